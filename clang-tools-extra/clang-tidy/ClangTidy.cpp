@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "ClangTidy.h"
+#include "ClangTidyCache.h"
 #include "ClangTidyCheck.h"
 #include "ClangTidyDiagnosticConsumer.h"
 #include "ClangTidyModuleRegistry.h"
@@ -495,15 +496,28 @@ getCheckOptions(const ClangTidyOptions &Options,
   return Factory.getCheckOptions();
 }
 
+static ClangTidyStats statsSince(const ClangTidyStats &Before,
+                                 const ClangTidyStats &After) {
+  ClangTidyStats Stats;
+  Stats.ErrorsDisplayed = After.ErrorsDisplayed - Before.ErrorsDisplayed;
+  Stats.ErrorsIgnoredCheckFilter =
+      After.ErrorsIgnoredCheckFilter - Before.ErrorsIgnoredCheckFilter;
+  Stats.ErrorsIgnoredNOLINT =
+      After.ErrorsIgnoredNOLINT - Before.ErrorsIgnoredNOLINT;
+  Stats.ErrorsIgnoredNonUserCode =
+      After.ErrorsIgnoredNonUserCode - Before.ErrorsIgnoredNonUserCode;
+  Stats.ErrorsIgnoredLineFilter =
+      After.ErrorsIgnoredLineFilter - Before.ErrorsIgnoredLineFilter;
+  return Stats;
+}
+
 std::vector<ClangTidyError>
 runClangTidy(clang::tidy::ClangTidyContext &Context,
              const CompilationDatabase &Compilations,
              ArrayRef<std::string> InputFiles,
              llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
-             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile) {
-  ClangTool Tool(Compilations, InputFiles,
-                 std::make_shared<PCHContainerOperations>(), BaseFS);
-
+             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile,
+             llvm::StringRef CacheDirectory) {
   // Add extra arguments passed by the clang-tidy command-line.
   ArgumentsAdjuster PerFileExtraArgumentsInserter =
       [&Context](const CommandLineArguments &Args, StringRef Filename) {
@@ -522,8 +536,15 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
         return AdjustedArgs;
       };
 
-  Tool.appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
-  Tool.appendArgumentsAdjuster(getStripPluginsAdjuster());
+  auto CreateTool = [&](ArrayRef<std::string> Files) {
+    auto Tool = std::make_unique<ClangTool>(
+        Compilations, Files, std::make_shared<PCHContainerOperations>(),
+        BaseFS);
+    Tool->appendArgumentsAdjuster(PerFileExtraArgumentsInserter);
+    Tool->appendArgumentsAdjuster(getStripPluginsAdjuster());
+    return Tool;
+  };
+
   Context.setEnableProfiling(EnableCheckProfile);
   Context.setProfileStoragePrefix(StoreCheckProfile);
 
@@ -531,7 +552,6 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
   DiagnosticsEngine DE(new DiagnosticIDs(), new DiagnosticOptions(),
                        &DiagConsumer, /*ShouldOwnClient=*/false);
   Context.setDiagnosticsEngine(&DE);
-  Tool.setDiagnosticConsumer(&DiagConsumer);
 
   class ActionFactory : public FrontendActionFactory {
   public:
@@ -568,8 +588,44 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
     ClangTidyASTConsumerFactory ConsumerFactory;
   };
 
-  ActionFactory Factory(Context, std::move(BaseFS));
-  Tool.run(&Factory);
+  ActionFactory Factory(Context, BaseFS);
+  if (CacheDirectory.empty()) {
+    std::unique_ptr<ClangTool> Tool = CreateTool(InputFiles);
+    Tool->setDiagnosticConsumer(&DiagConsumer);
+    Tool->run(&Factory);
+    return DiagConsumer.take();
+  }
+
+  // Analyze the files one at a time, so that the diagnostics of each
+  // translation unit can be stored separately. Incompatible fixes are only
+  // removed across all translation units, by DiagConsumer.take().
+  ClangTidyCache Cache(CacheDirectory);
+  for (const std::string &File : InputFiles) {
+    std::unique_ptr<ClangTool> Tool = CreateTool(File);
+    std::string Key = Cache.getKey(Context, Compilations, *Tool, File);
+    std::vector<ClangTidyError> Errors;
+    ClangTidyStats Stats;
+    if (!Key.empty() && Cache.lookup(Key, Errors, Stats)) {
+      DiagConsumer.addErrors(Errors, Stats);
+      continue;
+    }
+
+    ClangTidyDiagnosticConsumer FileDiagConsumer(
+        Context, /*ExternalDiagEngine=*/nullptr,
+        /*RemoveIncompatibleErrors=*/false);
+    DiagnosticsEngine FileDE(new DiagnosticIDs(), new DiagnosticOptions(),
+                             &FileDiagConsumer, /*ShouldOwnClient=*/false);
+    Context.setDiagnosticsEngine(&FileDE);
+    Tool->setDiagnosticConsumer(&FileDiagConsumer);
+    ClangTidyStats StatsBefore = Context.getStats();
+    Tool->run(&Factory);
+    Errors = FileDiagConsumer.take();
+    if (!Key.empty())
+      Cache.store(Key, Errors, statsSince(StatsBefore, Context.getStats()));
+    // The counters of the context are already up to date.
+    DiagConsumer.addErrors(Errors);
+    Context.setDiagnosticsEngine(&DE);
+  }
   return DiagConsumer.take();
 }
 
@@ -0,0 +1,343 @@
+//===--- ClangTidyCache.cpp - clang-tidy ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "ClangTidyCache.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/DiagnosticsYaml.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/YAMLTraits.h"
+
+namespace clang {
+namespace tidy {
+
+namespace {
+
+/// Bump this when the format of the cache entries or the way the keys are
+/// computed changes.
+constexpr llvm::StringLiteral CacheFormat = "clang-tidy-cache-1";
+
+/// A \c ClangTidyError as stored in a cache entry.
+struct CachedError {
+  tooling::Diagnostic Diag;
+  bool IsWarningAsError = false;
+  std::vector<std::string> EnabledDiagnosticAliases;
+};
+
+struct CacheEntry {
+  std::string Key;
+  std::vector<CachedError> Errors;
+  ClangTidyStats Stats;
+};
+
+/// Feeds a translation unit, as seen by the checks, into a SHA1 hash.
+class PreprocessedTokenHasher : public CommentHandler {
+public:
+  PreprocessedTokenHasher(Preprocessor &PP, llvm::SHA1 &Hasher)
+      : PP(PP), Hasher(Hasher) {}
+
+  void addNumber(uint64_t Value) {
+    Hasher.update(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(&Value), sizeof(Value)));
+  }
+
+  void addString(StringRef S) {
+    addNumber(S.size());
+    Hasher.update(S);
+  }
+
+  /// Adds the file and offset of \p Loc, as well as the location it was
+  /// spelled at if \p Loc is inside a macro expansion.
+  void addLocation(SourceLocation Loc) {
+    if (Loc.isInvalid()) {
+      addNumber(~0ULL);
+      return;
+    }
+    const SourceManager &SM = PP.getSourceManager();
+    addFileLocation(SM.getExpansionLoc(Loc));
+    if (Loc.isMacroID())
+      addFileLocation(SM.getSpellingLoc(Loc));
+  }
+
+  void addToken(const Token &Tok) {
+    addNumber(Tok.getKind());
+    addLocation(Tok.getLocation());
+    if (Tok.isAnnotation())
+      return;
+    llvm::SmallString<64> Buffer;
+    addString(PP.getSpelling(Tok, Buffer));
+  }
+
+  bool HandleComment(Preprocessor &PP, SourceRange Comment) override {
+    addNumber(tok::comment);
+    addLocation(Comment.getBegin());
+    addString(Lexer::getSourceText(
+        CharSourceRange::getCharRange(Comment), PP.getSourceManager(),
+        PP.getLangOpts()));
+    return false;
+  }
+
+private:
+  void addFileLocation(SourceLocation Loc) {
+    std::pair<FileID, unsigned> Decomposed =
+        PP.getSourceManager().getDecomposedLoc(Loc);
+    if (Decomposed.first != LastFile) {
+      LastFile = Decomposed.first;
+      addString(PP.getSourceManager().getBufferName(Loc));
+    }
+    addNumber(Decomposed.second);
+  }
+
+  Preprocessor &PP;
+  llvm::SHA1 &Hasher;
+  FileID LastFile;
+};
+
+/// Adds the directives that do not produce tokens, but are inspected by the
+/// \c PPCallbacks of some checks.
+class DirectiveHasher : public PPCallbacks {
+public:
+  DirectiveHasher(PreprocessedTokenHasher &Tokens) : Tokens(Tokens) {}
+
+  void MacroDefined(const Token &MacroNameTok,
+                    const MacroDirective *MD) override {
+    Tokens.addToken(MacroNameTok);
+    for (const Token &Tok : MD->getMacroInfo()->tokens())
+      Tokens.addToken(Tok);
+  }
+
+  void MacroUndefined(const Token &MacroNameTok, const MacroDefinition &MD,
+                      const MacroDirective *Undef) override {
+    Tokens.addToken(MacroNameTok);
+  }
+
+  void InclusionDirective(SourceLocation HashLoc, const Token &IncludeTok,
+                          StringRef FileName, bool IsAngled,
+                          CharSourceRange FilenameRange, const FileEntry *File,
+                          StringRef SearchPath, StringRef RelativePath,
+                          const Module *Imported,
+                          SrcMgr::CharacteristicKind FileType) override {
+    Tokens.addToken(IncludeTok);
+    Tokens.addString(FileName);
+    Tokens.addNumber(IsAngled);
+  }
+
+private:
+  PreprocessedTokenHasher &Tokens;
+};
+
+class HashPreprocessedTokensAction : public PreprocessorFrontendAction {
+public:
+  HashPreprocessedTokensAction(llvm::SHA1 &Hasher) : Hasher(Hasher) {}
+
+protected:
+  void ExecuteAction() override {
+    Preprocessor &PP = getCompilerInstance().getPreprocessor();
+    PreprocessedTokenHasher Tokens(PP, Hasher);
+    PP.addCommentHandler(&Tokens);
+    PP.addPPCallbacks(std::make_unique<DirectiveHasher>(Tokens));
+    PP.EnterMainSourceFile();
+    Token Tok;
+    for (PP.Lex(Tok); Tok.isNot(tok::eof); PP.Lex(Tok))
+      Tokens.addToken(Tok);
+    PP.removeCommentHandler(&Tokens);
+  }
+
+private:
+  llvm::SHA1 &Hasher;
+};
+
+class HashActionFactory : public tooling::FrontendActionFactory {
+public:
+  HashActionFactory(llvm::SHA1 &Hasher) : Hasher(Hasher) {}
+
+  std::unique_ptr<FrontendAction> create() override {
+    return std::make_unique<HashPreprocessedTokensAction>(Hasher);
+  }
+
+  bool runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                     FileManager *Files,
+                     std::shared_ptr<PCHContainerOperations> PCHContainerOps,
+                     DiagnosticConsumer *DiagConsumer) override {
+    // Preprocess the file the same way as runClangTidy() does.
+    Invocation->getPreprocessorOpts().SetUpStaticAnalyzer = true;
+    return FrontendActionFactory::runInvocation(
+        Invocation, Files, PCHContainerOps, DiagConsumer);
+  }
+
+private:
+  llvm::SHA1 &Hasher;
+};
+
+} // namespace
+} // namespace tidy
+} // namespace clang
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(clang::tidy::CachedError)
+
+namespace llvm {
+namespace yaml {
+
+template <> struct MappingTraits<clang::tidy::CachedError> {
+  static void mapping(IO &IO, clang::tidy::CachedError &Error) {
+    IO.mapRequired("Diagnostic", Error.Diag);
+    IO.mapOptional("IsWarningAsError", Error.IsWarningAsError, false);
+    IO.mapOptional("EnabledDiagnosticAliases",
+                   Error.EnabledDiagnosticAliases);
+  }
+};
+
+template <> struct MappingTraits<clang::tidy::ClangTidyStats> {
+  static void mapping(IO &IO, clang::tidy::ClangTidyStats &Stats) {
+    IO.mapRequired("ErrorsDisplayed", Stats.ErrorsDisplayed);
+    IO.mapRequired("ErrorsIgnoredCheckFilter", Stats.ErrorsIgnoredCheckFilter);
+    IO.mapRequired("ErrorsIgnoredNOLINT", Stats.ErrorsIgnoredNOLINT);
+    IO.mapRequired("ErrorsIgnoredNonUserCode", Stats.ErrorsIgnoredNonUserCode);
+    IO.mapRequired("ErrorsIgnoredLineFilter", Stats.ErrorsIgnoredLineFilter);
+  }
+};
+
+template <> struct MappingTraits<clang::tidy::CacheEntry> {
+  static void mapping(IO &IO, clang::tidy::CacheEntry &Entry) {
+    IO.mapRequired("Key", Entry.Key);
+    IO.mapRequired("Diagnostics", Entry.Errors);
+    IO.mapRequired("Stats", Entry.Stats);
+  }
+};
+
+} // namespace yaml
+} // namespace llvm
+
+namespace clang {
+namespace tidy {
+
+std::string ClangTidyCache::getKey(
+    ClangTidyContext &Context, const tooling::CompilationDatabase &Compilations,
+    tooling::ClangTool &Tool, StringRef File) const {
+  llvm::SHA1 Hasher;
+  auto AddString = [&Hasher](StringRef S) {
+    Hasher.update(std::to_string(S.size()));
+    Hasher.update(":");
+    Hasher.update(S);
+  };
+
+  AddString(CacheFormat);
+  AddString(getClangToolFullVersion("clang-tidy"));
+  AddString(Context.canEnableAnalyzerAlphaCheckers() ? "alpha" : "");
+  for (const tooling::CompileCommand &Command :
+       Compilations.getCompileCommands(File)) {
+    AddString(Command.Directory);
+    AddString(Command.Filename);
+    for (const std::string &Arg : Command.CommandLine)
+      AddString(Arg);
+  }
+  AddString(configurationAsText(Context.getOptionsForFile(File)));
+  for (const FileFilter &Filter : Context.getGlobalOptions().LineFilter) {
+    AddString(Filter.Name);
+    for (const FileFilter::LineRange &Range : Filter.LineRanges)
+      AddString(std::to_string(Range.first) + "-" +
+                std::to_string(Range.second));
+  }
+
+  // Errors are counted by the base class, but otherwise not reported; the
+  // analysis reports them if the file is not cached.
+  DiagnosticConsumer Diags;
+  Tool.setDiagnosticConsumer(&Diags);
+  HashActionFactory Factory(Hasher);
+  int Status = Tool.run(&Factory);
+  Tool.setDiagnosticConsumer(nullptr);
+  if (Status != 0)
+    return std::string();
+  return llvm::toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+std::string ClangTidyCache::getEntryPath(StringRef Key) const {
+  llvm::SmallString<256> Path(Directory);
+  llvm::sys::path::append(Path, Key.take_front(2), Key + ".yaml");
+  return std::string(Path);
+}
+
+bool ClangTidyCache::lookup(StringRef Key, std::vector<ClangTidyError> &Errors,
+                            ClangTidyStats &Stats) const {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> Buffer =
+      llvm::MemoryBuffer::getFile(getEntryPath(Key));
+  if (!Buffer)
+    return false;
+
+  CacheEntry Entry;
+  llvm::yaml::Input Input((*Buffer)->getBuffer());
+  Input >> Entry;
+  // Treat entries that cannot be read, e.g. because a write was interrupted,
+  // as missing; they are overwritten with the new results.
+  if (Input.error() || Entry.Key != Key)
+    return false;
+
+  Errors.clear();
+  for (CachedError &Cached : Entry.Errors) {
+    ClangTidyError Error(Cached.Diag.DiagnosticName, Cached.Diag.DiagLevel,
+                         Cached.Diag.BuildDirectory, Cached.IsWarningAsError);
+    static_cast<tooling::Diagnostic &>(Error) = std::move(Cached.Diag);
+    Error.EnabledDiagnosticAliases = std::move(Cached.EnabledDiagnosticAliases);
+    Errors.push_back(std::move(Error));
+  }
+  Stats = Entry.Stats;
+  return true;
+}
+
+void ClangTidyCache::store(StringRef Key, llvm::ArrayRef<ClangTidyError> Errors,
+                           const ClangTidyStats &Stats) const {
+  CacheEntry Entry;
+  Entry.Key = std::string(Key);
+  for (const ClangTidyError &Error : Errors)
+    Entry.Errors.push_back(
+        {Error, Error.IsWarningAsError, Error.EnabledDiagnosticAliases});
+  Entry.Stats = Stats;
+
+  std::string Path = getEntryPath(Key);
+  llvm::StringRef EntryDirectory = llvm::sys::path::parent_path(Path);
+  if (std::error_code EC = llvm::sys::fs::create_directories(EntryDirectory)) {
+    llvm::errs() << "Unable to create cache directory '" << EntryDirectory
+                 << "': " << EC.message() << "\n";
+    return;
+  }
+
+  // Write to a temporary file first, so that concurrent clang-tidy processes
+  // sharing the cache never read a partially written entry.
+  int FD;
+  llvm::SmallString<256> TempPath;
+  if (std::error_code EC =
+          llvm::sys::fs::createUniqueFile(Path + "-%%%%%%%%", FD, TempPath)) {
+    llvm::errs() << "Error creating cache file for '" << Path
+                 << "': " << EC.message() << "\n";
+    return;
+  }
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    llvm::yaml::Output YAML(OS);
+    YAML << Entry;
+  }
+  if (std::error_code EC = llvm::sys::fs::rename(TempPath, Path)) {
+    llvm::errs() << "Error writing cache file '" << Path
+                 << "': " << EC.message() << "\n";
+    llvm::sys::fs::remove(TempPath);
+  }
+}
+
+} // namespace tidy
+} // namespace clang
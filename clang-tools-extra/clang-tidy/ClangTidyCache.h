@@ -0,0 +1,68 @@
+//===--- ClangTidyCache.h - clang-tidy --------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANGTIDYCACHE_H
+#define LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANGTIDYCACHE_H
+
+#include "ClangTidyDiagnosticConsumer.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+namespace tooling {
+class ClangTool;
+class CompilationDatabase;
+} // namespace tooling
+
+namespace tidy {
+
+/// Caches the diagnostics of translation units in a directory, so that
+/// unchanged translation units are not analyzed again.
+///
+/// A translation unit is identified by a hash of everything its diagnostics
+/// depend on: the clang-tidy version, its compile commands, the effective
+/// clang-tidy options and the stream of preprocessed tokens with their
+/// locations, together with the comments, which hold NOLINT directives, and
+/// the macro definitions and inclusion directives seen by the checks'
+/// \c PPCallbacks. Editing a file that the translation unit does not include,
+/// or code that the preprocessor skips, does not invalidate the cached
+/// diagnostics, but any edit that moves a token does.
+class ClangTidyCache {
+public:
+  explicit ClangTidyCache(llvm::StringRef Directory)
+      : Directory(Directory.str()) {}
+
+  /// Computes the key of \p File by preprocessing it with \p Tool, which has
+  /// to be set up to analyze \p File alone. Returns an empty string if \p File
+  /// cannot be preprocessed; its diagnostics are not cached then.
+  std::string getKey(ClangTidyContext &Context,
+                     const tooling::CompilationDatabase &Compilations,
+                     tooling::ClangTool &Tool, llvm::StringRef File) const;
+
+  /// Restores the diagnostics stored under \p Key and the counters of the
+  /// diagnostics that were displayed or ignored when they were computed.
+  /// Returns false if there is no valid entry for \p Key.
+  bool lookup(llvm::StringRef Key, std::vector<ClangTidyError> &Errors,
+              ClangTidyStats &Stats) const;
+
+  /// Stores \p Errors and \p Stats under \p Key.
+  void store(llvm::StringRef Key, llvm::ArrayRef<ClangTidyError> Errors,
+             const ClangTidyStats &Stats) const;
+
+private:
+  std::string getEntryPath(llvm::StringRef Key) const;
+
+  std::string Directory;
+};
+
+} // end namespace tidy
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLS_EXTRA_CLANG_TIDY_CLANGTIDYCACHE_H
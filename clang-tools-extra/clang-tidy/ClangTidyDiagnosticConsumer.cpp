@@ -746,8 +746,23 @@ struct EqualClangTidyError {
 };
 } // end anonymous namespace
 
+void ClangTidyDiagnosticConsumer::addErrors(ArrayRef<ClangTidyError> NewErrors,
+                                            const ClangTidyStats &NewStats) {
+  // Keep them apart from Errors, whose last element may still be filtered out
+  // by finalizeLastError().
+  AddedErrors.insert(AddedErrors.end(), NewErrors.begin(), NewErrors.end());
+  Context.Stats.ErrorsDisplayed += NewStats.ErrorsDisplayed;
+  Context.Stats.ErrorsIgnoredCheckFilter += NewStats.ErrorsIgnoredCheckFilter;
+  Context.Stats.ErrorsIgnoredNOLINT += NewStats.ErrorsIgnoredNOLINT;
+  Context.Stats.ErrorsIgnoredNonUserCode += NewStats.ErrorsIgnoredNonUserCode;
+  Context.Stats.ErrorsIgnoredLineFilter += NewStats.ErrorsIgnoredLineFilter;
+}
+
 std::vector<ClangTidyError> ClangTidyDiagnosticConsumer::take() {
   finalizeLastError();
+  Errors.insert(Errors.end(), std::make_move_iterator(AddedErrors.begin()),
+                std::make_move_iterator(AddedErrors.end()));
+  AddedErrors.clear();
 
   llvm::stable_sort(Errors, LessClangTidyError());
   Errors.erase(std::unique(Errors.begin(), Errors.end(), EqualClangTidyError()),
@@ -246,6 +246,12 @@ public:
   // Retrieve the diagnostics that were captured.
   std::vector<ClangTidyError> take();
 
+  /// Adds diagnostics that were captured by another consumer, or restored from
+  /// the result cache, so that take() returns them together with the captured
+  /// ones. \p NewStats are added to the counters of the context.
+  void addErrors(llvm::ArrayRef<ClangTidyError> NewErrors,
+                 const ClangTidyStats &NewStats = ClangTidyStats());
+
 private:
   void finalizeLastError();
   void removeIncompatibleErrors();
@@ -266,6 +272,7 @@ private:
   DiagnosticsEngine *ExternalDiagEngine;
   bool RemoveIncompatibleErrors;
   std::vector<ClangTidyError> Errors;
+  std::vector<ClangTidyError> AddedErrors;
   std::unique_ptr<llvm::Regex> HeaderFilter;
   bool LastErrorRelatesToUserCode;
   bool LastErrorPassesLineFilter;
@@ -123,6 +123,8 @@ ClangdServer::Options ClangdServer::optsForTest() {
   Opts.AsyncThreadsCount = 4; // Consistent!
   Opts.TheiaSemanticHighlighting = true;
   Opts.AsyncPreambleBuilds = true;
+  // Tests count preamble builds per file.
+  Opts.SharePreambles = false;
   return Opts;
 }
 
@@ -133,6 +135,7 @@ ClangdServer::Options::operator TUScheduler::Options() const {
   Opts.StorePreamblesInMemory = StorePreamblesInMemory;
   Opts.UpdateDebounce = UpdateDebounce;
   Opts.AsyncPreambleBuilds = AsyncPreambleBuilds;
+  Opts.SharePreambles = SharePreambles;
   Opts.ContextProvider = ContextProvider;
   return Opts;
 }
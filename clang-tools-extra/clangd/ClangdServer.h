@@ -101,6 +101,9 @@ public:
     /// Reuse even stale preambles, and rebuild them in the background.
     /// This improves latency at the cost of accuracy.
     bool AsyncPreambleBuilds = true;
+    /// Reuse the preambles of other open files whose preamble region and
+    /// compile flags match, rather than building the same preamble again.
+    bool SharePreambles = true;
 
     /// If true, ClangdServer builds a dynamic in-memory index for symbols in
     /// opened files and uses the index to augment code completion results.
@@ -164,6 +164,16 @@ void IncludeStructure::recordInclude(llvm::StringRef IncludingName,
   IncludeChildren[Parent].push_back(Child);
 }
 
+void IncludeStructure::renameFile(llvm::StringRef OldName,
+                                  llvm::StringRef NewName) {
+  auto It = NameToIndex.find(OldName);
+  if (It == NameToIndex.end() || NameToIndex.count(NewName))
+    return;
+  unsigned Index = It->getValue();
+  NameToIndex.erase(It);
+  NameToIndex[NewName] = Index;
+}
+
 unsigned IncludeStructure::fileIndex(llvm::StringRef Name) {
   auto R = NameToIndex.try_emplace(Name, RealPathNames.size());
   if (R.second)
@@ -126,6 +126,10 @@ public:
                      llvm::StringRef IncludedName,
                      llvm::StringRef IncludedRealName);
 
+  // Makes the includes of \p OldName those of \p NewName, e.g. when the
+  // includes of a preamble are reused for another main file.
+  void renameFile(llvm::StringRef OldName, llvm::StringRef NewName);
+
 private:
   // Identifying files in a way that persists from preamble build to subsequent
   // builds is surprisingly hard. FileID is unavailable in InclusionDirective(),
@@ -255,7 +255,7 @@ ParsedAST::build(llvm::StringRef Filename, const ParseInputs &Inputs,
   // to leak memory in clangd.
   CI->getFrontendOpts().DisableFree = false;
   const PrecompiledPreamble *PreamblePCH =
-      Preamble ? &Preamble->Preamble : nullptr;
+      Preamble ? Preamble->Preamble.get() : nullptr;
 
   // This is on-by-default in windows to allow parsing SDK headers, but it
   // breaks many features. Disable it for the main-file (not preamble).
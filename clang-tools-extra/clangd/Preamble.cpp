@@ -37,11 +37,14 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/VirtualFileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include <iterator>
@@ -299,6 +302,60 @@ bool isMainFile(llvm::StringRef FileName, const SourceManager &SM) {
   return FE && *FE == SM.getFileEntryForID(SM.getMainFileID());
 }
 
+// Returns clang's name for the main file compiled by \p CI.
+std::string mainFileName(const CompilerInvocation &CI) {
+  const auto &Inputs = CI.getFrontendOpts().Inputs;
+  return Inputs.empty() ? std::string() : Inputs.front().getFile().str();
+}
+
+// Identifies everything besides the preamble region that the preamble of
+// \p FileName depends on: the directories includes are resolved in, and the
+// compile flags apart from the ones naming the file itself or its outputs.
+std::string sharedPreambleKey(PathRef FileName, llvm::StringRef Directory,
+                              const CompilerInvocation &CI) {
+  CompilerInvocation Flags(CI);
+  Flags.getFrontendOpts().Inputs.clear();
+  Flags.getFrontendOpts().OutputFile.clear();
+  Flags.getDependencyOutputOpts() = DependencyOutputOptions();
+  Flags.getDiagnosticOpts().DiagnosticSerializationFile.clear();
+  auto &CodeGenOpts = Flags.getCodeGenOpts();
+  CodeGenOpts.MainFileName.clear();
+  CodeGenOpts.DwarfDebugFlags.clear();
+  CodeGenOpts.CoverageDataFile.clear();
+  CodeGenOpts.CoverageNotesFile.clear();
+
+  llvm::BumpPtrAllocator Alloc;
+  llvm::StringSaver Saver(Alloc);
+  llvm::SmallVector<const char *, 64> Args;
+  Flags.generateCC1CommandLine(Args, [&Saver](const llvm::Twine &Arg) {
+    return Saver.save(Arg).data();
+  });
+
+  llvm::SHA1 Hasher;
+  auto Add = [&Hasher](llvm::StringRef S) {
+    Hasher.update(S);
+    Hasher.update(llvm::StringRef("\0", 1));
+  };
+  Add(Directory);
+  Add(llvm::sys::path::parent_path(FileName));
+  for (const char *Arg : Args)
+    Add(Arg);
+  return llvm::toHex(Hasher.final());
+}
+
+// Returns a copy of \p Shared, which was built for another file, to be used
+// for \p Inputs of \p FileName. The copy shares the compiled preamble.
+std::shared_ptr<const PreambleData>
+adoptPreamble(const PreambleData &Shared, const ParseInputs &Inputs,
+              const CompilerInvocation &CI) {
+  auto Result = std::make_shared<PreambleData>(Shared);
+  Result->Version = Inputs.Version;
+  Result->CompileCommand = Inputs.CompileCommand;
+  Result->MainFileName = mainFileName(CI);
+  Result->Includes.renameFile(Shared.MainFileName, Result->MainFileName);
+  return Result;
+}
+
 } // namespace
 
 PreambleData::PreambleData(const ParseInputs &Inputs,
@@ -308,10 +365,11 @@ PreambleData::PreambleData(const ParseInputs &Inputs,
                            std::unique_ptr<PreambleFileStatusCache> StatCache,
                            CanonicalIncludes CanonIncludes)
     : Version(Inputs.Version), CompileCommand(Inputs.CompileCommand),
-      Preamble(std::move(Preamble)), Diags(std::move(Diags)),
-      Includes(std::move(Includes)), Macros(std::move(Macros)),
-      StatCache(std::move(StatCache)), CanonIncludes(std::move(CanonIncludes)) {
-}
+      Preamble(
+          std::make_shared<const PrecompiledPreamble>(std::move(Preamble))),
+      Diags(std::move(Diags)), Includes(std::move(Includes)),
+      Macros(std::move(Macros)), StatCache(std::move(StatCache)),
+      CanonIncludes(std::move(CanonIncludes)) {}
 
 std::shared_ptr<const PreambleData>
 buildPreamble(PathRef FileName, CompilerInvocation CI,
@@ -357,11 +415,13 @@ buildPreamble(PathRef FileName, CompilerInvocation CI,
     vlog("Built preamble of size {0} for file {1} version {2}",
          BuiltPreamble->getSize(), FileName, Inputs.Version);
     std::vector<Diag> Diags = PreambleDiagnostics.take();
-    return std::make_shared<PreambleData>(
+    auto Result = std::make_shared<PreambleData>(
         Inputs, std::move(*BuiltPreamble), std::move(Diags),
         SerializedDeclsCollector.takeIncludes(),
         SerializedDeclsCollector.takeMacros(), std::move(StatCache),
         SerializedDeclsCollector.takeCanonicalIncludes());
+    Result->MainFileName = mainFileName(CI);
+    return Result;
   } else {
     elog("Could not build a preamble for file {0} version {1}", FileName,
          Inputs.Version);
@@ -378,7 +438,71 @@ bool isPreambleCompatible(const PreambleData &Preamble,
   auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
   return compileCommandsAreEqual(Inputs.CompileCommand,
                                  Preamble.CompileCommand) &&
-         Preamble.Preamble.CanReuse(CI, *ContentsBuffer, Bounds, *VFS);
+         Preamble.Preamble->CanReuse(CI, *ContentsBuffer, Bounds, *VFS);
+}
+
+SharedPreambleCache::Match
+SharedPreambleCache::lookup(PathRef FileName, const ParseInputs &Inputs,
+                            const CompilerInvocation &CI) {
+  std::string Key =
+      sharedPreambleKey(FileName, Inputs.CompileCommand.Directory, CI);
+  std::vector<std::shared_ptr<const PreambleData>> Candidates;
+  {
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto It = Preambles.find(Key);
+    if (It == Preambles.end())
+      return {};
+    llvm::DenseSet<const PrecompiledPreamble *> Seen;
+    for (const auto &Entry : It->second) {
+      auto Candidate = Entry.lock();
+      // Files that adopted a preamble share it, only check it once.
+      if (Candidate && Seen.insert(Candidate->Preamble.get()).second)
+        Candidates.push_back(std::move(Candidate));
+    }
+    if (Candidates.empty()) {
+      Preambles.erase(It);
+      return {};
+    }
+  }
+
+  trace::Span Tracer("LookupSharedPreamble");
+  SPAN_ATTACH(Tracer, "File", FileName);
+  auto ContentsBuffer =
+      llvm::MemoryBuffer::getMemBuffer(Inputs.Contents, FileName);
+  auto Bounds = ComputePreambleBounds(*CI.getLangOpts(), *ContentsBuffer, 0);
+  auto VFS = Inputs.TFS->view(Inputs.CompileCommand.Directory);
+  const PreambleData *Prefix = nullptr;
+  for (const auto &Candidate : Candidates) {
+    const PrecompiledPreamble &PCH = *Candidate->Preamble;
+    if (PCH.CanReuse(CI, *ContentsBuffer, Bounds, *VFS))
+      return {adoptPreamble(*Candidate, Inputs, CI), /*Exact=*/true};
+    // The candidate can serve as the baseline of a PreamblePatch if the file
+    // starts with all of its preamble region, e.g. because it only adds
+    // includes. Its headers are not checked for changes, as stale preambles
+    // are reused the same way while rebuilding.
+    PreambleBounds CandidateBounds = PCH.getBounds();
+    if (CandidateBounds.PreambleEndsAtStartOfLine &&
+        CandidateBounds.Size < Bounds.Size &&
+        llvm::StringRef(Inputs.Contents).startswith(PCH.getContents()) &&
+        (!Prefix || Prefix->Preamble->getBounds().Size < CandidateBounds.Size))
+      Prefix = Candidate.get();
+  }
+  if (!Prefix)
+    return {};
+  return {adoptPreamble(*Prefix, Inputs, CI), /*Exact=*/false};
+}
+
+void SharedPreambleCache::insert(PathRef FileName,
+                                 const CompilerInvocation &CI,
+                                 std::shared_ptr<const PreambleData> Preamble) {
+  std::string Key =
+      sharedPreambleKey(FileName, Preamble->CompileCommand.Directory, CI);
+  std::lock_guard<std::mutex> Lock(Mu);
+  auto &Entries = Preambles[Key];
+  llvm::erase_if(Entries, [](const std::weak_ptr<const PreambleData> &Entry) {
+    return Entry.expired();
+  });
+  Entries.push_back(std::move(Preamble));
 }
 
 void escapeBackslashAndQuotes(llvm::StringRef Text, llvm::raw_ostream &OS) {
@@ -411,7 +535,7 @@ PreamblePatch PreamblePatch::create(llvm::StringRef FileName,
   //   there's nothing to do but generate an empty patch.
   auto BaselineScan = scanPreamble(
       // Contents needs to be null-terminated.
-      Baseline.Preamble.getContents().str(), Modified.CompileCommand);
+      Baseline.Preamble->getContents().str(), Modified.CompileCommand);
   if (!BaselineScan) {
     elog("Failed to scan baseline of {0}: {1}", FileName,
          BaselineScan.takeError());
@@ -522,7 +646,7 @@ std::vector<Inclusion> PreamblePatch::preambleIncludes() const {
 PreamblePatch PreamblePatch::unmodified(const PreambleData &Preamble) {
   PreamblePatch PP;
   PP.PreambleIncludes = Preamble.Includes.MainFileIncludes;
-  PP.ModifiedBounds = Preamble.Preamble.getBounds();
+  PP.ModifiedBounds = Preamble.Preamble->getBounds();
   return PP;
 }
 
@@ -13,6 +13,10 @@
 // the result multiple times. The preamble is invalidated by changes to the
 // code in the preamble region, to the compile command, or to files on disk.
 //
+// Files that start with the same preamble region and are compiled with the
+// same flags, e.g. the sources of one module that all begin with the same
+// block of includes, can share a single preamble, see SharedPreambleCache.
+//
 // This is the most important optimization in clangd: it allows operations like
 // code-completion to have sub-second latency. It is supported by the
 // PrecompiledPreamble functionality in clang, which wraps the techniques used
@@ -33,9 +37,11 @@
 #include "clang/Frontend/PrecompiledPreamble.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -46,6 +52,9 @@ namespace clangd {
 ///
 /// As we must avoid re-parsing the preamble, any information that can only
 /// be obtained during parsing must be eagerly captured and stored here.
+///
+/// The compiled preamble and the file status cache may be shared with the
+/// PreambleData of other files, see SharedPreambleCache.
 struct PreambleData {
   PreambleData(const ParseInputs &Inputs, PrecompiledPreamble Preamble,
                std::vector<Diag> Diags, IncludeStructure Includes,
@@ -56,7 +65,7 @@ struct PreambleData {
   // Version of the ParseInputs this preamble was built from.
   std::string Version;
   tooling::CompileCommand CompileCommand;
-  PrecompiledPreamble Preamble;
+  std::shared_ptr<const PrecompiledPreamble> Preamble;
   std::vector<Diag> Diags;
   // Processes like code completions and go-to-definitions will need #include
   // information, and their compile action skips preamble range.
@@ -67,8 +76,10 @@ struct PreambleData {
   MainFileMacros Macros;
   // Cache of FS operations performed when building the preamble.
   // When reusing a preamble, this cache can be consumed to save IO.
-  std::unique_ptr<PreambleFileStatusCache> StatCache;
+  std::shared_ptr<const PreambleFileStatusCache> StatCache;
   CanonicalIncludes CanonIncludes;
+  // Clang's name for the main file, the root of Includes.
+  std::string MainFileName;
 };
 
 using PreambleParsedCallback =
@@ -91,6 +102,41 @@ bool isPreambleCompatible(const PreambleData &Preamble,
                           const ParseInputs &Inputs, PathRef FileName,
                           const CompilerInvocation &CI);
 
+/// Keeps track of the preambles of all open files, so that a file can reuse
+/// the preamble of another file that starts with the same preamble region and
+/// is compiled with the same flags in the same directory, instead of building
+/// an identical one. Only weak references are held: a preamble is released as
+/// soon as no file uses it any more.
+class SharedPreambleCache {
+public:
+  struct Match {
+    std::shared_ptr<const PreambleData> Preamble;
+    /// Whether Preamble can be used verbatim. Otherwise the preamble region of
+    /// the file extends beyond the one of Preamble, e.g. by additional
+    /// includes, and the file must be parsed with a PreamblePatch.
+    bool Exact = false;
+  };
+
+  /// Returns a preamble for \p Inputs of \p FileName, preferring one that can
+  /// be reused verbatim, or the one with the longest preamble region that is
+  /// a prefix of the preamble region of \p Inputs. Exact matches are returned
+  /// as a copy of the original PreambleData that carries the version and
+  /// compile command of \p Inputs, but shares the compiled preamble.
+  Match lookup(PathRef FileName, const ParseInputs &Inputs,
+               const CompilerInvocation &CI);
+
+  /// Makes \p Preamble, built for \p Inputs of \p FileName, available to
+  /// other files.
+  void insert(PathRef FileName, const CompilerInvocation &CI,
+              std::shared_ptr<const PreambleData> Preamble);
+
+private:
+  std::mutex Mu;
+  // Keyed by a hash of the compile flags and the directory of the file.
+  llvm::StringMap<std::vector<std::weak_ptr<const PreambleData>>>
+      Preambles; /* GUARDED_BY(Mu) */
+};
+
 /// Stores information required to parse a TU using a (possibly stale) Baseline
 /// preamble. Later on this information can be injected into the main file by
 /// updating compiler invocation with \c apply. This injected section
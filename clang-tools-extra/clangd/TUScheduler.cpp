@@ -221,10 +221,11 @@ class PreambleThread {
 public:
   PreambleThread(llvm::StringRef FileName, ParsingCallbacks &Callbacks,
                  bool StorePreambleInMemory, bool RunSync,
+                 SharedPreambleCache *SharedPreambles,
                  SynchronizedTUStatus &Status, ASTWorker &AW)
       : FileName(FileName), Callbacks(Callbacks),
-        StoreInMemory(StorePreambleInMemory), RunSync(RunSync), Status(Status),
-        ASTPeer(AW) {}
+        StoreInMemory(StorePreambleInMemory), RunSync(RunSync),
+        SharedPreambles(SharedPreambles), Status(Status), ASTPeer(AW) {}
 
   /// It isn't guaranteed that each requested version will be built. If there
   /// are multiple update requests while building a preamble, only the last one
@@ -348,6 +349,8 @@ private:
   ParsingCallbacks &Callbacks;
   const bool StoreInMemory;
   const bool RunSync;
+  // Preambles of other files that can be reused, may be null.
+  SharedPreambleCache *const SharedPreambles;
 
   SynchronizedTUStatus &Status;
   ASTWorker &ASTPeer;
@@ -368,8 +371,10 @@ class ASTWorkerHandle;
 class ASTWorker {
   friend class ASTWorkerHandle;
   ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
-            TUScheduler::ASTCache &LRUCache, Semaphore &Barrier, bool RunSync,
-            const TUScheduler::Options &Opts, ParsingCallbacks &Callbacks);
+            TUScheduler::ASTCache &LRUCache,
+            SharedPreambleCache *SharedPreambles, Semaphore &Barrier,
+            bool RunSync, const TUScheduler::Options &Opts,
+            ParsingCallbacks &Callbacks);
 
 public:
   /// Create a new ASTWorker and return a handle to it.
@@ -377,9 +382,11 @@ public:
   /// is null, all requests will be processed on the calling thread
   /// synchronously instead. \p Barrier is acquired when processing each
   /// request, it is used to limit the number of actively running threads.
+  /// \p SharedPreambles, if not null, provides preambles of other files.
   static ASTWorkerHandle create(PathRef FileName,
                                 const GlobalCompilationDatabase &CDB,
                                 TUScheduler::ASTCache &IdleASTs,
+                                SharedPreambleCache *SharedPreambles,
                                 AsyncTaskRunner *Tasks, Semaphore &Barrier,
                                 const TUScheduler::Options &Opts,
                                 ParsingCallbacks &Callbacks);
@@ -573,11 +580,13 @@ private:
 ASTWorkerHandle ASTWorker::create(PathRef FileName,
                                   const GlobalCompilationDatabase &CDB,
                                   TUScheduler::ASTCache &IdleASTs,
+                                  SharedPreambleCache *SharedPreambles,
                                   AsyncTaskRunner *Tasks, Semaphore &Barrier,
                                   const TUScheduler::Options &Opts,
                                   ParsingCallbacks &Callbacks) {
-  std::shared_ptr<ASTWorker> Worker(new ASTWorker(
-      FileName, CDB, IdleASTs, Barrier, /*RunSync=*/!Tasks, Opts, Callbacks));
+  std::shared_ptr<ASTWorker> Worker(
+      new ASTWorker(FileName, CDB, IdleASTs, SharedPreambles, Barrier,
+                    /*RunSync=*/!Tasks, Opts, Callbacks));
   if (Tasks) {
     Tasks->runAsync("ASTWorker:" + llvm::sys::path::filename(FileName),
                     [Worker]() { Worker->run(); });
@@ -589,7 +598,8 @@ ASTWorkerHandle ASTWorker::create(PathRef FileName,
 }
 
 ASTWorker::ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
-                     TUScheduler::ASTCache &LRUCache, Semaphore &Barrier,
+                     TUScheduler::ASTCache &LRUCache,
+                     SharedPreambleCache *SharedPreambles, Semaphore &Barrier,
                      bool RunSync, const TUScheduler::Options &Opts,
                      ParsingCallbacks &Callbacks)
     : IdleASTs(LRUCache), RunSync(RunSync), UpdateDebounce(Opts.UpdateDebounce),
@@ -597,7 +607,8 @@ ASTWorker::ASTWorker(PathRef FileName, const GlobalCompilationDatabase &CDB,
       Callbacks(Callbacks), Barrier(Barrier), Done(false),
       Status(FileName, Callbacks),
       PreamblePeer(FileName, Callbacks, Opts.StorePreamblesInMemory,
-                   RunSync || !Opts.AsyncPreambleBuilds, Status, *this) {
+                   RunSync || !Opts.AsyncPreambleBuilds, SharedPreambles,
+                   Status, *this) {
   // Set a fallback command because compile command can be accessed before
   // `Inputs` is initialized. Other fields are only used after initialization
   // from client inputs.
@@ -771,6 +782,28 @@ void PreambleThread::build(Request Req) {
          FileName, Inputs.Version, LatestBuild->Version);
   }
 
+  if (SharedPreambles && !Inputs.ForceRebuild) {
+    SharedPreambleCache::Match Shared =
+        SharedPreambles->lookup(FileName, Inputs, *Req.CI);
+    if (Shared.Exact) {
+      vlog("Reusing shared preamble for {0} version {1}", FileName,
+           Inputs.Version);
+      LatestBuild = std::move(Shared.Preamble);
+      SharedPreambles->insert(FileName, *Req.CI, LatestBuild);
+      return;
+    }
+    // Another file starts with a part of our preamble region. Until our own
+    // preamble is built, serve the first ASTs from its preamble with a patch,
+    // as is done for stale preambles.
+    if (Shared.Preamble && !LatestBuild) {
+      vlog("Using shared preamble for a prefix of {0} version {1}", FileName,
+           Inputs.Version);
+      ASTPeer.updatePreamble(std::make_unique<CompilerInvocation>(*Req.CI),
+                             Inputs, std::move(Shared.Preamble), Req.CIDiags,
+                             Req.WantDiags);
+    }
+  }
+
   LatestBuild = clang::clangd::buildPreamble(
       FileName, *Req.CI, Inputs, StoreInMemory,
       [this, Version(Inputs.Version)](ASTContext &Ctx,
@@ -779,6 +812,8 @@ void PreambleThread::build(Request Req) {
         Callbacks.onPreambleAST(FileName, Version, Ctx, std::move(PP),
                                 CanonIncludes);
       });
+  if (SharedPreambles && LatestBuild)
+    SharedPreambles->insert(FileName, *Req.CI, LatestBuild);
 }
 
 void ASTWorker::updatePreamble(std::unique_ptr<CompilerInvocation> CI,
@@ -967,7 +1002,7 @@ TUScheduler::FileStats ASTWorker::stats() const {
   // only, so this should be fine.
   Result.UsedBytesAST = IdleASTs.getUsedBytes(this);
   if (auto Preamble = getPossiblyStalePreamble())
-    Result.UsedBytesPreamble = Preamble->Preamble.getSize();
+    Result.UsedBytesPreamble = Preamble->Preamble->getSize();
   return Result;
 }
 
@@ -1274,6 +1309,8 @@ TUScheduler::TUScheduler(const GlobalCompilationDatabase &CDB,
       return Context::current().clone();
     };
   }
+  if (Opts.SharePreambles)
+    SharedPreambles = std::make_unique<SharedPreambleCache>();
   if (0 < Opts.AsyncThreadsCount) {
     PreambleTasks.emplace();
     WorkerThreads.emplace();
@@ -1309,7 +1346,7 @@ bool TUScheduler::update(PathRef File, ParseInputs Inputs,
   if (!FD) {
     // Create a new worker to process the AST-related tasks.
     ASTWorkerHandle Worker =
-        ASTWorker::create(File, CDB, *IdleASTs,
+        ASTWorker::create(File, CDB, *IdleASTs, SharedPreambles.get(),
                           WorkerThreads ? WorkerThreads.getPointer() : nullptr,
                           Barrier, Opts, *Callbacks);
     FD = std::unique_ptr<FileData>(
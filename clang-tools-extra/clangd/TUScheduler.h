@@ -28,6 +28,7 @@ namespace clang {
 namespace clangd {
 class ParsedAST;
 struct PreambleData;
+class SharedPreambleCache;
 
 /// Returns a number of a default async threads to use for TUScheduler.
 /// Returned value is always >= 1 (i.e. will not cause requests to be processed
@@ -200,6 +201,10 @@ public:
     /// No-op if AsyncThreadsCount is 0.
     bool AsyncPreambleBuilds = true;
 
+    /// Reuse the preamble of another open file with the same preamble region
+    /// and compile flags instead of building an identical one.
+    bool SharePreambles = false;
+
     /// Used to create a context that wraps each single operation.
     /// Typically to inject per-file configuration.
     /// If the path is empty, context sholud be "generic".
@@ -336,6 +341,8 @@ private:
   Semaphore QuickRunBarrier;
   llvm::StringMap<std::unique_ptr<FileData>> Files;
   std::unique_ptr<ASTCache> IdleASTs;
+  // Null unless Opts.SharePreambles is set.
+  std::unique_ptr<SharedPreambleCache> SharedPreambles;
   // None when running tasks synchronously and non-None when running tasks
   // asynchronously.
   llvm::Optional<AsyncTaskRunner> PreambleTasks;
@@ -199,6 +199,7 @@ private:
   const GlobalCompilationDatabase &CDB;
   std::function<Context(PathRef)> ContextProvider;
   bool CollectMainFileRefs;
+  unsigned ThreadPoolSize;
 
   llvm::Error index(tooling::CompileCommand);
 
@@ -11,11 +11,14 @@
 #include "index/Background.h"
 #include "support/Logger.h"
 #include "support/Path.h"
+#include "support/Threading.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <utility>
 #include <vector>
@@ -28,55 +31,72 @@ namespace {
 /// inverse dependency mapping.
 class BackgroundIndexLoader {
 public:
-  BackgroundIndexLoader(BackgroundIndexStorage::Factory &IndexStorageFactory)
-      : IndexStorageFactory(IndexStorageFactory) {}
-  /// Load the shards for \p MainFile and all of its dependencies.
-  void load(PathRef MainFile);
+  BackgroundIndexLoader(BackgroundIndexStorage::Factory &IndexStorageFactory,
+                        unsigned Parallelism)
+      : IndexStorageFactory(IndexStorageFactory), Parallelism(Parallelism) {}
+  /// Load the shards for \p MainFiles and all of their dependencies.
+  void load(llvm::ArrayRef<Path> MainFiles);
 
   /// Consumes the loader and returns all shards.
   std::vector<LoadedShard> takeResult() &&;
 
 private:
-  /// Returns the Shard for \p StartSourceFile from cache or loads it from \p
-  /// Storage. Also returns paths for dependencies of \p StartSourceFile if it
-  /// wasn't cached yet.
-  std::pair<const LoadedShard &, std::vector<Path>>
-  loadShard(PathRef StartSourceFile, PathRef DependentTU);
+  /// A shard that was discovered but not read from storage yet.
+  struct PendingShard {
+    LoadedShard *LS;
+    BackgroundIndexStorage *Storage;
+    /// Paths for dependencies of the shard, filled in by loadShard.
+    std::vector<Path> Edges;
+  };
+
+  /// Creates the cache entry for \p SourceFile and schedules it for loading,
+  /// unless it was already seen.
+  void enqueue(PathRef SourceFile, PathRef DependentTU);
+
+  /// Reads the shard for \p P.LS from \p P.Storage and fills in its metadata
+  /// and dependencies. Safe to run concurrently for distinct shards.
+  static void loadShard(PendingShard &P);
 
   /// Cache for Storage lookups.
   llvm::StringMap<LoadedShard> LoadedShards;
+  /// Shards of the BFS level currently being loaded.
+  std::vector<PendingShard> ToLoad;
 
   BackgroundIndexStorage::Factory &IndexStorageFactory;
+  unsigned Parallelism;
 };
 
-std::pair<const LoadedShard &, std::vector<Path>>
-BackgroundIndexLoader::loadShard(PathRef StartSourceFile, PathRef DependentTU) {
-  auto It = LoadedShards.try_emplace(StartSourceFile);
-  LoadedShard &LS = It.first->getValue();
-  std::vector<Path> Edges = {};
-  // Return the cached shard.
+void BackgroundIndexLoader::enqueue(PathRef SourceFile, PathRef DependentTU) {
+  auto It = LoadedShards.try_emplace(SourceFile);
   if (!It.second)
-    return {LS, Edges};
-
-  LS.AbsolutePath = StartSourceFile.str();
+    return;
+  // StringMap entries are never moved, so the pointer stays valid as the map
+  // grows.
+  LoadedShard &LS = It.first->getValue();
+  LS.AbsolutePath = SourceFile.str();
   LS.DependentTU = std::string(DependentTU);
-  BackgroundIndexStorage *Storage = IndexStorageFactory(LS.AbsolutePath);
-  auto Shard = Storage->loadShard(StartSourceFile);
+  // The factory isn't thread-safe, so storages are looked up upfront.
+  ToLoad.push_back({&LS, IndexStorageFactory(LS.AbsolutePath), {}});
+}
+
+void BackgroundIndexLoader::loadShard(PendingShard &P) {
+  LoadedShard &LS = *P.LS;
+  auto Shard = P.Storage->loadShard(LS.AbsolutePath);
   if (!Shard || !Shard->Sources) {
-    vlog("Failed to load shard: {0}", StartSourceFile);
-    return {LS, Edges};
+    vlog("Failed to load shard: {0}", LS.AbsolutePath);
+    return;
   }
 
   LS.Shard = std::move(Shard);
   for (const auto &It : *LS.Shard->Sources) {
-    auto AbsPath = URI::resolve(It.getKey(), StartSourceFile);
+    auto AbsPath = URI::resolve(It.getKey(), LS.AbsolutePath);
     if (!AbsPath) {
       elog("Failed to resolve URI: {0}", AbsPath.takeError());
       continue;
     }
     // A shard contains only edges for non main-file sources.
-    if (*AbsPath != StartSourceFile) {
-      Edges.push_back(*AbsPath);
+    if (*AbsPath != LS.AbsolutePath) {
+      P.Edges.push_back(*AbsPath);
       continue;
     }
 
@@ -87,26 +107,43 @@ BackgroundIndexLoader::loadShard(PathRef StartSourceFile, PathRef DependentTU) {
     LS.HadErrors = IGN.Flags & IncludeGraphNode::SourceFlag::HadErrors;
   }
   assert(LS.Digest != FileDigest{{0}} && "Digest is empty?");
-  return {LS, Edges};
 }
 
-void BackgroundIndexLoader::load(PathRef MainFile) {
-  llvm::StringSet<> InQueue;
-  // Following containers points to strings inside InQueue.
-  std::queue<PathRef> ToVisit;
-  InQueue.insert(MainFile);
-  ToVisit.push(MainFile);
-
-  while (!ToVisit.empty()) {
-    PathRef SourceFile = ToVisit.front();
-    ToVisit.pop();
-
-    auto ShardAndEdges = loadShard(SourceFile, MainFile);
-    for (PathRef Edge : ShardAndEdges.second) {
-      auto It = InQueue.insert(Edge);
-      if (It.second)
-        ToVisit.push(It.first->getKey());
+void BackgroundIndexLoader::load(llvm::ArrayRef<Path> MainFiles) {
+  for (PathRef MainFile : MainFiles) {
+    assert(llvm::sys::path::is_absolute(MainFile));
+    enqueue(MainFile, MainFile);
+  }
+
+  // Traverse the include graphs of all main files breadth-first, reading and
+  // deserializing the shards of a level concurrently. Which shards exist is
+  // only known once their dependents are loaded, so levels are processed one
+  // at a time.
+  while (!ToLoad.empty()) {
+    std::atomic<size_t> Next = {0};
+    auto Worker = [&] {
+      for (size_t I = Next++; I < ToLoad.size(); I = Next++)
+        loadShard(ToLoad[I]);
+    };
+    {
+      AsyncTaskRunner Tasks;
+      size_t Workers = std::min<size_t>(Parallelism, ToLoad.size());
+      for (size_t I = 1; I < Workers; ++I)
+        Tasks.runAsync("shard-loader:" + llvm::Twine(I),
+                       [Worker, Ctx = Context::current().clone()]() mutable {
+                         WithContext WithCtx(std::move(Ctx));
+                         Worker();
+                       });
+      // The current thread works on the level as well, so no threads are
+      // spawned without parallelism.
+      Worker();
     }
+
+    std::vector<PendingShard> Loaded = std::move(ToLoad);
+    ToLoad.clear();
+    for (const PendingShard &P : Loaded)
+      for (PathRef Edge : P.Edges)
+        enqueue(Edge, P.LS->DependentTU);
   }
 }
 
@@ -122,12 +159,10 @@ std::vector<LoadedShard> BackgroundIndexLoader::takeResult() && {
 std::vector<LoadedShard>
 loadIndexShards(llvm::ArrayRef<Path> MainFiles,
                 BackgroundIndexStorage::Factory &IndexStorageFactory,
-                const GlobalCompilationDatabase &CDB) {
-  BackgroundIndexLoader Loader(IndexStorageFactory);
-  for (llvm::StringRef MainFile : MainFiles) {
-    assert(llvm::sys::path::is_absolute(MainFile));
-    Loader.load(MainFile);
-  }
+                const GlobalCompilationDatabase &CDB,
+                unsigned Parallelism) {
+  BackgroundIndexLoader Loader(IndexStorageFactory, Parallelism);
+  Loader.load(MainFiles);
   return std::move(Loader).takeResult();
 }
 
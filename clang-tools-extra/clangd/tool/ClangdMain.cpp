@@ -460,6 +460,15 @@ opt<bool> AsyncPreamble{
     Hidden,
 };
 
+opt<bool> SharePreambles{
+    "share-preambles",
+    cat(Misc),
+    desc("Reuse the preamble of another open file with the same includes and "
+         "compile flags instead of building it again."),
+    init(ClangdServer::Options().SharePreambles),
+    Hidden,
+};
+
 opt<bool> EnableConfig{
     "enable-config",
     cat(Misc),
@@ -861,6 +870,7 @@ clangd accepts flags on the commandline, and in the CLANGD_FLAGS environment var
     Opts.ClangTidyProvider = ClangTidyOptProvider;
   }
   Opts.AsyncPreambleBuilds = AsyncPreamble;
+  Opts.SharePreambles = SharePreambles;
   Opts.QueryDriverGlobs = std::move(QueryDriverGlobs);
   Opts.TweakFilter = [&](const Tweak &T) {
     if (T.hidden() && !HiddenFeatures)
@@ -6,6 +6,7 @@
 #include "TestIndex.h"
 #include "TestTU.h"
 #include "index/Background.h"
+#include "index/BackgroundIndexLoader.h"
 #include "index/BackgroundRebuild.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
@@ -15,6 +16,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include <deque>
+#include <map>
 #include <thread>
 
 using ::testing::_;
@@ -551,6 +553,63 @@ TEST_F(BackgroundIndexTest, ShardStorageEmptyFile) {
               Contains(AllOf(Named("new_func"), Declared(), Not(Defined()))));
 }
 
+TEST_F(BackgroundIndexTest, ShardLoaderParallel) {
+  MockFS FS;
+  FS.Files[testPath("root/Deep.h")] = "void deep();";
+  FS.Files[testPath("root/B.h")] = "#include \"Deep.h\"\nvoid b();";
+  FS.Files[testPath("root/Common.h")] = "void common();";
+  FS.Files[testPath("root/A.cc")] =
+      "#include \"Common.h\"\nvoid a() { common(); }";
+  FS.Files[testPath("root/B.cc")] =
+      "#include \"Common.h\"\n#include \"B.h\"\nvoid g() { b(); deep(); }";
+
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  BackgroundIndexStorage::Factory MSSFactory = [&](llvm::StringRef) {
+    return &MSS;
+  };
+  OverlayCDB CDB(/*Base=*/nullptr);
+  {
+    BackgroundIndex Idx(FS, CDB, [&](llvm::StringRef) { return &MSS; },
+                        /*Opts=*/{});
+    for (llvm::StringRef Name : {"A.cc", "B.cc"}) {
+      tooling::CompileCommand Cmd;
+      std::string Path = testPath(("root/" + Name).str());
+      Cmd.Filename = Path;
+      Cmd.Directory = testPath("root");
+      Cmd.CommandLine = {"clang++", Path};
+      CDB.setCompileCommand(Path, Cmd);
+    }
+    ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  }
+  ASSERT_EQ(Storage.size(), 5U);
+
+  // The shards of a level are loaded concurrently, the result must not depend
+  // on the parallelism.
+  for (unsigned Parallelism : {1U, 4U}) {
+    CacheHits = 0;
+    std::vector<LoadedShard> Shards = loadIndexShards(
+        {testPath("root/A.cc"), testPath("root/B.cc")}, MSSFactory, CDB,
+        Parallelism);
+    EXPECT_EQ(CacheHits, 5U);
+    std::map<std::string, std::string> DependentTUs;
+    for (const LoadedShard &LS : Shards) {
+      EXPECT_NE(LS.Shard, nullptr) << LS.AbsolutePath;
+      EXPECT_NE(LS.Digest, FileDigest{{0}}) << LS.AbsolutePath;
+      DependentTUs[LS.AbsolutePath] = LS.DependentTU;
+    }
+    // Common.h is reached from A.cc first, Deep.h only through B.cc.
+    EXPECT_THAT(DependentTUs,
+                UnorderedElementsAre(
+                    Pair(testPath("root/A.cc"), testPath("root/A.cc")),
+                    Pair(testPath("root/B.cc"), testPath("root/B.cc")),
+                    Pair(testPath("root/Common.h"), testPath("root/A.cc")),
+                    Pair(testPath("root/B.h"), testPath("root/B.cc")),
+                    Pair(testPath("root/Deep.h"), testPath("root/B.cc"))));
+  }
+}
+
 TEST_F(BackgroundIndexTest, NoDotsInAbsPath) {
   MockFS FS;
   llvm::StringMap<std::string> Storage;
@@ -678,7 +678,7 @@ TEST_F(TUSchedulerTests, EmptyPreamble) {
       [&](Expected<InputsAndPreamble> Preamble) {
         // We expect to get a non-empty preamble.
         EXPECT_GT(
-            cantFail(std::move(Preamble)).Preamble->Preamble.getBounds().Size,
+            cantFail(std::move(Preamble)).Preamble->Preamble->getBounds().Size,
             0u);
       });
   // Wait while the preamble is being built.
@@ -693,11 +693,67 @@ TEST_F(TUSchedulerTests, EmptyPreamble) {
       [&](Expected<InputsAndPreamble> Preamble) {
         // We expect to get an empty preamble.
         EXPECT_EQ(
-            cantFail(std::move(Preamble)).Preamble->Preamble.getBounds().Size,
+            cantFail(std::move(Preamble)).Preamble->Preamble->getBounds().Size,
             0u);
       });
 }
 
+TEST_F(TUSchedulerTests, SharedPreamble) {
+  auto Opts = optsForTest();
+  Opts.SharePreambles = true;
+  TUScheduler S(CDB, Opts);
+
+  auto Header = testPath("foo.h");
+  FS.Files[Header] = "void foo();";
+  FS.Timestamps[Header] = time_t(0);
+  auto Foo = testPath("foo.cpp");
+  auto Bar = testPath("bar.cpp");
+  auto Baz = testPath("baz.cpp");
+  auto Code = R"cpp(
+    #include "foo.h"
+    int main() { foo(); }
+  )cpp";
+  auto OtherCode = R"cpp(
+    #include "foo.h"
+    #include "foo.h"
+    int main() { foo(); }
+  )cpp";
+
+  auto GetPCH = [&](PathRef File) {
+    const PrecompiledPreamble *PCH = nullptr;
+    S.runWithPreamble("getPCH", File, TUScheduler::Stale,
+                      [&](Expected<InputsAndPreamble> Preamble) {
+                        PCH = cantFail(std::move(Preamble))
+                                  .Preamble->Preamble.get();
+                      });
+    EXPECT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+    return PCH;
+  };
+
+  S.update(Foo, getInputs(Foo, Code), WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  S.update(Bar, getInputs(Bar, Code), WantDiagnostics::Yes);
+  S.update(Baz, getInputs(Baz, OtherCode), WantDiagnostics::Yes);
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+
+  const PrecompiledPreamble *FooPCH = GetPCH(Foo);
+  ASSERT_TRUE(FooPCH);
+  // Bar has the same preamble as Foo, Baz includes more.
+  EXPECT_EQ(FooPCH, GetPCH(Bar));
+  EXPECT_NE(FooPCH, GetPCH(Baz));
+
+  // The shared preamble still reports includes of the right main file.
+  S.runWithPreamble("getIncludes", Bar, TUScheduler::Stale,
+                    [&](Expected<InputsAndPreamble> Preamble) {
+                      auto &Includes =
+                          cantFail(std::move(Preamble)).Preamble->Includes;
+                      EXPECT_EQ(Includes.MainFileIncludes.size(), 1u);
+                      EXPECT_EQ(Includes.includeDepth(Bar).lookup(Header),
+                                1u);
+                    });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+}
+
 TEST_F(TUSchedulerTests, ASTSignalsSmokeTests) {
   TUScheduler S(CDB, optsForTest());
   auto Foo = testPath("foo.cpp");
@@ -0,0 +1,108 @@
+#include "ClangTidyCache.h"
+#include "ClangTidyOptions.h"
+#include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "gtest/gtest.h"
+
+namespace clang {
+namespace tidy {
+namespace test {
+
+namespace {
+class CacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("clang-tidy-cache",
+                                                      CacheDirectory));
+  }
+
+  void TearDown() override {
+    llvm::sys::fs::remove_directories(CacheDirectory);
+  }
+
+  std::string getKey(StringRef Code, StringRef Checks = "-*,misc-*") {
+    ClangTidyOptions Options;
+    Options.Checks = std::string(Checks);
+    ClangTidyContext Context(std::make_unique<DefaultOptionsProvider>(
+        ClangTidyGlobalOptions(), Options));
+
+    auto InMemoryFS =
+        llvm::makeIntrusiveRefCnt<llvm::vfs::InMemoryFileSystem>();
+    InMemoryFS->addFile("/src/input.cc", 0,
+                        llvm::MemoryBuffer::getMemBufferCopy(Code));
+    auto BaseFS = llvm::makeIntrusiveRefCnt<llvm::vfs::OverlayFileSystem>(
+        llvm::vfs::getRealFileSystem());
+    BaseFS->pushOverlay(InMemoryFS);
+
+    tooling::FixedCompilationDatabase Compilations("/src", {"-std=c++11"});
+    tooling::ClangTool Tool(Compilations, {"/src/input.cc"},
+                            std::make_shared<PCHContainerOperations>(), BaseFS);
+    ClangTidyCache Cache(CacheDirectory);
+    return Cache.getKey(Context, Compilations, Tool, "/src/input.cc");
+  }
+
+  llvm::SmallString<128> CacheDirectory;
+};
+} // namespace
+
+TEST_F(CacheTest, StoresAndRestoresErrors) {
+  ClangTidyError Error("misc-check", ClangTidyError::Warning, "/build",
+                       /*IsWarningAsError=*/true);
+  Error.Message.Message = "message";
+  Error.Message.FilePath = "/src/a.cc";
+  Error.Message.FileOffset = 10;
+  tooling::DiagnosticMessage Note;
+  Note.Message = "note";
+  Note.FilePath = "/src/a.h";
+  Note.FileOffset = 20;
+  Error.Notes.push_back(Note);
+  Error.EnabledDiagnosticAliases.push_back("alias-check");
+  ClangTidyStats Stats;
+  Stats.ErrorsDisplayed = 1;
+  Stats.ErrorsIgnoredNOLINT = 2;
+
+  ClangTidyCache Cache(CacheDirectory);
+  Cache.store("0123456789", Error, Stats);
+
+  std::vector<ClangTidyError> Errors;
+  ClangTidyStats RestoredStats;
+  EXPECT_FALSE(Cache.lookup("9876543210", Errors, RestoredStats));
+  ASSERT_TRUE(Cache.lookup("0123456789", Errors, RestoredStats));
+  ASSERT_EQ(1u, Errors.size());
+  EXPECT_EQ("misc-check", Errors[0].DiagnosticName);
+  EXPECT_EQ(ClangTidyError::Warning, Errors[0].DiagLevel);
+  EXPECT_EQ("/build", Errors[0].BuildDirectory);
+  EXPECT_TRUE(Errors[0].IsWarningAsError);
+  EXPECT_EQ("message", Errors[0].Message.Message);
+  EXPECT_EQ("/src/a.cc", Errors[0].Message.FilePath);
+  EXPECT_EQ(10u, Errors[0].Message.FileOffset);
+  ASSERT_EQ(1u, Errors[0].Notes.size());
+  EXPECT_EQ("note", Errors[0].Notes[0].Message);
+  EXPECT_EQ(20u, Errors[0].Notes[0].FileOffset);
+  ASSERT_EQ(1u, Errors[0].EnabledDiagnosticAliases.size());
+  EXPECT_EQ("alias-check", Errors[0].EnabledDiagnosticAliases[0]);
+  EXPECT_EQ(1u, RestoredStats.ErrorsDisplayed);
+  EXPECT_EQ(2u, RestoredStats.ErrorsIgnoredNOLINT);
+  EXPECT_EQ(0u, RestoredStats.ErrorsIgnoredLineFilter);
+}
+
+TEST_F(CacheTest, KeyDependsOnTokensAndConfiguration) {
+  std::string Key = getKey("#define N 1\nint a = N;\n");
+  ASSERT_FALSE(Key.empty());
+  EXPECT_EQ(Key, getKey("#define N 1\nint a = N;\n"));
+  // Code that the preprocessor skips does not matter.
+  EXPECT_EQ(Key, getKey("#define N 1\nint a = N;\n#if 0\nint b;\n#endif\n"));
+  EXPECT_NE(Key, getKey("#define N 2\nint a = N;\n"));
+  EXPECT_NE(Key, getKey("#define N 1\nint  a = N;\n"));
+  EXPECT_NE(Key, getKey("#define N 1\nint a = N; // NOLINT\n"));
+  EXPECT_NE(Key, getKey("#define N 1\nint a = N;\n#define M\n"));
+  EXPECT_NE(Key, getKey("#define N 1\nint a = N;\n", "-*,google-*"));
+  // Files that cannot be preprocessed are not cached.
+  EXPECT_EQ("", getKey("#include \"missing.h\"\n"));
+}
+
+} // namespace test
+} // namespace tidy
+} // namespace clang
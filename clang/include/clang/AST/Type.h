@@ -818,6 +818,12 @@ public:
   /// Return true if this is a trivially copyable type (C++0x [basic.types]p9)
   bool isTriviallyCopyableType(const ASTContext &Context) const;
 
+  /// Return true if an object of this type can be moved to a new location and
+  /// the old one be forgotten by copying its bytes, which is the case for
+  /// trivially copyable types and for classes that can be passed in registers,
+  /// like those with the trivial_abi attribute.
+  bool isTriviallyRelocatableType(const ASTContext &Context) const;
+
 
   /// Returns true if it is a class and it might be dynamic.
   bool mayBeDynamicClass() const;
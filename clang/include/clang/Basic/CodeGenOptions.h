@@ -223,6 +223,11 @@ public:
   /// Output filename for the split debug info, not used in the skeleton CU.
   std::string SplitDwarfOutput;
 
+  /// Output filenames for the objects of all but the first module partition
+  /// when generating code in parallel, see -fsplit-codegen. The first
+  /// partition is written to the main output file.
+  std::vector<std::string> SplitCodeGenOutputs;
+
   /// The name of the relocation model to use.
   llvm::Reloc::Model RelocationModel;
 
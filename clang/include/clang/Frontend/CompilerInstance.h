@@ -787,6 +787,10 @@ private:
                                                  SourceLocation ModuleNameLoc,
                                                  bool IsInclusionDirective);
 
+  /// Build the missing modules that the main file imports on
+  /// -fmodules-build-threads threads, before it is parsed.
+  void buildImportedModules();
+
 public:
   ModuleLoadResult loadModule(SourceLocation ImportLoc, ModuleIdPath Path,
                               Module::NameVisibilityKind Visibility,
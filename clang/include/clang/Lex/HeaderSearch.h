@@ -237,6 +237,12 @@ class HeaderSearch {
   /// Describes whether a given directory has a module map in it.
   llvm::DenseMap<const DirectoryEntry *, bool> DirectoryHasModuleMap;
 
+  /// The lowercased names of the entries of normal search directories, or
+  /// null if the listing of a directory couldn't be read. Only used with a
+  /// header search cache path.
+  llvm::DenseMap<const DirectoryEntry *, std::unique_ptr<llvm::StringSet<>>>
+      DirectoryListings;
+
   /// Set of module map files we've already loaded, and a flag indicating
   /// whether they were valid or not.
   llvm::DenseMap<const FileEntry *, bool> LoadedModuleMaps;
@@ -686,6 +692,16 @@ private:
       const FileEntry *File, StringRef FrameworkName, Module *RequestingModule,
       ModuleMap::KnownHeader *SuggestedModule, bool IsSystemFramework);
 
+  /// Determine whether the search directory \p Dir may contain the file
+  /// \p Filename, according to the listing of \p Dir. This doesn't imply
+  /// that the file exists.
+  bool mayContainFile(const DirectoryEntry *Dir, StringRef Filename);
+
+  /// Read the listing of \p Dir from the header search cache, or from the
+  /// file system if the cached one is missing or stale.
+  std::unique_ptr<llvm::StringSet<>>
+  loadDirectoryListing(const DirectoryEntry *Dir);
+
   /// Look up the file with the specified name and determine its owning
   /// module.
   Optional<FileEntryRef>
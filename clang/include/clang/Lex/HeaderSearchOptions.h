@@ -114,6 +114,12 @@ public:
   /// The directory used for a user build.
   std::string ModuleUserBuildPath;
 
+  /// If non-empty, the directory in which the listings of header search
+  /// directories are cached across compilations. Header lookups in a search
+  /// directory which doesn't contain the first component of the header name
+  /// then don't touch the file system.
+  std::string HeaderSearchCachePath;
+
   /// The mapping of module names to prebuilt module files.
   std::map<std::string, std::string, std::less<>> PrebuiltModuleFiles;
 
@@ -164,6 +170,10 @@ public:
   /// regenerated often.
   unsigned ModuleCachePruneAfter = 31 * 24 * 60 * 60;
 
+  /// The number of threads building the modules imported by the main file
+  /// before it is parsed, or 0 to build each module when it is imported.
+  unsigned ModulesBuildThreads = 0;
+
   /// The time in seconds when the build session started.
   ///
   /// This time is used by other optimizations in header search and module
@@ -12,8 +12,12 @@
 #include "llvm/ADT/IntrusiveRefCntPtr.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace clang {
 
@@ -27,7 +31,13 @@ namespace clang {
 /// Critically, it ensures that a single process has a consistent view of each
 /// PCM.  This is used by \a CompilerInstance when building PCMs to ensure that
 /// each \a ModuleManager sees the same files.
-class InMemoryModuleCache : public llvm::RefCountedBase<InMemoryModuleCache> {
+///
+/// The cache can be shared by CompilerInstances building modules on several
+/// threads.  Buffers that are dropped or replaced stay alive until the cache
+/// is destroyed, since a ModuleManager on another thread may still be reading
+/// them.
+class InMemoryModuleCache
+    : public llvm::ThreadSafeRefCountedBase<InMemoryModuleCache> {
   struct PCM {
     std::unique_ptr<llvm::MemoryBuffer> Buffer;
 
@@ -44,6 +54,18 @@ class InMemoryModuleCache : public llvm::RefCountedBase<InMemoryModuleCache> {
   /// Cache of buffers.
   llvm::StringMap<PCM> PCMs;
 
+  /// Buffers that were dropped from the cache.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> DroppedBuffers;
+
+  /// The PCMs being built by a thread of this process.
+  llvm::StringSet<> Building;
+
+  /// For each PCM being built, the PCM whose build it is waiting for.
+  llvm::StringMap<std::string> BlockedOn;
+
+  mutable std::mutex Mutex;
+  std::condition_variable BuildDone;
+
 public:
   /// There are four states for a PCM.  It must monotonically increase.
   ///
@@ -63,7 +85,8 @@ public:
   ///
   /// \pre state is Unknown
   /// \post state is Tentative
-  /// \return a reference to the buffer as a convenience.
+  /// \return a reference to the buffer as a convenience.  If another thread
+  /// stored the PCM first, that buffer is returned instead.
   llvm::MemoryBuffer &addPCM(llvm::StringRef Filename,
                              std::unique_ptr<llvm::MemoryBuffer> Buffer);
 
@@ -100,6 +123,28 @@ public:
   ///
   /// \return true iff state is ToBuild.
   bool shouldBuildPCM(llvm::StringRef Filename) const;
+
+  enum BuildClaim {
+    /// The caller is responsible for building the PCM.
+    BuildClaimed,
+    /// Another thread built the PCM while the caller waited.
+    BuildWaited,
+    /// The PCM is built by a thread that waits for the caller, which has to
+    /// build it itself to diagnose the cycle.
+    BuildCycle
+  };
+
+  /// Claim the build of the PCM \p Filename for the build of the PCM
+  /// \p Importer, which is empty if the importer is not a module, or wait for
+  /// the thread that claimed it first to call releaseBuild.
+  BuildClaim claimBuild(llvm::StringRef Filename, llvm::StringRef Importer);
+
+  /// Release a build claimed with claimBuild, and wake up the threads
+  /// waiting for it.
+  void releaseBuild(llvm::StringRef Filename, llvm::StringRef Importer);
+
+private:
+  State getPCMStateLocked(llvm::StringRef Filename) const;
 };
 
 } // end namespace clang
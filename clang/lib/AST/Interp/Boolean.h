@@ -100,6 +100,8 @@ class Boolean {
     return Boolean(!Value.isZero());
   }
 
+  static Boolean from(Boolean Value) { return Value; }
+
   static Boolean zero() { return from(false); }
 
   template <typename T>
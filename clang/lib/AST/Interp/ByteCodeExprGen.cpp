@@ -118,6 +118,26 @@ bool ByteCodeExprGen<Emitter>::VisitCastExpr(const CastExpr *CE) {
   case CK_ToVoid:
     return discard(SubExpr);
 
+  case CK_IntegralCast:
+  case CK_IntegralToBoolean:
+  case CK_BooleanToSignedIntegral: {
+    Optional<PrimType> FromT = classify(SubExpr->getType());
+    Optional<PrimType> ToT = classify(CE->getType());
+    if (!FromT || !ToT || *FromT == PT_Ptr || *ToT == PT_Ptr)
+      return this->bail(CE);
+
+    if (DiscardResult)
+      return discard(SubExpr);
+    if (!visit(SubExpr))
+      return false;
+    if (!emitCastIfNeeded(*FromT, *ToT, CE))
+      return false;
+    // A signed integer of value -1 is produced for true.
+    if (CE->getCastKind() == CK_BooleanToSignedIntegral)
+      return this->emitNeg(*ToT, CE);
+    return true;
+  }
+
   default: {
     // TODO: implement other casts.
     return this->bail(CE);
@@ -155,7 +175,14 @@ bool ByteCodeExprGen<Emitter>::VisitBinaryOperator(const BinaryOperator *BO) {
     if (!this->Visit(RHS))
       return false;
     return true;
+  case BO_LAnd:
+  case BO_LOr:
+    return visitLogicalOperator(BO);
+  case BO_Assign:
+    return visitAssignment(BO);
   default:
+    if (auto *CAO = dyn_cast<CompoundAssignOperator>(BO))
+      return visitCompoundAssignment(CAO);
     break;
   }
 
@@ -191,20 +218,354 @@ bool ByteCodeExprGen<Emitter>::VisitBinaryOperator(const BinaryOperator *BO) {
       return Discard(this->emitGT(*LT, BO));
     case BO_GE:
       return Discard(this->emitGE(*LT, BO));
-    case BO_Sub:
-      return Discard(this->emitSub(*T, BO));
-    case BO_Add:
-      return Discard(this->emitAdd(*T, BO));
-    case BO_Mul:
-      return Discard(this->emitMul(*T, BO));
     default:
-      return this->bail(BO);
+      return Discard(emitArithmetic(BO->getOpcode(), *T, *RT, BO));
     }
   }
 
   return this->bail(BO);
 }
 
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::emitArithmetic(BinaryOperatorKind Op,
+                                              PrimType T, PrimType RT,
+                                              const Expr *E) {
+  // Operands are promoted, pointer arithmetic is not supported yet.
+  if (T == PT_Bool || T == PT_Ptr || RT == PT_Bool || RT == PT_Ptr)
+    return this->bail(E);
+
+  switch (Op) {
+  case BO_Add:
+  case BO_AddAssign:
+    return this->emitAdd(T, E);
+  case BO_Sub:
+  case BO_SubAssign:
+    return this->emitSub(T, E);
+  case BO_Mul:
+  case BO_MulAssign:
+    return this->emitMul(T, E);
+  case BO_Div:
+  case BO_DivAssign:
+    return this->emitDiv(T, E);
+  case BO_Rem:
+  case BO_RemAssign:
+    return this->emitRem(T, E);
+  case BO_And:
+  case BO_AndAssign:
+    return this->emitBitAnd(T, E);
+  case BO_Or:
+  case BO_OrAssign:
+    return this->emitBitOr(T, E);
+  case BO_Xor:
+  case BO_XorAssign:
+    return this->emitBitXor(T, E);
+  case BO_Shl:
+  case BO_ShlAssign:
+    return this->emitShl(T, RT, E);
+  case BO_Shr:
+  case BO_ShrAssign:
+    return this->emitShr(T, RT, E);
+  default:
+    return this->bail(E);
+  }
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::visitLogicalOperator(const BinaryOperator *BO) {
+  Optional<PrimType> T = classify(BO->getType());
+  if (!T)
+    return this->bail(BO);
+
+  // The RHS is only evaluated if the LHS does not decide the result.
+  const bool IsAnd = BO->getOpcode() == BO_LAnd;
+  LabelTy LabelShort = this->getLabel();
+  LabelTy LabelEnd = this->getLabel();
+  if (!visitBool(BO->getLHS()))
+    return false;
+  if (!(IsAnd ? this->jumpFalse(LabelShort) : this->jumpTrue(LabelShort)))
+    return false;
+  if (!visitBool(BO->getRHS()))
+    return false;
+  if (!this->jump(LabelEnd))
+    return false;
+  this->emitLabel(LabelShort);
+  if (!this->emitConstBool(!IsAnd, BO))
+    return false;
+  this->fallthrough(LabelEnd);
+
+  // In C, the result is an int.
+  if (!emitCastIfNeeded(PT_Bool, *T, BO))
+    return false;
+  return DiscardResult ? this->emitPop(*T, BO) : true;
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::visitAssignment(const BinaryOperator *BO) {
+  const Expr *LHS = BO->getLHS();
+  const Expr *RHS = BO->getRHS();
+  Optional<PrimType> T = classify(LHS->getType());
+  if (!T)
+    return this->bail(BO);
+
+  const bool IsBitField = LHS->refersToBitField();
+  bool Result = dereference(
+      LHS, DerefKind::Write,
+      [this, RHS](PrimType) {
+        // Value to store.
+        return visit(RHS);
+      },
+      [this, RHS, BO, IsBitField](PrimType T) {
+        // Pointer on stack - store the value through it.
+        if (!visit(RHS))
+          return false;
+        if (IsBitField)
+          return DiscardResult ? this->emitStoreBitFieldPop(T, BO)
+                               : this->emitStoreBitField(T, BO);
+        return DiscardResult ? this->emitStorePop(T, BO)
+                             : this->emitStore(T, BO);
+      });
+  if (!Result)
+    return false;
+
+  // In C, the result of an assignment is not an lvalue.
+  if (!DiscardResult && !BO->isGLValue())
+    return this->emitLoadPop(*T, BO);
+  return true;
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::visitCompoundAssignment(
+    const CompoundAssignOperator *CAO) {
+  const Expr *LHS = CAO->getLHS();
+  const Expr *RHS = CAO->getRHS();
+  Optional<PrimType> LT = classify(LHS->getType());
+  Optional<PrimType> RT = classify(RHS->getType());
+  Optional<PrimType> CT = classify(CAO->getComputationLHSType());
+  Optional<PrimType> ResT = classify(CAO->getComputationResultType());
+  if (!LT || !RT || !CT || !ResT || LHS->refersToBitField())
+    return this->bail(CAO);
+
+  // Computes the new value from the old one, which is on top of the stack.
+  auto Compute = [this, CAO, RHS, LT, RT, CT, ResT]() {
+    if (!emitCastIfNeeded(*LT, *CT, CAO))
+      return false;
+    if (!visit(RHS))
+      return false;
+    if (!emitArithmetic(CAO->getOpcode(), *CT, *RT, CAO))
+      return false;
+    return emitCastIfNeeded(*ResT, *LT, CAO);
+  };
+
+  bool Result = dereference(
+      LHS, DerefKind::ReadWrite,
+      [&Compute](PrimType) { return Compute(); },
+      [this, CAO, &Compute](PrimType T) {
+        // Pointer on stack - load, compute and store through it.
+        if (!this->emitLoad(T, CAO))
+          return false;
+        if (!Compute())
+          return false;
+        return DiscardResult ? this->emitStorePop(T, CAO)
+                             : this->emitStore(T, CAO);
+      });
+  if (!Result)
+    return false;
+
+  if (!DiscardResult && !CAO->isGLValue())
+    return this->emitLoadPop(*LT, CAO);
+  return true;
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitUnaryOperator(const UnaryOperator *UO) {
+  const Expr *SubExpr = UO->getSubExpr();
+
+  switch (UO->getOpcode()) {
+  case UO_PreInc:
+  case UO_PreDec:
+  case UO_PostInc:
+  case UO_PostDec:
+    return visitIncDec(UO);
+  case UO_Plus:
+  case UO_AddrOf:
+  case UO_Deref:
+  case UO_Extension:
+    // Pointers and lvalues share a representation.
+    return this->Visit(SubExpr);
+  default:
+    break;
+  }
+
+  Optional<PrimType> T = classify(UO->getType());
+  if (!T)
+    return this->bail(UO);
+  if (DiscardResult)
+    return discard(SubExpr);
+
+  switch (UO->getOpcode()) {
+  case UO_Minus:
+    if (*T == PT_Bool || *T == PT_Ptr)
+      return this->bail(UO);
+    return visit(SubExpr) && this->emitNeg(*T, UO);
+  case UO_Not:
+    if (*T == PT_Bool || *T == PT_Ptr)
+      return this->bail(UO);
+    return visit(SubExpr) && this->emitComp(*T, UO);
+  case UO_LNot:
+    if (!visitBool(SubExpr))
+      return false;
+    if (!this->emitInv(UO))
+      return false;
+    // In C, the result is an int.
+    return emitCastIfNeeded(PT_Bool, *T, UO);
+  default:
+    return this->bail(UO);
+  }
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::visitIncDec(const UnaryOperator *UO) {
+  Optional<PrimType> T = classify(UO->getSubExpr()->getType());
+  if (!T || *T == PT_Bool || *T == PT_Ptr ||
+      UO->getSubExpr()->refersToBitField())
+    return this->bail(UO);
+
+  const bool IsInc = UO->isIncrementOp();
+  if (!visit(UO->getSubExpr()))
+    return false;
+
+  if (DiscardResult)
+    return IsInc ? this->emitIncPop(*T, UO) : this->emitDecPop(*T, UO);
+
+  // Postfix operators produce the old value.
+  if (UO->isPostfix())
+    return IsInc ? this->emitInc(*T, UO) : this->emitDec(*T, UO);
+
+  // Prefix operators produce the lvalue, or its new value in C.
+  if (!this->emitDup(PT_Ptr, UO))
+    return false;
+  if (!(IsInc ? this->emitIncPop(*T, UO) : this->emitDecPop(*T, UO)))
+    return false;
+  return UO->isGLValue() ? true : this->emitLoadPop(*T, UO);
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitConditionalOperator(
+    const ConditionalOperator *CO) {
+  if (!classify(CO))
+    return this->bail(CO);
+
+  LabelTy LabelFalse = this->getLabel();
+  LabelTy LabelEnd = this->getLabel();
+  if (!visitBool(CO->getCond()))
+    return false;
+  if (!this->jumpFalse(LabelFalse))
+    return false;
+  if (!this->Visit(CO->getTrueExpr()))
+    return false;
+  if (!this->jump(LabelEnd))
+    return false;
+  this->emitLabel(LabelFalse);
+  if (!this->Visit(CO->getFalseExpr()))
+    return false;
+  this->fallthrough(LabelEnd);
+  return true;
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitCXXBoolLiteralExpr(
+    const CXXBoolLiteralExpr *E) {
+  if (DiscardResult)
+    return true;
+  return this->emitConstBool(E->getValue(), E);
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitCXXDefaultArgExpr(
+    const CXXDefaultArgExpr *E) {
+  return this->Visit(E->getExpr());
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitDeclRefExpr(const DeclRefExpr *DE) {
+  const ValueDecl *D = DE->getDecl();
+
+  // Enumerators are the only declarations referred to by value.
+  if (auto *ECD = dyn_cast<EnumConstantDecl>(D)) {
+    if (DiscardResult)
+      return true;
+    QualType Ty = DE->getType();
+    if (Optional<PrimType> T = classify(Ty))
+      return emitConst(*T, getIntWidth(Ty), ECD->getInitVal(), DE);
+    return this->bail(DE);
+  }
+
+  // References would require the referenced pointer to be loaded.
+  if (D->getType()->isReferenceType())
+    return this->bail(DE);
+
+  if (DiscardResult)
+    return true;
+
+  if (auto *PD = dyn_cast<ParmVarDecl>(D)) {
+    auto It = this->Params.find(PD);
+    if (It != this->Params.end())
+      return this->emitGetPtrParam(It->second, DE);
+  }
+
+  if (auto *VD = dyn_cast<VarDecl>(D)) {
+    auto It = Locals.find(VD);
+    if (It != Locals.end())
+      return this->emitGetPtrLocal(It->second.Offset, DE);
+    if (Optional<unsigned> Idx = getGlobalIdx(VD))
+      return this->emitGetPtrGlobal(*Idx, DE);
+  }
+
+  return this->bail(DE);
+}
+
+template <class Emitter>
+bool ByteCodeExprGen<Emitter>::VisitCallExpr(const CallExpr *E) {
+  // Only direct calls to free functions returning primitives are supported.
+  const FunctionDecl *FD = E->getDirectCallee();
+  if (!FD || isa<CXXMethodDecl>(FD) || FD->getBuiltinID() ||
+      FD->isVariadic())
+    return this->bail(E);
+
+  QualType RetTy = E->getType();
+  Optional<PrimType> T = classify(RetTy);
+  if (!T && !RetTy->isVoidType())
+    return this->bail(E);
+  if (E->isGLValue())
+    return this->bail(E);
+
+  for (const Expr *Arg : E->arguments()) {
+    if (!classify(Arg->getType()))
+      return this->bail(Arg);
+  }
+
+  Expected<Function *> Func = P.getOrCreateFunction(FD);
+  if (!Func) {
+    // Report the location the callee failed to compile at.
+    SourceLocation Loc = E->getExprLoc();
+    handleAllErrors(Func.takeError(),
+                    [&Loc](ByteCodeGenError &Err) { Loc = Err.getLoc(); });
+    return this->bail(Loc);
+  }
+
+  // Arguments are pushed in order, the callee's frame is built on top.
+  for (const Expr *Arg : E->arguments()) {
+    if (!visit(Arg))
+      return false;
+  }
+
+  if (!*Func)
+    return this->emitNoCall(FD, E);
+  if (!this->emitCall(*Func, E))
+    return false;
+  return DiscardResult && T ? this->emitPop(*T, E) : true;
+}
+
 template <class Emitter>
 bool ByteCodeExprGen<Emitter>::discard(const Expr *E) {
   OptionScope<Emitter> Scope(this, /*discardResult=*/true);
@@ -220,7 +581,14 @@ bool ByteCodeExprGen<Emitter>::visit(const Expr *E) {
 template <class Emitter>
 bool ByteCodeExprGen<Emitter>::visitBool(const Expr *E) {
   if (Optional<PrimType> T = classify(E->getType())) {
-    return visit(E);
+    if (!visit(E))
+      return false;
+    // Conditions in C are not converted to bool, compare them against zero.
+    if (*T == PT_Bool)
+      return true;
+    if (!visitZeroInitializer(*T, E))
+      return false;
+    return this->emitNE(*T, E);
   } else {
     return this->bail(E);
   }
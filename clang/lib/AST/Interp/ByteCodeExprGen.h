@@ -71,6 +71,12 @@ public:
   bool VisitIntegerLiteral(const IntegerLiteral *E);
   bool VisitParenExpr(const ParenExpr *E);
   bool VisitBinaryOperator(const BinaryOperator *E);
+  bool VisitUnaryOperator(const UnaryOperator *E);
+  bool VisitConditionalOperator(const ConditionalOperator *E);
+  bool VisitCXXBoolLiteralExpr(const CXXBoolLiteralExpr *E);
+  bool VisitCXXDefaultArgExpr(const CXXDefaultArgExpr *E);
+  bool VisitDeclRefExpr(const DeclRefExpr *E);
+  bool VisitCallExpr(const CallExpr *E);
 
 protected:
   bool visitExpr(const Expr *E) override;
@@ -167,6 +173,25 @@ private:
   /// Emits a zero initializer.
   bool visitZeroInitializer(PrimType T, const Expr *E);
 
+  /// Emits the arithmetic opcode of a binary or compound assignment operator.
+  /// The shift amount has type RT, all other operands have type T.
+  bool emitArithmetic(BinaryOperatorKind Op, PrimType T, PrimType RT,
+                      const Expr *E);
+
+  /// Compiles a short-circuiting logical operator.
+  bool visitLogicalOperator(const BinaryOperator *BO);
+  /// Compiles an assignment to a primitive lvalue.
+  bool visitAssignment(const BinaryOperator *BO);
+  /// Compiles a compound assignment to a primitive lvalue.
+  bool visitCompoundAssignment(const CompoundAssignOperator *CAO);
+  /// Compiles an increment or a decrement of a primitive lvalue.
+  bool visitIncDec(const UnaryOperator *UO);
+
+  /// Emits a conversion between two primitive types, if required.
+  bool emitCastIfNeeded(PrimType From, PrimType To, const Expr *E) {
+    return From == To ? true : this->emitCast(From, To, E);
+  }
+
   enum class DerefKind {
     /// Value is read and pushed to stack.
     Read,
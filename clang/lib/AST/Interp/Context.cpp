@@ -120,8 +120,13 @@ bool Context::Run(State &Parent, Function *Func, APValue &Result) {
 }
 
 bool Context::Check(State &Parent, llvm::Expected<bool> &&Flag) {
-  if (Flag)
+  if (Flag) {
+    // A failed evaluation, possibly within a call, can leave values behind.
+    if (!*Flag)
+      Stk.clear();
     return *Flag;
+  }
+  Stk.clear();
   handleAllErrors(Flag.takeError(), [&Parent](ByteCodeGenError &Err) {
     Parent.FFDiag(Err.getLoc(), diag::err_experimental_clang_interp_failed);
   });
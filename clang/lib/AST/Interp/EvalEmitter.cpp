@@ -95,6 +95,31 @@ bool EvalEmitter::fallthrough(const LabelTy &Label) {
   return true;
 }
 
+bool EvalEmitter::emitCall(Function *Func, const SourceInfo &Info) {
+  if (!isActive())
+    return true;
+  CurrentSource = Info;
+  return ExecuteCall(Func, Pointer(), Info);
+}
+
+bool EvalEmitter::ExecuteCall(Function *F, Pointer &&This,
+                              const SourceInfo &Info) {
+  if (S.checkingPotentialConstantExpression())
+    return false;
+  if (!CheckCallable(S, OpPC, F))
+    return false;
+  if (!CheckCallDepth(S, OpPC))
+    return false;
+  if (!S.step(F->getLoc()))
+    return false;
+
+  // The callee returns to the dummy frame, leaving its result on the stack.
+  S.Current = new InterpFrame(S, F, S.Current, OpPC, std::move(This));
+  S.CallStackDepth++;
+  APValue Unused;
+  return Interpret(S, Unused);
+}
+
 template <PrimType OpType> bool EvalEmitter::emitRet(const SourceInfo &Info) {
   if (!isActive())
     return true;
@@ -27,6 +27,8 @@ namespace interp {
 using APInt = llvm::APInt;
 using APSInt = llvm::APSInt;
 
+class Boolean;
+
 /// Helper to compare two comparable types.
 template <typename T>
 ComparisonCategoryResult Compare(const T &X, const T &Y) {
@@ -94,6 +96,9 @@ public:
   Integral operator-() const { return Integral(-V); }
   Integral operator~() const { return Integral(~V); }
 
+  Integral operator>>(unsigned RHS) const { return Integral(V >> RHS); }
+  Integral operator<<(unsigned RHS) const { return Integral(V << RHS); }
+
   template <unsigned DstBits, bool DstSign>
   explicit operator Integral<DstBits, DstSign>() const {
     return Integral<DstBits, DstSign>(V);
@@ -135,7 +140,10 @@ public:
     return Compare(V, RHS.V);
   }
 
-  unsigned countLeadingZeros() const { return llvm::countLeadingZeros<T>(V); }
+  unsigned countLeadingZeros() const {
+    using UT = typename std::make_unsigned<T>::type;
+    return llvm::countLeadingZeros<UT>(static_cast<UT>(V));
+  }
 
   Integral truncate(unsigned TruncBits) const {
     if (TruncBits >= Bits)
@@ -173,6 +181,12 @@ public:
       return Integral(Value.V.getZExtValue());
   }
 
+  template <typename T>
+  static std::enable_if_t<std::is_same<T, Boolean>::value, Integral>
+  from(T Value) {
+    return Integral(static_cast<unsigned>(Value));
+  }
+
   static Integral zero() { return from(0); }
 
   template <typename T> static Integral from(T Value, unsigned NumBits) {
@@ -203,6 +217,33 @@ public:
     return CheckMulUB(A.V, B.V, R->V);
   }
 
+  /// Division and remainder expect the callers to have rejected a zero divisor
+  /// and the overflowing MIN / -1 case.
+  static bool div(Integral A, Integral B, unsigned OpBits, Integral *R) {
+    *R = Integral(A.V / B.V);
+    return false;
+  }
+
+  static bool rem(Integral A, Integral B, unsigned OpBits, Integral *R) {
+    *R = Integral(A.V % B.V);
+    return false;
+  }
+
+  static bool bitAnd(Integral A, Integral B, unsigned OpBits, Integral *R) {
+    *R = Integral(A.V & B.V);
+    return false;
+  }
+
+  static bool bitOr(Integral A, Integral B, unsigned OpBits, Integral *R) {
+    *R = Integral(A.V | B.V);
+    return false;
+  }
+
+  static bool bitXor(Integral A, Integral B, unsigned OpBits, Integral *R) {
+    *R = Integral(A.V ^ B.V);
+    return false;
+  }
+
 private:
   template <typename T>
   static std::enable_if_t<std::is_signed<T>::value, bool> CheckAddUB(T A, T B,
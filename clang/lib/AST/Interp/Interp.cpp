@@ -75,26 +75,57 @@ static bool RetValue(InterpState &S, CodePtr &Pt, APValue &Result) {
   llvm::report_fatal_error("Interpreter cannot return values");
 }
 
+//===----------------------------------------------------------------------===//
+// Call
+//===----------------------------------------------------------------------===//
+
+static bool Call(InterpState &S, CodePtr &PC, Function *Func) {
+  // Arguments are not known while checking for potential constant
+  // expressions, so the callee cannot be evaluated.
+  if (S.checkingPotentialConstantExpression())
+    return false;
+
+  // The source of the call is attached to the address after the opcode.
+  const CodePtr OpPC = PC - sizeof(Function *);
+  if (!CheckCallable(S, OpPC, Func))
+    return false;
+  if (!CheckCallDepth(S, OpPC))
+    return false;
+  if (!S.step(Func->getLoc()))
+    return false;
+
+  // Arguments are already on the stack, the frame is built on top of them.
+  S.Current = new InterpFrame(S, Func, S.Current, PC, {});
+  S.CallStackDepth++;
+  PC = Func->getCodeBegin();
+  return true;
+}
+
 //===----------------------------------------------------------------------===//
 // Jmp, Jt, Jf
 //===----------------------------------------------------------------------===//
 
-static bool Jmp(InterpState &S, CodePtr &PC, int32_t Offset) {
+/// Backward jumps close loops and are accounted against the step limit.
+static bool Jump(InterpState &S, CodePtr &PC, int32_t Offset) {
+  if (Offset < 0 && !S.step(S.Current->getCallee()->getBeginLoc()))
+    return false;
   PC += Offset;
   return true;
 }
 
+static bool Jmp(InterpState &S, CodePtr &PC, int32_t Offset) {
+  return Jump(S, PC, Offset);
+}
+
 static bool Jt(InterpState &S, CodePtr &PC, int32_t Offset) {
-  if (S.Stk.pop<bool>()) {
-    PC += Offset;
-  }
+  if (S.Stk.pop<bool>())
+    return Jump(S, PC, Offset);
   return true;
 }
 
 static bool Jf(InterpState &S, CodePtr &PC, int32_t Offset) {
-  if (!S.Stk.pop<bool>()) {
-    PC += Offset;
-  }
+  if (!S.Stk.pop<bool>())
+    return Jump(S, PC, Offset);
   return true;
 }
 
@@ -372,6 +403,16 @@ bool CheckCallable(InterpState &S, CodePtr OpPC, Function *F) {
   return true;
 }
 
+bool CheckCallDepth(InterpState &S, CodePtr OpPC) {
+  const unsigned MaxDepth = S.getLangOpts().ConstexprCallDepth;
+  if (S.CallStackDepth <= MaxDepth)
+    return true;
+
+  S.FFDiag(S.Current->getSource(OpPC), diag::note_constexpr_depth_limit_exceeded)
+      << MaxDepth;
+  return false;
+}
+
 bool CheckThis(InterpState &S, CodePtr OpPC, const Pointer &This) {
   if (!This.isZero())
     return true;
@@ -85,6 +85,9 @@ bool CheckInit(InterpState &S, CodePtr OpPC, const Pointer &Ptr);
 /// Checks if a method can be called.
 bool CheckCallable(InterpState &S, CodePtr OpPC, Function *F);
 
+/// Checks if another call fits into the call stack.
+bool CheckCallDepth(InterpState &S, CodePtr OpPC);
+
 /// Checks the 'this' pointer.
 bool CheckThis(InterpState &S, CodePtr OpPC, const Pointer &This);
 
@@ -152,6 +155,152 @@ bool Mul(InterpState &S, CodePtr OpPC) {
   return AddSubMulHelper<T, T::mul, std::multiplies>(S, OpPC, Bits, LHS, RHS);
 }
 
+//===----------------------------------------------------------------------===//
+// Div, Rem
+//===----------------------------------------------------------------------===//
+
+template <typename T>
+bool DivRemHelper(InterpState &S, CodePtr OpPC, bool (*Op)(T, T, unsigned, T *)) {
+  const T &RHS = S.Stk.pop<T>();
+  const T &LHS = S.Stk.pop<T>();
+
+  if (RHS.isZero()) {
+    const SourceInfo &Loc = S.Current->getSource(OpPC);
+    S.FFDiag(Loc, diag::note_expr_divide_by_zero);
+    return false;
+  }
+
+  // MIN / -1 overflows, the result is reported with an extra bit.
+  if (LHS.isSigned() && LHS.isMin() && RHS.isMinusOne()) {
+    S.Stk.push<T>(LHS);
+    APSInt Value = -LHS.toAPSInt(LHS.bitWidth() + 1);
+    if (!S.reportOverflow(S.Current->getExpr(OpPC), Value))
+      return false;
+    return true;
+  }
+
+  T Result;
+  Op(LHS, RHS, LHS.bitWidth(), &Result);
+  S.Stk.push<T>(Result);
+  return true;
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Div(InterpState &S, CodePtr OpPC) {
+  return DivRemHelper<T>(S, OpPC, T::div);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Rem(InterpState &S, CodePtr OpPC) {
+  return DivRemHelper<T>(S, OpPC, T::rem);
+}
+
+//===----------------------------------------------------------------------===//
+// BitAnd, BitOr, BitXor
+//===----------------------------------------------------------------------===//
+
+template <typename T>
+bool BitwiseHelper(InterpState &S, bool (*Op)(T, T, unsigned, T *)) {
+  const T &RHS = S.Stk.pop<T>();
+  const T &LHS = S.Stk.pop<T>();
+  T Result;
+  Op(LHS, RHS, LHS.bitWidth(), &Result);
+  S.Stk.push<T>(Result);
+  return true;
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool BitAnd(InterpState &S, CodePtr OpPC) {
+  return BitwiseHelper<T>(S, T::bitAnd);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool BitOr(InterpState &S, CodePtr OpPC) {
+  return BitwiseHelper<T>(S, T::bitOr);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool BitXor(InterpState &S, CodePtr OpPC) {
+  return BitwiseHelper<T>(S, T::bitXor);
+}
+
+//===----------------------------------------------------------------------===//
+// Neg, Comp, Inv
+//===----------------------------------------------------------------------===//
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Neg(InterpState &S, CodePtr OpPC) {
+  const T &Value = S.Stk.pop<T>();
+  if (!Value.isSigned() || !Value.isMin()) {
+    S.Stk.push<T>(-Value);
+    return true;
+  }
+
+  // Negating MIN wraps around to MIN.
+  S.Stk.push<T>(Value);
+  APSInt Result = -Value.toAPSInt(Value.bitWidth() + 1);
+  return S.reportOverflow(S.Current->getExpr(OpPC), Result);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Comp(InterpState &S, CodePtr OpPC) {
+  S.Stk.push<T>(~S.Stk.pop<T>());
+  return true;
+}
+
+inline bool Inv(InterpState &S, CodePtr OpPC) {
+  using BoolT = PrimConv<PT_Bool>::T;
+  S.Stk.push<BoolT>(BoolT::from(S.Stk.pop<BoolT>().isZero()));
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Inc, Dec, IncPop, DecPop
+//===----------------------------------------------------------------------===//
+
+template <typename T, bool IsInc, bool PushOld>
+bool IncDecHelper(InterpState &S, CodePtr OpPC) {
+  const Pointer &Ptr = S.Stk.pop<Pointer>();
+  if (!CheckLoad(S, OpPC, Ptr) || !CheckStore(S, OpPC, Ptr))
+    return false;
+
+  const T Value = Ptr.deref<T>();
+  if (PushOld)
+    S.Stk.push<T>(Value);
+
+  T Result;
+  bool Overflow = IsInc ? T::increment(Value, &Result)
+                        : T::decrement(Value, &Result);
+  Ptr.deref<T>() = Result;
+  if (!Overflow)
+    return true;
+
+  APSInt One(APInt(Value.bitWidth() + 1, 1), !Value.isSigned());
+  APSInt Wide = Value.toAPSInt(Value.bitWidth() + 1);
+  return S.reportOverflow(S.Current->getExpr(OpPC),
+                          IsInc ? Wide + One : Wide - One);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Inc(InterpState &S, CodePtr OpPC) {
+  return IncDecHelper<T, true, true>(S, OpPC);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool Dec(InterpState &S, CodePtr OpPC) {
+  return IncDecHelper<T, false, true>(S, OpPC);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool IncPop(InterpState &S, CodePtr OpPC) {
+  return IncDecHelper<T, true, false>(S, OpPC);
+}
+
+template <PrimType Name, class T = typename PrimConv<Name>::T>
+bool DecPop(InterpState &S, CodePtr OpPC) {
+  return IncDecHelper<T, false, false>(S, OpPC);
+}
+
 //===----------------------------------------------------------------------===//
 // EQ, NE, GT, GE, LT, LE
 //===----------------------------------------------------------------------===//
@@ -932,6 +1081,26 @@ inline bool NoRet(InterpState &S, CodePtr OpPC) {
   return false;
 }
 
+//===----------------------------------------------------------------------===//
+// NoCall
+//===----------------------------------------------------------------------===//
+
+inline bool NoCall(InterpState &S, CodePtr OpPC, const FunctionDecl *FD) {
+  // The body might still be defined later in the translation unit.
+  if (S.checkingPotentialConstantExpression())
+    return false;
+
+  const SourceInfo &Loc = S.Current->getSource(OpPC);
+  if (S.getLangOpts().CPlusPlus11) {
+    S.FFDiag(Loc, diag::note_constexpr_invalid_function, 1)
+        << FD->isConstexpr() << isa<CXXConstructorDecl>(FD) << FD;
+    S.Note(FD->getLocation(), diag::note_declared_at);
+  } else {
+    S.FFDiag(Loc, diag::note_invalid_subexpr_in_const_expr);
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 // NarrowPtr, ExpandPtr
 //===----------------------------------------------------------------------===//
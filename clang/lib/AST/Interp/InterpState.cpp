@@ -24,7 +24,8 @@ using APSInt = llvm::APSInt;
 InterpState::InterpState(State &Parent, Program &P, InterpStack &Stk,
                          Context &Ctx, SourceMapper *M)
     : Parent(Parent), M(M), P(P), Stk(Stk), Ctx(Ctx), Current(nullptr),
-      CallStackDepth(Parent.getCallStackDepth() + 1) {}
+      CallStackDepth(Parent.getCallStackDepth() + 1),
+      StepsLeft(getLangOpts().ConstexprStepLimit) {}
 
 InterpState::~InterpState() {
   while (Current) {
@@ -54,6 +55,15 @@ bool InterpState::reportOverflow(const Expr *E, const llvm::APSInt &Value) {
   return noteUndefinedBehavior();
 }
 
+bool InterpState::step(SourceLocation Loc) {
+  if (StepsLeft == 0) {
+    FFDiag(Loc, diag::note_constexpr_step_limit_exceeded);
+    return false;
+  }
+  --StepsLeft;
+  return true;
+}
+
 void InterpState::deallocate(Block *B) {
   Descriptor *Desc = B->getDescriptor();
   if (B->hasPointers()) {
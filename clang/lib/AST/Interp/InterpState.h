@@ -80,6 +80,10 @@ public:
   /// Deallocates a pointer.
   void deallocate(Block *B);
 
+  /// Accounts for a loop iteration or a call, failing if the step limit
+  /// of the evaluation was exhausted.
+  bool step(SourceLocation Loc);
+
   /// Delegates source mapping to the mapper.
   SourceInfo getSource(Function *F, CodePtr PC) const override {
     return M ? M->getSource(F, PC) : F->getSource(PC);
@@ -104,6 +108,8 @@ public:
   InterpFrame *Current = nullptr;
   /// Call stack depth.
   unsigned CallStackDepth;
+  /// Number of loop iterations and calls left before evaluation is aborted.
+  unsigned StepsLeft;
 };
 
 } // namespace interp
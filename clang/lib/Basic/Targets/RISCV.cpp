@@ -210,6 +210,15 @@ void RISCVTargetInfo::getTargetDefines(const LangOptions &Opts,
   if (HasZvlsseg)
     Builder.defineMacro("__riscv_zvlsseg", "10000");
 
+  if (HasXssr)
+    Builder.defineMacro("__riscv_xssr", "1000000");
+
+  if (HasXfrep)
+    Builder.defineMacro("__riscv_xfrep", "1000000");
+
+  if (HasXdma)
+    Builder.defineMacro("__riscv_xdma", "1000000");
+
   // Add HERO specific defines
   // FIXME: define separation between host and accelerator better
   if(getTriple().getVendor() == llvm::Triple::HERO && !getTriple().isArch64Bit()) {
@@ -245,6 +254,10 @@ bool RISCVTargetInfo::hasFeature(StringRef Feature) const {
       .Case("experimental-zfh", HasZfh)
       .Case("experimental-zvamo", HasZvamo)
       .Case("experimental-zvlsseg", HasZvlsseg)
+      .Case("xfalthalf", HasXfalthalf)
+      .Case("xssr", HasXssr)
+      .Case("xfrep", HasXfrep)
+      .Case("xdma", HasXdma)
       .Default(false);
 }
 
@@ -296,8 +309,20 @@ bool RISCVTargetInfo::handleTargetFeatures(std::vector<std::string> &Features,
       HasZvamo = true;
     else if (Feature == "+experimental-zvlsseg")
       HasZvlsseg = true;
+    else if (Feature == "+xfalthalf")
+      HasXfalthalf = true;
+    else if (Feature == "+xssr")
+      HasXssr = true;
+    else if (Feature == "+xfrep")
+      HasXfrep = true;
+    else if (Feature == "+xdma")
+      HasXdma = true;
   }
 
+  // The alternate half format of Xfalthalf is bfloat16, held in the half
+  // registers of Zfh.
+  HasBFloat16 = HasXfalthalf && HasZfh;
+
   return true;
 }
 
@@ -50,6 +50,10 @@ protected:
   bool HasZfh = false;
   bool HasZvamo = false;
   bool HasZvlsseg = false;
+  bool HasXfalthalf = false;
+  bool HasXssr = false;
+  bool HasXfrep = false;
+  bool HasXdma = false;
 
 public:
   RISCVTargetInfo(const llvm::Triple &Triple, const TargetOptions &)
@@ -57,6 +61,8 @@ public:
     LongDoubleWidth = 128;
     LongDoubleAlign = 128;
     LongDoubleFormat = &llvm::APFloat::IEEEquad();
+    BFloat16Width = BFloat16Align = 16;
+    BFloat16Format = &llvm::APFloat::BFloat();
     SuitableAlign = 128;
     WCharType = SignedInt;
     WIntType = UnsignedInt;
@@ -46,6 +46,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
@@ -80,8 +82,10 @@
 #include "llvm/Transforms/Scalar/LowerMatrixIntrinsics.h"
 #include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/CanonicalizeAliases.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/EntryExitInstrumenter.h"
 #include "llvm/Transforms/Utils/NameAnonGlobals.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "llvm/Transforms/Utils/SymbolRewriter.h"
 #include "llvm/Transforms/Utils/UniqueInternalLinkageNames.h"
 #include <memory>
@@ -134,6 +138,19 @@ class EmitAssemblyHelper {
   bool AddEmitPasses(legacy::PassManager &CodeGenPasses, BackendAction Action,
                      raw_pwrite_stream &OS, raw_pwrite_stream *DwoOS);
 
+  /// Return true if the code of the module is generated in parallel for the
+  /// partitions requested with -split-codegen-output.
+  bool useSplitCodeGen(BackendAction Action) const {
+    return Action == Backend_EmitObj &&
+           !CodeGenOpts.SplitCodeGenOutputs.empty() &&
+           CodeGenOpts.SplitDwarfOutput.empty();
+  }
+
+  /// Split the optimized module and generate the partitions in parallel. The
+  /// first partition is written to \p OS, the others to the
+  /// -split-codegen-output files.
+  void RunSplitCodeGen(BackendAction Action, raw_pwrite_stream &OS);
+
   std::unique_ptr<llvm::ToolOutputFile> openOutputFile(StringRef Path) {
     std::error_code EC;
     auto F = std::make_unique<llvm::ToolOutputFile>(Path, EC,
@@ -909,6 +926,77 @@ bool EmitAssemblyHelper::AddEmitPasses(legacy::PassManager &CodeGenPasses,
   return true;
 }
 
+void EmitAssemblyHelper::RunSplitCodeGen(BackendAction Action,
+                                         raw_pwrite_stream &OS) {
+  SmallVector<std::unique_ptr<llvm::ToolOutputFile>, 4> PartFiles;
+  SmallVector<raw_pwrite_stream *, 4> OSs = {&OS};
+  for (const std::string &Path : CodeGenOpts.SplitCodeGenOutputs) {
+    PartFiles.push_back(openOutputFile(Path));
+    if (!PartFiles.back())
+      return;
+    OSs.push_back(&PartFiles.back()->os());
+  }
+
+  CodeGenFileType CGFT = getCodeGenFileType(Action);
+  llvm::Triple TargetTriple(TheModule->getTargetTriple());
+
+  // Every partition is generated in its own context by its own target
+  // machine, configured like the one used for the optimization pipeline.
+  auto GeneratePartition = [&](const SmallString<0> &BC,
+                               raw_pwrite_stream *PartOS) {
+    LLVMContext Ctx;
+    Expected<std::unique_ptr<llvm::Module>> MOrErr = parseBitcodeFile(
+        MemoryBufferRef(StringRef(BC.data(), BC.size()), "<split-module>"),
+        Ctx);
+    if (!MOrErr)
+      report_fatal_error("Failed to read bitcode");
+    std::unique_ptr<TargetMachine> PartTM(TM->getTarget().createTargetMachine(
+        TM->getTargetTriple().str(), TM->getTargetCPU(),
+        TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+        TM->getCodeModel(), TM->getOptLevel()));
+
+    legacy::PassManager CodeGenPasses;
+    CodeGenPasses.add(
+        createTargetTransformInfoWrapperPass(PartTM->getTargetIRAnalysis()));
+    llvm::Triple PartTriple(TargetTriple);
+    std::unique_ptr<TargetLibraryInfoImpl> TLII(
+        createTLII(PartTriple, CodeGenOpts));
+    CodeGenPasses.add(new TargetLibraryInfoWrapperPass(*TLII));
+    if (CodeGenOpts.OptimizationLevel > 0)
+      CodeGenPasses.add(createObjCARCContractPass());
+    if (PartTM->addPassesToEmitFile(CodeGenPasses, *PartOS, nullptr, CGFT,
+                                    /*DisableVerify=*/!CodeGenOpts.VerifyModule))
+      report_fatal_error("Failed to set up code generation");
+    CodeGenPasses.run(**MOrErr);
+  };
+
+  // The partitions are serialized on this thread, the partitioning does not
+  // depend on the scheduling of the threads. Internal symbols stay in the
+  // partition of their users, so that the objects can be combined without
+  // changing the symbol table of the translation unit.
+  {
+    ThreadPool CodeGenThreadPool(hardware_concurrency(OSs.size()));
+    unsigned Partition = 0;
+    SplitModule(
+        CloneModule(*TheModule), OSs.size(),
+        [&](std::unique_ptr<llvm::Module> MPart) {
+          SmallString<0> BC;
+          raw_svector_ostream BCOS(BC);
+          WriteBitcodeToFile(*MPart, BCOS);
+          raw_pwrite_stream *PartOS = OSs[Partition++];
+          CodeGenThreadPool.async(
+              [&GeneratePartition, PartOS](const SmallString<0> &BC) {
+                GeneratePartition(BC, PartOS);
+              },
+              std::move(BC));
+        },
+        /*PreserveLocals=*/true);
+  }
+
+  for (std::unique_ptr<llvm::ToolOutputFile> &PartFile : PartFiles)
+    PartFile->keep();
+}
+
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       std::unique_ptr<raw_pwrite_stream> OS) {
   TimeRegion Region(CodeGenOpts.TimePasses ? &CodeGenerationTime : nullptr);
@@ -984,6 +1072,8 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
     break;
 
   default:
+    if (useSplitCodeGen(Action))
+      break;
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
       DwoOS = openOutputFile(CodeGenOpts.SplitDwarfOutput);
       if (!DwoOS)
@@ -1020,7 +1110,10 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
   {
     PrettyStackTraceString CrashInfo("Code generation");
     llvm::TimeTraceScope TimeScope("CodeGenPasses");
-    CodeGenPasses.run(*TheModule);
+    if (useSplitCodeGen(Action))
+      RunSplitCodeGen(Action, *OS);
+    else
+      CodeGenPasses.run(*TheModule);
   }
 
   if (ThinLinkOS)
@@ -1406,6 +1499,8 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
   case Backend_EmitMCNull:
   case Backend_EmitObj:
     NeedCodeGen = true;
+    if (useSplitCodeGen(Action))
+      break;
     CodeGenPasses.add(
         createTargetTransformInfoWrapperPass(getTargetIRAnalysis()));
     if (!CodeGenOpts.SplitDwarfOutput.empty()) {
@@ -1432,7 +1527,10 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
   // Now if needed, run the legacy PM for codegen.
   if (NeedCodeGen) {
     PrettyStackTraceString CrashInfo("Code generation");
-    CodeGenPasses.run(*TheModule);
+    if (useSplitCodeGen(Action))
+      RunSplitCodeGen(Action, *OS);
+    else
+      CodeGenPasses.run(*TheModule);
   }
 
   if (ThinLinkOS)
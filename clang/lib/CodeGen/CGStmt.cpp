@@ -57,6 +57,13 @@ void CodeGenFunction::EmitStmt(const Stmt *S, ArrayRef<const Attr *> Attrs) {
       addFrepMetadata(Builder.GetInsertBlock(), Attrs);
   }
 
+  // Like '#pragma frep infer', '#pragma clang loop frep(enable)' marks the
+  // block in front of the loop for the frep inference of the backend.
+  for (const Attr *A : Attrs)
+    if (const auto *LH = dyn_cast<LoopHintAttr>(A))
+      if (LH->getOption() == LoopHintAttr::Frep && HaveInsertPoint())
+        Builder.CreateIntrinsic(llvm::Intrinsic::riscv_frep_infer, {}, {});
+
   // These statements have their own debug info handling.
   if (EmitSimpleStmt(S, Attrs))
     return;
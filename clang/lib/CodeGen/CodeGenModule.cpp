@@ -3031,6 +3031,20 @@ bool CodeGenModule::shouldEmitFunction(GlobalDecl GD) {
   if (CodeGenOpts.OptimizationLevel == 0 && !F->hasAttr<AlwaysInlineAttr>())
     return false;
 
+  // An available_externally definition only exists to be inlined. Don't pull
+  // in the body of a function that won't be inlined in this compilation, which
+  // for functions from a PCH or module also spares deserializing it. LTO may
+  // still inline it at link time, so keep it then.
+  if (!CodeGenOpts.PrepareForLTO && !CodeGenOpts.PrepareForThinLTO) {
+    if (F->hasAttr<NoInlineAttr>() || F->hasAttr<OptimizeNoneAttr>())
+      return false;
+    if (!F->hasAttr<AlwaysInlineAttr>() &&
+        (CodeGenOpts.getInlining() == CodeGenOptions::OnlyAlwaysInlining ||
+         (CodeGenOpts.getInlining() == CodeGenOptions::OnlyHintInlining &&
+          !F->isInlined())))
+      return false;
+  }
+
   if (F->hasAttr<DLLImportAttr>()) {
     // Check whether it would be safe to inline this dllimport function.
     DLLImportFunctionVisitor Visitor;
@@ -18,6 +18,7 @@
 #include "Arch/VE.h"
 #include "Arch/X86.h"
 #include "CommonArgs.h"
+#include "Gnu.h"
 #include "Hexagon.h"
 #include "InputInfo.h"
 #include "MSP430.h"
@@ -1309,6 +1310,7 @@ void Clang::AddPreprocessingOptions(Compilation &C, const JobAction &JA,
   Args.AddAllArgs(CmdArgs,
                   {options::OPT_D, options::OPT_U, options::OPT_I_Group,
                    options::OPT_F, options::OPT_index_header_map});
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_search_cache_path_EQ);
 
   // Add -Wp, and -Xpreprocessor if using the preprocessor.
 
@@ -3442,6 +3444,8 @@ static void RenderModulesOptions(Compilation &C, const Driver &D,
   Args.AddAllArgs(CmdArgs, options::OPT_fmodules_ignore_macro);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_interval);
   Args.AddLastArg(CmdArgs, options::OPT_fmodules_prune_after);
+  if (HaveClangModules)
+    Args.AddLastArg(CmdArgs, options::OPT_fmodules_build_threads_EQ);
 
   Args.AddLastArg(CmdArgs, options::OPT_fbuild_session_timestamp);
 
@@ -5136,8 +5140,8 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
 
   if (Arg *A = Args.getLastArg(options::OPT_fsplit_machine_functions,
                                options::OPT_fno_split_machine_functions)) {
-    // This codegen pass is only available on x86-elf targets.
-    if (Triple.isX86() && Triple.isOSBinFormatELF()) {
+    // This codegen pass is only available on x86-elf and riscv-elf targets.
+    if ((Triple.isX86() || Triple.isRISCV()) && Triple.isOSBinFormatELF()) {
       if (A->getOption().matches(options::OPT_fsplit_machine_functions))
         A->render(Args, CmdArgs);
     } else {
@@ -5635,6 +5639,7 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   Args.AddLastArg(CmdArgs, options::OPT_ftime_report_EQ);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_trace);
   Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_granularity_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_ftime_trace_memory);
   Args.AddLastArg(CmdArgs, options::OPT_ftrapv);
   Args.AddLastArg(CmdArgs, options::OPT_malign_double);
   Args.AddLastArg(CmdArgs, options::OPT_fno_temp_file);
@@ -5964,11 +5969,16 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
   if (Args.hasFlag(options::OPT_fpch_validate_input_files_content,
                    options::OPT_fno_pch_validate_input_files_content, false))
     CmdArgs.push_back("-fvalidate-ast-input-files-content");
+  // When an object file is built for the PCH, templates instantiated while
+  // building it are emitted once and shared by all of its users, so
+  // -fpch-instantiate-templates is the default, as it is for clang-cl /Yc.
+  bool PCHCodegen =
+      Args.hasFlag(options::OPT_fpch_codegen, options::OPT_fno_pch_codegen,
+                   false);
   if (Args.hasFlag(options::OPT_fpch_instantiate_templates,
-                   options::OPT_fno_pch_instantiate_templates, false))
+                   options::OPT_fno_pch_instantiate_templates, PCHCodegen))
     CmdArgs.push_back("-fpch-instantiate-templates");
-  if (Args.hasFlag(options::OPT_fpch_codegen, options::OPT_fno_pch_codegen,
-                   false))
+  if (PCHCodegen)
     CmdArgs.push_back("-fmodules-codegen");
   if (Args.hasFlag(options::OPT_fpch_debuginfo, options::OPT_fno_pch_debuginfo,
                    false))
@@ -6539,9 +6549,41 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     CmdArgs.push_back(Args.MakeArgString(Str));
   }
 
+  // -fsplit-codegen=N generates the code of N module partitions in parallel.
+  // The cc1 writes one object per partition, a relocatable link combines them
+  // in partition order into the requested output.
+  SmallVector<const char *, 4> SplitCodeGenObjects;
+  if (Arg *A = Args.getLastArg(options::OPT_fsplit_codegen_EQ)) {
+    unsigned Partitions;
+    if (StringRef(A->getValue()).getAsInteger(10, Partitions) ||
+        Partitions == 0)
+      D.Diag(diag::err_drv_invalid_int_value)
+          << A->getAsString(Args) << A->getValue();
+    else if (!TC.getTriple().isOSBinFormatELF())
+      D.Diag(diag::warn_drv_unsupported_opt_for_target)
+          << A->getAsString(Args) << TC.getTripleString();
+    else if (DwarfFission != DwarfFissionKind::None)
+      D.Diag(diag::err_drv_argument_not_allowed_with)
+          << A->getAsString(Args) << "-gsplit-dwarf";
+    else if (Partitions > 1 && Output.isFilename() &&
+             Output.getType() == types::TY_Object) {
+      StringRef Stem = llvm::sys::path::stem(Output.getFilename());
+      for (unsigned I = 0; I != Partitions; ++I)
+        SplitCodeGenObjects.push_back(C.addTempFile(Args.MakeArgString(
+            D.GetTemporaryPath((Stem + "-part" + Twine(I)).str(), "o"))));
+    }
+  }
+
   // Add the "-o out -x type src.c" flags last. This is done primarily to make
   // the -cc1 command easier to edit when reproducing compiler crashes.
-  if (Output.getType() == types::TY_Dependencies) {
+  if (!SplitCodeGenObjects.empty()) {
+    for (const char *Obj : makeArrayRef(SplitCodeGenObjects).drop_front()) {
+      CmdArgs.push_back("-split-codegen-output");
+      CmdArgs.push_back(Obj);
+    }
+    CmdArgs.push_back("-o");
+    CmdArgs.push_back(SplitCodeGenObjects.front());
+  } else if (Output.getType() == types::TY_Dependencies) {
     // Handled with other dependency code.
   } else if (Output.isFilename()) {
     if (Output.getType() == clang::driver::types::TY_IFS_CPP ||
@@ -6607,6 +6649,28 @@ void Clang::ConstructJob(Compilation &C, const JobAction &JA,
     C.getJobs().getJobs().back()->PrintInputFilenames = true;
   }
 
+  if (!SplitCodeGenObjects.empty()) {
+    ArgStringList LinkArgs;
+    InputInfoList Parts;
+    LinkArgs.push_back("-r");
+    // The linker may default to another target than the one being compiled
+    // for, and cannot always infer it from the inputs.
+    if (const char *LDMOption =
+            gnutools::getLDMOption(TC.getTriple(), Args)) {
+      LinkArgs.push_back("-m");
+      LinkArgs.push_back(LDMOption);
+    }
+    LinkArgs.push_back("-o");
+    LinkArgs.push_back(Output.getFilename());
+    for (const char *Obj : SplitCodeGenObjects) {
+      LinkArgs.push_back(Obj);
+      Parts.push_back(InputInfo(types::TY_Object, Obj, Obj));
+    }
+    C.addCommand(std::make_unique<Command>(
+        JA, *this, ResponseFileSupport::AtFileCurCP(),
+        Args.MakeArgString(TC.GetLinkerPath()), LinkArgs, Parts, Output));
+  }
+
   if (Arg *A = Args.getLastArg(options::OPT_pg))
     if (FPKeepKind == CodeGenOptions::FramePointerKind::None &&
         !Args.hasArg(options::OPT_mfentry))
@@ -239,7 +239,8 @@ static bool isArmBigEndian(const llvm::Triple &Triple,
   return IsBigEndian;
 }
 
-static const char *getLDMOption(const llvm::Triple &T, const ArgList &Args) {
+const char *tools::gnutools::getLDMOption(const llvm::Triple &T,
+                                           const ArgList &Args) {
   switch (T.getArch()) {
   case llvm::Triple::x86:
     if (T.isOSIAMCU())
@@ -38,6 +38,11 @@ namespace tools {
 
 /// Directly call GNU Binutils' assembler and linker.
 namespace gnutools {
+
+/// Get the emulation the linker is passed with -m for the triple, or nullptr
+/// if there is none.
+const char *getLDMOption(const llvm::Triple &T,
+                         const llvm::opt::ArgList &Args);
 class LLVM_LIBRARY_VISIBILITY Assembler : public Tool {
 public:
   Assembler(const ToolChain &TC) : Tool("GNU::Assembler", "assembler", TC) {}
@@ -67,12 +67,17 @@ llvm::opt::DerivedArgList *HeroPULPToolChain::TranslateArgs(const llvm::opt::Der
     StringRef BoundArch, Action::OffloadKind DeviceOffloadKind) const {
   DerivedArgList *DAL = new DerivedArgList(Args.getBaseArgs());
 
-  // Set default march
-  StringRef Value = "-march=";
-  const OptTable &Opts = getDriver().getOpts();
-  Arg *march = new Arg(Opts.getOption(options::OPT_march_EQ), Value,
-                       Args.getBaseArgs().MakeIndex(Value), "rv32imafcxpulpv2");
-  DAL->append(march);
+  // Set default march, unless the device is selected explicitly, e.g. with
+  // -Xopenmp-target -mcpu=snitch for a Snitch cluster. The -march would
+  // otherwise override the extensions implied by the CPU.
+  if (!Args.hasArg(options::OPT_march_EQ, options::OPT_mcpu_EQ)) {
+    StringRef Value = "-march=";
+    const OptTable &Opts = getDriver().getOpts();
+    Arg *march = new Arg(Opts.getOption(options::OPT_march_EQ), Value,
+                         Args.getBaseArgs().MakeIndex(Value),
+                         "rv32imafcxpulpv2");
+    DAL->append(march);
+  }
 
   // Append all other args
   for (auto& arg : Args) {
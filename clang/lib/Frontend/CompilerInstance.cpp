@@ -28,6 +28,7 @@
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Frontend/Utils.h"
 #include "clang/Frontend/VerifyDiagnosticConsumer.h"
+#include "clang/Lex/DependencyDirectivesSourceMinimizer.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PreprocessorOptions.h"
@@ -36,6 +37,7 @@
 #include "clang/Serialization/ASTReader.h"
 #include "clang/Serialization/GlobalModuleIndex.h"
 #include "clang/Serialization/InMemoryModuleCache.h"
+#include "llvm/ADT/ScopeExit.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/BuryPointer.h"
 #include "llvm/Support/CrashRecoveryContext.h"
@@ -47,6 +49,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -946,6 +949,7 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
       getSourceManager().clearIDTables();
 
     if (Act.BeginSourceFile(*this, FIF)) {
+      buildImportedModules();
       if (llvm::Error Err = Act.Execute()) {
         consumeError(std::move(Err)); // FIXME this drops errors on the floor.
       }
@@ -1019,6 +1023,10 @@ static Language getLanguageFromOptions(const LangOptions &LangOpts) {
 /// Compile a module file for the given module, using the options
 /// provided by the importing compiler instance. Returns true if the module
 /// was built without errors.
+///
+/// With \p OnWorkerThread, the module is built concurrently with other
+/// modules and only reads the importing instance: it has a file manager of
+/// its own and its diagnostics are dropped.
 static bool
 compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
                   StringRef ModuleName, FrontendInputFile Input,
@@ -1026,7 +1034,8 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
                   llvm::function_ref<void(CompilerInstance &)> PreBuildStep =
                       [](CompilerInstance &) {},
                   llvm::function_ref<void(CompilerInstance &)> PostBuildStep =
-                      [](CompilerInstance &) {}) {
+                      [](CompilerInstance &) {},
+                  bool OnWorkerThread = false) {
   llvm::TimeTraceScope TimeScope("Module Compile", ModuleName);
 
   // Construct a compiler invocation for creating this module.
@@ -1064,10 +1073,15 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
   // instance.
   PreprocessorOptions &ImportingPPOpts
     = ImportingInstance.getInvocation().getPreprocessorOpts();
-  if (!ImportingPPOpts.FailedModules)
-    ImportingPPOpts.FailedModules =
+  if (OnWorkerThread) {
+    PPOpts.FailedModules =
         std::make_shared<PreprocessorOptions::FailedModulesSet>();
-  PPOpts.FailedModules = ImportingPPOpts.FailedModules;
+  } else {
+    if (!ImportingPPOpts.FailedModules)
+      ImportingPPOpts.FailedModules =
+          std::make_shared<PreprocessorOptions::FailedModulesSet>();
+    PPOpts.FailedModules = ImportingPPOpts.FailedModules;
+  }
 
   // If there is a module map file, build the module using the module map.
   // Set up the inputs/outputs so that we build the module from its umbrella
@@ -1086,6 +1100,10 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
   PPOpts.RetainRemappedFileBuffers = true;
 
   Invocation->getDiagnosticOpts().VerifyDiagnostics = 0;
+  if (OnWorkerThread) {
+    Invocation->getDiagnosticOpts().DiagnosticLogFile.clear();
+    Invocation->getDiagnosticOpts().DiagnosticSerializationFile.clear();
+  }
   assert(ImportingInstance.getInvocation().getModuleHash() ==
          Invocation->getModuleHash() && "Module hash mismatch!");
 
@@ -1098,13 +1116,21 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
   auto &Inv = *Invocation;
   Instance.setInvocation(std::move(Invocation));
 
-  Instance.createDiagnostics(new ForwardingDiagnosticConsumer(
+  if (OnWorkerThread)
+    Instance.createDiagnostics(new IgnoringDiagConsumer,
+                               /*ShouldOwnClient=*/true);
+  else
+    Instance.createDiagnostics(new ForwardingDiagnosticConsumer(
                                    ImportingInstance.getDiagnosticClient()),
-                             /*ShouldOwnClient=*/true);
+                               /*ShouldOwnClient=*/true);
 
   // Note that this module is part of the module build stack, so that we
   // can detect cycles in the module graph.
-  Instance.setFileManager(&ImportingInstance.getFileManager());
+  if (OnWorkerThread)
+    Instance.createFileManager(
+        &ImportingInstance.getFileManager().getVirtualFileSystem());
+  else
+    Instance.setFileManager(&ImportingInstance.getFileManager());
   Instance.createSourceManager(Instance.getFileManager());
   SourceManager &SourceMgr = Instance.getSourceManager();
   SourceMgr.setModuleBuildStack(
@@ -1118,9 +1144,10 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
   Instance.setModuleDepCollector(ImportingInstance.getModuleDepCollector());
   Inv.getDependencyOutputOpts() = DependencyOutputOptions();
 
-  ImportingInstance.getDiagnostics().Report(ImportLoc,
-                                            diag::remark_module_build)
-    << ModuleName << ModuleFileName;
+  if (!OnWorkerThread)
+    ImportingInstance.getDiagnostics().Report(ImportLoc,
+                                              diag::remark_module_build)
+        << ModuleName << ModuleFileName;
 
   PreBuildStep(Instance);
 
@@ -1136,9 +1163,10 @@ compileModuleImpl(CompilerInstance &ImportingInstance, SourceLocation ImportLoc,
 
   PostBuildStep(Instance);
 
-  ImportingInstance.getDiagnostics().Report(ImportLoc,
-                                            diag::remark_module_build_done)
-    << ModuleName;
+  if (!OnWorkerThread)
+    ImportingInstance.getDiagnostics().Report(ImportLoc,
+                                              diag::remark_module_build_done)
+        << ModuleName;
 
   // Delete any remaining temporary files related to Instance, in case the
   // module generation thread crashed.
@@ -1162,19 +1190,30 @@ static const FileEntry *getPublicModuleMap(const FileEntry *File,
   return nullptr;
 }
 
-/// Compile a module file for the given module in a separate compiler instance,
-/// using the options provided by the importing compiler instance. Returns true
-/// if the module was built without errors.
-static bool compileModule(CompilerInstance &ImportingInstance,
-                          SourceLocation ImportLoc, Module *Module,
-                          StringRef ModuleFileName) {
+namespace {
+/// Where a module is built from, as found in the module map of the
+/// importing compiler instance.
+struct ModuleBuildInput {
+  FrontendInputFile Input;
+  std::string OriginalModuleMapFile;
+
+  /// The contents of the module map of an inferred module, which is parsed
+  /// from a fake file named by Input.
+  std::string InferredModuleMapContent;
+};
+} // end anonymous namespace
+
+static ModuleBuildInput getModuleBuildInput(CompilerInstance &ImportingInstance,
+                                            Module *Module) {
   InputKind IK(getLanguageFromOptions(ImportingInstance.getLangOpts()),
                InputKind::ModuleMap);
 
   // Get or create the module map that we'll use to build this module.
   ModuleMap &ModMap
     = ImportingInstance.getPreprocessor().getHeaderSearchInfo().getModuleMap();
-  bool Result;
+  ModuleBuildInput Result;
+  Result.OriginalModuleMapFile =
+      std::string(ModMap.getModuleMapFileForUniquing(Module)->getName());
   if (const FileEntry *ModuleMapFile =
           ModMap.getContainingModuleMapFile(Module)) {
     // Canonicalize compilation to start with the public module map. This is
@@ -1185,39 +1224,62 @@ static bool compileModule(CompilerInstance &ImportingInstance,
       ModuleMapFile = PublicMMFile;
 
     // Use the module map where this module resides.
-    Result = compileModuleImpl(
-        ImportingInstance, ImportLoc, Module->getTopLevelModuleName(),
-        FrontendInputFile(ModuleMapFile->getName(), IK, +Module->IsSystem),
-        ModMap.getModuleMapFileForUniquing(Module)->getName(),
-        ModuleFileName);
-  } else {
-    // FIXME: We only need to fake up an input file here as a way of
-    // transporting the module's directory to the module map parser. We should
-    // be able to do that more directly, and parse from a memory buffer without
-    // inventing this file.
-    SmallString<128> FakeModuleMapFile(Module->Directory->getName());
-    llvm::sys::path::append(FakeModuleMapFile, "__inferred_module.map");
-
-    std::string InferredModuleMapContent;
-    llvm::raw_string_ostream OS(InferredModuleMapContent);
-    Module->print(OS);
-    OS.flush();
-
-    Result = compileModuleImpl(
-        ImportingInstance, ImportLoc, Module->getTopLevelModuleName(),
-        FrontendInputFile(FakeModuleMapFile, IK, +Module->IsSystem),
-        ModMap.getModuleMapFileForUniquing(Module)->getName(),
-        ModuleFileName,
-        [&](CompilerInstance &Instance) {
-      std::unique_ptr<llvm::MemoryBuffer> ModuleMapBuffer =
-          llvm::MemoryBuffer::getMemBuffer(InferredModuleMapContent);
-      ModuleMapFile = Instance.getFileManager().getVirtualFile(
-          FakeModuleMapFile, InferredModuleMapContent.size(), 0);
-      Instance.getSourceManager().overrideFileContents(
-          ModuleMapFile, std::move(ModuleMapBuffer));
-    });
+    Result.Input =
+        FrontendInputFile(ModuleMapFile->getName(), IK, +Module->IsSystem);
+    return Result;
   }
 
+  // FIXME: We only need to fake up an input file here as a way of
+  // transporting the module's directory to the module map parser. We should
+  // be able to do that more directly, and parse from a memory buffer without
+  // inventing this file.
+  SmallString<128> FakeModuleMapFile(Module->Directory->getName());
+  llvm::sys::path::append(FakeModuleMapFile, "__inferred_module.map");
+  Result.Input = FrontendInputFile(FakeModuleMapFile, IK, +Module->IsSystem);
+
+  llvm::raw_string_ostream OS(Result.InferredModuleMapContent);
+  Module->print(OS);
+  OS.flush();
+  return Result;
+}
+
+/// Compile a module file from \p BuildInput, see compileModuleImpl.
+static bool compileModuleFromInput(CompilerInstance &ImportingInstance,
+                                   SourceLocation ImportLoc,
+                                   StringRef ModuleName,
+                                   const ModuleBuildInput &BuildInput,
+                                   StringRef ModuleFileName,
+                                   bool OnWorkerThread = false) {
+  if (BuildInput.InferredModuleMapContent.empty())
+    return compileModuleImpl(
+        ImportingInstance, ImportLoc, ModuleName, BuildInput.Input,
+        BuildInput.OriginalModuleMapFile, ModuleFileName,
+        [](CompilerInstance &) {}, [](CompilerInstance &) {}, OnWorkerThread);
+
+  return compileModuleImpl(
+      ImportingInstance, ImportLoc, ModuleName, BuildInput.Input,
+      BuildInput.OriginalModuleMapFile, ModuleFileName,
+      [&](CompilerInstance &Instance) {
+    StringRef Content = BuildInput.InferredModuleMapContent;
+    std::unique_ptr<llvm::MemoryBuffer> ModuleMapBuffer =
+        llvm::MemoryBuffer::getMemBuffer(Content);
+    const FileEntry *ModuleMapFile = Instance.getFileManager().getVirtualFile(
+        BuildInput.Input.getFile(), Content.size(), 0);
+    Instance.getSourceManager().overrideFileContents(
+        ModuleMapFile, std::move(ModuleMapBuffer));
+  }, [](CompilerInstance &) {}, OnWorkerThread);
+}
+
+/// Compile a module file for the given module in a separate compiler instance,
+/// using the options provided by the importing compiler instance. Returns true
+/// if the module was built without errors.
+static bool compileModule(CompilerInstance &ImportingInstance,
+                          SourceLocation ImportLoc, Module *Module,
+                          StringRef ModuleFileName) {
+  bool Result = compileModuleFromInput(
+      ImportingInstance, ImportLoc, Module->getTopLevelModuleName(),
+      getModuleBuildInput(ImportingInstance, Module), ModuleFileName);
+
   // We've rebuilt a module. If we're allowed to generate or update the global
   // module index, record that fact in the importing compiler instance.
   if (ImportingInstance.getFrontendOpts().GenerateGlobalModuleIndex) {
@@ -1233,7 +1295,8 @@ static bool compileModule(CompilerInstance &ImportingInstance,
 /// Uses a lock file manager and exponential backoff to reduce the chances that
 /// multiple instances will compete to create the same module.  On timeout,
 /// deletes the lock file in order to avoid deadlock from crashing processes or
-/// bugs in the lock file manager.
+/// bugs in the lock file manager.  Threads of this process building the same
+/// module wait for each other through the module cache instead.
 static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
                                     SourceLocation ImportLoc,
                                     SourceLocation ModuleNameLoc,
@@ -1250,48 +1313,77 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
   StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
   llvm::sys::fs::create_directories(Dir);
 
+  // The module built by the importing instance, if any, which waits for this
+  // one to be built.
+  InMemoryModuleCache &ModuleCache = ImportingInstance.getModuleCache();
+  StringRef Importer;
+  if (ImportingInstance.getFrontendOpts().BuildingImplicitModule)
+    Importer = ImportingInstance.getFrontendOpts().OutputFile;
+
   while (1) {
     unsigned ModuleLoadCapabilities = ASTReader::ARR_Missing;
-    llvm::LockFileManager Locked(ModuleFileName);
-    switch (Locked) {
-    case llvm::LockFileManager::LFS_Error:
-      // ModuleCache takes care of correctness and locks are only necessary for
-      // performance. Fallback to building the module in case of any lock
-      // related errors.
-      Diags.Report(ModuleNameLoc, diag::remark_module_lock_failure)
-          << Module->Name << Locked.getErrorMessage();
-      // Clear out any potential leftover.
-      Locked.unsafeRemoveLockFile();
-      LLVM_FALLTHROUGH;
-    case llvm::LockFileManager::LFS_Owned:
-      // We're responsible for building the module ourselves.
+    InMemoryModuleCache::BuildClaim Claim =
+        ModuleCache.claimBuild(ModuleFileName, Importer);
+    auto ReleaseBuild = llvm::make_scope_exit([&] {
+      if (Claim == InMemoryModuleCache::BuildClaimed)
+        ModuleCache.releaseBuild(ModuleFileName, Importer);
+    });
+
+    std::unique_ptr<llvm::LockFileManager> Locked;
+    if (Claim == InMemoryModuleCache::BuildWaited) {
+      // Another thread built the module.
+      ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
+    } else if (Claim == InMemoryModuleCache::BuildCycle) {
+      // The thread building the module, which holds its lock file, waits for
+      // this one. Build it here to diagnose the cycle.
       if (!compileModule(ImportingInstance, ModuleNameLoc, Module,
                          ModuleFileName)) {
         diagnoseBuildFailure();
         return false;
       }
-      break;
+    } else if (!ModuleCache.isPCMFinal(ModuleFileName)) {
+      // Unless another thread just built it, build the module.
+      Locked = std::make_unique<llvm::LockFileManager>(ModuleFileName);
+      switch (*Locked) {
+      case llvm::LockFileManager::LFS_Error:
+        // ModuleCache takes care of correctness and locks are only necessary
+        // for performance. Fallback to building the module in case of any
+        // lock related errors.
+        Diags.Report(ModuleNameLoc, diag::remark_module_lock_failure)
+            << Module->Name << Locked->getErrorMessage();
+        // Clear out any potential leftover.
+        Locked->unsafeRemoveLockFile();
+        LLVM_FALLTHROUGH;
+      case llvm::LockFileManager::LFS_Owned:
+        // We're responsible for building the module ourselves.
+        if (!compileModule(ImportingInstance, ModuleNameLoc, Module,
+                           ModuleFileName)) {
+          diagnoseBuildFailure();
+          return false;
+        }
+        break;
 
-    case llvm::LockFileManager::LFS_Shared:
-      // Someone else is responsible for building the module. Wait for them to
-      // finish.
-      switch (Locked.waitForUnlock()) {
-      case llvm::LockFileManager::Res_Success:
-        ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
+      case llvm::LockFileManager::LFS_Shared:
+        // Someone else is responsible for building the module. Wait for them
+        // to finish.
+        switch (Locked->waitForUnlock()) {
+        case llvm::LockFileManager::Res_Success:
+          ModuleLoadCapabilities |= ASTReader::ARR_OutOfDate;
+          break;
+        case llvm::LockFileManager::Res_OwnerDied:
+          continue; // try again to get the lock.
+        case llvm::LockFileManager::Res_Timeout:
+          // Since ModuleCache takes care of correctness, we try waiting for
+          // another process to complete the build so clang does not do it done
+          // twice. If case of timeout, build it ourselves.
+          Diags.Report(ModuleNameLoc, diag::remark_module_lock_timeout)
+              << Module->Name;
+          // Clear the lock file so that future invocations can make progress.
+          Locked->unsafeRemoveLockFile();
+          continue;
+        }
         break;
-      case llvm::LockFileManager::Res_OwnerDied:
-        continue; // try again to get the lock.
-      case llvm::LockFileManager::Res_Timeout:
-        // Since ModuleCache takes care of correctness, we try waiting for
-        // another process to complete the build so clang does not do it done
-        // twice. If case of timeout, build it ourselves.
-        Diags.Report(ModuleNameLoc, diag::remark_module_lock_timeout)
-            << Module->Name;
-        // Clear the lock file so that future invocations can make progress.
-        Locked.unsafeRemoveLockFile();
-        continue;
       }
-      break;
     }
 
     // Try to read the module file, now that we've compiled it.
@@ -1301,7 +1393,8 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
             ModuleLoadCapabilities);
 
     if (ReadResult == ASTReader::OutOfDate &&
-        Locked == llvm::LockFileManager::LFS_Shared) {
+        (Claim == InMemoryModuleCache::BuildWaited ||
+         (Locked && *Locked == llvm::LockFileManager::LFS_Shared))) {
       // The module may be out of date in the presence of file system races,
       // or if one of its imports depends on header search paths that are not
       // consistent with this ImportingInstance.  Try again...
@@ -1317,6 +1410,180 @@ static bool compileModuleAndReadAST(CompilerInstance &ImportingInstance,
   }
 }
 
+/// Build a module imported by the main file of \p ImportingInstance on a
+/// worker thread, without reading it.  Failures are dropped: the module is
+/// built again and diagnosed when it is imported.
+static void buildModuleOnWorkerThread(CompilerInstance &ImportingInstance,
+                                      StringRef ModuleName,
+                                      const ModuleBuildInput &BuildInput,
+                                      StringRef ModuleFileName) {
+  StringRef Dir = llvm::sys::path::parent_path(ModuleFileName);
+  llvm::sys::fs::create_directories(Dir);
+
+  // A module imported by several modules is built by the first thread that
+  // needs it.
+  InMemoryModuleCache &ModuleCache = ImportingInstance.getModuleCache();
+  if (ModuleCache.claimBuild(ModuleFileName, StringRef()) !=
+      InMemoryModuleCache::BuildClaimed)
+    return;
+  auto ReleaseBuild = llvm::make_scope_exit(
+      [&] { ModuleCache.releaseBuild(ModuleFileName, StringRef()); });
+  if (ModuleCache.getPCMState(ModuleFileName) != InMemoryModuleCache::Unknown)
+    return;
+
+  // Leave the modules that another process builds to the import, which waits
+  // for them.
+  llvm::LockFileManager Locked(ModuleFileName);
+  if (Locked == llvm::LockFileManager::LFS_Shared)
+    return;
+  if (Locked == llvm::LockFileManager::LFS_Error)
+    Locked.unsafeRemoveLockFile();
+
+  compileModuleFromInput(ImportingInstance, SourceLocation(), ModuleName,
+                         BuildInput, ModuleFileName, /*OnWorkerThread=*/true);
+}
+
+/// Find the top-level modules that the main file of \p CI imports, from the
+/// inclusion and import directives outside of conditionals.
+static void findImportedModules(CompilerInstance &CI,
+                                SmallVectorImpl<Module *> &Modules) {
+  namespace tokens = minimize_source_to_dependency_directives;
+
+  SourceManager &SourceMgr = CI.getSourceManager();
+  FileID MainFileID = SourceMgr.getMainFileID();
+  const FileEntry *MainFile = SourceMgr.getFileEntryForID(MainFileID);
+  llvm::Optional<llvm::MemoryBufferRef> Buffer =
+      SourceMgr.getBufferOrNone(MainFileID);
+  if (!MainFile || !Buffer)
+    return;
+
+  SmallString<1024> Directives;
+  SmallVector<tokens::Token, 32> Tokens;
+  if (minimizeSourceToDependencyDirectives(Buffer->getBuffer(), Directives,
+                                           Tokens))
+    return;
+
+  HeaderSearch &HS = CI.getPreprocessor().getHeaderSearchInfo();
+  StringRef CurrentModule = CI.getLangOpts().CurrentModule;
+  llvm::SmallPtrSet<Module *, 16> Seen;
+  unsigned Depth = 0;
+  for (const tokens::Token &Tok : Tokens) {
+    switch (Tok.K) {
+    case tokens::pp_if:
+    case tokens::pp_ifdef:
+    case tokens::pp_ifndef:
+      ++Depth;
+      continue;
+    case tokens::pp_endif:
+      if (Depth)
+        --Depth;
+      continue;
+    case tokens::pp_include:
+    case tokens::pp_import:
+    case tokens::decl_at_import:
+      if (!Depth)
+        break;
+      continue;
+    default:
+      continue;
+    }
+
+    StringRef Directive =
+        Directives.str().substr(Tok.Offset).split('\n').first;
+    Module *M = nullptr;
+    if (Tok.K == tokens::decl_at_import) {
+      // @import A.B;
+      StringRef Name = Directive.drop_front(strlen("@import"))
+                           .split('.').first.split(';').first.trim();
+      M = HS.lookupModule(Name, /*AllowSearch=*/true,
+                          /*AllowExtraModuleMapSearch=*/true);
+    } else {
+      // #include <a/b.h> or #include "a/b.h"; skip macro expansions.
+      size_t Begin = Directive.find_first_of("<\"");
+      if (Begin == StringRef::npos)
+        continue;
+      bool IsAngled = Directive[Begin] == '<';
+      size_t End = Directive.find(IsAngled ? '>' : '"', Begin + 1);
+      if (End == StringRef::npos)
+        continue;
+      StringRef Filename = Directive.slice(Begin + 1, End);
+
+      const DirectoryLookup *CurDir;
+      ModuleMap::KnownHeader SuggestedModule;
+      std::pair<const FileEntry *, const DirectoryEntry *> Includer(
+          MainFile, MainFile->getDir());
+      HS.LookupFile(Filename, SourceLocation(), IsAngled, /*FromDir=*/nullptr,
+                    CurDir, Includer, /*SearchPath=*/nullptr,
+                    /*RelativePath=*/nullptr, /*RequestingModule=*/nullptr,
+                    &SuggestedModule, /*IsMapped=*/nullptr,
+                    /*IsFrameworkFound=*/nullptr);
+      M = SuggestedModule.getModule();
+    }
+    if (!M)
+      continue;
+
+    M = M->getTopLevelModule();
+    if (M->getASTFile() || !M->isAvailable() || M->Name == CurrentModule)
+      continue;
+    if (Seen.insert(M).second)
+      Modules.push_back(M);
+  }
+}
+
+void CompilerInstance::buildImportedModules() {
+  const HeaderSearchOptions &HSOpts = getHeaderSearchOpts();
+  unsigned Threads = HSOpts.ModulesBuildThreads;
+  if (Threads <= 1 || !getLangOpts().Modules ||
+      !getLangOpts().ImplicitModules ||
+      getFrontendOpts().BuildingImplicitModule || !hasPreprocessor() ||
+      getModuleDepCollector() || !HSOpts.PrebuiltModuleFiles.empty() ||
+      !HSOpts.PrebuiltModulePaths.empty())
+    return;
+
+  HeaderSearch &HS = getPreprocessor().getHeaderSearchInfo();
+  if (HS.getModuleCachePath().empty())
+    return;
+
+  SmallVector<Module *, 16> Imported;
+  findImportedModules(*this, Imported);
+
+  // Modules that have a module file may well be up to date; their imports
+  // validate them as usual.
+  SmallVector<Module *, 16> Missing;
+  SmallVector<std::string, 16> ModuleFileNames;
+  for (Module *M : Imported) {
+    std::string ModuleFileName = HS.getCachedModuleFileName(M);
+    if (ModuleFileName.empty() ||
+        getModuleCache().getPCMState(ModuleFileName) !=
+            InMemoryModuleCache::Unknown ||
+        llvm::sys::fs::exists(ModuleFileName))
+      continue;
+    Missing.push_back(M);
+    ModuleFileNames.push_back(std::move(ModuleFileName));
+  }
+
+  // A single module is built as well when it is imported.
+  if (Missing.size() < 2)
+    return;
+
+  // Only the module builds run on the pool and they only read this instance,
+  // so collect their inputs from the module map first.
+  SmallVector<ModuleBuildInput, 16> BuildInputs;
+  for (Module *M : Missing)
+    BuildInputs.push_back(getModuleBuildInput(*this, M));
+
+  llvm::ThreadPool Pool(llvm::hardware_concurrency(Threads));
+  for (unsigned I = 0, E = Missing.size(); I != E; ++I)
+    Pool.async([this, &Missing, &BuildInputs, &ModuleFileNames, I] {
+      buildModuleOnWorkerThread(*this, Missing[I]->Name, BuildInputs[I],
+                                ModuleFileNames[I]);
+    });
+  Pool.wait();
+
+  if (getFrontendOpts().GenerateGlobalModuleIndex)
+    setBuildGlobalModuleIndex(true);
+}
+
 /// Diagnose differences between the current definition of the given
 /// configuration macro and the definition provided on the command line.
 static void checkConfigMacro(Preprocessor &PP, StringRef ConfigMacro,
@@ -833,6 +833,14 @@ static void parseAnalyzerConfigs(AnalyzerOptions &AnOpts,
     Diags->Report(diag::err_analyzer_config_invalid_input)
         << "track-conditions-debug" << "'track-conditions' to also be enabled";
 
+  if (AnOpts.ShardCount == 0)
+    Diags->Report(diag::err_analyzer_config_invalid_input) << "shard-count"
+                                                           << "a positive";
+
+  if (AnOpts.ShardIndex >= std::max(AnOpts.ShardCount, 1u))
+    Diags->Report(diag::err_analyzer_config_invalid_input)
+        << "shard-index" << "an unsigned, less than 'shard-count',";
+
   if (!AnOpts.CTUDir.empty() && !llvm::sys::fs::is_directory(AnOpts.CTUDir))
     Diags->Report(diag::err_analyzer_config_invalid_input) << "ctu-dir"
                                                            << "a filename";
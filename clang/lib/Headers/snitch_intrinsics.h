@@ -0,0 +1,207 @@
+/*===---- snitch_intrinsics.h - Snitch SSR, DMA and FREP intrinsics --------===
+ *
+ * Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+ * See https://llvm.org/LICENSE.txt for license information.
+ * SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+ *
+ *===-----------------------------------------------------------------------===
+ */
+
+#ifndef __SNITCH_INTRINSICS_H
+#define __SNITCH_INTRINSICS_H
+
+#ifndef __riscv
+#error "Snitch intrinsics are only available on RISC-V targets."
+#endif
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define __DEFAULT_FN_ATTRS __attribute__((__always_inline__, __nodebug__))
+
+/* Stream semantic registers (Xssr)
+ *
+ * A stream is described by its data mover and by the number of iterations and
+ * the stride in bytes of each of its up to 4 nested loops, innermost first.
+ * The descriptor builders compute the values of the bound and stride
+ * registers. They are always inlined, so that a constant descriptor folds into
+ * scfgwi instructions with the register address as immediate.
+ */
+#ifdef __riscv_xssr
+
+enum snitch_ssr_dm {
+  SNITCH_SSR_DM0 = 0,
+  SNITCH_SSR_DM1 = 1,
+  SNITCH_SSR_DM2 = 2,
+  SNITCH_SSR_DM_ALL = 31
+};
+
+typedef struct {
+  uint32_t __dm;
+  uint32_t __dims;
+  uint32_t __bound[4];
+  uint32_t __stride[4];
+} snitch_ssr_stream_t;
+
+static __inline__ snitch_ssr_stream_t __DEFAULT_FN_ATTRS
+__snitch_ssr_stream(uint32_t __dm, uint32_t __dims, const uint32_t *__n,
+                    const uint32_t *__s) {
+  snitch_ssr_stream_t __stream = {__dm, __dims, {0, 0, 0, 0}, {0, 0, 0, 0}};
+  /* Each stride register holds the increment on top of the distance covered
+   * by the inner loops. */
+  uint32_t __covered = 0;
+  for (uint32_t __i = 0; __i < __dims; ++__i) {
+    __stream.__bound[__i] = __n[__i] - 1;
+    __stream.__stride[__i] = __s[__i] - __covered;
+    __covered += __s[__i] * (__n[__i] - 1);
+  }
+  return __stream;
+}
+
+static __inline__ snitch_ssr_stream_t __DEFAULT_FN_ATTRS
+snitch_ssr_stream_1d(uint32_t __dm, uint32_t __n0, uint32_t __s0) {
+  const uint32_t __n[] = {__n0};
+  const uint32_t __s[] = {__s0};
+  return __snitch_ssr_stream(__dm, 1, __n, __s);
+}
+
+static __inline__ snitch_ssr_stream_t __DEFAULT_FN_ATTRS
+snitch_ssr_stream_2d(uint32_t __dm, uint32_t __n0, uint32_t __n1,
+                     uint32_t __s0, uint32_t __s1) {
+  const uint32_t __n[] = {__n0, __n1};
+  const uint32_t __s[] = {__s0, __s1};
+  return __snitch_ssr_stream(__dm, 2, __n, __s);
+}
+
+static __inline__ snitch_ssr_stream_t __DEFAULT_FN_ATTRS
+snitch_ssr_stream_3d(uint32_t __dm, uint32_t __n0, uint32_t __n1,
+                     uint32_t __n2, uint32_t __s0, uint32_t __s1,
+                     uint32_t __s2) {
+  const uint32_t __n[] = {__n0, __n1, __n2};
+  const uint32_t __s[] = {__s0, __s1, __s2};
+  return __snitch_ssr_stream(__dm, 3, __n, __s);
+}
+
+static __inline__ snitch_ssr_stream_t __DEFAULT_FN_ATTRS
+snitch_ssr_stream_4d(uint32_t __dm, uint32_t __n0, uint32_t __n1,
+                     uint32_t __n2, uint32_t __n3, uint32_t __s0,
+                     uint32_t __s1, uint32_t __s2, uint32_t __s3) {
+  const uint32_t __n[] = {__n0, __n1, __n2, __n3};
+  const uint32_t __s[] = {__s0, __s1, __s2, __s3};
+  return __snitch_ssr_stream(__dm, 4, __n, __s);
+}
+
+/* Write the bound and stride registers of the stream's data mover. */
+static __inline__ void __DEFAULT_FN_ATTRS
+snitch_ssr_configure(snitch_ssr_stream_t __stream) {
+  switch (__stream.__dims) {
+  case 4:
+    __builtin_ssr_setup_bound_stride_4d(__stream.__dm, __stream.__bound[3],
+                                        __stream.__stride[3]);
+    /* FALLTHROUGH */
+  case 3:
+    __builtin_ssr_setup_bound_stride_3d(__stream.__dm, __stream.__bound[2],
+                                        __stream.__stride[2]);
+    /* FALLTHROUGH */
+  case 2:
+    __builtin_ssr_setup_bound_stride_2d(__stream.__dm, __stream.__bound[1],
+                                        __stream.__stride[1]);
+    /* FALLTHROUGH */
+  default:
+    __builtin_ssr_setup_bound_stride_1d(__stream.__dm, __stream.__bound[0],
+                                        __stream.__stride[0]);
+  }
+}
+
+/* Repeat each element of the stream's data mover __count times. */
+static __inline__ void __DEFAULT_FN_ATTRS
+snitch_ssr_repeat(uint32_t __dm, uint32_t __count) {
+  __builtin_ssr_setup_repetition(__dm, __count - 1);
+}
+
+/* Start reading the stream from __ptr. */
+static __inline__ void __DEFAULT_FN_ATTRS
+snitch_ssr_read(snitch_ssr_stream_t __stream, const void *__ptr) {
+  __builtin_ssr_read(__stream.__dm, __stream.__dims - 1, (void *)__ptr);
+}
+
+/* Start writing the stream to __ptr. */
+static __inline__ void __DEFAULT_FN_ATTRS
+snitch_ssr_write(snitch_ssr_stream_t __stream, void *__ptr) {
+  __builtin_ssr_write(__stream.__dm, __stream.__dims - 1, __ptr);
+}
+
+static __inline__ void __DEFAULT_FN_ATTRS snitch_ssr_enable(void) {
+  __builtin_ssr_enable();
+}
+
+static __inline__ void __DEFAULT_FN_ATTRS snitch_ssr_disable(void) {
+  __builtin_ssr_disable();
+}
+
+/* The data register of a streamer is named by an immediate. */
+#define snitch_ssr_push(dm, value) __builtin_ssr_push((dm), (value))
+#define snitch_ssr_pop(dm) __builtin_ssr_pop(dm)
+#define snitch_ssr_barrier(dm) __builtin_ssr_barrier(dm)
+
+#endif /* __riscv_xssr */
+
+/* Cluster DMA (Xdma) */
+#ifdef __riscv_xdma
+
+typedef uint32_t snitch_dma_txid_t;
+
+/* Copy __size bytes from __src to __dst. */
+static __inline__ snitch_dma_txid_t __DEFAULT_FN_ATTRS
+snitch_dma_start_1d(void *__dst, const void *__src, uint32_t __size) {
+  return __builtin_sdma_start_oned((uintptr_t)__src, (uintptr_t)__dst, __size,
+                                   0);
+}
+
+/* Copy __reps rows of __size bytes, advancing the source and destination by
+ * __src_stride and __dst_stride bytes between rows. */
+static __inline__ snitch_dma_txid_t __DEFAULT_FN_ATTRS
+snitch_dma_start_2d(void *__dst, const void *__src, uint32_t __size,
+                    uint32_t __dst_stride, uint32_t __src_stride,
+                    uint32_t __reps) {
+  return __builtin_sdma_start_twod((uintptr_t)__src, (uintptr_t)__dst, __size,
+                                   __src_stride, __dst_stride, __reps, 0);
+}
+
+static __inline__ uint32_t __DEFAULT_FN_ATTRS
+snitch_dma_status(snitch_dma_txid_t __id) {
+  return __builtin_sdma_stat(__id);
+}
+
+/* Wait until the transfer __id has completed. */
+static __inline__ void __DEFAULT_FN_ATTRS
+snitch_dma_wait(snitch_dma_txid_t __id) {
+  __builtin_sdma_wait(__id);
+}
+
+/* Wait until all transfers have completed. */
+static __inline__ void __DEFAULT_FN_ATTRS snitch_dma_wait_all(void) {
+  __builtin_sdma_wait_for_idle();
+}
+
+#endif /* __riscv_xdma */
+
+/* Floating-point repetition (Xfrep)
+ *
+ * Marks the following loop for conversion into an frep hardware loop, see
+ * '#pragma clang loop frep(enable)'.
+ */
+#ifdef __riscv_xfrep
+#define SNITCH_FREP_LOOP _Pragma("clang loop frep(enable)")
+#endif /* __riscv_xfrep */
+
+#undef __DEFAULT_FN_ATTRS
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* __SNITCH_INTRINSICS_H */
@@ -28,16 +28,21 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
@@ -56,6 +61,9 @@ ALWAYS_ENABLED_STATISTIC(
 ALWAYS_ENABLED_STATISTIC(NumFrameworkLookups, "Number of framework lookups.");
 ALWAYS_ENABLED_STATISTIC(NumSubFrameworkLookups,
                          "Number of subframework lookups.");
+ALWAYS_ENABLED_STATISTIC(
+    NumDirectoryListingSkips,
+    "Number of header lookups skipped due to cached directory listings.");
 
 const IdentifierInfo *
 HeaderFileInfo::getControllingMacro(ExternalPreprocessorSource *External) {
@@ -105,7 +113,9 @@ void HeaderSearch::PrintStats() {
                << " #includes skipped due to the multi-include optimization.\n";
 
   llvm::errs() << NumFrameworkLookups << " framework lookups.\n"
-               << NumSubFrameworkLookups << " subframework lookups.\n";
+               << NumSubFrameworkLookups << " subframework lookups.\n"
+               << NumDirectoryListingSkips
+               << " lookups skipped due to directory listings.\n";
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -371,6 +381,92 @@ Optional<FileEntryRef> HeaderSearch::getFileAndSuggestModule(
   return *File;
 }
 
+/// Directories modified this recently don't have their listing cached, as
+/// further changes within the resolution of the file system's timestamps
+/// would go unnoticed.
+static constexpr std::chrono::seconds RacyDirectoryInterval(2);
+
+std::unique_ptr<llvm::StringSet<>>
+HeaderSearch::loadDirectoryListing(const DirectoryEntry *Dir) {
+  llvm::vfs::FileSystem &FS = FileMgr.getVirtualFileSystem();
+  SmallString<128> DirName(Dir->getName());
+  FileMgr.makeAbsolutePath(DirName);
+  llvm::ErrorOr<llvm::vfs::Status> Status = FS.status(DirName);
+  if (!Status)
+    return nullptr;
+
+  // A listing is valid as long as the modification time of the directory
+  // stays the same, which changes whenever an entry is added or removed.
+  std::string Stamp;
+  llvm::raw_string_ostream(Stamp)
+      << Status->getLastModificationTime().time_since_epoch().count() << ' '
+      << DirName;
+  SmallString<128> CacheFile(HSOpts->HeaderSearchCachePath);
+  llvm::sys::path::append(CacheFile,
+                          llvm::utohexstr(llvm::xxHash64(DirName)) + ".dirs");
+
+  auto Listing = std::make_unique<llvm::StringSet<>>();
+  if (auto Buffer = llvm::MemoryBuffer::getFile(CacheFile)) {
+    StringRef Contents = (*Buffer)->getBuffer();
+    StringRef CachedStamp;
+    std::tie(CachedStamp, Contents) = Contents.split('\n');
+    if (CachedStamp == Stamp) {
+      SmallVector<StringRef, 64> Names;
+      Contents.split(Names, '\n', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+      for (StringRef Name : Names)
+        Listing->insert(Name);
+      return Listing;
+    }
+  }
+
+  std::error_code EC;
+  bool CanCache = true;
+  for (llvm::vfs::directory_iterator Entry = FS.dir_begin(DirName, EC), End;
+       Entry != End && !EC; Entry.increment(EC)) {
+    // Compare names case-insensitively, so that a listing never rejects a
+    // file on a case-insensitive file system.
+    std::string Name = llvm::sys::path::filename(Entry->path()).lower();
+    CanCache &= Name.find('\n') == std::string::npos;
+    Listing->insert(Name);
+  }
+  if (EC)
+    return nullptr;
+
+  if (CanCache && std::chrono::system_clock::now() -
+                          Status->getLastModificationTime() >
+                      RacyDirectoryInterval) {
+    std::string Contents;
+    llvm::raw_string_ostream OS(Contents);
+    OS << Stamp << '\n';
+    for (const auto &Name : Listing->keys())
+      OS << Name << '\n';
+    // Failing to update the cache only costs performance.
+    llvm::sys::fs::create_directories(HSOpts->HeaderSearchCachePath);
+    llvm::consumeError(llvm::writeFileAtomically(
+        (CacheFile + "-%%%%%%%%").str(), CacheFile, OS.str()));
+  }
+  return Listing;
+}
+
+bool HeaderSearch::mayContainFile(const DirectoryEntry *Dir,
+                                  StringRef Filename) {
+  if (HSOpts->HeaderSearchCachePath.empty() || Filename.empty() ||
+      llvm::sys::path::is_absolute(Filename))
+    return true;
+  StringRef FirstComponent = *llvm::sys::path::begin(Filename);
+  if (FirstComponent == "." || FirstComponent == "..")
+    return true;
+
+  auto Known = DirectoryListings.find(Dir);
+  if (Known == DirectoryListings.end())
+    Known = DirectoryListings.try_emplace(Dir, loadDirectoryListing(Dir)).first;
+  if (!Known->second || Known->second->count(FirstComponent.lower()))
+    return true;
+
+  ++NumDirectoryListingSkips;
+  return false;
+}
+
 /// LookupFile - Lookup the specified file in this search path, returning it
 /// if it exists or returning null if not.
 Optional<FileEntryRef> DirectoryLookup::LookupFile(
@@ -398,6 +494,9 @@ Optional<FileEntryRef> DirectoryLookup::LookupFile(
       RelativePath->append(Filename.begin(), Filename.end());
     }
 
+    if (!HS.mayContainFile(getDir(), Filename))
+      return None;
+
     return HS.getFileAndSuggestModule(TmpDir, IncludeLoc, getDir(),
                                       isSystemHeaderDirectory(),
                                       RequestingModule, SuggestedModule);
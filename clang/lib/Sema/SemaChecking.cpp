@@ -3532,6 +3532,20 @@ bool Sema::CheckRISCVBuiltinFunctionCall(unsigned BuiltinID,
   case RISCV::BI__builtin_pulp_spr_read_vol:
   case RISCV::BI__builtin_pulp_spr_write:
     return SemaBuiltinConstantArgRange(TheCall, 0, 0, 4091);
+  // SSR configuration: data mover in range [0..31], 31 addresses all of them
+  case RISCV::BI__builtin_ssr_setup_1d_r:
+  case RISCV::BI__builtin_ssr_setup_1d_w:
+    return SemaBuiltinConstantArgRange(TheCall, 0, 0, 31);
+  // SSR pointer: data mover and dimension in range [0..3]
+  case RISCV::BI__builtin_ssr_read_imm:
+  case RISCV::BI__builtin_ssr_write_imm:
+    return SemaBuiltinConstantArgRange(TheCall, 0, 0, 31) ||
+           SemaBuiltinConstantArgRange(TheCall, 1, 0, 3);
+  // SSR data register: one of the three streamers ft0-ft2
+  case RISCV::BI__builtin_ssr_push:
+  case RISCV::BI__builtin_ssr_pop:
+  case RISCV::BI__builtin_ssr_barrier:
+    return SemaBuiltinConstantArgRange(TheCall, 0, 0, 2);
   }
 
   if (NormArgNum) {
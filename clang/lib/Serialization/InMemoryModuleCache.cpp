@@ -12,7 +12,7 @@
 using namespace clang;
 
 InMemoryModuleCache::State
-InMemoryModuleCache::getPCMState(llvm::StringRef Filename) const {
+InMemoryModuleCache::getPCMStateLocked(llvm::StringRef Filename) const {
   auto I = PCMs.find(Filename);
   if (I == PCMs.end())
     return Unknown;
@@ -21,20 +21,42 @@ InMemoryModuleCache::getPCMState(llvm::StringRef Filename) const {
   return I->second.Buffer ? Tentative : ToBuild;
 }
 
+InMemoryModuleCache::State
+InMemoryModuleCache::getPCMState(llvm::StringRef Filename) const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return getPCMStateLocked(Filename);
+}
+
 llvm::MemoryBuffer &
 InMemoryModuleCache::addPCM(llvm::StringRef Filename,
                             std::unique_ptr<llvm::MemoryBuffer> Buffer) {
-  auto Insertion = PCMs.insert(std::make_pair(Filename, std::move(Buffer)));
-  assert(Insertion.second && "Already has a PCM");
-  return *Insertion.first->second.Buffer;
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto Insertion = PCMs.try_emplace(Filename);
+  auto &PCM = Insertion.first->second;
+  if (Insertion.second) {
+    PCM.Buffer = std::move(Buffer);
+    return *PCM.Buffer;
+  }
+
+  // Another thread read the PCM first.  If it was dropped since, the buffer
+  // is out of date and the caller will notice; keep it alive without making
+  // it visible to others.
+  if (PCM.Buffer)
+    return *PCM.Buffer;
+  DroppedBuffers.push_back(std::move(Buffer));
+  return *DroppedBuffers.back();
 }
 
 llvm::MemoryBuffer &
 InMemoryModuleCache::addBuiltPCM(llvm::StringRef Filename,
                                  std::unique_ptr<llvm::MemoryBuffer> Buffer) {
+  std::lock_guard<std::mutex> Lock(Mutex);
   auto &PCM = PCMs[Filename];
   assert(!PCM.IsFinal && "Trying to override finalized PCM?");
-  assert(!PCM.Buffer && "Trying to override tentative PCM?");
+  // Only another thread can still have a tentative buffer while this one was
+  // built; it is replaced.
+  if (PCM.Buffer)
+    DroppedBuffers.push_back(std::move(PCM.Buffer));
   PCM.Buffer = std::move(Buffer);
   PCM.IsFinal = true;
   return *PCM.Buffer;
@@ -42,6 +64,7 @@ InMemoryModuleCache::addBuiltPCM(llvm::StringRef Filename,
 
 llvm::MemoryBuffer *
 InMemoryModuleCache::lookupPCM(llvm::StringRef Filename) const {
+  std::lock_guard<std::mutex> Lock(Mutex);
   auto I = PCMs.find(Filename);
   if (I == PCMs.end())
     return nullptr;
@@ -57,24 +80,67 @@ bool InMemoryModuleCache::shouldBuildPCM(llvm::StringRef Filename) const {
 }
 
 bool InMemoryModuleCache::tryToDropPCM(llvm::StringRef Filename) {
+  std::lock_guard<std::mutex> Lock(Mutex);
   auto I = PCMs.find(Filename);
   assert(I != PCMs.end() && "PCM to remove is unknown...");
 
   auto &PCM = I->second;
-  assert(PCM.Buffer && "PCM to remove is scheduled to be built...");
-
   if (PCM.IsFinal)
     return true;
 
-  PCM.Buffer.reset();
+  // Another thread may have dropped it already.
+  if (PCM.Buffer)
+    DroppedBuffers.push_back(std::move(PCM.Buffer));
   return false;
 }
 
 void InMemoryModuleCache::finalizePCM(llvm::StringRef Filename) {
+  std::lock_guard<std::mutex> Lock(Mutex);
   auto I = PCMs.find(Filename);
   assert(I != PCMs.end() && "PCM to finalize is unknown...");
 
+  // A PCM dropped by another thread is rebuilt and finalized by its builder.
   auto &PCM = I->second;
-  assert(PCM.Buffer && "Trying to finalize a dropped PCM...");
-  PCM.IsFinal = true;
+  if (PCM.Buffer)
+    PCM.IsFinal = true;
+}
+
+InMemoryModuleCache::BuildClaim
+InMemoryModuleCache::claimBuild(llvm::StringRef Filename,
+                                llvm::StringRef Importer) {
+  std::unique_lock<std::mutex> Lock(Mutex);
+  if (Building.insert(Filename).second) {
+    if (!Importer.empty())
+      BlockedOn[Importer] = Filename.str();
+    return BuildClaimed;
+  }
+
+  // Waiting for a build that waits for the importer would never end.
+  llvm::StringRef Next = Filename;
+  for (size_t Steps = 0, E = BlockedOn.size(); Steps <= E; ++Steps) {
+    auto I = BlockedOn.find(Next);
+    if (I == BlockedOn.end())
+      break;
+    Next = I->second;
+    if (Next == Importer)
+      return BuildCycle;
+  }
+
+  if (!Importer.empty())
+    BlockedOn[Importer] = Filename.str();
+  BuildDone.wait(Lock, [&] { return !Building.count(Filename); });
+  if (!Importer.empty())
+    BlockedOn.erase(Importer);
+  return BuildWaited;
+}
+
+void InMemoryModuleCache::releaseBuild(llvm::StringRef Filename,
+                                       llvm::StringRef Importer) {
+  {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Building.erase(Filename);
+    if (!Importer.empty())
+      BlockedOn.erase(Importer);
+  }
+  BuildDone.notify_all();
 }
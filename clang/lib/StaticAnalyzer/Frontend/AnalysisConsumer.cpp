@@ -35,6 +35,7 @@
 #include "clang/StaticAnalyzer/Core/PathSensitive/ExprEngine.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
@@ -341,6 +342,9 @@ private:
 
   /// Check if we should skip (not analyze) the given function.
   AnalysisMode getModeForDecl(Decl *D, AnalysisMode Mode);
+  /// Returns true if \p D belongs to a shard other than the one selected with
+  /// 'shard-index'.
+  bool isInOtherShard(const Decl *D);
   void runAnalysisOnTranslationUnit(ASTContext &C);
 
   /// Print \p S to stderr if \c Opts->AnalyzerDisplayProgress is set.
@@ -485,9 +489,13 @@ static bool isBisonFile(ASTContext &C) {
 void AnalysisConsumer::runAnalysisOnTranslationUnit(ASTContext &C) {
   BugReporter BR(*Mgr);
   TranslationUnitDecl *TU = C.getTranslationUnitDecl();
+  // When the analysis is split into shards, the checks on the whole
+  // translation unit only run in the first one.
+  const bool IsFirstShard = Opts->ShardCount <= 1 || Opts->ShardIndex == 0;
   if (SyntaxCheckTimer)
     SyntaxCheckTimer->startTimer();
-  checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
+  if (IsFirstShard)
+    checkerMgr->runCheckersOnASTDecl(TU, *Mgr, BR);
   if (SyntaxCheckTimer)
     SyntaxCheckTimer->stopTimer();
 
@@ -514,7 +522,8 @@ void AnalysisConsumer::runAnalysisOnTranslationUnit(ASTContext &C) {
     HandleDeclsCallGraph(LocalTUDeclsSize);
 
   // After all decls handled, run checkers on the entire TranslationUnit.
-  checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
+  if (IsFirstShard)
+    checkerMgr->runCheckersOnEndOfTranslationUnit(TU, *Mgr, BR);
 
   BR.FlushReports();
   RecVisitorBR = nullptr;
@@ -613,12 +622,28 @@ std::string AnalysisConsumer::getFunctionName(const Decl *D) {
   return OS.str();
 }
 
+bool AnalysisConsumer::isInOtherShard(const Decl *D) {
+  if (Opts->ShardCount <= 1)
+    return false;
+  std::string Name = getFunctionName(D);
+  // Declarations without a body to analyze are cheap to check, leave them to
+  // the first shard.
+  if (Name.empty())
+    return Opts->ShardIndex != 0;
+  // Use a hash that is stable across invocations, so that every declaration
+  // ends up in exactly one of the shards.
+  return llvm::djbHash(Name) % Opts->ShardCount != Opts->ShardIndex;
+}
+
 AnalysisConsumer::AnalysisMode
 AnalysisConsumer::getModeForDecl(Decl *D, AnalysisMode Mode) {
   if (!Opts->AnalyzeSpecificFunction.empty() &&
       getFunctionName(D) != Opts->AnalyzeSpecificFunction)
     return AM_None;
 
+  if (isInOtherShard(D))
+    return AM_None;
+
   // Unless -analyze-all is specified, treat decls differently depending on
   // where they came from:
   // - Main source file: run both path-sensitive and non-path-sensitive checks.
@@ -0,0 +1,41 @@
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -verify=shard0,shard1 %s
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -verify=shard0 %s \
+// RUN:   -analyzer-config shard-count=2,shard-index=0
+// RUN: %clang_analyze_cc1 -analyzer-checker=core -verify=shard1 %s \
+// RUN:   -analyzer-config shard-count=2,shard-index=1
+
+// RUN: not %clang_analyze_cc1 -analyzer-checker=core %s \
+// RUN:   -analyzer-config shard-count=0 \
+// RUN:   2>&1 | FileCheck %s -check-prefix=CHECK-COUNT
+// CHECK-COUNT: (frontend): invalid input for analyzer-config option
+// CHECK-COUNT-SAME:        'shard-count', that expects a positive value
+
+// RUN: not %clang_analyze_cc1 -analyzer-checker=core %s \
+// RUN:   -analyzer-config shard-count=2,shard-index=2 \
+// RUN:   2>&1 | FileCheck %s -check-prefix=CHECK-INDEX
+// CHECK-INDEX: (frontend): invalid input for analyzer-config option
+// CHECK-INDEX-SAME:        'shard-index', that expects an unsigned, less
+// CHECK-INDEX-SAME:        than 'shard-count', value
+
+// Top-level functions are assigned to shards by a hash of their name, every
+// function is analyzed in exactly one of them.
+
+int f1(int x) {
+  int z = 0;
+  return x / z; // shard0-warning{{Division by zero}}
+}
+
+int f2(int x) {
+  int z = 0;
+  return x / z; // shard1-warning{{Division by zero}}
+}
+
+int f3(int x) {
+  int z = 0;
+  return x / z; // shard0-warning{{Division by zero}}
+}
+
+int f4(int x) {
+  int z = 0;
+  return x / z; // shard1-warning{{Division by zero}}
+}
@@ -0,0 +1,10 @@
+// RUN: %clang -march=rv32ima_xmempool1 -S -emit-llvm -o - %s \
+// RUN:  | FileCheck %s --check-prefix=CHECK --check-prefix=CHECK-RISCV
+
+#include <stdint.h>
+
+// CHECK-LABEL: test_mempool_barrier
+void test_mempool_barrier(uint32_t *counters, uint32_t *wake_up) {
+  // CHECK-RISCV: call void @llvm.riscv.mempool.barrier(i8* {{.*}}, i8* {{.*}}, i32 4, i32 16, i32 4)
+  __builtin_mempool_barrier(counters, wake_up, 4, 16, 4);
+}
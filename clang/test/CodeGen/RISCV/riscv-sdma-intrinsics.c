@@ -14,6 +14,14 @@ uint32_t test_sdma_start_twod(uint64_t src, uint64_t dst, uint32_t size,
   // CHECK-RISCV: call i32 @llvm.riscv.sdma.start.twod
   return __builtin_sdma_start_twod(src, dst, size, sstrd, dstrd, nreps, cfg);
 }
+// CHECK-LABEL: test_sdma_start_threed
+uint32_t test_sdma_start_threed(uint64_t src, uint64_t dst, uint32_t size,
+    uint32_t sstrd, uint32_t dstrd, uint32_t nreps, uint32_t sstrd2,
+    uint32_t dstrd2, uint32_t nreps2, uint32_t cfg) {
+  // CHECK-RISCV: call i32 @llvm.riscv.sdma.start.threed
+  return __builtin_sdma_start_threed(src, dst, size, sstrd, dstrd, nreps,
+                                     sstrd2, dstrd2, nreps2, cfg);
+}
 // CHECK-LABEL: test_sdma_stat
 uint32_t test_sdma_stat(uint32_t tid) {
   // CHECK-RISCV: call i32 @llvm.riscv.sdma.stat
@@ -24,3 +32,8 @@ void test_sdma_wait_for_idle(void) {
   // CHECK-RISCV: call void @llvm.riscv.sdma.wait.for.idle()
   __builtin_sdma_wait_for_idle();
 }
+// CHECK-LABEL: test_sdma_wait
+void test_sdma_wait(uint32_t tid) {
+  // CHECK-RISCV: call void @llvm.riscv.sdma.wait(i32
+  __builtin_sdma_wait(tid);
+}
@@ -0,0 +1,45 @@
+// RUN: %clang -march=rv32ifd_xssr1_xfrep1_xdma1 -O1 -S -emit-llvm -o - %s \
+// RUN:  | FileCheck %s
+// RUN: not %clang -march=rv32ifd -fsyntax-only -DNO_FREP %s 2>&1 \
+// RUN:  | FileCheck %s --check-prefix=NOFREP
+
+#ifdef NO_FREP
+// NOFREP: error: '#pragma clang loop frep' requires the Xfrep extension
+void test_frep_unsupported(double *a, int n) {
+#pragma clang loop frep(enable)
+  for (int i = 0; i < n; ++i)
+    a[i] += 1.0;
+}
+#else
+#include <snitch_intrinsics.h>
+
+// CHECK-LABEL: @test_frep_pragma
+// CHECK: call void @llvm.riscv.frep.infer()
+void test_frep_pragma(double *a, int n) {
+  SNITCH_FREP_LOOP
+  for (int i = 0; i < n; ++i)
+    a[i] += 1.0;
+}
+
+// CHECK-LABEL: @test_ssr_stream_2d
+// CHECK: call void @llvm.riscv.ssr.setup.bound.stride.2d(i32 0, i32 3, i32 -24)
+// CHECK: call void @llvm.riscv.ssr.setup.bound.stride.1d(i32 0, i32 7, i32 8)
+// CHECK: call void @llvm.riscv.ssr.read(i32 0, i32 1,
+void test_ssr_stream_2d(double *a) {
+  snitch_ssr_stream_t s = snitch_ssr_stream_2d(SNITCH_SSR_DM0, 8, 4, 8, 32);
+  snitch_ssr_configure(s);
+  snitch_ssr_read(s, a);
+}
+
+// CHECK-LABEL: @test_ssr_repeat
+// CHECK: call void @llvm.riscv.ssr.setup.repetition(i32 1, i32 2)
+void test_ssr_repeat(void) { snitch_ssr_repeat(SNITCH_SSR_DM1, 3); }
+
+// CHECK-LABEL: @test_dma_1d
+// CHECK: call i32 @llvm.riscv.sdma.start.oned(
+// CHECK: call void @llvm.riscv.sdma.wait.for.idle()
+void test_dma_1d(void *dst, const void *src, uint32_t size) {
+  snitch_dma_start_1d(dst, src, size);
+  snitch_dma_wait_all();
+}
+#endif
@@ -0,0 +1,16 @@
+// RUN: %clang_cc1 -triple riscv32 -target-feature +f -target-feature +d \
+// RUN:   -target-feature +experimental-zfh -target-feature +xfalthalf \
+// RUN:   -target-abi ilp32d -emit-llvm -o - %s | FileCheck %s
+
+// CHECK-LABEL: define{{.*}} bfloat @test_bf16_arg(bfloat %a, bfloat %b)
+__bf16 test_bf16_arg(__bf16 a, __bf16 b) {
+  // CHECK: ret bfloat
+  return b;
+}
+
+// CHECK-LABEL: define{{.*}} void @test_bf16_copy(bfloat* %dst, bfloat* %src)
+void test_bf16_copy(__bf16 *dst, __bf16 *src) {
+  // CHECK: [[V:%.*]] = load bfloat, bfloat* {{.*}}, align 2
+  // CHECK: store bfloat [[V]], bfloat* {{.*}}, align 2
+  *dst = *src;
+}
@@ -0,0 +1,31 @@
+// RUN: %clang_cc1 -O2 -disable-llvm-passes -emit-llvm -o - -triple x86_64-apple-darwin10 %s | FileCheck %s -check-prefix=INLINE
+// RUN: %clang_cc1 -O2 -fno-inline -disable-llvm-passes -emit-llvm -o - -triple x86_64-apple-darwin10 %s | FileCheck %s -check-prefix=NOINLINE
+// RUN: %clang_cc1 -O2 -fno-inline -flto -disable-llvm-passes -emit-llvm -o - -triple x86_64-apple-darwin10 %s | FileCheck %s -check-prefix=LTO
+
+// Ensure that clang doesn't emit the bodies of available_externally functions
+// which can't be inlined, unless they may still be inlined during LTO.
+int x;
+
+inline void f0(int y) { x = y; }
+
+inline void __attribute__((noinline)) f1(int y) { x = y; }
+
+inline void __attribute__((always_inline)) f2(int y) { x = y; }
+
+void test() {
+  f0(1);
+  f1(2);
+  f2(3);
+}
+
+// INLINE-DAG: define available_externally void @f0(
+// INLINE-DAG: declare void @f1(
+// INLINE-DAG: define available_externally void @f2(
+
+// NOINLINE-DAG: declare void @f0(
+// NOINLINE-DAG: declare void @f1(
+// NOINLINE-DAG: define available_externally void @f2(
+
+// LTO-DAG: define available_externally void @f0(
+// LTO-DAG: define available_externally void @f1(
+// LTO-DAG: define available_externally void @f2(
@@ -0,0 +1,14 @@
+// RUN: %clangxx -S -ftime-trace -ftime-trace-memory -ftime-trace-granularity=0 -o %T/check-time-trace-memory %s
+// RUN: cat %T/check-time-trace-memory.json \
+// RUN:   | %python -c 'import json, sys; json.dump(json.loads(sys.stdin.read()), sys.stdout, sort_keys=True, indent=2)' \
+// RUN:   | FileCheck %s
+
+// CHECK:      "traceEvents": [
+// CHECK:      "args":
+// CHECK:      "malloc delta": {{-?[0-9]+}}
+// CHECK-NEXT: "peak rss delta": {{[0-9]+}}
+// CHECK:      "name": "Frontend"
+
+int main() {
+  return 0;
+}
@@ -0,0 +1,22 @@
+// REQUIRES: riscv-registered-target
+
+/// Check that the HERO device defaults to a PULP cluster.
+// RUN: %clang -### -no-canonical-prefixes -c -target x86_64-unknown-linux-gnu \
+// RUN:   -fopenmp=libomp -fopenmp-targets=riscv32-hero-unknown-elf %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=CHK-PULP %s
+
+// CHK-PULP: clang{{.*}} "-triple" "riscv32-hero-unknown-elf"
+// CHK-PULP-SAME: "+xpulpv2"
+// CHK-PULP-SAME: "-fopenmp-is-device"
+
+/// Check that -Xopenmp-target -mcpu=snitch selects a Snitch cluster.
+// RUN: %clang -### -no-canonical-prefixes -c -target x86_64-unknown-linux-gnu \
+// RUN:   -fopenmp=libomp -fopenmp-targets=riscv32-hero-unknown-elf \
+// RUN:   -Xopenmp-target -mcpu=snitch %s 2>&1 \
+// RUN:   | FileCheck -check-prefix=CHK-SNITCH %s
+
+// CHK-SNITCH: clang{{.*}} "-triple" "riscv32-hero-unknown-elf"
+// CHK-SNITCH-SAME: "-target-cpu" "snitch"
+// CHK-SNITCH-NOT: "+xpulpv2"
+// CHK-SNITCH-SAME: "+xssr"
+// CHK-SNITCH-SAME: "-fopenmp-is-device"
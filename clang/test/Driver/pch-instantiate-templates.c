@@ -9,5 +9,10 @@
 // RUN: %clang -### -x c-header %s -o %t/foo.pch 2>&1 | FileCheck -check-prefix=GCC_DEFAULT %s
 // RUN: %clang -### -x c-header %s -o %t/foo.pch -fpch-instantiate-templates 2>&1 | FileCheck -check-prefix=GCC_DEFAULT_ENABLE %s
 
+// RUN: %clang -### -x c-header %s -o %t/foo.pch -fpch-codegen 2>&1 | FileCheck -check-prefix=GCC_CODEGEN %s
+// RUN: %clang -### -x c-header %s -o %t/foo.pch -fpch-codegen -fno-pch-instantiate-templates 2>&1 | FileCheck -check-prefix=GCC_CODEGEN_DISABLE %s
+
 // GCC_DEFAULT-NOT: "-fpch-instantiate-templates"
 // GCC_DEFAULT_ENABLE: "-fpch-instantiate-templates"
+// GCC_CODEGEN: "-fpch-instantiate-templates"
+// GCC_CODEGEN_DISABLE-NOT: "-fpch-instantiate-templates"
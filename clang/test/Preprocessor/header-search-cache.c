@@ -0,0 +1,22 @@
+// RUN: rm -rf %t && mkdir -p %t/a %t/b
+// RUN: echo 'int in_b;' > %t/b/foo.h
+// RUN: touch -m -a -t 201101010000 %t/a %t/b
+
+// Lookups of foo.h in a are skipped, and the listings of both directories
+// are cached.
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b \
+// RUN:   -fheader-search-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck %s -check-prefix=CHECK-B
+// RUN: ls %t/cache | count 2
+// CHECK-B: int in_b;
+// CHECK-B: 1 lookups skipped due to directory listings.
+
+// Adding foo.h to a invalidates its cached listing.
+// RUN: echo 'int in_a;' > %t/a/foo.h
+// RUN: %clang_cc1 -E -print-stats -I %t/a -I %t/b \
+// RUN:   -fheader-search-cache-path=%t/cache %s -o - 2>&1 \
+// RUN:   | FileCheck %s -check-prefix=CHECK-A
+// CHECK-A: int in_a;
+// CHECK-A: 0 lookups skipped due to directory listings.
+
+#include "foo.h"
@@ -1290,6 +1290,42 @@ void is_trivially_copyable2()
   int t45[F(__is_trivially_copyable(const volatile void))];
 }
 
+struct [[clang::trivial_abi]] TrivialAbiMovable {
+  TrivialAbiMovable(TrivialAbiMovable &&);
+  ~TrivialAbiMovable();
+  int *p;
+};
+
+struct NotRelocatable {
+  NotRelocatable(NotRelocatable &&);
+  ~NotRelocatable();
+};
+
+struct MemberNotRelocatable {
+  NotRelocatable n;
+};
+
+void is_trivially_relocatable()
+{
+  int t01[T(__is_trivially_relocatable(int))];
+  int t02[T(__is_trivially_relocatable(const int))];
+  int t03[T(__is_trivially_relocatable(int *))];
+  int t04[T(__is_trivially_relocatable(Enum))];
+  int t05[T(__is_trivially_relocatable(IntAr))];
+  int t06[T(__is_trivially_relocatable(TrivialStruct))];
+  int t07[T(__is_trivially_relocatable(TrivialAbiMovable))];
+  int t08[T(__is_trivially_relocatable(TrivialAbiMovable[4]))];
+
+  int t20[F(__is_trivially_relocatable(void))];
+  int t22[F(__is_trivially_relocatable(NotRelocatable))];
+  int t23[F(__is_trivially_relocatable(MemberNotRelocatable))];
+  int t24[F(__is_trivially_relocatable(HasDest))];
+
+  int t40[T(__is_trivially_relocatable(ACompleteType))];
+  int t41[F(__is_trivially_relocatable(AnIncompleteType))]; // expected-error {{incomplete type}}
+  int t42[F(__is_trivially_relocatable(AnIncompleteType[]))]; // expected-error {{incomplete type}}
+}
+
 struct CStruct {
   int one;
   int two;
@@ -0,0 +1,543 @@
+//===- ClangCompileServer.cpp - Persistent clang compile server -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A long running process that compiles translation units for its clients, so
+// that the contents of the headers and precompiled headers used by a build
+// stay in memory between compile jobs instead of being read again by every
+// clang process.
+//
+//   clang-compile-server -listen=<socket>
+//   clang-compile-server -connect=<socket> -- clang -c foo.c -o foo.o
+//
+// The client sends its working directory and the clang command line to the
+// server, prints the diagnostics of the job and exits with its status, so it
+// can be used as a compiler launcher. Jobs the server can't run in process
+// (more than one job, output to stdout, -mllvm, plugins, a different clang
+// than the one next to the server, ...) are run locally by the client. The
+// environment of the client is not forwarded.
+//
+// The server runs one job at a time. The contents of the files are checked
+// against the file system once per job, and dropped as soon as their size,
+// modification time or identity changes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/Stack.h"
+#include "clang/CodeGen/ObjectFilePCHContainerOperations.h"
+#include "clang/Driver/Compilation.h"
+#include "clang/Driver/Driver.h"
+#include "clang/Driver/Job.h"
+#include "clang/Driver/Options.h"
+#include "clang/Driver/ToolChain.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "clang/FrontendTool/Utils.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/CrashRecoveryContext.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace clang;
+using namespace llvm;
+
+static cl::OptionCategory ServerCategory("clang-compile-server options");
+
+static cl::opt<std::string>
+    ListenPath("listen", cl::desc("Serve compile jobs on the socket <path>"),
+               cl::value_desc("path"), cl::cat(ServerCategory));
+
+static cl::opt<std::string> ConnectPath(
+    "connect",
+    cl::desc("Send the compile job after -- to the server listening on <path>"),
+    cl::value_desc("path"), cl::cat(ServerCategory));
+
+static cl::opt<unsigned> MaxCacheSize(
+    "max-cache-size",
+    cl::desc("Maximum size in MiB of the file contents kept by the server"),
+    cl::init(1024), cl::cat(ServerCategory));
+
+static cl::list<std::string> CompileCommand(cl::Positional,
+                                            cl::desc("-- <clang> <args>..."),
+                                            cl::cat(ServerCategory));
+
+namespace {
+
+/// The status of a job, sent back to the client.
+enum JobStatus : uint32_t {
+  JobSucceeded = 0,
+  JobFailed = 1,
+  /// The job can't be run by the server, the client runs it locally.
+  JobDeclined = 2,
+};
+
+/// A file whose contents are owned by the cache.
+class CachedFile : public vfs::File {
+public:
+  CachedFile(vfs::Status Stat, MemoryBufferRef Contents)
+      : Stat(std::move(Stat)), Contents(Contents) {}
+
+  ErrorOr<vfs::Status> status() override { return Stat; }
+  ErrorOr<std::string> getName() override { return Stat.getName().str(); }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>>
+  getBuffer(const Twine &Name, int64_t FileSize, bool RequiresNullTerminator,
+            bool IsVolatile) override {
+    return MemoryBuffer::getMemBuffer(Contents.getBuffer(), Name.str(),
+                                      RequiresNullTerminator);
+  }
+
+  std::error_code close() override { return std::error_code(); }
+
+private:
+  vfs::Status Stat;
+  MemoryBufferRef Contents;
+};
+
+/// A file system that keeps the status and the contents of the files used by
+/// the compile jobs. Each entry is checked against the underlying file system
+/// the first time it is used by a job.
+class CachingFileSystem : public vfs::ProxyFileSystem {
+public:
+  CachingFileSystem(IntrusiveRefCntPtr<vfs::FileSystem> FS, uint64_t MaxBytes)
+      : ProxyFileSystem(std::move(FS)), MaxBytes(MaxBytes) {}
+
+  /// Start a new job, after which every entry is checked again.
+  void startJob() { ++Generation; }
+
+  ErrorOr<vfs::Status> status(const Twine &Path) override {
+    Entry &E = lookup(Path);
+    if (!E.Stat)
+      return E.Stat.getError();
+    return vfs::Status::copyWithNewName(*E.Stat, Path.str());
+  }
+
+  ErrorOr<std::unique_ptr<vfs::File>>
+  openFileForRead(const Twine &Path) override {
+    Entry &E = lookup(Path);
+    if (!E.Stat)
+      return E.Stat.getError();
+    if (!E.Contents) {
+      auto F = getUnderlyingFS().openFileForRead(Path);
+      if (!F || E.Stat->isDirectory() ||
+          CachedBytes + E.Stat->getSize() > MaxBytes)
+        return F;
+      // Use the status of the open file, so that it describes the contents.
+      auto Stat = (*F)->status();
+      if (!Stat)
+        return F;
+      // Read a private copy, later changes to the file must not show through.
+      auto Buffer = (*F)->getBuffer(Stat->getName(), Stat->getSize(),
+                                    /*RequiresNullTerminator=*/true,
+                                    /*IsVolatile=*/true);
+      if (!Buffer)
+        return Buffer.getError();
+      E.Stat = std::move(*Stat);
+      E.Contents = std::move(*Buffer);
+      CachedBytes += E.Contents->getBufferSize();
+    }
+    return std::unique_ptr<vfs::File>(new CachedFile(
+        vfs::Status::copyWithNewName(*E.Stat, Path.str()),
+        E.Contents->getMemBufferRef()));
+  }
+
+private:
+  struct Entry {
+    /// The job in which the entry was last checked.
+    unsigned Generation = 0;
+    ErrorOr<vfs::Status> Stat = std::error_code();
+    std::unique_ptr<MemoryBuffer> Contents;
+  };
+
+  static bool isSameFile(const vfs::Status &A, const vfs::Status &B) {
+    return A.getUniqueID() == B.getUniqueID() && A.getSize() == B.getSize() &&
+           A.getLastModificationTime() == B.getLastModificationTime();
+  }
+
+  Entry &lookup(const Twine &Path) {
+    SmallString<256> AbsPath;
+    Path.toVector(AbsPath);
+    makeAbsolute(AbsPath);
+    Entry &E = Entries[AbsPath];
+    if (E.Generation == Generation)
+      return E;
+    E.Generation = Generation;
+    ErrorOr<vfs::Status> Stat = getUnderlyingFS().status(AbsPath);
+    if (E.Contents && (!Stat || !isSameFile(*Stat, *E.Stat))) {
+      CachedBytes -= E.Contents->getBufferSize();
+      E.Contents.reset();
+    }
+    // Keep the status of the cached contents, which has the same identity.
+    if (!E.Contents)
+      E.Stat = std::move(Stat);
+    return E;
+  }
+
+  StringMap<Entry> Entries;
+  unsigned Generation = 1;
+  uint64_t CachedBytes = 0;
+  uint64_t MaxBytes;
+};
+
+} // end anonymous namespace
+
+//===----------------------------------------------------------------------===//
+// Protocol
+//
+// A request is a list of strings: the working directory of the client, then
+// the clang command line. A response is the status of the job, then its
+// diagnostics. Strings and lists are prefixed with their 32-bit little endian
+// size.
+//===----------------------------------------------------------------------===//
+
+static bool writeAll(int FD, StringRef Data) {
+  while (!Data.empty()) {
+    ssize_t N = ::write(FD, Data.data(), Data.size());
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Data = Data.drop_front(N);
+  }
+  return true;
+}
+
+static bool readAll(int FD, char *Buf, size_t Size) {
+  while (Size) {
+    ssize_t N = ::read(FD, Buf, Size);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Buf += N;
+    Size -= N;
+  }
+  return true;
+}
+
+static bool writeU32(int FD, uint32_t V) {
+  char Buf[4];
+  support::endian::write32le(Buf, V);
+  return writeAll(FD, StringRef(Buf, sizeof(Buf)));
+}
+
+static bool readU32(int FD, uint32_t &V) {
+  char Buf[4];
+  if (!readAll(FD, Buf, sizeof(Buf)))
+    return false;
+  V = support::endian::read32le(Buf);
+  return true;
+}
+
+static bool writeString(int FD, StringRef S) {
+  return writeU32(FD, S.size()) && writeAll(FD, S);
+}
+
+static bool readString(int FD, std::string &S) {
+  uint32_t Size;
+  if (!readU32(FD, Size))
+    return false;
+  S.resize(Size);
+  return readAll(FD, &S[0], Size);
+}
+
+static int connectTo(StringRef Path, bool Listen) {
+  sockaddr_un Addr;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  memcpy(Addr.sun_path, Path.data(), Path.size());
+
+  int FD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (FD < 0)
+    return -1;
+  int Ret;
+  if (Listen)
+    Ret = ::bind(FD, (sockaddr *)&Addr, sizeof(Addr)) || ::listen(FD, 64);
+  else
+    Ret = ::connect(FD, (sockaddr *)&Addr, sizeof(Addr));
+  if (Ret) {
+    ::close(FD);
+    return -1;
+  }
+  return FD;
+}
+
+//===----------------------------------------------------------------------===//
+// Server
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+class CompileServer {
+public:
+  CompileServer(StringRef ClangDir, uint64_t MaxCacheBytes)
+      : ClangDir(ClangDir), PCHOps(std::make_shared<PCHContainerOperations>()),
+        FS(new CachingFileSystem(vfs::getRealFileSystem(), MaxCacheBytes)) {
+    PCHOps->registerWriter(std::make_unique<ObjectFilePCHContainerWriter>());
+    PCHOps->registerReader(std::make_unique<ObjectFilePCHContainerReader>());
+  }
+
+  /// Run the job described by the working directory \p Cwd and the clang
+  /// command line \p Args, writing its diagnostics to \p OS.
+  JobStatus run(StringRef Cwd, ArrayRef<std::string> Args, raw_ostream &OS);
+
+private:
+  JobStatus runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                          raw_ostream &OS);
+
+  /// The real path of the directory of the clang the server is built with.
+  std::string ClangDir;
+  std::shared_ptr<PCHContainerOperations> PCHOps;
+  IntrusiveRefCntPtr<CachingFileSystem> FS;
+};
+
+} // end anonymous namespace
+
+JobStatus CompileServer::run(StringRef Cwd, ArrayRef<std::string> Args,
+                             raw_ostream &OS) {
+  if (Args.empty())
+    return JobDeclined;
+
+  // The jobs are compiled by the frontend linked into the server, so only
+  // take the ones meant for the clang installed next to it.
+  SmallString<256> Dir;
+  if (sys::fs::real_path(sys::path::parent_path(Args[0]), Dir) ||
+      Dir != ClangDir)
+    return JobDeclined;
+
+  // Relative output paths are resolved against the process working directory.
+  if (FS->setCurrentWorkingDirectory(Cwd))
+    return JobDeclined;
+  FS->startJob();
+
+  std::vector<const char *> Argv;
+  for (const std::string &Arg : Args)
+    Argv.push_back(Arg.c_str());
+
+  driver::ParsedClangName NameParts =
+      driver::ToolChain::getTargetAndModeFromProgramName(Args[0]);
+  if (!NameParts.TargetPrefix.empty())
+    return JobDeclined;
+
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  unsigned MissingArgIndex, MissingArgCount;
+  opt::InputArgList ParsedArgs = driver::getDriverOptTable().ParseArgs(
+      makeArrayRef(Argv).slice(1), MissingArgIndex, MissingArgCount);
+  ParseDiagnosticArgs(*DiagOpts, ParsedArgs);
+  TextDiagnosticPrinter DiagPrinter(OS, &*DiagOpts);
+  DiagnosticsEngine Diags(new DiagnosticIDs(), &*DiagOpts, &DiagPrinter,
+                          /*ShouldOwnClient=*/false);
+
+  driver::Driver TheDriver(Args[0], sys::getDefaultTargetTriple(), Diags,
+                           "clang LLVM compiler", FS);
+  TheDriver.setTargetAndMode(NameParts);
+  std::unique_ptr<driver::Compilation> C(TheDriver.BuildCompilation(Argv));
+  if (!C || Diags.hasErrorOccurred())
+    return JobFailed;
+
+  // Anything but a single compile job, such as a link, is run by the client.
+  const driver::JobList &Jobs = C->getJobs();
+  if (Jobs.size() != 1 || !isa<driver::Command>(*Jobs.begin()))
+    return JobDeclined;
+  const driver::Command &Cmd = *Jobs.begin();
+  if (StringRef(Cmd.getCreator().getName()) != "clang")
+    return JobDeclined;
+
+  auto Invocation = std::make_shared<CompilerInvocation>();
+  if (!CompilerInvocation::CreateFromArgs(*Invocation, Cmd.getArguments(),
+                                          Diags, Argv[0]))
+    return JobFailed;
+
+  // The options of LLVM and plugins are global to the process, and the
+  // standard streams are those of the server.
+  const FrontendOptions &FEOpts = Invocation->getFrontendOpts();
+  if (!FEOpts.LLVMArgs.empty() || !FEOpts.Plugins.empty() ||
+      FEOpts.OutputFile == "-" || FEOpts.TimeTrace)
+    return JobDeclined;
+  for (const FrontendInputFile &Input : FEOpts.Inputs)
+    if (Input.isFile() && Input.getFile() == "-")
+      return JobDeclined;
+
+  // The server outlives its jobs.
+  Invocation->getFrontendOpts().DisableFree = false;
+  Invocation->getCodeGenOpts().DisableFree = false;
+
+  JobStatus Status = JobDeclined;
+  CrashRecoveryContext CRC;
+  if (!CRC.RunSafely(
+          [&] { Status = runInvocation(std::move(Invocation), OS); }))
+    return JobDeclined;
+  return Status;
+}
+
+JobStatus
+CompileServer::runInvocation(std::shared_ptr<CompilerInvocation> Invocation,
+                             raw_ostream &OS) {
+  CompilerInstance Clang(PCHOps);
+  Clang.setInvocation(std::move(Invocation));
+  Clang.createDiagnostics(
+      new TextDiagnosticPrinter(OS, &Clang.getDiagnosticOpts()),
+      /*ShouldOwnClient=*/true);
+  if (!Clang.hasDiagnostics())
+    return JobFailed;
+  // A new file manager per job, so that it only sees the files as they are
+  // now, on top of the persistent cache of their contents.
+  Clang.createFileManager(FS);
+  return ExecuteCompilerInvocation(&Clang) ? JobSucceeded : JobFailed;
+}
+
+static int runServer(StringRef Path, StringRef ClangDir) {
+  // Replace the socket of a previous server.
+  sys::fs::file_status Stat;
+  if (!sys::fs::status(Path, Stat) &&
+      Stat.type() == sys::fs::file_type::socket_file)
+    sys::fs::remove(Path);
+  int Listener = connectTo(Path, /*Listen=*/true);
+  if (Listener < 0) {
+    errs() << "error: cannot listen on '" << Path
+           << "': " << std::strerror(errno) << "\n";
+    return 1;
+  }
+
+  // A client going away must not kill the server.
+  ::signal(SIGPIPE, SIG_IGN);
+  CrashRecoveryContext::Enable();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+  InitializeAllAsmParsers();
+
+  CompileServer Server(ClangDir, uint64_t(MaxCacheSize) << 20);
+  for (;;) {
+    int FD = ::accept(Listener, nullptr, nullptr);
+    if (FD < 0) {
+      if (errno == EINTR)
+        continue;
+      errs() << "error: cannot accept connection: " << std::strerror(errno)
+             << "\n";
+      return 1;
+    }
+
+    uint32_t NumStrings;
+    std::vector<std::string> Request;
+    bool Ok = readU32(FD, NumStrings) && NumStrings;
+    for (uint32_t I = 0; Ok && I < NumStrings; ++I) {
+      Request.emplace_back();
+      Ok = readString(FD, Request.back());
+    }
+    if (Ok) {
+      std::string Diagnostics;
+      raw_string_ostream OS(Diagnostics);
+      JobStatus Status =
+          Server.run(Request[0], makeArrayRef(Request).slice(1), OS);
+      OS.flush();
+      writeU32(FD, Status) && writeString(FD, Diagnostics);
+    }
+    ::close(FD);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Client
+//===----------------------------------------------------------------------===//
+
+static int runLocally(ArrayRef<std::string> Args) {
+  SmallVector<StringRef, 32> Argv(Args.begin(), Args.end());
+  std::string ErrMsg;
+  int Ret = sys::ExecuteAndWait(Args[0], Argv, /*Env=*/None, /*Redirects=*/{},
+                                /*SecondsToWait=*/0, /*MemoryLimit=*/0,
+                                &ErrMsg);
+  if (Ret < 0) {
+    errs() << "error: cannot run '" << Args[0] << "': " << ErrMsg << "\n";
+    return 1;
+  }
+  return Ret;
+}
+
+static int runClient(StringRef Path, std::vector<std::string> Args) {
+  if (Args.empty()) {
+    errs() << "error: no compile command given after --\n";
+    return 1;
+  }
+
+  // The server checks which clang the job is for from its path.
+  if (!sys::path::has_parent_path(Args[0])) {
+    ErrorOr<std::string> Program = sys::findProgramByName(Args[0]);
+    if (!Program) {
+      errs() << "error: cannot find '" << Args[0] << "'\n";
+      return 1;
+    }
+    Args[0] = *Program;
+  }
+  SmallString<256> Program(Args[0]);
+  sys::fs::make_absolute(Program);
+  Args[0] = std::string(Program);
+
+  SmallString<256> Cwd;
+  if (sys::fs::current_path(Cwd))
+    return runLocally(Args);
+
+  int FD = connectTo(Path, /*Listen=*/false);
+  if (FD < 0)
+    return runLocally(Args);
+
+  uint32_t Status;
+  std::string Diagnostics;
+  bool Ok = writeU32(FD, Args.size() + 1) && writeString(FD, Cwd);
+  for (const std::string &Arg : Args)
+    Ok = Ok && writeString(FD, Arg);
+  Ok = Ok && readU32(FD, Status) && readString(FD, Diagnostics);
+  ::close(FD);
+
+  // The job is run locally if the server declined it or went away.
+  if (!Ok || Status == JobDeclined)
+    return runLocally(Args);
+  errs() << Diagnostics;
+  return Status == JobSucceeded ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  noteBottomOfStack();
+  cl::HideUnrelatedOptions(ServerCategory);
+  cl::ParseCommandLineOptions(argc, argv, "clang compile server\n");
+
+  if (ListenPath.empty() == ConnectPath.empty()) {
+    errs() << "error: exactly one of -listen and -connect is required\n";
+    return 1;
+  }
+  if (!ConnectPath.empty())
+    return runClient(ConnectPath, CompileCommand);
+
+  SmallString<256> ClangDir;
+  std::string Self = sys::fs::getMainExecutable(argv[0], (void *)&main);
+  if (sys::fs::real_path(sys::path::parent_path(Self), ClangDir)) {
+    errs() << "error: cannot find the directory of '" << Self << "'\n";
+    return 1;
+  }
+  return runServer(ListenPath, ClangDir);
+}
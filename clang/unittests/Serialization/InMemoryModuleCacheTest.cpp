@@ -10,6 +10,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
 
+#include <thread>
+
 using namespace llvm;
 using namespace clang;
 
@@ -45,11 +47,16 @@ TEST(InMemoryModuleCacheTest, addPCM) {
   EXPECT_FALSE(Cache.isPCMFinal("B"));
   EXPECT_FALSE(Cache.shouldBuildPCM("B"));
 
-#if !defined(NDEBUG) && GTEST_HAS_DEATH_TEST
-  EXPECT_DEATH(Cache.addPCM("B", getBuffer(2)), "Already has a PCM");
-  EXPECT_DEATH(Cache.addBuiltPCM("B", getBuffer(2)),
-               "Trying to override tentative PCM");
-#endif
+  // Another thread reading the same PCM gets the buffer already stored.
+  EXPECT_EQ(RawB, &Cache.addPCM("B", getBuffer(2)));
+  EXPECT_EQ(RawB, Cache.lookupPCM("B"));
+
+  // A PCM built meanwhile replaces the tentative one.
+  auto Built = getBuffer(3);
+  auto *RawBuilt = Built.get();
+  EXPECT_EQ(RawBuilt, &Cache.addBuiltPCM("B", std::move(Built)));
+  EXPECT_EQ(RawBuilt, Cache.lookupPCM("B"));
+  EXPECT_TRUE(Cache.isPCMFinal("B"));
 }
 
 TEST(InMemoryModuleCacheTest, addBuiltPCM) {
@@ -62,9 +69,9 @@ TEST(InMemoryModuleCacheTest, addBuiltPCM) {
   EXPECT_EQ(RawB, Cache.lookupPCM("B"));
   EXPECT_TRUE(Cache.isPCMFinal("B"));
   EXPECT_FALSE(Cache.shouldBuildPCM("B"));
+  EXPECT_EQ(RawB, &Cache.addPCM("B", getBuffer(2)));
 
 #if !defined(NDEBUG) && GTEST_HAS_DEATH_TEST
-  EXPECT_DEATH(Cache.addPCM("B", getBuffer(2)), "Already has a PCM");
   EXPECT_DEATH(Cache.addBuiltPCM("B", getBuffer(2)),
                "Trying to override finalized PCM");
 #endif
@@ -86,12 +93,14 @@ TEST(InMemoryModuleCacheTest, tryToDropPCM) {
   EXPECT_FALSE(Cache.isPCMFinal("B"));
   EXPECT_TRUE(Cache.shouldBuildPCM("B"));
 
-#if !defined(NDEBUG) && GTEST_HAS_DEATH_TEST
-  EXPECT_DEATH(Cache.addPCM("B", getBuffer(2)), "Already has a PCM");
-  EXPECT_DEATH(Cache.tryToDropPCM("B"),
-               "PCM to remove is scheduled to be built");
-  EXPECT_DEATH(Cache.finalizePCM("B"), "Trying to finalize a dropped PCM");
-#endif
+  // Other threads that were reading the dropped PCM cannot bring it back.
+  auto Stale = getBuffer(3);
+  auto *RawStale = Stale.get();
+  EXPECT_EQ(RawStale, &Cache.addPCM("B", std::move(Stale)));
+  EXPECT_FALSE(Cache.tryToDropPCM("B"));
+  Cache.finalizePCM("B");
+  EXPECT_EQ(nullptr, Cache.lookupPCM("B"));
+  EXPECT_TRUE(Cache.shouldBuildPCM("B"));
 
   // Add a new one.
   EXPECT_EQ(RawB2, &Cache.addBuiltPCM("B", std::move(B2)));
@@ -116,4 +125,28 @@ TEST(InMemoryModuleCacheTest, finalizePCM) {
   EXPECT_TRUE(Cache.isPCMFinal("B"));
 }
 
+TEST(InMemoryModuleCacheTest, claimBuild) {
+  InMemoryModuleCache Cache;
+  EXPECT_EQ(InMemoryModuleCache::BuildClaimed, Cache.claimBuild("A", ""));
+
+  // The build of A builds B, which imports A.
+  EXPECT_EQ(InMemoryModuleCache::BuildClaimed, Cache.claimBuild("B", "A"));
+  EXPECT_EQ(InMemoryModuleCache::BuildCycle, Cache.claimBuild("A", "B"));
+  Cache.releaseBuild("B", "A");
+
+  // Another thread waits for the build of A, or builds it again if it comes
+  // too late.
+  std::thread Waiter([&] {
+    auto Claim = Cache.claimBuild("A", "C");
+    EXPECT_NE(InMemoryModuleCache::BuildCycle, Claim);
+    if (Claim == InMemoryModuleCache::BuildClaimed)
+      Cache.releaseBuild("A", "C");
+  });
+  Cache.releaseBuild("A", "");
+  Waiter.join();
+
+  EXPECT_EQ(InMemoryModuleCache::BuildClaimed, Cache.claimBuild("A", ""));
+  Cache.releaseBuild("A", "");
+}
+
 } // namespace
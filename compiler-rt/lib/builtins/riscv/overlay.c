@@ -0,0 +1,103 @@
+//===-- overlay.c - Load linker script overlays ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a minimal overlay manager for the sections of the
+// OVERLAY statements of a linker script. lld describes them in the table at
+// __overlay_table, which holds the number of overlays followed by the run
+// address, the load address, the size and the region of each overlay, in
+// the order of the linker script.
+//
+// __overlay_load(i) copies overlay i from its load address to its run
+// address unless it is resident already. On cores with the Snitch DMA engine
+// (Xdma) the copy is a DMA transfer, which __overlay_load_async starts
+// without waiting for it, so that the next overlay can be fetched while the
+// current one runs. The caller has to ensure that no code or data of the
+// overlay being replaced is in use.
+//
+//===----------------------------------------------------------------------===//
+
+#include <stdint.h>
+
+// Regions beyond this number are loaded on every call.
+#define OVERLAY_MAX_REGIONS 16
+
+enum { OVERLAY_VMA, OVERLAY_LMA, OVERLAY_SIZE, OVERLAY_REGION, OVERLAY_WORDS };
+
+// Defined by lld if the linker script has an OVERLAY statement.
+extern const uintptr_t __overlay_table[] __attribute__((weak));
+
+// One plus the index of the overlay resident in each region, 0 if none.
+static uintptr_t resident[OVERLAY_MAX_REGIONS];
+
+static const uintptr_t *lookup(unsigned index) {
+  if (!__overlay_table || index >= __overlay_table[0])
+    return 0;
+  return &__overlay_table[1 + index * OVERLAY_WORDS];
+}
+
+static void sync_instructions(void) {
+  // The overlay may contain code which was fetched before.
+  __asm__ volatile("fence.i" ::: "memory");
+}
+
+// Returns the DMA transfer ID, or 0 if the copy has finished already.
+static unsigned copy(const uintptr_t *entry) {
+#if defined(__riscv_xdma)
+  return __builtin_sdma_start_oned(entry[OVERLAY_LMA], entry[OVERLAY_VMA],
+                                   entry[OVERLAY_SIZE], 0) + 1;
+#else
+  volatile unsigned char *dst = (volatile unsigned char *)entry[OVERLAY_VMA];
+  const volatile unsigned char *src =
+      (const volatile unsigned char *)entry[OVERLAY_LMA];
+  for (uintptr_t i = 0; i != entry[OVERLAY_SIZE]; ++i)
+    dst[i] = src[i];
+  sync_instructions();
+  return 0;
+#endif
+}
+
+// Starts loading overlay index and returns a handle for __overlay_wait, or
+// -1 if there is no such overlay.
+int __overlay_load_async(unsigned index) {
+  const uintptr_t *entry = lookup(index);
+  if (!entry)
+    return -1;
+  uintptr_t region = entry[OVERLAY_REGION];
+  if (region < OVERLAY_MAX_REGIONS) {
+    if (resident[region] == index + 1)
+      return 0;
+    resident[region] = index + 1;
+  }
+  return (int)copy(entry);
+}
+
+// Waits until the transfer started by __overlay_load_async has finished.
+void __overlay_wait(int handle) {
+  if (handle <= 0)
+    return;
+#if defined(__riscv_xdma)
+  __builtin_sdma_wait((unsigned)handle - 1);
+#endif
+  sync_instructions();
+}
+
+// Loads overlay index and returns 0, or -1 if there is no such overlay.
+int __overlay_load(unsigned index) {
+  int handle = __overlay_load_async(index);
+  if (handle < 0)
+    return -1;
+  __overlay_wait(handle);
+  return 0;
+}
+
+// Forgets which overlays are resident, e.g. after the overlay regions were
+// overwritten by other means.
+void __overlay_reset(void) {
+  for (unsigned i = 0; i != OVERLAY_MAX_REGIONS; ++i)
+    resident[i] = 0;
+}
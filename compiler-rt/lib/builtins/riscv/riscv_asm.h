@@ -0,0 +1,139 @@
+//===-- riscv_asm.h - Helper macros for RISC-V assembly builtins ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines assembler macros shared by the RV32 builtins. Macros that
+// branch use the numeric local labels 1 to 8, so code around them must not
+// use those labels across an expansion.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef COMPILERRT_RISCV_ASM_H
+#define COMPILERRT_RISCV_ASM_H
+
+// clz_nonzero rd, rs, tmp1, tmp2
+//
+// Sets rd to the number of leading zero bits of rs, which must not be zero.
+// rd must differ from rs; tmp1 and tmp2 may be clobbered. Zbb and the PULP
+// Xpulpv2 extension have an instruction for this, the base ISA needs a binary
+// search.
+#if defined(__riscv_zbb)
+  .macro clz_nonzero rd, rs, tmp1, tmp2
+  clz \rd, \rs
+  .endm
+#elif defined(__riscv_xpulpv2)
+  .macro clz_nonzero rd, rs, tmp1, tmp2
+  p.fl1 \rd, \rs
+  xori \rd, \rd, 31
+  .endm
+#else
+  .macro clz_nonzero rd, rs, tmp1, tmp2
+  mv \tmp1, \rs
+  li \rd, 0
+  srli \tmp2, \tmp1, 16
+  bnez \tmp2, 1f
+  slli \tmp1, \tmp1, 16
+  addi \rd, \rd, 16
+1:
+  srli \tmp2, \tmp1, 24
+  bnez \tmp2, 2f
+  slli \tmp1, \tmp1, 8
+  addi \rd, \rd, 8
+2:
+  srli \tmp2, \tmp1, 28
+  bnez \tmp2, 3f
+  slli \tmp1, \tmp1, 4
+  addi \rd, \rd, 4
+3:
+  srli \tmp2, \tmp1, 30
+  bnez \tmp2, 4f
+  slli \tmp1, \tmp1, 2
+  addi \rd, \rd, 2
+4:
+  srli \tmp2, \tmp1, 31
+  bnez \tmp2, 5f
+  addi \rd, \rd, 1
+5:
+  .endm
+#endif
+
+// neg64 lo, hi, tmp
+//
+// Negates the 64-bit value held in hi:lo.
+  .macro neg64 lo, hi, tmp
+  snez \tmp, \lo
+  neg \lo, \lo
+  neg \hi, \hi
+  sub \hi, \hi, \tmp
+  .endm
+
+// srl64_sticky hi, lo, count, tmp1, tmp2
+//
+// Shifts the 64-bit value held in hi:lo right by count, which must be in
+// [1, 63], and ors into its lowest bit whether any of the bits shifted out
+// was set. count, tmp1 and tmp2 must all differ from hi and lo; tmp1 and
+// tmp2 are clobbered.
+  .macro srl64_sticky hi, lo, count, tmp1, tmp2
+  addi \tmp1, \count, -32
+  bgez \tmp1, 6f
+  neg \tmp2, \count
+  sll \tmp1, \lo, \tmp2
+  snez \tmp1, \tmp1
+  sll \tmp2, \hi, \tmp2
+  srl \lo, \lo, \count
+  or \lo, \lo, \tmp2
+  or \lo, \lo, \tmp1
+  srl \hi, \hi, \count
+  j 8f
+6:
+  snez \tmp2, \lo
+  mv \lo, \hi
+  beqz \tmp1, 7f
+  srl \lo, \hi, \tmp1
+  neg \tmp1, \tmp1
+  sll \hi, \hi, \tmp1
+  snez \hi, \hi
+  or \tmp2, \tmp2, \hi
+7:
+  li \hi, 0
+  or \lo, \lo, \tmp2
+8:
+  .endm
+
+// normalize_df hi, lo, exponent, tmp1, tmp2, tmp3
+//
+// Shifts the non zero significand of a denormal double held in hi:lo so that
+// its leading bit becomes the implicit bit, and adds 1 - shift to exponent,
+// like normalize() in fp_lib.h.
+  .macro normalize_df hi, lo, exponent, tmp1, tmp2, tmp3
+  beqz \hi, 6f
+  clz_nonzero \tmp1, \hi, \tmp2, \tmp3
+  addi \tmp1, \tmp1, -11
+  sll \hi, \hi, \tmp1
+  neg \tmp2, \tmp1
+  srl \tmp2, \lo, \tmp2
+  or \hi, \hi, \tmp2
+  sll \lo, \lo, \tmp1
+  j 8f
+6:
+  clz_nonzero \tmp1, \lo, \tmp2, \tmp3
+  addi \tmp1, \tmp1, 21
+  addi \tmp2, \tmp1, -32
+  bltz \tmp2, 7f
+  sll \hi, \lo, \tmp2
+  li \lo, 0
+  j 8f
+7:
+  neg \tmp2, \tmp1
+  srl \hi, \lo, \tmp2
+  sll \lo, \lo, \tmp1
+8:
+  sub \exponent, \exponent, \tmp1
+  addi \exponent, \exponent, 1
+  .endm
+
+#endif // COMPILERRT_RISCV_ASM_H
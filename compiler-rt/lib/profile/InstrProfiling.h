@@ -82,12 +82,47 @@ uint64_t __llvm_profile_get_size_for_buffer(void);
  */
 int __llvm_profile_write_buffer(char *Buffer);
 
+/*!
+ * \brief Callback sending \c Size bytes of raw profile to the host.
+ *
+ * Returns 0 on success. \c Data is only valid for the duration of the call:
+ * a channel that transfers asynchronously, for example by DMA, must wait for
+ * the transfer to complete before returning.
+ */
+typedef int (*__llvm_profile_stream_fn)(void *Ctx, const void *Data,
+                                        uint32_t Size);
+
+/*!
+ * \brief Set the channel used by \a __llvm_profile_stream_drain().
+ *
+ * This is meant for bare-metal targets that have neither a file system nor
+ * room for a buffer as big as \a __llvm_profile_get_size_for_buffer(). The
+ * raw profile is assembled in the \c StagingSize bytes at \c Staging and
+ * passed to \c Fn each time the staging buffer is full. Neither \c Ctx nor
+ * \c Staging are copied, so they must remain valid.
+ */
+void __llvm_profile_set_stream(__llvm_profile_stream_fn Fn, void *Ctx,
+                               uint8_t *Staging, uint32_t StagingSize);
+
+/*!
+ * \brief Send instrumentation data through the stream channel.
+ *
+ * Every drain sends a complete raw profile holding the counts accumulated
+ * since the previous drain, and takes them off the in-memory counters. This
+ * keeps the counters from wrapping on long runs, and lets the host rebuild
+ * the profile by summing the drained profiles, e.g. with
+ * \c llvm-profdata \c merge. Images running on different cores that each
+ * hold their own counters are merged in the same way. Value profile data is
+ * not sent. Returns 0 on success.
+ */
+int __llvm_profile_stream_drain(void);
+
 const __llvm_profile_data *__llvm_profile_begin_data(void);
 const __llvm_profile_data *__llvm_profile_end_data(void);
 const char *__llvm_profile_begin_names(void);
 const char *__llvm_profile_end_names(void);
-uint64_t *__llvm_profile_begin_counters(void);
-uint64_t *__llvm_profile_end_counters(void);
+char *__llvm_profile_begin_counters(void);
+char *__llvm_profile_end_counters(void);
 ValueProfNode *__llvm_profile_begin_vnodes();
 ValueProfNode *__llvm_profile_end_vnodes();
 uint32_t *__llvm_profile_begin_orderfile();
@@ -263,13 +298,23 @@ uint64_t __llvm_profile_get_version(void);
 uint64_t __llvm_profile_get_data_size(const __llvm_profile_data *Begin,
                                       const __llvm_profile_data *End);
 
+/*! \brief Get the size in bytes of a single counter entry.
+ *
+ * Counters are 64-bit execution counts, or single bytes with byte coverage,
+ * see \c VARIANT_MASK_BYTE_COVERAGE.
+ */
+size_t __llvm_profile_counter_entry_size(void);
+
+/*! \brief Get the number of entries in the profile counters section. */
+uint64_t __llvm_profile_get_num_counters(const char *Begin, const char *End);
+
 /* ! \brief Given the sizes of the data and counter information, return the
  * number of padding bytes before and after the counters, and after the names,
  * in the raw profile.
  *
  * Note: In this context, "size" means "number of entries", i.e. the first two
  * arguments must be the result of __llvm_profile_get_data_size() and of
- * (__llvm_profile_end_counters() - __llvm_profile_begin_counters()) resp.
+ * __llvm_profile_get_num_counters() resp.
  *
  * Note: When mmap() mode is disabled, no padding bytes before/after counters
  * are needed. However, in mmap() mode, the counter section in the raw profile
@@ -22,8 +22,8 @@ void (*VPMergeHook)(ValueProfData *, __llvm_profile_data *);
 COMPILER_RT_VISIBILITY
 uint64_t lprofGetLoadModuleSignature() {
   /* A very fast way to compute a module signature.  */
-  uint64_t CounterSize = (uint64_t)(__llvm_profile_end_counters() -
-                                    __llvm_profile_begin_counters());
+  uint64_t CounterSize = __llvm_profile_get_num_counters(
+      __llvm_profile_begin_counters(), __llvm_profile_end_counters());
   uint64_t DataSize = __llvm_profile_get_data_size(__llvm_profile_begin_data(),
                                                    __llvm_profile_end_data());
   uint64_t NamesSize =
@@ -56,16 +56,18 @@ int __llvm_profile_check_compatibility(const char *ProfileData,
       Header->DataSize !=
           __llvm_profile_get_data_size(__llvm_profile_begin_data(),
                                        __llvm_profile_end_data()) ||
-      Header->CountersSize != (uint64_t)(__llvm_profile_end_counters() -
-                                         __llvm_profile_begin_counters()) ||
+      Header->CountersSize !=
+          __llvm_profile_get_num_counters(__llvm_profile_begin_counters(),
+                                          __llvm_profile_end_counters()) ||
       Header->NamesSize != (uint64_t)(__llvm_profile_end_names() -
                                       __llvm_profile_begin_names()) ||
       Header->ValueKindLast != IPVK_Last)
     return 1;
 
-  if (ProfileSize < sizeof(__llvm_profile_header) +
-                        Header->DataSize * sizeof(__llvm_profile_data) +
-                        Header->NamesSize + Header->CountersSize)
+  if (ProfileSize <
+      sizeof(__llvm_profile_header) +
+          Header->DataSize * sizeof(__llvm_profile_data) + Header->NamesSize +
+          Header->CountersSize * __llvm_profile_counter_entry_size())
     return 1;
 
   for (SrcData = SrcDataStart,
@@ -86,15 +88,17 @@ void __llvm_profile_merge_from_buffer(const char *ProfileData,
                                       uint64_t ProfileSize) {
   __llvm_profile_data *SrcDataStart, *SrcDataEnd, *SrcData, *DstData;
   __llvm_profile_header *Header = (__llvm_profile_header *)ProfileData;
-  uint64_t *SrcCountersStart;
+  const char *SrcCountersStart;
   const char *SrcNameStart;
+  const size_t CounterEntrySize = __llvm_profile_counter_entry_size();
   ValueProfData *SrcValueProfDataStart, *SrcValueProfData;
 
   SrcDataStart =
       (__llvm_profile_data *)(ProfileData + sizeof(__llvm_profile_header));
   SrcDataEnd = SrcDataStart + Header->DataSize;
-  SrcCountersStart = (uint64_t *)SrcDataEnd;
-  SrcNameStart = (const char *)(SrcCountersStart + Header->CountersSize);
+  SrcCountersStart = (const char *)SrcDataEnd;
+  SrcNameStart = SrcCountersStart + Header->CountersSize * CounterEntrySize +
+                 Header->PaddingBytesAfterCounters;
   SrcValueProfDataStart =
       (ValueProfData *)(SrcNameStart + Header->NamesSize +
                         __llvm_profile_get_num_padding_bytes(
@@ -104,16 +108,21 @@ void __llvm_profile_merge_from_buffer(const char *ProfileData,
       DstData = (__llvm_profile_data *)__llvm_profile_begin_data(),
       SrcValueProfData = SrcValueProfDataStart;
        SrcData < SrcDataEnd; ++SrcData, ++DstData) {
-    uint64_t *SrcCounters;
-    uint64_t *DstCounters = (uint64_t *)DstData->CounterPtr;
+    const char *SrcCounters;
+    char *DstCounters = (char *)DstData->CounterPtr;
     unsigned I, NC, NVK = 0;
 
     NC = SrcData->NumCounters;
     SrcCounters = SrcCountersStart +
-                  ((size_t)SrcData->CounterPtr - Header->CountersDelta) /
-                      sizeof(uint64_t);
-    for (I = 0; I < NC; I++)
-      DstCounters[I] += SrcCounters[I];
+                  ((size_t)SrcData->CounterPtr - Header->CountersDelta);
+    if (CounterEntrySize == sizeof(uint8_t)) {
+      /* A byte counter is cleared if the region was covered in either. */
+      for (I = 0; I < NC; I++)
+        DstCounters[I] &= SrcCounters[I];
+    } else {
+      for (I = 0; I < NC; I++)
+        ((uint64_t *)DstCounters)[I] += ((const uint64_t *)SrcCounters)[I];
+    }
 
     /* Now merge value profile data.  */
     if (!VPMergeHook)
@@ -0,0 +1,135 @@
+/*===- InstrProfilingStream.c - Stream instrumentation to a host channel --===*\
+|*
+|* Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+|* See https://llvm.org/LICENSE.txt for license information.
+|* SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+|*
+\*===----------------------------------------------------------------------===*/
+
+// Note: This is meant for bare-metal targets without a file system, and must
+// remain compatible with freestanding compilation.
+
+#include <string.h>
+
+#include "InstrProfiling.h"
+#include "InstrProfilingInternal.h"
+#include "InstrProfilingPort.h"
+
+/* The state of the stream writer for one drain. The raw profile is assembled
+ * in the staging buffer, which is handed to the channel whenever it is full
+ * and once more at the end of the drain. */
+typedef struct StreamWriterCtx {
+  uint8_t *Staging;
+  uint32_t StagingSize;
+  uint32_t Offset;
+  const char *CountersBegin;
+} StreamWriterCtx;
+
+static __llvm_profile_stream_fn StreamFn = NULL;
+static void *StreamCtx = NULL;
+static uint8_t *StreamStaging = NULL;
+static uint32_t StreamStagingSize = 0;
+
+static int streamFlush(StreamWriterCtx *Ctx) {
+  if (!Ctx->Offset)
+    return 0;
+  if (StreamFn(StreamCtx, Ctx->Staging, Ctx->Offset))
+    return -1;
+  Ctx->Offset = 0;
+  return 0;
+}
+
+/* Append Length bytes of Data, or zeros if Data is null, to the staging
+ * buffer. */
+static int streamBytes(StreamWriterCtx *Ctx, const uint8_t *Data,
+                       uint64_t Length) {
+  while (Length) {
+    uint32_t Chunk = Ctx->StagingSize - Ctx->Offset;
+    if (Chunk > Length)
+      Chunk = Length;
+    if (Data) {
+      memcpy(Ctx->Staging + Ctx->Offset, Data, Chunk);
+      Data += Chunk;
+    } else
+      memset(Ctx->Staging + Ctx->Offset, 0, Chunk);
+    Ctx->Offset += Chunk;
+    Length -= Chunk;
+    if (Ctx->Offset == Ctx->StagingSize && streamFlush(Ctx))
+      return -1;
+  }
+  return 0;
+}
+
+/* Stream the counters, subtracting every value sent from the live counter,
+ * so that the next drain only carries the counts accumulated since this one.
+ * Increments that land between the read and the subtraction are kept. Byte
+ * coverage counters are set back to not covered instead. */
+static int streamCounters(StreamWriterCtx *Ctx, char *Counters,
+                          uint64_t SizeInBytes) {
+  uint64_t I;
+  if (__llvm_profile_counter_entry_size() == sizeof(uint8_t)) {
+    for (I = 0; I < SizeInBytes; I++) {
+      uint8_t Value = Counters[I];
+      Counters[I] = (char)0xFF;
+      if (streamBytes(Ctx, &Value, sizeof(Value)))
+        return -1;
+    }
+    return 0;
+  }
+  for (I = 0; I < SizeInBytes / sizeof(uint64_t); I++) {
+    uint64_t Value = ((uint64_t *)Counters)[I];
+    ((uint64_t *)Counters)[I] -= Value;
+    if (streamBytes(Ctx, (const uint8_t *)&Value, sizeof(Value)))
+      return -1;
+  }
+  return 0;
+}
+
+static uint32_t streamWriter(ProfDataWriter *This, ProfDataIOVec *IOVecs,
+                             uint32_t NumIOVecs) {
+  StreamWriterCtx *Ctx = (StreamWriterCtx *)This->WriterCtx;
+  uint32_t I;
+  for (I = 0; I < NumIOVecs; I++) {
+    uint64_t Length = IOVecs[I].ElmSize * IOVecs[I].NumElm;
+    int Ret;
+    if (IOVecs[I].Data && IOVecs[I].Data == Ctx->CountersBegin)
+      Ret = streamCounters(Ctx, (char *)IOVecs[I].Data, Length);
+    else
+      Ret = streamBytes(Ctx, (const uint8_t *)IOVecs[I].Data, Length);
+    if (Ret)
+      return -1;
+  }
+  return 0;
+}
+
+COMPILER_RT_VISIBILITY void
+__llvm_profile_set_stream(__llvm_profile_stream_fn Fn, void *Ctx,
+                          uint8_t *Staging, uint32_t StagingSize) {
+  StreamFn = Fn;
+  StreamCtx = Ctx;
+  StreamStaging = Staging;
+  StreamStagingSize = StagingSize;
+}
+
+COMPILER_RT_VISIBILITY int __llvm_profile_stream_drain(void) {
+  StreamWriterCtx Ctx;
+  ProfDataWriter StreamWriter;
+  int Ret;
+
+  if (!StreamFn || !StreamStaging || !StreamStagingSize)
+    return -1;
+
+  Ctx.Staging = StreamStaging;
+  Ctx.StagingSize = StreamStagingSize;
+  Ctx.Offset = 0;
+  Ctx.CountersBegin = __llvm_profile_begin_counters();
+  StreamWriter.Write = streamWriter;
+  StreamWriter.WriterCtx = &Ctx;
+
+  /* Value profiling needs the allocator, which bare-metal targets usually
+   * lack; only the counters are streamed, as for the in-memory buffer. */
+  Ret = lprofWriteData(&StreamWriter, 0, 0);
+  if (Ret)
+    return Ret;
+  return streamFlush(&Ctx);
+}
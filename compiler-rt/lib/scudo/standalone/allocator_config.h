@@ -17,6 +17,7 @@
 #include "secondary.h"
 #include "size_class_map.h"
 #include "tsd_exclusive.h"
+#include "tsd_percpu.h"
 #include "tsd_shared.h"
 
 namespace scudo {
@@ -97,6 +98,35 @@ struct AndroidSvelteConfig {
   using TSDRegistryT = TSDRegistrySharedT<A, 2U, 1U>; // Shared, max 2 TSDs.
 };
 
+#if SCUDO_LINUX
+// The default configuration with per CPU rather than per thread caches, for
+// processes with a lot more threads than CPUs.
+struct PerCPUConfig {
+  using SizeClassMap = DefaultSizeClassMap;
+  static const bool MaySupportMemoryTagging = false;
+
+#if SCUDO_CAN_USE_PRIMARY64
+  typedef SizeClassAllocator64<PerCPUConfig> Primary;
+  static const uptr PrimaryRegionSizeLog = 30U;
+#else
+  typedef SizeClassAllocator32<PerCPUConfig> Primary;
+  static const uptr PrimaryRegionSizeLog = 19U;
+#endif
+  static const s32 PrimaryMinReleaseToOsIntervalMs = INT32_MIN;
+  static const s32 PrimaryMaxReleaseToOsIntervalMs = INT32_MAX;
+
+  typedef MapAllocatorCache<PerCPUConfig> SecondaryCache;
+  static const u32 SecondaryCacheEntriesArraySize = 32U;
+  static const u32 SecondaryCacheDefaultMaxEntriesCount = 32U;
+  static const uptr SecondaryCacheDefaultMaxEntrySize = 1UL << 19;
+  static const s32 SecondaryCacheMinReleaseToOsIntervalMs = INT32_MIN;
+  static const s32 SecondaryCacheMaxReleaseToOsIntervalMs = INT32_MAX;
+
+  template <class A>
+  using TSDRegistryT = TSDRegistryPerCPUT<A, 64U>; // Per CPU, max 64 TSDs.
+};
+#endif
+
 #if SCUDO_CAN_USE_PRIMARY64
 struct FuchsiaConfig {
   using SizeClassMap = DefaultSizeClassMap;
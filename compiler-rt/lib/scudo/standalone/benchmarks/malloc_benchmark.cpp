@@ -48,6 +48,10 @@ BENCHMARK_TEMPLATE(BM_malloc_free, scudo::AndroidConfig)
     ->Range(MinSize, MaxSize);
 BENCHMARK_TEMPLATE(BM_malloc_free, scudo::AndroidSvelteConfig)
     ->Range(MinSize, MaxSize);
+#if SCUDO_LINUX
+BENCHMARK_TEMPLATE(BM_malloc_free, scudo::PerCPUConfig)
+    ->Range(MinSize, MaxSize);
+#endif
 #if SCUDO_CAN_USE_PRIMARY64
 BENCHMARK_TEMPLATE(BM_malloc_free, scudo::FuchsiaConfig)
     ->Range(MinSize, MaxSize);
@@ -95,9 +99,54 @@ BENCHMARK_TEMPLATE(BM_malloc_free_loop, scudo::AndroidConfig)
     ->Range(MinIters, MaxIters);
 BENCHMARK_TEMPLATE(BM_malloc_free_loop, scudo::AndroidSvelteConfig)
     ->Range(MinIters, MaxIters);
+#if SCUDO_LINUX
+BENCHMARK_TEMPLATE(BM_malloc_free_loop, scudo::PerCPUConfig)
+    ->Range(MinIters, MaxIters);
+#endif
 #if SCUDO_CAN_USE_PRIMARY64
 BENCHMARK_TEMPLATE(BM_malloc_free_loop, scudo::FuchsiaConfig)
     ->Range(MinIters, MaxIters);
 #endif
 
+// Compares the TSD models when many threads allocate at the same time. The
+// allocator is shared by the threads of all the runs of a configuration, and
+// never torn down, which also makes it possible to measure the exclusive TSDs.
+template <typename Config>
+static void BM_malloc_free_threaded(benchmark::State &State) {
+  using AllocatorT = scudo::Allocator<Config>;
+  static AllocatorT *Allocator = [] {
+    AllocatorT *A = new AllocatorT;
+    A->reset();
+    return A;
+  }();
+
+  const size_t NBytes = State.range(0);
+  for (auto _ : State) {
+    void *Ptr = Allocator->allocate(NBytes, scudo::Chunk::Origin::Malloc);
+    benchmark::DoNotOptimize(Ptr);
+    Allocator->deallocate(Ptr, scudo::Chunk::Origin::Malloc);
+  }
+
+  State.SetBytesProcessed(uint64_t(State.iterations()) * uint64_t(NBytes));
+}
+
+static const size_t MinThreadedSize = 16;
+static const size_t MaxThreadedSize = 4 * 1024;
+static const int MaxThreads = 64;
+
+BENCHMARK_TEMPLATE(BM_malloc_free_threaded, scudo::DefaultConfig)
+    ->RangeMultiplier(16)
+    ->Range(MinThreadedSize, MaxThreadedSize)
+    ->ThreadRange(1, MaxThreads);
+BENCHMARK_TEMPLATE(BM_malloc_free_threaded, scudo::AndroidConfig)
+    ->RangeMultiplier(16)
+    ->Range(MinThreadedSize, MaxThreadedSize)
+    ->ThreadRange(1, MaxThreads);
+#if SCUDO_LINUX
+BENCHMARK_TEMPLATE(BM_malloc_free_threaded, scudo::PerCPUConfig)
+    ->RangeMultiplier(16)
+    ->Range(MinThreadedSize, MaxThreadedSize)
+    ->ThreadRange(1, MaxThreads);
+#endif
+
 BENCHMARK_MAIN();
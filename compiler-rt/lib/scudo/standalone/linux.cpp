@@ -138,6 +138,47 @@ u32 getNumberOfCPUs() {
   return static_cast<u32>(CPU_COUNT(&CPUs));
 }
 
+#if defined(__NR_rseq)
+namespace {
+// The leading part of struct rseq from <linux/rseq.h>, which the headers might
+// not provide. Once registered, the kernel keeps CPUId up to date for the
+// thread. No restartable sequence is ever registered in it.
+struct alignas(32) RseqArea {
+  u32 CPUIdStart;
+  u32 CPUId;
+  u64 CriticalSection;
+  u32 Flags;
+};
+static_assert(sizeof(RseqArea) == 32, "");
+
+enum : u32 {
+  RseqCPUIdUninitialized = ~0U,
+  RseqCPUIdRegistrationFailed = ~1U,
+};
+constexpr u32 RseqSignature = 0x53053053;
+} // namespace
+
+static thread_local RseqArea ThreadRseq = {0, RseqCPUIdUninitialized, 0, 0};
+#endif
+
+u32 getCurrentCPU() {
+#if defined(__NR_rseq)
+  const u32 CPU = *reinterpret_cast<volatile u32 *>(&ThreadRseq.CPUId);
+  if (LIKELY(CPU < RseqCPUIdRegistrationFailed))
+    return CPU;
+  if (CPU == RseqCPUIdUninitialized) {
+    // The registration fails if the C library already registered an area for
+    // the thread, in which case sched_getcpu reads the CPU from that one.
+    if (syscall(__NR_rseq, &ThreadRseq, sizeof(ThreadRseq), 0,
+                RseqSignature) == 0)
+      return *reinterpret_cast<volatile u32 *>(&ThreadRseq.CPUId);
+    ThreadRseq.CPUId = RseqCPUIdRegistrationFailed;
+  }
+#endif
+  const int SchedCPU = sched_getcpu();
+  return SchedCPU < 0 ? 0U : static_cast<u32>(SchedCPU);
+}
+
 u32 getThreadID() {
 #if SCUDO_ANDROID
   return static_cast<u32>(gettid());
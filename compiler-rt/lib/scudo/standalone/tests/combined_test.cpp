@@ -334,6 +334,9 @@ TEST(ScudoCombinedTest, BasicCombined) {
   testAllocator<scudo::FuchsiaConfig>();
 #else
   testAllocator<scudo::DefaultConfig>();
+#if SCUDO_LINUX
+  testAllocator<scudo::PerCPUConfig>();
+#endif
   UseQuarantine = true;
   testAllocator<scudo::AndroidConfig>();
   testSEGV();
@@ -385,6 +388,9 @@ TEST(ScudoCombinedTest, ThreadedCombined) {
   testAllocatorThreaded<scudo::FuchsiaConfig>();
 #else
   testAllocatorThreaded<scudo::DefaultConfig>();
+#if SCUDO_LINUX
+  testAllocatorThreaded<scudo::PerCPUConfig>();
+#endif
   UseQuarantine = true;
   testAllocatorThreaded<scudo::AndroidConfig>();
 #endif
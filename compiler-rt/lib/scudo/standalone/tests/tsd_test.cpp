@@ -9,6 +9,7 @@
 #include "tests/scudo_unit_test.h"
 
 #include "tsd_exclusive.h"
+#include "tsd_percpu.h"
 #include "tsd_shared.h"
 
 #include <condition_variable>
@@ -16,6 +17,10 @@
 #include <set>
 #include <thread>
 
+#if SCUDO_LINUX
+#include <sched.h>
+#endif
+
 // We mock out an allocator with a TSD registry, mostly using empty stubs. The
 // cache contains a single volatile uptr, to be able to test that several
 // concurrent threads will not access or modify the same cache at the same time.
@@ -61,6 +66,11 @@ struct ExclusiveCaches {
   using TSDRegistryT = scudo::TSDRegistryExT<Allocator>;
 };
 
+struct PerCPUCaches {
+  template <class Allocator>
+  using TSDRegistryT = scudo::TSDRegistryPerCPUT<Allocator, 16U>;
+};
+
 TEST(ScudoTSDTest, TSDRegistryInit) {
   using AllocatorT = MockAllocator<OneCache>;
   auto Deleter = [](AllocatorT *A) {
@@ -110,6 +120,7 @@ template <class AllocatorT> static void testRegistry() {
 TEST(ScudoTSDTest, TSDRegistryBasic) {
   testRegistry<MockAllocator<OneCache>>();
   testRegistry<MockAllocator<SharedCaches>>();
+  testRegistry<MockAllocator<PerCPUCaches>>();
 #if !SCUDO_FUCHSIA
   testRegistry<MockAllocator<ExclusiveCaches>>();
 #endif
@@ -169,6 +180,7 @@ template <class AllocatorT> static void testRegistryThreaded() {
 TEST(ScudoTSDTest, TSDRegistryThreaded) {
   testRegistryThreaded<MockAllocator<OneCache>>();
   testRegistryThreaded<MockAllocator<SharedCaches>>();
+  testRegistryThreaded<MockAllocator<PerCPUCaches>>();
 #if !SCUDO_FUCHSIA
   testRegistryThreaded<MockAllocator<ExclusiveCaches>>();
 #endif
@@ -243,3 +255,43 @@ TEST(ScudoTSDTest, TSDRegistryTSDsCount) {
   // We should get 16 distinct TSDs back.
   EXPECT_EQ(Pointers.size(), 16U);
 }
+
+#if SCUDO_LINUX
+TEST(ScudoTSDTest, TSDRegistryPerCPU) {
+  using AllocatorT = MockAllocator<PerCPUCaches>;
+  auto Deleter = [](AllocatorT *A) {
+    A->unmapTestOnly();
+    delete A;
+  };
+  std::unique_ptr<AllocatorT, decltype(Deleter)> Allocator(new AllocatorT,
+                                                           Deleter);
+  Allocator->reset();
+  auto Registry = Allocator->getTSDRegistry();
+  Registry->initThreadMaybe(Allocator.get(), /*MinimalInit=*/false);
+  // The TSD is the one of the current CPU, whatever the thread, so pinning
+  // threads to the same CPU must give them the same TSD.
+  cpu_set_t CPUs;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(CPUs), &CPUs), 0);
+  int CPU = 0;
+  while (!CPU_ISSET(CPU, &CPUs))
+    CPU++;
+  auto GetPinnedTSD = [&]() {
+    cpu_set_t Pinned;
+    CPU_ZERO(&Pinned);
+    CPU_SET(CPU, &Pinned);
+    EXPECT_EQ(sched_setaffinity(0, sizeof(Pinned), &Pinned), 0);
+    Registry->initThreadMaybe(Allocator.get(), /*MinimalInit=*/false);
+    EXPECT_EQ(scudo::getCurrentCPU(), static_cast<scudo::u32>(CPU));
+    bool UnlockRequired;
+    auto TSD = Registry->getTSDAndLock(&UnlockRequired);
+    EXPECT_TRUE(UnlockRequired);
+    TSD->unlock();
+    return TSD;
+  };
+  void *First = nullptr, *Second = nullptr;
+  std::thread([&]() { First = GetPinnedTSD(); }).join();
+  std::thread([&]() { Second = GetPinnedTSD(); }).join();
+  EXPECT_NE(First, nullptr);
+  EXPECT_EQ(First, Second);
+}
+#endif
@@ -0,0 +1,114 @@
+//===-- tsd_percpu.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCUDO_TSD_PERCPU_H_
+#define SCUDO_TSD_PERCPU_H_
+
+#include "tsd.h"
+
+namespace scudo {
+
+// A registry with one TSD per CPU, picked by the CPU the thread is running on
+// rather than assigned to the thread. The memory used by the caches is bounded
+// by the number of CPUs whatever the number of threads, and a TSD is only
+// shared by the threads that are running on its CPU, so that locking it is
+// only contended if its owner got preempted or migrated while holding it.
+template <class Allocator, u32 TSDsArraySize> struct TSDRegistryPerCPUT {
+  void initLinkerInitialized(Allocator *Instance) {
+    Instance->initLinkerInitialized();
+    for (u32 I = 0; I < TSDsArraySize; I++)
+      TSDs[I].initLinkerInitialized(Instance);
+    const u32 NumberOfCPUs = getNumberOfCPUs();
+    NumberOfTSDs = (NumberOfCPUs == 0) ? TSDsArraySize
+                                       : Min(NumberOfCPUs, TSDsArraySize);
+    Initialized = true;
+  }
+  void init(Allocator *Instance) {
+    memset(this, 0, sizeof(*this));
+    initLinkerInitialized(Instance);
+  }
+
+  void unmapTestOnly() { ThreadState &= ~ThreadInitializedBit; }
+
+  ALWAYS_INLINE void initThreadMaybe(Allocator *Instance,
+                                     UNUSED bool MinimalInit) {
+    if (LIKELY(ThreadState & ThreadInitializedBit))
+      return;
+    initThread(Instance);
+  }
+
+  ALWAYS_INLINE TSD<Allocator> *getTSDAndLock(bool *UnlockRequired) {
+    *UnlockRequired = true;
+    u32 Index = getCurrentCPU();
+    // CPU numbers can go past the number of CPUs available to the process.
+    if (UNLIKELY(Index >= NumberOfTSDs))
+      Index %= NumberOfTSDs;
+    TSDs[Index].lock();
+    return &TSDs[Index];
+  }
+
+  void disable() {
+    Mutex.lock();
+    for (u32 I = 0; I < TSDsArraySize; I++)
+      TSDs[I].lock();
+  }
+
+  void enable() {
+    for (s32 I = static_cast<s32>(TSDsArraySize - 1); I >= 0; I--)
+      TSDs[I].unlock();
+    Mutex.unlock();
+  }
+
+  bool setOption(Option O, sptr Value) {
+    if (O == Option::ThreadDisableMemInit) {
+      if (Value)
+        ThreadState |= DisableMemInitBit;
+      else
+        ThreadState &= ~DisableMemInitBit;
+    }
+    // The number of TSDs follows the number of CPUs.
+    if (O == Option::MaxTSDsCount)
+      return false;
+    return true;
+  }
+
+  bool getDisableMemInit() const { return ThreadState & DisableMemInitBit; }
+
+private:
+  enum : uptr {
+    DisableMemInitBit = 1U << 0,
+    ThreadInitializedBit = 1U << 1,
+  };
+
+  void initOnceMaybe(Allocator *Instance) {
+    ScopedLock L(Mutex);
+    if (LIKELY(Initialized))
+      return;
+    initLinkerInitialized(Instance); // Sets Initialized.
+  }
+
+  NOINLINE void initThread(Allocator *Instance) {
+    initOnceMaybe(Instance);
+    ThreadState |= ThreadInitializedBit;
+    Instance->callPostInitCallback();
+  }
+
+  static thread_local uptr ThreadState;
+
+  u32 NumberOfTSDs;
+  bool Initialized;
+  HybridMutex Mutex;
+  TSD<Allocator> TSDs[TSDsArraySize];
+};
+
+template <class Allocator, u32 TSDsArraySize>
+thread_local uptr TSDRegistryPerCPUT<Allocator, TSDsArraySize>::ThreadState;
+
+} // namespace scudo
+
+#endif // SCUDO_TSD_PERCPU_H_
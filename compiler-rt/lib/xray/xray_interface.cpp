@@ -52,6 +52,10 @@ static const int16_t cSledLength = 48;
 static const int16_t cSledLength = 64;
 #elif defined(__powerpc64__)
 static const int16_t cSledLength = 8;
+#elif defined(__riscv) && __riscv_xlen == 64
+static const int16_t cSledLength = 60;
+#elif defined(__riscv) && __riscv_xlen == 32
+static const int16_t cSledLength = 44;
 #else
 #error "Unsupported CPU Architecture"
 #endif /* CPU architecture */
@@ -0,0 +1,240 @@
+//===-- xray_riscv.cpp ------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file is a part of XRay, a dynamic runtime instrumentation system.
+//
+// Implementation of RISC-V-specific routines (32-bit and 64-bit).
+//
+//===----------------------------------------------------------------------===//
+#include "sanitizer_common/sanitizer_common.h"
+#include "xray_defs.h"
+#include "xray_interface_internal.h"
+#include <atomic>
+
+extern "C" void __clear_cache(void *start, void *end);
+
+namespace __xray {
+
+// The machine codes for some instructions used in runtime patching.
+enum PatchOpcodes : uint32_t {
+  PO_ADDI = 0x00000013,  // addi rd, rs1, imm
+  PO_ADDIW = 0x0000001B, // addiw rd, rs1, imm
+  PO_SLLI = 0x00001013,  // slli rd, rs1, shamt
+  PO_ADD = 0x00000033,   // add rd, rs1, rs2
+  PO_LUI = 0x00000037,   // lui rd, imm
+  PO_JALR = 0x00000067,  // jalr rd, imm(rs1)
+  PO_JAL = 0x0000006F,   // jal rd, offset
+  PO_SW = 0x00002023,    // sw rs2, imm(rs1)
+  PO_SD = 0x00003023,    // sd rs2, imm(rs1)
+  PO_LW = 0x00002003,    // lw rd, imm(rs1)
+  PO_LD = 0x00003003,    // ld rd, imm(rs1)
+};
+
+// The number of instructions in a sled, see RISCVAsmPrinter::emitSled.
+#if __riscv_xlen == 64
+static const uint32_t SledWords = 15;
+#else
+static const uint32_t SledWords = 11;
+#endif
+
+enum RegNum : uint32_t {
+  RN_X0 = 0,
+  RN_RA = 1,
+  RN_SP = 2,
+  RN_A0 = 10,
+};
+
+inline static uint32_t encodeRTypeInstruction(uint32_t Opcode, uint32_t Rd,
+                                              uint32_t Rs1, uint32_t Rs2)
+    XRAY_NEVER_INSTRUMENT {
+  return Rs2 << 20 | Rs1 << 15 | Rd << 7 | Opcode;
+}
+
+inline static uint32_t encodeITypeInstruction(uint32_t Opcode, uint32_t Rd,
+                                              uint32_t Rs1, uint32_t Imm)
+    XRAY_NEVER_INSTRUMENT {
+  return (Imm & 0xFFF) << 20 | Rs1 << 15 | Rd << 7 | Opcode;
+}
+
+inline static uint32_t encodeSTypeInstruction(uint32_t Opcode, uint32_t Rs1,
+                                              uint32_t Rs2, uint32_t Imm)
+    XRAY_NEVER_INSTRUMENT {
+  return (Imm & 0xFE0) << 20 | Rs2 << 20 | Rs1 << 15 | (Imm & 0x1F) << 7 |
+         Opcode;
+}
+
+inline static uint32_t encodeUTypeInstruction(uint32_t Opcode, uint32_t Rd,
+                                              uint32_t Imm)
+    XRAY_NEVER_INSTRUMENT {
+  return (Imm & 0xFFFFF) << 12 | Rd << 7 | Opcode;
+}
+
+inline static uint32_t encodeJTypeInstruction(uint32_t Opcode, uint32_t Rd,
+                                              uint32_t Imm)
+    XRAY_NEVER_INSTRUMENT {
+  uint32_t Imm20 = (Imm >> 20) & 0x1;
+  uint32_t Imm10_1 = (Imm >> 1) & 0x3FF;
+  uint32_t Imm11 = (Imm >> 11) & 0x1;
+  uint32_t Imm19_12 = (Imm >> 12) & 0xFF;
+  return Imm20 << 31 | Imm10_1 << 21 | Imm11 << 20 | Imm19_12 << 12 | Rd << 7 |
+         Opcode;
+}
+
+// The immediates of a lui/addi(w) pair that materializes the low 32 bits of
+// Value: lui loads the upper 20 bits, rounded so that adding the sign-extended
+// lower 12 bits gives back Value.
+inline static uint32_t hi20(uint32_t Value) XRAY_NEVER_INSTRUMENT {
+  return (Value + 0x800) >> 12;
+}
+
+inline static uint32_t lo12(uint32_t Value) XRAY_NEVER_INSTRUMENT {
+  return Value & 0xFFF;
+}
+
+inline static bool patchSled(const bool Enable, const uint32_t FuncId,
+                             const XRaySledEntry &Sled,
+                             void (*TracingHook)()) XRAY_NEVER_INSTRUMENT {
+  // When |Enable| == true,
+  // We replace the following compile-time stub (sled):
+  //
+  // xray_sled_n:
+  //   J .tmpN
+  //   10 (RV32) or 14 (RV64) NOPs
+  //   .tmpN
+  //
+  // With the following runtime patch:
+  //
+  // xray_sled_n (32-bit):
+  //   addi sp, sp, -16                         ;create stack frame
+  //   sw ra, 12(sp)                            ;save return address
+  //   sw a0, 8(sp)                             ;save register a0
+  //   lui ra, %hi(__xray_FunctionEntry/Exit)
+  //   addi ra, ra, %lo(__xray_FunctionEntry/Exit)
+  //   lui a0, %hi(function_id)
+  //   addi a0, a0, %lo(function_id)            ;pass function id
+  //   jalr ra                                  ;call Tracing hook
+  //   lw a0, 8(sp)                             ;restore register a0
+  //   lw ra, 12(sp)                            ;restore return address
+  //   addi sp, sp, 16                          ;delete stack frame
+  //
+  // xray_sled_n (64-bit):
+  //   addi sp, sp, -16                         ;create stack frame
+  //   sd ra, 8(sp)                             ;save return address
+  //   sd a0, 0(sp)                             ;save register a0
+  //   lui ra, %hi(upper 32 bits of the hook)
+  //   addiw ra, ra, %lo(upper 32 bits of the hook)
+  //   slli ra, ra, 32
+  //   lui a0, %hi(lower 32 bits of the hook)
+  //   addiw a0, a0, %lo(lower 32 bits of the hook)
+  //   add ra, ra, a0
+  //   lui a0, %hi(function_id)
+  //   addiw a0, a0, %lo(function_id)           ;pass function id
+  //   jalr ra                                  ;call Tracing hook
+  //   ld a0, 0(sp)                             ;restore register a0
+  //   ld ra, 8(sp)                             ;restore return address
+  //   addi sp, sp, 16                          ;delete stack frame
+  //
+  // The lower 32 bits of the hook address are sign extended by lui/addiw, so
+  // the upper 32 bits are computed from the address minus that value.
+  //
+  // Replacement of the first 4-byte instruction should be the last and atomic
+  // operation, so that the user code which reaches the sled concurrently
+  // either jumps over the whole sled, or executes the whole sled when the
+  // latter is ready.
+  //
+  // When |Enable|==false, we set back the first instruction in the sled to be
+  //   J .tmpN
+
+  uint32_t *Address = reinterpret_cast<uint32_t *>(Sled.address());
+  if (Enable) {
+#if __riscv_xlen == 64
+    const uint64_t HookAddr = reinterpret_cast<uint64_t>(TracingHook);
+    const uint32_t LoTracingHookAddr = static_cast<uint32_t>(HookAddr);
+    const uint32_t HiTracingHookAddr = static_cast<uint32_t>(
+        (HookAddr - static_cast<int64_t>(static_cast<int32_t>(
+                        LoTracingHookAddr))) >>
+        32);
+    Address[1] = encodeSTypeInstruction(PO_SD, RN_SP, RN_RA, 8);
+    Address[2] = encodeSTypeInstruction(PO_SD, RN_SP, RN_A0, 0);
+    Address[3] = encodeUTypeInstruction(PO_LUI, RN_RA, hi20(HiTracingHookAddr));
+    Address[4] = encodeITypeInstruction(PO_ADDIW, RN_RA, RN_RA,
+                                        lo12(HiTracingHookAddr));
+    Address[5] = encodeITypeInstruction(PO_SLLI, RN_RA, RN_RA, 32);
+    Address[6] = encodeUTypeInstruction(PO_LUI, RN_A0, hi20(LoTracingHookAddr));
+    Address[7] = encodeITypeInstruction(PO_ADDIW, RN_A0, RN_A0,
+                                        lo12(LoTracingHookAddr));
+    Address[8] = encodeRTypeInstruction(PO_ADD, RN_RA, RN_RA, RN_A0);
+    Address[9] = encodeUTypeInstruction(PO_LUI, RN_A0, hi20(FuncId));
+    Address[10] = encodeITypeInstruction(PO_ADDIW, RN_A0, RN_A0, lo12(FuncId));
+    Address[11] = encodeITypeInstruction(PO_JALR, RN_RA, RN_RA, 0);
+    Address[12] = encodeITypeInstruction(PO_LD, RN_A0, RN_SP, 0);
+    Address[13] = encodeITypeInstruction(PO_LD, RN_RA, RN_SP, 8);
+    Address[14] = encodeITypeInstruction(PO_ADDI, RN_SP, RN_SP, 16);
+#else
+    const uint32_t TracingHookAddr = reinterpret_cast<uint32_t>(TracingHook);
+    Address[1] = encodeSTypeInstruction(PO_SW, RN_SP, RN_RA, 12);
+    Address[2] = encodeSTypeInstruction(PO_SW, RN_SP, RN_A0, 8);
+    Address[3] = encodeUTypeInstruction(PO_LUI, RN_RA, hi20(TracingHookAddr));
+    Address[4] = encodeITypeInstruction(PO_ADDI, RN_RA, RN_RA,
+                                        lo12(TracingHookAddr));
+    Address[5] = encodeUTypeInstruction(PO_LUI, RN_A0, hi20(FuncId));
+    Address[6] = encodeITypeInstruction(PO_ADDI, RN_A0, RN_A0, lo12(FuncId));
+    Address[7] = encodeITypeInstruction(PO_JALR, RN_RA, RN_RA, 0);
+    Address[8] = encodeITypeInstruction(PO_LW, RN_A0, RN_SP, 8);
+    Address[9] = encodeITypeInstruction(PO_LW, RN_RA, RN_SP, 12);
+    Address[10] = encodeITypeInstruction(PO_ADDI, RN_SP, RN_SP, 16);
+#endif
+    uint32_t CreateStackSpace =
+        encodeITypeInstruction(PO_ADDI, RN_SP, RN_SP, -16);
+    std::atomic_store_explicit(
+        reinterpret_cast<std::atomic<uint32_t> *>(Address), CreateStackSpace,
+        std::memory_order_release);
+  } else {
+    uint32_t JumpOverSled =
+        encodeJTypeInstruction(PO_JAL, RN_X0, SledWords * 4);
+    std::atomic_store_explicit(
+        reinterpret_cast<std::atomic<uint32_t> *>(Address), JumpOverSled,
+        std::memory_order_release);
+  }
+  __clear_cache(reinterpret_cast<char *>(Address),
+                reinterpret_cast<char *>(Address + SledWords));
+  return true;
+}
+
+bool patchFunctionEntry(const bool Enable, const uint32_t FuncId,
+                        const XRaySledEntry &Sled,
+                        void (*Trampoline)()) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, Trampoline);
+}
+
+bool patchFunctionExit(const bool Enable, const uint32_t FuncId,
+                       const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, __xray_FunctionExit);
+}
+
+bool patchFunctionTailExit(const bool Enable, const uint32_t FuncId,
+                           const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, __xray_FunctionTailExit);
+}
+
+bool patchCustomEvent(const bool Enable, const uint32_t FuncId,
+                      const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  // FIXME: Implement in riscv?
+  return false;
+}
+
+bool patchTypedEvent(const bool Enable, const uint32_t FuncId,
+                     const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  // FIXME: Implement in riscv?
+  return false;
+}
+} // namespace __xray
+
+extern "C" void __xray_ArgLoggerEntry() XRAY_NEVER_INSTRUMENT {
+  // FIXME: this will have to be implemented in the trampoline assembly file
+}
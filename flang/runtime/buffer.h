@@ -81,7 +81,7 @@ public:
       auto got{Store().Read(
           fileOffset_ + length_, buffer_ + next, minBytes, maxBytes, handler)};
       length_ += got;
-      RUNTIME_CHECK(handler, length_ < size_);
+      RUNTIME_CHECK(handler, length_ <= size_);
       if (got < minBytes) {
         break; // error or EOF & program can handle it
       }
@@ -119,6 +119,24 @@ public:
     }
   }
 
+  // Large transfers move data directly between the file and the caller's
+  // memory rather than through the buffer.  Buffered output is flushed
+  // first; a direct write also discards the buffered data, which it may
+  // have made stale.
+  std::size_t ReadDirectly(
+      FileOffset at, char *data, std::size_t bytes, IoErrorHandler &handler) {
+    Flush(handler);
+    return Store().Read(at, data, bytes, bytes, handler);
+  }
+
+  std::size_t WriteDirectly(FileOffset at, const char *data,
+      std::size_t bytes, IoErrorHandler &handler) {
+    Flush(handler);
+    std::size_t put{Store().Write(at, data, bytes, handler)};
+    Reset(at + put);
+    return put;
+  }
+
 private:
   STORE &Store() { return static_cast<STORE &>(*this); }
 
@@ -126,7 +144,10 @@ private:
     if (bytes > size_) {
       char *old{buffer_};
       auto oldSize{size_};
-      size_ = std::max<std::int64_t>(bytes, minBuffer);
+      // Grow geometrically so that a frame which is extended repeatedly,
+      // e.g. while scanning a long formatted record for its newline, costs
+      // amortized linear time.
+      size_ = std::max<std::int64_t>({bytes, 2 * size_, minBuffer});
       buffer_ =
           reinterpret_cast<char *>(AllocateMemoryOrCrash(terminator, size_));
       auto chunk{std::min<std::int64_t>(length_, oldSize - start_)};
@@ -19,6 +19,10 @@
 #include "flang/Common/uint128.h"
 
 namespace Fortran::runtime::io::descr {
+
+// Non-contiguous unformatted data are transferred in chunks of this size.
+static constexpr std::size_t unformattedChunkBytes{4096};
+
 template <typename A>
 inline A &ExtractElement(IoStatementState &io, const Descriptor &descriptor,
     const SubscriptValue subscripts[]) {
@@ -234,7 +238,39 @@ static bool DescriptorIO(IoStatementState &io, const Descriptor &descriptor) {
       } else {
         return unf->Receive(&x, totalBytes, elementBytes);
       }
-    } else { // non-contiguous unformatted I/O
+    } else if (elementBytes > 0 && elementBytes <= unformattedChunkBytes) {
+      // Non-contiguous unformatted I/O: gather (scatter) the elements through
+      // a local buffer so that each transfer moves many of them.
+      char chunk[unformattedChunkBytes];
+      std::size_t chunkElements{unformattedChunkBytes / elementBytes};
+      for (std::size_t j{0}; j < numElements; j += chunkElements) {
+        std::size_t n{std::min(chunkElements, numElements - j)};
+        if constexpr (DIR == Direction::Input) {
+          if (!unf->Receive(chunk, n * elementBytes, elementBytes)) {
+            return false;
+          }
+        }
+        for (std::size_t k{0}; k < n; ++k) {
+          char &x{ExtractElement<char>(io, descriptor, subscripts)};
+          if constexpr (DIR == Direction::Output) {
+            std::memcpy(&chunk[k * elementBytes], &x, elementBytes);
+          } else {
+            std::memcpy(&x, &chunk[k * elementBytes], elementBytes);
+          }
+          if (!descriptor.IncrementSubscripts(subscripts) &&
+              j + k + 1 < numElements) {
+            io.GetIoErrorHandler().Crash(
+                "DescriptorIO: subscripts out of bounds");
+          }
+        }
+        if constexpr (DIR == Direction::Output) {
+          if (!unf->Emit(chunk, n * elementBytes, elementBytes)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    } else { // non-contiguous unformatted I/O of large elements
       for (std::size_t j{0}; j < numElements; ++j) {
         char &x{ExtractElement<char>(io, descriptor, subscripts)};
         if constexpr (DIR == Direction::Output) {
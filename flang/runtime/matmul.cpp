@@ -0,0 +1,222 @@
+//===-- runtime/matmul.cpp ------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Implements MATMUL.  When the columns of X are contiguous, the product is
+// computed by a cache-blocked kernel whose innermost loop runs down a column
+// of X and of the result, so that it vectorizes; other arguments are
+// multiplied element by element through their byte strides.
+
+#include "matmul.h"
+#include "descriptor.h"
+#include "reduction-templates.h"
+#include "terminator.h"
+#include <algorithm>
+#include <cinttypes>
+
+namespace Fortran::runtime {
+
+// The kernel multiplies blocks of rows of X with blocks of the inner
+// dimension, so that a block of X (rowBlockBytes * innerBlock bytes) stays
+// in cache while it is multiplied with every column of Y.
+static constexpr std::size_t rowBlockBytes{1024};
+static constexpr SubscriptValue innerBlock{64};
+
+// A vector or matrix argument viewed as a matrix; a vector X is a single
+// row and a vector Y a single column.
+struct MatrixView {
+  MatrixView(const Descriptor &descriptor, bool isLeft) {
+    base = descriptor.OffsetElement<char>();
+    const Dimension &first{descriptor.GetDimension(0)};
+    if (descriptor.rank() == 2) {
+      const Dimension &second{descriptor.GetDimension(1)};
+      rows = first.Extent();
+      columns = second.Extent();
+      rowStride = first.ByteStride();
+      columnStride = second.ByteStride();
+    } else if (isLeft) {
+      rows = 1;
+      columns = first.Extent();
+      rowStride = 0;
+      columnStride = first.ByteStride();
+    } else {
+      rows = first.Extent();
+      columns = 1;
+      rowStride = first.ByteStride();
+      columnStride = 0;
+    }
+  }
+
+  template <typename T> const T &At(SubscriptValue i, SubscriptValue j) const {
+    return *reinterpret_cast<const T *>(
+        base + i * rowStride + j * columnStride);
+  }
+
+  const char *base;
+  SubscriptValue rows, columns;
+  SubscriptValue rowStride, columnStride; // in bytes
+};
+
+// Computes the rows x columns result into the contiguous storage at c.
+template <typename T>
+static void MatmulColumns(
+    T *c, const MatrixView &x, const MatrixView &y, SubscriptValue n) {
+  SubscriptValue rows{x.rows}, columns{y.columns};
+  std::fill(c, c + rows * columns, T{0});
+  constexpr auto rowBlock{static_cast<SubscriptValue>(rowBlockBytes / sizeof(T))};
+  for (SubscriptValue i0{0}; i0 < rows; i0 += rowBlock) {
+    SubscriptValue i1{std::min(i0 + rowBlock, rows)};
+    for (SubscriptValue k0{0}; k0 < n; k0 += innerBlock) {
+      SubscriptValue k1{std::min(k0 + innerBlock, n)};
+      for (SubscriptValue j{0}; j < columns; ++j) {
+        T *cj{c + j * rows};
+        for (SubscriptValue k{k0}; k < k1; ++k) {
+          T ykj{y.At<T>(k, j)};
+          const T *xk{&x.At<T>(0, k)};
+          for (SubscriptValue i{i0}; i < i1; ++i) {
+            cj[i] = Add(cj[i], Multiply(xk[i], ykj));
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+static void Matmul(
+    T *c, const MatrixView &x, const MatrixView &y, SubscriptValue n) {
+  auto elementBytes{static_cast<SubscriptValue>(sizeof(T))};
+  if (x.rows > 1 && x.rowStride == elementBytes) {
+    MatmulColumns(c, x, y, n);
+  } else if (x.rows == 1 && x.columnStride == elementBytes &&
+      y.rowStride == elementBytes) {
+    // Vector times matrix: a dot product with each column of Y.
+    for (SubscriptValue j{0}; j < y.columns; ++j) {
+      c[j] = DotContiguous<false>(&x.At<T>(0, 0), &y.At<T>(0, j), n);
+    }
+  } else {
+    for (SubscriptValue j{0}; j < y.columns; ++j) {
+      for (SubscriptValue i{0}; i < x.rows; ++i) {
+        T sum{0};
+        for (SubscriptValue k{0}; k < n; ++k) {
+          sum = Add(sum, Multiply(x.At<T>(i, k), y.At<T>(k, j)));
+        }
+        c[i + j * x.rows] = sum;
+      }
+    }
+  }
+}
+
+// LOGICAL elements are accessed as integers of the same size.
+template <typename T>
+static void MatmulLogical(
+    T *c, const MatrixView &x, const MatrixView &y, SubscriptValue n) {
+  for (SubscriptValue j{0}; j < y.columns; ++j) {
+    for (SubscriptValue i{0}; i < x.rows; ++i) {
+      bool any{false};
+      for (SubscriptValue k{0}; k < n && !any; ++k) {
+        any = x.At<T>(i, k) != 0 && y.At<T>(k, j) != 0;
+      }
+      c[i + j * x.rows] = any;
+    }
+  }
+}
+
+extern "C" {
+
+void RTNAME(Matmul)(Descriptor &result, const Descriptor &x,
+    const Descriptor &y, const char *sourceFile, int line) {
+  Terminator terminator{sourceFile, line};
+  int xRank{x.rank()}, yRank{y.rank()};
+  if (xRank < 1 || xRank > 2 || yRank < 1 || yRank > 2 ||
+      (xRank == 1 && yRank == 1)) {
+    terminator.Crash(
+        "MATMUL: arguments have unsupported ranks %d and %d", xRank, yRank);
+  }
+  if (x.type() != y.type()) {
+    terminator.Crash("MATMUL: arguments have different type codes %d and %d",
+        static_cast<int>(x.type().raw()), static_cast<int>(y.type().raw()));
+  }
+  MatrixView xView{x, true}, yView{y, false};
+  if (xView.columns != yView.rows) {
+    terminator.Crash("MATMUL: the inner extents of the arguments differ "
+                     "(%jd != %jd)",
+        static_cast<std::intmax_t>(xView.columns),
+        static_cast<std::intmax_t>(yView.rows));
+  }
+  SubscriptValue lb[2]{1, 1}, ub[2];
+  int resultRank{0};
+  if (xRank == 2) {
+    ub[resultRank++] = xView.rows;
+  }
+  if (yRank == 2) {
+    ub[resultRank++] = yView.columns;
+  }
+  result.Establish(x.type(), x.ElementBytes(), nullptr, resultRank, nullptr,
+      CFI_attribute_allocatable);
+  if (result.Allocate(lb, ub) != CFI_SUCCESS) {
+    terminator.Crash("MATMUL: could not allocate storage for result");
+  }
+  SubscriptValue n{xView.columns};
+  auto categoryAndKind{x.type().GetCategoryAndKind()};
+  RUNTIME_CHECK(terminator, categoryAndKind.has_value());
+  switch (categoryAndKind->first) {
+  case TypeCategory::Integer:
+    switch (categoryAndKind->second) {
+    case 1:
+      return Matmul(result.OffsetElement<std::int8_t>(), xView, yView, n);
+    case 2:
+      return Matmul(result.OffsetElement<std::int16_t>(), xView, yView, n);
+    case 4:
+      return Matmul(result.OffsetElement<std::int32_t>(), xView, yView, n);
+    case 8:
+      return Matmul(result.OffsetElement<std::int64_t>(), xView, yView, n);
+    }
+    break;
+  case TypeCategory::Real:
+    switch (categoryAndKind->second) {
+    case 4:
+      return Matmul(result.OffsetElement<float>(), xView, yView, n);
+    case 8:
+      return Matmul(result.OffsetElement<double>(), xView, yView, n);
+    }
+    break;
+  case TypeCategory::Complex:
+    switch (categoryAndKind->second) {
+    case 4:
+      return Matmul(
+          result.OffsetElement<std::complex<float>>(), xView, yView, n);
+    case 8:
+      return Matmul(
+          result.OffsetElement<std::complex<double>>(), xView, yView, n);
+    }
+    break;
+  case TypeCategory::Logical:
+    switch (categoryAndKind->second) {
+    case 1:
+      return MatmulLogical(
+          result.OffsetElement<std::int8_t>(), xView, yView, n);
+    case 2:
+      return MatmulLogical(
+          result.OffsetElement<std::int16_t>(), xView, yView, n);
+    case 4:
+      return MatmulLogical(
+          result.OffsetElement<std::int32_t>(), xView, yView, n);
+    case 8:
+      return MatmulLogical(
+          result.OffsetElement<std::int64_t>(), xView, yView, n);
+    }
+    break;
+  default:
+    break;
+  }
+  terminator.Crash("MATMUL: arguments have unsupported type code %d",
+      static_cast<int>(x.type().raw()));
+}
+
+} // extern "C"
+} // namespace Fortran::runtime
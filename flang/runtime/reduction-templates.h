@@ -0,0 +1,126 @@
+//===-- runtime/reduction-templates.h ---------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Arithmetic and loop templates shared by the implementations of the
+// numeric transformational intrinsic functions (SUM, PRODUCT, MAXVAL,
+// MINVAL, DOT_PRODUCT, and MATMUL).  Not part of the runtime API.
+
+#ifndef FORTRAN_RUNTIME_REDUCTION_TEMPLATES_H_
+#define FORTRAN_RUNTIME_REDUCTION_TEMPLATES_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace Fortran::runtime {
+
+// The number of independent partial results kept while reducing contiguous
+// data.  Fortran permits any mathematically equivalent order of evaluation,
+// and breaking the dependence of each operation on the previous one lets
+// compilers vectorize the loops.  16 elements fill two or more vector
+// registers of every supported element type.
+static constexpr std::size_t reductionLanes{16};
+
+template <typename T> struct IsComplex : std::false_type {};
+template <typename T> struct IsComplex<std::complex<T>> : std::true_type {};
+
+// INTEGER arithmetic wraps around on overflow instead of being undefined.
+template <typename T> inline T Add(T x, T y) {
+  if constexpr (std::is_integral_v<T>) {
+    return static_cast<T>(
+        static_cast<std::uint64_t>(x) + static_cast<std::uint64_t>(y));
+  } else {
+    return x + y;
+  }
+}
+
+template <typename T> inline T Multiply(T x, T y) {
+  if constexpr (std::is_integral_v<T>) {
+    return static_cast<T>(
+        static_cast<std::uint64_t>(x) * static_cast<std::uint64_t>(y));
+  } else if constexpr (IsComplex<T>::value) {
+    // Without the recovery of infinities of C99 Annex G, which Fortran does
+    // not require and which keeps std::complex products from being inlined.
+    return T{x.real() * y.real() - x.imag() * y.imag(),
+        x.real() * y.imag() + x.imag() * y.real()};
+  } else {
+    return x * y;
+  }
+}
+
+template <typename T> inline T Conjugate(T x) {
+  if constexpr (IsComplex<T>::value) {
+    return std::conj(x);
+  } else {
+    return x;
+  }
+}
+
+// A LOGICAL value of any kind is true when any of its bytes is nonzero.
+inline bool IsLogicalTrue(const char *p, std::size_t bytes) {
+  for (std::size_t j{0}; j < bytes; ++j) {
+    if (p[j]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reduces n contiguous elements with OP, which provides an identity value
+// and an associative and commutative Combine().
+template <typename OP, typename T>
+inline T ReduceContiguous(const T *x, std::size_t n) {
+  T partial[reductionLanes];
+  for (std::size_t l{0}; l < reductionLanes; ++l) {
+    partial[l] = OP::identity;
+  }
+  std::size_t j{0};
+  for (; j + reductionLanes <= n; j += reductionLanes) {
+    for (std::size_t l{0}; l < reductionLanes; ++l) {
+      partial[l] = OP::Combine(partial[l], x[j + l]);
+    }
+  }
+  T result{OP::identity};
+  for (std::size_t l{0}; l < reductionLanes; ++l) {
+    result = OP::Combine(result, partial[l]);
+  }
+  for (; j < n; ++j) {
+    result = OP::Combine(result, x[j]);
+  }
+  return result;
+}
+
+// The sum of the products of n contiguous elements of x and y, with the
+// elements of x conjugated when CONJUGATE is set (DOT_PRODUCT of COMPLEX).
+template <bool CONJUGATE, typename T>
+inline T DotContiguous(const T *x, const T *y, std::size_t n) {
+  T partial[reductionLanes];
+  for (std::size_t l{0}; l < reductionLanes; ++l) {
+    partial[l] = T{0};
+  }
+  std::size_t j{0};
+  for (; j + reductionLanes <= n; j += reductionLanes) {
+    for (std::size_t l{0}; l < reductionLanes; ++l) {
+      T xj{CONJUGATE ? Conjugate(x[j + l]) : x[j + l]};
+      partial[l] = Add(partial[l], Multiply(xj, y[j + l]));
+    }
+  }
+  T result{0};
+  for (std::size_t l{0}; l < reductionLanes; ++l) {
+    result = Add(result, partial[l]);
+  }
+  for (; j < n; ++j) {
+    T xj{CONJUGATE ? Conjugate(x[j]) : x[j]};
+    result = Add(result, Multiply(xj, y[j]));
+  }
+  return result;
+}
+
+} // namespace Fortran::runtime
+#endif // FORTRAN_RUNTIME_REDUCTION_TEMPLATES_H_
@@ -0,0 +1,567 @@
+//===-- runtime/reduction.cpp ---------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Implements SUM, PRODUCT, MAXVAL, MINVAL, and DOT_PRODUCT.  Contiguous
+// arguments without MASK= are reduced by the vectorizable loops in
+// reduction-templates.h; all others are traversed column by column through
+// their byte strides.
+
+#include "reduction.h"
+#include "descriptor.h"
+#include "reduction-templates.h"
+#include "terminator.h"
+#include <cinttypes>
+#include <limits>
+
+namespace Fortran::runtime {
+
+template <typename T> struct SumOp {
+  static constexpr T identity{0};
+  static T Combine(T x, T y) { return Add(x, y); }
+};
+
+template <typename T> struct ProductOp {
+  static constexpr T identity{1};
+  static T Combine(T x, T y) { return Multiply(x, y); }
+};
+
+// The result of MAXVAL and MINVAL of no elements is the negative and the
+// positive number of the largest magnitude, respectively (F2018 16.9.135,
+// 16.9.141).  Comparisons with NaN are false, so it never replaces a value.
+template <typename T> struct MaxvalOp {
+  static constexpr T identity{std::numeric_limits<T>::lowest()};
+  static T Combine(T x, T y) { return y > x ? y : x; }
+};
+
+template <typename T> struct MinvalOp {
+  static constexpr T identity{std::numeric_limits<T>::max()};
+  static T Combine(T x, T y) { return y < x ? y : x; }
+};
+
+static void CheckType(const Descriptor &array, TypeCategory category,
+    int kind, const char *intrinsic, Terminator &terminator) {
+  if (array.type() != TypeCode{category, kind}) {
+    terminator.Crash("%s: ARRAY= has type code %d, but %d was expected",
+        intrinsic, static_cast<int>(array.type().raw()),
+        static_cast<int>(TypeCode{category, kind}.raw()));
+  }
+}
+
+// Returns the mask to apply element by element, or nullptr when every
+// element takes part.  Sets 'none' when a scalar MASK= is false.
+static const Descriptor *CheckMask(const Descriptor &array,
+    const Descriptor *mask, bool &none, const char *intrinsic,
+    Terminator &terminator) {
+  none = false;
+  if (!mask) {
+    return nullptr;
+  }
+  RUNTIME_CHECK(terminator, mask->type().IsLogical());
+  if (mask->rank() == 0) {
+    none = !IsLogicalTrue(mask->OffsetElement<char>(), mask->ElementBytes());
+    return nullptr;
+  }
+  if (mask->rank() != array.rank()) {
+    terminator.Crash("%s: MASK= has rank %d, but ARRAY= has rank %d",
+        intrinsic, mask->rank(), array.rank());
+  }
+  for (int j{0}; j < array.rank(); ++j) {
+    SubscriptValue arrayExtent{array.GetDimension(j).Extent()};
+    SubscriptValue maskExtent{mask->GetDimension(j).Extent()};
+    if (maskExtent != arrayExtent) {
+      terminator.Crash("%s: MASK= has extent %jd, but ARRAY= has extent %jd "
+                       "on dimension %d",
+          intrinsic, static_cast<std::intmax_t>(maskExtent),
+          static_cast<std::intmax_t>(arrayExtent), j + 1);
+    }
+  }
+  return mask;
+}
+
+// Advances the subscripts of all dimensions but 'dim' (zero-based) to the
+// next element in array element order.
+static void IncrementSubscriptsExcept(
+    const Descriptor &array, SubscriptValue at[], int dim) {
+  for (int j{0}; j < array.rank(); ++j) {
+    if (j != dim) {
+      const Dimension &dimension{array.GetDimension(j)};
+      if (at[j]++ < dimension.UpperBound()) {
+        return;
+      }
+      at[j] = dimension.LowerBound();
+    }
+  }
+}
+
+template <typename OP, typename T>
+static T Reduce(const Descriptor &array, const Descriptor *mask,
+    const char *intrinsic, Terminator &terminator) {
+  bool none;
+  mask = CheckMask(array, mask, none, intrinsic, terminator);
+  std::size_t elements{none ? 0 : array.Elements()};
+  if (!mask && array.IsContiguous()) {
+    return ReduceContiguous<OP>(array.OffsetElement<T>(), elements);
+  }
+  // Walk the array one column (along the first dimension) at a time.
+  T result{OP::identity};
+  if (elements == 0) {
+    return result;
+  }
+  SubscriptValue at[maxRank], maskAt[maxRank];
+  array.GetLowerBounds(at);
+  if (mask) {
+    mask->GetLowerBounds(maskAt);
+  }
+  bool isScalar{array.rank() == 0};
+  std::size_t length(isScalar ? 1 : array.GetDimension(0).Extent());
+  SubscriptValue stride{isScalar ? 0 : array.GetDimension(0).ByteStride()};
+  SubscriptValue maskStride{mask ? mask->GetDimension(0).ByteStride() : 0};
+  std::size_t maskBytes{mask ? mask->ElementBytes() : 0};
+  for (std::size_t columns{elements / length}; columns-- > 0;) {
+    const char *p{array.Element<char>(at)};
+    if (mask) {
+      const char *m{mask->Element<char>(maskAt)};
+      for (std::size_t k{0}; k < length; ++k, p += stride, m += maskStride) {
+        if (IsLogicalTrue(m, maskBytes)) {
+          result = OP::Combine(result, *reinterpret_cast<const T *>(p));
+        }
+      }
+      IncrementSubscriptsExcept(*mask, maskAt, 0);
+    } else {
+      for (std::size_t k{0}; k < length; ++k, p += stride) {
+        result = OP::Combine(result, *reinterpret_cast<const T *>(p));
+      }
+    }
+    IncrementSubscriptsExcept(array, at, 0);
+  }
+  return result;
+}
+
+template <typename OP, typename T>
+static T ReduceToScalar(const Descriptor &array, TypeCategory category,
+    int kind, const char *source, int line, const Descriptor *mask,
+    const char *intrinsic) {
+  Terminator terminator{source, line};
+  CheckType(array, category, kind, intrinsic, terminator);
+  return Reduce<OP, T>(array, mask, intrinsic, terminator);
+}
+
+template <typename OP, typename T>
+static void ReduceDim(Descriptor &result, const Descriptor &array, int dim,
+    const Descriptor *mask, const char *intrinsic, Terminator &terminator) {
+  int rank{array.rank()};
+  if (dim < 1 || dim > rank) {
+    terminator.Crash("%s: DIM=%d is out of range for an array of rank %d",
+        intrinsic, dim, rank);
+  }
+  int zeroBasedDim{dim - 1};
+  // The array is viewed as 'outer' blocks of 'length' slices of 'inner'
+  // elements, of which the result has 'outer' blocks of 'inner' elements.
+  SubscriptValue lb[maxRank], ub[maxRank];
+  std::size_t inner{1}, outer{1};
+  std::size_t length(array.GetDimension(zeroBasedDim).Extent());
+  for (int j{0}, k{0}; j < rank; ++j) {
+    if (j != zeroBasedDim) {
+      SubscriptValue extent{array.GetDimension(j).Extent()};
+      (j < zeroBasedDim ? inner : outer) *= extent;
+      lb[k] = 1;
+      ub[k++] = extent;
+    }
+  }
+  result.Establish(array.type(), array.ElementBytes(), nullptr, rank - 1,
+      nullptr, CFI_attribute_allocatable);
+  if (result.Allocate(lb, ub) != CFI_SUCCESS) {
+    terminator.Crash("%s: could not allocate storage for result", intrinsic);
+  }
+  T *to{result.OffsetElement<T>()};
+  bool none;
+  mask = CheckMask(array, mask, none, intrinsic, terminator);
+  if (none) {
+    length = 0;
+  }
+  if (!mask && array.IsContiguous()) {
+    const T *from{array.OffsetElement<T>()};
+    for (std::size_t o{0}; o < outer; ++o, to += inner) {
+      if (inner == 1) {
+        *to = ReduceContiguous<OP>(from + o * length, length);
+        continue;
+      }
+      // Combine whole slices, which is vectorizable, rather than walking
+      // each result element's elements with a stride of 'inner'.
+      for (std::size_t i{0}; i < inner; ++i) {
+        to[i] = OP::identity;
+      }
+      for (std::size_t k{0}; k < length; ++k) {
+        const T *slice{from + (o * length + k) * inner};
+        for (std::size_t i{0}; i < inner; ++i) {
+          to[i] = OP::Combine(to[i], slice[i]);
+        }
+      }
+    }
+    return;
+  }
+  SubscriptValue at[maxRank], maskAt[maxRank];
+  array.GetLowerBounds(at);
+  if (mask) {
+    mask->GetLowerBounds(maskAt);
+  }
+  SubscriptValue dimLowerBound{array.GetDimension(zeroBasedDim).LowerBound()};
+  SubscriptValue maskDimLowerBound{
+      mask ? mask->GetDimension(zeroBasedDim).LowerBound() : 0};
+  for (std::size_t elements{inner * outer}; elements-- > 0; ++to) {
+    T value{OP::identity};
+    at[zeroBasedDim] = dimLowerBound;
+    maskAt[zeroBasedDim] = maskDimLowerBound;
+    for (std::size_t k{0}; k < length; ++k) {
+      if (!mask ||
+          IsLogicalTrue(mask->Element<char>(maskAt), mask->ElementBytes())) {
+        value = OP::Combine(value, *array.Element<T>(at));
+      }
+      ++at[zeroBasedDim];
+      ++maskAt[zeroBasedDim];
+    }
+    *to = value;
+    IncrementSubscriptsExcept(array, at, zeroBasedDim);
+    if (mask) {
+      IncrementSubscriptsExcept(*mask, maskAt, zeroBasedDim);
+    }
+  }
+}
+
+// Dispatches on the type of ARRAY=; COMPLEX arrays are accepted when
+// HAS_COMPLEX is set.
+template <template <typename> class OP, bool HAS_COMPLEX>
+static void DispatchReduceDim(Descriptor &result, const Descriptor &array,
+    int dim, const char *source, int line, const Descriptor *mask,
+    const char *intrinsic) {
+  Terminator terminator{source, line};
+  auto categoryAndKind{array.type().GetCategoryAndKind()};
+  RUNTIME_CHECK(terminator, categoryAndKind.has_value());
+  switch (categoryAndKind->first) {
+  case TypeCategory::Integer:
+    switch (categoryAndKind->second) {
+    case 1:
+      return ReduceDim<OP<std::int8_t>, std::int8_t>(
+          result, array, dim, mask, intrinsic, terminator);
+    case 2:
+      return ReduceDim<OP<std::int16_t>, std::int16_t>(
+          result, array, dim, mask, intrinsic, terminator);
+    case 4:
+      return ReduceDim<OP<std::int32_t>, std::int32_t>(
+          result, array, dim, mask, intrinsic, terminator);
+    case 8:
+      return ReduceDim<OP<std::int64_t>, std::int64_t>(
+          result, array, dim, mask, intrinsic, terminator);
+    }
+    break;
+  case TypeCategory::Real:
+    switch (categoryAndKind->second) {
+    case 4:
+      return ReduceDim<OP<float>, float>(
+          result, array, dim, mask, intrinsic, terminator);
+    case 8:
+      return ReduceDim<OP<double>, double>(
+          result, array, dim, mask, intrinsic, terminator);
+    }
+    break;
+  case TypeCategory::Complex:
+    if constexpr (HAS_COMPLEX) {
+      switch (categoryAndKind->second) {
+      case 4:
+        return ReduceDim<OP<std::complex<float>>, std::complex<float>>(
+            result, array, dim, mask, intrinsic, terminator);
+      case 8:
+        return ReduceDim<OP<std::complex<double>>, std::complex<double>>(
+            result, array, dim, mask, intrinsic, terminator);
+      }
+    }
+    break;
+  default:
+    break;
+  }
+  terminator.Crash("%s: ARRAY= has unsupported type code %d", intrinsic,
+      static_cast<int>(array.type().raw()));
+}
+
+static void CheckVectors(const Descriptor &x, const Descriptor &y,
+    Terminator &terminator) {
+  if (x.rank() != 1 || y.rank() != 1) {
+    terminator.Crash("DOT_PRODUCT: arguments have ranks %d and %d, not 1",
+        x.rank(), y.rank());
+  }
+  SubscriptValue xExtent{x.GetDimension(0).Extent()};
+  SubscriptValue yExtent{y.GetDimension(0).Extent()};
+  if (xExtent != yExtent) {
+    terminator.Crash("DOT_PRODUCT: arguments have extents %jd and %jd",
+        static_cast<std::intmax_t>(xExtent),
+        static_cast<std::intmax_t>(yExtent));
+  }
+}
+
+template <typename T>
+static T DotProduct(const Descriptor &x, const Descriptor &y,
+    TypeCategory category, int kind, const char *source, int line) {
+  Terminator terminator{source, line};
+  CheckVectors(x, y, terminator);
+  TypeCode type{category, kind};
+  if (x.type() != type || y.type() != type) {
+    terminator.Crash("DOT_PRODUCT: arguments have type codes %d and %d, but "
+                     "%d was expected",
+        static_cast<int>(x.type().raw()), static_cast<int>(y.type().raw()),
+        static_cast<int>(type.raw()));
+  }
+  constexpr bool conjugate{IsComplex<T>::value};
+  std::size_t n(x.GetDimension(0).Extent());
+  if (x.IsContiguous() && y.IsContiguous()) {
+    return DotContiguous<conjugate>(
+        x.OffsetElement<T>(), y.OffsetElement<T>(), n);
+  }
+  const char *xp{x.OffsetElement<char>()}, *yp{y.OffsetElement<char>()};
+  SubscriptValue xStride{x.GetDimension(0).ByteStride()};
+  SubscriptValue yStride{y.GetDimension(0).ByteStride()};
+  T result{0};
+  for (; n-- > 0; xp += xStride, yp += yStride) {
+    T xj{*reinterpret_cast<const T *>(xp)};
+    result = Add(result,
+        Multiply(conjugate ? Conjugate(xj) : xj,
+            *reinterpret_cast<const T *>(yp)));
+  }
+  return result;
+}
+
+extern "C" {
+
+std::int8_t RTNAME(SumInteger1)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<SumOp<std::int8_t>, std::int8_t>(
+      array, TypeCategory::Integer, 1, source, line, mask, "SUM");
+}
+std::int16_t RTNAME(SumInteger2)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<SumOp<std::int16_t>, std::int16_t>(
+      array, TypeCategory::Integer, 2, source, line, mask, "SUM");
+}
+std::int32_t RTNAME(SumInteger4)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<SumOp<std::int32_t>, std::int32_t>(
+      array, TypeCategory::Integer, 4, source, line, mask, "SUM");
+}
+std::int64_t RTNAME(SumInteger8)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<SumOp<std::int64_t>, std::int64_t>(
+      array, TypeCategory::Integer, 8, source, line, mask, "SUM");
+}
+float RTNAME(SumReal4)(const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  return ReduceToScalar<SumOp<float>, float>(
+      array, TypeCategory::Real, 4, source, line, mask, "SUM");
+}
+double RTNAME(SumReal8)(const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  return ReduceToScalar<SumOp<double>, double>(
+      array, TypeCategory::Real, 8, source, line, mask, "SUM");
+}
+void RTNAME(CppSumComplex4)(std::complex<float> &result,
+    const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  result = ReduceToScalar<SumOp<std::complex<float>>, std::complex<float>>(
+      array, TypeCategory::Complex, 4, source, line, mask, "SUM");
+}
+void RTNAME(CppSumComplex8)(std::complex<double> &result,
+    const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  result = ReduceToScalar<SumOp<std::complex<double>>, std::complex<double>>(
+      array, TypeCategory::Complex, 8, source, line, mask, "SUM");
+}
+
+std::int8_t RTNAME(ProductInteger1)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<std::int8_t>, std::int8_t>(
+      array, TypeCategory::Integer, 1, source, line, mask, "PRODUCT");
+}
+std::int16_t RTNAME(ProductInteger2)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<std::int16_t>, std::int16_t>(
+      array, TypeCategory::Integer, 2, source, line, mask, "PRODUCT");
+}
+std::int32_t RTNAME(ProductInteger4)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<std::int32_t>, std::int32_t>(
+      array, TypeCategory::Integer, 4, source, line, mask, "PRODUCT");
+}
+std::int64_t RTNAME(ProductInteger8)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<std::int64_t>, std::int64_t>(
+      array, TypeCategory::Integer, 8, source, line, mask, "PRODUCT");
+}
+float RTNAME(ProductReal4)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<float>, float>(
+      array, TypeCategory::Real, 4, source, line, mask, "PRODUCT");
+}
+double RTNAME(ProductReal8)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<ProductOp<double>, double>(
+      array, TypeCategory::Real, 8, source, line, mask, "PRODUCT");
+}
+void RTNAME(CppProductComplex4)(std::complex<float> &result,
+    const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  result =
+      ReduceToScalar<ProductOp<std::complex<float>>, std::complex<float>>(
+          array, TypeCategory::Complex, 4, source, line, mask, "PRODUCT");
+}
+void RTNAME(CppProductComplex8)(std::complex<double> &result,
+    const Descriptor &array, const char *source, int line,
+    const Descriptor *mask) {
+  result =
+      ReduceToScalar<ProductOp<std::complex<double>>, std::complex<double>>(
+          array, TypeCategory::Complex, 8, source, line, mask, "PRODUCT");
+}
+
+std::int8_t RTNAME(MaxvalInteger1)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<std::int8_t>, std::int8_t>(
+      array, TypeCategory::Integer, 1, source, line, mask, "MAXVAL");
+}
+std::int16_t RTNAME(MaxvalInteger2)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<std::int16_t>, std::int16_t>(
+      array, TypeCategory::Integer, 2, source, line, mask, "MAXVAL");
+}
+std::int32_t RTNAME(MaxvalInteger4)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<std::int32_t>, std::int32_t>(
+      array, TypeCategory::Integer, 4, source, line, mask, "MAXVAL");
+}
+std::int64_t RTNAME(MaxvalInteger8)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<std::int64_t>, std::int64_t>(
+      array, TypeCategory::Integer, 8, source, line, mask, "MAXVAL");
+}
+float RTNAME(MaxvalReal4)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<float>, float>(
+      array, TypeCategory::Real, 4, source, line, mask, "MAXVAL");
+}
+double RTNAME(MaxvalReal8)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<MaxvalOp<double>, double>(
+      array, TypeCategory::Real, 8, source, line, mask, "MAXVAL");
+}
+
+std::int8_t RTNAME(MinvalInteger1)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<std::int8_t>, std::int8_t>(
+      array, TypeCategory::Integer, 1, source, line, mask, "MINVAL");
+}
+std::int16_t RTNAME(MinvalInteger2)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<std::int16_t>, std::int16_t>(
+      array, TypeCategory::Integer, 2, source, line, mask, "MINVAL");
+}
+std::int32_t RTNAME(MinvalInteger4)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<std::int32_t>, std::int32_t>(
+      array, TypeCategory::Integer, 4, source, line, mask, "MINVAL");
+}
+std::int64_t RTNAME(MinvalInteger8)(const Descriptor &array,
+    const char *source, int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<std::int64_t>, std::int64_t>(
+      array, TypeCategory::Integer, 8, source, line, mask, "MINVAL");
+}
+float RTNAME(MinvalReal4)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<float>, float>(
+      array, TypeCategory::Real, 4, source, line, mask, "MINVAL");
+}
+double RTNAME(MinvalReal8)(const Descriptor &array, const char *source,
+    int line, const Descriptor *mask) {
+  return ReduceToScalar<MinvalOp<double>, double>(
+      array, TypeCategory::Real, 8, source, line, mask, "MINVAL");
+}
+
+void RTNAME(SumDim)(Descriptor &result, const Descriptor &array, int dim,
+    const char *source, int line, const Descriptor *mask) {
+  DispatchReduceDim<SumOp, true>(
+      result, array, dim, source, line, mask, "SUM");
+}
+void RTNAME(ProductDim)(Descriptor &result, const Descriptor &array, int dim,
+    const char *source, int line, const Descriptor *mask) {
+  DispatchReduceDim<ProductOp, true>(
+      result, array, dim, source, line, mask, "PRODUCT");
+}
+void RTNAME(MaxvalDim)(Descriptor &result, const Descriptor &array, int dim,
+    const char *source, int line, const Descriptor *mask) {
+  DispatchReduceDim<MaxvalOp, false>(
+      result, array, dim, source, line, mask, "MAXVAL");
+}
+void RTNAME(MinvalDim)(Descriptor &result, const Descriptor &array, int dim,
+    const char *source, int line, const Descriptor *mask) {
+  DispatchReduceDim<MinvalOp, false>(
+      result, array, dim, source, line, mask, "MINVAL");
+}
+
+std::int8_t RTNAME(DotProductInteger1)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<std::int8_t>(x, y, TypeCategory::Integer, 1, source, line);
+}
+std::int16_t RTNAME(DotProductInteger2)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<std::int16_t>(
+      x, y, TypeCategory::Integer, 2, source, line);
+}
+std::int32_t RTNAME(DotProductInteger4)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<std::int32_t>(
+      x, y, TypeCategory::Integer, 4, source, line);
+}
+std::int64_t RTNAME(DotProductInteger8)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<std::int64_t>(
+      x, y, TypeCategory::Integer, 8, source, line);
+}
+float RTNAME(DotProductReal4)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<float>(x, y, TypeCategory::Real, 4, source, line);
+}
+double RTNAME(DotProductReal8)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  return DotProduct<double>(x, y, TypeCategory::Real, 8, source, line);
+}
+void RTNAME(CppDotProductComplex4)(std::complex<float> &result,
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  result = DotProduct<std::complex<float>>(
+      x, y, TypeCategory::Complex, 4, source, line);
+}
+void RTNAME(CppDotProductComplex8)(std::complex<double> &result,
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  result = DotProduct<std::complex<double>>(
+      x, y, TypeCategory::Complex, 8, source, line);
+}
+
+bool RTNAME(DotProductLogical)(
+    const Descriptor &x, const Descriptor &y, const char *source, int line) {
+  Terminator terminator{source, line};
+  CheckVectors(x, y, terminator);
+  RUNTIME_CHECK(terminator, x.type().IsLogical() && y.type().IsLogical());
+  std::size_t xBytes{x.ElementBytes()}, yBytes{y.ElementBytes()};
+  const char *xp{x.OffsetElement<char>()}, *yp{y.OffsetElement<char>()};
+  SubscriptValue xStride{x.GetDimension(0).ByteStride()};
+  SubscriptValue yStride{y.GetDimension(0).ByteStride()};
+  for (auto n{x.GetDimension(0).Extent()}; n-- > 0;
+       xp += xStride, yp += yStride) {
+    if (IsLogicalTrue(xp, xBytes) && IsLogicalTrue(yp, yBytes)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // extern "C"
+} // namespace Fortran::runtime
@@ -23,6 +23,9 @@ static UnitMap *unitMap{nullptr};
 static ExternalFileUnit *defaultInput{nullptr};
 static ExternalFileUnit *defaultOutput{nullptr};
 
+// Unformatted transfers of at least this many bytes bypass the buffer.
+static constexpr std::size_t directTransferBytes{64 << 10};
+
 void FlushOutputOnCrash(const Terminator &terminator) {
   if (!defaultOutput) {
     return;
@@ -253,15 +256,28 @@ bool ExternalFileUnit::Emit(const char *data, std::size_t bytes,
         static_cast<std::intmax_t>(*recordLength));
     return false;
   }
-  WriteFrame(frameOffsetInFile_, recordOffsetInFrame_ + furthestAfter, handler);
-  if (positionInRecord > furthestPositionInRecord) {
-    std::memset(Frame() + recordOffsetInFrame_ + furthestPositionInRecord, ' ',
-        positionInRecord - furthestPositionInRecord);
-  }
-  char *to{Frame() + recordOffsetInFrame_ + positionInRecord};
-  std::memcpy(to, data, bytes);
-  if (swapEndianness_) {
-    SwapEndianness(to, bytes, elementBytes);
+  // The frame begins at the current position, or at the end of the data
+  // already in the record if there's a gap to be filled, rather than at the
+  // start of the record; so records larger than the buffer are streamed.
+  auto recordAt{frameOffsetInFile_ + recordOffsetInFrame_};
+  auto frameStart{std::min(positionInRecord, furthestPositionInRecord)};
+  if (bytes >= directTransferBytes && !swapEndianness_ &&
+      positionInRecord <= furthestPositionInRecord) {
+    if (WriteDirectly(recordAt + positionInRecord, data, bytes, handler) <
+        bytes) {
+      return false; // error has been signaled
+    }
+  } else {
+    WriteFrame(recordAt + frameStart, positionInRecord + bytes - frameStart,
+        handler);
+    if (positionInRecord > furthestPositionInRecord) {
+      std::memset(Frame(), ' ', positionInRecord - furthestPositionInRecord);
+    }
+    char *to{Frame() + (positionInRecord - frameStart)};
+    std::memcpy(to, data, bytes);
+    if (swapEndianness_) {
+      SwapEndianness(to, bytes, elementBytes);
+    }
   }
   positionInRecord += bytes;
   furthestPositionInRecord = furthestAfter;
@@ -280,10 +296,14 @@ bool ExternalFileUnit::Receive(char *data, std::size_t bytes,
         static_cast<std::intmax_t>(*recordLength));
     return false;
   }
-  auto need{recordOffsetInFrame_ + furthestAfter};
-  auto got{ReadFrame(frameOffsetInFile_, need, handler)};
-  if (got >= need) {
-    std::memcpy(data, Frame() + recordOffsetInFrame_ + positionInRecord, bytes);
+  auto at{frameOffsetInFile_ + recordOffsetInFrame_ + positionInRecord};
+  std::size_t got;
+  if (bytes >= directTransferBytes) {
+    got = ReadDirectly(at, data, bytes, handler);
+  } else if ((got = ReadFrame(at, bytes, handler)) >= bytes) {
+    std::memcpy(data, Frame(), bytes);
+  }
+  if (got >= bytes) {
     if (swapEndianness_) {
       SwapEndianness(data, bytes, elementBytes);
     }
@@ -527,15 +547,24 @@ void ExternalFileUnit::BeginSequentialVariableUnformattedInputRecord(
   } else {
     std::memcpy(&header, Frame() + recordOffsetInFrame_, sizeof header);
     recordLength = sizeof header + header; // does not include footer
-    need = recordOffsetInFrame_ + *recordLength + sizeof footer;
-    got = ReadFrame(frameOffsetInFile_, need, handler);
+    // A small record is read into the frame now, along with its footer;
+    // only the footer of a large one is read, and its data are read
+    // as they are transferred.
+    auto footerAt{recordOffsetInFrame_ + *recordLength};
+    auto frameAt{frameOffsetInFile_};
+    if (header >= 0 &&
+        static_cast<std::size_t>(header) >= directTransferBytes) {
+      frameAt += footerAt;
+      footerAt = 0;
+    }
+    need = footerAt + sizeof footer;
+    got = ReadFrame(frameAt, need, handler);
     if (got < need) {
       error = "Unformatted variable-length sequential file input failed at "
               "record #%jd (file offset %jd): hit EOF reading record with "
               "length %jd bytes";
     } else {
-      std::memcpy(&footer, Frame() + recordOffsetInFrame_ + *recordLength,
-          sizeof footer);
+      std::memcpy(&footer, Frame() + footerAt, sizeof footer);
       if (footer != header) {
         error = "Unformatted variable-length sequential file input failed at "
                 "record #%jd (file offset %jd): record header has length %jd "
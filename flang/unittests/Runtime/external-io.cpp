@@ -1,13 +1,18 @@
 // Sanity test for all external I/O modes
 
 #include "testing.h"
+#include "../../runtime/descriptor.h"
 #include "../../runtime/io-api.h"
 #include "../../runtime/main.h"
 #include "../../runtime/stop.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
+using namespace Fortran::runtime;
 using namespace Fortran::runtime::io;
+using Fortran::common::TypeCategory;
 
 void TestDirectUnformatted() {
   llvm::errs() << "begin TestDirectUnformatted()\n";
@@ -452,6 +457,125 @@ void TestSequentialVariableFormatted() {
   llvm::errs() << "end TestSequentialVariableFormatted()\n";
 }
 
+void TestSequentialVariableUnformattedLarge() {
+  llvm::errs() << "begin TestSequentialVariableUnformattedLarge()\n";
+  // OPEN(NEWUNIT=unit,ACCESS='SEQUENTIAL',ACTION='READWRITE',&
+  //   FORM='UNFORMATTED',STATUS='SCRATCH')
+  auto io{IONAME(BeginOpenNewUnit)(__FILE__, __LINE__)};
+  IONAME(SetAccess)
+  (io, "SEQUENTIAL", 10) || (Fail() << "SetAccess(SEQUENTIAL)", 0);
+  IONAME(SetAction)
+  (io, "READWRITE", 9) || (Fail() << "SetAction(READWRITE)", 0);
+  IONAME(SetForm)
+  (io, "UNFORMATTED", 11) || (Fail() << "SetForm(UNFORMATTED)", 0);
+  IONAME(SetStatus)(io, "SCRATCH", 7) || (Fail() << "SetStatus(SCRATCH)", 0);
+  int unit{-1};
+  IONAME(GetNewUnit)(io, unit) || (Fail() << "GetNewUnit()", 0);
+  llvm::errs() << "unit=" << unit << '\n';
+  IONAME(EndIoStatement)
+  (io) == IostatOk || (Fail() << "EndIoStatement() for OpenNewUnit", 0);
+  // Each record is much larger than the unit's buffer, and is written as a
+  // scalar, a contiguous array, the odd elements of that array, and another
+  // scalar, so that large transfers and gathered sections both appear
+  // between small items.
+  static constexpr int records{3};
+  static constexpr SubscriptValue n{1 << 18};
+  std::vector<std::int64_t> buffer(n);
+  StaticDescriptor<1> staticDescriptor;
+  Descriptor &odd{staticDescriptor.descriptor()};
+  SubscriptValue oddExtent{n / 2};
+  odd.Establish(TypeCategory::Integer, sizeof buffer[0], &buffer[1], 1,
+      &oddExtent, CFI_attribute_pointer);
+  odd.GetDimension(0).SetByteStride(2 * sizeof buffer[0]);
+  for (int j{1}; j <= records; ++j) {
+    // WRITE(UNIT=unit) J, BUFFER, BUFFER(2::2), -J
+    for (SubscriptValue k{0}; k < n; ++k) {
+      buffer[k] = j * n + k;
+    }
+    std::int64_t first{j}, last{-j};
+    io = IONAME(BeginUnformattedOutput)(unit, __FILE__, __LINE__);
+    (IONAME(OutputUnformattedBlock)(io,
+         reinterpret_cast<const char *>(&first), sizeof first, sizeof first) &&
+        IONAME(OutputUnformattedBlock)(io,
+            reinterpret_cast<const char *>(buffer.data()),
+            n * sizeof buffer[0], sizeof buffer[0]) &&
+        IONAME(OutputDescriptor)(io, odd) &&
+        IONAME(OutputUnformattedBlock)(io,
+            reinterpret_cast<const char *>(&last), sizeof last,
+            sizeof last)) ||
+        (Fail() << "output of large record " << j, 0);
+    IONAME(EndIoStatement)
+    (io) == IostatOk ||
+        (Fail() << "EndIoStatement() for large record output", 0);
+  }
+  std::vector<std::int64_t> rest(n);
+  auto readRecord{[&](int j) {
+    // READ(UNIT=unit) FIRST, BUFFER(2::2), REST, LAST
+    std::fill(buffer.begin(), buffer.end(), -1);
+    std::fill(rest.begin(), rest.end(), -1);
+    std::int64_t first{0}, last{0};
+    io = IONAME(BeginUnformattedInput)(unit, __FILE__, __LINE__);
+    (IONAME(InputUnformattedBlock)(io, reinterpret_cast<char *>(&first),
+         sizeof first, sizeof first) &&
+        IONAME(InputDescriptor)(io, odd) &&
+        IONAME(InputUnformattedBlock)(io,
+            reinterpret_cast<char *>(rest.data()), n * sizeof rest[0],
+            sizeof rest[0]) &&
+        IONAME(InputUnformattedBlock)(io, reinterpret_cast<char *>(&last),
+            sizeof last, sizeof last)) ||
+        (Fail() << "input of large record " << j, 0);
+    IONAME(EndIoStatement)
+    (io) == IostatOk ||
+        (Fail() << "EndIoStatement() for large record input", 0);
+    if (first != j || last != -j) {
+      Fail() << "Read back " << first << " and " << last
+             << " around large record " << j << '\n';
+    }
+    // BUFFER(2::2) holds the first half of the array as written, and REST
+    // its second half followed by its odd elements.
+    for (SubscriptValue k{0}; k < n; ++k) {
+      std::int64_t expect{k % 2 ? j * n + k / 2 : -1};
+      if (buffer[k] != expect) {
+        Fail() << "Read back BUFFER(" << k << ")=" << buffer[k]
+               << " from large record " << j << ", expected " << expect
+               << '\n';
+        break;
+      }
+      expect = k < oddExtent ? j * n + oddExtent + k
+                             : j * n + 1 + 2 * (k - oddExtent);
+      if (rest[k] != expect) {
+        Fail() << "Read back REST(" << k << ")=" << rest[k]
+               << " from large record " << j << ", expected " << expect
+               << '\n';
+        break;
+      }
+    }
+  }};
+  // REWIND(UNIT=unit)
+  io = IONAME(BeginRewind)(unit, __FILE__, __LINE__);
+  IONAME(EndIoStatement)
+  (io) == IostatOk || (Fail() << "EndIoStatement() for Rewind", 0);
+  for (int j{1}; j <= records; ++j) {
+    readRecord(j);
+  }
+  for (int j{records}; j >= 1; --j) {
+    // BACKSPACE(unit); READ(unit) ...; BACKSPACE(unit)
+    io = IONAME(BeginBackspace)(unit, __FILE__, __LINE__);
+    IONAME(EndIoStatement)
+    (io) == IostatOk || (Fail() << "EndIoStatement() for Backspace", 0);
+    readRecord(j);
+    io = IONAME(BeginBackspace)(unit, __FILE__, __LINE__);
+    IONAME(EndIoStatement)
+    (io) == IostatOk || (Fail() << "EndIoStatement() for Backspace", 0);
+  }
+  // CLOSE(UNIT=unit,STATUS='DELETE')
+  io = IONAME(BeginClose)(unit, __FILE__, __LINE__);
+  IONAME(SetStatus)(io, "DELETE", 6) || (Fail() << "SetStatus(DELETE)", 0);
+  IONAME(EndIoStatement)
+  (io) == IostatOk || (Fail() << "EndIoStatement() for Close", 0);
+  llvm::errs() << "end TestSequentialVariableUnformattedLarge()\n";
+}
+
 void TestStreamUnformatted() {
   // TODO
 }
@@ -462,6 +586,7 @@ int main() {
   TestDirectUnformattedSwapped();
   TestSequentialFixedUnformatted();
   TestSequentialVariableUnformatted();
+  TestSequentialVariableUnformattedLarge();
   TestDirectFormatted();
   TestSequentialVariableFormatted();
   TestStreamUnformatted();
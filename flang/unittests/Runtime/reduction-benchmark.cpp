@@ -0,0 +1,120 @@
+// Microbenchmarks of SUM, MAXVAL, DOT_PRODUCT, and MATMUL.  Each intrinsic
+// is timed on contiguous arguments, which take the vectorized paths, and on
+// the same values with a stride of two elements, which take the general
+// element-by-element paths.  Not run by default; the number of repetitions
+// is scaled by the optional first argument.
+
+#include "../../runtime/descriptor.h"
+#include "../../runtime/matmul.h"
+#include "../../runtime/reduction.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Fortran::runtime;
+using Fortran::common::TypeCategory;
+
+static double sink;
+
+template <typename F>
+static void Time(const char *what, std::size_t operations, int repetitions,
+    const F &function) {
+  function(); // warm up
+  auto start{std::chrono::steady_clock::now()};
+  for (int j{0}; j < repetitions; ++j) {
+    function();
+  }
+  std::chrono::duration<double> elapsed{
+      std::chrono::steady_clock::now() - start};
+  std::printf("%-40s %10.3f ms %10.3f Gop/s\n", what,
+      1e3 * elapsed.count() / repetitions,
+      1e-9 * operations * repetitions / elapsed.count());
+}
+
+static OwningPtr<Descriptor> MakeArray(TypeCategory category, int kind,
+    void *data, std::vector<SubscriptValue> extents, SubscriptValue stride) {
+  auto result{Descriptor::Create(category, kind, data,
+      static_cast<int>(extents.size()), extents.data())};
+  // Scale all strides, so that each dimension keeps its layout.
+  for (int j{0}; j < result->rank(); ++j) {
+    Dimension &dimension{result->GetDimension(j)};
+    dimension.SetByteStride(dimension.ByteStride() * stride);
+  }
+  return result;
+}
+
+template <typename T, int KIND>
+static void BenchmarkReductions(
+    const char *type, TypeCategory category, int scale) {
+  constexpr SubscriptValue n{1 << 20};
+  std::vector<T> data(2 * n);
+  for (SubscriptValue j{0}; j < 2 * n; ++j) {
+    data[j] = static_cast<T>(j % 1000);
+  }
+  char name[64];
+  for (SubscriptValue stride : {1, 2}) {
+    auto x{MakeArray(category, KIND, data.data(), {n}, stride)};
+    const char *layout{stride == 1 ? "contiguous" : "strided"};
+    std::snprintf(name, sizeof name, "SUM %s %s", type, layout);
+    Time(name, n, 20 * scale, [&]() {
+      if constexpr (KIND == 4) {
+        sink += RTNAME(SumReal4)(*x, __FILE__, __LINE__);
+      } else {
+        sink += RTNAME(SumReal8)(*x, __FILE__, __LINE__);
+      }
+    });
+    std::snprintf(name, sizeof name, "MAXVAL %s %s", type, layout);
+    Time(name, n, 20 * scale, [&]() {
+      if constexpr (KIND == 4) {
+        sink += RTNAME(MaxvalReal4)(*x, __FILE__, __LINE__);
+      } else {
+        sink += RTNAME(MaxvalReal8)(*x, __FILE__, __LINE__);
+      }
+    });
+    std::snprintf(name, sizeof name, "DOT_PRODUCT %s %s", type, layout);
+    Time(name, 2 * n, 20 * scale, [&]() {
+      if constexpr (KIND == 4) {
+        sink += RTNAME(DotProductReal4)(*x, *x, __FILE__, __LINE__);
+      } else {
+        sink += RTNAME(DotProductReal8)(*x, *x, __FILE__, __LINE__);
+      }
+    });
+  }
+}
+
+template <typename T, int KIND>
+static void BenchmarkMatmul(const char *type, int scale) {
+  StaticDescriptor<2> staticResult;
+  Descriptor &result{staticResult.descriptor()};
+  char name[64];
+  for (SubscriptValue n : {16, 64, 256}) {
+    std::vector<T> x(2 * n * n), y(2 * n * n);
+    for (SubscriptValue j{0}; j < 2 * n * n; ++j) {
+      x[j] = static_cast<T>(j % 7);
+      y[j] = static_cast<T>(j % 5);
+    }
+    int repetitions{static_cast<int>(scale * (1 << 24) / (n * n * n)) + 1};
+    for (SubscriptValue stride : {1, 2}) {
+      auto xArray{MakeArray(TypeCategory::Real, KIND, x.data(), {n, n}, stride)};
+      auto yArray{MakeArray(TypeCategory::Real, KIND, y.data(), {n, n}, stride)};
+      std::snprintf(name, sizeof name, "MATMUL %s %jdx%jd %s", type,
+          static_cast<std::intmax_t>(n), static_cast<std::intmax_t>(n),
+          stride == 1 ? "contiguous" : "strided");
+      Time(name, 2 * n * n * n, repetitions, [&]() {
+        RTNAME(Matmul)(result, *xArray, *yArray, __FILE__, __LINE__);
+        sink += *result.OffsetElement<T>();
+        result.Deallocate();
+      });
+    }
+  }
+}
+
+int main(int argc, const char *argv[]) {
+  int scale{argc > 1 ? std::atoi(argv[1]) : 1};
+  BenchmarkReductions<float, 4>("REAL(4)", TypeCategory::Real, scale);
+  BenchmarkReductions<double, 8>("REAL(8)", TypeCategory::Real, scale);
+  BenchmarkMatmul<float, 4>("REAL(4)", scale);
+  BenchmarkMatmul<double, 8>("REAL(8)", scale);
+  return sink == 0.5; // keep the results alive
+}
@@ -0,0 +1,340 @@
+// Tests of the numeric transformational intrinsic functions SUM, PRODUCT,
+// MAXVAL, MINVAL, DOT_PRODUCT, and MATMUL.  Each is applied to contiguous
+// arrays, which take the vectorized paths, and to strided or masked ones,
+// which are traversed element by element, and compared with simple loops.
+
+#include "../../runtime/descriptor.h"
+#include "../../runtime/matmul.h"
+#include "../../runtime/reduction.h"
+#include "testing.h"
+#include <cinttypes>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace Fortran::runtime;
+using Fortran::common::TypeCategory;
+
+static OwningPtr<Descriptor> MakeArray(TypeCategory category, int kind,
+    void *data, std::vector<SubscriptValue> extents) {
+  return Descriptor::Create(
+      category, kind, data, static_cast<int>(extents.size()), extents.data());
+}
+
+// Sets the byte stride of dimension 'dim' to 'factor' times its current one.
+static void Stretch(Descriptor &array, int dim, SubscriptValue factor) {
+  Dimension &dimension{array.GetDimension(dim)};
+  dimension.SetByteStride(dimension.ByteStride() * factor);
+}
+
+static void TestWholeArrayReductions() {
+  constexpr int n{1000};
+  std::vector<double> data(2 * n);
+  for (int j{0}; j < 2 * n; ++j) {
+    data[j] = j + 1;
+  }
+  auto contiguous{MakeArray(TypeCategory::Real, 8, data.data(), {n})};
+  if (double sum{RTNAME(SumReal8)(*contiguous, __FILE__, __LINE__)};
+      sum != n * (n + 1) / 2) {
+    Fail() << "SUM of 1.." << n << " is " << sum << '\n';
+  }
+  // Every other element: 1, 3, 5, ...
+  auto strided{MakeArray(TypeCategory::Real, 8, data.data(), {n})};
+  Stretch(*strided, 0, 2);
+  if (double sum{RTNAME(SumReal8)(*strided, __FILE__, __LINE__)};
+      sum != double{n} * n) {
+    Fail() << "SUM of odd elements is " << sum << '\n';
+  }
+  if (double max{RTNAME(MaxvalReal8)(*strided, __FILE__, __LINE__)};
+      max != 2 * n - 1) {
+    Fail() << "MAXVAL of odd elements is " << max << '\n';
+  }
+
+  // MASK= selecting the elements 2, 4, 6, ...
+  std::vector<std::int8_t> maskData(n);
+  for (int j{0}; j < n; ++j) {
+    maskData[j] = j % 2;
+  }
+  auto mask{MakeArray(TypeCategory::Logical, 1, maskData.data(), {n})};
+  if (double sum{RTNAME(SumReal8)(*contiguous, __FILE__, __LINE__, &*mask)};
+      sum != double{n / 2} * (n / 2 + 1)) {
+    Fail() << "SUM with MASK= is " << sum << '\n';
+  }
+  if (double min{
+          RTNAME(MinvalReal8)(*contiguous, __FILE__, __LINE__, &*mask)};
+      min != 2) {
+    Fail() << "MINVAL with MASK= is " << min << '\n';
+  }
+  std::int8_t falseValue{0};
+  auto falseMask{MakeArray(TypeCategory::Logical, 1, &falseValue, {})};
+  if (double sum{
+          RTNAME(SumReal8)(*contiguous, __FILE__, __LINE__, &*falseMask)};
+      sum != 0) {
+    Fail() << "SUM with MASK=.FALSE. is " << sum << '\n';
+  }
+
+  // INTEGER overflow wraps around.
+  std::int32_t ints[]{std::numeric_limits<std::int32_t>::max(), 1};
+  auto intArray{MakeArray(TypeCategory::Integer, 4, ints, {2})};
+  if (RTNAME(SumInteger4)(*intArray, __FILE__, __LINE__) !=
+      std::numeric_limits<std::int32_t>::min()) {
+    Fail() << "SUM of INTEGER(4) does not wrap around\n";
+  }
+  std::int64_t factors[20];
+  for (int j{0}; j < 20; ++j) {
+    factors[j] = j + 1;
+  }
+  auto factorArray{MakeArray(TypeCategory::Integer, 8, factors, {20})};
+  if (RTNAME(ProductInteger8)(*factorArray, __FILE__, __LINE__) !=
+      2432902008176640000) {
+    Fail() << "PRODUCT of 1..20 is wrong\n";
+  }
+
+  // NaN never becomes the result of MAXVAL or MINVAL, and empty arrays give
+  // the values of the largest magnitude.
+  float reals[]{1, std::nanf(""), 3, -2};
+  auto realArray{MakeArray(TypeCategory::Real, 4, reals, {4})};
+  if (RTNAME(MaxvalReal4)(*realArray, __FILE__, __LINE__) != 3 ||
+      RTNAME(MinvalReal4)(*realArray, __FILE__, __LINE__) != -2) {
+    Fail() << "MAXVAL or MINVAL with a NaN element is wrong\n";
+  }
+  auto emptyArray{MakeArray(TypeCategory::Real, 4, reals, {0})};
+  if (RTNAME(MaxvalReal4)(*emptyArray, __FILE__, __LINE__) !=
+          -std::numeric_limits<float>::max() ||
+      RTNAME(MinvalReal4)(*emptyArray, __FILE__, __LINE__) !=
+          std::numeric_limits<float>::max()) {
+    Fail() << "MAXVAL or MINVAL of an empty array is wrong\n";
+  }
+
+  std::complex<double> complexes[]{{1, 2}, {3, -4}, {0.5, 0.25}};
+  auto complexArray{MakeArray(TypeCategory::Complex, 8, complexes, {3})};
+  std::complex<double> complexSum;
+  RTNAME(CppSumComplex8)(complexSum, *complexArray, __FILE__, __LINE__);
+  if (complexSum != std::complex<double>{4.5, -1.75}) {
+    Fail() << "SUM of COMPLEX(8) is (" << complexSum.real() << ','
+           << complexSum.imag() << ")\n";
+  }
+}
+
+// SUM(a, DIM=) and MAXVAL(a, DIM=, MASK=) of the 3x4 matrix
+//   1  4  7 10
+//   2  5  8 11
+//   3  6  9 12
+static void TestReductionsWithDim() {
+  std::int32_t data[12];
+  for (int j{0}; j < 12; ++j) {
+    data[j] = j + 1;
+  }
+  std::int32_t columnSums[]{6, 15, 24, 33};
+  std::int32_t rowSums[]{22, 26, 30};
+  auto matrix{MakeArray(TypeCategory::Integer, 4, data, {3, 4})};
+  // The same matrix through a transposed view of its storage as a 4x3 array.
+  auto transposed{MakeArray(TypeCategory::Integer, 4, data, {4, 3})};
+  transposed->GetDimension(0).SetByteStride(3 * sizeof(std::int32_t));
+  transposed->GetDimension(1).SetByteStride(sizeof(std::int32_t));
+
+  StaticDescriptor<1> staticResult;
+  Descriptor &result{staticResult.descriptor()};
+  struct {
+    const Descriptor &array;
+    int dim;
+    const std::int32_t *expect;
+    SubscriptValue extent;
+  } cases[]{{*matrix, 1, columnSums, 4}, {*matrix, 2, rowSums, 3},
+      {*transposed, 1, rowSums, 3}, {*transposed, 2, columnSums, 4}};
+  for (const auto &c : cases) {
+    RTNAME(SumDim)(result, c.array, c.dim, __FILE__, __LINE__);
+    if (result.rank() != 1 || result.GetDimension(0).Extent() != c.extent) {
+      Fail() << "SUM(DIM=" << c.dim << ") has the wrong shape\n";
+    } else {
+      for (int j{0}; j < c.extent; ++j) {
+        if (std::int32_t x{*result.OffsetElement<std::int32_t>(
+                j * sizeof(std::int32_t))};
+            x != c.expect[j]) {
+          Fail() << "SUM(DIM=" << c.dim << ")(" << j + 1 << ") is " << x
+                 << ", should be " << c.expect[j] << '\n';
+        }
+      }
+    }
+    result.Deallocate();
+  }
+
+  // Only the odd elements take part.
+  std::int8_t maskData[12];
+  for (int j{0}; j < 12; ++j) {
+    maskData[j] = data[j] % 2;
+  }
+  auto mask{MakeArray(TypeCategory::Logical, 1, maskData, {3, 4})};
+  std::int32_t rowMaxima[]{7, 11, 9};
+  RTNAME(MaxvalDim)(result, *matrix, 2, __FILE__, __LINE__, &*mask);
+  for (int j{0}; j < 3; ++j) {
+    if (std::int32_t x{result.OffsetElement<std::int32_t>()[j]};
+        x != rowMaxima[j]) {
+      Fail() << "MAXVAL(DIM=2, MASK=)(" << j + 1 << ") is " << x
+             << ", should be " << rowMaxima[j] << '\n';
+    }
+  }
+  result.Deallocate();
+
+  // A vector reduces to a scalar.
+  auto vector{MakeArray(TypeCategory::Integer, 4, data, {12})};
+  RTNAME(SumDim)(result, *vector, 1, __FILE__, __LINE__);
+  if (result.rank() != 0 || *result.OffsetElement<std::int32_t>() != 78) {
+    Fail() << "SUM(vector, DIM=1) is wrong\n";
+  }
+  result.Deallocate();
+}
+
+static void TestDotProduct() {
+  constexpr int n{100};
+  std::vector<double> x(2 * n), y(n);
+  for (int j{0}; j < n; ++j) {
+    x[2 * j] = j;
+    x[2 * j + 1] = -1;
+    y[j] = 2;
+  }
+  auto xStrided{MakeArray(TypeCategory::Real, 8, x.data(), {n})};
+  Stretch(*xStrided, 0, 2);
+  auto yArray{MakeArray(TypeCategory::Real, 8, y.data(), {n})};
+  if (double dot{RTNAME(DotProductReal8)(*xStrided, *yArray)};
+      dot != n * (n - 1)) {
+    Fail() << "DOT_PRODUCT of a strided vector is " << dot << '\n';
+  }
+  auto xContiguous{MakeArray(TypeCategory::Real, 8, x.data(), {2 * n})};
+  auto yTwice{MakeArray(TypeCategory::Real, 8, x.data(), {2 * n})};
+  double expect{0};
+  for (double v : x) {
+    expect += v * v;
+  }
+  if (double dot{RTNAME(DotProductReal8)(*xContiguous, *yTwice)};
+      dot != expect) {
+    Fail() << "DOT_PRODUCT of contiguous vectors is " << dot << '\n';
+  }
+
+  // The elements of the first COMPLEX vector are conjugated.
+  std::complex<float> i[]{{0, 1}};
+  auto iArray{MakeArray(TypeCategory::Complex, 4, i, {1})};
+  std::complex<float> complexDot;
+  RTNAME(CppDotProductComplex4)(complexDot, *iArray, *iArray);
+  if (complexDot != std::complex<float>{1, 0}) {
+    Fail() << "DOT_PRODUCT of COMPLEX(4) is (" << complexDot.real() << ','
+           << complexDot.imag() << ")\n";
+  }
+
+  std::int8_t l1[]{1, 0, 1};
+  std::int64_t l8[]{0, 1, 0};
+  auto l1Array{MakeArray(TypeCategory::Logical, 1, l1, {3})};
+  auto l8Array{MakeArray(TypeCategory::Logical, 8, l8, {3})};
+  if (RTNAME(DotProductLogical)(*l1Array, *l8Array) ||
+      !RTNAME(DotProductLogical)(*l1Array, *l1Array)) {
+    Fail() << "DOT_PRODUCT of LOGICAL is wrong\n";
+  }
+}
+
+template <typename T>
+static void CheckMatmul(const Descriptor &result, const std::vector<T> &x,
+    const std::vector<T> &y, SubscriptValue rows, SubscriptValue n,
+    SubscriptValue columns, const char *what) {
+  for (SubscriptValue j{0}; j < columns; ++j) {
+    for (SubscriptValue i{0}; i < rows; ++i) {
+      T expect{0};
+      for (SubscriptValue k{0}; k < n; ++k) {
+        expect += x[i + k * rows] * y[k + j * n];
+      }
+      if (T got{result.OffsetElement<T>()[i + j * rows]}; got != expect) {
+        Fail() << "MATMUL of " << what << ": element (" << i + 1 << ','
+               << j + 1 << ") is " << got << ", should be " << expect << '\n';
+        return;
+      }
+    }
+  }
+}
+
+static void TestMatmul() {
+  // Larger than the blocks of the kernel in both the rows and the inner
+  // dimension.
+  constexpr SubscriptValue rows{150}, n{70}, columns{5};
+  std::vector<double> x(rows * n), y(n * columns), xT(n * rows);
+  for (SubscriptValue k{0}; k < n; ++k) {
+    for (SubscriptValue i{0}; i < rows; ++i) {
+      x[i + k * rows] = xT[k + i * n] = (i * 7 + k * 3) % 11 - 5;
+    }
+    for (SubscriptValue j{0}; j < columns; ++j) {
+      y[k + j * n] = (k + j * 5) % 13 - 6;
+    }
+  }
+  StaticDescriptor<2> staticResult;
+  Descriptor &result{staticResult.descriptor()};
+
+  auto xArray{MakeArray(TypeCategory::Real, 8, x.data(), {rows, n})};
+  auto yArray{MakeArray(TypeCategory::Real, 8, y.data(), {n, columns})};
+  RTNAME(Matmul)(result, *xArray, *yArray, __FILE__, __LINE__);
+  if (result.rank() != 2 || result.GetDimension(0).Extent() != rows ||
+      result.GetDimension(1).Extent() != columns) {
+    Fail() << "MATMUL of matrices has the wrong shape\n";
+  } else {
+    CheckMatmul(result, x, y, rows, n, columns, "matrices");
+  }
+  result.Deallocate();
+
+  // X as the transpose of the storage of xT, which is not contiguous by
+  // columns and is multiplied element by element.
+  auto xTransposed{MakeArray(TypeCategory::Real, 8, xT.data(), {rows, n})};
+  xTransposed->GetDimension(0).SetByteStride(n * sizeof(double));
+  xTransposed->GetDimension(1).SetByteStride(sizeof(double));
+  RTNAME(Matmul)(result, *xTransposed, *yArray, __FILE__, __LINE__);
+  CheckMatmul(result, x, y, rows, n, columns, "a transposed matrix");
+  result.Deallocate();
+
+  // Matrix times vector, and vector times matrix.
+  auto yVector{MakeArray(TypeCategory::Real, 8, y.data(), {n})};
+  RTNAME(Matmul)(result, *xArray, *yVector, __FILE__, __LINE__);
+  if (result.rank() != 1 || result.GetDimension(0).Extent() != rows) {
+    Fail() << "MATMUL of a matrix and a vector has the wrong shape\n";
+  } else {
+    CheckMatmul(result, x, y, rows, n, 1, "a matrix and a vector");
+  }
+  result.Deallocate();
+  std::vector<double> xRow(n);
+  for (SubscriptValue k{0}; k < n; ++k) {
+    xRow[k] = x[k * rows];
+  }
+  auto xVector{MakeArray(TypeCategory::Real, 8, xRow.data(), {n})};
+  RTNAME(Matmul)(result, *xVector, *yArray, __FILE__, __LINE__);
+  if (result.rank() != 1 || result.GetDimension(0).Extent() != columns) {
+    Fail() << "MATMUL of a vector and a matrix has the wrong shape\n";
+  } else {
+    CheckMatmul(result, xRow, y, 1, n, columns, "a vector and a matrix");
+  }
+  result.Deallocate();
+
+  std::vector<std::int32_t> xInt(x.begin(), x.end()), yInt(y.begin(), y.end());
+  auto xIntArray{MakeArray(TypeCategory::Integer, 4, xInt.data(), {rows, n})};
+  auto yIntArray{
+      MakeArray(TypeCategory::Integer, 4, yInt.data(), {n, columns})};
+  RTNAME(Matmul)(result, *xIntArray, *yIntArray, __FILE__, __LINE__);
+  CheckMatmul(result, xInt, yInt, rows, n, columns, "INTEGER(4) matrices");
+  result.Deallocate();
+
+  // [T F; F F] x [F T; T F] = [F T; F F]
+  std::int8_t lx[]{1, 0, 0, 0}, ly[]{0, 1, 1, 0}, lExpect[]{0, 0, 1, 0};
+  auto lxArray{MakeArray(TypeCategory::Logical, 1, lx, {2, 2})};
+  auto lyArray{MakeArray(TypeCategory::Logical, 1, ly, {2, 2})};
+  RTNAME(Matmul)(result, *lxArray, *lyArray, __FILE__, __LINE__);
+  for (int j{0}; j < 4; ++j) {
+    if (result.OffsetElement<std::int8_t>()[j] != lExpect[j]) {
+      Fail() << "MATMUL of LOGICAL(1) matrices is wrong\n";
+      break;
+    }
+  }
+  result.Deallocate();
+}
+
+int main() {
+  StartTests();
+  TestWholeArrayReductions();
+  TestReductionsWithDim();
+  TestDotProduct();
+  TestMatmul();
+  return EndTests();
+}
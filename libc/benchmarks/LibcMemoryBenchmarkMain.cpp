@@ -17,17 +17,25 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace __llvm_libc {
 
 extern void *memcpy(void *__restrict, const void *__restrict, size_t);
 extern void *memset(void *, int, size_t);
+extern int memcmp(const void *, const void *, size_t);
+extern void *memchr(const void *, int, size_t);
+extern size_t strlen(const char *);
+extern char *strchr(const char *, int);
+extern int strcmp(const char *, const char *);
 
 } // namespace __llvm_libc
 
 namespace llvm {
 namespace libc_benchmarks {
 
-enum Function { memcpy, memset };
+enum Function { memcpy, memset, memcmp, memchr, strlen, strchr, strcmp };
 
 static cl::opt<std::string>
     StudyName("study-name", cl::desc("The name for this study"), cl::Required);
@@ -35,9 +43,19 @@ static cl::opt<std::string>
 static cl::opt<Function>
     MemoryFunction("function", cl::desc("Sets the function to benchmark:"),
                    cl::values(clEnumVal(memcpy, "__llvm_libc::memcpy"),
-                              clEnumVal(memset, "__llvm_libc::memset")),
+                              clEnumVal(memset, "__llvm_libc::memset"),
+                              clEnumVal(memcmp, "__llvm_libc::memcmp"),
+                              clEnumVal(memchr, "__llvm_libc::memchr"),
+                              clEnumVal(strlen, "__llvm_libc::strlen"),
+                              clEnumVal(strchr, "__llvm_libc::strchr"),
+                              clEnumVal(strcmp, "__llvm_libc::strcmp")),
                    cl::Required);
 
+static cl::opt<bool>
+    SystemLibc("system-libc",
+               cl::desc("Benchmark the function of the C library the tool is "
+                        "linked with (e.g. glibc) instead of llvm-libc's"));
+
 static cl::opt<std::string>
     SizeDistributionName("size-distribution-name",
                          cl::desc("The name of the distribution to use"));
@@ -75,6 +93,11 @@ struct ParameterType {
   unsigned SizeBytes : 16;   // max : 16 KiB - 1
 };
 
+// Returns the implementation to benchmark.
+template <typename T> static T *pick(T *LlvmLibc, T *System) {
+  return SystemLibc ? System : LlvmLibc;
+}
+
 struct MemcpyBenchmark {
   static constexpr auto GetDistributions = &getMemcpySizeDistributions;
   static constexpr size_t BufferCount = 2;
@@ -85,12 +108,13 @@ struct MemcpyBenchmark {
 
   inline auto functor() {
     return [this](ParameterType P) {
-      __llvm_libc::memcpy(DstBuffer + P.OffsetBytes, SrcBuffer + P.OffsetBytes,
-                          P.SizeBytes);
+      Memcpy(DstBuffer + P.OffsetBytes, SrcBuffer + P.OffsetBytes,
+             P.SizeBytes);
       return DstBuffer + P.OffsetBytes;
     };
   }
 
+  decltype(&::memcpy) Memcpy = pick(&__llvm_libc::memcpy, &::memcpy);
   AlignedBuffer SrcBuffer;
   AlignedBuffer DstBuffer;
 };
@@ -104,15 +128,149 @@ struct MemsetBenchmark {
 
   inline auto functor() {
     return [this](ParameterType P) {
-      __llvm_libc::memset(DstBuffer + P.OffsetBytes, P.OffsetBytes & 0xFF,
-                          P.SizeBytes);
+      Memset(DstBuffer + P.OffsetBytes, P.OffsetBytes & 0xFF, P.SizeBytes);
       return DstBuffer + P.OffsetBytes;
     };
   }
 
+  decltype(&::memset) Memset = pick(&__llvm_libc::memset, &::memset);
   AlignedBuffer DstBuffer;
 };
 
+// The string benchmarks have no size distributions of their own and use the
+// memcmp ones. The buffers hold the same non null byte everywhere, so that
+// the searches and comparisons go through all `SizeBytes` bytes.
+
+struct MemcmpBenchmark {
+  static constexpr auto GetDistributions = &getMemcmpSizeDistributions;
+  static constexpr size_t BufferCount = 2;
+  static void amend(Study &S) { S.Configuration.Function = "memcmp"; }
+
+  MemcmpBenchmark(const size_t BufferSize)
+      : LhsBuffer(BufferSize), RhsBuffer(BufferSize) {
+    std::fill(LhsBuffer.begin(), LhsBuffer.end(), 'a');
+    std::fill(RhsBuffer.begin(), RhsBuffer.end(), 'a');
+  }
+
+  inline auto functor() {
+    return [this](ParameterType P) {
+      return Memcmp(LhsBuffer + P.OffsetBytes, RhsBuffer + P.OffsetBytes,
+                    P.SizeBytes);
+    };
+  }
+
+  decltype(&::memcmp) Memcmp = pick(&__llvm_libc::memcmp, &::memcmp);
+  AlignedBuffer LhsBuffer;
+  AlignedBuffer RhsBuffer;
+};
+
+struct MemchrBenchmark {
+  static constexpr auto GetDistributions = &getMemcmpSizeDistributions;
+  static constexpr size_t BufferCount = 1;
+  static void amend(Study &S) { S.Configuration.Function = "memchr"; }
+
+  MemchrBenchmark(const size_t BufferSize) : SrcBuffer(BufferSize) {
+    std::fill(SrcBuffer.begin(), SrcBuffer.end(), 'a');
+  }
+
+  inline auto functor() {
+    return [this](ParameterType P) {
+      return Memchr(SrcBuffer + P.OffsetBytes, 'b', P.SizeBytes);
+    };
+  }
+
+  // The C++ library overloads memchr and strchr on constness.
+  const void *(*Memchr)(const void *, int, size_t) =
+      pick<const void *(const void *, int, size_t)>(
+          [](const void *S, int C, size_t N) -> const void * {
+            return __llvm_libc::memchr(S, C, N);
+          },
+          [](const void *S, int C, size_t N) -> const void * {
+            return ::memchr(S, C, N);
+          });
+  AlignedBuffer SrcBuffer;
+};
+
+// The functions on null terminated strings get a terminator written at
+// `SizeBytes` for the duration of the call.
+struct StrlenBenchmark {
+  static constexpr auto GetDistributions = &getMemcmpSizeDistributions;
+  static constexpr size_t BufferCount = 1;
+  static void amend(Study &S) { S.Configuration.Function = "strlen"; }
+
+  StrlenBenchmark(const size_t BufferSize) : SrcBuffer(BufferSize) {
+    std::fill(SrcBuffer.begin(), SrcBuffer.end(), 'a');
+  }
+
+  inline auto functor() {
+    return [this](ParameterType P) {
+      char *End = SrcBuffer + P.OffsetBytes + P.SizeBytes;
+      *End = '\0';
+      const size_t Length = Strlen(SrcBuffer + P.OffsetBytes);
+      *End = 'a';
+      return Length;
+    };
+  }
+
+  decltype(&::strlen) Strlen = pick(&__llvm_libc::strlen, &::strlen);
+  AlignedBuffer SrcBuffer;
+};
+
+struct StrchrBenchmark {
+  static constexpr auto GetDistributions = &getMemcmpSizeDistributions;
+  static constexpr size_t BufferCount = 1;
+  static void amend(Study &S) { S.Configuration.Function = "strchr"; }
+
+  StrchrBenchmark(const size_t BufferSize) : SrcBuffer(BufferSize) {
+    std::fill(SrcBuffer.begin(), SrcBuffer.end(), 'a');
+  }
+
+  inline auto functor() {
+    return [this](ParameterType P) {
+      char *End = SrcBuffer + P.OffsetBytes + P.SizeBytes;
+      *End = '\0';
+      const char *Found = Strchr(SrcBuffer + P.OffsetBytes, 'b');
+      *End = 'a';
+      return Found;
+    };
+  }
+
+  const char *(*Strchr)(const char *, int) =
+      pick<const char *(const char *, int)>(
+          [](const char *S, int C) -> const char * {
+            return __llvm_libc::strchr(S, C);
+          },
+          [](const char *S, int C) -> const char * { return ::strchr(S, C); });
+  AlignedBuffer SrcBuffer;
+};
+
+struct StrcmpBenchmark {
+  static constexpr auto GetDistributions = &getMemcmpSizeDistributions;
+  static constexpr size_t BufferCount = 2;
+  static void amend(Study &S) { S.Configuration.Function = "strcmp"; }
+
+  StrcmpBenchmark(const size_t BufferSize)
+      : LhsBuffer(BufferSize), RhsBuffer(BufferSize) {
+    std::fill(LhsBuffer.begin(), LhsBuffer.end(), 'a');
+    std::fill(RhsBuffer.begin(), RhsBuffer.end(), 'a');
+  }
+
+  inline auto functor() {
+    return [this](ParameterType P) {
+      const size_t End = P.OffsetBytes + P.SizeBytes;
+      LhsBuffer[End] = RhsBuffer[End] = '\0';
+      const int Result =
+          Strcmp(LhsBuffer + P.OffsetBytes, RhsBuffer + P.OffsetBytes);
+      LhsBuffer[End] = RhsBuffer[End] = 'a';
+      return Result;
+    };
+  }
+
+  decltype(&::strcmp) Strcmp = pick(&__llvm_libc::strcmp, &::strcmp);
+  AlignedBuffer LhsBuffer;
+  AlignedBuffer RhsBuffer;
+};
+
 template <typename Benchmark> struct Harness : Benchmark {
   using Benchmark::functor;
 
@@ -319,6 +477,16 @@ std::unique_ptr<IBenchmark> getMemfunctionBenchmark() {
     return std::make_unique<MemfunctionBenchmark<MemcpyBenchmark>>();
   case memset:
     return std::make_unique<MemfunctionBenchmark<MemsetBenchmark>>();
+  case memcmp:
+    return std::make_unique<MemfunctionBenchmark<MemcmpBenchmark>>();
+  case memchr:
+    return std::make_unique<MemfunctionBenchmark<MemchrBenchmark>>();
+  case strlen:
+    return std::make_unique<MemfunctionBenchmark<StrlenBenchmark>>();
+  case strchr:
+    return std::make_unique<MemfunctionBenchmark<StrchrBenchmark>>();
+  case strcmp:
+    return std::make_unique<MemfunctionBenchmark<StrcmpBenchmark>>();
   }
 }
 
@@ -0,0 +1,64 @@
+//===-- Implementation of memcmp for RISC-V -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/memcmp.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/riscv/word_utils.h"
+
+namespace __llvm_libc {
+
+using riscv::kWordSize;
+using riscv::Word;
+
+static int CompareBytes(const unsigned char *lhs, const unsigned char *rhs,
+                        size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    if (lhs[i] != rhs[i])
+      return lhs[i] - rhs[i];
+  return 0;
+}
+
+// Compares a word at a time when `lhs` and `rhs` can be aligned together,
+// which is the common case of buffers coming from the allocator. The first
+// differing byte of two unequal words is found from their xor, with a single
+// `ctz` when Zbb is available.
+static int memcmp_riscv(const unsigned char *lhs, const unsigned char *rhs,
+                        size_t count) {
+  if (count < 2 * kWordSize ||
+      offset_from_last_aligned<kWordSize>(lhs) !=
+          offset_from_last_aligned<kWordSize>(rhs))
+    return CompareBytes(lhs, rhs, count);
+
+  const size_t head = offset_to_next_aligned<kWordSize>(lhs);
+  if (int result = CompareBytes(lhs, rhs, head))
+    return result;
+  lhs += head;
+  rhs += head;
+  count -= head;
+
+  for (; count >= kWordSize; count -= kWordSize) {
+    const Word l = riscv::LoadWord(reinterpret_cast<const char *>(lhs));
+    const Word r = riscv::LoadWord(reinterpret_cast<const char *>(rhs));
+    if (l != r) {
+      const size_t index = riscv::FirstNonZeroByte(l ^ r);
+      return lhs[index] - rhs[index];
+    }
+    lhs += kWordSize;
+    rhs += kWordSize;
+  }
+  return CompareBytes(lhs, rhs, count);
+}
+
+LLVM_LIBC_FUNCTION(int, memcmp,
+                   (const void *lhs, const void *rhs, size_t count)) {
+  return memcmp_riscv(reinterpret_cast<const unsigned char *>(lhs),
+                      reinterpret_cast<const unsigned char *>(rhs), count);
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,124 @@
+//===-- Implementation of memcpy for RISC-V -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/memcpy.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/riscv/word_utils.h"
+
+namespace __llvm_libc {
+
+using riscv::kWordSize;
+using riscv::Word;
+
+// Snitch and PULP clusters have a DMA engine driven by the Xdma instructions.
+// Copies of at least LLVM_LIBC_MEMCPY_RISCV_USE_XDMA_FROM_SIZE bytes are
+// offloaded to it; the core waits for the transfer to finish.
+#ifdef LLVM_LIBC_MEMCPY_RISCV_USE_XDMA_FROM_SIZE
+constexpr size_t kXdmaSize = LLVM_LIBC_MEMCPY_RISCV_USE_XDMA_FROM_SIZE;
+
+static void CopyXdma(char *__restrict dst, const char *__restrict src,
+                     size_t count) {
+  size_t id;
+  asm volatile("dmsrc %0, zero" : : "r"(src));
+  asm volatile("dmdst %0, zero" : : "r"(dst));
+  asm volatile("dmcpyi %0, %1, 0" : "=r"(id) : "r"(count));
+  // Status 2 is non zero while the engine is busy.
+  size_t busy;
+  do
+    asm volatile("dmstati %0, 2" : "=r"(busy) : : "memory");
+  while (busy);
+}
+#endif // LLVM_LIBC_MEMCPY_RISCV_USE_XDMA_FROM_SIZE
+
+static void CopyBytes(char *__restrict dst, const char *__restrict src,
+                      size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = src[i];
+}
+
+// Both `dst` and `src` are word aligned. Copies the largest multiple of the
+// word size that fits in `count`, four words per iteration when possible.
+static size_t CopyAlignedWords(char *__restrict dst, const char *__restrict src,
+                               size_t count) {
+  const size_t words = count / kWordSize;
+  size_t i = 0;
+  for (; i + 4 <= words; i += 4) {
+    const Word w0 = riscv::LoadWordAndIncrement(src);
+    const Word w1 = riscv::LoadWordAndIncrement(src);
+    const Word w2 = riscv::LoadWordAndIncrement(src);
+    const Word w3 = riscv::LoadWordAndIncrement(src);
+    riscv::StoreWordAndIncrement(dst, w0);
+    riscv::StoreWordAndIncrement(dst, w1);
+    riscv::StoreWordAndIncrement(dst, w2);
+    riscv::StoreWordAndIncrement(dst, w3);
+  }
+  for (; i < words; ++i)
+    riscv::StoreWordAndIncrement(dst, riscv::LoadWordAndIncrement(src));
+  return words * kWordSize;
+}
+
+// `dst` is word aligned but `src` is not. Loads aligned words from the source
+// and shifts them into place, so that no access is misaligned. The last load
+// may read past `src + count`, but never past the aligned word holding the
+// last byte to copy.
+static size_t CopyShiftedWords(char *__restrict dst, const char *__restrict src,
+                               size_t count) {
+  const size_t offset = offset_from_last_aligned<kWordSize>(src);
+  const size_t low_shift = 8 * offset;
+  const size_t high_shift = 8 * (kWordSize - offset);
+  const char *aligned_src = src - offset;
+  const size_t words = count / kWordSize;
+  Word current = riscv::LoadWordAndIncrement(aligned_src);
+  for (size_t i = 0; i < words; ++i) {
+    const Word next = riscv::LoadWordAndIncrement(aligned_src);
+    riscv::StoreWordAndIncrement(dst,
+                                 (current >> low_shift) | (next << high_shift));
+    current = next;
+  }
+  return words * kWordSize;
+}
+
+// Design rationale
+// ================
+//
+// Misaligned accesses are slow or trap on most RISC-V cores, so unlike the
+// generic implementation this one does not use overlapping unaligned blocks.
+// Short copies are done byte by byte. Longer copies first align `dst`, then
+// move whole words, shifting them into place when `src` has a different
+// alignment, and finish with the remaining bytes.
+static void memcpy_riscv(char *__restrict dst, const char *__restrict src,
+                         size_t count) {
+#ifdef LLVM_LIBC_MEMCPY_RISCV_USE_XDMA_FROM_SIZE
+  if (count >= kXdmaSize)
+    return CopyXdma(dst, src, count);
+#endif
+  if (count < 2 * kWordSize)
+    return CopyBytes(dst, src, count);
+
+  const size_t head = offset_to_next_aligned<kWordSize>(dst);
+  CopyBytes(dst, src, head);
+  dst += head;
+  src += head;
+  count -= head;
+
+  const size_t copied = offset_from_last_aligned<kWordSize>(src) == 0
+                            ? CopyAlignedWords(dst, src, count)
+                            : CopyShiftedWords(dst, src, count);
+  CopyBytes(dst + copied, src + copied, count - copied);
+}
+
+LLVM_LIBC_FUNCTION(void *, memcpy,
+                   (void *__restrict dst, const void *__restrict src,
+                    size_t size)) {
+  memcpy_riscv(reinterpret_cast<char *>(dst),
+               reinterpret_cast<const char *>(src), size);
+  return dst;
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,55 @@
+//===-- Implementation of memset for RISC-V -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/memset.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/riscv/word_utils.h"
+
+namespace __llvm_libc {
+
+using riscv::kWordSize;
+using riscv::Word;
+
+static void SetBytes(char *dst, unsigned char value, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    dst[i] = value;
+}
+
+// Same strategy as memcpy: bytes up to the first aligned word, whole words,
+// then the remaining bytes.
+static void memset_riscv(char *dst, unsigned char value, size_t count) {
+  if (count < 2 * kWordSize)
+    return SetBytes(dst, value, count);
+
+  const size_t head = offset_to_next_aligned<kWordSize>(dst);
+  SetBytes(dst, value, head);
+  dst += head;
+  count -= head;
+
+  const Word word = riscv::SplatByte(value);
+  const size_t words = count / kWordSize;
+  size_t i = 0;
+  for (; i + 4 <= words; i += 4) {
+    riscv::StoreWordAndIncrement(dst, word);
+    riscv::StoreWordAndIncrement(dst, word);
+    riscv::StoreWordAndIncrement(dst, word);
+    riscv::StoreWordAndIncrement(dst, word);
+  }
+  for (; i < words; ++i)
+    riscv::StoreWordAndIncrement(dst, word);
+  SetBytes(dst, value, count - words * kWordSize);
+}
+
+LLVM_LIBC_FUNCTION(void *, memset, (void *dst, int value, size_t count)) {
+  memset_riscv(reinterpret_cast<char *>(dst), static_cast<unsigned char>(value),
+               count);
+  return dst;
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,38 @@
+//===-- Implementation of strlen for RISC-V -------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/strlen.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/riscv/word_utils.h"
+
+namespace __llvm_libc {
+
+using riscv::kWordSize;
+using riscv::Word;
+
+// Scans bytes up to the first aligned word, then a word at a time. Aligned
+// words never cross a page boundary, so reading the bytes that follow the
+// terminator within its word is safe.
+static size_t strlen_riscv(const char *src) {
+  const char *ptr = src;
+  for (; offset_from_last_aligned<kWordSize>(ptr) != 0; ++ptr)
+    if (*ptr == '\0')
+      return ptr - src;
+
+  Word mask;
+  while ((mask = riscv::OrCombineBytes(riscv::LoadWord(ptr))) == ~Word(0))
+    ptr += kWordSize;
+  return ptr - src + riscv::FirstNonZeroByte(~mask);
+}
+
+LLVM_LIBC_FUNCTION(size_t, strlen, (const char *src)) {
+  return strlen_riscv(src);
+}
+
+} // namespace __llvm_libc
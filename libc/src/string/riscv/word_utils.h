@@ -0,0 +1,108 @@
+//===-- Word-at-a-time helpers for RISC-V string functions ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIBC_SRC_STRING_RISCV_WORD_UTILS_H
+#define LLVM_LIBC_SRC_STRING_RISCV_WORD_UTILS_H
+
+#include "src/string/memory_utils/utils.h"
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uintptr_t
+
+// Base RISC-V implementations are not required to support misaligned loads
+// and stores, and most embedded cores either trap or emulate them in
+// software. The functions in this directory therefore only ever access memory
+// through naturally aligned words, and fall back to bytes at the edges.
+//
+// All RISC-V targets are little-endian, the first byte in memory is the least
+// significant byte of a word.
+
+// PULP cores (RV32 with the Xpulpv2 extension) have loads and stores that
+// increment their address register, which saves one instruction per word in
+// the copy and fill loops.
+#if defined(LLVM_LIBC_RISCV_USE_XPULP) && __riscv_xlen != 32
+#error "Xpulpv2 post-increment loads are only available on RV32"
+#endif
+
+namespace __llvm_libc {
+namespace riscv {
+
+using Word = uintptr_t;
+
+static constexpr size_t kWordSize = sizeof(Word);
+
+// A word with each byte set to `value`.
+static inline Word SplatByte(unsigned char value) {
+  return static_cast<Word>(value) * (~Word(0) / 0xFF);
+}
+
+static inline Word LoadWord(const char *src) {
+  Word word;
+  __builtin_memcpy(&word, assume_aligned<kWordSize>(src), kWordSize);
+  return word;
+}
+
+static inline void StoreWord(char *dst, Word word) {
+  __builtin_memcpy(assume_aligned<kWordSize>(dst), &word, kWordSize);
+}
+
+// Loads the word at `src` and moves `src` to the next word.
+static inline Word LoadWordAndIncrement(const char *__restrict &src) {
+#if defined(LLVM_LIBC_RISCV_USE_XPULP)
+  Word word;
+  asm volatile("p.lw %0, 4(%1!)" : "=r"(word), "+r"(src) : : "memory");
+  return word;
+#else
+  const Word word = LoadWord(src);
+  src += kWordSize;
+  return word;
+#endif
+}
+
+// Stores `word` at `dst` and moves `dst` to the next word.
+static inline void StoreWordAndIncrement(char *__restrict &dst, Word word) {
+#if defined(LLVM_LIBC_RISCV_USE_XPULP)
+  asm volatile("p.sw %1, 4(%0!)" : "+r"(dst) : "r"(word) : "memory");
+#else
+  StoreWord(dst, word);
+  dst += kWordSize;
+#endif
+}
+
+// Returns a word where each byte is 0xFF if the corresponding byte of `word`
+// is non zero, and 0x00 otherwise. With Zbb this is a single `orc.b`.
+static inline Word OrCombineBytes(Word word) {
+#if defined(__riscv_zbb)
+  Word result;
+  asm("orc.b %0, %1" : "=r"(result) : "r"(word));
+  return result;
+#else
+  constexpr Word kLow7Bits = ~Word(0) / 0xFF * 0x7F;
+  // The top bit of each byte of `high` is set iff the byte is non zero.
+  const Word high = (((word & kLow7Bits) + kLow7Bits) | word) & ~kLow7Bits;
+  return (high >> 7) * 0xFF;
+#endif
+}
+
+// Index of the first byte in memory order that is set in `mask`, which must
+// not be zero. Zbb provides `ctz`, the base ISA needs a short loop.
+static inline size_t FirstNonZeroByte(Word mask) {
+#if defined(__riscv_zbb)
+  return static_cast<size_t>(__builtin_ctzl(mask)) / 8;
+#else
+  size_t index = 0;
+  for (; (mask & 0xFF) == 0; mask >>= 8)
+    ++index;
+  return index;
+#endif
+}
+
+} // namespace riscv
+} // namespace __llvm_libc
+
+#endif // LLVM_LIBC_SRC_STRING_RISCV_WORD_UTILS_H
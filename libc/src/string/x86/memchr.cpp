@@ -0,0 +1,48 @@
+//===-- Implementation of memchr for x86 ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/memchr.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/x86/vector_utils.h"
+
+namespace __llvm_libc {
+
+using x86::kVectorSize;
+
+// Scans aligned vectors from the one holding `src`. A match found past the
+// first `n` bytes is ignored, it can only be in the last vector.
+static const char *memchr_x86(const char *src, unsigned char ch, size_t n) {
+  if (n == 0)
+    return nullptr;
+  const x86::Vector needle = x86::SplatByte(ch);
+  const intptr_t offset = offset_from_last_aligned<kVectorSize>(src);
+  const char *ptr = src - offset;
+  uint64_t mask = x86::MatchEqual(x86::LoadAligned(ptr), needle) >> offset;
+  size_t remaining = n;
+  size_t in_vector = kVectorSize - offset;
+  const char *start = src;
+  while (!mask) {
+    if (remaining <= in_vector)
+      return nullptr;
+    remaining -= in_vector;
+    in_vector = kVectorSize;
+    ptr += kVectorSize;
+    start = ptr;
+    mask = x86::MatchEqual(x86::LoadAligned(ptr), needle);
+  }
+  const size_t index = x86::FirstSetByte(mask);
+  return index < remaining ? start + index : nullptr;
+}
+
+LLVM_LIBC_FUNCTION(void *, memchr, (const void *src, int c, size_t n)) {
+  return const_cast<char *>(
+      memchr_x86(reinterpret_cast<const char *>(src), c, n));
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,65 @@
+//===-- Implementation of memcmp for x86 ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/memcmp.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/x86/vector_utils.h"
+
+namespace __llvm_libc {
+
+using x86::kVectorSize;
+
+static int CompareBytes(const unsigned char *lhs, const unsigned char *rhs,
+                        size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    if (lhs[i] != rhs[i])
+      return lhs[i] - rhs[i];
+  return 0;
+}
+
+// Returns the mask of the bytes that differ between the vectors at `lhs` and
+// `rhs`.
+static inline uint64_t MatchDifferent(const char *lhs, const char *rhs) {
+  return x86::MatchEqual(x86::LoadUnaligned(lhs), x86::LoadUnaligned(rhs)) ^
+         x86::kFullMask;
+}
+
+// Compares whole vectors with unaligned loads. The remaining bytes are
+// compared with one more vector unless it could cross into a page that the
+// buffers do not reach, in which case the bytes past `count` are masked off.
+static int memcmp_x86(const char *lhs, const char *rhs, size_t count) {
+  const auto *ulhs = reinterpret_cast<const unsigned char *>(lhs);
+  const auto *urhs = reinterpret_cast<const unsigned char *>(rhs);
+  size_t offset = 0;
+  for (; count - offset >= kVectorSize; offset += kVectorSize) {
+    if (const uint64_t mask = MatchDifferent(lhs + offset, rhs + offset)) {
+      const size_t index = offset + x86::FirstSetByte(mask);
+      return ulhs[index] - urhs[index];
+    }
+  }
+  const size_t tail = count - offset;
+  if (tail == 0)
+    return 0;
+  if (!x86::FitsInPage(lhs + offset) || !x86::FitsInPage(rhs + offset))
+    return CompareBytes(ulhs + offset, urhs + offset, tail);
+  const uint64_t mask = MatchDifferent(lhs + offset, rhs + offset) &
+                        ((uint64_t(1) << tail) - 1);
+  if (!mask)
+    return 0;
+  const size_t index = offset + x86::FirstSetByte(mask);
+  return ulhs[index] - urhs[index];
+}
+
+LLVM_LIBC_FUNCTION(int, memcmp,
+                   (const void *lhs, const void *rhs, size_t count)) {
+  return memcmp_x86(reinterpret_cast<const char *>(lhs),
+                    reinterpret_cast<const char *>(rhs), count);
+}
+
+} // namespace __llvm_libc
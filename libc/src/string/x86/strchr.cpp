@@ -0,0 +1,45 @@
+//===-- Implementation of strchr for x86 ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/strchr.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/x86/vector_utils.h"
+
+namespace __llvm_libc {
+
+using x86::kVectorSize;
+
+// Scans aligned vectors for the first byte that is either `ch` or the
+// terminator, like strlen does.
+static const char *strchr_x86(const char *src, unsigned char ch) {
+  const x86::Vector needle = x86::SplatByte(ch);
+  const x86::Vector zero = x86::SplatByte(0);
+  const auto match = [&](const char *ptr) {
+    const x86::Vector bytes = x86::LoadAligned(ptr);
+    return x86::MatchEqual(bytes, needle) | x86::MatchEqual(bytes, zero);
+  };
+  const intptr_t offset = offset_from_last_aligned<kVectorSize>(src);
+  const char *ptr = src - offset;
+  uint64_t mask = match(ptr) >> offset;
+  if (!mask) {
+    do {
+      ptr += kVectorSize;
+      mask = match(ptr);
+    } while (!mask);
+    src = ptr;
+  }
+  const char *found = src + x86::FirstSetByte(mask);
+  return static_cast<unsigned char>(*found) == ch ? found : nullptr;
+}
+
+LLVM_LIBC_FUNCTION(char *, strchr, (const char *src, int c)) {
+  return const_cast<char *>(strchr_x86(src, c));
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,50 @@
+//===-- Implementation of strcmp for x86 ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/strcmp.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/x86/vector_utils.h"
+
+namespace __llvm_libc {
+
+using x86::kVectorSize;
+
+// Compares a vector of both strings at a time with unaligned loads, stopping
+// at the first byte that differs or terminates `left`. Close to the end of a
+// page, where a vector load could fault past the end of a string, it steps a
+// byte at a time until both strings are in the next page.
+static int strcmp_x86(const char *left, const char *right) {
+  const x86::Vector zero = x86::SplatByte(0);
+  const auto *uleft = reinterpret_cast<const unsigned char *>(left);
+  const auto *uright = reinterpret_cast<const unsigned char *>(right);
+  size_t offset = 0;
+  for (;;) {
+    if (!x86::FitsInPage(left + offset) || !x86::FitsInPage(right + offset)) {
+      if (uleft[offset] != uright[offset] || !uleft[offset])
+        return uleft[offset] - uright[offset];
+      ++offset;
+      continue;
+    }
+    const x86::Vector l = x86::LoadUnaligned(left + offset);
+    const x86::Vector r = x86::LoadUnaligned(right + offset);
+    const uint64_t mask =
+        (x86::MatchEqual(l, r) ^ x86::kFullMask) | x86::MatchEqual(l, zero);
+    if (mask) {
+      const size_t index = offset + x86::FirstSetByte(mask);
+      return uleft[index] - uright[index];
+    }
+    offset += kVectorSize;
+  }
+}
+
+LLVM_LIBC_FUNCTION(int, strcmp, (const char *left, const char *right)) {
+  return strcmp_x86(left, right);
+}
+
+} // namespace __llvm_libc
@@ -0,0 +1,38 @@
+//===-- Implementation of strlen for x86 ----------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "src/string/strlen.h"
+#include "src/__support/common.h"
+#include "src/string/memory_utils/utils.h"
+#include "src/string/x86/vector_utils.h"
+
+namespace __llvm_libc {
+
+using x86::kVectorSize;
+
+// Scans aligned vectors from the one holding `src`, ignoring the bytes that
+// come before the string in the first one.
+static size_t strlen_x86(const char *src) {
+  const x86::Vector zero = x86::SplatByte(0);
+  const intptr_t offset = offset_from_last_aligned<kVectorSize>(src);
+  const char *ptr = src - offset;
+  uint64_t mask = x86::MatchEqual(x86::LoadAligned(ptr), zero) >> offset;
+  if (mask)
+    return x86::FirstSetByte(mask);
+  do {
+    ptr += kVectorSize;
+    mask = x86::MatchEqual(x86::LoadAligned(ptr), zero);
+  } while (!mask);
+  return ptr - src + x86::FirstSetByte(mask);
+}
+
+LLVM_LIBC_FUNCTION(size_t, strlen, (const char *src)) {
+  return strlen_x86(src);
+}
+
+} // namespace __llvm_libc
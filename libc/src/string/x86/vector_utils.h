@@ -0,0 +1,108 @@
+//===-- Vector helpers for x86 string functions -----------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIBC_SRC_STRING_X86_VECTOR_UTILS_H
+#define LLVM_LIBC_SRC_STRING_X86_VECTOR_UTILS_H
+
+#include "src/string/memory_utils/utils.h"
+
+#include <immintrin.h>
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+// The functions in this directory compare a vector of bytes at a time and
+// turn the result into a mask with one bit per byte, the first byte in memory
+// being the least significant bit. The vector is the widest one the target
+// supports: 64 bytes with AVX512BW, 32 bytes with AVX2 and 16 bytes with SSE2,
+// which every x86-64 processor has.
+//
+// Scanning a string of unknown length reads past its end. Aligned vectors
+// never cross a page boundary, so the bytes they read around the string are
+// always mapped.
+#if !defined(__SSE2__)
+#error "The x86 string functions require SSE2"
+#endif
+
+namespace __llvm_libc {
+namespace x86 {
+
+#if defined(__AVX512BW__)
+using Vector = __m512i;
+static constexpr size_t kVectorSize = 64;
+
+static inline Vector LoadAligned(const char *src) {
+  return _mm512_load_si512(assume_aligned<kVectorSize>(src));
+}
+static inline Vector LoadUnaligned(const char *src) {
+  return _mm512_loadu_si512(src);
+}
+static inline Vector SplatByte(unsigned char value) {
+  return _mm512_set1_epi8(static_cast<char>(value));
+}
+static inline uint64_t MatchEqual(Vector a, Vector b) {
+  return _mm512_cmpeq_epi8_mask(a, b);
+}
+#elif defined(__AVX2__)
+using Vector = __m256i;
+static constexpr size_t kVectorSize = 32;
+
+static inline Vector LoadAligned(const char *src) {
+  return _mm256_load_si256(
+      reinterpret_cast<const Vector *>(assume_aligned<kVectorSize>(src)));
+}
+static inline Vector LoadUnaligned(const char *src) {
+  return _mm256_loadu_si256(reinterpret_cast<const Vector *>(src));
+}
+static inline Vector SplatByte(unsigned char value) {
+  return _mm256_set1_epi8(static_cast<char>(value));
+}
+static inline uint64_t MatchEqual(Vector a, Vector b) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+}
+#else
+using Vector = __m128i;
+static constexpr size_t kVectorSize = 16;
+
+static inline Vector LoadAligned(const char *src) {
+  return _mm_load_si128(
+      reinterpret_cast<const Vector *>(assume_aligned<kVectorSize>(src)));
+}
+static inline Vector LoadUnaligned(const char *src) {
+  return _mm_loadu_si128(reinterpret_cast<const Vector *>(src));
+}
+static inline Vector SplatByte(unsigned char value) {
+  return _mm_set1_epi8(static_cast<char>(value));
+}
+static inline uint64_t MatchEqual(Vector a, Vector b) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+}
+#endif
+
+// The mask with a bit set for every byte of a vector.
+static constexpr uint64_t kFullMask =
+    kVectorSize == 64 ? ~uint64_t(0) : (uint64_t(1) << kVectorSize) - 1;
+
+// The smallest page size, the granularity at which memory is mapped.
+static constexpr size_t kPageSize = 4096;
+
+// Whether a vector load at `src` stays within the page of `src`.
+static inline bool FitsInPage(const char *src) {
+  return offset_from_last_aligned<kPageSize>(src) <=
+         static_cast<intptr_t>(kPageSize - kVectorSize);
+}
+
+// Index of the first byte in memory order that is set in `mask`, which must
+// not be zero.
+static inline size_t FirstSetByte(uint64_t mask) {
+  return static_cast<size_t>(__builtin_ctzll(mask));
+}
+
+} // namespace x86
+} // namespace __llvm_libc
+
+#endif // LLVM_LIBC_SRC_STRING_X86_VECTOR_UTILS_H
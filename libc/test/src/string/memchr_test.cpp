@@ -120,3 +120,18 @@ TEST(LlvmLibcMemChrTest, SignedCharacterFound) {
   // Should find the first character 'c'.
   ASSERT_EQ(actual[0], c);
 }
+
+TEST(LlvmLibcMemChrTest, AllAlignmentsAndLengths) {
+  char buffer[160];
+  for (size_t offset = 0; offset < 64; ++offset) {
+    for (size_t length = 1; length < 96; ++length) {
+      for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = 'a';
+      buffer[offset + length - 1] = 'b';
+      const char *src = buffer + offset;
+      ASSERT_EQ(call_memchr(src, 'b', length), src + length - 1);
+      // A match right past the end of the range must not be found.
+      ASSERT_TRUE(call_memchr(src, 'b', length - 1) == nullptr);
+    }
+  }
+}
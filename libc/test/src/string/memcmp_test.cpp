@@ -32,3 +32,26 @@ TEST(LlvmLibcMemcmpTest, LhsAfterRhsLexically) {
   const char *rhs = "ab";
   EXPECT_EQ(__llvm_libc::memcmp(lhs, rhs, 2), 1);
 }
+
+TEST(LlvmLibcMemcmpTest, Sweep) {
+  static constexpr size_t kMaxSize = 136;
+  char lhs[kMaxSize + 8];
+  char rhs[kMaxSize + 8];
+  for (size_t i = 0; i < sizeof(lhs); ++i)
+    lhs[i] = rhs[i] = 'a';
+
+  // Every alignment and position of the first difference, so that
+  // word or vector at a time implementations are exercised on all their
+  // paths.
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t size = 0; size <= kMaxSize; ++size) {
+      EXPECT_EQ(__llvm_libc::memcmp(lhs + offset, rhs + offset, size), 0);
+      for (size_t diff = 0; diff < size; ++diff) {
+        rhs[offset + diff] = 'b';
+        EXPECT_EQ(__llvm_libc::memcmp(lhs + offset, rhs + offset, size), -1);
+        EXPECT_EQ(__llvm_libc::memcmp(rhs + offset, lhs + offset, size), 1);
+        rhs[offset + diff] = 'a';
+      }
+    }
+  }
+}
@@ -8,6 +8,7 @@
 
 #include "src/string/strchr.h"
 #include "utils/UnitTest/Test.h"
+#include <stddef.h>
 
 TEST(LlvmLibcStrChrTest, FindsFirstCharacter) {
   const char *src = "abcde";
@@ -80,3 +81,21 @@ TEST(LlvmLibcStrChrTest, EmptyStringShouldOnlyMatchNullTerminator) {
   ASSERT_STREQ(__llvm_libc::strchr("", '3'), nullptr);
   ASSERT_STREQ(__llvm_libc::strchr("", '*'), nullptr);
 }
+
+TEST(LlvmLibcStrChrTest, AllAlignmentsAndLengths) {
+  char buffer[160];
+  for (size_t offset = 0; offset < 64; ++offset) {
+    for (size_t length = 1; length < 96; ++length) {
+      for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = 'a';
+      buffer[offset + length] = '\0';
+      buffer[offset + length + 1] = 'c';
+      char *src = buffer + offset;
+      buffer[offset + length - 1] = 'b';
+      ASSERT_EQ(__llvm_libc::strchr(src, 'b'), src + length - 1);
+      ASSERT_EQ(__llvm_libc::strchr(src, '\0'), src + length);
+      // Characters past the terminator must not be found.
+      ASSERT_TRUE(__llvm_libc::strchr(src, 'c') == nullptr);
+    }
+  }
+}
@@ -8,6 +8,7 @@
 
 #include "src/string/strcmp.h"
 #include "utils/UnitTest/Test.h"
+#include <stddef.h>
 
 TEST(LlvmLibcStrCmpTest, EmptyStringsShouldReturnZero) {
   const char *s1 = "";
@@ -95,3 +96,24 @@ TEST(LlvmLibcStrCmpTest, StringArgumentSwapChangesSign) {
   // 'a' - 'b' = -1.
   ASSERT_EQ(result, -1);
 }
+
+TEST(LlvmLibcStrCmpTest, AllAlignmentsAndLengths) {
+  char left[160];
+  char right[160];
+  for (size_t offset = 0; offset < 64; ++offset) {
+    for (size_t length = 1; length < 96; ++length) {
+      for (size_t i = 0; i < sizeof(left); ++i)
+        left[i] = right[i] = 'a';
+      left[offset + length] = '\0';
+      right[length] = '\0';
+      // Bytes past the terminators must not be compared.
+      left[offset + length + 1] = 'x';
+      right[length + 1] = 'y';
+      const char *l = left + offset;
+      ASSERT_EQ(__llvm_libc::strcmp(l, right), 0);
+      right[length - 1] = 'b';
+      ASSERT_LT(__llvm_libc::strcmp(l, right), 0);
+      ASSERT_GT(__llvm_libc::strcmp(right, l), 0);
+    }
+  }
+}
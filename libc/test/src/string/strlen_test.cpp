@@ -22,3 +22,15 @@ TEST(LlvmLibcStrLenTest, AnyString) {
   size_t result = __llvm_libc::strlen(any);
   ASSERT_EQ((size_t)12, result);
 }
+
+TEST(LlvmLibcStrLenTest, AllAlignmentsAndLengths) {
+  char buffer[72];
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t length = 0; length < 64; ++length) {
+      for (size_t i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = 'a';
+      buffer[offset + length] = '\0';
+      ASSERT_EQ(__llvm_libc::strlen(buffer + offset), length);
+    }
+  }
+}
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <numeric>
 #include <random>
 #include <string>
 #include <utility>
@@ -38,12 +39,15 @@ enum class Order {
   Descending,
   SingleElement,
   PipeOrgan,
-  Heap
+  Heap,
+  FewUnique,
+  QuickSortAdversary
 };
-struct AllOrders : EnumValuesAsTuple<AllOrders, Order, 6> {
+struct AllOrders : EnumValuesAsTuple<AllOrders, Order, 8> {
   static constexpr const char* Names[] = {"Random",     "Ascending",
                                           "Descending", "SingleElement",
-                                          "PipeOrgan",  "Heap"};
+                                          "PipeOrgan",  "Heap",
+                                          "FewUnique",  "QuickSortAdversary"};
 };
 
 template <typename T>
@@ -102,6 +106,32 @@ void fillValues(std::vector<std::string>& V, size_t N, Order O) {
   }
 }
 
+// Ranks that make std::sort compare as often as it can, found by running it
+// against the adversary from M. D. McIlroy, "A Killer Adversary for Quicksort":
+// every element starts out as "gas" and is only given a value once the
+// algorithm compares it with another gas element.
+std::vector<size_t> getQuickSortAdversaryRanks(size_t N) {
+  const size_t Gas = N;
+  std::vector<size_t> Ranks(N, Gas);
+  std::vector<size_t> Indices(N);
+  std::iota(Indices.begin(), Indices.end(), 0);
+  size_t NumSolid = 0;
+  size_t Candidate = 0;
+  std::sort(Indices.begin(), Indices.end(), [&](size_t X, size_t Y) {
+    if (Ranks[X] == Gas && Ranks[Y] == Gas)
+      Ranks[X == Candidate ? X : Y] = NumSolid++;
+    if (Ranks[X] == Gas)
+      Candidate = X;
+    else if (Ranks[Y] == Gas)
+      Candidate = Y;
+    return Ranks[X] < Ranks[Y];
+  });
+  for (size_t& R : Ranks)
+    if (R == Gas)
+      R = NumSolid++;
+  return Ranks;
+}
+
 template <class T>
 void sortValues(T& V, Order O) {
   assert(std::is_sorted(V.begin(), V.end()));
@@ -128,6 +158,23 @@ void sortValues(T& V, Order O) {
   case Order::Heap:
     std::make_heap(V.begin(), V.end());
     break;
+  case Order::FewUnique: {
+    // Keep 16 distinct values, each repeated in a run, then shuffle.
+    const size_t Run = std::max(size_t{1}, V.size() / 16);
+    for (size_t I = 0; I < V.size(); ++I)
+      V[I] = V[I / Run * Run];
+    std::random_device R;
+    std::mt19937 M(R());
+    std::shuffle(V.begin(), V.end(), M);
+    break;
+  }
+  case Order::QuickSortAdversary: {
+    const std::vector<size_t> Ranks = getQuickSortAdversaryRanks(V.size());
+    const T Sorted = V;
+    for (size_t I = 0; I < V.size(); ++I)
+      V[I] = Sorted[Ranks[I]];
+    break;
+  }
   }
 }
 
@@ -0,0 +1,145 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+constexpr size_t TestNumInputs = 1024;
+
+// Finite values whose bit patterns are uniformly random, which covers the
+// whole exponent range.
+template <class T>
+std::vector<T> getRandomFloatingInputs() {
+  using Bits = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+  std::mt19937_64 Engine(42);
+  std::vector<T> Inputs;
+  while (Inputs.size() < TestNumInputs) {
+    const Bits B = static_cast<Bits>(Engine());
+    T Value;
+    std::memcpy(&Value, &B, sizeof(T));
+    if (Value - Value == 0)
+      Inputs.push_back(Value);
+  }
+  return Inputs;
+}
+
+// Values like the ones humans write, with few significant digits.
+std::vector<double> getShortDecimalInputs() {
+  std::mt19937_64 Engine(42);
+  std::vector<double> Inputs;
+  for (size_t I = 0; I < TestNumInputs; ++I)
+    Inputs.push_back(static_cast<double>(Engine() % 1000000) / 1000);
+  return Inputs;
+}
+
+template <class T>
+void BM_ToCharsShortest(benchmark::State& State, std::chars_format Fmt) {
+  const std::vector<T> Inputs = getRandomFloatingInputs<T>();
+  char Buffer[1024];
+  for (auto _ : State)
+    for (T Value : Inputs)
+      benchmark::DoNotOptimize(std::to_chars(Buffer, Buffer + sizeof(Buffer), Value, Fmt).ptr);
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+
+void BM_ToCharsShortestFloat(benchmark::State& State, std::chars_format Fmt) {
+  BM_ToCharsShortest<float>(State, Fmt);
+}
+BENCHMARK_CAPTURE(BM_ToCharsShortestFloat, scientific, std::chars_format::scientific);
+
+void BM_ToCharsShortestDouble(benchmark::State& State, std::chars_format Fmt) {
+  BM_ToCharsShortest<double>(State, Fmt);
+}
+BENCHMARK_CAPTURE(BM_ToCharsShortestDouble, scientific, std::chars_format::scientific);
+BENCHMARK_CAPTURE(BM_ToCharsShortestDouble, general, std::chars_format::general);
+BENCHMARK_CAPTURE(BM_ToCharsShortestDouble, hex, std::chars_format::hex);
+
+void BM_ToCharsPlain(benchmark::State& State) {
+  const std::vector<double> Inputs = getShortDecimalInputs();
+  char Buffer[1024];
+  for (auto _ : State)
+    for (double Value : Inputs)
+      benchmark::DoNotOptimize(std::to_chars(Buffer, Buffer + sizeof(Buffer), Value).ptr);
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK(BM_ToCharsPlain);
+
+void BM_ToCharsPrecision(benchmark::State& State, std::chars_format Fmt) {
+  const std::vector<double> Inputs = getRandomFloatingInputs<double>();
+  const int Precision = State.range(0);
+  char Buffer[2048];
+  for (auto _ : State)
+    for (double Value : Inputs)
+      benchmark::DoNotOptimize(std::to_chars(Buffer, Buffer + sizeof(Buffer), Value, Fmt, Precision).ptr);
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK_CAPTURE(BM_ToCharsPrecision, scientific, std::chars_format::scientific)->Arg(6)->Arg(17);
+BENCHMARK_CAPTURE(BM_ToCharsPrecision, general, std::chars_format::general)->Arg(6)->Arg(17);
+
+// The same conversion through snprintf, for comparison.
+void BM_SnprintfPrecision(benchmark::State& State) {
+  const std::vector<double> Inputs = getRandomFloatingInputs<double>();
+  const int Precision = State.range(0);
+  char Buffer[2048];
+  for (auto _ : State)
+    for (double Value : Inputs)
+      benchmark::DoNotOptimize(std::snprintf(Buffer, sizeof(Buffer), "%.*e", Precision, Value));
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK(BM_SnprintfPrecision)->Arg(6)->Arg(17);
+
+template <class T>
+std::vector<std::string> getFloatingStrings(const std::vector<T>& Values) {
+  std::vector<std::string> Strings;
+  char Buffer[64];
+  for (T Value : Values)
+    Strings.emplace_back(Buffer, std::to_chars(Buffer, Buffer + sizeof(Buffer), Value).ptr);
+  return Strings;
+}
+
+template <class T>
+void BM_FromChars(benchmark::State& State) {
+  const std::vector<std::string> Inputs = getFloatingStrings(getRandomFloatingInputs<T>());
+  for (auto _ : State) {
+    for (const std::string& Str : Inputs) {
+      T Value;
+      benchmark::DoNotOptimize(std::from_chars(Str.data(), Str.data() + Str.size(), Value).ptr);
+      benchmark::DoNotOptimize(Value);
+    }
+  }
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK_TEMPLATE(BM_FromChars, float);
+BENCHMARK_TEMPLATE(BM_FromChars, double);
+
+void BM_FromCharsShortDecimal(benchmark::State& State) {
+  const std::vector<std::string> Inputs = getFloatingStrings(getShortDecimalInputs());
+  for (auto _ : State) {
+    for (const std::string& Str : Inputs) {
+      double Value;
+      benchmark::DoNotOptimize(std::from_chars(Str.data(), Str.data() + Str.size(), Value).ptr);
+      benchmark::DoNotOptimize(Value);
+    }
+  }
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK(BM_FromCharsShortDecimal);
+
+// The same conversion through strtod, for comparison.
+void BM_Strtod(benchmark::State& State) {
+  const std::vector<std::string> Inputs = getFloatingStrings(getRandomFloatingInputs<double>());
+  for (auto _ : State)
+    for (const std::string& Str : Inputs)
+      benchmark::DoNotOptimize(std::strtod(Str.c_str(), nullptr));
+  State.SetItemsProcessed(State.iterations() * Inputs.size());
+}
+BENCHMARK(BM_Strtod);
+
+BENCHMARK_MAIN();
@@ -9,6 +9,9 @@
 #include "charconv"
 #include <string.h>
 
+#include "include/from_chars_floating_point.h"
+#include "include/to_chars_floating_point.h"
+
 _LIBCPP_BEGIN_NAMESPACE_STD
 
 namespace __itoa
@@ -157,4 +160,59 @@ __u64toa(uint64_t value, char* buffer) _NOEXCEPT
 
 }  // namespace __itoa
 
+// The floating-point overloads. long double is converted as double, which
+// is exact where the two types share a representation.
+
+to_chars_result to_chars(char* __first, char* __last, float __value) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, chars_format{}, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, double __value) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, chars_format{}, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, long double __value) {
+  return __floating_to_chars::__to_chars(__first, __last, static_cast<double>(__value), chars_format{}, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, float __value, chars_format __fmt) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, __fmt, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, double __value, chars_format __fmt) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, __fmt, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, long double __value, chars_format __fmt) {
+  return __floating_to_chars::__to_chars(__first, __last, static_cast<double>(__value), __fmt, 0, false);
+}
+
+to_chars_result to_chars(char* __first, char* __last, float __value, chars_format __fmt, int __precision) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, __fmt, __precision, true);
+}
+
+to_chars_result to_chars(char* __first, char* __last, double __value, chars_format __fmt, int __precision) {
+  return __floating_to_chars::__to_chars(__first, __last, __value, __fmt, __precision, true);
+}
+
+to_chars_result to_chars(char* __first, char* __last, long double __value, chars_format __fmt, int __precision) {
+  return __floating_to_chars::__to_chars(__first, __last, static_cast<double>(__value), __fmt, __precision, true);
+}
+
+from_chars_result from_chars(const char* __first, const char* __last, float& __value, chars_format __fmt) {
+  return __floating_from_chars::__from_chars(__first, __last, __value, __fmt);
+}
+
+from_chars_result from_chars(const char* __first, const char* __last, double& __value, chars_format __fmt) {
+  return __floating_from_chars::__from_chars(__first, __last, __value, __fmt);
+}
+
+from_chars_result from_chars(const char* __first, const char* __last, long double& __value, chars_format __fmt) {
+  double __d;
+  const from_chars_result __r = __floating_from_chars::__from_chars(__first, __last, __d, __fmt);
+  if (__r.ec == errc{})
+    __value = __d;
+  return __r;
+}
+
 _LIBCPP_END_NAMESPACE_STD
@@ -0,0 +1,476 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// The parsing behind the floating-point std::from_chars overloads.
+//
+// Decimal input is converted with the Eisel-Lemire algorithm (Daniel Lemire,
+// "Number Parsing at a Gigabyte per Second", 2021), which finds the correctly
+// rounded value from the first 19 significant digits and a 128-bit power of
+// five for all but a tiny fraction of inputs. Those it cannot decide, such as
+// halfway cases and very long inputs, are rebuilt without a decimal point,
+// which keeps them independent of the locale, and handed to strtod.
+// Hexadecimal input is rounded exactly here.
+
+#ifndef _LIBCPP_SRC_INCLUDE_FROM_CHARS_FLOATING_POINT_H
+#define _LIBCPP_SRC_INCLUDE_FROM_CHARS_FLOATING_POINT_H
+
+#include "__config"
+#include "cerrno"
+#include "cfloat"
+#include "charconv"
+#include "cstdint"
+#include "cstdio"
+#include "cstdlib"
+#include "cstring"
+#include "limits"
+
+#include "include/from_chars_pow5_table.h"
+#include "include/ryu/common.h"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace __floating_from_chars {
+
+template <class _Floating>
+struct __traits;
+
+template <>
+struct __traits<float> {
+  using _Uint = uint32_t;
+  static constexpr int __mantissa_bits = 23;
+  static constexpr int __exponent_bias = 127;
+  static constexpr int __max_biased_exponent = 255;
+  // Decimal exponents q outside [__min_q, __max_q] overflow or underflow
+  // for every 19-digit w in w * 10^q.
+  static constexpr int __min_q = -64;
+  static constexpr int __max_q = 38;
+  // The exact powers of ten, and the largest exact integer, for the fast path.
+  static constexpr int __max_exact_power = 10;
+  static constexpr uint64_t __max_exact_integer = uint64_t(1) << 24;
+
+  static float __from_bits(_Uint __bits) {
+    float __f;
+    memcpy(&__f, &__bits, sizeof(float));
+    return __f;
+  }
+  static float __strto(const char* __str) { return strtof(__str, nullptr); }
+  static float __power_of_ten(int __q) {
+    static constexpr float __powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    return __powers[__q];
+  }
+};
+
+template <>
+struct __traits<double> {
+  using _Uint = uint64_t;
+  static constexpr int __mantissa_bits = 52;
+  static constexpr int __exponent_bias = 1023;
+  static constexpr int __max_biased_exponent = 2047;
+  static constexpr int __min_q = __smallest_power_of_five;
+  static constexpr int __max_q = __largest_power_of_five;
+  static constexpr int __max_exact_power = 22;
+  static constexpr uint64_t __max_exact_integer = uint64_t(1) << 53;
+
+  static double __from_bits(_Uint __bits) {
+    double __d;
+    memcpy(&__d, &__bits, sizeof(double));
+    return __d;
+  }
+  static double __strto(const char* __str) { return strtod(__str, nullptr); }
+  static double __power_of_ten(int __q) {
+    static constexpr double __powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                          1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                          1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return __powers[__q];
+  }
+};
+
+inline bool __is_digit(char __c) { return static_cast<unsigned char>(__c - '0') < 10; }
+
+inline int __hex_value(char __c) {
+  if (__is_digit(__c))
+    return __c - '0';
+  if (__c >= 'a' && __c <= 'f')
+    return __c - 'a' + 10;
+  if (__c >= 'A' && __c <= 'F')
+    return __c - 'A' + 10;
+  return -1;
+}
+
+inline char __to_lower(char __c) { return __c >= 'A' && __c <= 'Z' ? static_cast<char>(__c - 'A' + 'a') : __c; }
+
+// Returns whether [__first, __last) starts with __word, ignoring case.
+inline bool __starts_with(const char* __first, const char* __last, const char* __word) {
+  const size_t __n = strlen(__word);
+  if (static_cast<size_t>(__last - __first) < __n)
+    return false;
+  for (size_t __i = 0; __i < __n; ++__i)
+    if (__to_lower(__first[__i]) != __word[__i])
+      return false;
+  return true;
+}
+
+// The significand of the input, as scanned by __scan_significand.
+struct __significand {
+  const char* __begin;  // The first digit or point.
+  const char* __end;    // One past the last digit or point.
+  // The first significant digits, and whether any nonzero digit was dropped.
+  uint64_t __w;
+  bool __truncated;
+  // The power of the base by which __w must be scaled, before the exponent.
+  int __exponent;
+};
+
+// Scans [digits][.][digits] in base 10 or 16, requiring at least one digit.
+// Returns false if there is none.
+inline bool __scan_significand(const char* __first, const char* __last, bool __hex, __significand& __s) {
+  const int __max_digits = __hex ? 16 : 19;
+  const unsigned __base = __hex ? 16 : 10;
+  const int __digit_exponent = __hex ? 4 : 1;
+  __s.__begin = __first;
+  __s.__w = 0;
+  __s.__truncated = false;
+  __s.__exponent = 0;
+  int __digits = 0;
+  bool __has_digits = false;
+  bool __after_point = false;
+  const char* __ptr = __first;
+  for (; __ptr != __last; ++__ptr) {
+    int __d;
+    if (*__ptr == '.') {
+      if (__after_point)
+        break;
+      __after_point = true;
+      continue;
+    }
+    if (__hex) {
+      __d = __hex_value(*__ptr);
+      if (__d < 0)
+        break;
+    } else {
+      if (!__is_digit(*__ptr))
+        break;
+      __d = *__ptr - '0';
+    }
+    __has_digits = true;
+    if (__digits == 0 && __d == 0) {
+      // A leading zero.
+      if (__after_point)
+        __s.__exponent -= __digit_exponent;
+      continue;
+    }
+    if (__digits < __max_digits) {
+      __s.__w = __s.__w * __base + static_cast<unsigned>(__d);
+      ++__digits;
+      if (__after_point)
+        __s.__exponent -= __digit_exponent;
+    } else {
+      __s.__truncated |= __d != 0;
+      if (!__after_point)
+        __s.__exponent += __digit_exponent;
+    }
+  }
+  __s.__end = __ptr;
+  return __has_digits;
+}
+
+// Scans an exponent [+|-]digits after its marker. Returns the end of the
+// match, which is __first if there are no digits. The value saturates, which
+// keeps the result the same as the exact exponent would give.
+inline const char* __scan_exponent(const char* __first, const char* __last, int& __exponent) {
+  const char* __ptr = __first;
+  bool __negative = false;
+  if (__ptr != __last && (*__ptr == '+' || *__ptr == '-')) {
+    __negative = *__ptr == '-';
+    ++__ptr;
+  }
+  if (__ptr == __last || !__is_digit(*__ptr))
+    return __first;
+  int __value = 0;
+  for (; __ptr != __last && __is_digit(*__ptr); ++__ptr)
+    if (__value < 100000)
+      __value = __value * 10 + (*__ptr - '0');
+  __exponent = __negative ? -__value : __value;
+  return __ptr;
+}
+
+// Computes the bits of w * 10^q rounded to nearest with the Eisel-Lemire
+// algorithm, for w != 0 and q within the table. Returns false if the result
+// cannot be decided this way, or is subnormal or infinite.
+template <class _Floating>
+bool __eisel_lemire(uint64_t __w, int __q, typename __traits<_Floating>::_Uint& __bits) {
+  using _Traits = __traits<_Floating>;
+  constexpr int __mantissa_bits = _Traits::__mantissa_bits;
+  // The bits of the 64-bit product below the mantissa and a rounding bit.
+  constexpr int __shift = 64 - __mantissa_bits - 3;
+  constexpr uint64_t __shift_mask = (uint64_t(1) << __shift) - 1;
+
+  const uint64_t* const __power = __power_of_five_128[__q - __smallest_power_of_five];
+  // floor(log2(10^q)) + bias + 64, from log2(10) ~= 217706 / 2^16.
+  const int64_t __exponent = ((int64_t(217706) * __q) >> 16) + _Traits::__exponent_bias + 64;
+
+  int __lz = 0;
+  while ((__w << __lz) >> 63 == 0)
+    ++__lz;
+  __w <<= __lz;
+
+  uint64_t __upper;
+  uint64_t __lower = __umul128(__w, __power[0], &__upper);
+  if ((__upper & __shift_mask) == __shift_mask && __lower + __w < __lower) {
+    // The truncated power leaves the product too uncertain; use all 128 bits.
+    uint64_t __middle_high;
+    const uint64_t __middle_low = __umul128(__w, __power[1], &__middle_high);
+    const uint64_t __middle = __lower + __middle_high;
+    if (__middle < __lower)
+      ++__upper;
+    if (__middle + 1 == 0 && (__upper & __shift_mask) == __shift_mask && __middle_low + __w < __middle_low)
+      return false;
+    __lower = __middle;
+  }
+
+  const uint64_t __upper_bit = __upper >> 63;
+  uint64_t __mantissa = __upper >> (__upper_bit + __shift);
+  __lz += static_cast<int>(1 ^ __upper_bit);
+
+  // An exact halfway case needs the remaining digits to break the tie.
+  if (__lower == 0 && (__upper & __shift_mask) == 0 && (__mantissa & 3) == 1)
+    return false;
+
+  __mantissa += __mantissa & 1;
+  __mantissa >>= 1;
+  if (__mantissa >= (uint64_t(2) << __mantissa_bits)) {
+    __mantissa = uint64_t(1) << __mantissa_bits;
+    --__lz;
+  }
+  __mantissa &= ~(uint64_t(1) << __mantissa_bits);
+
+  const int64_t __biased_exponent = __exponent - __lz;
+  if (__biased_exponent < 1 || __biased_exponent >= _Traits::__max_biased_exponent)
+    return false;
+  __bits = static_cast<typename _Traits::_Uint>((static_cast<uint64_t>(__biased_exponent) << __mantissa_bits) |
+                                                 __mantissa);
+  return true;
+}
+
+// Converts the decimal significand scaled by 10^__exponent with strtod, for
+// the inputs that __eisel_lemire cannot decide. Returns false on overflow or
+// underflow to zero.
+template <class _Floating>
+bool __slow_decimal(const __significand& __s, int __exponent, _Floating& __value) {
+  // 800 significant digits decide the rounding of any double; whether any of
+  // the remaining digits is nonzero is summarized by one more digit.
+  constexpr int __max_digits = 800;
+  char __buffer[__max_digits + 16];
+  int __length = 0;
+  int __scale = __exponent;
+  bool __after_point = false;
+  bool __truncated = false;
+  for (const char* __ptr = __s.__begin; __ptr != __s.__end; ++__ptr) {
+    if (*__ptr == '.') {
+      __after_point = true;
+      continue;
+    }
+    if (__length == 0 && *__ptr == '0') {
+      if (__after_point)
+        --__scale;
+      continue;
+    }
+    if (__length < __max_digits) {
+      __buffer[__length++] = *__ptr;
+      if (__after_point)
+        --__scale;
+    } else {
+      __truncated |= *__ptr != '0';
+      if (!__after_point)
+        ++__scale;
+    }
+  }
+  if (__truncated) {
+    __buffer[__length++] = '1';
+    --__scale;
+  }
+  snprintf(__buffer + __length, sizeof(__buffer) - __length, "e%d", __scale);
+
+  const int __saved_errno = errno;
+  const _Floating __result = __traits<_Floating>::__strto(__buffer);
+  errno = __saved_errno;
+  if (__result == 0 || __result > numeric_limits<_Floating>::max())
+    return false;
+  __value = __result;
+  return true;
+}
+
+template <class _Floating>
+from_chars_result __decimal(const char* __first, const char* __last, _Floating& __value, chars_format __fmt,
+                            bool __negative) {
+  using _Traits = __traits<_Floating>;
+  __significand __s;
+  if (!__scan_significand(__first, __last, false, __s))
+    return {__first, errc::invalid_argument};
+
+  const char* __end = __s.__end;
+  int __explicit_exponent = 0;
+  const bool __allow_exponent = (static_cast<unsigned>(__fmt) & static_cast<unsigned>(chars_format::scientific)) != 0;
+  if (__allow_exponent && __end != __last && (*__end == 'e' || *__end == 'E')) {
+    // An 'e' without digits is not part of the match.
+    const char* const __exponent_end = __scan_exponent(__end + 1, __last, __explicit_exponent);
+    if (__exponent_end != __end + 1)
+      __end = __exponent_end;
+  }
+  if (__fmt == chars_format::scientific && __end == __s.__end)
+    return {__first, errc::invalid_argument};
+
+  if (__s.__w == 0) {
+    __value = __negative ? -_Floating(0) : _Floating(0);
+    return {__end, errc{}};
+  }
+
+  const int __q = __s.__exponent + __explicit_exponent;
+  if (__q > _Traits::__max_q || __q < _Traits::__min_q)
+    return {__end, errc::result_out_of_range};
+
+  _Floating __result;
+  bool __done = false;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  // Clinger's fast path: both operands and the quotient or product are exact
+  // or correctly rounded.
+  if (!__s.__truncated && __s.__w <= _Traits::__max_exact_integer && __q >= -_Traits::__max_exact_power &&
+      __q <= _Traits::__max_exact_power) {
+    __result = static_cast<_Floating>(__s.__w);
+    if (__q < 0)
+      __result /= _Traits::__power_of_ten(-__q);
+    else
+      __result *= _Traits::__power_of_ten(__q);
+    __done = true;
+  }
+#endif
+  if (!__done) {
+    typename _Traits::_Uint __bits;
+    if (__eisel_lemire<_Floating>(__s.__w, __q, __bits)) {
+      // With dropped digits the value lies between w and w + 1 scaled; both
+      // must round the same way.
+      typename _Traits::_Uint __bits_up;
+      if (!__s.__truncated || (__eisel_lemire<_Floating>(__s.__w + 1, __q, __bits_up) && __bits_up == __bits)) {
+        __result = _Traits::__from_bits(__bits);
+        __done = true;
+      }
+    }
+  }
+  if (!__done && !__slow_decimal(__s, __explicit_exponent, __result))
+    return {__end, errc::result_out_of_range};
+
+  __value = __negative ? -__result : __result;
+  return {__end, errc{}};
+}
+
+template <class _Floating>
+from_chars_result __hexadecimal(const char* __first, const char* __last, _Floating& __value, bool __negative) {
+  using _Traits = __traits<_Floating>;
+  using _Uint = typename _Traits::_Uint;
+  constexpr int __mantissa_bits = _Traits::__mantissa_bits;
+  constexpr int __min_exponent = 1 - _Traits::__exponent_bias;
+
+  __significand __s;
+  if (!__scan_significand(__first, __last, true, __s))
+    return {__first, errc::invalid_argument};
+  const char* __end = __s.__end;
+  int __explicit_exponent = 0;
+  if (__end != __last && (*__end == 'p' || *__end == 'P')) {
+    const char* const __exponent_end = __scan_exponent(__end + 1, __last, __explicit_exponent);
+    if (__exponent_end != __end + 1)
+      __end = __exponent_end;
+  }
+
+  if (__s.__w == 0) {
+    __value = __negative ? -_Floating(0) : _Floating(0);
+    return {__end, errc{}};
+  }
+
+  // The value is __w * 2^__e2, with the top bit of __w set.
+  uint64_t __w = __s.__w;
+  int __lz = 0;
+  while ((__w << __lz) >> 63 == 0)
+    ++__lz;
+  __w <<= __lz;
+  const int __e = __s.__exponent + __explicit_exponent - __lz + 63;
+  if (__e > _Traits::__exponent_bias)
+    return {__end, errc::result_out_of_range};
+
+  // Keep __mantissa_bits + 1 bits, or fewer for a subnormal, and round the
+  // rest to nearest, ties to even.
+  const int __e_clamped = __e < __min_exponent ? __min_exponent : __e;
+  const int __drop = 63 - __mantissa_bits + (__e_clamped - __e);
+  uint64_t __mantissa;
+  bool __round_up;
+  if (__drop >= 64) {
+    __mantissa = 0;
+    // Only a value above half the smallest subnormal rounds up.
+    __round_up = __drop == 64 && (__w > (uint64_t(1) << 63) || __s.__truncated);
+  } else {
+    __mantissa = __w >> __drop;
+    const uint64_t __rest = __w & ((uint64_t(1) << __drop) - 1);
+    const uint64_t __half = uint64_t(1) << (__drop - 1);
+    __round_up = __rest > __half || (__rest == __half && (__s.__truncated || (__mantissa & 1) != 0));
+  }
+  __mantissa += __round_up;
+
+  // A normal mantissa includes the implicit bit, which adds one to the
+  // exponent field; a carry out of it moves to the next binade.
+  _Uint __bits;
+  if (__mantissa >> __mantissa_bits == 0)
+    __bits = static_cast<_Uint>(__mantissa);
+  else
+    __bits = (static_cast<_Uint>(__e_clamped - __min_exponent) << __mantissa_bits) + static_cast<_Uint>(__mantissa);
+  if (__bits == 0 || __bits >> __mantissa_bits >= static_cast<_Uint>(_Traits::__max_biased_exponent))
+    return {__end, errc::result_out_of_range};
+
+  const _Floating __result = _Traits::__from_bits(__bits);
+  __value = __negative ? -__result : __result;
+  return {__end, errc{}};
+}
+
+template <class _Floating>
+from_chars_result __from_chars(const char* __first, const char* __last, _Floating& __value, chars_format __fmt) {
+  const char* __ptr = __first;
+  bool __negative = false;
+  if (__ptr != __last && *__ptr == '-') {
+    __negative = true;
+    ++__ptr;
+  }
+
+  if (__starts_with(__ptr, __last, "inf")) {
+    __ptr += __starts_with(__ptr, __last, "infinity") ? 8 : 3;
+    __value = __negative ? -numeric_limits<_Floating>::infinity() : numeric_limits<_Floating>::infinity();
+    return {__ptr, errc{}};
+  }
+  if (__starts_with(__ptr, __last, "nan")) {
+    __ptr += 3;
+    // An optional (n-char-sequence).
+    if (__ptr != __last && *__ptr == '(') {
+      const char* __seq = __ptr + 1;
+      while (__seq != __last && (__is_digit(*__seq) || *__seq == '_' || (__to_lower(*__seq) >= 'a' && __to_lower(*__seq) <= 'z')))
+        ++__seq;
+      if (__seq != __last && *__seq == ')')
+        __ptr = __seq + 1;
+    }
+    __value = __negative ? -numeric_limits<_Floating>::quiet_NaN() : numeric_limits<_Floating>::quiet_NaN();
+    return {__ptr, errc{}};
+  }
+
+  from_chars_result __r = __fmt == chars_format::hex ? __hexadecimal(__ptr, __last, __value, __negative)
+                                                     : __decimal(__ptr, __last, __value, __fmt, __negative);
+  if (__r.ec == errc::invalid_argument)
+    __r.ptr = __first;
+  return __r;
+}
+
+} // namespace __floating_from_chars
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // _LIBCPP_SRC_INCLUDE_FROM_CHARS_FLOATING_POINT_H
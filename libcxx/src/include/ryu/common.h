@@ -0,0 +1,104 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Helpers shared by the Ryu shortest round-trip conversions, after
+// Ulf Adams, "Ryu: Fast Float-to-String Conversion", PLDI 2018.
+
+#ifndef _LIBCPP_SRC_INCLUDE_RYU_COMMON_H
+#define _LIBCPP_SRC_INCLUDE_RYU_COMMON_H
+
+#include "__config"
+#include "cstdint"
+#include "cstring"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+// Returns the number of decimal digits in __v, which has at most 17 digits.
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __decimal_length17(const uint64_t __v) {
+  if (__v >= 10000000000000000u) { return 17; }
+  if (__v >= 1000000000000000u) { return 16; }
+  if (__v >= 100000000000000u) { return 15; }
+  if (__v >= 10000000000000u) { return 14; }
+  if (__v >= 1000000000000u) { return 13; }
+  if (__v >= 100000000000u) { return 12; }
+  if (__v >= 10000000000u) { return 11; }
+  if (__v >= 1000000000u) { return 10; }
+  if (__v >= 100000000u) { return 9; }
+  if (__v >= 10000000u) { return 8; }
+  if (__v >= 1000000u) { return 7; }
+  if (__v >= 100000u) { return 6; }
+  if (__v >= 10000u) { return 5; }
+  if (__v >= 1000u) { return 4; }
+  if (__v >= 100u) { return 3; }
+  if (__v >= 10u) { return 2; }
+  return 1;
+}
+
+// Returns e == 0 ? 1 : ceil(log_2(5^e)); requires 0 <= e <= 3528.
+inline _LIBCPP_INLINE_VISIBILITY int32_t __pow5bits(const int32_t __e) {
+  return static_cast<int32_t>((static_cast<uint32_t>(__e) * 1217359) >> 19) + 1;
+}
+
+// Returns floor(log_10(2^e)); requires 0 <= e <= 1650.
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __log10Pow2(const int32_t __e) {
+  return (static_cast<uint32_t>(__e) * 78913) >> 18;
+}
+
+// Returns floor(log_10(5^e)); requires 0 <= e <= 2620.
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __log10Pow5(const int32_t __e) {
+  return (static_cast<uint32_t>(__e) * 732923) >> 20;
+}
+
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __float_to_bits(const float __f) {
+  uint32_t __bits;
+  memcpy(&__bits, &__f, sizeof(float));
+  return __bits;
+}
+
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __double_to_bits(const double __d) {
+  uint64_t __bits;
+  memcpy(&__bits, &__d, sizeof(double));
+  return __bits;
+}
+
+// Returns the 128-bit product of __a and __b, storing the high half in
+// *__product_hi.
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __umul128(const uint64_t __a, const uint64_t __b,
+                                                    uint64_t* const __product_hi) {
+#ifndef _LIBCPP_HAS_NO_INT128
+  const __uint128_t __p = static_cast<__uint128_t>(__a) * __b;
+  *__product_hi = static_cast<uint64_t>(__p >> 64);
+  return static_cast<uint64_t>(__p);
+#else
+  const uint32_t __a_lo = static_cast<uint32_t>(__a);
+  const uint32_t __a_hi = static_cast<uint32_t>(__a >> 32);
+  const uint32_t __b_lo = static_cast<uint32_t>(__b);
+  const uint32_t __b_hi = static_cast<uint32_t>(__b >> 32);
+
+  const uint64_t __b00 = static_cast<uint64_t>(__a_lo) * __b_lo;
+  const uint64_t __b01 = static_cast<uint64_t>(__a_lo) * __b_hi;
+  const uint64_t __b10 = static_cast<uint64_t>(__a_hi) * __b_lo;
+  const uint64_t __b11 = static_cast<uint64_t>(__a_hi) * __b_hi;
+
+  const uint64_t __mid1 = __b10 + (__b00 >> 32);
+  const uint64_t __mid2 = __b01 + static_cast<uint32_t>(__mid1);
+
+  *__product_hi = __b11 + (__mid1 >> 32) + (__mid2 >> 32);
+  return (__mid2 << 32) | static_cast<uint32_t>(__b00);
+#endif
+}
+
+// Returns (__hi:__lo) >> __dist for 0 < __dist < 64.
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __shiftright128(const uint64_t __lo, const uint64_t __hi,
+                                                          const uint32_t __dist) {
+  return (__hi << (64 - __dist)) | (__lo >> __dist);
+}
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // _LIBCPP_SRC_INCLUDE_RYU_COMMON_H
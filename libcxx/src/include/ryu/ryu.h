@@ -0,0 +1,43 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// The shortest round-trip decimal representation of float and double, as
+// computed by Ryu. The callers format the digits; see
+// src/include/to_chars_floating_point.h.
+
+#ifndef _LIBCPP_SRC_INCLUDE_RYU_RYU_H
+#define _LIBCPP_SRC_INCLUDE_RYU_RYU_H
+
+#include "__config"
+#include "cstdint"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+// The value __mantissa * 10^__exponent, where __mantissa has no trailing
+// zeros unless it is zero.
+struct __floating_decimal_64 {
+  uint64_t __mantissa;
+  int32_t __exponent;
+};
+
+struct __floating_decimal_32 {
+  uint32_t __mantissa;
+  int32_t __exponent;
+};
+
+// Returns the shortest decimal that rounds to the finite, nonzero double with
+// the given IEEE fields. If several decimals of that length round to the
+// double, the one closest to it is returned.
+_LIBCPP_HIDDEN __floating_decimal_64 __d2d(uint64_t __ieee_mantissa, uint32_t __ieee_exponent);
+
+// Same for float.
+_LIBCPP_HIDDEN __floating_decimal_32 __f2d(uint32_t __ieee_mantissa, uint32_t __ieee_exponent);
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // _LIBCPP_SRC_INCLUDE_RYU_RYU_H
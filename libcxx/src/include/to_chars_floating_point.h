@@ -0,0 +1,685 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// The formatting behind the floating-point std::to_chars overloads.
+//
+// The overloads without a precision print the shortest decimal that rounds
+// back to the value, as computed by Ryu (src/ryu). The overloads with a
+// precision print the correctly rounded value, like printf in the "C"
+// locale; they first expand the value into its exact decimal digits, which is
+// always possible since every binary floating-point value is a terminating
+// decimal, and then round those digits.
+
+#ifndef _LIBCPP_SRC_INCLUDE_TO_CHARS_FLOATING_POINT_H
+#define _LIBCPP_SRC_INCLUDE_TO_CHARS_FLOATING_POINT_H
+
+#include "__config"
+#include "charconv"
+#include "cstdint"
+#include "cstring"
+#include "limits"
+
+#include "include/ryu/common.h"
+#include "include/ryu/ryu.h"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace __floating_to_chars {
+
+template <class _Floating>
+struct __traits;
+
+template <>
+struct __traits<float> {
+  using _Uint = uint32_t;
+  static constexpr int __mantissa_bits = 23;
+  static constexpr int __exponent_bits = 8;
+  static constexpr int __exponent_bias = 127;
+  // The number of hexits after the point in the shortest hex form.
+  static constexpr int __hexits = 6;
+  // Integers with up to this many digits are exactly representable.
+  static constexpr int __exact_integer_digits = 7;
+
+  static _Uint __to_bits(float __value) { return __float_to_bits(__value); }
+};
+
+template <>
+struct __traits<double> {
+  using _Uint = uint64_t;
+  static constexpr int __mantissa_bits = 52;
+  static constexpr int __exponent_bits = 11;
+  static constexpr int __exponent_bias = 1023;
+  static constexpr int __hexits = 13;
+  static constexpr int __exact_integer_digits = 15;
+
+  static _Uint __to_bits(double __value) { return __double_to_bits(__value); }
+};
+
+inline to_chars_result __too_large(char* __last) { return {__last, errc::value_too_large}; }
+
+// Writes the decimal exponent of scientific notation, with a sign and at
+// least two digits.
+inline char* __write_exponent(char* __ptr, char __letter, int __exponent) {
+  *__ptr++ = __letter;
+  if (__exponent < 0) {
+    *__ptr++ = '-';
+    __exponent = -__exponent;
+  } else {
+    *__ptr++ = '+';
+  }
+  if (__exponent >= 100) {
+    *__ptr++ = static_cast<char>('0' + __exponent / 100);
+    __exponent %= 100;
+  }
+  *__ptr++ = static_cast<char>('0' + __exponent / 10);
+  *__ptr++ = static_cast<char>('0' + __exponent % 10);
+  return __ptr;
+}
+
+inline int __exponent_length(int __exponent) {
+  __exponent = __exponent < 0 ? -__exponent : __exponent;
+  return __exponent >= 100 ? 5 : 4;
+}
+
+// A nonnegative integer of up to 1024 bits, or the fraction of one, as
+// little-endian 32-bit words.
+struct __big_integer {
+  static constexpr int __max_words = 36;
+  uint32_t __words[__max_words];
+  int __size;
+
+  explicit __big_integer(uint64_t __value) {
+    __words[0] = static_cast<uint32_t>(__value);
+    __words[1] = static_cast<uint32_t>(__value >> 32);
+    __size = __words[1] != 0 ? 2 : (__words[0] != 0 ? 1 : 0);
+  }
+
+  void __shift_left(int __bits) {
+    const int __word_shift = __bits / 32;
+    const int __bit_shift = __bits % 32;
+    if (__size == 0)
+      return;
+    uint32_t __carry = 0;
+    if (__bit_shift != 0) {
+      for (int __i = 0; __i < __size; ++__i) {
+        const uint32_t __w = __words[__i];
+        __words[__i] = (__w << __bit_shift) | __carry;
+        __carry = __w >> (32 - __bit_shift);
+      }
+    }
+    if (__carry != 0)
+      __words[__size++] = __carry;
+    if (__word_shift != 0) {
+      memmove(__words + __word_shift, __words, __size * sizeof(uint32_t));
+      memset(__words, 0, __word_shift * sizeof(uint32_t));
+      __size += __word_shift;
+    }
+  }
+
+  // Divides by __divisor and returns the remainder.
+  uint32_t __divide(uint32_t __divisor) {
+    uint64_t __rem = 0;
+    for (int __i = __size; __i > 0; --__i) {
+      const uint64_t __cur = (__rem << 32) | __words[__i - 1];
+      __words[__i - 1] = static_cast<uint32_t>(__cur / __divisor);
+      __rem = __cur % __divisor;
+    }
+    while (__size > 0 && __words[__size - 1] == 0)
+      --__size;
+    return static_cast<uint32_t>(__rem);
+  }
+};
+
+// Writes the nine digits of __value < 10^9, with leading zeros.
+inline void __write_nine_digits(char* __ptr, uint32_t __value) {
+  for (int __i = 8; __i >= 0; --__i) {
+    __ptr[__i] = static_cast<char>('0' + __value % 10);
+    __value /= 10;
+  }
+}
+
+// Writes the decimal digits of __n to the buffer that ends at __end, and
+// returns where they start. __n is consumed.
+inline char* __write_big_integer(__big_integer& __n, char* __end) {
+  char* __ptr = __end;
+  while (__n.__size > 0) {
+    __ptr -= 9;
+    __write_nine_digits(__ptr, __n.__divide(1000000000));
+  }
+  while (__ptr != __end && *__ptr == '0')
+    ++__ptr;
+  return __ptr;
+}
+
+// The exact decimal expansion of a nonnegative double: __int_length integer
+// digits followed by the fraction digits, without trailing zeros in the
+// fraction. The integer part is empty for values below one.
+struct __exact_decimal {
+  // Up to 309 integer digits, and up to 1074 fraction digits.
+  char __digits[1400];
+  int __length;
+  int __int_length;
+
+  explicit __exact_decimal(double __value) {
+    const uint64_t __bits = __double_to_bits(__value);
+    const uint32_t __ieee_exponent = static_cast<uint32_t>(__bits >> 52) & 0x7FF;
+    uint64_t __m = __bits & ((uint64_t(1) << 52) - 1);
+    int __e2;
+    if (__ieee_exponent == 0) {
+      __e2 = 1 - 1075;
+    } else {
+      __m |= uint64_t(1) << 52;
+      __e2 = static_cast<int>(__ieee_exponent) - 1075;
+    }
+
+    // The integer part.
+    char __int_buffer[320];
+    char* const __int_end = __int_buffer + sizeof(__int_buffer);
+    char* __int_begin;
+    uint64_t __fraction = 0;
+    int __fraction_bits = 0;
+    if (__e2 >= 0) {
+      __big_integer __n(__m);
+      __n.__shift_left(__e2);
+      __int_begin = __write_big_integer(__n, __int_end);
+    } else if (-__e2 < 64) {
+      __big_integer __n(__m >> -__e2);
+      __int_begin = __write_big_integer(__n, __int_end);
+      __fraction = __m & ((uint64_t(1) << -__e2) - 1);
+      __fraction_bits = -__e2;
+    } else {
+      __int_begin = __int_end;
+      __fraction = __m;
+      __fraction_bits = -__e2;
+    }
+    __int_length = static_cast<int>(__int_end - __int_begin);
+    memcpy(__digits, __int_begin, __int_length);
+    __length = __int_length;
+
+    // The fraction __fraction / 2^__fraction_bits: multiplying by 10^9 moves
+    // the next nine digits above the binary point.
+    if (__fraction != 0) {
+      __big_integer __f(__fraction);
+      const int __top_word = __fraction_bits / 32;
+      const int __top_shift = __fraction_bits % 32;
+      while (__f.__size > 0) {
+        uint64_t __carry = 0;
+        for (int __i = 0; __i < __f.__size; ++__i) {
+          const uint64_t __cur = static_cast<uint64_t>(__f.__words[__i]) * 1000000000 + __carry;
+          __f.__words[__i] = static_cast<uint32_t>(__cur);
+          __carry = __cur >> 32;
+        }
+        if (__carry != 0)
+          __f.__words[__f.__size++] = static_cast<uint32_t>(__carry);
+        // Extract the bits at and above __fraction_bits, which are < 10^9.
+        uint64_t __high = 0;
+        for (int __i = __f.__size; __i > __top_word; --__i)
+          __high = (__high << 32) | __f.__words[__i - 1];
+        __write_nine_digits(__digits + __length, static_cast<uint32_t>(__high >> __top_shift));
+        __length += 9;
+        if (__top_word < __f.__size) {
+          __f.__words[__top_word] &= (uint32_t(1) << __top_shift) - 1;
+          __f.__size = __top_word + 1;
+        }
+        while (__f.__size > 0 && __f.__words[__f.__size - 1] == 0)
+          --__f.__size;
+      }
+      while (__length > __int_length && __digits[__length - 1] == '0')
+        --__length;
+    }
+  }
+
+  // Returns the digit at __i, which is zero past the end.
+  char __at(int __i) const { return __i < __length ? __digits[__i] : '0'; }
+
+  // Returns whether the exact value rounds away from zero when only the
+  // first __keep digits are kept, rounding to nearest with ties to even.
+  bool __round_up(int __keep) const {
+    if (__keep >= __length)
+      return false;
+    const char __next = __digits[__keep];
+    if (__next != '5')
+      return __next > '5';
+    if (__keep + 1 < __length)
+      return true;
+    return __keep > 0 && (__digits[__keep - 1] - '0') % 2 == 1;
+  }
+};
+
+// The first __keep digits of an exact decimal, rounded. A carry out of the
+// digit at __lead, the first one printed before the point, is reported in
+// __carry, in which case the digits are "1" followed by zeros.
+struct __rounded_digits {
+  const __exact_decimal& __dec;
+  int __keep;
+  bool __up;
+  bool __carry;
+  int __nines_from;
+
+  __rounded_digits(const __exact_decimal& __d, int __k, int __lead = 0)
+      : __dec(__d), __keep(__k), __up(__d.__round_up(__k)), __carry(false), __nines_from(__k) {
+    if (__up) {
+      // The digits from __nines_from to __keep are nines and become zeros.
+      while (__nines_from > 0 && __dec.__at(__nines_from - 1) == '9')
+        --__nines_from;
+      __carry = __nines_from <= __lead;
+    }
+  }
+
+  // Returns kept digit __i of the rounded value, ignoring a carry.
+  char operator[](int __i) const {
+    if (!__up || __i < __nines_from - 1)
+      return __dec.__at(__i);
+    if (__i == __nines_from - 1)
+      return static_cast<char>(__dec.__at(__i) + 1);
+    return '0';
+  }
+};
+
+// Prints the nonnegative __value as printf("%.*f", __precision, __value).
+inline to_chars_result __to_chars_fixed_precision(char* __first, char* __last, const __exact_decimal& __dec,
+                                                  int __precision) {
+  // Rounding only happens within the exact digits.
+  const int __keep = __precision < __dec.__length ? __precision : __dec.__length;
+  const __rounded_digits __r(__dec, __dec.__int_length + __keep);
+  const int __int_digits = __dec.__int_length + __r.__carry;
+  const ptrdiff_t __total = (__int_digits == 0 ? 1 : __int_digits) + (__precision > 0 ? 1 + ptrdiff_t(__precision) : 0);
+  if (__last - __first < __total)
+    return __too_large(__last);
+
+  char* __ptr = __first;
+  if (__r.__carry) {
+    *__ptr++ = '1';
+    for (int __i = 0; __i < __dec.__int_length; ++__i)
+      *__ptr++ = '0';
+  } else if (__dec.__int_length == 0) {
+    *__ptr++ = '0';
+  } else {
+    for (int __i = 0; __i < __dec.__int_length; ++__i)
+      *__ptr++ = __r[__i];
+  }
+  if (__precision > 0) {
+    *__ptr++ = '.';
+    // Past the exact digits only zeros remain.
+    const int __exact = __dec.__length - __dec.__int_length;
+    const int __digits = __precision < __exact ? __precision : __exact;
+    if (__r.__carry) {
+      memset(__ptr, '0', __digits);
+    } else {
+      for (int __i = 0; __i < __digits; ++__i)
+        __ptr[__i] = __r[__dec.__int_length + __i];
+    }
+    __ptr += __digits;
+    memset(__ptr, '0', __precision - __digits);
+    __ptr += __precision - __digits;
+  }
+  return {__ptr, errc{}};
+}
+
+// Returns the index of the first nonzero digit, or -1 for zero.
+inline int __first_significant(const __exact_decimal& __dec) {
+  for (int __i = 0; __i < __dec.__length; ++__i)
+    if (__dec.__digits[__i] != '0')
+      return __i;
+  return -1;
+}
+
+// Prints the nonnegative __value as printf("%.*e", __precision, __value).
+inline to_chars_result __to_chars_scientific_precision(char* __first, char* __last, const __exact_decimal& __dec,
+                                                       int __precision) {
+  const int __start = __first_significant(__dec);
+  int __exponent = 0;
+  char __lead = '0';
+  // The number of fraction digits that come from the exact value.
+  int __exact = 0;
+  const int __keep = __precision < __dec.__length ? __precision : __dec.__length;
+  const __rounded_digits __r(__dec, __start < 0 ? 0 : __start + 1 + __keep, __start < 0 ? 0 : __start);
+  if (__start >= 0) {
+    __exponent = __dec.__int_length - __start - 1;
+    if (__r.__carry) {
+      __lead = '1';
+      ++__exponent;
+    } else {
+      __lead = __r[__start];
+      __exact = __dec.__length - __start - 1;
+      if (__exact > __precision)
+        __exact = __precision;
+    }
+  }
+
+  const ptrdiff_t __total = 1 + (__precision > 0 ? 1 + ptrdiff_t(__precision) : 0) + __exponent_length(__exponent);
+  if (__last - __first < __total)
+    return __too_large(__last);
+
+  char* __ptr = __first;
+  *__ptr++ = __lead;
+  if (__precision > 0) {
+    *__ptr++ = '.';
+    for (int __i = 0; __i < __exact; ++__i)
+      __ptr[__i] = __r[__start + 1 + __i];
+    __ptr += __exact;
+    memset(__ptr, '0', __precision - __exact);
+    __ptr += __precision - __exact;
+  }
+  return {__write_exponent(__ptr, 'e', __exponent), errc{}};
+}
+
+// Prints the nonnegative __value as printf("%.*g", __precision, __value).
+inline to_chars_result __to_chars_general_precision(char* __first, char* __last, const __exact_decimal& __dec,
+                                                    int __precision) {
+  // C11 7.21.6.1/8: "Let P equal the precision if nonzero, 6 if the precision
+  // is omitted, or 1 if the precision is zero. Then, if a conversion with
+  // style E would have an exponent of X: if P > X >= -4, the conversion is
+  // with style f and precision P - (X + 1). Otherwise, the conversion is with
+  // style e and precision P - 1." Unless the # flag is used, trailing zeros
+  // are then removed from the fractional portion, and the decimal point if no
+  // fraction remains.
+  const int __p = __precision == 0 ? 1 : __precision;
+  const int __start = __first_significant(__dec);
+  const int __keep = __p < __dec.__length ? __p : __dec.__length;
+  int __x = 0;
+  if (__start >= 0) {
+    const __rounded_digits __r(__dec, __start + __keep, __start);
+    __x = __dec.__int_length - __start - 1 + __r.__carry;
+  }
+
+  // The significant digits that are left once the trailing zeros are gone
+  // never exceed the exact digits, so print into a bounded buffer first.
+  char __buffer[1500];
+  char* const __buffer_end = __buffer + sizeof(__buffer);
+  const int __exact_significant = __start < 0 ? 1 : __dec.__length - __start;
+  const int __digits = __p < __exact_significant ? __p : __exact_significant;
+  to_chars_result __res;
+  if (__p > __x && __x >= -4)
+    __res = __to_chars_fixed_precision(__buffer, __buffer_end, __dec, __digits - (__x + 1) > 0 ? __digits - (__x + 1) : 0);
+  else
+    __res = __to_chars_scientific_precision(__buffer, __buffer_end, __dec, __digits - 1);
+  _LIBCPP_ASSERT(__res.ec == errc{}, "the buffer holds every exact digit");
+
+  // Remove the trailing zeros of the fraction.
+  char* __significand_end = __res.ptr;
+  char* const __e = static_cast<char*>(memchr(__buffer, 'e', __res.ptr - __buffer));
+  if (__e != nullptr)
+    __significand_end = __e;
+  char* __trim = __significand_end;
+  if (memchr(__buffer, '.', __significand_end - __buffer) != nullptr) {
+    while (__trim[-1] == '0')
+      --__trim;
+    if (__trim[-1] == '.')
+      --__trim;
+  }
+  const ptrdiff_t __significand_length = __trim - __buffer;
+  const ptrdiff_t __exponent_length = __res.ptr - __significand_end;
+  if (__last - __first < __significand_length + __exponent_length)
+    return __too_large(__last);
+  char* __ptr = __first;
+  memcpy(__ptr, __buffer, __significand_length);
+  __ptr += __significand_length;
+  memcpy(__ptr, __significand_end, __exponent_length);
+  return {__ptr + __exponent_length, errc{}};
+}
+
+// Prints the nonnegative, finite __value in hexadecimal like printf("%a"),
+// without the 0x prefix. A negative precision requests the shortest form.
+template <class _Floating>
+to_chars_result __to_chars_hex(char* __first, char* __last, _Floating __value, int __precision) {
+  using _Traits = __traits<_Floating>;
+  using _Uint = typename _Traits::_Uint;
+  constexpr int __mantissa_bits = _Traits::__mantissa_bits;
+  constexpr int __hexits = _Traits::__hexits;
+  // Align the fraction to whole hexits.
+  constexpr int __adjust = __hexits * 4 - __mantissa_bits;
+
+  const _Uint __bits = _Traits::__to_bits(__value);
+  const _Uint __ieee_mantissa = __bits & ((_Uint(1) << __mantissa_bits) - 1);
+  const int __ieee_exponent = static_cast<int>(__bits >> __mantissa_bits);
+
+  unsigned __lead;
+  int __exponent;
+  if (__ieee_exponent == 0) {
+    __lead = 0;
+    __exponent = __ieee_mantissa == 0 ? 0 : 1 - _Traits::__exponent_bias;
+  } else {
+    __lead = 1;
+    __exponent = __ieee_exponent - _Traits::__exponent_bias;
+  }
+  _Uint __fraction = __ieee_mantissa << __adjust;
+
+  int __printed = __hexits;
+  if (__precision < 0) {
+    while (__printed > 0 && (__fraction & 0xF) == 0) {
+      __fraction >>= 4;
+      --__printed;
+    }
+  } else if (__precision < __hexits) {
+    // Round the dropped hexits to nearest, ties to even.
+    const int __dropped_bits = (__hexits - __precision) * 4;
+    const _Uint __dropped = __fraction & ((_Uint(1) << __dropped_bits) - 1);
+    const _Uint __half = _Uint(1) << (__dropped_bits - 1);
+    __fraction >>= __dropped_bits;
+    const bool __odd = __precision == 0 ? (__lead & 1) != 0 : (__fraction & 1) != 0;
+    if (__dropped > __half || (__dropped == __half && __odd)) {
+      ++__fraction;
+      if (__precision == 0 || __fraction >> (__precision * 4) != 0) {
+        // The carry goes into the leading hexit.
+        __fraction = __precision == 0 ? 0 : __fraction & ((_Uint(1) << (__precision * 4)) - 1);
+        ++__lead;
+      }
+    }
+    __printed = __precision;
+  }
+  const int __zeros = __precision > __printed ? __precision - __printed : 0;
+
+  int __abs_exponent = __exponent < 0 ? -__exponent : __exponent;
+  const int __exponent_digits = __abs_exponent >= 1000 ? 4 : __abs_exponent >= 100 ? 3 : __abs_exponent >= 10 ? 2 : 1;
+  const ptrdiff_t __total = 1 + (__printed + __zeros > 0 ? 1 + ptrdiff_t(__printed) + __zeros : 0) + 2 + __exponent_digits;
+  if (__last - __first < __total)
+    return __too_large(__last);
+
+  static constexpr char __hex_digits[] = "0123456789abcdef";
+  char* __ptr = __first;
+  *__ptr++ = __hex_digits[__lead];
+  if (__printed + __zeros > 0) {
+    *__ptr++ = '.';
+    for (int __i = __printed; __i > 0; --__i) {
+      __ptr[__i - 1] = __hex_digits[__fraction & 0xF];
+      __fraction >>= 4;
+    }
+    __ptr += __printed;
+    memset(__ptr, '0', __zeros);
+    __ptr += __zeros;
+  }
+  *__ptr++ = 'p';
+  *__ptr++ = __exponent < 0 ? '-' : '+';
+  __ptr += __exponent_digits;
+  for (int __i = 1; __i <= __exponent_digits; ++__i) {
+    __ptr[-__i] = static_cast<char>('0' + __abs_exponent % 10);
+    __abs_exponent /= 10;
+  }
+  return {__ptr, errc{}};
+}
+
+// Prints __mantissa * 10^__exponent, from the shortest round-trip digits, in
+// fixed notation. Integers that need more digits than Ryu produced are
+// printed exactly, since the exact value is then the closest representation
+// of the same length.
+template <class _Floating>
+to_chars_result __to_chars_fixed_shortest(char* __first, char* __last, _Floating __value, uint64_t __mantissa,
+                                          int __exponent, int __length) {
+  if (__exponent > 0 && __length + __exponent > __traits<_Floating>::__exact_integer_digits) {
+    const __exact_decimal __dec(static_cast<double>(__value));
+    if (__last - __first < __dec.__int_length)
+      return __too_large(__last);
+    memcpy(__first, __dec.__digits, __dec.__int_length);
+    return {__first + __dec.__int_length, errc{}};
+  }
+
+  char __digits[24];
+  __itoa::__u64toa(__mantissa, __digits);
+  const int __int_length = __length + __exponent;
+  if (__exponent >= 0) {
+    if (__last - __first < __int_length)
+      return __too_large(__last);
+    memcpy(__first, __digits, __length);
+    memset(__first + __length, '0', __exponent);
+    return {__first + __int_length, errc{}};
+  }
+  if (__int_length > 0) {
+    if (__last - __first < __length + 1)
+      return __too_large(__last);
+    memcpy(__first, __digits, __int_length);
+    __first[__int_length] = '.';
+    memcpy(__first + __int_length + 1, __digits + __int_length, __length - __int_length);
+    return {__first + __length + 1, errc{}};
+  }
+  const int __zeros = -__int_length;
+  if (__last - __first < 2 + __zeros + __length)
+    return __too_large(__last);
+  __first[0] = '0';
+  __first[1] = '.';
+  memset(__first + 2, '0', __zeros);
+  memcpy(__first + 2 + __zeros, __digits, __length);
+  return {__first + 2 + __zeros + __length, errc{}};
+}
+
+inline to_chars_result __to_chars_scientific_shortest(char* __first, char* __last, uint64_t __mantissa,
+                                                      int __exponent, int __length) {
+  const int __sci_exponent = __exponent + __length - 1;
+  const ptrdiff_t __total = __length + (__length > 1) + __exponent_length(__sci_exponent);
+  if (__last - __first < __total)
+    return __too_large(__last);
+  char __digits[24];
+  __itoa::__u64toa(__mantissa, __digits);
+  char* __ptr = __first;
+  *__ptr++ = __digits[0];
+  if (__length > 1) {
+    *__ptr++ = '.';
+    memcpy(__ptr, __digits + 1, __length - 1);
+    __ptr += __length - 1;
+  }
+  return {__write_exponent(__ptr, 'e', __sci_exponent), errc{}};
+}
+
+template <class _Floating>
+to_chars_result __to_chars_shortest(char* __first, char* __last, _Floating __value, chars_format __fmt) {
+  using _Traits = __traits<_Floating>;
+  using _Uint = typename _Traits::_Uint;
+  const _Uint __bits = _Traits::__to_bits(__value);
+  const _Uint __ieee_mantissa = __bits & ((_Uint(1) << _Traits::__mantissa_bits) - 1);
+  const uint32_t __ieee_exponent = static_cast<uint32_t>(__bits >> _Traits::__mantissa_bits);
+
+  if (__fmt == chars_format::hex)
+    return __to_chars_hex(__first, __last, __value, -1);
+
+  if (__ieee_mantissa == 0 && __ieee_exponent == 0) {
+    if (__fmt == chars_format::scientific) {
+      static constexpr char __zero[] = "0e+00";
+      if (__last - __first < 5)
+        return __too_large(__last);
+      memcpy(__first, __zero, 5);
+      return {__first + 5, errc{}};
+    }
+    if (__first == __last)
+      return __too_large(__last);
+    *__first = '0';
+    return {__first + 1, errc{}};
+  }
+
+  uint64_t __mantissa;
+  int __exponent;
+  if constexpr (sizeof(_Floating) == sizeof(float)) {
+    const __floating_decimal_32 __fd = __f2d(__ieee_mantissa, __ieee_exponent);
+    __mantissa = __fd.__mantissa;
+    __exponent = __fd.__exponent;
+  } else {
+    const __floating_decimal_64 __fd = __d2d(__ieee_mantissa, __ieee_exponent);
+    __mantissa = __fd.__mantissa;
+    __exponent = __fd.__exponent;
+  }
+  const int __length = static_cast<int>(__decimal_length17(__mantissa));
+  const int __sci_exponent = __exponent + __length - 1;
+
+  bool __use_fixed;
+  if (__fmt == chars_format::fixed) {
+    __use_fixed = true;
+  } else if (__fmt == chars_format::scientific) {
+    __use_fixed = false;
+  } else if (__fmt == chars_format::general) {
+    // As printf("%g") with the default precision of 6.
+    __use_fixed = -4 <= __sci_exponent && __sci_exponent < 6;
+  } else {
+    // The shorter of the two, preferring fixed notation on a tie.
+    int __fixed_length;
+    if (__exponent >= 0)
+      __fixed_length = __length + __exponent;
+    else if (__length + __exponent > 0)
+      __fixed_length = __length + 1;
+    else
+      __fixed_length = 2 - __exponent;
+    const int __sci_length = __length + (__length > 1) + __exponent_length(__sci_exponent);
+    __use_fixed = __fixed_length <= __sci_length;
+  }
+
+  if (__use_fixed)
+    return __to_chars_fixed_shortest(__first, __last, __value, __mantissa, __exponent, __length);
+  return __to_chars_scientific_shortest(__first, __last, __mantissa, __exponent, __length);
+}
+
+template <class _Floating>
+to_chars_result __to_chars_precision(char* __first, char* __last, _Floating __value, chars_format __fmt,
+                                     int __precision) {
+  if (__precision < 0)
+    __precision = 6;
+  if (__fmt == chars_format::hex)
+    return __to_chars_hex(__first, __last, __value, __precision);
+
+  const __exact_decimal __dec(static_cast<double>(__value));
+  if (__fmt == chars_format::fixed)
+    return __to_chars_fixed_precision(__first, __last, __dec, __precision);
+  if (__fmt == chars_format::scientific)
+    return __to_chars_scientific_precision(__first, __last, __dec, __precision);
+  return __to_chars_general_precision(__first, __last, __dec, __precision);
+}
+
+// The entry point: handles the sign and the values that are not finite.
+// Without __has_precision the shortest round-trip representation is printed,
+// and a __fmt of chars_format{} selects the plain overload's format.
+template <class _Floating>
+to_chars_result __to_chars(char* __first, char* __last, _Floating __value, chars_format __fmt, int __precision,
+                           bool __has_precision) {
+  using _Traits = __traits<_Floating>;
+  using _Uint = typename _Traits::_Uint;
+  const _Uint __bits = _Traits::__to_bits(__value);
+  constexpr int __sign_shift = _Traits::__mantissa_bits + _Traits::__exponent_bits;
+  constexpr _Uint __exponent_mask = ((_Uint(1) << _Traits::__exponent_bits) - 1) << _Traits::__mantissa_bits;
+
+  if ((__bits >> __sign_shift) != 0) {
+    if (__first == __last)
+      return __too_large(__last);
+    *__first++ = '-';
+    __value = -__value;
+  }
+
+  if ((__bits & __exponent_mask) == __exponent_mask) {
+    const bool __is_nan = (__bits & ((_Uint(1) << _Traits::__mantissa_bits) - 1)) != 0;
+    if (__last - __first < 3)
+      return __too_large(__last);
+    memcpy(__first, __is_nan ? "nan" : "inf", 3);
+    return {__first + 3, errc{}};
+  }
+
+  if (__has_precision)
+    return __to_chars_precision(__first, __last, __value, __fmt, __precision);
+  return __to_chars_shortest(__first, __last, __value, __fmt);
+}
+
+} // namespace __floating_to_chars
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // _LIBCPP_SRC_INCLUDE_TO_CHARS_FLOATING_POINT_H
@@ -0,0 +1,589 @@
+//===------------------------ memory_resource.cpp -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "memory_resource"
+
+#include "algorithm"
+#include "bit"
+#include "cstdint"
+#include "limits"
+#include "new"
+
+#include "include/atomic_support.h"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace pmr
+{
+
+// memory_resource
+
+memory_resource::~memory_resource() = default;
+
+// new_delete_resource()
+
+class _LIBCPP_TYPE_VIS __new_delete_memory_resource_imp
+    : public memory_resource
+{
+    void* do_allocate(size_t __size, size_t __align) override {
+        return _VSTD::__libcpp_allocate(__size, __align);
+    }
+
+    void do_deallocate(void* __p, size_t __size, size_t __align) override {
+        _VSTD::__libcpp_deallocate(__p, __size, __align);
+    }
+
+    bool do_is_equal(memory_resource const& __other) const _NOEXCEPT override
+        { return &__other == this; }
+
+public:
+    constexpr __new_delete_memory_resource_imp() = default;
+};
+
+// null_memory_resource()
+
+class _LIBCPP_TYPE_VIS __null_memory_resource_imp
+    : public memory_resource
+{
+    void* do_allocate(size_t, size_t) override {
+        __throw_bad_alloc();
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(memory_resource const& __other) const _NOEXCEPT override
+        { return &__other == this; }
+
+public:
+    constexpr __null_memory_resource_imp() = default;
+};
+
+namespace {
+
+// The global resources are never destroyed, so that objects with static
+// storage duration can use them until the very end of the program.
+union __resource_init_helper {
+    struct {
+        __new_delete_memory_resource_imp __new_delete_res;
+        __null_memory_resource_imp __null_res;
+    } __resources;
+    char __dummy;
+    constexpr __resource_init_helper() : __resources() {}
+    ~__resource_init_helper() {}
+};
+
+_LIBCPP_SAFE_STATIC __resource_init_helper __res_init;
+
+_LIBCPP_SAFE_STATIC memory_resource* __default_res =
+    &__res_init.__resources.__new_delete_res;
+
+} // namespace
+
+memory_resource* new_delete_resource() _NOEXCEPT
+{
+    return &__res_init.__resources.__new_delete_res;
+}
+
+memory_resource* null_memory_resource() _NOEXCEPT
+{
+    return &__res_init.__resources.__null_res;
+}
+
+// default_memory_resource()
+
+memory_resource* get_default_resource() _NOEXCEPT
+{
+    return __libcpp_atomic_load(&__default_res, _AO_Acquire);
+}
+
+memory_resource* set_default_resource(memory_resource* __new_res) _NOEXCEPT
+{
+    if (__new_res == nullptr)
+        __new_res = new_delete_resource();
+    return __libcpp_atomic_exchange(&__default_res, __new_res, _AO_Acq_Rel);
+}
+
+// 23.12.5, mem.res.pool
+
+namespace {
+
+// The blocks of the smallest pool; every pool doubles the block size of the
+// previous one.
+const size_t __smallest_block_size_log2 = 3;
+const size_t __smallest_block_size = size_t(1) << __smallest_block_size_log2;
+
+// The limits the pool options are clamped to, and the default values.
+const size_t __max_largest_required_pool_block = size_t(1) << 20;
+const size_t __max_blocks_per_chunk = size_t(1) << 20;
+
+// The first chunk of a pool holds about __initial_chunk_bytes, and each chunk
+// is twice as large as the previous one until it holds max_blocks_per_chunk
+// blocks or reaches __max_chunk_bytes.
+const size_t __initial_chunk_bytes = 1024;
+const size_t __max_chunk_bytes = size_t(1) << 22;
+
+struct __free_block {
+    __free_block* __next_;
+};
+
+struct __pool_chunk_footer {
+    __pool_chunk_footer* __next_;
+    char* __start_;
+    size_t __size_;
+    size_t __align_;
+};
+
+inline size_t __round_up(size_t __n, size_t __align) {
+    return (__n + __align - 1) & ~(__align - 1);
+}
+
+// Requires __n > 1.
+inline size_t __ceil_log2(size_t __n) {
+    return static_cast<size_t>(numeric_limits<size_t>::digits -
+                               __libcpp_clz(__n - 1));
+}
+
+} // namespace
+
+struct unsynchronized_pool_resource::__fixed_pool {
+    __pool_chunk_footer* __chunks_;
+    __free_block* __free_;
+    // The blocks of the newest chunk which have never been handed out.
+    char* __bump_;
+    char* __bump_end_;
+    size_t __next_chunk_blocks_;
+
+    explicit __fixed_pool(size_t __block_size, size_t __max_blocks)
+        : __chunks_(nullptr), __free_(nullptr), __bump_(nullptr),
+          __bump_end_(nullptr),
+          __next_chunk_blocks_(_VSTD::min(
+              _VSTD::max<size_t>(__initial_chunk_bytes / __block_size, 1),
+              __max_blocks)) {}
+
+    void* __allocate(memory_resource* __res, size_t __block_size,
+                     size_t __max_blocks) {
+        if (__free_block* __b = __free_) {
+            __free_ = __b->__next_;
+            return __b;
+        }
+        if (__bump_ == __bump_end_)
+            __grow(__res, __block_size, __max_blocks);
+        void* __p = __bump_;
+        __bump_ += __block_size;
+        return __p;
+    }
+
+    void __deallocate(void* __p) {
+        __free_block* __b = static_cast<__free_block*>(__p);
+        __b->__next_ = __free_;
+        __free_ = __b;
+    }
+
+    void __grow(memory_resource* __res, size_t __block_size,
+                size_t __max_blocks) {
+        size_t __blocks = __next_chunk_blocks_;
+        size_t __blocks_bytes = __blocks * __block_size;
+        // Chunks are aligned to the block size, which is a power of two no
+        // smaller than the alignment of any request served by the pool.
+        size_t __size = __blocks_bytes + sizeof(__pool_chunk_footer);
+        char* __start = static_cast<char*>(__res->allocate(__size, __block_size));
+        __pool_chunk_footer* __f =
+            reinterpret_cast<__pool_chunk_footer*>(__start + __blocks_bytes);
+        __f->__next_ = __chunks_;
+        __f->__start_ = __start;
+        __f->__size_ = __size;
+        __f->__align_ = __block_size;
+        __chunks_ = __f;
+        __bump_ = __start;
+        __bump_end_ = __start + __blocks_bytes;
+        if (__blocks < __max_blocks &&
+            __blocks_bytes * 2 <= _VSTD::max(__max_chunk_bytes, __block_size))
+            __next_chunk_blocks_ = _VSTD::min(__blocks * 2, __max_blocks);
+    }
+
+    void __release(memory_resource* __res) {
+        while (__chunks_ != nullptr) {
+            __pool_chunk_footer* __next = __chunks_->__next_;
+            __res->deallocate(__chunks_->__start_, __chunks_->__size_,
+                              __chunks_->__align_);
+            __chunks_ = __next;
+        }
+        __free_ = nullptr;
+        __bump_ = nullptr;
+        __bump_end_ = nullptr;
+    }
+};
+
+// The footer of an allocation too large for the pools, which follows the
+// allocated bytes.
+struct unsynchronized_pool_resource::__adhoc_chunk {
+    __adhoc_chunk* __prev_;
+    __adhoc_chunk* __next_;
+    char* __start_;
+    size_t __size_;
+    size_t __align_;
+
+    static size_t __footer_offset(size_t __bytes) {
+        return __round_up(__bytes, alignof(__adhoc_chunk));
+    }
+
+    static void* __allocate(__adhoc_chunk*& __list, memory_resource* __res,
+                            size_t __bytes, size_t __align) {
+        if (__bytes > numeric_limits<size_t>::max() - sizeof(__adhoc_chunk) -
+                          alignof(__adhoc_chunk))
+            __throw_bad_alloc();
+        size_t __offset = __footer_offset(__bytes);
+        size_t __size = __offset + sizeof(__adhoc_chunk);
+        __align = _VSTD::max(__align, alignof(__adhoc_chunk));
+        char* __start = static_cast<char*>(__res->allocate(__size, __align));
+        __adhoc_chunk* __c = reinterpret_cast<__adhoc_chunk*>(__start + __offset);
+        __c->__prev_ = nullptr;
+        __c->__next_ = __list;
+        __c->__start_ = __start;
+        __c->__size_ = __size;
+        __c->__align_ = __align;
+        if (__list)
+            __list->__prev_ = __c;
+        __list = __c;
+        return __start;
+    }
+
+    static void __deallocate(__adhoc_chunk*& __list, memory_resource* __res,
+                             void* __p, size_t __bytes) {
+        __adhoc_chunk* __c = reinterpret_cast<__adhoc_chunk*>(
+            static_cast<char*>(__p) + __footer_offset(__bytes));
+        _LIBCPP_ASSERT(__c->__start_ == __p,
+                       "deallocating a block with a different size");
+        if (__c->__prev_)
+            __c->__prev_->__next_ = __c->__next_;
+        else
+            __list = __c->__next_;
+        if (__c->__next_)
+            __c->__next_->__prev_ = __c->__prev_;
+        __res->deallocate(__c->__start_, __c->__size_, __c->__align_);
+    }
+
+    static void __release(__adhoc_chunk*& __list, memory_resource* __res) {
+        while (__list != nullptr) {
+            __adhoc_chunk* __next = __list->__next_;
+            __res->deallocate(__list->__start_, __list->__size_,
+                              __list->__align_);
+            __list = __next;
+        }
+    }
+};
+
+unsynchronized_pool_resource::unsynchronized_pool_resource(
+    const pool_options& __opts, memory_resource* __upstream)
+    : __res_(__upstream), __adhoc_(nullptr), __fixed_pools_(nullptr)
+{
+    size_t __largest = __opts.largest_required_pool_block;
+    if (__largest == 0 || __largest > __max_largest_required_pool_block)
+        __largest = __max_largest_required_pool_block;
+    __largest = _VSTD::max(__largest, __smallest_block_size);
+    __num_fixed_pools_ = static_cast<int>(
+        __ceil_log2(__largest) - __smallest_block_size_log2 + 1);
+
+    __max_blocks_per_chunk_ = __opts.max_blocks_per_chunk;
+    if (__max_blocks_per_chunk_ == 0 ||
+        __max_blocks_per_chunk_ > __max_blocks_per_chunk)
+        __max_blocks_per_chunk_ = __max_blocks_per_chunk;
+}
+
+void unsynchronized_pool_resource::release()
+{
+    __adhoc_chunk::__release(__adhoc_, __res_);
+    if (__fixed_pools_ != nullptr) {
+        for (int __i = 0; __i < __num_fixed_pools_; ++__i) {
+            __fixed_pools_[__i].__release(__res_);
+            __fixed_pools_[__i].~__fixed_pool();
+        }
+        __res_->deallocate(__fixed_pools_,
+                           __num_fixed_pools_ * sizeof(__fixed_pool),
+                           alignof(__fixed_pool));
+        __fixed_pools_ = nullptr;
+    }
+}
+
+pool_options unsynchronized_pool_resource::options() const
+{
+    pool_options __p;
+    __p.max_blocks_per_chunk = __max_blocks_per_chunk_;
+    __p.largest_required_pool_block =
+        __smallest_block_size << (__num_fixed_pools_ - 1);
+    return __p;
+}
+
+int unsynchronized_pool_resource::__pool_index(size_t __bytes,
+                                               size_t __align) const
+{
+    size_t __size = _VSTD::max(__bytes, __align);
+    if (__size <= __smallest_block_size)
+        return 0;
+    if (__size > (__smallest_block_size << (__num_fixed_pools_ - 1)))
+        return -1;
+    return static_cast<int>(__ceil_log2(__size) - __smallest_block_size_log2);
+}
+
+void* unsynchronized_pool_resource::do_allocate(size_t __bytes,
+                                                size_t __align)
+{
+    int __i = __pool_index(__bytes, __align);
+    if (__i < 0)
+        return __adhoc_chunk::__allocate(__adhoc_, __res_, __bytes, __align);
+
+    if (__fixed_pools_ == nullptr) {
+        // The pools are created on first use so that a resource which is never
+        // used does not allocate.
+        __fixed_pools_ = static_cast<__fixed_pool*>(
+            __res_->allocate(__num_fixed_pools_ * sizeof(__fixed_pool),
+                             alignof(__fixed_pool)));
+        for (int __j = 0; __j < __num_fixed_pools_; ++__j)
+            ::new ((void*)&__fixed_pools_[__j]) __fixed_pool(
+                __smallest_block_size << __j, __max_blocks_per_chunk_);
+    }
+    return __fixed_pools_[__i].__allocate(__res_, __smallest_block_size << __i,
+                                          __max_blocks_per_chunk_);
+}
+
+void unsynchronized_pool_resource::do_deallocate(void* __p, size_t __bytes,
+                                                 size_t __align)
+{
+    int __i = __pool_index(__bytes, __align);
+    if (__i < 0) {
+        __adhoc_chunk::__deallocate(__adhoc_, __res_, __p, __bytes);
+        return;
+    }
+    _LIBCPP_ASSERT(__fixed_pools_ != nullptr,
+                   "deallocating a block which was not allocated");
+    __fixed_pools_[__i].__deallocate(__p);
+}
+
+#if !defined(_LIBCPP_HAS_NO_THREADS)
+
+namespace {
+
+// Threads are spread round-robin over a fixed number of caches per resource,
+// each caching a few free blocks of the smallest pools.
+const int __thread_cache_count = 8;
+const int __thread_cache_pools = 10;
+const unsigned char __thread_cache_depth = 16;
+// Blocks taken from the pools at once when a cache is empty.
+const int __thread_cache_refill = 4;
+
+unsigned __thread_cache_index()
+{
+    static unsigned __next_index = 0;
+    static thread_local unsigned __index =
+        __libcpp_atomic_add(&__next_index, 1u, _AO_Relaxed) %
+        __thread_cache_count;
+    return __index;
+}
+
+} // namespace
+
+// The caches hold blocks of the pools of __unsync_; any block of a pool can
+// serve any request for that pool. A cache is only taken before __mut_, and
+// release() takes all caches in order, so the locking cannot deadlock.
+struct synchronized_pool_resource::__thread_cache {
+    mutex __mut_;
+    __free_block* __blocks_[__thread_cache_pools] = {};
+    unsigned char __count_[__thread_cache_pools] = {};
+};
+
+synchronized_pool_resource::__thread_cache*
+synchronized_pool_resource::__get_caches()
+{
+    __thread_cache* __c = __libcpp_atomic_load(&__caches_, _AO_Acquire);
+    if (__c != nullptr)
+        return __c;
+    unique_lock<mutex> __lk(__mut_);
+    __c = __libcpp_atomic_load(&__caches_, _AO_Relaxed);
+    if (__c == nullptr) {
+        // The caches live until the destructor, past any release(), so they
+        // are not taken from the upstream resource.
+        __c = static_cast<__thread_cache*>(_VSTD::__libcpp_allocate(
+            __thread_cache_count * sizeof(__thread_cache),
+            alignof(__thread_cache)));
+        for (int __i = 0; __i < __thread_cache_count; ++__i)
+            ::new ((void*)&__c[__i]) __thread_cache();
+        __libcpp_atomic_store(&__caches_, __c, _AO_Release);
+    }
+    return __c;
+}
+
+synchronized_pool_resource::~synchronized_pool_resource()
+{
+    release();
+    if (__caches_ != nullptr) {
+        for (int __i = 0; __i < __thread_cache_count; ++__i)
+            __caches_[__i].~__thread_cache();
+        _VSTD::__libcpp_deallocate(
+            __caches_, __thread_cache_count * sizeof(__thread_cache),
+            alignof(__thread_cache));
+    }
+}
+
+void synchronized_pool_resource::release()
+{
+    __thread_cache* __c = __libcpp_atomic_load(&__caches_, _AO_Acquire);
+    if (__c != nullptr)
+        for (int __i = 0; __i < __thread_cache_count; ++__i)
+            __c[__i].__mut_.lock();
+    {
+        lock_guard<mutex> __g(__mut_);
+        if (__c != nullptr) {
+            for (int __i = 0; __i < __thread_cache_count; ++__i) {
+                for (int __j = 0; __j < __thread_cache_pools; ++__j) {
+                    __c[__i].__blocks_[__j] = nullptr;
+                    __c[__i].__count_[__j] = 0;
+                }
+            }
+        }
+        __unsync_.release();
+    }
+    if (__c != nullptr)
+        for (int __i = __thread_cache_count; __i > 0; --__i)
+            __c[__i - 1].__mut_.unlock();
+}
+
+void* synchronized_pool_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    int __i = __unsync_.__pool_index(__bytes, __align);
+    if (__i >= 0 && __i < __thread_cache_pools) {
+        __thread_cache& __tc = __get_caches()[__thread_cache_index()];
+        lock_guard<mutex> __tl(__tc.__mut_);
+        if (__free_block* __b = __tc.__blocks_[__i]) {
+            __tc.__blocks_[__i] = __b->__next_;
+            --__tc.__count_[__i];
+            return __b;
+        }
+        // Take a few blocks at once so that the next requests of this thread
+        // do not need __mut_.
+        size_t __block_size = __smallest_block_size << __i;
+        lock_guard<mutex> __g(__mut_);
+        for (int __n = 1; __n < __thread_cache_refill; ++__n) {
+            __free_block* __b = static_cast<__free_block*>(
+                __unsync_.allocate(__block_size, __block_size));
+            __b->__next_ = __tc.__blocks_[__i];
+            __tc.__blocks_[__i] = __b;
+            ++__tc.__count_[__i];
+        }
+        return __unsync_.allocate(__block_size, __block_size);
+    }
+    lock_guard<mutex> __g(__mut_);
+    return __unsync_.allocate(__bytes, __align);
+}
+
+void synchronized_pool_resource::do_deallocate(void* __p, size_t __bytes,
+                                               size_t __align)
+{
+    int __i = __unsync_.__pool_index(__bytes, __align);
+    if (__i >= 0 && __i < __thread_cache_pools) {
+        __thread_cache& __tc = __get_caches()[__thread_cache_index()];
+        lock_guard<mutex> __tl(__tc.__mut_);
+        if (__tc.__count_[__i] < __thread_cache_depth) {
+            __free_block* __b = static_cast<__free_block*>(__p);
+            __b->__next_ = __tc.__blocks_[__i];
+            __tc.__blocks_[__i] = __b;
+            ++__tc.__count_[__i];
+            return;
+        }
+        lock_guard<mutex> __g(__mut_);
+        __unsync_.deallocate(__p, __bytes, __align);
+        return;
+    }
+    lock_guard<mutex> __g(__mut_);
+    __unsync_.deallocate(__p, __bytes, __align);
+}
+
+#else // _LIBCPP_HAS_NO_THREADS
+
+synchronized_pool_resource::~synchronized_pool_resource() {}
+
+void synchronized_pool_resource::release()
+{
+    __unsync_.release();
+}
+
+void* synchronized_pool_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    return __unsync_.allocate(__bytes, __align);
+}
+
+void synchronized_pool_resource::do_deallocate(void* __p, size_t __bytes,
+                                               size_t __align)
+{
+    __unsync_.deallocate(__p, __bytes, __align);
+}
+
+#endif // _LIBCPP_HAS_NO_THREADS
+
+// 23.12.6, mem.res.monotonic.buffer
+
+namespace {
+
+void* __try_allocate_from(char*& __cur, char* __end, size_t __bytes,
+                          size_t __align)
+{
+    if (__cur == nullptr)
+        return nullptr;
+    uintptr_t __c = reinterpret_cast<uintptr_t>(__cur);
+    uintptr_t __e = reinterpret_cast<uintptr_t>(__end);
+    uintptr_t __aligned = (__c + __align - 1) & ~(uintptr_t(__align) - 1);
+    if (__aligned < __c || __aligned > __e || __bytes > __e - __aligned)
+        return nullptr;
+    __cur = reinterpret_cast<char*>(__aligned + __bytes);
+    return reinterpret_cast<void*>(__aligned);
+}
+
+} // namespace
+
+void* monotonic_buffer_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    if (void* __p = __try_allocate_from(__cur_, __end_, __bytes, __align))
+        return __p;
+
+    const size_t __footer_size = sizeof(__chunk_footer);
+    const size_t __footer_align = alignof(__chunk_footer);
+    if (__bytes > numeric_limits<size_t>::max() / 2 - __footer_size -
+                      __footer_align)
+        __throw_bad_alloc();
+
+    // The first chunk has the initial size unless a buffer was given; every
+    // chunk is then twice as large as the previous one.
+    size_t __size;
+    if (__chunks_ != nullptr)
+        __size = __chunks_->__allocation_size();
+    else
+        __size = __initial_size_;
+    if (__chunks_ != nullptr || __initial_ != nullptr)
+        __size = __size <= numeric_limits<size_t>::max() / 4 ? __size * 2
+                                                              : __size;
+    __size = __round_up(_VSTD::max(_VSTD::max<size_t>(__size, 1), __bytes),
+                        __footer_align);
+
+    __align = _VSTD::max(__align, __default_buffer_alignment);
+    char* __start = static_cast<char*>(
+        __res_->allocate(__size + __footer_size, __align));
+    __chunk_footer* __f = reinterpret_cast<__chunk_footer*>(__start + __size);
+    __f->__next_ = __chunks_;
+    __f->__start_ = __start;
+    __f->__align_ = __align;
+    __chunks_ = __f;
+    __cur_ = __start;
+    __end_ = __start + __size;
+
+    void* __p = __try_allocate_from(__cur_, __end_, __bytes, __align);
+    _LIBCPP_ASSERT(__p != nullptr, "a new chunk must fit the request");
+    return __p;
+}
+
+} // namespace pmr
+
+_LIBCPP_END_NAMESPACE_STD
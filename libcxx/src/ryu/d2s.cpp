@@ -0,0 +1,245 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Shortest round-trip conversion of double, after Ulf Adams,
+// "Ryu: Fast Float-to-String Conversion", PLDI 2018.
+
+#include "__config"
+#include "cstdint"
+
+#include "include/ryu/common.h"
+#include "include/ryu/d2s_full_table.h"
+#include "include/ryu/ryu.h"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace {
+
+constexpr int __DOUBLE_MANTISSA_BITS = 52;
+constexpr int __DOUBLE_BIAS = 1023;
+
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __div5(const uint64_t __x) { return __x / 5; }
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __div10(const uint64_t __x) { return __x / 10; }
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __div100(const uint64_t __x) { return __x / 100; }
+
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __pow5Factor(uint64_t __value) {
+  // __m_inv_5 is the multiplicative inverse of 5 modulo 2^64; a multiple of 5
+  // times it is the quotient, which is at most 2^64 / 5.
+  const uint64_t __m_inv_5 = 14757395258967641293u;
+  const uint64_t __n_div_5 = 3689348814741910323u;
+  uint32_t __count = 0;
+  for (;;) {
+    __value *= __m_inv_5;
+    if (__value > __n_div_5) {
+      break;
+    }
+    ++__count;
+  }
+  return __count;
+}
+
+// Returns true if __value is divisible by 5^__p.
+inline _LIBCPP_INLINE_VISIBILITY bool __multipleOfPowerOf5(const uint64_t __value, const uint32_t __p) {
+  return __pow5Factor(__value) >= __p;
+}
+
+// Returns true if __value is divisible by 2^__p.
+inline _LIBCPP_INLINE_VISIBILITY bool __multipleOfPowerOf2(const uint64_t __value, const uint32_t __p) {
+  return (__value & ((1ull << __p) - 1)) == 0;
+}
+
+// Returns floor((__m * __mul) / 2^__j) for __m of at most 55 bits and
+// 64 < __j < 128.
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __mulShift64(const uint64_t __m, const uint64_t* const __mul,
+                                                       const int32_t __j) {
+  uint64_t __high1;
+  const uint64_t __low1 = __umul128(__m, __mul[1], &__high1);
+  uint64_t __high0;
+  (void)__umul128(__m, __mul[0], &__high0);
+  const uint64_t __sum = __high0 + __low1;
+  if (__sum < __high0) {
+    ++__high1;
+  }
+  return __shiftright128(__sum, __high1, static_cast<uint32_t>(__j - 64));
+}
+
+inline _LIBCPP_INLINE_VISIBILITY uint64_t __mulShiftAll64(const uint64_t __m, const uint64_t* const __mul,
+                                                          const int32_t __j, uint64_t* const __vp,
+                                                          uint64_t* const __vm, const uint32_t __mmShift) {
+  *__vp = __mulShift64(4 * __m + 2, __mul, __j);
+  *__vm = __mulShift64(4 * __m - 1 - __mmShift, __mul, __j);
+  return __mulShift64(4 * __m, __mul, __j);
+}
+
+} // namespace
+
+__floating_decimal_64 __d2d(const uint64_t __ieee_mantissa, const uint32_t __ieee_exponent) {
+  int32_t __e2;
+  uint64_t __m2;
+  if (__ieee_exponent == 0) {
+    // We subtract 2 so that the bounds computation has 2 additional bits.
+    __e2 = 1 - __DOUBLE_BIAS - __DOUBLE_MANTISSA_BITS - 2;
+    __m2 = __ieee_mantissa;
+  } else {
+    __e2 = static_cast<int32_t>(__ieee_exponent) - __DOUBLE_BIAS - __DOUBLE_MANTISSA_BITS - 2;
+    __m2 = (1ull << __DOUBLE_MANTISSA_BITS) | __ieee_mantissa;
+  }
+  const bool __even = (__m2 & 1) == 0;
+  const bool __acceptBounds = __even;
+
+  // Step 2: Determine the interval of valid decimal representations.
+  const uint64_t __mv = 4 * __m2;
+  // The lower boundary is closer if the mantissa is a power of two.
+  const uint32_t __mmShift = __ieee_mantissa != 0 || __ieee_exponent <= 1;
+
+  // Step 3: Convert to a decimal power base using 128-bit arithmetic.
+  uint64_t __vr, __vp, __vm;
+  int32_t __e10;
+  bool __vmIsTrailingZeros = false;
+  bool __vrIsTrailingZeros = false;
+  if (__e2 >= 0) {
+    // This is max(0, log10Pow2(e2) - 1), written to avoid the branch.
+    const uint32_t __q = __log10Pow2(__e2) - (__e2 > 3);
+    __e10 = static_cast<int32_t>(__q);
+    const int32_t __k = __DOUBLE_POW5_INV_BITCOUNT + __pow5bits(static_cast<int32_t>(__q)) - 1;
+    const int32_t __i = -__e2 + static_cast<int32_t>(__q) + __k;
+    __vr = __mulShiftAll64(__m2, __DOUBLE_POW5_INV_SPLIT[__q], __i, &__vp, &__vm, __mmShift);
+    if (__q <= 21) {
+      // Only one of mp, mv, and mm can be a multiple of 5, if any.
+      const uint32_t __mvMod5 = static_cast<uint32_t>(__mv) - 5 * static_cast<uint32_t>(__div5(__mv));
+      if (__mvMod5 == 0) {
+        __vrIsTrailingZeros = __multipleOfPowerOf5(__mv, __q);
+      } else if (__acceptBounds) {
+        // Same as min(e2 + (~mm & 1), pow5Factor(mm)) >= q, where e2 >= q.
+        __vmIsTrailingZeros = __multipleOfPowerOf5(__mv - 1 - __mmShift, __q);
+      } else {
+        // Same as min(e2 + 1, pow5Factor(mp)) >= q.
+        __vp -= __multipleOfPowerOf5(__mv + 2, __q);
+      }
+    }
+  } else {
+    // This is max(0, log10Pow5(-e2) - 1), written to avoid the branch.
+    const uint32_t __q = __log10Pow5(-__e2) - (-__e2 > 1);
+    __e10 = static_cast<int32_t>(__q) + __e2;
+    const int32_t __i = -__e2 - static_cast<int32_t>(__q);
+    const int32_t __k = __pow5bits(__i) - __DOUBLE_POW5_BITCOUNT;
+    const int32_t __j = static_cast<int32_t>(__q) - __k;
+    __vr = __mulShiftAll64(__m2, __DOUBLE_POW5_SPLIT[__i], __j, &__vp, &__vm, __mmShift);
+    if (__q <= 1) {
+      // {vr,vp,vm} is trailing zeros if {mv,mp,mm} has at least q trailing 0
+      // bits. mv = 4 * m2, so it always has at least two trailing 0 bits.
+      __vrIsTrailingZeros = true;
+      if (__acceptBounds) {
+        // mm = mv - 1 - mmShift, so it has 1 trailing 0 bit iff mmShift == 1.
+        __vmIsTrailingZeros = __mmShift == 1;
+      } else {
+        // mp = mv + 2, so it always has at least one trailing 0 bit.
+        --__vp;
+      }
+    } else if (__q < 63) {
+      // We want to know if the full product has at least q trailing zeros,
+      // that is min(p2(mv), p5(mv) - e2) >= q, which is p2(mv) >= q because
+      // -e2 >= q.
+      __vrIsTrailingZeros = __multipleOfPowerOf2(__mv, __q);
+    }
+  }
+
+  // Step 4: Find the shortest decimal representation in the interval of
+  // valid representations.
+  int32_t __removed = 0;
+  uint8_t __lastRemovedDigit = 0;
+  uint64_t __output;
+  if (__vmIsTrailingZeros || __vrIsTrailingZeros) {
+    // General case, which happens rarely (~0.7%).
+    for (;;) {
+      const uint64_t __vpDiv10 = __div10(__vp);
+      const uint64_t __vmDiv10 = __div10(__vm);
+      if (__vpDiv10 <= __vmDiv10) {
+        break;
+      }
+      const uint32_t __vmMod10 = static_cast<uint32_t>(__vm) - 10 * static_cast<uint32_t>(__vmDiv10);
+      const uint64_t __vrDiv10 = __div10(__vr);
+      const uint32_t __vrMod10 = static_cast<uint32_t>(__vr) - 10 * static_cast<uint32_t>(__vrDiv10);
+      __vmIsTrailingZeros &= __vmMod10 == 0;
+      __vrIsTrailingZeros &= __lastRemovedDigit == 0;
+      __lastRemovedDigit = static_cast<uint8_t>(__vrMod10);
+      __vr = __vrDiv10;
+      __vp = __vpDiv10;
+      __vm = __vmDiv10;
+      ++__removed;
+    }
+    if (__vmIsTrailingZeros) {
+      for (;;) {
+        const uint64_t __vmDiv10 = __div10(__vm);
+        const uint32_t __vmMod10 = static_cast<uint32_t>(__vm) - 10 * static_cast<uint32_t>(__vmDiv10);
+        if (__vmMod10 != 0) {
+          break;
+        }
+        const uint64_t __vpDiv10 = __div10(__vp);
+        const uint64_t __vrDiv10 = __div10(__vr);
+        const uint32_t __vrMod10 = static_cast<uint32_t>(__vr) - 10 * static_cast<uint32_t>(__vrDiv10);
+        __vrIsTrailingZeros &= __lastRemovedDigit == 0;
+        __lastRemovedDigit = static_cast<uint8_t>(__vrMod10);
+        __vr = __vrDiv10;
+        __vp = __vpDiv10;
+        __vm = __vmDiv10;
+        ++__removed;
+      }
+    }
+    if (__vrIsTrailingZeros && __lastRemovedDigit == 5 && __vr % 2 == 0) {
+      // Round even if the exact number is .....50..0.
+      __lastRemovedDigit = 4;
+    }
+    // We need to take vr + 1 if vr is outside bounds or we need to round up.
+    __output = __vr + ((__vr == __vm && (!__acceptBounds || !__vmIsTrailingZeros)) || __lastRemovedDigit >= 5);
+  } else {
+    // Specialized for the common case (~99.3%).
+    bool __roundUp = false;
+    const uint64_t __vpDiv100 = __div100(__vp);
+    const uint64_t __vmDiv100 = __div100(__vm);
+    if (__vpDiv100 > __vmDiv100) {
+      // Remove two digits at a time (~86.2%).
+      const uint64_t __vrDiv100 = __div100(__vr);
+      const uint32_t __vrMod100 = static_cast<uint32_t>(__vr) - 100 * static_cast<uint32_t>(__vrDiv100);
+      __roundUp = __vrMod100 >= 50;
+      __vr = __vrDiv100;
+      __vp = __vpDiv100;
+      __vm = __vmDiv100;
+      __removed += 2;
+    }
+    for (;;) {
+      const uint64_t __vpDiv10 = __div10(__vp);
+      const uint64_t __vmDiv10 = __div10(__vm);
+      if (__vpDiv10 <= __vmDiv10) {
+        break;
+      }
+      const uint64_t __vrDiv10 = __div10(__vr);
+      const uint32_t __vrMod10 = static_cast<uint32_t>(__vr) - 10 * static_cast<uint32_t>(__vrDiv10);
+      __roundUp = __vrMod10 >= 5;
+      __vr = __vrDiv10;
+      __vp = __vpDiv10;
+      __vm = __vmDiv10;
+      ++__removed;
+    }
+    // We need to take vr + 1 if vr is outside bounds or we need to round up.
+    __output = __vr + (__vr == __vm || __roundUp);
+  }
+
+  __floating_decimal_64 __fd;
+  __fd.__exponent = __e10 + __removed;
+  __fd.__mantissa = __output;
+  // Rounding up can leave a trailing zero; the callers rely on there being
+  // none.
+  while (__fd.__mantissa % 10 == 0) {
+    __fd.__mantissa /= 10;
+    ++__fd.__exponent;
+  }
+  return __fd;
+}
+
+_LIBCPP_END_NAMESPACE_STD
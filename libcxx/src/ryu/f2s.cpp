@@ -0,0 +1,302 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Shortest round-trip conversion of float, after Ulf Adams,
+// "Ryu: Fast Float-to-String Conversion", PLDI 2018.
+
+#include "__config"
+#include "cstdint"
+
+#include "include/ryu/common.h"
+#include "include/ryu/ryu.h"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace {
+
+constexpr int __FLOAT_MANTISSA_BITS = 23;
+constexpr int __FLOAT_BIAS = 127;
+
+constexpr int __FLOAT_POW5_INV_BITCOUNT = 59;
+constexpr int __FLOAT_POW5_BITCOUNT = 61;
+
+// Entry q is floor(2^(bitlength(5^q) - 1 + 59) / 5^q) + 1.
+constexpr uint64_t __FLOAT_POW5_INV_SPLIT[31] = {
+  576460752303423489u,
+  461168601842738791u,
+  368934881474191033u,
+  295147905179352826u,
+  472236648286964522u,
+  377789318629571618u,
+  302231454903657294u,
+  483570327845851670u,
+  386856262276681336u,
+  309485009821345069u,
+  495176015714152110u,
+  396140812571321688u,
+  316912650057057351u,
+  507060240091291761u,
+  405648192073033409u,
+  324518553658426727u,
+  519229685853482763u,
+  415383748682786211u,
+  332306998946228969u,
+  531691198313966350u,
+  425352958651173080u,
+  340282366920938464u,
+  544451787073501542u,
+  435561429658801234u,
+  348449143727040987u,
+  557518629963265579u,
+  446014903970612463u,
+  356811923176489971u,
+  570899077082383953u,
+  456719261665907162u,
+  365375409332725730u,
+};
+
+// Entry i is 5^i scaled by a power of two to exactly 61 bits.
+constexpr uint64_t __FLOAT_POW5_SPLIT[48] = {
+  1152921504606846976u,
+  1441151880758558720u,
+  1801439850948198400u,
+  2251799813685248000u,
+  1407374883553280000u,
+  1759218604441600000u,
+  2199023255552000000u,
+  1374389534720000000u,
+  1717986918400000000u,
+  2147483648000000000u,
+  1342177280000000000u,
+  1677721600000000000u,
+  2097152000000000000u,
+  1310720000000000000u,
+  1638400000000000000u,
+  2048000000000000000u,
+  1280000000000000000u,
+  1600000000000000000u,
+  2000000000000000000u,
+  1250000000000000000u,
+  1562500000000000000u,
+  1953125000000000000u,
+  1220703125000000000u,
+  1525878906250000000u,
+  1907348632812500000u,
+  1192092895507812500u,
+  1490116119384765625u,
+  1862645149230957031u,
+  1164153218269348144u,
+  1455191522836685180u,
+  1818989403545856475u,
+  2273736754432320594u,
+  1421085471520200371u,
+  1776356839400250464u,
+  2220446049250313080u,
+  1387778780781445675u,
+  1734723475976807094u,
+  2168404344971008868u,
+  1355252715606880542u,
+  1694065894508600678u,
+  2117582368135750847u,
+  1323488980084844279u,
+  1654361225106055349u,
+  2067951531382569187u,
+  1292469707114105741u,
+  1615587133892632177u,
+  2019483917365790221u,
+  1262177448353618888u,
+};
+
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __pow5factor_32(uint32_t __value) {
+  uint32_t __count = 0;
+  for (;;) {
+    const uint32_t __q = __value / 5;
+    const uint32_t __r = __value % 5;
+    if (__r != 0) {
+      break;
+    }
+    __value = __q;
+    ++__count;
+  }
+  return __count;
+}
+
+// Returns true if __value is divisible by 5^__p.
+inline _LIBCPP_INLINE_VISIBILITY bool __multipleOfPowerOf5_32(const uint32_t __value, const uint32_t __p) {
+  return __pow5factor_32(__value) >= __p;
+}
+
+// Returns true if __value is divisible by 2^__p.
+inline _LIBCPP_INLINE_VISIBILITY bool __multipleOfPowerOf2_32(const uint32_t __value, const uint32_t __p) {
+  return (__value & ((1u << __p) - 1)) == 0;
+}
+
+// Returns floor((__m * __factor) / 2^__shift) for 32 < __shift < 64.
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __mulShift32(const uint32_t __m, const uint64_t __factor,
+                                                       const int32_t __shift) {
+  const uint32_t __factorLo = static_cast<uint32_t>(__factor);
+  const uint32_t __factorHi = static_cast<uint32_t>(__factor >> 32);
+  const uint64_t __bits0 = static_cast<uint64_t>(__m) * __factorLo;
+  const uint64_t __bits1 = static_cast<uint64_t>(__m) * __factorHi;
+  const uint64_t __sum = (__bits0 >> 32) + __bits1;
+  return static_cast<uint32_t>(__sum >> (__shift - 32));
+}
+
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __mulPow5InvDivPow2(const uint32_t __m, const uint32_t __q,
+                                                              const int32_t __j) {
+  return __mulShift32(__m, __FLOAT_POW5_INV_SPLIT[__q], __j);
+}
+
+inline _LIBCPP_INLINE_VISIBILITY uint32_t __mulPow5divPow2(const uint32_t __m, const uint32_t __i,
+                                                           const int32_t __j) {
+  return __mulShift32(__m, __FLOAT_POW5_SPLIT[__i], __j);
+}
+
+} // namespace
+
+__floating_decimal_32 __f2d(const uint32_t __ieee_mantissa, const uint32_t __ieee_exponent) {
+  int32_t __e2;
+  uint32_t __m2;
+  if (__ieee_exponent == 0) {
+    // We subtract 2 so that the bounds computation has 2 additional bits.
+    __e2 = 1 - __FLOAT_BIAS - __FLOAT_MANTISSA_BITS - 2;
+    __m2 = __ieee_mantissa;
+  } else {
+    __e2 = static_cast<int32_t>(__ieee_exponent) - __FLOAT_BIAS - __FLOAT_MANTISSA_BITS - 2;
+    __m2 = (1u << __FLOAT_MANTISSA_BITS) | __ieee_mantissa;
+  }
+  const bool __even = (__m2 & 1) == 0;
+  const bool __acceptBounds = __even;
+
+  // Step 2: Determine the interval of valid decimal representations.
+  const uint32_t __mv = 4 * __m2;
+  const uint32_t __mp = 4 * __m2 + 2;
+  // The lower boundary is closer if the mantissa is a power of two.
+  const uint32_t __mmShift = __ieee_mantissa != 0 || __ieee_exponent <= 1;
+  const uint32_t __mm = 4 * __m2 - 1 - __mmShift;
+
+  // Step 3: Convert to a decimal power base using 64-bit arithmetic.
+  uint32_t __vr, __vp, __vm;
+  int32_t __e10;
+  bool __vmIsTrailingZeros = false;
+  bool __vrIsTrailingZeros = false;
+  uint8_t __lastRemovedDigit = 0;
+  if (__e2 >= 0) {
+    const uint32_t __q = __log10Pow2(__e2);
+    __e10 = static_cast<int32_t>(__q);
+    const int32_t __k = __FLOAT_POW5_INV_BITCOUNT + __pow5bits(static_cast<int32_t>(__q)) - 1;
+    const int32_t __i = -__e2 + static_cast<int32_t>(__q) + __k;
+    __vr = __mulPow5InvDivPow2(__mv, __q, __i);
+    __vp = __mulPow5InvDivPow2(__mp, __q, __i);
+    __vm = __mulPow5InvDivPow2(__mm, __q, __i);
+    if (__q != 0 && (__vp - 1) / 10 <= __vm / 10) {
+      // We need to know one removed digit even if we are not going to loop
+      // below. We could use q = X - 1 above, except that would require 33
+      // bits for the result.
+      const int32_t __l = __FLOAT_POW5_INV_BITCOUNT + __pow5bits(static_cast<int32_t>(__q - 1)) - 1;
+      __lastRemovedDigit = static_cast<uint8_t>(
+          __mulPow5InvDivPow2(__mv, __q - 1, -__e2 + static_cast<int32_t>(__q) - 1 + __l) % 10);
+    }
+    if (__q <= 9) {
+      // The largest power of 5 that fits in 24 bits is 5^10, but q <= 9
+      // seems to be safe as well. Only one of mp, mv, and mm can be a
+      // multiple of 5, if any.
+      if (__mv % 5 == 0) {
+        __vrIsTrailingZeros = __multipleOfPowerOf5_32(__mv, __q);
+      } else if (__acceptBounds) {
+        __vmIsTrailingZeros = __multipleOfPowerOf5_32(__mm, __q);
+      } else {
+        __vp -= __multipleOfPowerOf5_32(__mp, __q);
+      }
+    }
+  } else {
+    const uint32_t __q = __log10Pow5(-__e2);
+    __e10 = static_cast<int32_t>(__q) + __e2;
+    const int32_t __i = -__e2 - static_cast<int32_t>(__q);
+    const int32_t __k = __pow5bits(__i) - __FLOAT_POW5_BITCOUNT;
+    int32_t __j = static_cast<int32_t>(__q) - __k;
+    __vr = __mulPow5divPow2(__mv, static_cast<uint32_t>(__i), __j);
+    __vp = __mulPow5divPow2(__mp, static_cast<uint32_t>(__i), __j);
+    __vm = __mulPow5divPow2(__mm, static_cast<uint32_t>(__i), __j);
+    if (__q != 0 && (__vp - 1) / 10 <= __vm / 10) {
+      __j = static_cast<int32_t>(__q) - 1 - (__pow5bits(__i + 1) - __FLOAT_POW5_BITCOUNT);
+      __lastRemovedDigit = static_cast<uint8_t>(__mulPow5divPow2(__mv, static_cast<uint32_t>(__i + 1), __j) % 10);
+    }
+    if (__q <= 1) {
+      // {vr,vp,vm} is trailing zeros if {mv,mp,mm} has at least q trailing 0
+      // bits. mv = 4 * m2, so it always has at least two trailing 0 bits.
+      __vrIsTrailingZeros = true;
+      if (__acceptBounds) {
+        // mm = mv - 1 - mmShift, so it has 1 trailing 0 bit iff mmShift == 1.
+        __vmIsTrailingZeros = __mmShift == 1;
+      } else {
+        // mp = mv + 2, so it always has at least one trailing 0 bit.
+        --__vp;
+      }
+    } else if (__q < 31) {
+      __vrIsTrailingZeros = __multipleOfPowerOf2_32(__mv, __q - 1);
+    }
+  }
+
+  // Step 4: Find the shortest decimal representation in the interval of
+  // valid representations.
+  int32_t __removed = 0;
+  uint32_t __output;
+  if (__vmIsTrailingZeros || __vrIsTrailingZeros) {
+    // General case, which happens rarely (~4.0%).
+    while (__vp / 10 > __vm / 10) {
+      __vmIsTrailingZeros &= __vm % 10 == 0;
+      __vrIsTrailingZeros &= __lastRemovedDigit == 0;
+      __lastRemovedDigit = static_cast<uint8_t>(__vr % 10);
+      __vr /= 10;
+      __vp /= 10;
+      __vm /= 10;
+      ++__removed;
+    }
+    if (__vmIsTrailingZeros) {
+      while (__vm % 10 == 0) {
+        __vrIsTrailingZeros &= __lastRemovedDigit == 0;
+        __lastRemovedDigit = static_cast<uint8_t>(__vr % 10);
+        __vr /= 10;
+        __vp /= 10;
+        __vm /= 10;
+        ++__removed;
+      }
+    }
+    if (__vrIsTrailingZeros && __lastRemovedDigit == 5 && __vr % 2 == 0) {
+      // Round even if the exact number is .....50..0.
+      __lastRemovedDigit = 4;
+    }
+    // We need to take vr + 1 if vr is outside bounds or we need to round up.
+    __output = __vr + ((__vr == __vm && (!__acceptBounds || !__vmIsTrailingZeros)) || __lastRemovedDigit >= 5);
+  } else {
+    // Specialized for the common case (~96.0%).
+    while (__vp / 10 > __vm / 10) {
+      __lastRemovedDigit = static_cast<uint8_t>(__vr % 10);
+      __vr /= 10;
+      __vp /= 10;
+      __vm /= 10;
+      ++__removed;
+    }
+    // We need to take vr + 1 if vr is outside bounds or we need to round up.
+    __output = __vr + (__vr == __vm || __lastRemovedDigit >= 5);
+  }
+
+  __floating_decimal_32 __fd;
+  __fd.__exponent = __e10 + __removed;
+  __fd.__mantissa = __output;
+  // Rounding up can leave a trailing zero; the callers rely on there being
+  // none.
+  while (__fd.__mantissa % 10 == 0) {
+    __fd.__mantissa /= 10;
+    ++__fd.__exponent;
+  }
+  return __fd;
+}
+
+_LIBCPP_END_NAMESPACE_STD
@@ -0,0 +1,149 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03
+
+// <vector>
+
+// Test that vector relocates trivially relocatable elements with memcpy when
+// it reallocates, without moving or destroying them, unless the allocator
+// constructs or destroys them itself, and that the other elements are still
+// moved and destroyed.
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cassert>
+#include <cstddef>
+
+#include "test_macros.h"
+
+int moves = 0;
+int destructions = 0;
+
+template <bool Relocatable>
+struct Counted {
+  typedef typename std::conditional<Relocatable, Counted, void>::type __trivially_relocatable;
+
+  explicit Counted(int v) : value(v) {}
+  Counted(Counted&& other) noexcept : value(other.value) { ++moves; }
+  Counted(const Counted&) { assert(false); }
+  Counted& operator=(Counted&& other) noexcept { value = other.value; return *this; }
+  ~Counted() { ++destructions; }
+
+  int value;
+};
+
+// Points into itself, so copying its bytes would leave it pointing into the
+// old buffer.
+struct SelfReferencing {
+  explicit SelfReferencing(int v) : value(v), self(this) {}
+  SelfReferencing(SelfReferencing&& other) noexcept : value(other.value), self(this) {}
+  SelfReferencing(const SelfReferencing& other) : value(other.value), self(this) {}
+  SelfReferencing& operator=(const SelfReferencing& other) { value = other.value; return *this; }
+  ~SelfReferencing() { assert(self == this); }
+
+  int value;
+  SelfReferencing* self;
+};
+
+template <class T>
+struct ConstructingAllocator : std::allocator<T> {
+  typedef T value_type;
+  template <class U> struct rebind { typedef ConstructingAllocator<U> other; };
+
+  ConstructingAllocator() = default;
+  template <class U> ConstructingAllocator(const ConstructingAllocator<U>&) {}
+
+  template <class U, class... Args>
+  void construct(U* p, Args&&... args) { ::new ((void*)p) U(std::forward<Args>(args)...); }
+};
+
+static_assert(std::__libcpp_is_trivially_relocatable<int>::value, "");
+static_assert(std::__libcpp_is_trivially_relocatable<Counted<true> >::value, "");
+static_assert(!std::__libcpp_is_trivially_relocatable<Counted<false> >::value, "");
+static_assert(std::__libcpp_is_trivially_relocatable<std::unique_ptr<int> >::value, "");
+static_assert(std::__libcpp_is_trivially_relocatable<std::unique_ptr<int[]> >::value, "");
+static_assert(!std::__libcpp_is_trivially_relocatable<SelfReferencing>::value, "");
+
+template <bool Relocatable, class Alloc = std::allocator<Counted<Relocatable> > >
+void test_counted(bool expect_relocation) {
+  std::vector<Counted<Relocatable>, Alloc> v;
+  v.reserve(4);
+  for (int i = 0; i < 4; ++i)
+    v.emplace_back(i);
+  moves = destructions = 0;
+
+  // Reallocates through the single-argument __swap_out_circular_buffer.
+  v.emplace_back(4);
+  assert(v.size() == 5);
+  assert(moves == (expect_relocation ? 0 : 4));
+  assert(destructions == (expect_relocation ? 0 : 4));
+
+  v.shrink_to_fit();
+  moves = destructions = 0;
+
+  // Reallocates through the two-argument __swap_out_circular_buffer, which
+  // moves the elements before and after the insertion point separately.
+  v.emplace(v.begin() + 2, 42);
+  assert(v.size() == 6);
+  assert(moves == (expect_relocation ? 0 : 5));
+  assert(destructions == (expect_relocation ? 0 : 5));
+
+  int expected[] = {0, 1, 42, 2, 3, 4};
+  for (int i = 0; i < 6; ++i)
+    assert(v[i].value == expected[i]);
+
+  destructions = 0;
+  v.clear();
+  assert(destructions == 6);
+}
+
+void test_unique_ptr() {
+  std::vector<std::unique_ptr<int> > v;
+  for (int i = 0; i < 100; ++i)
+    v.push_back(std::unique_ptr<int>(new int(i)));
+  v.insert(v.begin() + 50, std::unique_ptr<int>(new int(-1)));
+  assert(v.size() == 101);
+  for (int i = 0; i < 101; ++i)
+    assert(*v[i] == (i < 50 ? i : i == 50 ? -1 : i - 1));
+}
+
+void test_self_referencing() {
+  std::vector<SelfReferencing> v;
+  for (int i = 0; i < 100; ++i)
+    v.push_back(SelfReferencing(i));
+  v.insert(v.begin() + 10, SelfReferencing(-1));
+  for (std::size_t i = 0; i < v.size(); ++i)
+    assert(v[i].self == &v[i]);
+}
+
+// The map of a deque is a __split_buffer of pointers, which is relocated when
+// it grows at either end.
+void test_deque() {
+  std::deque<std::unique_ptr<int> > d;
+  for (int i = 0; i < 10000; ++i) {
+    d.push_back(std::unique_ptr<int>(new int(i)));
+    d.push_front(std::unique_ptr<int>(new int(-i)));
+  }
+  for (int i = 0; i < 10000; ++i) {
+    assert(*d[9999 - i] == -i);
+    assert(*d[10000 + i] == i);
+  }
+}
+
+int main(int, char**) {
+  test_counted<true>(true);
+  test_counted<false>(false);
+  test_counted<true, ConstructingAllocator<Counted<true> > >(false);
+  test_unique_ptr();
+  test_self_referencing();
+  test_deque();
+
+  return 0;
+}
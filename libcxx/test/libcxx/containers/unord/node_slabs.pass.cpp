@@ -0,0 +1,128 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// ADDITIONAL_COMPILE_FLAGS: -D_LIBCPP_ABI_HASH_TABLE_NODE_SLABS
+
+// Not a portable test
+
+// Nodes of unordered containers are allocated from slabs owned by the
+// container. Make sure that nodes which leave their container through node
+// handles or merge() keep their memory alive, and that nothing leaks.
+
+#include <unordered_map>
+#include <unordered_set>
+#include <cassert>
+#include <utility>
+
+#include "test_macros.h"
+#include "count_new.h"
+
+void test_allocation_count() {
+    globalMemCounter.reset();
+    {
+        std::unordered_set<int> s;
+        s.reserve(1000);
+        int buckets = globalMemCounter.new_called;
+        for (int i = 0; i < 1000; ++i)
+            s.insert(i);
+        // One slab plus the control block for the first few nodes, then
+        // slabs doubling in size up to a fixed number of nodes.
+        assert(globalMemCounter.new_called - buckets < 20);
+        for (int i = 0; i < 1000; i += 2)
+            s.erase(i);
+        int before = globalMemCounter.new_called;
+        for (int i = 1000; i < 1500; ++i)
+            s.insert(i);
+        // Erased nodes are reused.
+        assert(globalMemCounter.checkNewCalledEq(before));
+        assert(s.size() == 1000);
+    }
+    assert(globalMemCounter.checkOutstandingNewEq(0));
+}
+
+void test_extract() {
+    globalMemCounter.reset();
+    {
+        std::unordered_map<int, int>::node_type nh;
+        {
+            std::unordered_map<int, int> m;
+            for (int i = 0; i < 100; ++i)
+                m.emplace(i, i);
+            nh = m.extract(42);
+        }
+        assert(!nh.empty());
+        assert(nh.key() == 42);
+        assert(nh.mapped() == 42);
+
+        std::unordered_map<int, int> m2;
+        m2.insert(std::move(nh));
+        assert(m2.size() == 1);
+        assert(m2.at(42) == 42);
+        m2.erase(42);
+        m2.emplace(1, 1);
+        assert(m2.at(1) == 1);
+    }
+    assert(globalMemCounter.checkOutstandingNewEq(0));
+}
+
+void test_merge() {
+    globalMemCounter.reset();
+    {
+        std::unordered_multiset<int> dst;
+        {
+            std::unordered_multiset<int> src;
+            for (int i = 0; i < 100; ++i)
+                src.insert(i);
+            dst.merge(src);
+            assert(src.empty());
+            for (int i = 0; i < 100; ++i)
+                src.insert(i);
+            dst.merge(src);
+        }
+        assert(dst.size() == 200);
+        for (int i = 0; i < 100; ++i)
+            assert(dst.count(i) == 2);
+        dst.erase(dst.begin(), dst.end());
+        dst.insert(1);
+        assert(dst.size() == 1);
+    }
+    assert(globalMemCounter.checkOutstandingNewEq(0));
+}
+
+void test_swap_and_move() {
+    globalMemCounter.reset();
+    {
+        std::unordered_set<int> a;
+        std::unordered_set<int> b;
+        for (int i = 0; i < 50; ++i) {
+            a.insert(i);
+            b.insert(-i);
+        }
+        a.swap(b);
+        a.erase(-1);
+        b.erase(1);
+        std::unordered_set<int> c(std::move(a));
+        assert(c.size() == 49);
+        a = std::move(b);
+        assert(a.size() == 49);
+        c = a;
+        assert(c == a);
+    }
+    assert(globalMemCounter.checkOutstandingNewEq(0));
+}
+
+int main(int, char**) {
+    test_allocation_count();
+    test_extract();
+    test_merge();
+    test_swap_and_move();
+
+    return 0;
+}
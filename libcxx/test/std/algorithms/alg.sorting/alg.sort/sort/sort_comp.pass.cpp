@@ -20,6 +20,7 @@
 #include <cassert>
 #include <cstddef>
 #include <memory>
+#include <random>
 
 #include "test_macros.h"
 
@@ -30,6 +31,61 @@ struct indirect_less
         {return *x < *y;}
 };
 
+// The adversary from M. D. McIlroy, "A Killer Adversary for Quicksort": values
+// are only decided once the algorithm compares two undecided elements, which
+// drives a plain quicksort to a quadratic number of comparisons.
+struct killer_adversary
+{
+    std::vector<std::size_t>& values;
+    std::size_t gas;
+    std::size_t& solid;
+    std::size_t& candidate;
+    std::size_t& comparisons;
+
+    bool operator()(std::size_t x, std::size_t y)
+    {
+        ++comparisons;
+        if (values[x] == gas && values[y] == gas)
+            values[x == candidate ? x : y] = solid++;
+        if (values[x] == gas)
+            candidate = x;
+        else if (values[y] == gas)
+            candidate = y;
+        return values[x] < values[y];
+    }
+};
+
+void test_adversary(std::size_t n)
+{
+    std::vector<std::size_t> values(n, n);
+    std::vector<std::size_t> indices(n);
+    for (std::size_t i = 0; i < n; ++i)
+        indices[i] = i;
+    std::size_t solid = 0;
+    std::size_t candidate = 0;
+    std::size_t comparisons = 0;
+    killer_adversary comp = {values, n, solid, candidate, comparisons};
+    std::sort(indices.begin(), indices.end(), comp);
+    for (std::size_t i = 0; i + 1 < n; ++i)
+        assert(values[indices[i]] < values[indices[i + 1]]);
+    std::size_t log2n = 0;
+    for (std::size_t i = n; i > 1; i /= 2)
+        ++log2n;
+    // O(N log N) comparisons are required since C++11.
+    assert(comparisons <= 8 * n * log2n);
+}
+
+template <class T, class Compare>
+void test_few_unique(std::size_t n, Compare comp)
+{
+    std::mt19937 randomness;
+    std::vector<T> v(n);
+    for (std::size_t i = 0; i < n; ++i)
+        v[i] = static_cast<T>(randomness() % 8);
+    std::sort(v.begin(), v.end(), comp);
+    assert(std::is_sorted(v.begin(), v.end(), comp));
+}
+
 int main(int, char**)
 {
     {
@@ -41,6 +97,12 @@ int main(int, char**)
     assert(std::is_sorted(v.begin(), v.end()));
     }
 
+    test_adversary(1000);
+    test_adversary(10007);
+    test_few_unique<int>(1000, std::less<int>());
+    test_few_unique<int>(10007, std::greater<int>());
+    test_few_unique<double>(10007, std::greater<double>());
+
 #if TEST_STD_VER >= 11
     {
     std::vector<std::unique_ptr<int> > v(1000);
@@ -1,4 +1,3 @@
-
 //===----------------------------------------------------------------------===//
 //
 // Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
@@ -7,29 +6,79 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// <memory_resource> feature macros
+// WARNING: This test was generated by generate_feature_test_macro_components.py
+// and should not be edited manually.
+//
+// clang-format off
 
-/*  Constant                                    Value
-    __cpp_lib_memory_resource                   201603L
+// <memory_resource>
 
+// Test the feature test macros defined by <memory_resource>
+
+/*  Constant                     Value
+    __cpp_lib_memory_resource    201603L [C++17]
 */
 
-// XFAIL
-// #include <memory_resource>
-#include <cassert>
+#include <memory_resource>
 #include "test_macros.h"
 
-int main(int, char**)
-{
-//  ensure that the macros that are supposed to be defined in <memory_resource> are defined.
+#if TEST_STD_VER < 14
 
-/*
-#if !defined(__cpp_lib_fooby)
-# error "__cpp_lib_fooby is not defined"
-#elif __cpp_lib_fooby < 201606L
-# error "__cpp_lib_fooby has an invalid value"
-#endif
-*/
+# ifdef __cpp_lib_memory_resource
+#   error "__cpp_lib_memory_resource should not be defined before c++17"
+# endif
+
+#elif TEST_STD_VER == 14
+
+# ifdef __cpp_lib_memory_resource
+#   error "__cpp_lib_memory_resource should not be defined before c++17"
+# endif
+
+#elif TEST_STD_VER == 17
+
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
+#   ifndef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should be defined in c++17"
+#   endif
+#   if __cpp_lib_memory_resource != 201603L
+#     error "__cpp_lib_memory_resource should have the value 201603L in c++17"
+#   endif
+# else
+#   ifdef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
+#   endif
+# endif
+
+#elif TEST_STD_VER == 20
+
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
+#   ifndef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should be defined in c++20"
+#   endif
+#   if __cpp_lib_memory_resource != 201603L
+#     error "__cpp_lib_memory_resource should have the value 201603L in c++20"
+#   endif
+# else
+#   ifdef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
+#   endif
+# endif
+
+#elif TEST_STD_VER > 20
+
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
+#   ifndef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should be defined in c++2b"
+#   endif
+#   if __cpp_lib_memory_resource != 201603L
+#     error "__cpp_lib_memory_resource should have the value 201603L in c++2b"
+#   endif
+# else
+#   ifdef __cpp_lib_memory_resource
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
+#   endif
+# endif
+
+#endif // TEST_STD_VER > 20
 
-  return 0;
-}
+int main(int, char**) { return 0; }
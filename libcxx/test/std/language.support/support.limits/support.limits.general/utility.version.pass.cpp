@@ -128,16 +128,16 @@
 #   error "__cpp_lib_integer_sequence should have the value 201304L in c++17"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++17"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++17"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
@@ -191,16 +191,16 @@
 #   error "__cpp_lib_integer_sequence should have the value 201304L in c++20"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++20"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++20"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
@@ -254,16 +254,16 @@
 #   error "__cpp_lib_integer_sequence should have the value 201304L in c++2b"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++2b"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++2b"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
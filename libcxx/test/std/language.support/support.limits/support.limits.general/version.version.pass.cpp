@@ -1770,16 +1770,16 @@
 #   endif
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
 #   ifndef __cpp_lib_memory_resource
 #     error "__cpp_lib_memory_resource should be defined in c++17"
 #   endif
 #   if __cpp_lib_memory_resource != 201603L
 #     error "__cpp_lib_memory_resource should have the value 201603L in c++17"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_memory_resource
-#     error "__cpp_lib_memory_resource should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
 #   endif
 # endif
 
@@ -1995,16 +1995,16 @@
 #   error "__cpp_lib_to_array should not be defined before c++20"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++17"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++17"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
@@ -2895,16 +2895,16 @@
 #   endif
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
 #   ifndef __cpp_lib_memory_resource
 #     error "__cpp_lib_memory_resource should be defined in c++20"
 #   endif
 #   if __cpp_lib_memory_resource != 201603L
 #     error "__cpp_lib_memory_resource should have the value 201603L in c++20"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_memory_resource
-#     error "__cpp_lib_memory_resource should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
 #   endif
 # endif
 
@@ -3204,16 +3204,16 @@
 #   error "__cpp_lib_to_array should have the value 201907L in c++20"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++20"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++20"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
@@ -4110,16 +4110,16 @@
 #   endif
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource)
 #   ifndef __cpp_lib_memory_resource
 #     error "__cpp_lib_memory_resource should be defined in c++2b"
 #   endif
 #   if __cpp_lib_memory_resource != 201603L
 #     error "__cpp_lib_memory_resource should have the value 201603L in c++2b"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_memory_resource
-#     error "__cpp_lib_memory_resource should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_memory_resource should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_memory_resource) is not defined!"
 #   endif
 # endif
 
@@ -4440,16 +4440,16 @@
 #   error "__cpp_lib_to_array should have the value 201907L in c++2b"
 # endif
 
-# if !defined(_LIBCPP_VERSION)
+# if !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars)
 #   ifndef __cpp_lib_to_chars
 #     error "__cpp_lib_to_chars should be defined in c++2b"
 #   endif
 #   if __cpp_lib_to_chars != 201611L
 #     error "__cpp_lib_to_chars should have the value 201611L in c++2b"
 #   endif
-# else // _LIBCPP_VERSION
+# else
 #   ifdef __cpp_lib_to_chars
-#     error "__cpp_lib_to_chars should not be defined because it is unimplemented in libc++!"
+#     error "__cpp_lib_to_chars should not be defined when !defined(_LIBCPP_AVAILABILITY_DISABLE_FTM___cpp_lib_to_chars) is not defined!"
 #   endif
 # endif
 
@@ -0,0 +1,168 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The floating-point overloads are not shipped in any system dylib yet.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <charconv>
+
+// from_chars_result from_chars(const char* first, const char* last, float& value,
+//                              chars_format fmt = chars_format::general);
+// from_chars_result from_chars(const char* first, const char* last, double& value,
+//                              chars_format fmt = chars_format::general);
+// from_chars_result from_chars(const char* first, const char* last, long double& value,
+//                              chars_format fmt = chars_format::general);
+
+#include <charconv>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "test_macros.h"
+
+template <class T>
+void test(const char* str, T expected, std::size_t length, std::chars_format fmt = std::chars_format::general) {
+  T value = 0;
+  std::from_chars_result r = std::from_chars(str, str + std::strlen(str), value, fmt);
+  assert(r.ec == std::errc{});
+  assert(r.ptr == str + length);
+  assert(value == expected);
+  assert(std::signbit(value) == std::signbit(expected));
+}
+
+template <class T>
+void test_invalid(const char* str, std::chars_format fmt = std::chars_format::general) {
+  T value = 42;
+  std::from_chars_result r = std::from_chars(str, str + std::strlen(str), value, fmt);
+  assert(r.ec == std::errc::invalid_argument);
+  assert(r.ptr == str);
+  assert(value == 42);
+}
+
+template <class T>
+void test_out_of_range(const char* str, std::chars_format fmt = std::chars_format::general) {
+  T value = 42;
+  std::from_chars_result r = std::from_chars(str, str + std::strlen(str), value, fmt);
+  assert(r.ec == std::errc::result_out_of_range);
+  assert(r.ptr == str + std::strlen(str));
+  assert(value == 42);
+}
+
+template <class T>
+void test_nan(const char* str, std::size_t length, bool negative) {
+  T value = 0;
+  std::from_chars_result r = std::from_chars(str, str + std::strlen(str), value);
+  assert(r.ec == std::errc{});
+  assert(r.ptr == str + length);
+  assert(std::isnan(value));
+  assert(std::signbit(value) == negative);
+}
+
+void test_double() {
+  test("1", 1.0, 1);
+  test("-1.5", -1.5, 4);
+  test("0.1", 0.1, 3);
+  test(".5", 0.5, 2);
+  test("5.", 5.0, 2);
+  test("-0", -0.0, 2);
+  test("1e10", 1e10, 4);
+  test("1E+10", 1e10, 5);
+  test("12.5e-1", 1.25, 7);
+  test("1.5x", 1.5, 3);
+  test("1e", 1.0, 1);
+  test("1e+", 1.0, 1);
+  test("1..5", 1.0, 2);
+  test("0000000000000000000000000000000000001", 1.0, 37);
+  test("123456789012345678901234567890", 123456789012345678901234567890.0, 30);
+  test("1.7976931348623157e308", std::numeric_limits<double>::max(), 22);
+  test("2.2250738585072014e-308", std::numeric_limits<double>::min(), 23);
+  test("4.9406564584124654e-324", std::numeric_limits<double>::denorm_min(), 23);
+
+  // Halfway cases, which need every digit to round correctly.
+  test("9007199254740993", 9007199254740992.0, 16);
+  test("9007199254740993.0000000000000000000000000000001", 9007199254740994.0, 48);
+  test("9007199254740995", 9007199254740996.0, 16);
+  test("2.4703282292062328e-324", std::numeric_limits<double>::denorm_min(), 23);
+  test("2.2250738585072011e-308", 2.225073858507201e-308, 23);
+  test("1.00000000000000011102230246251565404236316680908203125", 1.0, 55);
+  test("1.000000000000000111022302462515654042363166809082031250000000000000000000000001", 1.0000000000000002, 80);
+
+  // Formats.
+  test("1e5", 1.0, 1, std::chars_format::fixed);
+  test("1e5", 1e5, 3, std::chars_format::scientific);
+  test_invalid<double>("15", std::chars_format::scientific);
+  test("1.8p1", 3.0, 5, std::chars_format::hex);
+  test("-a.8", -10.5, 4, std::chars_format::hex);
+  test("1p", 1.0, 1, std::chars_format::hex);
+  test("0x1", 0.0, 1, std::chars_format::hex);
+  test("1.fffffffffffffp1023", std::numeric_limits<double>::max(), 20, std::chars_format::hex);
+  test("1p-1074", std::numeric_limits<double>::denorm_min(), 7, std::chars_format::hex);
+  test("1.00000000000008p0", 1.0, 18, std::chars_format::hex);
+  test("1.00000000000018p0", 1.0000000000000004, 18, std::chars_format::hex);
+  test("1.000000000000080001p0", 1.0000000000000002, 22, std::chars_format::hex);
+
+  test_invalid<double>("");
+  test_invalid<double>("-");
+  test_invalid<double>(".");
+  test_invalid<double>("+1");
+  test_invalid<double>(" 1");
+  test_invalid<double>("e5");
+
+  test_out_of_range<double>("1e309");
+  test_out_of_range<double>("-1e309");
+  test_out_of_range<double>("1.7976931348623159e308");
+  test_out_of_range<double>("1e-400");
+  test_out_of_range<double>("2.4703282292062327e-324");
+  test_out_of_range<double>("1e-100000000000");
+  test_out_of_range<double>("1p1024", std::chars_format::hex);
+  test_out_of_range<double>("1p-1076", std::chars_format::hex);
+
+  test("inf", std::numeric_limits<double>::infinity(), 3);
+  test("-INFINITY", -std::numeric_limits<double>::infinity(), 9);
+  test("infinit", std::numeric_limits<double>::infinity(), 3);
+  test_nan<double>("nan", 3, false);
+  test_nan<double>("-NaN(1a_b)", 10, true);
+  test_nan<double>("nan(", 3, false);
+  test_nan<double>("nan(-)", 3, false);
+}
+
+void test_float() {
+  test("0.1", 0.1f, 3);
+  test("16777217", 16777216.0f, 8);
+  test("16777219", 16777220.0f, 8);
+  test("3.4028235e38", std::numeric_limits<float>::max(), 12);
+  test("1.17549435e-38", std::numeric_limits<float>::min(), 14);
+  test("1e-45", std::numeric_limits<float>::denorm_min(), 5);
+  test("1.fffffep127", std::numeric_limits<float>::max(), 12, std::chars_format::hex);
+  test("1p-149", std::numeric_limits<float>::denorm_min(), 6, std::chars_format::hex);
+
+  test_out_of_range<float>("3.5e38");
+  test_out_of_range<float>("1e-50");
+  test_out_of_range<float>("1p128", std::chars_format::hex);
+
+  test("inf", std::numeric_limits<float>::infinity(), 3);
+  test_nan<float>("nan", 3, false);
+}
+
+void test_long_double() {
+  test("1.5", 1.5L, 3);
+  test("-0.25", -0.25L, 5);
+  test("1.8p1", 3.0L, 5, std::chars_format::hex);
+}
+
+int main(int, char**) {
+  test_double();
+  test_float();
+  test_long_double();
+
+  return 0;
+}
@@ -0,0 +1,171 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The floating-point overloads are not shipped in any system dylib yet.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <charconv>
+
+// to_chars_result to_chars(char* first, char* last, float value);
+// to_chars_result to_chars(char* first, char* last, double value);
+// to_chars_result to_chars(char* first, char* last, long double value);
+// to_chars_result to_chars(char* first, char* last, float value, chars_format fmt);
+// to_chars_result to_chars(char* first, char* last, double value, chars_format fmt);
+// to_chars_result to_chars(char* first, char* last, long double value, chars_format fmt);
+// to_chars_result to_chars(char* first, char* last, float value, chars_format fmt, int precision);
+// to_chars_result to_chars(char* first, char* last, double value, chars_format fmt, int precision);
+// to_chars_result to_chars(char* first, char* last, long double value, chars_format fmt, int precision);
+
+#include <charconv>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "test_macros.h"
+
+template <class... Args>
+std::string to_string(Args... args) {
+  char buffer[2000];
+  std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), args...);
+  assert(r.ec == std::errc{});
+  return std::string(buffer, r.ptr);
+}
+
+template <class T>
+void test_shortest(T value, const char* plain, const std::string& fixed, const char* scientific, const char* general,
+                   const char* hex) {
+  assert(to_string(value) == plain);
+  assert(to_string(value, std::chars_format::fixed) == fixed);
+  assert(to_string(value, std::chars_format::scientific) == scientific);
+  assert(to_string(value, std::chars_format::general) == general);
+  assert(to_string(value, std::chars_format::hex) == hex);
+}
+
+template <class T>
+void test_round_trip(T value) {
+  for (std::chars_format fmt : {std::chars_format::fixed, std::chars_format::scientific, std::chars_format::general,
+                                std::chars_format::hex}) {
+    char buffer[2000];
+    std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), value, fmt);
+    assert(r.ec == std::errc{});
+    T back;
+    std::from_chars_result fr = std::from_chars(buffer, r.ptr, back, fmt);
+    assert(fr.ec == std::errc{});
+    assert(fr.ptr == r.ptr);
+    assert(std::memcmp(&back, &value, sizeof(T)) == 0);
+  }
+}
+
+// Compares the precision overloads with printf, which is correctly rounded
+// on the platforms we test.
+void test_printf(double value) {
+  const std::pair<std::chars_format, const char*> formats[] = {{std::chars_format::fixed, "%.*f"},
+                                                               {std::chars_format::scientific, "%.*e"},
+                                                               {std::chars_format::general, "%.*g"}};
+  for (int precision : {0, 1, 2, 6, 17, 40}) {
+    for (const auto& f : formats) {
+      char expected[2000];
+      std::snprintf(expected, sizeof(expected), f.second, precision, value);
+      assert(to_string(value, f.first, precision) == expected);
+    }
+  }
+}
+
+void test_too_large() {
+  char buffer[8];
+  std::to_chars_result r = std::to_chars(buffer, buffer + 3, 1234.0);
+  assert(r.ec == std::errc::value_too_large);
+  assert(r.ptr == buffer + 3);
+
+  r = std::to_chars(buffer, buffer + 4, 1.5, std::chars_format::scientific);
+  assert(r.ec == std::errc::value_too_large);
+  assert(r.ptr == buffer + 4);
+
+  r = std::to_chars(buffer, buffer + 4, 0.5, std::chars_format::fixed, 3);
+  assert(r.ec == std::errc::value_too_large);
+
+  r = std::to_chars(buffer, buffer + 5, 0.5, std::chars_format::fixed, 3);
+  assert(r.ec == std::errc{});
+  assert(std::string(buffer, r.ptr) == "0.500");
+}
+
+int main(int, char**) {
+  test_shortest(0.0, "0", "0", "0e+00", "0", "0p+0");
+  test_shortest(-0.0, "-0", "-0", "-0e+00", "-0", "-0p+0");
+  test_shortest(1.0, "1", "1", "1e+00", "1", "1p+0");
+  test_shortest(0.1, "0.1", "0.1", "1e-01", "0.1", "1.999999999999ap-4");
+  test_shortest(-123.456, "-123.456", "-123.456", "-1.23456e+02", "-123.456", "-1.edd2f1a9fbe77p+6");
+  test_shortest(1e22, "1e+22", "10000000000000000000000", "1e+22", "1e+22", "1.0f0cf064dd592p+73");
+  // Fixed notation prints the exact integer, not the shortest digits padded with zeros.
+  test_shortest(1e23, "1e+23", "99999999999999991611392", "1e+23", "1e+23", "1.52d02c7e14af6p+76");
+  test_shortest(123456.0, "123456", "123456", "1.23456e+05", "123456", "1.e24p+16");
+  test_shortest(1234567.0, "1234567", "1234567", "1.234567e+06", "1.234567e+06", "1.2d687p+20");
+  test_shortest(0.0001, "1e-04", "0.0001", "1e-04", "0.0001", "1.a36e2eb1c432dp-14");
+  test_shortest(0.00001, "1e-05", "0.00001", "1e-05", "1e-05", "1.4f8b588e368f1p-17");
+  test_shortest(std::numeric_limits<double>::max(), "1.7976931348623157e+308",
+                "179769313486231570814527423731704356798070567525844996598917476803157260780028538760589558632766878171"
+                "540458953514382464234321326889464182768467546703537516986049910576551282076245490090389328944075868508"
+                "455133942304583236903222948165808559332123348274797826204144723168738177180919299881250404026184124858"
+                "368",
+                "1.7976931348623157e+308", "1.7976931348623157e+308", "1.fffffffffffffp+1023");
+  test_shortest(std::numeric_limits<double>::denorm_min(), "5e-324", "0." + std::string(323, '0') + "5", "5e-324",
+                "5e-324", "0.0000000000001p-1022");
+
+  test_shortest(0.1f, "0.1", "0.1", "1e-01", "0.1", "1.99999ap-4");
+  test_shortest(3.4028235e38f, "3.4028235e+38", "340282346638528859811704183484516925440", "3.4028235e+38",
+                "3.4028235e+38", "1.fffffep+127");
+  test_shortest(16777216.0f, "16777216", "16777216", "1.6777216e+07", "1.6777216e+07", "1p+24");
+
+  assert(to_string(1.5L) == "1.5");
+  assert(to_string(1.5L, std::chars_format::scientific) == "1.5e+00");
+  assert(to_string(1.5L, std::chars_format::fixed, 2) == "1.50");
+
+  assert(to_string(std::numeric_limits<double>::infinity()) == "inf");
+  assert(to_string(-std::numeric_limits<double>::infinity(), std::chars_format::fixed, 3) == "-inf");
+  assert(to_string(std::numeric_limits<float>::quiet_NaN()) == "nan");
+  assert(to_string(-std::numeric_limits<double>::quiet_NaN(), std::chars_format::hex) == "-nan");
+
+  // Precision: rounding to nearest with ties to even on the exact value.
+  assert(to_string(0.125, std::chars_format::fixed, 2) == "0.12");
+  assert(to_string(0.375, std::chars_format::fixed, 2) == "0.38");
+  assert(to_string(9.5, std::chars_format::fixed, 0) == "10");
+  assert(to_string(9.96, std::chars_format::scientific, 1) == "1.0e+01");
+  assert(to_string(9.96e-48, std::chars_format::scientific, 1) == "1.0e-47");
+  assert(to_string(0.1, std::chars_format::fixed, 30) == "0.100000000000000005551115123126");
+  assert(to_string(1e300, std::chars_format::scientific, 0) == "1e+300");
+  assert(to_string(1.0, std::chars_format::general, 0) == "1");
+  assert(to_string(100.0, std::chars_format::general, 2) == "1e+02");
+  assert(to_string(0.0001, std::chars_format::general, 3) == "0.0001");
+  assert(to_string(1.0, std::chars_format::general, -1) == "1");
+  assert(to_string(1.0, std::chars_format::fixed, -1) == "1.000000");
+  assert(to_string(1.0, std::chars_format::hex, 0) == "1p+0");
+  assert(to_string(1.0, std::chars_format::hex, 3) == "1.000p+0");
+  assert(to_string(1.03125, std::chars_format::hex, 1) == "1.0p+0");
+  assert(to_string(1.09375, std::chars_format::hex, 1) == "1.2p+0");
+  assert(to_string(1.96875, std::chars_format::hex, 0) == "2p+0");
+  assert(to_string(0.1f, std::chars_format::scientific, 10) == "1.0000000149e-01");
+
+  for (double value : {0.1, 1.0 / 3, 2.5, 1e-5, 123456789.0, 6.02214076e23, 5e-324, 2.2250738585072014e-308})
+    test_printf(value);
+
+  for (double value : {0.3, 2.0 / 3, 1e-300, 9007199254740993.0, 2.2250738585072009e-308, 1.7976931348623157e308,
+                       -5e-324})
+    test_round_trip(value);
+  for (float value : {0.3f, 2.0f / 3, 1e-40f, 16777217.0f, 1.17549435e-38f, 3.4028235e38f})
+    test_round_trip(value);
+
+  test_too_large();
+
+  return 0;
+}
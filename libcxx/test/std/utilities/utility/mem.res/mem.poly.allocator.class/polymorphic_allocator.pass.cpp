@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <memory_resource>
+
+// template <class T> class polymorphic_allocator
+
+#include <memory_resource>
+#include <cassert>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "test_macros.h"
+
+struct uses_arg
+{
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    uses_arg(std::allocator_arg_t, const allocator_type& a, int v)
+        : res(a.resource()), value(v) {}
+    std::pmr::memory_resource* res;
+    int value;
+};
+
+struct uses_trailing
+{
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    uses_trailing(int v, const allocator_type& a)
+        : res(a.resource()), value(v) {}
+    std::pmr::memory_resource* res;
+    int value;
+};
+
+int main(int, char**)
+{
+    std::pmr::monotonic_buffer_resource mono;
+    std::pmr::memory_resource* r = &mono;
+
+    {
+        std::pmr::polymorphic_allocator<int> a;
+        assert(a.resource() == std::pmr::get_default_resource());
+        std::pmr::polymorphic_allocator<int> b(r);
+        std::pmr::polymorphic_allocator<double> c(b);
+        assert(c.resource() == r);
+        assert(b == c && a != b);
+        assert(b.select_on_container_copy_construction().resource() ==
+               std::pmr::get_default_resource());
+
+        int* p = b.allocate(10);
+        b.deallocate(p, 10);
+#ifndef TEST_HAS_NO_EXCEPTIONS
+        try {
+            (void)b.allocate(static_cast<std::size_t>(-1) / sizeof(int) + 1);
+            assert(false);
+        } catch (const std::length_error&) {
+        }
+#endif
+    }
+    // Uses-allocator construction with both leading and trailing allocators.
+    {
+        std::pmr::polymorphic_allocator<char> a(r);
+        alignas(uses_arg) char buf1[sizeof(uses_arg)];
+        uses_arg* p1 = reinterpret_cast<uses_arg*>(buf1);
+        a.construct(p1, 1);
+        assert(p1->res == r && p1->value == 1);
+        a.destroy(p1);
+
+        alignas(uses_trailing) char buf2[sizeof(uses_trailing)];
+        uses_trailing* p2 = reinterpret_cast<uses_trailing*>(buf2);
+        a.construct(p2, 2);
+        assert(p2->res == r && p2->value == 2);
+        a.destroy(p2);
+
+        using P = std::pair<uses_arg, uses_trailing>;
+        alignas(P) char buf3[sizeof(P)];
+        P* p3 = reinterpret_cast<P*>(buf3);
+        a.construct(p3, std::piecewise_construct, std::make_tuple(3),
+                    std::make_tuple(4));
+        assert(p3->first.res == r && p3->first.value == 3);
+        assert(p3->second.res == r && p3->second.value == 4);
+        a.destroy(p3);
+
+        a.construct(p3, 5, 6);
+        assert(p3->first.value == 5 && p3->second.value == 6);
+        a.destroy(p3);
+    }
+    // The allocator propagates into nested containers.
+    {
+        using Inner = std::vector<int, std::pmr::polymorphic_allocator<int>>;
+        std::vector<Inner, std::pmr::polymorphic_allocator<Inner>> v(r);
+        v.emplace_back(3, 1);
+        assert(v[0].get_allocator().resource() == r);
+    }
+
+    return 0;
+}
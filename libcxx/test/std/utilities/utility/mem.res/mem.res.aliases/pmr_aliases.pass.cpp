@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+// UNSUPPORTED: libcpp-has-no-localization
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <deque>, <forward_list>, <list>, <map>, <regex>, <set>, <string>,
+// <unordered_map>, <unordered_set>, <vector>
+
+// The std::pmr container aliases.
+
+#include <deque>
+#include <forward_list>
+#include <list>
+#include <map>
+#include <regex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <memory_resource>
+#include <cassert>
+#include <type_traits>
+
+#include "test_macros.h"
+
+template <class C, class V>
+void check_alias()
+{
+    static_assert(std::is_same<typename C::allocator_type,
+                               std::pmr::polymorphic_allocator<V>>::value, "");
+}
+
+int main(int, char**)
+{
+    namespace pmr = std::pmr;
+
+    check_alias<pmr::vector<int>, int>();
+    check_alias<pmr::deque<int>, int>();
+    check_alias<pmr::forward_list<int>, int>();
+    check_alias<pmr::list<int>, int>();
+    check_alias<pmr::map<int, long>, std::pair<const int, long>>();
+    check_alias<pmr::multimap<int, long>, std::pair<const int, long>>();
+    check_alias<pmr::set<int>, int>();
+    check_alias<pmr::multiset<int>, int>();
+    check_alias<pmr::unordered_map<int, long>, std::pair<const int, long>>();
+    check_alias<pmr::unordered_multimap<int, long>, std::pair<const int, long>>();
+    check_alias<pmr::unordered_set<int>, int>();
+    check_alias<pmr::unordered_multiset<int>, int>();
+    check_alias<pmr::string, char>();
+    check_alias<pmr::wstring, wchar_t>();
+    check_alias<pmr::u16string, char16_t>();
+    check_alias<pmr::u32string, char32_t>();
+    check_alias<pmr::smatch, std::sub_match<pmr::string::const_iterator>>();
+    check_alias<pmr::cmatch, std::csub_match>();
+
+    static_assert(std::is_same<pmr::map<int, int>::key_compare,
+                               std::less<int>>::value, "");
+    static_assert(std::is_same<pmr::unordered_set<int>::hasher,
+                               std::hash<int>>::value, "");
+
+    char buffer[1024];
+    pmr::monotonic_buffer_resource mono(buffer, sizeof(buffer),
+                                        pmr::null_memory_resource());
+    {
+        pmr::vector<pmr::string> v(&mono);
+        v.emplace_back("a string long enough to need a heap allocation");
+        assert(v[0].get_allocator().resource() == &mono);
+
+        pmr::map<int, pmr::string> m(&mono);
+        m[1] = "one";
+        assert(m[1].get_allocator().resource() == &mono);
+    }
+
+    return 0;
+}
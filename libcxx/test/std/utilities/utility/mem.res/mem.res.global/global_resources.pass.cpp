@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <memory_resource>
+
+// memory_resource* new_delete_resource() noexcept;
+// memory_resource* null_memory_resource() noexcept;
+// memory_resource* get_default_resource() noexcept;
+// memory_resource* set_default_resource(memory_resource* r) noexcept;
+
+#include <memory_resource>
+#include <cassert>
+#include <new>
+#include <type_traits>
+
+#include "test_macros.h"
+#include "count_new.h"
+
+int main(int, char**)
+{
+    namespace pmr = std::pmr;
+
+    static_assert(noexcept(pmr::new_delete_resource()), "");
+    static_assert(noexcept(pmr::null_memory_resource()), "");
+    static_assert(noexcept(pmr::get_default_resource()), "");
+    static_assert(noexcept(pmr::set_default_resource(nullptr)), "");
+
+    pmr::memory_resource* nd = pmr::new_delete_resource();
+    pmr::memory_resource* null = pmr::null_memory_resource();
+    assert(nd && null && nd != null);
+    assert(nd == pmr::new_delete_resource());
+    assert(null == pmr::null_memory_resource());
+    assert(*nd != *null);
+
+    // The default resource starts as new_delete_resource(), and a null
+    // argument to set_default_resource restores it.
+    assert(pmr::get_default_resource() == nd);
+    assert(pmr::set_default_resource(null) == nd);
+    assert(pmr::get_default_resource() == null);
+    assert(pmr::set_default_resource(nullptr) == null);
+    assert(pmr::get_default_resource() == nd);
+
+    {
+        globalMemCounter.reset();
+        void* p = nd->allocate(64, 64);
+        assert(globalMemCounter.checkOutstandingNewEq(1));
+        assert(reinterpret_cast<std::uintptr_t>(p) % 64 == 0);
+        nd->deallocate(p, 64, 64);
+        assert(globalMemCounter.checkOutstandingNewEq(0));
+    }
+#ifndef TEST_HAS_NO_EXCEPTIONS
+    try {
+        (void)null->allocate(1);
+        assert(false);
+    } catch (const std::bad_alloc&) {
+    }
+#endif
+
+    return 0;
+}
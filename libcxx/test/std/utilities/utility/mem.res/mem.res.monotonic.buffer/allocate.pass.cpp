@@ -0,0 +1,111 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <memory_resource>
+
+// class monotonic_buffer_resource
+
+#include <memory_resource>
+#include <cassert>
+#include <cstdint>
+
+#include "test_macros.h"
+
+struct counting_resource : std::pmr::memory_resource
+{
+    int allocs = 0;
+    int outstanding = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        ++allocs;
+        ++outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+    {
+        --outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return &other == this;
+    }
+};
+
+static bool is_aligned(void* p, std::size_t align)
+{
+    return reinterpret_cast<std::uintptr_t>(p) % align == 0;
+}
+
+void test_initial_buffer()
+{
+    alignas(16) char buffer[256];
+    std::pmr::monotonic_buffer_resource mono(buffer, sizeof(buffer),
+                                              std::pmr::null_memory_resource());
+    char* p1 = static_cast<char*>(mono.allocate(10, 1));
+    char* p2 = static_cast<char*>(mono.allocate(10, 8));
+    assert(p1 >= buffer && p1 + 10 <= buffer + sizeof(buffer));
+    assert(p2 >= p1 + 10 && is_aligned(p2, 8));
+
+    // Deallocation is a no-op and release() reuses the buffer from the start.
+    mono.deallocate(p1, 10, 1);
+    mono.release();
+    assert(mono.allocate(10, 1) == p1);
+
+#ifndef TEST_HAS_NO_EXCEPTIONS
+    // Once the buffer is exhausted the request goes upstream, which throws.
+    try {
+        (void)mono.allocate(1024, 1);
+        assert(false);
+    } catch (const std::bad_alloc&) {
+    }
+#endif
+}
+
+void test_upstream_chunks()
+{
+    counting_resource upstream;
+    {
+        std::pmr::monotonic_buffer_resource mono(100, &upstream);
+        assert(mono.upstream_resource() == &upstream);
+        assert(upstream.allocs == 0);
+
+        void* p = mono.allocate(50, 16);
+        assert(is_aligned(p, 16));
+        assert(upstream.allocs == 1);
+        for (int i = 0; i < 100; ++i)
+            assert(is_aligned(mono.allocate(40, 32), 32));
+        // Chunks grow geometrically, so far fewer requests than allocations
+        // reach the upstream resource.
+        assert(upstream.allocs <= 8);
+
+        mono.release();
+        assert(upstream.outstanding == 0);
+        (void)mono.allocate(8);
+        assert(upstream.outstanding == 1);
+    }
+    // The destructor releases everything.
+    assert(upstream.outstanding == 0);
+}
+
+int main(int, char**)
+{
+    test_initial_buffer();
+    test_upstream_chunks();
+
+    return 0;
+}
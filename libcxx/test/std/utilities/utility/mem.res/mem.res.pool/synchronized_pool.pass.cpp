@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+// UNSUPPORTED: libcpp-has-no-threads
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <memory_resource>
+
+// class synchronized_pool_resource
+
+#include <memory_resource>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "test_macros.h"
+
+struct counting_resource : std::pmr::memory_resource
+{
+    std::atomic<int> allocs{0};
+    std::atomic<int> outstanding{0};
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        ++allocs;
+        ++outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+    {
+        --outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return &other == this;
+    }
+};
+
+void worker(std::pmr::memory_resource* pool, int seed)
+{
+    std::vector<std::pair<void*, std::size_t>> live;
+    for (int i = 0; i < 10000; ++i) {
+        std::size_t bytes = 1 + (i * 7919 + seed) % 300;
+        if (i % 3 == 2) {
+            std::pair<void*, std::size_t> b = live.back();
+            live.pop_back();
+            pool->deallocate(b.first, b.second, 8);
+        } else {
+            void* p = pool->allocate(bytes, 8);
+            std::memset(p, seed, bytes);
+            live.emplace_back(p, bytes);
+        }
+    }
+    for (auto& b : live)
+        pool->deallocate(b.first, b.second, 8);
+}
+
+int main(int, char**)
+{
+    counting_resource upstream;
+    {
+        std::pmr::synchronized_pool_resource pool(&upstream);
+        assert(pool.upstream_resource() == &upstream);
+        assert(pool.options().max_blocks_per_chunk > 0);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+            threads.emplace_back(worker, &pool, t);
+        for (auto& t : threads)
+            t.join();
+
+        pool.release();
+        assert(upstream.outstanding == 0);
+        worker(&pool, 42);
+    }
+    assert(upstream.outstanding == 0);
+
+    return 0;
+}
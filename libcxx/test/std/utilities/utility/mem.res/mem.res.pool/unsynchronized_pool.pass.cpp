@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++03, c++11, c++14
+
+// The pmr resources are not shipped in the system dylib on Apple platforms.
+// XFAIL: with_system_cxx_lib=macosx
+
+// <memory_resource>
+
+// class unsynchronized_pool_resource
+
+#include <memory_resource>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "test_macros.h"
+
+struct counting_resource : std::pmr::memory_resource
+{
+    int allocs = 0;
+    int outstanding = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override
+    {
+        ++allocs;
+        ++outstanding;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override
+    {
+        --outstanding;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return &other == this;
+    }
+};
+
+void test_options()
+{
+    std::pmr::pool_options opts;
+    opts.max_blocks_per_chunk = 0;
+    opts.largest_required_pool_block = 0;
+    std::pmr::unsynchronized_pool_resource pool(opts);
+    assert(pool.upstream_resource() == std::pmr::get_default_resource());
+    // Zero means "use the implementation's default", which is never zero.
+    assert(pool.options().max_blocks_per_chunk > 0);
+    assert(pool.options().largest_required_pool_block > 0);
+
+    opts.max_blocks_per_chunk = 4;
+    opts.largest_required_pool_block = 100;
+    std::pmr::unsynchronized_pool_resource small(opts);
+    assert(small.options().max_blocks_per_chunk >= 4);
+    assert(small.options().largest_required_pool_block >= 100);
+}
+
+void test_reuse()
+{
+    counting_resource upstream;
+    {
+        std::pmr::unsynchronized_pool_resource pool(&upstream);
+        std::vector<void*> blocks;
+        for (int i = 0; i < 1000; ++i) {
+            void* p = pool.allocate(24, 8);
+            assert(reinterpret_cast<std::uintptr_t>(p) % 8 == 0);
+            std::memset(p, i, 24);
+            blocks.push_back(p);
+        }
+        // Small blocks are carved out of a few chunks.
+        assert(upstream.allocs < 20);
+
+        int allocs = upstream.allocs;
+        for (void* p : blocks)
+            pool.deallocate(p, 24, 8);
+        for (int i = 0; i < 1000; ++i)
+            blocks[i] = pool.allocate(24, 8);
+        // Freed blocks are reused without asking upstream for more.
+        assert(upstream.allocs == allocs);
+
+        // Requests larger than the largest pool go directly upstream and are
+        // returned there on deallocation.
+        std::size_t big = pool.options().largest_required_pool_block + 1;
+        void* p = pool.allocate(big, 64);
+        assert(reinterpret_cast<std::uintptr_t>(p) % 64 == 0);
+        int outstanding = upstream.outstanding;
+        pool.deallocate(p, big, 64);
+        assert(upstream.outstanding == outstanding - 1);
+
+        pool.release();
+        assert(upstream.outstanding == 0);
+        (void)pool.allocate(8);
+    }
+    assert(upstream.outstanding == 0);
+}
+
+int main(int, char**)
+{
+    test_options();
+    test_reuse();
+
+    return 0;
+}
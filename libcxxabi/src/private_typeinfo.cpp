@@ -49,6 +49,11 @@
 #include <atomic>
 #endif
 
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+#include <atomic>
+#include <stdint.h>
+#endif
+
 static inline
 bool
 is_equal(const std::type_info* x, const std::type_info* y, bool use_strcmp)
@@ -71,6 +76,92 @@ static inline ptrdiff_t update_offset_to_base(const char* vtable,
 #endif
 }
 
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+
+// A lock-free, direct-mapped cache of the results of __dynamic_cast and of
+// matching a thrown class against the class of a catch clause. The result of
+// either only depends on the type_info objects and the vtable involved, none
+// of which is ever freed, so entries are never invalidated. Shared objects
+// with RTTI which are unloaded by dlclose are the exception, which is why the
+// cache is optional (LIBCXXABI_ENABLE_DYNAMIC_CAST_CACHE).
+//
+// Each entry is protected by a sequence number, which is odd while the entry
+// is written. A reader retries nothing: if the entry changes while it is read,
+// or another thread writes it, the lookup misses and the hierarchy is walked.
+// The cache is zero-initialized, so that it can be used before any static
+// constructor ran.
+namespace {
+
+class type_cache
+{
+public:
+    // The offset stored for a failed cast or a catch clause which does not
+    // match.
+    static const ptrdiff_t no_match = PTRDIFF_MIN;
+
+    bool lookup(const void* k0, const void* k1, const void* k2,
+                ptrdiff_t& offset)
+    {
+        entry& e = entries[hash(k0, k1, k2)];
+        size_t sequence = e.sequence.load(std::memory_order_acquire);
+        if (sequence & 1)
+            return false;
+        bool found = e.key[0].load(std::memory_order_relaxed) == k0 &&
+                     e.key[1].load(std::memory_order_relaxed) == k1 &&
+                     e.key[2].load(std::memory_order_relaxed) == k2;
+        ptrdiff_t value = e.offset.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!found || e.sequence.load(std::memory_order_relaxed) != sequence)
+            return false;
+        offset = value;
+        return true;
+    }
+
+    void insert(const void* k0, const void* k1, const void* k2,
+                ptrdiff_t offset)
+    {
+        entry& e = entries[hash(k0, k1, k2)];
+        size_t sequence = e.sequence.load(std::memory_order_relaxed);
+        // Leave the entry to the thread writing it.
+        if ((sequence & 1) ||
+            !e.sequence.compare_exchange_strong(sequence, sequence + 1,
+                                                std::memory_order_relaxed))
+            return;
+        std::atomic_thread_fence(std::memory_order_release);
+        e.key[0].store(k0, std::memory_order_relaxed);
+        e.key[1].store(k1, std::memory_order_relaxed);
+        e.key[2].store(k2, std::memory_order_relaxed);
+        e.offset.store(offset, std::memory_order_relaxed);
+        e.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    static const size_t num_entries = 512;
+
+    struct entry
+    {
+        std::atomic<size_t> sequence;
+        std::atomic<const void*> key[3];
+        std::atomic<ptrdiff_t> offset;
+    };
+
+    static size_t hash(const void* k0, const void* k1, const void* k2)
+    {
+        uintptr_t h = reinterpret_cast<uintptr_t>(k0);
+        h = (h ^ (h >> 4)) * 31 + reinterpret_cast<uintptr_t>(k1);
+        h = (h ^ (h >> 4)) * 31 + reinterpret_cast<uintptr_t>(k2);
+        return (h ^ (h >> 11) ^ (h >> 19)) % num_entries;
+    }
+
+    entry entries[num_entries];
+};
+
+type_cache the_type_cache;
+
+}  // namespace
+
+#endif  // _LIBCXXABI_DYNAMIC_CAST_CACHE
+
 namespace __cxxabiv1
 {
 
@@ -232,14 +323,39 @@ __class_type_info::can_catch(const __shim_type_info* thrown_type,
     if (thrown_class_type == 0)
         return false;
     // bullet 2
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+    // The thrown object is a complete object of thrown_type, so the offset
+    // of the base does not depend on the object. The null third key keeps
+    // these entries apart from those of __dynamic_cast.
+    ptrdiff_t cached;
+    if (adjustedPtr != 0 &&
+        the_type_cache.lookup(thrown_class_type, this, 0, cached))
+    {
+        if (cached == type_cache::no_match)
+            return false;
+        adjustedPtr = static_cast<char*>(adjustedPtr) + cached;
+        return true;
+    }
+#endif
     __dynamic_cast_info info = {thrown_class_type, 0, this, -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,};
     info.number_of_dst_type = 1;
     thrown_class_type->has_unambiguous_public_base(&info, adjustedPtr, public_path);
     if (info.path_dst_ptr_to_static_ptr == public_path)
     {
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+        if (adjustedPtr != 0)
+            the_type_cache.insert(
+                thrown_class_type, this, 0,
+                static_cast<const char*>(info.dst_ptr_leading_to_static_ptr) -
+                    static_cast<const char*>(adjustedPtr));
+#endif
         adjustedPtr = const_cast<void*>(info.dst_ptr_leading_to_static_ptr);
         return true;
     }
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+    if (adjustedPtr != 0)
+        the_type_cache.insert(thrown_class_type, this, 0, type_cache::no_match);
+#endif
     return false;
 }
 
@@ -646,6 +762,21 @@ __dynamic_cast(const void *static_ptr, const __class_type_info *static_type,
     const __class_type_info* dynamic_type = static_cast<const __class_type_info*>(vtable[-1]);
 #endif
 
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+    // The vtable pointer of (static_ptr, static_type) determines the layout of
+    // the whole object, also while it is under construction and its dynamic
+    // type is one of its bases, where (dynamic_type, offset_to_derived) does
+    // not. Several bases at the same address share the vtable pointer, hence
+    // static_type is part of the key.
+    const void* vptr = *static_cast<const void* const*>(static_ptr);
+    ptrdiff_t cached;
+    if (the_type_cache.lookup(vptr, static_type, dst_type, cached))
+        return cached == type_cache::no_match
+                   ? 0
+                   : const_cast<char*>(static_cast<const char*>(static_ptr) +
+                                       cached);
+#endif
+
     // Initialize answer to nullptr.  This will be changed from the search
     //    results if a non-null answer is found.  Regardless, this is what will
     //    be returned.
@@ -729,6 +860,12 @@ __dynamic_cast(const void *static_ptr, const __class_type_info *static_type,
             break;
         }
     }
+#ifdef _LIBCXXABI_DYNAMIC_CAST_CACHE
+    the_type_cache.insert(vptr, static_type, dst_type,
+                          dst_ptr ? static_cast<const char*>(dst_ptr) -
+                                        static_cast<const char*>(static_ptr)
+                                  : type_cache::no_match);
+#endif
     return const_cast<void*>(dst_ptr);
 }
 
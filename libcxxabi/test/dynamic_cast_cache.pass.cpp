@@ -0,0 +1,133 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Repeat dynamic_casts and catches whose results differ only in things a
+// cache of their results must take into account: the subobject cast from, the
+// static type at a shared address, and objects under construction, whose
+// dynamic type is a base with a different layout than its complete objects.
+
+// UNSUPPORTED: no-exceptions, no-rtti
+
+#include <cassert>
+
+namespace t1 {
+
+// Two A subobjects at different offsets of the same dynamic type.
+struct A { virtual ~A() {} int a; };
+struct B : A { int b; };
+struct C : A { int c; };
+struct D : B, C { int d; };
+
+void test() {
+  D d;
+  for (int i = 0; i < 3; ++i) {
+    A *viaB = static_cast<B *>(&d);
+    A *viaC = static_cast<C *>(&d);
+    assert(dynamic_cast<D *>(viaB) == &d);
+    assert(dynamic_cast<D *>(viaC) == &d);
+    assert(dynamic_cast<B *>(viaB) == static_cast<B *>(&d));
+    assert(dynamic_cast<C *>(viaC) == static_cast<C *>(&d));
+    // Cross casts from either A.
+    assert(dynamic_cast<C *>(viaB) == static_cast<C *>(&d));
+    assert(dynamic_cast<B *>(viaC) == static_cast<B *>(&d));
+  }
+  B b;
+  for (int i = 0; i < 3; ++i) {
+    A *a = &b;
+    assert(dynamic_cast<D *>(a) == nullptr);
+    assert(dynamic_cast<B *>(a) == &b);
+    assert(dynamic_cast<C *>(a) == nullptr);
+  }
+}
+
+} // namespace t1
+
+namespace t2 {
+
+// Casts while the object is under construction, where the virtual base V is
+// at a different offset than in a complete M.
+struct V { virtual ~V() {} int v; };
+struct M : virtual V {
+  int m;
+  M();
+  virtual ~M() {}
+};
+struct X { virtual ~X() {} int x[7]; };
+struct F : X, M { int f; F() {} };
+
+M *constructing = nullptr;
+
+M::M() {
+  V *v = this;
+  for (int i = 0; i < 3; ++i) {
+    assert(dynamic_cast<M *>(v) == this);
+    assert(dynamic_cast<F *>(v) == nullptr);
+  }
+  constructing = this;
+}
+
+void test() {
+  for (int i = 0; i < 2; ++i) {
+    M m;
+    F f;
+    V *vm = &m;
+    V *vf = &f;
+    assert(dynamic_cast<M *>(vm) == &m);
+    assert(dynamic_cast<M *>(vf) == static_cast<M *>(&f));
+    assert(dynamic_cast<F *>(vf) == &f);
+    assert(dynamic_cast<F *>(vm) == nullptr);
+    assert(dynamic_cast<X *>(vf) == static_cast<X *>(&f));
+  }
+  assert(constructing != nullptr);
+}
+
+} // namespace t2
+
+namespace t3 {
+
+// Catch clauses for bases at different offsets and for private bases.
+struct A { int a = 1; };
+struct B { int b = 2; };
+struct C : A, B { int c = 3; };
+struct P : private A { int p = 4; };
+
+void test() {
+  for (int i = 0; i < 3; ++i) {
+    try {
+      throw C();
+    } catch (B &b) {
+      assert(b.b == 2);
+    }
+    try {
+      throw C();
+    } catch (A &a) {
+      assert(a.a == 1);
+    }
+    bool caughtPrivate = false;
+    try {
+      try {
+        throw P();
+      } catch (A &) {
+        assert(false);
+      }
+    } catch (P &p) {
+      assert(p.p == 4);
+      caughtPrivate = true;
+    }
+    assert(caughtPrivate);
+  }
+}
+
+} // namespace t3
+
+int main(int, char **) {
+  t1::test();
+  t2::test();
+  t3::test();
+  return 0;
+}
@@ -110,6 +110,18 @@ extern char __exidx_end;
 
 #endif
 
+// _dl_find_object (glibc 2.35) returns the PT_GNU_EH_FRAME segment of the
+// object containing an address without taking the loader lock and without
+// iterating over all objects like dl_iterate_phdr. Targets where the data
+// base is needed for the .eh_frame_hdr encodings keep using dl_iterate_phdr.
+#if defined(_LIBUNWIND_USE_DL_ITERATE_PHDR) &&                                 \
+    defined(_LIBUNWIND_SUPPORT_DWARF_INDEX) && defined(__GLIBC__)
+#include <dlfcn.h>
+#if defined(DLFO_STRUCT_HAS_EH_DBASE) && !DLFO_STRUCT_HAS_EH_DBASE
+#define _LIBUNWIND_USE_DL_FIND_OBJECT 1
+#endif
+#endif
+
 namespace libunwind {
 
 /// Used by findUnwindSections() to return info about needed sections.
@@ -588,6 +600,26 @@ inline bool LocalAddressSpace::findUnwindSections(pint_t targetAddr,
   if (info.arm_section && info.arm_section_length)
     return true;
 #elif defined(_LIBUNWIND_USE_DL_ITERATE_PHDR)
+#if defined(_LIBUNWIND_USE_DL_FIND_OBJECT)
+  struct dl_find_object findResult;
+  if (_dl_find_object(reinterpret_cast<void *>(targetAddr), &findResult) == 0 &&
+      findResult.dlfo_eh_frame != nullptr) {
+    uintptr_t mapEnd = reinterpret_cast<uintptr_t>(findResult.dlfo_map_end);
+    uintptr_t ehFrameHdr = reinterpret_cast<uintptr_t>(findResult.dlfo_eh_frame);
+    EHHeaderParser<LocalAddressSpace>::EHHeaderInfo hdrInfo;
+    // The size of .eh_frame_hdr is not known, it ends within the object.
+    if (EHHeaderParser<LocalAddressSpace>::decodeEHHdr(*this, ehFrameHdr,
+                                                       mapEnd, hdrInfo)) {
+      info.dso_base = reinterpret_cast<uintptr_t>(findResult.dlfo_map_start);
+      info.text_segment_length = mapEnd - info.dso_base;
+      info.dwarf_index_section = ehFrameHdr;
+      info.dwarf_index_section_length = mapEnd - ehFrameHdr;
+      info.dwarf_section = hdrInfo.eh_frame_ptr;
+      info.dwarf_section_length = UINTPTR_MAX;
+      return true;
+    }
+  }
+#endif
   dl_iterate_cb_data cb_data = {this, &info, targetAddr};
   int found = dl_iterate_phdr(findUnwindSectionsByPhdr, &cb_data);
   return static_cast<bool>(found);
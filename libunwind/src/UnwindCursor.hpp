@@ -101,6 +101,21 @@ private:
   // These fields are all static to avoid needing an initializer.
   // There is only one instance of this class per process.
   static RWMutex _lock;
+#if !defined(_LIBUNWIND_HAS_NO_THREADS)
+  // Every thread remembers the FDEs it looked up last, so that repeated
+  // unwinds through the same frames, e.g. exceptions thrown in a loop, do not
+  // take the lock. The entries of a thread are only valid as long as _epoch is
+  // the same, it is advanced whenever FDEs are removed from the cache.
+  struct threadEntry {
+    unsigned epoch;
+    pint_t mh;
+    pint_t pc;
+    pint_t fde;
+  };
+  static constexpr size_t kThreadCacheSize = 16;
+  static threadEntry &threadCacheEntry(pint_t mh, pint_t pc);
+  static unsigned _epoch;
+#endif
 #ifdef __APPLE__
   static void dyldUnloadHook(const struct mach_header *mh, intptr_t slide);
   static bool _registeredForDyldUnloads;
@@ -129,6 +144,20 @@ typename DwarfFDECache<A>::entry DwarfFDECache<A>::_initialBuffer[64];
 template <typename A>
 RWMutex DwarfFDECache<A>::_lock;
 
+#if !defined(_LIBUNWIND_HAS_NO_THREADS)
+// Starts at 1 so that the zero-initialized thread entries never match.
+template <typename A>
+unsigned DwarfFDECache<A>::_epoch = 1;
+
+template <typename A>
+typename DwarfFDECache<A>::threadEntry &
+DwarfFDECache<A>::threadCacheEntry(pint_t mh, pint_t pc) {
+  static thread_local threadEntry cache[kThreadCacheSize];
+  // Return addresses are at least 2-byte aligned on most targets.
+  return cache[((pc >> 1) ^ (pc >> 7) ^ mh) % kThreadCacheSize];
+}
+#endif
+
 #ifdef __APPLE__
 template <typename A>
 bool DwarfFDECache<A>::_registeredForDyldUnloads = false;
@@ -136,6 +165,12 @@ bool DwarfFDECache<A>::_registeredForDyldUnloads = false;
 
 template <typename A>
 typename A::pint_t DwarfFDECache<A>::findFDE(pint_t mh, pint_t pc) {
+#if !defined(_LIBUNWIND_HAS_NO_THREADS)
+  threadEntry &cached = threadCacheEntry(mh, pc);
+  unsigned epoch = __atomic_load_n(&_epoch, __ATOMIC_ACQUIRE);
+  if (cached.epoch == epoch && cached.mh == mh && cached.pc == pc)
+    return cached.fde;
+#endif
   pint_t result = 0;
   _LIBUNWIND_LOG_IF_FALSE(_lock.lock_shared());
   for (entry *p = _buffer; p < _bufferUsed; ++p) {
@@ -146,6 +181,15 @@ typename A::pint_t DwarfFDECache<A>::findFDE(pint_t mh, pint_t pc) {
       }
     }
   }
+#if !defined(_LIBUNWIND_HAS_NO_THREADS)
+  // Misses are not remembered, FDEs added later have to be found.
+  if (result != 0) {
+    cached.epoch = __atomic_load_n(&_epoch, __ATOMIC_RELAXED);
+    cached.mh = mh;
+    cached.pc = pc;
+    cached.fde = result;
+  }
+#endif
   _LIBUNWIND_LOG_IF_FALSE(_lock.unlock_shared());
   return result;
 }
@@ -194,6 +238,9 @@ void DwarfFDECache<A>::removeAllIn(pint_t mh) {
     }
   }
   _bufferUsed = d;
+#if !defined(_LIBUNWIND_HAS_NO_THREADS)
+  __atomic_fetch_add(&_epoch, 1, __ATOMIC_RELEASE);
+#endif
   _LIBUNWIND_LOG_IF_FALSE(_lock.unlock());
 }
 
@@ -0,0 +1,85 @@
+// -*- C++ -*-
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Throw exceptions through a few frames from many threads at once and report
+// the throughput. Every thread checks that each exception reaches its handler
+// with the value it was thrown with, so that a lookup cache returning the FDE
+// of another frame or thread is caught.
+//
+// The number of threads and exceptions per thread can be set with the
+// environment variables UNWIND_BENCH_THREADS and UNWIND_BENCH_ITERATIONS.
+
+// REQUIRES: linux
+// UNSUPPORTED: libunwind-no-threads, no-exceptions
+
+#include <assert.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+struct Exception {
+  int thread;
+  int value;
+};
+
+__attribute__((noinline)) static void thrower(int thread, int value) {
+  throw Exception{thread, value};
+}
+
+// Different depths visit different FDEs.
+__attribute__((noinline)) static int middle(int thread, int value, int depth) {
+  if (depth == 0)
+    thrower(thread, value);
+  return middle(thread, value, depth - 1) + 1;
+}
+
+static void worker(int thread, int iterations, long *caught) {
+  long count = 0;
+  for (int i = 0; i < iterations; ++i) {
+    try {
+      middle(thread, i, i % 4);
+    } catch (const Exception &e) {
+      assert(e.thread == thread);
+      assert(e.value == i);
+      ++count;
+    }
+  }
+  *caught = count;
+}
+
+static int getEnv(const char *name, int fallback) {
+  const char *value = getenv(name);
+  return value ? atoi(value) : fallback;
+}
+
+int main(int, char **) {
+  int numThreads = getEnv("UNWIND_BENCH_THREADS", 8);
+  int iterations = getEnv("UNWIND_BENCH_ITERATIONS", 2000);
+
+  std::vector<long> caught(numThreads, 0);
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < numThreads; ++t)
+    threads.emplace_back(worker, t, iterations, &caught[t]);
+  for (std::thread &thread : threads)
+    thread.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  long total = 0;
+  for (long count : caught) {
+    assert(count == iterations);
+    total += count;
+  }
+  fprintf(stderr, "%d threads: %ld exceptions in %.3fs, %.0f exceptions/s\n",
+          numThreads, total, elapsed.count(), total / elapsed.count());
+  return 0;
+}
@@ -7,9 +7,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "InputFiles.h"
+#include "OutputSections.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "Target.h"
+#include "lld/Common/Memory.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/TimeProfiler.h"
+#include <atomic>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -34,10 +40,16 @@ public:
                      const uint8_t *loc) const override;
   void relocate(uint8_t *loc, const Relocation &rel,
                 uint64_t val) const override;
+  bool relaxOnce(int pass) const override;
 };
 
 } // end anonymous namespace
 
+// These are internal relocation numbers for GP-relative relaxation. They
+// aren't part of the psABI.
+#define INTERNAL_R_RISCV_GPREL_I 256
+#define INTERNAL_R_RISCV_GPREL_S 257
+
 const uint64_t dtpOffset = 0x800;
 
 enum Op {
@@ -52,6 +64,7 @@ enum Op {
 
 enum Reg {
   X_RA = 1,
+  X_GP = 3,
   X_T0 = 5,
   X_T1 = 6,
   X_T2 = 7,
@@ -236,16 +249,15 @@ RelExpr RISCV::getRelExpr(const RelType type, const Symbol &s,
   case R_RISCV_TPREL_LO12_I:
   case R_RISCV_TPREL_LO12_S:
     return R_TPREL;
-  case R_RISCV_RELAX:
   case R_RISCV_TPREL_ADD:
     return R_NONE;
+  case R_RISCV_RELAX:
   case R_RISCV_ALIGN:
-    // Not just a hint; always padded to the worst-case number of NOPs, so may
-    // not currently be aligned, and without linker relaxation support we can't
-    // delete NOPs to realign.
-    errorOrWarn(getErrorLocation(loc) + "relocation R_RISCV_ALIGN requires "
-                "unimplemented linker relaxation; recompile with -mno-relax");
-    return R_NONE;
+    // Kept in the relocations for relaxOnce, like the ADD/SUB pairs; relocate
+    // ignores them. R_RISCV_ALIGN is not just a hint; the assembler always
+    // pads to the worst-case number of NOPs, which relaxation deletes to
+    // realign.
+    return R_RISCV_ADD;
   case R_PULPV2_LOOP_SETUP:
     return R_NONE;
   case R_PULPV2_LOOP_SETUPI:
@@ -262,6 +274,14 @@ static uint32_t extractBits(uint64_t v, uint32_t begin, uint32_t end) {
   return (v & ((1ULL << (begin + 1)) - 1)) >> end;
 }
 
+static uint32_t setLO12_I(uint32_t insn, uint32_t imm) {
+  return (insn & 0xfffff) | (imm << 20);
+}
+static uint32_t setLO12_S(uint32_t insn, uint32_t imm) {
+  return (insn & 0x1fff07f) | (extractBits(imm, 11, 5) << 25) |
+         (extractBits(imm, 4, 0) << 7);
+}
+
 void RISCV::relocate(uint8_t *loc, const Relocation &rel, uint64_t val) const {
   const unsigned bits = config->wordsize * 8;
 
@@ -441,14 +461,369 @@ void RISCV::relocate(uint8_t *loc, const Relocation &rel, uint64_t val) const {
     write64le(loc, val - dtpOffset);
     break;
 
+  case INTERNAL_R_RISCV_GPREL_I:
+  case INTERNAL_R_RISCV_GPREL_S: {
+    Defined *gp = ElfSym::riscvGlobalPointer;
+    int64_t displace = SignExtend64(val - gp->getVA(), bits);
+    checkInt(loc, displace, 12, rel);
+    uint32_t insn = (read32le(loc) & ~(31 << 15)) | (X_GP << 15);
+    if (rel.type == INTERNAL_R_RISCV_GPREL_I)
+      insn = setLO12_I(insn, displace);
+    else
+      insn = setLO12_S(insn, displace);
+    write32le(loc, insn);
+    return;
+  }
+
+  case R_RISCV_ALIGN:
   case R_RISCV_RELAX:
-    return; // Ignored (for now)
+    return; // Handled by relaxOnce and riscvFinalizeRelax
 
   default:
     llvm_unreachable("unknown relocation");
   }
 }
 
+namespace {
+struct SymbolAnchor {
+  uint64_t offset;
+  Defined *d;
+  bool end; // true for the anchor of st_value+st_size
+};
+
+struct RISCVRelaxAux {
+  InputSection *sec;
+  // This records symbol start and end offsets which will be adjusted according
+  // to the nearest relocDeltas element.
+  SmallVector<SymbolAnchor, 0> anchors;
+  // For relocations[i], the actual offset is r_offset - (i ? relocDeltas[i-1] :
+  // 0).
+  std::unique_ptr<uint32_t[]> relocDeltas;
+  // For relocations[i], the actual type is relocTypes[i].
+  std::unique_ptr<RelType[]> relocTypes;
+  // The instructions replacing relaxed sequences, in relocation order.
+  SmallVector<uint32_t, 0> writes;
+};
+} // namespace
+
+// The relaxation state of the executable input sections. Sections that are
+// discarded have none.
+static SmallVector<RISCVRelaxAux *, 0> relaxAuxs;
+
+static void initSymbolAnchors() {
+  DenseMap<const InputSection *, RISCVRelaxAux *> auxOf;
+  for (OutputSection *osec : outputSections) {
+    if (!(osec->flags & SHF_EXECINSTR))
+      continue;
+    for (InputSection *sec : getInputSections(osec)) {
+      RISCVRelaxAux *aux = make<RISCVRelaxAux>();
+      aux->sec = sec;
+      if (sec->relocations.size()) {
+        aux->relocDeltas =
+            std::make_unique<uint32_t[]>(sec->relocations.size());
+        aux->relocTypes = std::make_unique<RelType[]>(sec->relocations.size());
+      }
+      relaxAuxs.push_back(aux);
+      auxOf[sec] = aux;
+    }
+  }
+  // Store anchors (st_value and st_value+st_size) for symbols relative to text
+  // sections.
+  for (InputFile *file : objectFiles)
+    for (Symbol *sym : file->getSymbols()) {
+      auto *d = dyn_cast<Defined>(sym);
+      if (!d || d->file != file)
+        continue;
+      if (auto *sec = dyn_cast_or_null<InputSection>(d->section)) {
+        auto it = auxOf.find(sec);
+        if (it == auxOf.end())
+          continue;
+        it->second->anchors.push_back({d->value, d, false});
+        it->second->anchors.push_back({d->value + d->size, d, true});
+      }
+    }
+  // Sort anchors by offset so that we can find the closest relocation
+  // efficiently. For a zero size symbol, ensure that its start anchor precedes
+  // its end anchor. For two symbols with anchors at the same offset, their
+  // order does not matter.
+  parallelForEach(relaxAuxs, [](RISCVRelaxAux *aux) {
+    llvm::sort(aux->anchors, [](const SymbolAnchor &a, const SymbolAnchor &b) {
+      return std::make_pair(a.offset, a.end) < std::make_pair(b.offset, b.end);
+    });
+  });
+}
+
+// Relax R_RISCV_CALL/R_RISCV_CALL_PLT auipc+jalr to c.j, c.jal, or jal.
+static void relaxCall(const InputSection &sec, RISCVRelaxAux &aux, size_t i,
+                      uint64_t loc, Relocation &r, uint32_t &remove) {
+  const bool rvc = getEFlags(sec.file) & EF_RISCV_RVC;
+  const Symbol &sym = *r.sym;
+  const uint64_t insnPair = read64le(sec.data().data() + r.offset);
+  const uint32_t rd = extractBits(insnPair, 32 + 11, 32 + 7);
+  const uint64_t dest =
+      (r.expr == R_PLT_PC ? sym.getPltVA() : sym.getVA()) + r.addend;
+  const int64_t displace = dest - loc;
+
+  if (rvc && isInt<12>(displace) && rd == 0) {
+    aux.relocTypes[i] = R_RISCV_RVC_JUMP;
+    aux.writes.push_back(0xa001); // c.j
+    remove = 6;
+  } else if (rvc && isInt<12>(displace) && rd == X_RA &&
+             !config->is64) { // RV32C only
+    aux.relocTypes[i] = R_RISCV_RVC_JUMP;
+    aux.writes.push_back(0x2001); // c.jal
+    remove = 6;
+  } else if (isInt<21>(displace)) {
+    aux.relocTypes[i] = R_RISCV_JAL;
+    aux.writes.push_back(0x6f | rd << 7); // jal
+    remove = 4;
+  }
+}
+
+// Relax lui+addi/load/store to a gp-relative access if the target is within
+// reach of __global_pointer$.
+static void relaxHi20Lo12(RISCVRelaxAux &aux, size_t i, Relocation &r,
+                          uint32_t &remove) {
+  const Defined *gp = ElfSym::riscvGlobalPointer;
+  if (!gp)
+    return;
+
+  if (!isInt<12>(r.sym->getVA(r.addend) - gp->getVA()))
+    return;
+
+  switch (r.type) {
+  case R_RISCV_HI20:
+    // Remove lui rd, %hi20(x).
+    aux.relocTypes[i] = R_RISCV_RELAX;
+    remove = 4;
+    break;
+  case R_RISCV_LO12_I:
+    aux.relocTypes[i] = INTERNAL_R_RISCV_GPREL_I;
+    break;
+  case R_RISCV_LO12_S:
+    aux.relocTypes[i] = INTERNAL_R_RISCV_GPREL_S;
+    break;
+  }
+}
+
+static bool isRelaxable(ArrayRef<Relocation> rels, size_t i) {
+  return config->relax && i + 1 != rels.size() &&
+         rels[i + 1].type == R_RISCV_RELAX;
+}
+
+// Decide which bytes every relocation of the section deletes and record the
+// running deletion in relocDeltas. Only the relaxation state of the section is
+// written; symbol values are those of the previous pass, so the sections can
+// be scanned in parallel.
+static bool scanRelocations(RISCVRelaxAux &aux) {
+  InputSection &sec = *aux.sec;
+  const uint64_t secAddr = sec.getVA();
+  bool changed = false;
+  uint32_t delta = 0;
+
+  std::fill_n(aux.relocTypes.get(), sec.relocations.size(), R_RISCV_NONE);
+  aux.writes.clear();
+  for (size_t i = 0, e = sec.relocations.size(); i != e; ++i) {
+    Relocation &r = sec.relocations[i];
+    const uint64_t loc = secAddr + r.offset - delta;
+    uint32_t &cur = aux.relocDeltas[i], remove = 0;
+    switch (r.type) {
+    case R_RISCV_ALIGN: {
+      const uint64_t nextLoc = loc + r.addend;
+      const uint64_t align = PowerOf2Ceil(r.addend + 2);
+      // All bytes beyond the alignment boundary should be removed.
+      remove = nextLoc - ((loc + align - 1) & -align);
+      assert(static_cast<int32_t>(remove) >= 0 &&
+             "R_RISCV_ALIGN needs expanding the content");
+      break;
+    }
+    case R_RISCV_CALL:
+    case R_RISCV_CALL_PLT:
+      if (isRelaxable(sec.relocations, i))
+        relaxCall(sec, aux, i, loc, r, remove);
+      break;
+    case R_RISCV_HI20:
+    case R_RISCV_LO12_I:
+    case R_RISCV_LO12_S:
+      if (isRelaxable(sec.relocations, i))
+        relaxHi20Lo12(aux, i, r, remove);
+      break;
+    }
+
+    delta += remove;
+    if (delta != cur) {
+      cur = delta;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// Move the symbols of the section by the deletions preceding them. Only
+// symbols defined in the section are written.
+static void updateSymbols(RISCVRelaxAux &aux) {
+  InputSection &sec = *aux.sec;
+  ArrayRef<SymbolAnchor> sa = makeArrayRef(aux.anchors);
+  uint32_t delta = 0;
+  for (size_t i = 0, e = sec.relocations.size(); i != e; ++i) {
+    const uint64_t offset = sec.relocations[i].offset;
+    // For all anchors whose offsets are <= r.offset, they are preceded by
+    // the previous relocation whose `relocDeltas` value equals `delta`.
+    // Decrease their st_value and update their st_size.
+    for (; sa.size() && sa[0].offset <= offset; sa = sa.slice(1)) {
+      if (sa[0].end)
+        sa[0].d->size = sa[0].offset - delta - sa[0].d->value;
+      else
+        sa[0].d->value = sa[0].offset - delta;
+    }
+    delta = aux.relocDeltas[i];
+  }
+
+  for (const SymbolAnchor &a : sa) {
+    if (a.end)
+      a.d->size = a.offset - delta - a.d->value;
+    else
+      a.d->value = a.offset - delta;
+  }
+  // Inform assignAddresses that the size has changed.
+  sec.bytesDropped = delta;
+}
+
+// When relaxing just R_RISCV_ALIGN, relocDeltas is usually changed only once in
+// the absence of a linker script. For call and load/store R_RISCV_RELAX, code
+// shrinkage may reduce displacement and make more relocations eligible for
+// relaxation. Code shrinkage may increase displacement to a call/load/store
+// target at a higher fixed address, invalidating an earlier relaxation. Any
+// change in section sizes can have cascading effect and require another
+// relaxation pass.
+bool RISCV::relaxOnce(int pass) const {
+  llvm::TimeTraceScope timeScope("RISC-V relaxOnce");
+  if (config->relocatable)
+    return false;
+
+  if (pass == 0)
+    initSymbolAnchors();
+
+  // The scans only read symbol values and the updates only write the symbols
+  // of their own section, both run over the sections in parallel.
+  std::atomic<bool> changed{false};
+  parallelForEach(relaxAuxs, [&](RISCVRelaxAux *aux) {
+    if (aux->relocDeltas && scanRelocations(*aux))
+      changed = true;
+  });
+  parallelForEach(relaxAuxs, [](RISCVRelaxAux *aux) {
+    if (aux->relocDeltas)
+      updateSymbols(*aux);
+  });
+  return changed;
+}
+
+void elf::riscvFinalizeRelax(int passes) {
+  llvm::TimeTraceScope timeScope("Finalize RISC-V relaxation");
+  log("relaxation passes: " + Twine(passes));
+  // The allocator is not thread-safe, allocate the new contents up front.
+  SmallVector<uint8_t *, 0> newData(relaxAuxs.size());
+  for (size_t idx = 0, e = relaxAuxs.size(); idx != e; ++idx) {
+    RISCVRelaxAux &aux = *relaxAuxs[idx];
+    if (aux.relocDeltas)
+      newData[idx] = bAlloc.Allocate<uint8_t>(
+          aux.sec->data().size() -
+          aux.relocDeltas[aux.sec->relocations.size() - 1]);
+  }
+
+  parallelForEachN(0, relaxAuxs.size(), [&](size_t idx) {
+    RISCVRelaxAux &aux = *relaxAuxs[idx];
+    InputSection *sec = aux.sec;
+    if (!aux.relocDeltas)
+      return;
+
+    auto &rels = sec->relocations;
+    ArrayRef<uint8_t> old = sec->data();
+    size_t newSize = old.size() - aux.relocDeltas[rels.size() - 1];
+    size_t writesIdx = 0;
+    uint8_t *p = newData[idx];
+    uint64_t offset = 0;
+    int64_t delta = 0;
+    sec->rawData = makeArrayRef(p, newSize);
+    sec->bytesDropped = 0;
+
+    // Update section content: remove NOPs for R_RISCV_ALIGN and rewrite
+    // instructions for relaxed relocations.
+    for (size_t i = 0, e = rels.size(); i != e; ++i) {
+      uint32_t remove = aux.relocDeltas[i] - delta;
+      delta = aux.relocDeltas[i];
+      if (remove == 0 && aux.relocTypes[i] == R_RISCV_NONE)
+        continue;
+
+      // Copy from last location to the current relocated location.
+      const Relocation &r = rels[i];
+      uint64_t size = r.offset - offset;
+      memcpy(p, old.data() + offset, size);
+      p += size;
+
+      // For R_RISCV_ALIGN, we will place `offset` in a location (among NOPs)
+      // to satisfy the alignment requirement. If both `remove` and r.addend
+      // are multiples of 4, it is as if we have skipped some NOPs. Otherwise
+      // we are in the middle of a 4-byte NOP, and we need to rewrite the NOP
+      // sequence.
+      int64_t skip = 0;
+      if (r.type == R_RISCV_ALIGN) {
+        if (remove % 4 || r.addend % 4) {
+          skip = r.addend - remove;
+          int64_t j = 0;
+          for (; j + 4 <= skip; j += 4)
+            write32le(p + j, 0x00000013); // nop
+          if (j != skip) {
+            assert(j + 2 == skip);
+            write16le(p + j, 0x0001); // c.nop
+          }
+        }
+      } else if (RelType newType = aux.relocTypes[i]) {
+        switch (newType) {
+        case INTERNAL_R_RISCV_GPREL_I:
+        case INTERNAL_R_RISCV_GPREL_S:
+          break;
+        case R_RISCV_RELAX:
+          // Used by relaxHi20Lo12 to indicate the lui is removed.
+          break;
+        case R_RISCV_RVC_JUMP:
+          skip = 2;
+          write16le(p, aux.writes[writesIdx++]);
+          break;
+        case R_RISCV_JAL:
+          skip = 4;
+          write32le(p, aux.writes[writesIdx++]);
+          break;
+        default:
+          llvm_unreachable("unsupported type");
+        }
+      }
+
+      p += skip;
+      offset = r.offset + skip + remove;
+    }
+    memcpy(p, old.data() + offset, old.size() - offset);
+
+    // Subtract the previous relocDeltas value from the relocation offset.
+    // For a pair of R_RISCV_CALL/R_RISCV_RELAX with the same offset, decrease
+    // their r_offset by the same delta.
+    delta = 0;
+    for (size_t i = 0, e = rels.size(); i != e;) {
+      uint64_t cur = rels[i].offset;
+      do {
+        rels[i].offset -= delta;
+        if (aux.relocTypes[i] != R_RISCV_NONE)
+          rels[i].type = aux.relocTypes[i];
+        // The removed lui needs no relocation.
+        if (aux.relocTypes[i] == R_RISCV_RELAX)
+          rels[i].expr = R_NONE;
+      } while (++i != e && rels[i].offset == cur);
+      delta = aux.relocDeltas[i - 1];
+    }
+  });
+  relaxAuxs.clear();
+}
+
 TargetInfo *elf::getRISCVTargetInfo() {
   static RISCV target;
   return &target;
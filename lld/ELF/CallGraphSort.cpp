@@ -38,20 +38,52 @@
 ///   * If not, then combine the clusters.
 /// * Sort non-empty clusters by density
 ///
+/// --call-graph-profile-sort=cdsort selects a cache-directed sort instead,
+/// which is similar to ExtTSP but works on functions. It merges chains of
+/// sections greedily, picking the merge that improves a locality score the
+/// most:
+/// * A call contributes its weight if the callee directly follows the caller,
+///   as if the call fell through, and a share decreasing linearly with the
+///   distance from the middle of the caller to the callee otherwise. Calls
+///   further apart than the instruction cache size contribute nothing.
+/// * Merges which exceed the maximum cluster size or degrade the density
+///   too much are rejected, as in C³.
+/// The resulting chains are sorted by density so that hot code is packed into
+/// few pages.
+///
 //===----------------------------------------------------------------------===//
 
 #include "CallGraphSort.h"
+#include "InputSection.h"
 #include "OutputSections.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Support/Format.h"
 
 #include <numeric>
+#include <queue>
 
 using namespace llvm;
 using namespace lld;
 using namespace lld::elf;
 
 namespace {
+// The call graph between the input sections of the profile.
+struct CallGraph {
+  struct Arc {
+    int from;
+    int to;
+    uint64_t weight;
+  };
+
+  CallGraph();
+
+  std::vector<const InputSectionBase *> sections;
+  // One arc per profile entry, in the order of the profile.
+  std::vector<Arc> arcs;
+};
+
 struct Edge {
   int from;
   uint64_t weight;
@@ -76,13 +108,63 @@ struct Cluster {
 
 class CallGraphSort {
 public:
-  CallGraphSort();
+  CallGraphSort(const CallGraph &graph);
 
-  DenseMap<const InputSectionBase *, int> run();
+  std::vector<const InputSectionBase *> run();
 
 private:
   std::vector<Cluster> clusters;
-  std::vector<const InputSectionBase *> sections;
+  const std::vector<const InputSectionBase *> &sections;
+};
+
+class CacheDirectedSort {
+public:
+  CacheDirectedSort(const CallGraph &graph);
+
+  std::vector<const InputSectionBase *> run();
+
+private:
+  struct Chain {
+    std::vector<int> nodes;
+    uint64_t size = 0;
+    uint64_t weight = 0;
+    // Bumped whenever the chain changes, to invalidate queued merges.
+    unsigned version = 0;
+    bool merged = false;
+
+    double getDensity() const {
+      return size == 0 ? 0 : double(weight) / double(size);
+    }
+  };
+
+  // A candidate merge of chains a and b, laid out as a·b, or b·a if
+  // swapped.
+  struct Merge {
+    double gain;
+    int a, b;
+    unsigned versionA, versionB;
+    bool swapped;
+
+    bool operator<(const Merge &other) const {
+      if (gain != other.gain)
+        return gain < other.gain;
+      return std::make_pair(a, b) > std::make_pair(other.a, other.b);
+    }
+  };
+
+  double getGain(int first, int second) const;
+  void pushMerge(int a, int b);
+  void mergeChains(const Merge &m);
+
+  const CallGraph &graph;
+  std::vector<uint64_t> sizes;
+  // The arcs from and to each node.
+  std::vector<std::vector<int>> nodeArcs;
+  std::vector<Chain> chains;
+  // The chain of each node and the offset of the node in the chain.
+  std::vector<int> chainOf;
+  std::vector<uint64_t> offsetOf;
+  std::priority_queue<Merge> queue;
 };
 
 // Maximum amount the combined cluster density can be worse than the original
@@ -91,6 +173,10 @@ constexpr int MAX_DENSITY_DEGRADATION = 8;
 
 // Maximum cluster size in bytes.
 constexpr uint64_t MAX_CLUSTER_SIZE = 1024 * 1024;
+
+// The share of the weight of a call to a near, but not directly following,
+// callee, relative to a fall through.
+constexpr double NEAR_CALL_SCORE = 0.5;
 } // end anonymous namespace
 
 using SectionPair =
@@ -99,16 +185,14 @@ using SectionPair =
 // Take the edge list in Config->CallGraphProfile, resolve symbol names to
 // Symbols, and generate a graph between InputSections with the provided
 // weights.
-CallGraphSort::CallGraphSort() {
+CallGraph::CallGraph() {
   MapVector<SectionPair, uint64_t> &profile = config->callGraphProfile;
-  DenseMap<const InputSectionBase *, int> secToCluster;
+  DenseMap<const InputSectionBase *, int> secToNode;
 
   auto getOrCreateNode = [&](const InputSectionBase *isec) -> int {
-    auto res = secToCluster.try_emplace(isec, clusters.size());
-    if (res.second) {
+    auto res = secToNode.try_emplace(isec, sections.size());
+    if (res.second)
       sections.push_back(isec);
-      clusters.emplace_back(clusters.size(), isec->getSize());
-    }
     return res.first->second;
   };
 
@@ -116,7 +200,6 @@ CallGraphSort::CallGraphSort() {
   for (std::pair<SectionPair, uint64_t> &c : profile) {
     const auto *fromSB = cast<InputSectionBase>(c.first.first->repl);
     const auto *toSB = cast<InputSectionBase>(c.first.second->repl);
-    uint64_t weight = c.second;
 
     // Ignore edges between input sections belonging to different output
     // sections.  This is done because otherwise we would end up with clusters
@@ -129,17 +212,26 @@ CallGraphSort::CallGraphSort() {
 
     int from = getOrCreateNode(fromSB);
     int to = getOrCreateNode(toSB);
+    arcs.push_back({from, to, c.second});
+  }
+}
 
-    clusters[to].weight += weight;
+CallGraphSort::CallGraphSort(const CallGraph &graph)
+    : sections(graph.sections) {
+  for (size_t i = 0, e = sections.size(); i != e; ++i)
+    clusters.emplace_back(i, sections[i]->getSize());
 
-    if (from == to)
+  for (const CallGraph::Arc &arc : graph.arcs) {
+    clusters[arc.to].weight += arc.weight;
+
+    if (arc.from == arc.to)
       continue;
 
     // Remember the best edge.
-    Cluster &toC = clusters[to];
-    if (toC.bestPred.from == -1 || toC.bestPred.weight < weight) {
-      toC.bestPred.from = from;
-      toC.bestPred.weight = weight;
+    Cluster &toC = clusters[arc.to];
+    if (toC.bestPred.from == -1 || toC.bestPred.weight < arc.weight) {
+      toC.bestPred.from = arc.from;
+      toC.bestPred.weight = arc.weight;
     }
   }
   for (Cluster &c : clusters)
@@ -178,7 +270,7 @@ static void mergeClusters(std::vector<Cluster> &cs, Cluster &into, int intoIdx,
 
 // Group InputSections into clusters using the Call-Chain Clustering heuristic
 // then sort the clusters by density.
-DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
+std::vector<const InputSectionBase *> CallGraphSort::run() {
   std::vector<int> sorted(clusters.size());
   std::vector<int> leaders(clusters.size());
 
@@ -221,49 +313,282 @@ DenseMap<const InputSectionBase *, int> CallGraphSort::run() {
     return clusters[a].getDensity() > clusters[b].getDensity();
   });
 
-  DenseMap<const InputSectionBase *, int> orderMap;
-  int curOrder = 1;
+  std::vector<const InputSectionBase *> order;
   for (int leader : sorted) {
     for (int i = leader;;) {
-      orderMap[sections[i]] = curOrder++;
+      order.push_back(sections[i]);
       i = clusters[i].next;
       if (i == leader)
         break;
     }
   }
-  if (!config->printSymbolOrder.empty()) {
-    std::error_code ec;
-    raw_fd_ostream os(config->printSymbolOrder, ec, sys::fs::OF_None);
-    if (ec) {
-      error("cannot open " + config->printSymbolOrder + ": " + ec.message());
-      return orderMap;
+  return order;
+}
+
+CacheDirectedSort::CacheDirectedSort(const CallGraph &graph) : graph(graph) {
+  size_t numNodes = graph.sections.size();
+  sizes.resize(numNodes);
+  nodeArcs.resize(numNodes);
+  chains.resize(numNodes);
+  chainOf.resize(numNodes);
+  offsetOf.resize(numNodes);
+
+  for (size_t i = 0; i != numNodes; ++i) {
+    sizes[i] = graph.sections[i]->getSize();
+    chains[i].nodes.push_back(i);
+    chains[i].size = sizes[i];
+    chainOf[i] = i;
+  }
+  for (size_t i = 0, e = graph.arcs.size(); i != e; ++i) {
+    const CallGraph::Arc &arc = graph.arcs[i];
+    chains[arc.to].weight += arc.weight;
+    if (arc.from == arc.to)
+      continue;
+    nodeArcs[arc.from].push_back(i);
+    nodeArcs[arc.to].push_back(i);
+  }
+}
+
+// Returns the locality score of a call from a section at callerAddr to one at
+// calleeAddr.
+static double getCallScore(uint64_t callerAddr, uint64_t callerSize,
+                           uint64_t calleeAddr, uint64_t weight) {
+  if (calleeAddr == callerAddr + callerSize)
+    return weight;
+  // Calls are assumed to come from the middle of the caller.
+  uint64_t src = callerAddr + callerSize / 2;
+  uint64_t dist = src < calleeAddr ? calleeAddr - src : src - calleeAddr;
+  uint64_t window = config->callGraphProfileCacheSize;
+  if (dist >= window)
+    return 0;
+  return weight * NEAR_CALL_SCORE * (1 - double(dist) / window);
+}
+
+// Returns how much laying out the chain second right after first improves the
+// score. Only the calls between the two chains change.
+double CacheDirectedSort::getGain(int first, int second) const {
+  const Chain &a = chains[first], &b = chains[second];
+  int from = a.nodes.size() <= b.nodes.size() ? first : second;
+  auto getAddr = [&](int node) {
+    return chainOf[node] == first ? offsetOf[node] : a.size + offsetOf[node];
+  };
+
+  double gain = 0;
+  for (int node : chains[from].nodes) {
+    for (int i : nodeArcs[node]) {
+      const CallGraph::Arc &arc = graph.arcs[i];
+      int other = arc.from == node ? arc.to : arc.from;
+      if (chainOf[other] == chainOf[node] ||
+          (chainOf[other] != first && chainOf[other] != second))
+        continue;
+      gain += getCallScore(getAddr(arc.from), sizes[arc.from],
+                           getAddr(arc.to), arc.weight);
     }
+  }
+  return gain;
+}
 
-    // Print the symbols ordered by C3, in the order of increasing curOrder
-    // Instead of sorting all the orderMap, just repeat the loops above.
-    for (int leader : sorted)
-      for (int i = leader;;) {
-        // Search all the symbols in the file of the section
-        // and find out a Defined symbol with name that is within the section.
-        for (Symbol *sym : sections[i]->file->getSymbols())
-          if (!sym->isSection()) // Filter out section-type symbols here.
-            if (auto *d = dyn_cast<Defined>(sym))
-              if (sections[i] == d->section)
-                os << sym->getName() << "\n";
-        i = clusters[i].next;
-        if (i == leader)
-          break;
-      }
+// Queues the better of the two ways to merge chains a and b, unless merging
+// them is not allowed.
+void CacheDirectedSort::pushMerge(int a, int b) {
+  const Chain &ca = chains[a], &cb = chains[b];
+  if (ca.size + cb.size > MAX_CLUSTER_SIZE)
+    return;
+  double newDensity =
+      double(ca.weight + cb.weight) / std::max<uint64_t>(ca.size + cb.size, 1);
+  if (newDensity < std::max(ca.getDensity(), cb.getDensity()) /
+                       MAX_DENSITY_DEGRADATION)
+    return;
+
+  double gainAB = getGain(a, b);
+  double gainBA = getGain(b, a);
+  double gain = std::max(gainAB, gainBA);
+  if (gain > 0)
+    queue.push({gain, a, b, ca.version, cb.version, gainBA > gainAB});
+}
+
+void CacheDirectedSort::mergeChains(const Merge &m) {
+  Chain &into = chains[m.a];
+  Chain &from = chains[m.b];
+  if (m.swapped)
+    std::swap(into.nodes, from.nodes);
+  into.nodes.insert(into.nodes.end(), from.nodes.begin(), from.nodes.end());
+  into.size += from.size;
+  into.weight += from.weight;
+  ++into.version;
+  from.nodes.clear();
+  from.merged = true;
+
+  uint64_t offset = 0;
+  for (int node : into.nodes) {
+    chainOf[node] = m.a;
+    offsetOf[node] = offset;
+    offset += sizes[node];
   }
 
-  return orderMap;
+  // Queue the merges with the chains connected to the new one.
+  SetVector<int> neighbors;
+  for (int node : into.nodes)
+    for (int i : nodeArcs[node]) {
+      const CallGraph::Arc &arc = graph.arcs[i];
+      int other = chainOf[arc.from == node ? arc.to : arc.from];
+      if (other != m.a)
+        neighbors.insert(other);
+    }
+  for (int other : neighbors)
+    pushMerge(std::min(m.a, other), std::max(m.a, other));
+}
+
+std::vector<const InputSectionBase *> CacheDirectedSort::run() {
+  for (const CallGraph::Arc &arc : graph.arcs)
+    if (arc.from != arc.to)
+      pushMerge(std::min(arc.from, arc.to), std::max(arc.from, arc.to));
+
+  while (!queue.empty()) {
+    Merge m = queue.top();
+    queue.pop();
+    if (chains[m.a].merged || chains[m.b].merged ||
+        chains[m.a].version != m.versionA || chains[m.b].version != m.versionB)
+      continue;
+    mergeChains(m);
+  }
+
+  // Sort the chains by density.
+  std::vector<int> sorted;
+  for (int i = 0, e = chains.size(); i != e; ++i)
+    if (!chains[i].merged)
+      sorted.push_back(i);
+  llvm::stable_sort(sorted, [&](int a, int b) {
+    return chains[a].getDensity() > chains[b].getDensity();
+  });
+
+  std::vector<const InputSectionBase *> order;
+  for (int i : sorted)
+    for (int node : chains[i].nodes)
+      order.push_back(graph.sections[node]);
+  return order;
+}
+
+// Print the symbols of the sections in the given order, for
+// --print-symbol-order.
+static void writeSymbolOrder(ArrayRef<const InputSectionBase *> order) {
+  std::error_code ec;
+  raw_fd_ostream os(config->printSymbolOrder, ec, sys::fs::OF_None);
+  if (ec) {
+    error("cannot open " + config->printSymbolOrder + ": " + ec.message());
+    return;
+  }
+
+  for (const InputSectionBase *sec : order)
+    // Search all the symbols in the file of the section
+    // and find out a Defined symbol with name that is within the section.
+    for (Symbol *sym : sec->file->getSymbols())
+      if (!sym->isSection()) // Filter out section-type symbols here.
+        if (auto *d = dyn_cast<Defined>(sym))
+          if (sec == d->section)
+            os << sym->getName() << "\n";
+}
+
+// Returns the score of laying out the sections of the call graph in the given
+// order, as if they were contiguous.
+static double getLayoutScore(const CallGraph &graph,
+                             ArrayRef<const InputSectionBase *> order,
+                             std::vector<uint64_t> &addrs) {
+  DenseMap<const InputSectionBase *, uint64_t> secAddr;
+  uint64_t addr = 0;
+  for (const InputSectionBase *sec : order) {
+    secAddr[sec] = addr;
+    addr += sec->getSize();
+  }
+  addrs.clear();
+  for (const InputSectionBase *sec : graph.sections)
+    addrs.push_back(secAddr.lookup(sec));
+
+  double score = 0;
+  for (const CallGraph::Arc &arc : graph.arcs)
+    if (arc.from != arc.to)
+      score += getCallScore(addrs[arc.from],
+                            graph.sections[arc.from]->getSize(),
+                            addrs[arc.to], arc.weight);
+  return score;
+}
+
+// Write a report of the computed layout for --call-graph-profile-report. The
+// score of the input order is given for comparison.
+static void writeLayoutReport(const CallGraph &graph,
+                              ArrayRef<const InputSectionBase *> order) {
+  std::error_code ec;
+  raw_fd_ostream os(config->callGraphProfileReport, ec, sys::fs::OF_None);
+  if (ec) {
+    error("cannot open " + config->callGraphProfileReport + ": " +
+          ec.message());
+    return;
+  }
+
+  // The input order of the profiled sections.
+  SetVector<const InputSectionBase *> profiled(graph.sections.begin(),
+                                               graph.sections.end());
+  std::vector<const InputSectionBase *> inputOrder;
+  for (InputSectionBase *sec : inputSections)
+    if (profiled.count(sec))
+      inputOrder.push_back(sec);
+
+  std::vector<uint64_t> addrs;
+  double inputScore = getLayoutScore(graph, inputOrder, addrs);
+  double score = getLayoutScore(graph, order, addrs);
+
+  std::vector<uint64_t> weights(graph.sections.size());
+  uint64_t totalWeight = 0;
+  for (const CallGraph::Arc &arc : graph.arcs) {
+    weights[arc.to] += arc.weight;
+    totalWeight += arc.weight;
+  }
+
+  os << "algorithm: "
+     << (config->callGraphProfileSort == CGProfileSortKind::Cdsort ? "cdsort"
+                                                                   : "hfsort")
+     << "\n";
+  os << "cache size: " << config->callGraphProfileCacheSize << "\n";
+  os << "sections: " << graph.sections.size() << "\n";
+  os << "calls: " << graph.arcs.size() << "\n";
+  os << "total weight: " << totalWeight << "\n";
+  os << "input order score: " << format("%.1f", inputScore) << "\n";
+  os << "score: " << format("%.1f", score) << "\n";
+  os << "\n";
+  os << "  Offset     Size   Weight Section\n";
+
+  DenseMap<const InputSectionBase *, int> secToNode;
+  for (int i = 0, e = graph.sections.size(); i != e; ++i)
+    secToNode[graph.sections[i]] = i;
+  for (const InputSectionBase *sec : order) {
+    int node = secToNode[sec];
+    os << format("%8llx %8llx %8llu ", (unsigned long long)addrs[node],
+                 (unsigned long long)sec->getSize(),
+                 (unsigned long long)weights[node])
+       << toString(sec) << "\n";
+  }
 }
 
 // Sort sections by the profile data provided by -callgraph-profile-file
 //
 // This first builds a call graph based on the profile data then merges sections
-// according to the C³ heuristic. All clusters are then sorted by a density
-// metric to further improve locality.
+// according to the C³ heuristic, or the cache-directed sort if requested. All
+// clusters are then sorted by a density metric to further improve locality.
 DenseMap<const InputSectionBase *, int> elf::computeCallGraphProfileOrder() {
-  return CallGraphSort().run();
+  CallGraph graph;
+  std::vector<const InputSectionBase *> order =
+      config->callGraphProfileSort == CGProfileSortKind::Cdsort
+          ? CacheDirectedSort(graph).run()
+          : CallGraphSort(graph).run();
+
+  if (!config->printSymbolOrder.empty())
+    writeSymbolOrder(order);
+  if (!config->callGraphProfileReport.empty())
+    writeLayoutReport(graph, order);
+
+  DenseMap<const InputSectionBase *, int> orderMap;
+  int curOrder = 1;
+  for (const InputSectionBase *sec : order)
+    orderMap[sec] = curOrder++;
+  return orderMap;
 }
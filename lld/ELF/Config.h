@@ -40,6 +40,9 @@ enum ELFKind {
 // For --build-id.
 enum class BuildIdKind { None, Fast, Md5, Sha1, Hexstring, Uuid };
 
+// For --call-graph-profile-sort={none,hfsort,cdsort}.
+enum class CGProfileSortKind { None, Hfsort, Cdsort };
+
 // For --discard-{all,locals,none}.
 enum class DiscardPolicy { Default, All, Locals, None };
 
@@ -93,8 +96,10 @@ struct Configuration {
   uint32_t andFeatures = 0;
   llvm::CachePruningPolicy thinLTOCachePolicy;
   llvm::SetVector<llvm::CachedHashString> dependencyFiles; // for --dependency-file
+  llvm::SetVector<llvm::CachedHashString> missingFiles; // for --incremental
   llvm::StringMap<uint64_t> sectionStartMap;
   llvm::StringRef bfdname;
+  llvm::StringRef callGraphProfileReport;
   llvm::StringRef chroot;
   llvm::StringRef dependencyFile;
   llvm::StringRef dwoDir;
@@ -145,10 +150,10 @@ struct Configuration {
   bool asNeeded = false;
   bool bsymbolic;
   bool bsymbolicFunctions;
-  bool callGraphProfileSort;
   bool checkSections;
   bool compressDebugSections;
   bool cref;
+  bool debugNames;
   std::vector<std::pair<llvm::GlobPattern, uint64_t>> deadRelocInNonAlloc;
   bool defineCommon;
   bool demangle = true;
@@ -171,6 +176,7 @@ struct Configuration {
   bool hasDynSymTab;
   bool ignoreDataAddressEquality;
   bool ignoreFunctionAddressEquality;
+  bool incremental;
   bool ltoCSProfileGenerate;
   bool ltoDebugPassManager;
   bool ltoEmitAsm;
@@ -193,6 +199,7 @@ struct Configuration {
   bool pie;
   bool printGcSections;
   bool printIcfSections;
+  bool relax;
   bool relocatable;
   bool relrPackDynRelocs;
   bool saveTemps;
@@ -242,6 +249,7 @@ struct Configuration {
   bool zText;
   bool zRetpolineplt;
   bool zWxneeded;
+  CGProfileSortKind callGraphProfileSort;
   DiscardPolicy discard;
   GnuStackKind zGnustack;
   ICFLevel icf;
@@ -257,6 +265,7 @@ struct Configuration {
   ELFKind ekind = ELFNoneKind;
   uint16_t emachine = llvm::ELF::EM_NONE;
   llvm::Optional<uint64_t> imageBase;
+  uint64_t callGraphProfileCacheSize;
   uint64_t commonPageSize;
   uint64_t maxPageSize;
   uint64_t mipsGotSize;
@@ -215,11 +215,22 @@ static Optional<std::string> findFile(StringRef path1, const Twine &path2) {
   else
     path::append(s, path1, path2);
 
-  if (fs::exists(s))
+  if (fileExists(s))
     return std::string(s);
   return None;
 }
 
+// Returns true if a file exists. With --incremental, the paths that did not
+// exist are remembered, because creating one of them may change which file a
+// search finds and so invalidates the output.
+bool elf::fileExists(const Twine &path) {
+  if (fs::exists(path))
+    return true;
+  if (config->incremental)
+    config->missingFiles.insert(CachedHashString(path.str()));
+  return false;
+}
+
 Optional<std::string> elf::findFromSearchPaths(StringRef path) {
   for (StringRef dir : config->searchPaths)
     if (Optional<std::string> s = findFile(dir, path))
@@ -252,7 +263,7 @@ Optional<std::string> elf::searchLibrary(StringRef name) {
 // look for the script in the '-L' search paths. This matches the behaviour of
 // '-T', --version-script=, and linker script INPUT() command in ld.bfd.
 Optional<std::string> elf::searchScript(StringRef name) {
-  if (fs::exists(name))
+  if (fileExists(name))
     return name.str();
   return findFromSearchPaths(name);
 }
@@ -0,0 +1,152 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the --incremental option. After a successful link, we
+// write a state file next to the output which records the command line, the
+// contents of every file that was read and every path that a search found
+// missing. If none of them have changed when the linker runs again, and the
+// output is still the one we wrote, the link is skipped.
+//
+// The state file is a text file named <output>.lld-state:
+//
+//   lld-incremental 1
+//   key <hash of the version, working directory and command line>
+//   output <hash of the output>
+//   file <hash> <path>
+//   missing <path>
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Reproduce.h"
+#include "lld/Common/Version.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace lld;
+using namespace lld::elf;
+
+static constexpr StringRef stateMagic = "lld-incremental 1";
+
+static std::string getStatePath() {
+  return (config->outputFile + ".lld-state").str();
+}
+
+// Hashes everything that affects the output but is not a file.
+static uint64_t getKey(const opt::InputArgList &args) {
+  std::string s = getLLDVersion();
+  s += '\0';
+  SmallString<128> cwd;
+  if (!sys::fs::current_path(cwd))
+    s += cwd.str();
+  for (const opt::Arg *arg : args) {
+    s += '\0';
+    s += toString(*arg);
+  }
+  return xxh3_64bits(s);
+}
+
+static Optional<uint64_t> hashFile(StringRef path) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(path, -1, false);
+  if (!mbOrErr)
+    return None;
+  return xxh3_64bits((*mbOrErr)->getBuffer());
+}
+
+static bool isEnabled() {
+  return config->incremental && !config->outputFile.empty() &&
+         config->outputFile != "-";
+}
+
+bool elf::isOutputUpToDate(const opt::InputArgList &args) {
+  if (!isEnabled())
+    return false;
+  ErrorOr<std::unique_ptr<MemoryBuffer>> mbOrErr =
+      MemoryBuffer::getFile(getStatePath(), -1, false);
+  if (!mbOrErr)
+    return false;
+
+  SmallVector<StringRef, 0> lines;
+  (*mbOrErr)->getBuffer().split(lines, '\n', -1, false);
+  if (lines.empty() || lines[0] != stateMagic)
+    return false;
+
+  bool hasKey = false, hasOutput = false;
+  for (StringRef line : makeArrayRef(lines).slice(1)) {
+    StringRef kind, rest;
+    std::tie(kind, rest) = line.split(' ');
+    if (kind == "missing") {
+      if (sys::fs::exists(rest))
+        return false;
+      continue;
+    }
+
+    StringRef hex, path;
+    std::tie(hex, path) = rest.split(' ');
+    uint64_t hash;
+    if (hex.getAsInteger(16, hash))
+      return false;
+    if (kind == "key") {
+      if (hash != getKey(args))
+        return false;
+      hasKey = true;
+    } else if (kind == "output") {
+      if (hashFile(config->outputFile) != hash)
+        return false;
+      hasOutput = true;
+    } else if (kind == "file") {
+      if (hashFile(path) != hash)
+        return false;
+    } else {
+      return false;
+    }
+  }
+  if (!hasKey || !hasOutput)
+    return false;
+  log(config->outputFile + " is up to date");
+  return true;
+}
+
+void elf::writeIncrementalState(const opt::InputArgList &args) {
+  if (!isEnabled())
+    return;
+  std::string statePath = getStatePath();
+  Optional<uint64_t> outputHash = hashFile(config->outputFile);
+  if (!outputHash) {
+    sys::fs::remove(statePath);
+    return;
+  }
+
+  std::error_code ec;
+  raw_fd_ostream os(statePath, ec, sys::fs::OF_None);
+  if (ec) {
+    warn("cannot open " + statePath + ": " + ec.message());
+    return;
+  }
+  os << stateMagic << '\n';
+  os << "key " << utohexstr(getKey(args)) << '\n';
+  os << "output " << utohexstr(*outputHash) << '\n';
+  for (StringRef path : config->dependencyFiles) {
+    Optional<uint64_t> hash = hashFile(path);
+    if (!hash) {
+      os.close();
+      sys::fs::remove(statePath);
+      return;
+    }
+    os << "file " << utohexstr(*hash) << ' ' << path << '\n';
+  }
+  for (StringRef path : config->missingFiles)
+    os << "missing " << path << '\n';
+}
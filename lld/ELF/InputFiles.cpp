@@ -26,6 +26,7 @@
 #include "llvm/Support/ARMAttributeParser.h"
 #include "llvm/Support/ARMBuildAttributes.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/RISCVAttributeParser.h"
 #include "llvm/Support/TarWriter.h"
@@ -232,6 +233,39 @@ void elf::parseFile(InputFile *file) {
   }
 }
 
+template <class ELFT> static void doPreParseFiles(ArrayRef<InputFile *> files) {
+  parallelForEach(files, [](InputFile *file) {
+    // Files of another ELF kind are diagnosed by parseFile(); reading them
+    // with this ELFT is wrong.
+    if (file->ekind != config->ekind)
+      return;
+    if (auto *f = dyn_cast<ObjFile<ELFT>>(file))
+      f->preParse();
+  });
+}
+
+// Does the file local part of parsing of object files in parallel. Symbol
+// resolution is still done by parseFile() one file at a time, because which
+// archive members get fetched depends on the order of files.
+void elf::preParseFiles(ArrayRef<InputFile *> files) {
+  switch (config->ekind) {
+  case ELF32LEKind:
+    doPreParseFiles<ELF32LE>(files);
+    return;
+  case ELF32BEKind:
+    doPreParseFiles<ELF32BE>(files);
+    return;
+  case ELF64LEKind:
+    doPreParseFiles<ELF64LE>(files);
+    return;
+  case ELF64BEKind:
+    doPreParseFiles<ELF64BE>(files);
+    return;
+  default:
+    llvm_unreachable("unknown ELFT");
+  }
+}
+
 // Concatenates arguments to construct a string representing an error location.
 static std::string createFileLineMsg(StringRef path, unsigned line) {
   std::string filename = std::string(path::filename(path));
@@ -404,6 +438,21 @@ template <class ELFT> ArrayRef<Symbol *> ObjFile<ELFT>::getGlobalSymbols() {
   return makeArrayRef(this->symbols).slice(this->firstGlobal);
 }
 
+template <class ELFT> void ObjFile<ELFT>::preParse() {
+  ArrayRef<Elf_Sym> eSyms = this->getGlobalELFSyms<ELFT>();
+  globalKeys.reserve(eSyms.size());
+  for (const Elf_Sym &eSym : eSyms) {
+    // A null key makes initializeSymbols() read the name itself, which also
+    // diagnoses malformed symbols.
+    if (eSym.getBinding() == STB_LOCAL ||
+        eSym.st_name >= this->stringTable.size())
+      globalKeys.emplace_back(StringRef(), 0);
+    else
+      globalKeys.push_back(SymbolTable::getKey(
+          StringRef(this->stringTable.data() + eSym.st_name)));
+  }
+}
+
 template <class ELFT> void ObjFile<ELFT>::parse(bool ignoreComdats) {
   // Read a section table. justSymbols is usually false.
   if (this->justSymbols)
@@ -509,7 +558,7 @@ template <class ELFT> void ObjFile<ELFT>::initializeJustSymbols() {
 static void addDependentLibrary(StringRef specifier, const InputFile *f) {
   if (!config->dependentLibraries)
     return;
-  if (fs::exists(specifier))
+  if (fileExists(specifier))
     driver->addFile(specifier, /*withLOption=*/false);
   else if (Optional<std::string> s = findFromSearchPaths(specifier))
     driver->addFile(*s, /*withLOption=*/true);
@@ -1100,8 +1149,12 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
         error(toString(this) + ": non-local symbol (" + Twine(i) +
               ") found at index < .symtab's sh_info (" + Twine(firstGlobal) +
               ")");
-      this->symbols[i] =
-          symtab->insert(CHECK(eSyms[i].getName(this->stringTable), this));
+      if (!globalKeys.empty() && i >= firstGlobal &&
+          globalKeys[i - firstGlobal].val().data())
+        this->symbols[i] = symtab->insert(globalKeys[i - firstGlobal]);
+      else
+        this->symbols[i] =
+            symtab->insert(CHECK(eSyms[i].getName(this->stringTable), this));
       continue;
     }
 
@@ -1198,6 +1251,8 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
 
     fatal(toString(this) + ": unexpected binding: " + Twine((int)binding));
   }
+
+  std::vector<CachedHashStringRef>().swap(globalKeys);
 }
 
 ArchiveFile::ArchiveFile(std::unique_ptr<Archive> &&file)
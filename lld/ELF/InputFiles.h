@@ -52,6 +52,7 @@ llvm::Optional<MemoryBufferRef> readFile(StringRef path);
 
 // Add symbols in File to the symbol table.
 void parseFile(InputFile *file);
+void preParseFiles(ArrayRef<InputFile *> files);
 
 // The root class of input files.
 class InputFile {
@@ -205,6 +206,11 @@ public:
     this->archiveName = std::string(archiveName);
   }
 
+  // Reads the names of global symbols and computes their symbol table keys.
+  // Unlike parse(), this does not depend on other files, so it is called for
+  // many files in parallel before they are parsed in command line order.
+  void preParse();
+
   void parse(bool ignoreComdats = false);
 
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> sections,
@@ -283,6 +289,10 @@ private:
   // .shstrtab contents.
   StringRef sectionStringTable;
 
+  // Symbol table keys of global symbols computed by preParse(), or empty if
+  // preParse() was not called. Released once the symbols are inserted.
+  std::vector<llvm::CachedHashStringRef> globalKeys;
+
   // Debugging information to retrieve source file and line for error
   // reporting. Linker may find reasonable number of errors in a
   // single object file, so we cache debugging information in order to
@@ -237,12 +237,14 @@ public:
     return llvm::makeArrayRef<T>((const T *)data().data(), s / sizeof(T));
   }
 
+  // The section contents; replaced by RISC-V linker relaxation, which deletes
+  // bytes.
+  mutable ArrayRef<uint8_t> rawData;
+
 protected:
   void parseCompressedHeader();
   void uncompress() const;
 
-  mutable ArrayRef<uint8_t> rawData;
-
   // This field stores the uncompressed size of the compressed data in rawData,
   // or -1 if rawData is not compressed (either because the section wasn't
   // compressed in the first place, or because we ended up uncompressing it).
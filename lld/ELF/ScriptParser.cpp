@@ -22,6 +22,7 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/StringSwitch.h"
@@ -285,7 +286,7 @@ void ScriptParser::addFile(StringRef s) {
   if (isUnderSysroot && s.startswith("/")) {
     SmallString<128> pathData;
     StringRef path = (config->sysroot + s).toStringRef(pathData);
-    if (sys::fs::exists(path)) {
+    if (fileExists(path)) {
       driver->addFile(saver.save(path), /*withLOption=*/false);
       return;
     }
@@ -311,13 +312,13 @@ void ScriptParser::addFile(StringRef s) {
     if (!directory.empty()) {
       SmallString<0> path(directory);
       sys::path::append(path, s);
-      if (sys::fs::exists(path)) {
+      if (fileExists(path)) {
         driver->addFile(path, /*withLOption=*/false);
         return;
       }
     }
     // Then search in the current working directory.
-    if (sys::fs::exists(s)) {
+    if (fileExists(s)) {
       driver->addFile(s, /*withLOption=*/false);
     } else {
       // Finally, search in the list of library paths.
@@ -533,14 +534,37 @@ std::vector<BaseCommand *> ScriptParser::readOverlay() {
     prev = os;
   }
 
+  // Like GNU ld, define __load_start_<name> and __load_stop_<name> with the
+  // load addresses of every section, so that a runtime can copy the section
+  // into the overlay region. The characters of the section name that cannot
+  // appear in a C identifier are dropped.
+  size_t numSections = v.size();
+  for (size_t i = 0; i != numSections; ++i) {
+    auto *os = cast<OutputSection>(v[i]);
+    std::string name;
+    for (char c : os->name)
+      if (isAlnum(c) || c == '_')
+        name += c;
+    auto *start = make<SymbolAssignment>(
+        saver.save("__load_start_" + name),
+        [=] { return ExprValue(os->getLMA()); }, getCurrentLocation());
+    auto *stop = make<SymbolAssignment>(
+        saver.save("__load_stop_" + name),
+        [=] { return ExprValue(os->getLMA() + os->size); },
+        getCurrentLocation());
+    start->provide = stop->provide = true;
+    v.push_back(start);
+    v.push_back(stop);
+  }
+
   // According to the specification, at the end of the overlay, the location
   // counter should be equal to the overlay base address plus size of the
   // largest section seen in the overlay.
   // Here we want to create the Dot assignment command to achieve that.
   Expr moveDot = [=] {
     uint64_t max = 0;
-    for (BaseCommand *cmd : v)
-      max = std::max(max, cast<OutputSection>(cmd)->size);
+    for (size_t i = 0; i != numSections; ++i)
+      max = std::max(max, cast<OutputSection>(v[i])->size);
     return addrExpr().getValue() + max;
   };
   v.push_back(make<SymbolAssignment>(".", moveDot, getCurrentLocation()));
@@ -14,6 +14,7 @@
 #include "lld/Common/Strings.h"
 #include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/ADT/STLExtras.h"
 
 namespace lld {
@@ -46,6 +47,12 @@ public:
   void wrap(Symbol *sym, Symbol *real, Symbol *wrap);
 
   Symbol *insert(StringRef name);
+  Symbol *insert(llvm::CachedHashStringRef key);
+
+  // Returns the key under which a symbol named \p name is stored. It does
+  // not touch the table, so input files compute keys for their symbols in
+  // parallel before they are inserted in command line order.
+  static llvm::CachedHashStringRef getKey(StringRef name);
 
   Symbol *addSymbol(const Symbol &newSym);
 
@@ -79,7 +86,7 @@ private:
   // but a bit inefficient.
   // FIXME: Experiment with passing in a custom hashing or sorting the symbols
   // once symbol resolution is finished.
-  llvm::DenseMap<llvm::CachedHashStringRef, int> symMap;
+  llvm::FlatHashMap<llvm::CachedHashStringRef, int> symMap;
   std::vector<Symbol *> symVector;
 
   // A map from demangled symbol names to their symbol objects.
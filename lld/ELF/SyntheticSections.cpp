@@ -30,9 +30,11 @@
 #include "llvm/ADT/SetOperations.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/DebugInfo/DWARF/DWARFAcceleratorTable.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugPubTable.h"
 #include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/DJB.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MD5.h"
@@ -2983,6 +2985,408 @@ void GdbIndexSection::writeTo(uint8_t *buf) {
 
 bool GdbIndexSection::isNeeded() const { return !chunks.empty(); }
 
+DebugNamesSection::DebugNamesSection()
+    : SyntheticSection(0, SHT_PROGBITS, 4, ".debug_names") {}
+
+// The size of the header of a DWARF32 name index without augmentation string.
+static constexpr size_t debugNamesHeaderSize = 36;
+
+// Returns whether the index attributes of form `form` can be copied as is to
+// the output, i.e. whether they are neither relocated nor relative to the
+// input name index.
+static bool isCopyableIndexForm(dwarf::Form form) {
+  switch (form) {
+  case DW_FORM_data1:
+  case DW_FORM_data2:
+  case DW_FORM_data4:
+  case DW_FORM_data8:
+  case DW_FORM_data16:
+  case DW_FORM_udata:
+  case DW_FORM_ref1:
+  case DW_FORM_ref2:
+  case DW_FORM_ref4:
+  case DW_FORM_ref8:
+  case DW_FORM_ref_udata:
+  case DW_FORM_flag:
+  case DW_FORM_flag_present:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Reads the name indexes of the .debug_names section of a file. The entries
+// of type units are dropped, as the output only lists compile units. Returns
+// false if the section cannot be merged, in which case its compile units are
+// left out of the output so that debuggers index them themselves.
+template <class ELFT>
+static bool readDebugNames(const LLDDwarfObj<ELFT> &obj,
+                           DebugNamesSection::DebugNamesChunk &chunk) {
+  using Chunk = DebugNamesSection::DebugNamesChunk;
+  const LLDDWARFSection &namesSec = obj.getNamesSection();
+  auto fail = [&](const Twine &msg) {
+    warn(toString(namesSec.sec) + ": " + msg);
+    chunk = Chunk{};
+    return false;
+  };
+
+  DWARFDataExtractor namesData(obj, namesSec, config->isLE, config->wordsize);
+  DataExtractor strData(obj.getStrSection(), config->isLE, config->wordsize);
+  DWARFDebugNames index(namesData, strData);
+  if (Error e = index.extract())
+    return fail(toString(std::move(e)));
+
+  // The forms of the attributes copied to the output do not depend on the
+  // DWARF format.
+  const dwarf::FormParams params = {5, 0, dwarf::DWARF32};
+  for (const DWARFDebugNames::NameIndex &ni : index) {
+    uint32_t cuBase = chunk.compilationUnits.size();
+    for (uint32_t i = 0, e = ni.getCUCount(); i != e; ++i)
+      chunk.compilationUnits.push_back(ni.getCUOffset(i));
+
+    DenseMap<uint32_t, uint32_t> abbrevIdxs;
+    std::vector<const DWARFDebugNames::Abbrev *> abbrevs;
+    for (const DWARFDebugNames::Abbrev &abbrev : ni.getAbbrevs()) {
+      std::string key;
+      raw_string_ostream os(key);
+      encodeULEB128(abbrev.Tag, os);
+      for (const DWARFDebugNames::AttributeEncoding &attr : abbrev.Attributes) {
+        if (attr.Index == DW_IDX_compile_unit ||
+            attr.Index == DW_IDX_type_unit || attr.Index == DW_IDX_parent)
+          continue;
+        if (!isCopyableIndexForm(attr.Form))
+          return fail("unsupported form " + FormEncodingString(attr.Form) +
+                      " in .debug_names abbreviation");
+        encodeULEB128(attr.Index, os);
+        encodeULEB128(attr.Form, os);
+      }
+      abbrevIdxs[abbrev.Code] = abbrevs.size();
+      abbrevs.push_back(&abbrev);
+      chunk.abbrevs.push_back(std::move(os.str()));
+    }
+    uint32_t abbrevBase = chunk.abbrevs.size() - abbrevs.size();
+
+    for (const DWARFDebugNames::NameTableEntry &nte : ni) {
+      const char *name = nte.getString();
+      if (!name)
+        return fail("invalid string offset in .debug_names");
+      DebugNamesSection::InputName in = {
+          CachedHashStringRef(name), caseFoldingDjbHash(name),
+          nte.getStringOffset(), static_cast<uint32_t>(chunk.entries.size()),
+          0};
+
+      uint64_t off = nte.getEntryOffset();
+      while (true) {
+        if (!namesData.isValidOffset(off))
+          return fail("incorrectly terminated entry list in .debug_names");
+        uint32_t code = namesData.getULEB128(&off);
+        if (code == 0)
+          break;
+        auto it = abbrevIdxs.find(code);
+        if (it == abbrevIdxs.end())
+          return fail("invalid abbreviation code in .debug_names");
+
+        DebugNamesSection::NameEntry ent = {
+            abbrevBase + it->second, 0,
+            static_cast<uint32_t>(chunk.attrPool.size()), 0};
+        // Entries of an index of a single compile unit may omit it.
+        Optional<uint64_t> cu;
+        if (ni.getCUCount() == 1)
+          cu = 0;
+        bool isTypeUnit = false;
+        for (const DWARFDebugNames::AttributeEncoding &attr :
+             abbrevs[it->second]->Attributes) {
+          uint64_t start = off;
+          if (attr.Index == DW_IDX_compile_unit) {
+            DWARFFormValue value(attr.Form);
+            if (!value.extractValue(namesData, &off, params))
+              return fail("cannot read DW_IDX_compile_unit in .debug_names");
+            cu = value.getAsUnsignedConstant();
+            continue;
+          }
+          if (!DWARFFormValue::skipValue(attr.Form, namesData, &off, params))
+            return fail("cannot read index attribute in .debug_names");
+          if (attr.Index == DW_IDX_type_unit)
+            isTypeUnit = true;
+          else if (attr.Index != DW_IDX_parent)
+            chunk.attrPool.append(namesSec.Data.data() + start, off - start);
+        }
+
+        if (isTypeUnit || !cu || *cu >= ni.getCUCount()) {
+          chunk.attrPool.resize(ent.attrsOff);
+          continue;
+        }
+        ent.cuIndex = cuBase + *cu;
+        ent.attrsSize = chunk.attrPool.size() - ent.attrsOff;
+        chunk.entries.push_back(ent);
+      }
+
+      in.entriesEnd = chunk.entries.size();
+      if (in.entriesBegin != in.entriesEnd)
+        chunk.names.push_back(in);
+    }
+  }
+  return true;
+}
+
+// Merges the input names by string.
+static std::vector<DebugNamesSection::OutputName>
+createNames(ArrayRef<DebugNamesSection::DebugNamesChunk> chunks) {
+  using OutputName = DebugNamesSection::OutputName;
+
+  // As for .gdb_index, there are millions of names in large executables, so
+  // they are uniquified in parallel in a sharded map.
+  constexpr size_t numShards = 32;
+  size_t concurrency = PowerOf2Floor(
+      std::min<size_t>(hardware_concurrency(parallel::strategy.ThreadsRequested)
+                           .compute_thread_count(),
+                       numShards));
+  std::vector<DenseMap<CachedHashStringRef, size_t>> map(numShards);
+  size_t shift = 32 - countTrailingZeros(numShards);
+
+  std::vector<std::vector<OutputName>> names(numShards);
+  parallelForEachN(0, concurrency, [&](size_t threadId) {
+    for (uint32_t i = 0, e = chunks.size(); i != e; ++i) {
+      ArrayRef<DebugNamesSection::InputName> inputs = chunks[i].names;
+      for (uint32_t j = 0, f = inputs.size(); j != f; ++j) {
+        const DebugNamesSection::InputName &in = inputs[j];
+        size_t shardId = in.name.hash() >> shift;
+        if ((shardId & (concurrency - 1)) != threadId)
+          continue;
+
+        size_t &idx = map[shardId][in.name];
+        if (!idx) {
+          idx = names[shardId].size() + 1;
+          names[shardId].push_back({in.name, in.hash, 0, {}});
+        }
+        names[shardId][idx - 1].inputs.emplace_back(i, j);
+      }
+    }
+  });
+
+  size_t numNames = 0;
+  for (ArrayRef<OutputName> v : names)
+    numNames += v.size();
+  std::vector<OutputName> ret;
+  ret.reserve(numNames);
+  for (std::vector<OutputName> &vec : names)
+    for (OutputName &name : vec)
+      ret.push_back(std::move(name));
+  return ret;
+}
+
+void DebugNamesSection::initOutputSize() {
+  for (const DebugNamesChunk &chunk : chunks)
+    cuCount += chunk.compilationUnits.size();
+  if (cuCount <= UINT8_MAX)
+    cuForm = DW_FORM_data1, cuFormSize = 1;
+  else if (cuCount <= UINT16_MAX)
+    cuForm = DW_FORM_data2, cuFormSize = 2;
+  else
+    cuForm = DW_FORM_data4, cuFormSize = 4;
+
+  // Give the abbreviations their output codes.
+  StringMap<uint32_t> codes;
+  for (DebugNamesChunk &chunk : chunks) {
+    for (std::string &abbrev : chunk.abbrevs) {
+      auto it = codes.insert({abbrev, abbrevTable.size() + 1});
+      if (it.second)
+        abbrevTable.push_back(std::move(abbrev));
+      chunk.abbrevCodes.push_back(it.first->second);
+    }
+    chunk.abbrevs.clear();
+  }
+  // Each abbreviation is its code, its encoding with DW_IDX_compile_unit
+  // added, and a (0, 0) terminator. The table is terminated by a 0 code.
+  abbrevTableSize = 1;
+  for (size_t i = 0, e = abbrevTable.size(); i != e; ++i)
+    abbrevTableSize += getULEB128Size(i + 1) + abbrevTable[i].size() +
+                       getULEB128Size(DW_IDX_compile_unit) +
+                       getULEB128Size(cuForm) + 2;
+
+  // Choose the number of buckets the way LLVM does, and sort the names by
+  // bucket. Names with the same hash are kept together within a bucket.
+  std::vector<uint32_t> hashes;
+  hashes.reserve(names.size());
+  for (const OutputName &name : names)
+    hashes.push_back(name.hash);
+  llvm::sort(hashes);
+  size_t uniqueHashes =
+      std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+  if (uniqueHashes > 1024)
+    bucketCount = uniqueHashes / 4;
+  else if (uniqueHashes > 16)
+    bucketCount = uniqueHashes / 2;
+  else
+    bucketCount = std::max<size_t>(uniqueHashes, 1);
+  llvm::stable_sort(names, [&](const OutputName &a, const OutputName &b) {
+    uint32_t bucketA = a.hash % bucketCount, bucketB = b.hash % bucketCount;
+    return bucketA != bucketB ? bucketA < bucketB : a.hash < b.hash;
+  });
+
+  // The entries of a name are followed by a 0 abbreviation code.
+  for (OutputName &name : names) {
+    name.entryOff = entryPoolSize;
+    for (std::pair<uint32_t, uint32_t> in : name.inputs) {
+      const DebugNamesChunk &chunk = chunks[in.first];
+      const InputName &inputName = chunk.names[in.second];
+      for (uint32_t i = inputName.entriesBegin; i != inputName.entriesEnd;
+           ++i) {
+        const NameEntry &ent = chunk.entries[i];
+        entryPoolSize += getULEB128Size(chunk.abbrevCodes[ent.abbrevIdx]) +
+                         cuFormSize + ent.attrsSize;
+      }
+    }
+    ++entryPoolSize;
+  }
+
+  size = debugNamesHeaderSize + cuCount * 4 + bucketCount * 4 +
+         names.size() * 12 + abbrevTableSize + entryPoolSize;
+  if (size - 4 > UINT32_MAX)
+    error(".debug_names: merged name index is too large");
+}
+
+// Returns a newly-created .debug_names section.
+template <class ELFT> DebugNamesSection *DebugNamesSection::create() {
+  SetVector<InputFile *> files;
+  for (InputSectionBase *s : inputSections) {
+    InputSection *isec = dyn_cast<InputSection>(s);
+    if (!isec || isec->name != ".debug_names")
+      continue;
+    // The input name indexes are replaced by the merged one.
+    s->markDead();
+    files.insert(isec->file);
+  }
+  // Drop .rel[a].debug_names for --emit-relocs.
+  llvm::erase_if(inputSections, [](InputSectionBase *s) {
+    if (auto *isec = dyn_cast<InputSection>(s))
+      if (InputSectionBase *rel = isec->getRelocatedSection())
+        return !rel->isLive();
+    return !s->isLive();
+  });
+
+  std::vector<DebugNamesChunk> chunks(files.size());
+  parallelForEachN(0, files.size(), [&](size_t i) {
+    ObjFile<ELFT> *file = cast<ObjFile<ELFT>>(files[i]);
+    LLDDwarfObj<ELFT> dobj(file);
+    DebugNamesChunk &chunk = chunks[i];
+    for (InputSectionBase *sec : file->getSections())
+      if (sec && sec != &InputSection::discarded && sec->name == ".debug_str")
+        chunk.strSec = sec;
+    chunk.infoSec = dobj.getInfoSection();
+    if (!chunk.infoSec || !chunk.strSec) {
+      warn(toString(file) + ": .debug_names without .debug_info or "
+                            ".debug_str is ignored");
+      return;
+    }
+    readDebugNames(dobj, chunk);
+  });
+  llvm::erase_if(chunks, [](const DebugNamesChunk &chunk) {
+    return chunk.compilationUnits.empty();
+  });
+
+  auto *ret = make<DebugNamesSection>();
+  ret->chunks = std::move(chunks);
+  ret->names = createNames(ret->chunks);
+  ret->initOutputSize();
+  return ret;
+}
+
+void DebugNamesSection::writeTo(uint8_t *buf) {
+  // Write the header.
+  write32(buf, size - 4);
+  write16(buf + 4, 5);
+  write32(buf + 8, cuCount);
+  write32(buf + 20, bucketCount);
+  write32(buf + 24, names.size());
+  write32(buf + 28, abbrevTableSize);
+  buf += debugNamesHeaderSize;
+
+  // Write the CU list. The offsets read from the input files are relative to
+  // their .debug_info sections.
+  for (const DebugNamesChunk &chunk : chunks) {
+    for (uint64_t cuOffset : chunk.compilationUnits) {
+      uint64_t off = chunk.infoSec->outSecOff + cuOffset;
+      if (off > UINT32_MAX)
+        error(".debug_names: compile unit offset overflows DWARF32");
+      write32(buf, off);
+      buf += 4;
+    }
+  }
+
+  // Write the buckets, holding the 1-based index of their first name, and the
+  // hashes.
+  uint8_t *buckets = buf;
+  buf += bucketCount * 4;
+  for (size_t i = names.size(); i != 0; --i) {
+    const OutputName &name = names[i - 1];
+    write32(buckets + (name.hash % bucketCount) * 4, i);
+    write32(buf + (i - 1) * 4, name.hash);
+  }
+  buf += names.size() * 4;
+
+  // Write the string offsets into the output .debug_str, and the entry
+  // offsets.
+  uint8_t *strOffsets = buf;
+  uint8_t *entryOffsets = buf + names.size() * 4;
+  parallelForEachN(0, names.size(), [&](size_t i) {
+    std::pair<uint32_t, uint32_t> in = names[i].inputs[0];
+    const DebugNamesChunk &chunk = chunks[in.first];
+    write32(strOffsets + i * 4,
+            chunk.strSec->getVA(chunk.names[in.second].strOffset));
+    write32(entryOffsets + i * 4, names[i].entryOff);
+  });
+  buf += names.size() * 8;
+
+  // Write the abbreviation table.
+  for (size_t i = 0, e = abbrevTable.size(); i != e; ++i) {
+    buf += encodeULEB128(i + 1, buf);
+    const std::string &abbrev = abbrevTable[i];
+    // DW_IDX_compile_unit goes right after the tag.
+    unsigned tagSize;
+    decodeULEB128(reinterpret_cast<const uint8_t *>(abbrev.data()), &tagSize);
+    memcpy(buf, abbrev.data(), tagSize);
+    buf += tagSize;
+    buf += encodeULEB128(DW_IDX_compile_unit, buf);
+    buf += encodeULEB128(cuForm, buf);
+    memcpy(buf, abbrev.data() + tagSize, abbrev.size() - tagSize);
+    buf += abbrev.size() - tagSize;
+    *buf++ = 0;
+    *buf++ = 0;
+  }
+  *buf++ = 0;
+
+  // Write the entry pool.
+  std::vector<uint32_t> cuBases(chunks.size());
+  for (size_t i = 1, e = chunks.size(); i < e; ++i)
+    cuBases[i] = cuBases[i - 1] + chunks[i - 1].compilationUnits.size();
+  parallelForEach(names, [&](const OutputName &name) {
+    uint8_t *p = buf + name.entryOff;
+    for (std::pair<uint32_t, uint32_t> in : name.inputs) {
+      const DebugNamesChunk &chunk = chunks[in.first];
+      const InputName &inputName = chunk.names[in.second];
+      for (uint32_t i = inputName.entriesBegin; i != inputName.entriesEnd;
+           ++i) {
+        const NameEntry &ent = chunk.entries[i];
+        p += encodeULEB128(chunk.abbrevCodes[ent.abbrevIdx], p);
+        uint32_t cuIndex = cuBases[in.first] + ent.cuIndex;
+        if (cuFormSize == 1)
+          *p = cuIndex;
+        else if (cuFormSize == 2)
+          write16(p, cuIndex);
+        else
+          write32(p, cuIndex);
+        p += cuFormSize;
+        memcpy(p, chunk.attrPool.data() + ent.attrsOff, ent.attrsSize);
+        p += ent.attrsSize;
+      }
+    }
+    *p = 0;
+  });
+}
+
+bool DebugNamesSection::isNeeded() const { return !chunks.empty(); }
+
 EhFrameHeader::EhFrameHeader()
     : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, 4, ".eh_frame_hdr") {}
 
@@ -3801,6 +4205,36 @@ void PartitionIndexSection::writeTo(uint8_t *buf) {
   }
 }
 
+OverlayTableSection::OverlayTableSection()
+    : SyntheticSection(SHF_ALLOC, SHT_PROGBITS, config->wordsize,
+                       ".overlay_table") {}
+
+size_t OverlayTableSection::getSize() const {
+  return config->wordsize * (1 + 4 * sections.size());
+}
+
+void OverlayTableSection::finalizeContents() {
+  // Overlay sections without input sections have been removed by now.
+  for (OutputSection *sec : outputSections)
+    if (sec->inOverlay)
+      sections.push_back(sec);
+}
+
+void OverlayTableSection::writeTo(uint8_t *buf) {
+  writeUint(buf, sections.size());
+  buf += config->wordsize;
+
+  DenseMap<uint64_t, uint64_t> regions;
+  for (OutputSection *sec : sections) {
+    uint64_t region = regions.insert({sec->addr, regions.size()}).first->second;
+    writeUint(buf, sec->addr);
+    writeUint(buf + config->wordsize, sec->getLMA());
+    writeUint(buf + config->wordsize * 2, sec->size);
+    writeUint(buf + config->wordsize * 3, region);
+    buf += config->wordsize * 4;
+  }
+}
+
 InStruct elf::in;
 
 std::vector<Partition> elf::partitions;
@@ -3811,6 +4245,11 @@ template GdbIndexSection *GdbIndexSection::create<ELF32BE>();
 template GdbIndexSection *GdbIndexSection::create<ELF64LE>();
 template GdbIndexSection *GdbIndexSection::create<ELF64BE>();
 
+template DebugNamesSection *DebugNamesSection::create<ELF32LE>();
+template DebugNamesSection *DebugNamesSection::create<ELF32BE>();
+template DebugNamesSection *DebugNamesSection::create<ELF64LE>();
+template DebugNamesSection *DebugNamesSection::create<ELF64BE>();
+
 template void elf::splitSections<ELF32LE>();
 template void elf::splitSections<ELF32BE>();
 template void elf::splitSections<ELF64LE>();
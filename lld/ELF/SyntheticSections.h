@@ -784,6 +784,76 @@ private:
   size_t size;
 };
 
+// The --debug-names option merges the .debug_names sections of the input
+// files, each holding one or more DWARF v5 name indexes, into a single name
+// index covering all their compile units. Debuggers can then look names up
+// without indexing .debug_info themselves.
+class DebugNamesSection final : public SyntheticSection {
+public:
+  // An entry of a name in the index. The index attributes other than
+  // DW_IDX_compile_unit are copied from the input, in the chunk's attrPool.
+  struct NameEntry {
+    uint32_t abbrevIdx;
+    uint32_t cuIndex;
+    uint32_t attrsOff;
+    uint32_t attrsSize;
+  };
+
+  // A name of an input name index and its entries in the chunk.
+  struct InputName {
+    llvm::CachedHashStringRef name;
+    uint32_t hash;
+    uint64_t strOffset;
+    uint32_t entriesBegin;
+    uint32_t entriesEnd;
+  };
+
+  // The name indexes of an input file.
+  struct DebugNamesChunk {
+    InputSection *infoSec;
+    InputSectionBase *strSec;
+    std::vector<uint64_t> compilationUnits;
+    // The abbreviations, as their encoding without the abbreviation code and
+    // the DW_IDX_compile_unit attribute, and the codes they get in the output.
+    std::vector<std::string> abbrevs;
+    std::vector<uint32_t> abbrevCodes;
+    std::vector<InputName> names;
+    std::vector<NameEntry> entries;
+    std::string attrPool;
+  };
+
+  struct OutputName {
+    llvm::CachedHashStringRef name;
+    uint32_t hash;
+    uint32_t entryOff;
+    // The input names merged into this one, as (chunk, name) indexes.
+    llvm::SmallVector<std::pair<uint32_t, uint32_t>, 1> inputs;
+  };
+
+  DebugNamesSection();
+  template <typename ELFT> static DebugNamesSection *create();
+  void writeTo(uint8_t *buf) override;
+  size_t getSize() const override { return size; }
+  bool isNeeded() const override;
+
+private:
+  void initOutputSize();
+
+  std::vector<DebugNamesChunk> chunks;
+
+  // The names sorted by bucket, and the abbreviation table.
+  std::vector<OutputName> names;
+  std::vector<std::string> abbrevTable;
+
+  uint32_t cuCount = 0;
+  uint32_t bucketCount = 0;
+  uint8_t cuFormSize = 0;
+  llvm::dwarf::Form cuForm;
+  size_t abbrevTableSize = 0;
+  size_t entryPoolSize = 0;
+  size_t size;
+};
+
 // --eh-frame-hdr option tells linker to construct a header for all the
 // .eh_frame sections. This header is placed to a section named .eh_frame_hdr
 // and also to a PT_GNU_EH_FRAME segment.
@@ -1144,6 +1214,23 @@ public:
   void writeTo(uint8_t *buf) override;
 };
 
+// The overlay table describes the output sections of the OVERLAY statements of
+// the linker script, so that a runtime can load an overlay by its index. It
+// starts with the number of entries, followed by one entry per section of
+// four words: the run address, the load address, the size, and the index of
+// the overlay region, which is shared by the sections with the same run
+// address. All values are of the word size of the target.
+class OverlayTableSection : public SyntheticSection {
+public:
+  OverlayTableSection();
+  size_t getSize() const override;
+  void finalizeContents() override;
+  void writeTo(uint8_t *buf) override;
+
+private:
+  std::vector<OutputSection *> sections;
+};
+
 InputSection *createInterpSection();
 MergeInputSection *createCommentSection();
 MergeSyntheticSection *createMergeSynthetic(StringRef name, uint32_t type,
@@ -1204,6 +1291,7 @@ struct InStruct {
   PPC64LongBranchTargetSection *ppc64LongBranchTarget;
   MipsGotSection *mipsGot;
   MipsRldMapSection *mipsRldMap;
+  OverlayTableSection *overlayTable;
   SyntheticSection *partEnd;
   SyntheticSection *partIndex;
   PltSection *plt;
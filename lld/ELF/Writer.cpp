@@ -492,6 +492,18 @@ template <class ELFT> void elf::createSyntheticSections() {
     add(in.partIndex);
   }
 
+  // Describe the OVERLAY sections of the linker script for the overlay
+  // manager of the runtime.
+  if (script->hasSectionsCommand &&
+      llvm::any_of(script->sectionCommands, [](BaseCommand *base) {
+        auto *sec = dyn_cast<OutputSection>(base);
+        return sec && sec->inOverlay;
+      })) {
+    in.overlayTable = make<OverlayTableSection>();
+    addOptionalRegular("__overlay_table", in.overlayTable, 0);
+    add(in.overlayTable);
+  }
+
   // Add .got. MIPS' .got is so different from the other archs,
   // it has its own class.
   if (config->emachine == EM_MIPS) {
@@ -528,6 +540,8 @@ template <class ELFT> void elf::createSyntheticSections() {
 
   if (config->gdbIndex)
     add(GdbIndexSection::create<ELFT>());
+  if (config->debugNames)
+    add(DebugNamesSection::create<ELFT>());
 
   // We always need to add rel[a].plt to output if it has entries.
   // Even for static linking it can contain R_[*]_IRELATIVE relocations.
@@ -1714,13 +1728,16 @@ template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
     hexagonTLSSymbolUpdate(outputSections);
 
   int assignPasses = 0;
+  int relaxPasses = 0;
   for (;;) {
-    bool changed = target->needsThunks && tc.createThunks(outputSections);
+    bool changed = target->needsThunks ? tc.createThunks(outputSections)
+                                       : target->relaxOnce(relaxPasses++);
 
     // With Thunk Size much smaller than branch range we expect to
     // converge quickly; if we get to 15 something has gone wrong.
-    if (changed && tc.pass >= 15) {
-      error("thunk creation not converged");
+    if (changed && (tc.pass >= 15 || relaxPasses >= 15)) {
+      error(target->needsThunks ? "thunk creation not converged"
+                                : "relaxation not converged");
       break;
     }
 
@@ -1759,6 +1776,9 @@ template <class ELFT> void Writer<ELFT>::finalizeAddressDependentContent() {
     }
   }
 
+  if (!config->relocatable && config->emachine == EM_RISCV)
+    riscvFinalizeRelax(relaxPasses);
+
   // If addrExpr is set, the address may not be a multiple of the alignment.
   // Warn because this is error-prone.
   for (BaseCommand *cmd : script->sectionCommands)
@@ -2140,6 +2160,7 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
     finalizeSynthetic(in.iplt);
     finalizeSynthetic(in.ppc32Got2);
     finalizeSynthetic(in.partIndex);
+    finalizeSynthetic(in.overlayTable);
 
     // Dynamic section must be the last one in this list and dynamic
     // symbol table section (dynSymTab) must be the first one.
@@ -3006,7 +3027,7 @@ template <class ELFT> void Writer<ELFT>::writeBuildId() {
   switch (config->buildId) {
   case BuildIdKind::Fast:
     computeHash(buildId, buf, [](uint8_t *dest, ArrayRef<uint8_t> arr) {
-      write64le(dest, xxHash64(arr));
+      write64le(dest, xxh3_64bits(arr));
     });
     break;
   case BuildIdKind::Md5:
@@ -59,6 +59,10 @@ public:
   bool SetClangModulesCachePath(const FileSpec &path);
   bool GetEnableExternalLookup() const;
   bool SetEnableExternalLookup(bool new_value);
+  bool GetEnableIndexCache() const;
+  bool SetEnableIndexCache(bool new_value);
+  FileSpec GetIndexCachePath() const;
+  bool SetIndexCachePath(const FileSpec &path);
 
   PathMappingList GetSymlinkMappings() const;
 };
@@ -54,6 +54,7 @@ GDBRemoteRegisterContext::~GDBRemoteRegisterContext() {}
 
 void GDBRemoteRegisterContext::InvalidateAllRegisters() {
   SetAllRegisterValid(false);
+  m_num_individual_reads = 0;
 }
 
 void GDBRemoteRegisterContext::SetAllRegisterValid(bool b) {
@@ -237,7 +238,9 @@ bool GDBRemoteRegisterContext::ReadRegisterBytes(const RegisterInfo *reg_info,
       }
       return false;
     }
-    if (reg_info->value_regs) {
+    if (ReadAllRegistersIfNeededOften(gdb_comm)) {
+      // Every register is valid now.
+    } else if (reg_info->value_regs) {
       // Process this composite register request by delegating to the
       // constituent primordial registers.
 
@@ -293,6 +296,31 @@ bool GDBRemoteRegisterContext::ReadRegisterBytes(const RegisterInfo *reg_info,
   return true;
 }
 
+bool GDBRemoteRegisterContext::ReadAllRegistersIfNeededOften(
+    GDBRemoteCommunicationClient &gdb_comm) {
+  // Each register read on its own costs a round trip to the stub, which is
+  // slow over a high latency link such as a JTAG probe. Once a stop has
+  // needed a few of them, as unwinding does, read all the registers with a
+  // single 'g' packet instead.
+  static const uint32_t g_max_individual_reads_per_stop = 2;
+  if (!m_try_read_all_at_once ||
+      ++m_num_individual_reads <= g_max_individual_reads_per_stop)
+    return false;
+
+  DataBufferSP buffer_sp = gdb_comm.ReadAllRegisters(m_thread.GetProtocolID());
+  if (!buffer_sp || buffer_sp->GetByteSize() < m_reg_data.GetByteSize()) {
+    // The stub has no 'g' packet, or it does not cover all the registers we
+    // know of; keep to reading them one at a time.
+    m_try_read_all_at_once = false;
+    return false;
+  }
+
+  memcpy(const_cast<uint8_t *>(m_reg_data.GetDataStart()),
+         buffer_sp->GetBytes(), m_reg_data.GetByteSize());
+  SetAllRegisterValid(true);
+  return true;
+}
+
 bool GDBRemoteRegisterContext::WriteRegister(const RegisterInfo *reg_info,
                                              const RegisterValue &value) {
   DataExtractor data;
@@ -118,11 +118,18 @@ protected:
   DataExtractor m_reg_data;
   bool m_read_all_at_once;
   bool m_write_all_at_once;
+  // Whether ReadAllRegistersIfNeededOften may still use the 'g' packet.
+  bool m_try_read_all_at_once = true;
+  // The number of registers read one at a time since the last stop.
+  uint32_t m_num_individual_reads = 0;
 
 private:
   // Helper function for ReadRegisterBytes().
   bool GetPrimordialRegister(const RegisterInfo *reg_info,
                              GDBRemoteCommunicationClient &gdb_comm);
+  // Helper function for ReadRegisterBytes(): reads all the registers at once
+  // if this stop has already read several of them one at a time.
+  bool ReadAllRegistersIfNeededOften(GDBRemoteCommunicationClient &gdb_comm);
   // Helper function for WriteRegisterBytes().
   bool SetPrimordialRegister(const RegisterInfo *reg_info,
                              GDBRemoteCommunicationClient &gdb_comm);
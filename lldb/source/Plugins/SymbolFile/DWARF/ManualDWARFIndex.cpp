@@ -13,9 +13,17 @@
 #include "Plugins/SymbolFile/DWARF/LogChannelDWARF.h"
 #include "Plugins/SymbolFile/DWARF/SymbolFileDWARFDwo.h"
 #include "lldb/Core/Module.h"
+#include "lldb/Core/ModuleList.h"
+#include "lldb/Host/FileSystem.h"
 #include "lldb/Symbol/ObjectFile.h"
+#include "lldb/Utility/DataBufferLLVM.h"
+#include "lldb/Utility/DataExtractor.h"
+#include "lldb/Utility/Endian.h"
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/Timer.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/ThreadPool.h"
 
 using namespace lldb_private;
@@ -56,6 +64,16 @@ void ManualDWARFIndex::Index() {
   if (units_to_index.empty())
     return;
 
+  // Split units are indexed from the dwo files, which can change without the
+  // main file changing, so the index of split DWARF is never cached.
+  const bool use_cache =
+      ModuleList::GetGlobalModuleListProperties().GetEnableIndexCache() &&
+      !dwp_dwarf && m_units_to_avoid.empty() &&
+      llvm::none_of(units_to_index,
+                    [](DWARFUnit *unit) { return unit->GetDWOId() != 0; });
+  if (use_cache && LoadFromCache())
+    return;
+
   std::vector<IndexSet> sets(units_to_index.size());
 
   // Keep memory down by clearing DIEs for any units if indexing
@@ -108,6 +126,135 @@ void ManualDWARFIndex::Index() {
   pool.async(finalize_fn, &IndexSet::types);
   pool.async(finalize_fn, &IndexSet::namespaces);
   pool.wait();
+
+  if (use_cache)
+    SaveToCache();
+}
+
+// The index cache holds one file per module, named after the module and its
+// UUID, which starts with a header identifying the version of the module the
+// index was computed for, followed by the indexes of an IndexSet.
+static constexpr llvm::StringLiteral g_index_cache_magic("LLDBDWIX");
+// Bump this whenever the layout of the cached index changes.
+static constexpr uint32_t g_index_cache_version = 1;
+
+static llvm::Optional<FileSpec> GetIndexCacheFile(Module &module) {
+  const UUID &uuid = module.GetUUID();
+  FileSpec cache_file =
+      ModuleList::GetGlobalModuleListProperties().GetIndexCachePath();
+  if (!uuid.IsValid() || !cache_file)
+    return llvm::None;
+  cache_file.AppendPathComponent(
+      llvm::formatv("{0}-{1}.dwarf-index", module.GetFileSpec().GetFilename(),
+                    uuid.GetAsString(""))
+          .str());
+  return cache_file;
+}
+
+static uint64_t GetIndexCacheTime(const llvm::sys::TimePoint<> &time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             time.time_since_epoch())
+      .count();
+}
+
+llvm::ArrayRef<NameToDIE ManualDWARFIndex::IndexSet::*>
+ManualDWARFIndex::GetCachedIndexes() {
+  static NameToDIE IndexSet::*const g_indexes[] = {
+      &IndexSet::function_basenames,
+      &IndexSet::function_fullnames,
+      &IndexSet::function_methods,
+      &IndexSet::function_selectors,
+      &IndexSet::objc_class_selectors,
+      &IndexSet::globals,
+      &IndexSet::types,
+      &IndexSet::namespaces,
+  };
+  return g_indexes;
+}
+
+bool ManualDWARFIndex::LoadFromCache() {
+  llvm::Optional<FileSpec> cache_file = GetIndexCacheFile(m_module);
+  if (!cache_file)
+    return false;
+
+  // The file is memory mapped, only the names are copied out of it.
+  DataBufferSP buffer_sp = FileSystem::Instance().CreateDataBuffer(*cache_file);
+  if (!buffer_sp)
+    return false;
+
+  LLDB_SCOPED_TIMERF("%s", cache_file->GetPath().c_str());
+
+  DataExtractor data(buffer_sp, endian::InlHostByteOrder(), sizeof(void *));
+  lldb::offset_t offset = 0;
+  const void *magic = data.GetData(&offset, g_index_cache_magic.size());
+  if (!magic ||
+      llvm::StringRef(static_cast<const char *>(magic),
+                      g_index_cache_magic.size()) != g_index_cache_magic ||
+      data.GetU32(&offset) != g_index_cache_version ||
+      data.GetU64(&offset) != GetIndexCacheTime(m_module.GetModificationTime()) ||
+      data.GetU64(&offset) !=
+          GetIndexCacheTime(m_module.GetObjectModificationTime()))
+    return false;
+
+  IndexSet set;
+  for (NameToDIE IndexSet::*index : GetCachedIndexes()) {
+    if (!(set.*index).Decode(data, &offset))
+      return false;
+    // The entries are sorted by string pool address, which differs between
+    // processes.
+    (set.*index).Finalize();
+  }
+  m_set = std::move(set);
+
+  Log *log = LogChannelDWARF::GetLogIfAll(DWARF_LOG_LOOKUPS);
+  if (log)
+    m_module.LogMessage(log, "ManualDWARFIndex loaded the index from %s",
+                        cache_file->GetPath().c_str());
+  return true;
+}
+
+void ManualDWARFIndex::SaveToCache() {
+  llvm::Optional<FileSpec> cache_file = GetIndexCacheFile(m_module);
+  if (!cache_file)
+    return;
+
+  Log *log = LogChannelDWARF::GetLogIfAll(DWARF_LOG_LOOKUPS);
+  const std::string cache_path = cache_file->GetPath();
+  if (std::error_code ec = llvm::sys::fs::create_directories(
+          cache_file->GetDirectory().GetStringRef())) {
+    LLDB_LOG(log, "Could not create the index cache directory: {0}",
+             ec.message());
+    return;
+  }
+
+  // Write a temporary file then rename it, so that a concurrent debug session
+  // never reads a partial index.
+  llvm::Expected<llvm::sys::fs::TempFile> temp =
+      llvm::sys::fs::TempFile::create(cache_path + "-%%%%%%.tmp");
+  if (!temp) {
+    LLDB_LOG_ERROR(log, temp.takeError(),
+                   "Could not create the index cache file: {0}");
+    return;
+  }
+
+  {
+    llvm::raw_fd_ostream os(temp->FD, /*shouldClose=*/false);
+    llvm::support::endian::Writer writer(os,
+                                         llvm::support::endianness::native);
+    os << g_index_cache_magic;
+    writer.write<uint32_t>(g_index_cache_version);
+    writer.write<uint64_t>(GetIndexCacheTime(m_module.GetModificationTime()));
+    writer.write<uint64_t>(
+        GetIndexCacheTime(m_module.GetObjectModificationTime()));
+    for (NameToDIE IndexSet::*index : GetCachedIndexes())
+      (m_set.*index).Encode(os);
+  }
+
+  if (llvm::Error err = temp->keep(cache_path)) {
+    LLDB_LOG_ERROR(log, std::move(err),
+                   "Could not save the index cache file: {0}");
+    llvm::consumeError(temp->discard());
+  }
 }
 
 void ManualDWARFIndex::IndexUnit(DWARFUnit &unit, SymbolFileDWARFDwo *dwp,
@@ -11,6 +11,7 @@
 
 #include "Plugins/SymbolFile/DWARF/DWARFIndex.h"
 #include "Plugins/SymbolFile/DWARF/NameToDIE.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseSet.h"
 
 class DWARFDebugInfo;
@@ -69,6 +70,18 @@ private:
   void Index();
   void IndexUnit(DWARFUnit &unit, SymbolFileDWARFDwo *dwp, IndexSet &set);
 
+  /// The indexes of an IndexSet, in the order they are stored in the index
+  /// cache.
+  static llvm::ArrayRef<NameToDIE IndexSet::*> GetCachedIndexes();
+
+  /// Load m_set from the index cache. Fails if there is no cache entry for
+  /// this module, or if it was made for a different version of the file.
+  bool LoadFromCache();
+
+  /// Save m_set to the index cache, so that the next debug session of the
+  /// same file does not have to index it again.
+  void SaveToCache();
+
   static void IndexUnitImpl(DWARFUnit &unit,
                             const lldb::LanguageType cu_language,
                             IndexSet &set);
@@ -10,9 +10,11 @@
 #include "DWARFUnit.h"
 #include "lldb/Symbol/ObjectFile.h"
 #include "lldb/Utility/ConstString.h"
+#include "lldb/Utility/DataExtractor.h"
 #include "lldb/Utility/RegularExpression.h"
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/StreamString.h"
+#include "llvm/Support/EndianStream.h"
 
 using namespace lldb;
 using namespace lldb_private;
@@ -86,3 +88,45 @@ void NameToDIE::Append(const NameToDIE &other) {
                  other.m_map.GetValueAtIndexUnchecked(i));
   }
 }
+
+void NameToDIE::Encode(llvm::raw_ostream &os) const {
+  llvm::support::endian::Writer writer(os, llvm::support::endianness::native);
+  const uint32_t size = m_map.GetSize();
+  writer.write<uint32_t>(size);
+  for (uint32_t i = 0; i < size; ++i) {
+    const DIERef &die_ref = m_map.GetValueRefAtIndexUnchecked(i);
+    os << m_map.GetCStringAtIndexUnchecked(i).GetStringRef() << '\0';
+    // A dwo_num of zero stands for the main file.
+    writer.write<uint32_t>(die_ref.dwo_num() ? *die_ref.dwo_num() + 1 : 0);
+    writer.write<uint8_t>(die_ref.section());
+    writer.write<uint32_t>(die_ref.die_offset());
+  }
+}
+
+bool NameToDIE::Decode(const DataExtractor &data, lldb::offset_t *offset_ptr) {
+  // Each entry takes at least ten bytes, which bounds the reservation below
+  // for corrupt files.
+  const uint32_t size = data.GetU32(offset_ptr);
+  if (!data.ValidOffsetForDataOfSize(*offset_ptr, uint64_t(size) * 10))
+    return false;
+  m_map.Reserve(m_map.GetSize() + size);
+  for (uint32_t i = 0; i < size; ++i) {
+    const char *name = data.GetCStr(offset_ptr);
+    if (!name || !data.ValidOffsetForDataOfSize(*offset_ptr, 9)) {
+      m_map.Clear();
+      return false;
+    }
+    const uint32_t dwo_num = data.GetU32(offset_ptr);
+    const uint8_t section = data.GetU8(offset_ptr);
+    const uint32_t die_offset = data.GetU32(offset_ptr);
+    if (section > DIERef::DebugTypes) {
+      m_map.Clear();
+      return false;
+    }
+    m_map.Append(ConstString(name),
+                 DIERef(dwo_num ? llvm::Optional<uint32_t>(dwo_num - 1)
+                                : llvm::None,
+                        static_cast<DIERef::Section>(section), die_offset));
+  }
+  return true;
+}
@@ -15,6 +15,15 @@
 #include "lldb/Core/UniqueCStringMap.h"
 #include "lldb/Core/dwarf.h"
 #include "lldb/lldb-defines.h"
+#include "lldb/lldb-types.h"
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace lldb_private {
+class DataExtractor;
+}
 
 class DWARFUnit;
 
@@ -47,6 +56,18 @@ public:
                              const DIERef &die_ref)> const
               &callback) const;
 
+  /// Write the entries of this map to \a os, in host byte order, for the
+  /// index cache.
+  void Encode(llvm::raw_ostream &os) const;
+
+  /// Read entries written by Encode from \a data, starting at \a *offset_ptr,
+  /// and append them to this map. The map must be finalized afterwards.
+  ///
+  /// \return
+  ///     False if the data is truncated, in which case the map is left empty.
+  bool Decode(const lldb_private::DataExtractor &data,
+              lldb::offset_t *offset_ptr);
+
 protected:
   lldb_private::UniqueCStringMap<DIERef> m_map;
 };
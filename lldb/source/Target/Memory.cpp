@@ -224,22 +224,33 @@ size_t MemoryCache::Read(addr_t addr, void *dst, size_t dst_len,
 
       if (bytes_left > 0) {
         assert((curr_addr % cache_line_byte_size) == 0);
-        std::unique_ptr<DataBufferHeap> data_buffer_heap_up(
-            new DataBufferHeap(cache_line_byte_size, 0));
+        // Fetch all the consecutive missing lines this request spans with a
+        // single read, as each read is a round trip to a remote stub.
+        const addr_t end_addr = curr_addr + cache_offset + bytes_left;
+        addr_t fetch_end = curr_addr + cache_line_byte_size;
+        while (fetch_end < end_addr && !m_L2_cache.count(fetch_end) &&
+               !m_invalid_ranges.FindEntryThatContains(fetch_end))
+          fetch_end += cache_line_byte_size;
+
+        DataBufferHeap data_buffer(fetch_end - curr_addr, 0);
         size_t process_bytes_read = m_process.ReadMemoryFromInferior(
-            curr_addr, data_buffer_heap_up->GetBytes(),
-            data_buffer_heap_up->GetByteSize(), error);
+            curr_addr, data_buffer.GetBytes(), data_buffer.GetByteSize(),
+            error);
         if (process_bytes_read == 0)
           return dst_len - bytes_left;
 
-        if (process_bytes_read != cache_line_byte_size) {
-          if (process_bytes_read < data_buffer_heap_up->GetByteSize()) {
-            dst_len -= data_buffer_heap_up->GetByteSize() - process_bytes_read;
-            bytes_left = process_bytes_read;
-          }
-          data_buffer_heap_up->SetByteSize(process_bytes_read);
+        if (process_bytes_read < cache_line_byte_size) {
+          dst_len -= cache_line_byte_size - process_bytes_read;
+          bytes_left = process_bytes_read;
+        }
+        // Cache every line read, the last one possibly partial.
+        for (size_t line_offset = 0; line_offset < process_bytes_read;
+             line_offset += cache_line_byte_size) {
+          const size_t line_size = std::min<size_t>(
+              cache_line_byte_size, process_bytes_read - line_offset);
+          m_L2_cache[curr_addr + line_offset] = std::make_shared<DataBufferHeap>(
+              data_buffer.GetBytes() + line_offset, line_size);
         }
-        m_L2_cache[curr_addr] = DataBufferSP(data_buffer_heap_up.release());
         // We have read data and put it into the cache, continue through the
         // loop again to get the data out of the cache...
       }
@@ -13,6 +13,7 @@
 #include "llvm/DebugInfo/PDB/PDBSymbolExe.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 #include "Plugins/ObjectFile/PECOFF/ObjectFilePECOFF.h"
 #include "Plugins/SymbolFile/DWARF/DWARFAbbreviationDeclaration.h"
@@ -20,6 +21,7 @@
 #include "Plugins/SymbolFile/DWARF/DWARFDebugAbbrev.h"
 #include "Plugins/SymbolFile/DWARF/DWARFDebugArangeSet.h"
 #include "Plugins/SymbolFile/DWARF/DWARFDebugAranges.h"
+#include "Plugins/SymbolFile/DWARF/NameToDIE.h"
 #include "Plugins/SymbolFile/DWARF/SymbolFileDWARF.h"
 #include "Plugins/SymbolFile/PDB/SymbolFilePDB.h"
 #include "Plugins/TypeSystem/Clang/TypeSystemClang.h"
@@ -34,6 +36,8 @@
 #include "lldb/Symbol/LineTable.h"
 #include "lldb/Utility/ArchSpec.h"
 #include "lldb/Utility/DataEncoder.h"
+#include "lldb/Utility/DataExtractor.h"
+#include "lldb/Utility/Endian.h"
 #include "lldb/Utility/FileSpec.h"
 #include "lldb/Utility/StreamString.h"
 
@@ -385,3 +389,51 @@ TEST_F(SymbolFileDWARFTests, ParseAranges) {
   EXPECT_EQ(debug_aranges.FindAddress(0x2100 - 1), 255u);
   EXPECT_EQ(debug_aranges.FindAddress(0x2100), DW_INVALID_OFFSET);
 }
+
+TEST_F(SymbolFileDWARFTests, NameToDIEEncodeDecode) {
+  NameToDIE map;
+  map.Insert(ConstString("main"), DIERef(llvm::None, DIERef::DebugInfo, 0x10));
+  map.Insert(ConstString("foo"), DIERef(3, DIERef::DebugTypes, 0x20));
+  map.Insert(ConstString("main"), DIERef(llvm::None, DIERef::DebugInfo, 0x30));
+  map.Finalize();
+
+  std::string bytes;
+  llvm::raw_string_ostream os(bytes);
+  map.Encode(os);
+  os.flush();
+
+  DataExtractor data(bytes.data(), bytes.size(), endian::InlHostByteOrder(),
+                     sizeof(void *));
+  lldb::offset_t offset = 0;
+  NameToDIE decoded;
+  ASSERT_TRUE(decoded.Decode(data, &offset));
+  decoded.Finalize();
+  EXPECT_EQ(offset, bytes.size());
+
+  std::vector<dw_offset_t> offsets;
+  decoded.Find(ConstString("main"), [&](DIERef ref) {
+    EXPECT_EQ(ref.dwo_num(), llvm::None);
+    EXPECT_EQ(ref.section(), DIERef::DebugInfo);
+    offsets.push_back(ref.die_offset());
+    return true;
+  });
+  llvm::sort(offsets);
+  EXPECT_EQ(offsets, std::vector<dw_offset_t>({0x10, 0x30}));
+
+  unsigned foo_count = 0;
+  decoded.Find(ConstString("foo"), [&](DIERef ref) {
+    EXPECT_EQ(ref.dwo_num(), llvm::Optional<uint32_t>(3));
+    EXPECT_EQ(ref.section(), DIERef::DebugTypes);
+    EXPECT_EQ(ref.die_offset(), 0x20u);
+    ++foo_count;
+    return true;
+  });
+  EXPECT_EQ(foo_count, 1u);
+
+  // A truncated index is rejected.
+  DataExtractor truncated(bytes.data(), bytes.size() - 1,
+                          endian::InlHostByteOrder(), sizeof(void *));
+  offset = 0;
+  NameToDIE partial;
+  EXPECT_FALSE(partial.Decode(truncated, &offset));
+}
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+# ===-- corpus.py - Synthetic IR modules for compile-time measurements ---===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# ===----------------------------------------------------------------------===#
+"""Generate the default corpus of run.py.
+
+The modules are generated from a fixed seed, so every run measures the same
+input without keeping megabytes of IR in the repository. Each module stresses
+a different part of the pipeline:
+
+  loops   many functions with nested integer and floating-point loops, for
+          the loop passes, the vectorizers and instruction selection,
+  calls   a deep call graph of small internal functions, for the inliner and
+          the interprocedural passes,
+  cfg     functions with large switches and many merging values, for the
+          CFG simplification, GVN and the register allocator.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import random
+import sys
+
+
+class Function(object):
+    """Accumulate the instructions of a function with numbered values."""
+
+    def __init__(self):
+        self.lines = []
+        self.count = 0
+
+    def value(self):
+        self.count += 1
+        return '%%v%d' % self.count
+
+    def emit(self, line):
+        self.lines.append('  ' + line)
+
+    def label(self, name):
+        self.lines.append('%s:' % name)
+
+    def text(self):
+        return '\n'.join(self.lines)
+
+
+def int_expr(fn, rng, operands, steps):
+    """Emit steps random integer operations on operands, return the last."""
+    ops = ['add', 'sub', 'mul', 'xor', 'and', 'or', 'shl']
+    values = list(operands)
+    for _ in range(steps):
+        op = rng.choice(ops)
+        lhs = rng.choice(values)
+        rhs = rng.choice(values) if rng.random() < 0.6 else \
+            str(rng.randint(1, 31) if op == 'shl' else rng.randint(1, 1000))
+        v = fn.value()
+        fn.emit('%s = %s i32 %s, %s' % (v, op, lhs, rhs))
+        values.append(v)
+    return values[-1]
+
+
+def gen_loops(rng, num_functions):
+    funcs = []
+    for k in range(num_functions):
+        fn = Function()
+        fp = k % 2 == 1
+        ty = 'float' if fp else 'i32'
+        fn.lines.append('define void @loops_%d(%s* noalias %%a, %s* noalias '
+                        '%%b, i32 %%n, i32 %%m) {' % (k, ty, ty))
+        fn.label('entry')
+        fn.emit('%outer.guard = icmp sgt i32 %m, 0')
+        fn.emit('br i1 %outer.guard, label %outer, label %exit')
+        fn.label('outer')
+        fn.emit('%j = phi i32 [ 0, %entry ], [ %j.next, %outer.latch ]')
+        fn.emit('%row = mul i32 %j, %n')
+        fn.emit('%inner.guard = icmp sgt i32 %n, 0')
+        fn.emit('br i1 %inner.guard, label %inner, label %outer.latch')
+        fn.label('inner')
+        fn.emit('%i = phi i32 [ 0, %outer ], [ %i.next, %inner ]')
+        fn.emit('%idx = add i32 %row, %i')
+        fn.emit('%%pa = getelementptr inbounds %s, %s* %%a, i32 %%idx'
+                % (ty, ty))
+        fn.emit('%%pb = getelementptr inbounds %s, %s* %%b, i32 %%i'
+                % (ty, ty))
+        fn.emit('%%x = load %s, %s* %%pa' % (ty, ty))
+        fn.emit('%%y = load %s, %s* %%pb' % (ty, ty))
+        if fp:
+            values = ['%x', '%y']
+            for _ in range(rng.randint(4, 12)):
+                op = rng.choice(['fadd', 'fsub', 'fmul'])
+                v = fn.value()
+                fn.emit('%s = %s fast float %s, %s' %
+                        (v, op, rng.choice(values), rng.choice(values)))
+                values.append(v)
+            result = values[-1]
+        else:
+            result = int_expr(fn, rng, ['%x', '%y', '%i'],
+                              rng.randint(4, 12))
+        fn.emit('store %s %s, %s* %%pa' % (ty, result, ty))
+        fn.emit('%i.next = add nuw nsw i32 %i, 1')
+        fn.emit('%inner.done = icmp eq i32 %i.next, %n')
+        fn.emit('br i1 %inner.done, label %outer.latch, label %inner')
+        fn.label('outer.latch')
+        fn.emit('%j.next = add nuw nsw i32 %j, 1')
+        fn.emit('%outer.done = icmp eq i32 %j.next, %m')
+        fn.emit('br i1 %outer.done, label %exit, label %outer')
+        fn.label('exit')
+        fn.emit('ret void')
+        fn.lines.append('}')
+        funcs.append(fn.text())
+    return funcs
+
+
+def gen_calls(rng, num_functions):
+    funcs = []
+    for k in range(num_functions):
+        fn = Function()
+        linkage = '' if k == num_functions - 1 else 'internal '
+        fn.lines.append('define %si32 @calls_%d(i32 %%x, i32 %%y) {'
+                        % (linkage, k))
+        fn.label('entry')
+        values = ['%x', '%y']
+        v = int_expr(fn, rng, values, rng.randint(2, 8))
+        values.append(v)
+        # Call earlier functions only, the call graph is a DAG.
+        for _ in range(min(k, rng.randint(0, 3))):
+            callee = rng.randint(0, k - 1)
+            r = fn.value()
+            fn.emit('%s = call i32 @calls_%d(i32 %s, i32 %s)' %
+                    (r, callee, rng.choice(values), rng.choice(values)))
+            values.append(r)
+        fn.emit('ret i32 %s' % values[-1])
+        fn.lines.append('}')
+        funcs.append(fn.text())
+    return funcs
+
+
+def gen_cfg(rng, num_functions, num_cases):
+    funcs = []
+    for k in range(num_functions):
+        fn = Function()
+        fn.lines.append('define i32 @cfg_%d(i32 %%sel, i32 %%x, i32 %%y) {'
+                        % k)
+        fn.label('entry')
+        cases = ' '.join('i32 %d, label %%case%d' % (c, c)
+                         for c in range(num_cases))
+        fn.emit('switch i32 %%sel, label %%default [ %s ]' % cases)
+        # Some cases branch into the tail of the previous case, so that the
+        # tails merge values from several predecessors.
+        values, preds = [], [[] for _ in range(num_cases)]
+        for c in range(num_cases):
+            fn.label('case%d' % c)
+            values.append(int_expr(fn, rng, ['%x', '%y'], rng.randint(1, 6)))
+            tail = c - 1 if c > 0 and rng.random() < 0.3 else c
+            fn.emit('br label %%case%d.tail' % tail)
+            preds[tail].append(c)
+        fn.label('default')
+        fn.emit('br label %merge')
+        tails = []
+        for c in range(num_cases):
+            fn.label('case%d.tail' % c)
+            if preds[c]:
+                phi = fn.value()
+                fn.emit('%s = phi i32 %s' % (phi, ', '.join(
+                    '[ %s, %%case%d ]' % (values[p], p) for p in preds[c])))
+                tails.append('[ %s, %%case%d.tail ]' % (phi, c))
+            else:
+                fn.emit('unreachable')
+                continue
+            fn.emit('br label %merge')
+        fn.label('merge')
+        r = fn.value()
+        fn.emit('%s = phi i32 [ 0, %%default ], %s' % (r, ', '.join(tails)))
+        fn.emit('ret i32 %s' % r)
+        fn.lines.append('}')
+        funcs.append(fn.text())
+    return funcs
+
+
+MODULES = {
+    'loops': lambda rng, scale: gen_loops(rng, 400 * scale),
+    'calls': lambda rng, scale: gen_calls(rng, 2000 * scale),
+    'cfg': lambda rng, scale: gen_cfg(rng, 40 * scale, 120),
+}
+
+
+def generate(directory, scale=1, seed=0):
+    """Write the corpus into directory and return the paths of the modules."""
+    paths = []
+    for name in sorted(MODULES):
+        rng = random.Random('%s-%d' % (name, seed))
+        path = os.path.join(directory, name + '.ll')
+        with open(path, 'w') as f:
+            f.write('; ModuleID = \'%s\'\n\n' % name)
+            f.write('\n\n'.join(MODULES[name](rng, scale)))
+            f.write('\n')
+        paths.append(path)
+    return paths
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('directory')
+    parser.add_argument('--scale', type=int, default=1,
+                        help='multiply the number of functions')
+    parser.add_argument('--seed', type=int, default=0)
+    args = parser.parse_args()
+    for path in generate(args.directory, args.scale, args.seed):
+        print(path)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
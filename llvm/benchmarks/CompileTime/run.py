@@ -0,0 +1,295 @@
+#!/usr/bin/env python3
+# ===-- run.py - Per-pass compile time of opt and llc ---------------------===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# ===----------------------------------------------------------------------===#
+"""Measure the compile time of opt and llc per pass and compare two builds.
+
+The "run" command compiles every module of the corpus with each stage
+
+  opt-O2   opt -passes='default<O2>'
+  opt-O3   opt -passes='default<O3>'
+  llc      llc -O2 -filetype=obj on the output of opt-O2
+
+with -time-passes -track-memory and parses the timing report into the wall
+time, user time, system time and memory usage of every pass. Together with
+the total wall time and the peak resident set size of each process this is
+written as JSON:
+
+  run.py run --bindir build/bin -o new.json
+
+Without --corpus the modules generated by corpus.py are used, which are the
+same for every run. Each stage is repeated --repeat times and the median is
+reported to reduce the noise. The "compare" command prints the differences of
+two such results, e.g. of two builds, and fails if the total time or the
+peak memory of any stage, or the time of any pass worth at least --min-time
+seconds, grew by more than --threshold percent:
+
+  run.py compare old.json new.json --threshold 5
+"""
+
+from __future__ import print_function
+
+import argparse
+import datetime
+import json
+import os
+import re
+import shlex
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+import corpus
+
+STAGES = ('opt-O2', 'opt-O3', 'llc')
+
+COLUMNS = (
+    ('user', '---User Time---'),
+    ('sys', '--System Time--'),
+    ('user+sys', '--User+System--'),
+    ('wall', '---Wall Time---'),
+)
+TIME_RE = re.compile(r'\s*(\d+\.\d+)\s+\(\s*[\d.]+%\)')
+
+
+def parse_report(text):
+    """Parse the -time-passes report into {group: {pass: {column: value}}}."""
+    groups = {}
+    group, columns, has_mem = None, None, False
+    lines = text.splitlines()
+    for i, line in enumerate(lines):
+        if line.startswith('===-') and i + 2 < len(lines) and \
+                lines[i + 2].startswith('===-'):
+            group = lines[i + 1].strip()
+            groups.setdefault(group, {})
+            columns = None
+            continue
+        if group is None:
+            continue
+        if '--- Name ---' in line:
+            columns = [c for c, header in COLUMNS if header in line]
+            has_mem = '---Mem---' in line
+            continue
+        if columns is None or not line.strip():
+            continue
+        row, pos = {}, 0
+        for column in columns:
+            match = TIME_RE.match(line, pos)
+            if not match:
+                break
+            row[column] = float(match.group(1))
+            pos = match.end()
+        else:
+            rest = line[pos:].strip()
+            if has_mem:
+                mem, _, rest = rest.partition(' ')
+                row['mem'] = int(mem)
+                rest = rest.strip()
+            # Passes run several times are summed up.
+            entry = groups[group].setdefault(rest, {})
+            for column, value in row.items():
+                entry[column] = entry.get(column, 0) + value
+    return groups
+
+
+def run_stage(cmd, report):
+    """Run cmd and return its wall time, peak RSS in KiB and timing report."""
+    with tempfile.TemporaryFile() as err:
+        start = time.time()
+        proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=err)
+        # Wait with wait4 for the resource usage of this process alone.
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.time() - start
+        proc.returncode = status  # Reaped by wait4 already.
+        if status != 0:
+            err.seek(0)
+            raise RuntimeError('command failed: %s\n%s' % (
+                ' '.join(cmd), err.read().decode(errors='replace')))
+    with open(report) as f:
+        passes = parse_report(f.read())
+    # ru_maxrss is in KiB on Linux.
+    return wall, usage.ru_maxrss, passes
+
+
+def stage_commands(args, stage, module, tmpdir):
+    name = os.path.splitext(os.path.basename(module))[0]
+    report = os.path.join(tmpdir, '%s-%s.txt' % (name, stage))
+    timing = ['-time-passes', '-track-memory', '-info-output-file=' + report]
+    opt = os.path.join(args.bindir, 'opt')
+    llc = os.path.join(args.bindir, 'llc')
+    if stage == 'opt-O2':
+        return [opt, '-passes=default<O2>', '-o', os.devnull, module] + \
+            timing + shlex.split(args.opt_flags), report
+    if stage == 'opt-O3':
+        return [opt, '-passes=default<O3>', '-o', os.devnull, module] + \
+            timing + shlex.split(args.opt_flags), report
+    # llc compiles the optimized module like the clang driver would.
+    optimized = os.path.join(tmpdir, name + '.bc')
+    if not os.path.exists(optimized):
+        subprocess.check_call([opt, '-passes=default<O2>', '-o', optimized,
+                               module] + shlex.split(args.opt_flags))
+    cmd = [llc, '-O2', '-filetype=obj', '-o', os.devnull, optimized] + timing
+    if args.triple:
+        cmd.append('-mtriple=' + args.triple)
+    if args.mcpu:
+        cmd.append('-mcpu=' + args.mcpu)
+    return cmd + shlex.split(args.llc_flags), report
+
+
+def median(values):
+    values = sorted(values)
+    mid = len(values) // 2
+    if len(values) % 2:
+        return values[mid]
+    return (values[mid - 1] + values[mid]) / 2.0
+
+
+def measure(args, stage, module, tmpdir):
+    walls, rss, reports = [], [], []
+    for _ in range(args.repeat):
+        cmd, report = stage_commands(args, stage, module, tmpdir)
+        wall, maxrss, passes = run_stage(cmd, report)
+        walls.append(wall)
+        rss.append(maxrss)
+        reports.append(passes)
+    merged = {}
+    for group in reports[0]:
+        merged[group] = {}
+        for name in reports[0][group]:
+            merged[group][name] = dict(
+                (column, median([r[group].get(name, {}).get(column, 0)
+                                 for r in reports]))
+                for column in reports[0][group][name])
+    return {'wall': median(walls), 'max_rss_kib': max(rss), 'passes': merged}
+
+
+def command_run(args):
+    tmpdir = tempfile.mkdtemp()
+    try:
+        modules = args.corpus or corpus.generate(tmpdir, args.scale)
+        stages = args.stage or STAGES
+        results = {}
+        print('%-28s %10s %12s' % ('benchmark', 'wall (s)', 'max rss (KiB)'))
+        for module in modules:
+            name = os.path.splitext(os.path.basename(module))[0]
+            for stage in stages:
+                result = measure(args, stage, module, tmpdir)
+                key = '%s/%s' % (name, stage)
+                print('%-28s %10.3f %12d' % (key, result['wall'],
+                                             result['max_rss_kib']))
+                results[key] = result
+    finally:
+        shutil.rmtree(tmpdir)
+
+    output = {
+        'context': {
+            'date': datetime.datetime.now().isoformat(),
+            'host_name': socket.gethostname(),
+            'bindir': os.path.abspath(args.bindir),
+            'repeat': args.repeat,
+            'scale': args.scale,
+        },
+        'benchmarks': results,
+    }
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(output, f, indent=2, sort_keys=True)
+    return 0
+
+
+def change(old, new):
+    return 100.0 * (new - old) / old if old else 0.0
+
+
+def command_compare(args):
+    with open(args.base) as f:
+        base = json.load(f)['benchmarks']
+    with open(args.new) as f:
+        new = json.load(f)['benchmarks']
+
+    regressions = 0
+    print('%-28s %10s %10s %8s' % ('benchmark', 'base', 'new', 'change'))
+    for key in sorted(set(base) & set(new)):
+        old, cur = base[key], new[key]
+        for metric in ('wall', 'max_rss_kib'):
+            diff = change(old[metric], cur[metric])
+            flag = ''
+            if diff > args.threshold:
+                flag = '  <-- regression'
+                regressions += 1
+            print('%-28s %10g %10g %+7.1f%%%s' %
+                  ('%s %s' % (key, metric), old[metric], cur[metric], diff,
+                   flag))
+        # The passes which changed most, above the noise level.
+        rows = []
+        for group, passes in cur['passes'].items():
+            for name, times in passes.items():
+                ref = old['passes'].get(group, {}).get(name)
+                if not ref or name == 'Total':
+                    continue
+                before, after = ref.get('wall', 0), times.get('wall', 0)
+                if max(before, after) < args.min_time:
+                    continue
+                rows.append((change(before, after), name, before, after))
+        rows.sort(reverse=True)
+        for diff, name, before, after in rows[:args.top]:
+            flag = ''
+            if diff > args.threshold:
+                flag = '  <-- regression'
+                regressions += 1
+            print('  %-26s %10.4f %10.4f %+7.1f%%%s' %
+                  (name[:26], before, after, diff, flag))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command')
+    sub.required = True
+
+    run = sub.add_parser('run', help='measure one build')
+    run.add_argument('--bindir', required=True,
+                     help='directory containing opt and llc')
+    run.add_argument('--corpus', nargs='+',
+                     help='IR modules to compile instead of the generated '
+                          'ones')
+    run.add_argument('--scale', type=int, default=1,
+                     help='size of the generated corpus')
+    run.add_argument('--stage', action='append', choices=STAGES,
+                     help='only run this stage (repeatable)')
+    run.add_argument('--repeat', type=int, default=3)
+    run.add_argument('--triple', help='target triple of llc')
+    run.add_argument('--mcpu', help='target CPU of llc')
+    run.add_argument('--opt-flags', default='',
+                     help='additional flags for opt')
+    run.add_argument('--llc-flags', default='',
+                     help='additional flags for llc')
+    run.add_argument('-o', '--output', help='write the JSON results here')
+    run.set_defaults(func=command_run)
+
+    cmp = sub.add_parser('compare', help='compare two results')
+    cmp.add_argument('base')
+    cmp.add_argument('new')
+    cmp.add_argument('--threshold', type=float, default=5.0,
+                     help='allowed growth in percent')
+    cmp.add_argument('--min-time', type=float, default=0.05,
+                     help='ignore passes faster than this (seconds)')
+    cmp.add_argument('--top', type=int, default=10,
+                     help='number of passes shown per benchmark')
+    cmp.set_defaults(func=command_compare)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,24 @@
+//===-- conv2d.c - 3x3 convolution kernel ---------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+// Valid 3x3 convolution of an H x W image, the output is (H-2) x (W-2).
+void bench_conv2d(const elem_t *restrict In, const elem_t *restrict Filter,
+                  elem_t *restrict Out) {
+  for (int Y = 0; Y < CONV_H - 2; ++Y)
+#pragma omp simd
+    for (int X = 0; X < CONV_W - 2; ++X) {
+      acc_t Sum = 0;
+      for (int KY = 0; KY < 3; ++KY)
+        for (int KX = 0; KX < 3; ++KX)
+          Sum += (acc_t)In[(Y + KY) * CONV_W + X + KX] *
+                 (acc_t)Filter[KY * 3 + KX];
+      Out[Y * (CONV_W - 2) + X] = (elem_t)Sum;
+    }
+}
@@ -0,0 +1,17 @@
+//===-- dot.c - Dot product kernel ----------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+acc_t bench_dot(const elem_t *restrict A, const elem_t *restrict B) {
+  acc_t Sum = 0;
+#pragma omp simd reduction(+ : Sum)
+  for (int I = 0; I < DOT_N; ++I)
+    Sum += (acc_t)A[I] * (acc_t)B[I];
+  return Sum;
+}
@@ -0,0 +1,26 @@
+//===-- fft.c - Radix-2 FFT butterfly kernel ------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+// The butterflies of one decimation-in-frequency stage on split real and
+// imaginary parts. The twiddle factors of the stage are precomputed.
+void bench_fft(elem_t *restrict Re, elem_t *restrict Im,
+               const elem_t *restrict TwRe, const elem_t *restrict TwIm) {
+  const int Half = FFT_N / 2;
+#pragma omp simd
+  for (int K = 0; K < Half; ++K) {
+    acc_t ARe = Re[K], AIm = Im[K];
+    acc_t BRe = Re[K + Half], BIm = Im[K + Half];
+    acc_t DRe = ARe - BRe, DIm = AIm - BIm;
+    Re[K] = (elem_t)(ARe + BRe);
+    Im[K] = (elem_t)(AIm + BIm);
+    Re[K + Half] = (elem_t)(DRe * TwRe[K] - DIm * TwIm[K]);
+    Im[K + Half] = (elem_t)(DRe * TwIm[K] + DIm * TwRe[K]);
+  }
+}
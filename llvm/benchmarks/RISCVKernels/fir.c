@@ -0,0 +1,21 @@
+//===-- fir.c - Finite impulse response filter kernel ---------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+// Y[I] = sum of H[T] * X[I + T], X holds N + TAPS - 1 samples.
+void bench_fir(const elem_t *restrict X, const elem_t *restrict H,
+               elem_t *restrict Y) {
+  for (int I = 0; I < FIR_N; ++I) {
+    acc_t Sum = 0;
+#pragma omp simd reduction(+ : Sum)
+    for (int T = 0; T < FIR_TAPS; ++T)
+      Sum += (acc_t)H[T] * (acc_t)X[I + T];
+    Y[I] = (elem_t)Sum;
+  }
+}
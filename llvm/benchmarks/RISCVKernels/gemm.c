@@ -0,0 +1,22 @@
+//===-- gemm.c - Matrix multiplication kernel -----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+// C = A * B with row-major A (M x K), B (K x N) and C (M x N).
+void bench_gemm(const elem_t *restrict A, const elem_t *restrict B,
+                elem_t *restrict C) {
+  for (int I = 0; I < GEMM_M; ++I)
+    for (int J = 0; J < GEMM_N; ++J) {
+      acc_t Sum = 0;
+#pragma omp simd reduction(+ : Sum)
+      for (int L = 0; L < GEMM_K; ++L)
+        Sum += (acc_t)A[I * GEMM_K + L] * (acc_t)B[L * GEMM_N + J];
+      C[I * GEMM_N + J] = (elem_t)Sum;
+    }
+}
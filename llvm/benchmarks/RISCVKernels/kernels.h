@@ -0,0 +1,43 @@
+//===-- kernels.h - Common definitions of the RISC-V kernels ------*- C -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// The kernels are compiled once per configuration of run.py. The element
+// type and the accumulator type are chosen by the configuration, e.g. int16_t
+// with int32_t accumulators for the PULP SIMD extension or _Float16 for the
+// smallfloat extensions of Snitch.
+
+#ifndef RISCV_KERNELS_H
+#define RISCV_KERNELS_H
+
+#include <stdint.h>
+
+#ifndef BENCH_T
+#define BENCH_T float
+#endif
+
+#ifndef BENCH_ACC_T
+#define BENCH_ACC_T BENCH_T
+#endif
+
+typedef BENCH_T elem_t;
+typedef BENCH_ACC_T acc_t;
+
+// Problem sizes, all data of a kernel fits into the L1 memory of a cluster.
+#define DOT_N 256
+#define GEMM_M 16
+#define GEMM_N 16
+#define GEMM_K 16
+#define CONV_H 18
+#define CONV_W 18
+#define FIR_N 128
+#define FIR_TAPS 16
+#define FFT_N 64
+#define STENCIL_H 18
+#define STENCIL_W 18
+
+#endif // RISCV_KERNELS_H
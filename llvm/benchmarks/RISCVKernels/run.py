@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+# ===-- run.py - Static and simulated cost of the RISC-V kernels ---------===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# ===----------------------------------------------------------------------===#
+"""Compile the RISC-V kernels for every configuration and report their cost.
+
+Every kernel in this directory is compiled by clang for each configuration,
+a CPU together with the element type of the kernel, so that the PULP hardware
+loops and SIMD instructions, the Snitch SSR and FREP extensions as well as the
+smallfloat formats are all exercised. For every compiled kernel the script
+reports
+
+  insts       the static number of instructions of the kernel,
+  loop_insts  the static number of instructions of its innermost loop, which
+              is the body of an frep, of a hardware loop or the instructions
+              between a backward branch and its target, and
+  cycles      the cycles per iteration of the innermost loop as estimated by
+              llvm-mca, or, with --sim, the cycles reported by an instruction
+              set simulator running the kernel.
+
+The results are written in the JSON format of Google Benchmark (with the
+cycles as time in ns), so that the usual tooling can compare two runs. With
+--baseline the script compares against an earlier result itself and fails if
+any metric grew by more than --threshold percent, which is meant for CI:
+
+  run.py --clang bin/clang --llvm-mca bin/llvm-mca -o new.json \\
+         --baseline old.json
+
+The simulator is given as a command template, where {obj} is replaced by the
+object file of the kernel, {kernel} by its name and {config} by the name of
+the configuration. Linking the kernel with a runtime and a driver calling it
+is up to the command, which has to print the cycle count matching --sim-regex.
+"""
+
+from __future__ import print_function
+
+import argparse
+import datetime
+import json
+import os
+import re
+import shlex
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+
+
+class Config(object):
+    def __init__(self, name, cpu, elem, acc=None, march=None, mattr=None):
+        self.name = name
+        self.cpu = cpu
+        self.elem = elem
+        self.acc = acc or elem
+        self.march = march
+        self.mattr = mattr
+
+
+CONFIGS = [
+    Config('rv32-fp32', 'rocket-rv32', 'float', march='rv32imfc',
+           mattr='+m,+f,+c'),
+    Config('pulp-int8', 'ri5cy', 'int8_t', acc='int32_t'),
+    Config('pulp-int16', 'ri5cy', 'int16_t', acc='int32_t'),
+    Config('pulp-fp32', 'ri5cy', 'float'),
+    Config('snitch-fp64', 'snitch', 'double'),
+    Config('snitch-fp16', 'snitch', '_Float16', acc='float'),
+]
+
+TRIPLE = 'riscv32-unknown-elf'
+SRC_DIR = os.path.dirname(os.path.abspath(__file__))
+
+
+def list_kernels():
+    return sorted(os.path.splitext(f)[0] for f in os.listdir(SRC_DIR)
+                  if f.endswith('.c'))
+
+
+def clang_args(args, config, kernel, output, mode):
+    cmd = [args.clang, '-target', TRIPLE, '-mcpu=' + config.cpu, '-O3',
+           '-fopenmp-simd', '-ffreestanding', mode, '-o', output,
+           '-DBENCH_T=' + config.elem, '-DBENCH_ACC_T=' + config.acc]
+    if config.march:
+        cmd.append('-march=' + config.march)
+    cmd += shlex.split(args.cflags)
+    cmd.append(os.path.join(SRC_DIR, kernel + '.c'))
+    return cmd
+
+
+def run(cmd):
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+                            stderr=subprocess.PIPE, universal_newlines=True)
+    out, err = proc.communicate()
+    if proc.returncode != 0:
+        raise RuntimeError('command failed: %s\n%s' % (' '.join(cmd), err))
+    return out
+
+
+LABEL_RE = re.compile(r'^([.\w$]+):')
+
+
+def parse_function(asm, name):
+    """Return the body of function name as a list of ('label', name) and
+    ('inst', mnemonic, operands, text) entries."""
+    body = []
+    inside = False
+    for line in asm.splitlines():
+        line = line.split('#', 1)[0].rstrip()
+        label = LABEL_RE.match(line)
+        if label:
+            if label.group(1) == name:
+                inside = True
+            elif inside and label.group(1).startswith('.Lfunc_end'):
+                break
+            elif inside:
+                body.append(('label', label.group(1)))
+            continue
+        text = line.strip()
+        if not inside or not text or text.startswith('.'):
+            continue
+        parts = text.split(None, 1)
+        operands = [o.strip() for o in parts[1].split(',')] \
+            if len(parts) > 1 else []
+        body.append(('inst', parts[0], operands, text))
+    return body
+
+
+def innermost_loop(body):
+    """Return the kind and the entries of the smallest loop in body."""
+    labels = dict((e[1], i) for i, e in enumerate(body) if e[0] == 'label')
+    loops = []
+    for i, e in enumerate(body):
+        if e[0] != 'inst' or not e[2]:
+            continue
+        mnemonic, operands = e[1], e[2]
+        if mnemonic in ('frep.o', 'frep.i'):
+            # The immediate is the number of repeated instructions.
+            count = int(operands[1], 0)
+            region, j = [], i + 1
+            while j < len(body) and len(region) < count:
+                if body[j][0] == 'inst':
+                    region.append(body[j])
+                j += 1
+            loops.append(('frep', region))
+        elif mnemonic in ('lp.setup', 'lp.setupi') and \
+                operands[-1] in labels and labels[operands[-1]] > i:
+            # The end label follows the last instruction of the body.
+            loops.append(('hwloop', body[i + 1:labels[operands[-1]]]))
+        elif mnemonic == 'lp.starti' and operands[-1] in labels:
+            level = operands[0]
+            for f in body[i + 1:]:
+                if f[0] == 'inst' and f[1] == 'lp.endi' and \
+                        f[2][0] == level and f[2][-1] in labels:
+                    start, end = labels[operands[-1]], labels[f[2][-1]]
+                    loops.append(('hwloop', body[start:end]))
+                    break
+        elif (mnemonic.startswith('b') or mnemonic == 'j') and \
+                operands[-1] in labels and labels[operands[-1]] < i:
+            loops.append(('branch', body[labels[operands[-1]]:i + 1]))
+
+    def size(loop):
+        return sum(1 for e in loop[1] if e[0] == 'inst')
+    loops = [l for l in loops if size(l) > 0]
+    if not loops:
+        return 'function', body
+    return min(loops, key=size)
+
+
+def mca_cycles(args, config, entries, iterations):
+    with tempfile.NamedTemporaryFile('w', suffix='.s', delete=False) as f:
+        for e in entries:
+            f.write('%s:\n' % e[1] if e[0] == 'label' else '\t%s\n' % e[3])
+        name = f.name
+    try:
+        cmd = [args.llvm_mca, '-mtriple=' + TRIPLE, '-mcpu=' + config.cpu,
+               '-iterations=%d' % iterations, name]
+        if config.mattr:
+            cmd.append('-mattr=' + config.mattr)
+        out = run(cmd)
+    finally:
+        os.unlink(name)
+    total = re.search(r'Total Cycles:\s*(\d+)', out)
+    if not total:
+        raise RuntimeError('no cycle count in llvm-mca output:\n' + out)
+    return float(total.group(1)) / iterations
+
+
+def sim_cycles(args, config, kernel, tmpdir):
+    obj = os.path.join(tmpdir, '%s-%s.o' % (kernel, config.name))
+    run(clang_args(args, config, kernel, obj, '-c'))
+    cmd = args.sim.format(obj=obj, kernel=kernel, config=config.name)
+    out = run(shlex.split(cmd))
+    match = re.search(args.sim_regex, out)
+    if not match:
+        raise RuntimeError('no cycle count in simulator output:\n' + out)
+    return float(match.group(1))
+
+
+def measure(args, config, kernel, tmpdir):
+    asm = run(clang_args(args, config, kernel, '-', '-S'))
+    body = parse_function(asm, 'bench_' + kernel)
+    insts = sum(1 for e in body if e[0] == 'inst')
+    kind, loop = innermost_loop(body)
+    loop_insts = sum(1 for e in loop if e[0] == 'inst')
+    if args.sim:
+        cycles, source = sim_cycles(args, config, kernel, tmpdir), 'sim'
+    else:
+        # Straight-line code is only executed once.
+        iterations = 1 if kind == 'function' else args.mca_iterations
+        cycles = mca_cycles(args, config, loop, iterations)
+        source = 'llvm-mca'
+    name = '%s/%s' % (kernel, config.name)
+    return {
+        'name': name, 'run_name': name, 'run_type': 'iteration',
+        'repetitions': 1, 'repetition_index': 0, 'threads': 1,
+        'iterations': 1, 'real_time': cycles, 'cpu_time': cycles,
+        'time_unit': 'ns', 'insts': insts, 'loop_insts': loop_insts,
+        'cycles': cycles, 'loop': kind, 'cycle_source': source,
+    }
+
+
+METRICS = ('insts', 'loop_insts', 'cycles')
+
+
+def compare(results, baseline, threshold):
+    """Print the metrics which grew by more than threshold percent and return
+    their number."""
+    old = dict((b['name'], b) for b in baseline['benchmarks'])
+    regressions = 0
+    for new in results:
+        ref = old.get(new['name'])
+        if not ref:
+            continue
+        for metric in METRICS:
+            if metric not in ref or not ref[metric]:
+                continue
+            change = 100.0 * (new[metric] - ref[metric]) / ref[metric]
+            if change > threshold:
+                print('regression: %s %s %g -> %g (%+.1f%%)' %
+                      (new['name'], metric, ref[metric], new[metric], change))
+                regressions += 1
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--clang', default='clang')
+    parser.add_argument('--llvm-mca', default='llvm-mca')
+    parser.add_argument('--cflags', default='',
+                        help='additional flags for clang, e.g. '
+                             '"-mllvm -snitch-ssr-inference"')
+    parser.add_argument('--config', action='append',
+                        choices=[c.name for c in CONFIGS],
+                        help='only run this configuration (repeatable)')
+    parser.add_argument('--kernel', action='append', choices=list_kernels(),
+                        help='only run this kernel (repeatable)')
+    parser.add_argument('--mca-iterations', type=int, default=100)
+    parser.add_argument('--sim', help='simulator command template')
+    parser.add_argument('--sim-regex', default=r'cycles\W*(\d+)',
+                        help='regex extracting the cycles from the simulator '
+                             'output')
+    parser.add_argument('-o', '--output', help='write the JSON results here')
+    parser.add_argument('--baseline', help='JSON results to compare against')
+    parser.add_argument('--threshold', type=float, default=1.0,
+                        help='allowed growth of a metric in percent')
+    args = parser.parse_args()
+
+    configs = [c for c in CONFIGS if not args.config or c.name in args.config]
+    kernels = args.kernel or list_kernels()
+
+    results = []
+    tmpdir = tempfile.mkdtemp()
+    print('%-24s %8s %10s %10s  %s' % ('benchmark', 'insts', 'loop_insts',
+                                       'cycles', 'loop'))
+    try:
+        for config in configs:
+            for kernel in kernels:
+                result = measure(args, config, kernel, tmpdir)
+                print('%-24s %8d %10d %10.2f  %s' %
+                      (result['name'], result['insts'], result['loop_insts'],
+                       result['cycles'], result['loop']))
+                results.append(result)
+    finally:
+        shutil.rmtree(tmpdir)
+
+    if args.output:
+        context = {
+            'date': datetime.datetime.now().isoformat(),
+            'host_name': socket.gethostname(),
+            'executable': 'riscv-kernels',
+            'num_cpus': 1, 'mhz_per_cpu': 0, 'cpu_scaling_enabled': False,
+            'caches': [], 'library_build_type': 'release',
+        }
+        with open(args.output, 'w') as f:
+            json.dump({'context': context, 'benchmarks': results}, f,
+                      indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            if compare(results, json.load(f), args.threshold):
+                return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,23 @@
+//===-- stencil.c - Five-point Jacobi stencil kernel ----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernels.h"
+
+// One Jacobi sweep over the interior of an H x W grid.
+void bench_stencil(const elem_t *restrict In, elem_t *restrict Out,
+                   elem_t Center, elem_t Neighbour) {
+  for (int Y = 1; Y < STENCIL_H - 1; ++Y)
+#pragma omp simd
+    for (int X = 1; X < STENCIL_W - 1; ++X) {
+      const elem_t *P = &In[Y * STENCIL_W + X];
+      acc_t Sum = (acc_t)P[-STENCIL_W] + (acc_t)P[STENCIL_W] +
+                  (acc_t)P[-1] + (acc_t)P[1];
+      Out[Y * STENCIL_W + X] =
+          (elem_t)((acc_t)Center * (acc_t)P[0] + (acc_t)Neighbour * Sum);
+    }
+}
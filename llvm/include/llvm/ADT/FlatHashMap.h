@@ -0,0 +1,643 @@
+//===- llvm/ADT/FlatHashMap.h - Group probed hash table ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatHashMap class, an open addressing hash table with
+// the interface of DenseMap.
+//
+// Next to the buckets, the table keeps one control byte per bucket, holding
+// either the low 7 bits of the hash of the key in the bucket, or a marker for
+// an empty or a deleted bucket. A lookup compares the control bytes of a
+// group of consecutive buckets with the hash at once, with SSE2 where it is
+// available and with 64-bit integer arithmetic otherwise, and only compares
+// the keys of the buckets that match. Probing moves on to the next group
+// until it finds a group with an empty bucket.
+//
+// Unlike DenseMap, no key values are reserved: the KeyInfoT only needs to
+// provide getHashValue() and isEqual(). Iterators are invalidated by every
+// insertion and erasure, and the iteration order is unspecified.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATHASHMAP_H
+#define LLVM_ADT_FLATHASHMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include "llvm/Support/SwapByteOrder.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_FLATHASHMAP_SSE2 1
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// Control byte values. A full bucket holds the low 7 bits of its hash.
+enum FlatHashCtrl : int8_t { FlatHashEmpty = -128, FlatHashDeleted = -2 };
+
+/// The set of buckets of a group that matched, as a bit mask with a bit per
+/// bucket every 1 << Shift bits.
+template <typename T, unsigned Shift> class FlatHashBitMask {
+  T Mask;
+
+public:
+  explicit FlatHashBitMask(T Mask) : Mask(Mask) {}
+
+  explicit operator bool() const { return Mask != 0; }
+  unsigned lowest() const { return countTrailingZeros(Mask) >> Shift; }
+  void clearLowest() { Mask &= Mask - 1; }
+
+  /// The number of buckets before the first and after the last match.
+  unsigned leadingUnmatched(unsigned Width) const {
+    return Mask ? countTrailingZeros(Mask) >> Shift : Width;
+  }
+  unsigned trailingUnmatched(unsigned Width) const {
+    return Mask ? (countLeadingZeros(Mask) >> Shift) -
+                      ((sizeof(T) * 8 >> Shift) - Width)
+                : Width;
+  }
+};
+
+#ifdef LLVM_FLATHASHMAP_SSE2
+/// The control bytes of 16 consecutive buckets.
+struct FlatHashGroup {
+  static constexpr unsigned Width = 16;
+  using BitMask = FlatHashBitMask<uint32_t, 0>;
+
+  __m128i Ctrl;
+
+  explicit FlatHashGroup(const int8_t *Pos)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+  BitMask match(int8_t H2) const {
+    return BitMask(static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Ctrl))));
+  }
+
+  BitMask matchEmpty() const { return match(FlatHashEmpty); }
+
+  BitMask matchEmptyOrDeleted() const {
+    // Only the markers are negative.
+    return BitMask(static_cast<uint32_t>(_mm_movemask_epi8(Ctrl)));
+  }
+};
+#else
+/// The control bytes of 8 consecutive buckets, in a 64-bit integer.
+struct FlatHashGroup {
+  static constexpr unsigned Width = 8;
+  using BitMask = FlatHashBitMask<uint64_t, 3>;
+
+  static constexpr uint64_t LSBs = 0x0101010101010101ULL;
+  static constexpr uint64_t MSBs = 0x8080808080808080ULL;
+
+  uint64_t Ctrl;
+
+  explicit FlatHashGroup(const int8_t *Pos) {
+    std::memcpy(&Ctrl, Pos, sizeof(Ctrl));
+    if (sys::IsBigEndianHost)
+      Ctrl = ByteSwap_64(Ctrl);
+  }
+
+  BitMask match(int8_t H2) const {
+    // May report a full bucket right after a match as matching as well, which
+    // only costs a key comparison.
+    uint64_t X = Ctrl ^ (LSBs * static_cast<uint8_t>(H2));
+    return BitMask((X - LSBs) & ~X & MSBs);
+  }
+
+  BitMask matchEmpty() const {
+    // Bits 7 and 1 are both set in deleted buckets only.
+    return BitMask(Ctrl & ~(Ctrl << 6) & MSBs);
+  }
+
+  BitMask matchEmptyOrDeleted() const { return BitMask(Ctrl & MSBs); }
+};
+#endif
+
+template <typename KeyT, typename ValueT, typename BucketT, bool IsConst>
+class FlatHashMapIterator;
+
+} // end namespace detail
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = detail::DenseMapPair<KeyT, ValueT>>
+class FlatHashMap : public DebugEpochBase {
+  using Group = detail::FlatHashGroup;
+
+  template <typename T>
+  using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+  BucketT *Buckets = nullptr;
+  int8_t *Ctrl = nullptr;
+  unsigned NumBuckets = 0;
+  unsigned NumEntries = 0;
+  /// The number of empty buckets that can still be filled before the table
+  /// has to be rehashed.
+  unsigned GrowthLeft = 0;
+
+public:
+  using size_type = unsigned;
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = BucketT;
+
+  using iterator = detail::FlatHashMapIterator<KeyT, ValueT, BucketT, false>;
+  using const_iterator =
+      detail::FlatHashMapIterator<KeyT, ValueT, BucketT, true>;
+
+  explicit FlatHashMap(unsigned InitialReserve = 0) {
+    if (InitialReserve)
+      reserve(InitialReserve);
+  }
+
+  FlatHashMap(const FlatHashMap &Other) : DebugEpochBase() {
+    reserve(Other.size());
+    for (const BucketT &B : Other)
+      insert(B);
+  }
+
+  FlatHashMap(FlatHashMap &&Other) : DebugEpochBase() { swap(Other); }
+
+  template <typename InputIt> FlatHashMap(const InputIt &I, const InputIt &E) {
+    insert(I, E);
+  }
+
+  FlatHashMap(std::initializer_list<std::pair<KeyT, ValueT>> Vals) {
+    reserve(Vals.size());
+    insert(Vals.begin(), Vals.end());
+  }
+
+  ~FlatHashMap() {
+    destroyAll();
+    deallocateBuckets();
+  }
+
+  FlatHashMap &operator=(const FlatHashMap &Other) {
+    if (&Other != this) {
+      FlatHashMap Copy(Other);
+      swap(Copy);
+    }
+    return *this;
+  }
+
+  FlatHashMap &operator=(FlatHashMap &&Other) {
+    destroyAll();
+    deallocateBuckets();
+    Buckets = nullptr;
+    Ctrl = nullptr;
+    NumBuckets = NumEntries = GrowthLeft = 0;
+    swap(Other);
+    return *this;
+  }
+
+  void swap(FlatHashMap &RHS) {
+    incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(GrowthLeft, RHS.GrowthLeft);
+  }
+
+  iterator begin() { return makeIterator(0); }
+  iterator end() { return makeIterator(NumBuckets); }
+  const_iterator begin() const { return makeConstIterator(0); }
+  const_iterator end() const { return makeConstIterator(NumBuckets); }
+
+  LLVM_NODISCARD bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the table so that \p NumEntries elements fit without rehashing.
+  void reserve(size_type NumEntries) {
+    if (NumEntries > maxLoad(NumBuckets))
+      rehash(bucketsForEntries(NumEntries));
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && GrowthLeft == maxLoad(NumBuckets))
+      return;
+    destroyAll();
+    resetCtrl();
+    NumEntries = 0;
+    GrowthLeft = maxLoad(NumBuckets);
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const_arg_type_t<KeyT> Val) const {
+    return findIndex(Val) != NumBuckets ? 1 : 0;
+  }
+
+  iterator find(const_arg_type_t<KeyT> Val) {
+    return makeIterator(findIndex(Val));
+  }
+  const_iterator find(const_arg_type_t<KeyT> Val) const {
+    return makeConstIterator(findIndex(Val));
+  }
+
+  /// Alternate version of find() which allows a different, and possibly less
+  /// expensive, key type. The KeyInfoT must provide getHashValue() and
+  /// isEqual() for the LookupKeyT type, hashing equal keys the same.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    return makeIterator(findIndex(Val));
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    return makeConstIterator(findIndex(Val));
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const_arg_type_t<KeyT> Val) const {
+    unsigned Index = findIndex(Val);
+    if (Index != NumBuckets)
+      return Buckets[Index].getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    std::pair<unsigned, bool> Res = findOrPrepareInsert(Key);
+    if (Res.second)
+      construct(Res.first, std::move(Key), std::forward<Ts>(Args)...);
+    return {makeIterator(Res.first), Res.second};
+  }
+
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    std::pair<unsigned, bool> Res = findOrPrepareInsert(Key);
+    if (Res.second)
+      construct(Res.first, Key, std::forward<Ts>(Args)...);
+    return {makeIterator(Res.first), Res.second};
+  }
+
+  /// insert - Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    unsigned Index = findIndex(Val);
+    if (Index == NumBuckets)
+      return false;
+    eraseIndex(Index);
+    return true;
+  }
+
+  void erase(iterator I) { eraseIndex(I.Ptr - Buckets); }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    return *try_emplace(Key).first;
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    return *try_emplace(std::move(Key)).first;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by FlatHashMap.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const { return allocationSize(NumBuckets); }
+
+private:
+  static bool isFull(int8_t C) { return C >= 0; }
+
+  /// Mix the hash of the key, KeyInfoT hashes are often weak in the low bits.
+  template <typename LookupKeyT> static uint64_t getHash(const LookupKeyT &K) {
+    uint64_t H = KeyInfoT::getHashValue(K);
+    H ^= H >> 33;
+    H *= 0xff51afd7ed558ccdULL;
+    H ^= H >> 33;
+    return H;
+  }
+  static int8_t getH2(uint64_t Hash) { return Hash & 0x7f; }
+  static unsigned getH1(uint64_t Hash) { return Hash >> 7; }
+
+  /// The table is kept at most 7/8 full, so that probing stops early.
+  static unsigned maxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  static unsigned bucketsForEntries(unsigned NumEntries) {
+    unsigned Min = NumEntries + NumEntries / 7 + 1;
+    return std::max<unsigned>(Group::Width, NextPowerOf2(Min - 1));
+  }
+
+  /// The buckets, followed by a control byte per bucket and a copy of the
+  /// first group of control bytes, so that a group can be loaded at every
+  /// bucket.
+  static size_t allocationSize(unsigned NumBuckets) {
+    if (NumBuckets == 0)
+      return 0;
+    return sizeof(BucketT) * NumBuckets + NumBuckets + Group::Width;
+  }
+
+  void setCtrl(unsigned Index, int8_t C) {
+    Ctrl[Index] = C;
+    if (Index < Group::Width)
+      Ctrl[NumBuckets + Index] = C;
+  }
+
+  void resetCtrl() {
+    std::memset(Ctrl, detail::FlatHashEmpty, NumBuckets + Group::Width);
+  }
+
+  /// Visits the groups of the probe sequence of \p Hash. Stepping a growing
+  /// number of groups visits every group of a power-of-two table once.
+  template <typename CallbackT>
+  unsigned probe(uint64_t Hash, CallbackT Callback) const {
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = getH1(Hash) & Mask;
+    for (unsigned Step = Group::Width;; Step += Group::Width) {
+      unsigned Index = Callback(Pos, Group(Ctrl + Pos));
+      if (Index != ~0U)
+        return Index;
+      Pos = (Pos + Step) & Mask;
+    }
+  }
+
+  /// Returns the index of the bucket holding \p Val, or NumBuckets.
+  template <typename LookupKeyT>
+  unsigned findIndex(const LookupKeyT &Val) const {
+    if (NumBuckets == 0)
+      return 0;
+    uint64_t Hash = getHash(Val);
+    int8_t H2 = getH2(Hash);
+    unsigned Mask = NumBuckets - 1;
+    return probe(Hash, [&](unsigned Pos, const Group &G) {
+      for (auto M = G.match(H2); M; M.clearLowest()) {
+        unsigned Index = (Pos + M.lowest()) & Mask;
+        if (KeyInfoT::isEqual(Val, Buckets[Index].getFirst()))
+          return Index;
+      }
+      return G.matchEmpty() ? NumBuckets : ~0U;
+    });
+  }
+
+  /// Returns the first empty or deleted bucket of the probe sequence.
+  unsigned findFreeIndex(uint64_t Hash) const {
+    unsigned Mask = NumBuckets - 1;
+    return probe(Hash, [&](unsigned Pos, const Group &G) {
+      if (auto M = G.matchEmptyOrDeleted())
+        return (Pos + M.lowest()) & Mask;
+      return ~0U;
+    });
+  }
+
+  /// Returns the bucket of \p Key and false if it is in the map, or a free
+  /// bucket for it and true if it is not.
+  template <typename LookupKeyT>
+  std::pair<unsigned, bool> findOrPrepareInsert(const LookupKeyT &Key) {
+    unsigned Index = findIndex(Key);
+    if (Index != NumBuckets)
+      return {Index, false};
+
+    incrementEpoch();
+    uint64_t Hash = getHash(Key);
+    if (NumBuckets != 0) {
+      Index = findFreeIndex(Hash);
+      if (Ctrl[Index] == detail::FlatHashDeleted || GrowthLeft != 0) {
+        if (Ctrl[Index] == detail::FlatHashEmpty)
+          --GrowthLeft;
+        setCtrl(Index, getH2(Hash));
+        ++NumEntries;
+        return {Index, true};
+      }
+    }
+
+    // Out of empty buckets: grow the table, or only drop the deleted buckets
+    // if that frees enough.
+    unsigned NewNumBuckets = NumBuckets;
+    if (NumEntries + 1 > maxLoad(NumBuckets) / 2 || NumBuckets == 0)
+      NewNumBuckets = bucketsForEntries(std::max(NumEntries + 1, 2 * NumEntries));
+    rehash(NewNumBuckets);
+    Index = findFreeIndex(Hash);
+    --GrowthLeft;
+    setCtrl(Index, getH2(Hash));
+    ++NumEntries;
+    return {Index, true};
+  }
+
+  template <typename KeyArg, typename... ValueArgs>
+  void construct(unsigned Index, KeyArg &&Key, ValueArgs &&... Values) {
+    BucketT *B = Buckets + Index;
+    ::new (&B->getFirst()) KeyT(std::forward<KeyArg>(Key));
+    ::new (&B->getSecond()) ValueT(std::forward<ValueArgs>(Values)...);
+  }
+
+  void eraseIndex(unsigned Index) {
+    incrementEpoch();
+    BucketT *B = Buckets + Index;
+    B->getSecond().~ValueT();
+    B->getFirst().~KeyT();
+    // A bucket can become empty again if no probe sequence ever went past
+    // it, which is the case if no group around it has ever been full: the
+    // run of non-empty buckets it is in is shorter than a group.
+    unsigned Mask = NumBuckets - 1;
+    auto Before = Group(Ctrl + ((Index - Group::Width) & Mask)).matchEmpty();
+    auto After = Group(Ctrl + Index).matchEmpty();
+    if (Before.trailingUnmatched(Group::Width) +
+            After.leadingUnmatched(Group::Width) <
+        Group::Width) {
+      setCtrl(Index, detail::FlatHashEmpty);
+      ++GrowthLeft;
+    } else {
+      setCtrl(Index, detail::FlatHashDeleted);
+    }
+    --NumEntries;
+  }
+
+  void destroyAll() {
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (!isFull(Ctrl[I]))
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void deallocateBuckets() {
+    if (NumBuckets)
+      deallocate_buffer(Buckets, allocationSize(NumBuckets), alignof(BucketT));
+  }
+
+  /// Moves all entries into a new table of \p NewNumBuckets buckets.
+  void rehash(unsigned NewNumBuckets) {
+    incrementEpoch();
+    BucketT *OldBuckets = Buckets;
+    int8_t *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+
+    Buckets = static_cast<BucketT *>(
+        allocate_buffer(allocationSize(NewNumBuckets), alignof(BucketT)));
+    Ctrl = reinterpret_cast<int8_t *>(Buckets + NewNumBuckets);
+    NumBuckets = NewNumBuckets;
+    resetCtrl();
+    GrowthLeft = maxLoad(NumBuckets) - NumEntries;
+
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (!isFull(OldCtrl[I]))
+        continue;
+      BucketT &Old = OldBuckets[I];
+      uint64_t Hash = getHash(Old.getFirst());
+      unsigned Index = findFreeIndex(Hash);
+      setCtrl(Index, getH2(Hash));
+      construct(Index, std::move(Old.getFirst()), std::move(Old.getSecond()));
+      Old.getSecond().~ValueT();
+      Old.getFirst().~KeyT();
+    }
+
+    if (OldNumBuckets)
+      deallocate_buffer(OldBuckets, allocationSize(OldNumBuckets),
+                        alignof(BucketT));
+  }
+
+  iterator makeIterator(unsigned Index) {
+    return iterator(Buckets + Index, Ctrl + Index, Ctrl + NumBuckets, *this);
+  }
+  const_iterator makeConstIterator(unsigned Index) const {
+    return const_iterator(Buckets + Index, Ctrl + Index, Ctrl + NumBuckets,
+                          *this);
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+inline void swap(FlatHashMap<KeyT, ValueT, KeyInfoT, BucketT> &LHS,
+                 FlatHashMap<KeyT, ValueT, KeyInfoT, BucketT> &RHS) {
+  LHS.swap(RHS);
+}
+
+namespace detail {
+
+template <typename KeyT, typename ValueT, typename BucketT, bool IsConst>
+class FlatHashMapIterator : DebugEpochBase::HandleBase {
+  template <typename, typename, typename, typename> friend class llvm::FlatHashMap;
+  friend class FlatHashMapIterator<KeyT, ValueT, BucketT, true>;
+  friend class FlatHashMapIterator<KeyT, ValueT, BucketT, false>;
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type =
+      typename std::conditional<IsConst, const BucketT, BucketT>::type;
+  using pointer = value_type *;
+  using reference = value_type &;
+  using iterator_category = std::forward_iterator_tag;
+
+private:
+  pointer Ptr = nullptr;
+  const int8_t *CtrlPtr = nullptr;
+  const int8_t *CtrlEnd = nullptr;
+
+public:
+  FlatHashMapIterator() = default;
+
+  FlatHashMapIterator(pointer Pos, const int8_t *CtrlPos, const int8_t *CtrlEnd,
+                      const DebugEpochBase &Epoch)
+      : DebugEpochBase::HandleBase(&Epoch), Ptr(Pos), CtrlPtr(CtrlPos),
+        CtrlEnd(CtrlEnd) {
+    skipFree();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined
+  // copy constructor.
+  template <bool IsConstSrc,
+            typename = std::enable_if_t<!IsConstSrc && IsConst>>
+  FlatHashMapIterator(
+      const FlatHashMapIterator<KeyT, ValueT, BucketT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ptr(I.Ptr), CtrlPtr(I.CtrlPtr),
+        CtrlEnd(I.CtrlEnd) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  friend bool operator==(const FlatHashMapIterator &LHS,
+                         const FlatHashMapIterator &RHS) {
+    assert((!LHS.Ptr || LHS.isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(LHS.getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return LHS.Ptr == RHS.Ptr;
+  }
+
+  friend bool operator!=(const FlatHashMapIterator &LHS,
+                         const FlatHashMapIterator &RHS) {
+    return !(LHS == RHS);
+  }
+
+  FlatHashMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ptr;
+    ++CtrlPtr;
+    skipFree();
+    return *this;
+  }
+  FlatHashMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    FlatHashMapIterator Tmp = *this;
+    ++*this;
+    return Tmp;
+  }
+
+private:
+  void skipFree() {
+    while (CtrlPtr != CtrlEnd && *CtrlPtr < 0) {
+      ++Ptr;
+      ++CtrlPtr;
+    }
+  }
+};
+
+} // end namespace detail
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_FLATHASHMAP_H
@@ -121,9 +121,9 @@ class DefaultInlineAdvice : public InlineAdvice {
 public:
   DefaultInlineAdvice(InlineAdvisor *Advisor, CallBase &CB,
                       Optional<InlineCost> OIC, OptimizationRemarkEmitter &ORE,
-                      bool EmitRemarks = true)
+                      bool EmitRemarks = true, unsigned HotCodeGrowth = 0)
       : InlineAdvice(Advisor, CB, ORE, OIC.hasValue()), OriginalCB(&CB),
-        OIC(OIC), EmitRemarks(EmitRemarks) {}
+        OIC(OIC), EmitRemarks(EmitRemarks), HotCodeGrowth(HotCodeGrowth) {}
 
 private:
   void recordUnsuccessfulInliningImpl(const InlineResult &Result) override;
@@ -134,6 +134,8 @@ private:
   CallBase *const OriginalCB;
   Optional<InlineCost> OIC;
   bool EmitRemarks;
+  /// Bytes added to the hot code of the module by inlining the call site.
+  unsigned HotCodeGrowth;
 };
 
 /// Interface for deciding whether to inline a call site or not.
@@ -208,11 +210,37 @@ public:
       : InlineAdvisor(M, FAM), Params(Params) {}
 
 private:
+  friend class DefaultInlineAdvice;
+
   std::unique_ptr<InlineAdvice> getAdviceImpl(CallBase &CB) override;
 
   void onPassExit() override { freeDeletedFunctions(); }
 
+  /// Return true if inlining \p CB grows the hot code of the module, which
+  /// has to fit into the hot code budget.
+  bool isHotCodeBudgetCallSite(CallBase &CB);
+
+  /// Return true if the hot code of the module can grow by the \p Bytes of
+  /// inlining \p CB, whose inlining benefit is given by \p IC.
+  bool fitsHotCodeBudget(CallBase &CB, const InlineCost &IC, unsigned Bytes);
+
+  /// Account for a hot call site inlined with \p IC, copying \p Bytes.
+  void recordHotCodeGrowth(const InlineCost &IC, unsigned Bytes);
+
+  /// Return the estimated size in bytes of the code of \p F.
+  unsigned getCodeSize(Function &F);
+
   InlineParams Params;
+
+  /// The size in bytes the hot code should fit into, 0 if there is no budget.
+  /// It is determined when the first call site is looked at.
+  Optional<unsigned> HotCodeBudget;
+  /// The current size in bytes of the hot code of the module.
+  uint64_t HotCodeSize = 0;
+  /// The bytes copied and the cost saved by the hot call sites inlined so far,
+  /// which give the average benefit per byte.
+  uint64_t InlinedHotBytes = 0;
+  int64_t InlinedHotBenefit = 0;
 };
 
 /// The InlineAdvisorAnalysis is a module pass because the InlineAdvisor
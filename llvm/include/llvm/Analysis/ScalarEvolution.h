@@ -834,10 +834,11 @@ public:
   void forgetValue(Value *V);
 
   /// Called when the client has changed the disposition of values in
-  /// this loop.
+  /// this loop, e.g. by moving instructions into its preheader or exit
+  /// blocks.
   ///
-  /// We don't have a way to invalidate per-loop dispositions. Clear and
-  /// recompute is simpler.
+  /// Only the dispositions with respect to the loops of the nest containing
+  /// \p L are dropped, the cached dispositions for other loops are kept.
   void forgetLoopDispositions(const Loop *L);
 
   /// Determine the minimum number of zero bits that S is guaranteed to end in
@@ -304,6 +304,11 @@ public:
   /// scientific. A target may has no bonus on vector instructions.
   int getInlinerVectorBonusPercent() const;
 
+  /// \returns The size in bytes that the hot code of a module should fit
+  /// into, e.g. a small instruction cache, or 0 if there is no such budget.
+  /// The inliner stops growing the hot code once it exceeds this size.
+  unsigned getInliningHotCodeBudget() const;
+
   /// \return the expected cost of a memcpy, which could e.g. depend on the
   /// source/destination type and alignment and the number of bytes copied.
   int getMemcpyCost(const Instruction *I) const;
@@ -1400,6 +1405,7 @@ public:
   virtual unsigned getInliningThresholdMultiplier() = 0;
   virtual unsigned adjustInliningThreshold(const CallBase *CB) = 0;
   virtual int getInlinerVectorBonusPercent() = 0;
+  virtual unsigned getInliningHotCodeBudget() = 0;
   virtual int getMemcpyCost(const Instruction *I) = 0;
   virtual unsigned
   getEstimatedNumberOfCaseClusters(const SwitchInst &SI, unsigned &JTSize,
@@ -1689,6 +1695,9 @@ public:
   int getInlinerVectorBonusPercent() override {
     return Impl.getInlinerVectorBonusPercent();
   }
+  unsigned getInliningHotCodeBudget() override {
+    return Impl.getInliningHotCodeBudget();
+  }
   int getMemcpyCost(const Instruction *I) override {
     return Impl.getMemcpyCost(I);
   }
@@ -71,6 +71,8 @@ public:
 
   int getInlinerVectorBonusPercent() const { return 150; }
 
+  unsigned getInliningHotCodeBudget() const { return 0; }
+
   unsigned getMemcpyCost(const Instruction *I) const {
     return TTI::TCC_Expensive;
   }
@@ -34,6 +34,12 @@ enum class MachineCombinerPattern {
   REASSOC_XY_BCA,
   REASSOC_XY_BAC,
 
+  // These are multiply-accumulate patterns matched by the RISCV machine
+  // combiner for the PULPv2 extension.
+  PULP_MAC_OP1,
+  PULP_MAC_OP2,
+  PULP_MSU_OP2,
+
   // These are multiply-add patterns matched by the AArch64 machine combiner.
   MULADDW_OP1,
   MULADDW_OP2,
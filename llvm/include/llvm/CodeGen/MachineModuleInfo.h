@@ -32,11 +32,13 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/PointerIntPair.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Allocator.h"
 #include <memory>
 #include <utility>
 #include <vector>
@@ -271,6 +273,9 @@ public:
 
 class MachineModuleInfoWrapperPass : public ImmutablePass {
   MachineModuleInfo MMI;
+  /// Recycles the allocator slabs of the machine functions while the pass
+  /// manager runs.
+  Optional<SlabCache> Slabs;
 
 public:
   static char ID; // Pass identification, replacement for typeid
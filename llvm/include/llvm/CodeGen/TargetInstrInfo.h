@@ -1890,6 +1890,12 @@ public:
     return true;
   }
 
+  /// Optional target hook that returns true if \p MBB may be moved into the
+  /// cold section of its function by the machine function splitter.
+  virtual bool isMBBSafeToSplitToCold(const MachineBasicBlock &MBB) const {
+    return true;
+  }
+
   /// Insert a custom frame for outlined functions.
   virtual void buildOutlinedFrame(MachineBasicBlock &MBB, MachineFunction &MF,
                                   const outliner::OutlinedFunction &OF) const {
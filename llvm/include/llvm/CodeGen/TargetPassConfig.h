@@ -440,6 +440,12 @@ protected:
   // `addPreEmitPass` *should* be but in reality isn't.
   virtual void addPreEmitPass2() {}
 
+  /// Targets may add passes that need to know the final section of each basic
+  /// block in this callback, e.g. to relax branches between the parts of a
+  /// function split by the machine function splitter. This is called after
+  /// the basic block sections passes, right before `addPreEmitPass2`.
+  virtual void addPostBBSections() {}
+
   /// Utilities for targets to add passes to the pass manager.
   ///
 
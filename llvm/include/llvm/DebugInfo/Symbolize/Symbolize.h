@@ -20,6 +20,7 @@
 #include "llvm/Support/Error.h"
 #include <algorithm>
 #include <cstdint>
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
@@ -49,6 +50,10 @@ public:
     std::string FallbackDebugPath;
     std::string DWPName;
     std::vector<std::string> DebugFileDirectory;
+    /// Upper bound on the size in bytes of the debug info of the modules kept
+    /// parsed. The least recently used modules are dropped beyond it, while
+    /// their files stay mapped. 0 means no limit.
+    uint64_t MaxCacheSize = 0;
   };
 
   LLVMSymbolizer() = default;
@@ -95,7 +100,7 @@ private:
   Expected<SymbolizableModule *>
   createModuleInfo(const ObjectFile *Obj,
                    std::unique_ptr<DIContext> Context,
-                   StringRef ModuleName);
+                   StringRef ModuleName, uint64_t Size);
 
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
@@ -117,8 +122,29 @@ private:
   Expected<ObjectFile *> getOrCreateObject(const std::string &Path,
                                           const std::string &ArchName);
 
-  std::map<std::string, std::unique_ptr<SymbolizableModule>, std::less<>>
-      Modules;
+  /// Returns the cached module \p ModuleName, or nullptr and false if it was
+  /// not created yet.
+  std::pair<SymbolizableModule *, bool> lookUpModule(StringRef ModuleName);
+
+  /// Drops the least recently used modules until the cache fits in
+  /// Opts.MaxCacheSize.
+  void pruneCache();
+
+  struct CachedModule {
+    std::unique_ptr<SymbolizableModule> Module;
+    /// Size of the debug info the module was created from.
+    uint64_t Size = 0;
+    /// Position of the module in LRUModules, if it was loaded successfully.
+    std::list<const std::string *>::iterator LRUPos;
+  };
+
+  std::map<std::string, CachedModule, std::less<>> Modules;
+
+  /// Names of the successfully loaded modules, most recently used first.
+  std::list<const std::string *> LRUModules;
+
+  /// Sum of the sizes of the modules in LRUModules.
+  uint64_t CacheSize = 0;
 
   /// Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
@@ -0,0 +1,76 @@
+//===----- ELF_riscv.h - JIT link functions for ELF/RISC-V ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// jit-link functions for ELF/RISC-V (RV32 and RV64).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_JITLINK_ELF_RISCV_H
+#define LLVM_EXECUTIONENGINE_JITLINK_ELF_RISCV_H
+
+#include "llvm/ExecutionEngine/JITLink/JITLink.h"
+
+namespace llvm {
+namespace jitlink {
+
+namespace ELF_riscv_Edges {
+enum ELFRISCVRelocationKind : Edge::Kind {
+  Pointer32 = Edge::FirstRelocation,
+  Pointer64,
+  PCRel32,
+  Branch,
+  Jal,
+  Call,
+  CallPLT,
+  GOTPCRelHi20,
+  PCRelHi20,
+  PCRelLo12I,
+  PCRelLo12S,
+  Hi20,
+  Lo12I,
+  Lo12S,
+  RVCBranch,
+  RVCJump,
+  Add8,
+  Add16,
+  Add32,
+  Add64,
+  Sub6,
+  Sub8,
+  Sub16,
+  Sub32,
+  Sub64,
+  Set6,
+  Set8,
+  Set16,
+  Set32,
+};
+
+} // end namespace ELF_riscv_Edges
+
+/// Create a LinkGraph from an ELF/RISC-V relocatable object.
+///
+/// Note: The graph does not take ownership of the underlying buffer, nor copy
+/// its contents. The caller is responsible for ensuring that the object buffer
+/// outlives the graph.
+Expected<std::unique_ptr<LinkGraph>>
+createLinkGraphFromELFObject_riscv(MemoryBufferRef ObjectBuffer);
+
+/// jit-link the given object buffer, which must be a ELF RISC-V object file.
+///
+/// Linker relaxation is not performed: R_RISCV_RELAX and R_RISCV_ALIGN are
+/// ignored and the code is linked with the layout chosen by the assembler.
+void link_ELF_riscv(std::unique_ptr<LinkGraph> G,
+                    std::unique_ptr<JITLinkContext> Ctx);
+
+/// Return the string name of the given ELF RISC-V edge kind.
+StringRef getELFRISCVRelocationKindName(Edge::Kind R);
+} // end namespace jitlink
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_JITLINK_ELF_RISCV_H
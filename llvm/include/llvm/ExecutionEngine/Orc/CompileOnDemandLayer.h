@@ -92,6 +92,12 @@ public:
   /// Sets the ImplSymbolMap
   void setImplMap(ImplSymbolMap *Imp);
 
+  /// Points the call-through stub for Name, whose definition lives in the
+  /// implementation dylib ImplD, at NewAddr. All callers then go to NewAddr,
+  /// e.g. a re-optimized version of the function.
+  Error redirect(JITDylib &ImplD, const SymbolStringPtr &Name,
+                 JITTargetAddress NewAddr);
+
   /// Emits the given module. This should not be called by clients: it will be
   /// called by the JIT when a definition added via the add method is requested.
   void emit(std::unique_ptr<MaterializationResponsibility> R,
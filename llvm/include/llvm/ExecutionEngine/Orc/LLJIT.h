@@ -13,6 +13,7 @@
 #ifndef LLVM_EXECUTIONENGINE_ORC_LLJIT_H
 #define LLVM_EXECUTIONENGINE_ORC_LLJIT_H
 
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
@@ -20,6 +21,8 @@
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "llvm/Support/CachePruning.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ThreadPool.h"
 
@@ -207,6 +210,7 @@ protected:
   DataLayout DL;
   Triple TT;
   std::unique_ptr<ThreadPool> CompileThreads;
+  std::unique_ptr<ObjectCache> ObjCache;
 
   std::unique_ptr<ObjectLayer> ObjLinkingLayer;
   std::unique_ptr<ObjectTransformLayer> ObjTransformLayer;
@@ -231,6 +235,14 @@ public:
   /// Returns a reference to the on-demand layer.
   CompileOnDemandLayer &getCompileOnDemandLayer() { return *CODLayer; }
 
+  /// Returns the optimizing transform layer.
+  ///
+  /// Only available if tiered compilation is enabled
+  /// (LLLazyJITBuilder::setTieredCompilation).
+  IRTransformLayer *getOptimizedTransformLayer() {
+    return OptimizedTransformLayer.get();
+  }
+
   /// Add a module to be lazily compiled to JITDylib JD.
   Error addLazyIRModule(JITDylib &JD, ThreadSafeModule M);
 
@@ -245,6 +257,12 @@ private:
   LLLazyJIT(LLLazyJITBuilderState &S, Error &Err);
 
   std::unique_ptr<LazyCallThroughManager> LCTMgr;
+  std::unique_ptr<MangleAndInterner> Mangle;
+  std::unique_ptr<ImplSymbolMap> SpeculationImpls;
+  std::unique_ptr<Speculator> Spec;
+  std::unique_ptr<IRSpeculationLayer> SpeculationLayer;
+  std::unique_ptr<IRTransformLayer> OptimizedTransformLayer;
+  std::unique_ptr<TieredCompileLayer> TieredLayer;
   std::unique_ptr<CompileOnDemandLayer> CODLayer;
 };
 
@@ -268,6 +286,9 @@ public:
   PlatformSetupFunction SetUpPlatform;
   unsigned NumCompileThreads = 0;
   TargetProcessControl *TPC = nullptr;
+  std::unique_ptr<ObjectCache> ObjCache;
+  std::string ObjectCacheDir;
+  CachePruningPolicy ObjectCachePruningPolicy;
 
   /// Called prior to JIT class construcion to fix up defaults.
   Error prepareForConstruction();
@@ -350,6 +371,27 @@ public:
     return impl();
   }
 
+  /// Set an ObjectCache to query before compiling, and to store compiled
+  /// objects into.
+  ///
+  /// The cache is only used by the default compile function: clients that set
+  /// a CompileFunctionCreator should install their cache in their compiler.
+  SetterImpl &setObjectCache(std::unique_ptr<ObjectCache> ObjCache) {
+    impl().ObjCache = std::move(ObjCache);
+    return impl();
+  }
+
+  /// Cache compiled objects in directory Dir, across JIT instances and
+  /// processes, evicting them as described by Policy (see OnDiskObjectCache).
+  ///
+  /// Ignored if an ObjectCache has been set with setObjectCache.
+  SetterImpl &setObjectCacheDirectory(
+      StringRef Dir, CachePruningPolicy Policy = CachePruningPolicy()) {
+    impl().ObjectCacheDir = Dir.str();
+    impl().ObjectCachePruningPolicy = std::move(Policy);
+    return impl();
+  }
+
   /// Set a TargetProcessControl object.
   ///
   /// If the platform uses ObjectLinkingLayer by default and no
@@ -393,6 +435,10 @@ public:
   JITTargetAddress LazyCompileFailureAddr = 0;
   std::unique_ptr<LazyCallThroughManager> LCTMgr;
   IndirectStubsManagerBuilderFunction ISMBuilder;
+  IRSpeculationLayer::ResultEval SpeculationQuery;
+  uint64_t TierUpThreshold = 0;
+  IRTransformLayer::TransformFunction OptimizedTransform =
+      IRTransformLayer::identityTransform;
 
   Error prepareForConstruction();
 };
@@ -428,6 +474,31 @@ public:
     this->impl().ISMBuilder = std::move(ISMBuilder);
     return this->impl();
   }
+
+  /// Set the query that finds the likely callees of a function.
+  ///
+  /// If this method is called, the first call to a function triggers the
+  /// compilation of its likely callees (see Speculator), on the compile
+  /// threads if there are any. The speculation runtime is defined in the main
+  /// JITDylib.
+  SetterImpl &setSpeculationQuery(IRSpeculationLayer::ResultEval Query) {
+    this->impl().SpeculationQuery = std::move(Query);
+    return this->impl();
+  }
+
+  /// Enable tiered compilation.
+  ///
+  /// Functions are first compiled through the regular transform layer, which
+  /// should run a cheap pipeline, and recompiled through OptimizedTransform
+  /// once they have been called Threshold times (see TieredCompileLayer).
+  /// The tier-up runtime is defined in the main JITDylib.
+  SetterImpl &
+  setTieredCompilation(uint64_t Threshold,
+                       IRTransformLayer::TransformFunction OptimizedTransform) {
+    this->impl().TierUpThreshold = Threshold;
+    this->impl().OptimizedTransform = std::move(OptimizedTransform);
+    return this->impl();
+  }
 };
 
 /// Constructs LLLazyJIT instances.
@@ -0,0 +1,66 @@
+//===- OnDiskObjectCache.h - Persistent, content-addressed cache -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that keeps compiled objects in a directory across processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_ONDISKOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_ONDISKOBJECTCACHE_H
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+namespace orc {
+
+class JITTargetMachineBuilder;
+
+/// An ObjectCache that stores objects in a directory, keyed by a hash of the
+/// module's bitcode and of the target options they were compiled with.
+///
+/// The cache can be shared by compile threads and by processes: entries are
+/// written to a temporary file which is then renamed into place. Entries are
+/// evicted least recently used first, following the given pruning policy (see
+/// pruneCache), when the cache is created and as entries are added.
+class OnDiskObjectCache : public ObjectCache {
+public:
+  /// Create a cache in CacheDir, creating the directory if needed, for objects
+  /// compiled with the target options of JTMB.
+  static Expected<std::unique_ptr<OnDiskObjectCache>>
+  Create(StringRef CacheDir, const JITTargetMachineBuilder &JTMB,
+         CachePruningPolicy Policy = CachePruningPolicy());
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+private:
+  OnDiskObjectCache(std::string CacheDir, std::string TargetKey,
+                    CachePruningPolicy Policy)
+      : CacheDir(std::move(CacheDir)), TargetKey(std::move(TargetKey)),
+        Policy(std::move(Policy)) {}
+
+  std::string getEntryPath(const Module &M);
+
+  std::string CacheDir;
+  std::string TargetKey;
+  CachePruningPolicy Policy;
+
+  // Serializes the pruning. Lookups and stores need no lock.
+  std::mutex PruneMutex;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_ONDISKOBJECTCACHE_H
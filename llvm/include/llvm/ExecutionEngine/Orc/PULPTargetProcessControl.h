@@ -0,0 +1,134 @@
+//===- PULPTargetProcessControl.h - Control a PULP accelerator --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A TargetProcessControl implementation for the PULP cluster of a HERO
+// system. The JIT runs on the host, links RISC-V code into the L2 memory of
+// the accelerator and starts it through the mailbox, like the libomptarget
+// PULP plugin starts offloaded kernels.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_PULPTARGETPROCESSCONTROL_H
+#define LLVM_EXECUTIONENGINE_ORC_PULPTARGETPROCESSCONTROL_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ExecutionEngine/Orc/TargetProcessControl.h"
+
+#include <map>
+#include <mutex>
+
+namespace llvm {
+namespace orc {
+
+/// The operations of the HERO driver that the JIT needs. An implementation
+/// on top of libpulp writes the memory through the mapping of the device
+/// (e.g. pulp->l2_mem) and forwards the mailbox accesses to pulp_mbox_write
+/// and pulp_mbox_read.
+class PULPDriver {
+public:
+  virtual ~PULPDriver();
+
+  /// Copy \p Bytes to the memory of the accelerator at address \p Addr.
+  virtual Error writeMemory(JITTargetAddress Addr, ArrayRef<char> Bytes) = 0;
+
+  /// Send \p Word to the accelerator.
+  virtual Error writeMailbox(uint32_t Word) = 0;
+
+  /// Wait for the next word sent by the accelerator.
+  virtual Expected<uint32_t> readMailbox() = 0;
+};
+
+/// A TargetProcessControl implementation for a PULP accelerator.
+///
+/// The JIT-linked code and data are placed in a range of the L2 memory that
+/// the resident runtime of the accelerator does not use. Symbols of the
+/// resident runtime are resolved from the table given on creation. Kernels
+/// are started with runKernel, which takes one message per kernel like the
+/// start message of the libomptarget plugin.
+class PULPTargetProcessControl : public TargetProcessControl,
+                                 private TargetProcessControl::MemoryAccess {
+public:
+  /// Mailbox messages of the resident runtime.
+  enum : uint32_t { PULP_START = 2, PULP_DONE = 4 };
+
+  PULPTargetProcessControl(std::shared_ptr<SymbolStringPool> SSP,
+                           std::unique_ptr<PULPDriver> Driver,
+                           JITTargetAddress L2Begin, JITTargetAddress L2End,
+                           StringMap<JITTargetAddress> DeviceSymbols);
+  ~PULPTargetProcessControl() override;
+
+  /// Create a PULPTargetProcessControl that JIT-links into the L2 memory
+  /// range [\p L2Begin, \p L2End) of the accelerator.
+  static Expected<std::unique_ptr<PULPTargetProcessControl>>
+  Create(std::shared_ptr<SymbolStringPool> SSP,
+         std::unique_ptr<PULPDriver> Driver, JITTargetAddress L2Begin,
+         JITTargetAddress L2End,
+         StringMap<JITTargetAddress> DeviceSymbols = {});
+
+  /// Only the resident runtime, with a null path, can be loaded.
+  Expected<tpctypes::DylibHandle> loadDylib(const char *DylibPath) override;
+
+  Expected<std::vector<tpctypes::LookupResult>>
+  lookupSymbols(ArrayRef<LookupRequest> Request) override;
+
+  /// PULP kernels have no main-like entry points, these return an error.
+  Expected<int32_t> runAsMain(JITTargetAddress MainFnAddr,
+                              ArrayRef<std::string> Args) override;
+
+  Expected<tpctypes::WrapperFunctionResult>
+  runWrapper(JITTargetAddress WrapperFnAddr,
+             ArrayRef<uint8_t> ArgBuffer) override;
+
+  Error disconnect() override;
+
+  /// Run the kernel at \p EntryAddr on the cluster and wait for it to
+  /// complete. The kernel is passed the address of an array holding \p Args.
+  /// Returns the number of cycles the kernel took.
+  Expected<uint32_t> runKernel(JITTargetAddress EntryAddr,
+                               ArrayRef<uint64_t> Args);
+
+private:
+  class L2MemoryManager;
+
+  void writeUInt8s(ArrayRef<tpctypes::UInt8Write> Ws,
+                   WriteResultFn OnWriteComplete) override;
+
+  void writeUInt16s(ArrayRef<tpctypes::UInt16Write> Ws,
+                    WriteResultFn OnWriteComplete) override;
+
+  void writeUInt32s(ArrayRef<tpctypes::UInt32Write> Ws,
+                    WriteResultFn OnWriteComplete) override;
+
+  void writeUInt64s(ArrayRef<tpctypes::UInt64Write> Ws,
+                    WriteResultFn OnWriteComplete) override;
+
+  void writeBuffers(ArrayRef<tpctypes::BufferWrite> Ws,
+                    WriteResultFn OnWriteComplete) override;
+
+  /// Allocate \p Size bytes of L2 memory aligned to \p Alignment.
+  Expected<JITTargetAddress> allocateL2(uint64_t Size, uint64_t Alignment);
+
+  /// Release the L2 memory [\p Addr, \p Addr + \p Size).
+  void deallocateL2(JITTargetAddress Addr, uint64_t Size);
+
+  std::unique_ptr<PULPDriver> Driver;
+  std::unique_ptr<L2MemoryManager> OwnedMemMgr;
+  StringMap<JITTargetAddress> DeviceSymbols;
+
+  /// The free ranges of the L2 memory, by start address.
+  std::mutex L2Mutex;
+  std::map<JITTargetAddress, uint64_t> FreeL2;
+
+  /// The mailbox takes one kernel at a time.
+  std::mutex KernelMutex;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_PULPTARGETPROCESSCONTROL_H
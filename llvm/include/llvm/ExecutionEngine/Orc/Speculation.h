@@ -175,7 +175,7 @@ public:
   using ResultEval = std::function<IRlikiesStrRef(Function &)>;
   using TargetAndLikelies = DenseMap<SymbolStringPtr, SymbolNameSet>;
 
-  IRSpeculationLayer(ExecutionSession &ES, IRCompileLayer &BaseLayer,
+  IRSpeculationLayer(ExecutionSession &ES, IRLayer &BaseLayer,
                      Speculator &Spec, MangleAndInterner &Mangle,
                      ResultEval Interpreter)
       : IRLayer(ES, BaseLayer.getManglingOptions()), NextLayer(BaseLayer),
@@ -198,7 +198,7 @@ private:
     return InternedNames;
   }
 
-  IRCompileLayer &NextLayer;
+  IRLayer &NextLayer;
   Speculator &S;
   MangleAndInterner &Mangle;
   ResultEval QueryAnalysis;
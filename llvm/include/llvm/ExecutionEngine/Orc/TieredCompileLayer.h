@@ -0,0 +1,91 @@
+//===- TieredCompileLayer.h - Re-optimize hot functions ---------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Tiered compilation: functions are first compiled cheaply with a call
+// counter, and recompiled through an optimizing layer once they get hot.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+#define LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/Layer.h"
+#include "llvm/ExecutionEngine/Orc/Mangling.h"
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+
+/// A layer that compiles every module twice: first through BaseLayer, with a
+/// counter on the entry of each function, then, once the functions of the
+/// module have been called Threshold times, through OptimizedLayer.
+///
+/// The optimized copy defines the functions under new names in the same
+/// JITDylib and refers to the data of the first copy. Callers are switched
+/// over by the redirect function, typically by updating the call-through
+/// stubs of a CompileOnDemandLayer, so this layer is meant to sit below one:
+/// it relies on all symbols of the module having been promoted to external
+/// linkage, and leaves modules with local symbols or aliases untiered.
+///
+/// The tier-up request is issued from the JIT'd code through the runtime
+/// defined by addTierUpRuntime. The optimized copy is compiled by a lookup, so
+/// it runs on the compile threads of the ExecutionSession if there are any.
+class TieredCompileLayer : public IRLayer {
+public:
+  /// Redirects the callers of the symbol Name, defined in JITDylib JD, to
+  /// NewAddr.
+  using RedirectFunction = unique_function<Error(
+      JITDylib &JD, const SymbolStringPtr &Name, JITTargetAddress NewAddr)>;
+
+  TieredCompileLayer(ExecutionSession &ES, IRLayer &BaseLayer,
+                     IRLayer &OptimizedLayer, uint64_t Threshold);
+
+  void setRedirectFunction(RedirectFunction Redirect) {
+    this->Redirect = std::move(Redirect);
+  }
+
+  /// Define symbols for this layer (__orc_tier_up_ctx) and the tier-up
+  /// runtime entry point (__orc_tier_up) in the given JITDylib. They must be
+  /// visible from every JITDylib whose code goes through this layer.
+  Error addTierUpRuntime(JITDylib &JD, MangleAndInterner &Mangle);
+
+  void emit(std::unique_ptr<MaterializationResponsibility> R,
+            ThreadSafeModule TSM) override;
+
+private:
+  // The optimized copy of a module, waiting for its functions to get hot.
+  struct PendingTierUp {
+    JITDylib *JD = nullptr;
+    ThreadSafeModule TSM;
+    // The original and the optimized copy names of each tiered function.
+    std::vector<std::pair<SymbolStringPtr, SymbolStringPtr>> Renames;
+  };
+
+  static void tierUpEntryPoint(TieredCompileLayer *Layer, uint64_t ModuleId);
+  void tierUp(uint64_t ModuleId);
+
+  IRLayer &BaseLayer;
+  IRLayer &OptimizedLayer;
+  uint64_t Threshold;
+  RedirectFunction Redirect;
+
+  std::mutex PendingMutex;
+  DenseMap<uint64_t, PendingTierUp> Pending;
+  std::atomic<uint64_t> NextModuleId{0};
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
@@ -36,6 +36,7 @@
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -276,6 +277,65 @@ template <> struct DenseMapInfo<ValueInfo> {
   static unsigned getHashValue(ValueInfo I) { return (uintptr_t)I.getRef(); }
 };
 
+/// An array holding exactly its elements, for the reference and call edges of
+/// the summaries. The combined index of a large program has millions of these
+/// lists: unlike a std::vector, this one takes two words instead of three and
+/// never has spare capacity.
+///
+/// This only changes how the edges are stored. The summaries are still owned
+/// one by one and the edges still hold ValueInfos, so the combined index is
+/// not a flat layout that could be memory-mapped.
+template <typename T> class SummaryEdgeList {
+  std::unique_ptr<T[]> Elts;
+  uint32_t NumElts = 0;
+
+public:
+  SummaryEdgeList() = default;
+  SummaryEdgeList(ArrayRef<T> Init) { assign(Init); }
+  SummaryEdgeList(const SummaryEdgeList &Other) { assign(Other); }
+  SummaryEdgeList(SummaryEdgeList &&Other)
+      : Elts(std::move(Other.Elts)), NumElts(Other.NumElts) {
+    Other.NumElts = 0;
+  }
+
+  SummaryEdgeList &operator=(const SummaryEdgeList &Other) {
+    if (this != &Other)
+      assign(Other);
+    return *this;
+  }
+  SummaryEdgeList &operator=(SummaryEdgeList &&Other) {
+    Elts = std::move(Other.Elts);
+    NumElts = Other.NumElts;
+    Other.NumElts = 0;
+    return *this;
+  }
+
+  /// Replace the elements of the list by \p NewElts.
+  void assign(ArrayRef<T> NewElts) {
+    assert(NewElts.size() <= std::numeric_limits<uint32_t>::max() &&
+           "Too many summary edges");
+    NumElts = NewElts.size();
+    Elts.reset(NumElts ? new T[NumElts] : nullptr);
+    std::copy(NewElts.begin(), NewElts.end(), Elts.get());
+  }
+
+  /// Append \p Elt, reallocating the whole list. This is only meant for the
+  /// few edges that are added after the list has been built.
+  void push_back(const T &Elt) {
+    std::unique_ptr<T[]> NewElts(new T[NumElts + 1]);
+    std::copy(begin(), end(), NewElts.get());
+    NewElts[NumElts++] = Elt;
+    Elts = std::move(NewElts);
+  }
+
+  T *begin() const { return Elts.get(); }
+  T *end() const { return Elts.get() + NumElts; }
+  size_t size() const { return NumElts; }
+  bool empty() const { return NumElts == 0; }
+
+  operator ArrayRef<T>() const { return makeArrayRef(begin(), NumElts); }
+};
+
 /// Function and variable summary information to aid decisions and
 /// implementation of importing.
 class GlobalValueSummary {
@@ -352,11 +412,11 @@ private:
   /// (either by the initializer of a global variable, or referenced
   /// from within a function). This does not include functions called, which
   /// are listed in the derived FunctionSummary object.
-  std::vector<ValueInfo> RefEdgeList;
+  SummaryEdgeList<ValueInfo> RefEdgeList;
 
 protected:
   GlobalValueSummary(SummaryKind K, GVFlags Flags, std::vector<ValueInfo> Refs)
-      : Kind(K), Flags(Flags), RefEdgeList(std::move(Refs)) {
+      : Kind(K), Flags(Flags), RefEdgeList(Refs) {
     assert((K != AliasKind || Refs.empty()) &&
            "Expect no references for AliasSummary");
   }
@@ -623,7 +683,7 @@ private:
   uint64_t EntryCount = 0;
 
   /// List of <CalleeValueInfo, CalleeInfo> call edge pairs from this function.
-  std::vector<EdgeTy> CallGraphEdgeList;
+  SummaryEdgeList<EdgeTy> CallGraphEdgeList;
 
   std::unique_ptr<TypeIdInfo> TIdInfo;
 
@@ -643,7 +703,7 @@ public:
                   std::vector<ParamAccess> Params)
       : GlobalValueSummary(FunctionKind, Flags, std::move(Refs)),
         InstCount(NumInsts), FunFlags(FunFlags), EntryCount(EntryCount),
-        CallGraphEdgeList(std::move(CGEdges)) {
+        CallGraphEdgeList(CGEdges) {
     if (!TypeTests.empty() || !TypeTestAssumeVCalls.empty() ||
         !TypeCheckedLoadVCalls.empty() || !TypeTestAssumeConstVCalls.empty() ||
         !TypeCheckedLoadConstVCalls.empty())
@@ -1510,11 +1570,10 @@ template <> struct GraphTraits<ValueInfo> {
   static NodeRef valueInfoFromEdge(FunctionSummary::EdgeTy &P) {
     return P.first;
   }
-  using ChildIteratorType =
-      mapped_iterator<std::vector<FunctionSummary::EdgeTy>::iterator,
-                      decltype(&valueInfoFromEdge)>;
+  using ChildIteratorType = mapped_iterator<FunctionSummary::EdgeTy *,
+                                            decltype(&valueInfoFromEdge)>;
 
-  using ChildEdgeIteratorType = std::vector<FunctionSummary::EdgeTy>::iterator;
+  using ChildEdgeIteratorType = FunctionSummary::EdgeTy *;
 
   static NodeRef getEntryNode(ValueInfo V) { return V; }
 
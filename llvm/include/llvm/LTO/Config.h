@@ -105,6 +105,12 @@ struct Config {
   /// The directory to store .dwo files.
   std::string DwoDir;
 
+  /// If this is set, ThinLTO backends that miss the cache look up their object
+  /// again in this directory, keyed by the module after importing. A change to
+  /// a function that was not imported then no longer invalidates the
+  /// importing modules. This is normally the cache directory itself.
+  std::string ThinLTOPostImportCacheDir;
+
   /// The name for the split debug info file used for the DW_AT_[GNU_]dwo_name
   /// attribute in the skeleton CU. This should generally only be used when
   /// running an individual backend directly via thinBackend(), as otherwise
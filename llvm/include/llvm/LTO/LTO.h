@@ -61,7 +61,9 @@ void thinLTOInternalizeAndPromoteInIndex(
 
 /// Computes a unique hash for the Module considering the current list of
 /// export/import and other global analysis results.
-/// The hash is produced in \p Key.
+/// The hash is produced in \p Key. Without \p IncludeModuleHashes, the
+/// contents of the module and the modules it imports from are left out, the
+/// caller then has to hash the module after importing.
 void computeLTOCacheKey(
     SmallString<40> &Key, const lto::Config &Conf,
     const ModuleSummaryIndex &Index, StringRef ModuleID,
@@ -70,7 +72,8 @@ void computeLTOCacheKey(
     const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
     const GVSummaryMapTy &DefinedGlobals,
     const std::set<GlobalValue::GUID> &CfiFunctionDefs = {},
-    const std::set<GlobalValue::GUID> &CfiFunctionDecls = {});
+    const std::set<GlobalValue::GUID> &CfiFunctionDecls = {},
+    bool IncludeModuleHashes = true);
 
 namespace lto {
 
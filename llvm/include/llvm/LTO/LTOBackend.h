@@ -45,13 +45,19 @@ Error backend(const Config &C, AddStreamFn AddStream,
               unsigned ParallelCodeGenParallelismLevel,
               std::unique_ptr<Module> M, ModuleSummaryIndex &CombinedIndex);
 
+/// Called by thinBackend() once the imports are done. Returns the stream to
+/// write the object to instead of the one passed to thinBackend(), or an empty
+/// function if the object does not need to be generated.
+using ThinBackendPostImportFn = std::function<AddStreamFn(const Module &M)>;
+
 /// Runs a ThinLTO backend.
 Error thinBackend(const Config &C, unsigned Task, AddStreamFn AddStream,
                   Module &M, const ModuleSummaryIndex &CombinedIndex,
                   const FunctionImporter::ImportMapTy &ImportList,
                   const GVSummaryMapTy &DefinedGlobals,
                   MapVector<StringRef, BitcodeModule> &ModuleMap,
-                  const std::vector<uint8_t> &CmdArgs = std::vector<uint8_t>());
+                  const std::vector<uint8_t> &CmdArgs = std::vector<uint8_t>(),
+                  ThinBackendPostImportFn PostImport = nullptr);
 
 Error finalizeOptimizationRemarks(
     std::unique_ptr<ToolOutputFile> DiagOutputFile);
@@ -12,6 +12,7 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/ADT/iterator_range.h"
@@ -182,9 +183,30 @@ private:
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
                                const MCAsmLayout &Layout) const;
 
+  /// The progress of the relaxation across layout iterations.
+  struct RelaxationState {
+    enum : unsigned { Never = ~0U };
+
+    /// The number of section relaxation passes which adjusted an offset.
+    unsigned Changes = 0;
+    /// The value of Changes when each section, by ordinal, no longer changed.
+    SmallVector<unsigned, 16> StableAt;
+    /// The first fragment of each section whose size depends on expressions.
+    SmallVector<MCFragment *, 16> FirstDependentFragment;
+
+    explicit RelaxationState(unsigned NumSections)
+        : StableAt(NumSections, Never),
+          FirstDependentFragment(NumSections, nullptr) {}
+  };
+
   /// Perform one layout iteration and return true if any offsets
-  /// were adjusted.
-  bool layoutOnce(MCAsmLayout &Layout);
+  /// were adjusted. Sections which cannot have changed since their last
+  /// iteration are skipped.
+  bool layoutOnce(MCAsmLayout &Layout, RelaxationState &State);
+
+  /// Return the first fragment of \p Sec whose size is computed from an
+  /// expression that may depend on the layout of other sections.
+  MCFragment *findLayoutDependentFragment(MCSection &Sec) const;
 
   /// Perform one layout iteration of the given section and return true
   /// if any offsets were adjusted.
@@ -20,6 +20,7 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/iterator.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/ProfileData/InstrProf.h"
@@ -33,6 +34,7 @@
 #include <cstdint>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <system_error>
 #include <tuple>
@@ -342,11 +344,9 @@ struct FunctionRecord {
   std::string Name;
   /// Mapping from FileID (i.e. vector index) to filename. Used to support
   /// macro expansions within a function in which the macro and function are
-  /// defined in separate files.
-  ///
-  /// TODO: Uniquing filenames across all function records may be a performance
-  /// optimization.
-  std::vector<std::string> Filenames;
+  /// defined in separate files. The filenames are uniqued by, and live as long
+  /// as, the CoverageMapping.
+  std::vector<StringRef> Filenames;
   /// Regions in the function along with their counts.
   std::vector<CountedRegion> CountedRegions;
   /// Branch Regions in the function along with their counts.
@@ -570,12 +570,24 @@ class CoverageMapping {
   std::vector<FunctionRecord> Functions;
   DenseMap<size_t, SmallVector<unsigned, 0>> FilenameHash2RecordIndices;
   std::vector<std::pair<std::string, uint64_t>> FuncHashMismatches;
+  /// The filenames of all function records.
+  StringSet<> Filenames;
+
+  /// A mapping record that is loaded, but not added yet.
+  struct PendingRecord;
 
   CoverageMapping() = default;
 
-  /// Add a function record corresponding to \p Record.
+  /// Look up the counters of \p Record and evaluate its regions into \p P,
+  /// unless it is a duplicate or has no profile. \p ProfileMu guards
+  /// \p ProfileReader, so records can be loaded concurrently.
   Error loadFunctionRecord(const CoverageMappingRecord &Record,
-                           IndexedInstrProfReader &ProfileReader);
+                           IndexedInstrProfReader &ProfileReader,
+                           std::mutex &ProfileMu, PendingRecord &P) const;
+
+  /// Add the function records of \p Pending in order, or return the first
+  /// error loading them.
+  Error addPendingRecords(MutableArrayRef<PendingRecord> Pending);
 
   /// Look up the indices for function records which are at least partially
   /// defined in the specified file. This is guaranteed to return a superset of
@@ -588,17 +600,18 @@ public:
   CoverageMapping(const CoverageMapping &) = delete;
   CoverageMapping &operator=(const CoverageMapping &) = delete;
 
-  /// Load the coverage mapping using the given readers.
+  /// Load the coverage mapping using the given readers. The records are
+  /// decoded and evaluated on \p NumThreads threads, 0 uses all cores.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<std::unique_ptr<CoverageMappingReader>> CoverageReaders,
-       IndexedInstrProfReader &ProfileReader);
+       IndexedInstrProfReader &ProfileReader, unsigned NumThreads = 1);
 
   /// Load the coverage mapping from the given object files and profile. If
   /// \p Arches is non-empty, it must specify an architecture for each object.
   /// Ignores non-instrumented object files unless all are not instrumented.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<StringRef> ObjectFilenames, StringRef ProfileFilename,
-       ArrayRef<StringRef> Arches = None);
+       ArrayRef<StringRef> Arches = None, unsigned NumThreads = 1);
 
   /// The number of functions that couldn't have their profiles mapped.
   ///
@@ -19,6 +19,7 @@
 #include "llvm/ProfileData/Coverage/CoverageMapping.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstddef>
 #include <cstdint>
@@ -98,6 +99,24 @@ public:
   virtual Error readNextRecord(CoverageMappingRecord &Record) = 0;
   CoverageMappingIterator begin() { return CoverageMappingIterator(this); }
   CoverageMappingIterator end() { return CoverageMappingIterator(); }
+
+  /// The storage a record decoded by readRecord refers to.
+  struct RecordBuffers {
+    std::vector<StringRef> Filenames;
+    std::vector<CounterExpression> Expressions;
+    std::vector<CounterMappingRegion> MappingRegions;
+  };
+
+  /// The number of records readRecord can decode, or 0 if the records can
+  /// only be read in order.
+  virtual size_t getNumRecords() const { return 0; }
+
+  /// Decode the record \p Index into \p Record, which refers to \p Buffers.
+  /// Calls with distinct buffers may run concurrently.
+  virtual Error readRecord(size_t Index, CoverageMappingRecord &Record,
+                           RecordBuffers &Buffers) const {
+    llvm_unreachable("The records can only be read in order");
+  }
 };
 
 /// Base class for the raw coverage mapping and filenames data readers.
@@ -181,9 +200,7 @@ private:
   std::vector<ProfileMappingRecord> MappingRecords;
   InstrProfSymtab ProfileNames;
   size_t CurrentRecord = 0;
-  std::vector<StringRef> FunctionsFilenames;
-  std::vector<CounterExpression> Expressions;
-  std::vector<CounterMappingRegion> MappingRegions;
+  RecordBuffers Buffers;
 
   // Used to tie the lifetimes of coverage function records to the lifetime of
   // this BinaryCoverageReader instance. Needed to support the format change in
@@ -212,6 +229,9 @@ public:
                                  support::endianness Endian);
 
   Error readNextRecord(CoverageMappingRecord &Record) override;
+  size_t getNumRecords() const override { return MappingRecords.size(); }
+  Error readRecord(size_t Index, CoverageMappingRecord &Record,
+                   RecordBuffers &Buffers) const override;
 };
 
 /// Reader for the raw coverage filenames.
@@ -206,7 +206,7 @@ private:
   uint64_t NamesDelta;
   const RawInstrProf::ProfileData<IntPtrT> *Data;
   const RawInstrProf::ProfileData<IntPtrT> *DataEnd;
-  const uint64_t *CountersStart;
+  const char *CountersStart;
   const char *NamesStart;
   uint64_t NamesSize;
   // After value profile is all read, this pointer points to
@@ -237,6 +237,12 @@ public:
     return (Version & VARIANT_MASK_INSTR_ENTRY) != 0;
   }
 
+  /// Returns true if the counters are single bytes that only record whether
+  /// a region was executed.
+  bool hasSingleByteCoverage() const {
+    return (Version & VARIANT_MASK_BYTE_COVERAGE) != 0;
+  }
+
   InstrProfSymtab &getSymtab() override {
     assert(Symtab.get());
     return *Symtab.get();
@@ -281,15 +287,26 @@ private:
       return (const char *)ValueDataStart;
   }
 
+  /// Get the size in bytes of one counter in the counters section.
+  size_t getCounterTypeSize() const {
+    return hasSingleByteCoverage() ? sizeof(uint8_t) : sizeof(uint64_t);
+  }
+
   /// Get the offset of \p CounterPtr from the start of the counters section of
   /// the profile. The offset has units of "number of counters", i.e. increasing
-  /// the offset by 1 corresponds to an increase in the *byte offset* by 8.
+  /// the offset by 1 corresponds to an increase in the *byte offset* by
+  /// getCounterTypeSize().
   ptrdiff_t getCounterOffset(IntPtrT CounterPtr) const {
-    return (swap(CounterPtr) - CountersDelta) / sizeof(uint64_t);
+    return (swap(CounterPtr) - CountersDelta) / getCounterTypeSize();
   }
 
-  const uint64_t *getCounter(ptrdiff_t Offset) const {
-    return CountersStart + Offset;
+  /// Get the execution count of the counter at \p Offset. A single byte
+  /// counter is cleared when its region is executed.
+  uint64_t getCounter(ptrdiff_t Offset) const {
+    const char *Ptr = CountersStart + Offset * getCounterTypeSize();
+    if (hasSingleByteCoverage())
+      return *Ptr == 0 ? 1 : 0;
+    return swap(*reinterpret_cast<const uint64_t *>(Ptr));
   }
 
   StringRef getName(uint64_t NameRef) const {
@@ -59,7 +59,8 @@ public:
     addRecord(std::move(I), 1, Warn);
   }
 
-  /// Merge existing function counts from the given writer.
+  /// Merge existing function counts from the given writer, which is left
+  /// empty.
   void mergeRecordsFromWriter(InstrProfWriter &&IPW,
                               function_ref<void(Error)> Warn);
 
@@ -648,6 +648,11 @@ protected:
   // placeholder for subclasses to dispatch their own section readers.
   virtual std::error_code readCustomSection(const SecHdrTableEntry &Entry) = 0;
   virtual ErrorOr<StringRef> readStringFromTable() override;
+  /// Return the MD5 at index \p Idx of a fixed length MD5 name table.
+  uint64_t getFixedLengthMD5(uint32_t Idx);
+  /// Return the name at index \p Idx of a fixed length MD5 name table. It is
+  /// converted to a string the first time it is used.
+  StringRef getFixedLengthMD5Name(uint32_t Idx);
 
   std::unique_ptr<ProfileSymbolList> ProfSymList;
 
@@ -45,6 +45,51 @@ void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
 
 } // end namespace detail
 
+/// A cache of the slabs that the BumpPtrAllocators using the MallocAllocator
+/// release on the current thread, to hand them out again when one of them
+/// starts a new slab of the same size.
+///
+/// A cache is installed on the thread that constructs it, until it is
+/// destroyed, which returns the slabs it still holds to malloc. Caches nest.
+/// The code generator installs one per module, so that the allocators of the
+/// machine functions and the SelectionDAG reuse their slabs from function to
+/// function instead of going through malloc for each of them.
+class SlabCache {
+public:
+  explicit SlabCache(size_t MaxCachedBytes = 32 * 1024 * 1024);
+  ~SlabCache();
+
+  SlabCache(const SlabCache &) = delete;
+  SlabCache &operator=(const SlabCache &) = delete;
+
+  /// The cache installed on the current thread, or null.
+  static SlabCache *getCurrent();
+
+  /// Returns a slab of \p Size bytes, reusing a released one if possible.
+  void *allocate(size_t Size);
+
+  /// Keeps the slab for reuse, or frees it if the cache is full.
+  void deallocate(void *Slab, size_t Size);
+
+  size_t getBytesAllocated() const { return BytesAllocated; }
+  size_t getBytesReused() const { return BytesReused; }
+
+private:
+  struct FreeSlab {
+    FreeSlab *Next;
+  };
+
+  /// Slabs of 4 KiB << I bytes, the sizes the BumpPtrAllocators grow through.
+  static constexpr unsigned NumSizeClasses = 12;
+  FreeSlab *FreeLists[NumSizeClasses] = {};
+
+  size_t MaxCachedBytes;
+  size_t CachedBytes = 0;
+  size_t BytesAllocated = 0;
+  size_t BytesReused = 0;
+  SlabCache *Prev;
+};
+
 /// Allocate memory in an ever growing pool, as if by bump-pointer.
 ///
 /// This isn't strictly a bump-pointer allocator as it uses backing slabs of
@@ -171,8 +216,7 @@ public:
     // If Size is really big, allocate a separate slab for it.
     size_t PaddedSize = SizeToAllocate + Alignment.value() - 1;
     if (PaddedSize > SizeThreshold) {
-      void *NewSlab =
-          AllocatorT::Allocate(PaddedSize, alignof(std::max_align_t));
+      void *NewSlab = allocateSlab(PaddedSize);
       // We own the new slab and don't want anyone reading anyting other than
       // pieces returned from this method.  So poison the whole slab.
       __asan_poison_memory_region(NewSlab, PaddedSize);
@@ -331,8 +375,7 @@ private:
   void StartNewSlab() {
     size_t AllocatedSlabSize = computeSlabSize(Slabs.size());
 
-    void *NewSlab =
-        AllocatorT::Allocate(AllocatedSlabSize, alignof(std::max_align_t));
+    void *NewSlab = allocateSlab(AllocatedSlabSize);
     // We own the new slab and don't want anyone reading anything other than
     // pieces returned from this method.  So poison the whole slab.
     __asan_poison_memory_region(NewSlab, AllocatedSlabSize);
@@ -348,7 +391,7 @@ private:
     for (; I != E; ++I) {
       size_t AllocatedSlabSize =
           computeSlabSize(std::distance(Slabs.begin(), I));
-      AllocatorT::Deallocate(*I, AllocatedSlabSize, alignof(std::max_align_t));
+      deallocateSlab(*I, AllocatedSlabSize);
     }
   }
 
@@ -357,10 +400,25 @@ private:
     for (auto &PtrAndSize : CustomSizedSlabs) {
       void *Ptr = PtrAndSize.first;
       size_t Size = PtrAndSize.second;
-      AllocatorT::Deallocate(Ptr, Size, alignof(std::max_align_t));
+      deallocateSlab(Ptr, Size);
     }
   }
 
+  /// Slabs from malloc go through the SlabCache installed on the thread.
+  void *allocateSlab(size_t Size) {
+    if (std::is_same<AllocatorT, MallocAllocator>::value)
+      if (SlabCache *Cache = SlabCache::getCurrent())
+        return Cache->allocate(Size);
+    return AllocatorT::Allocate(Size, alignof(std::max_align_t));
+  }
+
+  void deallocateSlab(void *Slab, size_t Size) {
+    if (std::is_same<AllocatorT, MallocAllocator>::value)
+      if (SlabCache *Cache = SlabCache::getCurrent())
+        return Cache->deallocate(Slab, Size);
+    AllocatorT::Deallocate(Slab, Size, alignof(std::max_align_t));
+  }
+
   template <typename T> friend class SpecificBumpPtrAllocator;
 };
 
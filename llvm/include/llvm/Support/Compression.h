@@ -32,6 +32,17 @@ bool isAvailable();
 Error compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
                int Level = DefaultCompression);
 
+/// Compress \p InputBuffer into a single zlib stream like compress(), but
+/// deflate chunks of \p ChunkSize bytes independently and in parallel. All
+/// but the last chunk end in a full flush, so the chunks can simply be
+/// concatenated. The result is slightly larger, but decompresses with any
+/// zlib implementation. An input of at most \p ChunkSize bytes is compressed
+/// exactly like compress() does.
+Error compressParallel(StringRef InputBuffer,
+                       SmallVectorImpl<char> &CompressedBuffer,
+                       int Level = DefaultCompression,
+                       size_t ChunkSize = 1 << 20);
+
 Error uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                  size_t &UncompressedSize);
 
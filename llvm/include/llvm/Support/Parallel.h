@@ -16,6 +16,7 @@
 #include "llvm/Support/Threading.h"
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -34,7 +35,7 @@ namespace detail {
 #if LLVM_ENABLE_THREADS
 
 class Latch {
-  uint32_t Count;
+  std::atomic<uint32_t> Count;
   mutable std::mutex Mutex;
   mutable std::condition_variable Cond;
 
@@ -42,10 +43,7 @@ public:
   explicit Latch(uint32_t Count = 0) : Count(Count) {}
   ~Latch() { sync(); }
 
-  void inc() {
-    std::lock_guard<std::mutex> lock(Mutex);
-    ++Count;
-  }
+  void inc() { ++Count; }
 
   void dec() {
     std::lock_guard<std::mutex> lock(Mutex);
@@ -53,6 +51,8 @@ public:
       Cond.notify_all();
   }
 
+  bool isDone() const { return Count == 0; }
+
   void sync() const {
     std::unique_lock<std::mutex> lock(Mutex);
     Cond.wait(lock, [&] { return Count == 0; });
@@ -69,7 +69,9 @@ public:
 
   void spawn(std::function<void()> f);
 
-  void sync() const { L.sync(); }
+  /// Waits for the spawned tasks, running pending tasks on the calling thread
+  /// in the meantime.
+  void sync() const;
 };
 
 const ptrdiff_t MinParallelSize = 1024;
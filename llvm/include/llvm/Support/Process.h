@@ -75,6 +75,10 @@ public:
   /// allocated space.
   static size_t GetMallocUsage();
 
+  /// Return the peak resident set size of the process in bytes, or 0 if the
+  /// operating system doesn't report it.
+  static size_t GetPeakResidentSetSize();
+
   /// This static function will set \p user_time to the amount of CPU time
   /// spent in user (non-kernel) mode and \p sys_time to the amount of CPU
   /// time spent in system (kernel) mode.  If the operating system does not
@@ -13,6 +13,9 @@
 #ifndef LLVM_TABLEGEN_MAIN_H
 #define LLVM_TABLEGEN_MAIN_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include <functional>
+
 namespace llvm {
 
 class raw_ostream;
@@ -24,6 +27,12 @@ using TableGenMainFn = bool (raw_ostream &OS, RecordKeeper &Records);
 
 int TableGenMain(const char *argv0, TableGenMainFn *MainFn);
 
+/// Perform each of the Actions in turn, using the Records of a single parse of
+/// the input, so that several files are generated for the cost of one parse.
+/// The output of the I-th action is written to the I-th output file (-o).
+int TableGenMain(const char *argv0,
+                 ArrayRef<std::function<TableGenMainFn>> Actions);
+
 } // end namespace llvm
 
 #endif // LLVM_TABLEGEN_MAIN_H
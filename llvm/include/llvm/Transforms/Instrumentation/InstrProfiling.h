@@ -83,6 +83,10 @@ private:
   /// Returns true if profile counter update register promotion is enabled.
   bool isCounterPromotionEnabled() const;
 
+  /// Returns true if the counters are single bytes that only record whether
+  /// a region was executed.
+  bool isByteCoverageEnabled() const;
+
   /// Count the number of instrumented value sites for the function.
   void computeNumValueSiteCounts(InstrProfValueProfileInst *Ins);
 
@@ -117,6 +121,9 @@ private:
   /// Add uses of our data variables and runtime hook.
   void emitUses();
 
+  /// Mark the raw profile version as using single byte counters.
+  void emitByteCoverageFlag();
+
   /// Create a static initializer for our data, on platforms that need it,
   /// and for any profile output file that was specified.
   void emitInitialization();
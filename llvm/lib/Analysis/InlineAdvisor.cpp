@@ -13,6 +13,7 @@
 
 #include "llvm/Analysis/InlineAdvisor.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
 #include "llvm/Analysis/InlineCost.h"
 #include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/ProfileSummaryInfo.h"
@@ -20,6 +21,7 @@
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
@@ -33,6 +35,8 @@ using namespace llvm;
 // to inline a function A into B, we analyze the callers of B in order to see
 // if those would be more profitable and blocked inline steps.
 STATISTIC(NumCallerCallersAnalyzed, "Number of caller-callers analyzed");
+STATISTIC(NumHotCodeBudgetRejected,
+          "Number of hot call sites not inlined to fit the hot code budget");
 
 /// Flag to add inline messages as callsite attributes 'inline-remark'.
 static cl::opt<bool>
@@ -49,6 +53,17 @@ static cl::opt<int>
                         cl::desc("Scale to limit the cost of inline deferral"),
                         cl::init(2), cl::Hidden);
 
+// The hot code of a module, as determined from the profile, should fit into
+// a small instruction cache shared by many cores. Without a profile there is
+// no budget.
+static cl::opt<unsigned> InlineHotCodeBudget(
+    "inline-hot-code-budget", cl::Hidden,
+    cl::desc("Size in bytes the hot code of a module should fit into, "
+             "overrides the default of the target. 0 disables the budget"));
+
+// Code size estimates are in instructions, assume the common 4-byte encoding.
+static const unsigned HotCodeBytesPerInst = 4;
+
 extern cl::opt<InlinerFunctionImportStatsOpts> InlinerFunctionImportStats;
 
 void DefaultInlineAdvice::recordUnsuccessfulInliningImpl(
@@ -72,6 +87,10 @@ void DefaultInlineAdvice::recordInliningWithCalleeDeletedImpl() {
 void DefaultInlineAdvice::recordInliningImpl() {
   if (EmitRemarks)
     emitInlinedInto(ORE, DLoc, Block, *Callee, *Caller, *OIC);
+  // The callee stays around, its code now exists twice.
+  if (HotCodeGrowth)
+    static_cast<DefaultInlineAdvisor *>(Advisor)->recordHotCodeGrowth(
+        *OIC, HotCodeGrowth);
 }
 
 llvm::Optional<llvm::InlineCost> static getDefaultInlineAdvice(
@@ -109,9 +128,98 @@ llvm::Optional<llvm::InlineCost> static getDefaultInlineAdvice(
 std::unique_ptr<InlineAdvice>
 DefaultInlineAdvisor::getAdviceImpl(CallBase &CB) {
   auto OIC = getDefaultInlineAdvice(CB, FAM, Params);
+  unsigned HotCodeGrowth = 0;
+  if (OIC && !OIC->isAlways() && isHotCodeBudgetCallSite(CB)) {
+    HotCodeGrowth = getCodeSize(*CB.getCalledFunction());
+    if (!fitsHotCodeBudget(CB, *OIC, HotCodeGrowth))
+      OIC = None;
+  }
   return std::make_unique<DefaultInlineAdvice>(
       this, CB, OIC,
-      FAM.getResult<OptimizationRemarkEmitterAnalysis>(*CB.getCaller()));
+      FAM.getResult<OptimizationRemarkEmitterAnalysis>(*CB.getCaller()),
+      /*EmitRemarks=*/true, HotCodeGrowth);
+}
+
+unsigned DefaultInlineAdvisor::getCodeSize(Function &F) {
+  auto &TTI = FAM.getResult<TargetIRAnalysis>(F);
+  unsigned Size = 0;
+  for (Instruction &I : instructions(F))
+    Size += TTI.getUserCost(&I, TargetTransformInfo::TCK_CodeSize);
+  return Size * HotCodeBytesPerInst;
+}
+
+bool DefaultInlineAdvisor::isHotCodeBudgetCallSite(CallBase &CB) {
+  Function &Caller = *CB.getCaller();
+  ProfileSummaryInfo *PSI =
+      FAM.getResult<ModuleAnalysisManagerFunctionProxy>(Caller)
+          .getCachedResult<ProfileSummaryAnalysis>(M);
+  if (!PSI || !PSI->hasProfileSummary())
+    return false;
+
+  if (!HotCodeBudget) {
+    HotCodeBudget = InlineHotCodeBudget.getNumOccurrences()
+                        ? InlineHotCodeBudget
+                        : FAM.getResult<TargetIRAnalysis>(Caller)
+                              .getInliningHotCodeBudget();
+    // The hot code to start with is the one of the functions that are hot in
+    // the profile.
+    if (*HotCodeBudget)
+      for (Function &F : M)
+        if (!F.isDeclaration() &&
+            PSI->isFunctionHotInCallGraph(
+                &F, FAM.getResult<BlockFrequencyAnalysis>(F)))
+          HotCodeSize += getCodeSize(F);
+    LLVM_DEBUG(dbgs() << "Hot code budget " << *HotCodeBudget << ", hot code "
+                      << HotCodeSize << "\n");
+  }
+  if (!*HotCodeBudget)
+    return false;
+
+  // Inlining the only call of a local function moves its code instead of
+  // copying it.
+  Function *Callee = CB.getCalledFunction();
+  if (Callee->hasLocalLinkage() && Callee->hasOneUse())
+    return false;
+  return PSI->isHotCallSite(CB, &FAM.getResult<BlockFrequencyAnalysis>(Caller));
+}
+
+bool DefaultInlineAdvisor::fitsHotCodeBudget(CallBase &CB,
+                                             const InlineCost &IC,
+                                             unsigned Bytes) {
+  // The inliner walks the call graph bottom-up, it cannot sort all call
+  // sites by benefit. Once half the budget is used up, only admit call sites
+  // that save at least as much per byte as the ones inlined so far did on
+  // average.
+  const char *Reason = nullptr;
+  if (HotCodeSize + Bytes > *HotCodeBudget)
+    Reason = "hot code budget exhausted";
+  else if (2 * HotCodeSize > *HotCodeBudget && InlinedHotBytes &&
+           int64_t(IC.getCostDelta()) * int64_t(InlinedHotBytes) <
+               InlinedHotBenefit * int64_t(Bytes))
+    Reason = "benefit per byte below average of the hot code budget";
+  if (!Reason)
+    return true;
+
+  ++NumHotCodeBudgetRejected;
+  LLVM_DEBUG(dbgs() << "Not inlining " << CB << ": " << Reason << "\n");
+  using namespace ore;
+  OptimizationRemarkEmitter &ORE = getCallerORE(CB);
+  ORE.emit([&]() {
+    return OptimizationRemarkMissed(DEBUG_TYPE, "HotCodeBudget", &CB)
+           << NV("Callee", CB.getCalledFunction())
+           << " will not be inlined into " << NV("Caller", CB.getCaller())
+           << ": " << NV("Reason", Reason) << " (" << NV("HotCodeSize", HotCodeSize) << " + "
+           << NV("Bytes", Bytes) << " of " << NV("Budget", *HotCodeBudget)
+           << " bytes)";
+  });
+  return false;
+}
+
+void DefaultInlineAdvisor::recordHotCodeGrowth(const InlineCost &IC,
+                                               unsigned Bytes) {
+  HotCodeSize += Bytes;
+  InlinedHotBytes += Bytes;
+  InlinedHotBenefit += IC.getCostDelta();
 }
 
 InlineAdvice::InlineAdvice(InlineAdvisor *Advisor, CallBase &CB,
@@ -147,6 +147,13 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumSCEVCacheHits, "Number of getSCEV queries answered from cache");
+STATISTIC(NumTripCountCacheHits,
+          "Number of backedge-taken count queries answered from cache");
+STATISTIC(NumLoopDispositionsKept,
+          "Number of loop dispositions kept by forgetLoopDispositions");
+STATISTIC(NumLoopDispositionsForgotten,
+          "Number of loop dispositions dropped by forgetLoopDispositions");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -3869,7 +3876,9 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
 
   const SCEV *S = getExistingSCEV(V);
-  if (S == nullptr) {
+  if (S) {
+    ++NumSCEVCacheHits;
+  } else {
     S = createSCEV(V);
     // During PHI resolution, it is possible to create two SCEVs for the same
     // V, so it is needed to double check whether V->S is inserted into
@@ -6961,8 +6970,10 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
       BackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
-  if (!Pair.second)
+  if (!Pair.second) {
+    ++NumTripCountCacheHits;
     return Pair.first->second;
+  }
 
   // computeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
@@ -7176,7 +7187,27 @@ void ScalarEvolution::forgetValue(Value *V) {
 }
 
 void ScalarEvolution::forgetLoopDispositions(const Loop *L) {
-  LoopDispositions.clear();
+  // Callers move instructions between L, its preheader and its exit blocks.
+  // This only changes whether an instruction is contained in the loops of the
+  // nest around L, the dispositions with respect to all other loops stay
+  // valid.
+  const Loop *Outermost = L;
+  while (const Loop *Parent = Outermost->getParentLoop())
+    Outermost = Parent;
+
+  for (auto I = LoopDispositions.begin(), E = LoopDispositions.end(); I != E;) {
+    auto &Values = I->second;
+    unsigned Before = Values.size();
+    llvm::erase_if(Values, [&](const auto &Entry) {
+      return Entry.getPointer() && Outermost->contains(Entry.getPointer());
+    });
+    NumLoopDispositionsForgotten += Before - Values.size();
+    NumLoopDispositionsKept += Values.size();
+    auto Next = std::next(I);
+    if (Values.empty())
+      LoopDispositions.erase(I);
+    I = Next;
+  }
 }
 
 /// Get the exact loop backedge taken count considering all loop exits. A
@@ -70,6 +70,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -92,12 +93,34 @@ static cl::opt<bool> PrintSummaryGUIDs(
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> DecodeFunctionBodyThreads(
+    "bitcode-decode-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads decoding the function bodies of a module "
+             "ahead of materializing all of it, 0 uses all cores"));
+
 namespace {
 
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
 };
 
+/// The top-level entries of a function block, decoded without touching the
+/// LLVMContext so that it can be done on another thread. Nested blocks are
+/// only located, they are parsed when the function body is.
+struct DecodedFunctionBody {
+  struct Entry {
+    decltype(BitstreamEntry::Kind) Kind;
+    /// The code of a record or the ID of a nested block.
+    unsigned ID;
+    /// The position of a nested block, after its ID.
+    uint64_t BitNo;
+    /// The operands of a record in Ops.
+    size_t OpsBegin, OpsEnd;
+  };
+  std::vector<Entry> Entries;
+  SmallVector<uint64_t, 0> Ops;
+};
+
 } // end anonymous namespace
 
 static Error error(const Twine &Message) {
@@ -536,6 +559,10 @@ class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// The bodies of deferred functions decoded ahead of time by
+  /// decodeFunctionBodies.
+  DenseMap<Function *, DecodedFunctionBody> DecodedFunctionBodies;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -754,6 +781,7 @@ private:
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
   Error parseFunctionBody(Function *F);
+  void decodeFunctionBodies(unsigned NumThreads);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
@@ -3835,11 +3863,53 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
 
   std::vector<OperandBundleDef> OperandBundles;
 
+  // Take the records from the decoded body if there is one, the stream is
+  // then only used for nested blocks.
+  DecodedFunctionBody Decoded;
+  auto DecodedIt = DecodedFunctionBodies.find(F);
+  bool IsDecoded = DecodedIt != DecodedFunctionBodies.end();
+  if (IsDecoded) {
+    Decoded = std::move(DecodedIt->second);
+    DecodedFunctionBodies.erase(DecodedIt);
+  }
+  size_t NextEntry = 0;
+  auto advance = [&]() -> Expected<BitstreamEntry> {
+    if (!IsDecoded)
+      return Stream.advance();
+    if (NextEntry == Decoded.Entries.size())
+      return BitstreamEntry::getError();
+    const DecodedFunctionBody::Entry &E = Decoded.Entries[NextEntry];
+    switch (E.Kind) {
+    case BitstreamEntry::SubBlock:
+      if (Error Err = Stream.JumpToBit(E.BitNo))
+        return std::move(Err);
+      ++NextEntry;
+      return BitstreamEntry::getSubBlock(E.ID);
+    case BitstreamEntry::EndBlock:
+      ++NextEntry;
+      if (Stream.ReadBlockEnd())
+        return BitstreamEntry::getError();
+      return BitstreamEntry::getEndBlock();
+    default:
+      // The entry is consumed by readRecord.
+      return BitstreamEntry::getRecord(NextEntry);
+    }
+  };
+  auto readRecord = [&](unsigned ID,
+                        SmallVectorImpl<uint64_t> &Vals) -> Expected<unsigned> {
+    if (!IsDecoded)
+      return Stream.readRecord(ID, Vals);
+    const DecodedFunctionBody::Entry &E = Decoded.Entries[NextEntry++];
+    Vals.append(Decoded.Ops.begin() + E.OpsBegin,
+                Decoded.Ops.begin() + E.OpsEnd);
+    return E.ID;
+  };
+
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
 
   while (true) {
-    Expected<llvm::BitstreamEntry> MaybeEntry = Stream.advance();
+    Expected<llvm::BitstreamEntry> MaybeEntry = advance();
     if (!MaybeEntry)
       return MaybeEntry.takeError();
     llvm::BitstreamEntry Entry = MaybeEntry.get();
@@ -3891,7 +3961,7 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     Record.clear();
     Instruction *I = nullptr;
     Type *FullTy = nullptr;
-    Expected<unsigned> MaybeBitCode = Stream.readRecord(Entry.ID, Record);
+    Expected<unsigned> MaybeBitCode = readRecord(Entry.ID, Record);
     if (!MaybeBitCode)
       return MaybeBitCode.takeError();
     switch (unsigned BitCode = MaybeBitCode.get()) {
@@ -5510,6 +5580,93 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   return materializeForwardReferencedFunctions();
 }
 
+/// Decode the function block at \p BitNo into \p Body.
+static Error decodeFunctionBody(BitstreamCursor &Cursor, uint64_t BitNo,
+                                DecodedFunctionBody &Body) {
+  if (Error Err = Cursor.JumpToBit(BitNo))
+    return Err;
+  if (Error Err = Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+    return Err;
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    Expected<BitstreamEntry> MaybeEntry = Cursor.advance();
+    if (!MaybeEntry)
+      return MaybeEntry.takeError();
+    BitstreamEntry Entry = MaybeEntry.get();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      Body.Entries.push_back({Entry.Kind, 0, 0, 0, 0});
+      return Error::success();
+    case BitstreamEntry::SubBlock:
+      Body.Entries.push_back(
+          {Entry.Kind, Entry.ID, Cursor.GetCurrentBitNo(), 0, 0});
+      if (Error Err = Cursor.SkipBlock())
+        return Err;
+      continue;
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    Expected<unsigned> MaybeBitCode = Cursor.readRecord(Entry.ID, Record);
+    if (!MaybeBitCode)
+      return MaybeBitCode.takeError();
+    size_t OpsBegin = Body.Ops.size();
+    Body.Ops.append(Record.begin(), Record.end());
+    Body.Entries.push_back(
+        {Entry.Kind, MaybeBitCode.get(), 0, OpsBegin, Body.Ops.size()});
+  }
+}
+
+/// Decode the bodies of all deferred functions whose position is known on
+/// \p NumThreads threads. Decoding only reads the bitcode, the IR is still
+/// built by materialize on this thread. A body that fails to decode is left
+/// to materialize, which reports the error.
+void BitcodeReader::decodeFunctionBodies(unsigned NumThreads) {
+  std::vector<std::pair<Function *, uint64_t>> Bodies;
+  for (Function &F : *TheModule) {
+    auto DFII = DeferredFunctionInfo.find(&F);
+    if (F.isMaterializable() && DFII != DeferredFunctionInfo.end() &&
+        DFII->second && !DecodedFunctionBodies.count(&F))
+      Bodies.emplace_back(&F, DFII->second);
+  }
+  if (Bodies.size() < 2)
+    return;
+
+  // Each task decodes a contiguous range of bodies with its own cursor. The
+  // block info is only read while entering blocks.
+  ThreadPool Pool(hardware_concurrency(NumThreads));
+  unsigned NumTasks = std::min<size_t>(Pool.getThreadCount(), Bodies.size());
+  std::vector<DecodedFunctionBody> Decoded(Bodies.size());
+  std::vector<uint8_t> Failed(Bodies.size());
+  for (unsigned Task = 0; Task != NumTasks; ++Task) {
+    size_t Begin = Bodies.size() * Task / NumTasks;
+    size_t End = Bodies.size() * (Task + 1) / NumTasks;
+    Pool.async([&, Begin, End]() {
+      BitstreamCursor Cursor(Stream.getBitcodeBytes());
+      Cursor.setBlockInfo(&BlockInfo);
+      for (size_t I = Begin; I != End; ++I)
+        if (Error Err = decodeFunctionBody(Cursor, Bodies[I].second,
+                                           Decoded[I])) {
+          consumeError(std::move(Err));
+          Failed[I] = true;
+          // The cursor may be left in a nested block.
+          Cursor = BitstreamCursor(Stream.getBitcodeBytes());
+          Cursor.setBlockInfo(&BlockInfo);
+        }
+    });
+  }
+  Pool.wait();
+
+  for (size_t I = 0, E = Bodies.size(); I != E; ++I)
+    if (!Failed[I])
+      DecodedFunctionBodies[Bodies[I].first] = std::move(Decoded[I]);
+}
+
 Error BitcodeReader::materializeModule() {
   if (Error Err = materializeMetadata())
     return Err;
@@ -5517,6 +5674,9 @@ Error BitcodeReader::materializeModule() {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  if (DecodeFunctionBodyThreads != 1)
+    decodeFunctionBodies(DecodeFunctionBodyThreads);
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
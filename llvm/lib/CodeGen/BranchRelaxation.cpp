@@ -26,6 +26,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
 #include <cassert>
 #include <cstdint>
 #include <iterator>
@@ -93,6 +94,8 @@ class BranchRelaxation : public MachineFunctionPass {
   MachineBasicBlock *splitBlockBeforeInstr(MachineInstr &MI,
                                            MachineBasicBlock *DestBB);
   void adjustBlockOffsets(MachineBasicBlock &Start);
+  int64_t getBranchDistance(const MachineInstr &MI,
+                            const MachineBasicBlock &DestBB) const;
   bool isBlockInRange(const MachineInstr &MI, const MachineBasicBlock &BB) const;
 
   bool fixupConditionalBranch(MachineInstr &MI);
@@ -209,6 +212,11 @@ MachineBasicBlock *BranchRelaxation::createNewBlockAfter(MachineBasicBlock &BB)
       MF->CreateMachineBasicBlock(BB.getBasicBlock());
   MF->insert(++BB.getIterator(), NewBB);
 
+  // The new block belongs to the section of BB, which it may now end.
+  NewBB->setSectionID(BB.getSectionID());
+  NewBB->setIsEndSection(BB.isEndSection());
+  BB.setIsEndSection(false);
+
   // Insert an entry into BlockInfo to align it properly with the block numbers.
   BlockInfo.insert(BlockInfo.begin() + NewBB->getNumber(), BasicBlockInfo());
 
@@ -226,6 +234,9 @@ MachineBasicBlock *BranchRelaxation::splitBlockBeforeInstr(MachineInstr &MI,
   MachineBasicBlock *NewBB =
       MF->CreateMachineBasicBlock(OrigBB->getBasicBlock());
   MF->insert(++OrigBB->getIterator(), NewBB);
+  NewBB->setSectionID(OrigBB->getSectionID());
+  NewBB->setIsEndSection(OrigBB->isEndSection());
+  OrigBB->setIsEndSection(false);
 
   // Splice the instructions starting with MI over to NewBB.
   NewBB->splice(NewBB->end(), OrigBB, MI.getIterator(), OrigBB->end());
@@ -270,21 +281,42 @@ MachineBasicBlock *BranchRelaxation::splitBlockBeforeInstr(MachineInstr &MI,
   return NewBB;
 }
 
+/// getBranchDistance - Returns the displacement the branch MI needs to reach
+/// DestBB.
+int64_t BranchRelaxation::getBranchDistance(
+    const MachineInstr &MI, const MachineBasicBlock &DestBB) const {
+  // The sections of a function are placed independently of each other by the
+  // linker, a branch into another section must be able to reach as far as
+  // the code model allows.
+  if (MI.getParent()->getSectionID() != DestBB.getSectionID()) {
+    switch (MF->getTarget().getCodeModel()) {
+    case CodeModel::Tiny:
+      return maxIntN(20);
+    case CodeModel::Large:
+      return maxIntN(63);
+    default:
+      return maxIntN(31);
+    }
+  }
+
+  int64_t BrOffset = getInstrOffset(MI);
+  int64_t DestOffset = BlockInfo[DestBB.getNumber()].Offset;
+  return DestOffset - BrOffset;
+}
+
 /// isBlockInRange - Returns true if the distance between specific MI and
 /// specific BB can fit in MI's displacement field.
 bool BranchRelaxation::isBlockInRange(
   const MachineInstr &MI, const MachineBasicBlock &DestBB) const {
-  int64_t BrOffset = getInstrOffset(MI);
-  int64_t DestOffset = BlockInfo[DestBB.getNumber()].Offset;
+  int64_t Distance = getBranchDistance(MI, DestBB);
 
-  if (TII->isBranchOffsetInRange(MI.getOpcode(), DestOffset - BrOffset))
+  if (TII->isBranchOffsetInRange(MI.getOpcode(), Distance))
     return true;
 
   LLVM_DEBUG(dbgs() << "Out of range branch to destination "
                     << printMBBReference(DestBB) << " from "
-                    << printMBBReference(*MI.getParent()) << " to "
-                    << DestOffset << " offset " << DestOffset - BrOffset << '\t'
-                    << MI);
+                    << printMBBReference(*MI.getParent()) << " offset "
+                    << Distance << '\t' << MI);
 
   return false;
 }
@@ -436,10 +468,9 @@ bool BranchRelaxation::fixupUnconditionalBranch(MachineInstr &MI) {
   unsigned OldBrSize = TII->getInstSizeInBytes(MI);
   MachineBasicBlock *DestBB = TII->getBranchDestBlock(MI);
 
-  int64_t DestOffset = BlockInfo[DestBB->getNumber()].Offset;
-  int64_t SrcOffset = getInstrOffset(MI);
+  int64_t Distance = getBranchDistance(MI, *DestBB);
 
-  assert(!TII->isBranchOffsetInRange(MI.getOpcode(), DestOffset - SrcOffset));
+  assert(!TII->isBranchOffsetInRange(MI.getOpcode(), Distance));
 
   BlockInfo[MBB->getNumber()].Size -= OldBrSize;
 
@@ -464,7 +495,7 @@ bool BranchRelaxation::fixupUnconditionalBranch(MachineInstr &MI) {
   DebugLoc DL = MI.getDebugLoc();
   MI.eraseFromParent();
   BlockInfo[BranchBB->getNumber()].Size += TII->insertIndirectBranch(
-    *BranchBB, *DestBB, DL, DestOffset - SrcOffset, RS.get());
+    *BranchBB, *DestBB, DL, Distance, RS.get());
 
   adjustBlockOffsets(*MBB);
   return true;
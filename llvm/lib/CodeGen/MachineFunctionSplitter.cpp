@@ -32,6 +32,8 @@
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/TargetInstrInfo.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
 #include "llvm/InitializePasses.h"
@@ -120,6 +122,7 @@ bool MachineFunctionSplitter::runOnMachineFunction(MachineFunction &MF) {
   MF.setBBSectionsType(BasicBlockSection::Preset);
   auto *MBFI = &getAnalysis<MachineBlockFrequencyInfo>();
   auto *PSI = &getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+  const TargetInstrInfo &TII = *MF.getSubtarget().getInstrInfo();
 
   for (auto &MBB : MF) {
     // FIXME: We retain the entry block and conservatively keep all landing pad
@@ -127,7 +130,7 @@ bool MachineFunctionSplitter::runOnMachineFunction(MachineFunction &MF) {
     // improve the handling of ehpads.
     if ((MBB.pred_empty() || MBB.isEHPad()))
       continue;
-    if (isColdBlock(MBB, MBFI, PSI))
+    if (isColdBlock(MBB, MBFI, PSI) && TII.isMBBSafeToSplitToCold(MBB))
       MBB.setSectionID(MBBSectionID::ColdSectionID);
   }
 
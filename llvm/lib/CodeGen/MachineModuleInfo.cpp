@@ -318,6 +318,7 @@ INITIALIZE_PASS(MachineModuleInfoWrapperPass, "machinemoduleinfo",
 char MachineModuleInfoWrapperPass::ID = 0;
 
 bool MachineModuleInfoWrapperPass::doInitialization(Module &M) {
+  Slabs.emplace();
   MMI.initialize();
   MMI.TheModule = &M;
   MMI.DbgInfoAvailable = !M.debug_compile_units().empty();
@@ -326,6 +327,7 @@ bool MachineModuleInfoWrapperPass::doInitialization(Module &M) {
 
 bool MachineModuleInfoWrapperPass::doFinalization(Module &M) {
   MMI.finalize();
+  Slabs.reset();
   return false;
 }
 
@@ -72,6 +72,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <queue>
 #include <tuple>
@@ -84,6 +85,10 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumOverBudget,   "Number of functions exceeding the split and "
+                           "evict budget");
+STATISTIC(NumBudgetEvicts, "Number of evictions skipped over budget");
+STATISTIC(NumBudgetSplits, "Number of splits simplified over budget");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -136,6 +141,18 @@ static cl::opt<bool> ConsiderLocalIntervalCost(
              "candidate when choosing the best split candidate."),
     cl::init(false));
 
+static cl::opt<unsigned> HugeFunctionSize(
+    "regalloc-budget-min-instrs", cl::Hidden,
+    cl::desc("Limit the splitting and eviction work in functions with at "
+             "least this many instructions (0 = never)"),
+    cl::init(100000));
+
+static cl::opt<unsigned> WorkBudgetPerInstr(
+    "regalloc-budget-per-instr", cl::Hidden,
+    cl::desc("Splitting and eviction work allowed per instruction in a "
+             "function over regalloc-budget-min-instrs"),
+    cl::init(16));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -406,6 +423,13 @@ class RAGreedy : public MachineFunctionPass,
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
+  /// The splitting and eviction work left for the current function. Region
+  /// splitting and eviction chains are superlinear in the size of the
+  /// function, so huge functions fall back to block, instruction splitting
+  /// and spilling once it runs out.
+  uint64_t WorkBudget;
+  bool OverBudget;
+
 public:
   RAGreedy();
 
@@ -520,6 +544,7 @@ private:
                                SmallVirtRegSet &, unsigned);
   void tryHintRecoloring(LiveInterval &);
   void tryHintsRecoloring();
+  bool spendWorkBudget(uint64_t Work);
 
   /// Model the information carried by one end of a copy.
   struct HintInfo {
@@ -2458,9 +2483,15 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
     NamedRegionTimer T("local_split", "Local Splitting", TimerGroupName,
                        TimerGroupDescription, TimePassesIsEnabled);
     SA->analyze(&VirtReg);
-    Register PhysReg = tryLocalSplit(VirtReg, Order, NewVRegs);
-    if (PhysReg || !NewVRegs.empty())
-      return PhysReg;
+    // Local splitting is quadratic in the number of uses, splitting around
+    // instructions is cheap.
+    if (spendWorkBudget(SA->getUseSlots().size())) {
+      Register PhysReg = tryLocalSplit(VirtReg, Order, NewVRegs);
+      if (PhysReg || !NewVRegs.empty())
+        return PhysReg;
+    } else {
+      ++NumBudgetSplits;
+    }
     return tryInstructionSplit(VirtReg, Order, NewVRegs);
   }
 
@@ -2484,9 +2515,15 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   // ranges already made dubious progress with region splitting, so they go
   // straight to single block splitting.
   if (getStage(VirtReg) < RS_Split2) {
-    MCRegister PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
-    if (PhysReg || !NewVRegs.empty())
-      return PhysReg;
+    if (spendWorkBudget(uint64_t(SA->getUseBlocks().size() +
+                                 SA->getNumThroughBlocks()) *
+                        Order.getOrder().size())) {
+      MCRegister PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
+      if (PhysReg || !NewVRegs.empty())
+        return PhysReg;
+    } else {
+      ++NumBudgetSplits;
+    }
   }
 
   // Then isolate blocks.
@@ -3020,6 +3057,22 @@ void RAGreedy::tryHintsRecoloring() {
   }
 }
 
+/// Spend \p Work units of the splitting and eviction budget of the function.
+/// \return false if the budget is exhausted, the work should not be done.
+bool RAGreedy::spendWorkBudget(uint64_t Work) {
+  if (OverBudget)
+    return false;
+  if (Work <= WorkBudget) {
+    WorkBudget -= Work;
+    return true;
+  }
+  LLVM_DEBUG(dbgs() << "Split and evict budget exhausted in " << MF->getName()
+                    << '\n');
+  ++NumOverBudget;
+  OverBudget = true;
+  return false;
+}
+
 MCRegister RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
                                        SmallVectorImpl<Register> &NewVRegs,
                                        SmallVirtRegSet &FixedRegisters,
@@ -3054,7 +3107,12 @@ MCRegister RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
   // Try to evict a less worthy live range, but only for ranges from the primary
   // queue. The RS_Split ranges already failed to do this, and they should not
   // get a second chance until they have been split.
-  if (Stage != RS_Split)
+  bool MayEvict = Stage != RS_Split;
+  if (MayEvict && !spendWorkBudget(Order.getOrder().size())) {
+    ++NumBudgetEvicts;
+    MayEvict = false;
+  }
+  if (MayEvict)
     if (Register PhysReg =
             tryEvict(VirtReg, Order, NewVRegs, CostPerUseLimit,
                      FixedRegisters)) {
@@ -3257,6 +3315,12 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   SetOfBrokenHints.clear();
   LastEvicted.clear();
 
+  WorkBudget = std::numeric_limits<uint64_t>::max();
+  OverBudget = false;
+  unsigned NumInstrs = MF->getInstructionCount();
+  if (HugeFunctionSize && NumInstrs >= HugeFunctionSize)
+    WorkBudget = uint64_t(NumInstrs) * WorkBudgetPerInstr;
+
   allocatePhysRegs();
   tryHintsRecoloring();
   postOptimization();
@@ -1195,6 +1195,8 @@ void TargetPassConfig::addMachinePasses() {
     addPass(llvm::createBasicBlockSectionsPass(TM->getBBSectionsFuncListBuf()));
   }
 
+  addPostBBSections();
+
   // Add passes that directly emit MI after all other MI passes.
   addPreEmitPass2();
 
@@ -237,6 +237,16 @@ bool XRayInstrumentation::runOnMachineFunction(MachineFunction &MF) {
       prependRetWithPatchableExit(MF, TII, op);
       break;
     }
+    case Triple::ArchType::riscv32:
+    case Triple::ArchType::riscv64: {
+      // RISC-V returns and tail calls are both return instructions. Give the
+      // tail calls their own sled kind so that the runtime can tell them apart.
+      InstrumentationOptions op;
+      op.HandleTailcall = true;
+      op.HandleAllReturns = true;
+      prependRetWithPatchableExit(MF, TII, op);
+      break;
+    }
     case Triple::ArchType::ppc64le: {
       // PPC has conditional returns. Turn them into branch and plain returns.
       InstrumentationOptions op;
@@ -2387,13 +2387,14 @@ bool DWARFLinker::link() {
     if (!OptContext.File.Dwarf)
       continue;
 
-    // In a first phase, just read in the debug info and load all clang modules.
+    // In a first phase, just read in the unit DIEs and load all clang
+    // modules. The other DIEs are parsed when the object is analyzed.
     OptContext.CompileUnits.reserve(
         OptContext.File.Dwarf->getNumCompileUnits());
 
     for (const auto &CU : OptContext.File.Dwarf->compile_units()) {
       updateDwarfVersion(CU->getVersion());
-      auto CUDie = CU->getUnitDIE(false);
+      auto CUDie = CU->getUnitDIE();
       if (Options.Verbose) {
         outs() << "Input compilation unit:";
         DIDumpOptions DumpOpts;
@@ -2578,7 +2579,19 @@ bool DWARFLinker::link() {
     }
     EmitLambda();
   } else {
-    ThreadPool Pool(hardware_concurrency(2));
+    ThreadPool Pool(hardware_concurrency(Options.Threads));
+    // Parsing the DIEs is a large part of the analysis and only touches the
+    // object file itself, so do it for all objects in parallel first.
+    for (LinkContext &OptContext : ObjectContexts) {
+      if (OptContext.Skip || !OptContext.File.Dwarf)
+        continue;
+      Pool.async([&OptContext]() {
+        for (const auto &CU : OptContext.File.Dwarf->compile_units())
+          CU->getUnitDIE(false);
+      });
+    }
+    Pool.wait();
+
     Pool.async(AnalyzeAll);
     Pool.async(CloneAll);
     Pool.wait();
@@ -64,13 +64,13 @@ Expected<DILineInfo>
 LLVMSymbolizer::symbolizeCode(const ObjectFile &Obj,
                               object::SectionedAddress ModuleOffset) {
   StringRef ModuleName = Obj.getFileName();
-  auto I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return symbolizeCodeCommon(I->second.get(), ModuleOffset);
+  auto Cached = lookUpModule(ModuleName);
+  if (Cached.second)
+    return symbolizeCodeCommon(Cached.first, ModuleOffset);
 
   std::unique_ptr<DIContext> Context = DWARFContext::create(Obj);
-  Expected<SymbolizableModule *> InfoOrErr =
-                     createModuleInfo(&Obj, std::move(Context), ModuleName);
+  Expected<SymbolizableModule *> InfoOrErr = createModuleInfo(
+      &Obj, std::move(Context), ModuleName, Obj.getData().size());
   if (!InfoOrErr)
     return InfoOrErr.takeError();
   return symbolizeCodeCommon(*InfoOrErr, ModuleOffset);
@@ -169,9 +169,35 @@ void LLVMSymbolizer::flush() {
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
+  LRUModules.clear();
+  CacheSize = 0;
   Modules.clear();
 }
 
+std::pair<SymbolizableModule *, bool>
+LLVMSymbolizer::lookUpModule(StringRef ModuleName) {
+  auto I = Modules.find(ModuleName);
+  if (I == Modules.end())
+    return {nullptr, false};
+  CachedModule &Cached = I->second;
+  if (Cached.Module)
+    LRUModules.splice(LRUModules.begin(), LRUModules, Cached.LRUPos);
+  return {Cached.Module.get(), true};
+}
+
+void LLVMSymbolizer::pruneCache() {
+  if (!Opts.MaxCacheSize)
+    return;
+  // Never drop the module that was just used.
+  while (CacheSize > Opts.MaxCacheSize && LRUModules.size() > 1) {
+    auto I = Modules.find(*LRUModules.back());
+    assert(I != Modules.end() && "LRU list out of sync with the modules");
+    CacheSize -= I->second.Size;
+    LRUModules.pop_back();
+    Modules.erase(I);
+  }
+}
+
 namespace {
 
 // For Path="/path/to/foo" and Basename="foo" assume that debug info is in
@@ -505,25 +531,31 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
 Expected<SymbolizableModule *>
 LLVMSymbolizer::createModuleInfo(const ObjectFile *Obj,
                                  std::unique_ptr<DIContext> Context,
-                                 StringRef ModuleName) {
+                                 StringRef ModuleName, uint64_t Size) {
   auto InfoOrErr = SymbolizableObjectFile::create(Obj, std::move(Context),
                                                   Opts.UntagAddresses);
-  std::unique_ptr<SymbolizableModule> SymMod;
-  if (InfoOrErr)
-    SymMod = std::move(*InfoOrErr);
-  auto InsertResult = Modules.insert(
-      std::make_pair(std::string(ModuleName), std::move(SymMod)));
+  auto InsertResult =
+      Modules.insert(std::make_pair(std::string(ModuleName), CachedModule()));
   assert(InsertResult.second);
-  if (!InfoOrErr)
+  if (!InfoOrErr) {
+    InsertResult.first->second.LRUPos = LRUModules.end();
     return InfoOrErr.takeError();
-  return InsertResult.first->second.get();
+  }
+  CachedModule &Cached = InsertResult.first->second;
+  Cached.Module = std::move(*InfoOrErr);
+  Cached.Size = Size;
+  Cached.LRUPos = LRUModules.insert(LRUModules.begin(),
+                                    &InsertResult.first->first);
+  CacheSize += Size;
+  pruneCache();
+  return Cached.Module.get();
 }
 
 Expected<SymbolizableModule *>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  auto I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second.get();
+  auto Cached = lookUpModule(ModuleName);
+  if (Cached.second)
+    return Cached.first;
 
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
@@ -539,7 +571,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
-    Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
+    Modules[ModuleName].LRUPos = LRUModules.end();
     return ObjectsOrErr.takeError();
   }
   ObjectPair Objects = ObjectsOrErr.get();
@@ -559,7 +591,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
           Opts.UseDIA ? PDB_ReaderType::DIA : PDB_ReaderType::Native;
       if (auto Err = loadDataForEXE(ReaderType, Objects.first->getFileName(),
                                     Session)) {
-        Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
+        Modules[ModuleName].LRUPos = LRUModules.end();
         // Return along the PDB filename to provide more context
         return createFileError(PDBFileName, std::move(Err));
       }
@@ -568,7 +600,8 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   }
   if (!Context)
     Context = DWARFContext::create(*Objects.second, nullptr, Opts.DWPName);
-  return createModuleInfo(Objects.first, std::move(Context), ModuleName);
+  return createModuleInfo(Objects.first, std::move(Context), ModuleName,
+                          Objects.second->getData().size());
 }
 
 namespace {
@@ -0,0 +1,844 @@
+//===----- ELF_riscv.cpp - JIT linker implementation for ELF/RISC-V -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// ELF/RISC-V jit-link implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITLink/ELF_riscv.h"
+#include "llvm/ExecutionEngine/JITLink/JITLink.h"
+#include "llvm/Object/ELFObjectFile.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "BasicGOTAndStubsBuilder.h"
+#include "JITLinkGeneric.h"
+
+#define DEBUG_TYPE "jitlink"
+
+using namespace llvm;
+using namespace llvm::jitlink;
+using namespace llvm::jitlink::ELF_riscv_Edges;
+
+namespace {
+
+class ELF_riscv_GOTAndStubsBuilder
+    : public BasicGOTAndStubsBuilder<ELF_riscv_GOTAndStubsBuilder> {
+public:
+  static const uint8_t NullGOTEntryContent[8];
+  static const uint8_t RV32StubContent[16];
+  static const uint8_t RV64StubContent[16];
+
+  ELF_riscv_GOTAndStubsBuilder(LinkGraph &G)
+      : BasicGOTAndStubsBuilder<ELF_riscv_GOTAndStubsBuilder>(G) {}
+
+  bool isGOTEdge(Edge &E) const { return E.getKind() == GOTPCRelHi20; }
+
+  Symbol &createGOTEntry(Symbol &Target) {
+    unsigned PointerSize = G.getPointerSize();
+    auto &GOTEntryBlock = G.createContentBlock(
+        getGOTSection(), getGOTEntryBlockContent(), 0, PointerSize, 0);
+    GOTEntryBlock.addEdge(PointerSize == 8 ? Pointer64 : Pointer32, 0, Target,
+                          0);
+    return G.addAnonymousSymbol(GOTEntryBlock, 0, PointerSize, false, false);
+  }
+
+  void fixGOTEdge(Edge &E, Symbol &GOTEntry) {
+    assert(E.getKind() == GOTPCRelHi20 && "Not a GOT edge?");
+    // The auipc now computes the address of the GOT entry. The paired
+    // PCRelLo12 edge of the load is resolved through this edge, so it picks up
+    // the new target without being changed.
+    E.setKind(PCRelHi20);
+    E.setTarget(GOTEntry);
+    // Leave the edge addend as-is.
+  }
+
+  bool isExternalBranchEdge(Edge &E) {
+    return (E.getKind() == Call || E.getKind() == CallPLT) &&
+           !E.getTarget().isDefined();
+  }
+
+  Symbol &createStub(Symbol &Target) {
+    auto &StubContentBlock =
+        G.createContentBlock(getStubsSection(), getStubBlockContent(), 0, 4, 0);
+    auto &StubSymbol =
+        G.addAnonymousSymbol(StubContentBlock, 0, 16, true, false);
+    // Re-use GOT entries for stub targets. The load is relative to the auipc
+    // at the start of the stub.
+    auto &GOTEntrySymbol = getGOTEntrySymbol(Target);
+    StubContentBlock.addEdge(PCRelHi20, 0, GOTEntrySymbol, 0);
+    StubContentBlock.addEdge(PCRelLo12I, 4, StubSymbol, 0);
+    return StubSymbol;
+  }
+
+  void fixExternalBranchEdge(Edge &E, Symbol &Stub) {
+    assert((E.getKind() == Call || E.getKind() == CallPLT) &&
+           "Not a call edge?");
+    E.setTarget(Stub);
+  }
+
+private:
+  Section &getGOTSection() {
+    if (!GOTSection)
+      GOTSection = &G.createSection("$__GOT", sys::Memory::MF_READ);
+    return *GOTSection;
+  }
+
+  Section &getStubsSection() {
+    if (!StubsSection) {
+      auto StubsProt = static_cast<sys::Memory::ProtectionFlags>(
+          sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+      StubsSection = &G.createSection("$__STUBS", StubsProt);
+    }
+    return *StubsSection;
+  }
+
+  StringRef getGOTEntryBlockContent() {
+    return StringRef(reinterpret_cast<const char *>(NullGOTEntryContent),
+                     G.getPointerSize());
+  }
+
+  StringRef getStubBlockContent() {
+    auto &StubContent =
+        G.getPointerSize() == 8 ? RV64StubContent : RV32StubContent;
+    return StringRef(reinterpret_cast<const char *>(StubContent),
+                     sizeof(StubContent));
+  }
+
+  Section *GOTSection = nullptr;
+  Section *StubsSection = nullptr;
+};
+
+} // namespace
+
+const uint8_t ELF_riscv_GOTAndStubsBuilder::NullGOTEntryContent[8] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+// auipc t3, %pcrel_hi(GOT entry); lw t3, %pcrel_lo(.)(t3); jalr t1, t3; nop
+const uint8_t ELF_riscv_GOTAndStubsBuilder::RV32StubContent[16] = {
+    0x17, 0x0e, 0x00, 0x00, 0x03, 0x2e, 0x0e, 0x00,
+    0x67, 0x03, 0x0e, 0x00, 0x13, 0x00, 0x00, 0x00};
+// auipc t3, %pcrel_hi(GOT entry); ld t3, %pcrel_lo(.)(t3); jalr t1, t3; nop
+const uint8_t ELF_riscv_GOTAndStubsBuilder::RV64StubContent[16] = {
+    0x17, 0x0e, 0x00, 0x00, 0x03, 0x3e, 0x0e, 0x00,
+    0x67, 0x03, 0x0e, 0x00, 0x13, 0x00, 0x00, 0x00};
+
+static const char *CommonSectionName = "__common";
+
+namespace llvm {
+namespace jitlink {
+
+template <typename ELFT> class ELFLinkGraphBuilder_riscv {
+private:
+  using ELFFile = object::ELFFile<ELFT>;
+  using Elf_Shdr = typename ELFFile::Elf_Shdr;
+
+  std::unique_ptr<LinkGraph> G;
+  const ELFFile &Obj;
+  typename ELFFile::Elf_Shdr_Range Sections;
+  const Elf_Shdr *SymTabSec = nullptr;
+  Section *CommonSection = nullptr;
+
+  // Every allocated section becomes a single block; symbol values and
+  // relocation offsets are relative to it.
+  DenseMap<unsigned, Block *> SectionBlocks;
+  DenseMap<unsigned, Symbol *> JITSymbolTable;
+
+  Section &getCommonSection() {
+    if (!CommonSection) {
+      auto Prot = static_cast<sys::Memory::ProtectionFlags>(
+          sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+      CommonSection = &G->createSection(CommonSectionName, Prot);
+    }
+    return *CommonSection;
+  }
+
+  static Expected<ELFRISCVRelocationKind> getRelocationKind(uint32_t Type) {
+    switch (Type) {
+    case ELF::R_RISCV_32:
+      return Pointer32;
+    case ELF::R_RISCV_64:
+      return Pointer64;
+    case ELF::R_RISCV_32_PCREL:
+      return PCRel32;
+    case ELF::R_RISCV_BRANCH:
+      return Branch;
+    case ELF::R_RISCV_JAL:
+      return Jal;
+    case ELF::R_RISCV_CALL:
+      return Call;
+    case ELF::R_RISCV_CALL_PLT:
+      return CallPLT;
+    case ELF::R_RISCV_GOT_HI20:
+      return GOTPCRelHi20;
+    case ELF::R_RISCV_PCREL_HI20:
+      return PCRelHi20;
+    case ELF::R_RISCV_PCREL_LO12_I:
+      return PCRelLo12I;
+    case ELF::R_RISCV_PCREL_LO12_S:
+      return PCRelLo12S;
+    case ELF::R_RISCV_HI20:
+      return Hi20;
+    case ELF::R_RISCV_LO12_I:
+      return Lo12I;
+    case ELF::R_RISCV_LO12_S:
+      return Lo12S;
+    case ELF::R_RISCV_RVC_BRANCH:
+      return RVCBranch;
+    case ELF::R_RISCV_RVC_JUMP:
+      return RVCJump;
+    case ELF::R_RISCV_ADD8:
+      return Add8;
+    case ELF::R_RISCV_ADD16:
+      return Add16;
+    case ELF::R_RISCV_ADD32:
+      return Add32;
+    case ELF::R_RISCV_ADD64:
+      return Add64;
+    case ELF::R_RISCV_SUB6:
+      return Sub6;
+    case ELF::R_RISCV_SUB8:
+      return Sub8;
+    case ELF::R_RISCV_SUB16:
+      return Sub16;
+    case ELF::R_RISCV_SUB32:
+      return Sub32;
+    case ELF::R_RISCV_SUB64:
+      return Sub64;
+    case ELF::R_RISCV_SET6:
+      return Set6;
+    case ELF::R_RISCV_SET8:
+      return Set8;
+    case ELF::R_RISCV_SET16:
+      return Set16;
+    case ELF::R_RISCV_SET32:
+      return Set32;
+    }
+    return make_error<JITLinkError>("Unsupported RISC-V relocation:" +
+                                    formatv("{0:d}", Type));
+  }
+
+  bool isRelocatable() { return Obj.getHeader().e_type == llvm::ELF::ET_REL; }
+
+  Error createNormalizedSections() {
+    LLVM_DEBUG(dbgs() << "Creating normalized sections...\n");
+    unsigned SecIndex = 0;
+    for (auto &SecRef : Sections) {
+      unsigned Index = SecIndex++;
+
+      if (SecRef.sh_type == ELF::SHT_SYMTAB)
+        SymTabSec = &SecRef;
+
+      // Only sections that are part of the memory image are linked. This
+      // skips the symbol and string tables, the relocations and the debug
+      // info.
+      if (!(SecRef.sh_flags & ELF::SHF_ALLOC) || SecRef.sh_size == 0)
+        continue;
+
+      auto Name = Obj.getSectionName(SecRef);
+      if (!Name)
+        return Name.takeError();
+
+      sys::Memory::ProtectionFlags Prot;
+      if (SecRef.sh_flags & ELF::SHF_EXECINSTR)
+        Prot = static_cast<sys::Memory::ProtectionFlags>(sys::Memory::MF_READ |
+                                                         sys::Memory::MF_EXEC);
+      else if (SecRef.sh_flags & ELF::SHF_WRITE)
+        Prot = static_cast<sys::Memory::ProtectionFlags>(sys::Memory::MF_READ |
+                                                         sys::Memory::MF_WRITE);
+      else
+        Prot = sys::Memory::MF_READ;
+
+      uint64_t Size = SecRef.sh_size;
+      uint64_t Alignment = std::max<uint64_t>(SecRef.sh_addralign, 1);
+
+      LLVM_DEBUG({
+        dbgs() << "  " << *Name << ": size " << formatv("{0:x16}", Size)
+               << ", align: " << Alignment
+               << " Flags: " << formatv("{0:x}", SecRef.sh_flags) << "\n";
+      });
+
+      auto &Section = G->createSection(*Name, Prot);
+      if (SecRef.sh_type != ELF::SHT_NOBITS) {
+        auto Contents = Obj.template getSectionContentsAsArray<char>(SecRef);
+        if (!Contents)
+          return Contents.takeError();
+        SectionBlocks[Index] = &G->createContentBlock(
+            Section, StringRef(Contents->data(), Size), 0, Alignment, 0);
+      } else
+        SectionBlocks[Index] =
+            &G->createZeroFillBlock(Section, Size, 0, Alignment, 0);
+    }
+
+    return Error::success();
+  }
+
+  Error graphifySymbols() {
+    LLVM_DEBUG(dbgs() << "Creating graph symbols...\n");
+
+    if (!SymTabSec)
+      return Error::success();
+
+    auto Symbols = Obj.symbols(SymTabSec);
+    if (!Symbols)
+      return Symbols.takeError();
+
+    auto StringTable = Obj.getStringTableForSymtab(*SymTabSec);
+    if (!StringTable)
+      return StringTable.takeError();
+
+    unsigned SymbolIndex = 0;
+    for (auto &SymRef : *Symbols) {
+      unsigned Index = SymbolIndex++;
+      auto Type = SymRef.getType();
+
+      if (Index == 0 || Type == ELF::STT_FILE)
+        continue;
+
+      auto Name = SymRef.getName(*StringTable);
+      if (!Name)
+        return Name.takeError();
+
+      if (SymRef.isCommon()) {
+        // Symbols in SHN_COMMON refer to uninitialized data. The st_value
+        // field holds alignment constraints.
+        Symbol &S =
+            G->addCommonSymbol(*Name, Scope::Default, getCommonSection(), 0,
+                               SymRef.st_size, SymRef.getValue(), false);
+        JITSymbolTable[Index] = &S;
+        continue;
+      }
+
+      // Map Visibility and Binding to Scope and Linkage:
+      Linkage L = Linkage::Strong;
+      Scope S = Scope::Default;
+
+      switch (SymRef.getBinding()) {
+      case ELF::STB_LOCAL:
+        S = Scope::Local;
+        break;
+      case ELF::STB_GLOBAL:
+        // Nothing to do here.
+        break;
+      case ELF::STB_WEAK:
+        L = Linkage::Weak;
+        break;
+      default:
+        return make_error<StringError>("Unrecognized symbol binding for " +
+                                           *Name,
+                                       inconvertibleErrorCode());
+      }
+
+      switch (SymRef.getVisibility()) {
+      case ELF::STV_DEFAULT:
+      case ELF::STV_PROTECTED:
+        break;
+      case ELF::STV_HIDDEN:
+        // Default scope -> Hidden scope. No effect on local scope.
+        if (S == Scope::Default)
+          S = Scope::Hidden;
+        break;
+      case ELF::STV_INTERNAL:
+        return make_error<StringError>("Unrecognized symbol visibility for " +
+                                           *Name,
+                                       inconvertibleErrorCode());
+      }
+
+      if (SymRef.isUndefined()) {
+        if (SymRef.isExternal())
+          JITSymbolTable[Index] =
+              &G->addExternalSymbol(*Name, SymRef.st_size, L);
+        continue;
+      }
+
+      if (SymRef.st_shndx == ELF::SHN_ABS) {
+        JITSymbolTable[Index] = &G->addAbsoluteSymbol(
+            *Name, SymRef.getValue(), SymRef.st_size, L, S, false);
+        continue;
+      }
+
+      // Local labels (STT_NOTYPE) are kept: the PCREL_LO12 relocations refer
+      // to the auipc through them.
+      if (Type != ELF::STT_FUNC && Type != ELF::STT_OBJECT &&
+          Type != ELF::STT_SECTION && Type != ELF::STT_NOTYPE)
+        continue;
+
+      auto BlockI = SectionBlocks.find(SymRef.st_shndx);
+      if (BlockI == SectionBlocks.end()) {
+        LLVM_DEBUG({
+          dbgs() << "  Not creating graph symbol for \"" << *Name
+                 << "\" in section " << SymRef.st_shndx
+                 << ", which is not linked\n";
+        });
+        continue;
+      }
+
+      if (Type == ELF::STT_SECTION)
+        *Name = BlockI->second->getSection().getName();
+
+      LLVM_DEBUG(
+          { dbgs() << "  " << *Name << " at index " << Index << "\n"; });
+      JITSymbolTable[Index] = &G->addDefinedSymbol(
+          *BlockI->second, SymRef.getValue(), *Name, SymRef.st_size, L, S,
+          Type == ELF::STT_FUNC, false);
+    }
+    return Error::success();
+  }
+
+  Error addRelocations() {
+    LLVM_DEBUG(dbgs() << "Adding relocations\n");
+    for (auto &SecRef : Sections) {
+      if (SecRef.sh_type != ELF::SHT_RELA && SecRef.sh_type != ELF::SHT_REL)
+        continue;
+      if (SecRef.sh_type == ELF::SHT_REL)
+        return make_error<JITLinkError>("Shouldn't have REL in RISC-V");
+
+      // Relocations of sections that are not linked, e.g. debug info, are
+      // dropped along with them.
+      auto BlockI = SectionBlocks.find(SecRef.sh_info);
+      if (BlockI == SectionBlocks.end())
+        continue;
+      Block &BlockToFix = *BlockI->second;
+
+      LLVM_DEBUG({
+        dbgs() << "  For target section " << BlockToFix.getSection().getName()
+               << "\n";
+      });
+
+      auto Relocations = Obj.relas(SecRef);
+      if (!Relocations)
+        return Relocations.takeError();
+
+      for (const auto &Rela : *Relocations) {
+        auto Type = Rela.getType(false);
+
+        // The layout is kept as emitted by the assembler, so the relaxation
+        // hints have nothing to do. Without relaxation the nops emitted for
+        // R_RISCV_ALIGN are simply executed.
+        if (Type == ELF::R_RISCV_RELAX || Type == ELF::R_RISCV_ALIGN ||
+            Type == ELF::R_RISCV_NONE)
+          continue;
+
+        auto Kind = getRelocationKind(Type);
+        if (!Kind)
+          return Kind.takeError();
+
+        auto SymbolIndex = Rela.getSymbol(false);
+        auto *TargetSymbol = JITSymbolTable.lookup(SymbolIndex);
+        if (!TargetSymbol)
+          return make_error<JITLinkError>(
+              "Could not find symbol at given index, did you add it to "
+              "JITSymbolTable? index: " +
+              std::to_string(SymbolIndex));
+
+        int64_t Addend = Rela.r_addend;
+        LLVM_DEBUG({
+          Edge GE(*Kind, Rela.r_offset, *TargetSymbol, Addend);
+          printEdge(dbgs(), BlockToFix, GE,
+                    getELFRISCVRelocationKindName(*Kind));
+          dbgs() << "\n";
+        });
+        BlockToFix.addEdge(*Kind, Rela.r_offset, *TargetSymbol, Addend);
+      }
+    }
+    return Error::success();
+  }
+
+public:
+  ELFLinkGraphBuilder_riscv(StringRef FileName, const ELFFile &Obj)
+      : G(std::make_unique<LinkGraph>(
+            FileName.str(),
+            Triple(ELFT::Is64Bits ? "riscv64-unknown-linux"
+                                  : "riscv32-unknown-linux"),
+            ELFT::Is64Bits ? 8 : 4, support::little)),
+        Obj(Obj) {}
+
+  Expected<std::unique_ptr<LinkGraph>> buildGraph() {
+    // Sanity check: we only operate on relocatable objects.
+    if (!isRelocatable())
+      return make_error<JITLinkError>("Object is not a relocatable ELF");
+
+    auto Secs = Obj.sections();
+    if (!Secs)
+      return Secs.takeError();
+    Sections = *Secs;
+
+    if (auto Err = createNormalizedSections())
+      return std::move(Err);
+
+    if (auto Err = graphifySymbols())
+      return std::move(Err);
+
+    if (auto Err = addRelocations())
+      return std::move(Err);
+
+    return std::move(G);
+  }
+};
+
+class ELFJITLinker_riscv : public JITLinker<ELFJITLinker_riscv> {
+  friend class JITLinker<ELFJITLinker_riscv>;
+
+public:
+  ELFJITLinker_riscv(std::unique_ptr<JITLinkContext> Ctx,
+                     std::unique_ptr<LinkGraph> G, PassConfiguration PassConfig,
+                     bool Is64Bit)
+      : JITLinker(std::move(Ctx), std::move(G), std::move(PassConfig)),
+        Is64Bit(Is64Bit) {}
+
+private:
+  // On RV32 every address is reachable from a hi20/lo12 pair, on RV64 only
+  // those within 2GiB.
+  bool Is64Bit;
+
+  StringRef getEdgeKindName(Edge::Kind R) const override {
+    return getELFRISCVRelocationKindName(R);
+  }
+
+  static Error targetOutOfRangeError(const Block &B, const Edge &E) {
+    std::string ErrMsg;
+    {
+      raw_string_ostream ErrStream(ErrMsg);
+      ErrStream << "Relocation target out of range: ";
+      printEdge(ErrStream, B, E, getELFRISCVRelocationKindName(E.getKind()));
+      ErrStream << "\n";
+    }
+    return make_error<JITLinkError>(std::move(ErrMsg));
+  }
+
+  static Error targetMisalignedError(const Block &B, const Edge &E) {
+    std::string ErrMsg;
+    {
+      raw_string_ostream ErrStream(ErrMsg);
+      ErrStream << "Relocation target is not 2-byte aligned: ";
+      printEdge(ErrStream, B, E, getELFRISCVRelocationKindName(E.getKind()));
+      ErrStream << "\n";
+    }
+    return make_error<JITLinkError>(std::move(ErrMsg));
+  }
+
+  static uint32_t extractBits(uint64_t Num, unsigned Low, unsigned Size) {
+    return (Num >> Low) & ((1ULL << Size) - 1);
+  }
+
+  // The upper 20 bits of Value, rounded so that adding the sign-extended lower
+  // 12 bits gives back Value.
+  static uint32_t hi20(int64_t Value) {
+    return static_cast<uint32_t>(Value + 0x800) & 0xFFFFF000;
+  }
+
+  static uint32_t lo12(int64_t Value) {
+    return static_cast<uint32_t>(Value) & 0xFFF;
+  }
+
+  bool fitsHi20(int64_t Value) const {
+    return !Is64Bit || isInt<32>(Value + 0x800);
+  }
+
+  // A PCREL_LO12 edge targets the auipc instruction that holds the matching
+  // PCREL_HI20, and takes its value from that edge.
+  static const Edge *getPCRelHi20(const Edge &E) {
+    const Symbol &Sym = E.getTarget();
+    if (!Sym.isDefined())
+      return nullptr;
+    for (auto &HiEdge : Sym.getBlock().edges())
+      if (HiEdge.getOffset() == Sym.getOffset() &&
+          HiEdge.getKind() == PCRelHi20)
+        return &HiEdge;
+    return nullptr;
+  }
+
+  Error applyFixup(Block &B, const Edge &E, char *BlockWorkingMem) const {
+    using namespace llvm::support;
+    char *FixupPtr = BlockWorkingMem + E.getOffset();
+    JITTargetAddress FixupAddress = B.getAddress() + E.getOffset();
+    int64_t Value = E.getTarget().getAddress() + E.getAddend();
+    int64_t PCValue = Value - FixupAddress;
+    auto &RawInstr = *(ulittle32_t *)FixupPtr;
+    auto &RawCInstr = *(ulittle16_t *)FixupPtr;
+
+    switch (E.getKind()) {
+    case Pointer32:
+      *(ulittle32_t *)FixupPtr = Value;
+      break;
+    case Pointer64:
+      *(ulittle64_t *)FixupPtr = Value;
+      break;
+    case PCRel32:
+      if (Is64Bit && !isInt<32>(PCValue))
+        return targetOutOfRangeError(B, E);
+      *(little32_t *)FixupPtr = PCValue;
+      break;
+    case Branch: {
+      if (!isInt<13>(PCValue))
+        return targetOutOfRangeError(B, E);
+      if (PCValue & 1)
+        return targetMisalignedError(B, E);
+      uint32_t Imm = extractBits(PCValue, 12, 1) << 31 |
+                     extractBits(PCValue, 5, 6) << 25 |
+                     extractBits(PCValue, 1, 4) << 8 |
+                     extractBits(PCValue, 11, 1) << 7;
+      RawInstr = (RawInstr & 0x1FFF07F) | Imm;
+      break;
+    }
+    case Jal: {
+      if (!isInt<21>(PCValue))
+        return targetOutOfRangeError(B, E);
+      if (PCValue & 1)
+        return targetMisalignedError(B, E);
+      uint32_t Imm = extractBits(PCValue, 20, 1) << 31 |
+                     extractBits(PCValue, 1, 10) << 21 |
+                     extractBits(PCValue, 11, 1) << 20 |
+                     extractBits(PCValue, 12, 8) << 12;
+      RawInstr = (RawInstr & 0xFFF) | Imm;
+      break;
+    }
+    case Call:
+    case CallPLT: {
+      // An auipc/jalr pair.
+      if (!fitsHi20(PCValue))
+        return targetOutOfRangeError(B, E);
+      auto &RawJalr = *(ulittle32_t *)(FixupPtr + 4);
+      RawInstr = (RawInstr & 0xFFF) | hi20(PCValue);
+      RawJalr = (RawJalr & 0xFFFFF) | lo12(PCValue) << 20;
+      break;
+    }
+    case PCRelHi20:
+      if (!fitsHi20(PCValue))
+        return targetOutOfRangeError(B, E);
+      RawInstr = (RawInstr & 0xFFF) | hi20(PCValue);
+      break;
+    case PCRelLo12I:
+    case PCRelLo12S: {
+      const Edge *HiEdge = getPCRelHi20(E);
+      if (!HiEdge)
+        return make_error<JITLinkError>(
+            "No PCREL_HI20 relocation found for PCREL_LO12 target " +
+            (E.getTarget().hasName() ? E.getTarget().getName()
+                                     : StringRef("<anonymous symbol>")));
+      JITTargetAddress HiFixupAddress =
+          E.getTarget().getBlock().getAddress() + HiEdge->getOffset();
+      int64_t HiValue = HiEdge->getTarget().getAddress() +
+                        HiEdge->getAddend() - HiFixupAddress;
+      uint32_t Imm = lo12(HiValue);
+      if (E.getKind() == PCRelLo12I)
+        RawInstr = (RawInstr & 0xFFFFF) | Imm << 20;
+      else
+        RawInstr = (RawInstr & 0x1FFF07F) | (Imm & 0xFE0) << 20 |
+                   (Imm & 0x1F) << 7;
+      break;
+    }
+    case Hi20:
+      if (!fitsHi20(Value))
+        return targetOutOfRangeError(B, E);
+      RawInstr = (RawInstr & 0xFFF) | hi20(Value);
+      break;
+    case Lo12I:
+      RawInstr = (RawInstr & 0xFFFFF) | lo12(Value) << 20;
+      break;
+    case Lo12S: {
+      uint32_t Imm = lo12(Value);
+      RawInstr =
+          (RawInstr & 0x1FFF07F) | (Imm & 0xFE0) << 20 | (Imm & 0x1F) << 7;
+      break;
+    }
+    case RVCBranch: {
+      if (!isInt<9>(PCValue))
+        return targetOutOfRangeError(B, E);
+      if (PCValue & 1)
+        return targetMisalignedError(B, E);
+      uint16_t Imm = extractBits(PCValue, 8, 1) << 12 |
+                     extractBits(PCValue, 3, 2) << 10 |
+                     extractBits(PCValue, 6, 2) << 5 |
+                     extractBits(PCValue, 1, 2) << 3 |
+                     extractBits(PCValue, 5, 1) << 2;
+      RawCInstr = (RawCInstr & 0xE383) | Imm;
+      break;
+    }
+    case RVCJump: {
+      if (!isInt<12>(PCValue))
+        return targetOutOfRangeError(B, E);
+      if (PCValue & 1)
+        return targetMisalignedError(B, E);
+      uint16_t Imm = extractBits(PCValue, 11, 1) << 12 |
+                     extractBits(PCValue, 4, 1) << 11 |
+                     extractBits(PCValue, 8, 2) << 9 |
+                     extractBits(PCValue, 10, 1) << 8 |
+                     extractBits(PCValue, 6, 1) << 7 |
+                     extractBits(PCValue, 7, 1) << 6 |
+                     extractBits(PCValue, 1, 3) << 3 |
+                     extractBits(PCValue, 5, 1) << 2;
+      RawCInstr = (RawCInstr & 0xE003) | Imm;
+      break;
+    }
+    case Add8:
+      *(uint8_t *)FixupPtr += Value;
+      break;
+    case Add16:
+      *(ulittle16_t *)FixupPtr += Value;
+      break;
+    case Add32:
+      *(ulittle32_t *)FixupPtr += Value;
+      break;
+    case Add64:
+      *(ulittle64_t *)FixupPtr += Value;
+      break;
+    case Sub6: {
+      uint8_t &Byte = *(uint8_t *)FixupPtr;
+      Byte = (Byte & 0xC0) | ((Byte - Value) & 0x3F);
+      break;
+    }
+    case Sub8:
+      *(uint8_t *)FixupPtr -= Value;
+      break;
+    case Sub16:
+      *(ulittle16_t *)FixupPtr -= Value;
+      break;
+    case Sub32:
+      *(ulittle32_t *)FixupPtr -= Value;
+      break;
+    case Sub64:
+      *(ulittle64_t *)FixupPtr -= Value;
+      break;
+    case Set6: {
+      uint8_t &Byte = *(uint8_t *)FixupPtr;
+      Byte = (Byte & 0xC0) | (Value & 0x3F);
+      break;
+    }
+    case Set8:
+      *(uint8_t *)FixupPtr = Value;
+      break;
+    case Set16:
+      *(ulittle16_t *)FixupPtr = Value;
+      break;
+    case Set32:
+      *(ulittle32_t *)FixupPtr = Value;
+      break;
+    default:
+      // GOTPCRelHi20 edges are rewritten by the GOT/stubs pass.
+      return make_error<JITLinkError>(
+          "Unsupported RISC-V edge kind " +
+          getELFRISCVRelocationKindName(E.getKind()));
+    }
+    return Error::success();
+  }
+};
+
+Expected<std::unique_ptr<LinkGraph>>
+createLinkGraphFromELFObject_riscv(MemoryBufferRef ObjectBuffer) {
+  LLVM_DEBUG({
+    dbgs() << "Building jitlink graph for new input "
+           << ObjectBuffer.getBufferIdentifier() << "...\n";
+  });
+
+  auto ELFObj = object::ObjectFile::createELFObjectFile(ObjectBuffer);
+  if (!ELFObj)
+    return ELFObj.takeError();
+
+  if (auto *ELF64 = dyn_cast<object::ELFObjectFile<object::ELF64LE>>(
+          ELFObj->get()))
+    return ELFLinkGraphBuilder_riscv<object::ELF64LE>(
+               (*ELFObj)->getFileName(), ELF64->getELFFile())
+        .buildGraph();
+
+  auto &ELF32 = cast<object::ELFObjectFile<object::ELF32LE>>(**ELFObj);
+  return ELFLinkGraphBuilder_riscv<object::ELF32LE>((*ELFObj)->getFileName(),
+                                                    ELF32.getELFFile())
+      .buildGraph();
+}
+
+void link_ELF_riscv(std::unique_ptr<LinkGraph> G,
+                    std::unique_ptr<JITLinkContext> Ctx) {
+  PassConfiguration Config;
+
+  if (Ctx->shouldAddDefaultTargetPasses(G->getTargetTriple())) {
+    // Add a mark-live pass.
+    if (auto MarkLive = Ctx->getMarkLivePass(G->getTargetTriple()))
+      Config.PrePrunePasses.push_back(std::move(MarkLive));
+    else
+      Config.PrePrunePasses.push_back(markAllSymbolsLive);
+
+    // Add an in-place GOT/Stubs pass.
+    Config.PostPrunePasses.push_back([](LinkGraph &G) -> Error {
+      ELF_riscv_GOTAndStubsBuilder(G).run();
+      return Error::success();
+    });
+  }
+
+  if (auto Err = Ctx->modifyPassConfig(G->getTargetTriple(), Config))
+    return Ctx->notifyFailed(std::move(Err));
+
+  bool Is64Bit = G->getPointerSize() == 8;
+  ELFJITLinker_riscv::link(std::move(Ctx), std::move(G), std::move(Config),
+                           Is64Bit);
+}
+
+StringRef getELFRISCVRelocationKindName(Edge::Kind R) {
+  switch (R) {
+  case Pointer32:
+    return "Pointer32";
+  case Pointer64:
+    return "Pointer64";
+  case PCRel32:
+    return "PCRel32";
+  case Branch:
+    return "Branch";
+  case Jal:
+    return "Jal";
+  case Call:
+    return "Call";
+  case CallPLT:
+    return "CallPLT";
+  case GOTPCRelHi20:
+    return "GOTPCRelHi20";
+  case PCRelHi20:
+    return "PCRelHi20";
+  case PCRelLo12I:
+    return "PCRelLo12I";
+  case PCRelLo12S:
+    return "PCRelLo12S";
+  case Hi20:
+    return "Hi20";
+  case Lo12I:
+    return "Lo12I";
+  case Lo12S:
+    return "Lo12S";
+  case RVCBranch:
+    return "RVCBranch";
+  case RVCJump:
+    return "RVCJump";
+  case Add8:
+    return "Add8";
+  case Add16:
+    return "Add16";
+  case Add32:
+    return "Add32";
+  case Add64:
+    return "Add64";
+  case Sub6:
+    return "Sub6";
+  case Sub8:
+    return "Sub8";
+  case Sub16:
+    return "Sub16";
+  case Sub32:
+    return "Sub32";
+  case Sub64:
+    return "Sub64";
+  case Set6:
+    return "Set6";
+  case Set8:
+    return "Set8";
+  case Set16:
+    return "Set16";
+  case Set32:
+    return "Set32";
+  }
+  return getGenericEdgeKindName(static_cast<Edge::Kind>(R));
+}
+} // end namespace jitlink
+} // end namespace llvm
@@ -182,8 +182,21 @@ void CompileOnDemandLayer::emit(
   }
 }
 
+Error CompileOnDemandLayer::redirect(JITDylib &ImplD,
+                                     const SymbolStringPtr &Name,
+                                     JITTargetAddress NewAddr) {
+  std::lock_guard<std::mutex> Lock(CODLayerMutex);
+  for (auto &KV : DylibResources)
+    if (&KV.second.getImplDylib() == &ImplD)
+      return KV.second.getISManager().updatePointer(*Name, NewAddr);
+  return make_error<StringError>("No stubs for implementation dylib " +
+                                     ImplD.getName(),
+                                 inconvertibleErrorCode());
+}
+
 CompileOnDemandLayer::PerDylibResources &
 CompileOnDemandLayer::getPerDylibResources(JITDylib &TargetD) {
+  std::lock_guard<std::mutex> Lock(CODLayerMutex);
   auto I = DylibResources.find(&TargetD);
   if (I == DylibResources.end()) {
     auto &ImplD =
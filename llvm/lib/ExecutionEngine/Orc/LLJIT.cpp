@@ -12,6 +12,7 @@
 #include "llvm/ExecutionEngine/Orc/MachOPlatform.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/Orc/ObjectTransformLayer.h"
+#include "llvm/ExecutionEngine/Orc/OnDiskObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/Orc/Shared/OrcError.h"
 #include "llvm/ExecutionEngine/Orc/TargetProcessControl.h"
@@ -948,11 +949,17 @@ Error LLJITBuilderState::prepareForConstruction() {
   // JIT linker.
   if (!CreateObjectLinkingLayer) {
     auto &TT = JTMB->getTargetTriple();
-    if (TT.isOSBinFormatMachO() &&
-        (TT.getArch() == Triple::aarch64 || TT.getArch() == Triple::x86_64)) {
+    bool UseJITLinkMachO =
+        TT.isOSBinFormatMachO() &&
+        (TT.getArch() == Triple::aarch64 || TT.getArch() == Triple::x86_64);
+    bool UseJITLinkELFRISCV = TT.isOSBinFormatELF() && TT.isRISCV();
+    if (UseJITLinkMachO || UseJITLinkELFRISCV) {
 
       JTMB->setRelocationModel(Reloc::PIC_);
-      JTMB->setCodeModel(CodeModel::Small);
+      // The RISC-V small code model uses absolute addressing, which can not
+      // reach JIT'd memory on RV64; the medium (medany) model is PC-relative.
+      JTMB->setCodeModel(UseJITLinkELFRISCV ? CodeModel::Medium
+                                            : CodeModel::Small);
       CreateObjectLinkingLayer =
           [TPC = this->TPC](
               ExecutionSession &ES,
@@ -971,6 +978,17 @@ Error LLJITBuilderState::prepareForConstruction() {
     }
   }
 
+  // The cache is keyed by the final target options, so create it last.
+  if (!ObjCache && !ObjectCacheDir.empty()) {
+    LLVM_DEBUG(dbgs() << "  Object cache directory: " << ObjectCacheDir
+                      << "\n");
+    auto CacheOrErr = OnDiskObjectCache::Create(ObjectCacheDir, *JTMB,
+                                                ObjectCachePruningPolicy);
+    if (!CacheOrErr)
+      return CacheOrErr.takeError();
+    ObjCache = std::move(*CacheOrErr);
+  }
+
   return Error::success();
 }
 
@@ -1047,13 +1065,15 @@ LLJIT::createCompileFunction(LLJITBuilderState &S,
   // Otherwise default to creating a SimpleCompiler, or ConcurrentIRCompiler,
   // depending on the number of threads requested.
   if (S.NumCompileThreads > 0)
-    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB));
+    return std::make_unique<ConcurrentIRCompiler>(std::move(JTMB),
+                                                  S.ObjCache.get());
 
   auto TM = JTMB.createTargetMachine();
   if (!TM)
     return TM.takeError();
 
-  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM));
+  return std::make_unique<TMOwningSimpleCompiler>(std::move(*TM),
+                                                  S.ObjCache.get());
 }
 
 LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
@@ -1093,6 +1113,7 @@ LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
       Err = CompileFunction.takeError();
       return;
     }
+    ObjCache = std::move(S.ObjCache);
     CompileLayer = std::make_unique<IRCompileLayer>(
         *ES, *ObjTransformLayer, std::move(*CompileFunction));
     TransformLayer = std::make_unique<IRTransformLayer>(*ES, *CompileLayer);
@@ -1218,12 +1239,53 @@ LLLazyJIT::LLLazyJIT(LLLazyJITBuilderState &S, Error &Err) : LLJIT(S, Err) {
     return;
   }
 
+  IRLayer *BaseLayer = InitHelperTransformLayer.get();
+  if (S.SpeculationQuery || S.TierUpThreshold)
+    Mangle = std::make_unique<MangleAndInterner>(*ES, DL);
+
+  // Compile likely callees ahead of their first call.
+  if (S.SpeculationQuery) {
+    SpeculationImpls = std::make_unique<ImplSymbolMap>();
+    Spec = std::make_unique<Speculator>(*SpeculationImpls, *ES);
+    if (auto Err2 = Spec->addSpeculationRuntime(*Main, *Mangle)) {
+      Err = std::move(Err2);
+      return;
+    }
+    SpeculationLayer = std::make_unique<IRSpeculationLayer>(
+        *ES, *BaseLayer, *Spec, *Mangle, std::move(S.SpeculationQuery));
+    BaseLayer = SpeculationLayer.get();
+  }
+
+  // Recompile hot functions through the optimizing transform, which bypasses
+  // the regular one. The optimized copies carry no initializers.
+  if (S.TierUpThreshold) {
+    OptimizedTransformLayer = std::make_unique<IRTransformLayer>(
+        *ES, *CompileLayer, std::move(S.OptimizedTransform));
+    TieredLayer = std::make_unique<TieredCompileLayer>(
+        *ES, *BaseLayer, *OptimizedTransformLayer, S.TierUpThreshold);
+    if (auto Err2 = TieredLayer->addTierUpRuntime(*Main, *Mangle)) {
+      Err = std::move(Err2);
+      return;
+    }
+    BaseLayer = TieredLayer.get();
+  }
+
   // Create the COD layer.
   CODLayer = std::make_unique<CompileOnDemandLayer>(
-      *ES, *InitHelperTransformLayer, *LCTMgr, std::move(ISMBuilder));
+      *ES, *BaseLayer, *LCTMgr, std::move(ISMBuilder));
 
   if (S.NumCompileThreads > 0)
     CODLayer->setCloneToNewContextOnEmit(true);
+
+  if (SpeculationImpls)
+    CODLayer->setImplMap(SpeculationImpls.get());
+
+  if (TieredLayer)
+    TieredLayer->setRedirectFunction(
+        [this](JITDylib &ImplD, const SymbolStringPtr &Name,
+               JITTargetAddress NewAddr) {
+          return CODLayer->redirect(ImplD, Name, NewAddr);
+        });
 }
 
 } // End namespace orc.
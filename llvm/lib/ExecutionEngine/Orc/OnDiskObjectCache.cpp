@@ -0,0 +1,137 @@
+//===------- OnDiskObjectCache.cpp - Persistent, content-addressed cache ---===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/OnDiskObjectCache.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "orc"
+
+namespace llvm {
+namespace orc {
+
+Expected<std::unique_ptr<OnDiskObjectCache>>
+OnDiskObjectCache::Create(StringRef CacheDir,
+                          const JITTargetMachineBuilder &JTMB,
+                          CachePruningPolicy Policy) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDir))
+    return errorCodeToError(EC);
+
+  // Everything that changes the generated code besides the module itself.
+  std::string TargetKey;
+  {
+    raw_string_ostream KeyStream(TargetKey);
+    KeyStream << JTMB.getTargetTriple().str() << ':' << JTMB.getCPU() << ':'
+              << JTMB.getFeatures().getString() << ':'
+              << static_cast<int>(JTMB.getCodeGenOptLevel()) << ':';
+    if (JTMB.getRelocationModel())
+      KeyStream << static_cast<int>(*JTMB.getRelocationModel());
+    KeyStream << ':';
+    if (JTMB.getCodeModel())
+      KeyStream << static_cast<int>(*JTMB.getCodeModel());
+  }
+
+  std::unique_ptr<OnDiskObjectCache> Cache(new OnDiskObjectCache(
+      CacheDir.str(), std::move(TargetKey), std::move(Policy)));
+  pruneCache(Cache->CacheDir, Cache->Policy);
+  return std::move(Cache);
+}
+
+std::string OnDiskObjectCache::getEntryPath(const Module &M) {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream BitcodeStream(Bitcode);
+    WriteBitcodeToFile(M, BitcodeStream);
+  }
+
+  SHA1 Hasher;
+  Hasher.update(TargetKey);
+  Hasher.update(StringRef(Bitcode.data(), Bitcode.size()));
+
+  // This choice of file name allows the cache to be pruned (see pruneCache()
+  // in include/llvm/Support/CachePruning.h).
+  SmallString<128> EntryPath(CacheDir);
+  sys::path::append(EntryPath, "llvmcache-" + toHex(Hasher.final()));
+  return std::string(EntryPath.str());
+}
+
+std::unique_ptr<MemoryBuffer> OnDiskObjectCache::getObject(const Module *M) {
+  std::string EntryPath = getEntryPath(*M);
+
+  // Opening the file refreshes its access time, which orders the eviction.
+  Expected<sys::fs::file_t> FDOrErr =
+      sys::fs::openNativeFileForRead(EntryPath, sys::fs::OF_UpdateAtime);
+  if (!FDOrErr) {
+    consumeError(FDOrErr.takeError());
+    LLVM_DEBUG(dbgs() << "Object cache miss for " << M->getModuleIdentifier()
+                      << "\n");
+    return nullptr;
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getOpenFile(*FDOrErr, EntryPath, /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
+  sys::fs::closeFile(*FDOrErr);
+  if (!MBOrErr)
+    return nullptr;
+
+  LLVM_DEBUG(dbgs() << "Object cache hit for " << M->getModuleIdentifier()
+                    << ": " << EntryPath << "\n");
+  return std::move(*MBOrErr);
+}
+
+void OnDiskObjectCache::notifyObjectCompiled(const Module *M,
+                                             MemoryBufferRef Obj) {
+  std::string EntryPath = getEntryPath(*M);
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers, in this or another process, never see a partial entry. A failed
+  // store only costs a recompilation later.
+  SmallString<128> TempFileModel(CacheDir);
+  sys::path::append(TempFileModel, "orcjit-%%%%%%.tmp.o");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFileModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    Error Err = Temp.takeError();
+    LLVM_DEBUG(dbgs() << "Could not create object cache entry: " << Err
+                      << "\n");
+    consumeError(std::move(Err));
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Obj.getBuffer();
+  }
+
+  if (Error Err = Temp->keep(EntryPath)) {
+    LLVM_DEBUG(dbgs() << "Could not store object cache entry " << EntryPath
+                      << ": " << Err << "\n");
+    consumeError(std::move(Err));
+    consumeError(Temp->discard());
+    return;
+  }
+
+  LLVM_DEBUG(dbgs() << "Stored " << M->getModuleIdentifier()
+                    << " in the object cache: " << EntryPath << "\n");
+
+  // pruneCache only scans the directory once per Policy.Interval.
+  std::lock_guard<std::mutex> Lock(PruneMutex);
+  pruneCache(CacheDir, Policy);
+}
+
+} // end namespace orc
+} // end namespace llvm
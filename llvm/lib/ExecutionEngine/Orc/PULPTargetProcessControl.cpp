@@ -0,0 +1,315 @@
+//===--- PULPTargetProcessControl.cpp - Control a PULP accelerator --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PULPTargetProcessControl.h"
+
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FormatVariadic.h"
+
+namespace llvm {
+namespace orc {
+
+PULPDriver::~PULPDriver() {}
+
+/// Allocates the segments of a link graph in the L2 memory. The linker works
+/// on host memory, which is copied to the accelerator on finalization.
+class PULPTargetProcessControl::L2MemoryManager
+    : public jitlink::JITLinkMemoryManager {
+public:
+  L2MemoryManager(PULPTargetProcessControl &TPC) : TPC(TPC) {}
+
+  Expected<std::unique_ptr<Allocation>>
+  allocate(const jitlink::JITLinkDylib *JD,
+           const SegmentsRequestMap &Request) override;
+
+private:
+  struct Segment {
+    JITTargetAddress TargetAddr = 0;
+    uint64_t Size = 0;
+    std::vector<char> WorkingMem;
+  };
+
+  class L2Allocation : public Allocation {
+  public:
+    L2Allocation(PULPTargetProcessControl &TPC) : TPC(TPC) {}
+
+    MutableArrayRef<char> getWorkingMemory(ProtectionFlags Seg) override {
+      assert(Segs.count(Seg) && "No allocation for segment");
+      return Segs[Seg].WorkingMem;
+    }
+
+    JITTargetAddress getTargetMemory(ProtectionFlags Seg) override {
+      assert(Segs.count(Seg) && "No allocation for segment");
+      return Segs[Seg].TargetAddr;
+    }
+
+    void finalizeAsync(FinalizeContinuation OnFinalize) override {
+      // The accelerator has no memory protection, the segments only have to
+      // be copied.
+      for (auto &KV : Segs) {
+        Segment &S = KV.second;
+        if (Error Err = TPC.Driver->writeMemory(S.TargetAddr, S.WorkingMem))
+          return OnFinalize(std::move(Err));
+        S.WorkingMem.clear();
+        S.WorkingMem.shrink_to_fit();
+      }
+      OnFinalize(Error::success());
+    }
+
+    Error deallocate() override {
+      for (auto &KV : Segs)
+        TPC.deallocateL2(KV.second.TargetAddr, KV.second.Size);
+      Segs.clear();
+      return Error::success();
+    }
+
+    PULPTargetProcessControl &TPC;
+    DenseMap<unsigned, Segment> Segs;
+  };
+
+  PULPTargetProcessControl &TPC;
+};
+
+Expected<std::unique_ptr<jitlink::JITLinkMemoryManager::Allocation>>
+PULPTargetProcessControl::L2MemoryManager::allocate(
+    const jitlink::JITLinkDylib *JD, const SegmentsRequestMap &Request) {
+  auto Alloc = std::make_unique<L2Allocation>(TPC);
+  for (auto &KV : Request) {
+    const auto &Seg = KV.second;
+    uint64_t Size = Seg.getContentSize() + Seg.getZeroFillSize();
+    auto Addr = TPC.allocateL2(Size, Seg.getAlignment());
+    if (!Addr) {
+      cantFail(Alloc->deallocate());
+      return Addr.takeError();
+    }
+    // The working memory is zero initialized, which covers the zero-fill
+    // part of the segment.
+    Segment &S = Alloc->Segs[KV.first];
+    S.TargetAddr = *Addr;
+    S.Size = Size;
+    S.WorkingMem.resize(Size);
+  }
+  return std::unique_ptr<Allocation>(std::move(Alloc));
+}
+
+PULPTargetProcessControl::PULPTargetProcessControl(
+    std::shared_ptr<SymbolStringPool> SSP, std::unique_ptr<PULPDriver> Driver,
+    JITTargetAddress L2Begin, JITTargetAddress L2End,
+    StringMap<JITTargetAddress> DeviceSymbols)
+    : TargetProcessControl(std::move(SSP)), Driver(std::move(Driver)),
+      OwnedMemMgr(std::make_unique<L2MemoryManager>(*this)),
+      DeviceSymbols(std::move(DeviceSymbols)) {
+  this->TargetTriple = Triple("riscv32-hero-unknown-elf");
+  // The accelerator has no virtual memory, the page size only matters for
+  // the layout of the link graphs.
+  this->PageSize = 4096;
+  this->MemMgr = OwnedMemMgr.get();
+  this->MemAccess = this;
+  FreeL2[L2Begin] = L2End - L2Begin;
+}
+
+PULPTargetProcessControl::~PULPTargetProcessControl() {}
+
+Expected<std::unique_ptr<PULPTargetProcessControl>>
+PULPTargetProcessControl::Create(std::shared_ptr<SymbolStringPool> SSP,
+                                 std::unique_ptr<PULPDriver> Driver,
+                                 JITTargetAddress L2Begin,
+                                 JITTargetAddress L2End,
+                                 StringMap<JITTargetAddress> DeviceSymbols) {
+  if (L2Begin >= L2End || L2End > UINT32_MAX)
+    return make_error<StringError>(
+        formatv("Invalid L2 memory range [{0:x}, {1:x})", L2Begin, L2End),
+        inconvertibleErrorCode());
+  return std::make_unique<PULPTargetProcessControl>(
+      std::move(SSP), std::move(Driver), L2Begin, L2End,
+      std::move(DeviceSymbols));
+}
+
+Expected<tpctypes::DylibHandle>
+PULPTargetProcessControl::loadDylib(const char *DylibPath) {
+  if (DylibPath)
+    return make_error<StringError>(
+        formatv("Cannot load {0} on the PULP accelerator", DylibPath),
+        inconvertibleErrorCode());
+  return 0;
+}
+
+Expected<std::vector<tpctypes::LookupResult>>
+PULPTargetProcessControl::lookupSymbols(ArrayRef<LookupRequest> Request) {
+  std::vector<tpctypes::LookupResult> R;
+  for (auto &Elem : Request) {
+    assert(Elem.Handle == 0 && "Invalid handle");
+    R.push_back(std::vector<JITTargetAddress>());
+    SymbolNameVector MissingSymbols;
+    for (auto &KV : Elem.Symbols) {
+      auto &Sym = KV.first;
+      auto It = DeviceSymbols.find(*Sym);
+      if (It == DeviceSymbols.end()) {
+        if (KV.second == SymbolLookupFlags::RequiredSymbol)
+          MissingSymbols.push_back(Sym);
+        R.back().push_back(0);
+        continue;
+      }
+      R.back().push_back(It->second);
+    }
+    if (!MissingSymbols.empty())
+      return make_error<SymbolsNotFound>(std::move(MissingSymbols));
+  }
+  return R;
+}
+
+Expected<int32_t>
+PULPTargetProcessControl::runAsMain(JITTargetAddress MainFnAddr,
+                                    ArrayRef<std::string> Args) {
+  return make_error<StringError>("PULP kernels are started with runKernel",
+                                 inconvertibleErrorCode());
+}
+
+Expected<tpctypes::WrapperFunctionResult>
+PULPTargetProcessControl::runWrapper(JITTargetAddress WrapperFnAddr,
+                                     ArrayRef<uint8_t> ArgBuffer) {
+  return make_error<StringError>("PULP kernels are started with runKernel",
+                                 inconvertibleErrorCode());
+}
+
+Error PULPTargetProcessControl::disconnect() { return Error::success(); }
+
+Expected<uint32_t>
+PULPTargetProcessControl::runKernel(JITTargetAddress EntryAddr,
+                                    ArrayRef<uint64_t> Args) {
+  // The arguments are passed as 64-bit words, like the arguments of the
+  // kernels offloaded by libomptarget.
+  std::vector<char> ArgWords(std::max<size_t>(Args.size(), 1) *
+                             sizeof(uint64_t));
+  for (size_t I = 0, E = Args.size(); I != E; ++I)
+    support::endian::write64le(ArgWords.data() + I * sizeof(uint64_t),
+                               Args[I]);
+  auto ArgsAddr = allocateL2(ArgWords.size(), sizeof(uint64_t));
+  if (!ArgsAddr)
+    return ArgsAddr.takeError();
+  auto ReleaseArgs =
+      make_scope_exit([&] { deallocateL2(*ArgsAddr, ArgWords.size()); });
+  if (Error Err = Driver->writeMemory(*ArgsAddr, ArgWords))
+    return std::move(Err);
+
+  std::lock_guard<std::mutex> Lock(KernelMutex);
+  // Start the kernel on one cluster, without miss handler threads.
+  for (uint32_t Word : {uint32_t(PULP_START), uint32_t(EntryAddr),
+                        uint32_t(*ArgsAddr), uint32_t(0)})
+    if (Error Err = Driver->writeMailbox(Word))
+      return std::move(Err);
+
+  auto Done = Driver->readMailbox();
+  if (!Done)
+    return Done.takeError();
+  if (*Done != PULP_DONE)
+    return make_error<StringError>(
+        formatv("Mailbox protocol failure: expected PULP_DONE, got {0}",
+                *Done),
+        inconvertibleErrorCode());
+  return Driver->readMailbox();
+}
+
+void PULPTargetProcessControl::writeUInt8s(ArrayRef<tpctypes::UInt8Write> Ws,
+                                           WriteResultFn OnWriteComplete) {
+  for (auto &W : Ws) {
+    char Buf[1] = {char(W.Value)};
+    if (Error Err = Driver->writeMemory(W.Address, Buf))
+      return OnWriteComplete(std::move(Err));
+  }
+  OnWriteComplete(Error::success());
+}
+
+void PULPTargetProcessControl::writeUInt16s(ArrayRef<tpctypes::UInt16Write> Ws,
+                                            WriteResultFn OnWriteComplete) {
+  for (auto &W : Ws) {
+    char Buf[2];
+    support::endian::write16le(Buf, W.Value);
+    if (Error Err = Driver->writeMemory(W.Address, Buf))
+      return OnWriteComplete(std::move(Err));
+  }
+  OnWriteComplete(Error::success());
+}
+
+void PULPTargetProcessControl::writeUInt32s(ArrayRef<tpctypes::UInt32Write> Ws,
+                                            WriteResultFn OnWriteComplete) {
+  for (auto &W : Ws) {
+    char Buf[4];
+    support::endian::write32le(Buf, W.Value);
+    if (Error Err = Driver->writeMemory(W.Address, Buf))
+      return OnWriteComplete(std::move(Err));
+  }
+  OnWriteComplete(Error::success());
+}
+
+void PULPTargetProcessControl::writeUInt64s(ArrayRef<tpctypes::UInt64Write> Ws,
+                                            WriteResultFn OnWriteComplete) {
+  for (auto &W : Ws) {
+    char Buf[8];
+    support::endian::write64le(Buf, W.Value);
+    if (Error Err = Driver->writeMemory(W.Address, Buf))
+      return OnWriteComplete(std::move(Err));
+  }
+  OnWriteComplete(Error::success());
+}
+
+void PULPTargetProcessControl::writeBuffers(ArrayRef<tpctypes::BufferWrite> Ws,
+                                            WriteResultFn OnWriteComplete) {
+  for (auto &W : Ws)
+    if (Error Err = Driver->writeMemory(
+            W.Address, makeArrayRef(W.Buffer.data(), W.Buffer.size())))
+      return OnWriteComplete(std::move(Err));
+  OnWriteComplete(Error::success());
+}
+
+Expected<JITTargetAddress>
+PULPTargetProcessControl::allocateL2(uint64_t Size, uint64_t Alignment) {
+  std::lock_guard<std::mutex> Lock(L2Mutex);
+  // Take the first free range that fits, and keep what is left of it before
+  // and after the allocation.
+  for (auto It = FreeL2.begin(), E = FreeL2.end(); It != E; ++It) {
+    JITTargetAddress Begin = It->first, End = It->first + It->second;
+    JITTargetAddress Addr = alignTo(Begin, std::max<uint64_t>(Alignment, 1));
+    if (Addr + Size > End)
+      continue;
+    FreeL2.erase(It);
+    if (Addr != Begin)
+      FreeL2[Begin] = Addr - Begin;
+    if (Addr + Size != End)
+      FreeL2[Addr + Size] = End - (Addr + Size);
+    return Addr;
+  }
+  return make_error<StringError>(
+      formatv("Out of L2 memory allocating {0} bytes", Size),
+      inconvertibleErrorCode());
+}
+
+void PULPTargetProcessControl::deallocateL2(JITTargetAddress Addr,
+                                            uint64_t Size) {
+  if (!Size)
+    return;
+  std::lock_guard<std::mutex> Lock(L2Mutex);
+  auto It = FreeL2.emplace(Addr, Size).first;
+  // Merge with the free ranges right after and right before.
+  auto Next = std::next(It);
+  if (Next != FreeL2.end() && It->first + It->second == Next->first) {
+    It->second += Next->second;
+    FreeL2.erase(Next);
+  }
+  if (It != FreeL2.begin()) {
+    auto Prev = std::prev(It);
+    if (Prev->first + Prev->second == It->first) {
+      Prev->second += It->second;
+      FreeL2.erase(It);
+    }
+  }
+}
+
+} // end namespace orc
+} // end namespace llvm
@@ -0,0 +1,200 @@
+//===- TieredCompileLayer.cpp - Re-optimize hot functions -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#define DEBUG_TYPE "orc"
+
+namespace llvm {
+namespace orc {
+
+TieredCompileLayer::TieredCompileLayer(ExecutionSession &ES,
+                                       IRLayer &BaseLayer,
+                                       IRLayer &OptimizedLayer,
+                                       uint64_t Threshold)
+    : IRLayer(ES, BaseLayer.getManglingOptions()), BaseLayer(BaseLayer),
+      OptimizedLayer(OptimizedLayer), Threshold(Threshold) {}
+
+Error TieredCompileLayer::addTierUpRuntime(JITDylib &JD,
+                                           MangleAndInterner &Mangle) {
+  JITEvaluatedSymbol ThisPtr(pointerToJITTargetAddress(this),
+                             JITSymbolFlags::Exported);
+  JITEvaluatedSymbol TierUpEntryPtr(pointerToJITTargetAddress(&tierUpEntryPoint),
+                                    JITSymbolFlags::Exported);
+  return JD.define(absoluteSymbols({
+      {Mangle("__orc_tier_up_ctx"), ThisPtr},     // Data Symbol
+      {Mangle("__orc_tier_up"), TierUpEntryPtr} // Callable Symbol
+  }));
+}
+
+void TieredCompileLayer::emit(std::unique_ptr<MaterializationResponsibility> R,
+                              ThreadSafeModule TSM) {
+  assert(TSM && "Null module");
+
+  auto &ES = getExecutionSession();
+  uint64_t ModuleId = NextModuleId++;
+  PendingTierUp P;
+  SmallPtrSet<const GlobalValue *, 8> TieredFns;
+
+  // Pick the functions of this materialization to tier. Local symbols can not
+  // be shared with the optimized copy, so modules with any are left alone.
+  TSM.withModuleDo([&](Module &M) {
+    if (!Threshold || !M.alias_empty() || !M.ifunc_empty())
+      return;
+    for (auto &GV : M.global_values())
+      if (!GV.isDeclaration() && GV.hasLocalLinkage())
+        return;
+
+    MangleAndInterner Mangle(ES, M.getDataLayout());
+    auto &Symbols = R->getSymbols();
+    for (auto &F : M) {
+      if (F.isDeclaration() || F.hasAvailableExternallyLinkage())
+        continue;
+      auto Name = Mangle(F.getName());
+      if (!Symbols.count(Name))
+        continue;
+      TieredFns.insert(&F);
+      P.Renames.push_back(
+          {std::move(Name), Mangle(("__orc_tier2." + F.getName()).str())});
+    }
+  });
+
+  if (TieredFns.empty()) {
+    BaseLayer.emit(std::move(R), std::move(TSM));
+    return;
+  }
+
+  // The optimized copy only defines the tiered functions. Everything else,
+  // including the data, is referred to in the first copy.
+  P.JD = &R->getTargetJITDylib();
+  P.TSM = cloneToNewContext(
+      TSM, [&](const GlobalValue &GV) { return TieredFns.count(&GV); });
+  P.TSM.withModuleDo([](Module &M) {
+    for (auto &GV : make_early_inc_range(M.globals()))
+      if (GV.hasAppendingLinkage())
+        GV.eraseFromParent();
+    for (auto &F : M) {
+      if (F.isDeclaration())
+        continue;
+      F.setName("__orc_tier2." + F.getName());
+      F.setLinkage(GlobalValue::ExternalLinkage);
+      F.setVisibility(GlobalValue::HiddenVisibility);
+      F.setComdat(nullptr);
+    }
+  });
+
+  // Count the calls on entry, after the static allocas, and request the tier
+  // up on the call that reaches the threshold.
+  TSM.withModuleDo([&](Module &M) {
+    auto &MContext = M.getContext();
+    auto *LayerTy = StructType::create(MContext, "Class.TieredCompileLayer");
+    auto *Int64Ty = Type::getInt64Ty(MContext);
+    auto *RuntimeCallTy =
+        FunctionType::get(Type::getVoidTy(MContext),
+                          {LayerTy->getPointerTo(), Int64Ty}, false);
+    auto RuntimeCall = M.getOrInsertFunction("__orc_tier_up", RuntimeCallTy);
+    auto *LayerAddr = new GlobalVariable(
+        M, LayerTy, false, GlobalValue::ExternalLinkage, nullptr,
+        "__orc_tier_up_ctx");
+    auto *Counter = new GlobalVariable(
+        M, Int64Ty, false, GlobalValue::InternalLinkage,
+        ConstantInt::get(Int64Ty, 0), "__orc_tier_up.count");
+    MDNode *Unlikely = MDBuilder(MContext).createBranchWeights(1, 1 << 20);
+
+    for (auto &F : M) {
+      if (!TieredFns.count(&F))
+        continue;
+      BasicBlock &Entry = F.getEntryBlock();
+      auto IP = Entry.getFirstInsertionPt();
+      while (isa<AllocaInst>(IP))
+        ++IP;
+
+      IRBuilder<> Mutator(&Entry, IP);
+      auto *OldCount = Mutator.CreateAtomicRMW(
+          AtomicRMWInst::Add, Counter, ConstantInt::get(Int64Ty, 1),
+          AtomicOrdering::Monotonic);
+      auto *IsHot =
+          Mutator.CreateICmpEQ(OldCount, ConstantInt::get(Int64Ty, Threshold - 1),
+                               "tier_up.is.hot");
+      Mutator.SetInsertPoint(
+          SplitBlockAndInsertIfThen(IsHot, &*IP, false, Unlikely));
+      Mutator.CreateCall(RuntimeCall,
+                         {LayerAddr, ConstantInt::get(Int64Ty, ModuleId)});
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> Lock(PendingMutex);
+    Pending[ModuleId] = std::move(P);
+  }
+
+  BaseLayer.emit(std::move(R), std::move(TSM));
+}
+
+void TieredCompileLayer::tierUpEntryPoint(TieredCompileLayer *Layer,
+                                          uint64_t ModuleId) {
+  assert(Layer && " Null Address Received in __orc_tier_up ");
+  Layer->tierUp(ModuleId);
+}
+
+void TieredCompileLayer::tierUp(uint64_t ModuleId) {
+  assert(Redirect && "No redirect function to switch to optimized code");
+
+  PendingTierUp P;
+  {
+    std::lock_guard<std::mutex> Lock(PendingMutex);
+    auto I = Pending.find(ModuleId);
+    if (I == Pending.end())
+      return;
+    P = std::move(I->second);
+    Pending.erase(I);
+  }
+
+  auto &ES = getExecutionSession();
+  JITDylib *JD = P.JD;
+  if (auto Err = OptimizedLayer.add(*JD, std::move(P.TSM))) {
+    ES.reportError(std::move(Err));
+    return;
+  }
+
+  SymbolLookupSet OptimizedNames;
+  for (auto &KV : P.Renames)
+    OptimizedNames.add(KV.second);
+
+  DEBUG_WITH_TYPE("orc", {
+    dbgs() << "Tiering up in " << JD->getName() << ":";
+    for (auto &KV : P.Renames)
+      dbgs() << " " << *KV.first;
+    dbgs() << "\n";
+  });
+
+  // Compile the optimized copy, then switch the callers over.
+  ES.lookup(
+      LookupKind::Static,
+      makeJITDylibSearchOrder(JD, JITDylibLookupFlags::MatchAllSymbols),
+      std::move(OptimizedNames), SymbolState::Ready,
+      [this, JD, Renames = std::move(P.Renames)](Expected<SymbolMap> Result) {
+        if (!Result) {
+          getExecutionSession().reportError(Result.takeError());
+          return;
+        }
+        for (auto &KV : Renames)
+          if (auto Err =
+                  Redirect(*JD, KV.first, (*Result)[KV.second].getAddress()))
+            getExecutionSession().reportError(std::move(Err));
+      },
+      NoDependenciesToRegister);
+}
+
+} // end namespace orc
+} // end namespace llvm
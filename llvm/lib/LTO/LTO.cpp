@@ -33,6 +33,7 @@
 #include "llvm/Object/IRObjectFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
@@ -79,7 +80,8 @@ void llvm::computeLTOCacheKey(
     const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
     const GVSummaryMapTy &DefinedGlobals,
     const std::set<GlobalValue::GUID> &CfiFunctionDefs,
-    const std::set<GlobalValue::GUID> &CfiFunctionDecls) {
+    const std::set<GlobalValue::GUID> &CfiFunctionDecls,
+    bool IncludeModuleHashes) {
   // Compute the unique hash for this entry.
   // This is based on the current compiler version, the module itself, the
   // export list, the hash for every single module in the import list, the
@@ -138,8 +140,10 @@ void llvm::computeLTOCacheKey(
   AddString(Conf.DwoDir);
 
   // Include the hash for the current module
-  auto ModHash = Index.getModuleHash(ModuleID);
-  Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+  if (IncludeModuleHashes) {
+    auto ModHash = Index.getModuleHash(ModuleID);
+    Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+  }
 
   std::vector<uint64_t> ExportsGUID;
   ExportsGUID.reserve(ExportList.size());
@@ -170,8 +174,11 @@ void llvm::computeLTOCacheKey(
              [](const ImportMapIteratorTy &Lhs, const ImportMapIteratorTy &Rhs)
                  -> bool { return Lhs->getKey() < Rhs->getKey(); });
   for (const ImportMapIteratorTy &EntryIt : ImportModulesVector) {
-    auto ModHash = Index.getModuleHash(EntryIt->first());
-    Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    if (IncludeModuleHashes) {
+      auto ModHash = Index.getModuleHash(EntryIt->first());
+      Hasher.update(
+          ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+    }
 
     AddUint64(EntryIt->second.size());
     for (auto &Fn : EntryIt->second)
@@ -1111,6 +1118,97 @@ public:
   virtual unsigned getThreadCount() = 0;
 };
 
+namespace {
+/// Buffers the object of a ThinLTO backend that missed the post-import cache,
+/// hands it to the coarse cache entry and then stores it under its post-import
+/// key as well.
+struct PostImportCacheStream : NativeObjectStream {
+  std::unique_ptr<SmallString<0>> Buffer;
+  AddStreamFn CacheAddStream;
+  std::string EntryPath;
+  std::string TempFilenameModel;
+  unsigned Task;
+
+  PostImportCacheStream(std::unique_ptr<SmallString<0>> Buffer,
+                        AddStreamFn CacheAddStream, std::string EntryPath,
+                        std::string TempFilenameModel, unsigned Task)
+      : NativeObjectStream(std::make_unique<raw_svector_ostream>(*Buffer)),
+        Buffer(std::move(Buffer)), CacheAddStream(std::move(CacheAddStream)),
+        EntryPath(std::move(EntryPath)),
+        TempFilenameModel(std::move(TempFilenameModel)), Task(Task) {}
+
+  ~PostImportCacheStream() {
+    OS.reset();
+    // Committing the coarse entry also adds the object to the link.
+    *CacheAddStream(Task)->OS << *Buffer;
+
+    // The post-import entry is only an optimization, failing to write it is
+    // not an error.
+    Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+        TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+    if (!Temp) {
+      consumeError(Temp.takeError());
+      return;
+    }
+    {
+      raw_fd_ostream TempOS(Temp->FD, /*shouldClose=*/false);
+      TempOS << *Buffer;
+    }
+    if (Error E = Temp->keep(EntryPath)) {
+      consumeError(std::move(E));
+      consumeError(Temp->discard());
+    }
+  }
+};
+} // end anonymous namespace
+
+/// Looks up the object of the ThinLTO backend for the imported module \p M.
+/// \p PartialKey is the cache key without the module hashes. On a hit the
+/// object is written to the coarse cache entry through \p CacheAddStream and
+/// an empty function is returned.
+static AddStreamFn lookupPostImportCache(StringRef CacheDir,
+                                         StringRef PartialKey, const Module &M,
+                                         unsigned Task,
+                                         AddStreamFn CacheAddStream) {
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream BitcodeOS(Bitcode);
+    WriteBitcodeToFile(M, BitcodeOS);
+  }
+  SHA1 Hasher;
+  Hasher.update(PartialKey);
+  Hasher.update(Bitcode);
+
+  SmallString<64> EntryPath;
+  sys::path::append(EntryPath, CacheDir,
+                    "llvmcache-post-import-" + toHex(Hasher.result()));
+  // Like the coarse entries, a hit updates the access time so that the cache
+  // pruner keeps the entries that are in use.
+  Expected<sys::fs::file_t> FDOrErr =
+      sys::fs::openNativeFileForRead(Twine(EntryPath), sys::fs::OF_UpdateAtime);
+  if (FDOrErr) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+        MemoryBuffer::getOpenFile(*FDOrErr, EntryPath, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+    sys::fs::closeFile(*FDOrErr);
+    if (MBOrErr) {
+      *CacheAddStream(Task)->OS << (*MBOrErr)->getBuffer();
+      return AddStreamFn();
+    }
+  } else {
+    consumeError(FDOrErr.takeError());
+  }
+
+  SmallString<64> TempFilenameModel;
+  sys::path::append(TempFilenameModel, CacheDir, "Thin-%%%%%%.tmp.o");
+  std::string Entry = std::string(EntryPath.str());
+  std::string Model = std::string(TempFilenameModel.str());
+  return [=](unsigned Task) -> std::unique_ptr<NativeObjectStream> {
+    return std::make_unique<PostImportCacheStream>(
+        std::make_unique<SmallString<0>>(), CacheAddStream, Entry, Model, Task);
+  };
+}
+
 namespace {
 class InProcessThinBackend : public ThinBackendProc {
   ThreadPool BackendThreadPool;
@@ -1147,14 +1245,16 @@ public:
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       const GVSummaryMapTy &DefinedGlobals,
       MapVector<StringRef, BitcodeModule> &ModuleMap) {
-    auto RunThinBackend = [&](AddStreamFn AddStream) {
+    auto RunThinBackend = [&](AddStreamFn AddStream,
+                              ThinBackendPostImportFn PostImport) {
       LTOLLVMContext BackendContext(Conf);
       Expected<std::unique_ptr<Module>> MOrErr = BM.parseModule(BackendContext);
       if (!MOrErr)
         return MOrErr.takeError();
 
       return thinBackend(Conf, Task, AddStream, **MOrErr, CombinedIndex,
-                         ImportList, DefinedGlobals, ModuleMap);
+                         ImportList, DefinedGlobals, ModuleMap,
+                         std::vector<uint8_t>(), PostImport);
     };
 
     auto ModuleID = BM.getModuleIdentifier();
@@ -1164,17 +1264,29 @@ public:
                [](uint32_t V) { return V == 0; }))
       // Cache disabled or no entry for this module in the combined index or
       // no module hash.
-      return RunThinBackend(AddStream);
+      return RunThinBackend(AddStream, nullptr);
 
     SmallString<40> Key;
     // The module may be cached, this helps handling it.
     computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
                        ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
                        CfiFunctionDecls);
-    if (AddStreamFn CacheAddStream = Cache(Task, Key))
-      return RunThinBackend(CacheAddStream);
+    AddStreamFn CacheAddStream = Cache(Task, Key);
+    if (!CacheAddStream)
+      return Error::success();
+    if (Conf.ThinLTOPostImportCacheDir.empty())
+      return RunThinBackend(CacheAddStream, nullptr);
 
-    return Error::success();
+    // The key covers the whole of every module imported from. Look the object
+    // up again once the imports are done, by the IR the backend actually sees.
+    SmallString<40> PartialKey;
+    computeLTOCacheKey(PartialKey, Conf, CombinedIndex, ModuleID, ImportList,
+                       ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
+                       CfiFunctionDecls, /*IncludeModuleHashes=*/false);
+    return RunThinBackend(CacheAddStream, [&](const Module &M) {
+      return lookupPostImportCache(Conf.ThinLTOPostImportCacheDir, PartialKey,
+                                   M, Task, CacheAddStream);
+    });
   }
 
   Error start(
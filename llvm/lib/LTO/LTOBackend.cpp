@@ -74,6 +74,12 @@ static cl::opt<bool> ThinLTOAssumeMerged(
     cl::desc("Assume the input has already undergone ThinLTO function "
              "importing and the other pre-optimization pipeline changes."));
 
+static cl::opt<bool> DiscardIRAfterCodeGen(
+    "lto-discard-ir-after-codegen", cl::init(false),
+    cl::desc("Free the body of each function as soon as its machine code "
+             "has been emitted, to reduce the peak memory use of the LTO "
+             "code generator."));
+
 LLVM_ATTRIBUTE_NORETURN static void reportOpenError(StringRef Path, Twine Msg) {
   errs() << "failed to open " << Path << ": " << Msg << '\n';
   errs().flush();
@@ -406,6 +412,39 @@ bool lto::opt(const Config &Conf, TargetMachine *TM, unsigned Task, Module &Mod,
   return !Conf.PostOptModuleHook || Conf.PostOptModuleHook(Task, Mod);
 }
 
+namespace {
+/// Runs after the machine function has been emitted and freed, and replaces
+/// the IR body of the function with a single unreachable. The function stays
+/// a definition with its linkage, so that the remaining functions and the
+/// module level emission in the AsmPrinter see no difference.
+class DiscardFunctionBody : public FunctionPass {
+public:
+  static char ID;
+  DiscardFunctionBody() : FunctionPass(ID) {}
+
+  StringRef getPassName() const override { return "Discard function body"; }
+
+  bool runOnFunction(Function &F) override {
+    if (F.isDeclaration())
+      return false;
+    // Block addresses may still be emitted in global initializers.
+    for (BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        return false;
+
+    for (BasicBlock &BB : F)
+      BB.dropAllReferences();
+    while (!F.empty())
+      F.begin()->eraseFromParent();
+    new UnreachableInst(F.getContext(),
+                        BasicBlock::Create(F.getContext(), "", &F));
+    return true;
+  }
+};
+} // end anonymous namespace
+
+char DiscardFunctionBody::ID = 0;
+
 static void codegen(const Config &Conf, TargetMachine *TM,
                     AddStreamFn AddStream, unsigned Task, Module &Mod,
                     const ModuleSummaryIndex &CombinedIndex) {
@@ -449,6 +488,8 @@ static void codegen(const Config &Conf, TargetMachine *TM,
                               DwoOut ? &DwoOut->os() : nullptr,
                               Conf.CGFileType))
     report_fatal_error("Failed to setup codegen");
+  if (DiscardIRAfterCodeGen)
+    CodeGenPasses.add(new DiscardFunctionBody());
   CodeGenPasses.run(Mod);
 
   if (DwoOut)
@@ -584,7 +625,8 @@ Error lto::thinBackend(const Config &Conf, unsigned Task, AddStreamFn AddStream,
                        const FunctionImporter::ImportMapTy &ImportList,
                        const GVSummaryMapTy &DefinedGlobals,
                        MapVector<StringRef, BitcodeModule> &ModuleMap,
-                       const std::vector<uint8_t> &CmdArgs) {
+                       const std::vector<uint8_t> &CmdArgs,
+                       ThinBackendPostImportFn PostImport) {
   Expected<const Target *> TOrErr = initAndLookupTarget(Conf, Mod);
   if (!TOrErr)
     return TOrErr.takeError();
@@ -667,6 +709,12 @@ Error lto::thinBackend(const Config &Conf, unsigned Task, AddStreamFn AddStream,
   if (Conf.PostImportModuleHook && !Conf.PostImportModuleHook(Task, Mod))
     return finalizeOptimizationRemarks(std::move(DiagnosticOutputFile));
 
+  if (PostImport) {
+    AddStream = PostImport(Mod);
+    if (!AddStream)
+      return finalizeOptimizationRemarks(std::move(DiagnosticOutputFile));
+  }
+
   return OptimizeAndCodegen(Mod, TM.get(), std::move(DiagnosticOutputFile));
 }
 
@@ -46,6 +46,7 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/SwapByteOrder.h"
@@ -162,6 +163,19 @@ struct ELFWriter {
                              SmallVectorImpl<char> &CompressedContents,
                              bool ZLibStyle, unsigned Alignment);
 
+  // The contents of a debug section which is written compressed.
+  struct CompressedSection {
+    SmallVector<char, 0> UncompressedData;
+    // Empty if compression failed.
+    SmallVector<char, 0> CompressedContents;
+  };
+
+  // Debug sections compressed ahead of writeSectionData().
+  DenseMap<const MCSectionELF *, CompressedSection> CompressedSections;
+
+  bool shouldCompress(const MCAssembler &Asm, const MCSectionELF &Section);
+  void compressSections(const MCAssembler &Asm, const MCAsmLayout &Layout);
+
 public:
   ELFWriter(ELFObjectWriter &OWriter, raw_pwrite_stream &OS,
             bool IsLittleEndian, DwoMode Mode)
@@ -840,46 +854,74 @@ bool ELFWriter::maybeWriteCompression(
   return true;
 }
 
-void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
-                                 const MCAsmLayout &Layout) {
-  MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
-  StringRef SectionName = Section.getName();
-
-  auto &MC = Asm.getContext();
-  const auto &MAI = MC.getAsmInfo();
+bool ELFWriter::shouldCompress(const MCAssembler &Asm,
+                               const MCSectionELF &Section) {
+  const MCAsmInfo *MAI = Asm.getContext().getAsmInfo();
+  if (MAI->compressDebugSections() == DebugCompressionType::None)
+    return false;
+  assert((MAI->compressDebugSections() == DebugCompressionType::Z ||
+          MAI->compressDebugSections() == DebugCompressionType::GNU) &&
+         "expected zlib or zlib-gnu style compression");
 
   // Compressing debug_frame requires handling alignment fragments which is
   // more work (possibly generalizing MCAssembler.cpp:writeFragment to allow
   // for writing to arbitrary buffers) for little benefit.
-  bool CompressionEnabled =
-      MAI->compressDebugSections() != DebugCompressionType::None;
-  if (!CompressionEnabled || !SectionName.startswith(".debug_") ||
-      SectionName == ".debug_frame") {
-    Asm.writeSectionData(W.OS, &Section, Layout);
-    return;
-  }
+  StringRef SectionName = Section.getName();
+  return SectionName.startswith(".debug_") && SectionName != ".debug_frame";
+}
 
-  assert((MAI->compressDebugSections() == DebugCompressionType::Z ||
-          MAI->compressDebugSections() == DebugCompressionType::GNU) &&
-         "expected zlib or zlib-gnu style compression");
+// zlib dominates the time it takes to write an object with compressed debug
+// info, so render and compress all such sections in parallel up front. The
+// layout is final at this point, and writing section data only reads it.
+void ELFWriter::compressSections(const MCAssembler &Asm,
+                                 const MCAsmLayout &Layout) {
+  std::vector<MCSectionELF *> ToCompress;
+  for (MCSection &Sec : Asm) {
+    MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
+    if (Mode == NonDwoOnly && isDwoSection(Section))
+      continue;
+    if (Mode == DwoOnly && !isDwoSection(Section))
+      continue;
+    if (shouldCompress(Asm, Section)) {
+      ToCompress.push_back(&Section);
+      CompressedSections[&Section];
+    }
+  }
 
-  SmallVector<char, 128> UncompressedData;
-  raw_svector_ostream VecOS(UncompressedData);
-  Asm.writeSectionData(VecOS, &Section, Layout);
+  parallelForEach(ToCompress, [&](MCSectionELF *Section) {
+    CompressedSection &Data = CompressedSections.find(Section)->second;
+    raw_svector_ostream VecOS(Data.UncompressedData);
+    Asm.writeSectionData(VecOS, Section, Layout);
+    if (Error E = zlib::compress(
+            StringRef(Data.UncompressedData.data(),
+                      Data.UncompressedData.size()),
+            Data.CompressedContents)) {
+      consumeError(std::move(E));
+      Data.CompressedContents.clear();
+    }
+  });
+}
 
-  SmallVector<char, 128> CompressedContents;
-  if (Error E = zlib::compress(
-          StringRef(UncompressedData.data(), UncompressedData.size()),
-          CompressedContents)) {
-    consumeError(std::move(E));
-    W.OS << UncompressedData;
+void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
+                                 const MCAsmLayout &Layout) {
+  MCSectionELF &Section = static_cast<MCSectionELF &>(Sec);
+  auto It = CompressedSections.find(&Section);
+  if (It == CompressedSections.end()) {
+    Asm.writeSectionData(W.OS, &Section, Layout);
     return;
   }
 
-  bool ZlibStyle = MAI->compressDebugSections() == DebugCompressionType::Z;
-  if (!maybeWriteCompression(UncompressedData.size(), CompressedContents,
-                             ZlibStyle, Sec.getAlignment())) {
-    W.OS << UncompressedData;
+  CompressedSection Data = std::move(It->second);
+  CompressedSections.erase(It);
+
+  auto &MC = Asm.getContext();
+  bool ZlibStyle =
+      MC.getAsmInfo()->compressDebugSections() == DebugCompressionType::Z;
+  if (Data.CompressedContents.empty() ||
+      !maybeWriteCompression(Data.UncompressedData.size(),
+                             Data.CompressedContents, ZlibStyle,
+                             Sec.getAlignment())) {
+    W.OS << Data.UncompressedData;
     return;
   }
 
@@ -891,9 +933,10 @@ void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
     Section.setAlignment(is64Bit() ? Align(8) : Align(4));
   } else {
     // Add "z" prefix to section name. This is zlib-gnu style.
-    MC.renameELFSection(&Section, (".z" + SectionName.drop_front(1)).str());
+    MC.renameELFSection(&Section,
+                        (".z" + Section.getName().drop_front(1)).str());
   }
-  W.OS << CompressedContents;
+  W.OS << Data.CompressedContents;
 }
 
 void ELFWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type, uint64_t Flags,
@@ -1083,6 +1126,8 @@ uint64_t ELFWriter::writeObject(MCAssembler &Asm, const MCAsmLayout &Layout) {
 
   std::map<const MCSymbol *, std::vector<const MCSectionELF *>> GroupMembers;
 
+  compressSections(Asm, Layout);
+
   // Write out the ELF header ...
   writeHeader(Asm);
 
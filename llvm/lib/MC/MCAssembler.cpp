@@ -69,6 +69,10 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionRelaxationSteps,
+          "Number of relaxation passes over the fragments of a section");
+STATISTIC(SkippedSectionRelaxations,
+          "Number of section relaxation passes skipped as nothing changed");
 
 } // end namespace stats
 } // end anonymous namespace
@@ -844,15 +848,13 @@ void MCAssembler::layout(MCAsmLayout &Layout) {
   }
 
   // Layout until everything fits.
-  while (layoutOnce(Layout)) {
+  RelaxationState State(SectionIndex);
+  for (MCSection &Sec : *this)
+    State.FirstDependentFragment[Sec.getOrdinal()] =
+        findLayoutDependentFragment(Sec);
+  while (layoutOnce(Layout, State))
     if (getContext().hadError())
       return;
-    // Size of fragments in one section can depend on the size of fragments in
-    // another. If any fragment has changed size, we have to re-layout (and
-    // as a result possibly further relax) all.
-    for (MCSection &Sec : *this)
-      Layout.invalidateFragmentsFrom(&*Sec.begin());
-  }
 
   DEBUG_WITH_TYPE("mc-dump", {
       errs() << "assembler backend - post-relaxation\n--\n";
@@ -1230,33 +1232,70 @@ bool MCAssembler::relaxFragment(MCAsmLayout &Layout, MCFragment &F) {
 }
 
 bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
+  ++stats::SectionRelaxationSteps;
 
-  // Attempt to relax all the fragments in the section.
+  // When a fragment is relaxed, the fragments following it are invalidated
+  // right away, as their offset is going to change. The fragments relaxed
+  // later in this pass then see the new offsets, so that a chain of growing
+  // branches is usually resolved in a single pass. Invalidating is cheap, the
+  // layout of the following fragments is only recomputed on demand.
+  bool WasRelaxed = false;
   for (MCFragment &Frag : Sec) {
-    // Check if this is a fragment that needs relaxation.
-    bool RelaxedFrag = relaxFragment(Layout, Frag);
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = &Frag;
+    if (relaxFragment(Layout, Frag)) {
+      Layout.invalidateFragmentsFrom(&Frag);
+      WasRelaxed = true;
+    }
   }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
+  return WasRelaxed;
+}
+
+MCFragment *MCAssembler::findLayoutDependentFragment(MCSection &Sec) const {
+  for (MCFragment &Frag : Sec) {
+    switch (Frag.getKind()) {
+    case MCFragment::FT_Fill: {
+      int64_t NumValues;
+      if (!cast<MCFillFragment>(Frag).getNumValues().evaluateAsAbsolute(
+              NumValues))
+        return &Frag;
+      break;
+    }
+    case MCFragment::FT_Org:
+      return &Frag;
+    default:
+      break;
+    }
   }
-  return false;
+  return nullptr;
 }
 
-bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
+bool MCAssembler::layoutOnce(MCAsmLayout &Layout, RelaxationState &State) {
   ++stats::RelaxationSteps;
 
   bool WasRelaxed = false;
   for (MCSection &Sec : *this) {
+    // The fragments of a section only depend on the layout of other sections
+    // through the values of symbols. If nothing was relaxed since the section
+    // reached its fixed point, it cannot change.
+    unsigned &StableAt = State.StableAt[Sec.getOrdinal()];
+    if (StableAt == State.Changes) {
+      ++stats::SkippedSectionRelaxations;
+      continue;
+    }
+    // The size of .fill and .org fragments is computed from expressions, which
+    // may refer to other sections. Only these and the fragments after them
+    // have to be laid out again.
+    if (StableAt != RelaxationState::Never)
+      if (MCFragment *F = State.FirstDependentFragment[Sec.getOrdinal()])
+        Layout.invalidateFragmentsFrom(F);
+
+    bool SectionRelaxed = false;
     while (layoutSectionOnce(Layout, Sec))
+      SectionRelaxed = true;
+    if (SectionRelaxed) {
+      ++State.Changes;
       WasRelaxed = true;
+    }
+    StableAt = State.Changes;
   }
 
   return WasRelaxed;
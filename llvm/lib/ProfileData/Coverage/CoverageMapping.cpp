@@ -27,6 +27,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -203,9 +204,20 @@ ArrayRef<unsigned> CoverageMapping::getImpreciseRecordIndicesForFilename(
   return RecordIt->second;
 }
 
+struct CoverageMapping::PendingRecord {
+  /// The error loading the record, if any.
+  Optional<Error> Err;
+  /// The function record, unless the record is dropped.
+  Optional<FunctionRecord> Function;
+  size_t FilenamesHash = 0;
+  /// The name and hash of the record, if the profile has a different hash.
+  Optional<std::pair<std::string, uint64_t>> HashMismatch;
+};
+
 Error CoverageMapping::loadFunctionRecord(
     const CoverageMappingRecord &Record,
-    IndexedInstrProfReader &ProfileReader) {
+    IndexedInstrProfReader &ProfileReader, std::mutex &ProfileMu,
+    PendingRecord &P) const {
   StringRef OrigFuncName = Record.FunctionName;
   if (OrigFuncName.empty())
     return make_error<CoverageMapError>(coveragemap_error::malformed);
@@ -218,12 +230,16 @@ Error CoverageMapping::loadFunctionRecord(
   CounterMappingContext Ctx(Record.Expressions);
 
   std::vector<uint64_t> Counts;
-  if (Error E = ProfileReader.getFunctionCounts(Record.FunctionName,
-                                                Record.FunctionHash, Counts)) {
-    instrprof_error IPE = InstrProfError::take(std::move(E));
+  Error CountsErr = [&] {
+    std::lock_guard<std::mutex> Lock(ProfileMu);
+    return ProfileReader.getFunctionCounts(Record.FunctionName,
+                                           Record.FunctionHash, Counts);
+  }();
+  if (CountsErr) {
+    instrprof_error IPE = InstrProfError::take(std::move(CountsErr));
     if (IPE == instrprof_error::hash_mismatch) {
-      FuncHashMismatches.emplace_back(std::string(Record.FunctionName),
-                                      Record.FunctionHash);
+      P.HashMismatch.emplace(std::string(Record.FunctionName),
+                             Record.FunctionHash);
       return Error::success();
     } else if (IPE != instrprof_error::unknown_function)
       return make_error<InstrProfError>(IPE);
@@ -242,6 +258,16 @@ Error CoverageMapping::loadFunctionRecord(
       Record.MappingRegions[0].Count.isZero() && Counts[0] > 0)
     return Error::success();
 
+  // Don't create records for (filenames, function) pairs we've already seen.
+  // RecordProvenance only changes between batches, and addPendingRecords
+  // drops the duplicates within a batch.
+  auto FilenamesHash = hash_combine_range(Record.Filenames.begin(),
+                                          Record.Filenames.end());
+  auto ProvenanceIt = RecordProvenance.find(FilenamesHash);
+  if (ProvenanceIt != RecordProvenance.end() &&
+      ProvenanceIt->second.count(hash_value(OrigFuncName)))
+    return Error::success();
+
   FunctionRecord Function(OrigFuncName, Record.Filenames);
   for (const auto &Region : Record.MappingRegions) {
     Expected<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
@@ -257,41 +283,110 @@ Error CoverageMapping::loadFunctionRecord(
     Function.pushRegion(Region, *ExecutionCount, *AltExecutionCount);
   }
 
-  // Don't create records for (filenames, function) pairs we've already seen.
-  auto FilenamesHash = hash_combine_range(Record.Filenames.begin(),
-                                          Record.Filenames.end());
-  if (!RecordProvenance[FilenamesHash].insert(hash_value(OrigFuncName)).second)
-    return Error::success();
+  P.Function = std::move(Function);
+  P.FilenamesHash = FilenamesHash;
+  return Error::success();
+}
 
-  Functions.push_back(std::move(Function));
-
-  // Performance optimization: keep track of the indices of the function records
-  // which correspond to each filename. This can be used to substantially speed
-  // up queries for coverage info in a file.
-  unsigned RecordIndex = Functions.size() - 1;
-  for (StringRef Filename : Record.Filenames) {
-    auto &RecordIndices = FilenameHash2RecordIndices[hash_value(Filename)];
-    // Note that there may be duplicates in the filename set for a function
-    // record, because of e.g. macro expansions in the function in which both
-    // the macro and the function are defined in the same file.
-    if (RecordIndices.empty() || RecordIndices.back() != RecordIndex)
-      RecordIndices.push_back(RecordIndex);
-  }
+Error CoverageMapping::addPendingRecords(
+    MutableArrayRef<PendingRecord> Pending) {
+  for (PendingRecord &P : Pending) {
+    if (P.Err) {
+      // Loading stops at the first error, drop the ones of later records.
+      Error Err = std::move(*P.Err);
+      for (PendingRecord &Later : Pending)
+        if (&Later != &P && Later.Err)
+          consumeError(std::move(*Later.Err));
+      return Err;
+    }
+    if (P.HashMismatch)
+      FuncHashMismatches.push_back(std::move(*P.HashMismatch));
+    if (!P.Function)
+      continue;
+    if (!RecordProvenance[P.FilenamesHash]
+             .insert(hash_value(P.Function->Name))
+             .second)
+      continue;
 
+    // The filenames point into the reader until they are uniqued here.
+    for (StringRef &Filename : P.Function->Filenames)
+      Filename = Filenames.insert(Filename).first->getKey();
+    Functions.push_back(std::move(*P.Function));
+
+    // Performance optimization: keep track of the indices of the function
+    // records which correspond to each filename. This can be used to
+    // substantially speed up queries for coverage info in a file.
+    unsigned RecordIndex = Functions.size() - 1;
+    for (StringRef Filename : Functions.back().Filenames) {
+      auto &RecordIndices = FilenameHash2RecordIndices[hash_value(Filename)];
+      // Note that there may be duplicates in the filename set for a function
+      // record, because of e.g. macro expansions in the function in which both
+      // the macro and the function are defined in the same file.
+      if (RecordIndices.empty() || RecordIndices.back() != RecordIndex)
+        RecordIndices.push_back(RecordIndex);
+    }
+  }
   return Error::success();
 }
 
 Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
     ArrayRef<std::unique_ptr<CoverageMappingReader>> CoverageReaders,
-    IndexedInstrProfReader &ProfileReader) {
+    IndexedInstrProfReader &ProfileReader, unsigned NumThreads) {
   auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
 
+  std::mutex ProfileMu;
+  Optional<ThreadPool> Pool;
+  if (NumThreads != 1)
+    Pool.emplace(hardware_concurrency(NumThreads));
+
+  // Records are decoded and evaluated concurrently in batches, the batches
+  // are added in order. This keeps the result the same as with one thread.
+  const size_t BatchSize = 1 << 14;
   for (const auto &CoverageReader : CoverageReaders) {
-    for (auto RecordOrErr : *CoverageReader) {
-      if (Error E = RecordOrErr.takeError())
-        return std::move(E);
-      const auto &Record = *RecordOrErr;
-      if (Error E = Coverage->loadFunctionRecord(Record, ProfileReader))
+    size_t NumRecords = CoverageReader->getNumRecords();
+    if (!NumRecords) {
+      for (auto RecordOrErr : *CoverageReader) {
+        if (Error E = RecordOrErr.takeError())
+          return std::move(E);
+        PendingRecord P;
+        if (Error E = Coverage->loadFunctionRecord(*RecordOrErr, ProfileReader,
+                                                   ProfileMu, P))
+          return std::move(E);
+        if (Error E = Coverage->addPendingRecords(P))
+          return std::move(E);
+      }
+      continue;
+    }
+
+    for (size_t Begin = 0; Begin < NumRecords; Begin += BatchSize) {
+      std::vector<PendingRecord> Pending(
+          std::min(BatchSize, NumRecords - Begin));
+      // Each task reuses one set of buffers for the records it decodes.
+      auto LoadRange = [&](size_t From, size_t To) {
+        CoverageMappingReader::RecordBuffers Buffers;
+        for (size_t I = From; I != To; ++I) {
+          CoverageMappingRecord Record;
+          Error E = CoverageReader->readRecord(Begin + I, Record, Buffers);
+          if (!E)
+            E = Coverage->loadFunctionRecord(Record, ProfileReader, ProfileMu,
+                                             Pending[I]);
+          if (E) {
+            Pending[I].Err = std::move(E);
+            return;
+          }
+        }
+      };
+      if (!Pool || Pending.size() < 2) {
+        LoadRange(0, Pending.size());
+      } else {
+        size_t NumTasks =
+            std::min<size_t>(Pool->getThreadCount(), Pending.size());
+        for (size_t Task = 0; Task != NumTasks; ++Task)
+          Pool->async(LoadRange, Pending.size() * Task / NumTasks,
+                      Pending.size() * (Task + 1) / NumTasks);
+        Pool->wait();
+      }
+      if (Error E = Coverage->addPendingRecords(Pending))
         return std::move(E);
     }
   }
@@ -311,7 +406,8 @@ static Error handleMaybeNoDataFoundError(Error E) {
 
 Expected<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(ArrayRef<StringRef> ObjectFilenames,
-                      StringRef ProfileFilename, ArrayRef<StringRef> Arches) {
+                      StringRef ProfileFilename, ArrayRef<StringRef> Arches,
+                      unsigned NumThreads) {
   auto ProfileReaderOrErr = IndexedInstrProfReader::create(ProfileFilename);
   if (Error E = ProfileReaderOrErr.takeError())
     return std::move(E);
@@ -343,7 +439,7 @@ CoverageMapping::load(ArrayRef<StringRef> ObjectFilenames,
   // had coverage data. Return an error in the latter case.
   if (Readers.empty() && !ObjectFilenames.empty())
     return make_error<CoverageMapError>(coveragemap_error::no_data_found);
-  return load(Readers, *ProfileReader);
+  return load(Readers, *ProfileReader, NumThreads);
 }
 
 namespace {
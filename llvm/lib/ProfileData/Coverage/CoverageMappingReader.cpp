@@ -1071,23 +1071,31 @@ Error BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
   if (CurrentRecord >= MappingRecords.size())
     return make_error<CoverageMapError>(coveragemap_error::eof);
 
-  FunctionsFilenames.clear();
-  Expressions.clear();
-  MappingRegions.clear();
-  auto &R = MappingRecords[CurrentRecord];
+  if (auto Err = readRecord(CurrentRecord, Record, Buffers))
+    return Err;
+
+  ++CurrentRecord;
+  return Error::success();
+}
+
+Error BinaryCoverageReader::readRecord(size_t Index,
+                                       CoverageMappingRecord &Record,
+                                       RecordBuffers &Buffers) const {
+  Buffers.Filenames.clear();
+  Buffers.Expressions.clear();
+  Buffers.MappingRegions.clear();
+  auto &R = MappingRecords[Index];
   RawCoverageMappingReader Reader(
       R.CoverageMapping,
       makeArrayRef(Filenames).slice(R.FilenamesBegin, R.FilenamesSize),
-      FunctionsFilenames, Expressions, MappingRegions);
+      Buffers.Filenames, Buffers.Expressions, Buffers.MappingRegions);
   if (auto Err = Reader.read())
     return Err;
 
   Record.FunctionName = R.FunctionName;
   Record.FunctionHash = R.FunctionHash;
-  Record.Filenames = FunctionsFilenames;
-  Record.Expressions = Expressions;
-  Record.MappingRegions = MappingRegions;
-
-  ++CurrentRecord;
+  Record.Filenames = Buffers.Filenames;
+  Record.Expressions = Buffers.Expressions;
+  Record.MappingRegions = Buffers.MappingRegions;
   return Error::success();
 }
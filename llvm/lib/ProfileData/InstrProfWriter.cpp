@@ -252,9 +252,25 @@ void InstrProfWriter::addRecord(StringRef Name, uint64_t Hash,
 
 void InstrProfWriter::mergeRecordsFromWriter(InstrProfWriter &&IPW,
                                              function_ref<void(Error)> Warn) {
-  for (auto &I : IPW.FunctionData)
-    for (auto &Func : I.getValue())
-      addRecord(I.getKey(), Func.first, std::move(Func.second), 1, Warn);
+  // A writer that got no input does not know the kind of profile yet.
+  if (IPW.ProfileKind != PF_Unknown)
+    if (Error E = setIsIRLevelProfile(IPW.ProfileKind != PF_FE,
+                                      IPW.ProfileKind == PF_IRLevelWithCS)) {
+      Warn(std::move(E));
+      return;
+    }
+  if (IPW.InstrEntryBBEnabled)
+    InstrEntryBBEnabled = true;
+
+  // Release the records of IPW as they are merged, so that merging two
+  // writers does not need room for both of them.
+  for (auto I = IPW.FunctionData.begin(), E = IPW.FunctionData.end();
+       I != E;) {
+    auto Cur = I++;
+    for (auto &Func : Cur->getValue())
+      addRecord(Cur->getKey(), Func.first, std::move(Func.second), 1, Warn);
+    IPW.FunctionData.erase(Cur);
+  }
 }
 
 bool InstrProfWriter::shouldEncodeData(const ProfilingData &PD) {
@@ -428,21 +428,25 @@ ErrorOr<StringRef> SampleProfileReaderExtBinaryBase::readStringFromTable() {
   if (std::error_code EC = Idx.getError())
     return EC;
 
+  return getFixedLengthMD5Name(*Idx);
+}
+
+uint64_t SampleProfileReaderExtBinaryBase::getFixedLengthMD5(uint32_t Idx) {
+  using namespace support;
+  return endian::read<uint64_t, little, unaligned>(MD5NameMemStart +
+                                                   Idx * sizeof(uint64_t));
+}
+
+StringRef SampleProfileReaderExtBinaryBase::getFixedLengthMD5Name(uint32_t Idx) {
   // Check whether the name to be accessed has been accessed before,
   // if not, read it from memory directly.
-  StringRef &SR = NameTable[*Idx];
+  StringRef &SR = NameTable[Idx];
   if (SR.empty()) {
-    const uint8_t *SavedData = Data;
-    Data = MD5NameMemStart + ((*Idx) * sizeof(uint64_t));
-    auto FID = readUnencodedNumber<uint64_t>();
-    if (std::error_code EC = FID.getError())
-      return EC;
     // Save the string converted from uint64_t in MD5StringBuf. All the
     // references to the name are all StringRefs refering to the string
     // in MD5StringBuf.
-    MD5StringBuf->push_back(std::to_string(*FID));
+    MD5StringBuf->push_back(std::to_string(getFixedLengthMD5(Idx)));
     SR = MD5StringBuf->back();
-    Data = SavedData;
   }
   return SR;
 }
@@ -632,6 +636,30 @@ std::error_code SampleProfileReaderExtBinaryBase::readFuncOffsetTable() {
   if (std::error_code EC = Size.getError())
     return EC;
 
+  // With a fixed length MD5 name table, only the functions of the module are
+  // put in the table. Their MD5s are compared to the ones in the name table
+  // without converting the names of all the other functions to strings,
+  // which dominates the time to read large profiles.
+  if (!UseAllFuncs && FixedLengthMD5) {
+    DenseSet<uint64_t> GUIDsToUse;
+    for (StringRef Name : FuncsToUse)
+      GUIDsToUse.insert(MD5Hash(Name));
+    FuncOffsetTable.reserve(GUIDsToUse.size());
+    for (uint32_t I = 0; I < *Size; ++I) {
+      auto Idx = readStringIndex(NameTable);
+      if (std::error_code EC = Idx.getError())
+        return EC;
+
+      auto Offset = readNumber<uint64_t>();
+      if (std::error_code EC = Offset.getError())
+        return EC;
+
+      if (GUIDsToUse.count(getFixedLengthMD5(*Idx)))
+        FuncOffsetTable[getFixedLengthMD5Name(*Idx)] = *Offset;
+    }
+    return sampleprof_error::success;
+  }
+
   FuncOffsetTable.reserve(*Size);
   for (uint32_t I = 0; I < *Size; ++I) {
     auto FName(readStringFromTable());
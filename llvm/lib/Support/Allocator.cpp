@@ -11,10 +11,74 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 
+#define DEBUG_TYPE "slab-cache"
+
+STATISTIC(NumSlabBytesAllocated,
+          "Number of bytes of slabs allocated by the slab caches");
+STATISTIC(NumSlabBytesReused,
+          "Number of bytes of slabs reused from the slab caches");
+
 namespace llvm {
 
+static LLVM_THREAD_LOCAL SlabCache *CurrentSlabCache = nullptr;
+
+/// The free list for slabs of \p Size bytes, or NumSizeClasses.
+static unsigned getSizeClass(size_t Size, unsigned NumSizeClasses) {
+  if (Size < 4096 || !isPowerOf2_64(Size))
+    return NumSizeClasses;
+  return std::min<unsigned>(Log2_64(Size) - 12, NumSizeClasses);
+}
+
+SlabCache::SlabCache(size_t MaxCachedBytes)
+    : MaxCachedBytes(MaxCachedBytes), Prev(CurrentSlabCache) {
+  CurrentSlabCache = this;
+}
+
+SlabCache::~SlabCache() {
+  assert(CurrentSlabCache == this && "slab caches must nest");
+  CurrentSlabCache = Prev;
+  for (unsigned I = 0; I != NumSizeClasses; ++I) {
+    while (FreeSlab *Slab = FreeLists[I]) {
+      FreeLists[I] = Slab->Next;
+      deallocate_buffer(Slab, size_t(4096) << I, alignof(std::max_align_t));
+    }
+  }
+  NumSlabBytesAllocated += BytesAllocated;
+  NumSlabBytesReused += BytesReused;
+}
+
+SlabCache *SlabCache::getCurrent() { return CurrentSlabCache; }
+
+void *SlabCache::allocate(size_t Size) {
+  unsigned Class = getSizeClass(Size, NumSizeClasses);
+  if (Class != NumSizeClasses && FreeLists[Class]) {
+    FreeSlab *Slab = FreeLists[Class];
+    FreeLists[Class] = Slab->Next;
+    CachedBytes -= Size;
+    BytesReused += Size;
+    return Slab;
+  }
+  BytesAllocated += Size;
+  return allocate_buffer(Size, alignof(std::max_align_t));
+}
+
+void SlabCache::deallocate(void *Slab, size_t Size) {
+  unsigned Class = getSizeClass(Size, NumSizeClasses);
+  if (Class == NumSizeClasses || CachedBytes + Size > MaxCachedBytes) {
+    deallocate_buffer(Slab, Size, alignof(std::max_align_t));
+    return;
+  }
+  // The released slab is still poisoned.
+  __asan_unpoison_memory_region(Slab, sizeof(FreeSlab));
+  FreeSlab *Free = static_cast<FreeSlab *>(Slab);
+  Free->Next = FreeLists[Class];
+  FreeLists[Class] = Free;
+  CachedBytes += Size;
+}
+
 namespace detail {
 
 void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
@@ -17,6 +17,8 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Parallel.h"
+#include <vector>
 #if LLVM_ENABLE_ZLIB
 #include <zlib.h>
 #endif
@@ -60,6 +62,80 @@ Error zlib::compress(StringRef InputBuffer,
   return Res ? createError(convertZlibCodeToString(Res)) : Error::success();
 }
 
+/// Deflate \p Input into a raw deflate stream (without zlib header and
+/// trailer). The stream is finished if \p Last is true, otherwise it ends in
+/// a full flush: at a byte boundary and without references to earlier data.
+static int deflateChunk(StringRef Input, int Level, bool Last,
+                        SmallVectorImpl<char> &Out) {
+  z_stream S = {};
+  int Res = deflateInit2(&S, Level, Z_DEFLATED, /*windowBits=*/-15,
+                         /*memLevel=*/8, Z_DEFAULT_STRATEGY);
+  if (Res != Z_OK)
+    return Res;
+
+  // Leave room for the empty stored block of the flush.
+  Out.resize_for_overwrite(deflateBound(&S, Input.size()) + 16);
+  S.next_in = (Bytef *)Input.data();
+  S.avail_in = Input.size();
+  S.next_out = (Bytef *)Out.data();
+  S.avail_out = Out.size();
+  Res = deflate(&S, Last ? Z_FINISH : Z_FULL_FLUSH);
+  size_t Size = Out.size() - S.avail_out;
+  deflateEnd(&S);
+  if (Res != (Last ? Z_STREAM_END : Z_OK) || S.avail_in || !S.avail_out)
+    return Res == Z_OK || Res == Z_STREAM_END ? Z_BUF_ERROR : Res;
+
+  __msan_unpoison(Out.data(), Size);
+  Out.resize(Size);
+  return Z_OK;
+}
+
+Error zlib::compressParallel(StringRef InputBuffer,
+                             SmallVectorImpl<char> &CompressedBuffer,
+                             int Level, size_t ChunkSize) {
+  assert(ChunkSize && "Chunks must not be empty");
+  size_t NumChunks =
+      std::max<size_t>(1, (InputBuffer.size() + ChunkSize - 1) / ChunkSize);
+  std::vector<SmallVector<char, 0>> Chunks(NumChunks);
+  std::vector<uLong> Checksums(NumChunks);
+  std::vector<int> Results(NumChunks);
+  parallelForEachN(0, NumChunks, [&](size_t I) {
+    StringRef Chunk = InputBuffer.substr(I * ChunkSize, ChunkSize);
+    Results[I] = deflateChunk(Chunk, Level, I + 1 == NumChunks, Chunks[I]);
+    Checksums[I] =
+        adler32(adler32(0, nullptr, 0), (const Bytef *)Chunk.data(),
+                Chunk.size());
+  });
+  for (int Res : Results)
+    if (Res != Z_OK)
+      return createError(convertZlibCodeToString(Res));
+
+  // The zlib header as written by deflate() for this level.
+  if (Level == Z_DEFAULT_COMPRESSION)
+    Level = DefaultCompression;
+  unsigned LevelFlags = Level < 2 ? 0 : Level < 6 ? 1 : Level == 6 ? 2 : 3;
+  unsigned Header = (Z_DEFLATED + ((15 - 8) << 4)) << 8 | LevelFlags << 6;
+  Header += 31 - Header % 31;
+
+  uLong Checksum = Checksums[0];
+  size_t Size = 2 + 4 + Chunks[0].size();
+  for (size_t I = 1; I < NumChunks; ++I) {
+    StringRef Chunk = InputBuffer.substr(I * ChunkSize, ChunkSize);
+    Checksum = adler32_combine(Checksum, Checksums[I], Chunk.size());
+    Size += Chunks[I].size();
+  }
+
+  CompressedBuffer.clear();
+  CompressedBuffer.reserve(Size);
+  CompressedBuffer.push_back(Header >> 8);
+  CompressedBuffer.push_back(Header & 0xff);
+  for (const SmallVector<char, 0> &Chunk : Chunks)
+    CompressedBuffer.append(Chunk.begin(), Chunk.end());
+  for (int Shift = 24; Shift >= 0; Shift -= 8)
+    CompressedBuffer.push_back((Checksum >> Shift) & 0xff);
+  return Error::success();
+}
+
 Error zlib::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                        size_t &UncompressedSize) {
   int Res =
@@ -91,6 +167,11 @@ Error zlib::compress(StringRef InputBuffer,
                      SmallVectorImpl<char> &CompressedBuffer, int Level) {
   llvm_unreachable("zlib::compress is unavailable");
 }
+Error zlib::compressParallel(StringRef InputBuffer,
+                             SmallVectorImpl<char> &CompressedBuffer,
+                             int Level, size_t ChunkSize) {
+  llvm_unreachable("zlib::compressParallel is unavailable");
+}
 Error zlib::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
                        size_t &UncompressedSize) {
   llvm_unreachable("zlib::uncompress is unavailable");
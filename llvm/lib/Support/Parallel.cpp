@@ -12,8 +12,8 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
+#include <deque>
 #include <future>
-#include <stack>
 #include <thread>
 #include <vector>
 
@@ -33,15 +33,31 @@ public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
 
+  /// Runs one pending closure on the calling thread. Returns false if there
+  /// was none.
+  virtual bool runPendingTask() = 0;
+
   static Executor *getDefaultExecutor();
 };
 
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// The index plus one of the worker thread of the default executor, or zero
+/// on other threads.
+static LLVM_THREAD_LOCAL unsigned WorkerIndex = 0;
+
+/// An implementation of an Executor that runs closures on a thread pool.
+///
+/// Every worker owns a queue. It runs the closures it added itself in filo
+/// order and steals the oldest closure of another worker, starting at a
+/// random one, when its own queue is empty. Closures added by other threads
+/// are spread over the queues in turn. The queues have a lock each, so that
+/// workers only contend when they steal from the same queue.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(ThreadPoolStrategy S = hardware_concurrency()) {
     unsigned ThreadCount = S.compute_thread_count();
+    Queues.reserve(ThreadCount);
+    for (unsigned I = 0; I < ThreadCount; ++I)
+      Queues.push_back(std::make_unique<WorkQueue>());
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     Threads.reserve(ThreadCount);
@@ -87,30 +103,100 @@ public:
   };
 
   void add(std::function<void()> F) override {
+    unsigned Index = WorkerIndex ? WorkerIndex - 1
+                                 : NextQueue++ % Queues.size();
+    // A worker that is about to sleep increments Sleepers before it checks
+    // PendingTasks, so one of the two sides sees the other.
+    ++PendingTasks;
     {
+      std::lock_guard<std::mutex> Lock(Queues[Index]->Mutex);
+      Queues[Index]->Tasks.push_back(std::move(F));
+    }
+    if (Sleepers != 0) {
       std::lock_guard<std::mutex> Lock(Mutex);
-      WorkStack.push(F);
+      Cond.notify_one();
     }
-    Cond.notify_one();
+  }
+
+  bool runPendingTask() override {
+    std::function<void()> Task;
+    if (!popTask(WorkerIndex ? WorkerIndex - 1 : NextQueue++ % Queues.size(),
+                 Task))
+      return false;
+    Task();
+    return true;
   }
 
 private:
+  struct WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  /// Takes the newest closure of queue \p Index or else the oldest closure of
+  /// another queue.
+  bool popTask(unsigned Index, std::function<void()> &Task) {
+    if (PendingTasks == 0)
+      return false;
+    {
+      WorkQueue &Q = *Queues[Index];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.back());
+        Q.Tasks.pop_back();
+        --PendingTasks;
+        return true;
+      }
+    }
+    unsigned NumQueues = Queues.size();
+    unsigned Start = nextRandom() % NumQueues;
+    for (unsigned I = 0; I < NumQueues; ++I) {
+      WorkQueue &Q = *Queues[(Start + I) % NumQueues];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.front());
+        Q.Tasks.pop_front();
+        --PendingTasks;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static unsigned nextRandom() {
+    // xorshift32, seeded differently on every thread.
+    static LLVM_THREAD_LOCAL unsigned State = 0;
+    if (State == 0)
+      State = static_cast<unsigned>(
+                  std::hash<std::thread::id>()(std::this_thread::get_id())) |
+              1;
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    return State;
+  }
+
   void work(ThreadPoolStrategy S, unsigned ThreadID) {
     S.apply_thread_strategy(ThreadID);
-    while (true) {
+    WorkerIndex = ThreadID + 1;
+    while (!Stop) {
+      std::function<void()> Task;
+      if (popTask(ThreadID, Task)) {
+        Task();
+        continue;
+      }
       std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
-      if (Stop)
-        break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
-      Lock.unlock();
-      Task();
+      ++Sleepers;
+      Cond.wait(Lock, [&] { return Stop || PendingTasks != 0; });
+      --Sleepers;
     }
   }
 
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
+  std::vector<std::unique_ptr<WorkQueue>> Queues;
+  std::atomic<unsigned> NextQueue{0};
+  std::atomic<size_t> PendingTasks{0};
+  std::atomic<unsigned> Sleepers{0};
   std::mutex Mutex;
   std::condition_variable Cond;
   std::promise<void> ThreadsCreated;
@@ -151,7 +237,22 @@ static std::atomic<int> TaskGroupInstances;
 // lock, only allow the first TaskGroup to run tasks parallelly. In the scenario
 // of nested parallel_for_each(), only the outermost one runs parallelly.
 TaskGroup::TaskGroup() : Parallel(TaskGroupInstances++ == 0) {}
-TaskGroup::~TaskGroup() { --TaskGroupInstances; }
+TaskGroup::~TaskGroup() {
+  sync();
+  --TaskGroupInstances;
+}
+
+void TaskGroup::sync() const {
+  // Only the tasks of this group are in the executor, help running them
+  // rather than blocking a thread.
+  if (Parallel) {
+    Executor *Exec = Executor::getDefaultExecutor();
+    while (!L.isDone())
+      if (!Exec->runPendingTask())
+        break;
+  }
+  L.sync();
+}
 
 void TaskGroup::spawn(std::function<void()> F) {
   if (Parallel) {
@@ -46,11 +46,29 @@ typedef std::pair<std::string, CountAndDurationType>
     NameAndCountAndDurationType;
 
 namespace {
+struct MemoryUsage {
+  size_t Malloc = 0;
+  size_t PeakRSS = 0;
+
+  static MemoryUsage get() {
+    MemoryUsage Usage;
+    Usage.Malloc = sys::Process::GetMallocUsage();
+    Usage.PeakRSS = sys::Process::GetPeakResidentSetSize();
+    return Usage;
+  }
+};
+
 struct Entry {
   const TimePointType Start;
   TimePointType End;
   const std::string Name;
   const std::string Detail;
+  // Memory usage at the start of the entry while it is open, and the change
+  // in memory usage over the entry once it is closed. Only filled in if
+  // memory usage is traced.
+  MemoryUsage StartMemory;
+  int64_t MallocDelta = 0;
+  int64_t PeakRSSDelta = 0;
 
   Entry(TimePointType &&S, TimePointType &&E, std::string &&N, std::string &&Dt)
       : Start(std::move(S)), End(std::move(E)), Name(std::move(N)),
@@ -74,21 +92,31 @@ struct Entry {
 } // namespace
 
 struct llvm::TimeTraceProfiler {
-  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "")
+  TimeTraceProfiler(unsigned TimeTraceGranularity = 0, StringRef ProcName = "",
+                    bool TraceMemory = false)
       : BeginningOfTime(system_clock::now()), StartTime(steady_clock::now()),
         ProcName(ProcName), Pid(sys::Process::getProcessId()),
-        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity) {
+        Tid(llvm::get_threadid()), TimeTraceGranularity(TimeTraceGranularity),
+        TraceMemory(TraceMemory) {
     llvm::get_thread_name(ThreadName);
   }
 
   void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
     Stack.emplace_back(steady_clock::now(), TimePointType(), std::move(Name),
                        Detail());
+    if (TraceMemory)
+      Stack.back().StartMemory = MemoryUsage::get();
   }
 
   void end() {
     assert(!Stack.empty() && "Must call begin() first");
     Entry &E = Stack.back();
+    if (TraceMemory) {
+      MemoryUsage EndMemory = MemoryUsage::get();
+      E.MallocDelta = int64_t(EndMemory.Malloc) - int64_t(E.StartMemory.Malloc);
+      E.PeakRSSDelta =
+          int64_t(EndMemory.PeakRSS) - int64_t(E.StartMemory.PeakRSS);
+    }
     E.End = steady_clock::now();
 
     // Check that end times monotonically increase.
@@ -149,8 +177,17 @@ struct llvm::TimeTraceProfiler {
         J.attribute("ts", StartUs);
         J.attribute("dur", DurUs);
         J.attribute("name", E.Name);
-        if (!E.Detail.empty()) {
-          J.attributeObject("args", [&] { J.attribute("detail", E.Detail); });
+        if (!E.Detail.empty() || TraceMemory) {
+          J.attributeObject("args", [&] {
+            if (!E.Detail.empty())
+              J.attribute("detail", E.Detail);
+            // Malloc'ed memory and peak RSS are process-wide, so the deltas
+            // include the work of any other threads running meanwhile.
+            if (TraceMemory) {
+              J.attribute("malloc delta", E.MallocDelta);
+              J.attribute("peak rss delta", E.PeakRSSDelta);
+            }
+          });
         }
       });
     };
@@ -258,14 +295,18 @@ struct llvm::TimeTraceProfiler {
 
   // Minimum time granularity (in microseconds)
   const unsigned TimeTraceGranularity;
+
+  // Whether to record the change in memory usage over each entry.
+  const bool TraceMemory;
 };
 
 void llvm::timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
-                                       StringRef ProcName) {
+                                       StringRef ProcName, bool TraceMemory) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
-  TimeTraceProfilerInstance = new TimeTraceProfiler(
-      TimeTraceGranularity, llvm::sys::path::filename(ProcName));
+  TimeTraceProfilerInstance =
+      new TimeTraceProfiler(TimeTraceGranularity,
+                            llvm::sys::path::filename(ProcName), TraceMemory);
 }
 
 // Removes all TimeTraceProfilerInstances.
@@ -33,14 +33,23 @@
 */
 
 /* based on revision d2df04efcbef7d7f6886d345861e5dfda4edacc1 Removed
- * everything but a simple interface for computing XXh64. */
+ * everything but a simple interface for computing XXh64.
+ * XXH3 is based on xxHash 0.8, only the 64-bit hash with the default secret
+ * and seed 0 is kept. */
 
 #include "llvm/Support/xxhash.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Endian.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XXH3_SSE2 1
+#endif
+
 using namespace llvm;
 using namespace support;
 
@@ -136,3 +145,279 @@ uint64_t llvm::xxHash64(StringRef Data) {
 uint64_t llvm::xxHash64(ArrayRef<uint8_t> Data) {
   return xxHash64({(const char *)Data.data(), Data.size()});
 }
+
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+static const uint32_t PRIME32_2 = 0x85EBCA77U;
+static const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+// The default secret of XXH3.
+constexpr size_t SECRET_SIZE = 192;
+alignas(64) static const uint8_t kSecret[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static uint64_t XXH64_avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 33;
+  Hash *= PRIME64_2;
+  Hash ^= Hash >> 29;
+  Hash *= PRIME64_3;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+static uint64_t XXH3_avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 37;
+  Hash *= PRIME_MX1;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+/// The 128-bit product of \p LHS and \p RHS, folded to 64 bits.
+static uint64_t XXH3_mul128_fold64(uint64_t LHS, uint64_t RHS) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t Product = (__uint128_t)LHS * RHS;
+  return uint64_t(Product) ^ uint64_t(Product >> 64);
+#else
+  uint64_t LoLo = (LHS & 0xffffffff) * (RHS & 0xffffffff);
+  uint64_t HiLo = (LHS >> 32) * (RHS & 0xffffffff);
+  uint64_t LoHi = (LHS & 0xffffffff) * (RHS >> 32);
+  uint64_t HiHi = (LHS >> 32) * (RHS >> 32);
+  uint64_t Cross = (LoLo >> 32) + (HiLo & 0xffffffff) + LoHi;
+  uint64_t Upper = (HiLo >> 32) + (Cross >> 32) + HiHi;
+  uint64_t Lower = (Cross << 32) | (LoLo & 0xffffffff);
+  return Lower ^ Upper;
+#endif
+}
+
+static uint64_t XXH3_len_1to3(const uint8_t *Input, size_t Len) {
+  const uint8_t C1 = Input[0];
+  const uint8_t C2 = Input[Len >> 1];
+  const uint8_t C3 = Input[Len - 1];
+  uint32_t Combined = ((uint32_t)C1 << 16) | ((uint32_t)C2 << 24) |
+                      ((uint32_t)C3 << 0) | ((uint32_t)Len << 8);
+  uint64_t Bitflip =
+      (uint64_t)(endian::read32le(kSecret) ^ endian::read32le(kSecret + 4));
+  return XXH64_avalanche(uint64_t(Combined) ^ Bitflip);
+}
+
+static uint64_t XXH3_len_4to8(const uint8_t *Input, size_t Len) {
+  uint32_t Input1 = endian::read32le(Input);
+  uint32_t Input2 = endian::read32le(Input + Len - 4);
+  uint64_t Bitflip =
+      endian::read64le(kSecret + 8) ^ endian::read64le(kSecret + 16);
+  uint64_t Input64 = (uint64_t)Input2 | ((uint64_t)Input1 << 32);
+  uint64_t Hash = Input64 ^ Bitflip;
+  Hash ^= rotl64(Hash, 49) ^ rotl64(Hash, 24);
+  Hash *= PRIME_MX2;
+  Hash ^= (Hash >> 35) + Len;
+  Hash *= PRIME_MX2;
+  Hash ^= Hash >> 28;
+  return Hash;
+}
+
+static uint64_t XXH3_len_9to16(const uint8_t *Input, size_t Len) {
+  uint64_t Bitflip1 =
+      endian::read64le(kSecret + 24) ^ endian::read64le(kSecret + 32);
+  uint64_t Bitflip2 =
+      endian::read64le(kSecret + 40) ^ endian::read64le(kSecret + 48);
+  uint64_t InputLo = endian::read64le(Input) ^ Bitflip1;
+  uint64_t InputHi = endian::read64le(Input + Len - 8) ^ Bitflip2;
+  uint64_t Acc = Len + ByteSwap_64(InputLo) + InputHi +
+                 XXH3_mul128_fold64(InputLo, InputHi);
+  return XXH3_avalanche(Acc);
+}
+
+static uint64_t XXH3_len_0to16(const uint8_t *Input, size_t Len) {
+  if (LLVM_LIKELY(Len > 8))
+    return XXH3_len_9to16(Input, Len);
+  if (LLVM_LIKELY(Len >= 4))
+    return XXH3_len_4to8(Input, Len);
+  if (Len)
+    return XXH3_len_1to3(Input, Len);
+  return XXH64_avalanche(endian::read64le(kSecret + 56) ^
+                         endian::read64le(kSecret + 64));
+}
+
+static uint64_t XXH3_mix16B(const uint8_t *Input, const uint8_t *Secret) {
+  uint64_t Lhs = endian::read64le(Input) ^ endian::read64le(Secret);
+  uint64_t Rhs = endian::read64le(Input + 8) ^ endian::read64le(Secret + 8);
+  return XXH3_mul128_fold64(Lhs, Rhs);
+}
+
+static uint64_t XXH3_len_17to128(const uint8_t *Input, size_t Len) {
+  uint64_t Acc = Len * PRIME64_1;
+  if (Len > 32) {
+    if (Len > 64) {
+      if (Len > 96) {
+        Acc += XXH3_mix16B(Input + 48, kSecret + 96);
+        Acc += XXH3_mix16B(Input + Len - 64, kSecret + 112);
+      }
+      Acc += XXH3_mix16B(Input + 32, kSecret + 64);
+      Acc += XXH3_mix16B(Input + Len - 48, kSecret + 80);
+    }
+    Acc += XXH3_mix16B(Input + 16, kSecret + 32);
+    Acc += XXH3_mix16B(Input + Len - 32, kSecret + 48);
+  }
+  Acc += XXH3_mix16B(Input, kSecret);
+  Acc += XXH3_mix16B(Input + Len - 16, kSecret + 16);
+  return XXH3_avalanche(Acc);
+}
+
+constexpr size_t MIDSIZE_MAX = 240;
+constexpr size_t MIDSIZE_STARTOFFSET = 3;
+constexpr size_t MIDSIZE_LASTOFFSET = 17;
+constexpr size_t SECRET_SIZE_MIN = 136;
+
+static uint64_t XXH3_len_129to240(const uint8_t *Input, size_t Len) {
+  uint64_t Acc = Len * PRIME64_1;
+  size_t NbRounds = Len / 16;
+  for (size_t I = 0; I < 8; ++I)
+    Acc += XXH3_mix16B(Input + 16 * I, kSecret + 16 * I);
+  Acc = XXH3_avalanche(Acc);
+
+  for (size_t I = 8; I < NbRounds; ++I)
+    Acc += XXH3_mix16B(Input + 16 * I,
+                       kSecret + 16 * (I - 8) + MIDSIZE_STARTOFFSET);
+  // Last 16 bytes.
+  Acc += XXH3_mix16B(Input + Len - 16,
+                     kSecret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET);
+  return XXH3_avalanche(Acc);
+}
+
+constexpr size_t STRIPE_LEN = 64;
+constexpr size_t SECRET_CONSUME_RATE = 8;
+constexpr size_t ACC_NB = STRIPE_LEN / sizeof(uint64_t);
+constexpr size_t SECRET_LASTACC_START = 7;
+constexpr size_t SECRET_MERGEACCS_START = 11;
+
+/// Mixes a stripe of 64 bytes into the 8 accumulators.
+static void XXH3_accumulate_512(uint64_t *Acc, const uint8_t *Input,
+                                const uint8_t *Secret) {
+#ifdef XXH3_SSE2
+  __m128i *XAcc = reinterpret_cast<__m128i *>(Acc);
+  for (size_t I = 0; I < ACC_NB / 2; ++I) {
+    __m128i DataVec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Input) + I);
+    __m128i KeyVec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Secret) + I);
+    __m128i DataKey = _mm_xor_si128(DataVec, KeyVec);
+    // The high halves of the 64-bit lanes times the low halves.
+    __m128i DataKeyLo = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i Product = _mm_mul_epu32(DataKey, DataKeyLo);
+    // Each accumulator also gets the input of its neighbour.
+    __m128i DataSwap = _mm_shuffle_epi32(DataVec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i Sum = _mm_add_epi64(_mm_loadu_si128(XAcc + I), DataSwap);
+    _mm_storeu_si128(XAcc + I, _mm_add_epi64(Product, Sum));
+  }
+#else
+  for (size_t I = 0; I < ACC_NB; ++I) {
+    uint64_t DataVal = endian::read64le(Input + 8 * I);
+    uint64_t DataKey = DataVal ^ endian::read64le(Secret + 8 * I);
+    Acc[I ^ 1] += DataVal;
+    Acc[I] += uint32_t(DataKey) * (DataKey >> 32);
+  }
+#endif
+}
+
+static void XXH3_scrambleAcc(uint64_t *Acc, const uint8_t *Secret) {
+#ifdef XXH3_SSE2
+  __m128i *XAcc = reinterpret_cast<__m128i *>(Acc);
+  const __m128i Prime32 = _mm_set1_epi32((int)PRIME32_1);
+  for (size_t I = 0; I < ACC_NB / 2; ++I) {
+    __m128i AccVec = _mm_loadu_si128(XAcc + I);
+    __m128i DataVec = _mm_xor_si128(AccVec, _mm_srli_epi64(AccVec, 47));
+    __m128i KeyVec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Secret) + I);
+    __m128i DataKey = _mm_xor_si128(DataVec, KeyVec);
+    // Multiply the 64-bit lanes by PRIME32_1 in two 32-bit halves.
+    __m128i DataKeyHi = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i ProdLo = _mm_mul_epu32(DataKey, Prime32);
+    __m128i ProdHi = _mm_mul_epu32(DataKeyHi, Prime32);
+    _mm_storeu_si128(XAcc + I,
+                     _mm_add_epi64(ProdLo, _mm_slli_epi64(ProdHi, 32)));
+  }
+#else
+  for (size_t I = 0; I < ACC_NB; ++I) {
+    uint64_t Acc64 = Acc[I];
+    Acc64 ^= Acc64 >> 47;
+    Acc64 ^= endian::read64le(Secret + 8 * I);
+    Acc64 *= PRIME32_1;
+    Acc[I] = Acc64;
+  }
+#endif
+}
+
+static void XXH3_accumulate(uint64_t *Acc, const uint8_t *Input,
+                            const uint8_t *Secret, size_t NbStripes) {
+  for (size_t N = 0; N < NbStripes; ++N)
+    XXH3_accumulate_512(Acc, Input + N * STRIPE_LEN,
+                        Secret + N * SECRET_CONSUME_RATE);
+}
+
+static uint64_t XXH3_mix2Accs(const uint64_t *Acc, const uint8_t *Secret) {
+  return XXH3_mul128_fold64(Acc[0] ^ endian::read64le(Secret),
+                            Acc[1] ^ endian::read64le(Secret + 8));
+}
+
+static uint64_t XXH3_mergeAccs(const uint64_t *Acc, const uint8_t *Secret,
+                               uint64_t Start) {
+  uint64_t Result = Start;
+  for (size_t I = 0; I < 4; ++I)
+    Result += XXH3_mix2Accs(Acc + 2 * I, Secret + 16 * I);
+  return XXH3_avalanche(Result);
+}
+
+LLVM_ATTRIBUTE_NOINLINE
+static uint64_t XXH3_hashLong_64b(const uint8_t *Input, size_t Len) {
+  alignas(16) uint64_t Acc[ACC_NB] = {PRIME32_3, PRIME64_1, PRIME64_2,
+                                      PRIME64_3, PRIME64_4, PRIME32_2,
+                                      PRIME64_5, PRIME32_1};
+  const size_t NbStripesPerBlock =
+      (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+  const size_t BlockLen = STRIPE_LEN * NbStripesPerBlock;
+  const size_t NbBlocks = (Len - 1) / BlockLen;
+
+  for (size_t N = 0; N < NbBlocks; ++N) {
+    XXH3_accumulate(Acc, Input + N * BlockLen, kSecret, NbStripesPerBlock);
+    XXH3_scrambleAcc(Acc, kSecret + SECRET_SIZE - STRIPE_LEN);
+  }
+
+  // The last partial block, and the last stripe of the input.
+  const size_t NbStripes = ((Len - 1) - BlockLen * NbBlocks) / STRIPE_LEN;
+  XXH3_accumulate(Acc, Input + NbBlocks * BlockLen, kSecret, NbStripes);
+  XXH3_accumulate_512(Acc, Input + Len - STRIPE_LEN,
+                      kSecret + SECRET_SIZE - STRIPE_LEN -
+                          SECRET_LASTACC_START);
+
+  return XXH3_mergeAccs(Acc, kSecret + SECRET_MERGEACCS_START,
+                        (uint64_t)Len * PRIME64_1);
+}
+
+uint64_t llvm::xxh3_64bits(ArrayRef<uint8_t> Data) {
+  const uint8_t *Input = Data.data();
+  size_t Len = Data.size();
+  if (Len <= 16)
+    return XXH3_len_0to16(Input, Len);
+  if (Len <= 128)
+    return XXH3_len_17to128(Input, Len);
+  if (Len <= MIDSIZE_MAX)
+    return XXH3_len_129to240(Input, Len);
+  return XXH3_hashLong_64b(Input, Len);
+}
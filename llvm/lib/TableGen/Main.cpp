@@ -26,11 +26,13 @@
 #include <algorithm>
 #include <cstdio>
 #include <system_error>
+#include <vector>
 using namespace llvm;
 
-static cl::opt<std::string>
-OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
-               cl::init("-"));
+static cl::list<std::string>
+OutputFilenames("o", cl::desc("Output filename (one per action when several "
+                              "actions are given)"),
+                cl::value_desc("filename"));
 
 static cl::opt<std::string>
 DependFilename("d",
@@ -66,7 +68,7 @@ static int reportError(const char *ProgName, Twine Msg) {
 /// This functionality is really only for the benefit of the build system.
 /// It is similar to GCC's `-M*` family of options.
 static int createDependencyFile(const TGParser &Parser, const char *argv0) {
-  if (OutputFilename == "-")
+  if (OutputFilenames.empty())
     return reportError(argv0, "the option -d must be used together with -o\n");
 
   std::error_code EC;
@@ -74,7 +76,7 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
   if (EC)
     return reportError(argv0, "error opening " + DependFilename + ":" +
                                   EC.message() + "\n");
-  DepOut.os() << OutputFilename << ":";
+  DepOut.os() << join(OutputFilenames, " ") << ":";
   for (const auto &Dep : Parser.getDependencies()) {
     DepOut.os() << ' ' << Dep;
   }
@@ -83,7 +85,41 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
   return 0;
 }
 
+/// Write the output of an action to OutputFilename.
+static int writeOutputFile(const char *argv0, StringRef OutputFilename,
+                           StringRef Output) {
+  bool WriteFile = true;
+  if (WriteIfChanged) {
+    // Only updates the real output file if there are any differences.
+    // This prevents recompilation of all the files depending on it if there
+    // aren't any.
+    if (auto ExistingOrErr = MemoryBuffer::getFile(OutputFilename))
+      if (std::move(ExistingOrErr.get())->getBuffer() == Output)
+        WriteFile = false;
+  }
+  if (WriteFile) {
+    std::error_code EC;
+    ToolOutputFile OutFile(OutputFilename, EC, sys::fs::OF_None);
+    if (EC)
+      return reportError(argv0, "error opening " + OutputFilename + ": " +
+                                    EC.message() + "\n");
+    OutFile.os() << Output;
+    if (ErrorsPrinted == 0)
+      OutFile.keep();
+  }
+  return 0;
+}
+
 int llvm::TableGenMain(const char *argv0, TableGenMainFn *MainFn) {
+  return TableGenMain(argv0, std::function<TableGenMainFn>(MainFn));
+}
+
+int llvm::TableGenMain(const char *argv0,
+                       ArrayRef<std::function<TableGenMainFn>> Actions) {
+  if ((Actions.size() > 1 || OutputFilenames.size() > 1) &&
+      OutputFilenames.size() != Actions.size())
+    return reportError(argv0, "expected one output file (-o) per action\n");
+
   RecordKeeper Records;
 
   if (TimePhases)
@@ -113,14 +149,17 @@ int llvm::TableGenMain(const char *argv0, TableGenMainFn *MainFn) {
     return 1;
   Records.stopTimer();
 
-  // Write output to memory.
+  // Write output to memory. The actions share the records, so they are run
+  // one after the other.
   Records.startBackendTimer("Backend overall");
-  std::string OutString;
-  raw_string_ostream Out(OutString);
-  unsigned status = MainFn(Out, Records);
+  std::vector<std::string> Outputs(Actions.size());
+  for (unsigned I = 0, E = Actions.size(); I != E; ++I) {
+    raw_string_ostream Out(Outputs[I]);
+    if (Actions[I](Out, Records))
+      return 1;
+    Out.flush();
+  }
   Records.stopBackendTimer();
-  if (status)
-    return 1;
 
   // Always write the depfile, even if the main output hasn't changed.
   // If it's missing, Ninja considers the output dirty.  If this was below
@@ -132,26 +171,13 @@ int llvm::TableGenMain(const char *argv0, TableGenMainFn *MainFn) {
   }
 
   Records.startTimer("Write output");
-  bool WriteFile = true;
-  if (WriteIfChanged) {
-    // Only updates the real output file if there are any differences.
-    // This prevents recompilation of all the files depending on it if there
-    // aren't any.
-    if (auto ExistingOrErr = MemoryBuffer::getFile(OutputFilename))
-      if (std::move(ExistingOrErr.get())->getBuffer() == Out.str())
-        WriteFile = false;
-  }
-  if (WriteFile) {
-    std::error_code EC;
-    ToolOutputFile OutFile(OutputFilename, EC, sys::fs::OF_None);
-    if (EC)
-      return reportError(argv0, "error opening " + OutputFilename + ": " +
-                                    EC.message() + "\n");
-    OutFile.os() << Out.str();
-    if (ErrorsPrinted == 0)
-      OutFile.keep();
+  for (unsigned I = 0, E = Actions.size(); I != E; ++I) {
+    StringRef OutputFilename =
+        OutputFilenames.empty() ? StringRef("-") : StringRef(OutputFilenames[I]);
+    if (int Ret = writeOutputFile(argv0, OutputFilename, Outputs[I]))
+      return Ret;
   }
-  
+
   Records.stopTimer();
   Records.stopPhaseTiming();
 
@@ -51,4 +51,28 @@ std::unique_ptr<MCObjectTargetWriter> createRISCVELFObjectWriter(uint8_t OSABI,
 #define GET_SUBTARGETINFO_ENUM
 #include "RISCVGenSubtargetInfo.inc"
 
+namespace llvm {
+namespace RISCV_MC {
+/// Returns true if \p MI reads or writes one of the stream semantic registers
+/// ft0-ft2 of Xssr. Works on both MCInst and MachineInstr for the scheduling
+/// predicates.
+template <class Inst> bool accessesStreamRegister(const Inst &MI) {
+  for (unsigned I = 0, E = MI.getNumOperands(); I != E; ++I) {
+    const auto &Op = MI.getOperand(I);
+    if (!Op.isReg())
+      continue;
+    switch (Op.getReg()) {
+    case RISCV::F0_D: case RISCV::F1_D: case RISCV::F2_D:
+    case RISCV::F0_F: case RISCV::F1_F: case RISCV::F2_F:
+    case RISCV::F0_H: case RISCV::F1_H: case RISCV::F2_H:
+      return true;
+    default:
+      break;
+    }
+  }
+  return false;
+}
+} // namespace RISCV_MC
+} // namespace llvm
+
 #endif
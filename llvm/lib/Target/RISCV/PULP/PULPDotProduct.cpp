@@ -0,0 +1,376 @@
+//===-- PULPDotProduct.cpp - Form PULP dot products from reductions -------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass turns widening multiply-add reductions of packed SIMD vectors into
+// the dot product instructions of the PULPv2 extension. A dot product is a
+// multiplication of two extended v4i8 or v2i16 vectors:
+//
+//   %a.ext = sext <4 x i8> %a to <4 x i32>
+//   %b.ext = sext <4 x i8> %b to <4 x i32>
+//   %m = mul <4 x i32> %a.ext, %b.ext
+//
+// Two forms of reductions over dot products are recognized. A horizontal add
+// of a dot product, as produced by the SLP vectorizer and in-loop reductions,
+// becomes pv.dotsp.b, or pv.sdotsp.b if the result is added to a scalar:
+//
+//   %r = call i32 @llvm.vector.reduce.add.v4i32(<4 x i32> %m)
+//   %s.next = add i32 %s, %r
+//
+// A vector accumulator, as produced by the loop vectorizer, only needs the
+// sum of its lanes after the loop. It is replaced by a scalar accumulator
+// updated with pv.sdotsp.b in every iteration:
+//
+//   loop:
+//     %acc = phi <4 x i32> [ %start, %ph ], [ %acc.next, %loop ]
+//     %acc.next = add <4 x i32> %acc, %m
+//   exit:
+//     %r = call i32 @llvm.vector.reduce.add.v4i32(<4 x i32> %acc.next)
+//
+// Zero extended operands select the unsigned variants, a mix of signedness
+// the unsigned-signed ones.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+#define DEBUG_TYPE "pulp-dotp"
+#define PULP_DOTP_NAME "PULP dot product formation"
+
+static cl::opt<bool> DisableDotProduct(
+    "pulp-dotp-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not form PULP dot products from multiply-add reductions"));
+
+STATISTIC(NumDotProducts, "Number of dot products formed");
+STATISTIC(NumAccumulators, "Number of vector accumulators made scalar");
+
+namespace {
+
+/// The operands of a dot product, \p A is zero extended if the product is
+/// of mixed signedness.
+struct DotProduct {
+  Value *A = nullptr;
+  Value *B = nullptr;
+  Value *Mul = nullptr;
+  bool SignedA = false;
+  bool SignedB = false;
+};
+
+class PULPDotProduct : public FunctionPass {
+public:
+  static char ID;
+
+  PULPDotProduct() : FunctionPass(ID) {
+    initializePULPDotProductPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return PULP_DOTP_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.setPreservesCFG();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  /// Replace a horizontal add of a dot product, returns true on success.
+  bool convertReduction(IntrinsicInst *Red);
+
+  /// Replace the vector accumulator \p Phi by a scalar one, returns true on
+  /// success.
+  bool convertAccumulator(PHINode *Phi);
+
+  /// Create a dot product, accumulating into \p Acc if it is not null.
+  Value *createDotProduct(IRBuilder<> &Builder, const DotProduct &DP,
+                          Value *Acc) const;
+};
+
+} // end anonymous namespace
+
+char PULPDotProduct::ID = 0;
+
+/// Match a multiplication of two extended packed SIMD vectors.
+static bool matchDotProduct(Value *V, DotProduct &DP) {
+  auto *Mul = dyn_cast<BinaryOperator>(V);
+  if (!Mul || Mul->getOpcode() != Instruction::Mul)
+    return false;
+  auto *Ty = dyn_cast<FixedVectorType>(Mul->getType());
+  if (!Ty || !Ty->getElementType()->isIntegerTy(32))
+    return false;
+
+  Value *Ops[2];
+  bool Signed[2];
+  for (unsigned i = 0; i < 2; ++i) {
+    Value *Op = Mul->getOperand(i);
+    if (match(Op, m_SExt(m_Value(Ops[i]))))
+      Signed[i] = true;
+    else if (match(Op, m_ZExt(m_Value(Ops[i]))))
+      Signed[i] = false;
+    else
+      return false;
+    auto *SrcTy = cast<FixedVectorType>(Ops[i]->getType());
+    unsigned Bits = SrcTy->getScalarSizeInBits();
+    if (!((Bits == 8 && Ty->getNumElements() == 4) ||
+          (Bits == 16 && Ty->getNumElements() == 2)))
+      return false;
+  }
+
+  // pv.dotusp takes the unsigned operand first.
+  if (Signed[0] && !Signed[1]) {
+    std::swap(Ops[0], Ops[1]);
+    std::swap(Signed[0], Signed[1]);
+  }
+  DP.A = Ops[0];
+  DP.B = Ops[1];
+  DP.Mul = Mul;
+  DP.SignedA = Signed[0];
+  DP.SignedB = Signed[1];
+  return true;
+}
+
+static bool isAddReduction(const Value *V) {
+  const auto *II = dyn_cast<IntrinsicInst>(V);
+  return II && II->getIntrinsicID() == Intrinsic::vector_reduce_add;
+}
+
+bool PULPDotProduct::runOnFunction(Function &F) {
+  if (DisableDotProduct || skipFunction(F))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasPULPExtV2())
+    return false;
+
+  // Converting an accumulator erases its exit phis and the reductions after
+  // the loop, and deleting a dead dot product can take other instructions
+  // with it. The candidates are held by handles that become null when they
+  // are erased, and do not follow the values replacing them.
+  SmallVector<WeakVH, 4> Phis;
+  SmallVector<WeakVH, 8> Reductions;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB) {
+      if (auto *Phi = dyn_cast<PHINode>(&I)) {
+        if (Phi->getType()->isVectorTy())
+          Phis.push_back(Phi);
+      } else if (isAddReduction(&I)) {
+        Reductions.push_back(&I);
+      }
+    }
+
+  bool Changed = false;
+  // Accumulators, once scalar, no longer feed the reductions after the loop.
+  for (WeakVH &Phi : Phis)
+    if (Phi)
+      Changed |= convertAccumulator(cast<PHINode>(Phi));
+  for (WeakVH &Red : Reductions)
+    if (Red)
+      Changed |= convertReduction(cast<IntrinsicInst>(Red));
+  return Changed;
+}
+
+Value *PULPDotProduct::createDotProduct(IRBuilder<> &Builder,
+                                        const DotProduct &DP,
+                                        Value *Acc) const {
+  bool Byte = cast<FixedVectorType>(DP.A->getType())->getNumElements() == 4;
+  Intrinsic::ID ID;
+  if (DP.SignedA)
+    ID = Byte ? (Acc ? Intrinsic::riscv_pulp_sdotsp4
+                     : Intrinsic::riscv_pulp_dotsp4)
+              : (Acc ? Intrinsic::riscv_pulp_sdotsp2
+                     : Intrinsic::riscv_pulp_dotsp2);
+  else if (DP.SignedB)
+    ID = Byte ? (Acc ? Intrinsic::riscv_pulp_sdotusp4
+                     : Intrinsic::riscv_pulp_dotusp4)
+              : (Acc ? Intrinsic::riscv_pulp_sdotusp2
+                     : Intrinsic::riscv_pulp_dotusp2);
+  else
+    ID = Byte ? (Acc ? Intrinsic::riscv_pulp_sdotup4
+                     : Intrinsic::riscv_pulp_dotup4)
+              : (Acc ? Intrinsic::riscv_pulp_sdotup2
+                     : Intrinsic::riscv_pulp_dotup2);
+
+  ++NumDotProducts;
+  if (Acc)
+    return Builder.CreateIntrinsic(ID, {}, {DP.A, DP.B, Acc});
+  return Builder.CreateIntrinsic(ID, {}, {DP.A, DP.B});
+}
+
+bool PULPDotProduct::convertReduction(IntrinsicInst *Red) {
+  DotProduct DP;
+  if (!matchDotProduct(Red->getArgOperand(0), DP))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Dot product reduction " << *Red << "\n");
+
+  // Fold a single scalar accumulation into the dot product.
+  Instruction *Repl = Red;
+  Value *Acc = nullptr;
+  if (Red->hasOneUse()) {
+    auto *Add = dyn_cast<BinaryOperator>(Red->user_back());
+    if (Add && Add->getOpcode() == Instruction::Add) {
+      Repl = Add;
+      Acc = Add->getOperand(Add->getOperand(0) == Red ? 1 : 0);
+    }
+  }
+
+  IRBuilder<> Builder(Repl);
+  Value *Dot = createDotProduct(Builder, DP, Acc);
+  Repl->replaceAllUsesWith(Dot);
+  Value *Mul = Red->getArgOperand(0);
+  if (Repl != Red)
+    Repl->eraseFromParent();
+  Red->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Mul);
+  return true;
+}
+
+bool PULPDotProduct::convertAccumulator(PHINode *Phi) {
+  if (Phi->getNumIncomingValues() != 2 || !Phi->hasOneUse())
+    return false;
+
+  // Follow the chain of additions of dot products to the value fed back into
+  // the phi.
+  SmallVector<std::pair<BinaryOperator *, DotProduct>, 2> Chain;
+  Value *Cur = Phi;
+  while (true) {
+    if (!Cur->hasOneUse())
+      break;
+    auto *Add = dyn_cast<BinaryOperator>(Cur->user_back());
+    if (!Add || Add->getOpcode() != Instruction::Add)
+      break;
+    DotProduct DP;
+    Value *Other = Add->getOperand(Add->getOperand(0) == Cur ? 1 : 0);
+    if (Other == Cur || !matchDotProduct(Other, DP))
+      return false;
+    Chain.push_back({Add, DP});
+    Cur = Add;
+  }
+  if (Chain.empty())
+    return false;
+
+  // The end of the chain is fed back into the phi, its other uses have to be
+  // reductions after the loop, possibly through LCSSA phis.
+  BinaryOperator *Next = Chain.back().first;
+  unsigned BackEdge;
+  if (Phi->getIncomingValue(0) == Next)
+    BackEdge = 0;
+  else if (Phi->getIncomingValue(1) == Next)
+    BackEdge = 1;
+  else
+    return false;
+  unsigned Entry = 1 - BackEdge;
+
+  SmallVector<IntrinsicInst *, 2> Reductions;
+  SmallVector<PHINode *, 2> ExitPhis;
+  for (User *U : Next->users()) {
+    if (U == Phi)
+      continue;
+    if (isAddReduction(U)) {
+      Reductions.push_back(cast<IntrinsicInst>(U));
+      continue;
+    }
+    auto *ExitPhi = dyn_cast<PHINode>(U);
+    if (!ExitPhi || ExitPhi == Phi)
+      return false;
+    for (Value *In : ExitPhi->incoming_values())
+      if (In != Next)
+        return false;
+    for (User *PU : ExitPhi->users())
+      if (!isAddReduction(PU))
+        return false;
+    ExitPhis.push_back(ExitPhi);
+  }
+  if (Reductions.empty() && ExitPhis.empty())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Dot product accumulator " << *Phi << "\n");
+
+  // The scalar accumulator starts with the sum of the lanes of the vector.
+  Type *Int32Ty = Type::getInt32Ty(Phi->getContext());
+  Value *Start = Phi->getIncomingValue(Entry);
+  Value *ScalarStart;
+  if (isa<ConstantAggregateZero>(Start)) {
+    ScalarStart = ConstantInt::get(Int32Ty, 0);
+  } else {
+    IRBuilder<> Builder(Phi->getIncomingBlock(Entry)->getTerminator());
+    ScalarStart = Builder.CreateAddReduce(Start);
+  }
+
+  IRBuilder<> Builder(Phi);
+  PHINode *Acc = Builder.CreatePHI(Int32Ty, 2, Phi->getName() + ".dotp");
+  Acc->addIncoming(ScalarStart, Phi->getIncomingBlock(Entry));
+  Value *ScalarNext = Acc;
+  for (auto &Link : Chain) {
+    Builder.SetInsertPoint(Link.first);
+    ScalarNext = createDotProduct(Builder, Link.second, ScalarNext);
+  }
+  Acc->addIncoming(ScalarNext, Phi->getIncomingBlock(BackEdge));
+
+  for (IntrinsicInst *Red : Reductions) {
+    Red->replaceAllUsesWith(ScalarNext);
+    Red->eraseFromParent();
+  }
+  for (PHINode *ExitPhi : ExitPhis) {
+    Builder.SetInsertPoint(ExitPhi);
+    PHINode *ScalarPhi = Builder.CreatePHI(
+        Int32Ty, ExitPhi->getNumIncomingValues(), ExitPhi->getName() + ".dotp");
+    for (BasicBlock *BB : ExitPhi->blocks())
+      ScalarPhi->addIncoming(ScalarNext, BB);
+    for (User *U : make_early_inc_range(ExitPhi->users())) {
+      U->replaceAllUsesWith(ScalarPhi);
+      cast<Instruction>(U)->eraseFromParent();
+    }
+    ExitPhi->eraseFromParent();
+  }
+
+  // The vector chain is dead now, the phi keeps it alive through the back
+  // edge.
+  Phi->replaceAllUsesWith(UndefValue::get(Phi->getType()));
+  Phi->eraseFromParent();
+  for (auto &Link : reverse(Chain)) {
+    Link.first->replaceAllUsesWith(UndefValue::get(Next->getType()));
+    Link.first->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(Link.second.Mul);
+  }
+
+  ++NumAccumulators;
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(PULPDotProduct, DEBUG_TYPE, PULP_DOTP_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(PULPDotProduct, DEBUG_TYPE, PULP_DOTP_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createPULPDotProductPass() {
+    return new PULPDotProduct();
+  }
+} // end of namespace llvm
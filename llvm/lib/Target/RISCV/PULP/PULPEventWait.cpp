@@ -0,0 +1,221 @@
+//===-- PULPEventWait.cpp - Turn event unit polling into p.elw ------------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass turns spin-waits on registers of the PULP cluster event unit
+// into p.elw loads. A spin-wait is a loop made of a single block that only
+// polls one volatile or atomic word and computes the exit condition from it:
+//
+//   loop:
+//     %v = load volatile i32, i32* inttoptr (i32 0x204004 to i32*)
+//     %c = icmp eq i32 %v, 0
+//     br i1 %c, label %loop, label %exit
+//
+// The polling load becomes a call of llvm.riscv.pulp.event.unit.read, which
+// is selected to p.elw. The event unit holds back the response to p.elw on
+// its wait registers, clock gating the core instead of letting it hammer the
+// peripheral interconnect, and p.elw restarts properly when the wait is
+// interrupted. Polling the masked event buffer is redirected to the event
+// wait register, which returns the same value but only once an event is
+// pending, so the loop sleeps until the next event.
+//
+// Other volatile loops, e.g. on flags in the TCDM, are left alone: a core
+// sleeping on them would never be woken up.
+//
+// The pass runs on functions with the "pulp-event-wait" attribute, or on all
+// functions with -pulp-event-wait, for subtargets with the PULPv2 extension.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "pulp-event-wait"
+#define PULP_EVENT_WAIT_NAME "PULP event unit wait formation"
+
+static cl::opt<bool> EnableEventWait(
+    "pulp-event-wait", cl::init(false), cl::Hidden,
+    cl::desc("Turn spin-waits on event unit registers into p.elw in all "
+             "functions"));
+
+STATISTIC(NumEventWaits, "Number of event unit spin-waits turned into p.elw");
+STATISTIC(NumSleeps, "Number of event buffer spin-waits made to sleep");
+
+namespace {
+
+// The layout of the event unit, as offsets into the address range of a
+// cluster. The cluster that a core belongs to is also aliased at address 0.
+enum : uint64_t {
+  ClusterBase = 0x10000000,
+  ClusterSize = 0x00400000,
+  MaxClusters = 32,
+  EUBase = 0x00200800,
+  EUSize = 0x00000800,
+  EUDemuxBase = 0x00204000,
+  EUDemuxSize = 0x00000800,
+  EUCoreBufferMasked = 0x04,
+  EUCoreEventWait = 0x38,
+};
+
+class PULPEventWait : public FunctionPass {
+public:
+  static char ID;
+
+  PULPEventWait() : FunctionPass(ID) {
+    initializePULPEventWaitPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return PULP_EVENT_WAIT_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.setPreservesCFG();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  /// Return the polling load of \p BB if it is a spin-wait.
+  LoadInst *getSpinWaitLoad(BasicBlock &BB) const;
+
+  /// Replace the polling \p Load of event unit address \p Addr by p.elw.
+  void formEventWait(LoadInst *Load, uint64_t Addr);
+};
+
+} // end anonymous namespace
+
+char PULPEventWait::ID = 0;
+
+/// Return the constant address \p Ptr points to, if any.
+static Optional<uint64_t> getConstantAddress(Value *Ptr,
+                                             const DataLayout &DL) {
+  APInt Offset(DL.getIndexTypeSizeInBits(Ptr->getType()), 0);
+  Value *Base = Ptr->stripAndAccumulateConstantOffsets(
+      DL, Offset, /*AllowNonInbounds=*/true);
+  auto *CE = dyn_cast<ConstantExpr>(Base);
+  if (!CE || CE->getOpcode() != Instruction::IntToPtr)
+    return None;
+  auto *CI = dyn_cast<ConstantInt>(CE->getOperand(0));
+  if (!CI)
+    return None;
+  return CI->getZExtValue() + Offset.getSExtValue();
+}
+
+/// Return whether \p Addr is a register of the event unit of a cluster.
+static bool isEventUnitAddress(uint64_t Addr) {
+  bool InCluster = Addr < ClusterSize ||
+                   (Addr >= ClusterBase &&
+                    Addr < ClusterBase + MaxClusters * ClusterSize);
+  if (!InCluster)
+    return false;
+  uint64_t Offset = Addr % ClusterSize;
+  return (Offset >= EUBase && Offset < EUBase + EUSize) ||
+         (Offset >= EUDemuxBase && Offset < EUDemuxBase + EUDemuxSize);
+}
+
+bool PULPEventWait::runOnFunction(Function &F) {
+  if (skipFunction(F))
+    return false;
+  if (!EnableEventWait && !F.hasFnAttribute("pulp-event-wait"))
+    return false;
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasPULPExtV2())
+    return false;
+
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  SmallVector<std::pair<LoadInst *, uint64_t>, 4> Waits;
+  for (BasicBlock &BB : F) {
+    LoadInst *Load = getSpinWaitLoad(BB);
+    if (!Load)
+      continue;
+    Optional<uint64_t> Addr = getConstantAddress(Load->getPointerOperand(), DL);
+    if (Addr && isEventUnitAddress(*Addr))
+      Waits.emplace_back(Load, *Addr);
+  }
+
+  for (auto &Wait : Waits)
+    formEventWait(Wait.first, Wait.second);
+  return !Waits.empty();
+}
+
+LoadInst *PULPEventWait::getSpinWaitLoad(BasicBlock &BB) const {
+  auto *Br = dyn_cast<BranchInst>(BB.getTerminator());
+  if (!Br || !Br->isConditional() ||
+      (Br->getSuccessor(0) != &BB && Br->getSuccessor(1) != &BB))
+    return nullptr;
+
+  LoadInst *Load = nullptr;
+  for (Instruction &I : BB) {
+    if (&I == Br || I.isDebugOrPseudoInst())
+      continue;
+    if (auto *LI = dyn_cast<LoadInst>(&I)) {
+      if (Load || !(LI->isVolatile() || LI->isAtomic()) ||
+          !LI->getType()->isIntegerTy(32))
+        return nullptr;
+      // The polled address must not change between iterations.
+      auto *Ptr = dyn_cast<Instruction>(LI->getPointerOperand());
+      if (Ptr && Ptr->getParent() == &BB)
+        return nullptr;
+      Load = LI;
+      continue;
+    }
+    // Anything else must only compute the exit condition.
+    if (isa<PHINode>(I) || I.mayReadOrWriteMemory() || I.mayHaveSideEffects())
+      return nullptr;
+  }
+  return Load;
+}
+
+void PULPEventWait::formEventWait(LoadInst *Load, uint64_t Addr) {
+  LLVM_DEBUG(dbgs() << "Forming event wait from " << *Load << "\n");
+
+  // The event wait register returns the masked event buffer once it is not
+  // empty.
+  if (Addr % ClusterSize == EUDemuxBase + EUCoreBufferMasked) {
+    Addr += EUCoreEventWait - EUCoreBufferMasked;
+    ++NumSleeps;
+  }
+
+  IRBuilder<> Builder(Load);
+  Module *M = Load->getModule();
+  Value *Ptr = ConstantExpr::getIntToPtr(Builder.getInt32(Addr),
+                                         Builder.getInt32Ty()->getPointerTo());
+  Function *ELW =
+      Intrinsic::getDeclaration(M, Intrinsic::riscv_pulp_event_unit_read);
+  CallInst *Wait = Builder.CreateCall(ELW, {Ptr, Builder.getInt32(0)});
+  Wait->takeName(Load);
+  Load->replaceAllUsesWith(Wait);
+  Load->eraseFromParent();
+  ++NumEventWaits;
+}
+
+INITIALIZE_PASS_BEGIN(PULPEventWait, DEBUG_TYPE, PULP_EVENT_WAIT_NAME, false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(PULPEventWait, DEBUG_TYPE, PULP_EVENT_WAIT_NAME, false,
+                    false)
+
+namespace llvm {
+  FunctionPass *createPULPEventWaitPass() { return new PULPEventWait(); }
+} // end of namespace llvm
@@ -9,6 +9,7 @@
 
 #include "../RISCVTargetMachine.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
@@ -18,6 +19,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Pass.h"
 
+#include <algorithm>
 #include <queue>
 #include <set>
 
@@ -31,6 +33,11 @@ static cl::opt<signed> MaxLoopRangeReg(
     "pulp-loop-range-register", cl::Hidden, cl::init(8190),
     cl::desc("Restrict range of lp.setup to N instructions."));
 
+static cl::opt<unsigned> MinNestedLoopEndGap(
+    "pulp-loop-nest-gap", cl::Hidden, cl::init(2),
+    cl::desc("Minimum number of instructions between the end of an inner and "
+             "the end of an outer hardware loop."));
+
 namespace llvm {
   FunctionPass *createPULPFixupHwLoops();
   void initializePULPFixupHwLoopsPass(PassRegistry&);
@@ -64,6 +71,9 @@ MachineBasicBlock *splitMBBAt(MachineBasicBlock *OldMBB, MachineInstr &MI) {
       MF->CreateMachineBasicBlock(OldMBB->getBasicBlock());
 
   MF->insert(++MachineFunction::iterator(OldMBB), SplitBB);
+  SplitBB->setSectionID(OldMBB->getSectionID());
+  SplitBB->setIsEndSection(OldMBB->isEndSection());
+  OldMBB->setIsEndSection(false);
   SplitBB->splice(SplitBB->begin(), OldMBB, SplitPoint, OldMBB->end());
 
   SplitBB->transferSuccessorsAndUpdatePHIs(OldMBB);
@@ -104,6 +114,8 @@ MachineBasicBlock *splitMBBAt(MachineBasicBlock *OldMBB, MachineInstr &MI) {
     bool fixupLoopPreheader(MachineFunction &MF);
     bool fixupLoopLatch(MachineFunction &MF);
     bool fixupLoopInstrs(MachineFunction &MF);
+    bool fixupNestedLoopEnds(MachineFunction &MF,
+                             ArrayRef<MachineInstr *> Setups);
 
   };
 
@@ -478,6 +490,75 @@ bool PULPFixupHwLoops::fixupLoopLatch(MachineFunction &MF) {
   return changedOverall;
 }
 
+/// Returns the first instruction of \p MBB which is emitted.
+static MachineBasicBlock::iterator getFirstRealInstr(MachineBasicBlock &MBB) {
+  MachineBasicBlock::iterator I = MBB.begin();
+  while (I != MBB.end() && I->isMetaInstruction())
+    ++I;
+  return I;
+}
+
+/// The end of an outer hardware loop has to lie at least MinNestedLoopEndGap
+/// instructions after the end of the loop nested in it; otherwise the core
+/// cannot tell the two loop ends apart. \p Setups are the loop setup
+/// instructions, whose first operand is the block starting with the last
+/// instruction of the loop. Missing instructions are filled up with NOPs after
+/// the end of the inner loop, which only run once the inner loop exits.
+bool PULPFixupHwLoops::fixupNestedLoopEnds(MachineFunction &MF,
+                                           ArrayRef<MachineInstr *> Setups) {
+  const RISCVInstrInfo *RII =
+      static_cast<const RISCVInstrInfo *>(MF.getSubtarget().getInstrInfo());
+
+  DenseMap<const MachineBasicBlock *, unsigned> BlockNumber;
+  unsigned Number = 0;
+  for (const MachineBasicBlock &MBB : MF)
+    BlockNumber[&MBB] = Number++;
+
+  bool Changed = false;
+  for (MachineInstr *Inner : Setups) {
+    MachineBasicBlock *InnerEnd = Inner->getOperand(0).getMBB();
+    for (MachineInstr *Outer : Setups) {
+      MachineBasicBlock *OuterEnd = Outer->getOperand(0).getMBB();
+      // The inner loop is set up and ends within the outer loop.
+      if (Inner == Outer ||
+          BlockNumber[Inner->getParent()] <= BlockNumber[Outer->getParent()] ||
+          BlockNumber[InnerEnd] >= BlockNumber[OuterEnd])
+        continue;
+
+      MachineBasicBlock::iterator InnerLast = getFirstRealInstr(*InnerEnd);
+      MachineBasicBlock::iterator OuterLast = getFirstRealInstr(*OuterEnd);
+      if (InnerLast == InnerEnd->end() || OuterLast == OuterEnd->end())
+        continue;
+
+      // Count the instructions after the inner end up to the outer end.
+      unsigned Gap = 0;
+      MachineBasicBlock::iterator I = std::next(InnerLast);
+      MachineFunction::iterator MBBI = InnerEnd->getIterator();
+      while (Gap < MinNestedLoopEndGap) {
+        if (I == MBBI->end()) {
+          if (++MBBI == MF.end())
+            break;
+          I = MBBI->begin();
+          continue;
+        }
+        if (!I->isMetaInstruction())
+          ++Gap;
+        if (I == OuterLast)
+          break;
+        ++I;
+      }
+
+      DebugLoc DL = InnerLast->getDebugLoc();
+      for (; Gap < MinNestedLoopEndGap; ++Gap) {
+        BuildMI(*InnerEnd, std::next(InnerLast), DL, RII->get(RISCV::ADDI))
+          .addReg(RISCV::X0).addReg(RISCV::X0).addImm(0);
+        Changed = true;
+      }
+    }
+  }
+  return Changed;
+}
+
 /// This function makes three passes over the basic blocks.  The first
 /// pass labels all loop ends. The second calculates the offset of the
 /// instructions between blocks. The third checks the length of the hardware
@@ -495,6 +576,7 @@ bool PULPFixupHwLoops::fixupLoopInstrs(MachineFunction &MF) {
 
   // First pass: Label the end of each loop.
   bool Changed = false;
+  SmallVector<MachineInstr *, 4> Setups;
   for (MachineBasicBlock &MBB : MF) {
     // Loop over all the instructions.
     MachineBasicBlock::iterator MII = MBB.begin();
@@ -510,6 +592,18 @@ bool PULPFixupHwLoops::fixupLoopInstrs(MachineFunction &MF) {
         // Figure out which MBB that is the last one in the loop.
         MachineBasicBlock *LastMBB = MII->getOperand(0).getMBB();
 
+        // The latch of an outer loop can be left without instructions once
+        // its bump and branch have been removed, but the loop needs a last
+        // instruction to end on.
+        if (std::all_of(LastMBB->getFirstNonPHI(), LastMBB->getFirstTerminator(),
+                        [](const MachineInstr &MI) {
+                          return MI.isTransient();
+                        })) {
+          BuildMI(*LastMBB, LastMBB->getFirstTerminator(), MII->getDebugLoc(),
+                  RII->get(RISCV::ADDI)).addReg(RISCV::X0).addReg(RISCV::X0)
+                                        .addImm(0);
+        }
+
         // Create a new basic block in the loop, and insert it after the
         // current last. It will be used to label the last instruction in the
         // loop.
@@ -529,6 +623,9 @@ bool PULPFixupHwLoops::fixupLoopInstrs(MachineFunction &MF) {
         MachineFunction *MF = LastMBB->getParent();
         auto LoopEnd = MF->CreateMachineBasicBlock();
         MF->insert(++LastMBB->getIterator(), LoopEnd);
+        LoopEnd->setSectionID(LastMBB->getSectionID());
+        LoopEnd->setIsEndSection(LastMBB->isEndSection());
+        LastMBB->setIsEndSection(false);
         // Adopt the control flow.
         LoopEnd->transferSuccessors(LastMBB);
         LastMBB->addSuccessor(LoopEnd);
@@ -547,6 +644,7 @@ bool PULPFixupHwLoops::fixupLoopInstrs(MachineFunction &MF) {
             DL, RII->get(MII->getOpcode()));
         MIB.addMBB(LoopEnd);
         MIB.add(MII->getOperand(1));
+        Setups.push_back(MIB.getInstr());
         // Remove old
         MII = MII->getParent()->erase(MII);
       } else {
@@ -555,8 +653,15 @@ bool PULPFixupHwLoops::fixupLoopInstrs(MachineFunction &MF) {
     }
   }
 
-  // Second pass: Compute offset from start
+  Changed |= fixupNestedLoopEnds(MF, Setups);
+
+  // Second pass: Compute offset from start. Aligned blocks, such as hot loop
+  // headers, are assumed to be preceded by the largest possible padding.
+  const unsigned MinInstSize =
+      MF.getSubtarget<RISCVSubtarget>().hasStdExtC() ? 2 : 4;
   for (const MachineBasicBlock &MBB : MF) {
+    if (MBB.getAlignment().value() > MinInstSize)
+      InstOffset += MBB.getAlignment().value() - MinInstSize;
     BlockToInstOffset[&MBB] = InstOffset;
     for (const MachineInstr &MI : MBB) {
       InstOffset += getMISize(MI);
@@ -11,14 +11,20 @@
 // loop instruction.  The hardware loop can perform loop branches with a
 // zero-cycle overhead.
 //
+// Every converted loop is reported as an optimization remark, every loop
+// which is not converted as a missed remark named after the reason, see
+// RISCVLoopRemarks.h (-Rpass-missed=pulp-hwloops).
+//
 //  This file is based on the lib/Target/Hexagon/HexagonHardwareLoops.cpp file.
 //
 //===----------------------------------------------------------------------===//
 
 #include "../RISCVInstrInfo.h"
+#include "../RISCVLoopRemarks.h"
 #include "../RISCVRegisterInfo.h"
 #include "../RISCVSubtarget.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -32,7 +38,9 @@
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineOperand.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/MachineSSAUpdater.h"
 #include "llvm/CodeGen/TargetRegisterInfo.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugLoc.h"
@@ -57,14 +65,17 @@ using namespace llvm;
 
 #define DEBUG_TYPE "pulp-hwloops"
 
-// Turn it off by default. If a preheader block is not created here, the
-// software pipeliner may be unable to find a block suitable to serve as
-// a preheader. In that case SWP will not run.
-static cl::opt<bool> SpecPreheader("pulp-hwloop-spec-preheader", cl::init(false),
+// A speculative preheader is the block guarding the loop. The edge from it
+// into the loop is split before the loop setup is placed, so the loop setup
+// still directly precedes the loop body and nothing is executed speculatively
+// when the loop is skipped.
+static cl::opt<bool> SpecPreheader("pulp-hwloop-spec-preheader", cl::init(true),
   cl::Hidden, cl::ZeroOrMore, cl::desc("Allow speculation of preheader "
   "instructions"));
 
 STATISTIC(NumHWLoops, "Number of loops converted to hardware loops");
+STATISTIC(NumVersionedLoops,
+          "Number of hardware loops versioned for a zero trip count");
 
 namespace llvm {
 
@@ -81,6 +92,7 @@ namespace {
     MachineLoopInfo            *MLI;
     MachineRegisterInfo        *MRI;
     MachineDominatorTree       *MDT;
+    MachineOptimizationRemarkEmitter *ORE;
     const RISCVInstrInfo     *TII;
     const RISCVRegisterInfo  *TRI;
 
@@ -98,6 +110,7 @@ namespace {
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<MachineDominatorTree>();
       AU.addRequired<MachineLoopInfo>();
+      AU.addRequired<MachineOptimizationRemarkEmitterPass>();
       MachineFunctionPass::getAnalysisUsage(AU);
     }
 
@@ -189,13 +202,33 @@ namespace {
     /// loop.
     bool isInvalidLoopOperation(const MachineInstr *MI) const;
 
-    /// Return true if the loop contains an instruction that inhibits
-    /// using the hardware loop.
-    bool containsInvalidInstruction(MachineLoop *L) const;
+    /// Return the first instruction of the loop that inhibits using the
+    /// hardware loop, or nullptr if there is none.
+    const MachineInstr *findInvalidInstruction(MachineLoop *L) const;
+
+    /// Emit a missed remark for \p L, declined for \p Reason. \p MI is the
+    /// offending instruction, if any.
+    void reportMissed(MachineLoop *L, RISCVLoopRemark::Reason Reason,
+                      const MachineInstr *MI = nullptr);
+
+    /// Hardware loop levels, as a mask of the levels used in a loop nest.
+    enum HardwareLoopLevel { HWLoop0 = 0x1, HWLoop1 = 0x2 };
 
-    /// Given a loop, check if we can convert it to a hardware loop.
-    /// If so, then perform the conversion and return true.
-    bool convertToHardwareLoop(MachineLoop *L, bool &L0used, bool &L1used);
+    /// Given a loop, check if we can convert it and the loops nested in it to
+    /// hardware loops. If so, then perform the conversion and return true.
+    /// The levels used by the converted loops are returned in \p UsedLevels.
+    bool convertNestToHardwareLoops(MachineLoop *L, unsigned &UsedLevels);
+
+    /// Convert the loop \p L to a hardware loop using loop \p Level, 0 or 1.
+    bool convertToHardwareLoop(MachineLoop *L, unsigned Level);
+
+    /// Version the single block loop \p L on a zero trip count in \p CountReg.
+    /// \p Preheader branches to a software copy of the loop if the count is
+    /// zero, and to a new preheader otherwise. Return the new preheader, which
+    /// will hold the loop setup, or nullptr if the loop cannot be versioned.
+    MachineBasicBlock *versionZeroTripCountLoop(MachineLoop *L,
+                                                MachineBasicBlock *Preheader,
+                                                Register CountReg);
 
     /// Return true if the instruction is now dead.
     bool isDead(const MachineInstr *MI,
@@ -245,6 +278,7 @@ namespace {
 
   private:
     CountValueType Kind;
+    bool MayBeZero = false;
     union Values {
       struct {
         unsigned Reg;
@@ -267,6 +301,11 @@ namespace {
     bool isReg() const { return Kind == CV_Register; }
     bool isImm() const { return Kind == CV_Immediate; }
 
+    /// A register trip count which could not be proven to be non-zero. A zero
+    /// count means the loop wraps around the whole register range.
+    bool mayBeZero() const { return MayBeZero; }
+    void setMayBeZero() { MayBeZero = true; }
+
     unsigned getReg() const {
       assert(isReg() && "Wrong CountValue accessor");
       return Contents.R.Reg;
@@ -294,6 +333,7 @@ INITIALIZE_PASS_BEGIN(PULPHardwareLoops, "pulp-hwloops",
                       "PULP Hardware Loops", false, false)
 INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
 INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineOptimizationRemarkEmitterPass)
 INITIALIZE_PASS_END(PULPHardwareLoops, "pulp-hwloops",
                     "PULP Hardware Loops", false, false)
 
@@ -319,16 +359,18 @@ bool PULPHardwareLoops::runOnMachineFunction(MachineFunction &MF) {
   MLI = &getAnalysis<MachineLoopInfo>();
   MRI = &MF.getRegInfo();
   MDT = &getAnalysis<MachineDominatorTree>();
+  ORE = &getAnalysis<MachineOptimizationRemarkEmitterPass>().getORE();
   const RISCVSubtarget &HST = MF.getSubtarget<RISCVSubtarget>();
   TII = HST.getInstrInfo();
   TRI = HST.getRegisterInfo();
 
-  for (auto &L : *MLI)
+  // Versioning adds loops, iterate over a copy of the top level loops.
+  SmallVector<MachineLoop *, 8> Loops(MLI->begin(), MLI->end());
+  for (MachineLoop *L : Loops)
     if (!L->getParentLoop()) {
-      bool L0Used = false;
-      bool L1Used = false;
+      unsigned UsedLevels = 0;
       KnownHardwareLoops.clear();
-      Changed |= convertToHardwareLoop(L, L0Used, L1Used);
+      Changed |= convertNestToHardwareLoops(L, UsedLevels);
     }
 
   if (Changed) {
@@ -410,12 +452,16 @@ bool PULPHardwareLoops::findInductionRegister(MachineLoop *L,
     return false;
   }
   
-  // We now know there are two terminators, one conditional and one
-  // unconditional. If the order does not match what we expect, bail out.
-  MachineInstr *condTerm = &(*Latch->getFirstTerminator());
-  MachineInstr *uncondTerm = &(*std::next(Latch->getFirstTerminator()));
-  if (!(condTerm->getDesc().isConditionalBranch() &&
-      uncondTerm->getDesc().isUnconditionalBranch())) {
+  // The latch has to end in a conditional branch, optionally followed by an
+  // unconditional one. Latches of outer loops often fall through to the exit.
+  // If the order does not match what we expect, bail out.
+  MachineBasicBlock::iterator CondTerm = Latch->getFirstTerminator();
+  if (CondTerm == Latch->end() || !CondTerm->getDesc().isConditionalBranch()) {
+    return false;
+  }
+  MachineBasicBlock::iterator UncondTerm = std::next(CondTerm);
+  if (UncondTerm != Latch->end() &&
+      !UncondTerm->getDesc().isUnconditionalBranch()) {
     return false;
   }
 
@@ -586,13 +632,17 @@ CountValue *PULPHardwareLoops::getLoopTripCount(MachineLoop *L,
   if (!TB || (FB && TB != Header && FB != Header)) {
     return nullptr;
   }
-  
-  // We now know there are two terminators, one conditional and one 
-  // unconditional. Double check to be sure.
-  MachineBasicBlock::iterator firstTerm = Latch->getFirstTerminator();
-  MachineBasicBlock::iterator secondTerm = std::next(firstTerm);
-  if (!(firstTerm->getDesc().isConditionalBranch() && 
-      secondTerm->getDesc().isUnconditionalBranch())) {
+
+  // The latch ends in a conditional branch, optionally followed by an
+  // unconditional one. Double check to be sure.
+  MachineBasicBlock::iterator FirstTerm = Latch->getFirstTerminator();
+  if (FirstTerm == Latch->end() ||
+      !FirstTerm->getDesc().isConditionalBranch()) {
+    return nullptr;
+  }
+  MachineBasicBlock::iterator SecondTerm = std::next(FirstTerm);
+  if (SecondTerm != Latch->end() &&
+      !SecondTerm->getDesc().isUnconditionalBranch()) {
     return nullptr;
   }
 
@@ -761,11 +811,10 @@ CountValue *PULPHardwareLoops::computeCount(MachineLoop *Loop,
 
   // Check if the initial value may be zero and can be decremented in the first
   // iteration. If the value is zero, the endloop instruction will not decrement
-  // the loop counter, so we shouldn't generate a hardware loop in this case.
-  if (loopCountMayWrapOrUnderFlow(Start, End, Loop->getLoopPreheader(), Loop,
-                                  LoopFeederPhi)) {
-    return nullptr;
-  }
+  // the loop counter, so the hardware loop has to be skipped in this case.
+  bool MayBeZero = loopCountMayWrapOrUnderFlow(Start, End,
+                                               Loop->getLoopPreheader(), Loop,
+                                               LoopFeederPhi);
 
   // A general case: Start and End are some values, but the actual
   // iteration count may not be available.  If it is not, insert
@@ -911,7 +960,10 @@ CountValue *PULPHardwareLoops::computeCount(MachineLoop *Loop,
     CountSR = 0;
   }
 
-  return new CountValue(CountValue::CV_Register, CountR, CountSR);
+  CountValue *Count = new CountValue(CountValue::CV_Register, CountR, CountSR);
+  if (MayBeZero)
+    Count->setMayBeZero();
+  return Count;
 }
 
 /// Return true if the operation is invalid within hardware loop.
@@ -938,18 +990,36 @@ bool PULPHardwareLoops::isInvalidLoopOperation(const MachineInstr *MI) const {
   return false;
 }
 
-/// Return true if the loop contains an instruction that inhibits
-/// the use of the hardware loop instruction.
-bool PULPHardwareLoops::containsInvalidInstruction(MachineLoop *L) const {
+/// Return the first instruction of the loop that inhibits the use of the
+/// hardware loop instruction.
+const MachineInstr *
+PULPHardwareLoops::findInvalidInstruction(MachineLoop *L) const {
   for (MachineBasicBlock *MBB : L->getBlocks()) {
     for (MachineInstr &MI : *MBB) {
       if (isInvalidLoopOperation(&MI)) {
         LLVM_DEBUG(dbgs() << "\nCannot convert to hwloop due to:"; MI.dump(););
-        return true;
+        return &MI;
       }
     }
   }
-  return false;
+  return nullptr;
+}
+
+void PULPHardwareLoops::reportMissed(MachineLoop *L,
+                                     RISCVLoopRemark::Reason Reason,
+                                     const MachineInstr *MI) {
+  LLVM_DEBUG(dbgs() << "Not a hardware loop: "
+                    << RISCVLoopRemark::getMessage(Reason) << "\n");
+  ORE->emit([&]() {
+    MachineOptimizationRemarkMissed R(DEBUG_TYPE,
+                                      RISCVLoopRemark::getName(Reason),
+                                      L->getStartLoc(), L->getHeader());
+    R << "loop not converted to a hardware loop: "
+      << RISCVLoopRemark::getMessage(Reason);
+    if (MI)
+      R << ": " << MachineOptimizationRemarkMissed::MachineArgument("Inst", *MI);
+    return R;
+  });
 }
 
 /// Returns true if the instruction is dead.  This was essentially
@@ -1039,61 +1109,80 @@ void PULPHardwareLoops::removeIfDead(MachineInstr *MI) {
   }
 }
 
-/// Check if the loop is a candidate for converting to a hardware
-/// loop.  If so, then perform the transformation.
-///
-/// This function works on innermost loops first.  A loop can be converted
-/// if it is a counting loop; either a register value or an immediate.
+/// Check if the loop nest is a candidate for converting to hardware
+/// loops.  If so, then perform the transformation.
 ///
-/// The code makes several assumptions about the representation of the loop
-/// in llvm.
-bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
-                                                 bool &RecL0used,
-                                                 bool &RecL1used) {
+/// This function works on innermost loops first. The innermost converted loop
+/// of a nest uses loop 0, the loop enclosing it uses loop 1. Sibling nests
+/// reuse the same levels, so a loop can only be converted if none of the
+/// nests inside of it already uses loop 1. Loops which fail to convert do not
+/// take a level, their parent can still use it.
+bool PULPHardwareLoops::convertNestToHardwareLoops(MachineLoop *L,
+                                                   unsigned &UsedLevels) {
   // This is just for sanity.
   assert(L->getHeader() && "Loop without a header?");
 
   bool Changed = false;
-  bool L0Used = false;
-  bool L1Used = false;
+  unsigned NestedLevels = 0;
 
-  // Process nested loops first.
-  for (MachineLoop::iterator I = L->begin(), E = L->end(); I != E; ++I) {
-    Changed |= convertToHardwareLoop(*I, RecL0used, RecL1used);
-    L0Used |= RecL0used;
-    L1Used |= RecL1used;
+  // Process nested loops first. Versioning adds loops to the nest, iterate
+  // over a copy.
+  SmallVector<MachineLoop *, 4> SubLoops(L->begin(), L->end());
+  for (MachineLoop *SubLoop : SubLoops) {
+    unsigned SubLevels = 0;
+    Changed |= convertNestToHardwareLoops(SubLoop, SubLevels);
+    NestedLevels |= SubLevels;
   }
+  UsedLevels = NestedLevels;
 
-  // If a nested loop has been converted, then we can't convert this loop.
-  if (Changed && L0Used && L1Used) {
+  // Loop 1 is only used around loop 0, both levels are taken.
+  if (NestedLevels & HWLoop1) {
+    reportMissed(L, RISCVLoopRemark::NoFreeLevel);
     return Changed;
   }
 
-  // The instructions that are available to use at this level. If L0 is already
-  // used we have to use L1.
-  unsigned LOOP_i;
-  unsigned LOOP_r;
-  if (L0Used) {
-    LOOP_i = RISCV::LOOP1setupi;
-    LOOP_r = RISCV::LOOP1setup;
-  } else {
-    LOOP_i = RISCV::LOOP0setupi;
-    LOOP_r = RISCV::LOOP0setup;
+  unsigned Level = (NestedLevels & HWLoop0) ? 1 : 0;
+  if (!convertToHardwareLoop(L, Level)) {
+    return Changed;
   }
 
+  UsedLevels |= Level ? HWLoop1 : HWLoop0;
+  return true;
+}
+
+/// Check if the loop is a candidate for converting to a hardware
+/// loop.  If so, then perform the transformation.
+///
+/// A loop can be converted if it is a counting loop; either a register value
+/// or an immediate.
+///
+/// The code makes several assumptions about the representation of the loop
+/// in llvm.
+bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
+                                                 unsigned Level) {
+  assert(Level < 2 && "PULP has two hardware loop levels");
+  bool Changed = false;
+
+  // The instructions that are available to use at this level.
+  unsigned LOOP_i = Level ? RISCV::LOOP1setupi : RISCV::LOOP0setupi;
+  unsigned LOOP_r = Level ? RISCV::LOOP1setup : RISCV::LOOP0setup;
+
   // Does the loop contain any invalid instructions?
-  if (containsInvalidInstruction(L)) {
+  if (const MachineInstr *Invalid = findInvalidInstruction(L)) {
+    reportMissed(L, RISCVLoopRemark::InvalidInstruction, Invalid);
     return Changed;
   }
 
   MachineBasicBlock *LastMBB = L->findLoopControlBlock();
   // Don't generate hw loop if the loop has more than one exit.
   if (!LastMBB) {
+    reportMissed(L, RISCVLoopRemark::MultipleExits);
     return Changed;
   }
 
   MachineBasicBlock::iterator LastI = LastMBB->getFirstTerminator();
   if (LastI == LastMBB->end()) {
+    reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
     return Changed;
   }
 
@@ -1108,15 +1197,27 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
     //        re-implement it based on sample code that GCC manages to make into
     //        hardware loops, but we fail.
 
+    reportMissed(L, RISCVLoopRemark::NoPreheader);
     return Changed;
   }
 
-  MachineBasicBlock::iterator InsertPos = Preheader->getFirstTerminator();
+  // A speculative preheader also branches around the loop. Split the edge into
+  // the loop to get a dedicated preheader, the loop setup has to directly
+  // precede the loop body.
+  if (Preheader != L->getLoopPreheader()) {
+    Preheader = Preheader->SplitCriticalEdge(L->getHeader(), *this);
+    if (!Preheader) {
+      reportMissed(L, RISCVLoopRemark::NoPreheader);
+      return Changed;
+    }
+    Changed = true;
+  }
 
   SmallVector<MachineInstr*, 2> OldInsts;
   // Are we able to determine the trip count for the loop?
   CountValue *TripCount = getLoopTripCount(L, OldInsts);
   if (!TripCount) {
+    reportMissed(L, RISCVLoopRemark::UnknownTripCount);
     return Changed;
   }
 
@@ -1127,6 +1228,8 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
     MachineInstr *TCDef = MRI->getVRegDef(TripCount->getReg());
     MachineBasicBlock *BBDef = TCDef->getParent();
     if (!MDT->dominates(BBDef, Preheader)) {
+      reportMissed(L, RISCVLoopRemark::TripCountNotAvailable);
+      delete TripCount;
       return Changed;
     }
   }
@@ -1140,6 +1243,8 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
     MachineBasicBlock *TB = nullptr, *FB = nullptr;
     SmallVector<MachineOperand, 2> Cond;
     if (TII->analyzeBranch(*ExitingBlock, TB, FB, Cond, false)) {
+      reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
+      delete TripCount;
       return Changed;
     }
     if (L->contains(TB))
@@ -1147,6 +1252,8 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
     else if (L->contains(FB))
       LoopStart = FB;
     else {
+      reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
+      delete TripCount;
       return Changed;
     }
   }
@@ -1158,6 +1265,8 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
   // We need a single exit block to make sure that this loop can be simplified
   // to a fixed amount of loop iterations.
   if (!ExitBlock) {
+    reportMissed(L, RISCVLoopRemark::MultipleExits);
+    delete TripCount;
     return Changed;
   }
 
@@ -1169,12 +1278,30 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
   for (const MachineBasicBlock *LB : L->getBlocks()) {
     loopSize += instructionSize * LB->size();
     if (loopSize > 0xFFF) {
+      reportMissed(L, RISCVLoopRemark::BodyTooLong);
+      delete TripCount;
       return Changed;
     }
   }
-  
+
+  // A zero trip count makes the software loop wrap around, while the hardware
+  // loop would execute once. Keep a software copy of the loop for this case.
+  if (TripCount->mayBeZero()) {
+    MachineBasicBlock *NewPH = nullptr;
+    if (TripCount->getSubReg() == 0)
+      NewPH = versionZeroTripCountLoop(L, Preheader, TripCount->getReg());
+    if (!NewPH) {
+      reportMissed(L, RISCVLoopRemark::ZeroTripCount);
+      delete TripCount;
+      return Changed;
+    }
+    Preheader = NewPH;
+    ++NumVersionedLoops;
+  }
+
   // Convert the loop to a hardware loop.
   LLVM_DEBUG(dbgs() << "Change to hardware loop at "; L->dump());
+  MachineBasicBlock::iterator InsertPos = Preheader->getFirstTerminator();
   DebugLoc DL;
   if (InsertPos != Preheader->end())
     DL = InsertPos->getDebugLoc();
@@ -1227,16 +1354,169 @@ bool PULPHardwareLoops::convertToHardwareLoop(MachineLoop *L,
 
   ++NumHWLoops;
   ++NumHWLoopsInternal;
+  ORE->emit([&]() {
+    return MachineOptimizationRemark(DEBUG_TYPE, "HardwareLoop",
+                                     L->getStartLoc(), L->getHeader())
+           << "converted loop to hardware loop "
+           << ore::NV("Level", Level);
+  });
+
+  return true;
+}
+
+/// Version the loop on a zero trip count:
+///
+///   preheader:                   preheader:
+///     ...                          ...
+///                         =>       beq count, x0, fallback
+///   loop:                        newpreheader:
+///     ...                          <loop setup>
+///     bne ..., loop              loop:
+///                                  ...  (hardware loop)
+///                                fallback:
+///                                  ...  (software loop)
+///
+/// Only loops consisting of a single block are versioned. Values defined in
+/// the loop and used after it are merged with the values of the software
+/// copy.
+MachineBasicBlock *
+PULPHardwareLoops::versionZeroTripCountLoop(MachineLoop *L,
+                                            MachineBasicBlock *Preheader,
+                                            Register CountReg) {
+  MachineBasicBlock *Header = L->getHeader();
+  MachineBasicBlock *ExitBlock = L->getExitBlock();
+  if (L->getNumBlocks() != 1 || !ExitBlock || ExitBlock->isEHPad()) {
+    return nullptr;
+  }
+
+  // Both the preheader and the loop have to end in analyzable branches.
+  MachineBasicBlock *TB = nullptr, *FB = nullptr;
+  SmallVector<MachineOperand, 4> Cond;
+  if (TII->analyzeBranch(*Header, TB, FB, Cond, false) || Cond.empty()) {
+    return nullptr;
+  }
+  MachineBasicBlock *PTB = nullptr, *PFB = nullptr;
+  SmallVector<MachineOperand, 4> PCond;
+  if (TII->analyzeBranch(*Preheader, PTB, PFB, PCond, false) ||
+      !PCond.empty() || Preheader->succ_size() != 1) {
+    return nullptr;
+  }
 
-  // Set RecL1used and RecL0used only after hardware loop has been
-  // successfully generated. Doing it earlier can cause wrong loop instruction
-  // to be used.
-  if (L0Used) // Loop0 was already used. So, the correct loop must be loop1.
-    RecL1used = true;
+  LLVM_DEBUG(dbgs() << "Versioning loop on a zero trip count in "
+                    << printReg(CountReg, TRI) << "\n");
+
+  MachineFunction &MF = *Header->getParent();
+  DebugLoc DL = Preheader->findBranchDebugLoc();
+
+  // The new preheader directly precedes the loop, the software copy is placed
+  // at the end of the function.
+  MachineBasicBlock *NewPH = MF.CreateMachineBasicBlock();
+  MF.insert(Header->getIterator(), NewPH);
+  MachineBasicBlock *Fallback =
+      MF.CreateMachineBasicBlock(Header->getBasicBlock());
+  MF.insert(MF.end(), Fallback);
+
+  // Clone the loop body with new virtual registers.
+  MapVector<Register, Register> VRMap;
+  for (MachineInstr &MI :
+       make_range(Header->begin(), Header->getFirstTerminator())) {
+    MachineInstr *NewMI = MF.CloneMachineInstr(&MI);
+    Fallback->push_back(NewMI);
+    for (MachineOperand &MO : NewMI->defs()) {
+      if (!MO.isReg() || !MO.getReg().isVirtual())
+        continue;
+      Register NewReg =
+          MRI->createVirtualRegister(MRI->getRegClass(MO.getReg()));
+      VRMap[MO.getReg()] = NewReg;
+      MO.setReg(NewReg);
+    }
+  }
+  auto getMappedReg = [&VRMap](Register Reg) {
+    auto It = VRMap.find(Reg);
+    return It == VRMap.end() ? Reg : It->second;
+  };
+  for (MachineInstr &MI : *Fallback) {
+    for (MachineOperand &MO : MI.uses())
+      if (MO.isReg())
+        MO.setReg(getMappedReg(MO.getReg()));
+    if (MI.isPHI())
+      for (unsigned i = 2, e = MI.getNumOperands(); i < e; i += 2)
+        if (MI.getOperand(i).getMBB() == Header)
+          MI.getOperand(i).setMBB(Fallback);
+  }
+
+  // The software copy branches to itself instead of to the loop.
+  SmallVector<MachineOperand, 4> NewCond;
+  for (const MachineOperand &MO : Cond)
+    NewCond.push_back(MO.isReg()
+                          ? MachineOperand::CreateReg(getMappedReg(MO.getReg()),
+                                                      false)
+                          : MO);
+  if (TB == Header)
+    TII->insertBranch(*Fallback, Fallback, ExitBlock, NewCond, DL);
   else
-    RecL0used = true;
+    TII->insertBranch(*Fallback, ExitBlock, Fallback, NewCond, DL);
+  Fallback->addSuccessor(Fallback);
+  Fallback->addSuccessor(ExitBlock);
 
-  return true;
+  for (MachineInstr &Phi : ExitBlock->phis()) {
+    for (unsigned i = 1, e = Phi.getNumOperands(); i < e; i += 2) {
+      if (Phi.getOperand(i + 1).getMBB() != Header)
+        continue;
+      const MachineOperand &MO = Phi.getOperand(i);
+      MachineInstrBuilder(MF, Phi)
+          .addReg(getMappedReg(MO.getReg()), 0, MO.getSubReg())
+          .addMBB(Fallback);
+      break;
+    }
+  }
+
+  // Guard the new preheader.
+  Header->replacePhiUsesWith(Preheader, NewPH);
+  Preheader->replaceSuccessor(Header, NewPH);
+  Preheader->addSuccessor(Fallback);
+  NewPH->addSuccessor(Header);
+  TII->removeBranch(*Preheader);
+  SmallVector<MachineOperand, 3> GuardCond = {
+      MachineOperand::CreateImm(RISCV::BEQ),
+      MachineOperand::CreateReg(CountReg, false),
+      MachineOperand::CreateReg(RISCV::X0, false)};
+  TII->insertBranch(*Preheader, Fallback, NewPH, GuardCond, DL);
+  TII->insertBranch(*NewPH, Header, nullptr, {}, DL);
+
+  // Merge the values which are live out of the loop.
+  MachineSSAUpdater SSAUpdate(MF);
+  for (const auto &KV : VRMap) {
+    SSAUpdate.Initialize(KV.first);
+    SSAUpdate.AddAvailableValue(Header, KV.first);
+    SSAUpdate.AddAvailableValue(Fallback, KV.second);
+    for (MachineOperand &MO :
+         make_early_inc_range(MRI->use_operands(KV.first))) {
+      MachineBasicBlock *UseMBB = MO.getParent()->getParent();
+      if (UseMBB != Header && UseMBB != Fallback)
+        SSAUpdate.RewriteUse(MO);
+    }
+  }
+
+  // Update the analyses.
+  MachineBasicBlock *ExitIDom = MDT->getNode(ExitBlock)->getIDom()->getBlock();
+  MDT->addNewBlock(NewPH, Preheader);
+  MDT->changeImmediateDominator(Header, NewPH);
+  MDT->addNewBlock(Fallback, Preheader);
+  MDT->changeImmediateDominator(
+      ExitBlock, MDT->findNearestCommonDominator(ExitIDom, Preheader));
+
+  MachineLoop *Parent = L->getParentLoop();
+  if (Parent)
+    Parent->addBasicBlockToLoop(NewPH, MLI->getBase());
+  MachineLoop *FallbackLoop = MLI->getBase().AllocateLoop();
+  if (Parent)
+    Parent->addChildLoop(FallbackLoop);
+  else
+    MLI->getBase().addTopLevelLoop(FallbackLoop);
+  FallbackLoop->addBasicBlockToLoop(Fallback, MLI->getBase());
+
+  return NewPH;
 }
 
 /// This function is required to break recursion. Visiting phis in a loop may
@@ -1282,10 +1562,10 @@ bool PULPHardwareLoops::phiMayWrapOrUnderflow(
 
 /// Return true if the induction variable can underflow in the first iteration.
 /// An example, is an initial unsigned value that is 0 and is decrement in the
-/// first itertion of a do-while loop.  In this case, we cannot generate a
-/// hardware loop because the endloop instruction does not decrement the loop
-/// counter if it is <= 1. We only need to perform this analysis if the
-/// initial value is a register.
+/// first itertion of a do-while loop.  In this case, the hardware loop has to
+/// be skipped because the endloop instruction does not decrement the loop
+/// counter if it is <= 1, see versionZeroTripCountLoop. We only need to
+/// perform this analysis if the initial value is a register.
 ///
 /// This function assumes the initial value may underfow unless proven
 /// otherwise. If the type is signed, then we don't care because signed
@@ -0,0 +1,253 @@
+//===-- PULPPostIncrement.cpp - Form PULP post-increment accesses ---------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass folds the pointer updates of loops into the post-increment loads
+// and stores of the PULPv2 extension. Instruction selection only forms them
+// when the update directly follows the access in the DAG; after loop strength
+// reduction, loops accessing several arrays usually keep a base register per
+// stream which is bumped once per iteration and accessed with constant
+// offsets:
+//
+//   %p = PHI %p.init, %preheader, %p.next, %loop
+//   %a = LW %p, 0
+//   %b = LW %p, 4
+//   %p.next = ADDI %p, 8
+//
+// The access at offset zero becomes the post-increment, accesses after it are
+// rebased on the incremented pointer:
+//
+//   %a, %p.next = P_LW_ri_PostIncrement %p, 8
+//   %b = LW %p.next, -4
+//
+// Register increments ("ADD %p, %stride") are folded into the register-offset
+// post-increment forms if no access follows the post-increment. Pointer updates
+// which feed the loop exit branch are left to the hardware loop conversion,
+// which removes them together with the compare.
+//
+// The pass runs on SSA form, every stream of a loop is handled independently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVInstrInfo.h"
+#include "../RISCVSubtarget.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "pulp-post-increment"
+#define PULP_POST_INCREMENT_NAME "PULP post-increment formation"
+
+static cl::opt<bool> DisablePostIncrement(
+    "pulp-post-increment-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not fold pointer updates into post-increment accesses"));
+
+STATISTIC(NumPostIncrements, "Number of post-increment accesses formed");
+
+namespace {
+
+class PULPPostIncrement : public MachineFunctionPass {
+public:
+  static char ID;
+
+  PULPPostIncrement() : MachineFunctionPass(ID) {
+    initializePULPPostIncrementPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override { return PULP_POST_INCREMENT_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<MachineLoopInfo>();
+    AU.addPreserved<MachineLoopInfo>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  const RISCVInstrInfo *TII;
+  MachineRegisterInfo *MRI;
+
+  /// Fold the pointer update \p Inc into an access in its block, returns true
+  /// on success.
+  bool foldIncrement(MachineInstr &Inc);
+};
+
+} // end anonymous namespace
+
+char PULPPostIncrement::ID = 0;
+
+/// Return the post-increment opcode for the access \p Opc, with an immediate
+/// or register increment, or 0 if there is none.
+static unsigned getPostIncrementOpcode(unsigned Opc, bool RegInc) {
+  switch (Opc) {
+  case RISCV::LB:
+    return RegInc ? RISCV::P_LB_rr_PostIncrement : RISCV::P_LB_ri_PostIncrement;
+  case RISCV::LBU:
+    return RegInc ? RISCV::P_LBU_rr_PostIncrement
+                  : RISCV::P_LBU_ri_PostIncrement;
+  case RISCV::LH:
+    return RegInc ? RISCV::P_LH_rr_PostIncrement : RISCV::P_LH_ri_PostIncrement;
+  case RISCV::LHU:
+    return RegInc ? RISCV::P_LHU_rr_PostIncrement
+                  : RISCV::P_LHU_ri_PostIncrement;
+  case RISCV::LW:
+    return RegInc ? RISCV::P_LW_rr_PostIncrement : RISCV::P_LW_ri_PostIncrement;
+  case RISCV::SB:
+    return RegInc ? RISCV::P_SB_rr_PostIncrement : RISCV::P_SB_ri_PostIncrement;
+  case RISCV::SH:
+    return RegInc ? RISCV::P_SH_rr_PostIncrement : RISCV::P_SH_ri_PostIncrement;
+  case RISCV::SW:
+    return RegInc ? RISCV::P_SW_rr_PostIncrement : RISCV::P_SW_ri_PostIncrement;
+  default:
+    return 0;
+  }
+}
+
+/// Return true if \p MI is a load or store with base register \p Reg and an
+/// immediate offset.
+static bool isBaseImmAccess(const MachineInstr &MI, Register Reg) {
+  if (!getPostIncrementOpcode(MI.getOpcode(), false))
+    return false;
+  const MachineOperand &Base = MI.getOperand(1);
+  const MachineOperand &Off = MI.getOperand(2);
+  return Base.isReg() && Base.getReg() == Reg && Off.isImm();
+}
+
+bool PULPPostIncrement::runOnMachineFunction(MachineFunction &MF) {
+  if (DisablePostIncrement || skipFunction(MF.getFunction()))
+    return false;
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  if (!ST.hasPULPExtV2() || ST.is64Bit())
+    return false;
+
+  TII = ST.getInstrInfo();
+  MRI = &MF.getRegInfo();
+  MachineLoopInfo &MLI = getAnalysis<MachineLoopInfo>();
+
+  SmallVector<MachineInstr *, 8> Incs;
+  for (MachineBasicBlock &MBB : MF) {
+    if (!MLI.getLoopFor(&MBB))
+      continue;
+    for (MachineInstr &MI : MBB)
+      if (MI.getOpcode() == RISCV::ADDI || MI.getOpcode() == RISCV::ADD)
+        Incs.push_back(&MI);
+  }
+
+  bool Changed = false;
+  for (MachineInstr *Inc : Incs)
+    Changed |= foldIncrement(*Inc);
+  return Changed;
+}
+
+bool PULPPostIncrement::foldIncrement(MachineInstr &Inc) {
+  if (!Inc.getOperand(1).isReg())
+    return false;
+  Register Dst = Inc.getOperand(0).getReg();
+  Register Base = Inc.getOperand(1).getReg();
+  const MachineOperand &Step = Inc.getOperand(2);
+  bool RegInc = Inc.getOpcode() == RISCV::ADD;
+  if (!Dst.isVirtual() || !Base.isVirtual())
+    return false;
+  if (RegInc ? !Step.getReg().isVirtual() : !Step.isImm())
+    return false;
+
+  // Leave the exit condition of the loop to the hardware loop conversion.
+  for (const MachineInstr &UseMI : MRI->use_nodbg_instructions(Dst))
+    if (UseMI.isBranch())
+      return false;
+
+  // All other uses of the base have to be in the block of the update, the
+  // ones after the post-increment are rebased on the new pointer.
+  MachineBasicBlock *MBB = Inc.getParent();
+  for (const MachineInstr &UseMI : MRI->use_nodbg_instructions(Base))
+    if (UseMI.getParent() != MBB || UseMI.isPHI())
+      return false;
+
+  // Pick the last access at offset zero before the update. The increment
+  // register has to be available there.
+  MachineInstr *Access = nullptr;
+  for (MachineInstr &MI :
+       make_range(MBB->getFirstNonPHI(), Inc.getIterator()))
+    if (isBaseImmAccess(MI, Base) && MI.getOperand(2).getImm() == 0)
+      Access = &MI;
+  if (!Access)
+    return false;
+  if (RegInc) {
+    MachineInstr *StepDef = MRI->getVRegDef(Step.getReg());
+    if (StepDef && StepDef->getParent() == MBB)
+      for (MachineInstr &MI :
+           make_range(Access->getIterator(), Inc.getIterator()))
+        if (&MI == StepDef)
+          return false;
+  }
+
+  // Check that the uses of the base after the access can be rebased.
+  SmallVector<MachineInstr *, 4> Rebased;
+  int64_t Bump = RegInc ? 0 : Step.getImm();
+  for (MachineInstr &MI :
+       make_range(std::next(Access->getIterator()), MBB->end())) {
+    if (&MI == &Inc || MI.isDebugInstr() || !MI.readsRegister(Base))
+      continue;
+    if (RegInc || !isBaseImmAccess(MI, Base) ||
+        !isInt<12>(MI.getOperand(2).getImm() - Bump) ||
+        MI.getOperand(0).getReg() == Base)
+      return false;
+    Rebased.push_back(&MI);
+  }
+
+  LLVM_DEBUG(dbgs() << "Folding " << Inc << "  into " << *Access);
+
+  unsigned Opc = getPostIncrementOpcode(Access->getOpcode(), RegInc);
+  MachineInstrBuilder MIB =
+      BuildMI(*MBB, Access, Access->getDebugLoc(), TII->get(Opc));
+  if (Access->mayLoad())
+    MIB.add(Access->getOperand(0)).addReg(Dst, RegState::Define);
+  else
+    MIB.addReg(Dst, RegState::Define).add(Access->getOperand(0));
+  MIB.addReg(Base).add(Step);
+  MIB.cloneMemRefs(*Access);
+
+  for (MachineInstr *MI : Rebased) {
+    MI->getOperand(1).setReg(Dst);
+    MI->getOperand(2).setImm(MI->getOperand(2).getImm() - Bump);
+  }
+
+  Access->eraseFromParent();
+  Inc.eraseFromParent();
+  MRI->clearKillFlags(Base);
+  MRI->clearKillFlags(Dst);
+  if (RegInc)
+    MRI->clearKillFlags(MIB->getOperand(3).getReg());
+  ++NumPostIncrements;
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(PULPPostIncrement, DEBUG_TYPE, PULP_POST_INCREMENT_NAME,
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_END(PULPPostIncrement, DEBUG_TYPE, PULP_POST_INCREMENT_NAME,
+                    false, false)
+
+namespace llvm {
+  FunctionPass *createPULPPostIncrementPass() {
+    return new PULPPostIncrement();
+  }
+} // end of namespace llvm
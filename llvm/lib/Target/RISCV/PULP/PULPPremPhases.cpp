@@ -0,0 +1,595 @@
+//===-- PULPPremPhases.cpp - Split loops into PREM phases -----------------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass splits the innermost loops of offloaded kernels into the phases
+// of the predictable execution model (PREM): the memory accessed by the loop
+// is only touched in memory phases, in which the cluster DMA copies it
+// between the main memory and the TCDM, while the loop itself computes on
+// the TCDM copies. A loop is strip-mined into tiles whose working set fits
+// into an L1 budget:
+//
+//   for (t = 0; t < n; t += len) {
+//     len = min(n - t, T);
+//     __kmpc_pulp_prem_memory_phase_begin();
+//     __kmpc_pulp_prem_dma_in(buf, &a[t], len * sizeof(a[0]));
+//     __kmpc_pulp_prem_dma_wait();
+//     __kmpc_pulp_prem_memory_phase_end();
+//     for (i = t; i < t + len; ++i)         // computes on buf only
+//       ...
+//     __kmpc_pulp_prem_memory_phase_begin();
+//     __kmpc_pulp_prem_dma_out(&a[t], buf, len * sizeof(a[0]));
+//     __kmpc_pulp_prem_dma_wait();
+//     __kmpc_pulp_prem_memory_phase_end();
+//   }
+//
+// The PREM runtime arbitrates the memory phases of the accelerator and of
+// the host cores, so that the main memory is never accessed by both at once.
+//
+// The accesses of the loop are grouped by the array they walk through. The
+// buffers of the groups are carved out of a stack allocation of the budget,
+// since the stacks of the cluster cores reside in the TCDM. A loop is only
+// split if
+//  - it is in loop-simplify form, only exits from its latch and counts its
+//    induction variable up by one to a loop-invariant bound,
+//  - every memory access of the loop is a simple load or store whose address
+//    is an affine recurrence with a positive constant stride, and the loop
+//    has no calls,
+//  - the accesses of a written group all go to the same address, cover the
+//    whole stride and are made in every iteration, so that the write-back
+//    only stores bytes written by the tile,
+//  - no written group may alias another group.
+//
+// The pass runs on functions with the "pulp-prem" attribute, or on all
+// functions with -pulp-prem, for PULP subtargets.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+#define DEBUG_TYPE "pulp-prem-phases"
+#define PULP_PREM_PHASES_NAME "PULP PREM phase splitting"
+
+static cl::opt<bool> EnablePremPhases(
+    "pulp-prem", cl::init(false), cl::Hidden,
+    cl::desc("Split the loops of all functions into PREM memory and compute "
+             "phases"));
+
+static cl::opt<unsigned> PremL1Budget(
+    "pulp-prem-l1-budget", cl::init(1024), cl::Hidden,
+    cl::desc("Number of bytes of the TCDM the PREM tiles of a loop may take"));
+
+static cl::opt<unsigned> PremMinTile(
+    "pulp-prem-min-tile", cl::init(4), cl::Hidden,
+    cl::desc("Minimum number of iterations of a PREM tile"));
+
+STATISTIC(NumPremLoops, "Number of loops split into PREM phases");
+STATISTIC(NumPremGroups, "Number of arrays copied to the TCDM by PREM tiles");
+
+namespace {
+
+// Every core has a limited number of DMA transfers in flight, each group
+// takes one in every memory phase.
+constexpr unsigned MaxGroups = 4;
+constexpr uint64_t BufferAlign = 8;
+
+/// The accesses of a loop to one array, at constant offsets from each other.
+struct AccessGroup {
+  /// Address of the first access of the group in the first iteration.
+  const SCEV *Start;
+  /// Number of bytes the accesses advance per iteration.
+  int64_t Stride;
+  /// Bytes accessed in an iteration, relative to Start.
+  int64_t Lo, Hi;
+  bool Read = false;
+  bool Written = false;
+  /// The loads and stores of the group, with their offset from Start.
+  SmallVector<std::pair<Instruction *, int64_t>, 4> Accesses;
+
+  /// Size of the buffer holding \p Count iterations.
+  uint64_t getBufferSize(uint64_t Count) const {
+    return Stride * (Count - 1) + (Hi - Lo);
+  }
+};
+
+/// A loop to split and how to split it.
+struct PremPlan {
+  Loop *L;
+  PHINode *IV;
+  Value *Init;
+  /// The compare of the latch and the index of its bound operand.
+  ICmpInst *Cmp;
+  unsigned BoundOp;
+  const SCEV *TripCount;
+  uint64_t Tile;
+  SmallVector<AccessGroup, MaxGroups> Groups;
+};
+
+class PULPPremPhases : public FunctionPass {
+public:
+  static char ID;
+
+  PULPPremPhases() : FunctionPass(ID) {
+    initializePULPPremPhasesPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return PULP_PREM_PHASES_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<AAResultsWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  AAResults *AA;
+  const DataLayout *DL;
+  /// The TCDM buffer shared by the tiles of all loops of the function.
+  AllocaInst *Arena;
+
+  /// Check whether \p L can be split and fill in \p Plan.
+  bool analyzeLoop(Loop *L, PremPlan &Plan) const;
+
+  /// Match the induction variable and the exit condition of \p L.
+  bool matchCountedLoop(Loop *L, PremPlan &Plan) const;
+
+  /// Add the access \p I of \p Ptr to the groups of \p Plan.
+  bool addAccess(PremPlan &Plan, Instruction *I, Value *Ptr, Type *Ty,
+                 bool IsWrite) const;
+
+  /// Strip-mine the loop of \p Plan into PREM tiles.
+  void splitLoop(PremPlan &Plan, ArrayRef<uint64_t> Offsets);
+};
+
+} // end anonymous namespace
+
+char PULPPremPhases::ID = 0;
+
+bool PULPPremPhases::runOnFunction(Function &F) {
+  if (skipFunction(F))
+    return false;
+  if (!EnablePremPhases && !F.hasFnAttribute("pulp-prem"))
+    return false;
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->isPULP())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "--------- PULP PREM Phase Splitting ---------\n");
+
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
+  DL = &F.getParent()->getDataLayout();
+  Arena = nullptr;
+
+  // Innermost loops never run at the same time, so their tiles may all use
+  // the same buffer. Plan them before any of them is split.
+  SmallVector<PremPlan, 4> Plans;
+  for (Loop *L : LI->getLoopsInPreorder()) {
+    PremPlan Plan;
+    if (L->isInnermost() && analyzeLoop(L, Plan))
+      Plans.push_back(std::move(Plan));
+  }
+  if (Plans.empty())
+    return false;
+
+  IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+  Arena = Builder.CreateAlloca(
+      ArrayType::get(Builder.getInt8Ty(), PremL1Budget), nullptr, "prem.l1");
+  Arena->setAlignment(Align(BufferAlign));
+
+  for (PremPlan &Plan : Plans) {
+    SmallVector<uint64_t, MaxGroups> Offsets;
+    uint64_t Offset = 0;
+    for (const AccessGroup &G : Plan.Groups) {
+      Offsets.push_back(Offset);
+      Offset = alignTo(Offset + G.getBufferSize(Plan.Tile), BufferAlign);
+    }
+    splitLoop(Plan, Offsets);
+  }
+  return true;
+}
+
+bool PULPPremPhases::matchCountedLoop(Loop *L, PremPlan &Plan) const {
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Preheader || !Latch || L->getExitingBlock() != Latch ||
+      !L->getUniqueExitBlock() || !L->hasDedicatedExits())
+    return false;
+
+  // The latch exits once the incremented induction variable reaches the
+  // bound, or continues while it did not.
+  auto *Br = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!Br || !Br->isConditional())
+    return false;
+  auto *Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+  if (!Cmp || !Cmp->hasOneUse() || !Cmp->isEquality() ||
+      (Cmp->getPredicate() == ICmpInst::ICMP_NE) !=
+          (Br->getSuccessor(0) == Header))
+    return false;
+
+  for (unsigned Op = 0; Op != 2; ++Op) {
+    Value *Next = Cmp->getOperand(Op);
+    Value *Bound = Cmp->getOperand(1 - Op);
+    Value *V;
+    if (!match(Next, m_Add(m_Value(V), m_One())) || !L->isLoopInvariant(Bound))
+      continue;
+    auto *IV = dyn_cast<PHINode>(V);
+    if (!IV || IV->getParent() != Header ||
+        IV->getIncomingValueForBlock(Latch) != Next)
+      continue;
+    Plan.IV = IV;
+    Plan.Init = IV->getIncomingValueForBlock(Preheader);
+    Plan.Cmp = Cmp;
+    Plan.BoundOp = 1 - Op;
+    return true;
+  }
+  return false;
+}
+
+bool PULPPremPhases::addAccess(PremPlan &Plan, Instruction *I, Value *Ptr,
+                               Type *Ty, bool IsWrite) const {
+  if (Ptr->getType()->getPointerAddressSpace() != 0)
+    return false;
+  Loop *L = Plan.L;
+  auto *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return false;
+  auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step || Step->getAPInt().isNonPositive())
+    return false;
+  int64_t Stride = Step->getAPInt().getSExtValue();
+  int64_t Size = DL->getTypeStoreSize(Ty);
+  const SCEV *Start = AR->getStart();
+  if (!SE->isLoopInvariant(Start, L) ||
+      !isSafeToExpandAt(Start, L->getLoopPreheader()->getTerminator(), *SE))
+    return false;
+
+  // Join the group of the same array at a constant offset, if any.
+  for (AccessGroup &G : Plan.Groups) {
+    if (G.Stride != Stride)
+      continue;
+    auto *Diff = dyn_cast<SCEVConstant>(SE->getMinusSCEV(Start, G.Start));
+    if (!Diff)
+      continue;
+    int64_t Offset = Diff->getAPInt().getSExtValue();
+    G.Lo = std::min(G.Lo, Offset);
+    G.Hi = std::max(G.Hi, Offset + Size);
+    G.Read |= !IsWrite;
+    G.Written |= IsWrite;
+    G.Accesses.emplace_back(I, Offset);
+    return true;
+  }
+
+  if (Plan.Groups.size() == MaxGroups)
+    return false;
+  AccessGroup G;
+  G.Start = Start;
+  G.Stride = Stride;
+  G.Lo = 0;
+  G.Hi = Size;
+  G.Read = !IsWrite;
+  G.Written = IsWrite;
+  G.Accesses.emplace_back(I, 0);
+  Plan.Groups.push_back(std::move(G));
+  return true;
+}
+
+bool PULPPremPhases::analyzeLoop(Loop *L, PremPlan &Plan) const {
+  Plan.L = L;
+  if (!matchCountedLoop(L, Plan))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Candidate loop: " << *L);
+
+  BasicBlock *Preheader = L->getLoopPreheader();
+  const SCEV *BTC = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC) ||
+      BTC->getType() != Plan.IV->getType() ||
+      !isSafeToExpandAt(BTC, Preheader->getTerminator(), *SE)) {
+    LLVM_DEBUG(dbgs() << "  trip count is not computable\n");
+    return false;
+  }
+  Plan.TripCount = SE->getAddExpr(BTC, SE->getOne(BTC->getType()));
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (I.isDebugOrPseudoInst() || !I.mayReadOrWriteMemory())
+        continue;
+      bool Added = false;
+      if (auto *Load = dyn_cast<LoadInst>(&I))
+        Added = Load->isSimple() &&
+                addAccess(Plan, Load, Load->getPointerOperand(),
+                          Load->getType(), /*IsWrite=*/false);
+      else if (auto *Store = dyn_cast<StoreInst>(&I))
+        Added = Store->isSimple() &&
+                addAccess(Plan, Store, Store->getPointerOperand(),
+                          Store->getValueOperand()->getType(),
+                          /*IsWrite=*/true);
+      if (!Added) {
+        LLVM_DEBUG(dbgs() << "  unsupported memory access: " << I << "\n");
+        return false;
+      }
+    }
+  if (Plan.Groups.empty())
+    return false;
+
+  // The write-back stores whole tiles, which must only hold bytes that the
+  // tile wrote.
+  BasicBlock *Latch = L->getLoopLatch();
+  for (const AccessGroup &G : Plan.Groups) {
+    if (!G.Written)
+      continue;
+    bool Covered = G.Hi - G.Lo == G.Stride, Stored = false;
+    for (auto &Access : G.Accesses) {
+      Covered &= Access.second == G.Lo;
+      auto *Store = dyn_cast<StoreInst>(Access.first);
+      Stored |= Store &&
+                DL->getTypeStoreSize(Store->getValueOperand()->getType()) ==
+                    uint64_t(G.Stride) &&
+                DT->dominates(Store->getParent(), Latch);
+    }
+    if (!Covered || !Stored) {
+      LLVM_DEBUG(dbgs() << "  written array is not covered: " << *G.Start
+                        << "\n");
+      return false;
+    }
+  }
+
+  // The groups are copied independently of each other.
+  for (unsigned A = 0, E = Plan.Groups.size(); A != E; ++A)
+    for (unsigned B = A + 1; B != E; ++B) {
+      const AccessGroup &GA = Plan.Groups[A], &GB = Plan.Groups[B];
+      if (!GA.Written && !GB.Written)
+        continue;
+      Value *PA = getLoadStorePointerOperand(GA.Accesses.front().first);
+      Value *PB = getLoadStorePointerOperand(GB.Accesses.front().first);
+      if (!AA->isNoAlias(MemoryLocation::getBeforeOrAfter(PA),
+                         MemoryLocation::getBeforeOrAfter(PB))) {
+        LLVM_DEBUG(dbgs() << "  arrays may alias: " << *GA.Start << ", "
+                          << *GB.Start << "\n");
+        return false;
+      }
+    }
+
+  // Fit the tiles of all groups into the budget.
+  int64_t PerIteration = 0, Fixed = 0;
+  for (const AccessGroup &G : Plan.Groups) {
+    PerIteration += G.Stride;
+    Fixed += G.Hi - G.Lo - G.Stride + BufferAlign;
+  }
+  if (Fixed >= int64_t(PremL1Budget))
+    return false;
+  Plan.Tile = (PremL1Budget - Fixed) / PerIteration;
+  if (unsigned TC = SE->getSmallConstantTripCount(L))
+    Plan.Tile = std::min<uint64_t>(Plan.Tile, TC);
+  if (Plan.Tile < std::max(1u, unsigned(PremMinTile))) {
+    LLVM_DEBUG(dbgs() << "  working set does not fit into the budget\n");
+    return false;
+  }
+  LLVM_DEBUG(dbgs() << "  " << Plan.Groups.size() << " arrays, tiles of "
+                    << Plan.Tile << " iterations\n");
+  return true;
+}
+
+void PULPPremPhases::splitLoop(PremPlan &Plan, ArrayRef<uint64_t> Offsets) {
+  Loop *L = Plan.L;
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Latch = L->getLoopLatch();
+  BasicBlock *Exit = L->getUniqueExitBlock();
+  Function *F = Header->getParent();
+  Module *M = F->getParent();
+  LLVMContext &Ctx = F->getContext();
+
+  Type *CountTy = Plan.IV->getType();
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *IntPtrTy = DL->getIntPtrType(Ctx);
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  FunctionCallee PhaseBegin =
+      M->getOrInsertFunction("__kmpc_pulp_prem_memory_phase_begin", VoidTy);
+  FunctionCallee PhaseEnd =
+      M->getOrInsertFunction("__kmpc_pulp_prem_memory_phase_end", VoidTy);
+  FunctionCallee DMAIn = M->getOrInsertFunction(
+      "__kmpc_pulp_prem_dma_in", VoidTy, Int8PtrTy, Int8PtrTy, Int32Ty);
+  FunctionCallee DMAOut = M->getOrInsertFunction(
+      "__kmpc_pulp_prem_dma_out", VoidTy, Int8PtrTy, Int8PtrTy, Int32Ty);
+  FunctionCallee DMAWait =
+      M->getOrInsertFunction("__kmpc_pulp_prem_dma_wait", VoidTy);
+
+  // Expand the trip count and where the groups start in the preheader.
+  SCEVExpander Expander(*SE, *DL, "prem");
+  Instruction *PreheaderTerm = Preheader->getTerminator();
+  Value *TripCount =
+      Expander.expandCodeFor(Plan.TripCount, CountTy, PreheaderTerm);
+  SmallVector<Value *, MaxGroups> Starts;
+  for (const AccessGroup &G : Plan.Groups) {
+    const SCEV *S = SE->getAddExpr(G.Start, SE->getConstant(
+                                                IntPtrTy, G.Lo, true));
+    Starts.push_back(Expander.expandCodeFor(S, Int8PtrTy, PreheaderTerm));
+  }
+
+  // The tile loop wraps the original loop: its header enters the memory
+  // phase of a tile and its latch the one of the write-back.
+  BasicBlock *TileHeader = BasicBlock::Create(Ctx, "prem.tile", F, Header);
+  BasicBlock *TileLatch = BasicBlock::Create(Ctx, "prem.writeback", F, Exit);
+  PreheaderTerm->replaceUsesOfWith(Header, TileHeader);
+  Latch->getTerminator()->replaceUsesOfWith(Exit, TileLatch);
+  Exit->replacePhiUsesWith(Latch, TileLatch);
+
+  IRBuilder<> Builder(TileHeader);
+  PHINode *TileStart = Builder.CreatePHI(CountTy, 2, "prem.start");
+  TileStart->addIncoming(ConstantInt::get(CountTy, 0), Preheader);
+
+  // The other recurrences of the loop carry their value from one tile to the
+  // next.
+  for (PHINode &PN : Header->phis()) {
+    if (&PN == Plan.IV) {
+      PN.setIncomingBlock(PN.getBasicBlockIndex(Preheader), TileHeader);
+      continue;
+    }
+    PHINode *Carried =
+        Builder.CreatePHI(PN.getType(), 2, PN.getName() + ".prem");
+    Carried->addIncoming(PN.getIncomingValueForBlock(Preheader), Preheader);
+    Carried->addIncoming(PN.getIncomingValueForBlock(Latch), TileLatch);
+    PN.setIncomingValue(PN.getBasicBlockIndex(Preheader), Carried);
+    PN.setIncomingBlock(PN.getBasicBlockIndex(Preheader), TileHeader);
+  }
+
+  Value *Remaining = Builder.CreateSub(TripCount, TileStart, "prem.remaining");
+  Value *MaxLen = ConstantInt::get(CountTy, Plan.Tile);
+  Value *Len = Builder.CreateSelect(Builder.CreateICmpULT(Remaining, MaxLen),
+                                    Remaining, MaxLen, "prem.len");
+  Value *First = Builder.CreateAdd(Plan.Init, TileStart, "prem.first");
+  Plan.IV->setIncomingValue(Plan.IV->getBasicBlockIndex(TileHeader), First);
+  Plan.Cmp->setOperand(Plan.BoundOp, Builder.CreateAdd(First, Len, "prem.end"));
+
+  // Where the tile of every group starts, in the main memory and in the TCDM,
+  // and its size.
+  SmallVector<Value *, MaxGroups> Srcs, Bases, Bufs, Sizes;
+  for (unsigned I = 0, E = Plan.Groups.size(); I != E; ++I) {
+    const AccessGroup &G = Plan.Groups[I];
+    Value *Skip = Builder.CreateMul(
+        Builder.CreateZExtOrTrunc(TileStart, IntPtrTy),
+        ConstantInt::get(IntPtrTy, G.Stride));
+    Srcs.push_back(Builder.CreateGEP(Builder.getInt8Ty(), Starts[I], Skip,
+                                     "prem.src"));
+    Bases.push_back(Builder.CreatePtrToInt(Srcs.back(), IntPtrTy));
+    Bufs.push_back(Builder.CreateConstInBoundsGEP2_32(
+        Arena->getAllocatedType(), Arena, 0, Offsets[I], "prem.buf"));
+    Value *Size = Builder.CreateAdd(
+        Builder.CreateMul(Builder.CreateZExtOrTrunc(Len, Int32Ty),
+                          Builder.getInt32(G.Stride)),
+        Builder.getInt32(G.Hi - G.Lo - G.Stride), "prem.size");
+    Sizes.push_back(Size);
+  }
+
+  // Prefetch interval: everything the tile reads.
+  Builder.CreateCall(PhaseBegin);
+  for (unsigned I = 0, E = Plan.Groups.size(); I != E; ++I)
+    if (Plan.Groups[I].Read)
+      Builder.CreateCall(DMAIn, {Bufs[I], Srcs[I], Sizes[I]});
+  Builder.CreateCall(DMAWait);
+  Builder.CreateCall(PhaseEnd);
+  Builder.CreateBr(Header);
+
+  // Compute interval: the accesses of the loop go to the TCDM buffers, at the
+  // same offset from the start of the tile.
+  for (unsigned I = 0, E = Plan.Groups.size(); I != E; ++I) {
+    const AccessGroup &G = Plan.Groups[I];
+    for (auto &Access : G.Accesses) {
+      Instruction *Inst = Access.first;
+      Value *Ptr = getLoadStorePointerOperand(Inst);
+      Builder.SetInsertPoint(Inst);
+      Value *Offset = Builder.CreateSub(
+          Builder.CreatePtrToInt(Ptr, IntPtrTy), Bases[I], "prem.offset");
+      Value *Local = Builder.CreatePointerCast(
+          Builder.CreateGEP(Builder.getInt8Ty(), Bufs[I], Offset),
+          Ptr->getType(), "prem.local");
+      // The buffer is aligned, the access is only as aligned as its offset
+      // into the tile.
+      Align LocalAlign = commonAlignment(
+          commonAlignment(Align(BufferAlign), Access.second - G.Lo), G.Stride);
+      if (auto *Load = dyn_cast<LoadInst>(Inst)) {
+        Load->setOperand(Load->getPointerOperandIndex(), Local);
+        Load->setAlignment(std::min(Load->getAlign(), LocalAlign));
+      } else {
+        auto *Store = cast<StoreInst>(Inst);
+        Store->setOperand(Store->getPointerOperandIndex(), Local);
+        Store->setAlignment(std::min(Store->getAlign(), LocalAlign));
+      }
+    }
+  }
+
+  // Write-back interval, then continue with the next tile.
+  Builder.SetInsertPoint(TileLatch);
+  Builder.CreateCall(PhaseBegin);
+  for (unsigned I = 0, E = Plan.Groups.size(); I != E; ++I)
+    if (Plan.Groups[I].Written)
+      Builder.CreateCall(DMAOut, {Srcs[I], Bufs[I], Sizes[I]});
+  Builder.CreateCall(DMAWait);
+  Builder.CreateCall(PhaseEnd);
+  Value *Next = Builder.CreateAdd(TileStart, Len, "prem.next");
+  TileStart->addIncoming(Next, TileLatch);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Next, TripCount, "prem.done"),
+                       Exit, TileHeader);
+
+  // Keep the dominator tree and the loop info up to date for the next loops.
+  DT->applyUpdates({{DominatorTree::Insert, Preheader, TileHeader},
+                    {DominatorTree::Insert, TileHeader, Header},
+                    {DominatorTree::Delete, Preheader, Header},
+                    {DominatorTree::Insert, Latch, TileLatch},
+                    {DominatorTree::Insert, TileLatch, Exit},
+                    {DominatorTree::Insert, TileLatch, TileHeader},
+                    {DominatorTree::Delete, Latch, Exit}});
+  Loop *TileLoop = LI->AllocateLoop();
+  if (Loop *Parent = L->getParentLoop())
+    Parent->replaceChildLoopWith(L, TileLoop);
+  else
+    LI->changeTopLevelLoop(L, TileLoop);
+  TileLoop->addChildLoop(L);
+  TileLoop->addBasicBlockToLoop(TileHeader, *LI);
+  for (BasicBlock *BB : L->blocks())
+    TileLoop->addBlockEntry(BB);
+  TileLoop->addBasicBlockToLoop(TileLatch, *LI);
+
+  SE->forgetLoop(L);
+  ++NumPremLoops;
+  NumPremGroups += Plan.Groups.size();
+  LLVM_DEBUG(dbgs() << "  split into tiles of " << Plan.Tile
+                    << " iterations\n");
+}
+
+INITIALIZE_PASS_BEGIN(PULPPremPhases, DEBUG_TYPE, PULP_PREM_PHASES_NAME, false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_END(PULPPremPhases, DEBUG_TYPE, PULP_PREM_PHASES_NAME, false,
+                    false)
+
+namespace llvm {
+  FunctionPass *createPULPPremPhasesPass() { return new PULPPremPhases(); }
+} // end of namespace llvm
@@ -28,6 +28,7 @@ class MCInst;
 class MCOperand;
 class MachineInstr;
 class MachineOperand;
+class ModulePass;
 class PassRegistry;
 
 void LowerRISCVMachineInstrToMCInst(const MachineInstr *MI, MCInst &OutMI,
@@ -48,8 +49,20 @@ void initializeRISCVExpandPseudoPass(PassRegistry &);
 FunctionPass *createRISCVExpandAtomicPseudoPass();
 void initializeRISCVExpandAtomicPseudoPass(PassRegistry &);
 
-FunctionPass *createRISCVCleanupVSETVLIPass();
-void initializeRISCVCleanupVSETVLIPass(PassRegistry &);
+FunctionPass *createRISCVInsertVSETVLIPass();
+void initializeRISCVInsertVSETVLIPass(PassRegistry &);
+
+FunctionPass *createPULPDotProductPass();
+void initializePULPDotProductPass(PassRegistry &);
+
+FunctionPass *createPULPEventWaitPass();
+void initializePULPEventWaitPass(PassRegistry &);
+
+FunctionPass *createPULPPremPhasesPass();
+void initializePULPPremPhasesPass(PassRegistry &);
+
+FunctionPass *createPULPPostIncrementPass();
+void initializePULPPostIncrementPass(PassRegistry &);
 
 FunctionPass *createRISCVExpandSSRPass();
 void initializeRISCVExpandSSRPass(PassRegistry &);
@@ -60,6 +73,53 @@ void initializeRISCVExpandSDMAPass(PassRegistry &);
 FunctionPass *createSNITCHFrepLoopsPass();
 void initializeSNITCHFrepLoopsPass(PassRegistry &);
 
+FunctionPass *createSNITCHSSRInferencePass();
+void initializeSNITCHSSRInferencePass(PassRegistry &);
+
+FunctionPass *createSNITCHDMACopyIdiomPass();
+void initializeSNITCHDMACopyIdiomPass(PassRegistry &);
+
+FunctionPass *createSNITCHDMADoubleBufferPass();
+void initializeSNITCHDMADoubleBufferPass(PassRegistry &);
+
+FunctionPass *createSNITCHFDotProductPass();
+void initializeSNITCHFDotProductPass(PassRegistry &);
+
+FunctionPass *createSNITCHDMAWaitSinkingPass();
+void initializeSNITCHDMAWaitSinkingPass(PassRegistry &);
+
+FunctionPass *createSNITCHMempoolBarrierPass();
+void initializeSNITCHMempoolBarrierPass(PassRegistry &);
+
+FunctionPass *createSNITCHSSRConfigHoistPass();
+void initializeSNITCHSSRConfigHoistPass(PassRegistry &);
+
+FunctionPass *createSNITCHSSRRegionOptPass();
+void initializeSNITCHSSRRegionOptPass(PassRegistry &);
+
+FunctionPass *createSNITCHFPUSyncSinkingPass();
+void initializeSNITCHFPUSyncSinkingPass(PassRegistry &);
+
+ModulePass *createSNITCHTCDMBankPaddingPass();
+void initializeSNITCHTCDMBankPaddingPass(PassRegistry &);
+
+ModulePass *createSNITCHOpenMPLoweringPass();
+void initializeSNITCHOpenMPLoweringPass(PassRegistry &);
+
+ModulePass *createRISCVSmallDataPlacementPass();
+void initializeRISCVSmallDataPlacementPass(PassRegistry &);
+
+namespace RISCVAS {
+// Address spaces of the MemPool system. Generic pointers may point to any bank
+// of the cluster, which may live in a remote tile.
+enum : unsigned {
+  // The sequential L1 region of the tile the core belongs to.
+  MEMPOOL_SEQ = 1,
+  // The banks of the group the core belongs to.
+  MEMPOOL_GROUP = 2,
+};
+} // namespace RISCVAS
+
 InstructionSelector *createRISCVInstructionSelector(const RISCVTargetMachine &,
                                                     RISCVSubtarget &,
                                                     RISCVRegisterBankInfo &);
@@ -17,6 +17,7 @@
 #include "RISCV.h"
 #include "RISCVTargetMachine.h"
 #include "TargetInfo/RISCVTargetInfo.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
@@ -25,16 +26,27 @@
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCInst.h"
+#include "llvm/MC/MCInstBuilder.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "asm-printer"
 
+STATISTIC(RISCVNumInstrs, "Number of RISC-V instructions emitted");
 STATISTIC(RISCVNumInstrsCompressed,
           "Number of RISC-V Compressed instructions emitted");
+STATISTIC(RISCVNumLoopsAlignedByExpansion,
+          "Number of loop headers aligned by expanding compressed "
+          "instructions");
+
+static cl::opt<bool> DisableLoopAlignExpansion(
+    "riscv-loop-align-expansion-disable", cl::init(false), cl::Hidden,
+    cl::desc("Always pad aligned loop headers with nops instead of expanding "
+             "compressed instructions in front of them"));
 
 namespace {
 class RISCVAsmPrinter : public AsmPrinter {
@@ -70,6 +82,27 @@ public:
 
 private:
   void emitAttributes();
+
+  void LowerPATCHABLE_FUNCTION_ENTER(const MachineInstr &MI);
+  void LowerPATCHABLE_FUNCTION_EXIT(const MachineInstr &MI);
+  void LowerPATCHABLE_TAIL_CALL(const MachineInstr &MI);
+
+  /// Emit an XRay sled, which the runtime in compiler-rt/lib/xray (see
+  /// xray_riscv.cpp) patches into a call to its trampolines.
+  void emitSled(const MachineInstr &MI, SledKind Kind);
+
+  /// Return the size of \p MI in the output, or None if it is not known
+  /// before the object file is laid out and linked. \p Compressed is set
+  /// for compressed instructions which would keep their size if expanded.
+  Optional<unsigned> getEmittedSize(const MachineInstr &MI,
+                                    bool &Compressed) const;
+
+  /// Replace the alignment padding in front of loop headers by expanding
+  /// compressed instructions preceding them.
+  void alignLoopsByExpansion(MachineFunction &MF);
+
+  // Instructions emitted uncompressed to align the following loop header.
+  SmallPtrSet<const MachineInstr *, 8> Uncompressed;
 };
 }
 
@@ -78,6 +111,7 @@ private:
 void RISCVAsmPrinter::EmitToStreamer(MCStreamer &S, const MCInst &Inst) {
   MCInst CInst;
   bool Res = compressInst(CInst, Inst, *STI, OutStreamer->getContext());
+  ++RISCVNumInstrs;
   if (Res)
     ++RISCVNumInstrsCompressed;
   AsmPrinter::EmitToStreamer(*OutStreamer, Res ? CInst : Inst);
@@ -88,12 +122,36 @@ void RISCVAsmPrinter::EmitToStreamer(MCStreamer &S, const MCInst &Inst) {
 #include "RISCVGenMCPseudoLowering.inc"
 
 void RISCVAsmPrinter::emitInstruction(const MachineInstr *MI) {
+  switch (MI->getOpcode()) {
+  default:
+    break;
+  case TargetOpcode::PATCHABLE_FUNCTION_ENTER:
+    LowerPATCHABLE_FUNCTION_ENTER(*MI);
+    return;
+  case TargetOpcode::PATCHABLE_FUNCTION_EXIT:
+    LowerPATCHABLE_FUNCTION_EXIT(*MI);
+    return;
+  case TargetOpcode::PATCHABLE_TAIL_CALL:
+    LowerPATCHABLE_TAIL_CALL(*MI);
+    return;
+  }
+
   // Do any auto-generated pseudo lowerings.
   if (emitPseudoExpansionLowering(*OutStreamer, MI))
     return;
 
   MCInst TmpInst;
   LowerRISCVMachineInstrToMCInst(MI, TmpInst, *this);
+  if (Uncompressed.count(MI)) {
+    // The assembler would compress the instruction again.
+    RISCVTargetStreamer &RTS =
+        static_cast<RISCVTargetStreamer &>(*OutStreamer->getTargetStreamer());
+    RTS.emitDirectiveOptionPush();
+    RTS.emitDirectiveOptionNoRVC();
+    AsmPrinter::EmitToStreamer(*OutStreamer, TmpInst);
+    RTS.emitDirectiveOptionPop();
+    return;
+  }
   EmitToStreamer(*OutStreamer, TmpInst);
 }
 
@@ -173,10 +231,155 @@ bool RISCVAsmPrinter::runOnMachineFunction(MachineFunction &MF) {
   STI = &NewSTI;
 
   SetupMachineFunction(MF);
+  alignLoopsByExpansion(MF);
   emitFunctionBody();
+
+  // Emit the XRay table for this function.
+  emitXRayTable();
   return false;
 }
 
+void RISCVAsmPrinter::LowerPATCHABLE_FUNCTION_ENTER(const MachineInstr &MI) {
+  emitSled(MI, SledKind::FUNCTION_ENTER);
+}
+
+void RISCVAsmPrinter::LowerPATCHABLE_FUNCTION_EXIT(const MachineInstr &MI) {
+  emitSled(MI, SledKind::FUNCTION_EXIT);
+}
+
+void RISCVAsmPrinter::LowerPATCHABLE_TAIL_CALL(const MachineInstr &MI) {
+  emitSled(MI, SledKind::TAIL_CALL);
+}
+
+void RISCVAsmPrinter::emitSled(const MachineInstr &MI, SledKind Kind) {
+  // We want to emit the following pattern, with every instruction 4 bytes
+  // long so that the runtime can patch it a word at a time:
+  //
+  // .Lxray_sled_N:
+  //   ALIGN
+  //   J .tmpN
+  //   10 (RV32) or 14 (RV64) NOP instructions
+  // .tmpN
+  //
+  // When the sled is enabled, the runtime overwrites the NOPs with code that
+  // saves ra and a0 on the stack, loads the address of the trampoline and the
+  // function ID, calls the trampoline and restores ra and a0, and then
+  // atomically replaces the jump with the first instruction of that code
+  // (RV64 needs four more instructions to materialize a 64-bit address).
+  const unsigned NoopsInSledCount =
+      MI.getMF()->getSubtarget<RISCVSubtarget>().is64Bit() ? 14 : 10;
+
+  OutStreamer->emitCodeAlignment(4);
+  MCSymbol *CurSled = OutContext.createTempSymbol("xray_sled_", true);
+  OutStreamer->emitLabel(CurSled);
+  MCSymbol *Target = OutContext.createTempSymbol();
+
+  // The assembler must not compress any of the sled.
+  RISCVTargetStreamer &RTS =
+      static_cast<RISCVTargetStreamer &>(*OutStreamer->getTargetStreamer());
+  RTS.emitDirectiveOptionPush();
+  RTS.emitDirectiveOptionNoRVC();
+  const MCExpr *TargetExpr = MCSymbolRefExpr::create(Target, OutContext);
+  AsmPrinter::EmitToStreamer(
+      *OutStreamer,
+      MCInstBuilder(RISCV::JAL).addReg(RISCV::X0).addExpr(TargetExpr));
+  for (unsigned I = 0; I < NoopsInSledCount; ++I)
+    AsmPrinter::EmitToStreamer(*OutStreamer, MCInstBuilder(RISCV::ADDI)
+                                                 .addReg(RISCV::X0)
+                                                 .addReg(RISCV::X0)
+                                                 .addImm(0));
+  RTS.emitDirectiveOptionPop();
+
+  OutStreamer->emitLabel(Target);
+  recordSled(CurSled, MI, Kind, 2);
+}
+
+Optional<unsigned>
+RISCVAsmPrinter::getEmittedSize(const MachineInstr &MI,
+                                bool &Compressed) const {
+  Compressed = false;
+  if (MI.isMetaInstruction())
+    return 0;
+  // Pseudos are expanded by the tablegen'erated lowering or by the code
+  // emitter, inline assembly is opaque.
+  if (MI.isPseudo() || MI.isInlineAsm())
+    return None;
+
+  bool HasSymbol = false;
+  for (const MachineOperand &MO : MI.operands()) {
+    if (MO.isReg() || MO.isImm())
+      continue;
+    // The linker may delete the instruction or its neighbour.
+    if (MO.getTargetFlags() != RISCVII::MO_None &&
+        MI.getMF()->getSubtarget<RISCVSubtarget>().enableLinkerRelax())
+      return None;
+    HasSymbol = true;
+  }
+
+  MCInst Inst, CInst;
+  LowerRISCVMachineInstrToMCInst(&MI, Inst, *this);
+  if (!compressInst(CInst, Inst, *STI, OutStreamer->getContext()))
+    return 4;
+  // The assembler relaxes compressed branches whose target is out of range.
+  if (HasSymbol)
+    return None;
+  Compressed = true;
+  return 2;
+}
+
+void RISCVAsmPrinter::alignLoopsByExpansion(MachineFunction &MF) {
+  Uncompressed.clear();
+  if (DisableLoopAlignExpansion ||
+      !MF.getSubtarget<RISCVSubtarget>().hasStdExtC() ||
+      MF.getFunction().hasFnAttribute("patchable-function-entry"))
+    return;
+
+  // The offset of the current instruction from the last point of known
+  // alignment, either the function entry or a block aligned with padding. It
+  // is unknown after instructions whose size is only fixed by the assembler
+  // or the linker.
+  Align Anchor = MF.getAlignment();
+  uint64_t Offset = 0;
+  bool Known = true;
+  // The compressed instructions since the last aligned block.
+  SmallVector<const MachineInstr *, 16> Compressed;
+  for (MachineBasicBlock &MBB : MF) {
+    Align Alignment = MBB.getAlignment();
+    if (Alignment > Align(2)) {
+      uint64_t Padding = offsetToAlignment(Offset, Alignment);
+      if (Known && Anchor >= Alignment && Padding / 2 <= Compressed.size()) {
+        // Expanding the instructions closest to the header keeps the
+        // expansion out of the loops laid out before it.
+        for (unsigned I = 0; I != Padding / 2; ++I)
+          Uncompressed.insert(Compressed[Compressed.size() - 1 - I]);
+        Offset += Padding;
+        MBB.setAlignment(Align(1));
+        if (Padding)
+          ++RISCVNumLoopsAlignedByExpansion;
+      } else {
+        Anchor = Alignment;
+        Offset = 0;
+        Known = true;
+      }
+      Compressed.clear();
+    }
+
+    for (const MachineInstr &MI : MBB.instrs()) {
+      if (!Known)
+        break;
+      bool IsCompressed;
+      Optional<unsigned> Size = getEmittedSize(MI, IsCompressed);
+      if (!Size) {
+        Known = false;
+        break;
+      }
+      Offset += *Size;
+      if (IsCompressed)
+        Compressed.push_back(&MI);
+    }
+  }
+}
+
 void RISCVAsmPrinter::emitStartOfAsmFile(Module &M) {
   if (TM.getTargetTriple().isOSBinFormatELF())
     emitAttributes();
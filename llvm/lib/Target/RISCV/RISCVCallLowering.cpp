@@ -9,27 +9,320 @@
 /// \file
 /// This file implements the lowering of LLVM calls to machine code calls for
 /// GlobalISel.
+///
+/// Argument locations are assigned by the same CC_RISCV routine as in
+/// SelectionDAG. Only values which the calling convention places directly in
+/// registers or stack slots are supported; aggregates, variadic functions and
+/// values passed indirectly or split across register kinds make the function
+/// fall back to SelectionDAG.
 //
 //===----------------------------------------------------------------------===//
 
 #include "RISCVCallLowering.h"
 #include "RISCVISelLowering.h"
+#include "RISCVSubtarget.h"
+#include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/GlobalISel/MachineIRBuilder.h"
+#include "llvm/CodeGen/GlobalISel/Utils.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
 
 using namespace llvm;
 
 RISCVCallLowering::RISCVCallLowering(const RISCVTargetLowering &TLI)
     : CallLowering(&TLI) {}
 
+static bool isSupportedType(const DataLayout &DL, const RISCVSubtarget &ST,
+                            const RISCVTargetLowering &TLI, Type *T) {
+  EVT VT = TLI.getValueType(DL, T, true);
+  if (!VT.isSimple())
+    return false;
+
+  unsigned XLen = ST.getXLen();
+  if (VT.isVector())
+    return ST.hasPULPExtV2() && (VT == MVT::v2i16 || VT == MVT::v4i8);
+  if (VT.isInteger())
+    return VT.getSizeInBits() <= 2 * XLen;
+  if (VT == MVT::f32)
+    return true;
+  // f64 is only supported in FPRs, see checkFPArgs.
+  if (VT == MVT::f64)
+    return ST.hasStdExtD();
+  return false;
+}
+
+/// Return true if all floating point values in \p Tys can be passed the way
+/// GlobalISel lowers them. An f64 given to GPRs by a soft-float ABI or when
+/// the argument FPRs are exhausted would need to be split, which is left to
+/// SelectionDAG.
+static bool checkFPArgs(const RISCVSubtarget &ST, ArrayRef<Type *> Tys) {
+  unsigned NumFP = 0;
+  bool HasF64 = false;
+  for (Type *T : Tys) {
+    if (T->isFloatingPointTy())
+      ++NumFP;
+    HasF64 |= T->isDoubleTy();
+  }
+  if (!HasF64)
+    return true;
+  RISCVABI::ABI ABI = ST.getTargetABI();
+  if (ABI != RISCVABI::ABI_ILP32D && ABI != RISCVABI::ABI_LP64D)
+    return false;
+  return NumFP <= 8;
+}
+
+/// Replace the IR type of \p OrigArg by the type of its value, so that
+/// pointers are assigned like XLen integers.
+static void splitToValueTypes(const CallLowering::ArgInfo &OrigArg,
+                              SmallVectorImpl<CallLowering::ArgInfo> &SplitArgs,
+                              const RISCVTargetLowering &TLI,
+                              MachineFunction &MF) {
+  LLVMContext &Ctx = OrigArg.Ty->getContext();
+  const DataLayout &DL = MF.getDataLayout();
+  EVT VT = TLI.getValueType(DL, OrigArg.Ty, true);
+  ISD::ArgFlagsTy Flags = OrigArg.Flags[0];
+  Flags.setOrigAlign(DL.getABITypeAlign(OrigArg.Ty));
+  SplitArgs.emplace_back(OrigArg.Regs[0], VT.getTypeForEVT(Ctx), Flags,
+                         OrigArg.IsFixed);
+}
+
+/// Assign a location to a value with CC_RISCV. Integers narrower than XLen are
+/// promoted beforehand, as SelectionDAG does during type legalization, while
+/// wider ones are rejected so that CallLowering splits them into XLen parts.
+static bool assignRISCVArg(const RISCVTargetLowering &TLI, unsigned ValNo,
+                           MVT ValVT, MVT LocVT, CCValAssign::LocInfo LocInfo,
+                           const CallLowering::ArgInfo &Info,
+                           ISD::ArgFlagsTy Flags, CCState &State, bool IsRet) {
+  MachineFunction &MF = State.getMachineFunction();
+  const DataLayout &DL = MF.getDataLayout();
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  unsigned XLen = ST.getXLen();
+
+  if (ValVT.isScalarInteger()) {
+    if (ValVT.getSizeInBits() > XLen)
+      return true;
+    if (ValVT.getSizeInBits() < XLen) {
+      LocVT = MVT::getIntegerVT(XLen);
+      if (Flags.isSExt())
+        LocInfo = CCValAssign::SExt;
+      else if (Flags.isZExt())
+        LocInfo = CCValAssign::ZExt;
+      else
+        LocInfo = CCValAssign::AExt;
+    }
+  }
+
+  return RISCV::CC_RISCV(DL, ST.getTargetABI(), ValNo, ValVT, LocVT, LocInfo,
+                         Flags, State, Info.IsFixed, IsRet, Info.Ty, TLI,
+                         /*FirstMaskArgument=*/None);
+}
+
+namespace {
+
+/// Helper class for values going out through an ABI boundary (used for handling
+/// function return values and call parameters).
+struct RISCVOutgoingValueHandler : public CallLowering::OutgoingValueHandler {
+  RISCVOutgoingValueHandler(MachineIRBuilder &MIRBuilder,
+                            MachineRegisterInfo &MRI, MachineInstrBuilder &MIB,
+                            const RISCVTargetLowering &TLI, bool IsRet)
+      : OutgoingValueHandler(MIRBuilder, MRI, nullptr), MIB(MIB), TLI(TLI),
+        IsRet(IsRet) {}
+
+  Register getStackAddress(uint64_t Size, int64_t Offset,
+                           MachinePointerInfo &MPO) override {
+    MachineFunction &MF = MIRBuilder.getMF();
+    unsigned XLen = MF.getSubtarget<RISCVSubtarget>().getXLen();
+    LLT p0 = LLT::pointer(0, XLen);
+    LLT sXLen = LLT::scalar(XLen);
+    auto SPReg = MIRBuilder.buildCopy(p0, Register(RISCV::X2));
+    auto OffsetReg = MIRBuilder.buildConstant(sXLen, Offset);
+    auto AddrReg = MIRBuilder.buildPtrAdd(p0, SPReg, OffsetReg);
+
+    MPO = MachinePointerInfo::getStack(MF, Offset);
+    return AddrReg.getReg(0);
+  }
+
+  void assignValueToReg(Register ValVReg, Register PhysReg,
+                        CCValAssign &VA) override {
+    assert(VA.isRegLoc() && "Value shouldn't be assigned to reg");
+    assert(VA.getLocReg() == PhysReg && "Assigning to the wrong reg?");
+
+    Register ExtReg = extendRegister(ValVReg, VA);
+    MIRBuilder.buildCopy(PhysReg, ExtReg);
+    MIB.addUse(PhysReg, RegState::Implicit);
+  }
+
+  void assignValueToAddress(Register ValVReg, Register Addr, uint64_t Size,
+                            MachinePointerInfo &MPO, CCValAssign &VA) override {
+    MachineFunction &MF = MIRBuilder.getMF();
+    Register ExtReg = extendRegister(ValVReg, VA);
+    uint64_t StoreSize = MRI.getType(ExtReg).getSizeInBytes();
+    auto MMO = MF.getMachineMemOperand(MPO, MachineMemOperand::MOStore,
+                                       StoreSize, inferAlignFromPtrInfo(MF, MPO));
+    MIRBuilder.buildStore(ExtReg, Addr, *MMO);
+  }
+
+  bool assignArg(unsigned ValNo, MVT ValVT, MVT LocVT,
+                 CCValAssign::LocInfo LocInfo,
+                 const CallLowering::ArgInfo &Info, ISD::ArgFlagsTy Flags,
+                 CCState &State) override {
+    if (assignRISCVArg(TLI, ValNo, ValVT, LocVT, LocInfo, Info, Flags, State,
+                       IsRet))
+      return true;
+
+    StackSize =
+        std::max(StackSize, static_cast<uint64_t>(State.getNextStackOffset()));
+    return false;
+  }
+
+  MachineInstrBuilder &MIB;
+  const RISCVTargetLowering &TLI;
+  bool IsRet;
+  uint64_t StackSize = 0;
+};
+
+/// Helper class for values coming in through an ABI boundary (used for handling
+/// formal arguments and call return values).
+struct RISCVIncomingValueHandler : public CallLowering::IncomingValueHandler {
+  RISCVIncomingValueHandler(MachineIRBuilder &MIRBuilder,
+                            MachineRegisterInfo &MRI,
+                            const RISCVTargetLowering &TLI, bool IsRet)
+      : IncomingValueHandler(MIRBuilder, MRI, nullptr), TLI(TLI),
+        IsRet(IsRet) {}
+
+  Register getStackAddress(uint64_t Size, int64_t Offset,
+                           MachinePointerInfo &MPO) override {
+    MachineFunction &MF = MIRBuilder.getMF();
+    unsigned XLen = MF.getSubtarget<RISCVSubtarget>().getXLen();
+    auto &MFI = MF.getFrameInfo();
+
+    int FI = MFI.CreateFixedObject(Size, Offset, true);
+    MPO = MachinePointerInfo::getFixedStack(MF, FI);
+    return MIRBuilder.buildFrameIndex(LLT::pointer(0, XLen), FI).getReg(0);
+  }
+
+  void assignValueToAddress(Register ValVReg, Register Addr, uint64_t Size,
+                            MachinePointerInfo &MPO, CCValAssign &VA) override {
+    MachineFunction &MF = MIRBuilder.getMF();
+    LLT ValTy = MRI.getType(ValVReg);
+    LLT LocTy{VA.getLocVT()};
+
+    if (ValTy.getSizeInBits() < LocTy.getSizeInBits()) {
+      // The caller stored the promoted value; load all of it and truncate.
+      auto MMO = MF.getMachineMemOperand(MPO, MachineMemOperand::MOLoad,
+                                         LocTy.getSizeInBytes(),
+                                         inferAlignFromPtrInfo(MF, MPO));
+      auto Load = MIRBuilder.buildLoad(LocTy, Addr, *MMO);
+      MIRBuilder.buildTrunc(ValVReg, Load);
+      return;
+    }
+
+    auto MMO = MF.getMachineMemOperand(MPO, MachineMemOperand::MOLoad, Size,
+                                       inferAlignFromPtrInfo(MF, MPO));
+    MIRBuilder.buildLoad(ValVReg, Addr, *MMO);
+  }
+
+  void assignValueToReg(Register ValVReg, Register PhysReg,
+                        CCValAssign &VA) override {
+    assert(VA.isRegLoc() && "Value shouldn't be assigned to reg");
+    assert(VA.getLocReg() == PhysReg && "Assigning to the wrong reg?");
+
+    markPhysRegUsed(PhysReg);
+
+    LLT ValTy = MRI.getType(ValVReg);
+    uint64_t LocSize = VA.getLocVT().getSizeInBits();
+    if (ValTy.getSizeInBits() == LocSize) {
+      MIRBuilder.buildCopy(ValVReg, PhysReg);
+      return;
+    }
+
+    // We cannot create a truncating copy, nor a trunc of a physical register.
+    assert(ValTy.getSizeInBits() < LocSize && "Extensions not supported");
+    auto Copy = MIRBuilder.buildCopy(LLT::scalar(LocSize), PhysReg);
+    MIRBuilder.buildTrunc(ValVReg, Copy);
+  }
+
+  bool assignArg(unsigned ValNo, MVT ValVT, MVT LocVT,
+                 CCValAssign::LocInfo LocInfo,
+                 const CallLowering::ArgInfo &Info, ISD::ArgFlagsTy Flags,
+                 CCState &State) override {
+    return assignRISCVArg(TLI, ValNo, ValVT, LocVT, LocInfo, Info, Flags, State,
+                          IsRet);
+  }
+
+  /// Marking a physical register as used is different between formal
+  /// parameters, where it's a basic block live-in, and call returns, where it's
+  /// an implicit-def of the call instruction.
+  virtual void markPhysRegUsed(MCRegister PhysReg) = 0;
+
+  const RISCVTargetLowering &TLI;
+  bool IsRet;
+};
+
+struct FormalArgHandler : public RISCVIncomingValueHandler {
+  FormalArgHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                   const RISCVTargetLowering &TLI)
+      : RISCVIncomingValueHandler(MIRBuilder, MRI, TLI, /*IsRet=*/false) {}
+
+  void markPhysRegUsed(MCRegister PhysReg) override {
+    MIRBuilder.getMRI()->addLiveIn(PhysReg);
+    MIRBuilder.getMBB().addLiveIn(PhysReg);
+  }
+};
+
+struct CallReturnHandler : public RISCVIncomingValueHandler {
+  CallReturnHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                    MachineInstrBuilder &MIB, const RISCVTargetLowering &TLI)
+      : RISCVIncomingValueHandler(MIRBuilder, MRI, TLI, /*IsRet=*/true),
+        MIB(MIB) {}
+
+  void markPhysRegUsed(MCRegister PhysReg) override {
+    MIB.addDef(PhysReg, RegState::Implicit);
+  }
+
+  MachineInstrBuilder &MIB;
+};
+
+} // end anonymous namespace
+
+/// GlobalISel only has patterns for the default hardware mode, in which XLenVT
+/// is i32, so RV64 functions are left to SelectionDAG.
+static bool isSupportedFunction(const MachineFunction &MF) {
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  return !ST.is64Bit() && !MF.getFunction().hasFnAttribute("interrupt");
+}
+
 bool RISCVCallLowering::lowerReturn(MachineIRBuilder &MIRBuilder,
                                     const Value *Val, ArrayRef<Register> VRegs,
                                     FunctionLoweringInfo &FLI) const {
+  assert(!Val == VRegs.empty() && "Return value without a vreg");
+  MachineFunction &MF = MIRBuilder.getMF();
+  if (!isSupportedFunction(MF))
+    return false;
 
   MachineInstrBuilder Ret = MIRBuilder.buildInstrNoInsert(RISCV::PseudoRET);
 
-  if (Val != nullptr) {
-    return false;
+  if (Val) {
+    const Function &F = MF.getFunction();
+    const DataLayout &DL = MF.getDataLayout();
+    const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+    const RISCVTargetLowering &TLI = *getTLI<RISCVTargetLowering>();
+    if (VRegs.size() != 1 || !isSupportedType(DL, ST, TLI, Val->getType()) ||
+        !checkFPArgs(ST, Val->getType()))
+      return false;
+
+    ArgInfo OrigRetInfo(VRegs, Val->getType());
+    setArgFlags(OrigRetInfo, AttributeList::ReturnIndex, DL, F);
+
+    SmallVector<ArgInfo, 4> SplitRetInfos;
+    splitToValueTypes(OrigRetInfo, SplitRetInfos, TLI, MF);
+
+    RISCVOutgoingValueHandler RetHandler(MIRBuilder, MF.getRegInfo(), Ret, TLI,
+                                         /*IsRet=*/true);
+    if (!handleAssignments(MIRBuilder, SplitRetInfos, RetHandler))
+      return false;
   }
+
   MIRBuilder.insertInstr(Ret);
   return true;
 }
@@ -38,14 +331,143 @@ bool RISCVCallLowering::lowerFormalArguments(MachineIRBuilder &MIRBuilder,
                                              const Function &F,
                                              ArrayRef<ArrayRef<Register>> VRegs,
                                              FunctionLoweringInfo &FLI) const {
+  MachineFunction &MF = MIRBuilder.getMF();
+  if (!isSupportedFunction(MF))
+    return false;
 
+  // Quick exit if there aren't any args
   if (F.arg_empty())
     return true;
 
-  return false;
+  if (F.isVarArg())
+    return false;
+
+  const DataLayout &DL = MF.getDataLayout();
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  const RISCVTargetLowering &TLI = *getTLI<RISCVTargetLowering>();
+
+  SmallVector<Type *, 8> Tys;
+  for (auto &Arg : F.args()) {
+    if (!isSupportedType(DL, ST, TLI, Arg.getType()))
+      return false;
+    if (Arg.hasPassPointeeByValueCopyAttr() || Arg.hasAttribute(Attribute::Nest))
+      return false;
+    Tys.push_back(Arg.getType());
+  }
+  if (!checkFPArgs(ST, Tys))
+    return false;
+
+  SmallVector<ArgInfo, 8> SplitArgInfos;
+  unsigned Idx = 0;
+  for (auto &Arg : F.args()) {
+    if (VRegs[Idx].size() != 1)
+      return false;
+    ArgInfo OrigArgInfo(VRegs[Idx], Arg.getType());
+    setArgFlags(OrigArgInfo, Idx + AttributeList::FirstArgIndex, DL, F);
+    splitToValueTypes(OrigArgInfo, SplitArgInfos, TLI, MF);
+    ++Idx;
+  }
+
+  MachineBasicBlock &MBB = MIRBuilder.getMBB();
+  if (!MBB.empty())
+    MIRBuilder.setInstr(*MBB.begin());
+
+  FormalArgHandler ArgHandler(MIRBuilder, MF.getRegInfo(), TLI);
+  if (!handleAssignments(MIRBuilder, SplitArgInfos, ArgHandler))
+    return false;
+
+  // Move back to the end of the basic block.
+  MIRBuilder.setMBB(MBB);
+  return true;
 }
 
 bool RISCVCallLowering::lowerCall(MachineIRBuilder &MIRBuilder,
                                   CallLoweringInfo &Info) const {
-  return false;
+  MachineFunction &MF = MIRBuilder.getMF();
+  if (!isSupportedFunction(MF))
+    return false;
+
+  if (Info.IsVarArg || Info.IsMustTailCall || Info.SwiftErrorVReg)
+    return false;
+
+  const DataLayout &DL = MF.getDataLayout();
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  const RISCVTargetLowering &TLI = *getTLI<RISCVTargetLowering>();
+  const TargetRegisterInfo *TRI = ST.getRegisterInfo();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+
+  SmallVector<Type *, 8> Tys;
+  for (auto &Arg : Info.OrigArgs) {
+    if (Arg.Regs.size() != 1 || !isSupportedType(DL, ST, TLI, Arg.Ty))
+      return false;
+    if (Arg.Flags[0].isByVal() || Arg.Flags[0].isNest())
+      return false;
+    Tys.push_back(Arg.Ty);
+  }
+  if (!checkFPArgs(ST, Tys))
+    return false;
+
+  bool HasRet = !Info.OrigRet.Ty->isVoidTy();
+  if (HasRet && (Info.OrigRet.Regs.size() != 1 ||
+                 !isSupportedType(DL, ST, TLI, Info.OrigRet.Ty) ||
+                 !checkFPArgs(ST, Info.OrigRet.Ty)))
+    return false;
+
+  auto CallSeqStart = MIRBuilder.buildInstr(RISCV::ADJCALLSTACKDOWN);
+
+  // Create the call instruction so we can add the implicit uses of arg
+  // registers, but don't insert it yet.
+  MachineInstrBuilder MIB;
+  if (Info.Callee.isReg()) {
+    MIB = MIRBuilder.buildInstrNoInsert(RISCV::PseudoCALLIndirect);
+    MIB.add(Info.Callee);
+    MIB->getOperand(0).setReg(constrainOperandRegClass(
+        MF, *TRI, MRI, *ST.getInstrInfo(), *ST.getRegBankInfo(),
+        *MIB.getInstr(), MIB->getDesc(), Info.Callee, 0));
+  } else {
+    const Module *M = MF.getFunction().getParent();
+    const GlobalValue *GV =
+        Info.Callee.isGlobal() ? Info.Callee.getGlobal() : nullptr;
+    unsigned OpFlags = RISCVII::MO_CALL;
+    if (!MF.getTarget().shouldAssumeDSOLocal(*M, GV))
+      OpFlags = RISCVII::MO_PLT;
+    MIB = MIRBuilder.buildInstrNoInsert(RISCV::PseudoCALL);
+    if (GV)
+      MIB.addGlobalAddress(GV, Info.Callee.getOffset(), OpFlags);
+    else if (Info.Callee.isSymbol())
+      MIB.addExternalSymbol(Info.Callee.getSymbolName(), OpFlags);
+    else
+      return false;
+  }
+
+  MIB.addRegMask(TRI->getCallPreservedMask(MF, Info.CallConv));
+
+  SmallVector<ArgInfo, 8> ArgInfos;
+  for (auto &Arg : Info.OrigArgs)
+    splitToValueTypes(Arg, ArgInfos, TLI, MF);
+
+  RISCVOutgoingValueHandler ArgHandler(MIRBuilder, MRI, MIB, TLI,
+                                       /*IsRet=*/false);
+  if (!handleAssignments(MIRBuilder, ArgInfos, ArgHandler))
+    return false;
+
+  // Now we can add the actual call instruction to the correct basic block.
+  MIRBuilder.insertInstr(MIB);
+
+  if (HasRet) {
+    ArgInfos.clear();
+    splitToValueTypes(Info.OrigRet, ArgInfos, TLI, MF);
+    CallReturnHandler RetHandler(MIRBuilder, MRI, MIB, TLI);
+    if (!handleAssignments(MIRBuilder, ArgInfos, RetHandler))
+      return false;
+  }
+
+  // We now know the size of the stack - update the ADJCALLSTACKDOWN
+  // accordingly.
+  CallSeqStart.addImm(ArgHandler.StackSize).addImm(0);
+  MIRBuilder.buildInstr(RISCV::ADJCALLSTACKUP)
+      .addImm(ArgHandler.StackSize)
+      .addImm(0);
+
+  return true;
 }
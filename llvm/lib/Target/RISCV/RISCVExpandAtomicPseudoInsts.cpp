@@ -338,6 +338,16 @@ static void doMaskedAtomicBinOpExpansion(
       .addMBB(LoopMBB);
 }
 
+// Keep the blocks inserted after MBB in its section. The last of them ends the
+// section if MBB did.
+static void assignSection(MachineBasicBlock &MBB,
+                          ArrayRef<MachineBasicBlock *> NewMBBs) {
+  for (MachineBasicBlock *NewMBB : NewMBBs)
+    NewMBB->setSectionID(MBB.getSectionID());
+  NewMBBs.back()->setIsEndSection(MBB.isEndSection());
+  MBB.setIsEndSection(false);
+}
+
 bool RISCVExpandAtomicPseudo::expandAtomicBinOp(
     MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
     AtomicRMWInst::BinOp BinOp, bool IsMasked, int Width,
@@ -352,6 +362,7 @@ bool RISCVExpandAtomicPseudo::expandAtomicBinOp(
   // Insert new MBBs.
   MF->insert(++MBB.getIterator(), LoopMBB);
   MF->insert(++LoopMBB->getIterator(), DoneMBB);
+  assignSection(MBB, {LoopMBB, DoneMBB});
 
   // Set up successors and transfer remaining instructions to DoneMBB.
   LoopMBB->addSuccessor(LoopMBB);
@@ -408,6 +419,7 @@ bool RISCVExpandAtomicPseudo::expandAtomicMinMaxOp(
   MF->insert(++LoopHeadMBB->getIterator(), LoopIfBodyMBB);
   MF->insert(++LoopIfBodyMBB->getIterator(), LoopTailMBB);
   MF->insert(++LoopTailMBB->getIterator(), DoneMBB);
+  assignSection(MBB, {LoopHeadMBB, LoopIfBodyMBB, LoopTailMBB, DoneMBB});
 
   // Set up successors and transfer remaining instructions to DoneMBB.
   LoopHeadMBB->addSuccessor(LoopIfBodyMBB);
@@ -522,6 +534,7 @@ bool RISCVExpandAtomicPseudo::expandAtomicCmpXchg(
   MF->insert(++MBB.getIterator(), LoopHeadMBB);
   MF->insert(++LoopHeadMBB->getIterator(), LoopTailMBB);
   MF->insert(++LoopTailMBB->getIterator(), DoneMBB);
+  assignSection(MBB, {LoopHeadMBB, LoopTailMBB, DoneMBB});
 
   // Set up successors and transfer remaining instructions to DoneMBB.
   LoopHeadMBB->addSuccessor(LoopTailMBB);
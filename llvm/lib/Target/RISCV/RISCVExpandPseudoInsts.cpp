@@ -146,6 +146,9 @@ bool RISCVExpandPseudo::expandAuipcInstPair(
   NewMBB->setLabelMustBeEmitted();
 
   MF->insert(++MBB.getIterator(), NewMBB);
+  NewMBB->setSectionID(MBB.getSectionID());
+  NewMBB->setIsEndSection(MBB.isEndSection());
+  MBB.setIsEndSection(false);
 
   BuildMI(NewMBB, DL, TII->get(RISCV::AUIPC), DestReg)
       .addDisp(Symbol, 0, FlagsHi);
@@ -10,6 +10,10 @@
 // This file contains a pass that expands SDMA pseudo instructions into target
 // instructions. This pass should be run before register allocation
 //
+// The DMA source, destination, stride and repetition registers keep their
+// value across transfers. After the expansion, writes which store the same
+// virtual registers as the previous write on all paths are removed.
+//
 //===----------------------------------------------------------------------===//
 
 #include "RISCV.h"
@@ -22,6 +26,8 @@
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/LowLevelType.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -31,8 +37,40 @@ using namespace llvm;
 
 #define RISCV_EXPAND_SDMA_NAME "RISCV SDMA pseudo instruction expansion pass"
 
+static cl::opt<bool>
+    SDMANoConfigCache("sdma-nocache", cl::Hidden, cl::init(false),
+                      cl::desc("Do not remove redundant writes of the DMA "
+                               "configuration registers"));
+
 namespace {
 
+/// Registers last written to the DMA configuration registers on all paths.
+struct DMAConfig {
+  enum { Src, Dst, Str, Rep, NumRegs };
+  std::pair<Register, Register> Regs[NumRegs];
+
+  bool operator==(const DMAConfig &O) const {
+    return std::equal(std::begin(Regs), std::end(Regs), std::begin(O.Regs));
+  }
+  bool operator!=(const DMAConfig &O) const { return !(*this == O); }
+
+  void meet(const DMAConfig &O) {
+    for (unsigned I = 0; I != NumRegs; ++I)
+      if (Regs[I] != O.Regs[I])
+        Regs[I] = {};
+  }
+  void clear() {
+    for (auto &R : Regs)
+      R = {};
+  }
+  /// Forget the values which depend on the redefined register \p Reg.
+  void clobber(Register Reg) {
+    for (auto &R : Regs)
+      if (R.first == Reg || R.second == Reg)
+        R = {};
+  }
+};
+
 class RISCVExpandSDMA : public MachineFunctionPass {
 public:
   const RISCVInstrInfo *TII;
@@ -60,6 +98,12 @@ private:
   bool expandWaitForIdle(MachineBasicBlock &MBB,
                          MachineBasicBlock::iterator MBBI,
                          MachineBasicBlock::iterator &NextMBBI);
+  bool expandWait(MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
+                  MachineBasicBlock::iterator &NextMBBI);
+  bool expandThreed(MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
+                    MachineBasicBlock::iterator &NextMBBI);
+  bool removeRedundantConfig(MachineFunction &MF);
+  bool updateConfig(MachineBasicBlock &MBB, DMAConfig &Config, bool Remove);
 };
 
 char RISCVExpandSDMA::ID = 0;
@@ -73,6 +117,9 @@ bool RISCVExpandSDMA::runOnMachineFunction(MachineFunction &MF) {
   bool Modified = false;
   for (auto &MBB : MF)
     Modified |= expandMBB(MBB);
+  if (Modified && !SDMANoConfigCache &&
+      MF.getTarget().getOptLevel() != CodeGenOpt::None)
+    removeRedundantConfig(MF);
   return Modified;
 }
 
@@ -100,10 +147,14 @@ bool RISCVExpandSDMA::expandMI(MachineBasicBlock &MBB,
     return expandOned(MBB, MBBI);
   case RISCV::PseudoSDMATwod:
     return expandTwod(MBB, MBBI);
+  case RISCV::PseudoSDMAThreed:
+    return expandThreed(MBB, MBBI, NextMBBI);
   case RISCV::PseudoSDMAStat:
     return expandStat(MBB, MBBI);
   case RISCV::PseudoSDMAWaitForIdle:
     return expandWaitForIdle(MBB, MBBI, NextMBBI);
+  case RISCV::PseudoSDMAWait:
+    return expandWait(MBB, MBBI, NextMBBI);
   }
 
   return false;
@@ -191,6 +242,197 @@ bool RISCVExpandSDMA::expandTwod(MachineBasicBlock &MBB,
   return true;
 }
 
+bool RISCVExpandSDMA::expandThreed(MachineBasicBlock &MBB,
+                                   MachineBasicBlock::iterator MBBI,
+                                   MachineBasicBlock::iterator &NextMBBI) {
+  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  MachineInstr &MI = *MBBI;
+  MachineFunction *MF = MBB.getParent();
+  DebugLoc DL = MI.getDebugLoc();
+
+  // expected arguments:
+  // 0 -> rd: destination register for the transfer ID
+  // 1/2 -> source pointer hi/lo in registers
+  // 3/4 -> destination pointer hi/lo in registers
+  // 5 -> size: transfer size stored in a register
+  // 6 -> source stride
+  // 7 -> destination stride
+  // 8 -> n reps
+  // 9 -> outer source stride
+  // 10 -> outer destination stride
+  // 11 -> outer n reps, at least 1
+  // 12 -> cfg: config bits in a register
+
+  LLVM_DEBUG(dbgs() << "-- Expanding SDMA Threed\n");
+
+  // The hardware only supports 2D transfers, issue nreps2 of them. The
+  // strides and repetitions are shared by all of them and set up once.
+  Register Cfg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ORI), Cfg)
+    .addReg(MI.getOperand(12).getReg(), 0)
+    .addImm(0x1<<1);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::DMSTR))
+    .addReg(MI.getOperand(6).getReg(), 0)  // srcstrd
+    .addReg(MI.getOperand(7).getReg(), 0); // dststrd
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::DMREP))
+    .addReg(MI.getOperand(8).getReg(), 0); // reps
+
+  auto LoopMBB = MF->CreateMachineBasicBlock(MBB.getBasicBlock());
+  auto DoneMBB = MF->CreateMachineBasicBlock(MBB.getBasicBlock());
+
+  // Insert new MBBs.
+  MF->insert(++MBB.getIterator(), LoopMBB);
+  MF->insert(++LoopMBB->getIterator(), DoneMBB);
+
+  // Set up successors and transfer remaining instructions to DoneMBB.
+  LoopMBB->addSuccessor(LoopMBB);
+  LoopMBB->addSuccessor(DoneMBB);
+  DoneMBB->splice(DoneMBB->end(), &MBB, std::next(MBBI), MBB.end());
+  DoneMBB->transferSuccessorsAndUpdatePHIs(&MBB);
+  MBB.addSuccessor(LoopMBB);
+
+  // Advance a 64-bit address split into hi/lo by a 32-bit stride.
+  auto buildAddressLoop = [&](Register InitHi, Register InitLo,
+                              Register Stride, Register &Hi, Register &Lo) {
+    Hi = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Lo = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Register NextHi = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Register NextLo = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Register Carry = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(*LoopMBB, LoopMBB->begin(), DL, TII->get(RISCV::PHI), Hi)
+      .addReg(InitHi).addMBB(&MBB)
+      .addReg(NextHi).addMBB(LoopMBB);
+    BuildMI(*LoopMBB, LoopMBB->begin(), DL, TII->get(RISCV::PHI), Lo)
+      .addReg(InitLo).addMBB(&MBB)
+      .addReg(NextLo).addMBB(LoopMBB);
+    BuildMI(LoopMBB, DL, TII->get(RISCV::ADD), NextLo)
+      .addReg(Lo).addReg(Stride);
+    BuildMI(LoopMBB, DL, TII->get(RISCV::SLTU), Carry)
+      .addReg(NextLo).addReg(Lo);
+    BuildMI(LoopMBB, DL, TII->get(RISCV::ADD), NextHi)
+      .addReg(Hi).addReg(Carry, RegState::Kill);
+  };
+
+  // build loop:
+  //   dmsrc slo, shi; dmdst dlo, dhi; tid = dmcpy size, cfg
+  //   advance src and dst by the outer strides
+  //   n = n - 1; bne n, zero, loop
+  Register N = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  Register NextN = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  BuildMI(LoopMBB, DL, TII->get(RISCV::PHI), N)
+    .addReg(MI.getOperand(11).getReg()).addMBB(&MBB)
+    .addReg(NextN).addMBB(LoopMBB);
+  MachineInstr *Src = BuildMI(LoopMBB, DL, TII->get(RISCV::DMSRC));
+  MachineInstr *Dst = BuildMI(LoopMBB, DL, TII->get(RISCV::DMDST));
+  BuildMI(LoopMBB, DL, TII->get(RISCV::DMCPY), MI.getOperand(0).getReg())
+    .addReg(MI.getOperand(5).getReg(), 0)  // rs1 = size
+    .addReg(Cfg, 0);                       // rs2 = config
+  Register SHi, SLo, DHi, DLo;
+  buildAddressLoop(MI.getOperand(1).getReg(), MI.getOperand(2).getReg(),
+                   MI.getOperand(9).getReg(), SHi, SLo);
+  buildAddressLoop(MI.getOperand(3).getReg(), MI.getOperand(4).getReg(),
+                   MI.getOperand(10).getReg(), DHi, DLo);
+  MachineInstrBuilder(*MF, Src).addReg(SLo).addReg(SHi);
+  MachineInstrBuilder(*MF, Dst).addReg(DLo).addReg(DHi);
+  BuildMI(LoopMBB, DL, TII->get(RISCV::ADDI), NextN)
+    .addReg(N).addImm(-1);
+  BuildMI(LoopMBB, DL, TII->get(RISCV::BNE))
+    .addReg(NextN).addReg(RISCV::X0).addMBB(LoopMBB);
+
+  NextMBBI = MBB.end();
+  MI.eraseFromParent();
+  return true;
+}
+
+bool RISCVExpandSDMA::updateConfig(MachineBasicBlock &MBB, DMAConfig &Config,
+                                   bool Remove) {
+  bool Modified = false;
+  for (MachineInstr &MI : make_early_inc_range(MBB)) {
+    int Idx = -1;
+    switch (MI.getOpcode()) {
+    case RISCV::DMSRC: Idx = DMAConfig::Src; break;
+    case RISCV::DMDST: Idx = DMAConfig::Dst; break;
+    case RISCV::DMSTR: Idx = DMAConfig::Str; break;
+    case RISCV::DMREP: Idx = DMAConfig::Rep; break;
+    }
+    if (Idx >= 0) {
+      // Only virtual registers and the zero register identify a value.
+      std::pair<Register, Register> Value;
+      bool Known = true;
+      for (unsigned I = 0, E = MI.getNumOperands(); I != E; ++I) {
+        Register Reg = MI.getOperand(I).getReg();
+        Known &= Reg.isVirtual() || Reg == RISCV::X0;
+        (I == 0 ? Value.first : Value.second) = Reg;
+      }
+      if (Known && Config.Regs[Idx] == Value) {
+        if (Remove) {
+          LLVM_DEBUG(dbgs() << "-- Removing redundant " << MI);
+          MI.eraseFromParent();
+          Modified = true;
+        }
+        continue;
+      }
+      Config.Regs[Idx] = Known ? Value : std::pair<Register, Register>();
+      continue;
+    }
+    // Calls and inline assembly may start transfers of their own.
+    if (MI.isCall() || MI.isInlineAsm()) {
+      Config.clear();
+      continue;
+    }
+    for (const MachineOperand &MO : MI.operands())
+      if (MO.isReg() && MO.isDef())
+        Config.clobber(MO.getReg());
+  }
+  return Modified;
+}
+
+bool RISCVExpandSDMA::removeRedundantConfig(MachineFunction &MF) {
+  // Forward data flow over the values in the configuration registers. Blocks
+  // which have not been visited yet do not constrain their successors.
+  DenseMap<const MachineBasicBlock *, DMAConfig> Out;
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+
+  auto getIn = [&](const MachineBasicBlock *MBB) {
+    DMAConfig In;
+    if (MBB->pred_empty() || MBB->isEHPad())
+      return In;
+    bool First = true;
+    for (const MachineBasicBlock *Pred : MBB->predecessors()) {
+      auto It = Out.find(Pred);
+      if (It == Out.end())
+        continue;
+      if (First)
+        In = It->second;
+      else
+        In.meet(It->second);
+      First = false;
+    }
+    return In;
+  };
+
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (MachineBasicBlock *MBB : RPOT) {
+      DMAConfig Config = getIn(MBB);
+      updateConfig(*MBB, Config, false);
+      auto It = Out.find(MBB);
+      if (It == Out.end() || It->second != Config) {
+        Out[MBB] = Config;
+        Changed = true;
+      }
+    }
+  }
+
+  bool Modified = false;
+  for (MachineBasicBlock *MBB : RPOT) {
+    DMAConfig Config = getIn(MBB);
+    Modified |= updateConfig(*MBB, Config, true);
+  }
+  return Modified;
+}
+
 bool RISCVExpandSDMA::expandStat(MachineBasicBlock &MBB,
                                           MachineBasicBlock::iterator MBBI) {
   DebugLoc DL = MBBI->getDebugLoc();
@@ -243,6 +485,51 @@ bool RISCVExpandSDMA::expandWaitForIdle(MachineBasicBlock &MBB,
   return true;
 }
 
+bool RISCVExpandSDMA::expandWait(MachineBasicBlock &MBB,
+                                 MachineBasicBlock::iterator MBBI,
+                                 MachineBasicBlock::iterator &NextMBBI) {
+  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  MachineInstr &MI = *MBBI;
+  MachineFunction *MF = MBB.getParent();
+  DebugLoc DL = MI.getDebugLoc();
+  Register TID = MI.getOperand(0).getReg();
+
+  LLVM_DEBUG(dbgs() << "-- Expanding SDMA Wait\n");
+
+  auto LoopMBB = MF->CreateMachineBasicBlock(MBB.getBasicBlock());
+  auto DoneMBB = MF->CreateMachineBasicBlock(MBB.getBasicBlock());
+
+  // Insert new MBBs.
+  MF->insert(++MBB.getIterator(), LoopMBB);
+  MF->insert(++LoopMBB->getIterator(), DoneMBB);
+
+  // Set up successors and transfer remaining instructions to DoneMBB.
+  LoopMBB->addSuccessor(LoopMBB);
+  LoopMBB->addSuccessor(DoneMBB);
+  DoneMBB->splice(DoneMBB->end(), &MBB, MI, MBB.end());
+  DoneMBB->transferSuccessorsAndUpdatePHIs(&MBB);
+  MBB.addSuccessor(LoopMBB);
+
+  // Status 0 holds the ID of the last completed transfer. Transfers complete
+  // in order, so poll until it reached the requested ID.
+  // build loop: %0 = dmstati 0; blt %0, tid, loop
+  Register R = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  BuildMI(LoopMBB, DL, TII->get(RISCV::DMSTATI), R).addImm(0);
+  BuildMI(LoopMBB, DL, TII->get(RISCV::BLT))
+      .addReg(R, RegState::Kill)
+      .addReg(TID)
+      .addMBB(LoopMBB);
+
+  NextMBBI = MBB.end();
+  MI.eraseFromParent();
+
+  LivePhysRegs LiveRegs;
+  computeAndAddLiveIns(LiveRegs, *LoopMBB);
+  computeAndAddLiveIns(LiveRegs, *DoneMBB);
+
+  return true;
+}
+
 } // end of anonymous namespace
 
 INITIALIZE_PASS(RISCVExpandSDMA, "riscv-expand-sdma",
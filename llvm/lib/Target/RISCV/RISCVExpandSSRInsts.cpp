@@ -46,15 +46,35 @@
 // scfgw   rs1 rs2 # rs1=value rs2=addr
 //===----------------------------------------------------------------------===//
 
+//===----------------------------------------------------------------------===//
+// While streaming is enabled, ft0-ft2 are bound to the data movers. Instead of
+// reserving them for the whole function, the expanded enable implicitly
+// defines and the disable implicitly uses the SSR data registers. Together
+// with live-ins on all blocks inside an enable/disable region, this gives
+// them physical live ranges spanning exactly the streaming regions, so that
+// the register allocator can use ft0-ft2 as ordinary registers elsewhere.
+// Calls inside a streaming region which may clobber ft0-ft2 are wrapped into
+// a disable and an enable, the streams are paused across the callee. With
+// -enable-ipra, which is the default for SSR targets, the register masks of
+// calls to functions compiled earlier only clobber the registers the callee
+// actually writes, so streams stay enabled across leaf helpers. Functions
+// with a clobbering tail call inside a streaming region fall back to
+// reserving the registers.
+//===----------------------------------------------------------------------===//
+
 #include "RISCV.h"
 #include "RISCVInstrInfo.h"
 #include "RISCVTargetMachine.h"
 #include "RISCVMachineFunctionInfo.h"
 
 #include "llvm/CodeGen/LivePhysRegs.h"
+#include "llvm/CodeGen/MachineDominators.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachinePostDominators.h"
 #include "llvm/CodeGen/LowLevelType.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -66,6 +86,10 @@ using namespace llvm;
 static cl::opt<bool>
     SSRRegisterMerge("ssr-noregmerge", cl::Hidden,
                     cl::desc("Disable the merging of SSR registers in other instructions"));
+static cl::opt<bool>
+    SSRReserveRegs("ssr-reserve-regs", cl::Hidden, cl::init(false),
+                   cl::desc("Reserve the SSR data registers in the whole "
+                            "function instead of only in streaming regions"));
 
 #define RISCV_EXPAND_SSR_NAME "RISCV SSR pseudo instruction expansion pass"
 
@@ -96,10 +120,29 @@ private:
 
   const MachineFunction *MF;
   RISCVMachineFunctionInfo *RVFI;
+  MachineRegisterInfo *MRI;
+  const TargetRegisterInfo *TRI;
+  MachineDominatorTree *MDT;
+  PostDomTreeBase<MachineBasicBlock> *MPDT;
+  MachineLoopInfo *MLI;
   bool Enabled;
+  bool HasRegion;
 
   bool expandMBB(MachineBasicBlock &MBB);
-  void mergePushPop(MachineBasicBlock &MBB);
+  void mergeSSRRegisters(MachineFunction &MF);
+  bool mergePhi(MachineInstr &Phi);
+  bool sinkPopIntoUse(Register V, Register R, MachineBasicBlock &FromMBB,
+                      MachineBasicBlock::iterator From,
+                      SmallVectorImpl<MachineInstr *> &Dead);
+  bool hoistPushIntoDef(Register V, Register R, MachineBasicBlock &ToMBB,
+                        MachineBasicBlock::iterator To,
+                        SmallVectorImpl<MachineInstr *> &Dead);
+  bool isClearPath(MachineBasicBlock &FromMBB,
+                   MachineBasicBlock::iterator From, MachineBasicBlock &ToMBB,
+                   MachineBasicBlock::iterator To, Register R);
+  bool canUseSSRReg(const MachineInstr &MI, unsigned OpIdx, Register R);
+  void dropDebugUses(ArrayRef<Register> Regs);
+  void eraseDead(ArrayRef<MachineInstr *> Dead);
   bool expandMI(MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
                 MachineBasicBlock::iterator &NextMBBI);
   bool expandSSR_Setup(MachineBasicBlock &MBB,
@@ -121,6 +164,9 @@ private:
                          MachineBasicBlock::iterator &NextMBBI);
 
   RISCVExpandSSR::RegisterMergingPreferences gatherRegisterMergingPreferences();
+  void buildEnDis(MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
+                  const DebugLoc &DL, bool isEnable);
+  bool addRegionLiveIns(MachineFunction &MF);
 };
 
 char RISCVExpandSSR::ID = 0;
@@ -136,11 +182,34 @@ static Register getSSRFtReg(unsigned streamer) {
   return Register(*I);
 }
 
+/// Returns the value of \p Reg if it is a small constant materialized by a
+/// single li, so that the SSR register address can be folded into an scfgwi.
+/// The li is erased once the last use is folded.
+static Optional<int64_t> foldConstantReg(Register Reg,
+                                         MachineRegisterInfo &MRI,
+                                         MachineInstr *&Def) {
+  Def = Reg.isVirtual() ? MRI.getVRegDef(Reg) : nullptr;
+  if (!Def || Def->getOpcode() != RISCV::ADDI || !Def->getOperand(1).isReg() ||
+      Def->getOperand(1).getReg() != RISCV::X0 || !Def->getOperand(2).isImm())
+    return None;
+  return Def->getOperand(2).getImm();
+}
+
+/// Erase the constant definitions that were folded into scfgwi immediates.
+static void eraseFoldedConstants(ArrayRef<MachineInstr *> Defs,
+                                 MachineRegisterInfo &MRI) {
+  for (MachineInstr *Def : Defs)
+    if (Def && Def->getParent() &&
+        MRI.use_nodbg_empty(Def->getOperand(0).getReg()))
+      Def->eraseFromParent();
+}
+
 bool RISCVExpandSSR::runOnMachineFunction(MachineFunction &MF) {
   TII = static_cast<const RISCVInstrInfo *>(MF.getSubtarget().getInstrInfo());
   this->MF = &MF;
   this->RVFI = MF.getInfo<RISCVMachineFunctionInfo>();
   Enabled = false;
+  HasRegion = false;
 
   bool Modified = false;
   for (auto &MBB : MF)
@@ -148,12 +217,20 @@ bool RISCVExpandSSR::runOnMachineFunction(MachineFunction &MF) {
 
   // Run over MF again to merge SSR pops/pushs into instruction uses
   RISCVExpandSSR::RegisterMergingPreferences RMP = gatherRegisterMergingPreferences();
-  if(RMP.Enable && RVFI->getUsedSSR())
-    for (auto &MBB : MF)
-      mergePushPop(MBB);
-
-  /// "Forcefully" add all SSR registers as live-in to all MBB in this MF
-  if(Modified) {
+  if(RMP.Enable && HasRegion)
+    mergeSSRRegisters(MF);
+
+  // Model the SSR data registers as live throughout the streaming regions.
+  // If this is not possible, reserve them in the whole function and
+  // "forcefully" add them as live-in to all MBB in this MF
+  if(HasRegion && !SSRReserveRegs && addRegionLiveIns(MF)) {
+    RVFI->setHasSSRRegions(true);
+  } else if(Modified) {
+    unsigned ssrEnabledMask = 0;
+    for (unsigned n = 0; n != NUM_SSR; ++n)
+      ssrEnabledMask |= 1 << n;
+    if(HasRegion)
+      RVFI->setUsedSSR(ssrEnabledMask);
     for (auto &MBB : MF) {
       for(unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no)
         MBB.addLiveIn(getSSRFtReg(ssr_no));
@@ -201,11 +278,16 @@ bool RISCVExpandSSR::expandMI(MachineBasicBlock &MBB,
   case RISCV::PseudoSSRSetupBoundStride_2D:
   case RISCV::PseudoSSRSetupBoundStride_3D:
   case RISCV::PseudoSSRSetupBoundStride_4D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_1D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_2D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_3D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_4D:
     return expandSSR_BoundStride(MBB, MBBI);
   case RISCV::PseudoSSREnable:
   case RISCV::PseudoSSRDisable:
     return expandSSR_EnDis(MBB, MBBI);
   case RISCV::PseudoSSRSetupRepetition:
+  case RISCV::PseudoSSRSetupRepetitionImm:
     return expandSSR_SetupRep(MBB, MBBI);
   case RISCV::PseudoSSRBarrier:
     return expandSSR_Barrier(MBB, MBBI, NextMBBI);
@@ -315,6 +397,20 @@ bool RISCVExpandSSR::expandSSR_ReadWrite(MachineBasicBlock &MBB,
   // reg  = (read ? 0x18 : 0x1c) + dim_off_reg
   // addr = reg << 5 + dm_off
 
+  // A constant data mover and dimension address the register directly.
+  MachineInstr *DMDef, *DimDef;
+  Optional<int64_t> DM = foldConstantReg(dm_off_reg, MRI, DMDef);
+  Optional<int64_t> Dim = foldConstantReg(dim_off_reg, MRI, DimDef);
+  if (DM && Dim) {
+    int ssr_reg = ((rw_off + *Dim) << 5) + *DM;
+    BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGWI))
+        .addReg(MBBI->getOperand(2).getReg())
+        .addImm(ssr_reg);
+    MBBI->eraseFromParent();
+    eraseFoldedConstants({DMDef, DimDef}, MRI);
+    return true;
+  }
+
   Register dim_off0 = MRI.createVirtualRegister(&RISCV::GPRRegClass);
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), dim_off0).addReg(dim_off_reg).addImm(rw_off);
   Register dim_off1 = MRI.createVirtualRegister(&RISCV::GPRRegClass);
@@ -354,13 +450,29 @@ bool RISCVExpandSSR::expandSSR_SetupRep(MachineBasicBlock &MBB,
   DebugLoc DL = MBBI->getDebugLoc();
   MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
 
+  Register PtrReg = MBBI->getOperand(1).getReg();
+
+  Optional<int64_t> DM;
+  MachineInstr *DMDef = nullptr;
+  if (MBBI->getOperand(0).isImm())
+    DM = MBBI->getOperand(0).getImm();
+  else
+    DM = foldConstantReg(MBBI->getOperand(0).getReg(), MRI, DMDef);
+  if (DM) {
+    BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGWI))
+        .addReg(PtrReg)
+        .addImm(*DM + (1 << 5));
+    MBBI->eraseFromParent();
+    eraseFoldedConstants(DMDef, MRI);
+    return true;
+  }
+
   // select streamer based on first argument
   Register dm_off_reg = MBBI->getOperand(0).getReg();
   Register dm_off = MRI.createVirtualRegister(&RISCV::GPRRegClass);
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), dm_off).addReg(dm_off_reg).addImm(1<<5);
 
   // emit scfgwi at proper location
-  Register PtrReg = MBBI->getOperand(1).getReg();
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGW)).addReg(PtrReg).addReg(dm_off, RegState::Kill);
 
   MBBI->eraseFromParent(); // The pseudo instruction is gone now.
@@ -373,13 +485,42 @@ bool RISCVExpandSSR::expandSSR_BoundStride(MachineBasicBlock &MBB,
   DebugLoc DL = MBBI->getDebugLoc();
   MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
 
-  if(MBBI->getOpcode() == RISCV::PseudoSSRSetupBoundStride_1D) dim = 1;
-  if(MBBI->getOpcode() == RISCV::PseudoSSRSetupBoundStride_2D) dim = 2;
-  if(MBBI->getOpcode() == RISCV::PseudoSSRSetupBoundStride_3D) dim = 3;
-  if(MBBI->getOpcode() == RISCV::PseudoSSRSetupBoundStride_4D) dim = 4;
+  switch (MBBI->getOpcode()) {
+  case RISCV::PseudoSSRSetupBoundStride_1D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_1D: dim = 1; break;
+  case RISCV::PseudoSSRSetupBoundStride_2D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_2D: dim = 2; break;
+  case RISCV::PseudoSSRSetupBoundStride_3D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_3D: dim = 3; break;
+  default: dim = 4; break;
+  }
 
   LLVM_DEBUG(dbgs() << "-- Expanding SSR Bound Stride " << dim << "D\n");
 
+  Register BoundReg = MBBI->getOperand(1).getReg();
+  Register StrideReg = MBBI->getOperand(2).getReg();
+
+  // SCFGWI rs1 imm # rs1=value imm=addr, for a constant data mover. ISel
+  // selects the Imm pseudos for constants in the same block, constants
+  // materialized elsewhere are folded here.
+  Optional<int64_t> DM;
+  MachineInstr *DMDef = nullptr;
+  if (MBBI->getOperand(0).isImm())
+    DM = MBBI->getOperand(0).getImm();
+  else
+    DM = foldConstantReg(MBBI->getOperand(0).getReg(), MRI, DMDef);
+  if (DM) {
+    BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGWI))
+        .addReg(BoundReg)
+        .addImm(*DM + ((2 + (dim - 1)) << 5));
+    BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGWI))
+        .addReg(StrideReg)
+        .addImm(*DM + ((6 + (dim - 1)) << 5));
+    MBBI->eraseFromParent();
+    eraseFoldedConstants(DMDef, MRI);
+    return true;
+  }
+
   // select streamer based on first argument
   Register dm_off_reg = MBBI->getOperand(0).getReg();
 
@@ -394,10 +535,8 @@ bool RISCVExpandSSR::expandSSR_BoundStride(MachineBasicBlock &MBB,
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), addr_stride).addReg(dm_off_reg).addImm( ((6+(dim-1))<<5));
 
   // set bound
-  Register BoundReg = MBBI->getOperand(1).getReg();
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGW)).addReg(BoundReg).addReg(addr_bound, RegState::Kill);
   // set stride
-  Register StrideReg = MBBI->getOperand(2).getReg();
   BuildMI(MBB, MBBI, DL, TII->get(RISCV::SCFGW)).addReg(StrideReg).addReg(addr_stride, RegState::Kill);
   
   MBBI->eraseFromParent(); // The pseudo instruction is gone now.
@@ -408,32 +547,37 @@ bool RISCVExpandSSR::expandSSR_EnDis(MachineBasicBlock &MBB,
                                           MachineBasicBlock::iterator MBBI) {
   DebugLoc DL = MBBI->getDebugLoc();
   bool isEnable = MBBI->getOpcode() == RISCV::PseudoSSREnable;
-  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
 
   LLVM_DEBUG(dbgs() << "-- Expanding SSR " << (isEnable ? "Enable" : "Disable") << "\n");
   Enabled = isEnable;
+  HasRegion = true;
+
+  buildEnDis(MBB, MBBI, DL, isEnable);
+
+  MBBI->eraseFromParent(); // The pseudo instruction is gone now.
+  return true;
+}
 
-  // emit a csrsi/csrci call to the SSR location
+/// Emit a csrsi/csrci call to the SSR location before \p MBBI. The enable
+/// starts the live ranges of the SSR data registers, the disable ends them.
+void RISCVExpandSSR::buildEnDis(MachineBasicBlock &MBB,
+                                MachineBasicBlock::iterator MBBI,
+                                const DebugLoc &DL, bool isEnable) {
+  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
   if(isEnable) {
-    BuildMI(MBB, MBBI, DL, TII->get(RISCV::CSRRSI))
+    MachineInstrBuilder MIB = BuildMI(MBB, MBBI, DL, TII->get(RISCV::CSRRSI))
       .addDef(MRI.createVirtualRegister(&RISCV::GPRRegClass), RegState::Dead)
       .addImm(0x7C0).addImm(1);
-
-    // mark the SSR registers reserved in this machine function
-    unsigned ssrEnabledMask = 0;
-    for (unsigned n = 0; n != 3; ++n) {
-      ssrEnabledMask |= 1 << n;
-    }
-    RVFI->setUsedSSR(ssrEnabledMask);
+    for (unsigned n = 0; n != NUM_SSR; ++n)
+      MIB.addReg(getSSRFtReg(n), RegState::ImplicitDefine);
   }
   else {
-    BuildMI(MBB, MBBI, DL, TII->get(RISCV::CSRRCI))
+    MachineInstrBuilder MIB = BuildMI(MBB, MBBI, DL, TII->get(RISCV::CSRRCI))
       .addDef(MRI.createVirtualRegister(&RISCV::GPRRegClass), RegState::Dead)
       .addImm(0x7C0).addImm(1);
+    for (unsigned n = 0; n != NUM_SSR; ++n)
+      MIB.addReg(getSSRFtReg(n), RegState::Implicit);
   }
-
-  MBBI->eraseFromParent(); // The pseudo instruction is gone now.
-  return true;
 }
 
 bool RISCVExpandSSR::expandSSR_Barrier(MachineBasicBlock &MBB,
@@ -479,80 +623,415 @@ bool RISCVExpandSSR::expandSSR_Barrier(MachineBasicBlock &MBB,
   return true;
 }
 
-void RISCVExpandSSR::mergePushPop(MachineBasicBlock &MBB) {
-  SmallSet<Register, 8> virtRegs[NUM_SSR];
-  const TargetRegisterInfo *TRI = MBB.getParent()->getRegInfo().getTargetRegisterInfo();
-  bool inSSRRegion = false;
-
-  Register ssr_regs[NUM_SSR];
-  for(unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) ssr_regs[ssr_no] = getSSRFtReg(ssr_no);
-
-  // First pass: Detect moves to or from SSR registers
-  for (auto MI = MBB.begin() ; MI != MBB.end() ; ) {
-    MachineBasicBlock::iterator NMI = std::next(MI);
-
-    LLVM_DEBUG(dbgs()<<"Analyzing: "<<*MI<<"\n");
-
-    // detect an emitted pop and add assignment (virtual_reg, ssr_read) to list
-    if(MI->getOpcode() == RISCV::FSGNJ_D) {
-      LLVM_DEBUG(dbgs()<<"Found FSGNJ_D, Op 0: " << MI->getOperand(1).getReg() << " Op1: " << MI->getOperand(2).getReg() << "\n");
-      
-      // look for each streamer register
-      for(unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) {
-        // check for pop
-        if(MI->getOperand(1).getReg() == ssr_regs[ssr_no] && MI->getOperand(2).getReg() == ssr_regs[ssr_no]) {
-          LLVM_DEBUG(dbgs()<<"  pop: both operands from SSR"<< ssr_no <<"\n");
-          // append virtual register to list of assigned virtuals
-          LLVM_DEBUG(dbgs()<<"  append: "<< MI->getOperand(0).getReg() <<"\n");
-          virtRegs[ssr_no].insert(MI->getOperand(0).getReg());
-          // remove operation
-          MI->eraseFromParent();
-          break;
-        }
-        // TODO: check for push
-        else if(MI->getOperand(0).getReg() == ssr_regs[ssr_no]) {
-          // This is non-trivial because a register might be used elsewhere, therefore the entire MBB
-          // must be analyzed and a merge can only be made, if the register is written once
-          // LLVM_DEBUG(dbgs()<<"  push: operand 0 from SSR"<< ssr_no <<"\n");
-          // // append virtual register to list of assigned virtuals
-          // LLVM_DEBUG(dbgs()<<"  append: "<< MI->getOperand(1).getReg() <<"\n");
-          // virtRegs[ssr_no].insert(MI->getOperand(1).getReg());
-          // // remove operation
-          // MI->eraseFromParent();
-          break;
-        }
-      }
-    } 
-    MI = NMI;
+/// Return true if \p MI reads or writes the SSR data register \p R.
+static bool accessesSSRReg(const MachineInstr &MI, Register R,
+                           const TargetRegisterInfo *TRI) {
+  return MI.readsRegister(R, TRI) || MI.modifiesRegister(R, TRI);
+}
+
+/// Return true if the SSR data register \p R is not accessed between \p From
+/// in \p FromMBB and \p To in \p ToMBB, and both positions execute equally
+/// often. Moving a pop or push between the two points then preserves the
+/// order of the stream.
+bool RISCVExpandSSR::isClearPath(MachineBasicBlock &FromMBB,
+                                 MachineBasicBlock::iterator From,
+                                 MachineBasicBlock &ToMBB,
+                                 MachineBasicBlock::iterator To, Register R) {
+  if (&FromMBB == &ToMBB) {
+    for (auto I = From; I != FromMBB.end(); ++I) {
+      if (I == To)
+        return true;
+      if (accessesSSRReg(*I, R, TRI))
+        return false;
+    }
+    return To == FromMBB.end();
+  }
+
+  // The blocks must be control equivalent within the same loop.
+  if (!MDT->dominates(&FromMBB, &ToMBB) ||
+      !MPDT->dominates(&ToMBB, &FromMBB) ||
+      MLI->getLoopFor(&FromMBB) != MLI->getLoopFor(&ToMBB))
+    return false;
+
+  for (auto I = From; I != FromMBB.end(); ++I)
+    if (accessesSSRReg(*I, R, TRI))
+      return false;
+  for (auto I = ToMBB.begin(); I != To; ++I)
+    if (accessesSSRReg(*I, R, TRI))
+      return false;
+
+  // Walk all blocks on paths between the two, FromMBB dominates ToMBB so the
+  // backward walk terminates there.
+  SmallPtrSet<MachineBasicBlock *, 8> Visited;
+  Visited.insert(&FromMBB);
+  Visited.insert(&ToMBB);
+  SmallVector<MachineBasicBlock *, 8> Worklist(ToMBB.pred_begin(),
+                                               ToMBB.pred_end());
+  while (!Worklist.empty()) {
+    MachineBasicBlock *MBB = Worklist.pop_back_val();
+    if (!Visited.insert(MBB).second)
+      continue;
+    for (auto &MI : *MBB)
+      if (accessesSSRReg(MI, R, TRI))
+        return false;
+    Worklist.append(MBB->pred_begin(), MBB->pred_end());
+  }
+  return true;
+}
+
+/// Return the SSR data register moved by the expanded pop \p MI, or an
+/// invalid register if \p MI is not a pop.
+static Register getPoppedSSRReg(const MachineInstr &MI) {
+  if (MI.getOpcode() != RISCV::FSGNJ_D ||
+      !MI.getOperand(0).getReg().isVirtual())
+    return Register();
+  for (unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) {
+    Register R = getSSRFtReg(ssr_no);
+    if (MI.getOperand(1).getReg() == R && MI.getOperand(2).getReg() == R)
+      return R;
+  }
+  return Register();
+}
+
+/// Return the SSR data register written by the expanded push \p MI, or an
+/// invalid register if \p MI is not a push.
+static Register getPushedSSRReg(const MachineInstr &MI) {
+  if (MI.getOpcode() != RISCV::FSGNJ_D ||
+      MI.getOperand(1).getReg() != MI.getOperand(2).getReg() ||
+      !MI.getOperand(1).getReg().isVirtual())
+    return Register();
+  for (unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no)
+    if (MI.getOperand(0).getReg() == getSSRFtReg(ssr_no))
+      return MI.getOperand(0).getReg();
+  return Register();
+}
+
+/// Return true if operand \p OpIdx of \p MI can be replaced by the SSR data
+/// register \p R.
+bool RISCVExpandSSR::canUseSSRReg(const MachineInstr &MI, unsigned OpIdx,
+                                  Register R) {
+  const MachineOperand &MO = MI.getOperand(OpIdx);
+  if (MI.isPHI() || MI.isCopy() || MI.isInlineAsm() || MI.isDebugInstr() ||
+      MO.isTied() || MO.getSubReg() || MO.isImplicit())
+    return false;
+  const TargetRegisterClass *RC = MI.getRegClassConstraint(OpIdx, TII, TRI);
+  return RC && RC->contains(R);
+}
+
+/// Mark the debug uses of the virtual registers in \p Regs undefined.
+void RISCVExpandSSR::dropDebugUses(ArrayRef<Register> Regs) {
+  for (Register V : Regs)
+    for (MachineInstr &DbgMI :
+         make_early_inc_range(MRI->use_instructions(V)))
+      if (DbgMI.isDebugValue())
+        DbgMI.setDebugValueUndef();
+}
+
+/// Erase the merged moves in \p Dead together with the debug uses of the
+/// values they define.
+void RISCVExpandSSR::eraseDead(ArrayRef<MachineInstr *> Dead) {
+  for (MachineInstr *MI : Dead) {
+    for (const MachineOperand &MO : MI->defs())
+      if (MO.getReg().isVirtual())
+        dropDebugUses(MO.getReg());
+    MI->eraseFromParent();
+  }
+}
+
+/// Replace the single use of the popped value \p V, possibly through a chain
+/// of COPYs, with the SSR data register \p R. The pop is conceptually moved
+/// from \p From in \p FromMBB to the use. \p Dead holds the instructions
+/// defining \p V which are deleted on success.
+bool RISCVExpandSSR::sinkPopIntoUse(Register V, Register R,
+                                    MachineBasicBlock &FromMBB,
+                                    MachineBasicBlock::iterator From,
+                                    SmallVectorImpl<MachineInstr *> &Dead) {
+  MachineOperand *UseMO = nullptr;
+  for (;;) {
+    // Each use of the register pops a new element, so the value must be used
+    // exactly once.
+    if (!MRI->hasOneNonDBGUse(V))
+      return false;
+    UseMO = &*MRI->use_nodbg_begin(V);
+    MachineInstr *UseMI = UseMO->getParent();
+    if (!UseMI->isCopy() || UseMO->getSubReg() ||
+        !UseMI->getOperand(0).getReg().isVirtual() ||
+        UseMI->getOperand(0).getSubReg())
+      break;
+    Dead.push_back(UseMI);
+    V = UseMI->getOperand(0).getReg();
+  }
+
+  MachineInstr &UseMI = *UseMO->getParent();
+  if (!canUseSSRReg(UseMI, UseMI.getOperandNo(UseMO), R) ||
+      !isClearPath(FromMBB, From, *UseMI.getParent(), UseMI.getIterator(), R))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "  merge pop of " << printReg(R, TRI) << " into "
+                    << UseMI);
+  UseMO->setReg(R);
+  UseMO->setIsKill(false);
+  eraseDead(Dead);
+  return true;
+}
+
+/// Let the single definition of the pushed value \p V, possibly through a
+/// chain of COPYs, write the SSR data register \p R directly. The push is
+/// conceptually moved from the definition to \p To in \p ToMBB. \p Dead holds
+/// the instructions using \p V which are deleted on success.
+bool RISCVExpandSSR::hoistPushIntoDef(Register V, Register R,
+                                      MachineBasicBlock &ToMBB,
+                                      MachineBasicBlock::iterator To,
+                                      SmallVectorImpl<MachineInstr *> &Dead) {
+  SmallVector<Register, 4> Chain;
+  MachineInstr *DefMI = nullptr;
+  for (;;) {
+    if (!MRI->hasOneNonDBGUser(V) || !MRI->hasOneDef(V))
+      return false;
+    Chain.push_back(V);
+    DefMI = MRI->getVRegDef(V);
+    if (!DefMI->isCopy() || DefMI->getOperand(1).getSubReg() ||
+        !DefMI->getOperand(1).getReg().isVirtual() ||
+        DefMI->getOperand(0).getSubReg())
+      break;
+    Dead.push_back(DefMI);
+    V = DefMI->getOperand(1).getReg();
+  }
+
+  int DefIdx = DefMI->findRegisterDefOperandIdx(V);
+  if (DefIdx < 0 || !canUseSSRReg(*DefMI, DefIdx, R) ||
+      DefMI->readsRegister(R, TRI) ||
+      !isClearPath(*DefMI->getParent(), std::next(DefMI->getIterator()),
+                   ToMBB, To, R))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "  merge push of " << printReg(R, TRI) << " into "
+                    << *DefMI);
+  MachineOperand &DefMO = DefMI->getOperand(DefIdx);
+  DefMO.setReg(R);
+  DefMO.setIsDead(false);
+  dropDebugUses(Chain);
+  eraseDead(Dead);
+  return true;
+}
+
+/// Merge pops and pushes which meet at the PHI \p Phi. If every incoming
+/// value is popped at the end of its predecessor, the pop is sunk past the
+/// PHI into the use of its result. If every incoming value is pushed, the
+/// push is hoisted into the definitions of the incoming values.
+bool RISCVExpandSSR::mergePhi(MachineInstr &Phi) {
+  MachineBasicBlock &MBB = *Phi.getParent();
+  Register Res = Phi.getOperand(0).getReg();
+
+  // Collect the incoming values, each predecessor must flow straight into the
+  // PHI block so that exactly one of them is executed.
+  SmallVector<std::pair<Register, MachineBasicBlock *>, 4> Incoming;
+  for (unsigned I = 1, E = Phi.getNumOperands(); I != E; I += 2) {
+    Register In = Phi.getOperand(I).getReg();
+    MachineBasicBlock *Pred = Phi.getOperand(I + 1).getMBB();
+    if (!In.isVirtual() || Phi.getOperand(I).getSubReg() ||
+        Pred->succ_size() != 1 || !MRI->hasOneNonDBGUse(In))
+      return false;
+    Incoming.push_back({In, Pred});
   }
 
-  // DBG
-  for(unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) {
-    for (auto iter = virtRegs[ssr_no].begin() ; iter != virtRegs[ssr_no].end() ; ++iter)
-      LLVM_DEBUG(dbgs() << "virtregs["<<ssr_no<<"] = " << *iter << "\n");
+  // pop in every predecessor
+  SmallVector<MachineInstr *, 4> Pops;
+  Register R;
+  for (auto &In : Incoming) {
+    MachineInstr *DefMI = MRI->getVRegDef(In.first);
+    Register PopR = DefMI ? getPoppedSSRReg(*DefMI) : Register();
+    if (!PopR || (R && PopR != R) || DefMI->getParent() != In.second ||
+        !isClearPath(*In.second, std::next(DefMI->getIterator()), *In.second,
+                     In.second->end(), PopR))
+      break;
+    R = PopR;
+    Pops.push_back(DefMI);
+  }
+  if (Pops.size() == Incoming.size()) {
+    SmallVector<MachineInstr *, 4> Dead(Pops.begin(), Pops.end());
+    Dead.push_back(&Phi);
+    return sinkPopIntoUse(Res, R, MBB, MBB.getFirstNonPHI(), Dead);
   }
 
-  // Second pass: Replace uses of virtual registers corresponding to DMs with FT registers
-  for (auto MI = MBB.begin() ; MI != MBB.end() ; ) {
-    MachineBasicBlock::iterator NMI = std::next(MI);
-
-    // look for usage of any of the virtual registers assigned to SSRs
-    for (auto operand = MI->operands_begin() ; operand != MI->operands_end() ; ++operand) {
-      if(!operand->isReg()) continue;
-      // check if operand is in any SSR list
-      for(unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) {
-        if(virtRegs[ssr_no].contains(operand->getReg())) {
-          LLVM_DEBUG(dbgs() << "Found use of operand " << operand->getReg() << " ssr: " << ssr_no << " in inst " <<  MI->getOpcode() << "\n");
-          // substitute with SSR register
-          MI->substituteRegister(operand->getReg(), ssr_regs[ssr_no], 0, *TRI);
-          // guard this block and add ssr regs to live in
-          MBB.addLiveIn(ssr_regs[ssr_no]);
+  // push of the PHI result
+  if (!MRI->hasOneNonDBGUser(Res))
+    return false;
+  MachineInstr &Push = *MRI->use_instr_nodbg_begin(Res);
+  R = getPushedSSRReg(Push);
+  if (!R || !isClearPath(MBB, MBB.getFirstNonPHI(), *Push.getParent(),
+                         Push.getIterator(), R))
+    return false;
+
+  // Check all incoming definitions first, the rewrite must not be partial.
+  for (auto &In : Incoming) {
+    MachineInstr *DefMI = MRI->getVRegDef(In.first);
+    if (!DefMI || DefMI->getParent() != In.second || DefMI->isCopy())
+      return false;
+    int DefIdx = DefMI->findRegisterDefOperandIdx(In.first);
+    if (DefIdx < 0 || !canUseSSRReg(*DefMI, DefIdx, R) ||
+        DefMI->readsRegister(R, TRI) ||
+        !isClearPath(*In.second, std::next(DefMI->getIterator()), *In.second,
+                     In.second->end(), R))
+      return false;
+  }
+
+  LLVM_DEBUG(dbgs() << "  merge push of " << printReg(R, TRI)
+                    << " through " << Phi);
+  SmallVector<Register, 4> Regs{Res};
+  for (auto &In : Incoming) {
+    MachineInstr *DefMI = MRI->getVRegDef(In.first);
+    MachineOperand &DefMO =
+        DefMI->getOperand(DefMI->findRegisterDefOperandIdx(In.first));
+    Regs.push_back(In.first);
+    DefMO.setReg(R);
+    DefMO.setIsDead(false);
+  }
+  dropDebugUses(Regs);
+  eraseDead({&Push, &Phi});
+  return true;
+}
+
+/// Merge the moves from and to the SSR data registers into the instructions
+/// consuming or producing the streamed values. This runs on SSA form and
+/// follows the values across basic blocks, through COPYs and PHIs.
+void RISCVExpandSSR::mergeSSRRegisters(MachineFunction &MF) {
+  MRI = &MF.getRegInfo();
+  TRI = MRI->getTargetRegisterInfo();
+
+  // The barrier expansion changed the CFG, compute the analyses here.
+  MachineDominatorTree DomTree(MF);
+  MachineLoopInfo LoopInfo(DomTree);
+  PostDomTreeBase<MachineBasicBlock> PostDomTree;
+  PostDomTree.recalculate(MF);
+  MDT = &DomTree;
+  MLI = &LoopInfo;
+  MPDT = &PostDomTree;
+
+  // PHIs first, afterwards the pops and pushes feeding them are gone.
+  SmallVector<MachineInstr *, 16> Phis;
+  for (auto &MBB : MF)
+    for (auto &Phi : MBB.phis())
+      Phis.push_back(&Phi);
+  for (MachineInstr *Phi : Phis)
+    mergePhi(*Phi);
+
+  SmallVector<MachineInstr *, 16> Moves;
+  for (auto &MBB : MF)
+    for (auto &MI : MBB)
+      if (getPoppedSSRReg(MI) || getPushedSSRReg(MI))
+        Moves.push_back(&MI);
+
+  for (MachineInstr *MI : Moves) {
+    SmallVector<MachineInstr *, 4> Dead{MI};
+    if (Register R = getPoppedSSRReg(*MI))
+      sinkPopIntoUse(MI->getOperand(0).getReg(), R, *MI->getParent(),
+                     std::next(MI->getIterator()), Dead);
+    else
+      hoistPushIntoDef(MI->getOperand(1).getReg(), getPushedSSRReg(*MI),
+                       *MI->getParent(), MI->getIterator(), Dead);
+  }
+
+  // merged uses and definitions need the SSR registers live-in
+  for (auto &MBB : MF) {
+    for (unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no) {
+      Register R = getSSRFtReg(ssr_no);
+      if (any_of(MBB, [&](const MachineInstr &MI) {
+            return MI.readsRegister(R, TRI);
+          }))
+        MBB.addLiveIn(R);
+    }
+    MBB.sortUniqueLiveIns();
+  }
+}
+
+/// Return 1 for an expanded SSR enable, -1 for a disable and 0 otherwise
+static int getSSRRegionEdge(const MachineInstr &MI) {
+  if (MI.getOpcode() != RISCV::CSRRSI && MI.getOpcode() != RISCV::CSRRCI)
+    return 0;
+  if (MI.getOperand(1).getImm() != 0x7C0 || MI.getOperand(2).getImm() != 1)
+    return 0;
+  return MI.getOpcode() == RISCV::CSRRSI ? 1 : -1;
+}
+
+/// Return whether the call \p MI may clobber an SSR data register. Under
+/// IPRA, its register mask only contains the registers written by the callee.
+static bool clobbersSSRRegs(const MachineInstr &MI) {
+  bool HasRegMask = false;
+  for (const MachineOperand &MO : MI.operands()) {
+    if (!MO.isRegMask())
+      continue;
+    HasRegMask = true;
+    for (unsigned n = 0; n != NUM_SSR; ++n)
+      if (MO.clobbersPhysReg(getSSRFtReg(n)))
+        return true;
+  }
+  return !HasRegMask;
+}
+
+/// Add the SSR data registers as live-in to all blocks which may be entered
+/// with streaming enabled, and pause the streams around the calls inside the
+/// regions which clobber them. Returns false if a streaming region contains a
+/// clobbering tail call, in which case the registers have to be reserved
+/// instead.
+bool RISCVExpandSSR::addRegionLiveIns(MachineFunction &MF) {
+  SmallPtrSet<MachineBasicBlock *, 16> EnabledIn;
+  SmallVector<MachineBasicBlock *, 16> Worklist;
+  for (auto &MBB : MF)
+    Worklist.push_back(&MBB);
+
+  // Forward dataflow: a block is entered enabled if any predecessor may leave
+  // it enabled.
+  while (!Worklist.empty()) {
+    MachineBasicBlock *MBB = Worklist.pop_back_val();
+    bool InRegion = EnabledIn.count(MBB);
+    for (auto &MI : *MBB)
+      if (int Edge = getSSRRegionEdge(MI))
+        InRegion = Edge > 0;
+    if (!InRegion)
+      continue;
+    for (MachineBasicBlock *Succ : MBB->successors())
+      if (EnabledIn.insert(Succ).second)
+        Worklist.push_back(Succ);
+  }
+
+  // Collect the calls which have to pause the streams before changing
+  // anything, the registers may still have to be reserved.
+  SmallVector<MachineInstr *, 8> Calls;
+  for (auto &MBB : MF) {
+    bool InRegion = EnabledIn.count(&MBB);
+    for (auto &MI : MBB) {
+      if (int Edge = getSSRRegionEdge(MI))
+        InRegion = Edge > 0;
+      else if (InRegion && MI.isCall()) {
+        if (!clobbersSSRRegs(MI)) {
+          LLVM_DEBUG(dbgs() << "Streaming across call: " << MI);
+          continue;
+        }
+        if (MI.isReturn()) {
+          LLVM_DEBUG(dbgs() << "Tail call in SSR region, reserving registers: "
+                            << MI);
+          return false;
         }
+        Calls.push_back(&MI);
       }
     }
-    MI = NMI;    
   }
-  MBB.sortUniqueLiveIns();
+
+  for (MachineInstr *Call : Calls) {
+    LLVM_DEBUG(dbgs() << "Pausing streams around call: " << *Call);
+    MachineBasicBlock &MBB = *Call->getParent();
+    buildEnDis(MBB, Call->getIterator(), Call->getDebugLoc(), false);
+    buildEnDis(MBB, std::next(Call->getIterator()), Call->getDebugLoc(), true);
+  }
+
+  for (MachineBasicBlock *MBB : EnabledIn) {
+    for (unsigned ssr_no = 0; ssr_no < NUM_SSR; ++ssr_no)
+      MBB->addLiveIn(getSSRFtReg(ssr_no));
+    MBB->sortUniqueLiveIns();
+  }
+  LLVM_DEBUG(dbgs() << "SSR regions span " << EnabledIn.size() << " blocks\n");
+  return true;
 }
 
 /// Gather parameters for the register merging
@@ -20,9 +20,23 @@
 #include "llvm/CodeGen/RegisterScavenging.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/MC/MCDwarf.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace llvm;
 
+static cl::opt<bool> L1StackHotFunctions(
+    "riscv-l1-stack", cl::Hidden, cl::init(false),
+    cl::desc("Place the frames of hot functions on the per-core L1 stacks"));
+
+static cl::opt<unsigned> L1StackSize(
+    "riscv-l1-stack-size", cl::Hidden, cl::init(1024),
+    cl::desc("Size in bytes of the L1 stack of a core, a power of two"));
+
+static cl::opt<unsigned> L1StackCores(
+    "riscv-l1-stack-cores", cl::Hidden, cl::init(16),
+    cl::desc("Number of per-core L1 stacks, a power of two. The stack of a "
+             "core is selected by the low bits of mhartid"));
+
 // For now we use x18, a.k.a s2, as pointer to shadow call stack.
 // User should explicitly set -ffixed-x18 and not use x18 in their asm.
 static void emitSCSPrologue(MachineFunction &MF, MachineBasicBlock &MBB,
@@ -303,6 +317,123 @@ getNonLibcallCSI(const std::vector<CalleeSavedInfo> &CSI) {
   return NonLibcallCSI;
 }
 
+bool RISCVFrameLowering::usesL1Stack(const MachineFunction &MF) const {
+  const Function &F = MF.getFunction();
+  if (!F.hasFnAttribute("riscv-l1-stack") &&
+      !(L1StackHotFunctions && RISCVMachineFunctionInfo::isHotFunction(F)))
+    return false;
+  if (!isPowerOf2_32(L1StackSize) || L1StackSize < getStackAlign().value() ||
+      !isPowerOf2_32(L1StackCores) || L1StackCores > 2048)
+    report_fatal_error("invalid size or number of the per-core L1 stacks");
+
+  // Incoming arguments on the stack, the vararg save area and the spill
+  // slots of the save/restore libcalls are fixed objects relative to the
+  // stack pointer on entry, which stay behind on the original stack.
+  const MachineFrameInfo &MFI = MF.getFrameInfo();
+  const auto *RVFI = MF.getInfo<RISCVMachineFunctionInfo>();
+  return !F.isVarArg() && MFI.getNumFixedObjects() == 0 &&
+         !F.hasFnAttribute("interrupt") && !RVFI->useSaveRestoreLibCalls(MF);
+}
+
+// Switch to the L1 stack of the core, unless the stack pointer already
+// points into it, e.g. in a callee of a function using the L1 stack. The old
+// stack pointer is saved at the top of the new stack:
+//
+//   csrr  t0, mhartid
+//   andi  t0, t0, Cores - 1
+//   addi  t0, t0, 1
+//   slli  t0, t0, log2(Size)
+//   lui   t1, %hi(__l1_stack_start)
+//   add   t0, t0, t1
+//   addi  t0, t0, %lo(__l1_stack_start)  # top of the stack of the core
+//   sub   t1, t0, sp
+//   addi  t1, t1, -1
+//   srli  t1, t1, log2(Size)             # zero iff sp is in the stack
+//   snez  t1, t1
+//   neg   t1, t1
+//   xor   t0, t0, sp
+//   and   t0, t0, t1
+//   xor   t0, t0, sp                     # the new stack pointer
+//   s[w|d] sp, -[4|8](t0)
+//   addi  sp, t0, -16
+//
+// The linker reserves Cores stacks of Size bytes from __l1_stack_start.
+void RISCVFrameLowering::emitL1StackSwitch(MachineBasicBlock &MBB,
+                                           MachineBasicBlock::iterator MBBI,
+                                           const DebugLoc &DL) const {
+  const RISCVInstrInfo *TII = STI.getInstrInfo();
+  Register SPReg = getSPReg(STI);
+  Register Top = RISCV::X5, Tmp = RISCV::X6;
+  unsigned SizeLog2 = Log2_32(L1StackSize);
+  int64_t SlotSize = STI.getXLen() / 8;
+  const char *Start = "__l1_stack_start";
+  auto Flag = MachineInstr::FrameSetup;
+
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::CSRRS), Top)
+      .addImm(RISCVSysReg::lookupSysRegByName("MHARTID")->Encoding)
+      .addReg(RISCV::X0)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ANDI), Top)
+      .addReg(Top)
+      .addImm(L1StackCores - 1)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), Top)
+      .addReg(Top)
+      .addImm(1)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::SLLI), Top)
+      .addReg(Top)
+      .addImm(SizeLog2)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::LUI), Tmp)
+      .addExternalSymbol(Start, RISCVII::MO_HI)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADD), Top)
+      .addReg(Top)
+      .addReg(Tmp)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), Top)
+      .addReg(Top)
+      .addExternalSymbol(Start, RISCVII::MO_LO)
+      .setMIFlag(Flag);
+
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::SUB), Tmp)
+      .addReg(Top)
+      .addReg(SPReg)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), Tmp)
+      .addReg(Tmp)
+      .addImm(-1)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::SRLI), Tmp)
+      .addReg(Tmp)
+      .addImm(SizeLog2)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::SLTU), Tmp)
+      .addReg(RISCV::X0)
+      .addReg(Tmp)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::SUB), Tmp)
+      .addReg(RISCV::X0)
+      .addReg(Tmp)
+      .setMIFlag(Flag);
+  for (unsigned Opc : {RISCV::XOR, RISCV::AND, RISCV::XOR})
+    BuildMI(MBB, MBBI, DL, TII->get(Opc), Top)
+        .addReg(Top)
+        .addReg(Opc == RISCV::AND ? Tmp : SPReg)
+        .setMIFlag(Flag);
+
+  BuildMI(MBB, MBBI, DL, TII->get(SlotSize == 8 ? RISCV::SD : RISCV::SW))
+      .addReg(SPReg)
+      .addReg(Top)
+      .addImm(-SlotSize)
+      .setMIFlag(Flag);
+  BuildMI(MBB, MBBI, DL, TII->get(RISCV::ADDI), SPReg)
+      .addReg(Top)
+      .addImm(-(int64_t)getStackAlign().value())
+      .setMIFlag(Flag);
+}
+
 void RISCVFrameLowering::emitPrologue(MachineFunction &MF,
                                       MachineBasicBlock &MBB) const {
   MachineFrameInfo &MFI = MF.getFrameInfo();
@@ -375,6 +506,12 @@ void RISCVFrameLowering::emitPrologue(MachineFunction &MF,
     MF.getFunction().getContext().diagnose(DiagnosticInfoUnsupported{
         MF.getFunction(), "Stack pointer required, but has been reserved."});
 
+  // Place the frame, and those of the callees, on the L1 stack. The CFA
+  // described below is the one of the new stack, unwinding does not go past
+  // the frame.
+  if (usesL1Stack(MF))
+    emitL1StackSwitch(MBB, MBBI, DL);
+
   uint64_t FirstSPAdjustAmount = getFirstSPAdjustAmount(MF);
   // Split the SP adjustment to reduce the offsets of callee saved spill.
   if (FirstSPAdjustAmount) {
@@ -564,6 +701,17 @@ void RISCVFrameLowering::emitEpilogue(MachineFunction &MF,
   // Deallocate stack
   adjustReg(MBB, MBBI, DL, SPReg, SPReg, StackSize, MachineInstr::FrameDestroy);
 
+  // Return to the stack saved by emitL1StackSwitch.
+  if ((RealStackSize != 0 || MFI.adjustsStack()) && usesL1Stack(MF)) {
+    const RISCVInstrInfo *TII = STI.getInstrInfo();
+    int64_t SlotSize = STI.getXLen() / 8;
+    BuildMI(MBB, MBBI, DL, TII->get(SlotSize == 8 ? RISCV::LD : RISCV::LW),
+            SPReg)
+        .addReg(SPReg)
+        .addImm(getStackAlign().value() - SlotSize)
+        .setMIFlag(MachineInstr::FrameDestroy);
+  }
+
   // Emit epilogue for shadow call stack.
   emitSCSEpilogue(MF, MBB, MBBI, DL);
 }
@@ -842,17 +990,19 @@ bool RISCVFrameLowering::canUseAsPrologue(const MachineBasicBlock &MBB) const {
   MachineBasicBlock *TmpMBB = const_cast<MachineBasicBlock *>(&MBB);
   const MachineFunction *MF = MBB.getParent();
   const auto *RVFI = MF->getInfo<RISCVMachineFunctionInfo>();
+  bool L1Stack = usesL1Stack(*MF);
 
-  if (!RVFI->useSaveRestoreLibCalls(*MF))
+  if (!RVFI->useSaveRestoreLibCalls(*MF) && !L1Stack)
     return true;
 
   // Inserting a call to a __riscv_save libcall requires the use of the register
   // t0 (X5) to hold the return address. Therefore if this register is already
-  // used we can't insert the call.
+  // used we can't insert the call. The switch to the L1 stack uses t0 and t1
+  // (X6).
 
   RegScavenger RS;
   RS.enterBasicBlock(*TmpMBB);
-  return !RS.isRegUsed(RISCV::X5);
+  return !RS.isRegUsed(RISCV::X5) && (!L1Stack || !RS.isRegUsed(RISCV::X6));
 }
 
 bool RISCVFrameLowering::canUseAsEpilogue(const MachineBasicBlock &MBB) const {
@@ -65,6 +65,11 @@ public:
   bool canUseAsPrologue(const MachineBasicBlock &MBB) const override;
   bool canUseAsEpilogue(const MachineBasicBlock &MBB) const override;
 
+  // Returns true if the frame of the function is placed on the L1 stack of
+  // the core, i.e. the function has the "riscv-l1-stack" attribute, or is hot
+  // and -riscv-l1-stack is given.
+  bool usesL1Stack(const MachineFunction &MF) const;
+
 protected:
   const RISCVSubtarget &STI;
 
@@ -73,6 +78,9 @@ private:
   void adjustReg(MachineBasicBlock &MBB, MachineBasicBlock::iterator MBBI,
                  const DebugLoc &DL, Register DestReg, Register SrcReg,
                  int64_t Val, MachineInstr::MIFlag Flag) const;
+  void emitL1StackSwitch(MachineBasicBlock &MBB,
+                         MachineBasicBlock::iterator MBBI,
+                         const DebugLoc &DL) const;
 };
 }
 #endif
@@ -24,6 +24,7 @@
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/TargetLoweringObjectFileImpl.h"
 #include "llvm/CodeGen/ValueTypes.h"
@@ -93,6 +94,12 @@ RISCVTargetLowering::RISCVTargetLowering(const TargetMachine &TM,
     addRegisterClass(MVT::v2i16, &RISCV::PulpV2RegClass);
     addRegisterClass(MVT::v4i8, &RISCV::PulpV4RegClass);
   }
+  if (Subtarget.hasPackedV2F32())
+    addRegisterClass(MVT::v2f32, &RISCV::FPR64V2RegClass);
+  if (Subtarget.hasPackedV4F16())
+    addRegisterClass(MVT::v4f16, &RISCV::FPR64V4RegClass);
+  if (Subtarget.hasBF16())
+    addRegisterClass(MVT::bf16, &RISCV::FPR16BFRegClass);
 
   if (Subtarget.hasStdExtV()) {
     addRegisterClass(RISCVVMVTs::vbool64_t, &RISCV::VRRegClass);
@@ -256,6 +263,8 @@ RISCVTargetLowering::RISCVTargetLowering(const TargetMachine &TM,
     setOperationAction(ISD::SMAX, XLenVT, Legal);
     setOperationAction(ISD::UMIN, XLenVT, Legal);
     setOperationAction(ISD::UMAX, XLenVT, Legal);
+    // abs is max(x, -x).
+    setOperationAction(ISD::ABS, XLenVT, Legal);
   } else {
     setOperationAction(ISD::CTTZ, XLenVT, Expand);
     setOperationAction(ISD::CTLZ, XLenVT, Expand);
@@ -376,6 +385,7 @@ RISCVTargetLowering::RISCVTargetLowering(const TargetMachine &TM,
     for (auto VT : {MVT::v2i16, MVT::v4i8}){
       setOperationAction(ISD::SPLAT_VECTOR, VT, Legal);
       setOperationAction(ISD::VECREDUCE_ADD, VT, Legal);
+      setOperationAction(ISD::VECTOR_SHUFFLE, VT, Custom);
       setOperationPromotedToType(ISD::LOAD, VT, MVT::i32);
       setOperationPromotedToType(ISD::STORE, VT, MVT::i32);
       setOperationAction(ISD::VSELECT, VT, Expand);
@@ -407,6 +417,65 @@ RISCVTargetLowering::RISCVTargetLowering(const TargetMachine &TM,
     setBooleanVectorContents(ZeroOrNegativeOneBooleanContent);
   }
 
+  // The packed SIMD formats of the smallfloat extensions only provide the
+  // arithmetic, everything else goes through the scalar FPU or memory.
+  SmallVector<MVT, 2> PackedFPVTs;
+  if (Subtarget.hasPackedV2F32())
+    PackedFPVTs.push_back(MVT::v2f32);
+  if (Subtarget.hasPackedV4F16())
+    PackedFPVTs.push_back(MVT::v4f16);
+  for (MVT VT : PackedFPVTs) {
+    for (unsigned Opc = 0; Opc < ISD::BUILTIN_OP_END; ++Opc)
+      setOperationAction(Opc, VT, Expand);
+    for (auto Opc : {ISD::FADD, ISD::FSUB, ISD::FMUL, ISD::FDIV, ISD::FSQRT,
+                     ISD::FMA, ISD::FMINNUM, ISD::FMAXNUM, ISD::FNEG,
+                     ISD::FABS, ISD::FCOPYSIGN, ISD::BITCAST,
+                     ISD::BUILD_VECTOR, ISD::SPLAT_VECTOR})
+      setOperationAction(Opc, VT, Legal);
+    setOperationAction(ISD::EXTRACT_VECTOR_ELT, VT, Custom);
+    setOperationAction(ISD::VECTOR_SHUFFLE, VT, Custom);
+    setOperationPromotedToType(ISD::LOAD, VT, MVT::f64);
+    setOperationPromotedToType(ISD::STORE, VT, MVT::f64);
+    for (MVT MemVT : MVT::fp_fixedlen_vector_valuetypes()) {
+      setLoadExtAction(ISD::EXTLOAD, VT, MemVT, Expand);
+      setTruncStoreAction(VT, MemVT, Expand);
+    }
+  }
+
+  // The alternate half format is bfloat16. Its arithmetic instructions depend
+  // on the fmode CSR, so only the format-independent operations are native and
+  // everything else is done in single precision. The conversions are integer
+  // shifts and rounding of the bit patterns.
+  if (Subtarget.hasBF16()) {
+    for (unsigned Opc = 0; Opc < ISD::BUILTIN_OP_END; ++Opc)
+      setOperationAction(Opc, MVT::bf16, Expand);
+    for (auto Opc : {ISD::FNEG, ISD::FABS, ISD::BITCAST})
+      setOperationAction(Opc, MVT::bf16, Legal);
+    setOperationAction(ISD::FCOPYSIGN, MVT::bf16, Custom);
+    setOperationAction(ISD::FP_ROUND, MVT::bf16, Custom);
+    for (auto Opc : {ISD::LOAD, ISD::STORE, ISD::SELECT})
+      setOperationPromotedToType(Opc, MVT::bf16, MVT::f16);
+    for (auto Opc :
+         {ISD::FADD,   ISD::FSUB,   ISD::FMUL,       ISD::FDIV,   ISD::FREM,
+          ISD::FMA,    ISD::FSQRT,  ISD::FMINNUM,    ISD::FMAXNUM, ISD::FFLOOR,
+          ISD::FCEIL,  ISD::FTRUNC, ISD::FRINT,      ISD::FNEARBYINT,
+          ISD::FROUND, ISD::FROUNDEVEN, ISD::FSIN,   ISD::FCOS,   ISD::FPOW,
+          ISD::FLOG,   ISD::FLOG2,  ISD::FLOG10,     ISD::FEXP,   ISD::FEXP2,
+          ISD::SETCC,  ISD::BR_CC})
+      setOperationPromotedToType(Opc, MVT::bf16, MVT::f32);
+    for (MVT VT : {MVT::f32, MVT::f64}) {
+      setOperationAction(ISD::FP_EXTEND, VT, Custom);
+      setLoadExtAction(ISD::EXTLOAD, VT, MVT::bf16, Expand);
+      setTruncStoreAction(VT, MVT::bf16, Expand);
+    }
+    // The integer conversions are keyed on the integer type, so they are
+    // rewritten to single precision before legalization.
+    setTargetDAGCombine(ISD::FP_TO_SINT);
+    setTargetDAGCombine(ISD::FP_TO_UINT);
+    setTargetDAGCombine(ISD::SINT_TO_FP);
+    setTargetDAGCombine(ISD::UINT_TO_FP);
+  }
+
   if (Subtarget.hasStdExtA()) {
     setMaxAtomicSizeInBitsSupported(Subtarget.getXLen());
     setMinCmpXchgSizeInBits(32);
@@ -639,6 +708,14 @@ bool RISCVTargetLowering::isLegalAddressingMode(const DataLayout &DL,
     if (!AM.HasBaseReg) // allow "r+i".
       break;
     return false; // disallow "r+r" or "r+r+i".
+  case 2:
+  case 4:
+  case 8:
+    // Zba computes "r+s*r" with a single sh[123]add, which makes the scaled
+    // index as cheap as the pointer increments LSR would otherwise create.
+    if (Subtarget.hasStdExtZba() && AM.HasBaseReg)
+      break;
+    return false;
   default:
     return false;
   }
@@ -646,6 +723,15 @@ bool RISCVTargetLowering::isLegalAddressingMode(const DataLayout &DL,
   return true;
 }
 
+int RISCVTargetLowering::getScalingFactorCost(const DataLayout &DL,
+                                              const AddrMode &AM, Type *Ty,
+                                              unsigned AS) const {
+  if (!isLegalAddressingMode(DL, AM, Ty, AS))
+    return -1;
+  // The sh[123]add is not folded into the memory access.
+  return AM.Scale != 0 ? 1 : 0;
+}
+
 bool RISCVTargetLowering::isLegalICmpImmediate(int64_t Imm) const {
   return isInt<12>(Imm);
 }
@@ -704,6 +790,8 @@ bool RISCVTargetLowering::isFPImmLegal(const APFloat &Imm, EVT VT,
                                        bool ForCodeSize) const {
   if (VT == MVT::f16 && !Subtarget.hasStdExtZfh())
     return false;
+  if (VT == MVT::bf16 && !Subtarget.hasBF16())
+    return false;
   if (VT == MVT::f32 && !Subtarget.hasStdExtF())
     return false;
   if (VT == MVT::f64 && !Subtarget.hasStdExtD())
@@ -800,6 +888,13 @@ SDValue RISCVTargetLowering::LowerOperation(SDValue Op,
           DAG.getNode(ISD::ANY_EXTEND, DL, Subtarget.getXLenVT(), Op0);
       SDValue FPConv = DAG.getNode(RISCVISD::FMV_H_X, DL, MVT::f16, NewOp0);
       return FPConv;
+    } else if (Op.getValueType() == MVT::bf16 && Subtarget.hasBF16()) {
+      if (Op0.getValueType() != MVT::i16)
+        return SDValue();
+      SDValue NewOp0 =
+          DAG.getNode(ISD::ANY_EXTEND, DL, Subtarget.getXLenVT(), Op0);
+      SDValue FPConv = DAG.getNode(RISCVISD::FMV_H_X, DL, MVT::f16, NewOp0);
+      return DAG.getNode(ISD::BITCAST, DL, MVT::bf16, FPConv);
     } else if (Op.getValueType() == MVT::f32 && Subtarget.is64Bit() &&
                Subtarget.hasStdExtF()) {
       if (Op0.getValueType() != MVT::i32)
@@ -811,6 +906,24 @@ SDValue RISCVTargetLowering::LowerOperation(SDValue Op,
     }
     return SDValue();
   }
+  case ISD::FP_EXTEND:
+    if (Op.getOperand(0).getValueType() != MVT::bf16)
+      return Op;
+    return lowerBF16_FP_EXTEND(Op, DAG);
+  case ISD::FP_ROUND:
+    return lowerBF16_FP_ROUND(Op, DAG);
+  case ISD::FCOPYSIGN: {
+    // Only the sign of another bf16 is injected directly, other signs are
+    // copied in single precision.
+    SDValue Sign = Op.getOperand(1);
+    if (Sign.getValueType() == MVT::bf16)
+      return Op;
+    SDLoc DL(Op);
+    SDValue Ext = DAG.getNode(ISD::FP_EXTEND, DL, MVT::f32, Op.getOperand(0));
+    SDValue CopySign = DAG.getNode(ISD::FCOPYSIGN, DL, MVT::f32, Ext, Sign);
+    return DAG.getNode(ISD::FP_ROUND, DL, MVT::bf16, CopySign,
+                       DAG.getIntPtrConstant(1, DL));
+  }
   case ISD::INTRINSIC_WO_CHAIN:
     return LowerINTRINSIC_WO_CHAIN(Op, DAG);
   case ISD::INTRINSIC_W_CHAIN:
@@ -875,7 +988,14 @@ SDValue RISCVTargetLowering::LowerOperation(SDValue Op,
   case ISD::INSERT_VECTOR_ELT:
     return lowerINSERT_VECTOR_ELT(Op, DAG);
   case ISD::EXTRACT_VECTOR_ELT:
+    if (Op.getOperand(0).getValueType() == MVT::v2f32 ||
+        Op.getOperand(0).getValueType() == MVT::v4f16)
+      return lowerPackedFPEXTRACT_VECTOR_ELT(Op, DAG);
     return lowerEXTRACT_VECTOR_ELT(Op, DAG);
+  case ISD::VECTOR_SHUFFLE:
+    if (Op.getValueType() == MVT::v2f32 || Op.getValueType() == MVT::v4f16)
+      return lowerPackedFPVECTOR_SHUFFLE(Op, DAG);
+    return lowerPULPVECTOR_SHUFFLE(Op, DAG);
   case ISD::VSCALE: {
     MVT VT = Op.getSimpleValueType();
     SDLoc DL(Op);
@@ -1493,6 +1613,286 @@ SDValue RISCVTargetLowering::lowerEXTRACT_VECTOR_ELT(SDValue Op,
                      DAG.getConstant(0, DL, Subtarget.getXLenVT()));
 }
 
+// Lower a single source shuffle of the PULP packed SIMD vector Src, whose
+// Mask only refers to the elements of Src, to a PV_SHUFFLE node.
+static SDValue getPULPShuffle(SDValue Src, ArrayRef<int> Mask, const SDLoc &DL,
+                              SelectionDAG &DAG, MVT XLenVT) {
+  unsigned NumElts = Mask.size();
+  unsigned SelBits = Log2_32(NumElts);
+  uint64_t Sel = 0;
+  bool IsIdentity = true;
+  for (unsigned i = 0; i != NumElts; ++i) {
+    if (Mask[i] < 0) {
+      Sel |= i << (i * SelBits);
+      continue;
+    }
+    IsIdentity &= unsigned(Mask[i]) == i;
+    Sel |= uint64_t(Mask[i]) << (i * SelBits);
+  }
+  if (IsIdentity)
+    return Src;
+  return DAG.getNode(RISCVISD::PV_SHUFFLE, DL, Src.getValueType(), Src,
+                     DAG.getConstant(Sel, DL, XLenVT));
+}
+
+// Lower a shuffle of PULP packed SIMD vectors. Single source shuffles map to
+// pv.shuffle.sci. For two sources, the cheapest of these is picked:
+//  - pv.shuffle2 with a selector constant,
+//  - inserting the elements of one source into the other one, shuffled if
+//    needed, with pv.insert,
+//  - for halfwords, packing both elements with pv.pack.h.
+// Elements other than the first one of a source are shifted into place for
+// pv.insert and pv.pack.h, as they only read the low bits of the scalar.
+SDValue RISCVTargetLowering::lowerPULPVECTOR_SHUFFLE(SDValue Op,
+                                                     SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  MVT VT = Op.getSimpleValueType();
+  assert((VT == MVT::v2i16 || VT == MVT::v4i8) &&
+         "Unexpected VECTOR_SHUFFLE lowering");
+  MVT XLenVT = Subtarget.getXLenVT();
+  unsigned NumElts = VT.getVectorNumElements();
+  unsigned EltBits = VT.getScalarSizeInBits();
+  SDValue Srcs[2] = {Op.getOperand(0), Op.getOperand(1)};
+  SmallVector<int, 4> Mask(cast<ShuffleVectorSDNode>(Op)->getMask().begin(),
+                           cast<ShuffleVectorSDNode>(Op)->getMask().end());
+  if (Srcs[0] == Srcs[1])
+    for (int &M : Mask)
+      if (M >= 0)
+        M %= NumElts;
+
+  // The elements taken from each source, in place in the result.
+  SmallVector<int, 4> SrcMasks[2] = {SmallVector<int, 4>(NumElts, -1),
+                                     SmallVector<int, 4>(NumElts, -1)};
+  for (unsigned i = 0; i != NumElts; ++i)
+    if (Mask[i] >= 0)
+      SrcMasks[Mask[i] / NumElts][i] = Mask[i] % NumElts;
+  bool UsesSrc[2] = {any_of(SrcMasks[0], [](int M) { return M >= 0; }),
+                     any_of(SrcMasks[1], [](int M) { return M >= 0; })};
+  if (!UsesSrc[0] && !UsesSrc[1])
+    return DAG.getUNDEF(VT);
+  if (!UsesSrc[1])
+    return getPULPShuffle(Srcs[0], SrcMasks[0], DL, DAG, XLenVT);
+  if (!UsesSrc[0])
+    return getPULPShuffle(Srcs[1], SrcMasks[1], DL, DAG, XLenVT);
+
+  // pv.shuffle2 needs the selector in a register, which is loop invariant
+  // most of the time.
+  uint64_t Sel2 = 0;
+  for (unsigned i = 0; i != NumElts; ++i)
+    if (Mask[i] >= 0)
+      Sel2 |= uint64_t(Mask[i]) << (i * EltBits);
+  RISCVMatInt::InstSeq Seq;
+  RISCVMatInt::generateInstSeq(Sel2, Subtarget.is64Bit(), Seq);
+  unsigned Shuffle2Cost = 1 + Seq.size();
+
+  // Inserting an element costs the pv.insert, and a shift unless it is the
+  // first one of its source.
+  auto getInsertCost = [&](ArrayRef<int> SrcMask) {
+    unsigned Cost = 0;
+    for (int M : SrcMask)
+      if (M >= 0)
+        Cost += M ? 2 : 1;
+    return Cost;
+  };
+  unsigned InsertCost[2];
+  for (unsigned Base = 0; Base != 2; ++Base) {
+    bool InPlace = true;
+    for (unsigned i = 0; i != NumElts; ++i)
+      InPlace &= SrcMasks[Base][i] < 0 || unsigned(SrcMasks[Base][i]) == i;
+    InsertCost[Base] = !InPlace + getInsertCost(SrcMasks[1 - Base]);
+  }
+  unsigned Base = InsertCost[1] < InsertCost[0];
+
+  // Both elements of a halfword vector come from different sources here.
+  unsigned PackCost = VT == MVT::v2i16 ? 1 + (Mask[0] % NumElts != 0) +
+                                             (Mask[1] % NumElts != 0)
+                                       : ~0U;
+
+  // Return element Idx of Src in the low bits of a scalar.
+  auto getElement = [&](SDValue Src, unsigned Idx) {
+    SDValue Elt = DAG.getBitcast(XLenVT, Src);
+    if (Idx)
+      Elt = DAG.getNode(ISD::SRL, DL, XLenVT, Elt,
+                        DAG.getConstant(Idx * EltBits, DL, XLenVT));
+    return Elt;
+  };
+
+  if (PackCost <= InsertCost[Base] && PackCost <= Shuffle2Cost)
+    return DAG.getNode(
+        ISD::BUILD_VECTOR, DL, VT,
+        getElement(Srcs[Mask[0] / NumElts], Mask[0] % NumElts),
+        getElement(Srcs[Mask[1] / NumElts], Mask[1] % NumElts));
+
+  if (InsertCost[Base] <= Shuffle2Cost) {
+    SDValue Res = getPULPShuffle(Srcs[Base], SrcMasks[Base], DL, DAG, XLenVT);
+    for (unsigned i = 0; i != NumElts; ++i) {
+      int M = SrcMasks[1 - Base][i];
+      if (M < 0)
+        continue;
+      Res = DAG.getNode(ISD::INSERT_VECTOR_ELT, DL, VT, Res,
+                        getElement(Srcs[1 - Base], M),
+                        DAG.getConstant(i, DL, XLenVT));
+    }
+    return Res;
+  }
+
+  SDValue Sel = DAG.getBitcast(VT, DAG.getConstant(Sel2, DL, XLenVT));
+  return DAG.getNode(RISCVISD::PV_SHUFFLE2, DL, VT, Srcs[0], Srcs[1], Sel);
+}
+
+// The first element of a packed smallfloat vector is the scalar register
+// itself. The others are loaded again if the vector comes from memory, and
+// otherwise left to the default expansion through the stack.
+SDValue
+RISCVTargetLowering::lowerPackedFPEXTRACT_VECTOR_ELT(SDValue Op,
+                                                     SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  auto *Idx = dyn_cast<ConstantSDNode>(Op.getOperand(1));
+  if (!Idx)
+    return SDValue();
+  if (Idx->isNullValue())
+    return Op;
+
+  // Loads of packed vectors are promoted to f64.
+  SDValue Vec = peekThroughBitcasts(Op.getOperand(0));
+  auto *Ld = dyn_cast<LoadSDNode>(Vec);
+  if (!Ld || !ISD::isNormalLoad(Ld) || !Ld->isSimple())
+    return SDValue();
+  EVT EltVT = Op.getValueType();
+  uint64_t Offset = Idx->getZExtValue() * EltVT.getStoreSize();
+  if (Offset >= Ld->getMemoryVT().getStoreSize())
+    return SDValue();
+  SDValue Ptr = DAG.getMemBasePlusOffset(Ld->getBasePtr(),
+                                         TypeSize::Fixed(Offset), DL);
+  SDValue Elt = DAG.getLoad(EltVT, DL, Ld->getChain(), Ptr,
+                            Ld->getPointerInfo().getWithOffset(Offset),
+                            commonAlignment(Ld->getAlign(), Offset),
+                            Ld->getMemOperand()->getFlags(), Ld->getAAInfo());
+  DAG.makeEquivalentMemoryOrdering(Ld, Elt);
+  return Elt;
+}
+
+// Shuffles of packed smallfloat vectors are expanded element by element,
+// except for the alternating additions and subtractions of complex
+// arithmetic. Those become a single fma with a vector of ones of the right
+// signs: multiplying by +-1 is exact, so the fma rounds like the separate
+// fadd and fsub.
+SDValue
+RISCVTargetLowering::lowerPackedFPVECTOR_SHUFFLE(SDValue Op,
+                                                 SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  MVT VT = Op.getSimpleValueType();
+  ArrayRef<int> Mask = cast<ShuffleVectorSDNode>(Op)->getMask();
+  unsigned NumElts = VT.getVectorNumElements();
+  SDValue Add = Op.getOperand(0), Sub = Op.getOperand(1);
+  bool SubFirst = Add.getOpcode() == ISD::FSUB;
+  if (SubFirst)
+    std::swap(Add, Sub);
+  if (Add.getOpcode() != ISD::FADD || Sub.getOpcode() != ISD::FSUB)
+    return SDValue();
+  SDValue A = Sub.getOperand(0), B = Sub.getOperand(1);
+  if (!((Add.getOperand(0) == A && Add.getOperand(1) == B) ||
+        (Add.getOperand(0) == B && Add.getOperand(1) == A)))
+    return SDValue();
+
+  EVT EltVT = VT.getVectorElementType();
+  SmallVector<SDValue, 4> Signs;
+  for (unsigned i = 0; i != NumElts; ++i) {
+    if (Mask[i] < 0) {
+      Signs.push_back(DAG.getUNDEF(EltVT));
+      continue;
+    }
+    if (unsigned(Mask[i]) % NumElts != i)
+      return SDValue();
+    bool FromSub = (unsigned(Mask[i]) >= NumElts) != SubFirst;
+    Signs.push_back(DAG.getConstantFP(FromSub ? -1.0 : 1.0, DL, EltVT));
+  }
+  return DAG.getNode(ISD::FMA, DL, VT, B, DAG.getBuildVector(VT, DL, Signs),
+                     A);
+}
+
+// Move the bits of an f32 into the low 32 bits of a GPR.
+static SDValue getF32Bits(SDValue Val, const SDLoc &DL, SelectionDAG &DAG,
+                          const RISCVSubtarget &Subtarget) {
+  if (Subtarget.is64Bit())
+    return DAG.getNode(RISCVISD::FMV_X_ANYEXTW_RV64, DL, MVT::i64, Val);
+  return DAG.getNode(ISD::BITCAST, DL, MVT::i32, Val);
+}
+
+// A bfloat16 is the upper half of an f32, extending it shifts the bits into
+// place.
+SDValue RISCVTargetLowering::lowerBF16_FP_EXTEND(SDValue Op,
+                                                 SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  MVT XLenVT = Subtarget.getXLenVT();
+  SDValue Half = DAG.getNode(ISD::BITCAST, DL, MVT::f16, Op.getOperand(0));
+  SDValue Bits = DAG.getNode(RISCVISD::FMV_X_ANYEXTH, DL, XLenVT, Half);
+  Bits = DAG.getNode(ISD::SHL, DL, XLenVT, Bits,
+                     DAG.getConstant(16, DL, XLenVT));
+  SDValue Ext;
+  if (Subtarget.is64Bit())
+    Ext = DAG.getNode(RISCVISD::FMV_W_X_RV64, DL, MVT::f32, Bits);
+  else
+    Ext = DAG.getNode(ISD::BITCAST, DL, MVT::f32, Bits);
+  if (Op.getValueType() == MVT::f64)
+    Ext = DAG.getNode(ISD::FP_EXTEND, DL, MVT::f64, Ext);
+  return Ext;
+}
+
+// Round to bfloat16 to nearest even on the bits of an f32, NaNs are quieted.
+// Doubles are first rounded to single precision with round-to-odd, which is
+// exact enough for the second rounding to give the correctly rounded result.
+SDValue RISCVTargetLowering::lowerBF16_FP_ROUND(SDValue Op,
+                                                SelectionDAG &DAG) const {
+  SDLoc DL(Op);
+  MVT XLenVT = Subtarget.getXLenVT();
+  SDValue Src = Op.getOperand(0);
+  assert((Src.getValueType() == MVT::f32 ||
+          (Src.getValueType() == MVT::f64 && Subtarget.hasStdExtD())) &&
+         "Unexpected custom legalisation");
+
+  SDValue One = DAG.getConstant(1, DL, XLenVT);
+  SDValue Sixteen = DAG.getConstant(16, DL, XLenVT);
+  SDValue Single = Src;
+  if (Src.getValueType() == MVT::f64)
+    Single = DAG.getNode(ISD::FP_ROUND, DL, MVT::f32, Src,
+                         DAG.getIntPtrConstant(0, DL));
+  SDValue Bits = getF32Bits(Single, DL, DAG, Subtarget);
+  if (Src.getValueType() == MVT::f64) {
+    // An inexact result with an even mantissa moves to its odd neighbour
+    // towards the source.
+    SDValue Back = DAG.getNode(ISD::FP_EXTEND, DL, MVT::f64, Single);
+    SDValue Inexact = DAG.getSetCC(DL, XLenVT, Back, Src, ISD::SETONE);
+    SDValue Even = DAG.getSetCC(
+        DL, XLenVT, DAG.getNode(ISD::AND, DL, XLenVT, Bits, One),
+        DAG.getConstant(0, DL, XLenVT), ISD::SETEQ);
+    SDValue Away = DAG.getSetCC(DL, XLenVT,
+                                DAG.getNode(ISD::FABS, DL, MVT::f64, Back),
+                                DAG.getNode(ISD::FABS, DL, MVT::f64, Src),
+                                ISD::SETOGT);
+    SDValue Adjust = DAG.getSelect(DL, XLenVT, Away,
+                                   DAG.getAllOnesConstant(DL, XLenVT), One);
+    SDValue Odd = DAG.getNode(ISD::ADD, DL, XLenVT, Bits, Adjust);
+    Bits = DAG.getSelect(DL, XLenVT,
+                         DAG.getNode(ISD::AND, DL, XLenVT, Inexact, Even), Odd,
+                         Bits);
+  }
+
+  SDValue High = DAG.getNode(ISD::SRL, DL, XLenVT, Bits, Sixteen);
+  SDValue Lsb = DAG.getNode(ISD::AND, DL, XLenVT, High, One);
+  SDValue Bias = DAG.getNode(ISD::ADD, DL, XLenVT, Lsb,
+                             DAG.getConstant(0x7fff, DL, XLenVT));
+  SDValue Rounded = DAG.getNode(
+      ISD::SRL, DL, XLenVT, DAG.getNode(ISD::ADD, DL, XLenVT, Bits, Bias),
+      Sixteen);
+  SDValue Quiet = DAG.getNode(ISD::OR, DL, XLenVT, High,
+                              DAG.getConstant(0x40, DL, XLenVT));
+  SDValue IsNaN = DAG.getSetCC(DL, XLenVT, Single, Single, ISD::SETUO);
+  SDValue Res = DAG.getSelect(DL, XLenVT, IsNaN, Quiet, Rounded);
+  SDValue Half = DAG.getNode(RISCVISD::FMV_H_X, DL, MVT::f16, Res);
+  return DAG.getNode(ISD::BITCAST, DL, MVT::bf16, Half);
+}
+
 SDValue RISCVTargetLowering::LowerINTRINSIC_WO_CHAIN(SDValue Op,
                                                      SelectionDAG &DAG) const {
   unsigned IntNo = cast<ConstantSDNode>(Op.getOperand(0))->getZExtValue();
@@ -1576,9 +1976,9 @@ SDValue RISCVTargetLowering::LowerINTRINSIC_W_CHAIN(SDValue Op,
   switch (IntNo) {
   default:
     return SDValue(); // Don't custom lower most intrinsics.
+  case Intrinsic::riscv_sdma_start_threed:
   case Intrinsic::riscv_sdma_start_twod:
   case Intrinsic::riscv_sdma_start_oned: {
-    bool isTwod = IntNo == Intrinsic::riscv_sdma_start_twod;
 
     EVT VT1 = Op.getOperand(2).getValueType();
     EVT VT2 = Op.getOperand(3).getValueType();
@@ -1600,25 +2000,20 @@ SDValue RISCVTargetLowering::LowerINTRINSIC_W_CHAIN(SDValue Op,
       // chain
     OpsV.push_back(Op.getOperand(0));
       // intrinsic ID
-    if(isTwod)
-      OpsV.push_back(DAG.getConstant(Intrinsic::riscv_sdma_start_twod_legal, DL, MVT::i32));
-    else
-      OpsV.push_back(DAG.getConstant(Intrinsic::riscv_sdma_start_oned_legal, DL, MVT::i32));
+    unsigned LegalID = Intrinsic::riscv_sdma_start_oned_legal;
+    if (IntNo == Intrinsic::riscv_sdma_start_twod)
+      LegalID = Intrinsic::riscv_sdma_start_twod_legal;
+    else if (IntNo == Intrinsic::riscv_sdma_start_threed)
+      LegalID = Intrinsic::riscv_sdma_start_threed_legal;
+    OpsV.push_back(DAG.getConstant(LegalID, DL, MVT::i32));
       // unpacked src and dst addresses
     OpsV.push_back(LHS_Hi);
     OpsV.push_back(LHS_Lo);
     OpsV.push_back(RHS_Hi);
     OpsV.push_back(RHS_Lo);
-    // original size
-    OpsV.push_back(Op.getOperand(4));
-    if(isTwod) {
-      // source, destination stride and nreps
-      OpsV.push_back(Op.getOperand(5));
-      OpsV.push_back(Op.getOperand(6));
-      OpsV.push_back(Op.getOperand(7));
-    }
-    // original cfg 
-    OpsV.push_back(Op.getOperand(isTwod ? 8:5));
+    // original size, the strides and nreps of the outer dimensions and cfg
+    for (unsigned I = 4, E = Op.getNumOperands(); I != E; ++I)
+      OpsV.push_back(Op.getOperand(I));
     ArrayRef<SDValue> Ops(OpsV);
 
     // build result types: i32 and Chain
@@ -1906,6 +2301,8 @@ void RISCVTargetLowering::ReplaceNodeResults(SDNode *N,
            "Unexpected custom legalisation");
     SDValue Op0 = N->getOperand(0);
     if (N->getValueType(0) == MVT::i16 && Subtarget.hasStdExtZfh()) {
+      if (Op0.getValueType() == MVT::bf16 && Subtarget.hasBF16())
+        Op0 = DAG.getNode(ISD::BITCAST, DL, MVT::f16, Op0);
       if (Op0.getValueType() != MVT::f16)
         return;
       SDValue FPConv =
@@ -2441,6 +2838,29 @@ SDValue RISCVTargetLowering::PerformDAGCombine(SDNode *N,
                                      LoopBranch, BB2);
     return DCI.CombineTo(N, ElseBranch);
   }
+  case ISD::FP_TO_SINT:
+  case ISD::FP_TO_UINT: {
+    // Convert bfloat16 to integers in single precision, which holds every
+    // bfloat16 exactly.
+    SDValue Src = N->getOperand(0);
+    if (Src.getValueType() != MVT::bf16)
+      break;
+    SDLoc DL(N);
+    SDValue Ext = DAG.getNode(ISD::FP_EXTEND, DL, MVT::f32, Src);
+    return DAG.getNode(N->getOpcode(), DL, N->getValueType(0), Ext);
+  }
+  case ISD::SINT_TO_FP:
+  case ISD::UINT_TO_FP: {
+    // Convert integers to bfloat16 through double precision where possible,
+    // it holds 32-bit integers exactly and the final rounding is the only one.
+    if (N->getValueType(0) != MVT::bf16)
+      break;
+    SDLoc DL(N);
+    MVT VT = Subtarget.hasStdExtD() ? MVT::f64 : MVT::f32;
+    SDValue Conv = DAG.getNode(N->getOpcode(), DL, VT, N->getOperand(0));
+    return DAG.getNode(ISD::FP_ROUND, DL, MVT::bf16, Conv,
+                       DAG.getIntPtrConstant(0, DL));
+  }
   }
 
   return SDValue();
@@ -2903,80 +3323,9 @@ static MachineBasicBlock *emitSelectPseudo(MachineInstr &MI,
   return TailMBB;
 }
 
-static MachineBasicBlock *addVSetVL(MachineInstr &MI, MachineBasicBlock *BB,
-                                    int VLIndex, unsigned SEWIndex,
-                                    RISCVVLMUL VLMul, bool WritesElement0) {
-  MachineFunction &MF = *BB->getParent();
-  DebugLoc DL = MI.getDebugLoc();
-  const TargetInstrInfo &TII = *MF.getSubtarget().getInstrInfo();
-
-  unsigned SEW = MI.getOperand(SEWIndex).getImm();
-  assert(RISCVVType::isValidSEW(SEW) && "Unexpected SEW");
-  RISCVVSEW ElementWidth = static_cast<RISCVVSEW>(Log2_32(SEW / 8));
-
-  MachineRegisterInfo &MRI = MF.getRegInfo();
-
-  // VL and VTYPE are alive here.
-  MachineInstrBuilder MIB = BuildMI(*BB, MI, DL, TII.get(RISCV::PseudoVSETVLI));
-
-  if (VLIndex >= 0) {
-    // Set VL (rs1 != X0).
-    Register DestReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
-    MIB.addReg(DestReg, RegState::Define | RegState::Dead)
-        .addReg(MI.getOperand(VLIndex).getReg());
-  } else
-    // With no VL operator in the pseudo, do not modify VL (rd = X0, rs1 = X0).
-    MIB.addReg(RISCV::X0, RegState::Define | RegState::Dead)
-        .addReg(RISCV::X0, RegState::Kill);
-
-  // Default to tail agnostic unless the destination is tied to a source. In
-  // that case the user would have some control over the tail values. The tail
-  // policy is also ignored on instructions that only update element 0 like
-  // vmv.s.x or reductions so use agnostic there to match the common case.
-  // FIXME: This is conservatively correct, but we might want to detect that
-  // the input is undefined.
-  bool TailAgnostic = true;
-  unsigned UseOpIdx;
-  if (MI.isRegTiedToUseOperand(0, &UseOpIdx) && !WritesElement0) {
-    TailAgnostic = false;
-    // If the tied operand is an IMPLICIT_DEF we can keep TailAgnostic.
-    const MachineOperand &UseMO = MI.getOperand(UseOpIdx);
-    MachineInstr *UseMI = MRI.getVRegDef(UseMO.getReg());
-    if (UseMI && UseMI->isImplicitDef())
-      TailAgnostic = true;
-  }
-
-  // For simplicity we reuse the vtype representation here.
-  MIB.addImm(RISCVVType::encodeVTYPE(VLMul, ElementWidth,
-                                     /*TailAgnostic*/ TailAgnostic,
-                                     /*MaskAgnostic*/ false));
-
-  // Remove (now) redundant operands from pseudo
-  MI.getOperand(SEWIndex).setImm(-1);
-  if (VLIndex >= 0) {
-    MI.getOperand(VLIndex).setReg(RISCV::NoRegister);
-    MI.getOperand(VLIndex).setIsKill(false);
-  }
-
-  return BB;
-}
-
 MachineBasicBlock *
 RISCVTargetLowering::EmitInstrWithCustomInserter(MachineInstr &MI,
                                                  MachineBasicBlock *BB) const {
-  uint64_t TSFlags = MI.getDesc().TSFlags;
-
-  if (TSFlags & RISCVII::HasSEWOpMask) {
-    unsigned NumOperands = MI.getNumExplicitOperands();
-    int VLIndex = (TSFlags & RISCVII::HasVLOpMask) ? NumOperands - 2 : -1;
-    unsigned SEWIndex = NumOperands - 1;
-    bool WritesElement0 = TSFlags & RISCVII::WritesElement0Mask;
-
-    RISCVVLMUL VLMul = static_cast<RISCVVLMUL>((TSFlags & RISCVII::VLMulMask) >>
-                                               RISCVII::VLMulShift);
-    return addVSetVL(MI, BB, VLIndex, SEWIndex, VLMul, WritesElement0);
-  }
-
   switch (MI.getOpcode()) {
   default:
     llvm_unreachable("Unexpected instr type to insert");
@@ -3049,6 +3398,12 @@ static const MCPhysReg ArgVRM4s[] = {RISCV::V8M4, RISCV::V12M4, RISCV::V16M4,
                                      RISCV::V20M4};
 static const MCPhysReg ArgVRM8s[] = {RISCV::V8M8, RISCV::V16M8};
 
+// The packed SIMD types of Xfvecsingle and Xfvechalf fill a 64-bit FPR and are
+// passed exactly like f64.
+static bool isPassedAsF64(MVT VT) {
+  return VT == MVT::f64 || VT == MVT::v2f32 || VT == MVT::v4f16;
+}
+
 // Pass a 2*XLEN argument that has been split into two XLEN values through
 // registers or the stack as necessary.
 static bool CC_RISCVAssign2XLen(unsigned XLen, CCState &State, CCValAssign VA1,
@@ -3089,7 +3444,7 @@ static bool CC_RISCVAssign2XLen(unsigned XLen, CCState &State, CCValAssign VA1,
 }
 
 // Implements the RISC-V calling convention. Returns true upon failure.
-static bool CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
+bool RISCV::CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
                      MVT ValVT, MVT LocVT, CCValAssign::LocInfo LocInfo,
                      ISD::ArgFlagsTy ArgFlags, CCState &State, bool IsFixed,
                      bool IsRet, Type *OrigTy, const RISCVTargetLowering &TLI,
@@ -3137,10 +3492,11 @@ static bool CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
   // similar local variables rather than directly checking against the target
   // ABI.
 
-  if (UseGPRForF16_F32 && (ValVT == MVT::f16 || ValVT == MVT::f32)) {
+  if (UseGPRForF16_F32 &&
+      (ValVT == MVT::f16 || ValVT == MVT::bf16 || ValVT == MVT::f32)) {
     LocVT = XLenVT;
     LocInfo = CCValAssign::BCvt;
-  } else if (UseGPRForF64 && XLen == 64 && ValVT == MVT::f64) {
+  } else if (UseGPRForF64 && XLen == 64 && isPassedAsF64(ValVT)) {
     LocVT = MVT::i64;
     LocInfo = CCValAssign::BCvt;
   }
@@ -3170,7 +3526,7 @@ static bool CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
 
   // Handle passing f64 on RV32D with a soft float ABI or when floating point
   // registers are exhausted.
-  if (UseGPRForF64 && XLen == 32 && ValVT == MVT::f64) {
+  if (UseGPRForF64 && XLen == 32 && isPassedAsF64(ValVT)) {
     assert(!ArgFlags.isSplit() && PendingLocs.empty() &&
            "Can't lower f64 if it is split");
     // Depending on available argument GPRS, f64 may be passed in a pair of
@@ -3220,11 +3576,11 @@ static bool CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
 
   // Allocate to a register if possible, or else a stack slot.
   Register Reg;
-  if (ValVT == MVT::f16 && !UseGPRForF16_F32)
+  if ((ValVT == MVT::f16 || ValVT == MVT::bf16) && !UseGPRForF16_F32)
     Reg = State.AllocateReg(ArgFPR16s);
   else if (ValVT == MVT::f32 && !UseGPRForF16_F32)
     Reg = State.AllocateReg(ArgFPR32s);
-  else if (ValVT == MVT::f64 && !UseGPRForF64)
+  else if (isPassedAsF64(ValVT) && !UseGPRForF64)
     Reg = State.AllocateReg(ArgFPR64s);
   else if (ValVT.isScalableVector()) {
     const TargetRegisterClass *RC = TLI.getRegClassFor(ValVT);
@@ -3327,9 +3683,9 @@ void RISCVTargetLowering::analyzeInputArgs(
       ArgTy = FType->getParamType(Ins[i].getOrigArgIndex());
 
     RISCVABI::ABI ABI = MF.getSubtarget<RISCVSubtarget>().getTargetABI();
-    if (CC_RISCV(MF.getDataLayout(), ABI, i, ArgVT, ArgVT, CCValAssign::Full,
-                 ArgFlags, CCInfo, /*IsFixed=*/true, IsRet, ArgTy, *this,
-                 FirstMaskArgument)) {
+    if (RISCV::CC_RISCV(MF.getDataLayout(), ABI, i, ArgVT, ArgVT,
+                        CCValAssign::Full, ArgFlags, CCInfo, /*IsFixed=*/true,
+                        IsRet, ArgTy, *this, FirstMaskArgument)) {
       LLVM_DEBUG(dbgs() << "InputArg #" << i << " has unhandled type "
                         << EVT(ArgVT).getEVTString() << '\n');
       llvm_unreachable(nullptr);
@@ -3353,9 +3709,9 @@ void RISCVTargetLowering::analyzeOutputArgs(
     Type *OrigTy = CLI ? CLI->getArgs()[Outs[i].OrigArgIndex].Ty : nullptr;
 
     RISCVABI::ABI ABI = MF.getSubtarget<RISCVSubtarget>().getTargetABI();
-    if (CC_RISCV(MF.getDataLayout(), ABI, i, ArgVT, ArgVT, CCValAssign::Full,
-                 ArgFlags, CCInfo, Outs[i].IsFixed, IsRet, OrigTy, *this,
-                 FirstMaskArgument)) {
+    if (RISCV::CC_RISCV(MF.getDataLayout(), ABI, i, ArgVT, ArgVT,
+                        CCValAssign::Full, ArgFlags, CCInfo, Outs[i].IsFixed,
+                        IsRet, OrigTy, *this, FirstMaskArgument)) {
       LLVM_DEBUG(dbgs() << "OutputArg #" << i << " has unhandled type "
                         << EVT(ArgVT).getEVTString() << "\n");
       llvm_unreachable(nullptr);
@@ -3375,8 +3731,14 @@ static SDValue convertLocVTToValVT(SelectionDAG &DAG, SDValue Val,
   case CCValAssign::BCvt:
     if (VA.getLocVT().isInteger() && VA.getValVT() == MVT::f16)
       Val = DAG.getNode(RISCVISD::FMV_H_X, DL, MVT::f16, Val);
+    else if (VA.getLocVT().isInteger() && VA.getValVT() == MVT::bf16)
+      Val = DAG.getNode(ISD::BITCAST, DL, MVT::bf16,
+                        DAG.getNode(RISCVISD::FMV_H_X, DL, MVT::f16, Val));
     else if (VA.getLocVT() == MVT::i64 && VA.getValVT() == MVT::f32)
       Val = DAG.getNode(RISCVISD::FMV_W_X_RV64, DL, MVT::f32, Val);
+    else if (VA.getLocVT().isInteger() && VA.getValVT().isVector())
+      Val = DAG.getNode(ISD::BITCAST, DL, VA.getValVT(),
+                        DAG.getNode(ISD::BITCAST, DL, MVT::f64, Val));
     else
       Val = DAG.getNode(ISD::BITCAST, DL, VA.getValVT(), Val);
     break;
@@ -3416,8 +3778,14 @@ static SDValue convertValVTToLocVT(SelectionDAG &DAG, SDValue Val,
   case CCValAssign::BCvt:
     if (VA.getLocVT().isInteger() && VA.getValVT() == MVT::f16)
       Val = DAG.getNode(RISCVISD::FMV_X_ANYEXTH, DL, VA.getLocVT(), Val);
+    else if (VA.getLocVT().isInteger() && VA.getValVT() == MVT::bf16)
+      Val = DAG.getNode(RISCVISD::FMV_X_ANYEXTH, DL, VA.getLocVT(),
+                        DAG.getNode(ISD::BITCAST, DL, MVT::f16, Val));
     else if (VA.getLocVT() == MVT::i64 && VA.getValVT() == MVT::f32)
       Val = DAG.getNode(RISCVISD::FMV_X_ANYEXTW_RV64, DL, MVT::i64, Val);
+    else if (VA.getLocVT().isInteger() && VA.getValVT().isVector())
+      Val = DAG.getNode(ISD::BITCAST, DL, LocVT,
+                        DAG.getNode(ISD::BITCAST, DL, MVT::f64, Val));
     else
       Val = DAG.getNode(ISD::BITCAST, DL, LocVT, Val);
     break;
@@ -3456,7 +3824,7 @@ static SDValue unpackFromMemLoc(SelectionDAG &DAG, SDValue Chain,
 
 static SDValue unpackF64OnRV32DSoftABI(SelectionDAG &DAG, SDValue Chain,
                                        const CCValAssign &VA, const SDLoc &DL) {
-  assert(VA.getLocVT() == MVT::i32 && VA.getValVT() == MVT::f64 &&
+  assert(VA.getLocVT() == MVT::i32 && isPassedAsF64(VA.getValVT()) &&
          "Unexpected VA");
   MachineFunction &MF = DAG.getMachineFunction();
   MachineFrameInfo &MFI = MF.getFrameInfo();
@@ -3466,7 +3834,7 @@ static SDValue unpackF64OnRV32DSoftABI(SelectionDAG &DAG, SDValue Chain,
     // f64 is passed on the stack.
     int FI = MFI.CreateFixedObject(8, VA.getLocMemOffset(), /*Immutable=*/true);
     SDValue FIN = DAG.getFrameIndex(FI, MVT::i32);
-    return DAG.getLoad(MVT::f64, DL, Chain, FIN,
+    return DAG.getLoad(VA.getValVT(), DL, Chain, FIN,
                        MachinePointerInfo::getFixedStack(MF, FI));
   }
 
@@ -3488,7 +3856,8 @@ static SDValue unpackF64OnRV32DSoftABI(SelectionDAG &DAG, SDValue Chain,
     RegInfo.addLiveIn(VA.getLocReg() + 1, HiVReg);
     Hi = DAG.getCopyFromReg(Chain, DL, HiVReg, MVT::i32);
   }
-  return DAG.getNode(RISCVISD::BuildPairF64, DL, MVT::f64, Lo, Hi);
+  return DAG.getBitcast(VA.getValVT(), DAG.getNode(RISCVISD::BuildPairF64, DL,
+                                                    MVT::f64, Lo, Hi));
 }
 
 // FastCC has less than 1% performance improvement for some particular
@@ -3509,7 +3878,7 @@ static bool CC_RISCV_FastCC(unsigned ValNo, MVT ValVT, MVT LocVT,
     }
   }
 
-  if (LocVT == MVT::f16) {
+  if (LocVT == MVT::f16 || LocVT == MVT::bf16) {
     static const MCPhysReg FPR16List[] = {
         RISCV::F10_H, RISCV::F11_H, RISCV::F12_H, RISCV::F13_H, RISCV::F14_H,
         RISCV::F15_H, RISCV::F16_H, RISCV::F17_H, RISCV::F0_H,  RISCV::F1_H,
@@ -3533,7 +3902,7 @@ static bool CC_RISCV_FastCC(unsigned ValNo, MVT ValVT, MVT LocVT,
     }
   }
 
-  if (LocVT == MVT::f64) {
+  if (isPassedAsF64(LocVT)) {
     static const MCPhysReg FPR64List[] = {
         RISCV::F10_D, RISCV::F11_D, RISCV::F12_D, RISCV::F13_D, RISCV::F14_D,
         RISCV::F15_D, RISCV::F16_D, RISCV::F17_D, RISCV::F0_D,  RISCV::F1_D,
@@ -3551,7 +3920,7 @@ static bool CC_RISCV_FastCC(unsigned ValNo, MVT ValVT, MVT LocVT,
     return false;
   }
 
-  if (LocVT == MVT::i64 || LocVT == MVT::f64) {
+  if (LocVT == MVT::i64 || isPassedAsF64(LocVT)) {
     unsigned Offset5 = State.AllocateStack(8, Align(8));
     State.addLoc(CCValAssign::getMem(ValNo, ValVT, Offset5, LocVT, LocInfo));
     return false;
@@ -3661,7 +4030,7 @@ SDValue RISCVTargetLowering::LowerFormalArguments(
     SDValue ArgValue;
     // Passing f64 on RV32D with a soft float ABI must be handled as a special
     // case.
-    if (VA.getLocVT() == MVT::i32 && VA.getValVT() == MVT::f64)
+    if (VA.getLocVT() == MVT::i32 && isPassedAsF64(VA.getValVT()))
       ArgValue = unpackF64OnRV32DSoftABI(DAG, Chain, VA, DL);
     else if (VA.isRegLoc())
       ArgValue = unpackFromRegLoc(DAG, Chain, VA, DL, *this);
@@ -3908,10 +4277,11 @@ SDValue RISCVTargetLowering::LowerCall(CallLoweringInfo &CLI,
 
     // Handle passing f64 on RV32D with a soft float ABI as a special case.
     bool IsF64OnRV32DSoftABI =
-        VA.getLocVT() == MVT::i32 && VA.getValVT() == MVT::f64;
+        VA.getLocVT() == MVT::i32 && isPassedAsF64(VA.getValVT());
     if (IsF64OnRV32DSoftABI && VA.isRegLoc()) {
-      SDValue SplitF64 = DAG.getNode(
-          RISCVISD::SplitF64, DL, DAG.getVTList(MVT::i32, MVT::i32), ArgValue);
+      SDValue SplitF64 =
+          DAG.getNode(RISCVISD::SplitF64, DL, DAG.getVTList(MVT::i32, MVT::i32),
+                      DAG.getBitcast(MVT::f64, ArgValue));
       SDValue Lo = SplitF64.getValue(0);
       SDValue Hi = SplitF64.getValue(1);
 
@@ -4089,7 +4459,7 @@ SDValue RISCVTargetLowering::LowerCall(CallLoweringInfo &CLI,
     Chain = RetValue.getValue(1);
     Glue = RetValue.getValue(2);
 
-    if (VA.getLocVT() == MVT::i32 && VA.getValVT() == MVT::f64) {
+    if (VA.getLocVT() == MVT::i32 && isPassedAsF64(VA.getValVT())) {
       assert(VA.getLocReg() == ArgGPRs[0] && "Unexpected reg assignment");
       SDValue RetValue2 =
           DAG.getCopyFromReg(Chain, DL, ArgGPRs[1], MVT::i32, Glue);
@@ -4097,6 +4467,7 @@ SDValue RISCVTargetLowering::LowerCall(CallLoweringInfo &CLI,
       Glue = RetValue2.getValue(2);
       RetValue = DAG.getNode(RISCVISD::BuildPairF64, DL, MVT::f64, RetValue,
                              RetValue2);
+      RetValue = DAG.getBitcast(VA.getValVT(), RetValue);
     }
 
     RetValue = convertLocVTToValVT(DAG, RetValue, VA, DL);
@@ -4121,9 +4492,9 @@ bool RISCVTargetLowering::CanLowerReturn(
     MVT VT = Outs[i].VT;
     ISD::ArgFlagsTy ArgFlags = Outs[i].Flags;
     RISCVABI::ABI ABI = MF.getSubtarget<RISCVSubtarget>().getTargetABI();
-    if (CC_RISCV(MF.getDataLayout(), ABI, i, VT, VT, CCValAssign::Full,
-                 ArgFlags, CCInfo, /*IsFixed=*/true, /*IsRet=*/true, nullptr,
-                 *this, FirstMaskArgument))
+    if (RISCV::CC_RISCV(MF.getDataLayout(), ABI, i, VT, VT, CCValAssign::Full,
+                        ArgFlags, CCInfo, /*IsFixed=*/true, /*IsRet=*/true,
+                        nullptr, *this, FirstMaskArgument))
       return false;
   }
   return true;
@@ -4160,11 +4531,12 @@ RISCVTargetLowering::LowerReturn(SDValue Chain, CallingConv::ID CallConv,
     CCValAssign &VA = RVLocs[i];
     assert(VA.isRegLoc() && "Can only return in registers!");
 
-    if (VA.getLocVT() == MVT::i32 && VA.getValVT() == MVT::f64) {
+    if (VA.getLocVT() == MVT::i32 && isPassedAsF64(VA.getValVT())) {
       // Handle returning f64 on RV32D with a soft float ABI.
       assert(VA.isRegLoc() && "Expected return via registers");
-      SDValue SplitF64 = DAG.getNode(RISCVISD::SplitF64, DL,
-                                     DAG.getVTList(MVT::i32, MVT::i32), Val);
+      SDValue SplitF64 =
+          DAG.getNode(RISCVISD::SplitF64, DL, DAG.getVTList(MVT::i32, MVT::i32),
+                      DAG.getBitcast(MVT::f64, Val));
       SDValue Lo = SplitF64.getValue(0);
       SDValue Hi = SplitF64.getValue(1);
       Register RegLo = VA.getLocReg();
@@ -4296,6 +4668,8 @@ const char *RISCVTargetLowering::getTargetNodeName(unsigned Opcode) const {
   NODE_NAME_CASE(VSLIDEUP)
   NODE_NAME_CASE(VSLIDEDOWN)
   NODE_NAME_CASE(VID)
+  NODE_NAME_CASE(PV_SHUFFLE)
+  NODE_NAME_CASE(PV_SHUFFLE2)
   }
   // clang-format on
   return nullptr;
@@ -4336,6 +4710,8 @@ RISCVTargetLowering::getRegForInlineAsmConstraint(const TargetRegisterInfo *TRI,
     case 'f':
       if (Subtarget.hasStdExtZfh() && VT == MVT::f16)
         return std::make_pair(0U, &RISCV::FPR16RegClass);
+      if (Subtarget.hasBF16() && VT == MVT::bf16)
+        return std::make_pair(0U, &RISCV::FPR16BFRegClass);
       if (Subtarget.hasStdExtF() && VT == MVT::f32)
         return std::make_pair(0U, &RISCV::FPR32RegClass);
       if (Subtarget.hasStdExtD() && VT == MVT::f64)
@@ -4532,6 +4908,11 @@ RISCVTargetLowering::shouldExpandAtomicRMWInIR(AtomicRMWInst *AI) const {
     return AtomicExpansionKind::CmpXChg;
 
   unsigned Size = AI->getType()->getPrimitiveSizeInBits();
+  // PULP has no LR/SC, loop on a compare-and-swap of the word for the
+  // sub-word operations and for nand, which has no AMO.
+  if (Subtarget.isPULP() &&
+      (Size == 8 || Size == 16 || AI->getOperation() == AtomicRMWInst::Nand))
+    return AtomicExpansionKind::CmpXChg;
   if (Size == 8 || Size == 16)
     return AtomicExpansionKind::MaskedIntrinsic;
   return AtomicExpansionKind::None;
@@ -4635,6 +5016,9 @@ TargetLowering::AtomicExpansionKind
 RISCVTargetLowering::shouldExpandAtomicCmpXchgInIR(
     AtomicCmpXchgInst *CI) const {
   unsigned Size = CI->getCompareOperand()->getType()->getPrimitiveSizeInBits();
+  // Without LR/SC, sub-word compare-and-swaps are widened to the word.
+  if (Subtarget.isPULP())
+    return AtomicExpansionKind::None;
   if (Size == 8 || Size == 16)
     return AtomicExpansionKind::MaskedIntrinsic;
   return AtomicExpansionKind::None;
@@ -4664,6 +5048,13 @@ Value *RISCVTargetLowering::emitMaskedAtomicCmpXchgIntrinsic(
 
 bool RISCVTargetLowering::isFMAFasterThanFMulAndFAdd(const MachineFunction &MF,
                                                      EVT VT) const {
+  // The packed floating-point vectors fuse even without the scalar extension
+  // of their element type.
+  if (VT == MVT::v2f32 && Subtarget.hasPackedV2F32())
+    return true;
+  if (VT == MVT::v4f16 && Subtarget.hasPackedV4F16())
+    return true;
+
   VT = VT.getScalarType();
 
   if (!VT.isSimple())
@@ -4683,6 +5074,18 @@ bool RISCVTargetLowering::isFMAFasterThanFMulAndFAdd(const MachineFunction &MF,
   return false;
 }
 
+Align RISCVTargetLowering::getPrefLoopAlignment(MachineLoop *ML) const {
+  // With compressed instructions, the header of a loop may start in the
+  // middle of a fetch block, which costs a fetch bubble on every iteration.
+  // Only innermost loops are aligned; MachineBlockPlacement skips the cold
+  // ones. Nothing is gained if instructions cannot straddle a fetch block.
+  Align Fetch = Subtarget.getFetchAlignment();
+  Align MinAlign = getMinFunctionAlignment();
+  if (!ML || !ML->isInnermost() || Fetch <= MinAlign)
+    return TargetLowering::getPrefLoopAlignment(ML);
+  return Fetch;
+}
+
 Register RISCVTargetLowering::getExceptionPointerRegister(
     const Constant *PersonalityFn) const {
   return RISCV::X10;
@@ -4718,6 +5121,10 @@ bool RISCVTargetLowering::decomposeMulByConstant(LLVMContext &Context, EVT VT,
     // size exceeds XLen.
     if (Subtarget.hasStdExtM() && VT.getSizeInBits() > Subtarget.getXLen())
       return false;
+    // PULP cores multiply in a single cycle, keep the multiply so that it can
+    // be folded into a p.mac or p.msu.
+    if (Subtarget.hasStdExtM() && Subtarget.hasPULPExtV2())
+      return false;
     if (auto *ConstNode = dyn_cast<ConstantSDNode>(C.getNode())) {
       // Break the MUL to a SLLI and an ADD/SUB.
       const APInt &Imm = ConstNode->getAPIntValue();
@@ -15,6 +15,7 @@
 #define LLVM_LIB_TARGET_RISCV_RISCVISELLOWERING_H
 
 #include "RISCV.h"
+#include "llvm/CodeGen/CallingConvLower.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/CodeGen/TargetLowering.h"
 
@@ -111,6 +112,16 @@ enum NodeType : unsigned {
   VSLIDEDOWN,
   // Matches the semantics of the unmasked vid.v instruction.
   VID,
+  // Single source shuffle of a PULP packed SIMD vector, matching the semantics
+  // of pv.shuffle.sci.h and pv.shuffleI*.sci.b. The second operand is an
+  // XLenVT constant holding the source element of each result element, log2
+  // of the number of elements bits per element starting at element 0.
+  PV_SHUFFLE,
+  // Two source shuffle of PULP packed SIMD vectors, matching the semantics of
+  // pv.shuffle2.h and pv.shuffle2.b. The third operand is a vector holding
+  // the source element of each result element, counting the elements of the
+  // second source after the ones of the first, like a shuffle mask.
+  PV_SHUFFLE2,
 };
 } // namespace RISCVISD
 
@@ -129,6 +140,8 @@ public:
   bool isLegalAddressingMode(const DataLayout &DL, const AddrMode &AM, Type *Ty,
                              unsigned AS,
                              Instruction *I = nullptr) const override;
+  int getScalingFactorCost(const DataLayout &DL, const AddrMode &AM, Type *Ty,
+                           unsigned AS = 0) const override;
   bool isLegalICmpImmediate(int64_t Imm) const override;
   bool isLegalAddImmediate(int64_t Imm) const override;
   bool isTruncateFree(Type *SrcTy, Type *DstTy) const override;
@@ -214,6 +227,8 @@ public:
     return ISD::SIGN_EXTEND;
   }
 
+  Align getPrefLoopAlignment(MachineLoop *ML) const override;
+
   bool shouldExpandShift(SelectionDAG &DAG, SDNode *N) const override {
     if (DAG.getMachineFunction().getFunction().hasMinSize())
       return false;
@@ -319,6 +334,11 @@ private:
   SDValue lowerVectorMaskTrunc(SDValue Op, SelectionDAG &DAG) const;
   SDValue lowerINSERT_VECTOR_ELT(SDValue Op, SelectionDAG &DAG) const;
   SDValue lowerEXTRACT_VECTOR_ELT(SDValue Op, SelectionDAG &DAG) const;
+  SDValue lowerPULPVECTOR_SHUFFLE(SDValue Op, SelectionDAG &DAG) const;
+  SDValue lowerPackedFPEXTRACT_VECTOR_ELT(SDValue Op, SelectionDAG &DAG) const;
+  SDValue lowerPackedFPVECTOR_SHUFFLE(SDValue Op, SelectionDAG &DAG) const;
+  SDValue lowerBF16_FP_EXTEND(SDValue Op, SelectionDAG &DAG) const;
+  SDValue lowerBF16_FP_ROUND(SDValue Op, SelectionDAG &DAG) const;
   SDValue LowerINTRINSIC_WO_CHAIN(SDValue Op, SelectionDAG &DAG) const;
   SDValue LowerINTRINSIC_W_CHAIN(SDValue Op, SelectionDAG &DAG) const;
 
@@ -337,6 +357,16 @@ private:
                                       bool *Fast) const override;
 };
 
+namespace RISCV {
+// Implements the RISC-V calling convention, shared with GlobalISel. Returns
+// true upon failure.
+bool CC_RISCV(const DataLayout &DL, RISCVABI::ABI ABI, unsigned ValNo,
+              MVT ValVT, MVT LocVT, CCValAssign::LocInfo LocInfo,
+              ISD::ArgFlagsTy ArgFlags, CCState &State, bool IsFixed,
+              bool IsRet, Type *OrigTy, const RISCVTargetLowering &TLI,
+              Optional<unsigned> FirstMaskArgument);
+} // end namespace RISCV
+
 namespace RISCVVIntrinsicsTable {
 
 struct RISCVVIntrinsicInfo {
@@ -0,0 +1,663 @@
+//===- RISCVInsertVSETVLI.cpp - Insert VSETVLI instructions ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a function pass that inserts VSETVLI instructions where
+// needed.
+//
+// The vector pseudos carry the AVL and SEW they are executed with as operands
+// and the LMUL in their TSFlags. This pass computes the VL and VTYPE state
+// required by each of them and only inserts a vsetvli where the state reaching
+// the instruction is not compatible with it. The state is propagated across
+// blocks in three phases:
+//
+//   1. The state at the entry of each block is the intersection of the exit
+//      states of its predecessors. A worklist iterates the transfer function
+//      of the blocks until the entry states do not change anymore.
+//   2. Loops whose header needs a vsetvli on every iteration, with an AVL
+//      defined outside of the loop, get that vsetvli at the end of their
+//      preheader instead if the back edges then carry the same state.
+//   3. Each block is walked starting from its entry state, inserting the
+//      vsetvlis and removing the explicit ones which do not change the state
+//      and whose result is unused.
+//
+// Calls, inline assembly and the instructions writing VL themselves, such as
+// the fault-only-first loads, make the state unknown.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RISCV.h"
+#include "RISCVSubtarget.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include <queue>
+using namespace llvm;
+
+#define DEBUG_TYPE "riscv-insert-vsetvli"
+#define RISCV_INSERT_VSETVLI_NAME "RISCV Insert VSETVLI pass"
+
+static cl::opt<bool> DisableVSETVLIHoisting(
+    "riscv-vsetvli-hoist-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not hoist loop invariant vsetvli instructions into the "
+             "preheader"));
+
+STATISTIC(NumInserted, "Number of vsetvli instructions inserted");
+STATISTIC(NumHoisted, "Number of vsetvli instructions hoisted out of loops");
+STATISTIC(NumRemoved, "Number of redundant vsetvli instructions removed");
+
+namespace {
+
+class VSETVLIInfo {
+  Register AVLReg;
+  unsigned AVLImm = 0;
+
+  enum : uint8_t {
+    Uninitialized,
+    AVLIsReg,
+    AVLIsImm,
+    Unknown,
+  } State = Uninitialized;
+
+  RISCVVLMUL VLMul = RISCVVLMUL::LMUL_1;
+  RISCVVSEW SEW = RISCVVSEW::SEW_8;
+  bool TailAgnostic = false;
+  bool MaskAgnostic = false;
+  // Only set on the state required by an instruction which does not read VL,
+  // vmv.x.s and vfmv.f.s.
+  bool IgnoresVL = false;
+
+public:
+  static VSETVLIInfo getUnknown() {
+    VSETVLIInfo Info;
+    Info.State = Unknown;
+    return Info;
+  }
+
+  bool isValid() const { return State != Uninitialized; }
+  bool isUnknown() const { return State == Unknown; }
+  bool isKnown() const { return isValid() && !isUnknown(); }
+
+  void setAVLReg(Register Reg) {
+    AVLReg = Reg;
+    State = AVLIsReg;
+  }
+  void setAVLImm(unsigned Imm) {
+    AVLImm = Imm;
+    State = AVLIsImm;
+  }
+  void setAVL(const VSETVLIInfo &Other) {
+    AVLReg = Other.AVLReg;
+    AVLImm = Other.AVLImm;
+    State = Other.State;
+  }
+  bool hasAVLReg() const { return State == AVLIsReg; }
+  bool hasAVLImm() const { return State == AVLIsImm; }
+  Register getAVLReg() const { return AVLReg; }
+  unsigned getAVLImm() const { return AVLImm; }
+
+  void setIgnoresVL(bool Ignores) { IgnoresVL = Ignores; }
+  bool ignoresVL() const { return IgnoresVL; }
+
+  void setVTYPE(unsigned VType) {
+    VLMul = RISCVVType::getVLMUL(VType);
+    SEW = RISCVVType::getVSEW(VType);
+    TailAgnostic = RISCVVType::isTailAgnostic(VType);
+    MaskAgnostic = RISCVVType::isMaskAgnostic(VType);
+  }
+  void setVTYPE(RISCVVLMUL L, RISCVVSEW S, bool TA, bool MA) {
+    VLMul = L;
+    SEW = S;
+    TailAgnostic = TA;
+    MaskAgnostic = MA;
+  }
+  unsigned encodeVTYPE() const {
+    return RISCVVType::encodeVTYPE(VLMul, SEW, TailAgnostic, MaskAgnostic);
+  }
+
+  bool hasSameAVL(const VSETVLIInfo &Other) const {
+    if (hasAVLReg() && Other.hasAVLReg())
+      return getAVLReg() == Other.getAVLReg();
+    if (hasAVLImm() && Other.hasAVLImm())
+      return getAVLImm() == Other.getAVLImm();
+    return false;
+  }
+
+  bool hasSameVTYPE(const VSETVLIInfo &Other) const {
+    return VLMul == Other.VLMul && SEW == Other.SEW &&
+           TailAgnostic == Other.TailAgnostic &&
+           MaskAgnostic == Other.MaskAgnostic;
+  }
+
+  /// Return SEW / LMUL, which determines VLMAX for a given VLEN.
+  unsigned getSEWLMULRatio() const {
+    unsigned SEWBits = 8 << static_cast<unsigned>(SEW);
+    // LMUL in units of 1/8.
+    unsigned LMULEighths;
+    switch (VLMul) {
+    case RISCVVLMUL::LMUL_F8: LMULEighths = 1; break;
+    case RISCVVLMUL::LMUL_F4: LMULEighths = 2; break;
+    case RISCVVLMUL::LMUL_F2: LMULEighths = 4; break;
+    default:
+      LMULEighths = 8 << static_cast<unsigned>(VLMul);
+      break;
+    }
+    return SEWBits * 8 / LMULEighths;
+  }
+
+  bool hasSameVLMAX(const VSETVLIInfo &Other) const {
+    return getSEWLMULRatio() == Other.getSEWLMULRatio();
+  }
+
+  /// Return true if an instruction requiring \p Require may execute with this
+  /// VTYPE. Tail undisturbed is a valid implementation of tail agnostic.
+  bool hasCompatibleVTYPE(const VSETVLIInfo &Require) const {
+    return VLMul == Require.VLMul && SEW == Require.SEW &&
+           MaskAgnostic == Require.MaskAgnostic &&
+           (Require.TailAgnostic || !TailAgnostic);
+  }
+
+  /// Return true if an instruction requiring \p Require may execute in this
+  /// state without a vsetvli.
+  bool isCompatible(const VSETVLIInfo &Require) const {
+    assert(Require.isKnown() && "Unexpected requirement");
+    if (!isKnown() || !hasCompatibleVTYPE(Require))
+      return false;
+    return Require.ignoresVL() || hasSameAVL(Require);
+  }
+
+  bool operator==(const VSETVLIInfo &Other) const {
+    if (State != Other.State)
+      return false;
+    if (!isKnown())
+      return true;
+    return hasSameAVL(Other) && hasSameVTYPE(Other);
+  }
+  bool operator!=(const VSETVLIInfo &Other) const { return !(*this == Other); }
+
+  /// Return the state on the entry of a block reached with this state and
+  /// with \p Other; an uninitialized state is the identity.
+  VSETVLIInfo intersect(const VSETVLIInfo &Other) const {
+    if (!Other.isValid())
+      return *this;
+    if (!isValid())
+      return Other;
+    if (*this == Other)
+      return *this;
+    return getUnknown();
+  }
+};
+
+struct BlockData {
+  // The state required by the first vector instruction if it precedes all
+  // other changes of the state in the block.
+  VSETVLIInfo FirstRequire;
+  // The state on the entry of the block.
+  VSETVLIInfo Pred;
+  // The state on the exit of the block.
+  VSETVLIInfo Exit;
+  // Whether the block is in the worklist.
+  bool InQueue = false;
+};
+
+class RISCVInsertVSETVLI : public MachineFunctionPass {
+  const TargetInstrInfo *TII;
+  MachineRegisterInfo *MRI;
+  MachineLoopInfo *MLI;
+
+  std::vector<BlockData> BlockInfo;
+  std::queue<const MachineBasicBlock *> WorkList;
+
+public:
+  static char ID;
+
+  RISCVInsertVSETVLI() : MachineFunctionPass(ID) {
+    initializeRISCVInsertVSETVLIPass(*PassRegistry::getPassRegistry());
+  }
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  MachineFunctionProperties getRequiredProperties() const override {
+    return MachineFunctionProperties().set(
+        MachineFunctionProperties::Property::IsSSA);
+  }
+
+  // This pass modifies the program, but does not modify the CFG
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<MachineLoopInfo>();
+    AU.addPreserved<MachineLoopInfo>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+  StringRef getPassName() const override { return RISCV_INSERT_VSETVLI_NAME; }
+
+private:
+  /// Return the state required by the vector pseudo \p MI.
+  VSETVLIInfo computeInfoForInstr(const MachineInstr &MI) const;
+
+  /// Return the state after the vsetvli \p MI executed in state \p Cur.
+  VSETVLIInfo getInfoForVSETVLI(const MachineInstr &MI,
+                                const VSETVLIInfo &Cur) const;
+
+  /// Return the state an instruction requiring \p Require executes in if a
+  /// vsetvli is inserted in front of it in state \p Cur.
+  VSETVLIInfo resolveRequire(const VSETVLIInfo &Require,
+                             const VSETVLIInfo &Cur) const;
+
+  /// Return true if a vsetvli must be inserted in state \p Cur before an
+  /// instruction requiring \p Require.
+  bool needVSETVLI(const VSETVLIInfo &Require, const VSETVLIInfo &Cur) const;
+
+  /// Return true if the vsetvli \p MI does not change the state \p Cur and its
+  /// result is unused.
+  bool isRedundantVSETVLI(const MachineInstr &MI,
+                          const VSETVLIInfo &Cur) const;
+
+  /// Update \p Cur to the state after \p MI.
+  void transferInstr(const MachineInstr &MI, VSETVLIInfo &Cur) const;
+
+  void insertVSETVLI(MachineBasicBlock &MBB, MachineBasicBlock::iterator InsertPt,
+                     const DebugLoc &DL, const VSETVLIInfo &Info,
+                     const VSETVLIInfo &PrevInfo);
+
+  void computeFirstRequire(const MachineBasicBlock &MBB);
+  void computeIncomingVLVTYPE(const MachineBasicBlock &MBB);
+  void computeDataflow(const MachineFunction &MF);
+  bool hoistVSETVLIs(MachineFunction &MF);
+  bool emitVSETVLIs(MachineBasicBlock &MBB);
+};
+
+} // end anonymous namespace
+
+char RISCVInsertVSETVLI::ID = 0;
+
+INITIALIZE_PASS_BEGIN(RISCVInsertVSETVLI, DEBUG_TYPE, RISCV_INSERT_VSETVLI_NAME,
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_END(RISCVInsertVSETVLI, DEBUG_TYPE, RISCV_INSERT_VSETVLI_NAME,
+                    false, false)
+
+static bool isVectorConfigInstr(const MachineInstr &MI) {
+  return MI.getOpcode() == RISCV::PseudoVSETVLI ||
+         MI.getOpcode() == RISCV::PseudoVSETIVLI;
+}
+
+static bool isVectorPseudo(const MachineInstr &MI) {
+  return MI.getDesc().TSFlags & RISCVII::HasSEWOpMask;
+}
+
+static bool clobbersVLVTYPE(const MachineInstr &MI) {
+  return MI.isCall() || MI.isInlineAsm() || MI.modifiesRegister(RISCV::VL) ||
+         MI.modifiesRegister(RISCV::VTYPE);
+}
+
+VSETVLIInfo
+RISCVInsertVSETVLI::computeInfoForInstr(const MachineInstr &MI) const {
+  uint64_t TSFlags = MI.getDesc().TSFlags;
+  unsigned NumOperands = MI.getNumExplicitOperands();
+
+  unsigned SEW = MI.getOperand(NumOperands - 1).getImm();
+  assert(RISCVVType::isValidSEW(SEW) && "Unexpected SEW");
+  RISCVVSEW ElementWidth = static_cast<RISCVVSEW>(Log2_32(SEW / 8));
+  RISCVVLMUL VLMul = static_cast<RISCVVLMUL>((TSFlags & RISCVII::VLMulMask) >>
+                                             RISCVII::VLMulShift);
+
+  // Default to tail agnostic unless the destination is tied to a source. In
+  // that case the user would have some control over the tail values. The tail
+  // policy is also ignored on instructions that only update element 0 like
+  // vmv.s.x or reductions so use agnostic there to match the common case.
+  // FIXME: This is conservatively correct, but we might want to detect that
+  // the input is undefined.
+  bool TailAgnostic = true;
+  unsigned UseOpIdx;
+  if (MI.isRegTiedToUseOperand(0, &UseOpIdx) &&
+      !(TSFlags & RISCVII::WritesElement0Mask)) {
+    TailAgnostic = false;
+    // If the tied operand is an IMPLICIT_DEF we can keep TailAgnostic.
+    const MachineOperand &UseMO = MI.getOperand(UseOpIdx);
+    MachineInstr *UseMI = MRI->getVRegDef(UseMO.getReg());
+    if (UseMI && UseMI->isImplicitDef())
+      TailAgnostic = true;
+  }
+
+  VSETVLIInfo Info;
+  Info.setVTYPE(VLMul, ElementWidth, TailAgnostic, /*MaskAgnostic*/ false);
+  if (TSFlags & RISCVII::HasVLOpMask) {
+    Info.setAVLReg(MI.getOperand(NumOperands - 2).getReg());
+  } else {
+    // Without a VL operand any VL will do, VLMAX if it has to be set.
+    Info.setAVLReg(RISCV::X0);
+    Info.setIgnoresVL(true);
+  }
+  return Info;
+}
+
+VSETVLIInfo
+RISCVInsertVSETVLI::getInfoForVSETVLI(const MachineInstr &MI,
+                                      const VSETVLIInfo &Cur) const {
+  VSETVLIInfo Info;
+  Info.setVTYPE(MI.getOperand(2).getImm());
+  if (MI.getOpcode() == RISCV::PseudoVSETIVLI) {
+    Info.setAVLImm(MI.getOperand(1).getImm());
+    return Info;
+  }
+  Register AVLReg = MI.getOperand(1).getReg();
+  // vsetvli x0, x0 keeps VL as long as VLMAX does not change.
+  if (AVLReg == RISCV::X0 && MI.getOperand(0).getReg() == RISCV::X0) {
+    if (!Cur.isKnown() || !Cur.hasSameVLMAX(Info))
+      return VSETVLIInfo::getUnknown();
+    Info.setAVL(Cur);
+    return Info;
+  }
+  Info.setAVLReg(AVLReg);
+  return Info;
+}
+
+VSETVLIInfo RISCVInsertVSETVLI::resolveRequire(const VSETVLIInfo &Require,
+                                               const VSETVLIInfo &Cur) const {
+  VSETVLIInfo Info = Require;
+  Info.setIgnoresVL(false);
+  // Change VTYPE only, the instruction does not care about VL.
+  if (Require.ignoresVL() && Cur.isKnown() && Cur.hasSameVLMAX(Require))
+    Info.setAVL(Cur);
+  return Info;
+}
+
+bool RISCVInsertVSETVLI::needVSETVLI(const VSETVLIInfo &Require,
+                                     const VSETVLIInfo &Cur) const {
+  if (Cur.isCompatible(Require))
+    return false;
+
+  // The AVL may be the result of a vsetvli which set VL to it already, that
+  // is the VL of an earlier vsetvli with the same VLMAX.
+  if (Require.hasAVLReg() && Require.getAVLReg().isVirtual() &&
+      Cur.isKnown() && Cur.hasCompatibleVTYPE(Require)) {
+    if (MachineInstr *DefMI = MRI->getVRegDef(Require.getAVLReg())) {
+      if (isVectorConfigInstr(*DefMI)) {
+        VSETVLIInfo DefInfo =
+            getInfoForVSETVLI(*DefMI, VSETVLIInfo::getUnknown());
+        if (DefInfo.hasSameAVL(Cur) && DefInfo.hasSameVLMAX(Cur))
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool RISCVInsertVSETVLI::isRedundantVSETVLI(const MachineInstr &MI,
+                                            const VSETVLIInfo &Cur) const {
+  Register DestReg = MI.getOperand(0).getReg();
+  if (DestReg != RISCV::X0 &&
+      !(DestReg.isVirtual() && MRI->use_nodbg_empty(DestReg)))
+    return false;
+  VSETVLIInfo Info = getInfoForVSETVLI(MI, Cur);
+  return Cur.isKnown() && Info == Cur;
+}
+
+void RISCVInsertVSETVLI::transferInstr(const MachineInstr &MI,
+                                       VSETVLIInfo &Cur) const {
+  if (isVectorConfigInstr(MI)) {
+    Cur = getInfoForVSETVLI(MI, Cur);
+    return;
+  }
+  if (isVectorPseudo(MI)) {
+    VSETVLIInfo Require = computeInfoForInstr(MI);
+    if (needVSETVLI(Require, Cur))
+      Cur = resolveRequire(Require, Cur);
+  }
+  if (clobbersVLVTYPE(MI))
+    Cur = VSETVLIInfo::getUnknown();
+}
+
+void RISCVInsertVSETVLI::insertVSETVLI(MachineBasicBlock &MBB,
+                                       MachineBasicBlock::iterator InsertPt,
+                                       const DebugLoc &DL,
+                                       const VSETVLIInfo &Info,
+                                       const VSETVLIInfo &PrevInfo) {
+  ++NumInserted;
+  // Use X0, X0 form if the AVL is the same and the SEW+LMUL gives the same
+  // VLMAX.
+  if (PrevInfo.isKnown() && Info.hasSameAVL(PrevInfo) &&
+      Info.hasSameVLMAX(PrevInfo)) {
+    BuildMI(MBB, InsertPt, DL, TII->get(RISCV::PseudoVSETVLI))
+        .addReg(RISCV::X0, RegState::Define | RegState::Dead)
+        .addReg(RISCV::X0, RegState::Kill)
+        .addImm(Info.encodeVTYPE());
+    return;
+  }
+
+  if (Info.hasAVLImm()) {
+    BuildMI(MBB, InsertPt, DL, TII->get(RISCV::PseudoVSETIVLI))
+        .addReg(RISCV::X0, RegState::Define | RegState::Dead)
+        .addImm(Info.getAVLImm())
+        .addImm(Info.encodeVTYPE());
+    return;
+  }
+
+  Register AVLReg = Info.getAVLReg();
+  if (AVLReg == RISCV::X0) {
+    // Set VL to VLMAX (rd != X0, rs1 = X0).
+    Register DestReg = MRI->createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(MBB, InsertPt, DL, TII->get(RISCV::PseudoVSETVLI))
+        .addReg(DestReg, RegState::Define | RegState::Dead)
+        .addReg(RISCV::X0, RegState::Kill)
+        .addImm(Info.encodeVTYPE());
+    return;
+  }
+
+  BuildMI(MBB, InsertPt, DL, TII->get(RISCV::PseudoVSETVLI))
+      .addReg(RISCV::X0, RegState::Define | RegState::Dead)
+      .addReg(AVLReg)
+      .addImm(Info.encodeVTYPE());
+}
+
+void RISCVInsertVSETVLI::computeFirstRequire(const MachineBasicBlock &MBB) {
+  BlockData &BBInfo = BlockInfo[MBB.getNumber()];
+  BBInfo.FirstRequire = VSETVLIInfo();
+  for (const MachineInstr &MI : MBB) {
+    if (isVectorPseudo(MI)) {
+      BBInfo.FirstRequire = computeInfoForInstr(MI);
+      return;
+    }
+    if (isVectorConfigInstr(MI) || clobbersVLVTYPE(MI))
+      return;
+  }
+}
+
+void RISCVInsertVSETVLI::computeIncomingVLVTYPE(const MachineBasicBlock &MBB) {
+  BlockData &BBInfo = BlockInfo[MBB.getNumber()];
+  BBInfo.InQueue = false;
+
+  // Nothing is known about VL and VTYPE on entry to the function.
+  VSETVLIInfo InInfo;
+  if (MBB.pred_empty()) {
+    InInfo = VSETVLIInfo::getUnknown();
+  } else {
+    for (const MachineBasicBlock *P : MBB.predecessors())
+      InInfo = InInfo.intersect(BlockInfo[P->getNumber()].Exit);
+  }
+
+  // None of the predecessors has been visited yet.
+  if (!InInfo.isValid())
+    return;
+
+  BBInfo.Pred = InInfo;
+
+  VSETVLIInfo Cur = InInfo;
+  for (const MachineInstr &MI : MBB)
+    transferInstr(MI, Cur);
+
+  // The exit state did not change, neither do the successors.
+  if (Cur == BBInfo.Exit)
+    return;
+
+  BBInfo.Exit = Cur;
+  for (const MachineBasicBlock *S : MBB.successors()) {
+    if (!BlockInfo[S->getNumber()].InQueue) {
+      BlockInfo[S->getNumber()].InQueue = true;
+      WorkList.push(S);
+    }
+  }
+}
+
+void RISCVInsertVSETVLI::computeDataflow(const MachineFunction &MF) {
+  BlockInfo.clear();
+  BlockInfo.resize(MF.getNumBlockIDs());
+
+  for (const MachineBasicBlock &MBB : MF) {
+    computeFirstRequire(MBB);
+    WorkList.push(&MBB);
+    BlockInfo[MBB.getNumber()].InQueue = true;
+  }
+  while (!WorkList.empty()) {
+    const MachineBasicBlock &MBB = *WorkList.front();
+    WorkList.pop();
+    computeIncomingVLVTYPE(MBB);
+  }
+}
+
+bool RISCVInsertVSETVLI::hoistVSETVLIs(MachineFunction &MF) {
+  // Inner loops first, their preheader may be the header of the outer loop.
+  SmallVector<MachineLoop *, 8> Loops;
+  SmallVector<MachineLoop *, 8> Stack(MLI->begin(), MLI->end());
+  while (!Stack.empty()) {
+    MachineLoop *L = Stack.pop_back_val();
+    Loops.push_back(L);
+    Stack.append(L->begin(), L->end());
+  }
+
+  bool Changed = false;
+  for (MachineLoop *L : reverse(Loops)) {
+    MachineBasicBlock *Header = L->getHeader();
+    MachineBasicBlock *Preheader = L->getLoopPreheader();
+    if (!Preheader)
+      continue;
+    const BlockData &HeaderInfo = BlockInfo[Header->getNumber()];
+    const VSETVLIInfo &Require = HeaderInfo.FirstRequire;
+    if (!Require.isValid() || Require.ignoresVL() ||
+        !needVSETVLI(Require, HeaderInfo.Pred) ||
+        !needVSETVLI(Require, BlockInfo[Preheader->getNumber()].Exit))
+      continue;
+
+    // The AVL has to be available in the preheader.
+    if (Require.hasAVLReg() && Require.getAVLReg() != RISCV::X0) {
+      Register AVLReg = Require.getAVLReg();
+      if (!AVLReg.isVirtual())
+        continue;
+      MachineInstr *DefMI = MRI->getVRegDef(AVLReg);
+      if (!DefMI || L->contains(DefMI->getParent()))
+        continue;
+    }
+
+    MachineBasicBlock::iterator InsertPt = Preheader->getFirstTerminator();
+    DebugLoc DL = InsertPt != Preheader->end() ? InsertPt->getDebugLoc()
+                                               : DebugLoc();
+    insertVSETVLI(*Preheader, InsertPt, DL, Require,
+                  BlockInfo[Preheader->getNumber()].Exit);
+    MachineInstr &Hoisted = *std::prev(Preheader->getFirstTerminator());
+    computeDataflow(MF);
+
+    // The loop itself changes the state on the back edge, keep the vsetvli in
+    // the header.
+    if (needVSETVLI(Require, BlockInfo[Header->getNumber()].Pred)) {
+      --NumInserted;
+      Hoisted.eraseFromParent();
+      computeDataflow(MF);
+      continue;
+    }
+    LLVM_DEBUG(dbgs() << "Hoisted vsetvli of " << printMBBReference(*Header)
+                      << " into " << printMBBReference(*Preheader) << "\n");
+    ++NumHoisted;
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool RISCVInsertVSETVLI::emitVSETVLIs(MachineBasicBlock &MBB) {
+  bool Changed = false;
+  VSETVLIInfo Cur = BlockInfo[MBB.getNumber()].Pred;
+
+  for (auto MII = MBB.begin(), MIE = MBB.end(); MII != MIE;) {
+    MachineInstr &MI = *MII++;
+
+    if (isVectorConfigInstr(MI)) {
+      if (isRedundantVSETVLI(MI, Cur)) {
+        LLVM_DEBUG(dbgs() << "Removing redundant " << MI);
+        MI.eraseFromParent();
+        ++NumRemoved;
+        Changed = true;
+        continue;
+      }
+      Cur = getInfoForVSETVLI(MI, Cur);
+      continue;
+    }
+
+    if (isVectorPseudo(MI)) {
+      VSETVLIInfo Require = computeInfoForInstr(MI);
+      if (needVSETVLI(Require, Cur)) {
+        VSETVLIInfo NewInfo = resolveRequire(Require, Cur);
+        insertVSETVLI(MBB, MI, MI.getDebugLoc(), NewInfo, Cur);
+        Cur = NewInfo;
+        Changed = true;
+      }
+
+      // The AVL now lives in VL, remove it from the pseudo.
+      uint64_t TSFlags = MI.getDesc().TSFlags;
+      if (TSFlags & RISCVII::HasVLOpMask) {
+        MachineOperand &VLOp = MI.getOperand(MI.getNumExplicitOperands() - 2);
+        VLOp.setReg(RISCV::NoRegister);
+        VLOp.setIsKill(false);
+      }
+    }
+
+    if (clobbersVLVTYPE(MI))
+      Cur = VSETVLIInfo::getUnknown();
+  }
+
+  assert(Cur == BlockInfo[MBB.getNumber()].Exit &&
+         "Exit state differs from the dataflow result");
+  return Changed;
+}
+
+bool RISCVInsertVSETVLI::runOnMachineFunction(MachineFunction &MF) {
+  // Skip if the vector extension is not enabled.
+  const RISCVSubtarget &ST = MF.getSubtarget<RISCVSubtarget>();
+  if (!ST.hasStdExtV())
+    return false;
+
+  TII = ST.getInstrInfo();
+  MRI = &MF.getRegInfo();
+  MLI = &getAnalysis<MachineLoopInfo>();
+
+  bool HaveVectorOp = false;
+  for (const MachineBasicBlock &MBB : MF)
+    for (const MachineInstr &MI : MBB)
+      HaveVectorOp |= isVectorPseudo(MI);
+  if (!HaveVectorOp)
+    return false;
+
+  computeDataflow(MF);
+
+  bool Changed = false;
+  if (!DisableVSETVLIHoisting && !skipFunction(MF.getFunction()))
+    Changed |= hoistVSETVLIs(MF);
+
+  for (MachineBasicBlock &MBB : MF)
+    Changed |= emitVSETVLIs(MBB);
+
+  BlockInfo.clear();
+  return Changed;
+}
+
+/// Returns an instance of the Insert VSETVLI pass.
+FunctionPass *llvm::createRISCVInsertVSETVLIPass() {
+  return new RISCVInsertVSETVLI();
+}
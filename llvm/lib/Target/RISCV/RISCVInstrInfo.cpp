@@ -13,19 +13,28 @@
 #include "RISCVInstrInfo.h"
 #include "MCTargetDesc/RISCVMatInt.h"
 #include "RISCV.h"
+#include "RISCVMachineFunctionInfo.h"
 #include "RISCVSubtarget.h"
 #include "RISCVTargetMachine.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/PseudoSourceValue.h"
 #include "llvm/CodeGen/RegisterScavenging.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/TargetRegistry.h"
 
 using namespace llvm;
 
+static cl::opt<bool> OutlineFromHotFunctions(
+    "riscv-outline-hot-functions", cl::Hidden,
+    cl::desc("Let the MachineOutliner outline from hot functions"),
+    cl::init(false));
+
 #define GEN_CHECK_COMPRESS_INSTR
 #include "RISCVGenCompressInstEmitter.inc"
 
@@ -513,6 +522,14 @@ unsigned RISCVInstrInfo::getInstSizeInBytes(const MachineInstr &MI) const {
   case TargetOpcode::KILL:
   case TargetOpcode::DBG_VALUE:
     return 0;
+  // XRay sleds, see RISCVAsmPrinter::emitSled. They may need 2 bytes of
+  // padding to be word aligned.
+  case TargetOpcode::PATCHABLE_FUNCTION_ENTER:
+  case TargetOpcode::PATCHABLE_FUNCTION_EXIT:
+  case TargetOpcode::PATCHABLE_TAIL_CALL: {
+    const RISCVSubtarget &ST = MI.getMF()->getSubtarget<RISCVSubtarget>();
+    return (ST.is64Bit() ? 60 : 44) + (ST.hasStdExtC() ? 2 : 0);
+  }
   // These values are determined based on RISCVExpandAtomicPseudoInsts,
   // RISCVExpandPseudoInsts and RISCVMCCodeEmitter, depending on where the
   // pseudos are expanded.
@@ -589,6 +606,19 @@ RISCVInstrInfo::isCopyInstrImpl(const MachineInstr &MI) const {
       return DestSourcePair{MI.getOperand(0), MI.getOperand(1)};
     break;
   case RISCV::FSGNJ_D:
+    // Inside SSR regions, a move from or to ft0-ft2 pops or pushes a stream
+    // element. It must neither be forwarded nor removed as a redundant copy.
+    if (MI.getParent() && MI.getMF()
+                              ->getInfo<RISCVMachineFunctionInfo>()
+                              ->hasSSRRegions()) {
+      auto IsSSRDataReg = [](const MachineOperand &MO) {
+        return MO.isReg() && MO.getReg() >= RISCV::F0_D &&
+               MO.getReg() <= RISCV::F2_D;
+      };
+      if (IsSSRDataReg(MI.getOperand(0)) || IsSSRDataReg(MI.getOperand(1)))
+        break;
+    }
+    LLVM_FALLTHROUGH;
   case RISCV::FSGNJ_S:
     // The canonical floating-point move is fsgnj rd, rs, rs.
     if (MI.getOperand(1).isReg() && MI.getOperand(2).isReg() &&
@@ -710,6 +740,501 @@ bool RISCVInstrInfo::areMemAccessesTriviallyDisjoint(
   return false;
 }
 
+bool RISCVInstrInfo::getMemOperandsWithOffsetWidth(
+    const MachineInstr &MI, SmallVectorImpl<const MachineOperand *> &BaseOps,
+    int64_t &Offset, bool &OffsetIsScalable, unsigned &Width,
+    const TargetRegisterInfo *TRI) const {
+  const MachineOperand *BaseOp;
+  if (!getMemOperandWithOffsetWidth(MI, BaseOp, Offset, Width, TRI))
+    return false;
+  OffsetIsScalable = false;
+  BaseOps.push_back(BaseOp);
+  return true;
+}
+
+bool RISCVInstrInfo::getIncrementValue(const MachineInstr &MI,
+                                       int &Value) const {
+  if (MI.getOpcode() != RISCV::ADDI || !MI.getOperand(1).isReg() ||
+      MI.getOperand(1).getReg() == RISCV::X0 || !MI.getOperand(2).isImm())
+    return false;
+  Value = MI.getOperand(2).getImm();
+  return true;
+}
+
+// Return the banks the single memory operand MMO may reach.
+static RISCVInstrInfo::MempoolLocality
+getMempoolLocality(const MachineMemOperand &MMO) {
+  using MempoolLocality = RISCVInstrInfo::MempoolLocality;
+  switch (MMO.getAddrSpace()) {
+  case RISCVAS::MEMPOOL_SEQ:
+    return MempoolLocality::Tile;
+  case RISCVAS::MEMPOOL_GROUP:
+    return MempoolLocality::Group;
+  default:
+    break;
+  }
+  // The runtime places the stacks in the sequential region.
+  if (const PseudoSourceValue *PSV = MMO.getPseudoValue())
+    if (PSV->isStack() || PSV->kind() == PseudoSourceValue::FixedStack)
+      return MempoolLocality::Tile;
+  if (const Value *V = MMO.getValue())
+    if (isa<AllocaInst>(getUnderlyingObject(V)))
+      return MempoolLocality::Tile;
+  return MempoolLocality::Remote;
+}
+
+RISCVInstrInfo::MempoolLocality
+RISCVInstrInfo::getMempoolLocality(const MachineInstr &MI) const {
+  if (!STI.hasExtXmempool() || !MI.mayLoadOrStore())
+    return MempoolLocality::Remote;
+  if (MI.memoperands_empty())
+    return MI.getNumOperands() > 1 && MI.getOperand(1).isFI()
+               ? MempoolLocality::Tile
+               : MempoolLocality::Remote;
+  MempoolLocality Locality = MempoolLocality::Tile;
+  for (const MachineMemOperand *MMO : MI.memoperands())
+    Locality = std::max(Locality, ::getMempoolLocality(*MMO));
+  return Locality;
+}
+
+namespace {
+// Loop information for the MachinePipeliner. RISC-V has no loop counter
+// register, so the exit of the loop is a compare-and-branch on an induction
+// variable. The pipeliner does not keep the stage of that induction variable
+// in sync with the kernel's trip count, thus the kernel is given its own down
+// counter, which the PULP hardware loop pass can turn into a zero-overhead
+// loop afterwards.
+class RISCVPipelinerLoopInfo : public TargetInstrInfo::PipelinerLoopInfo {
+  MachineBasicBlock *LoopBB, *Preheader;
+  MachineBasicBlock *NewPreheader = nullptr;
+  MachineRegisterInfo &MRI;
+  const RISCVInstrInfo *TII;
+  DebugLoc DL;
+  // Induction variable: the loop iterates while Init + i * Step does not
+  // reach End. Only steps with a power-of-two magnitude are supported.
+  Register Init, End;
+  int64_t Step;
+  bool Exact;
+  // Whether an ordered exit compares unsigned.
+  bool Unsigned;
+  // Trip count if known at compile-time, -1 otherwise.
+  int64_t TripCount;
+  // Trip count materialized in the preheader on first use.
+  Register TripCountReg;
+
+public:
+  RISCVPipelinerLoopInfo(MachineBasicBlock *LoopBB,
+                         MachineBasicBlock *Preheader, Register Init,
+                         Register End, int64_t Step, bool Exact,
+                         bool Unsigned, int64_t TripCount, DebugLoc DL)
+      : LoopBB(LoopBB), Preheader(Preheader),
+        MRI(LoopBB->getParent()->getRegInfo()),
+        TII(static_cast<const RISCVInstrInfo *>(
+            LoopBB->getParent()->getSubtarget().getInstrInfo())),
+        DL(DL), Init(Init), End(End), Step(Step), Exact(Exact),
+        Unsigned(Unsigned), TripCount(TripCount) {}
+
+  bool shouldIgnoreForPipelining(const MachineInstr *MI) const override {
+    // Only ignore the terminator.
+    return MI->isTerminator();
+  }
+
+  Optional<bool> createTripCountGreaterCondition(
+      int TC, MachineBasicBlock &MBB,
+      SmallVectorImpl<MachineOperand> &Cond) override {
+    if (TripCount != -1)
+      return TripCount > TC;
+
+    // The condition is taken if the loop ends before reaching the kernel, i.e.
+    // if TC >= trip count.
+    Register TCReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(MBB, MBB.getFirstTerminator(), DL, TII->get(RISCV::ADDI), TCReg)
+        .addReg(RISCV::X0)
+        .addImm(TC);
+    Cond.push_back(MachineOperand::CreateImm(RISCV::BGEU));
+    Cond.push_back(MachineOperand::CreateReg(TCReg, false));
+    Cond.push_back(MachineOperand::CreateReg(getTripCountReg(), false));
+    return {};
+  }
+
+  void setPreheader(MachineBasicBlock *NewPreheader) override {
+    this->NewPreheader = NewPreheader;
+  }
+
+  void adjustTripCount(int TripCountAdjust) override {
+    // The peeling expander pipelines the loop in place, the default expander
+    // creates a new kernel after the last prolog.
+    MachineBasicBlock *Kernel = LoopBB;
+    if (NewPreheader)
+      for (MachineBasicBlock *Succ : NewPreheader->successors())
+        if (Succ->isSuccessor(Succ))
+          Kernel = Succ;
+    MachineBasicBlock *KernelPreheader = nullptr, *Exit = nullptr;
+    for (MachineBasicBlock *Pred : Kernel->predecessors())
+      if (Pred != Kernel)
+        KernelPreheader = Pred;
+    for (MachineBasicBlock *Succ : Kernel->successors())
+      if (Succ != Kernel)
+        Exit = Succ;
+    assert(KernelPreheader && Exit && "Kernel is not a loop!");
+
+    Register Count = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    if (TripCount != -1) {
+      TII->movImm(*KernelPreheader, KernelPreheader->getFirstTerminator(), DL,
+                  Count, TripCount + TripCountAdjust);
+    } else {
+      MachineBasicBlock::iterator InsertPt = Preheader->getFirstTerminator();
+      Register TC = getTripCountReg();
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::ADDI), Count)
+          .addReg(TC)
+          .addImm(TripCountAdjust);
+    }
+
+    Register Counter = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Register CounterNext = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(*Kernel, Kernel->begin(), DL, TII->get(TargetOpcode::PHI), Counter)
+        .addReg(Count)
+        .addMBB(KernelPreheader)
+        .addReg(CounterNext)
+        .addMBB(Kernel);
+    TII->removeBranch(*Kernel);
+    BuildMI(Kernel, DL, TII->get(RISCV::ADDI), CounterNext)
+        .addReg(Counter)
+        .addImm(-1);
+    SmallVector<MachineOperand, 3> Cond;
+    Cond.push_back(MachineOperand::CreateImm(RISCV::BNE));
+    Cond.push_back(MachineOperand::CreateReg(CounterNext, false));
+    Cond.push_back(MachineOperand::CreateReg(RISCV::X0, false));
+    TII->insertBranch(*Kernel, Kernel, Exit, Cond, DL);
+  }
+
+  void disposed() override {
+    // The trip count computation is left to dead code elimination.
+  }
+
+private:
+  Register getTripCountReg() {
+    if (TripCountReg)
+      return TripCountReg;
+
+    MachineBasicBlock::iterator InsertPt = Preheader->getFirstTerminator();
+    Register From = Step > 0 ? Init : End, To = Step > 0 ? End : Init;
+    Register Distance = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::SUB), Distance)
+        .addReg(To)
+        .addReg(From);
+
+    // The loop is bottom-tested, so an ordered exit runs it once even if the
+    // induction variable starts past the end value, which the preheader has
+    // no guard for. The distance is clamped to at least one:
+    //   Distance = ((Distance - 1) & -(From < To)) + 1
+    if (!Exact) {
+      Register Less = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL,
+              TII->get(Unsigned ? RISCV::SLTU : RISCV::SLT), Less)
+          .addReg(From)
+          .addReg(To);
+      Register Mask = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::SUB), Mask)
+          .addReg(RISCV::X0)
+          .addReg(Less);
+      Register Pred = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::ADDI), Pred)
+          .addReg(Distance)
+          .addImm(-1);
+      Register Masked = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::AND), Masked)
+          .addReg(Pred)
+          .addReg(Mask);
+      Distance = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::ADDI), Distance)
+          .addReg(Masked)
+          .addImm(1);
+    }
+    uint64_t AbsStep = std::abs(Step);
+    if (AbsStep == 1)
+      return TripCountReg = Distance;
+
+    // The trip count is the distance divided by the step, rounded up if the
+    // exit compares for ordering instead of equality.
+    if (!Exact) {
+      Register Rounded = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+      BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::ADDI), Rounded)
+          .addReg(Distance)
+          .addImm(AbsStep - 1);
+      Distance = Rounded;
+    }
+    TripCountReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    BuildMI(*Preheader, InsertPt, DL, TII->get(RISCV::SRLI), TripCountReg)
+        .addReg(Distance)
+        .addImm(Log2_64(AbsStep));
+    return TripCountReg;
+  }
+};
+} // namespace
+
+// Return the constant held by Reg if it is X0 or materialized by a single
+// ADDI from X0.
+static bool getConstantValue(const MachineRegisterInfo &MRI, Register Reg,
+                             int64_t &Value) {
+  if (Reg == RISCV::X0) {
+    Value = 0;
+    return true;
+  }
+  if (!Reg.isVirtual())
+    return false;
+  const MachineInstr *Def = MRI.getVRegDef(Reg);
+  if (!Def || Def->getOpcode() != RISCV::ADDI ||
+      !Def->getOperand(1).isReg() || Def->getOperand(1).getReg() != RISCV::X0)
+    return false;
+  Value = Def->getOperand(2).getImm();
+  return true;
+}
+
+std::unique_ptr<TargetInstrInfo::PipelinerLoopInfo>
+RISCVInstrInfo::analyzeLoopForPipelining(MachineBasicBlock *LoopBB) const {
+  if (LoopBB->pred_size() != 2 || !LoopBB->isSuccessor(LoopBB))
+    return nullptr;
+  MachineBasicBlock *Preheader = *LoopBB->pred_begin();
+  if (Preheader == LoopBB)
+    Preheader = *std::next(LoopBB->pred_begin());
+
+  MachineFunction *MF = LoopBB->getParent();
+  const TargetRegisterInfo *TRI = STI.getRegisterInfo();
+  bool HasSSRRegions = MF->getInfo<RISCVMachineFunctionInfo>()->hasSSRRegions();
+  for (const MachineInstr &MI : *LoopBB) {
+    // Leave loops to their dedicated hardware loop passes.
+    if (MI.isCall() || MI.getOpcode() == RISCV::FREP_O ||
+        MI.getOpcode() == RISCV::FREP_I ||
+        MI.getOpcode() == RISCV::PseudoFrepInfer)
+      return nullptr;
+    // Each access of an SSR data register pushes or pops the stream, the
+    // order of these accesses must not change.
+    if (HasSSRRegions)
+      for (MCRegister R : {RISCV::F0_D, RISCV::F1_D, RISCV::F2_D})
+        if (MI.readsRegister(R, TRI) || MI.modifiesRegister(R, TRI))
+          return nullptr;
+  }
+
+  // Get the condition under which the loop is continued.
+  MachineBasicBlock *TBB = nullptr, *FBB = nullptr;
+  SmallVector<MachineOperand, 3> Cond;
+  MachineBasicBlock::iterator Term = LoopBB->getFirstTerminator();
+  if (Term == LoopBB->end() || !Term->isConditionalBranch() ||
+      analyzeBranch(*LoopBB, TBB, FBB, Cond, false) || Cond.empty())
+    return nullptr;
+  if (TBB != LoopBB) {
+    if (FBB != LoopBB || reverseBranchCondition(Cond))
+      return nullptr;
+  }
+  if (!Cond[1].isReg() || !Cond[2].isReg())
+    return nullptr;
+
+  // Find the induction variable, which is bumped by a constant in the loop
+  // and compared against a loop invariant value.
+  const MachineRegisterInfo &MRI = MF->getRegInfo();
+  auto getIVBump = [&](Register R) -> const MachineInstr * {
+    if (!R.isVirtual())
+      return nullptr;
+    const MachineInstr *Bump = MRI.getVRegDef(R);
+    int Value;
+    if (!Bump || Bump->getParent() != LoopBB ||
+        !getIncrementValue(*Bump, Value))
+      return nullptr;
+    const MachineInstr *Phi = MRI.getVRegDef(Bump->getOperand(1).getReg());
+    if (!Phi || !Phi->isPHI() || Phi->getParent() != LoopBB)
+      return nullptr;
+    for (unsigned I = 1, E = Phi->getNumOperands(); I != E; I += 2)
+      if (Phi->getOperand(I + 1).getMBB() == LoopBB &&
+          Phi->getOperand(I).getReg() != R)
+        return nullptr;
+    return Bump;
+  };
+  auto isInvariant = [&](Register R) {
+    if (R == RISCV::X0)
+      return true;
+    if (!R.isVirtual())
+      return false;
+    const MachineInstr *Def = MRI.getVRegDef(R);
+    return Def && Def->getParent() != LoopBB;
+  };
+
+  unsigned Opc = Cond[0].getImm();
+  Register LHS = Cond[1].getReg(), RHS = Cond[2].getReg();
+  const MachineInstr *Bump = getIVBump(LHS);
+  bool IVIsLHS = Bump != nullptr;
+  if (!Bump)
+    Bump = getIVBump(RHS);
+  if (!Bump || !isInvariant(IVIsLHS ? RHS : LHS))
+    return nullptr;
+  Register End = IVIsLHS ? RHS : LHS;
+  int64_t Step = Bump->getOperand(2).getImm();
+  if (Step == 0 || !isPowerOf2_64(std::abs(Step)))
+    return nullptr;
+
+  // Continuing on inequality requires the induction variable to hit the end
+  // value exactly. Ordered compares must move the induction variable towards
+  // the end value.
+  bool Exact;
+  switch (Opc) {
+  case RISCV::BNE:
+    Exact = true;
+    break;
+  case RISCV::BLT:
+  case RISCV::BLTU:
+    if ((Step > 0) != IVIsLHS)
+      return nullptr;
+    Exact = false;
+    break;
+  default:
+    return nullptr;
+  }
+
+  const MachineInstr *Phi = MRI.getVRegDef(Bump->getOperand(1).getReg());
+  Register Init;
+  for (unsigned I = 1, E = Phi->getNumOperands(); I != E; I += 2)
+    if (Phi->getOperand(I + 1).getMBB() == Preheader)
+      Init = Phi->getOperand(I).getReg();
+  if (!Init)
+    return nullptr;
+
+  int64_t TripCount = -1;
+  int64_t InitValue, EndValue;
+  if (getConstantValue(MRI, Init, InitValue) &&
+      getConstantValue(MRI, End, EndValue)) {
+    int64_t Distance = Step > 0 ? EndValue - InitValue : InitValue - EndValue;
+    int64_t AbsStep = std::abs(Step);
+    if (Exact && (Distance <= 0 || Distance % AbsStep))
+      return nullptr;
+    // The loop is bottom-tested and executes at least once.
+    TripCount = std::max<int64_t>(1, (Distance + AbsStep - 1) / AbsStep);
+  }
+
+  return std::make_unique<RISCVPipelinerLoopInfo>(
+      LoopBB, Preheader, Init, End, Step, Exact, Opc == RISCV::BLTU,
+      TripCount, Term->getDebugLoc());
+}
+
+// Return the PULPv2 multiply-accumulate which adds (or subtracts, if \p Sub)
+// the result of the multiply \p MulOpc to a register, or 0 if there is none.
+static unsigned getMACOpcode(unsigned MulOpc, bool Sub) {
+  switch (MulOpc) {
+  case RISCV::MUL:
+    return Sub ? RISCV::P_MSU : RISCV::P_MAC;
+  case RISCV::P_MULS:
+    return Sub ? 0 : RISCV::P_MACS;
+  case RISCV::P_MULHHS:
+    return Sub ? 0 : RISCV::P_MACHHS;
+  case RISCV::P_MULU:
+    return Sub ? 0 : RISCV::P_MACU;
+  case RISCV::P_MULHHU:
+    return Sub ? 0 : RISCV::P_MACHHU;
+  default:
+    return 0;
+  }
+}
+
+// Return true if operand \p MulIdx of \p Root is defined by a multiply in the
+// same block whose only use is \p Root, and the other operand is a virtual
+// register which can be the accumulator.
+static bool canCombineWithMul(const MachineInstr &Root, unsigned MulIdx,
+                              bool Sub) {
+  const MachineRegisterInfo &MRI = Root.getMF()->getRegInfo();
+  const MachineOperand &MO = Root.getOperand(MulIdx);
+  const MachineOperand &Acc = Root.getOperand(3 - MulIdx);
+  if (!MO.isReg() || !MO.getReg().isVirtual() || !Acc.isReg() ||
+      !Acc.getReg().isVirtual())
+    return false;
+  const MachineInstr *Mul = MRI.getUniqueVRegDef(MO.getReg());
+  if (!Mul || Mul->getParent() != Root.getParent() ||
+      !getMACOpcode(Mul->getOpcode(), Sub))
+    return false;
+  return MRI.hasOneNonDBGUse(MO.getReg());
+}
+
+bool RISCVInstrInfo::getMachineCombinerPatterns(
+    MachineInstr &Root, SmallVectorImpl<MachineCombinerPattern> &Patterns,
+    bool DoRegPressureReduce) const {
+  if (STI.hasPULPExtV2() && !STI.is64Bit()) {
+    switch (Root.getOpcode()) {
+    case RISCV::ADD:
+      if (canCombineWithMul(Root, 1, false))
+        Patterns.push_back(MachineCombinerPattern::PULP_MAC_OP1);
+      if (canCombineWithMul(Root, 2, false))
+        Patterns.push_back(MachineCombinerPattern::PULP_MAC_OP2);
+      break;
+    case RISCV::SUB:
+      if (canCombineWithMul(Root, 2, true))
+        Patterns.push_back(MachineCombinerPattern::PULP_MSU_OP2);
+      break;
+    default:
+      break;
+    }
+    if (!Patterns.empty())
+      return true;
+  }
+  return TargetInstrInfo::getMachineCombinerPatterns(Root, Patterns,
+                                                     DoRegPressureReduce);
+}
+
+bool RISCVInstrInfo::isThroughputPattern(
+    MachineCombinerPattern Pattern) const {
+  switch (Pattern) {
+  // A multiply-accumulate saves an instruction, which is all that counts on
+  // the single-issue PULP cores.
+  case MachineCombinerPattern::PULP_MAC_OP1:
+  case MachineCombinerPattern::PULP_MAC_OP2:
+  case MachineCombinerPattern::PULP_MSU_OP2:
+    return true;
+  default:
+    return TargetInstrInfo::isThroughputPattern(Pattern);
+  }
+}
+
+void RISCVInstrInfo::genAlternativeCodeSequence(
+    MachineInstr &Root, MachineCombinerPattern Pattern,
+    SmallVectorImpl<MachineInstr *> &InsInstrs,
+    SmallVectorImpl<MachineInstr *> &DelInstrs,
+    DenseMap<unsigned, unsigned> &InstrIdxForVirtReg) const {
+  unsigned MulIdx;
+  switch (Pattern) {
+  case MachineCombinerPattern::PULP_MAC_OP1:
+    MulIdx = 1;
+    break;
+  case MachineCombinerPattern::PULP_MAC_OP2:
+  case MachineCombinerPattern::PULP_MSU_OP2:
+    MulIdx = 2;
+    break;
+  default:
+    TargetInstrInfo::genAlternativeCodeSequence(Root, Pattern, InsInstrs,
+                                                DelInstrs, InstrIdxForVirtReg);
+    return;
+  }
+
+  // MUL I = A, B; ADD R = C, I  ==>  P_MAC R = C, A, B
+  MachineFunction &MF = *Root.getMF();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  MachineInstr *Mul = MRI.getUniqueVRegDef(Root.getOperand(MulIdx).getReg());
+  const MachineOperand &Acc = Root.getOperand(3 - MulIdx);
+  const MachineOperand &A = Mul->getOperand(1);
+  const MachineOperand &B = Mul->getOperand(2);
+  unsigned Opc = getMACOpcode(Mul->getOpcode(), Root.getOpcode() == RISCV::SUB);
+
+  Register Dst = Root.getOperand(0).getReg();
+  for (Register Reg : {Dst, Acc.getReg(), A.getReg(), B.getReg()})
+    if (Reg.isVirtual())
+      MRI.constrainRegClass(Reg, &RISCV::GPRRegClass);
+
+  MachineInstrBuilder MIB =
+      BuildMI(MF, Root.getDebugLoc(), get(Opc), Dst)
+          .addReg(Acc.getReg(), getKillRegState(Acc.isKill()))
+          .addReg(A.getReg(), getKillRegState(A.isKill()))
+          .addReg(B.getReg(), getKillRegState(B.isKill()));
+  InsInstrs.push_back(MIB);
+  DelInstrs.push_back(Mul);
+  DelInstrs.push_back(&Root);
+}
+
 std::pair<unsigned, unsigned>
 RISCVInstrInfo::decomposeMachineOperandsTargetFlags(unsigned TF) const {
   const unsigned Mask = RISCVII::MO_DIRECT_FLAG_MASK;
@@ -747,32 +1272,113 @@ bool RISCVInstrInfo::isFunctionSafeToOutlineFrom(
   if (F.hasSection())
     return false;
 
+  // Keep the hot working set in one piece in the instruction cache. Calls to
+  // outlined code from hot paths pull in extra lines and cost a call and a
+  // return per execution.
+  if (!OutlineFromHotFunctions && RISCVMachineFunctionInfo::isHotFunction(F))
+    return false;
+
   // It's safe to outline from MF.
   return true;
 }
 
 bool RISCVInstrInfo::isMBBSafeToOutlineFrom(MachineBasicBlock &MBB,
                                             unsigned &Flags) const {
+  // The body of an frep loop is the sequence of instructions following the
+  // frep, it has to stay in place.
+  for (const MachineInstr &MI : MBB)
+    if (MI.getOpcode() == RISCV::FREP_O || MI.getOpcode() == RISCV::FREP_I)
+      return false;
+
+  // A hardware loop ends at the last instruction of the block referenced by
+  // its setup, which must not be replaced by a call.
+  for (const MachineBasicBlock &Other : *MBB.getParent())
+    for (const MachineInstr &MI : Other) {
+      switch (MI.getOpcode()) {
+      case RISCV::LOOP0setup:
+      case RISCV::LOOP1setup:
+      case RISCV::LOOP0setupi:
+      case RISCV::LOOP1setupi:
+        if (MI.getOperand(0).isMBB() && MI.getOperand(0).getMBB() == &MBB)
+          return false;
+        break;
+      default:
+        break;
+      }
+    }
+
   // More accurate safety checking is done in getOutliningCandidateInfo.
   return true;
 }
 
+bool RISCVInstrInfo::isMBBSafeToSplitToCold(
+    const MachineBasicBlock &MBB) const {
+  if (!STI.hasPULPExtV2())
+    return true;
+
+  // A hardware loop runs from the instruction after its setup to the end of
+  // the block referenced by the setup. Neither the setup nor any block of the
+  // body may leave the section. The splitter numbers the blocks in layout
+  // order, nested loops end before the loop around them.
+  const MachineBasicBlock *LoopEnd = nullptr;
+  for (const MachineBasicBlock &Other : *MBB.getParent()) {
+    bool InLoop = LoopEnd != nullptr;
+    for (const MachineInstr &MI : Other) {
+      switch (MI.getOpcode()) {
+      case RISCV::LOOP0setup:
+      case RISCV::LOOP1setup:
+      case RISCV::LOOP0setupi:
+      case RISCV::LOOP1setupi:
+        if (MI.getOperand(0).isMBB()) {
+          const MachineBasicBlock *End = MI.getOperand(0).getMBB();
+          if (!LoopEnd || End->getNumber() > LoopEnd->getNumber())
+            LoopEnd = End;
+          InLoop = true;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+    if (&Other == &MBB)
+      return !InLoop;
+    if (&Other == LoopEnd)
+      LoopEnd = nullptr;
+  }
+  return true;
+}
+
 // Enum values indicating how an outlined call should be constructed.
 enum MachineOutlinerConstructionID {
-  MachineOutlinerDefault
+  MachineOutlinerDefault,
+  MachineOutlinerTailCall
 };
 
 outliner::OutlinedFunction RISCVInstrInfo::getOutliningCandidateInfo(
     std::vector<outliner::Candidate> &RepeatedSequenceLocs) const {
 
-  // First we need to filter out candidates where the X5 register (IE t0) can't
-  // be used to setup the function call.
-  auto CannotInsertCall = [](outliner::Candidate &C) {
+  unsigned SequenceSize = 0;
+
+  auto I = RepeatedSequenceLocs[0].front();
+  auto E = std::next(RepeatedSequenceLocs[0].back());
+  for (; I != E; ++I)
+    SequenceSize += getInstSizeInBytes(*I);
+
+  // Sequences ending in a return are reached with a tail call and return
+  // directly to the caller of the function they were outlined from. The tail
+  // call goes through X6 (IE t1), otherwise the call goes through X5 (IE t0)
+  // which also holds the return address.
+  bool IsTailCall = RepeatedSequenceLocs[0].back()->isReturn();
+  Register CallReg = IsTailCall ? RISCV::X6 : RISCV::X5;
+
+  // First we need to filter out candidates where that register can't be used
+  // to setup the function call.
+  auto CannotInsertCall = [CallReg](outliner::Candidate &C) {
     const TargetRegisterInfo *TRI = C.getMF()->getSubtarget().getRegisterInfo();
 
     C.initLRU(*TRI);
     LiveRegUnits LRU = C.LRU;
-    return !LRU.available(RISCV::X5);
+    return !LRU.available(CallReg);
   };
 
   llvm::erase_if(RepeatedSequenceLocs, CannotInsertCall);
@@ -781,12 +1387,13 @@ outliner::OutlinedFunction RISCVInstrInfo::getOutliningCandidateInfo(
   if (RepeatedSequenceLocs.size() < 2)
     return outliner::OutlinedFunction();
 
-  unsigned SequenceSize = 0;
-
-  auto I = RepeatedSequenceLocs[0].front();
-  auto E = std::next(RepeatedSequenceLocs[0].back());
-  for (; I != E; ++I)
-    SequenceSize += getInstSizeInBytes(*I);
+  // tail function = 8 bytes, the outlined frame needs no return.
+  if (IsTailCall) {
+    for (auto &C : RepeatedSequenceLocs)
+      C.setCallInfo(MachineOutlinerTailCall, 8);
+    return outliner::OutlinedFunction(RepeatedSequenceLocs, SequenceSize, 0,
+                                      MachineOutlinerTailCall);
+  }
 
   // call t0, function = 8 bytes.
   unsigned CallOverhead = 8;
@@ -828,13 +1435,8 @@ RISCVInstrInfo::getOutliningType(MachineBasicBlock::iterator &MBBI,
   if (MI.isTerminator() && !MBB->succ_empty())
     return outliner::InstrType::Illegal;
 
-  // We need support for tail calls to outlined functions before return
-  // statements can be allowed.
-  if (MI.isReturn())
-    return outliner::InstrType::Illegal;
-
   // Don't allow modifying the X5 register which we use for return addresses for
-  // these outlined functions.
+  // these outlined functions. This also rules out calls, which clobber it.
   if (MI.modifiesRegister(RISCV::X5, TRI) ||
       MI.getDesc().hasImplicitDefOfPhysReg(RISCV::X5))
     return outliner::InstrType::Illegal;
@@ -844,6 +1446,10 @@ RISCVInstrInfo::getOutliningType(MachineBasicBlock::iterator &MBBI,
     if (MO.isMBB() || MO.isBlockAddress() || MO.isCPI())
       return outliner::InstrType::Illegal;
 
+  // Returns end a sequence that is reached with a tail call.
+  if (MI.isReturn())
+    return outliner::InstrType::LegalTerminator;
+
   // Don't allow instructions which won't be materialized to impact outlining
   // analysis.
   if (MI.isMetaInstruction())
@@ -871,6 +1477,10 @@ void RISCVInstrInfo::buildOutlinedFrame(
     }
   }
 
+  // A tail called frame returns with the outlined return.
+  if (OF.FrameConstructionID == MachineOutlinerTailCall)
+    return;
+
   MBB.addLiveIn(RISCV::X5);
 
   // Add in a return instruction to the end of the outlined frame.
@@ -884,6 +1494,14 @@ MachineBasicBlock::iterator RISCVInstrInfo::insertOutlinedCall(
     Module &M, MachineBasicBlock &MBB, MachineBasicBlock::iterator &It,
     MachineFunction &MF, const outliner::Candidate &C) const {
 
+  // Tail call the outlined function through t1, see PseudoTAIL.
+  if (C.CallConstructionID == MachineOutlinerTailCall) {
+    It = MBB.insert(It, BuildMI(MF, DebugLoc(), get(RISCV::PseudoTAIL))
+                            .addGlobalAddress(M.getNamedValue(MF.getName()),
+                                              0, RISCVII::MO_CALL));
+    return It;
+  }
+
   // Add in a call instruction to the outlined function at the given location.
   It = MBB.insert(It,
                   BuildMI(MF, DebugLoc(), get(RISCV::PseudoCALLReg), RISCV::X5)
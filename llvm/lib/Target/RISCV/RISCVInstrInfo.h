@@ -94,9 +94,45 @@ public:
                                     int64_t &Offset, unsigned &Width,
                                     const TargetRegisterInfo *TRI) const;
 
+  bool getMemOperandsWithOffsetWidth(
+      const MachineInstr &MI, SmallVectorImpl<const MachineOperand *> &BaseOps,
+      int64_t &Offset, bool &OffsetIsScalable, unsigned &Width,
+      const TargetRegisterInfo *TRI) const override;
+
   bool areMemAccessesTriviallyDisjoint(const MachineInstr &MIa,
                                        const MachineInstr &MIb) const override;
 
+  bool getIncrementValue(const MachineInstr &MI, int &Value) const override;
+
+  // The banks a MemPool memory access may reach, from the closest to the
+  // farthest ones.
+  enum class MempoolLocality { Tile, Group, Remote };
+
+  // Return the farthest banks the memory access MI may touch. The stack and
+  // data in RISCVAS::MEMPOOL_SEQ are in the own tile, data in
+  // RISCVAS::MEMPOOL_GROUP in the own group.
+  MempoolLocality getMempoolLocality(const MachineInstr &MI) const;
+
+  // Analyze a single-block loop with a compare-and-branch exit for the
+  // MachinePipeliner.
+  std::unique_ptr<PipelinerLoopInfo>
+  analyzeLoopForPipelining(MachineBasicBlock *LoopBB) const override;
+
+  // Fold multiplies into the PULPv2 multiply-accumulate instructions.
+  bool useMachineCombiner() const override { return true; }
+
+  bool getMachineCombinerPatterns(
+      MachineInstr &Root, SmallVectorImpl<MachineCombinerPattern> &Patterns,
+      bool DoRegPressureReduce) const override;
+
+  bool isThroughputPattern(MachineCombinerPattern Pattern) const override;
+
+  void genAlternativeCodeSequence(
+      MachineInstr &Root, MachineCombinerPattern Pattern,
+      SmallVectorImpl<MachineInstr *> &InsInstrs,
+      SmallVectorImpl<MachineInstr *> &DelInstrs,
+      DenseMap<unsigned, unsigned> &InstrIdxForVirtReg) const override;
+
 
   std::pair<unsigned, unsigned>
   decomposeMachineOperandsTargetFlags(unsigned TF) const override;
@@ -114,6 +150,10 @@ public:
   virtual bool isMBBSafeToOutlineFrom(MachineBasicBlock &MBB,
                                       unsigned &Flags) const override;
 
+  // Return true if MBB is not part of a hardware loop, whose body must stay
+  // contiguous.
+  bool isMBBSafeToSplitToCold(const MachineBasicBlock &MBB) const override;
+
   // Calculate target-specific information for a set of outlining candidates.
   outliner::OutlinedFunction getOutliningCandidateInfo(
       std::vector<outliner::Candidate> &RepeatedSequenceLocs) const override;
@@ -11,11 +11,14 @@
 /// \todo This should be generated by TableGen.
 //===----------------------------------------------------------------------===//
 
+#include "MCTargetDesc/RISCVMatInt.h"
 #include "RISCVRegisterBankInfo.h"
 #include "RISCVSubtarget.h"
 #include "RISCVTargetMachine.h"
 #include "llvm/CodeGen/GlobalISel/InstructionSelector.h"
 #include "llvm/CodeGen/GlobalISel/InstructionSelectorImpl.h"
+#include "llvm/CodeGen/GlobalISel/MachineIRBuilder.h"
+#include "llvm/CodeGen/GlobalISel/Utils.h"
 #include "llvm/IR/IntrinsicsRISCV.h"
 #include "llvm/Support/Debug.h"
 
@@ -40,7 +43,27 @@ public:
 
 private:
   bool selectImpl(MachineInstr &I, CodeGenCoverage &CoverageInfo) const;
+  bool isRegInGPRB(Register Reg, MachineRegisterInfo &MRI) const;
+  const TargetRegisterClass *
+  getRegClassForTypeOnBank(Register Reg, MachineRegisterInfo &MRI) const;
+  bool constrainDef(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectCopy(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool materializeImm(Register DstReg, int64_t Imm, MachineIRBuilder &B) const;
+  bool selectFConstant(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectGlobalValue(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectLoadStore(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectICmp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectFCmp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectBrCond(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectSelect(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectF64Pseudo(MachineInstr &I, MachineRegisterInfo &MRI) const;
 
+  /// Fold a constant offset and a frame index defining \p Addr into the
+  /// base and offset operands of a memory access.
+  void selectAddrRegImm(Register Addr, MachineRegisterInfo &MRI,
+                        MachineOperand &Base, int64_t &Offset) const;
+
+  const RISCVTargetMachine &TM;
   const RISCVSubtarget &STI;
   const RISCVInstrInfo &TII;
   const RISCVRegisterInfo &TRI;
@@ -69,7 +92,7 @@ private:
 RISCVInstructionSelector::RISCVInstructionSelector(
     const RISCVTargetMachine &TM, const RISCVSubtarget &STI,
     const RISCVRegisterBankInfo &RBI)
-    : InstructionSelector(), STI(STI), TII(*STI.getInstrInfo()),
+    : InstructionSelector(), TM(TM), STI(STI), TII(*STI.getInstrInfo()),
       TRI(*STI.getRegisterInfo()), RBI(RBI),
 
 #define GET_GLOBALISEL_PREDICATES_INIT
@@ -81,17 +104,596 @@ RISCVInstructionSelector::RISCVInstructionSelector(
 {
 }
 
+bool RISCVInstructionSelector::isRegInGPRB(Register Reg,
+                                           MachineRegisterInfo &MRI) const {
+  return RBI.getRegBank(Reg, MRI, TRI)->getID() == RISCV::GPRRegBankID;
+}
+
+const TargetRegisterClass *RISCVInstructionSelector::getRegClassForTypeOnBank(
+    Register Reg, MachineRegisterInfo &MRI) const {
+  const LLT Ty = MRI.getType(Reg);
+
+  if (isRegInGPRB(Reg, MRI)) {
+    if (Ty == LLT::vector(2, 16))
+      return &RISCV::PulpV2RegClass;
+    if (Ty == LLT::vector(4, 8))
+      return &RISCV::PulpV4RegClass;
+    return &RISCV::GPRRegClass;
+  }
+
+  assert(Ty.isScalar() &&
+         (Ty.getSizeInBits() == 32 || Ty.getSizeInBits() == 64) &&
+         "Register class not available for LLT, register bank combination");
+  return Ty.getSizeInBits() == 32 ? &RISCV::FPR32RegClass
+                                  : &RISCV::FPR64RegClass;
+}
+
+bool RISCVInstructionSelector::constrainDef(MachineInstr &I,
+                                            MachineRegisterInfo &MRI) const {
+  Register DstReg = I.getOperand(0).getReg();
+  if (DstReg.isPhysical())
+    return true;
+
+  const TargetRegisterClass *RC = getRegClassForTypeOnBank(DstReg, MRI);
+  if (!RBI.constrainGenericRegister(DstReg, *RC, MRI)) {
+    LLVM_DEBUG(dbgs() << "Failed to constrain " << TII.getName(I.getOpcode())
+                      << " operand\n");
+    return false;
+  }
+  return true;
+}
+
+bool RISCVInstructionSelector::selectCopy(MachineInstr &I,
+                                          MachineRegisterInfo &MRI) const {
+  Register DstReg = I.getOperand(0).getReg();
+  Register SrcReg = I.getOperand(1).getReg();
+  const RegisterBank *DstBank = RBI.getRegBank(DstReg, MRI, TRI);
+  const RegisterBank *SrcBank = RBI.getRegBank(SrcReg, MRI, TRI);
+
+  // Copies between register banks are moves between the register files.
+  if (DstBank && SrcBank && DstBank != SrcBank) {
+    if (!STI.hasStdExtF() || RBI.getSizeInBits(DstReg, MRI, TRI) != 32)
+      return false;
+    I.setDesc(TII.get(DstBank->getID() == RISCV::FPRRegBankID
+                          ? RISCV::FMV_W_X
+                          : RISCV::FMV_X_W));
+    return constrainSelectedInstRegOperands(I, TII, TRI, RBI);
+  }
+
+  return constrainDef(I, MRI);
+}
+
+bool RISCVInstructionSelector::materializeImm(Register DstReg, int64_t Imm,
+                                              MachineIRBuilder &B) const {
+  MachineRegisterInfo &MRI = *B.getMRI();
+  RISCVMatInt::InstSeq Seq;
+  RISCVMatInt::generateInstSeq(Imm, /*IsRV64=*/false, Seq);
+
+  Register SrcReg = RISCV::X0;
+  for (unsigned Idx = 0, E = Seq.size(); Idx != E; ++Idx) {
+    Register TmpReg = Idx + 1 == E
+                          ? DstReg
+                          : MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    MachineInstrBuilder MIB;
+    if (Seq[Idx].Opc == RISCV::LUI)
+      MIB = B.buildInstr(RISCV::LUI, {TmpReg}, {}).addImm(Seq[Idx].Imm);
+    else
+      MIB = B.buildInstr(Seq[Idx].Opc, {TmpReg}, {SrcReg})
+                .addImm(Seq[Idx].Imm);
+    if (!constrainSelectedInstRegOperands(*MIB, TII, TRI, RBI))
+      return false;
+    SrcReg = TmpReg;
+  }
+  return true;
+}
+
+bool RISCVInstructionSelector::selectFConstant(MachineInstr &I,
+                                               MachineRegisterInfo &MRI) const {
+  Register DstReg = I.getOperand(0).getReg();
+  APInt Bits = I.getOperand(1).getFPImm()->getValueAPF().bitcastToAPInt();
+  MachineIRBuilder B(I);
+
+  // Materialize the bit pattern in GPRs and move it to the FPR.
+  auto materializeWord = [&](uint64_t Word) -> Register {
+    if (Word == 0)
+      return RISCV::X0;
+    Register Reg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    if (!materializeImm(Reg, SignExtend64<32>(Word), B))
+      return Register();
+    return Reg;
+  };
+
+  if (Bits.getBitWidth() == 32) {
+    Register Word = materializeWord(Bits.getZExtValue());
+    if (!Word)
+      return false;
+    auto Move = B.buildInstr(RISCV::FMV_W_X, {DstReg}, {Word});
+    if (!constrainSelectedInstRegOperands(*Move, TII, TRI, RBI))
+      return false;
+    I.eraseFromParent();
+    return true;
+  }
+
+  uint64_t Val = Bits.getZExtValue();
+  Register Lo = materializeWord(Val & 0xffffffff);
+  Register Hi = materializeWord(Val >> 32);
+  if (!Lo || !Hi)
+    return false;
+  auto Pair = B.buildInstr(RISCV::BuildPairF64Pseudo, {DstReg}, {Lo, Hi});
+  if (!constrainSelectedInstRegOperands(*Pair, TII, TRI, RBI))
+    return false;
+  I.eraseFromParent();
+  return selectF64Pseudo(*Pair, MRI);
+}
+
+bool RISCVInstructionSelector::selectGlobalValue(
+    MachineInstr &I, MachineRegisterInfo &MRI) const {
+  const GlobalValue *GV = I.getOperand(1).getGlobal();
+  int64_t Offset = I.getOperand(1).getOffset();
+  Register DstReg = I.getOperand(0).getReg();
+  if (GV->isThreadLocal())
+    return false;
+
+  MachineIRBuilder B(I);
+  MachineInstrBuilder MIB;
+  if (TM.isPositionIndependent()) {
+    // Same as RISCVTargetLowering::getAddr: PC-relative for local symbols,
+    // through the GOT otherwise.
+    if (TM.shouldAssumeDSOLocal(*GV->getParent(), GV)) {
+      MIB = B.buildInstr(RISCV::PseudoLLA, {DstReg}, {})
+                .addGlobalAddress(GV, Offset);
+    } else {
+      if (Offset != 0)
+        return false;
+      MIB = B.buildInstr(RISCV::PseudoLA, {DstReg}, {}).addGlobalAddress(GV);
+    }
+  } else if (TM.getCodeModel() == CodeModel::Small) {
+    Register HiReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    auto Hi = B.buildInstr(RISCV::LUI, {HiReg}, {})
+                  .addGlobalAddress(GV, Offset, RISCVII::MO_HI);
+    if (!constrainSelectedInstRegOperands(*Hi, TII, TRI, RBI))
+      return false;
+    MIB = B.buildInstr(RISCV::ADDI, {DstReg}, {HiReg})
+              .addGlobalAddress(GV, Offset, RISCVII::MO_LO);
+  } else if (TM.getCodeModel() == CodeModel::Medium) {
+    MIB = B.buildInstr(RISCV::PseudoLLA, {DstReg}, {})
+              .addGlobalAddress(GV, Offset);
+  } else {
+    return false;
+  }
+
+  if (!constrainSelectedInstRegOperands(*MIB, TII, TRI, RBI))
+    return false;
+  I.eraseFromParent();
+  return true;
+}
+
+void RISCVInstructionSelector::selectAddrRegImm(Register Addr,
+                                                MachineRegisterInfo &MRI,
+                                                MachineOperand &Base,
+                                                int64_t &Offset) const {
+  Base = MachineOperand::CreateReg(Addr, false);
+  Offset = 0;
+
+  MachineInstr *Def = MRI.getVRegDef(Addr);
+  if (Def && Def->getOpcode() == TargetOpcode::G_PTR_ADD) {
+    Optional<int64_t> Imm =
+        getConstantVRegSExtVal(Def->getOperand(2).getReg(), MRI);
+    if (Imm && isInt<12>(*Imm)) {
+      Offset = *Imm;
+      Addr = Def->getOperand(1).getReg();
+      Base = MachineOperand::CreateReg(Addr, false);
+      Def = MRI.getVRegDef(Addr);
+    }
+  }
+
+  if (Def && Def->getOpcode() == TargetOpcode::G_FRAME_INDEX)
+    Base = MachineOperand::CreateFI(Def->getOperand(1).getIndex());
+}
+
+bool RISCVInstructionSelector::selectLoadStore(MachineInstr &I,
+                                               MachineRegisterInfo &MRI) const {
+  assert(I.hasOneMemOperand() && "Expected a single memory operand");
+  const MachineMemOperand &MMO = **I.memoperands_begin();
+  // Atomic accesses are left to SelectionDAG, which inserts the fences.
+  if (MMO.isAtomic())
+    return false;
+
+  Register ValReg = I.getOperand(0).getReg();
+  unsigned MemSize = MMO.getSizeInBits();
+  bool IsGPR = isRegInGPRB(ValReg, MRI);
+  unsigned Opc;
+  switch (I.getOpcode()) {
+  case TargetOpcode::G_LOAD:
+    if (!IsGPR)
+      Opc = MemSize == 32 ? RISCV::FLW : RISCV::FLD;
+    else
+      Opc = MemSize == 8 ? RISCV::LBU : MemSize == 16 ? RISCV::LHU : RISCV::LW;
+    break;
+  case TargetOpcode::G_SEXTLOAD:
+    Opc = MemSize == 8 ? RISCV::LB : RISCV::LH;
+    break;
+  case TargetOpcode::G_ZEXTLOAD:
+    Opc = MemSize == 8 ? RISCV::LBU : RISCV::LHU;
+    break;
+  case TargetOpcode::G_STORE:
+    if (!IsGPR)
+      Opc = MemSize == 32 ? RISCV::FSW : RISCV::FSD;
+    else
+      Opc = MemSize == 8 ? RISCV::SB : MemSize == 16 ? RISCV::SH : RISCV::SW;
+    break;
+  default:
+    llvm_unreachable("Unexpected memory access");
+  }
+  if ((Opc == RISCV::FLD || Opc == RISCV::FSD) && !STI.hasStdExtD())
+    return false;
+
+  MachineOperand Base = MachineOperand::CreateImm(0);
+  int64_t Offset;
+  selectAddrRegImm(I.getOperand(1).getReg(), MRI, Base, Offset);
+
+  MachineInstr *MI = BuildMI(*I.getParent(), I, I.getDebugLoc(), TII.get(Opc))
+                         .add(I.getOperand(0))
+                         .add(Base)
+                         .addImm(Offset)
+                         .addMemOperand(*I.memoperands_begin());
+  if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+    return false;
+  I.eraseFromParent();
+  return true;
+}
+
+bool RISCVInstructionSelector::selectICmp(MachineInstr &I,
+                                          MachineRegisterInfo &MRI) const {
+  Register DstReg = I.getOperand(0).getReg();
+  auto Pred = static_cast<CmpInst::Predicate>(I.getOperand(1).getPredicate());
+  Register LHS = I.getOperand(2).getReg();
+  Register RHS = I.getOperand(3).getReg();
+  MachineIRBuilder B(I);
+  SmallVector<MachineInstr *, 2> MIs;
+
+  Register CmpReg = DstReg;
+  bool Invert = false;
+  switch (Pred) {
+  case CmpInst::ICMP_EQ:
+  case CmpInst::ICMP_NE: {
+    Register XorReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    MIs.push_back(B.buildInstr(RISCV::XOR, {XorReg}, {LHS, RHS}));
+    if (Pred == CmpInst::ICMP_EQ)
+      MIs.push_back(
+          B.buildInstr(RISCV::SLTIU, {DstReg}, {XorReg}).addImm(1));
+    else
+      MIs.push_back(B.buildInstr(RISCV::SLTU, {DstReg},
+                                 {Register(RISCV::X0), XorReg}));
+    break;
+  }
+  default: {
+    unsigned Opc = CmpInst::isSigned(Pred) ? RISCV::SLT : RISCV::SLTU;
+    // a > b is b < a, and a >= b is !(a < b).
+    bool Swap = Pred == CmpInst::ICMP_SGT || Pred == CmpInst::ICMP_UGT ||
+                Pred == CmpInst::ICMP_SLE || Pred == CmpInst::ICMP_ULE;
+    Invert = Pred == CmpInst::ICMP_SGE || Pred == CmpInst::ICMP_UGE ||
+             Pred == CmpInst::ICMP_SLE || Pred == CmpInst::ICMP_ULE;
+    if (Invert)
+      CmpReg = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    if (Swap)
+      std::swap(LHS, RHS);
+    MIs.push_back(B.buildInstr(Opc, {CmpReg}, {LHS, RHS}));
+    if (Invert)
+      MIs.push_back(B.buildInstr(RISCV::XORI, {DstReg}, {CmpReg}).addImm(1));
+    break;
+  }
+  }
+
+  for (MachineInstr *MI : MIs)
+    if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+      return false;
+  I.eraseFromParent();
+  return true;
+}
+
+bool RISCVInstructionSelector::selectFCmp(MachineInstr &I,
+                                          MachineRegisterInfo &MRI) const {
+  Register DstReg = I.getOperand(0).getReg();
+  auto Pred = static_cast<CmpInst::Predicate>(I.getOperand(1).getPredicate());
+  Register LHS = I.getOperand(2).getReg();
+  Register RHS = I.getOperand(3).getReg();
+  bool IsDouble = MRI.getType(LHS).getSizeInBits() == 64;
+  unsigned FEQ = IsDouble ? RISCV::FEQ_D : RISCV::FEQ_S;
+  unsigned FLT = IsDouble ? RISCV::FLT_D : RISCV::FLT_S;
+  unsigned FLE = IsDouble ? RISCV::FLE_D : RISCV::FLE_S;
+  MachineIRBuilder B(I);
+  SmallVector<MachineInstr *, 4> MIs;
+
+  if (Pred == CmpInst::FCMP_TRUE || Pred == CmpInst::FCMP_FALSE) {
+    if (!materializeImm(DstReg, Pred == CmpInst::FCMP_TRUE, B))
+      return false;
+    I.eraseFromParent();
+    return true;
+  }
+
+  // The unordered predicates are the inverse of the ordered ones.
+  bool Invert = CmpInst::isUnordered(Pred);
+  if (Invert)
+    Pred = CmpInst::getInversePredicate(Pred);
+  Register CmpReg =
+      Invert ? MRI.createVirtualRegister(&RISCV::GPRRegClass) : DstReg;
+
+  auto buildPair = [&](unsigned Opc, Register A, Register C, unsigned Combine,
+                       unsigned OpcC, Register D, Register E) {
+    Register Tmp0 = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    Register Tmp1 = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+    MIs.push_back(B.buildInstr(Opc, {Tmp0}, {A, C}));
+    MIs.push_back(B.buildInstr(OpcC, {Tmp1}, {D, E}));
+    MIs.push_back(B.buildInstr(Combine, {CmpReg}, {Tmp0, Tmp1}));
+  };
+
+  switch (Pred) {
+  case CmpInst::FCMP_OEQ:
+    MIs.push_back(B.buildInstr(FEQ, {CmpReg}, {LHS, RHS}));
+    break;
+  case CmpInst::FCMP_OLT:
+    MIs.push_back(B.buildInstr(FLT, {CmpReg}, {LHS, RHS}));
+    break;
+  case CmpInst::FCMP_OLE:
+    MIs.push_back(B.buildInstr(FLE, {CmpReg}, {LHS, RHS}));
+    break;
+  case CmpInst::FCMP_OGT:
+    MIs.push_back(B.buildInstr(FLT, {CmpReg}, {RHS, LHS}));
+    break;
+  case CmpInst::FCMP_OGE:
+    MIs.push_back(B.buildInstr(FLE, {CmpReg}, {RHS, LHS}));
+    break;
+  case CmpInst::FCMP_ONE:
+    buildPair(FLT, LHS, RHS, RISCV::OR, FLT, RHS, LHS);
+    break;
+  case CmpInst::FCMP_ORD:
+    buildPair(FEQ, LHS, LHS, RISCV::AND, FEQ, RHS, RHS);
+    break;
+  default:
+    return false;
+  }
+  if (Invert)
+    MIs.push_back(B.buildInstr(RISCV::XORI, {DstReg}, {CmpReg}).addImm(1));
+
+  for (MachineInstr *MI : MIs)
+    if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+      return false;
+  I.eraseFromParent();
+  return true;
+}
+
+bool RISCVInstructionSelector::selectBrCond(MachineInstr &I,
+                                            MachineRegisterInfo &MRI) const {
+  Register CondReg = I.getOperand(0).getReg();
+  MachineBasicBlock *DestMBB = I.getOperand(1).getMBB();
+  MachineIRBuilder B(I);
+
+  unsigned Opc = RISCV::BNE;
+  Register LHS = CondReg;
+  Register RHS = RISCV::X0;
+
+  // Branch on the integer comparison directly if this is its only use. The
+  // comparison is then dead and removed by InstructionSelect.
+  MachineInstr *Def = MRI.getVRegDef(CondReg);
+  if (Def && Def->getOpcode() == TargetOpcode::G_ICMP &&
+      Def->getParent() == I.getParent() && MRI.hasOneNonDBGUse(CondReg)) {
+    auto Pred =
+        static_cast<CmpInst::Predicate>(Def->getOperand(1).getPredicate());
+    LHS = Def->getOperand(2).getReg();
+    RHS = Def->getOperand(3).getReg();
+    switch (Pred) {
+    default:
+      llvm_unreachable("Unexpected integer predicate");
+    case CmpInst::ICMP_EQ:
+      Opc = RISCV::BEQ;
+      break;
+    case CmpInst::ICMP_NE:
+      Opc = RISCV::BNE;
+      break;
+    case CmpInst::ICMP_SLT:
+      Opc = RISCV::BLT;
+      break;
+    case CmpInst::ICMP_SGE:
+      Opc = RISCV::BGE;
+      break;
+    case CmpInst::ICMP_ULT:
+      Opc = RISCV::BLTU;
+      break;
+    case CmpInst::ICMP_UGE:
+      Opc = RISCV::BGEU;
+      break;
+    case CmpInst::ICMP_SGT:
+      Opc = RISCV::BLT;
+      std::swap(LHS, RHS);
+      break;
+    case CmpInst::ICMP_SLE:
+      Opc = RISCV::BGE;
+      std::swap(LHS, RHS);
+      break;
+    case CmpInst::ICMP_UGT:
+      Opc = RISCV::BLTU;
+      std::swap(LHS, RHS);
+      break;
+    case CmpInst::ICMP_ULE:
+      Opc = RISCV::BGEU;
+      std::swap(LHS, RHS);
+      break;
+    }
+  }
+
+  auto Br = B.buildInstr(Opc, {}, {LHS, RHS}).addMBB(DestMBB);
+  if (!constrainSelectedInstRegOperands(*Br, TII, TRI, RBI))
+    return false;
+  I.eraseFromParent();
+  return true;
+}
+
+bool RISCVInstructionSelector::selectSelect(MachineInstr &I,
+                                            MachineRegisterInfo &MRI) const {
+  // The Select_*_Using_CC_GPR pseudos split the block in their custom
+  // inserter, which GlobalISel does not run. Select without a branch instead:
+  //   dst = f ^ ((t ^ f) & -cond)
+  Register DstReg = I.getOperand(0).getReg();
+  Register CondReg = I.getOperand(1).getReg();
+  Register TReg = I.getOperand(2).getReg();
+  Register FReg = I.getOperand(3).getReg();
+  MachineIRBuilder B(I);
+
+  Register Mask = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  Register Diff = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  Register Masked = MRI.createVirtualRegister(&RISCV::GPRRegClass);
+  MachineInstr *MIs[] = {
+      B.buildInstr(RISCV::SUB, {Mask}, {Register(RISCV::X0), CondReg}),
+      B.buildInstr(RISCV::XOR, {Diff}, {TReg, FReg}),
+      B.buildInstr(RISCV::AND, {Masked}, {Diff, Mask}),
+      B.buildInstr(RISCV::XOR, {DstReg}, {Masked, FReg})};
+  for (MachineInstr *MI : MIs)
+    if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+      return false;
+  I.eraseFromParent();
+  return true;
+}
+
+bool RISCVInstructionSelector::selectF64Pseudo(MachineInstr &I,
+                                               MachineRegisterInfo &MRI) const {
+  // The custom inserters of BuildPairF64Pseudo and SplitF64Pseudo go through
+  // the stack slot for f64 moves and do not change the CFG, so they can be
+  // expanded right away.
+  STI.getTargetLowering()->EmitInstrWithCustomInserter(I, I.getParent());
+  return true;
+}
+
 bool RISCVInstructionSelector::select(MachineInstr &I) {
+  MachineBasicBlock &MBB = *I.getParent();
+  MachineFunction &MF = *MBB.getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
 
   if (!isPreISelGenericOpcode(I.getOpcode())) {
-    // Certain non-generic instructions also need some special handling.
+    if (I.isCopy())
+      return selectCopy(I, MRI);
+
     return true;
   }
 
+  using namespace TargetOpcode;
+
+  // Memory accesses fold their address computation, which the imported
+  // patterns do not.
+  switch (I.getOpcode()) {
+  case G_LOAD:
+  case G_SEXTLOAD:
+  case G_ZEXTLOAD:
+  case G_STORE:
+    return selectLoadStore(I, MRI);
+  case G_BRCOND:
+    return selectBrCond(I, MRI);
+  default:
+    break;
+  }
+
   if (selectImpl(I, *CoverageInfo))
     return true;
 
-  return false;
+  MachineInstr *MI = nullptr;
+
+  switch (I.getOpcode()) {
+  case G_CONSTANT: {
+    MachineIRBuilder B(I);
+    if (!materializeImm(I.getOperand(0).getReg(),
+                        I.getOperand(1).getCImm()->getSExtValue(), B))
+      return false;
+    break;
+  }
+  case G_FCONSTANT:
+    return selectFConstant(I, MRI);
+  case G_GLOBAL_VALUE:
+    return selectGlobalValue(I, MRI);
+  case G_FRAME_INDEX: {
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::ADDI))
+             .add(I.getOperand(0))
+             .add(I.getOperand(1))
+             .addImm(0);
+    break;
+  }
+  case G_PTR_ADD: {
+    Optional<int64_t> Imm =
+        getConstantVRegSExtVal(I.getOperand(2).getReg(), MRI);
+    if (Imm && isInt<12>(*Imm))
+      MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::ADDI))
+               .add(I.getOperand(0))
+               .add(I.getOperand(1))
+               .addImm(*Imm);
+    else
+      MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::ADD))
+               .add(I.getOperand(0))
+               .add(I.getOperand(1))
+               .add(I.getOperand(2));
+    break;
+  }
+  case G_SHL:
+  case G_LSHR:
+  case G_ASHR: {
+    unsigned Opc = I.getOpcode() == G_SHL
+                       ? RISCV::SLL
+                       : I.getOpcode() == G_LSHR ? RISCV::SRL : RISCV::SRA;
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(Opc))
+             .add(I.getOperand(0))
+             .add(I.getOperand(1))
+             .add(I.getOperand(2));
+    break;
+  }
+  case G_ICMP:
+    return selectICmp(I, MRI);
+  case G_FCMP:
+    return selectFCmp(I, MRI);
+  case G_SELECT:
+    return selectSelect(I, MRI);
+  case G_BR:
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::PseudoBR))
+             .add(I.getOperand(0));
+    break;
+  case G_BRINDIRECT:
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::PseudoBRIND))
+             .add(I.getOperand(0))
+             .addImm(0);
+    break;
+  case G_MERGE_VALUES: {
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::BuildPairF64Pseudo))
+             .add(I.getOperand(0))
+             .add(I.getOperand(1))
+             .add(I.getOperand(2));
+    if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+      return false;
+    I.eraseFromParent();
+    return selectF64Pseudo(*MI, MRI);
+  }
+  case G_UNMERGE_VALUES: {
+    MI = BuildMI(MBB, I, I.getDebugLoc(), TII.get(RISCV::SplitF64Pseudo))
+             .add(I.getOperand(0))
+             .add(I.getOperand(1))
+             .add(I.getOperand(2));
+    if (!constrainSelectedInstRegOperands(*MI, TII, TRI, RBI))
+      return false;
+    I.eraseFromParent();
+    return selectF64Pseudo(*MI, MRI);
+  }
+  case G_PTRTOINT:
+  case G_INTTOPTR:
+    I.setDesc(TII.get(COPY));
+    return selectCopy(I, MRI);
+  case G_IMPLICIT_DEF:
+    I.setDesc(TII.get(IMPLICIT_DEF));
+    return constrainDef(I, MRI);
+  case G_PHI:
+    I.setDesc(TII.get(PHI));
+    return constrainDef(I, MRI);
+  default:
+    return false;
+  }
+
+  I.eraseFromParent();
+  return MI ? constrainSelectedInstRegOperands(*MI, TII, TRI, RBI) : true;
 }
 
 namespace llvm {
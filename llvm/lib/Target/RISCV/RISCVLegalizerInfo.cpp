@@ -11,6 +11,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "RISCVLegalizerInfo.h"
+#include "RISCVSubtarget.h"
+#include "llvm/CodeGen/GlobalISel/LegalizerHelper.h"
 #include "llvm/CodeGen/TargetOpcodes.h"
 #include "llvm/CodeGen/ValueTypes.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -18,6 +20,296 @@
 
 using namespace llvm;
 
+struct TypesAndMemOps {
+  LLT ValTy;
+  LLT PtrTy;
+  unsigned MemSize;
+};
+
+static bool
+CheckTy0Ty1MemSizeAlign(const LegalityQuery &Query,
+                        std::initializer_list<TypesAndMemOps> SupportedValues,
+                        bool SupportsUnalignedAccess) {
+  unsigned QueryMemSize = Query.MMODescrs[0].SizeInBits;
+
+  for (auto &Val : SupportedValues) {
+    if (Val.ValTy != Query.Types[0] || Val.PtrTy != Query.Types[1] ||
+        Val.MemSize != QueryMemSize)
+      continue;
+    return SupportsUnalignedAccess ||
+           Query.MMODescrs[0].AlignInBits >= QueryMemSize;
+  }
+  return false;
+}
+
+static bool CheckTyN(unsigned N, const LegalityQuery &Query,
+                     std::initializer_list<LLT> SupportedValues) {
+  for (auto &Val : SupportedValues)
+    if (Val == Query.Types[N])
+      return true;
+  return false;
+}
+
 RISCVLegalizerInfo::RISCVLegalizerInfo(const RISCVSubtarget &ST) {
+  using namespace TargetOpcode;
+
+  // GlobalISel is only used for RV32, see RISCVCallLowering.
+  const LLT s1 = LLT::scalar(1);
+  const LLT s32 = LLT::scalar(32);
+  const LLT s64 = LLT::scalar(64);
+  const LLT v2s16 = LLT::vector(2, 16);
+  const LLT v4s8 = LLT::vector(4, 8);
+  const LLT p0 = LLT::pointer(0, 32);
+
+  const bool HasPULP = ST.hasPULPExtV2();
+  const bool HasF = ST.hasStdExtF();
+  const bool HasD = ST.hasStdExtD();
+
+  auto isLegalFP = [=](unsigned N) {
+    return [=](const LegalityQuery &Query) {
+      return (HasF && Query.Types[N] == s32) || (HasD && Query.Types[N] == s64);
+    };
+  };
+
+  // The Xpulpv2 SIMD instructions operate on packed halfwords and bytes held
+  // in GPRs.
+  auto isPULPVector = [=](unsigned N) {
+    return [=](const LegalityQuery &Query) {
+      return HasPULP && CheckTyN(N, Query, {v2s16, v4s8});
+    };
+  };
+
+  getActionDefinitionsBuilder({G_ADD, G_SUB, G_AND, G_OR, G_XOR})
+      .legalFor({s32})
+      .legalIf(isPULPVector(0))
+      .clampScalar(0, s32, s32);
+
+  getActionDefinitionsBuilder({G_UADDO, G_UADDE, G_USUBO, G_USUBE, G_UMULO})
+      .lowerFor({{s32, s1}});
+
+  if (ST.hasStdExtM()) {
+    getActionDefinitionsBuilder(G_MUL)
+        .legalFor({s32})
+        .clampScalar(0, s32, s32);
+
+    getActionDefinitionsBuilder({G_UMULH, G_SMULH})
+        .legalFor({s32})
+        .maxScalar(0, s32);
+
+    getActionDefinitionsBuilder({G_SDIV, G_SREM, G_UDIV, G_UREM})
+        .legalFor({s32})
+        .libcallFor({s64})
+        .clampScalar(0, s32, s64);
+  } else {
+    // There is no generic libcall for G_MUL, which leaves multiplications
+    // without the M extension to SelectionDAG.
+    getActionDefinitionsBuilder({G_SDIV, G_SREM, G_UDIV, G_UREM})
+        .libcallFor({s32, s64})
+        .clampScalar(0, s32, s64);
+  }
+
+  getActionDefinitionsBuilder({G_SHL, G_ASHR, G_LSHR})
+      .legalFor({{s32, s32}})
+      .legalIf([=](const LegalityQuery &Query) {
+        return isPULPVector(0)(Query) && Query.Types[0] == Query.Types[1];
+      })
+      .clampScalar(1, s32, s32)
+      .clampScalar(0, s32, s32);
+
+  getActionDefinitionsBuilder({G_SMIN, G_SMAX, G_UMIN, G_UMAX})
+      .legalIf([=](const LegalityQuery &Query) {
+        return (HasPULP && Query.Types[0] == s32) || isPULPVector(0)(Query);
+      })
+      .minScalar(0, s32)
+      .lower();
+
+  getActionDefinitionsBuilder(G_ABS)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasPULP && Query.Types[0] == s32;
+      })
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder({G_CTPOP, G_CTTZ})
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasPULP && Query.Types[0] == s32 && Query.Types[1] == s32;
+      })
+      .clampScalar(0, s32, s32)
+      .clampScalar(1, s32, s32)
+      .lower();
+
+  getActionDefinitionsBuilder(G_CTLZ_ZERO_UNDEF)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasPULP && Query.Types[0] == s32 && Query.Types[1] == s32;
+      })
+      .clampScalar(0, s32, s32)
+      .clampScalar(1, s32, s32)
+      .lower();
+
+  getActionDefinitionsBuilder({G_CTLZ, G_CTTZ_ZERO_UNDEF})
+      .clampScalar(0, s32, s32)
+      .clampScalar(1, s32, s32)
+      .lower();
+
+  getActionDefinitionsBuilder({G_BSWAP, G_BITREVERSE})
+      .lowerFor({s32})
+      .maxScalar(0, s32);
+
+  getActionDefinitionsBuilder({G_LOAD, G_STORE})
+      .legalIf([=](const LegalityQuery &Query) {
+        if (CheckTy0Ty1MemSizeAlign(Query,
+                                    {{s32, p0, 8},
+                                     {s32, p0, 16},
+                                     {s32, p0, 32},
+                                     {p0, p0, 32}},
+                                    HasPULP))
+          return true;
+        if (HasPULP && CheckTy0Ty1MemSizeAlign(
+                           Query, {{v2s16, p0, 32}, {v4s8, p0, 32}}, HasPULP))
+          return true;
+        if (HasD && CheckTy0Ty1MemSizeAlign(Query, {{s64, p0, 64}}, false))
+          return true;
+        return false;
+      })
+      .minScalar(0, s32)
+      .maxScalar(0, s32);
+
+  getActionDefinitionsBuilder({G_ZEXTLOAD, G_SEXTLOAD})
+      .legalIf([=](const LegalityQuery &Query) {
+        return CheckTy0Ty1MemSizeAlign(Query, {{s32, p0, 8}, {s32, p0, 16}},
+                                       HasPULP);
+      })
+      .clampScalar(0, s32, s32);
+
+  getActionDefinitionsBuilder(G_IMPLICIT_DEF)
+      .legalFor({s32, p0})
+      .legalIf(isPULPVector(0))
+      .legalIf(isLegalFP(0))
+      .clampScalar(0, s32, s32);
+
+  getActionDefinitionsBuilder(G_UNMERGE_VALUES)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasD && Query.Types[0] == s32 && Query.Types[1] == s64;
+      });
+
+  getActionDefinitionsBuilder(G_MERGE_VALUES)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasD && Query.Types[0] == s64 && Query.Types[1] == s32;
+      });
+
+  getActionDefinitionsBuilder({G_ZEXT, G_SEXT, G_ANYEXT})
+      .legalIf([](const LegalityQuery &Query) { return false; })
+      .maxScalar(0, s32);
+
+  getActionDefinitionsBuilder(G_TRUNC)
+      .legalIf([](const LegalityQuery &Query) { return false; })
+      .maxScalar(1, s32);
+
+  getActionDefinitionsBuilder(G_SEXT_INREG)
+      .lower();
+
+  // Selects are done branchless in GPRs; 64-bit selects are split in halves.
+  getActionDefinitionsBuilder(G_SELECT)
+      .legalForCartesianProduct({p0, s32}, {s32})
+      .legalIf([=](const LegalityQuery &Query) {
+        return isPULPVector(0)(Query) && Query.Types[1] == s32;
+      })
+      .clampScalar(0, s32, s32)
+      .minScalar(1, s32);
+
+  getActionDefinitionsBuilder(G_BRCOND)
+      .legalFor({s32})
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder(G_BRINDIRECT)
+      .legalFor({p0});
+
+  getActionDefinitionsBuilder(G_PHI)
+      .legalFor({p0, s32})
+      .legalIf(isPULPVector(0))
+      .legalIf(isLegalFP(0))
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder(G_ICMP)
+      .legalForCartesianProduct({s32}, {s32, p0})
+      .clampScalar(1, s32, s32)
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder(G_CONSTANT)
+      .legalFor({s32, p0})
+      .clampScalar(0, s32, s32);
+
+  getActionDefinitionsBuilder({G_PTR_ADD, G_INTTOPTR})
+      .legalFor({{p0, s32}});
+
+  getActionDefinitionsBuilder(G_PTRTOINT)
+      .legalFor({{s32, p0}});
+
+  getActionDefinitionsBuilder({G_FRAME_INDEX, G_GLOBAL_VALUE})
+      .legalFor({p0});
+
+  getActionDefinitionsBuilder(G_DYN_STACKALLOC)
+      .lowerFor({{p0, s32}});
+
+  getActionDefinitionsBuilder({G_MEMCPY, G_MEMMOVE, G_MEMSET})
+      .libcall();
+
+  // FP instructions
+  getActionDefinitionsBuilder({G_FADD, G_FSUB, G_FMUL, G_FDIV, G_FSQRT})
+      .legalIf(isLegalFP(0))
+      .libcallFor({s32, s64});
+
+  getActionDefinitionsBuilder({G_FMA, G_FMINNUM, G_FMAXNUM})
+      .legalIf(isLegalFP(0))
+      .libcallFor({s32, s64});
+
+  getActionDefinitionsBuilder({G_FNEG, G_FABS})
+      .legalIf(isLegalFP(0));
+
+  getActionDefinitionsBuilder(G_FCOPYSIGN)
+      .legalIf([=](const LegalityQuery &Query) {
+        return isLegalFP(0)(Query) && isLegalFP(1)(Query);
+      });
+
+  getActionDefinitionsBuilder({G_FREM, G_FPOW, G_FEXP, G_FEXP2, G_FLOG,
+                               G_FLOG2, G_FLOG10, G_FSIN, G_FCOS, G_FCEIL,
+                               G_FFLOOR, G_FRINT, G_FNEARBYINT})
+      .libcallFor({s32, s64});
+
+  getActionDefinitionsBuilder(G_FCONSTANT)
+      .legalIf(isLegalFP(0));
+
+  getActionDefinitionsBuilder(G_FCMP)
+      .legalIf([=](const LegalityQuery &Query) {
+        return Query.Types[0] == s32 && isLegalFP(1)(Query);
+      })
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder(G_FPEXT)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasD && Query.Types[0] == s64 && Query.Types[1] == s32;
+      })
+      .libcallFor({{s64, s32}});
+
+  getActionDefinitionsBuilder(G_FPTRUNC)
+      .legalIf([=](const LegalityQuery &Query) {
+        return HasD && Query.Types[0] == s32 && Query.Types[1] == s64;
+      })
+      .libcallFor({{s32, s64}});
+
+  getActionDefinitionsBuilder({G_FPTOSI, G_FPTOUI})
+      .legalIf([=](const LegalityQuery &Query) {
+        return Query.Types[0] == s32 && isLegalFP(1)(Query);
+      })
+      .libcallForCartesianProduct({s32, s64}, {s32, s64})
+      .minScalar(0, s32);
+
+  getActionDefinitionsBuilder({G_SITOFP, G_UITOFP})
+      .legalIf([=](const LegalityQuery &Query) {
+        return isLegalFP(0)(Query) && Query.Types[1] == s32;
+      })
+      .libcallForCartesianProduct({s32, s64}, {s32, s64})
+      .minScalar(1, s32);
+
   computeTables();
+  verify(*ST.getInstrInfo());
 }
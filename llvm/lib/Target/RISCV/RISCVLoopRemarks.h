@@ -0,0 +1,101 @@
+//===-- RISCVLoopRemarks.h - Reasons for missed PULP/Snitch loops -*- C++ -*-=//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the reasons for which the PULP hardware loop, the Snitch
+// frep and the Snitch SSR inference passes decline a loop. Each reason is
+// reported as a missed optimization remark whose remark name is the reason
+// code, so that the codes are the same across the passes and stay stable in
+// serialized remarks (-pass-remarks-output, -pass-remarks-format=bitstream).
+// Together with -pass-remarks-with-hotness, tooling can rank the loops which
+// miss the fast path by how often they run.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_RISCV_RISCVLOOPREMARKS_H
+#define LLVM_LIB_TARGET_RISCV_RISCVLOOPREMARKS_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/ErrorHandling.h"
+
+namespace llvm {
+namespace RISCVLoopRemark {
+
+/// Do not rename, the remark names are matched by tools.
+enum Reason {
+  UnknownTripCount,
+  TripCountNotAvailable,
+  InvalidInstruction,
+  BodyTooLong,
+  NoPreheader,
+  MultipleExits,
+  UnanalyzableBranch,
+  ZeroTripCount,
+  NoFreeLevel,
+  NotFPOnly,
+  MayAlias,
+  MemoryDependence,
+  UnanalyzableAccess,
+};
+
+/// The remark name of \p R.
+inline StringRef getName(Reason R) {
+  switch (R) {
+  case UnknownTripCount:      return "UnknownTripCount";
+  case TripCountNotAvailable: return "TripCountNotAvailable";
+  case InvalidInstruction:    return "InvalidInstruction";
+  case BodyTooLong:           return "BodyTooLong";
+  case NoPreheader:           return "NoPreheader";
+  case MultipleExits:         return "MultipleExits";
+  case UnanalyzableBranch:    return "UnanalyzableBranch";
+  case ZeroTripCount:         return "ZeroTripCount";
+  case NoFreeLevel:           return "NoFreeLevel";
+  case NotFPOnly:             return "NotFPOnly";
+  case MayAlias:              return "MayAlias";
+  case MemoryDependence:      return "MemoryDependence";
+  case UnanalyzableAccess:    return "UnanalyzableAccess";
+  }
+  llvm_unreachable("Unknown loop remark reason");
+}
+
+/// The human readable message of \p R.
+inline StringRef getMessage(Reason R) {
+  switch (R) {
+  case UnknownTripCount:
+    return "the trip count could not be computed";
+  case TripCountNotAvailable:
+    return "the trip count is not available before the loop";
+  case InvalidInstruction:
+    return "the loop contains an instruction which cannot be repeated";
+  case BodyTooLong:
+    return "the loop body is too long";
+  case NoPreheader:
+    return "the loop has no preheader";
+  case MultipleExits:
+    return "the loop has multiple exits";
+  case UnanalyzableBranch:
+    return "the loop branch could not be analyzed";
+  case ZeroTripCount:
+    return "the loop may be skipped and could not be versioned";
+  case NoFreeLevel:
+    return "all hardware loop levels are used by nested loops";
+  case NotFPOnly:
+    return "the loop body contains integer instructions";
+  case MayAlias:
+    return "the streamed accesses may alias";
+  case MemoryDependence:
+    return "the loop carries memory dependences";
+  case UnanalyzableAccess:
+    return "the memory accesses could not be mapped to streams";
+  }
+  llvm_unreachable("Unknown loop remark reason");
+}
+
+} // end namespace RISCVLoopRemark
+} // end namespace llvm
+
+#endif // LLVM_LIB_TARGET_RISCV_RISCVLOOPREMARKS_H
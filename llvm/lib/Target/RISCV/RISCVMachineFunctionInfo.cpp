@@ -0,0 +1,45 @@
+//=- RISCVMachineFunctionInfo.cpp - RISCV machine function info ---*- C++ -*-=//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines RISCV-specific per-machine-function information.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RISCVMachineFunctionInfo.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+static cl::opt<bool> SaveRestoreInHotFunctions(
+    "riscv-save-restore-hot-functions", cl::Hidden,
+    cl::desc("Use the save/restore libcalls in hot functions as well"),
+    cl::init(false));
+
+// CodeGenPrepare places functions in the hot text section based on the
+// profile summary and block frequencies.
+bool RISCVMachineFunctionInfo::isHotFunction(const Function &F) {
+  if (F.hasFnAttribute(Attribute::Hot))
+    return true;
+  Optional<StringRef> Prefix = F.getSectionPrefix();
+  return Prefix && *Prefix == "hot";
+}
+
+bool RISCVMachineFunctionInfo::useSaveRestoreLibCalls(
+    const MachineFunction &MF) const {
+  // We cannot use fixed locations for the callee saved spill slots if the
+  // function uses a varargs save area.
+  if (!MF.getSubtarget<RISCVSubtarget>().enableSaveRestore() ||
+      VarArgsSaveSize != 0 || MF.getFrameInfo().hasTailCall())
+    return false;
+
+  // The libcalls trade an extra call and return in the prologue and epilogue
+  // for code size. Only pay for it outside of hot code, unless the function
+  // is optimized for minimum size.
+  const Function &F = MF.getFunction();
+  return SaveRestoreInHotFunctions || F.hasMinSize() || !isHotFunction(F);
+}
@@ -35,6 +35,10 @@ private:
   /// Keep track of used and enabled SSR streamers in this function. If
   /// any are used, its register is reserved. one-hot coded
   unsigned UsedSSR = 0;
+  /// True if the function contains SSR enable/disable regions whose data
+  /// registers are modelled as physical live ranges instead of reserving
+  /// them for the whole function.
+  bool HasSSRRegions = false;
 
 public:
   RISCVMachineFunctionInfo(const MachineFunction &MF) {}
@@ -58,12 +62,17 @@ public:
   unsigned getUsedSSR() const { return UsedSSR; }
   void setUsedSSR(unsigned SSR) { UsedSSR = SSR; }
 
-  bool useSaveRestoreLibCalls(const MachineFunction &MF) const {
-    // We cannot use fixed locations for the callee saved spill slots if the
-    // function uses a varargs save area.
-    return MF.getSubtarget<RISCVSubtarget>().enableSaveRestore() &&
-           VarArgsSaveSize == 0 && !MF.getFrameInfo().hasTailCall();
-  }
+  bool hasSSRRegions() const { return HasSSRRegions; }
+  void setHasSSRRegions(bool V) { HasSSRRegions = V; }
+
+  /// Returns true if the callee saved registers are spilled and restored by
+  /// the __riscv_save_N/__riscv_restore_N libcalls. Hot functions keep their
+  /// spills inline to avoid the extra call and return.
+  bool useSaveRestoreLibCalls(const MachineFunction &MF) const;
+
+  /// Returns true if \p F is marked hot or CodeGenPrepare placed it in the
+  /// hot text section based on the profile.
+  static bool isHotFunction(const Function &F);
 };
 
 } // end namespace llvm
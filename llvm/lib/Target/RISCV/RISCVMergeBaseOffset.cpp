@@ -21,11 +21,35 @@
 // 2) The lowered global address has only one use.
 //
 // The offset field can be in a different form. This pass handles all of them.
+//
+// Before that, the lowering sequences of the same global address in different
+// blocks are merged into one, since instruction selection rebuilds them in
+// every block and MachineCSE leaves cheap instructions alone across blocks:
+//   bb.1:                              bb.0:
+//     lui  vreg1, %hi(s)                  lui  vreg5, %hi(s)
+//     addi vreg2, vreg1, %lo(s)           addi vreg6, vreg5, %lo(s)
+//     lw   vreg3, 4(vreg2)        -->   bb.1:
+//   bb.2:                                 lw   vreg3, 4(vreg6)
+//     lui  vreg4, %hi(s)                bb.2:
+//     ...                                 ...
+// The shared sequence is placed in the nearest common dominator of the blocks,
+// hoisted out of loops, if it runs less often than the sequences it replaces.
+// Only the sequences of the same symbol can be shared: whether two globals
+// end up in the same 4 KiB page, with the same %hi, is only known after
+// linking. The number of shared bases per function is limited, since each of
+// them occupies a register across all of its uses.
 //===----------------------------------------------------------------------===//
 
 #include "RISCV.h"
 #include "RISCVTargetMachine.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineDominators.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetOptions.h"
@@ -34,6 +58,12 @@ using namespace llvm;
 
 #define DEBUG_TYPE "riscv-merge-base-offset"
 #define RISCV_MERGE_BASE_OFFSET_NAME "RISCV Merge Base Offset"
+
+static cl::opt<unsigned> MaxSharedBases(
+    "riscv-merge-base-max-shared", cl::init(4), cl::Hidden,
+    cl::desc("Maximum number of global addresses per function whose lowering "
+             "is shared between blocks"));
+
 namespace {
 
 struct RISCVMergeBaseOffsetOpt : public MachineFunctionPass {
@@ -46,8 +76,18 @@ struct RISCVMergeBaseOffsetOpt : public MachineFunctionPass {
   void foldOffset(MachineInstr &HiLUI, MachineInstr &LoADDI, MachineInstr &Tail,
                   int64_t Offset);
   bool matchLargeOffset(MachineInstr &TailAdd, Register GSReg, int64_t &Offset);
+  bool shareGlobalBases(MachineFunction &Fn);
+  void shareBase(MachineBasicBlock &Dom, ArrayRef<MachineInstr *> HiLUIs);
   RISCVMergeBaseOffsetOpt() : MachineFunctionPass(ID) {}
 
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<MachineDominatorTree>();
+    AU.addRequired<MachineLoopInfo>();
+    AU.addRequired<MachineBlockFrequencyInfo>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
   MachineFunctionProperties getRequiredProperties() const override {
     return MachineFunctionProperties().set(
         MachineFunctionProperties::Property::IsSSA);
@@ -59,13 +99,128 @@ struct RISCVMergeBaseOffsetOpt : public MachineFunctionPass {
 
 private:
   MachineRegisterInfo *MRI;
+  const TargetInstrInfo *TII;
+  MachineDominatorTree *MDT;
+  MachineLoopInfo *MLI;
+  MachineBlockFrequencyInfo *MBFI;
   std::set<MachineInstr *> DeadInstrs;
 };
 } // end anonymous namespace
 
 char RISCVMergeBaseOffsetOpt::ID = 0;
-INITIALIZE_PASS(RISCVMergeBaseOffsetOpt, DEBUG_TYPE,
-                RISCV_MERGE_BASE_OFFSET_NAME, false, false)
+INITIALIZE_PASS_BEGIN(RISCVMergeBaseOffsetOpt, DEBUG_TYPE,
+                      RISCV_MERGE_BASE_OFFSET_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
+INITIALIZE_PASS_END(RISCVMergeBaseOffsetOpt, DEBUG_TYPE,
+                    RISCV_MERGE_BASE_OFFSET_NAME, false, false)
+
+/// Return whether \p MO is the %hi or %lo part, as given by \p Flags, of the
+/// address \p Sym.
+static bool isGlobalPart(const MachineOperand &MO, const MachineOperand &Sym,
+                         unsigned Flags) {
+  return MO.isGlobal() && MO.getTargetFlags() == Flags &&
+         MO.getGlobal() == Sym.getGlobal() && MO.getOffset() == Sym.getOffset();
+}
+
+// Replace the %hi parts \p HiLUIs of the same global address in different
+// blocks, and the %lo parts adding to them, by one lowering sequence placed in
+// \p Dom.
+void RISCVMergeBaseOffsetOpt::shareBase(MachineBasicBlock &Dom,
+                                        ArrayRef<MachineInstr *> HiLUIs) {
+  // The LUIs are in block order, the first one in Dom precedes the uses in
+  // Dom.
+  MachineBasicBlock::iterator InsertPt = Dom.getFirstTerminator();
+  for (MachineInstr *HiLUI : HiLUIs)
+    if (HiLUI->getParent() == &Dom) {
+      InsertPt = HiLUI->getIterator();
+      break;
+    }
+
+  const MachineOperand &Sym = HiLUIs.front()->getOperand(1);
+  const GlobalValue *GV = Sym.getGlobal();
+  int64_t Offset = Sym.getOffset();
+  Register HiReg = MRI->createVirtualRegister(
+      MRI->getRegClass(HiLUIs.front()->getOperand(0).getReg()));
+  BuildMI(Dom, InsertPt, DebugLoc(), TII->get(RISCV::LUI), HiReg)
+      .addGlobalAddress(GV, Offset, RISCVII::MO_HI);
+  Register BaseReg = MRI->createVirtualRegister(&RISCV::GPRRegClass);
+  MachineInstr *LoADDI =
+      BuildMI(Dom, InsertPt, DebugLoc(), TII->get(RISCV::ADDI), BaseReg)
+          .addReg(HiReg)
+          .addGlobalAddress(GV, Offset, RISCVII::MO_LO);
+  LLVM_DEBUG(dbgs() << "  Sharing " << HiLUIs.size() << " bases of " << *GV
+                    << " from " << printMBBReference(Dom) << "\n");
+
+  for (MachineInstr *HiLUI : HiLUIs) {
+    Register Reg = HiLUI->getOperand(0).getReg();
+    MRI->constrainRegClass(HiReg, MRI->getRegClass(Reg));
+    MRI->replaceRegWith(Reg, HiReg);
+    HiLUI->eraseFromParent();
+  }
+
+  SmallVector<MachineInstr *, 8> OldADDIs;
+  for (MachineInstr &UseMI : MRI->use_nodbg_instructions(HiReg))
+    if (&UseMI != LoADDI && UseMI.getOpcode() == RISCV::ADDI &&
+        isGlobalPart(UseMI.getOperand(2), Sym, RISCVII::MO_LO))
+      OldADDIs.push_back(&UseMI);
+  for (MachineInstr *OldADDI : OldADDIs) {
+    Register Reg = OldADDI->getOperand(0).getReg();
+    MRI->constrainRegClass(BaseReg, MRI->getRegClass(Reg));
+    MRI->replaceRegWith(Reg, BaseReg);
+    OldADDI->eraseFromParent();
+  }
+}
+
+// Share the lowering of global addresses which is repeated in several blocks.
+bool RISCVMergeBaseOffsetOpt::shareGlobalBases(MachineFunction &Fn) {
+  using GlobalKey = std::pair<const GlobalValue *, int64_t>;
+  MapVector<GlobalKey, SmallVector<MachineInstr *, 4>> Groups;
+  for (MachineBasicBlock &MBB : Fn)
+    for (MachineInstr &MI : MBB)
+      if (MI.getOpcode() == RISCV::LUI && MI.getOperand(1).isGlobal() &&
+          MI.getOperand(1).getTargetFlags() == RISCVII::MO_HI)
+        Groups[{MI.getOperand(1).getGlobal(), MI.getOperand(1).getOffset()}]
+            .push_back(&MI);
+
+  struct Candidate {
+    MachineBasicBlock *Dom;
+    uint64_t Saving;
+    ArrayRef<MachineInstr *> HiLUIs;
+  };
+  SmallVector<Candidate, 8> Candidates;
+  for (auto &Group : Groups) {
+    ArrayRef<MachineInstr *> HiLUIs = Group.second;
+    if (HiLUIs.size() < 2)
+      continue;
+    MachineBasicBlock *Dom = HiLUIs.front()->getParent();
+    uint64_t Freq = 0;
+    for (MachineInstr *HiLUI : HiLUIs) {
+      Dom = MDT->findNearestCommonDominator(Dom, HiLUI->getParent());
+      Freq += MBFI->getBlockFreq(HiLUI->getParent()).getFrequency();
+    }
+    while (MachineLoop *L = MLI->getLoopFor(Dom)) {
+      MachineBasicBlock *Preheader = L->getLoopPreheader();
+      if (!Preheader)
+        break;
+      Dom = Preheader;
+    }
+    uint64_t DomFreq = MBFI->getBlockFreq(Dom).getFrequency();
+    if (DomFreq < Freq)
+      Candidates.push_back({Dom, Freq - DomFreq, HiLUIs});
+  }
+
+  // Keep the bases which save the most instructions.
+  llvm::stable_sort(Candidates, [](const Candidate &A, const Candidate &B) {
+    return A.Saving > B.Saving;
+  });
+  if (Candidates.size() > MaxSharedBases)
+    Candidates.resize(MaxSharedBases);
+  for (const Candidate &C : Candidates)
+    shareBase(*C.Dom, C.HiLUIs);
+  return !Candidates.empty();
+}
 
 // Detect the pattern:
 //   lui   vreg1, %hi(s)
@@ -263,6 +418,11 @@ bool RISCVMergeBaseOffsetOpt::runOnMachineFunction(MachineFunction &Fn) {
 
   DeadInstrs.clear();
   MRI = &Fn.getRegInfo();
+  TII = Fn.getSubtarget().getInstrInfo();
+  MDT = &getAnalysis<MachineDominatorTree>();
+  MLI = &getAnalysis<MachineLoopInfo>();
+  MBFI = &getAnalysis<MachineBlockFrequencyInfo>();
+  shareGlobalBases(Fn);
   for (MachineBasicBlock &MBB : Fn) {
     LLVM_DEBUG(dbgs() << "MBB: " << MBB.getName() << "\n");
     for (MachineInstr &HiLUI : MBB) {
@@ -20,7 +20,288 @@
 #define GET_TARGET_REGBANK_IMPL
 #include "RISCVGenRegisterBank.inc"
 
+namespace llvm {
+namespace RISCV {
+enum PartialMappingIdx {
+  PMI_GPR,
+  PMI_FPR32,
+  PMI_FPR64,
+  PMI_Min = PMI_GPR,
+};
+
+RegisterBankInfo::PartialMapping PartMappings[]{
+    {0, 32, GPRRegBank},
+    {0, 32, FPRRegBank},
+    {0, 64, FPRRegBank}
+};
+
+enum ValueMappingIdx {
+    InvalidIdx = 0,
+    GPRIdx = 1,
+    FPR32Idx = 4,
+    FPR64Idx = 7
+};
+
+RegisterBankInfo::ValueMapping ValueMappings[] = {
+    // invalid
+    {nullptr, 0},
+    // up to 3 operands in GPRs
+    {&PartMappings[PMI_GPR - PMI_Min], 1},
+    {&PartMappings[PMI_GPR - PMI_Min], 1},
+    {&PartMappings[PMI_GPR - PMI_Min], 1},
+    // up to 3 operands in FPRs - single precision
+    {&PartMappings[PMI_FPR32 - PMI_Min], 1},
+    {&PartMappings[PMI_FPR32 - PMI_Min], 1},
+    {&PartMappings[PMI_FPR32 - PMI_Min], 1},
+    // up to 3 operands in FPRs - double precision
+    {&PartMappings[PMI_FPR64 - PMI_Min], 1},
+    {&PartMappings[PMI_FPR64 - PMI_Min], 1},
+    {&PartMappings[PMI_FPR64 - PMI_Min], 1}
+};
+
+} // end namespace RISCV
+} // end namespace llvm
+
 using namespace llvm;
 
 RISCVRegisterBankInfo::RISCVRegisterBankInfo(const TargetRegisterInfo &TRI)
     : RISCVGenRegisterBankInfo() {}
+
+const RegisterBank &
+RISCVRegisterBankInfo::getRegBankFromRegClass(const TargetRegisterClass &RC,
+                                              LLT) const {
+  switch (RC.getID()) {
+  case RISCV::GPRRegClassID:
+  case RISCV::GPRX0RegClassID:
+  case RISCV::GPRNoX0RegClassID:
+  case RISCV::GPRNoX0X2RegClassID:
+  case RISCV::GPRCRegClassID:
+  case RISCV::GPRTCRegClassID:
+  case RISCV::GPRC_and_GPRTCRegClassID:
+  case RISCV::SPRegClassID:
+  case RISCV::PulpV2RegClassID:
+  case RISCV::PulpV4RegClassID:
+    return getRegBank(RISCV::GPRRegBankID);
+  case RISCV::FPR16RegClassID:
+  case RISCV::FPR16BFRegClassID:
+  case RISCV::FPR32RegClassID:
+  case RISCV::FPR32CRegClassID:
+  case RISCV::FPR64RegClassID:
+  case RISCV::FPR64CRegClassID:
+  case RISCV::FPR64V2RegClassID:
+  case RISCV::FPR64V4RegClassID:
+    return getRegBank(RISCV::FPRRegBankID);
+  default:
+    llvm_unreachable("Register class not supported");
+  }
+}
+
+// Instructions where all register operands are floating point.
+static bool isFloatingPointOpcode(unsigned Opc) {
+  switch (Opc) {
+  case TargetOpcode::G_FCONSTANT:
+  case TargetOpcode::G_FADD:
+  case TargetOpcode::G_FSUB:
+  case TargetOpcode::G_FMUL:
+  case TargetOpcode::G_FDIV:
+  case TargetOpcode::G_FMA:
+  case TargetOpcode::G_FNEG:
+  case TargetOpcode::G_FABS:
+  case TargetOpcode::G_FSQRT:
+  case TargetOpcode::G_FCOPYSIGN:
+  case TargetOpcode::G_FMINNUM:
+  case TargetOpcode::G_FMAXNUM:
+  case TargetOpcode::G_FPEXT:
+  case TargetOpcode::G_FPTRUNC:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Instructions where use operands are floating point registers.
+// Def operands are general purpose.
+static bool isFloatingPointOpcodeUse(unsigned Opc) {
+  switch (Opc) {
+  case TargetOpcode::G_FPTOSI:
+  case TargetOpcode::G_FPTOUI:
+  case TargetOpcode::G_FCMP:
+    return true;
+  default:
+    return isFloatingPointOpcode(Opc);
+  }
+}
+
+// Instructions where def operands are floating point registers.
+// Use operands are general purpose.
+static bool isFloatingPointOpcodeDef(unsigned Opc) {
+  switch (Opc) {
+  case TargetOpcode::G_SITOFP:
+  case TargetOpcode::G_UITOFP:
+    return true;
+  default:
+    return isFloatingPointOpcode(Opc);
+  }
+}
+
+bool RISCVRegisterBankInfo::onlyDefinesFP(Register Reg,
+                                          const MachineRegisterInfo &MRI,
+                                          const TargetRegisterInfo &TRI) const {
+  // Instructions visited before already have their banks.
+  if (const RegisterBank *Bank = getRegBank(Reg, MRI, TRI))
+    return Bank->getID() == RISCV::FPRRegBankID;
+
+  const MachineInstr *DefMI = MRI.getVRegDef(Reg);
+  if (!DefMI)
+    return false;
+  if (DefMI->getOpcode() == TargetOpcode::COPY)
+    return onlyDefinesFP(DefMI->getOperand(1).getReg(), MRI, TRI);
+  return isFloatingPointOpcodeDef(DefMI->getOpcode());
+}
+
+bool RISCVRegisterBankInfo::onlyUsesFP(Register Reg,
+                                       const MachineRegisterInfo &MRI,
+                                       const TargetRegisterInfo &TRI) const {
+  if (MRI.use_nodbg_empty(Reg))
+    return false;
+
+  for (const MachineInstr &UseMI : MRI.use_nodbg_instructions(Reg)) {
+    if (UseMI.getOpcode() == TargetOpcode::COPY) {
+      Register Dst = UseMI.getOperand(0).getReg();
+      if (Dst.isPhysical()) {
+        const RegisterBank *Bank = getRegBank(Dst, MRI, TRI);
+        if (!Bank || Bank->getID() != RISCV::FPRRegBankID)
+          return false;
+      } else if (!onlyUsesFP(Dst, MRI, TRI)) {
+        return false;
+      }
+      continue;
+    }
+    if (!isFloatingPointOpcodeUse(UseMI.getOpcode()))
+      return false;
+  }
+  return true;
+}
+
+static const RegisterBankInfo::ValueMapping *getFPRMapping(unsigned Size) {
+  return Size == 32 ? &RISCV::ValueMappings[RISCV::FPR32Idx]
+                    : &RISCV::ValueMappings[RISCV::FPR64Idx];
+}
+
+const RegisterBankInfo::InstructionMapping &
+RISCVRegisterBankInfo::getInstrMapping(const MachineInstr &MI) const {
+  unsigned Opc = MI.getOpcode();
+
+  if (!isPreISelGenericOpcode(Opc) || Opc == TargetOpcode::G_PHI) {
+    const RegisterBankInfo::InstructionMapping &Mapping =
+        getInstrMappingImpl(MI);
+    if (Mapping.isValid())
+      return Mapping;
+  }
+
+  using namespace TargetOpcode;
+
+  const MachineFunction &MF = *MI.getParent()->getParent();
+  const MachineRegisterInfo &MRI = MF.getRegInfo();
+  const TargetRegisterInfo &TRI = *MF.getSubtarget().getRegisterInfo();
+  const ValueMapping *GPRMapping = &RISCV::ValueMappings[RISCV::GPRIdx];
+  unsigned NumOperands = MI.getNumOperands();
+
+  // Check if LLT sizes match sizes of available register banks. Only FPRs hold
+  // 64-bit values on RV32.
+  for (const MachineOperand &Op : MI.operands()) {
+    if (Op.isReg() && Op.getReg()) {
+      LLT RegTy = MRI.getType(Op.getReg());
+      if (RegTy.getSizeInBits() != 32 && RegTy.getSizeInBits() != 64)
+        return getInvalidInstructionMapping();
+    }
+  }
+
+  SmallVector<const ValueMapping *, 4> OpdsMapping(NumOperands);
+  auto getSize = [&](unsigned Idx) {
+    return MRI.getType(MI.getOperand(Idx).getReg()).getSizeInBits();
+  };
+
+  switch (Opc) {
+  case G_FPTOSI:
+  case G_FPTOUI:
+    OpdsMapping[0] = GPRMapping;
+    OpdsMapping[1] = getFPRMapping(getSize(1));
+    break;
+  case G_SITOFP:
+  case G_UITOFP:
+    OpdsMapping[0] = getFPRMapping(getSize(0));
+    OpdsMapping[1] = GPRMapping;
+    break;
+  case G_FCMP:
+    OpdsMapping[0] = GPRMapping;
+    OpdsMapping[2] = OpdsMapping[3] = getFPRMapping(getSize(2));
+    break;
+  case G_MERGE_VALUES:
+    // Only f64 values are built from GPR pairs on RV32.
+    OpdsMapping[0] = getFPRMapping(64);
+    OpdsMapping[1] = OpdsMapping[2] = GPRMapping;
+    break;
+  case G_UNMERGE_VALUES:
+    OpdsMapping[0] = OpdsMapping[1] = GPRMapping;
+    OpdsMapping[2] = getFPRMapping(64);
+    break;
+  case G_LOAD:
+  case G_IMPLICIT_DEF: {
+    Register Dst = MI.getOperand(0).getReg();
+    unsigned Size = getSize(0);
+    if (Size == 64 ||
+        (!MRI.getType(Dst).isPointer() && onlyUsesFP(Dst, MRI, TRI)))
+      OpdsMapping[0] = getFPRMapping(Size);
+    else
+      OpdsMapping[0] = GPRMapping;
+    if (Opc == G_LOAD)
+      OpdsMapping[1] = GPRMapping;
+    break;
+  }
+  case G_STORE: {
+    Register Val = MI.getOperand(0).getReg();
+    unsigned Size = getSize(0);
+    if (Size == 64 ||
+        (!MRI.getType(Val).isPointer() && onlyDefinesFP(Val, MRI, TRI)))
+      OpdsMapping[0] = getFPRMapping(Size);
+    else
+      OpdsMapping[0] = GPRMapping;
+    OpdsMapping[1] = GPRMapping;
+    break;
+  }
+  case G_PHI: {
+    Register Dst = MI.getOperand(0).getReg();
+    unsigned Size = getSize(0);
+    bool IsFP = Size == 64;
+    if (!IsFP && !MRI.getType(Dst).isPointer()) {
+      IsFP = onlyUsesFP(Dst, MRI, TRI);
+      for (unsigned I = 1; !IsFP && I < NumOperands; I += 2)
+        IsFP = onlyDefinesFP(MI.getOperand(I).getReg(), MRI, TRI);
+    }
+    const ValueMapping *ValMapping = IsFP ? getFPRMapping(Size) : GPRMapping;
+    OpdsMapping[0] = ValMapping;
+    for (unsigned I = 1; I < NumOperands; I += 2)
+      OpdsMapping[I] = ValMapping;
+    break;
+  }
+  default:
+    if (isFloatingPointOpcode(Opc)) {
+      for (unsigned I = 0; I < NumOperands; ++I)
+        if (MI.getOperand(I).isReg())
+          OpdsMapping[I] = getFPRMapping(getSize(I));
+      break;
+    }
+    for (unsigned I = 0; I < NumOperands; ++I) {
+      if (!MI.getOperand(I).isReg() || !MI.getOperand(I).getReg())
+        continue;
+      if (getSize(I) != 32)
+        return getInvalidInstructionMapping();
+      OpdsMapping[I] = GPRMapping;
+    }
+    break;
+  }
+
+  return getInstructionMapping(DefaultMappingID, /*Cost=*/1,
+                               getOperandsMapping(OpdsMapping), NumOperands);
+}
@@ -32,6 +32,23 @@ protected:
 class RISCVRegisterBankInfo final : public RISCVGenRegisterBankInfo {
 public:
   RISCVRegisterBankInfo(const TargetRegisterInfo &TRI);
+
+  const RegisterBank &getRegBankFromRegClass(const TargetRegisterClass &RC,
+                                             LLT) const override;
+
+  const InstructionMapping &
+  getInstrMapping(const MachineInstr &MI) const override;
+
+private:
+  /// Return true if \p Reg is defined by an instruction which produces a
+  /// floating point value, looking through copies.
+  bool onlyDefinesFP(Register Reg, const MachineRegisterInfo &MRI,
+                     const TargetRegisterInfo &TRI) const;
+
+  /// Return true if all users of \p Reg consume it as a floating point value,
+  /// looking through copies.
+  bool onlyUsesFP(Register Reg, const MachineRegisterInfo &MRI,
+                  const TargetRegisterInfo &TRI) const;
 };
 } // end namespace llvm
 #endif
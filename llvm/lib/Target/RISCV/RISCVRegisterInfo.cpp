@@ -20,6 +20,8 @@
 #include "llvm/CodeGen/RegisterScavenging.h"
 #include "llvm/CodeGen/TargetFrameLowering.h"
 #include "llvm/CodeGen/TargetInstrInfo.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 
 #define GET_REGINFO_TARGET_DESC
@@ -27,6 +29,11 @@
 
 using namespace llvm;
 
+static cl::opt<bool> DisableRVCRegAllocHints(
+    "riscv-disable-rvc-regalloc-hints", cl::init(false), cl::Hidden,
+    cl::desc("Do not prefer the registers of the compressed instructions "
+             "during register allocation"));
+
 static_assert(RISCV::X1 == RISCV::X0 + 1, "Register list not consecutive");
 static_assert(RISCV::X31 == RISCV::X0 + 31, "Register list not consecutive");
 static_assert(RISCV::F1_H == RISCV::F0_H + 1, "Register list not consecutive");
@@ -229,3 +236,137 @@ RISCVRegisterInfo::getCallPreservedMask(const MachineFunction & MF,
     return CSR_ILP32D_LP64D_RegMask;
   }
 }
+
+/// Return true if \p MI only has a compressed encoding if its operand \p OpIdx
+/// is one of x8-x15 or f8-f15. \p Partner is set to the operand which has to
+/// be the same register for the compressed form, if any.
+static bool needsCompressedReg(const MachineInstr &MI, unsigned OpIdx,
+                               const RISCVSubtarget &ST, int &Partner) {
+  Partner = -1;
+  unsigned Scale = 0;
+  switch (MI.getOpcode()) {
+  default:
+    return false;
+  case RISCV::FLW:
+  case RISCV::FSW:
+    if (ST.is64Bit() || !ST.hasStdExtF())
+      return false;
+    Scale = 4;
+    break;
+  case RISCV::LW:
+  case RISCV::SW:
+    Scale = 4;
+    break;
+  case RISCV::FLD:
+  case RISCV::FSD:
+    if (!ST.hasStdExtD())
+      return false;
+    Scale = 8;
+    break;
+  case RISCV::LD:
+  case RISCV::SD:
+    if (!ST.is64Bit())
+      return false;
+    Scale = 8;
+    break;
+  case RISCV::ADDW:
+  case RISCV::SUBW:
+    if (!ST.is64Bit())
+      return false;
+    LLVM_FALLTHROUGH;
+  case RISCV::SUB:
+  case RISCV::XOR:
+  case RISCV::OR:
+  case RISCV::AND:
+    // c.sub and friends overwrite their first source.
+    if (OpIdx > 2)
+      return false;
+    if (OpIdx == 0)
+      Partner = 1;
+    else if (OpIdx == 1)
+      Partner = 0;
+    return true;
+  case RISCV::ANDI:
+  case RISCV::SRLI:
+  case RISCV::SRAI:
+    if (OpIdx > 1 || !MI.getOperand(2).isImm())
+      return false;
+    if (MI.getOpcode() == RISCV::ANDI ? !isInt<6>(MI.getOperand(2).getImm())
+                                      : MI.getOperand(2).getImm() == 0)
+      return false;
+    Partner = 1 - OpIdx;
+    return true;
+  case RISCV::BEQ:
+  case RISCV::BNE:
+    // c.beqz and c.bnez
+    return OpIdx == 0 && MI.getOperand(1).isReg() &&
+           MI.getOperand(1).getReg() == RISCV::X0;
+  }
+
+  // c.lw and friends take both registers from x8-x15 and a scaled unsigned
+  // five bit offset. Stack accesses use c.lwsp, which takes any register.
+  if (OpIdx > 1 || !MI.getOperand(1).isReg() ||
+      MI.getOperand(1).getReg() == RISCV::X2 || !MI.getOperand(2).isImm())
+    return false;
+  int64_t Offset = MI.getOperand(2).getImm();
+  return Offset >= 0 && Offset % Scale == 0 && Offset / Scale < 32;
+}
+
+bool RISCVRegisterInfo::getRegAllocationHints(
+    Register VirtReg, ArrayRef<MCPhysReg> Order,
+    SmallVectorImpl<MCPhysReg> &Hints, const MachineFunction &MF,
+    const VirtRegMap *VRM, const LiveRegMatrix *Matrix) const {
+  bool BaseImplRetVal = TargetRegisterInfo::getRegAllocationHints(
+      VirtReg, Order, Hints, MF, VRM, Matrix);
+  const auto &ST = MF.getSubtarget<RISCVSubtarget>();
+  if (!VRM || DisableRVCRegAllocHints || !ST.hasStdExtC())
+    return BaseImplRetVal;
+
+  // Only x8-x15 and f8-f15 fit the three bit register fields of most of the
+  // compressed instructions. Prefer them for values used by instructions
+  // which would become compressible. The machine function gives no access to
+  // block frequencies here, but greedy assigns the live ranges in the order
+  // of their spill weight, so the hottest values get these registers first.
+  const MachineRegisterInfo &MRI = MF.getRegInfo();
+  SmallVector<MCPhysReg, 4> PartnerHints;
+  bool WantsCompressed = false;
+  for (const MachineOperand &MO : MRI.reg_nodbg_operands(VirtReg)) {
+    const MachineInstr &MI = *MO.getParent();
+    int Partner;
+    if (MO.getSubReg() ||
+        !needsCompressedReg(MI, MI.getOperandNo(&MO), ST, Partner))
+      continue;
+    WantsCompressed = true;
+    if (Partner < 0 || !MI.getOperand(Partner).isReg())
+      continue;
+    // The compressed form also needs the same register for both operands.
+    Register PartnerReg = MI.getOperand(Partner).getReg();
+    if (PartnerReg.isVirtual())
+      PartnerReg = VRM->getPhys(PartnerReg);
+    if (PartnerReg && RISCV::GPRCRegClass.contains(PartnerReg))
+      PartnerHints.push_back(PartnerReg);
+  }
+  if (!WantsCompressed)
+    return BaseImplRetVal;
+
+  // The callee-saved ones among them are left to the allocation order, a
+  // hint should not cost a save and restore.
+  const MCPhysReg *CSRs = getCalleeSavedRegs(&MF);
+  auto IsCompressedReg = [&](MCPhysReg Reg) {
+    if (MRI.isReserved(Reg) || is_contained(Hints, Reg))
+      return false;
+    for (const MCPhysReg *CSR = CSRs; *CSR; ++CSR)
+      if (*CSR == Reg)
+        return false;
+    return RISCV::GPRCRegClass.contains(Reg) ||
+           RISCV::FPR32CRegClass.contains(Reg) ||
+           RISCV::FPR64CRegClass.contains(Reg);
+  };
+  for (MCPhysReg Reg : Order)
+    if (is_contained(PartnerHints, Reg) && IsCompressedReg(Reg))
+      Hints.push_back(Reg);
+  for (MCPhysReg Reg : Order)
+    if (IsCompressedReg(Reg))
+      Hints.push_back(Reg);
+  return BaseImplRetVal;
+}
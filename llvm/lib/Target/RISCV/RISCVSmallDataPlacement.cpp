@@ -0,0 +1,219 @@
+//===-- RISCVSmallDataPlacement.cpp - Place hot globals in small data -----===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass chooses the globals placed in the small data sections by how often
+// they are accessed instead of by their size alone. A global in .sdata, .sbss
+// or .srodata lies within the 4 KiB window around __global_pointer$, where the
+// linker relaxes
+//
+//   lui a0, %hi(g)
+//   lw  a1, %lo(g)(a0)
+//
+// into a single gp-relative access, also for the lui/lw pairs with folded
+// offsets formed by RISCVMergeBaseOffset:
+//
+//   lw  a1, %lo(g)(gp)
+//
+// The size threshold of RISCVELFTargetObjectFile (-msmall-data-limit) only
+// admits scalars, while the window has room for hot arrays and structs as
+// well. The use count of a global is the sum of the frequencies of the blocks
+// accessing it, relative to the entry of their function and scaled by its
+// profile count if available. The globals with the most uses per byte are
+// given an explicit small data section while they fit into the space of the
+// window which is not taken by the globals below the threshold.
+//
+// The window is shared by the whole program but the pass only sees one
+// module; globals linked outside of the window keep their lui/lw pairs.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RISCV.h"
+#include "RISCVSubtarget.h"
+#include "RISCVTargetMachine.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/MC/SectionKind.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Target/TargetLoweringObjectFile.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "riscv-sdata-placement"
+#define RISCV_SDATA_PLACEMENT_NAME "RISCV hot small data placement"
+
+static cl::opt<bool> DisableSDataPlacement(
+    "riscv-sdata-placement-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not place frequently accessed globals in small data"));
+
+static cl::opt<unsigned> SDataWindowSize(
+    "riscv-sdata-window-size", cl::init(4096), cl::Hidden,
+    cl::desc("Bytes of small data the module may place within reach of gp"));
+
+STATISTIC(NumPlaced, "Number of hot globals placed in small data");
+
+namespace {
+
+class RISCVSmallDataPlacement : public ModulePass {
+public:
+  static char ID;
+
+  RISCVSmallDataPlacement() : ModulePass(ID) {
+    initializeRISCVSmallDataPlacementPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  StringRef getPassName() const override { return RISCV_SDATA_PLACEMENT_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.setPreservesAll();
+  }
+
+private:
+  /// Return the number of executions of \p BB per module entry.
+  double getFrequency(BasicBlock *BB);
+
+  /// Accumulate the uses of \p V by instructions, looking through constant
+  /// expressions.
+  double getUseCount(const Value *V);
+
+  DenseMap<Function *, BlockFrequencyInfo *> BFIs;
+};
+
+struct Candidate {
+  GlobalVariable *GV;
+  uint64_t Size;
+  double Density;
+};
+
+} // end anonymous namespace
+
+char RISCVSmallDataPlacement::ID = 0;
+
+double RISCVSmallDataPlacement::getFrequency(BasicBlock *BB) {
+  Function *F = BB->getParent();
+  BlockFrequencyInfo *&BFI = BFIs[F];
+  if (!BFI)
+    BFI = &getAnalysis<BlockFrequencyInfoWrapperPass>(*F).getBFI();
+  double Freq = (double)BFI->getBlockFreq(BB).getFrequency() /
+                (double)BFI->getEntryFreq();
+  if (auto Count = F->getEntryCount())
+    Freq *= Count.getCount();
+  return Freq;
+}
+
+double RISCVSmallDataPlacement::getUseCount(const Value *V) {
+  double Count = 0;
+  for (const User *U : V->users()) {
+    if (auto *I = dyn_cast<Instruction>(U))
+      Count += getFrequency(const_cast<BasicBlock *>(I->getParent()));
+    else if (isa<ConstantExpr>(U))
+      Count += getUseCount(U);
+  }
+  return Count;
+}
+
+bool RISCVSmallDataPlacement::runOnModule(Module &M) {
+  if (DisableSDataPlacement || skipModule(M))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  // The linker does not relax gp-relative accesses in shared objects.
+  if (TM.isPositionIndependent())
+    return false;
+  if (llvm::none_of(M, [&](const Function &F) {
+        return !F.isDeclaration() &&
+               TM.getSubtargetImpl(F)->enableLinkerRelax();
+      }))
+    return false;
+
+  // Same default as RISCVELFTargetObjectFile; -G0 disables small data.
+  uint64_t Limit = 8;
+  if (auto *MD = mdconst::extract_or_null<ConstantInt>(
+          M.getModuleFlag("SmallDataLimit")))
+    Limit = MD->getZExtValue();
+  if (Limit == 0)
+    return false;
+
+  const DataLayout &DL = M.getDataLayout();
+  uint64_t Free = SDataWindowSize;
+  SmallVector<Candidate, 16> Candidates;
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.isDeclaration() || GV.hasSection() || GV.isThreadLocal() ||
+        GV.hasCommonLinkage() || GV.getAddressSpace() != 0 ||
+        !GV.getValueType()->isSized())
+      continue;
+    uint64_t Size = DL.getTypeAllocSize(GV.getValueType());
+    if (Size == 0)
+      continue;
+    // Already placed in small data by its size.
+    if (Size <= Limit) {
+      Free -= std::min(Free, Size);
+      continue;
+    }
+    if (Size > SDataWindowSize)
+      continue;
+    double Count = getUseCount(&GV);
+    if (Count > 0)
+      Candidates.push_back({&GV, Size, Count / Size});
+  }
+
+  llvm::stable_sort(Candidates, [](const Candidate &A, const Candidate &B) {
+    return A.Density > B.Density;
+  });
+
+  bool Changed = false;
+  for (const Candidate &C : Candidates) {
+    if (C.Size > Free)
+      continue;
+    SectionKind Kind = TargetLoweringObjectFile::getKindForGlobal(C.GV, TM);
+    StringRef Section;
+    if (Kind.isBSS())
+      Section = ".sbss";
+    else if (Kind.isData())
+      Section = ".sdata";
+    else if (Kind.isReadOnly())
+      Section = ".srodata";
+    else
+      continue;
+    LLVM_DEBUG(dbgs() << "Placing " << C.GV->getName() << " (" << C.Size
+                      << " bytes, " << C.Density << " uses per byte) in "
+                      << Section << "\n");
+    C.GV->setSection(Section);
+    Free -= C.Size;
+    Changed = true;
+    ++NumPlaced;
+  }
+  return Changed;
+}
+
+INITIALIZE_PASS_BEGIN(RISCVSmallDataPlacement, DEBUG_TYPE,
+                      RISCV_SDATA_PLACEMENT_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_END(RISCVSmallDataPlacement, DEBUG_TYPE,
+                    RISCV_SDATA_PLACEMENT_NAME, false, false)
+
+namespace llvm {
+  ModulePass *createRISCVSmallDataPlacementPass() {
+    return new RISCVSmallDataPlacement();
+  }
+} // end of namespace llvm
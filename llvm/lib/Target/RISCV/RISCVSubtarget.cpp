@@ -17,12 +17,33 @@
 #include "RISCVLegalizerInfo.h"
 #include "RISCVRegisterBankInfo.h"
 #include "RISCVTargetMachine.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetRegistry.h"
 
 using namespace llvm;
 
 #define DEBUG_TYPE "riscv-subtarget"
 
+static cl::opt<unsigned> FetchAlignment(
+    "riscv-fetch-align", cl::init(4), cl::Hidden,
+    cl::desc("Size in bytes of the aligned blocks fetched by the core, to "
+             "which hot innermost loops are aligned"));
+
+static cl::opt<unsigned> TCDMNumBanks(
+    "riscv-tcdm-banks", cl::init(0), cl::Hidden,
+    cl::desc("Number of word-interleaved banks of the L1 memory, overrides "
+             "the default of the processor"));
+
+static cl::opt<unsigned> TCDMBankWidth(
+    "riscv-tcdm-bank-width", cl::init(0), cl::Hidden,
+    cl::desc("Width in bytes of the banks of the L1 memory, overrides the "
+             "default of the processor"));
+
+static cl::opt<unsigned> ICacheSize(
+    "riscv-icache-size", cl::init(0), cl::Hidden,
+    cl::desc("Size in bytes of the instruction cache shared by the cores of "
+             "the cluster, overrides the default of the processor"));
+
 #define GET_SUBTARGETINFO_TARGET_DESC
 #define GET_SUBTARGETINFO_CTOR
 #include "RISCVGenSubtargetInfo.inc"
@@ -71,6 +92,41 @@ RISCVSubtarget::RISCVSubtarget(const Triple &TT, StringRef CPU,
       *static_cast<const RISCVTargetMachine *>(&TM), *this, *RBI));
 }
 
+Align RISCVSubtarget::getFetchAlignment() const {
+  // The cores of this target fetch one aligned 32-bit word per cycle.
+  return Align(PowerOf2Floor(std::max<unsigned>(FetchAlignment, 1)));
+}
+
+unsigned RISCVSubtarget::getTCDMNumBanks() const {
+  if (TCDMNumBanks.getNumOccurrences())
+    return TCDMNumBanks;
+  // MemPool interleaves 1024 banks among its 256 cores, a Snitch cluster has
+  // 32 banks for its 8 cores and the DMA engine.
+  if (HasExtXmempool)
+    return 1024;
+  if (HasExtXssr)
+    return 32;
+  return 0;
+}
+
+unsigned RISCVSubtarget::getTCDMBankWidth() const {
+  if (TCDMBankWidth.getNumOccurrences())
+    return std::max<unsigned>(TCDMBankWidth, 1);
+  return HasExtXmempool ? 4 : 8;
+}
+
+unsigned RISCVSubtarget::getICacheSize() const {
+  if (ICacheSize.getNumOccurrences())
+    return ICacheSize;
+  // The cores of a PULP cluster share a 4 KiB instruction cache, the ones of
+  // a Snitch cluster 8 KiB.
+  if (HasPULPExtV2)
+    return 4096;
+  if (HasExtXssr)
+    return 8192;
+  return 0;
+}
+
 const CallLowering *RISCVSubtarget::getCallLowering() const {
   return CallLoweringInfo.get();
 }
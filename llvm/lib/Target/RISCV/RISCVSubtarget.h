@@ -89,6 +89,7 @@ class RISCVSubtarget : public RISCVGenSubtargetInfo {
   bool EnableLinkerRelax = false;
   bool EnableRVCHintInstrs = true;
   bool EnableSaveRestore = false;
+  bool EnableSoftwarePipeliner = false;
   unsigned XLen = 32;
   MVT XLenVT = MVT::i32;
   RISCVABI::ABI TargetABI = RISCVABI::ABI_Unknown;
@@ -129,6 +130,13 @@ public:
     return &TSInfo;
   }
   bool enableMachineScheduler() const override { return true; }
+  bool isXRaySupported() const override { return true; }
+  // The pipeliner relies on the per-operand machine model instead of
+  // itineraries.
+  bool enableMachinePipeliner() const override {
+    return EnableSoftwarePipeliner && getSchedModel().hasInstrSchedModel();
+  }
+  bool useDFAforSMS() const override { return false; }
   bool hasStdExtM() const { return HasStdExtM; }
   bool hasStdExtA() const { return HasStdExtA; }
   bool hasStdExtF() const { return HasStdExtF; }
@@ -190,11 +198,33 @@ public:
   bool hasExtXfexpauxvecquarter() const { return HasExtXfexpauxvecquarter; }
   bool hasExtXfexpauxvecaltquarter() const { return HasExtXfexpauxvecaltquarter; }
   // -->
+  // The packed SIMD formats are used for code generation where a vector fills
+  // a 64-bit FP register.
+  bool hasPackedV2F32() const { return HasExtXfvecsingle && HasStdExtD; }
+  bool hasPackedV4F16() const {
+    return HasExtXfvechalf && HasStdExtD && HasStdExtZfh;
+  }
+  // bfloat16 is stored in the half registers, which Zfh provides.
+  bool hasBF16() const { return HasExtXfalthalf && HasStdExtZfh; }
+  bool hasPackedExpandingDotProduct() const {
+    return HasExtXfexpauxvechalf && hasPackedV2F32() && hasPackedV4F16();
+  }
   bool is64Bit() const { return HasRV64; }
   bool isRV32E() const { return IsRV32E; }
   bool enableLinkerRelax() const { return EnableLinkerRelax; }
   bool enableRVCHintInstrs() const { return EnableRVCHintInstrs; }
   bool enableSaveRestore() const { return EnableSaveRestore; }
+  /// Alignment of the blocks fetched by the core. Loop headers are aligned to
+  /// it if instructions may straddle a fetch block, i.e. with compression.
+  Align getFetchAlignment() const;
+  /// Number of word-interleaved banks of the L1 memory of the cluster, or 0
+  /// if the processor has no banked L1 memory.
+  unsigned getTCDMNumBanks() const;
+  /// Width in bytes of the banks of the L1 memory.
+  unsigned getTCDMBankWidth() const;
+  /// Size in bytes of the instruction cache shared by the cores of the
+  /// cluster, or 0 if unknown.
+  unsigned getICacheSize() const;
   MVT getXLenVT() const { return XLenVT; }
   unsigned getXLen() const { return XLen; }
   RISCVABI::ABI getTargetABI() const { return TargetABI; }
@@ -27,11 +27,18 @@
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/InitializePasses.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/Scalar.h"
 using namespace llvm;
 
+static cl::opt<int> EnableGlobalISelAtO(
+    "riscv-enable-global-isel-at-O", cl::Hidden,
+    cl::desc("Enable GlobalISel at or below an opt level (-1 to disable)"),
+    cl::init(-1));
+
 extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializeRISCVTarget() {
   RegisterTargetMachine<RISCVTargetMachine> X(getTheRISCV32Target());
   RegisterTargetMachine<RISCVTargetMachine> Y(getTheRISCV64Target());
@@ -39,10 +46,26 @@ extern "C" LLVM_EXTERNAL_VISIBILITY void LLVMInitializeRISCVTarget() {
   initializeGlobalISel(*PR);
   initializeRISCVMergeBaseOffsetOptPass(*PR);
   initializeRISCVExpandSSRPass(*PR);
+  initializePULPDotProductPass(*PR);
+  initializePULPEventWaitPass(*PR);
+  initializePULPPostIncrementPass(*PR);
+  initializePULPPremPhasesPass(*PR);
   initializeSNITCHFrepLoopsPass(*PR);
+  initializeSNITCHSSRInferencePass(*PR);
+  initializeSNITCHDMACopyIdiomPass(*PR);
+  initializeSNITCHDMADoubleBufferPass(*PR);
+  initializeSNITCHDMAWaitSinkingPass(*PR);
+  initializeSNITCHFDotProductPass(*PR);
+  initializeSNITCHMempoolBarrierPass(*PR);
+  initializeSNITCHSSRConfigHoistPass(*PR);
+  initializeSNITCHSSRRegionOptPass(*PR);
+  initializeSNITCHFPUSyncSinkingPass(*PR);
+  initializeSNITCHTCDMBankPaddingPass(*PR);
+  initializeSNITCHOpenMPLoweringPass(*PR);
+  initializeRISCVSmallDataPlacementPass(*PR);
   initializeRISCVExpandSDMAPass(*PR);
   initializeRISCVExpandPseudoPass(*PR);
-  initializeRISCVCleanupVSETVLIPass(*PR);
+  initializeRISCVInsertVSETVLIPass(*PR);
 }
 
 static StringRef computeDataLayout(const Triple &TT) {
@@ -78,6 +101,13 @@ RISCVTargetMachine::RISCVTargetMachine(const Target &T, const Triple &TT,
 
   // RISC-V supports the MachineOutliner.
   setMachineOutliner(true);
+
+  // GlobalISel only covers RV32. Functions it cannot handle fall back to
+  // SelectionDAG.
+  if (getOptLevel() <= EnableGlobalISelAtO && !TT.isArch64Bit()) {
+    setGlobalISel(true);
+    setGlobalISelAbort(GlobalISelAbortMode::Disable);
+  }
 }
 
 const RISCVSubtarget *
@@ -141,6 +171,14 @@ bool RISCVTargetMachine::isNoopAddrSpaceCast(unsigned SrcAS,
   return true;
 }
 
+// Calls inside SSR streaming regions only pause the streams if the callee
+// writes the SSR data registers, which requires the register usage of the
+// callees.
+bool RISCVTargetMachine::useIPRA() const {
+  return getTargetCPU() == "snitch" ||
+         getTargetFeatureString().contains("+xssr");
+}
+
 namespace {
 class RISCVPassConfig : public TargetPassConfig {
 public:
@@ -157,10 +195,11 @@ public:
   bool addLegalizeMachineIR() override;
   bool addRegBankSelect() override;
   bool addGlobalInstructionSelect() override;
-  void addPreEmitPass() override;
+  void addPostBBSections() override;
   void addPreEmitPass2() override;
   void addPreSched2() override;
   void addPreRegAlloc() override;
+  bool addILPOpts() override;
 };
 } // namespace
 
@@ -169,7 +208,35 @@ TargetPassConfig *RISCVTargetMachine::createPassConfig(PassManagerBase &PM) {
 }
 
 void RISCVPassConfig::addIRPasses() {
+  // Lower the OpenMP runtime calls of bare-metal Snitch code first, the DMA
+  // operations it leaves to the DMA core are seen by the passes below.
+  addPass(createSNITCHOpenMPLoweringPass());
+  // Expand the barriers before the atomics of the counter tree are expanded.
+  addPass(createSNITCHMempoolBarrierPass());
   addPass(createAtomicExpandPass());
+  // Recognize DMA copies and infer SSR streams before LSR rewrites the
+  // address computations.
+  if (getOptLevel() != CodeGenOpt::None) {
+    // Pad the rows of L1 arrays first, so that the strides follow the padding.
+    addPass(createSNITCHTCDMBankPaddingPass());
+    addPass(createSNITCHDMACopyIdiomPass());
+    addPass(createSNITCHDMADoubleBufferPass());
+    // Split the loops of PREM kernels into memory and compute phases.
+    addPass(createPULPPremPhasesPass());
+    addPass(createSNITCHSSRInferencePass());
+    // Form integer and expanding floating-point dot products before the
+    // reductions are expanded.
+    addPass(createPULPDotProductPass());
+    addPass(createSNITCHFDotProductPass());
+    // Let cores polling the event unit sleep until the event arrives.
+    addPass(createPULPEventWaitPass());
+    // Assign the small data sections before the globals are lowered.
+    addPass(createRISCVSmallDataPlacementPass());
+    // Use 32-bit accelerator pointers for the host pointers that are known to
+    // point to accelerator memory.
+    if (getRISCVTargetMachine().isHEROAccelerator())
+      addPass(createInferAddressSpacesPass());
+  }
   TargetPassConfig::addIRPasses();
 }
 
@@ -199,10 +266,18 @@ bool RISCVPassConfig::addGlobalInstructionSelect() {
   return false;
 }
 
-void RISCVPassConfig::addPreSched2() {}
+void RISCVPassConfig::addPreSched2() {
+  // Delay the reads of FPU results once the machine scheduler can no longer
+  // hoist them.
+  if (TM->getOptLevel() != CodeGenOpt::None)
+    addPass(createSNITCHFPUSyncSinkingPass());
+}
 
-void RISCVPassConfig::addPreEmitPass() { 
-  addPass(&BranchRelaxationPassID); 
+void RISCVPassConfig::addPostBBSections() {
+  // Branch relaxation runs once the blocks of split functions know their
+  // section, a branch from the hot part of a function to its cold part may
+  // have to cross the whole address space.
+  addPass(&BranchRelaxationPassID);
 }
 
 void RISCVPassConfig::addPreEmitPass2() {
@@ -214,13 +289,35 @@ void RISCVPassConfig::addPreEmitPass2() {
   addPass(createRISCVExpandAtomicPseudoPass());
 }
 
+bool RISCVPassConfig::addILPOpts() {
+  // Fold the multiplies instruction selection left alone into PULP
+  // multiply-accumulates.
+  addPass(&MachineCombinerID);
+  return true;
+}
+
 void RISCVPassConfig::addPreRegAlloc() {
+  // Sink the waits for single transfers while the DMA pseudos are still
+  // intact.
+  if (TM->getOptLevel() != CodeGenOpt::None)
+    addPass(createSNITCHDMAWaitSinkingPass());
+  // Likewise merge the SSR regions and remove or sink the barriers before
+  // they are expanded.
+  if (TM->getOptLevel() != CodeGenOpt::None)
+    addPass(createSNITCHSSRRegionOptPass());
   addPass(createRISCVExpandSDMAPass());
   addPass(createRISCVExpandSSRPass());
+  if (TM->getOptLevel() != CodeGenOpt::None)
+    addPass(createSNITCHSSRConfigHoistPass());
   addPass(createSNITCHFrepLoopsPass());
-  if (TM->getOptLevel() != CodeGenOpt::None) {
+  if (TM->getOptLevel() != CodeGenOpt::None)
     addPass(createRISCVMergeBaseOffsetOptPass());
-    addPass(createRISCVCleanupVSETVLIPass());
+  addPass(createRISCVInsertVSETVLIPass());
+  if (TM->getOptLevel() != CodeGenOpt::None) {
+    // Pipeline before the hardware loop conversion so that the kernel of a
+    // pipelined loop still becomes a zero-overhead loop.
+    addPass(&MachinePipelinerID);
+    addPass(createPULPPostIncrementPass());
     addPass(createPULPHardwareLoops());
   }
 }
@@ -49,6 +49,18 @@ public:
 
   virtual bool isNoopAddrSpaceCast(unsigned SrcAS,
                                    unsigned DstAS) const override;
+
+  bool useIPRA() const override;
+
+  /// Address space of the 64-bit pointers with which the PULP accelerator of a
+  /// HERO platform accesses the shared virtual memory of the host.
+  static constexpr unsigned HEROHostAddressSpace = 1;
+
+  /// Whether this targets the 32-bit accelerator of a HERO platform.
+  bool isHEROAccelerator() const {
+    return TargetTriple.getVendor() == Triple::HERO &&
+           TargetTriple.isArch32Bit();
+  }
 };
 } // namespace llvm
 
@@ -7,13 +7,29 @@
 //===----------------------------------------------------------------------===//
 
 #include "RISCVTargetObjectFile.h"
+#include "RISCV.h"
 #include "RISCVTargetMachine.h"
 #include "llvm/BinaryFormat/ELF.h"
+#include "llvm/CodeGen/BasicBlockSectionUtils.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCSectionELF.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace llvm;
 
+static cl::opt<std::string> MempoolSeqSectionName(
+    "riscv-mempool-seq-section", cl::init(".l1_prio"), cl::Hidden,
+    cl::desc("Section of the data in the MemPool sequential address space"));
+
+// The PULP runtimes keep the .text sections in the instruction memory close to
+// the cores. The cold parts of split functions are better off in L2.
+static cl::opt<std::string> PULPColdTextPrefix(
+    "riscv-pulp-cold-text-prefix", cl::init(".l2_text."), cl::Hidden,
+    cl::desc("Section prefix of the cold blocks split out of functions for "
+             "PULP, placed in L2 by the linker script"));
+
 void RISCVELFTargetObjectFile::Initialize(MCContext &Ctx,
                                           const TargetMachine &TM) {
   TargetLoweringObjectFileELF::Initialize(Ctx, TM);
@@ -22,6 +38,9 @@ void RISCVELFTargetObjectFile::Initialize(MCContext &Ctx,
       ".sdata", ELF::SHT_PROGBITS, ELF::SHF_WRITE | ELF::SHF_ALLOC);
   SmallBSSSection = getContext().getELFSection(".sbss", ELF::SHT_NOBITS,
                                                ELF::SHF_WRITE | ELF::SHF_ALLOC);
+  MempoolSeqSection =
+      getContext().getELFSection(MempoolSeqSectionName, ELF::SHT_PROGBITS,
+                                 ELF::SHF_WRITE | ELF::SHF_ALLOC);
 }
 
 // A address must be loaded from a small section if its size is less than the
@@ -42,6 +61,9 @@ bool RISCVELFTargetObjectFile::isGlobalInSmallSection(
   if (!GVA)
     return false;
 
+  if (isGlobalInMempoolSeqSection(GVA))
+    return false;
+
   // If the variable has an explicit section, it is placed in that section.
   if (GVA->hasSection()) {
     StringRef Section = GVA->getSection();
@@ -71,8 +93,20 @@ bool RISCVELFTargetObjectFile::isGlobalInSmallSection(
       GVA->getParent()->getDataLayout().getTypeAllocSize(Ty));
 }
 
+// The address space only selects the section if there is no explicit one, the
+// runtime maps the section to the sequential region of each tile.
+bool RISCVELFTargetObjectFile::isGlobalInMempoolSeqSection(
+    const GlobalObject *GO) const {
+  const GlobalVariable *GVA = dyn_cast<GlobalVariable>(GO);
+  return GVA && !GVA->hasSection() &&
+         GVA->getAddressSpace() == RISCVAS::MEMPOOL_SEQ;
+}
+
 MCSection *RISCVELFTargetObjectFile::SelectSectionForGlobal(
     const GlobalObject *GO, SectionKind Kind, const TargetMachine &TM) const {
+  if (isGlobalInMempoolSeqSection(GO))
+    return MempoolSeqSection;
+
   // Handle Small Section classification here.
   if (Kind.isBSS() && isGlobalInSmallSection(GO, TM))
     return SmallBSSSection;
@@ -83,6 +117,32 @@ MCSection *RISCVELFTargetObjectFile::SelectSectionForGlobal(
   return TargetLoweringObjectFileELF::SelectSectionForGlobal(GO, Kind, TM);
 }
 
+MCSection *RISCVELFTargetObjectFile::getSectionForMachineBasicBlock(
+    const Function &F, const MachineBasicBlock &MBB,
+    const TargetMachine &TM) const {
+  // An explicit -bbsections-cold-text-prefix applies to all targets.
+  if (MBB.getSectionID() != MBBSectionID::ColdSectionID ||
+      BBSectionsColdTextPrefix.getNumOccurrences() ||
+      PULPColdTextPrefix.empty() ||
+      !static_cast<const RISCVTargetMachine &>(TM)
+           .getSubtargetImpl(F)
+           ->hasPULPExtV2())
+    return TargetLoweringObjectFileELF::getSectionForMachineBasicBlock(F, MBB,
+                                                                       TM);
+
+  SmallString<128> Name(PULPColdTextPrefix);
+  Name += MBB.getParent()->getName();
+  unsigned Flags = ELF::SHF_ALLOC | ELF::SHF_EXECINSTR;
+  std::string GroupName;
+  if (F.hasComdat()) {
+    Flags |= ELF::SHF_GROUP;
+    GroupName = F.getComdat()->getName().str();
+  }
+  return getContext().getELFSection(Name, ELF::SHT_PROGBITS, Flags,
+                                    0 /* Entry Size */, GroupName,
+                                    MCContext::GenericSectionID, nullptr);
+}
+
 void RISCVELFTargetObjectFile::getModuleMetadata(Module &M) {
   SmallVector<Module::ModuleFlagEntry, 8> ModuleFlags;
   M.getModuleFlagsMetadata(ModuleFlags);
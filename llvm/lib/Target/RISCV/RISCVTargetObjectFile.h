@@ -17,6 +17,7 @@ namespace llvm {
 class RISCVELFTargetObjectFile : public TargetLoweringObjectFileELF {
   MCSection *SmallDataSection;
   MCSection *SmallBSSSection;
+  MCSection *MempoolSeqSection;
   unsigned SSThreshold = 8;
 
 public:
@@ -27,6 +28,10 @@ public:
   bool isGlobalInSmallSection(const GlobalObject *GO,
                               const TargetMachine &TM) const;
 
+  /// Return true if this global lives in the sequential L1 region of a
+  /// MemPool tile.
+  bool isGlobalInMempoolSeqSection(const GlobalObject *GO) const;
+
   MCSection *SelectSectionForGlobal(const GlobalObject *GO, SectionKind Kind,
                                     const TargetMachine &TM) const override;
 
@@ -37,6 +42,12 @@ public:
                                    const Constant *C,
                                    Align &Alignment) const override;
 
+  /// Place the cold blocks split out of PULP functions into L2.
+  MCSection *
+  getSectionForMachineBasicBlock(const Function &F,
+                                 const MachineBasicBlock &MBB,
+                                 const TargetMachine &TM) const override;
+
   void getModuleMetadata(Module &M) override;
 
   bool isInSmallSection(uint64_t Size) const;
@@ -8,13 +8,33 @@
 
 #include "RISCVTargetTransformInfo.h"
 #include "MCTargetDesc/RISCVMatInt.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/CodeGen/BasicTTIImpl.h"
 #include "llvm/CodeGen/TargetLowering.h"
+#include "llvm/Support/CommandLine.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "riscvtti"
 
+// PULPHardwareLoops only converts loops of up to 0xFFF bytes, assuming four
+// bytes per instruction.
+static cl::opt<unsigned> PULPHwLoopMaxSize(
+    "riscv-pulp-hwloop-max-size", cl::init(1023), cl::Hidden,
+    cl::desc("Largest loop body in instructions which the unroller keeps "
+             "eligible for a PULP hardware loop"));
+
+static cl::opt<unsigned> RVVSetVLICost(
+    "riscv-v-vsetvli-cost", cl::init(1), cl::Hidden,
+    cl::desc("Cost of the vsetvli switching the element width of a vector "
+             "loop"));
+
+// The V extension allows vector registers of up to 64 Kib, each made of
+// vscale blocks of 64 bits.
+static const unsigned RVVMaxVLEN = 65536;
+static const unsigned RVVBitsPerBlock = 64;
+
 int RISCVTTIImpl::getIntImmCost(const APInt &Imm, Type *Ty,
                                 TTI::TargetCostKind CostKind) {
   assert(Ty->isIntegerTy() &&
@@ -105,3 +125,478 @@ bool RISCVTTIImpl::isLoweredToCall(const Function *F) {
 bool RISCVTTIImpl::shouldFavorPostInc() const {
   return ST->hasPULPExtV2();
 }
+
+bool RISCVTTIImpl::isLSRCostLess(TargetTransformInfo::LSRCost &C1,
+                                 TargetTransformInfo::LSRCost &C2) {
+  if (!ST->hasPULPExtV2())
+    return BaseT::isLSRCostLess(C1, C2);
+  // With post-increment addressing and hardware loops, a formula which needs
+  // no IV arithmetic at all is cheaper than one saving a register.
+  return std::tie(C1.Insns, C1.NumRegs, C1.AddRecCost, C1.NumIVMuls,
+                  C1.NumBaseAdds, C1.ScaleCost, C1.ImmCost, C1.SetupCost) <
+         std::tie(C2.Insns, C2.NumRegs, C2.AddRecCost, C2.NumIVMuls,
+                  C2.NumBaseAdds, C2.ScaleCost, C2.ImmCost, C2.SetupCost);
+}
+
+bool RISCVTTIImpl::isNumRegsMajorCostOfLSR() {
+  return !ST->hasPULPExtV2();
+}
+
+bool RISCVTTIImpl::canMacroFuseCmp() {
+  // The branches compare two registers, an exit test against a non-zero end
+  // value costs no extra instruction.
+  return ST->hasPULPExtV2();
+}
+
+bool RISCVTTIImpl::canSaveCmp(Loop *L, BranchInst **BI, ScalarEvolution *SE,
+                              LoopInfo *LI, DominatorTree *DT,
+                              AssumptionCache *AC,
+                              TargetLibraryInfo *LibInfo) {
+  // The exit compare of a loop converted by PULPHardwareLoops is replaced by
+  // the lp.setup, LSR need not keep an induction variable for it. The
+  // hardware loop pass removes the original one once it is dead.
+  HardwareLoopInfo HWLoopInfo(L);
+  if (!HWLoopInfo.canAnalyze(*LI) ||
+      !isHardwareLoopProfitable(L, *SE, *AC, LibInfo, HWLoopInfo) ||
+      !HWLoopInfo.isHardwareLoopCandidate(*SE, *LI, *DT))
+    return false;
+  *BI = HWLoopInfo.ExitBranch;
+  return true;
+}
+
+unsigned RISCVTTIImpl::getFlatAddressSpace() const {
+  // On HERO, host pointers can address everything, including the local memory
+  // of the accelerator, but every access through them has to be remapped.
+  // Treating them as flat lets InferAddressSpaces rewrite the accesses whose
+  // pointers are known to point to accelerator memory.
+  const auto &TM =
+      static_cast<const RISCVTargetMachine &>(TLI->getTargetMachine());
+  if (TM.isHEROAccelerator())
+    return RISCVTargetMachine::HEROHostAddressSpace;
+  return -1;
+}
+
+TTI::PopcntSupportKind RISCVTTIImpl::getPopcntSupport(unsigned TyWidth) {
+  assert(isPowerOf2_32(TyWidth) && "Ty width must be power of 2");
+  // p.cnt counts the bits of a word in a single cycle, as does cpop.
+  if (ST->hasPULPExtV2() && TyWidth <= 32)
+    return TTI::PSK_FastHardware;
+  if (ST->hasStdExtZbb() && TyWidth <= ST->getXLen())
+    return TTI::PSK_FastHardware;
+  return TTI::PSK_Software;
+}
+
+unsigned RISCVTTIImpl::getInliningHotCodeBudget() const {
+  // All cores of a cluster run the same hot loops out of the shared
+  // instruction cache, inlining beyond its size makes them all miss.
+  return ST->getICacheSize();
+}
+
+bool RISCVTTIImpl::isPULPVectorType(Type *Ty) const {
+  if (!ST->hasPULPExtV2() || !isa<FixedVectorType>(Ty))
+    return false;
+  EVT VT = getTLI()->getValueType(getDataLayout(), Ty);
+  return VT == MVT::v2i16 || VT == MVT::v4i8;
+}
+
+bool RISCVTTIImpl::isDotProductMul(const Instruction *I, unsigned VF) const {
+  if (!ST->hasPULPExtV2() || !I || I->getOpcode() != Instruction::Mul ||
+      I->getType()->getScalarSizeInBits() != 32)
+    return false;
+  for (const Value *Op : I->operands()) {
+    if (!isa<SExtInst>(Op) && !isa<ZExtInst>(Op))
+      return false;
+    Type *SrcTy = cast<CastInst>(Op)->getSrcTy();
+    unsigned Bits = SrcTy->getScalarSizeInBits();
+    if (!((Bits == 8 && VF == 4) || (Bits == 16 && VF == 2)))
+      return false;
+  }
+  return true;
+}
+
+bool RISCVTTIImpl::isRVVVectorType(Type *Ty) const {
+  return ST->hasStdExtV() && isa<ScalableVectorType>(Ty);
+}
+
+unsigned RISCVTTIImpl::getRVVLMUL(Type *Ty) const {
+  std::pair<int, MVT> LT = getTLI()->getTypeLegalizationCost(getDataLayout(),
+                                                             Ty);
+  unsigned Bits = LT.second.getSizeInBits().getKnownMinSize();
+  return LT.first * std::max(1u, Bits / RVVBitsPerBlock);
+}
+
+bool RISCVTTIImpl::hasPackedFPVectors() const {
+  return ST->hasPackedV2F32() || ST->hasPackedV4F16();
+}
+
+bool RISCVTTIImpl::isPackedFPVectorType(Type *Ty) const {
+  if (!isa<FixedVectorType>(Ty))
+    return false;
+  EVT VT = getTLI()->getValueType(getDataLayout(), Ty);
+  return (VT == MVT::v2f32 && ST->hasPackedV2F32()) ||
+         (VT == MVT::v4f16 && ST->hasPackedV4F16());
+}
+
+bool RISCVTTIImpl::isFDotProductMul(const Instruction *I, unsigned VF) const {
+  if (!ST->hasPackedExpandingDotProduct() || !I ||
+      I->getOpcode() != Instruction::FMul ||
+      !I->getType()->getScalarType()->isFloatTy() || VF % 4 != 0)
+    return false;
+  for (const Value *Op : I->operands()) {
+    const auto *Ext = dyn_cast<FPExtInst>(Op);
+    if (!Ext || !Ext->getSrcTy()->getScalarType()->isHalfTy())
+      return false;
+  }
+  return true;
+}
+
+unsigned RISCVTTIImpl::getNumberOfRegisters(unsigned ClassID) const {
+  bool Vector = (ClassID == 1);
+  // The packed smallfloat formats live in the FP registers.
+  if (Vector && hasPackedFPVectors())
+    return 32;
+  // The packed SIMD types of the PULP extension live in the GPRs, which are
+  // shared with the addresses and scalars of the loop.
+  if (Vector && ST->hasPULPExtV2())
+    return 16;
+  return BaseT::getNumberOfRegisters(ClassID);
+}
+
+unsigned RISCVTTIImpl::getRegisterBitWidth(bool Vector) const {
+  if (Vector && hasPackedFPVectors())
+    return 64;
+  if (Vector && ST->hasPULPExtV2())
+    return 32;
+  return BaseT::getRegisterBitWidth(Vector);
+}
+
+Optional<unsigned> RISCVTTIImpl::getMaxVScale() const {
+  if (ST->hasStdExtV())
+    return RVVMaxVLEN / RVVBitsPerBlock;
+  return BaseT::getMaxVScale();
+}
+
+unsigned RISCVTTIImpl::getRegUsageForType(Type *Ty) {
+  // A register group of LMUL > 1 occupies as many vector registers.
+  if (isRVVVectorType(Ty))
+    return getRVVLMUL(Ty);
+  return BaseT::getRegUsageForType(Ty);
+}
+
+bool RISCVTTIImpl::shouldMaximizeVectorBandwidth(bool OptSize) const {
+  // Mixed precision loops are vectorized by the narrow type, the wide
+  // operations are split or become expanding ones.
+  return hasPackedFPVectors();
+}
+
+unsigned RISCVTTIImpl::getMinVectorRegisterBitWidth() const {
+  if (hasPackedFPVectors())
+    return 64;
+  if (ST->hasPULPExtV2())
+    return 32;
+  return BaseT::getMinVectorRegisterBitWidth();
+}
+
+unsigned RISCVTTIImpl::getArithmeticInstrCost(
+    unsigned Opcode, Type *Ty, TTI::TargetCostKind CostKind,
+    TTI::OperandValueKind Opd1Info, TTI::OperandValueKind Opd2Info,
+    TTI::OperandValueProperties Opd1PropInfo,
+    TTI::OperandValueProperties Opd2PropInfo, ArrayRef<const Value *> Args,
+    const Instruction *CxtI) {
+  // The vector unit processes one register of the group after the other, an
+  // operation with LMUL = 8 takes eight times as long as one with LMUL = 1.
+  if (isRVVVectorType(Ty))
+    return getRVVLMUL(Ty);
+  // A widening multiply-add of packed SIMD operands is a single pv.sdotsp,
+  // announce the multiplication as one instruction and the addition for free.
+  if (auto *VTy = dyn_cast<FixedVectorType>(Ty)) {
+    unsigned VF = VTy->getNumElements();
+    if (Opcode == Instruction::Mul && isDotProductMul(CxtI, VF))
+      return 1;
+    if (Opcode == Instruction::Add && CxtI &&
+        (isDotProductMul(dyn_cast<Instruction>(CxtI->getOperand(0)), VF) ||
+         isDotProductMul(dyn_cast<Instruction>(CxtI->getOperand(1)), VF)))
+      return 0;
+    // Likewise, four products of extended halves are one vfdotpex.s.h if the
+    // sum may be reassociated.
+    if (Opcode == Instruction::FMul && isFDotProductMul(CxtI, VF))
+      return VF / 4;
+    if (Opcode == Instruction::FAdd && CxtI && isa<FPMathOperator>(CxtI) &&
+        CxtI->hasAllowReassoc() &&
+        (isFDotProductMul(dyn_cast<Instruction>(CxtI->getOperand(0)), VF) ||
+         isFDotProductMul(dyn_cast<Instruction>(CxtI->getOperand(1)), VF)))
+      return 0;
+  }
+  return BaseT::getArithmeticInstrCost(Opcode, Ty, CostKind, Opd1Info,
+                                       Opd2Info, Opd1PropInfo, Opd2PropInfo,
+                                       Args, CxtI);
+}
+
+unsigned RISCVTTIImpl::getIntrinsicInstrCost(const IntrinsicCostAttributes &ICA,
+                                             TTI::TargetCostKind CostKind) {
+  // Most of the bit manipulation intrinsics are single instructions of the B
+  // extension on scalars of up to XLen bits. The generic cost model charges
+  // double for the ones that are custom lowered and does not know that a
+  // funnel shift of a value with itself is a rotate.
+  Type *RetTy = ICA.getReturnType();
+  if (!RetTy->isIntegerTy() || RetTy->getIntegerBitWidth() > ST->getXLen())
+    return BaseT::getIntrinsicInstrCost(ICA, CostKind);
+  // Narrower bswap and bitreverse need a shift after the rev8 or grevi,
+  // unless grevi can reverse the narrow value in place.
+  bool IsXLen = RetTy->getIntegerBitWidth() == ST->getXLen();
+  const auto &Args = ICA.getArgs();
+  switch (ICA.getID()) {
+  case Intrinsic::bswap:
+    if (ST->hasStdExtZbp())
+      return 1;
+    if (ST->hasStdExtZbb())
+      return IsXLen ? 1 : 2;
+    break;
+  case Intrinsic::bitreverse:
+    if (ST->hasStdExtZbp())
+      return 1;
+    break;
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz:
+  case Intrinsic::ctpop:
+  case Intrinsic::smin:
+  case Intrinsic::smax:
+  case Intrinsic::umin:
+  case Intrinsic::umax:
+    if (ST->hasStdExtZbb())
+      return 1;
+    break;
+  case Intrinsic::abs:
+    // A neg and a max.
+    if (ST->hasStdExtZbb())
+      return 2;
+    break;
+  case Intrinsic::fshl:
+  case Intrinsic::fshr:
+    if (ST->hasStdExtZbt())
+      return 1;
+    if ((ST->hasStdExtZbb() || ST->hasStdExtZbp()) && Args.size() == 3 &&
+        Args[0] == Args[1])
+      return 1;
+    break;
+  default:
+    break;
+  }
+  return BaseT::getIntrinsicInstrCost(ICA, CostKind);
+}
+
+unsigned RISCVTTIImpl::getCastInstrCost(unsigned Opcode, Type *Dst, Type *Src,
+                                        TTI::CastContextHint CCH,
+                                        TTI::TargetCostKind CostKind,
+                                        const Instruction *I) {
+  // Widening and narrowing operations change the element width, the loop
+  // needs a vsetvli before and after them. vsext and vzext extend by up to
+  // eight times, the other conversions only double or halve the width.
+  if (isRVVVectorType(Dst) && isRVVVectorType(Src)) {
+    unsigned DstBits = Dst->getScalarSizeInBits();
+    unsigned SrcBits = Src->getScalarSizeInBits();
+    unsigned LMUL = std::max(getRVVLMUL(Dst), getRVVLMUL(Src));
+    if (DstBits == SrcBits)
+      return LMUL;
+    unsigned Steps = 1;
+    if (Opcode == Instruction::Trunc || Opcode == Instruction::FPTrunc)
+      Steps = Log2_32(SrcBits / DstBits);
+    else if (Opcode == Instruction::FPExt)
+      Steps = Log2_32(DstBits / SrcBits);
+    return Steps * (LMUL + RVVSetVLICost);
+  }
+  // The extensions of dot product operands are folded into pv.sdotsp.
+  if ((Opcode == Instruction::SExt || Opcode == Instruction::ZExt) && I &&
+      isPULPVectorType(Src) && !I->user_empty()) {
+    unsigned VF = cast<FixedVectorType>(Src)->getNumElements();
+    if (all_of(I->users(), [&](const User *U) {
+          return isDotProductMul(dyn_cast<Instruction>(U), VF);
+        }))
+      return 0;
+  }
+  // Likewise the extensions of halves into vfdotpex.s.h.
+  if (Opcode == Instruction::FPExt && I && !I->user_empty() &&
+      isa<FixedVectorType>(Src)) {
+    unsigned VF = cast<FixedVectorType>(Src)->getNumElements();
+    if (all_of(I->users(), [&](const User *U) {
+          return isFDotProductMul(dyn_cast<Instruction>(U), VF);
+        }))
+      return 0;
+  }
+  return BaseT::getCastInstrCost(Opcode, Dst, Src, CCH, CostKind, I);
+}
+
+unsigned RISCVTTIImpl::getMemoryOpCost(unsigned Opcode, Type *Src,
+                                       MaybeAlign Alignment,
+                                       unsigned AddressSpace,
+                                       TTI::TargetCostKind CostKind,
+                                       const Instruction *I) {
+  // Unit-stride vle/vse transfer the register group one register at a time.
+  if (isRVVVectorType(Src))
+    return getRVVLMUL(Src);
+  return BaseT::getMemoryOpCost(Opcode, Src, Alignment, AddressSpace, CostKind,
+                                I);
+}
+
+unsigned RISCVTTIImpl::getVectorInstrCost(unsigned Opcode, Type *Val,
+                                          unsigned Index) {
+  // Single elements of the packed smallfloat formats are moved through the
+  // stack, a store and a load. The first element is the scalar register, and
+  // the second one of a pair is packed onto it with vfcpka.
+  if ((Opcode == Instruction::InsertElement ||
+       Opcode == Instruction::ExtractElement) &&
+      isPackedFPVectorType(Val)) {
+    bool IsPair = cast<FixedVectorType>(Val)->getNumElements() == 2;
+    if (Opcode == Instruction::ExtractElement && Index == 0)
+      return 0;
+    if (Opcode == Instruction::InsertElement && IsPair && Index == 1)
+      return 1;
+    return 2;
+  }
+  return BaseT::getVectorInstrCost(Opcode, Val, Index);
+}
+
+unsigned RISCVTTIImpl::getShuffleCost(TTI::ShuffleKind Kind, VectorType *Tp,
+                                      int Index, VectorType *SubTp) {
+  // Single source shuffles map to pv.shuffle.sci, splats to pv.pack.h or
+  // pv.add.sc.b. Two source shuffles take a pv.shuffle2 with its selector in
+  // a register, or a pv.insert or pv.pack.h for simple ones.
+  if (isPULPVectorType(Tp)) {
+    switch (Kind) {
+    case TTI::SK_Broadcast:
+    case TTI::SK_Reverse:
+    case TTI::SK_PermuteSingleSrc:
+      return 1;
+    case TTI::SK_Select:
+    case TTI::SK_Transpose:
+    case TTI::SK_PermuteTwoSrc:
+      return 2;
+    default:
+      break;
+    }
+  }
+  // Packed smallfloat splats are built with vfcpk. Selects are
+  // mostly the alternating fadd and fsub of complex arithmetic, which fold
+  // into one vfmac. Swapping a pair reloads or spills the second element and
+  // packs it with the first one.
+  if (isPackedFPVectorType(Tp)) {
+    bool IsPair = cast<FixedVectorType>(Tp)->getNumElements() == 2;
+    switch (Kind) {
+    case TTI::SK_Broadcast:
+    case TTI::SK_Select:
+      return 1;
+    case TTI::SK_Reverse:
+    case TTI::SK_PermuteSingleSrc:
+      if (IsPair)
+        return 3;
+      break;
+    default:
+      break;
+    }
+  }
+  return BaseT::getShuffleCost(Kind, Tp, Index, SubTp);
+}
+
+unsigned RISCVTTIImpl::getArithmeticReductionCost(
+    unsigned Opcode, VectorType *Ty, bool IsPairwise,
+    TTI::TargetCostKind CostKind) {
+  // An add reduction is a dot product with a splat of ones, pv.dotup.sci.
+  if (isPULPVectorType(Ty) && Opcode == Instruction::Add && !IsPairwise)
+    return 1;
+  return BaseT::getArithmeticReductionCost(Opcode, Ty, IsPairwise, CostKind);
+}
+
+bool RISCVTTIImpl::useReductionIntrinsic(unsigned Opcode, Type *Ty,
+                                         TTI::ReductionFlags Flags) const {
+  return Opcode == Instruction::Add && isPULPVectorType(Ty);
+}
+
+bool RISCVTTIImpl::shouldExpandReduction(const IntrinsicInst *II) const {
+  // Add reductions of the packed SIMD types are selected directly.
+  if (II->getIntrinsicID() == Intrinsic::vector_reduce_add &&
+      isPULPVectorType(II->getArgOperand(0)->getType()))
+    return false;
+  return true;
+}
+
+Optional<unsigned> RISCVTTIImpl::getLoopCodeSize(Loop *L, Loop *SkipSubLoop) {
+  unsigned Size = 0;
+  for (BasicBlock *BB : L->blocks()) {
+    if (SkipSubLoop && SkipSubLoop->contains(BB))
+      continue;
+    for (Instruction &I : *BB) {
+      if (const auto *CB = dyn_cast<CallBase>(&I)) {
+        const Function *F = CB->getCalledFunction();
+        if (!F || isLoweredToCall(F))
+          return None;
+      }
+      SmallVector<const Value *, 4> Operands(I.operand_values());
+      Size += getUserCost(&I, Operands, TTI::TCK_CodeSize);
+    }
+  }
+  return Size;
+}
+
+bool RISCVTTIImpl::isPULPHardwareLoopCandidate(Loop *L, ScalarEvolution &SE,
+                                               unsigned Size) const {
+  if (!ST->hasPULPExtV2() || Size > PULPHwLoopMaxSize)
+    return false;
+  // There are two hardware loop levels, the inner one is taken by the
+  // innermost loop.
+  if (any_of(*L, [](const Loop *SubLoop) { return !SubLoop->isInnermost(); }))
+    return false;
+  if (!L->getExitingBlock() || !L->getExitBlock())
+    return false;
+  return !isa<SCEVCouldNotCompute>(SE.getBackedgeTakenCount(L));
+}
+
+void RISCVTTIImpl::getUnrollingPreferences(Loop *L, ScalarEvolution &SE,
+                                           TTI::UnrollingPreferences &UP) {
+  BaseT::getUnrollingPreferences(L, SE, UP);
+  if (!ST->hasPULPExtV2())
+    return;
+
+  // PULPHardwareLoops turns counted loops into zero-overhead loops after
+  // unrolling. Keep the unroller from pushing a loop, or the loop it is
+  // unrolled into, past the size limit of the hardware loop setup.
+  Optional<unsigned> Size = getLoopCodeSize(L);
+  if (!Size)
+    return;
+
+  if (isPULPHardwareLoopCandidate(L, SE, *Size)) {
+    // The hardware loop already removes the counter update and the branch,
+    // unrolling only adds freedom to the scheduler. A runtime remainder loop
+    // would need a second loop setup instead.
+    UP.Runtime = false;
+    UP.PartialThreshold = std::min<unsigned>(UP.PartialThreshold,
+                                             PULPHwLoopMaxSize);
+  }
+
+  // A fully unrolled loop adds its unrolled body to its parent.
+  if (Loop *Parent = L->getParentLoop()) {
+    Optional<unsigned> ParentSize = getLoopCodeSize(Parent, L);
+    if (!ParentSize || !L->isInnermost() ||
+        !isPULPHardwareLoopCandidate(Parent, SE, *ParentSize + *Size))
+      return;
+    unsigned Room = PULPHwLoopMaxSize - *ParentSize;
+    UP.Threshold = std::min(UP.Threshold, Room);
+    UP.PartialThreshold = std::min(UP.PartialThreshold, Room);
+  }
+}
+
+bool RISCVTTIImpl::isHardwareLoopProfitable(Loop *L, ScalarEvolution &SE,
+                                            AssumptionCache &AC,
+                                            TargetLibraryInfo *LibInfo,
+                                            HardwareLoopInfo &HWLoopInfo) {
+  // The hardware loops are formed on machine IR by PULPHardwareLoops, give
+  // the same answer to the IR level clients.
+  Optional<unsigned> Size = getLoopCodeSize(L);
+  if (!Size || !isPULPHardwareLoopCandidate(L, SE, *Size))
+    return false;
+
+  LLVMContext &C = L->getHeader()->getContext();
+  HWLoopInfo.CountType = Type::getInt32Ty(C);
+  HWLoopInfo.LoopDecrement = ConstantInt::get(HWLoopInfo.CountType, 1);
+  HWLoopInfo.IsNestingLegal = true;
+  return true;
+}
@@ -21,6 +21,7 @@
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/CodeGen/BasicTTIImpl.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IntrinsicInst.h"
 
 namespace llvm {
 
@@ -49,6 +50,95 @@ public:
                           Type *Ty, TTI::TargetCostKind CostKind);
   bool isLoweredToCall(const Function *F);
   bool shouldFavorPostInc() const;
+  bool isLSRCostLess(TargetTransformInfo::LSRCost &C1,
+                     TargetTransformInfo::LSRCost &C2);
+  bool isNumRegsMajorCostOfLSR();
+  bool canMacroFuseCmp();
+  bool canSaveCmp(Loop *L, BranchInst **BI, ScalarEvolution *SE, LoopInfo *LI,
+                  DominatorTree *DT, AssumptionCache *AC,
+                  TargetLibraryInfo *LibInfo);
+  unsigned getFlatAddressSpace() const;
+  TTI::PopcntSupportKind getPopcntSupport(unsigned TyWidth);
+  unsigned getInliningHotCodeBudget() const;
+
+  unsigned getNumberOfRegisters(unsigned ClassID) const;
+  unsigned getRegisterBitWidth(bool Vector) const;
+  unsigned getMinVectorRegisterBitWidth() const;
+  bool shouldMaximizeVectorBandwidth(bool OptSize) const;
+  bool supportsScalableVectors() const { return ST->hasStdExtV(); }
+  Optional<unsigned> getMaxVScale() const;
+  unsigned getRegUsageForType(Type *Ty);
+
+  unsigned getArithmeticInstrCost(
+      unsigned Opcode, Type *Ty,
+      TTI::TargetCostKind CostKind = TTI::TCK_RecipThroughput,
+      TTI::OperandValueKind Opd1Info = TTI::OK_AnyValue,
+      TTI::OperandValueKind Opd2Info = TTI::OK_AnyValue,
+      TTI::OperandValueProperties Opd1PropInfo = TTI::OP_None,
+      TTI::OperandValueProperties Opd2PropInfo = TTI::OP_None,
+      ArrayRef<const Value *> Args = ArrayRef<const Value *>(),
+      const Instruction *CxtI = nullptr);
+  unsigned getIntrinsicInstrCost(const IntrinsicCostAttributes &ICA,
+                                 TTI::TargetCostKind CostKind);
+  unsigned getCastInstrCost(unsigned Opcode, Type *Dst, Type *Src,
+                            TTI::CastContextHint CCH,
+                            TTI::TargetCostKind CostKind,
+                            const Instruction *I = nullptr);
+  unsigned getMemoryOpCost(unsigned Opcode, Type *Src, MaybeAlign Alignment,
+                           unsigned AddressSpace,
+                           TTI::TargetCostKind CostKind,
+                           const Instruction *I = nullptr);
+  unsigned getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index);
+  unsigned getShuffleCost(TTI::ShuffleKind Kind, VectorType *Tp, int Index,
+                          VectorType *SubTp);
+  unsigned getArithmeticReductionCost(unsigned Opcode, VectorType *Ty,
+                                      bool IsPairwise,
+                                      TTI::TargetCostKind CostKind);
+  bool useReductionIntrinsic(unsigned Opcode, Type *Ty,
+                             TTI::ReductionFlags Flags) const;
+  bool shouldExpandReduction(const IntrinsicInst *II) const;
+
+  void getUnrollingPreferences(Loop *L, ScalarEvolution &SE,
+                               TTI::UnrollingPreferences &UP);
+  bool isHardwareLoopProfitable(Loop *L, ScalarEvolution &SE,
+                                AssumptionCache &AC,
+                                TargetLibraryInfo *LibInfo,
+                                HardwareLoopInfo &HWLoopInfo);
+
+private:
+  /// Return true if \p Ty is a scalable vector type of the V extension.
+  bool isRVVVectorType(Type *Ty) const;
+
+  /// Return the number of vector registers grouped by the legalized \p Ty,
+  /// the LMUL of its operations or 1 for the fractional ones.
+  unsigned getRVVLMUL(Type *Ty) const;
+
+  /// Return true if the packed smallfloat formats are available for
+  /// vectorization.
+  bool hasPackedFPVectors() const;
+
+  /// Return true if \p Ty is one of the packed smallfloat formats.
+  bool isPackedFPVectorType(Type *Ty) const;
+
+  /// Return true if \p Ty is a packed SIMD type of the PULP extension.
+  bool isPULPVectorType(Type *Ty) const;
+
+  /// Return the estimated code size of the blocks of \p L, or None if \p L
+  /// contains a call. Subloops are included unless \p SkipSubLoop is one.
+  Optional<unsigned> getLoopCodeSize(Loop *L, Loop *SkipSubLoop = nullptr);
+
+  /// Return true if PULPHardwareLoops will convert \p L, whose blocks have
+  /// size \p Size, into a hardware loop.
+  bool isPULPHardwareLoopCandidate(Loop *L, ScalarEvolution &SE,
+                                   unsigned Size) const;
+
+  /// Return true if \p I is a multiplication of two extended values which
+  /// becomes part of a pv.dotsp when vectorized by \p VF.
+  bool isDotProductMul(const Instruction *I, unsigned VF) const;
+
+  /// Return true if \p I is a multiplication of two extended halves which
+  /// becomes part of a vfdotpex.s.h when vectorized by \p VF.
+  bool isFDotProductMul(const Instruction *I, unsigned VF) const;
 };
 
 } // end namespace llvm
@@ -0,0 +1,400 @@
+//===-- SNITCHDMACopyIdiom.cpp - Turn copies into DMA transfers -----------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass moves memory copies from the core to the cluster DMA. It handles
+// the copies which loop idiom recognition leaves behind:
+//
+//  - Innermost loops which copy one row per iteration, either by a memcpy of
+//    loop-invariant size or by a load whose value is only stored, between two
+//    addresses which advance by a fixed stride:
+//
+//      for (i = 0; i < N; ++i)
+//        memcpy(dst + i * dstrd, src + i * sstrd, size);
+//
+//    The loop is replaced by a single 2D transfer of N rows, or by a 1D
+//    transfer if the rows are contiguous on both sides. Strided element
+//    copies, e.g. the extraction of a tile column, become 2D transfers of one
+//    element per row.
+//
+//  - Calls to llvm.memcpy of a constant size, which become 1D transfers.
+//
+// Every transfer is directly followed by a wait for its ID, which the DMA
+// wait sinking pass moves down to the first access depending on the copy.
+// Copies smaller than snitch-dma-copy-min-bytes are left to the core, since
+// programming the DMA costs a handful of instructions. A loop is only
+// replaced if
+//  - it consists of a single block with a computable backedge-taken count
+//    and does nothing but the copy, the address computation and the exit
+//    test,
+//  - the source and the destination are distinct objects, so that the order
+//    of the rows does not matter,
+//  - the destination rows do not overlap and the row size, the strides and
+//    the number of rows fit into the 32-bit fields of the DMA.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-dma-copy-idiom"
+#define SNITCH_DMA_COPY_IDIOM_NAME "Snitch DMA copy idiom recognition"
+
+static cl::opt<bool> EnableDMACopyIdiom(
+    "snitch-dma-copy-idiom", cl::init(false), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Perform copy loops and memcpy calls with the DMA"));
+
+static cl::opt<unsigned> DMACopyMinBytes(
+    "snitch-dma-copy-min-bytes", cl::init(64), cl::Hidden,
+    cl::desc("Minimum size in bytes of a copy performed with the DMA"));
+
+STATISTIC(NumDMACopyLoops, "Number of copy loops replaced by DMA transfers");
+STATISTIC(NumDMAMemCpys, "Number of memcpy calls replaced by DMA transfers");
+
+namespace {
+
+class SNITCHDMACopyIdiom : public FunctionPass {
+public:
+  static char ID;
+
+  SNITCHDMACopyIdiom() : FunctionPass(ID) {
+    initializeSNITCHDMACopyIdiomPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return SNITCH_DMA_COPY_IDIOM_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<AAResultsWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  AAResults *AA;
+
+  /// Try to replace the copy loop \p L by a single transfer.
+  bool convertLoop(Loop *L);
+
+  /// Find the copy of the single-block loop \p L. Returns the memcpy or the
+  /// store of the copy and sets \p Load for a load/store pair.
+  Instruction *findCopy(Loop *L, LoadInst *&Load) const;
+
+  /// Try to replace the memcpy \p MC by a 1D transfer.
+  bool convertMemCpy(MemCpyInst *MC);
+};
+
+} // end anonymous namespace
+
+char SNITCHDMACopyIdiom::ID = 0;
+
+/// Return the 64-bit DMA address of the pointer \p Ptr.
+static Value *createDMAAddress(IRBuilder<> &Builder, Value *Ptr,
+                               const DataLayout &DL) {
+  Value *Addr =
+      Builder.CreatePtrToInt(Ptr, DL.getIntPtrType(Ptr->getType()));
+  return Builder.CreateZExtOrTrunc(Addr, Builder.getInt64Ty());
+}
+
+/// Return the object the pointer expression \p S points into, if known.
+static const Value *getBaseObject(const SCEV *S, ScalarEvolution &SE) {
+  auto *Base = dyn_cast<SCEVUnknown>(SE.getPointerBase(S));
+  return Base ? getUnderlyingObject(Base->getValue()) : nullptr;
+}
+
+bool SNITCHDMACopyIdiom::runOnFunction(Function &F) {
+  if (!EnableDMACopyIdiom || skipFunction(F))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasExtXdma())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "--------- Snitch DMA Copy Idiom ---------\n");
+
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
+
+  SmallVector<Loop *, 8> Worklist;
+  for (Loop *TopLevel : *LI)
+    for (Loop *L : depth_first(TopLevel))
+      if (L->isInnermost())
+        Worklist.push_back(L);
+
+  bool Changed = false;
+  for (Loop *L : Worklist)
+    Changed |= convertLoop(L);
+
+  // The memcpys of the loops which could not be replaced as a whole still
+  // become transfers of their own.
+  SmallVector<MemCpyInst *, 8> MemCpys;
+  for (Instruction &I : instructions(F))
+    if (auto *MC = dyn_cast<MemCpyInst>(&I))
+      MemCpys.push_back(MC);
+  for (MemCpyInst *MC : MemCpys)
+    Changed |= convertMemCpy(MC);
+
+  return Changed;
+}
+
+Instruction *SNITCHDMACopyIdiom::findCopy(Loop *L, LoadInst *&Load) const {
+  Instruction *Copy = nullptr;
+  Load = nullptr;
+  for (Instruction &I : *L->getHeader()) {
+    // Nothing computed by the loop may survive it.
+    for (User *U : I.users())
+      if (!L->contains(cast<Instruction>(U)))
+        return nullptr;
+    if (isa<DbgInfoIntrinsic>(I))
+      continue;
+    if (auto *MC = dyn_cast<MemCpyInst>(&I)) {
+      if (Copy || MC->isVolatile())
+        return nullptr;
+      Copy = MC;
+      continue;
+    }
+    if (auto *SI = dyn_cast<StoreInst>(&I)) {
+      if (Copy || !SI->isSimple())
+        return nullptr;
+      Copy = SI;
+      continue;
+    }
+    if (auto *LdI = dyn_cast<LoadInst>(&I)) {
+      if (Load || !LdI->isSimple())
+        return nullptr;
+      Load = LdI;
+      continue;
+    }
+    if (I.mayHaveSideEffects() || I.mayReadFromMemory())
+      return nullptr;
+  }
+  if (!Copy)
+    return nullptr;
+
+  if (isa<MemCpyInst>(Copy))
+    return Load ? nullptr : Copy;
+  // The loaded value may only be stored.
+  auto *SI = cast<StoreInst>(Copy);
+  if (!Load || SI->getValueOperand() != Load || !Load->hasOneUse() ||
+      isa<ScalableVectorType>(Load->getType()))
+    return nullptr;
+  return Copy;
+}
+
+bool SNITCHDMACopyIdiom::convertLoop(Loop *L) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader || L->getNumBlocks() != 1 || !L->getUniqueExitBlock() ||
+      !L->hasDedicatedExits())
+    return false;
+  auto *PreheaderBr = dyn_cast<BranchInst>(Preheader->getTerminator());
+  if (!PreheaderBr || !PreheaderBr->isUnconditional())
+    return false;
+
+  LoadInst *Load;
+  Instruction *Copy = findCopy(L, Load);
+  if (!Copy)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Copy loop: " << *L);
+
+  const DataLayout &DL = Preheader->getModule()->getDataLayout();
+  Type *Int64Ty = Type::getInt64Ty(Preheader->getContext());
+  Type *Int32Ty = Type::getInt32Ty(Preheader->getContext());
+
+  Value *SrcPtr, *DstPtr;
+  const SCEV *Size;
+  if (auto *MC = dyn_cast<MemCpyInst>(Copy)) {
+    SrcPtr = MC->getRawSource();
+    DstPtr = MC->getRawDest();
+    Size = SE->getNoopOrZeroExtend(SE->getSCEV(MC->getLength()), Int64Ty);
+  } else {
+    SrcPtr = Load->getPointerOperand();
+    DstPtr = cast<StoreInst>(Copy)->getPointerOperand();
+    Size = SE->getConstant(Int64Ty,
+                           DL.getTypeStoreSize(Load->getType()).getFixedSize());
+  }
+
+  auto *SrcAR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(SrcPtr));
+  auto *DstAR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(DstPtr));
+  if (!SrcAR || !DstAR || SrcAR->getLoop() != L || DstAR->getLoop() != L ||
+      !SrcAR->isAffine() || !DstAR->isAffine()) {
+    LLVM_DEBUG(dbgs() << "  addresses are not strided\n");
+    return false;
+  }
+
+  // The rows are no longer copied in order.
+  const Value *SrcObj = getBaseObject(SrcAR, *SE);
+  const Value *DstObj = getBaseObject(DstAR, *SE);
+  if (!SrcObj || !DstObj ||
+      !AA->isNoAlias(MemoryLocation::getBeforeOrAfter(SrcObj),
+                     MemoryLocation::getBeforeOrAfter(DstObj))) {
+    LLVM_DEBUG(dbgs() << "  source and destination may alias\n");
+    return false;
+  }
+
+  const SCEV *BTC = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC) ||
+      SE->getUnsignedRangeMax(BTC).getLimitedValue() >= UINT32_MAX) {
+    LLVM_DEBUG(dbgs() << "  trip count is not computable or too large\n");
+    return false;
+  }
+  const SCEV *NReps = SE->getAddExpr(SE->getNoopOrZeroExtend(BTC, Int64Ty),
+                                     SE->getOne(Int64Ty));
+
+  const SCEV *SrcStride = SrcAR->getStepRecurrence(*SE);
+  const SCEV *DstStride = DstAR->getStepRecurrence(*SE);
+  if (!SE->isKnownNonNegative(SrcStride) ||
+      !SE->isKnownNonNegative(DstStride) ||
+      SE->getUnsignedRangeMax(SrcStride).getLimitedValue() > INT32_MAX ||
+      SE->getUnsignedRangeMax(DstStride).getLimitedValue() > INT32_MAX) {
+    LLVM_DEBUG(dbgs() << "  strides do not fit the DMA\n");
+    return false;
+  }
+  SrcStride = SE->getNoopOrZeroExtend(SrcStride, Int64Ty);
+  DstStride = SE->getNoopOrZeroExtend(DstStride, Int64Ty);
+
+  if (!SE->isLoopInvariant(Size, L) || !SE->isKnownNonZero(Size) ||
+      SE->getUnsignedRangeMax(Size).getLimitedValue() > UINT32_MAX ||
+      (!BTC->isZero() &&
+       !SE->isKnownPredicate(ICmpInst::ICMP_UGE, DstStride, Size))) {
+    LLVM_DEBUG(dbgs() << "  row size does not fit the DMA\n");
+    return false;
+  }
+
+  const SCEV *Total = SE->getMulExpr(Size, NReps);
+  if (SE->getUnsignedRangeMax(Total).getLimitedValue() < DMACopyMinBytes) {
+    LLVM_DEBUG(dbgs() << "  copy is too small\n");
+    return false;
+  }
+
+  // Contiguous rows are a single 1D transfer.
+  bool IsOneD = SrcStride == Size && DstStride == Size &&
+                SE->getUnsignedRangeMax(Total).getLimitedValue() <= UINT32_MAX;
+
+  Instruction *InsertPt = Preheader->getTerminator();
+  SmallVector<const SCEV *, 5> Operands;
+  if (IsOneD)
+    Operands = {Total};
+  else
+    Operands = {Size, SrcStride, DstStride, NReps};
+  if (!isSafeToExpandAt(SrcAR->getStart(), InsertPt, *SE) ||
+      !isSafeToExpandAt(DstAR->getStart(), InsertPt, *SE) ||
+      any_of(Operands, [&](const SCEV *S) {
+        return !isSafeToExpandAt(S, InsertPt, *SE);
+      })) {
+    LLVM_DEBUG(dbgs() << "  transfer can not be expanded in the preheader\n");
+    return false;
+  }
+
+  {
+    SCEVExpander Expander(*SE, DL, "dmacopy");
+    IRBuilder<> Builder(InsertPt);
+    SmallVector<Value *, 8> Ops;
+    Ops.push_back(createDMAAddress(
+        Builder, Expander.expandCodeFor(SrcAR->getStart(), nullptr, InsertPt),
+        DL));
+    Ops.push_back(createDMAAddress(
+        Builder, Expander.expandCodeFor(DstAR->getStart(), nullptr, InsertPt),
+        DL));
+    for (const SCEV *S : Operands)
+      Ops.push_back(Expander.expandCodeFor(SE->getTruncateOrNoop(S, Int32Ty),
+                                           Int32Ty, InsertPt));
+    Ops.push_back(Builder.getInt32(0));
+
+    Module *M = Preheader->getModule();
+    Function *StartFn = Intrinsic::getDeclaration(
+        M, IsOneD ? Intrinsic::riscv_sdma_start_oned
+                  : Intrinsic::riscv_sdma_start_twod);
+    Function *WaitFn = Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_wait);
+    Value *ID = Builder.CreateCall(StartFn, Ops, "dmacopy.id");
+    Builder.CreateCall(WaitFn, ID);
+  }
+
+  deleteDeadLoop(L, DT, SE, LI);
+  ++NumDMACopyLoops;
+  LLVM_DEBUG(dbgs() << "  replaced by a " << (IsOneD ? "1D" : "2D")
+                    << " transfer\n");
+  return true;
+}
+
+bool SNITCHDMACopyIdiom::convertMemCpy(MemCpyInst *MC) {
+  auto *Len = dyn_cast<ConstantInt>(MC->getLength());
+  if (MC->isVolatile() || !Len || Len->getLimitedValue() < DMACopyMinBytes ||
+      Len->getLimitedValue() > UINT32_MAX)
+    return false;
+
+  const DataLayout &DL = MC->getModule()->getDataLayout();
+  IRBuilder<> Builder(MC);
+  Value *Ops[] = {createDMAAddress(Builder, MC->getRawSource(), DL),
+                  createDMAAddress(Builder, MC->getRawDest(), DL),
+                  Builder.getInt32(Len->getZExtValue()), Builder.getInt32(0)};
+  Module *M = MC->getModule();
+  Function *StartFn =
+      Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_start_oned);
+  Function *WaitFn = Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_wait);
+  Value *ID = Builder.CreateCall(StartFn, Ops, "dmacopy.id");
+  Builder.CreateCall(WaitFn, ID);
+
+  LLVM_DEBUG(dbgs() << "memcpy of " << Len->getZExtValue()
+                    << " bytes replaced by a 1D transfer\n");
+  MC->eraseFromParent();
+  ++NumDMAMemCpys;
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHDMACopyIdiom, DEBUG_TYPE,
+                      SNITCH_DMA_COPY_IDIOM_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_END(SNITCHDMACopyIdiom, DEBUG_TYPE,
+                    SNITCH_DMA_COPY_IDIOM_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHDMACopyIdiomPass() {
+    return new SNITCHDMACopyIdiom();
+  }
+} // end of namespace llvm
@@ -0,0 +1,506 @@
+//===-- SNITCHDMADoubleBuffer.cpp - Double-buffer DMA transfers in loops --===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass overlaps the DMA transfers of tiled loops with the computation.
+// It looks for loops which fetch one tile per iteration into a scratch buffer
+// and immediately wait for it:
+//
+//   for (t = 0; t < T; ++t) {
+//     __builtin_sdma_start_twod(src(t), buf, ...);
+//     __builtin_sdma_wait_for_idle();
+//     compute(buf);
+//   }
+//
+// The scratch buffer is duplicated and the loop is rewritten to ping-pong
+// between both copies. The first tile is fetched in the preheader, every
+// iteration then waits for its own tile and issues the transfer of the next
+// tile into the other buffer before computing:
+//
+//   start(src(0), buf0);
+//   for (t = 0, cur = buf0, nxt = buf1; t < T; ++t, swap(cur, nxt)) {
+//     __builtin_sdma_wait_for_idle();
+//     if (t + 1 < T)
+//       start(src(t + 1), nxt);
+//     compute(cur);
+//   }
+//
+// The arguments of the transfer for the next tile are derived from their
+// scalar evolution. Static stack allocations are taken as scratch buffers
+// since the Snitch stack resides in the TCDM. A loop is only transformed if
+//  - it is in loop-simplify form and its backedge-taken count is computable,
+//  - it issues exactly one transfer per iteration, directly followed by the
+//    only wait of the loop, and no other DMA instruction or call,
+//  - the buffer is only accessed after the wait and not used after the loop,
+//  - no write in the loop may alias the source of the transfers, which are
+//    now read one iteration earlier.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+#include <functional>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-dma-double-buffer"
+#define SNITCH_DMA_DOUBLE_BUFFER_NAME "Snitch DMA double buffering"
+
+static cl::opt<bool> EnableDMADoubleBuffer(
+    "snitch-dma-double-buffer", cl::init(false), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Overlap the DMA transfers of tiled loops with the computation"));
+
+STATISTIC(NumDMADoubleBuffered, "Number of loops with double-buffered DMA");
+
+namespace {
+
+/// Rewrites the add recurrences of a loop to their value in the first
+/// iteration or in the next iteration.
+class SCEVIterationRewriter
+    : public SCEVRewriteVisitor<SCEVIterationRewriter> {
+  const Loop *L;
+  bool Next;
+
+public:
+  SCEVIterationRewriter(const Loop *L, bool Next, ScalarEvolution &SE)
+      : SCEVRewriteVisitor(SE), L(L), Next(Next) {}
+
+  static const SCEV *rewrite(const SCEV *S, const Loop *L, bool Next,
+                             ScalarEvolution &SE) {
+    SCEVIterationRewriter Rewriter(L, Next, SE);
+    return Rewriter.visit(S);
+  }
+
+  const SCEV *visitAddRecExpr(const SCEVAddRecExpr *Expr) {
+    if (Expr->getLoop() != L)
+      return Expr;
+    return Next ? Expr->getPostIncExpr(SE) : Expr->getStart();
+  }
+};
+
+class SNITCHDMADoubleBuffer : public FunctionPass {
+public:
+  static char ID;
+
+  SNITCHDMADoubleBuffer() : FunctionPass(ID) {
+    initializeSNITCHDMADoubleBufferPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_DMA_DOUBLE_BUFFER_NAME;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<AAResultsWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  AAResults *AA;
+
+  /// Try to double-buffer the transfer of the tile loop \p L.
+  bool convertToDoubleBuffer(Loop *L);
+
+  /// Find the single transfer of \p L and the wait following it.
+  bool findTransfer(Loop *L, IntrinsicInst *&Start, IntrinsicInst *&Wait) const;
+
+  /// Return the scratch buffer the destination \p Dst of a transfer points to
+  /// and collect the casts leading to it in \p Chain.
+  AllocaInst *getScratchBuffer(Value *Dst,
+                               SmallVectorImpl<Instruction *> &Chain) const;
+
+  /// Collect the uses of \p Buf in \p L which have to be rebased onto the
+  /// current buffer. Returns false if the buffer is accessed before \p Wait
+  /// or after the loop.
+  bool collectBufferUses(Loop *L, AllocaInst *Buf, IntrinsicInst *Wait,
+                         ArrayRef<Instruction *> Chain,
+                         SmallVectorImpl<Use *> &Uses,
+                         SmallVectorImpl<Instruction *> &Lifetimes) const;
+
+  /// Return true if no write of \p L may alias the source of \p Start.
+  bool isSourceReadOnly(Loop *L, IntrinsicInst *Start, AllocaInst *Buf) const;
+};
+
+} // end anonymous namespace
+
+char SNITCHDMADoubleBuffer::ID = 0;
+
+static bool isDMAIntrinsic(const Instruction &I) {
+  const auto *II = dyn_cast<IntrinsicInst>(&I);
+  if (!II)
+    return false;
+  switch (II->getIntrinsicID()) {
+  case Intrinsic::riscv_sdma_start_oned:
+  case Intrinsic::riscv_sdma_start_twod:
+  case Intrinsic::riscv_sdma_start_threed:
+  case Intrinsic::riscv_sdma_stat:
+  case Intrinsic::riscv_sdma_wait_for_idle:
+  case Intrinsic::riscv_sdma_wait:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool SNITCHDMADoubleBuffer::runOnFunction(Function &F) {
+  if (!EnableDMADoubleBuffer || skipFunction(F))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasExtXdma())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "--------- Snitch DMA Double Buffering ---------\n");
+
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
+
+  SmallVector<Loop *, 8> Worklist;
+  for (Loop *TopLevel : *LI)
+    for (Loop *L : depth_first(TopLevel))
+      Worklist.push_back(L);
+
+  bool Changed = false;
+  for (Loop *L : Worklist)
+    Changed |= convertToDoubleBuffer(L);
+
+  return Changed;
+}
+
+bool SNITCHDMADoubleBuffer::findTransfer(Loop *L, IntrinsicInst *&Start,
+                                         IntrinsicInst *&Wait) const {
+  Start = Wait = nullptr;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (isDMAIntrinsic(I)) {
+        auto *II = cast<IntrinsicInst>(&I);
+        switch (II->getIntrinsicID()) {
+        case Intrinsic::riscv_sdma_start_oned:
+        case Intrinsic::riscv_sdma_start_twod:
+          if (Start)
+            return false;
+          Start = II;
+          break;
+        case Intrinsic::riscv_sdma_wait_for_idle:
+          if (Wait)
+            return false;
+          Wait = II;
+          break;
+        default:
+          return false;
+        }
+        continue;
+      }
+      // Anything which is not an intrinsic might use the DMA by itself.
+      if (isa<CallBase>(I) && !isa<IntrinsicInst>(I))
+        return false;
+    }
+  if (!Start || !Wait || !Start->use_empty())
+    return false;
+
+  // The transfer has to be issued once per iteration of L.
+  BasicBlock *BB = Start->getParent();
+  if (LI->getLoopFor(BB) != L || !DT->dominates(BB, L->getLoopLatch()))
+    return false;
+
+  // The wait has to follow the transfer, nothing may touch memory in between.
+  if (Wait->getParent() != BB)
+    return false;
+  for (auto I = std::next(Start->getIterator()); &*I != Wait; ++I)
+    if (I == BB->end() || I->mayReadOrWriteMemory())
+      return false;
+  return true;
+}
+
+AllocaInst *SNITCHDMADoubleBuffer::getScratchBuffer(
+    Value *Dst, SmallVectorImpl<Instruction *> &Chain) const {
+  Value *V = Dst;
+  while (auto *Cast = dyn_cast<CastInst>(V)) {
+    if (!isa<ZExtInst>(Cast) && !isa<PtrToIntInst>(Cast) &&
+        !isa<BitCastInst>(Cast))
+      return nullptr;
+    if (!Cast->hasOneUse())
+      return nullptr;
+    Chain.push_back(Cast);
+    V = Cast->getOperand(0);
+  }
+  auto *Buf = dyn_cast<AllocaInst>(V);
+  if (!Buf || !Buf->isStaticAlloca() || Chain.empty())
+    return nullptr;
+  return Buf;
+}
+
+bool SNITCHDMADoubleBuffer::collectBufferUses(
+    Loop *L, AllocaInst *Buf, IntrinsicInst *Wait,
+    ArrayRef<Instruction *> Chain, SmallVectorImpl<Use *> &Uses,
+    SmallVectorImpl<Instruction *> &Lifetimes) const {
+  SmallVector<Value *, 8> Worklist;
+  Worklist.push_back(Buf);
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (Use &U : V->uses()) {
+      auto *I = cast<Instruction>(U.getUser());
+      if (is_contained(Chain, I) || isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (I->isLifetimeStartOrEnd()) {
+        Lifetimes.push_back(I);
+        continue;
+      }
+      if (L->contains(I)) {
+        // In the loop, the buffer holds the current tile only after the wait.
+        if (!DT->dominates(Wait, U))
+          return false;
+        Uses.push_back(&U);
+        continue;
+      }
+      // Address computations hoisted out of the loop are followed to their
+      // uses, anything else outside the loop sees the wrong buffer.
+      if (!isa<GetElementPtrInst>(I) && !isa<BitCastInst>(I))
+        return false;
+      Worklist.push_back(I);
+    }
+  }
+  return true;
+}
+
+bool SNITCHDMADoubleBuffer::isSourceReadOnly(Loop *L, IntrinsicInst *Start,
+                                             AllocaInst *Buf) const {
+  // Recover the pointer the 64-bit source address was derived from.
+  Value *Src = Start->getArgOperand(0);
+  while (isa<ZExtInst>(Src) || isa<PtrToIntInst>(Src))
+    Src = cast<CastInst>(Src)->getOperand(0);
+  const Value *SrcObj =
+      Src->getType()->isPointerTy() ? getUnderlyingObject(Src) : nullptr;
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (!I.mayWriteToMemory() || isDMAIntrinsic(I))
+        continue;
+      if (isa<IntrinsicInst>(I) && !isa<MemIntrinsic>(I))
+        continue;
+      Optional<MemoryLocation> Loc = MemoryLocation::getOrNone(&I);
+      if (!Loc)
+        return false;
+      if (getUnderlyingObject(Loc->Ptr) == Buf)
+        continue;
+      if (!SrcObj || !AA->isNoAlias(MemoryLocation::getBeforeOrAfter(SrcObj),
+                                    *Loc))
+        return false;
+    }
+  return true;
+}
+
+bool SNITCHDMADoubleBuffer::convertToDoubleBuffer(Loop *L) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Preheader || !Latch || !L->hasDedicatedExits())
+    return false;
+
+  IntrinsicInst *Start, *Wait;
+  if (!findTransfer(L, Start, Wait))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Tile loop: " << *L);
+
+  SmallVector<Instruction *, 4> Chain;
+  AllocaInst *Buf = getScratchBuffer(Start->getArgOperand(1), Chain);
+  if (!Buf) {
+    LLVM_DEBUG(dbgs() << "  destination is not a scratch buffer\n");
+    return false;
+  }
+
+  SmallVector<Use *, 16> Uses;
+  SmallVector<Instruction *, 4> Lifetimes;
+  if (!collectBufferUses(L, Buf, Wait, Chain, Uses, Lifetimes)) {
+    LLVM_DEBUG(dbgs() << "  buffer is live outside of the tile\n");
+    return false;
+  }
+
+  if (!isSourceReadOnly(L, Start, Buf)) {
+    LLVM_DEBUG(dbgs() << "  source may be written by the loop\n");
+    return false;
+  }
+
+  const SCEV *BTC = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC) ||
+      !isSafeToExpandAt(BTC, Preheader->getTerminator(), *SE)) {
+    LLVM_DEBUG(dbgs() << "  trip count is not computable\n");
+    return false;
+  }
+
+  // Describe the transfer of the first and of the next tile. The destination
+  // is replaced by the buffers.
+  SmallVector<const SCEV *, 8> FirstArgs, NextArgs;
+  for (unsigned I = 0, E = Start->getNumArgOperands(); I != E; ++I) {
+    if (I == 1) {
+      FirstArgs.push_back(nullptr);
+      NextArgs.push_back(nullptr);
+      continue;
+    }
+    Value *Arg = Start->getArgOperand(I);
+    if (!SE->isSCEVable(Arg->getType()))
+      return false;
+    const SCEV *S = SE->getSCEV(Arg);
+    const SCEV *First = SCEVIterationRewriter::rewrite(S, L, false, *SE);
+    const SCEV *Next = SCEVIterationRewriter::rewrite(S, L, true, *SE);
+    if (!SE->isLoopInvariant(First, L) ||
+        !isSafeToExpandAt(First, Preheader->getTerminator(), *SE) ||
+        !isSafeToExpandAt(Next, Start, *SE)) {
+      LLVM_DEBUG(dbgs() << "  argument " << I << " is not affine: " << *S
+                        << "\n");
+      return false;
+    }
+    FirstArgs.push_back(First);
+    NextArgs.push_back(Next);
+  }
+
+  const DataLayout &DL = Buf->getModule()->getDataLayout();
+  SCEVExpander Expander(*SE, DL, "dmabuf");
+  Value *Dst = Start->getArgOperand(1);
+
+  // Clone the transfer with the given arguments and destination buffer.
+  auto emitTransfer = [&](ArrayRef<const SCEV *> Args, Value *Buffer,
+                          Instruction *InsertPt) {
+    IRBuilder<> Builder(InsertPt);
+    SmallVector<Value *, 8> Ops;
+    for (unsigned I = 0, E = Args.size(); I != E; ++I) {
+      Type *Ty = Start->getArgOperand(I)->getType();
+      if (I == 1)
+        Ops.push_back(Builder.CreateZExtOrTrunc(
+            Builder.CreatePtrToInt(Buffer, DL.getIntPtrType(Buffer->getType())),
+            Dst->getType()));
+      else
+        Ops.push_back(Expander.expandCodeFor(Args[I], Ty, InsertPt));
+    }
+    return Builder.CreateCall(Start->getCalledFunction(), Ops);
+  };
+
+  // Second buffer next to the original one.
+  auto *Buf2 = new AllocaInst(Buf->getAllocatedType(),
+                              Buf->getType()->getAddressSpace(),
+                              Buf->getArraySize(), Buf->getAlign(),
+                              Buf->getName() + ".pingpong");
+  Buf2->insertAfter(Buf);
+
+  // The lifetimes of the buffers now span the whole loop.
+  for (Instruction *I : Lifetimes)
+    I->eraseFromParent();
+
+  // Fetch the first tile in the preheader.
+  emitTransfer(FirstArgs, Buf, Preheader->getTerminator());
+
+  // Swap the buffers every iteration.
+  BasicBlock *Header = L->getHeader();
+  IRBuilder<> Builder(&Header->front());
+  PHINode *Cur = Builder.CreatePHI(Buf->getType(), 2, "dmabuf.cur");
+  PHINode *Nxt = Builder.CreatePHI(Buf->getType(), 2, "dmabuf.next");
+  Cur->addIncoming(Buf, Preheader);
+  Cur->addIncoming(Nxt, Latch);
+  Nxt->addIncoming(Buf2, Preheader);
+  Nxt->addIncoming(Cur, Latch);
+
+  // Rebase the accesses of the tile. Address computations which were hoisted
+  // out of the loop are rematerialized on the current buffer.
+  DenseMap<Value *, Value *> Rebased;
+  Rebased[Buf] = Cur;
+  Instruction *RebasePt = &*Header->getFirstInsertionPt();
+  std::function<Value *(Value *)> rebase = [&](Value *V) -> Value * {
+    auto It = Rebased.find(V);
+    if (It != Rebased.end())
+      return It->second;
+    auto *I = cast<Instruction>(V);
+    Value *Base = rebase(I->getOperand(0));
+    Instruction *Clone = I->clone();
+    Clone->setOperand(0, Base);
+    Clone->insertBefore(RebasePt);
+    Clone->setName(I->getName() + ".cur");
+    return Rebased[V] = Clone;
+  };
+  for (Use *U : Uses)
+    U->set(rebase(U->get()));
+
+  // Wait for the current tile and fetch the next one, unless this is the last
+  // iteration.
+  Builder.SetInsertPoint(Start);
+  Builder.CreateCall(Wait->getCalledFunction());
+  Type *CountTy = BTC->getType();
+  const SCEV *Iteration = SE->getAddRecExpr(
+      SE->getZero(CountTy), SE->getOne(CountTy), L, SCEV::FlagNUW);
+  Value *IterationV = Expander.expandCodeFor(Iteration, CountTy, Start);
+  Value *BTCV =
+      Expander.expandCodeFor(BTC, CountTy, Preheader->getTerminator());
+  Value *HasNext = Builder.CreateICmpNE(IterationV, BTCV, "dmabuf.hasnext");
+  Instruction *Then =
+      SplitBlockAndInsertIfThen(HasNext, Start, false, nullptr, DT, LI);
+  emitTransfer(NextArgs, Nxt, Then);
+
+  Wait->eraseFromParent();
+  Start->eraseFromParent();
+  // The casts of the destination are ordered from the transfer upwards.
+  for (Instruction *I : Chain)
+    if (I->use_empty())
+      I->eraseFromParent();
+
+  SE->forgetLoop(L);
+  ++NumDMADoubleBuffered;
+  LLVM_DEBUG(dbgs() << "  double-buffered " << *Buf << "\n");
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHDMADoubleBuffer, DEBUG_TYPE,
+                      SNITCH_DMA_DOUBLE_BUFFER_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_END(SNITCHDMADoubleBuffer, DEBUG_TYPE,
+                    SNITCH_DMA_DOUBLE_BUFFER_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHDMADoubleBufferPass() {
+    return new SNITCHDMADoubleBuffer();
+  }
+} // end of namespace llvm
@@ -0,0 +1,279 @@
+//===-- SNITCHDMAWaitSinking.cpp - Sink DMA waits to the first use --------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass moves waits for a single DMA transfer (PseudoSDMAWait) down to
+// the first instruction which depends on the completion of the transfer, so
+// that the transfer overlaps with independent computation. An instruction
+// depends on the transfer if it accesses the destination buffer, writes to
+// the source buffer or has side effects which are not modeled, e.g. calls and
+// other DMA instructions.
+//
+// The buffers are recovered from the address operands of the start pseudo
+// defining the transfer ID. Stack objects and globals are identified, memory
+// accesses are disambiguated through their memory operands. If a buffer is
+// not known, every access which could touch it is a barrier.
+//
+// Waits are sunk within their block and into straight-line successors which
+// have no other predecessor. The pass runs on SSA form, before the DMA
+// pseudos are expanded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVInstrInfo.h"
+#include "../RISCVSubtarget.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineMemOperand.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/PseudoSourceValue.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-dma-wait-sinking"
+#define SNITCH_DMA_WAIT_SINKING_NAME "Snitch DMA wait sinking"
+
+static cl::opt<bool> DisableDMAWaitSinking(
+    "snitch-dma-wait-sinking-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not sink DMA waits to the first use of the transfer"));
+
+STATISTIC(NumWaitsSunk, "Number of DMA waits sunk");
+
+namespace {
+
+/// The memory object a DMA address points into. Either an IR object (alloca,
+/// global, noalias argument) or a stack object without IR counterpart.
+struct DMAObject {
+  const Value *V = nullptr;
+  int FI = 0;
+  bool IsFI = false;
+
+  bool isKnown() const { return V || IsFI; }
+};
+
+class SNITCHDMAWaitSinking : public MachineFunctionPass {
+public:
+  static char ID;
+
+  SNITCHDMAWaitSinking() : MachineFunctionPass(ID) {
+    initializeSNITCHDMAWaitSinkingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_DMA_WAIT_SINKING_NAME;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  MachineRegisterInfo *MRI;
+  const MachineFrameInfo *MFI;
+
+  /// Sink the wait \p Wait, returns true if it was moved.
+  bool sinkWait(MachineInstr &Wait);
+
+  /// Return the object the address in \p Reg points into.
+  DMAObject getAddressObject(Register Reg) const;
+
+  /// Return the object accessed by the memory operand \p MMO.
+  DMAObject getAccessedObject(const MachineMemOperand &MMO) const;
+
+  /// Return true if \p MI has to observe the completion of a transfer from
+  /// \p Src to \p Dst.
+  bool dependsOnTransfer(const MachineInstr &MI, const DMAObject &Src,
+                         const DMAObject &Dst) const;
+};
+
+} // end anonymous namespace
+
+char SNITCHDMAWaitSinking::ID = 0;
+
+static bool mayAlias(const DMAObject &A, const DMAObject &B) {
+  if (!A.isKnown() || !B.isKnown())
+    return true;
+  if (A.IsFI && B.IsFI)
+    return A.FI == B.FI;
+  if (A.V && B.V)
+    return A.V == B.V;
+  // Stack objects without an alloca may still back a byval argument.
+  const Value *V = A.V ? A.V : B.V;
+  return !isa<AllocaInst>(V) && !isa<GlobalValue>(V);
+}
+
+bool SNITCHDMAWaitSinking::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableDMAWaitSinking || skipFunction(MF.getFunction()))
+    return false;
+  if (!MF.getSubtarget<RISCVSubtarget>().hasExtXdma())
+    return false;
+
+  MRI = &MF.getRegInfo();
+  MFI = &MF.getFrameInfo();
+
+  SmallVector<MachineInstr *, 8> Waits;
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB)
+      if (MI.getOpcode() == RISCV::PseudoSDMAWait)
+        Waits.push_back(&MI);
+
+  bool Changed = false;
+  // Waits are barriers to each other, sink the later ones first to make room
+  // for the earlier ones.
+  for (MachineInstr *Wait : reverse(Waits))
+    Changed |= sinkWait(*Wait);
+  return Changed;
+}
+
+DMAObject SNITCHDMAWaitSinking::getAddressObject(Register Reg) const {
+  DMAObject Obj;
+  while (Reg.isVirtual()) {
+    const MachineInstr *MI = MRI->getVRegDef(Reg);
+    if (!MI)
+      break;
+    if (MI->isCopy()) {
+      Reg = MI->getOperand(1).getReg();
+      continue;
+    }
+    if (MI->getOpcode() == RISCV::ADDI) {
+      const MachineOperand &Base = MI->getOperand(1);
+      const MachineOperand &Off = MI->getOperand(2);
+      if (Base.isFI()) {
+        Obj.FI = Base.getIndex();
+        Obj.IsFI = true;
+        if (const AllocaInst *AI = MFI->getObjectAllocation(Obj.FI)) {
+          Obj.V = AI;
+          Obj.IsFI = false;
+        }
+      } else if (Off.isGlobal()) {
+        Obj.V = Off.getGlobal();
+      }
+      break;
+    }
+    if (MI->getOpcode() == RISCV::PseudoLLA && MI->getOperand(1).isGlobal())
+      Obj.V = MI->getOperand(1).getGlobal();
+    break;
+  }
+  return Obj;
+}
+
+DMAObject SNITCHDMAWaitSinking::getAccessedObject(
+    const MachineMemOperand &MMO) const {
+  DMAObject Obj;
+  if (const Value *V = MMO.getValue()) {
+    const Value *UO = getUnderlyingObject(V);
+    if (isIdentifiedObject(UO))
+      Obj.V = UO;
+    return Obj;
+  }
+  if (const auto *FS =
+          dyn_cast_or_null<FixedStackPseudoSourceValue>(MMO.getPseudoValue())) {
+    Obj.FI = FS->getFrameIndex();
+    Obj.IsFI = true;
+  }
+  return Obj;
+}
+
+bool SNITCHDMAWaitSinking::dependsOnTransfer(const MachineInstr &MI,
+                                             const DMAObject &Src,
+                                             const DMAObject &Dst) const {
+  if (MI.isCall() || MI.hasUnmodeledSideEffects() || MI.hasOrderedMemoryRef())
+    return true;
+  if (!MI.mayLoadOrStore())
+    return false;
+  if (MI.memoperands_empty())
+    return true;
+  for (const MachineMemOperand *MMO : MI.memoperands()) {
+    DMAObject Obj = getAccessedObject(*MMO);
+    if (mayAlias(Obj, Dst))
+      return true;
+    if (MMO->isStore() && mayAlias(Obj, Src))
+      return true;
+  }
+  return false;
+}
+
+bool SNITCHDMAWaitSinking::sinkWait(MachineInstr &Wait) {
+  Register TID = Wait.getOperand(0).getReg();
+
+  // Recover the buffers of the transfer, unknown if the ID does not come from
+  // a start pseudo directly.
+  DMAObject Src, Dst;
+  Register Reg = TID;
+  while (Reg.isVirtual()) {
+    const MachineInstr *Def = MRI->getVRegDef(Reg);
+    if (Def && Def->isCopy()) {
+      Reg = Def->getOperand(1).getReg();
+      continue;
+    }
+    if (Def && (Def->getOpcode() == RISCV::PseudoSDMAOned ||
+                Def->getOpcode() == RISCV::PseudoSDMATwod ||
+                Def->getOpcode() == RISCV::PseudoSDMAThreed)) {
+      // Operands: tid, src hi, src lo, dst hi, dst lo, ...
+      Src = getAddressObject(Def->getOperand(2).getReg());
+      Dst = getAddressObject(Def->getOperand(4).getReg());
+    }
+    break;
+  }
+
+  LLVM_DEBUG(dbgs() << "Sinking " << Wait);
+
+  MachineBasicBlock *MBB = Wait.getParent();
+  MachineBasicBlock::iterator InsertPt = std::next(Wait.getIterator());
+  while (true) {
+    MachineBasicBlock::iterator E = MBB->getFirstTerminator();
+    while (InsertPt != E && !dependsOnTransfer(*InsertPt, Src, Dst))
+      ++InsertPt;
+    if (InsertPt != E)
+      break;
+    // Continue in a straight-line successor.
+    if (MBB->succ_size() != 1)
+      break;
+    MachineBasicBlock *Succ = *MBB->succ_begin();
+    if (Succ->pred_size() != 1 || Succ->isEHPad() ||
+        Succ == Wait.getParent())
+      break;
+    MBB = Succ;
+    InsertPt = MBB->getFirstNonPHI();
+  }
+
+  if (InsertPt == std::next(Wait.getIterator()))
+    return false;
+
+  Wait.removeFromParent();
+  MBB->insert(InsertPt, &Wait);
+  // The ID now lives until the new position of the wait.
+  MRI->clearKillFlags(TID);
+  LLVM_DEBUG(dbgs() << "  into " << printMBBReference(*MBB) << "\n");
+  ++NumWaitsSunk;
+  return true;
+}
+
+INITIALIZE_PASS(SNITCHDMAWaitSinking, DEBUG_TYPE, SNITCH_DMA_WAIT_SINKING_NAME,
+                false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHDMAWaitSinkingPass() {
+    return new SNITCHDMAWaitSinking();
+  }
+} // end of namespace llvm
@@ -0,0 +1,356 @@
+//===-- SNITCHFDotProduct.cpp - Form expanding FP dot products ------------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass turns mixed precision multiply-add reductions, products of halves
+// summed in single precision, into the expanding dot product vfdotpex.s.h of
+// the Xfexpauxvechalf extension. Without it every product is extended
+// separately and the <4 x float> operations are split. A dot product is a
+// multiplication of two extended <4 x half> vectors, or of a multiple of four
+// lanes:
+//
+//   %a.ext = fpext <4 x half> %a to <4 x float>
+//   %b.ext = fpext <4 x half> %b to <4 x float>
+//   %m = fmul <4 x float> %a.ext, %b.ext
+//
+// vfdotpex.s.h adds the products of two neighbouring lanes into one lane of a
+// <2 x float> accumulator, which is only valid if the sum may be reassociated.
+// Two forms of reductions are recognized. A horizontal add of a dot product,
+// as produced by the SLP vectorizer:
+//
+//   %r = call reassoc float @llvm.vector.reduce.fadd.v4f32(float %s, <4 x float> %m)
+//
+// becomes a vfdotpex.s.h into a zero accumulator followed by the reduction of
+// its two lanes. A vector accumulator, as produced by the loop vectorizer:
+//
+//   loop:
+//     %acc = phi <4 x float> [ %start, %ph ], [ %acc.next, %loop ]
+//     %acc.next = fadd reassoc <4 x float> %acc, %m
+//   exit:
+//     %r = call reassoc float @llvm.vector.reduce.fadd.v4f32(float %s, <4 x float> %acc.next)
+//
+// is replaced by a <2 x float> accumulator updated with vfdotpex.s.h in every
+// iteration and reduced after the loop.
+//
+// The scalar expanding operations, fmulex.s.h and fmacex.s.h, are exact and
+// selected by instruction patterns.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/IR/PatternMatch.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+using namespace llvm::PatternMatch;
+
+#define DEBUG_TYPE "snitch-fdotp"
+#define SNITCH_FDOTP_NAME "Snitch expanding dot product formation"
+
+static cl::opt<bool> DisableFDotProduct(
+    "snitch-fdotp-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not form expanding dot products from mixed precision "
+             "reductions"));
+
+STATISTIC(NumDotProducts, "Number of expanding dot products formed");
+STATISTIC(NumAccumulators, "Number of vector accumulators narrowed");
+
+namespace {
+
+/// The extended operands of a dot product.
+struct FDotProduct {
+  Value *A = nullptr;
+  Value *B = nullptr;
+  Value *Mul = nullptr;
+};
+
+class SNITCHFDotProduct : public FunctionPass {
+public:
+  static char ID;
+
+  SNITCHFDotProduct() : FunctionPass(ID) {
+    initializeSNITCHFDotProductPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return SNITCH_FDOTP_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.setPreservesCFG();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  /// Replace a horizontal add of a dot product, returns true on success.
+  bool convertReduction(IntrinsicInst *Red);
+
+  /// Replace the vector accumulator \p Phi by a <2 x float> one, returns true
+  /// on success.
+  bool convertAccumulator(PHINode *Phi);
+
+  /// Accumulate the dot product \p DP into the <2 x float> \p Acc, four lanes
+  /// at a time.
+  Value *createDotProduct(IRBuilder<> &Builder, const FDotProduct &DP,
+                          Value *Acc) const;
+};
+
+} // end anonymous namespace
+
+char SNITCHFDotProduct::ID = 0;
+
+/// Match a multiplication of two extended vectors of halves.
+static bool matchFDotProduct(Value *V, FDotProduct &DP) {
+  auto *Mul = dyn_cast<BinaryOperator>(V);
+  if (!Mul || Mul->getOpcode() != Instruction::FMul)
+    return false;
+  auto *Ty = dyn_cast<FixedVectorType>(Mul->getType());
+  if (!Ty || !Ty->getElementType()->isFloatTy() ||
+      Ty->getNumElements() % 4 != 0)
+    return false;
+
+  Value *Ops[2];
+  for (unsigned i = 0; i < 2; ++i)
+    if (!match(Mul->getOperand(i), m_FPExt(m_Value(Ops[i]))) ||
+        !Ops[i]->getType()->getScalarType()->isHalfTy())
+      return false;
+
+  DP.A = Ops[0];
+  DP.B = Ops[1];
+  DP.Mul = Mul;
+  return true;
+}
+
+/// Return true if \p V is a reassociable add reduction.
+static bool isFAddReduction(const Value *V) {
+  const auto *II = dyn_cast<IntrinsicInst>(V);
+  return II && II->getIntrinsicID() == Intrinsic::vector_reduce_fadd &&
+         II->hasAllowReassoc();
+}
+
+/// Return true if \p V is a reassociable fadd.
+static bool isReassocFAdd(const Value *V) {
+  const auto *BO = dyn_cast<BinaryOperator>(V);
+  return BO && BO->getOpcode() == Instruction::FAdd && BO->hasAllowReassoc();
+}
+
+bool SNITCHFDotProduct::runOnFunction(Function &F) {
+  if (DisableFDotProduct || skipFunction(F))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasPackedExpandingDotProduct())
+    return false;
+
+  SmallVector<PHINode *, 4> Phis;
+  for (BasicBlock &BB : F)
+    for (PHINode &Phi : BB.phis())
+      if (Phi.getType()->isVectorTy())
+        Phis.push_back(&Phi);
+
+  bool Changed = false;
+  for (PHINode *Phi : Phis)
+    Changed |= convertAccumulator(Phi);
+
+  // Narrowed accumulators have already replaced the reductions after their
+  // loops, collect the remaining ones.
+  SmallVector<IntrinsicInst *, 8> Reductions;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (isFAddReduction(&I))
+        Reductions.push_back(cast<IntrinsicInst>(&I));
+  for (IntrinsicInst *Red : Reductions)
+    Changed |= convertReduction(Red);
+  return Changed;
+}
+
+Value *SNITCHFDotProduct::createDotProduct(IRBuilder<> &Builder,
+                                           const FDotProduct &DP,
+                                           Value *Acc) const {
+  unsigned NumElts = cast<FixedVectorType>(DP.A->getType())->getNumElements();
+  for (unsigned Lo = 0; Lo < NumElts; Lo += 4) {
+    Value *A = DP.A, *B = DP.B;
+    if (NumElts != 4) {
+      int Mask[] = {int(Lo), int(Lo + 1), int(Lo + 2), int(Lo + 3)};
+      A = Builder.CreateShuffleVector(DP.A, Mask);
+      B = Builder.CreateShuffleVector(DP.B, Mask);
+    }
+    Acc = Builder.CreateIntrinsic(Intrinsic::riscv_vfdotpex_s_h, {},
+                                  {Acc, A, B});
+    ++NumDotProducts;
+  }
+  return Acc;
+}
+
+bool SNITCHFDotProduct::convertReduction(IntrinsicInst *Red) {
+  FDotProduct DP;
+  if (!matchFDotProduct(Red->getArgOperand(1), DP))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Expanding dot product reduction " << *Red << "\n");
+
+  IRBuilder<> Builder(Red);
+  Builder.setFastMathFlags(Red->getFastMathFlags());
+  auto *AccTy = FixedVectorType::get(Builder.getFloatTy(), 2);
+  Value *Dot =
+      createDotProduct(Builder, DP, ConstantAggregateZero::get(AccTy));
+  Value *Sum = Builder.CreateFAddReduce(Red->getArgOperand(0), Dot);
+  Red->replaceAllUsesWith(Sum);
+  Value *Mul = Red->getArgOperand(1);
+  Red->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructions(Mul);
+  return true;
+}
+
+bool SNITCHFDotProduct::convertAccumulator(PHINode *Phi) {
+  if (Phi->getNumIncomingValues() != 2 || !Phi->hasOneUse())
+    return false;
+
+  // Follow the chain of additions of dot products to the value fed back into
+  // the phi.
+  SmallVector<std::pair<BinaryOperator *, FDotProduct>, 2> Chain;
+  Value *Cur = Phi;
+  while (true) {
+    if (!Cur->hasOneUse())
+      break;
+    if (!isReassocFAdd(Cur->user_back()))
+      break;
+    auto *Add = cast<BinaryOperator>(Cur->user_back());
+    FDotProduct DP;
+    Value *Other = Add->getOperand(Add->getOperand(0) == Cur ? 1 : 0);
+    if (Other == Cur || !matchFDotProduct(Other, DP))
+      return false;
+    Chain.push_back({Add, DP});
+    Cur = Add;
+  }
+  if (Chain.empty())
+    return false;
+
+  // The end of the chain is fed back into the phi, its other uses have to be
+  // reductions after the loop, possibly through LCSSA phis.
+  BinaryOperator *Next = Chain.back().first;
+  unsigned BackEdge;
+  if (Phi->getIncomingValue(0) == Next)
+    BackEdge = 0;
+  else if (Phi->getIncomingValue(1) == Next)
+    BackEdge = 1;
+  else
+    return false;
+  unsigned Entry = 1 - BackEdge;
+
+  SmallVector<IntrinsicInst *, 2> Reductions;
+  SmallVector<PHINode *, 2> ExitPhis;
+  for (User *U : Next->users()) {
+    if (U == Phi)
+      continue;
+    if (isFAddReduction(U)) {
+      Reductions.push_back(cast<IntrinsicInst>(U));
+      continue;
+    }
+    auto *ExitPhi = dyn_cast<PHINode>(U);
+    if (!ExitPhi || ExitPhi == Phi)
+      return false;
+    for (Value *In : ExitPhi->incoming_values())
+      if (In != Next)
+        return false;
+    for (User *PU : ExitPhi->users())
+      if (!isFAddReduction(PU))
+        return false;
+    ExitPhis.push_back(ExitPhi);
+  }
+  if (Reductions.empty() && ExitPhis.empty())
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Expanding dot product accumulator " << *Phi << "\n");
+
+  // The narrow accumulator starts with the sum of the lanes of the vector.
+  IRBuilder<> Builder(Phi);
+  Builder.setFastMathFlags(Chain.front().first->getFastMathFlags());
+  auto *AccTy = FixedVectorType::get(Builder.getFloatTy(), 2);
+  Value *Start = Phi->getIncomingValue(Entry);
+  Value *NarrowStart;
+  if (isa<ConstantAggregateZero>(Start)) {
+    NarrowStart = ConstantAggregateZero::get(AccTy);
+  } else {
+    IRBuilder<> PHBuilder(Phi->getIncomingBlock(Entry)->getTerminator());
+    PHBuilder.setFastMathFlags(Builder.getFastMathFlags());
+    Value *Sum = PHBuilder.CreateFAddReduce(
+        ConstantFP::getNegativeZero(PHBuilder.getFloatTy()), Start);
+    NarrowStart = PHBuilder.CreateInsertElement(
+        ConstantAggregateZero::get(AccTy), Sum, uint64_t(0));
+  }
+
+  PHINode *Acc = Builder.CreatePHI(AccTy, 2, Phi->getName() + ".fdotp");
+  Acc->addIncoming(NarrowStart, Phi->getIncomingBlock(Entry));
+  Value *NarrowNext = Acc;
+  for (auto &Link : Chain) {
+    Builder.SetInsertPoint(Link.first);
+    NarrowNext = createDotProduct(Builder, Link.second, NarrowNext);
+  }
+  Acc->addIncoming(NarrowNext, Phi->getIncomingBlock(BackEdge));
+
+  auto replaceReduction = [&](IntrinsicInst *Red, Value *NewAcc) {
+    IRBuilder<> RedBuilder(Red);
+    RedBuilder.setFastMathFlags(Red->getFastMathFlags());
+    Red->replaceAllUsesWith(
+        RedBuilder.CreateFAddReduce(Red->getArgOperand(0), NewAcc));
+    Red->eraseFromParent();
+  };
+  for (IntrinsicInst *Red : Reductions)
+    replaceReduction(Red, NarrowNext);
+  for (PHINode *ExitPhi : ExitPhis) {
+    Builder.SetInsertPoint(ExitPhi);
+    PHINode *NarrowPhi = Builder.CreatePHI(
+        AccTy, ExitPhi->getNumIncomingValues(), ExitPhi->getName() + ".fdotp");
+    for (BasicBlock *BB : ExitPhi->blocks())
+      NarrowPhi->addIncoming(NarrowNext, BB);
+    for (User *U : make_early_inc_range(ExitPhi->users()))
+      replaceReduction(cast<IntrinsicInst>(U), NarrowPhi);
+    ExitPhi->eraseFromParent();
+  }
+
+  // The wide chain is dead now, the phi keeps it alive through the back edge.
+  Phi->replaceAllUsesWith(UndefValue::get(Phi->getType()));
+  Phi->eraseFromParent();
+  for (auto &Link : reverse(Chain)) {
+    Link.first->replaceAllUsesWith(UndefValue::get(Next->getType()));
+    Link.first->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(Link.second.Mul);
+  }
+
+  ++NumAccumulators;
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHFDotProduct, DEBUG_TYPE, SNITCH_FDOTP_NAME, false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(SNITCHFDotProduct, DEBUG_TYPE, SNITCH_FDOTP_NAME, false,
+                    false)
+
+namespace llvm {
+  FunctionPass *createSNITCHFDotProductPass() {
+    return new SNITCHFDotProduct();
+  }
+} // end of namespace llvm
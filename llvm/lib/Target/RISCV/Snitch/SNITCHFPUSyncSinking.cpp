@@ -0,0 +1,261 @@
+//===-- SNITCHFPUSyncSinking.cpp - Delay integer-core/FPU synchronization -===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Snitch offloads floating point instructions to the FPU sequencer and keeps
+// issuing integer instructions while the FPU drains its queue, e.g. during an
+// frep loop. An instruction which returns a floating point result to the
+// integer register file (fmv.x.w, feq/flt/fle, fclass, fcvt.w.*) has to wait
+// until the FPU has executed everything queued before it, and so does all
+// integer work following it.
+//
+// This pass moves such synchronization points down to the latest position in
+// their block, past the independent integer work following them, so that the
+// integer core executes that work while the FPU is still busy. A sync point
+// is moved past an instruction unless
+//  - the instruction is executed by the FPU (it touches a floating point
+//    register or is an frep), since the sync point would then also wait for
+//    it,
+//  - it accesses memory, since the accesses of the integer core are only
+//    ordered with the floating point stores still queued in the sequencer by
+//    a sync point,
+//  - it is a call, a terminator or has other side effects, or
+//  - it depends on the result or clobbers an operand of the sync point.
+// Sync points are visited bottom-up, so consecutive ones end up next to each
+// other and the integer core waits for them once.
+//
+// For every remaining sync point an analysis remark is emitted, reporting
+// where the integer core waits for the FPU (-Rpass-analysis=
+// snitch-fpu-sync-sinking). The integer work moved before a sync point is
+// costed with the scheduling model of the subtarget.
+//
+// The pass runs after register allocation, since the pre-RA machine scheduler
+// would hoist the sync points again to cover their latency.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVInstrInfo.h"
+#include "../RISCVSubtarget.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
+#include "llvm/CodeGen/TargetSchedule.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-fpu-sync-sinking"
+#define SNITCH_FPU_SYNC_SINKING_NAME "Snitch FPU synchronization sinking"
+
+static cl::opt<bool> DisableFPUSyncSinking(
+    "snitch-fpu-sync-sinking-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not delay the reads of FPU results by the integer core"));
+
+STATISTIC(NumSyncsSunk, "Number of FPU synchronization points sunk");
+STATISTIC(NumSyncPoints, "Number of remaining FPU synchronization points");
+
+namespace {
+
+class SNITCHFPUSyncSinking : public MachineFunctionPass {
+public:
+  static char ID;
+
+  SNITCHFPUSyncSinking() : MachineFunctionPass(ID) {
+    initializeSNITCHFPUSyncSinkingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_FPU_SYNC_SINKING_NAME;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<MachineOptimizationRemarkEmitterPass>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  const TargetRegisterInfo *TRI;
+  MachineOptimizationRemarkEmitter *ORE;
+  TargetSchedModel SchedModel;
+
+  /// Sink the sync point \p Sync, returns true if it was moved.
+  bool sinkSyncPoint(MachineInstr &Sync);
+
+  /// Return true if \p Sync may be moved below \p MI.
+  bool canSinkPast(const MachineInstr &Sync, const MachineInstr &MI) const;
+
+  /// Emit a remark for each group of sync points left in \p MBB.
+  void reportSyncPoints(MachineBasicBlock &MBB);
+};
+
+} // end anonymous namespace
+
+char SNITCHFPUSyncSinking::ID = 0;
+
+static bool isFPReg(Register Reg) {
+  return RISCV::FPR64RegClass.contains(Reg) ||
+         RISCV::FPR32RegClass.contains(Reg) ||
+         RISCV::FPR16RegClass.contains(Reg);
+}
+
+/// Return true if \p MI is queued in the FPU sequencer.
+static bool isOffloaded(const MachineInstr &MI) {
+  if (MI.getOpcode() == RISCV::FREP_O || MI.getOpcode() == RISCV::FREP_I)
+    return true;
+  for (const MachineOperand &MO : MI.operands())
+    if (MO.isReg() && !MO.isImplicit() && MO.getReg() && isFPReg(MO.getReg()))
+      return true;
+  return false;
+}
+
+/// Return true if the integer core waits for the FPU to execute \p MI, i.e.
+/// \p MI reads floating point registers and only writes an integer register.
+static bool isSyncPoint(const MachineInstr &MI) {
+  if (MI.isCall() || MI.isTerminator() || MI.mayLoadOrStore() ||
+      MI.hasUnmodeledSideEffects() || MI.isInlineAsm() ||
+      MI.mayRaiseFPException())
+    return false;
+  bool DefinesGPR = false, ReadsFPR = false;
+  for (const MachineOperand &MO : MI.operands()) {
+    if (!MO.isReg() || !MO.getReg())
+      continue;
+    if (MO.isDef()) {
+      if (MO.isImplicit() || !RISCV::GPRRegClass.contains(MO.getReg()))
+        return false;
+      DefinesGPR = true;
+    } else if (!MO.isImplicit() && isFPReg(MO.getReg())) {
+      ReadsFPR = true;
+    }
+  }
+  return DefinesGPR && ReadsFPR;
+}
+
+bool SNITCHFPUSyncSinking::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableFPUSyncSinking || skipFunction(MF.getFunction()))
+    return false;
+  const auto &ST = MF.getSubtarget<RISCVSubtarget>();
+  if (!ST.hasExtXfrep())
+    return false;
+
+  TRI = ST.getRegisterInfo();
+  ORE = &getAnalysis<MachineOptimizationRemarkEmitterPass>().getORE();
+  SchedModel.init(&ST);
+
+  bool Changed = false;
+  for (MachineBasicBlock &MBB : MF) {
+    SmallVector<MachineInstr *, 8> Syncs;
+    for (MachineInstr &MI : MBB)
+      if (isSyncPoint(MI))
+        Syncs.push_back(&MI);
+    // Sync points are barriers to each other, sink the later ones first to
+    // make room for the earlier ones.
+    for (MachineInstr *Sync : reverse(Syncs))
+      Changed |= sinkSyncPoint(*Sync);
+    reportSyncPoints(MBB);
+  }
+  return Changed;
+}
+
+bool SNITCHFPUSyncSinking::canSinkPast(const MachineInstr &Sync,
+                                       const MachineInstr &MI) const {
+  if (MI.isCall() || MI.isTerminator() || MI.isLabel() || MI.isInlineAsm() ||
+      MI.mayLoadOrStore() || MI.hasUnmodeledSideEffects() || isOffloaded(MI))
+    return false;
+  for (const MachineOperand &MO : Sync.operands()) {
+    if (!MO.isReg() || !MO.getReg())
+      continue;
+    if (MI.modifiesRegister(MO.getReg(), TRI))
+      return false;
+    if (MO.isDef() && MI.readsRegister(MO.getReg(), TRI))
+      return false;
+  }
+  return true;
+}
+
+bool SNITCHFPUSyncSinking::sinkSyncPoint(MachineInstr &Sync) {
+  MachineBasicBlock &MBB = *Sync.getParent();
+  Register Dst = Sync.getOperand(0).getReg();
+
+  unsigned NumPassed = 0, Cycles = 0;
+  SmallVector<MachineInstr *, 4> DbgUses;
+  MachineBasicBlock::iterator InsertPt = std::next(Sync.getIterator());
+  for (MachineBasicBlock::iterator E = MBB.end(); InsertPt != E; ++InsertPt) {
+    if (InsertPt->isDebugInstr()) {
+      if (InsertPt->isDebugValue() && InsertPt->readsRegister(Dst, TRI))
+        DbgUses.push_back(&*InsertPt);
+      continue;
+    }
+    if (!canSinkPast(Sync, *InsertPt))
+      break;
+    ++NumPassed;
+    Cycles += SchedModel.computeInstrLatency(&*InsertPt);
+  }
+  if (!NumPassed)
+    return false;
+
+  LLVM_DEBUG(dbgs() << "Sinking " << Sync << "  past " << NumPassed
+                    << " instructions, " << Cycles << " cycles\n");
+  MBB.splice(InsertPt, &MBB, Sync.getIterator());
+  // The debug values passed no longer see the result.
+  for (MachineInstr *DbgMI : DbgUses)
+    DbgMI->setDebugValueUndef();
+
+  ORE->emit([&]() {
+    return MachineOptimizationRemark(DEBUG_TYPE, "SyncSunk",
+                                     Sync.getDebugLoc(), &MBB)
+           << "delayed the FPU synchronization past "
+           << ore::NV("NumInstrs", NumPassed) << " integer instructions ("
+           << ore::NV("NumCycles", Cycles) << " cycles)";
+  });
+  ++NumSyncsSunk;
+  return true;
+}
+
+void SNITCHFPUSyncSinking::reportSyncPoints(MachineBasicBlock &MBB) {
+  for (auto I = MBB.begin(), E = MBB.end(); I != E;) {
+    if (!isSyncPoint(*I)) {
+      ++I;
+      continue;
+    }
+    const MachineInstr &First = *I;
+    unsigned NumResults = 0;
+    for (; I != E && (I->isDebugInstr() || isSyncPoint(*I)); ++I)
+      if (!I->isDebugInstr())
+        ++NumResults;
+
+    ORE->emit([&]() {
+      return MachineOptimizationRemarkAnalysis(DEBUG_TYPE, "FPUSync",
+                                               First.getDebugLoc(), &MBB)
+             << "integer core waits for the FPU to return "
+             << ore::NV("NumResults", NumResults) << " result(s)";
+    });
+    ++NumSyncPoints;
+  }
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHFPUSyncSinking, DEBUG_TYPE,
+                      SNITCH_FPU_SYNC_SINKING_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineOptimizationRemarkEmitterPass)
+INITIALIZE_PASS_END(SNITCHFPUSyncSinking, DEBUG_TYPE,
+                    SNITCH_FPU_SYNC_SINKING_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHFPUSyncSinkingPass() {
+    return new SNITCHFPUSyncSinking();
+  }
+} // end of namespace llvm
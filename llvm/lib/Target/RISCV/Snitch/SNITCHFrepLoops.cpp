@@ -11,16 +11,29 @@
 // floating point repetition instruction (frep).  The hardware loop can perform 
 // floating point instruction repetition with zero-cycle overhead
 //
+// Only instructions executed by the FPU can be repeated. Integer instructions
+// of single-block loops which neither consume nor produce floating point
+// values are moved into a separate integer loop following the frep body. The
+// integer core runs this loop while the FPU sequencer repeats the body.
+//
+// Every loop marked for inference which is not converted is reported as a
+// missed remark named after the reason, see RISCVLoopRemarks.h
+// (-Rpass-missed=snitch-freploops).
+//
 //  This file is based on the lib/Target/Hexagon/HexagonHardwareLoops.cpp file.
 //===----------------------------------------------------------------------===//
 
 
 
+#include "../MCTargetDesc/RISCVBaseInfo.h"
 #include "../RISCVInstrInfo.h"
+#include "../RISCVLoopRemarks.h"
 #include "../RISCVRegisterInfo.h"
 #include "../RISCVSubtarget.h"
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
@@ -34,8 +47,10 @@
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
 #include "llvm/CodeGen/MachineOperand.h"
+#include "llvm/CodeGen/MachineOptimizationRemarkEmitter.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/TargetRegisterInfo.h"
+#include "llvm/CodeGen/TargetSchedule.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugLoc.h"
 #include "llvm/InitializePasses.h"
@@ -64,6 +79,17 @@ static cl::opt<bool> EnableFrepInference("snitch-frep-inference", cl::init(false
   cl::Hidden, cl::ZeroOrMore, cl::desc("Enable automatic inference of frep loops"));
 
 STATISTIC(NumFrepLoops, "Number of loops converted to frep loops");
+static cl::opt<unsigned> FrepStagger("snitch-frep-stagger", cl::init(4),
+  cl::Hidden, cl::desc("Number of staggered accumulators for reductions in "
+                       "frep loops, 1 disables staggering"));
+
+STATISTIC(NumFrepStaggered, "Number of frep loops with staggered reductions");
+static cl::opt<bool> DisableFrepInner("snitch-frep-inner-disable",
+  cl::init(false), cl::Hidden,
+  cl::desc("Only infer frep.o, never repeat the instructions one by one"));
+
+STATISTIC(NumFrepInner, "Number of frep loops repeating each instruction");
+STATISTIC(NumFrepSplitLoops, "Number of frep loops with a decoupled integer loop");
 
 namespace {
   class CountValue;
@@ -73,8 +99,10 @@ class SNITCHFrepLoops : public MachineFunctionPass {
   MachineLoopInfo            *MLI;
   MachineRegisterInfo        *MRI;
   MachineDominatorTree       *MDT;
+  MachineOptimizationRemarkEmitter *ORE;
   const RISCVInstrInfo       *TII;
   const RISCVRegisterInfo    *TRI;
+  TargetSchedModel           SchedModel;
   FrepLoop                   *FL;
 
 public:
@@ -91,6 +119,7 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<MachineDominatorTree>();
     AU.addRequired<MachineLoopInfo>();
+    AU.addRequired<MachineOptimizationRemarkEmitterPass>();
     MachineFunctionPass::getAnalysisUsage(AU);
   }
 
@@ -148,14 +177,60 @@ private:
   bool convertToHardwareLoop(MachineLoop *L);
 
   /// Return number of freppable instructions of loop is freppable, zero
-  /// if not
+  /// if not. \p Invalid is set to the instruction which cannot be repeated,
+  /// if any.
   unsigned containsInvalidInstruction(MachineLoop *L, Register *IV, Register *ICV,
-    SmallVectorImpl<MachineInstr *> &FPPhis) const;
+    SmallVectorImpl<MachineInstr *> &FPPhis,
+    SmallVectorImpl<MachineInstr *> &IntInsts,
+    const MachineInstr *&Invalid) const;
+
+  /// Emit a missed remark for \p L, declined for \p Reason. \p MI is the
+  /// offending instruction, if any.
+  void reportMissed(MachineLoop *L, RISCVLoopRemark::Reason Reason,
+                    const MachineInstr *MI = nullptr);
 
   /// Return true if the instruction is not valid within a hardware
   /// loop.
   bool isInvalidLoopOperation(const MachineInstr *MI) const;
 
+  /// Return true if the register is a floating point register
+  bool isFPReg(Register Reg) const;
+
+  /// Return true if all register operands of the instruction are floating
+  /// point registers, i.e. it is issued to the FPU sequencer
+  bool isFPUInstruction(const MachineInstr *MI) const;
+
+  /// Return true if the instruction only involves integer registers and can
+  /// run on the integer core alongside the frep
+  bool isDecoupledIntInstruction(const MachineInstr *MI) const;
+
+  /// Return true if the instruction stays in the frep body when the integer
+  /// instructions are split off
+  bool isFrepBodyInstruction(const MachineInstr &MI) const;
+
+  /// Rotate the reduction chains of the frep body through several
+  /// accumulators. Returns the stagger_max field and sets the mask, or
+  /// returns zero if the body is not staggered
+  unsigned staggerReductions(MachineLoop *L, MachineBasicBlock *Preheader,
+                             unsigned &StaggerMask);
+
+  /// Return true if repeating each instruction of the single-block loop L on
+  /// its own (frep.i) is faster than repeating the whole body. If so, the
+  /// temporaries of the body are staggered and the stagger fields are set
+  bool inferInnerRepetition(MachineLoop *L, MachineBasicBlock *Preheader,
+                            unsigned TripCount, unsigned &StaggerMax,
+                            unsigned &StaggerMask);
+
+  /// Return the first of Num consecutive free floating point temporaries
+  /// which are not in Taken, or zero
+  MCPhysReg findStaggerRegs(const MachineFunction &MF, unsigned Num,
+                            const SmallSet<MCPhysReg, 8> &Taken) const;
+
+  /// Move the integer instructions of the single-block loop L into a new
+  /// loop following the frep body
+  MachineBasicBlock *splitIntegerLoop(MachineLoop *L,
+                                      MachineBasicBlock *LoopSucc);
+
   /// Scan the loop body and search for a branch instruction that 
   /// leads to the induction variable and trip count
   const MachineInstr * findBranchInstruction(MachineLoop *L);
@@ -304,9 +379,11 @@ bool SNITCHFrepLoops::runOnMachineFunction(MachineFunction &MF) {
   MLI = &getAnalysis<MachineLoopInfo>();
   MRI = &MF.getRegInfo();
   MDT = &getAnalysis<MachineDominatorTree>();
+  ORE = &getAnalysis<MachineOptimizationRemarkEmitterPass>().getORE();
   const RISCVSubtarget &HST = MF.getSubtarget<RISCVSubtarget>();
   TII = HST.getInstrInfo();
   TRI = HST.getRegisterInfo();
+  SchedModel.init(&HST);
 
   for (auto &L : *MLI)
     if (L->isOutermost()) {
@@ -368,7 +445,7 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   CountValue *TripCount = getLoopTripCount(L, OldInsts, IndReg, IncReg);
 
   if(TripCount == nullptr) {
-    LLVM_DEBUG(dbgs() << "trip count not found\n");
+    reportMissed(L, RISCVLoopRemark::UnknownTripCount);
     return changed;
   }
   LLVM_DEBUG(dbgs() << "getLoopTripCount found count "; TripCount->print(dbgs(), TRI));
@@ -376,8 +453,21 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   // Does the loop contain any invalid instructions?
   LLVM_DEBUG(dbgs() << ">>>>> in containsInvalidInstruction()\n");
   SmallVector<MachineInstr*, 2> FPPhis;
-  unsigned nFlops = containsInvalidInstruction(L, IndReg, IncReg, FPPhis);
+  SmallVector<MachineInstr*, 4> IntInsts;
+  const MachineInstr *Invalid = nullptr;
+  unsigned nFlops = containsInvalidInstruction(L, IndReg, IncReg, FPPhis,
+                                               IntInsts, Invalid);
   if (nFlops == 0) {
+    reportMissed(L, Invalid ? RISCVLoopRemark::InvalidInstruction
+                            : RISCVLoopRemark::NotFPOnly, Invalid);
+    delete TripCount;
+    return changed;
+  }
+  // integer instructions can only be split off single-block loops
+  if (!IntInsts.empty() && L->getNumBlocks() != 1) {
+    LLVM_DEBUG(dbgs() << "integer instructions in multi-block loop\n");
+    reportMissed(L, RISCVLoopRemark::NotFPOnly, IntInsts.front());
+    delete TripCount;
     return changed;
   }
   LLVM_DEBUG(dbgs() << "No invalid instructions found\n");
@@ -385,6 +475,8 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   // don't proceed if we don't have a control block
   MachineBasicBlock *ControlBlock = L->findLoopControlBlock();
   if (!ControlBlock) {
+    reportMissed(L, RISCVLoopRemark::MultipleExits);
+    delete TripCount;
     return changed;
   }
   LLVM_DEBUG(dbgs()<<"ControlBlock: " << ControlBlock->getName() << "\n");
@@ -393,6 +485,8 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   // loop latch, one out of the loop
   MachineBasicBlock::iterator LastI = ControlBlock->getFirstTerminator();
   if (LastI == ControlBlock->end()) {
+    reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
+    delete TripCount;
     return changed;
   }
 
@@ -400,22 +494,23 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   // placed there.
   MachineBasicBlock *Preheader = MLI->findLoopPreheader(L, SpecPreheader);
   if (!Preheader) {
-    dbgs() << "No preheader found\n";
+    reportMissed(L, RISCVLoopRemark::NoPreheader);
+    delete TripCount;
     return changed;
   }
 
   // Is the trip count available in the preheader?
   // Don't worry if it is immediate
   if (TripCount->isReg()) {
-    dbgs() << "Don't know yet how to handle register trip counts\n";
-    return changed;
-    // There will be a use of the register inserted into the preheader,
+    // There will be a use of the register inserted into the loop top block,
     // so make sure that the register is actually defined at that point.
-    // MachineInstr *TCDef = MRI->getVRegDef(TripCount->getReg());
-    // MachineBasicBlock *BBDef = TCDef->getParent();
-    // if (!MDT->dominates(BBDef, Preheader)) {
-    //   return Changed;
-    // }
+    MachineInstr *TCDef = MRI->getVRegDef(TripCount->getReg());
+    MachineBasicBlock *BBDef = TCDef->getParent();
+    if (!MDT->dominates(BBDef, Preheader)) {
+      reportMissed(L, RISCVLoopRemark::TripCountNotAvailable);
+      delete TripCount;
+      return changed;
+    }
   }
 
   // Determine the loop start.
@@ -432,6 +527,8 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   bool branchNotFound = TII->analyzeBranch(*ControlBlock, TB, FB, Cond, false);
   if (ControlBlock !=  LatchBlock) {
     if (branchNotFound) {
+      reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
+      delete TripCount;
       return changed;
     }
     if (L->contains(TB)) {
@@ -443,6 +540,8 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
       LoopSucc = TB;
     }
     else {
+      reportMissed(L, RISCVLoopRemark::UnanalyzableBranch);
+      delete TripCount;
       return changed;
     }
   }
@@ -456,7 +555,8 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   // We need a single exit block to make sure that this loop can be simplified
   // to a fixed amount of loop iterations.
   if (!ExitBlock) {
-    dbgs() << "no exit block found\n";
+    reportMissed(L, RISCVLoopRemark::MultipleExits);
+    delete TripCount;
     return changed;
   }
 
@@ -469,12 +569,36 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
   for (const MachineBasicBlock *LB : L->getBlocks()) {
     loopSize += instructionSize * LB->size();
     if (loopSize > 0xFFF) {
-      dbgs() << "loopsize exceeds limit: "<<loopSize<<"\n";
+      LLVM_DEBUG(dbgs() << "loopsize exceeds limit: "<<loopSize<<"\n");
+      reportMissed(L, RISCVLoopRemark::BodyTooLong);
+      delete TripCount;
       return changed;
     }
   }
   LLVM_DEBUG(dbgs() << "loopsize: "<<loopSize/instructionSize<<" instructions "<<nFlops<<" flops\n");
   
+  // Move the integer instructions into their own loop, which then contains
+  // the induction variable and the backedge.
+  bool IsSplit = !IntInsts.empty();
+  MachineBasicBlock *IntLoop = nullptr;
+  if (IsSplit) {
+    LLVM_DEBUG(dbgs() << ">>>>> split " << IntInsts.size()
+                      << " integer instructions\n");
+    IntLoop = splitIntegerLoop(L, LoopSucc);
+  }
+
+  // Hide the FPU latency of reduction chains with staggered accumulators.
+  unsigned StaggerMask = 0;
+  unsigned StaggerMax = staggerReductions(L, Preheader, StaggerMask);
+
+  // Repeat the instructions one by one if the body is a chain which frep.o
+  // would stall on.
+  unsigned FrepOpc = RISCV::FREP_O;
+  if (!StaggerMax && TripCount->isImm() && FPPhis.empty() &&
+      inferInnerRepetition(L, Preheader, TripCount->getImm(), StaggerMax,
+                           StaggerMask))
+    FrepOpc = RISCV::FREP_I;
+
   // Convert the loop to a hardware loop.
   LLVM_DEBUG(dbgs() << ">>>>> insert frep\n");
   MachineBasicBlock::iterator InsertPos = TopBlock->getFirstNonPHI();
@@ -484,16 +608,13 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
     DL = InsertPos->getDebugLoc();
 
   if (TripCount->isReg()) {
-    // Create a copy of the loop count register.
+    // frep takes the number of repetitions minus one in the register
     unsigned CountReg = MRI->createVirtualRegister(&RISCV::GPRRegClass);
-    BuildMI(*TopBlock, InsertPos, DL, TII->get(TargetOpcode::COPY), CountReg)
-      .addReg(TripCount->getReg(), 0, TripCount->getSubReg());
-    // wat tripcount-1 in the register
-    BuildMI(*TopBlock, InsertPos, DL, TII->get(RISCV::ADDI))
-      .addReg(CountReg).addReg(CountReg).addImm(-1);
+    BuildMI(*TopBlock, InsertPos, DL, TII->get(RISCV::ADDI), CountReg)
+      .addReg(TripCount->getReg(), 0, TripCount->getSubReg()).addImm(-1);
     // Add the Loop instruction to the beginning of the loop.
-    auto hwloop = BuildMI(*TopBlock, InsertPos, DL, TII->get(RISCV::FREP_O))
-      .addReg(CountReg).addImm(nFlops).addImm(0).addImm(0);
+    auto hwloop = BuildMI(*TopBlock, InsertPos, DL, TII->get(FrepOpc))
+      .addReg(CountReg).addImm(nFlops).addImm(StaggerMax).addImm(StaggerMask);
     KnownHardwareLoops.insert(hwloop.getInstr());
   } else {
     assert(TripCount->isImm() && "Expecting immediate value for trip count if not register");
@@ -503,12 +624,31 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
     unsigned CountReg = MRI->createVirtualRegister(&RISCV::GPRRegClass);
     BuildMI(*TopBlock, InsertPos, DL, TII->get(RISCV::ADDI), CountReg)
       .addReg(RISCV::X0).addImm(CountImm-1);
-    auto hwloop = BuildMI(*TopBlock, InsertPos, DL, TII->get(RISCV::FREP_O))
-      .addReg(CountReg).addImm(nFlops).addImm(0).addImm(0);
+    auto hwloop = BuildMI(*TopBlock, InsertPos, DL, TII->get(FrepOpc))
+      .addReg(CountReg).addImm(nFlops).addImm(StaggerMax).addImm(StaggerMask);
     KnownHardwareLoops.insert(hwloop.getInstr()); 
   }
   delete TripCount;
 
+  ORE->emit([&]() {
+    return MachineOptimizationRemark(DEBUG_TYPE, "FrepLoop", L->getStartLoc(),
+                                     L->getHeader())
+           << "converted loop to "
+           << (FrepOpc == RISCV::FREP_I ? "frep.i" : "frep.o") << " of "
+           << ore::NV("NumInstrs", nFlops) << " instructions";
+  });
+
+  // The body is now straight-line code, the integer loop keeps the branch.
+  if (IsSplit) {
+    insertFPUBarrier(L, ExitBlock);
+    // The body is still the only block of L while it is converted, the
+    // integer loop joins it and its parents only now.
+    L->addBasicBlockToLoop(IntLoop, MLI->getBase());
+    ++NumFrepLoops;
+    ++NumFrepSplitLoops;
+    return true;
+  }
+
   // Add unconditional branch to exit block where FPU fence is placed
   // InsertPos = TopBlock->getFirstTerminator();
   // NewInsts.push_back(BuildMI(*TopBlock, InsertPos, DL,
@@ -692,7 +832,9 @@ bool SNITCHFrepLoops::convertToHardwareLoop(MachineLoop *L) {
 /// Return true if the loop contains an instruction that inhibits
 /// the use of the hardware loop instruction.
 unsigned SNITCHFrepLoops::containsInvalidInstruction(MachineLoop *L, Register *IV, Register *ICV,
-    SmallVectorImpl<MachineInstr *> &FPPhis) const {
+    SmallVectorImpl<MachineInstr *> &FPPhis,
+    SmallVectorImpl<MachineInstr *> &IntInsts,
+    const MachineInstr *&Invalid) const {
   MachineBasicBlock *Header = L->getHeader();
   MachineBasicBlock *Latch = L->getLoopLatch();
   MachineBasicBlock *ExitingBlock = L->findLoopControlBlock();
@@ -717,6 +859,15 @@ unsigned SNITCHFrepLoops::containsInvalidInstruction(MachineLoop *L, Register *I
       }
 
       if(MI->getOpcode() ==  TargetOpcode::COPY) {
+        // copies between integer and floating point registers cannot be
+        // assigned to either side
+        Register Dst = MI->getOperand(0).getReg();
+        Register Src = MI->getOperand(1).getReg();
+        if(isFPReg(Dst) != isFPReg(Src)) {
+          LLVM_DEBUG(dbgs() << "Cannot convert to hw_loop due to:"; MI->dump());
+          Invalid = MI;
+          return 0;
+        }
         LLVM_DEBUG(dbgs() << "  ignoring COPY\n");
         continue;
       }
@@ -756,36 +907,558 @@ unsigned SNITCHFrepLoops::containsInvalidInstruction(MachineLoop *L, Register *I
       }
       if(skip) continue;
 
-      // skip if contains induction variable IV
-      skip = false;
-      for(auto MO : MI->operands())
-        if(MO.isReg() && (MO.getReg() == *IV) ) {
-          LLVM_DEBUG(dbgs()<<"  skipped due to inudction register usage\n");
-          skip = true;
-          break;
-        }
-      if(skip) continue;
+      // skip the induction variable bump
+      if(MI->getNumOperands() && MI->getOperand(0).isReg() &&
+         MI->getOperand(0).isDef() && MI->getOperand(0).getReg() == *ICV &&
+         MI->readsRegister(*IV)) {
+        LLVM_DEBUG(dbgs()<<"  skipped due to inudction register usage\n");
+        continue;
+      }
 
       if (isInvalidLoopOperation(MI)) {
         LLVM_DEBUG(dbgs() << "Cannot convert to hw_loop due to:"; MI->dump());
+        Invalid = MI;
         return 0;
       }
+      if (!isFPUInstruction(MI)) {
+        LLVM_DEBUG(dbgs() << "  integer instruction, split off\n");
+        IntInsts.push_back(MI);
+        continue;
+      }
       Flops++;
     }
   }
   return Flops;
 }
 
+void SNITCHFrepLoops::reportMissed(MachineLoop *L,
+                                   RISCVLoopRemark::Reason Reason,
+                                   const MachineInstr *MI) {
+  LLVM_DEBUG(dbgs() << "Not an frep loop: "
+                    << RISCVLoopRemark::getMessage(Reason) << "\n");
+  ORE->emit([&]() {
+    MachineOptimizationRemarkMissed R(DEBUG_TYPE,
+                                      RISCVLoopRemark::getName(Reason),
+                                      L->getStartLoc(), L->getHeader());
+    R << "loop not converted to an frep loop: "
+      << RISCVLoopRemark::getMessage(Reason);
+    if (MI)
+      R << ": " << MachineOptimizationRemarkMissed::MachineArgument("Inst", *MI);
+    return R;
+  });
+}
+
 /// Return true if the operation is invalid within hardware loop.
 bool SNITCHFrepLoops::isInvalidLoopOperation(const MachineInstr *MI) const {
-  // If all virtual register operands are FPR, this instruction is valid for frep
-  bool validInstr = true;
-  for(auto MO : MI->operands())
-    if(MO.isReg() && MO.getReg().isVirtual())
-      if(MRI->getRegClass(MO.getReg()) != &RISCV::FPR64RegClass || 
-        MRI->getRegClass(MO.getReg()) != &RISCV::FPR32RegClass)
-        validInstr = false;
-  return validInstr;
+  return !isFPUInstruction(MI) && !isDecoupledIntInstruction(MI);
+}
+
+bool SNITCHFrepLoops::isFPReg(Register Reg) const {
+  if (Reg.isVirtual()) {
+    const TargetRegisterClass *RC = MRI->getRegClass(Reg);
+    return RISCV::FPR64RegClass.hasSubClassEq(RC) ||
+           RISCV::FPR32RegClass.hasSubClassEq(RC);
+  }
+  return RISCV::FPR64RegClass.contains(Reg) ||
+         RISCV::FPR32RegClass.contains(Reg);
+}
+
+bool SNITCHFrepLoops::isFPUInstruction(const MachineInstr *MI) const {
+  if (MI->mayLoadOrStore() || MI->isCall() || MI->isBranch() ||
+      MI->hasUnmodeledSideEffects())
+    return false;
+  // Implicit operands are the rounding mode and the exception flags
+  bool HasReg = false;
+  for (const MachineOperand &MO : MI->operands()) {
+    if (!MO.isReg() || MO.isImplicit() || !MO.getReg())
+      continue;
+    if (!isFPReg(MO.getReg()))
+      return false;
+    HasReg = true;
+  }
+  return HasReg;
+}
+
+bool SNITCHFrepLoops::isDecoupledIntInstruction(const MachineInstr *MI) const {
+  if (MI->isCall() || MI->isTerminator() || MI->hasUnmodeledSideEffects() ||
+      MI->isInlineAsm())
+    return false;
+  for (const MachineOperand &MO : MI->operands())
+    if (MO.isReg() && MO.getReg() && isFPReg(MO.getReg()))
+      return false;
+  return true;
+}
+
+bool SNITCHFrepLoops::isFrepBodyInstruction(const MachineInstr &MI) const {
+  if (MI.isPHI() || MI.isCopy())
+    return isFPReg(MI.getOperand(0).getReg());
+  if (MI.isDebugValue())
+    return !MI.getOperand(0).isReg() || !MI.getOperand(0).getReg() ||
+           isFPReg(MI.getOperand(0).getReg());
+  return isFPUInstruction(&MI);
+}
+
+/// Stagger the reduction chains in the body of the single-block loop L.
+///
+/// frep can rename the registers of the repeated instructions: in iteration
+/// i, every operand selected by stagger_mask is incremented by
+/// i % (stagger_max + 1). A reduction such as
+///
+///   %acc = PHI %init, %preheader, %res, %body
+///   %res = FMADD_D %a, %b, %acc
+///
+/// is rewritten to accumulate into consecutive physical registers ft4-ft7,
+/// which are initialized with %init and zeros in the preheader and summed up
+/// after the repeated instructions:
+///
+///   frep.o %n, 1, 3, 0b1001
+///   fmadd.d ft4, %a, %b, ft4
+///   %res = (ft4 + ft5) + (ft6 + ft7)
+///
+/// The stagger applies to every repeated instruction, so the body may only
+/// consist of reductions accumulating in the same operand position. Since the
+/// reduction is reassociated, all of them must allow reassociation.
+unsigned SNITCHFrepLoops::staggerReductions(MachineLoop *L,
+                                            MachineBasicBlock *Preheader,
+                                            unsigned &StaggerMask) {
+  // stagger_max has 3 bits
+  unsigned NumAcc = std::min<unsigned>(FrepStagger, 8);
+  if (NumAcc < 2 || L->getNumBlocks() != 1)
+    return 0;
+  MachineBasicBlock *Body = L->getHeader();
+
+  struct Reduction {
+    MachineInstr *MI;
+    MachineInstr *Phi;
+    unsigned AccIdx;
+    Register Init;
+    Register Result;
+    MCPhysReg Base;
+  };
+  SmallVector<Reduction, 2> Reductions;
+  unsigned Mask = 0;
+
+  for (MachineInstr &MI : *Body) {
+    if (MI.isPHI() || MI.isDebugInstr() || !isFPUInstruction(&MI))
+      continue;
+
+    SmallVector<unsigned, 2> AccCandidates;
+    switch (MI.getOpcode()) {
+    case RISCV::FMADD_D:
+    case RISCV::FNMSUB_D:
+      AccCandidates.push_back(3);
+      break;
+    case RISCV::FADD_D:
+      AccCandidates.push_back(1);
+      AccCandidates.push_back(2);
+      break;
+    case RISCV::FSUB_D:
+      AccCandidates.push_back(1);
+      break;
+    default:
+      LLVM_DEBUG(dbgs() << "  no reduction, not staggering: "; MI.dump());
+      return 0;
+    }
+    if (!MI.getFlag(MachineInstr::FmReassoc))
+      return 0;
+
+    // The accumulator is a PHI of the body whose only use is this instruction,
+    // the result is only fed back through the PHI within the body.
+    Register Result = MI.getOperand(0).getReg();
+    Reduction Red = {&MI, nullptr, 0, Register(), Result, 0};
+    for (unsigned Idx : AccCandidates) {
+      Register Acc = MI.getOperand(Idx).getReg();
+      MachineInstr *Phi = Acc.isVirtual() ? MRI->getVRegDef(Acc) : nullptr;
+      if (!Phi || !Phi->isPHI() || Phi->getParent() != Body ||
+          Phi->getNumOperands() != 5 || !MRI->hasOneNonDBGUse(Acc))
+        continue;
+      unsigned InitOp = Phi->getOperand(2).getMBB() == Preheader ? 1 : 3;
+      if (Phi->getOperand(InitOp + 1).getMBB() != Preheader ||
+          Phi->getOperand(InitOp ^ 2).getReg() != Result)
+        continue;
+      Red.Phi = Phi;
+      Red.AccIdx = Idx;
+      Red.Init = Phi->getOperand(InitOp).getReg();
+      break;
+    }
+    if (!Red.Phi || !Result.isVirtual())
+      return 0;
+    for (MachineInstr &UseMI : MRI->use_nodbg_instructions(Result))
+      if (UseMI.getParent() == Body && &UseMI != Red.Phi)
+        return 0;
+
+    // The remaining operands are not staggered and must not be produced by
+    // another (staggered) instruction of the body.
+    for (unsigned Idx = 1, E = MI.getNumExplicitOperands(); Idx != E; ++Idx) {
+      const MachineOperand &MO = MI.getOperand(Idx);
+      if (Idx == Red.AccIdx || !MO.isReg() || !MO.getReg().isVirtual())
+        continue;
+      if (MRI->getVRegDef(MO.getReg())->getParent() == Body)
+        return 0;
+    }
+
+    unsigned OpMask = 1 | (1 << Red.AccIdx);
+    if (Mask && Mask != OpMask)
+      return 0;
+    Mask = OpMask;
+    Reductions.push_back(Red);
+  }
+  if (Reductions.empty())
+    return 0;
+
+  // Find consecutive free temporaries for each chain.
+  SmallSet<MCPhysReg, 8> Taken;
+  for (Reduction &Red : Reductions) {
+    Red.Base = findStaggerRegs(*Body->getParent(), NumAcc, Taken);
+    if (!Red.Base) {
+      LLVM_DEBUG(dbgs() << "  no free accumulators, not staggering\n");
+      return 0;
+    }
+    for (unsigned i = 0; i < NumAcc; ++i)
+      Taken.insert(Red.Base + i);
+  }
+
+  MachineBasicBlock::iterator InitPos = Preheader->getFirstTerminator();
+  MachineBasicBlock::iterator EpiloguePos = Body->getFirstTerminator();
+  for (Reduction &Red : Reductions) {
+    MachineInstr &MI = *Red.MI;
+    DebugLoc DL = MI.getDebugLoc();
+    LLVM_DEBUG(dbgs() << "  staggering " << NumAcc << " accumulators from "
+                      << printReg(Red.Base, TRI) << " for "; MI.dump());
+
+    // the first accumulator starts with the initial value, the others with
+    // the neutral element
+    BuildMI(*Preheader, InitPos, DL, TII->get(TargetOpcode::COPY), Red.Base)
+      .addReg(Red.Init);
+    for (unsigned i = 1; i < NumAcc; ++i)
+      BuildMI(*Preheader, InitPos, DL, TII->get(RISCV::FCVT_D_W), Red.Base + i)
+        .addReg(RISCV::X0);
+
+    MI.getOperand(0).setReg(Red.Base);
+    MI.getOperand(Red.AccIdx).setReg(Red.Base);
+    MI.getOperand(Red.AccIdx).setIsKill(false);
+    Red.Phi->eraseFromParent();
+
+    // The epilogue follows the repeated instructions, so it is executed once
+    // after the repetition. Sum up pairwise.
+    SmallVector<Register, 8> Partial;
+    for (unsigned i = 0; i < NumAcc; ++i)
+      Partial.push_back(Red.Base + i);
+    while (Partial.size() > 1) {
+      SmallVector<Register, 8> Next;
+      for (unsigned i = 0; i + 1 < Partial.size(); i += 2) {
+        Register Sum = MRI->createVirtualRegister(&RISCV::FPR64RegClass);
+        BuildMI(*Body, EpiloguePos, DL, TII->get(RISCV::FADD_D), Sum)
+          .addReg(Partial[i]).addReg(Partial[i + 1])
+          .addImm(RISCVFPRndMode::DYN);
+        Next.push_back(Sum);
+      }
+      if (Partial.size() % 2)
+        Next.push_back(Partial.back());
+      Partial = Next;
+    }
+    MRI->replaceRegWith(Red.Result, Partial.front());
+
+    for (unsigned i = 0; i < NumAcc; ++i)
+      Body->addLiveIn(Red.Base + i);
+  }
+  Body->sortUniqueLiveIns();
+
+  StaggerMask = Mask;
+  ++NumFrepStaggered;
+  return NumAcc - 1;
+}
+
+/// Repeat every instruction of the single-block loop L TripCount times before
+/// moving on to the next one (frep.i) instead of repeating the whole body
+/// (frep.o), if that is faster.
+///
+/// frep.o stalls on every dependence between two instructions of the same
+/// iteration whose distance in the body is shorter than the FPU latency. With
+/// frep.i the iterations of a chain are independent, as long as each of them
+/// works on its own registers. Staggering by the trip count gives each
+/// iteration i its own copy of the temporaries, e.g. for four iterations
+///
+///   %t = FMUL_D %a, $f0_d          frep.i %n, 2, 3, 0b0011
+///   %u = FADD_D %t, $f1_d            fmul.d ft4, fa0, ft0
+///                                    fadd.d ft8, ft4, ft1
+///
+/// The stagger applies to the same operand positions of every repeated
+/// instruction, so every operand in a staggered position has to be a
+/// temporary of the body or a loop-invariant value, which is then copied to
+/// consecutive registers in the preheader (%a to fa0-fa3 above). Temporaries
+/// used after the loop
+/// are taken from the copy of the last iteration. Since frep.i changes the
+/// order of the stream accesses, each SSR may only be used by one
+/// instruction. The body may not carry values to the next iteration, and a
+/// chain can not end in a stream, whose register would be staggered as well.
+///
+/// The choice follows an in-order, single-issue estimate of the cycles the
+/// FPU needs for both orders with the latencies of the scheduling model.
+bool SNITCHFrepLoops::inferInnerRepetition(MachineLoop *L,
+                                           MachineBasicBlock *Preheader,
+                                           unsigned TripCount,
+                                           unsigned &StaggerMax,
+                                           unsigned &StaggerMask) {
+  // stagger_max has 3 bits
+  if (DisableFrepInner || L->getNumBlocks() != 1 || TripCount < 2 ||
+      TripCount > 8)
+    return false;
+  MachineBasicBlock *Body = L->getHeader();
+  MachineFunction *MF = Body->getParent();
+  const unsigned N = TripCount;
+
+  SmallVector<MachineInstr *, 8> Insts;
+  DenseMap<Register, unsigned> DefIdx;
+  for (MachineInstr &MI : *Body) {
+    if (MI.isPHI() || MI.isDebugInstr() || !isFPUInstruction(&MI))
+      continue;
+    if (MI.isCopy())
+      return false;
+    const MachineOperand &Def = MI.getOperand(0);
+    if (!Def.isReg() || !Def.isDef() || !Def.getReg().isVirtual() ||
+        Def.getSubReg() ||
+        MRI->getRegClass(Def.getReg()) != &RISCV::FPR64RegClass)
+      return false;
+    DefIdx[Def.getReg()] = Insts.size();
+    Insts.push_back(&MI);
+  }
+  if (Insts.size() < 2)
+    return false;
+
+  // The dependences within an iteration select the staggered operands.
+  unsigned Mask = 1;
+  SmallVector<SmallVector<unsigned, 3>, 8> Preds(Insts.size());
+  SmallVector<const MachineInstr *, 3> StreamUser(3, nullptr);
+  for (unsigned I = 0, E = Insts.size(); I != E; ++I) {
+    MachineInstr &MI = *Insts[I];
+    for (unsigned Idx = 1, OE = MI.getNumExplicitOperands(); Idx != OE;
+         ++Idx) {
+      const MachineOperand &MO = MI.getOperand(Idx);
+      if (!MO.isReg() || !MO.getReg())
+        continue;
+      auto It = DefIdx.find(MO.getReg());
+      if (It == DefIdx.end())
+        continue;
+      if (Idx > 3)
+        return false;
+      Mask |= 1 << Idx;
+      Preds[I].push_back(It->second);
+    }
+    for (const MachineOperand &MO : MI.operands())
+      if (MO.isReg() && MO.getReg().isPhysical())
+        for (unsigned S = 0; S < 3; ++S)
+          if (TRI->regsOverlap(MO.getReg(), RISCV::F0_D + S)) {
+            if (StreamUser[S] && StreamUser[S] != &MI)
+              return false;
+            StreamUser[S] = &MI;
+          }
+  }
+  if (Mask == 1)
+    return false;
+
+  // Every instruction has to have a register in each staggered position.
+  SmallVector<Register, 4> Invariants;
+  for (MachineInstr *MI : Insts)
+    for (unsigned Idx = 1; Idx <= 3; ++Idx) {
+      if (!(Mask & (1 << Idx)))
+        continue;
+      if (Idx >= MI->getNumExplicitOperands())
+        return false;
+      const MachineOperand &MO = MI->getOperand(Idx);
+      if (!MO.isReg() || !MO.getReg().isVirtual() || MO.getSubReg() ||
+          MRI->getRegClass(MO.getReg()) != &RISCV::FPR64RegClass)
+        return false;
+      if (!DefIdx.count(MO.getReg()) && !is_contained(Invariants, MO.getReg()))
+        Invariants.push_back(MO.getReg());
+    }
+
+  // Temporaries are only used by later instructions of the body or after the
+  // loop.
+  SmallVector<Register, 4> LiveOuts;
+  for (MachineInstr *MI : Insts) {
+    Register Reg = MI->getOperand(0).getReg();
+    bool IsLiveOut = false;
+    for (MachineInstr &UseMI : MRI->use_nodbg_instructions(Reg)) {
+      if (!L->contains(&UseMI))
+        IsLiveOut = true;
+      else if (!is_contained(Insts, &UseMI))
+        return false;
+    }
+    if (IsLiveOut)
+      LiveOuts.push_back(Reg);
+  }
+
+  auto estimateCycles = [&](bool Inner) {
+    const unsigned B = Insts.size();
+    SmallVector<unsigned, 64> Ready(B * N, 0);
+    unsigned Cycle = 0, Done = 0;
+    for (unsigned Step = 0; Step != B * N; ++Step) {
+      unsigned I = Inner ? Step / N : Step % B;
+      unsigned K = Inner ? Step % N : Step / B;
+      for (unsigned P : Preds[I])
+        Cycle = std::max(Cycle, Ready[P * N + K]);
+      Ready[I * N + K] = Cycle + SchedModel.computeInstrLatency(Insts[I]);
+      Done = std::max(Done, Ready[I * N + K]);
+      ++Cycle;
+    }
+    return Done;
+  };
+  unsigned OuterCycles = estimateCycles(false);
+  unsigned InnerCycles = estimateCycles(true);
+  LLVM_DEBUG(dbgs() << "  frep.o: " << OuterCycles << " cycles, frep.i: "
+                    << InnerCycles << " cycles\n");
+  if (InnerCycles >= OuterCycles)
+    return false;
+
+  DenseMap<Register, MCPhysReg> Bases;
+  SmallSet<MCPhysReg, 8> Taken;
+  auto assignBase = [&](Register Reg) {
+    MCPhysReg Base = findStaggerRegs(*MF, N, Taken);
+    for (unsigned K = 0; Base && K < N; ++K)
+      Taken.insert(Base + K);
+    Bases[Reg] = Base;
+    return Base != 0;
+  };
+  for (MachineInstr *MI : Insts)
+    if (!assignBase(MI->getOperand(0).getReg()))
+      return false;
+  for (Register Reg : Invariants)
+    if (!assignBase(Reg))
+      return false;
+
+  LLVM_DEBUG(dbgs() << "  repeating each of " << Insts.size()
+                    << " instructions, stagger mask " << Mask << "\n");
+
+  DebugLoc DL = Insts.front()->getDebugLoc();
+  MachineBasicBlock::iterator InitPos = Preheader->getFirstTerminator();
+  for (Register Reg : Invariants)
+    for (unsigned K = 0; K < N; ++K) {
+      BuildMI(*Preheader, InitPos, DL, TII->get(TargetOpcode::COPY),
+              Bases[Reg] + K)
+        .addReg(Reg);
+      Body->addLiveIn(Bases[Reg] + K);
+    }
+
+  // Only the values of the last iteration remain visible after the loop.
+  for (MachineInstr *MI : Insts) {
+    Register Reg = MI->getOperand(0).getReg();
+    bool IsLiveOut = is_contained(LiveOuts, Reg);
+    for (MachineInstr &DbgMI :
+         make_early_inc_range(MRI->use_instructions(Reg)))
+      if (DbgMI.isDebugValue() && (!IsLiveOut || L->contains(&DbgMI)))
+        DbgMI.setDebugValueUndef();
+  }
+
+  // The hardware writes and reads the registers of all iterations, which is
+  // modeled by implicit operands.
+  for (MachineInstr *MI : Insts) {
+    SmallVector<std::pair<MCPhysReg, bool>, 4> Staggered;
+    for (unsigned Idx = 0; Idx <= 3; ++Idx) {
+      if (!(Mask & (1 << Idx)))
+        continue;
+      MachineOperand &MO = MI->getOperand(Idx);
+      MCPhysReg Base = Bases[MO.getReg()];
+      MO.setReg(Base);
+      MO.setIsKill(false);
+      MO.setIsDead(false);
+      Staggered.push_back({Base, Idx == 0});
+    }
+    MachineInstrBuilder MIB(*MF, MI);
+    for (auto &S : Staggered)
+      for (unsigned K = 1; K < N; ++K)
+        MIB.addReg(S.first + K,
+                   S.second ? RegState::ImplicitDefine : RegState::Implicit);
+  }
+
+  // The epilogue follows the repeated instructions and is executed once.
+  MachineBasicBlock::iterator EpiloguePos = Body->getFirstTerminator();
+  for (Register Reg : LiveOuts)
+    BuildMI(*Body, EpiloguePos, DL, TII->get(TargetOpcode::COPY), Reg)
+      .addReg(Bases[Reg] + N - 1);
+  Body->sortUniqueLiveIns();
+
+  StaggerMax = N - 1;
+  StaggerMask = Mask;
+  ++NumFrepInner;
+  return true;
+}
+
+MCPhysReg
+SNITCHFrepLoops::findStaggerRegs(const MachineFunction &MF, unsigned Num,
+                                 const SmallSet<MCPhysReg, 8> &Taken) const {
+  // Caller-saved registers only, ft0-ft2 are left to the SSRs.
+  const BitVector Reserved = TRI->getReservedRegs(MF);
+  auto IsFree = [&](MCPhysReg Reg) {
+    if (Reserved.test(Reg) || Taken.count(Reg))
+      return false;
+    for (MCRegAliasIterator AI(Reg, TRI, true); AI.isValid(); ++AI)
+      if (!MRI->reg_nodbg_empty(*AI))
+        return false;
+    return true;
+  };
+  static const std::pair<MCPhysReg, MCPhysReg> Pools[] = {
+      {RISCV::F4_D, RISCV::F7_D}, {RISCV::F28_D, RISCV::F31_D},
+      {RISCV::F10_D, RISCV::F17_D}};
+  for (auto &Pool : Pools)
+    for (MCPhysReg Base = Pool.first; Base + Num - 1 <= Pool.second; ++Base) {
+      bool Fits = true;
+      for (unsigned i = 0; i < Num && Fits; ++i)
+        Fits = IsFree(Base + i);
+      if (Fits)
+        return Base;
+    }
+  return 0;
+}
+
+/// Split the single-block loop L into the frep body, which keeps all floating
+/// point instructions, and an integer loop placed after it:
+///
+///   Preheader -> Body -> IntLoop -> LoopSucc
+///                        ^     |
+///                        +-----+
+///
+/// The integer loop receives the integer PHIs, the induction variable, the
+/// decoupled integer instructions and the loop branch. Since the body and the
+/// integer loop do not share any register, both run independently.
+MachineBasicBlock *SNITCHFrepLoops::splitIntegerLoop(MachineLoop *L,
+                                                     MachineBasicBlock *LoopSucc) {
+  MachineBasicBlock *Body = L->getHeader();
+  MachineFunction *MF = Body->getParent();
+  MachineBasicBlock *IntLoop = MF->CreateMachineBasicBlock(Body->getBasicBlock());
+  MF->insert(std::next(Body->getIterator()), IntLoop);
+
+  for (MachineInstr &MI : make_early_inc_range(*Body))
+    if (!isFrepBodyInstruction(MI))
+      IntLoop->splice(IntLoop->end(), Body, MI.getIterator());
+
+  // incoming values from the preheader now arrive from the body, the
+  // backedge values from the integer loop itself
+  for (MachineInstr &Phi : IntLoop->phis())
+    for (unsigned i = 2, e = Phi.getNumOperands(); i < e; i += 2) {
+      MachineOperand &MO = Phi.getOperand(i);
+      MO.setMBB(MO.getMBB() == Body ? IntLoop : Body);
+    }
+  for (MachineInstr &Term : IntLoop->terminators())
+    for (MachineOperand &MO : Term.operands())
+      if (MO.isMBB() && MO.getMBB() == Body)
+        MO.setMBB(IntLoop);
+
+  IntLoop->transferSuccessors(Body);
+  IntLoop->replaceSuccessor(Body, IntLoop);
+  Body->addSuccessor(IntLoop);
+  for (MachineBasicBlock *Succ : IntLoop->successors())
+    if (Succ != IntLoop)
+      Succ->replacePhiUsesWith(Body, IntLoop);
+  for (const auto &LI : Body->liveins())
+    IntLoop->addLiveIn(LI);
+
+  MDT->addNewBlock(IntLoop, Body);
+  if (MDT->getNode(LoopSucc)->getIDom()->getBlock() == Body)
+    MDT->changeImmediateDominator(LoopSucc, IntLoop);
+
+  LLVM_DEBUG(dbgs() << "split off integer loop "; IntLoop->dump());
+  return IntLoop;
 }
 
 const MachineInstr * SNITCHFrepLoops::findBranchInstruction(MachineLoop *L) {
@@ -1339,7 +2012,70 @@ CountValue *SNITCHFrepLoops::computeCount(MachineLoop *Loop,
     LLVM_DEBUG(dbgs() << "Found trip count = "<<Count<<"\n");
     return new CountValue(CountValue::CV_Immediate, Count);
   }
-  return nullptr;
+
+  // A register trip count is computed in the preheader as
+  //   (|End - Start| + Adjust) >> log2(|IVBump|)
+  // which requires a power-of-two bump to avoid a division.
+  uint64_t AbsBump = std::abs(IVBump);
+  if (!isPowerOf2_64(AbsBump))
+    return nullptr;
+  // For NE the distance must be an exact multiple of the bump, otherwise
+  // the loop does not terminate anyway.
+  bool CmpIsNE = Cmp & Comparison::NE;
+  if (!CmpIsNE && !CmpLess && !CmpGreater)
+    return nullptr;
+
+  auto getReg = [&](const MachineOperand *MO, bool IsImm,
+                    int64_t Imm) -> unsigned {
+    if (!IsImm)
+      return MO->getReg();
+    if (Imm == 0)
+      return RISCV::X0;
+    if (!isInt<12>(Imm))
+      return 0;
+    unsigned R = MRI->createVirtualRegister(IntRC);
+    BuildMI(*PH, InsertPos, DL, TII->get(RISCV::ADDI), R)
+      .addReg(RISCV::X0).addImm(Imm);
+    return R;
+  };
+  unsigned StartReg = getReg(Start, startIsImm, immStart);
+  unsigned EndReg = getReg(End, endIsImm, immEnd);
+  if (!StartReg || !EndReg)
+    return nullptr;
+
+  unsigned DistReg = MRI->createVirtualRegister(IntRC);
+  if (IVBump > 0)
+    BuildMI(*PH, InsertPos, DL, TII->get(RISCV::SUB), DistReg)
+      .addReg(EndReg).addReg(StartReg);
+  else
+    BuildMI(*PH, InsertPos, DL, TII->get(RISCV::SUB), DistReg)
+      .addReg(StartReg).addReg(EndReg);
+
+  // Round up for inexact strict comparisons; inclusive comparisons run
+  // floor(|End - Start| / |IVBump|) + 1 times.
+  int64_t Adjust = 0;
+  if (CmpHasEqual)
+    Adjust = AbsBump;
+  else if (!CmpIsNE)
+    Adjust = AbsBump - 1;
+  if (Adjust) {
+    if (!isInt<12>(Adjust))
+      return nullptr;
+    unsigned AdjReg = MRI->createVirtualRegister(IntRC);
+    BuildMI(*PH, InsertPos, DL, TII->get(RISCV::ADDI), AdjReg)
+      .addReg(DistReg).addImm(Adjust);
+    DistReg = AdjReg;
+  }
+  if (AbsBump > 1) {
+    unsigned ShReg = MRI->createVirtualRegister(IntRC);
+    BuildMI(*PH, InsertPos, DL, TII->get(RISCV::SRLI), ShReg)
+      .addReg(DistReg).addImm(Log2_64(AbsBump));
+    DistReg = ShReg;
+  }
+
+  LLVM_DEBUG(dbgs() << "Found trip count in register "
+                    << printReg(DistReg, TRI) << "\n");
+  return new CountValue(CountValue::CV_Register, DistReg);
 }
 
 /// Returns true if the instruction is dead.  This was essentially
@@ -1545,6 +2281,7 @@ INITIALIZE_PASS_BEGIN(SNITCHFrepLoops, DEBUG_TYPE,
                       SNITCH_FREP_LOOPS_NAME, false, false)
 INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
 INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineOptimizationRemarkEmitterPass)
 INITIALIZE_PASS_END(SNITCHFrepLoops, DEBUG_TYPE,
                     SNITCH_FREP_LOOPS_NAME, false, false)
 
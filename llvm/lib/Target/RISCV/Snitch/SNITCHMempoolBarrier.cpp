@@ -0,0 +1,198 @@
+//===-- SNITCHMempoolBarrier.cpp - Expand MemPool tree barriers -----------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass expands the MemPool barrier builtin
+//
+//   __builtin_mempool_barrier(counters, wake_up, CoresPerTile, TilesPerGroup,
+//                             NumGroups);
+//
+// into a counter tree following the hierarchy of the cluster. A single
+// central counter serializes all cores on one bank; here each core only
+// increments the counter of its tile with an AMO. The last core arriving at
+// a tile continues with the counter of its group, the last tile of a group
+// with the counter of the cluster. The core completing the cluster counter
+// wakes up all cores, every core then sleeps until it is woken up:
+//
+//   tile = hartid / CoresPerTile; group = tile / TilesPerGroup;
+//   if (amoadd(&counters[tile], 1) == CoresPerTile - 1) {
+//     counters[tile] = 0;
+//     if (amoadd(&counters[NumTiles + group], 1) == TilesPerGroup - 1) {
+//       counters[NumTiles + group] = 0;
+//       if (amoadd(&counters[NumTiles + NumGroups], 1) == NumGroups - 1) {
+//         counters[NumTiles + NumGroups] = 0;
+//         *wake_up = -1;
+//       }
+//     }
+//   }
+//   wfi;
+//
+// The counters array holds NumTiles + NumGroups + 1 words which are zero
+// before the first barrier. A counter is only reset by the last core arriving
+// at it, while all other cores of the subtree are asleep, so it is zero again
+// before any core can arrive at the next barrier. The wake-up of the core
+// completing the barrier is pending when it executes the wfi, which then
+// returns immediately.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-mempool-barrier"
+#define SNITCH_MEMPOOL_BARRIER_NAME "MemPool barrier expansion"
+
+STATISTIC(NumBarriers, "Number of MemPool barriers expanded");
+
+namespace {
+
+class SNITCHMempoolBarrier : public FunctionPass {
+public:
+  static char ID;
+
+  SNITCHMempoolBarrier() : FunctionPass(ID) {
+    initializeSNITCHMempoolBarrierPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return SNITCH_MEMPOOL_BARRIER_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  /// Replace the barrier intrinsic \p Barrier by the counter tree.
+  void expandBarrier(IntrinsicInst *Barrier);
+};
+
+} // end anonymous namespace
+
+char SNITCHMempoolBarrier::ID = 0;
+
+bool SNITCHMempoolBarrier::runOnFunction(Function &F) {
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  if (!TM.getSubtargetImpl(F)->hasExtXmempool())
+    return false;
+
+  SmallVector<IntrinsicInst *, 4> Barriers;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (auto *II = dyn_cast<IntrinsicInst>(&I))
+        if (II->getIntrinsicID() == Intrinsic::riscv_mempool_barrier)
+          Barriers.push_back(II);
+
+  for (IntrinsicInst *Barrier : Barriers)
+    expandBarrier(Barrier);
+  return !Barriers.empty();
+}
+
+void SNITCHMempoolBarrier::expandBarrier(IntrinsicInst *Barrier) {
+  LLVM_DEBUG(dbgs() << "Expanding " << *Barrier << "\n");
+
+  auto getImm = [&](unsigned Idx) {
+    return cast<ConstantInt>(Barrier->getArgOperand(Idx))->getZExtValue();
+  };
+  uint64_t CoresPerTile = getImm(2);
+  uint64_t TilesPerGroup = getImm(3);
+  uint64_t NumGroups = getImm(4);
+  uint64_t NumTiles = TilesPerGroup * NumGroups;
+
+  IRBuilder<> Builder(Barrier);
+  LLVMContext &Ctx = Builder.getContext();
+  Type *I32Ty = Builder.getInt32Ty();
+  Value *Counters = Builder.CreateBitCast(Barrier->getArgOperand(0),
+                                          I32Ty->getPointerTo());
+  Value *WakeUp =
+      Builder.CreateBitCast(Barrier->getArgOperand(1), I32Ty->getPointerTo());
+
+  InlineAsm *ReadHartId = InlineAsm::get(FunctionType::get(I32Ty, false),
+                                         "csrr $0, mhartid", "=r", false);
+  Value *Tile = Builder.CreateUDiv(Builder.CreateCall(ReadHartId),
+                                   Builder.getInt32(CoresPerTile), "tile");
+  Value *Group =
+      Builder.CreateUDiv(Tile, Builder.getInt32(TilesPerGroup), "group");
+
+  // The levels of the tree with the index of the counter and the number of
+  // arrivals completing it.
+  std::pair<Value *, uint64_t> Levels[] = {
+      {Tile, CoresPerTile},
+      {Builder.CreateAdd(Group, Builder.getInt32(NumTiles)), TilesPerGroup},
+      {Builder.getInt32(NumTiles + NumGroups), NumGroups}};
+
+  // Split off the sleep; every level either falls through to the next one or
+  // branches to it.
+  BasicBlock *Entry = Barrier->getParent();
+  BasicBlock *Sleep = SplitBlock(Entry, Barrier);
+  Sleep->setName("barrier.sleep");
+  Entry->getTerminator()->eraseFromParent();
+  Function *F = Entry->getParent();
+
+  BasicBlock *BB = Entry;
+  for (const auto &Level : Levels) {
+    Builder.SetInsertPoint(BB);
+    Value *Counter = Builder.CreateGEP(I32Ty, Counters, Level.first);
+    Value *Arrived = Builder.CreateAtomicRMW(
+        AtomicRMWInst::Add, Counter, Builder.getInt32(1),
+        AtomicOrdering::AcquireRelease);
+    Value *Last =
+        Builder.CreateICmpEQ(Arrived, Builder.getInt32(Level.second - 1));
+    BasicBlock *Next = BasicBlock::Create(Ctx, "barrier.last", F, Sleep);
+    Builder.CreateCondBr(Last, Next, Sleep);
+
+    Builder.SetInsertPoint(Next);
+    StoreInst *Reset = Builder.CreateAlignedStore(Builder.getInt32(0), Counter,
+                                                  Align(4));
+    Reset->setAtomic(AtomicOrdering::Monotonic);
+    BB = Next;
+  }
+
+  // The last core of the cluster wakes up everybody.
+  Builder.SetInsertPoint(BB);
+  Builder.CreateFence(AtomicOrdering::Release);
+  Builder.CreateAlignedStore(Builder.getInt32(-1), WakeUp, Align(4),
+                             /*isVolatile=*/true);
+  Builder.CreateBr(Sleep);
+
+  Builder.SetInsertPoint(Barrier);
+  InlineAsm *Wfi = InlineAsm::get(FunctionType::get(Builder.getVoidTy(), false),
+                                  "wfi", "~{memory}", true);
+  Builder.CreateCall(Wfi);
+  Barrier->eraseFromParent();
+  ++NumBarriers;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHMempoolBarrier, DEBUG_TYPE,
+                      SNITCH_MEMPOOL_BARRIER_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(SNITCHMempoolBarrier, DEBUG_TYPE,
+                    SNITCH_MEMPOOL_BARRIER_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHMempoolBarrierPass() {
+    return new SNITCHMempoolBarrier();
+  }
+} // end of namespace llvm
@@ -0,0 +1,366 @@
+//===-- SNITCHOpenMPLowering.cpp - Bare-metal OpenMP on Snitch clusters ---===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass lowers the OpenMP runtime calls emitted by clang for
+//
+//   #pragma omp parallel for
+//
+// to bare-metal code for a Snitch cluster, so that no OpenMP runtime has to
+// be linked in. Snitch programs are SPMD: all cores of the cluster, the
+// compute cores and the DMA core after them, run main and compute their part
+// of the work from mhartid. Clang already outlines the body of the parallel
+// region into a microtask; the pass lets every core call it directly and
+// replaces the calls of the runtime by a few instructions:
+//
+//   __kmpc_fork_call(loc, n, microtask, args...)
+//     -> tid = core index; microtask(&tid, &tid, args...); barrier
+//   __kmpc_for_static_init_{4,4u,8,8u}(loc, gtid, sched, &last, &lb, &ub,
+//                                      &stride, 1, chunk)
+//     -> static partition of [lb, ub] over the compute cores by core index
+//   __kmpc_for_static_fini, __kmpc_push_num_threads -> removed
+//   __kmpc_barrier(loc, gtid) -> cluster hardware barrier
+//   __kmpc_global_thread_num(loc) -> core index
+//
+// The core index is mhartid modulo the number of cores of the cluster, the
+// DMA core has index -snitch-omp-compute-cores. It takes part in the
+// parallel regions and their barriers, but is assigned no iterations of the
+// worksharing loops. In turn, only the DMA core issues the Xdma transfers of
+// a microtask, the compute cores skip them and read zero as their transfer
+// ids and status:
+//
+//   #pragma omp parallel
+//   {
+//     __builtin_sdma_wait(__builtin_sdma_start_oned(...)); // DMA core only
+//   #pragma omp barrier
+//   #pragma omp for
+//     for (...)                                          // compute cores only
+//   }
+//
+// The hardware barrier is the read of the barrier CSR of the cluster, which
+// stalls until all cores of the cluster have read it.
+//
+// Loops with other schedules, reductions and the remaining constructs still
+// call the runtime.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-openmp-lowering"
+#define SNITCH_OPENMP_LOWERING_NAME "Snitch bare-metal OpenMP lowering"
+
+static cl::opt<bool> EnableOpenMPLowering(
+    "snitch-omp-spmd", cl::init(false), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Lower OpenMP parallel regions and loops to SPMD code for the "
+             "cores of a Snitch cluster"));
+
+static cl::opt<unsigned> NumComputeCores(
+    "snitch-omp-compute-cores", cl::init(8), cl::Hidden,
+    cl::desc("Number of compute cores of a Snitch cluster, the DMA core "
+             "follows them"));
+
+STATISTIC(NumParallel, "Number of parallel regions forked without runtime");
+STATISTIC(NumLoops, "Number of worksharing loops partitioned by core index");
+STATISTIC(NumBarriers, "Number of OpenMP barriers using the hardware barrier");
+STATISTIC(NumDMAGuarded, "Number of DMA operations left to the DMA core");
+
+namespace {
+
+// Schedule types of the runtime, see kmp.h.
+enum : uint64_t {
+  kmp_sch_static_chunked = 33,
+  kmp_sch_static = 34,
+  kmp_sch_modifier_mask = 3u << 29,
+};
+
+class SNITCHOpenMPLowering : public ModulePass {
+public:
+  static char ID;
+
+  SNITCHOpenMPLowering() : ModulePass(ID) {
+    initializeSNITCHOpenMPLoweringPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_OPENMP_LOWERING_NAME;
+  }
+
+private:
+  /// The index of the executing core in its cluster, computed once at the
+  /// entry of every function.
+  DenseMap<Function *, Value *> CoreIndices;
+
+  Value *getCoreIndex(Function &F);
+
+  /// Insert the cluster hardware barrier before \p At.
+  void createBarrier(Instruction *At);
+
+  void lowerForkCall(CallBase *Fork);
+  bool lowerStaticInit(CallBase *Init);
+  void guardDMAOperation(IntrinsicInst *DMA);
+};
+
+} // end anonymous namespace
+
+char SNITCHOpenMPLowering::ID = 0;
+
+Value *SNITCHOpenMPLowering::getCoreIndex(Function &F) {
+  Value *&Index = CoreIndices[&F];
+  if (Index)
+    return Index;
+  IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+  Type *I32Ty = Builder.getInt32Ty();
+  InlineAsm *ReadHartId = InlineAsm::get(FunctionType::get(I32Ty, false),
+                                         "csrr $0, mhartid", "=r", false);
+  Index = Builder.CreateURem(Builder.CreateCall(ReadHartId),
+                             Builder.getInt32(NumComputeCores + 1),
+                             "core.idx");
+  return Index;
+}
+
+void SNITCHOpenMPLowering::createBarrier(Instruction *At) {
+  IRBuilder<> Builder(At);
+  InlineAsm *Barrier =
+      InlineAsm::get(FunctionType::get(Builder.getVoidTy(), false),
+                     "csrr x0, 0x7c2", "~{memory}", true);
+  Builder.CreateCall(Barrier);
+}
+
+void SNITCHOpenMPLowering::lowerForkCall(CallBase *Fork) {
+  LLVM_DEBUG(dbgs() << "Forking " << *Fork << "\n");
+  IRBuilder<> Builder(Fork);
+  Function &F = *Fork->getFunction();
+  Type *I32Ty = Builder.getInt32Ty();
+
+  // The global and the bound thread id of the microtask are both the core
+  // index.
+  IRBuilder<> EntryBuilder(&*F.getEntryBlock().getFirstInsertionPt());
+  AllocaInst *Tid = EntryBuilder.CreateAlloca(I32Ty, nullptr, "omp.tid");
+  Builder.CreateStore(getCoreIndex(F), Tid);
+
+  SmallVector<Value *, 8> Args = {Tid, Tid};
+  SmallVector<Type *, 8> Params = {Tid->getType(), Tid->getType()};
+  for (Value *Arg : drop_begin(Fork->args(), 3)) {
+    Args.push_back(Arg);
+    Params.push_back(Arg->getType());
+  }
+  auto *MicrotaskTy = FunctionType::get(Builder.getVoidTy(), Params, false);
+  Value *Microtask = Builder.CreateBitCast(Fork->getArgOperand(2),
+                                          MicrotaskTy->getPointerTo());
+  Builder.CreateCall(MicrotaskTy, Microtask, Args);
+
+  // The join.
+  createBarrier(Fork);
+  Fork->eraseFromParent();
+  ++NumParallel;
+}
+
+bool SNITCHOpenMPLowering::lowerStaticInit(CallBase *Init) {
+  auto *Sched = dyn_cast<ConstantInt>(Init->getArgOperand(2));
+  auto *Incr = dyn_cast<ConstantInt>(Init->getArgOperand(7));
+  if (!Sched || !Incr || !Incr->isOne())
+    return false;
+  uint64_t Schedule = Sched->getZExtValue() & ~uint64_t(kmp_sch_modifier_mask);
+  if (Schedule != kmp_sch_static && Schedule != kmp_sch_static_chunked)
+    return false;
+  LLVM_DEBUG(dbgs() << "Partitioning " << *Init << "\n");
+
+  IRBuilder<> Builder(Init);
+  Function &F = *Init->getFunction();
+  Value *LastIter = Init->getArgOperand(3);
+  Value *LowerPtr = Init->getArgOperand(4);
+  Value *UpperPtr = Init->getArgOperand(5);
+  Value *StridePtr = Init->getArgOperand(6);
+  Type *IVTy = Init->getArgOperand(8)->getType();
+
+  // All computations are unsigned, the trip count is positive.
+  Value *Index = Builder.CreateZExtOrTrunc(getCoreIndex(F), IVTy);
+  Value *NumThreads = ConstantInt::get(IVTy, NumComputeCores);
+  Value *One = ConstantInt::get(IVTy, 1);
+  Value *Lower = Builder.CreateLoad(IVTy, LowerPtr, "omp.lb");
+  Value *Upper = Builder.CreateLoad(IVTy, UpperPtr, "omp.ub");
+  Value *Trip = Builder.CreateAdd(Builder.CreateSub(Upper, Lower), One);
+  Value *IsDMACore = Builder.CreateICmpEQ(Index, NumThreads, "omp.dm");
+
+  Value *NewLower, *NewUpper, *Stride, *Last;
+  if (Schedule == kmp_sch_static) {
+    // One contiguous block per core, the first Trip % NumThreads cores get
+    // one iteration more.
+    Value *Small = Builder.CreateUDiv(Trip, NumThreads);
+    Value *Extras = Builder.CreateURem(Trip, NumThreads);
+    Value *HasExtra = Builder.CreateICmpULT(Index, Extras);
+    Value *Skipped = Builder.CreateAdd(
+        Builder.CreateMul(Index, Small),
+        Builder.CreateSelect(HasExtra, Index, Extras));
+    NewLower = Builder.CreateAdd(Lower, Skipped);
+    NewUpper = Builder.CreateSub(
+        Builder.CreateAdd(NewLower, Small),
+        Builder.CreateSelect(HasExtra, ConstantInt::get(IVTy, 0), One));
+    Stride = Trip;
+    Value *Active = Builder.CreateSelect(
+        Builder.CreateICmpULT(Trip, NumThreads), Trip, NumThreads);
+    Last = Builder.CreateICmpEQ(Index, Builder.CreateSub(Active, One));
+  } else {
+    // Round robin over chunks of Chunk iterations.
+    Value *Chunk = Init->getArgOperand(8);
+    NewLower = Builder.CreateAdd(Lower, Builder.CreateMul(Index, Chunk));
+    NewUpper = Builder.CreateSub(Builder.CreateAdd(NewLower, Chunk), One);
+    Stride = Builder.CreateMul(NumThreads, Chunk);
+    Value *LastChunk = Builder.CreateUDiv(Builder.CreateSub(Trip, One), Chunk);
+    Last = Builder.CreateICmpEQ(Index,
+                                Builder.CreateURem(LastChunk, NumThreads));
+  }
+
+  // The DMA core gets an empty range.
+  NewLower = Builder.CreateSelect(IsDMACore, Builder.CreateAdd(Upper, One),
+                                  NewLower);
+  NewUpper = Builder.CreateSelect(IsDMACore, Upper, NewUpper);
+  Builder.CreateStore(NewLower, LowerPtr);
+  Builder.CreateStore(NewUpper, UpperPtr);
+  Builder.CreateStore(Stride, StridePtr);
+  Builder.CreateStore(Builder.CreateZExt(Last, Builder.getInt32Ty()),
+                      LastIter);
+  Init->eraseFromParent();
+  ++NumLoops;
+  return true;
+}
+
+void SNITCHOpenMPLowering::guardDMAOperation(IntrinsicInst *DMA) {
+  LLVM_DEBUG(dbgs() << "Guarding " << *DMA << "\n");
+  Function &F = *DMA->getFunction();
+  Value *Index = getCoreIndex(F);
+
+  BasicBlock *Head = DMA->getParent();
+  BasicBlock *Tail = SplitBlock(Head, DMA->getNextNode());
+  BasicBlock *Issue = SplitBlock(Head, DMA);
+  Issue->setName("dm.issue");
+  Head->getTerminator()->eraseFromParent();
+  IRBuilder<> Builder(Head);
+  Builder.CreateCondBr(
+      Builder.CreateICmpEQ(Index, Builder.getInt32(NumComputeCores)), Issue,
+      Tail);
+
+  if (!DMA->getType()->isVoidTy()) {
+    Builder.SetInsertPoint(&Tail->front());
+    PHINode *Result = Builder.CreatePHI(DMA->getType(), 2);
+    DMA->replaceAllUsesWith(Result);
+    Result->addIncoming(DMA, Issue);
+    Result->addIncoming(Constant::getNullValue(DMA->getType()), Head);
+  }
+  ++NumDMAGuarded;
+}
+
+static bool isDMAOperation(const IntrinsicInst &II) {
+  switch (II.getIntrinsicID()) {
+  case Intrinsic::riscv_sdma_start_oned:
+  case Intrinsic::riscv_sdma_start_twod:
+  case Intrinsic::riscv_sdma_start_threed:
+  case Intrinsic::riscv_sdma_stat:
+  case Intrinsic::riscv_sdma_wait_for_idle:
+  case Intrinsic::riscv_sdma_wait:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Collect the calls of the runtime function \p Name.
+static SmallVector<CallBase *, 8> getRuntimeCalls(Module &M, StringRef Name) {
+  SmallVector<CallBase *, 8> Calls;
+  if (Function *Fn = M.getFunction(Name))
+    for (User *U : Fn->users())
+      if (auto *CB = dyn_cast<CallBase>(U))
+        if (CB->getCalledFunction() == Fn)
+          Calls.push_back(CB);
+  return Calls;
+}
+
+bool SNITCHOpenMPLowering::runOnModule(Module &M) {
+  if (!EnableOpenMPLowering)
+    return false;
+  CoreIndices.clear();
+  bool Changed = false;
+
+  SmallPtrSet<Function *, 8> Microtasks;
+  for (CallBase *Fork : getRuntimeCalls(M, "__kmpc_fork_call")) {
+    if (auto *Microtask = dyn_cast<Function>(
+            Fork->getArgOperand(2)->stripPointerCasts()))
+      Microtasks.insert(Microtask);
+    lowerForkCall(Fork);
+    Changed = true;
+  }
+
+  for (StringRef Name :
+       {"__kmpc_for_static_init_4", "__kmpc_for_static_init_4u",
+        "__kmpc_for_static_init_8", "__kmpc_for_static_init_8u"})
+    for (CallBase *Init : getRuntimeCalls(M, Name))
+      Changed |= lowerStaticInit(Init);
+
+  for (CallBase *Barrier : getRuntimeCalls(M, "__kmpc_barrier")) {
+    createBarrier(Barrier);
+    Barrier->eraseFromParent();
+    ++NumBarriers;
+    Changed = true;
+  }
+
+  for (CallBase *Call : getRuntimeCalls(M, "__kmpc_global_thread_num")) {
+    Call->replaceAllUsesWith(getCoreIndex(*Call->getFunction()));
+    Call->eraseFromParent();
+    Changed = true;
+  }
+
+  for (StringRef Name : {"__kmpc_for_static_fini", "__kmpc_push_num_threads"})
+    for (CallBase *Call : getRuntimeCalls(M, Name)) {
+      Call->eraseFromParent();
+      Changed = true;
+    }
+
+  for (Function *Microtask : Microtasks) {
+    SmallVector<IntrinsicInst *, 8> DMAs;
+    for (BasicBlock &BB : *Microtask)
+      for (Instruction &I : BB)
+        if (auto *II = dyn_cast<IntrinsicInst>(&I))
+          if (isDMAOperation(*II))
+            DMAs.push_back(II);
+    for (IntrinsicInst *DMA : DMAs)
+      guardDMAOperation(DMA);
+    Changed |= !DMAs.empty();
+  }
+  return Changed;
+}
+
+INITIALIZE_PASS(SNITCHOpenMPLowering, DEBUG_TYPE, SNITCH_OPENMP_LOWERING_NAME,
+                false, false)
+
+namespace llvm {
+  ModulePass *createSNITCHOpenMPLoweringPass() {
+    return new SNITCHOpenMPLowering();
+  }
+} // end of namespace llvm
@@ -0,0 +1,333 @@
+//===-- SNITCHSSRConfigHoist.cpp - Hoist invariant SSR configuration ------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass removes redundant writes to the SSR configuration registers. The
+// scfgwi instructions produced by RISCVExpandSSR have side effects, so the
+// generic MachineLICM leaves them alone, and kernels working on small tiles
+// end up rewriting the same repetition, bound and stride registers in every
+// iteration of the outer loops.
+//
+// The repetition, bound and stride registers keep their value until they are
+// written again, only writing a read or write pointer launches a stream. A
+// write of such a register is hoisted into the loop preheader if
+//  - its address is an immediate and the written value is loop invariant,
+//  - it executes in every iteration, i.e. before every latch and exit,
+//  - nothing else in the loop writes or reads the register,
+//  - no stream of the same data mover is launched before it in the first
+//    iteration, and
+//  - the loop contains no calls, inline asm or scfgw/scfgr with a register
+//    address, which could access the register behind our back.
+// Loops are visited innermost first, so a write hoisted out of an inner loop
+// may continue into the preheader of the enclosing one.
+//
+// Afterwards, writes of the value a register is known to hold already are
+// erased. The known values are tracked within blocks and into blocks with a
+// single predecessor.
+//
+// The pass runs on SSA form, after the SSR pseudos are expanded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVInstrInfo.h"
+#include "../RISCVSubtarget.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineDominators.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-ssr-config-hoist"
+#define SNITCH_SSR_CONFIG_HOIST_NAME "Snitch SSR configuration hoisting"
+
+static cl::opt<bool> DisableSSRConfigHoist(
+    "snitch-ssr-config-hoist-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not hoist or remove redundant SSR configuration writes"));
+
+STATISTIC(NumHoisted, "Number of SSR configuration writes hoisted");
+STATISTIC(NumRedundant, "Number of redundant SSR configuration writes erased");
+
+namespace {
+
+/// A configuration register address, see RISCVExpandSSRInsts.cpp for the
+/// address map.
+struct SSRConfigAddr {
+  unsigned DM;
+  unsigned Reg;
+
+  explicit SSRConfigAddr(int64_t Addr) : DM(Addr & 0x1f), Reg(Addr >> 5) {}
+
+  /// Data mover 31 addresses all data movers.
+  bool overlapsDM(const SSRConfigAddr &Other) const {
+    return DM == Other.DM || DM == 0x1f || Other.DM == 0x1f;
+  }
+  bool overlaps(const SSRConfigAddr &Other) const {
+    return Reg == Other.Reg && overlapsDM(Other);
+  }
+  /// Repetition, bounds and strides only take effect at the next launch.
+  bool isState() const { return Reg >= 0x1 && Reg <= 0x9; }
+};
+
+/// Known values of the configuration registers, by address.
+using SSRConfigState = SmallDenseMap<int64_t, Register, 16>;
+
+class SNITCHSSRConfigHoist : public MachineFunctionPass {
+public:
+  static char ID;
+
+  SNITCHSSRConfigHoist() : MachineFunctionPass(ID) {
+    initializeSNITCHSSRConfigHoistPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_SSR_CONFIG_HOIST_NAME;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    AU.addRequired<MachineDominatorTree>();
+    AU.addRequired<MachineLoopInfo>();
+    AU.addPreserved<MachineDominatorTree>();
+    AU.addPreserved<MachineLoopInfo>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  MachineRegisterInfo *MRI;
+  MachineDominatorTree *MDT;
+  MachineLoopInfo *MLI;
+
+  bool hoistFromLoop(MachineLoop &L);
+  bool isLoopInvariant(Register Reg, const MachineLoop &L) const;
+  bool isSameValue(Register A, Register B) const;
+  bool removeRedundantWrites(MachineFunction &MF);
+};
+
+} // end anonymous namespace
+
+char SNITCHSSRConfigHoist::ID = 0;
+
+/// Return true if \p MI may access the SSR configuration in a way that is not
+/// visible through an immediate address.
+static bool isOpaqueConfigAccess(const MachineInstr &MI) {
+  return MI.isCall() || MI.isInlineAsm() || MI.getOpcode() == RISCV::SCFGW ||
+         MI.getOpcode() == RISCV::SCFGR;
+}
+
+bool SNITCHSSRConfigHoist::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableSSRConfigHoist || skipFunction(MF.getFunction()))
+    return false;
+  if (!MF.getSubtarget<RISCVSubtarget>().hasExtXssr())
+    return false;
+
+  MRI = &MF.getRegInfo();
+  MDT = &getAnalysis<MachineDominatorTree>();
+  MLI = &getAnalysis<MachineLoopInfo>();
+
+  bool Changed = false;
+  // Innermost loops first.
+  SmallVector<MachineLoop *, 8> Worklist(MLI->begin(), MLI->end());
+  SmallVector<MachineLoop *, 8> Loops;
+  while (!Worklist.empty()) {
+    MachineLoop *L = Worklist.pop_back_val();
+    Loops.push_back(L);
+    Worklist.append(L->begin(), L->end());
+  }
+  for (MachineLoop *L : reverse(Loops))
+    Changed |= hoistFromLoop(*L);
+
+  Changed |= removeRedundantWrites(MF);
+  return Changed;
+}
+
+bool SNITCHSSRConfigHoist::isLoopInvariant(Register Reg,
+                                           const MachineLoop &L) const {
+  if (Reg == RISCV::X0)
+    return true;
+  if (!Reg.isVirtual())
+    return false;
+  const MachineInstr *Def = MRI->getVRegDef(Reg);
+  return Def && !L.contains(Def->getParent());
+}
+
+bool SNITCHSSRConfigHoist::hoistFromLoop(MachineLoop &L) {
+  MachineBasicBlock *Preheader = L.getLoopPreheader();
+  if (!Preheader)
+    return false;
+
+  SmallVector<MachineInstr *, 8> Writes;
+  SmallVector<MachineInstr *, 8> Launches;
+  SmallVector<MachineInstr *, 4> Reads;
+  for (MachineBasicBlock *MBB : L.blocks()) {
+    for (MachineInstr &MI : *MBB) {
+      if (isOpaqueConfigAccess(MI))
+        return false;
+      if (MI.getOpcode() == RISCV::SCFGRI) {
+        Reads.push_back(&MI);
+      } else if (MI.getOpcode() == RISCV::SCFGWI) {
+        if (SSRConfigAddr(MI.getOperand(1).getImm()).isState())
+          Writes.push_back(&MI);
+        else
+          Launches.push_back(&MI);
+      }
+    }
+  }
+  if (Writes.empty())
+    return false;
+
+  SmallVector<MachineBasicBlock *, 4> MustExecute;
+  L.getExitingBlocks(MustExecute);
+  L.getLoopLatches(MustExecute);
+
+  bool Changed = false;
+  for (MachineInstr *W : Writes) {
+    SSRConfigAddr Addr(W->getOperand(1).getImm());
+    Register Val = W->getOperand(0).getReg();
+    MachineBasicBlock *MBB = W->getParent();
+    if (!isLoopInvariant(Val, L))
+      continue;
+
+    // The write has to happen in every iteration, and it must be the only
+    // access to the register in the loop.
+    if (any_of(MustExecute, [&](MachineBasicBlock *B) {
+          return !MDT->dominates(MBB, B);
+        }))
+      continue;
+    if (any_of(Writes, [&](MachineInstr *Other) {
+          return Other != W &&
+                 Addr.overlaps(SSRConfigAddr(Other->getOperand(1).getImm()));
+        }))
+      continue;
+    if (any_of(Reads, [&](MachineInstr *R) {
+          return Addr.overlaps(SSRConfigAddr(R->getOperand(1).getImm()));
+        }))
+      continue;
+
+    // A stream launched before the write in the first iteration would see
+    // the hoisted value instead of the one from before the loop.
+    bool LaunchedBefore = any_of(Launches, [&](MachineInstr *Launch) {
+      if (!Addr.overlapsDM(SSRConfigAddr(Launch->getOperand(1).getImm())))
+        return false;
+      if (Launch->getParent() != MBB)
+        return !MDT->dominates(MBB, Launch->getParent());
+      for (MachineInstr &MI : *MBB) {
+        if (&MI == W)
+          return false;
+        if (&MI == Launch)
+          return true;
+      }
+      return false;
+    });
+    if (LaunchedBefore)
+      continue;
+
+    LLVM_DEBUG(dbgs() << "Hoisting into " << printMBBReference(*Preheader)
+                      << ": " << *W);
+    Preheader->splice(Preheader->getFirstTerminator(), MBB, W);
+    if (Val.isVirtual())
+      MRI->clearKillFlags(Val);
+    ++NumHoisted;
+    Changed = true;
+  }
+  return Changed;
+}
+
+/// Return the value of \p Reg if it is zero or materialized by a single li.
+static Optional<int64_t> getConstantValue(Register Reg,
+                                          const MachineRegisterInfo &MRI) {
+  if (Reg == RISCV::X0)
+    return 0;
+  if (!Reg.isVirtual())
+    return None;
+  const MachineInstr *Def = MRI.getVRegDef(Reg);
+  if (!Def || Def->getOpcode() != RISCV::ADDI || !Def->getOperand(1).isReg() ||
+      Def->getOperand(1).getReg() != RISCV::X0 || !Def->getOperand(2).isImm())
+    return None;
+  return Def->getOperand(2).getImm();
+}
+
+bool SNITCHSSRConfigHoist::isSameValue(Register A, Register B) const {
+  if (A == B)
+    return A.isVirtual() || A == RISCV::X0;
+  Optional<int64_t> CA = getConstantValue(A, *MRI);
+  Optional<int64_t> CB = getConstantValue(B, *MRI);
+  return CA && CB && *CA == *CB;
+}
+
+bool SNITCHSSRConfigHoist::removeRedundantWrites(MachineFunction &MF) {
+  bool Changed = false;
+  DenseMap<const MachineBasicBlock *, SSRConfigState> ExitStates;
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+  for (MachineBasicBlock *MBB : RPOT) {
+    SSRConfigState Known;
+    if (MBB->pred_size() == 1) {
+      auto It = ExitStates.find(*MBB->pred_begin());
+      if (It != ExitStates.end())
+        Known = It->second;
+    }
+
+    for (MachineInstr &MI : make_early_inc_range(*MBB)) {
+      if (isOpaqueConfigAccess(MI) && MI.getOpcode() != RISCV::SCFGR) {
+        Known.clear();
+        continue;
+      }
+      if (MI.getOpcode() != RISCV::SCFGWI)
+        continue;
+      int64_t Imm = MI.getOperand(1).getImm();
+      SSRConfigAddr Addr(Imm);
+      if (!Addr.isState())
+        continue;
+      Register Val = MI.getOperand(0).getReg();
+      auto It = Known.find(Imm);
+      if (It != Known.end() && isSameValue(It->second, Val)) {
+        LLVM_DEBUG(dbgs() << "Erasing redundant " << MI);
+        MI.eraseFromParent();
+        ++NumRedundant;
+        Changed = true;
+        continue;
+      }
+      SmallVector<int64_t, 4> Clobbered;
+      for (auto &Entry : Known)
+        if (Addr.overlaps(SSRConfigAddr(Entry.first)))
+          Clobbered.push_back(Entry.first);
+      for (int64_t C : Clobbered)
+        Known.erase(C);
+      Known[Imm] = Val;
+    }
+    ExitStates[MBB] = std::move(Known);
+  }
+  return Changed;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHSSRConfigHoist, DEBUG_TYPE,
+                      SNITCH_SSR_CONFIG_HOIST_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_END(SNITCHSSRConfigHoist, DEBUG_TYPE,
+                    SNITCH_SSR_CONFIG_HOIST_NAME, false, false)
+
+namespace llvm {
+FunctionPass *createSNITCHSSRConfigHoistPass() {
+  return new SNITCHSSRConfigHoist();
+}
+} // end namespace llvm
@@ -0,0 +1,853 @@
+//===-- SNITCHSSRInference.cpp - Infer SSR streams from affine loops ------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass identifies affine loads and stores in innermost loops and maps
+// them onto the Snitch stream semantic registers (SSR). Each selected memory
+// access is replaced by an SSR pop (load) or push (store) and the data mover
+// is configured with the bound, stride and pointer in the loop preheader. The
+// loop is surrounded by an SSR enable/disable region.
+//
+// Perfectly nested parents of the innermost loop with rectangular iteration
+// spaces are collapsed into the stream configuration, up to the four
+// dimensions supported by the data movers. The streaming region then covers
+// the whole nest and the data movers are only configured once. Reads whose
+// address is invariant in the innermost loop use the repetition register
+// instead of fetching the same datum again.
+//
+// If all memory traffic of the loop could be moved into streams, the address
+// arithmetic becomes dead and the body only consists of floating-point
+// instructions and the loop bookkeeping. Such loops are marked for the FREP
+// inference in SNITCHFrepLoops which then puts the body under frep.o,
+// yielding a zero-overhead, load-free inner loop.
+//
+// The inference runs on every innermost loop with -snitch-ssr-inference and
+// otherwise only on the loops whose accesses are annotated as parallel, such
+// as '#pragma omp simd' loops in OpenMP target regions offloaded to Snitch.
+//
+// Only double-precision accesses are streamed because the SSR data registers
+// ft0-ft2 are 64 bits wide. A loop is only transformed if
+//  - it is in loop-simplify form with a single exit taken from the latch,
+//  - its backedge-taken count is computable by SCEV,
+//  - LoopAccessAnalysis proves that no memory dependence exists between the
+//    accesses, possibly subject to runtime alias checks,
+//  - for regions spanning several loops, alias analysis proves that no write
+//    stream overlaps any other access, and
+//  - it contains no calls which could clobber ft0-ft2.
+//
+// Kernels taking plain 'double *' arguments rarely carry 'restrict', so their
+// accesses may alias as far as the compiler can tell. If LoopAccessAnalysis
+// can disambiguate them with runtime pointer checks, the loop is versioned:
+// the streaming loop runs if the accessed ranges do not overlap and the
+// original loop is kept as the fallback. The checks only cover the ranges
+// accessed by the innermost loop, the streaming region of a versioned loop is
+// therefore not extended to its parents.
+//
+// Loops which are not streamed are reported as missed remarks named after the
+// reason, see RISCVLoopRemarks.h (-Rpass-missed=snitch-ssr-inference).
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVLoopRemarks.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopAccessAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopVersioning.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-ssr-inference"
+#define SNITCH_SSR_INFERENCE_NAME "Snitch SSR stream inference"
+
+#define NUM_SSR 3
+#define NUM_SSR_DIMS 4
+
+static cl::opt<bool> EnableSSRInference(
+    "snitch-ssr-inference", cl::init(false), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Enable automatic inference of SSR streams in innermost loops"));
+
+static cl::opt<bool> EnableSSRFrepFusion(
+    "snitch-ssr-frep", cl::init(true), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Mark fully streamed floating-point loops for frep inference"));
+
+static cl::opt<unsigned> SSRRuntimeCheckThreshold(
+    "snitch-ssr-runtime-check-threshold", cl::init(8), cl::Hidden,
+    cl::desc("Maximum number of runtime alias checks guarding a versioned "
+             "SSR streaming loop, 0 disables loop versioning"));
+
+STATISTIC(NumSSRLoops, "Number of loops converted to SSR streaming loops");
+STATISTIC(NumSSRStreams, "Number of memory accesses mapped to SSR streams");
+STATISTIC(NumSSRNestedStreams, "Number of multi-dimensional SSR streams");
+STATISTIC(NumSSRRepStreams, "Number of SSR streams using repetition");
+STATISTIC(NumSSRFrepLoops, "Number of streaming loops marked for frep");
+STATISTIC(NumSSRVersionedLoops,
+          "Number of streaming loops versioned with runtime alias checks");
+
+namespace {
+
+/// A single memory access that is mapped onto one SSR data mover.
+struct SSRStream {
+  /// The load or store that is replaced by the stream.
+  Instruction *Access;
+  /// data mover this stream is assigned to
+  unsigned DM;
+  /// Number of dimensions of the stream.
+  unsigned Dims = 0;
+  /// Bound (iterations minus one) and byte stride per dimension, innermost
+  /// first. The strides are absolute, i.e. the address increment of one
+  /// iteration of the respective loop.
+  const SCEV *Bounds[NUM_SSR_DIMS];
+  const SCEV *Strides[NUM_SSR_DIMS];
+  /// Address of the first datum.
+  const SCEV *Base = nullptr;
+  /// Repetition count minus one, null if every datum is fetched once.
+  const SCEV *Repeat = nullptr;
+
+  bool isWrite() const { return isa<StoreInst>(Access); }
+};
+
+class SNITCHSSRInference : public FunctionPass {
+public:
+  static char ID;
+
+  SNITCHSSRInference() : FunctionPass(ID) {
+    initializeSNITCHSSRInferencePass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override;
+
+  StringRef getPassName() const override { return SNITCH_SSR_INFERENCE_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<AAResultsWrapperPass>();
+    AU.addRequired<LoopAccessLegacyAnalysis>();
+    AU.addRequired<OptimizationRemarkEmitterWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    FunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  const RISCVSubtarget *ST;
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  AAResults *AA;
+  LoopAccessLegacyAnalysis *LAA;
+  OptimizationRemarkEmitter *ORE;
+  const DataLayout *DL;
+
+  /// Try to convert the innermost loop \p L into an SSR streaming loop.
+  bool convertToStreamingLoop(Loop *L);
+
+  /// Check the loop shape and its instructions for SSR-compatibility. On
+  /// failure \p Reason is set, and \p Culprit to the offending instruction
+  /// if there is one.
+  bool isCandidateLoop(Loop *L, RISCVLoopRemark::Reason &Reason,
+                       const Instruction *&Culprit) const;
+
+  /// Emit a missed remark for \p L, declined for \p Reason.
+  void reportMissed(Loop *L, RISCVLoopRemark::Reason Reason,
+                    const Instruction *Culprit = nullptr,
+                    StringRef What = "loop not converted to a streaming loop");
+
+  /// Return true if \p I may use the SSR data registers by itself.
+  bool mayClobberSSRRegs(const Instruction &I) const;
+
+  /// Return true if \p Inner is perfectly nested in its parent \p Outer.
+  bool isPerfectlyNested(Loop *Inner, Loop *Outer) const;
+
+  /// Collect the perfect loop nest around the innermost loop \p L, innermost
+  /// first, together with the backedge-taken counts of each level.
+  void collectNest(Loop *L, const SCEV *BTC, SmallVectorImpl<Loop *> &Nest,
+                   SmallVectorImpl<const SCEV *> &NestBTCs) const;
+
+  /// Describe the access of \p S as a stream over the loops \p Nest. Returns
+  /// false if the address is not affine in all levels.
+  bool describeStream(SSRStream &S, ArrayRef<Loop *> Nest,
+                      ArrayRef<const SCEV *> NestBTCs) const;
+
+  /// Return true if no write stream may alias any other access of \p L.
+  /// LoopAccessAnalysis only covers the innermost loop, this guards regions
+  /// spanning several loops.
+  bool isSafeRegion(Loop *L, ArrayRef<SSRStream> Streams);
+
+  /// Collect the streamable accesses of \p L in program order and return the
+  /// number of loops covered by the streaming region, or zero if the memory
+  /// dependences of the loop prevent streaming, setting \p Reason.
+  unsigned collectStreams(Loop *L, ArrayRef<Loop *> Nest,
+                          ArrayRef<const SCEV *> NestBTCs,
+                          SmallVectorImpl<SSRStream> &Streams,
+                          RISCVLoopRemark::Reason &Reason);
+
+  /// Version \p L with the runtime alias checks of LoopAccessAnalysis, such
+  /// that \p L only runs if its accesses do not overlap.
+  void versionWithRuntimeChecks(Loop *L);
+
+  /// Emit the data mover configuration of \p S before \p InsertPt.
+  void emitStreamSetup(const SSRStream &S, SCEVExpander &Expander,
+                       Instruction *InsertPt);
+
+  /// Replace the memory access of \p S with the SSR push/pop. The address
+  /// operand is appended to \p DeadInsts for later cleanup.
+  void replaceAccess(const SSRStream &S,
+                     SmallVectorImpl<WeakTrackingVH> &DeadInsts);
+
+  /// Delete the address computations which became dead by streaming.
+  void removeDeadAddressing(ArrayRef<Loop *> Region,
+                            SmallVectorImpl<WeakTrackingVH> &DeadInsts);
+
+  /// Return true if the body of \p L only contains floating-point
+  /// instructions, SSR accesses and the induction variable bookkeeping.
+  bool isFPOnlyBody(Loop *L) const;
+};
+
+} // end anonymous namespace
+
+char SNITCHSSRInference::ID = 0;
+
+/// Return true if the function already manages SSRs explicitly. We leave
+/// such functions alone since the assignment of data movers is up to the
+/// user.
+static bool hasExplicitSSRUse(const Function &F) {
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      if (const auto *II = dyn_cast<IntrinsicInst>(&I))
+        switch (II->getIntrinsicID()) {
+        case Intrinsic::riscv_ssr_enable:
+        case Intrinsic::riscv_ssr_disable:
+        case Intrinsic::riscv_ssr_push:
+        case Intrinsic::riscv_ssr_pop:
+          return true;
+        default:
+          break;
+        }
+  return false;
+}
+
+bool SNITCHSSRInference::runOnFunction(Function &F) {
+  if (skipFunction(F))
+    return false;
+
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+  ST = TM.getSubtargetImpl(F);
+  if (!ST->hasExtXssr())
+    return false;
+
+  if (hasExplicitSSRUse(F))
+    return false;
+
+  LLVM_DEBUG(dbgs() << "------------ Snitch SSR Inference ------------\n");
+
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
+  LAA = &getAnalysis<LoopAccessLegacyAnalysis>();
+  ORE = &getAnalysis<OptimizationRemarkEmitterWrapperPass>().getORE();
+  DL = &F.getParent()->getDataLayout();
+
+  SmallVector<Loop *, 8> Worklist;
+  for (Loop *TopLevel : *LI)
+    for (Loop *L : depth_first(TopLevel))
+      if (L->isInnermost() && (EnableSSRInference || L->isAnnotatedParallel()))
+        Worklist.push_back(L);
+
+  bool Changed = false;
+  for (Loop *L : Worklist)
+    Changed |= convertToStreamingLoop(L);
+
+  return Changed;
+}
+
+bool SNITCHSSRInference::mayClobberSSRRegs(const Instruction &I) const {
+  const auto *CB = dyn_cast<CallBase>(&I);
+  if (!CB)
+    return false;
+
+  // Intrinsics that lower to plain FPU instructions are safe, anything that
+  // could end up as a call might read or write ft0-ft2 behind our back.
+  if (const auto *II = dyn_cast<IntrinsicInst>(CB)) {
+    if (isa<DbgInfoIntrinsic>(II))
+      return false;
+    switch (II->getIntrinsicID()) {
+    case Intrinsic::fmuladd:
+    case Intrinsic::fma:
+    case Intrinsic::fabs:
+    case Intrinsic::sqrt:
+    case Intrinsic::minnum:
+    case Intrinsic::maxnum:
+    case Intrinsic::copysign:
+    case Intrinsic::lifetime_start:
+    case Intrinsic::lifetime_end:
+    case Intrinsic::assume:
+      return false;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+bool SNITCHSSRInference::isCandidateLoop(Loop *L,
+                                         RISCVLoopRemark::Reason &Reason,
+                                         const Instruction *&Culprit) const {
+  if (!L->isLoopSimplifyForm()) {
+    LLVM_DEBUG(dbgs() << "  loop not in simplify form\n");
+    Reason = RISCVLoopRemark::NoPreheader;
+    return false;
+  }
+
+  // The stream configuration assumes that every iteration executes all
+  // streamed accesses exactly once, hence the loop may only be left through
+  // the latch.
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!L->getExitBlock() || L->getExitingBlock() != Latch) {
+    LLVM_DEBUG(dbgs() << "  loop has multiple exits or early exit\n");
+    Reason = RISCVLoopRemark::MultipleExits;
+    return false;
+  }
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (mayClobberSSRRegs(I)) {
+        LLVM_DEBUG(dbgs() << "  loop contains call: " << I << "\n");
+        Reason = RISCVLoopRemark::InvalidInstruction;
+        Culprit = &I;
+        return false;
+      }
+
+  return true;
+}
+
+void SNITCHSSRInference::reportMissed(Loop *L, RISCVLoopRemark::Reason Reason,
+                                      const Instruction *Culprit,
+                                      StringRef What) {
+  ORE->emit([&]() {
+    OptimizationRemarkMissed R(DEBUG_TYPE, RISCVLoopRemark::getName(Reason),
+                               L->getStartLoc(), L->getHeader());
+    R << What << ": " << RISCVLoopRemark::getMessage(Reason);
+    if (Culprit)
+      R << ": " << ore::NV("Inst", Culprit);
+    return R;
+  });
+}
+
+bool SNITCHSSRInference::isPerfectlyNested(Loop *Inner, Loop *Outer) const {
+  RISCVLoopRemark::Reason Reason;
+  const Instruction *Culprit = nullptr;
+  if (Outer->getSubLoops().size() != 1 ||
+      !isCandidateLoop(Outer, Reason, Culprit))
+    return false;
+
+  // Every iteration of the outer loop has to run the inner loop exactly once.
+  if (!DT->dominates(Inner->getLoopPreheader(), Outer->getLoopLatch()))
+    return false;
+
+  // Apart from the bookkeeping, the outer loop must not touch memory.
+  for (BasicBlock *BB : Outer->blocks()) {
+    if (Inner->contains(BB))
+      continue;
+    for (Instruction &I : *BB)
+      if (I.mayReadOrWriteMemory())
+        return false;
+  }
+  return true;
+}
+
+void SNITCHSSRInference::collectNest(
+    Loop *L, const SCEV *BTC, SmallVectorImpl<Loop *> &Nest,
+    SmallVectorImpl<const SCEV *> &NestBTCs) const {
+  Nest.push_back(L);
+  NestBTCs.push_back(BTC);
+  for (Loop *P = L->getParentLoop(); P && Nest.size() < NUM_SSR_DIMS;
+       P = P->getParentLoop()) {
+    if (!isPerfectlyNested(Nest.back(), P))
+      break;
+    const SCEV *OuterBTC = SE->getBackedgeTakenCount(P);
+    if (isa<SCEVCouldNotCompute>(OuterBTC) || !isSafeToExpand(OuterBTC, *SE))
+      break;
+    // The data movers only support rectangular iteration spaces.
+    if (any_of(NestBTCs,
+               [&](const SCEV *B) { return !SE->isLoopInvariant(B, P); }))
+      break;
+    Nest.push_back(P);
+    NestBTCs.push_back(OuterBTC);
+  }
+  LLVM_DEBUG(dbgs() << "  perfect nest depth " << Nest.size() << "\n");
+}
+
+bool SNITCHSSRInference::describeStream(
+    SSRStream &S, ArrayRef<Loop *> Nest,
+    ArrayRef<const SCEV *> NestBTCs) const {
+  Loop *Outermost = Nest.back();
+  Type *Int32Ty = Type::getInt32Ty(S.Access->getContext());
+  const SCEV *Addr = SE->getSCEV(getLoadStorePointerOperand(S.Access));
+
+  S.Dims = 0;
+  S.Repeat = nullptr;
+  for (unsigned Level = 0; Level < Nest.size(); ++Level) {
+    const auto *AR = dyn_cast<SCEVAddRecExpr>(Addr);
+    if (AR && AR->getLoop() == Nest[Level]) {
+      if (!AR->isAffine())
+        return false;
+      const SCEV *Step = AR->getStepRecurrence(*SE);
+      if (!SE->isLoopInvariant(Step, Outermost) || !isSafeToExpand(Step, *SE))
+        return false;
+      S.Bounds[S.Dims] = NestBTCs[Level];
+      S.Strides[S.Dims] = Step;
+      ++S.Dims;
+      Addr = AR->getStart();
+      continue;
+    }
+
+    if (!SE->isLoopInvariant(Addr, Nest[Level]))
+      return false;
+    // A datum invariant in the innermost loop is repeatedly delivered by the
+    // data mover. Writing the same location repeatedly is not supported.
+    if (Level == 0) {
+      if (S.isWrite())
+        return false;
+      S.Repeat = NestBTCs[0];
+      continue;
+    }
+    // Outer levels revisit the same data with a zero stride.
+    S.Bounds[S.Dims] = NestBTCs[Level];
+    S.Strides[S.Dims] = SE->getZero(Int32Ty);
+    ++S.Dims;
+  }
+
+  if (!SE->isLoopInvariant(Addr, Outermost) || !isSafeToExpand(Addr, *SE))
+    return false;
+  S.Base = Addr;
+
+  // A pure repetition of a single datum still needs a (trivial) dimension.
+  if (S.Dims == 0) {
+    S.Bounds[0] = SE->getZero(Int32Ty);
+    S.Strides[0] = SE->getZero(Int32Ty);
+    S.Dims = 1;
+  }
+  return true;
+}
+
+bool SNITCHSSRInference::isSafeRegion(Loop *L, ArrayRef<SSRStream> Streams) {
+  for (const SSRStream &W : Streams) {
+    if (!W.isWrite())
+      continue;
+    MemoryLocation WLoc =
+        MemoryLocation::getAfter(getLoadStorePointerOperand(W.Access));
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB) {
+        if (&I == W.Access || !I.mayReadOrWriteMemory())
+          continue;
+        const Value *Ptr = getLoadStorePointerOperand(&I);
+        if (!Ptr || !AA->isNoAlias(WLoc, MemoryLocation::getAfter(Ptr))) {
+          LLVM_DEBUG(dbgs() << "  write stream may alias " << I << "\n");
+          return false;
+        }
+      }
+  }
+  return true;
+}
+
+unsigned SNITCHSSRInference::collectStreams(
+    Loop *L, ArrayRef<Loop *> Nest, ArrayRef<const SCEV *> NestBTCs,
+    SmallVectorImpl<SSRStream> &Streams, RISCVLoopRemark::Reason &Reason) {
+  const LoopAccessInfo &LAI = LAA->getInfo(L);
+  unsigned NumChecks = LAI.getNumRuntimePointerChecks();
+  if (!LAI.canVectorizeMemory()) {
+    LLVM_DEBUG(dbgs() << "  memory accesses not analyzable\n");
+    Reason = RISCVLoopRemark::UnanalyzableAccess;
+    return 0;
+  }
+  if (NumChecks > SSRRuntimeCheckThreshold) {
+    LLVM_DEBUG(dbgs() << "  too many runtime alias checks: " << NumChecks
+                      << "\n");
+    Reason = RISCVLoopRemark::MayAlias;
+    return 0;
+  }
+
+  // Streams read ahead and write behind the instruction stream. Even
+  // dependences which are harmless for vectorization (e.g. a store and a
+  // load of the same element within one iteration) are therefore unsafe.
+  const auto *Deps = LAI.getDepChecker().getDependences();
+  if (!Deps || !Deps->empty()) {
+    LLVM_DEBUG(dbgs() << "  loop carries memory dependences\n");
+    Reason = RISCVLoopRemark::MemoryDependence;
+    return 0;
+  }
+
+  Type *DoubleTy = Type::getDoubleTy(L->getHeader()->getContext());
+
+  // Only blocks dominating the latch execute in every iteration. They form a
+  // chain in the dominator tree, visit them top-down so that the order of the
+  // pops and pushes within an iteration matches the order of the stream.
+  SmallVector<BasicBlock *, 4> Blocks;
+  for (DomTreeNode *N = DT->getNode(L->getLoopLatch());
+       N && L->contains(N->getBlock()); N = N->getIDom())
+    Blocks.push_back(N->getBlock());
+
+  // The region covers as many loops as all selected streams support.
+  unsigned Depth = Nest.size();
+  for (BasicBlock *BB : reverse(Blocks)) {
+    for (Instruction &I : *BB) {
+      if (Streams.size() == NUM_SSR)
+        break;
+
+      Value *Ptr = nullptr;
+      Type *AccessTy = nullptr;
+      if (auto *Load = dyn_cast<LoadInst>(&I)) {
+        if (!Load->isSimple())
+          continue;
+        Ptr = Load->getPointerOperand();
+        AccessTy = Load->getType();
+      } else if (auto *SI = dyn_cast<StoreInst>(&I)) {
+        if (!SI->isSimple())
+          continue;
+        Ptr = SI->getPointerOperand();
+        AccessTy = SI->getValueOperand()->getType();
+      } else {
+        continue;
+      }
+
+      if (AccessTy != DoubleTy || Ptr->getType()->getPointerAddressSpace())
+        continue;
+
+      SSRStream S;
+      S.Access = &I;
+      S.DM = Streams.size();
+      unsigned StreamDepth = Depth;
+      while (StreamDepth &&
+             !describeStream(S, Nest.take_front(StreamDepth), NestBTCs))
+        --StreamDepth;
+      if (!StreamDepth)
+        continue;
+
+      LLVM_DEBUG(dbgs() << "  stream " << S.DM << ": " << I << "\n    over "
+                        << StreamDepth << " loops, base " << *S.Base << "\n");
+      Depth = StreamDepth;
+      Streams.push_back(S);
+    }
+  }
+  if (Streams.empty()) {
+    Reason = RISCVLoopRemark::UnanalyzableAccess;
+    return 0;
+  }
+
+  // The runtime checks do not cover the accesses of the outer iterations.
+  if (Depth > 1 && (NumChecks || !isSafeRegion(L, Streams)))
+    Depth = 1;
+
+  // Shrinking the region keeps every stream describable, the remaining
+  // address is still invariant in the new outermost loop.
+  for (SSRStream &S : Streams) {
+    bool Described = describeStream(S, Nest.take_front(Depth), NestBTCs);
+    (void)Described;
+    assert(Described && "stream not describable in smaller region");
+  }
+  return Depth;
+}
+
+void SNITCHSSRInference::versionWithRuntimeChecks(Loop *L) {
+  const LoopAccessInfo &LAI = LAA->getInfo(L);
+  LoopVersioning LVer(LAI, LAI.getRuntimePointerChecking()->getChecks(), L,
+                      LI, DT, SE);
+  LVer.versionLoop();
+  // The exit of the versioned loop is dedicated, the SSR region is left
+  // before the exit joins the fallback loop.
+  LLVM_DEBUG(dbgs() << "  versioned with "
+                    << LAI.getNumRuntimePointerChecks()
+                    << " runtime alias checks\n");
+  ++NumSSRVersionedLoops;
+}
+
+void SNITCHSSRInference::emitStreamSetup(const SSRStream &S,
+                                         SCEVExpander &Expander,
+                                         Instruction *InsertPt) {
+  IRBuilder<> Builder(InsertPt);
+  Type *Int32Ty = Builder.getInt32Ty();
+  Value *DM = Builder.getInt32(S.DM);
+
+  Value *Ptr =
+      Expander.expandCodeFor(S.Base, Builder.getInt8PtrTy(), InsertPt);
+  // repetition is written as count minus one
+  Value *Rep = S.Repeat
+                   ? Expander.expandCodeFor(
+                         SE->getTruncateOrZeroExtend(S.Repeat, Int32Ty),
+                         Int32Ty, InsertPt)
+                   : Builder.getInt32(0);
+
+  // The stride of a dimension is applied after all inner dimensions have
+  // been walked, so it is relative to the address reached by the inner
+  // dimensions: s'_d = s_d - sum_{i<d} b_i * s_i.
+  SmallVector<Value *, NUM_SSR_DIMS> Bounds, Strides;
+  const SCEV *Walked = SE->getZero(Int32Ty);
+  for (unsigned D = 0; D < S.Dims; ++D) {
+    const SCEV *Bound = SE->getTruncateOrZeroExtend(S.Bounds[D], Int32Ty);
+    const SCEV *Stride = SE->getTruncateOrSignExtend(S.Strides[D], Int32Ty);
+    const SCEV *RelStride = SE->getMinusSCEV(Stride, Walked);
+    Walked = SE->getAddExpr(Walked, SE->getMulExpr(Bound, Stride));
+    Bounds.push_back(Expander.expandCodeFor(Bound, Int32Ty, InsertPt));
+    Strides.push_back(Expander.expandCodeFor(RelStride, Int32Ty, InsertPt));
+  }
+
+  if (S.Dims == 1) {
+    Intrinsic::ID SetupID = S.isWrite() ? Intrinsic::riscv_ssr_setup_1d_w
+                                        : Intrinsic::riscv_ssr_setup_1d_r;
+    Builder.CreateIntrinsic(SetupID, {},
+                            {DM, Rep, Bounds[0], Strides[0], Ptr});
+    return;
+  }
+
+  static const Intrinsic::ID BoundStrideIDs[NUM_SSR_DIMS] = {
+      Intrinsic::riscv_ssr_setup_bound_stride_1d,
+      Intrinsic::riscv_ssr_setup_bound_stride_2d,
+      Intrinsic::riscv_ssr_setup_bound_stride_3d,
+      Intrinsic::riscv_ssr_setup_bound_stride_4d};
+  Builder.CreateIntrinsic(Intrinsic::riscv_ssr_setup_repetition, {},
+                          {DM, Rep});
+  for (unsigned D = 0; D < S.Dims; ++D)
+    Builder.CreateIntrinsic(BoundStrideIDs[D], {},
+                            {DM, Bounds[D], Strides[D]});
+  // writing the pointer starts the stream, dim is the number of dimensions
+  // minus one
+  Intrinsic::ID StartID = S.isWrite() ? Intrinsic::riscv_ssr_write_imm
+                                      : Intrinsic::riscv_ssr_read_imm;
+  Builder.CreateIntrinsic(StartID, {},
+                          {DM, Builder.getInt32(S.Dims - 1), Ptr});
+}
+
+void SNITCHSSRInference::replaceAccess(
+    const SSRStream &S, SmallVectorImpl<WeakTrackingVH> &DeadInsts) {
+  IRBuilder<> Builder(S.Access);
+  DeadInsts.push_back(getLoadStorePointerOperand(S.Access));
+  Value *DM = Builder.getInt32(S.DM);
+  if (auto *SI = dyn_cast<StoreInst>(S.Access)) {
+    Builder.CreateIntrinsic(Intrinsic::riscv_ssr_push, {},
+                            {DM, SI->getValueOperand()});
+  } else {
+    Value *Pop = Builder.CreateIntrinsic(Intrinsic::riscv_ssr_pop, {}, {DM});
+    Pop->takeName(S.Access);
+    S.Access->replaceAllUsesWith(Pop);
+  }
+  S.Access->eraseFromParent();
+}
+
+void SNITCHSSRInference::removeDeadAddressing(
+    ArrayRef<Loop *> Region, SmallVectorImpl<WeakTrackingVH> &DeadInsts) {
+  RecursivelyDeleteTriviallyDeadInstructions(DeadInsts);
+
+  // Pointer induction variables form a cycle through the header PHI and are
+  // not trivially dead.
+  SmallVector<PHINode *, 4> Phis;
+  for (Loop *L : Region)
+    for (PHINode &Phi : L->getHeader()->phis())
+      Phis.push_back(&Phi);
+  for (PHINode *Phi : Phis)
+    RecursivelyDeleteDeadPHINode(Phi);
+}
+
+bool SNITCHSSRInference::isFPOnlyBody(Loop *L) const {
+  BasicBlock *Latch = L->getLoopLatch();
+  auto *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+  auto *Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+  if (!Cmp || !L->contains(Cmp))
+    return false;
+
+  // The exit condition and the induction variable it is computed from are
+  // taken care of by the frep inference.
+  SmallPtrSet<const Instruction *, 8> Bookkeeping;
+  Bookkeeping.insert(BI);
+  Bookkeeping.insert(Cmp);
+  for (Value *Op : Cmp->operands()) {
+    auto *I = dyn_cast<Instruction>(Op);
+    if (!I || !L->contains(I))
+      continue;
+    auto *Phi = dyn_cast<PHINode>(I);
+    auto *Inc = dyn_cast<BinaryOperator>(I);
+    if (Phi)
+      Inc = dyn_cast<BinaryOperator>(Phi->getIncomingValueForBlock(Latch));
+    else if (Inc)
+      Phi = dyn_cast<PHINode>(Inc->getOperand(0));
+    if (!Phi || !Inc || Phi->getParent() != L->getHeader() ||
+        Inc->getOpcode() != Instruction::Add || Inc->getOperand(0) != Phi ||
+        !L->isLoopInvariant(Inc->getOperand(1)) ||
+        Phi->getIncomingValueForBlock(Latch) != Inc)
+      return false;
+    Bookkeeping.insert(Phi);
+    Bookkeeping.insert(Inc);
+  }
+
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB) {
+      if (Bookkeeping.count(&I)) {
+        // the bookkeeping must not feed the floating-point computation
+        for (User *U : I.users())
+          if (L->contains(cast<Instruction>(U)) &&
+              !Bookkeeping.count(cast<Instruction>(U)))
+            return false;
+        continue;
+      }
+      if (isa<DbgInfoIntrinsic>(I))
+        continue;
+      if (auto *Br = dyn_cast<BranchInst>(&I)) {
+        if (Br->isUnconditional())
+          continue;
+        return false;
+      }
+      if (auto *II = dyn_cast<IntrinsicInst>(&I))
+        if (II->getIntrinsicID() == Intrinsic::riscv_ssr_push ||
+            II->getIntrinsicID() == Intrinsic::riscv_ssr_pop)
+          continue;
+      if (I.getType()->isFloatingPointTy() && !isa<LoadInst>(I))
+        continue;
+      LLVM_DEBUG(dbgs() << "  not FP-only due to: " << I << "\n");
+      return false;
+    }
+  return true;
+}
+
+bool SNITCHSSRInference::convertToStreamingLoop(Loop *L) {
+  LLVM_DEBUG(dbgs() << "Running on "; L->print(dbgs()));
+
+  RISCVLoopRemark::Reason Reason;
+  const Instruction *Culprit = nullptr;
+  if (!isCandidateLoop(L, Reason, Culprit)) {
+    reportMissed(L, Reason, Culprit);
+    return false;
+  }
+
+  const SCEV *BTC = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BTC) || !isSafeToExpand(BTC, *SE)) {
+    LLVM_DEBUG(dbgs() << "  trip count not computable\n");
+    reportMissed(L, RISCVLoopRemark::UnknownTripCount);
+    return false;
+  }
+
+  SmallVector<Loop *, NUM_SSR_DIMS> Nest;
+  SmallVector<const SCEV *, NUM_SSR_DIMS> NestBTCs;
+  collectNest(L, BTC, Nest, NestBTCs);
+
+  SmallVector<SSRStream, NUM_SSR> Streams;
+  unsigned Depth = collectStreams(L, Nest, NestBTCs, Streams, Reason);
+  if (!Depth) {
+    reportMissed(L, Reason);
+    return false;
+  }
+
+  if (LAA->getInfo(L).getNumRuntimePointerChecks())
+    versionWithRuntimeChecks(L);
+
+  // The streaming region spans the outermost loop covered by all streams.
+  ArrayRef<Loop *> Region = makeArrayRef(Nest).take_front(Depth);
+  Loop *Outermost = Region.back();
+  BasicBlock *Preheader = Outermost->getLoopPreheader();
+  BasicBlock *Exit = Outermost->getExitBlock();
+  IRBuilder<> Builder(Preheader->getTerminator());
+
+  SCEVExpander Expander(*SE, *DL, "ssr");
+  for (const SSRStream &S : Streams)
+    emitStreamSetup(S, Expander, Preheader->getTerminator());
+  Builder.CreateIntrinsic(Intrinsic::riscv_ssr_enable, {}, {});
+
+  SE->forgetLoop(Outermost);
+  SmallVector<WeakTrackingVH, NUM_SSR> DeadInsts;
+  for (const SSRStream &S : Streams)
+    replaceAccess(S, DeadInsts);
+  removeDeadAddressing(Region, DeadInsts);
+
+  // Leave the streaming region in the exit block and wait for all write
+  // streams to drain to memory before anyone can observe the results.
+  Builder.SetInsertPoint(&*Exit->getFirstInsertionPt());
+  Builder.CreateIntrinsic(Intrinsic::riscv_ssr_disable, {}, {});
+  for (const SSRStream &S : Streams)
+    if (S.isWrite())
+      Builder.CreateIntrinsic(Intrinsic::riscv_ssr_barrier, {},
+                              {Builder.getInt32(S.DM)});
+
+  // With all memory traffic in streams, let the frep inference turn the
+  // body into a hardware repetition.
+  if (EnableSSRFrepFusion && ST->hasExtXfrep()) {
+    if (isFPOnlyBody(L)) {
+      Builder.SetInsertPoint(L->getLoopPreheader()->getTerminator());
+      Builder.CreateIntrinsic(Intrinsic::riscv_frep_infer, {}, {});
+      ++NumSSRFrepLoops;
+      LLVM_DEBUG(dbgs() << "  marked for frep inference\n");
+    } else {
+      reportMissed(L, RISCVLoopRemark::NotFPOnly, nullptr,
+                   "streaming loop not marked for frep inference");
+    }
+  }
+
+  ++NumSSRLoops;
+  NumSSRStreams += Streams.size();
+  for (const SSRStream &S : Streams) {
+    if (S.Dims > 1)
+      ++NumSSRNestedStreams;
+    if (S.Repeat)
+      ++NumSSRRepStreams;
+  }
+  LLVM_DEBUG(dbgs() << "  mapped " << Streams.size() << " streams over "
+                    << Depth << " loops\n");
+  ORE->emit([&]() {
+    return OptimizationRemark(DEBUG_TYPE, "StreamingLoop", L->getStartLoc(),
+                              L->getHeader())
+           << "mapped " << ore::NV("NumStreams", unsigned(Streams.size()))
+           << " accesses to streams over " << ore::NV("NumLoops", Depth)
+           << " loops";
+  });
+  return true;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHSSRInference, DEBUG_TYPE,
+                      SNITCH_SSR_INFERENCE_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopAccessLegacyAnalysis)
+INITIALIZE_PASS_DEPENDENCY(OptimizationRemarkEmitterWrapperPass)
+INITIALIZE_PASS_END(SNITCHSSRInference, DEBUG_TYPE,
+                    SNITCH_SSR_INFERENCE_NAME, false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHSSRInferencePass() {
+    return new SNITCHSSRInference();
+  }
+} // end of namespace llvm
@@ -0,0 +1,360 @@
+//===-- SNITCHSSRRegionOpt.cpp - Merge SSR regions and barriers -----------===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass cleans up the streaming regions and barriers of back-to-back SSR
+// kernels before RISCVExpandSSR expands every enable, disable and barrier
+// pseudo literally. Inlined kernels typically end up as
+//
+//   ssr_enable; <kernel 1>; ssr_disable; ssr_barrier(0);
+//   <setup of DM 1>; ssr_enable; <kernel 2>; ssr_disable; ssr_barrier(1);
+//   ssr_barrier(0); ...
+//
+// The pass
+//  - merges adjacent regions: a disable followed by an enable in the same
+//    block is erased if nothing in between touches the SSR data registers,
+//    calls or is inline asm. Empty regions are erased as well.
+//  - erases barriers on data movers which are known to be idle. A forward
+//    dataflow tracks the data movers which may run a stream: launching a
+//    stream, i.e. writing a read or write pointer, sets the data mover,
+//    a barrier clears it. Calls, inline asm and raw configuration writes
+//    may launch any stream. A barrier on a data mover which is idle on all
+//    paths is redundant.
+//  - sinks the remaining barriers as late as possible, to the first
+//    instruction that depends on the completion of the streams: memory
+//    accesses, other SSR instructions on the same data mover, region edges
+//    and instructions with side effects. The drain of the streams then
+//    overlaps with independent computation. Barriers are sunk within their
+//    block and into straight-line successors with no other predecessor.
+//
+// The pass runs on SSA form, before the SSR pseudos are expanded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVInstrInfo.h"
+#include "../RISCVSubtarget.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-ssr-region-opt"
+#define SNITCH_SSR_REGION_OPT_NAME "Snitch SSR region and barrier optimization"
+
+static cl::opt<bool> DisableSSRRegionOpt(
+    "snitch-ssr-region-opt-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not merge SSR regions or remove and sink SSR barriers"));
+
+STATISTIC(NumRegionsMerged, "Number of adjacent SSR regions merged");
+STATISTIC(NumRegionsErased, "Number of empty SSR regions erased");
+STATISTIC(NumBarriersErased, "Number of redundant SSR barriers erased");
+STATISTIC(NumBarriersSunk, "Number of SSR barriers sunk");
+
+namespace {
+
+/// The data movers, one bit each. Data mover 31 addresses all of them.
+constexpr unsigned NumDMs = 3;
+constexpr unsigned AllDMs = (1 << NumDMs) - 1;
+
+class SNITCHSSRRegionOpt : public MachineFunctionPass {
+public:
+  static char ID;
+
+  SNITCHSSRRegionOpt() : MachineFunctionPass(ID) {
+    initializeSNITCHSSRRegionOptPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  StringRef getPassName() const override { return SNITCH_SSR_REGION_OPT_NAME; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+private:
+  MachineRegisterInfo *MRI;
+  const TargetRegisterInfo *TRI;
+
+  /// Return the data movers \p MI, an SSR pseudo, addresses.
+  unsigned getDMs(const MachineInstr &MI) const;
+
+  /// Return true if \p MI reads or writes one of the SSR data registers.
+  bool accessesSSRRegs(const MachineInstr &MI) const;
+
+  bool mergeRegions(MachineBasicBlock &MBB);
+  bool eraseRedundantBarriers(MachineFunction &MF);
+  bool sinkBarrier(MachineInstr &Barrier);
+
+  /// Return true if \p MI has to wait for the streams of the data movers
+  /// \p DMs to complete.
+  bool dependsOnBarrier(const MachineInstr &MI, unsigned DMs) const;
+
+  /// Update the data movers which may be running in \p Busy after \p MI.
+  void transfer(const MachineInstr &MI, unsigned &Busy) const;
+};
+
+} // end anonymous namespace
+
+char SNITCHSSRRegionOpt::ID = 0;
+
+static bool isSSRPseudo(unsigned Opc) {
+  switch (Opc) {
+  case RISCV::PseudoSSRSetup_1D_R:
+  case RISCV::PseudoSSRSetup_1D_W:
+  case RISCV::PseudoSSRPush:
+  case RISCV::PseudoSSRPop:
+  case RISCV::PseudoSSRRead:
+  case RISCV::PseudoSSRWrite:
+  case RISCV::PseudoSSRReadImm:
+  case RISCV::PseudoSSRWriteImm:
+  case RISCV::PseudoSSRSetupBoundStride_1D:
+  case RISCV::PseudoSSRSetupBoundStride_2D:
+  case RISCV::PseudoSSRSetupBoundStride_3D:
+  case RISCV::PseudoSSRSetupBoundStride_4D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_1D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_2D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_3D:
+  case RISCV::PseudoSSRSetupBoundStrideImm_4D:
+  case RISCV::PseudoSSREnable:
+  case RISCV::PseudoSSRDisable:
+  case RISCV::PseudoSSRSetupRepetition:
+  case RISCV::PseudoSSRSetupRepetitionImm:
+  case RISCV::PseudoSSRBarrier:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Return true if \p Opc writes a read or write pointer, which launches a
+/// stream.
+static bool isStreamLaunch(unsigned Opc) {
+  switch (Opc) {
+  case RISCV::PseudoSSRSetup_1D_R:
+  case RISCV::PseudoSSRSetup_1D_W:
+  case RISCV::PseudoSSRRead:
+  case RISCV::PseudoSSRWrite:
+  case RISCV::PseudoSSRReadImm:
+  case RISCV::PseudoSSRWriteImm:
+    return true;
+  default:
+    return false;
+  }
+}
+
+unsigned SNITCHSSRRegionOpt::getDMs(const MachineInstr &MI) const {
+  unsigned Opc = MI.getOpcode();
+  if (Opc == RISCV::PseudoSSREnable || Opc == RISCV::PseudoSSRDisable)
+    return AllDMs;
+  const MachineOperand &MO =
+      MI.getOperand(Opc == RISCV::PseudoSSRPop ? 1 : 0);
+  Optional<int64_t> DM;
+  if (MO.isImm()) {
+    DM = MO.getImm();
+  } else if (MO.isReg() && MO.getReg().isVirtual()) {
+    // A data mover in a register is usually a constant the selector did not
+    // fold, see foldConstantReg in RISCVExpandSSRInsts.cpp.
+    const MachineInstr *Def = MRI->getVRegDef(MO.getReg());
+    if (Def && Def->getOpcode() == RISCV::ADDI &&
+        Def->getOperand(1).isReg() &&
+        Def->getOperand(1).getReg() == RISCV::X0 && Def->getOperand(2).isImm())
+      DM = Def->getOperand(2).getImm();
+  }
+  if (DM && *DM >= 0 && *DM < NumDMs)
+    return 1 << *DM;
+  return AllDMs;
+}
+
+bool SNITCHSSRRegionOpt::accessesSSRRegs(const MachineInstr &MI) const {
+  for (MCPhysReg R : {RISCV::F0_D, RISCV::F1_D, RISCV::F2_D})
+    if (MI.readsRegister(R, TRI) || MI.modifiesRegister(R, TRI))
+      return true;
+  return false;
+}
+
+bool SNITCHSSRRegionOpt::runOnMachineFunction(MachineFunction &MF) {
+  if (DisableSSRRegionOpt || skipFunction(MF.getFunction()))
+    return false;
+  if (!MF.getSubtarget<RISCVSubtarget>().hasExtXssr())
+    return false;
+
+  MRI = &MF.getRegInfo();
+  TRI = MF.getSubtarget().getRegisterInfo();
+
+  bool Changed = false;
+  for (MachineBasicBlock &MBB : MF)
+    Changed |= mergeRegions(MBB);
+  Changed |= eraseRedundantBarriers(MF);
+
+  SmallVector<MachineInstr *, 8> Barriers;
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB)
+      if (MI.getOpcode() == RISCV::PseudoSSRBarrier)
+        Barriers.push_back(&MI);
+  // Barriers are barriers to each other, sink the later ones first to make
+  // room for the earlier ones.
+  for (MachineInstr *Barrier : reverse(Barriers))
+    Changed |= sinkBarrier(*Barrier);
+  return Changed;
+}
+
+bool SNITCHSSRRegionOpt::mergeRegions(MachineBasicBlock &MBB) {
+  bool Changed = false;
+  MachineInstr *LastEdge = nullptr;
+  for (MachineInstr &MI : make_early_inc_range(MBB)) {
+    unsigned Opc = MI.getOpcode();
+    if (Opc == RISCV::PseudoSSREnable || Opc == RISCV::PseudoSSRDisable) {
+      // A disable followed by an enable continues the region, an enable
+      // followed by a disable is an empty region.
+      if (LastEdge && LastEdge->getOpcode() != Opc) {
+        LLVM_DEBUG(dbgs() << "Erasing " << *LastEdge << "  and " << MI);
+        if (Opc == RISCV::PseudoSSREnable)
+          ++NumRegionsMerged;
+        else
+          ++NumRegionsErased;
+        LastEdge->eraseFromParent();
+        MI.eraseFromParent();
+        LastEdge = nullptr;
+        Changed = true;
+        continue;
+      }
+      LastEdge = &MI;
+      continue;
+    }
+    if (MI.isDebugInstr())
+      continue;
+    // Pushes and pops need the streams enabled, configuration writes and
+    // barriers do not care.
+    if (MI.isCall() || MI.isInlineAsm() || accessesSSRRegs(MI) ||
+        Opc == RISCV::PseudoSSRPush || Opc == RISCV::PseudoSSRPop)
+      LastEdge = nullptr;
+  }
+  return Changed;
+}
+
+void SNITCHSSRRegionOpt::transfer(const MachineInstr &MI,
+                                  unsigned &Busy) const {
+  unsigned Opc = MI.getOpcode();
+  if (Opc == RISCV::PseudoSSRBarrier)
+    Busy &= ~getDMs(MI);
+  else if (isStreamLaunch(Opc))
+    Busy |= getDMs(MI);
+  else if (MI.isCall() || MI.isInlineAsm() || Opc == RISCV::SCFGW ||
+           Opc == RISCV::SCFGWI)
+    Busy = AllDMs;
+}
+
+bool SNITCHSSRRegionOpt::eraseRedundantBarriers(MachineFunction &MF) {
+  // The data movers which may be busy on entry of a block. Streams may still
+  // run from the caller on entry of the function.
+  DenseMap<const MachineBasicBlock *, unsigned> BusyIn;
+  BusyIn[&MF.front()] = AllDMs;
+  ReversePostOrderTraversal<MachineFunction *> RPOT(&MF);
+  bool Iterate = true;
+  while (Iterate) {
+    Iterate = false;
+    for (MachineBasicBlock *MBB : RPOT) {
+      unsigned Busy = BusyIn.lookup(MBB);
+      for (const MachineInstr &MI : *MBB)
+        transfer(MI, Busy);
+      for (MachineBasicBlock *Succ : MBB->successors()) {
+        unsigned &In = BusyIn[Succ];
+        if ((In | Busy) != In) {
+          In |= Busy;
+          Iterate = true;
+        }
+      }
+    }
+  }
+
+  bool Changed = false;
+  for (MachineBasicBlock *MBB : RPOT) {
+    unsigned Busy = BusyIn.lookup(MBB);
+    for (MachineInstr &MI : make_early_inc_range(*MBB)) {
+      if (MI.getOpcode() == RISCV::PseudoSSRBarrier && !(Busy & getDMs(MI))) {
+        LLVM_DEBUG(dbgs() << "Erasing redundant " << MI);
+        MI.eraseFromParent();
+        ++NumBarriersErased;
+        Changed = true;
+        continue;
+      }
+      transfer(MI, Busy);
+    }
+  }
+  return Changed;
+}
+
+bool SNITCHSSRRegionOpt::dependsOnBarrier(const MachineInstr &MI,
+                                          unsigned DMs) const {
+  if (isSSRPseudo(MI.getOpcode())) {
+    unsigned Opc = MI.getOpcode();
+    return Opc == RISCV::PseudoSSREnable || Opc == RISCV::PseudoSSRDisable ||
+           (getDMs(MI) & DMs);
+  }
+  // Written streams have to reach the memory before it is accessed, read
+  // streams must not see later stores.
+  return MI.isCall() || MI.isInlineAsm() || MI.hasUnmodeledSideEffects() ||
+         MI.mayLoadOrStore() || MI.hasOrderedMemoryRef() ||
+         accessesSSRRegs(MI);
+}
+
+bool SNITCHSSRRegionOpt::sinkBarrier(MachineInstr &Barrier) {
+  unsigned DMs = getDMs(Barrier);
+  LLVM_DEBUG(dbgs() << "Sinking " << Barrier);
+
+  MachineBasicBlock *MBB = Barrier.getParent();
+  MachineBasicBlock::iterator InsertPt = std::next(Barrier.getIterator());
+  while (true) {
+    MachineBasicBlock::iterator E = MBB->getFirstTerminator();
+    while (InsertPt != E && !dependsOnBarrier(*InsertPt, DMs))
+      ++InsertPt;
+    if (InsertPt != E)
+      break;
+    // Continue in a straight-line successor.
+    if (MBB->succ_size() != 1)
+      break;
+    MachineBasicBlock *Succ = *MBB->succ_begin();
+    if (Succ->pred_size() != 1 || Succ->isEHPad() ||
+        Succ == Barrier.getParent())
+      break;
+    MBB = Succ;
+    InsertPt = MBB->getFirstNonPHI();
+  }
+
+  if (InsertPt == std::next(Barrier.getIterator()))
+    return false;
+
+  Barrier.removeFromParent();
+  MBB->insert(InsertPt, &Barrier);
+  LLVM_DEBUG(dbgs() << "  into " << printMBBReference(*MBB) << "\n");
+  ++NumBarriersSunk;
+  return true;
+}
+
+INITIALIZE_PASS(SNITCHSSRRegionOpt, DEBUG_TYPE, SNITCH_SSR_REGION_OPT_NAME,
+                false, false)
+
+namespace llvm {
+  FunctionPass *createSNITCHSSRRegionOptPass() {
+    return new SNITCHSSRRegionOpt();
+  }
+} // end of namespace llvm
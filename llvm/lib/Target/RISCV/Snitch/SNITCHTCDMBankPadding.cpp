@@ -0,0 +1,465 @@
+//===-- SNITCHTCDMBankPadding.cpp - Pad arrays against bank conflicts -----===//
+//
+// Copyright 2021 ETH Zurich, University of Bologna.
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass pads the rows of multi-dimensional arrays in the L1 memory of
+// Snitch and MemPool clusters. The L1 memory interleaves its words across
+// banks, and rows whose size is a multiple of the bank count times the bank
+// width all start in the same bank. The cores working on different rows and
+// SSR streams walking down a column then conflict on every access:
+//
+//   static double A[32][32] __attribute__((section(".l1")));
+//   ... A[core_id][j] ... A[i][k] ...
+//
+// Appending a few elements to each row makes consecutive rows start in
+// different banks, here A becomes a [32 x [33 x double]] array. The padding
+// is the smallest one which spreads the rows over as many banks as the type
+// of the elements allows, as long as it stays within -snitch-tcdm-max-padding
+// percent of the row.
+//
+// The pass runs before the SSR inference and the DMA idiom recognition, so
+// the streams and transfers derived from the accesses follow the new layout.
+// The layout of an array may only change if nothing depends on it:
+//  - it is a non-constant global with local linkage in one of the sections
+//    of -snitch-tcdm-sections, or a static stack allocation on Snitch, whose
+//    stack lives in the TCDM,
+//  - it is only addressed by inbounds GEPs which index the array level by
+//    level, and the elements are only loaded and stored. Arrays whose
+//    addresses are passed on, e.g. to explicit SSR or DMA setups with strides
+//    computed by the programmer, are left alone,
+//  - some access selects a row with a variable index.
+//
+// A remark reports the padding chosen for every array, and a missed remark
+// the arrays with conflicting rows that cannot be padded.
+//
+//===----------------------------------------------------------------------===//
+
+#include "../RISCV.h"
+#include "../RISCVSubtarget.h"
+#include "../RISCVTargetMachine.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "snitch-tcdm-bank-padding"
+#define SNITCH_TCDM_BANK_PADDING_NAME "Snitch TCDM bank conflict padding"
+
+static cl::opt<bool> DisableBankPadding(
+    "snitch-tcdm-bank-padding-disable", cl::init(false), cl::Hidden,
+    cl::desc("Do not pad arrays to avoid TCDM bank conflicts"));
+
+static cl::opt<std::string> TCDMSections(
+    "snitch-tcdm-sections", cl::init(".l1,.tcdm"), cl::Hidden,
+    cl::desc("Comma separated list of the sections placed in the TCDM"));
+
+static cl::opt<unsigned> MaxPaddingPercent(
+    "snitch-tcdm-max-padding", cl::init(25), cl::Hidden,
+    cl::desc("Maximum padding of a row, in percent of its size"));
+
+STATISTIC(NumPadded, "Number of arrays padded against bank conflicts");
+STATISTIC(NumPaddingBytes, "Number of bytes added by bank conflict padding");
+
+namespace {
+
+/// The nested array types of an array, outermost first, and the padded
+/// types replacing them.
+struct ArrayShape {
+  SmallVector<ArrayType *, 4> Levels;
+  SmallVector<ArrayType *, 4> NewLevels;
+  Type *EltTy = nullptr;
+
+  unsigned getNumLevels() const { return Levels.size(); }
+};
+
+/// Checks that the layout of an array is only observed through accesses to
+/// its elements.
+struct AccessChecker {
+  const ArrayShape &Shape;
+  /// Whether an access selects a row with a variable index.
+  bool VariableRow = false;
+  /// The first load or store of an element.
+  Instruction *FirstAccess = nullptr;
+  /// The user which prevents the padding.
+  User *Blocker = nullptr;
+
+  AccessChecker(const ArrayShape &Shape) : Shape(Shape) {}
+
+  /// Check the users of \p Ptr, which points to an array of level \p Level or
+  /// to an element if \p Level is the number of levels.
+  bool check(Value *Ptr, unsigned Level);
+};
+
+class SNITCHTCDMBankPadding : public ModulePass {
+public:
+  static char ID;
+
+  SNITCHTCDMBankPadding() : ModulePass(ID) {
+    initializeSNITCHTCDMBankPaddingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override;
+
+  StringRef getPassName() const override {
+    return SNITCH_TCDM_BANK_PADDING_NAME;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<TargetPassConfig>();
+  }
+
+private:
+  /// Choose the padding of the array \p Base of type \p Ty and fill in the
+  /// padded types of \p Shape. Return the first access of the array, or null
+  /// if it is not padded.
+  Instruction *choosePadding(Value *Base, Type *Ty, ArrayShape &Shape);
+
+  /// Report the padding of \p Base accessed by \p At.
+  void reportPadding(Value *Base, const ArrayShape &Shape, Instruction *At);
+
+  bool padGlobal(GlobalVariable &GV);
+  bool padAlloca(AllocaInst &AI);
+
+  const RISCVTargetMachine *TM = nullptr;
+};
+
+} // end anonymous namespace
+
+char SNITCHTCDMBankPadding::ID = 0;
+
+bool AccessChecker::check(Value *Ptr, unsigned Level) {
+  unsigned NumLevels = Shape.getNumLevels();
+  for (User *U : Ptr->users()) {
+    if (Level == NumLevels) {
+      auto *SI = dyn_cast<StoreInst>(U);
+      if (!isa<LoadInst>(U) && !(SI && SI->getValueOperand() != Ptr)) {
+        Blocker = U;
+        return false;
+      }
+      if (!FirstAccess)
+        FirstAccess = cast<Instruction>(U);
+      continue;
+    }
+    // The lifetime markers of allocations are resized with them.
+    if (Level == 0 && isa<BitCastInst>(U) && onlyUsedByLifetimeMarkers(U))
+      continue;
+
+    auto *GEP = dyn_cast<GEPOperator>(U);
+    auto *First = GEP ? dyn_cast<ConstantInt>(GEP->getOperand(1)) : nullptr;
+    if (!GEP || GEP->getPointerOperand() != Ptr || !GEP->isInBounds() ||
+        GEP->getSourceElementType() != Shape.Levels[Level] || !First ||
+        !First->isZero()) {
+      Blocker = U;
+      return false;
+    }
+    // Operand K indexes into level Level + K - 2, all but the innermost level
+    // select a row.
+    unsigned NumIndices = GEP->getNumIndices();
+    for (unsigned K = 2; K <= NumIndices; ++K)
+      if (Level + K - 1 < NumLevels && !isa<ConstantInt>(GEP->getOperand(K)))
+        VariableRow = true;
+    if (!check(GEP, Level + NumIndices - 1))
+      return false;
+  }
+  return true;
+}
+
+/// Return whether \p GV is placed in the TCDM.
+static bool isTCDMGlobal(const GlobalVariable &GV) {
+  if (!GV.hasSection() || GV.getAddressSpace() == RISCVAS::MEMPOOL_SEQ)
+    return false;
+  SmallVector<StringRef, 4> Sections;
+  StringRef(TCDMSections).split(Sections, ',', -1, /*KeepEmpty=*/false);
+  return is_contained(Sections, GV.getSection());
+}
+
+/// Return the number of elements to append to the rows of \p NumElts elements
+/// of \p EltSize bytes so that consecutive rows start in as many different
+/// banks as possible, or 0 if they already do.
+static uint64_t getRowPadding(uint64_t NumElts, uint64_t EltSize,
+                              unsigned NumBanks, unsigned BankWidth) {
+  // The number of consecutive rows which start in the same bank, or 0 if the
+  // rows are not aligned to the banks.
+  auto getConflicts = [&](uint64_t Elts) -> uint64_t {
+    uint64_t Bytes = Elts * EltSize;
+    if (Bytes % BankWidth)
+      return 0;
+    return greatestCommonDivisor<uint64_t>(Bytes / BankWidth, NumBanks);
+  };
+  uint64_t Best = greatestCommonDivisor<uint64_t>(
+      std::max<uint64_t>(EltSize / BankWidth, 1), NumBanks);
+  uint64_t Conflicts = getConflicts(NumElts);
+  if (Conflicts <= Best)
+    return 0;
+  uint64_t MaxPadding = NumElts * MaxPaddingPercent / 100;
+  for (uint64_t Padding = 1; Padding <= MaxPadding; ++Padding) {
+    uint64_t Padded = getConflicts(NumElts + Padding);
+    if (Padded && Padded <= Best)
+      return Padding;
+  }
+  return 0;
+}
+
+Instruction *SNITCHTCDMBankPadding::choosePadding(Value *Base, Type *Ty,
+                                                  ArrayShape &Shape) {
+  while (auto *ATy = dyn_cast<ArrayType>(Ty)) {
+    Shape.Levels.push_back(ATy);
+    Ty = ATy->getElementType();
+  }
+  Shape.EltTy = Ty;
+  if (Shape.getNumLevels() < 2 ||
+      !(Ty->isIntOrPtrTy() || Ty->isFloatingPointTy()))
+    return nullptr;
+  ArrayType *RowTy = Shape.Levels.back();
+  uint64_t NumElts = RowTy->getNumElements();
+  if (NumElts == 0 || Shape.Levels[Shape.getNumLevels() - 2]
+                              ->getNumElements() < 2)
+    return nullptr;
+
+  AccessChecker Checker(Shape);
+  bool Safe = Checker.check(Base, 0);
+  Instruction *At = Checker.FirstAccess;
+  if (!Safe)
+    At = dyn_cast<Instruction>(Checker.Blocker);
+  if (!At || (Safe && !Checker.VariableRow))
+    return nullptr;
+
+  const Function &F = *At->getFunction();
+  const RISCVSubtarget &ST = *TM->getSubtargetImpl(F);
+  unsigned NumBanks = ST.getTCDMNumBanks();
+  if (!NumBanks)
+    return nullptr;
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  uint64_t EltSize = DL.getTypeAllocSize(Shape.EltTy);
+  uint64_t Padding =
+      getRowPadding(NumElts, EltSize, NumBanks, ST.getTCDMBankWidth());
+  if (!Padding)
+    return nullptr;
+
+  OptimizationRemarkEmitter ORE(&F);
+  if (!Safe) {
+    ORE.emit([&]() {
+      return OptimizationRemarkMissed(DEBUG_TYPE, "BankConflict", At)
+             << "the rows of " << ore::NV("Array", Base->getName())
+             << " start in the same TCDM bank, but its layout is observed "
+                "here";
+    });
+    return nullptr;
+  }
+
+  Shape.NewLevels.resize(Shape.getNumLevels());
+  Type *NewTy = ArrayType::get(Shape.EltTy, NumElts + Padding);
+  for (unsigned L = Shape.getNumLevels(); L-- > 0;) {
+    if (L + 1 < Shape.getNumLevels())
+      NewTy = ArrayType::get(NewTy, Shape.Levels[L]->getNumElements());
+    Shape.NewLevels[L] = cast<ArrayType>(NewTy);
+  }
+  return At;
+}
+
+void SNITCHTCDMBankPadding::reportPadding(Value *Base, const ArrayShape &Shape,
+                                          Instruction *At) {
+  const Function &F = *At->getFunction();
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  uint64_t NumElts = Shape.Levels.back()->getNumElements();
+  uint64_t NewNumElts = Shape.NewLevels.back()->getNumElements();
+  LLVM_DEBUG(dbgs() << "Padding the rows of " << Base->getName() << " from "
+                    << NumElts << " to " << NewNumElts << " elements\n");
+  OptimizationRemarkEmitter ORE(&F);
+  ORE.emit([&]() {
+    return OptimizationRemark(DEBUG_TYPE, "BankPadding", At)
+           << "padded the rows of " << ore::NV("Array", Base->getName())
+           << " from " << ore::NV("Elements", NumElts) << " to "
+           << ore::NV("PaddedElements", NewNumElts)
+           << " elements to spread them over "
+           << ore::NV("Banks", TM->getSubtargetImpl(F)->getTCDMNumBanks())
+           << " TCDM banks";
+  });
+  ++NumPadded;
+  NumPaddingBytes += DL.getTypeAllocSize(Shape.NewLevels[0]) -
+                     DL.getTypeAllocSize(Shape.Levels[0]);
+}
+
+/// Rebuild the users of \p Old, which points to level \p Level of the array,
+/// on top of the padded \p New. Allocations also resize the lifetime markers
+/// to \p NewSize.
+static void rewriteUses(Value *Old, Value *New, unsigned Level,
+                        const ArrayShape &Shape, uint64_t NewSize) {
+  SmallVector<User *, 8> Users(Old->users());
+  for (User *U : Users) {
+    if (auto *BC = dyn_cast<BitCastInst>(U)) {
+      for (User *LU : BC->users()) {
+        auto *II = cast<IntrinsicInst>(LU);
+        if (!cast<ConstantInt>(II->getArgOperand(0))->isMinusOne())
+          II->setArgOperand(
+              0, ConstantInt::get(II->getArgOperand(0)->getType(), NewSize));
+      }
+      auto *NewBC = new BitCastInst(New, BC->getType(), "", BC);
+      NewBC->takeName(BC);
+      BC->replaceAllUsesWith(NewBC);
+      BC->eraseFromParent();
+      continue;
+    }
+
+    auto *GEP = cast<GEPOperator>(U);
+    SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+    unsigned NewLevel = Level + Indices.size() - 1;
+    Value *NewGEP;
+    if (auto *I = dyn_cast<GetElementPtrInst>(GEP)) {
+      NewGEP = GetElementPtrInst::CreateInBounds(Shape.NewLevels[Level], New,
+                                                 Indices, "", I);
+      NewGEP->takeName(I);
+    } else {
+      NewGEP = ConstantExpr::getInBoundsGetElementPtr(
+          Shape.NewLevels[Level], cast<Constant>(New), Indices);
+    }
+    if (NewLevel == Shape.getNumLevels())
+      GEP->replaceAllUsesWith(NewGEP);
+    else
+      rewriteUses(GEP, NewGEP, NewLevel, Shape, NewSize);
+
+    if (auto *I = dyn_cast<Instruction>(GEP))
+      I->eraseFromParent();
+    else
+      cast<Constant>(GEP)->destroyConstant();
+  }
+}
+
+/// Return the initializer \p Init of level \p Level with padded rows, or null
+/// if it cannot be rebuilt.
+static Constant *padInitializer(Constant *Init, const ArrayShape &Shape,
+                                unsigned Level) {
+  ArrayType *NewTy = Shape.NewLevels[Level];
+  if (isa<ConstantAggregateZero>(Init))
+    return Constant::getNullValue(NewTy);
+  if (isa<UndefValue>(Init))
+    return UndefValue::get(NewTy);
+
+  bool IsRow = Level + 1 == Shape.getNumLevels();
+  uint64_t NumElts = Shape.Levels[Level]->getNumElements();
+  SmallVector<Constant *, 16> Elts;
+  for (uint64_t I = 0, E = NewTy->getNumElements(); I != E; ++I) {
+    if (I >= NumElts) {
+      Elts.push_back(Constant::getNullValue(Shape.EltTy));
+      continue;
+    }
+    Constant *Elt = Init->getAggregateElement(I);
+    if (Elt && !IsRow)
+      Elt = padInitializer(Elt, Shape, Level + 1);
+    if (!Elt)
+      return nullptr;
+    Elts.push_back(Elt);
+  }
+  return ConstantArray::get(NewTy, Elts);
+}
+
+bool SNITCHTCDMBankPadding::padGlobal(GlobalVariable &GV) {
+  GV.removeDeadConstantUsers();
+  ArrayShape Shape;
+  Instruction *At = choosePadding(&GV, GV.getValueType(), Shape);
+  if (!At)
+    return false;
+  Constant *Init = padInitializer(GV.getInitializer(), Shape, 0);
+  if (!Init)
+    return false;
+  reportPadding(&GV, Shape, At);
+
+  Module &M = *GV.getParent();
+  auto *NewGV = new GlobalVariable(M, Shape.NewLevels[0], GV.isConstant(),
+                                   GV.getLinkage(), Init, "", &GV,
+                                   GV.getThreadLocalMode(),
+                                   GV.getAddressSpace());
+  NewGV->copyAttributesFrom(&GV);
+  NewGV->takeName(&GV);
+  SmallVector<DIGlobalVariableExpression *, 1> DIs;
+  GV.getDebugInfo(DIs);
+  for (DIGlobalVariableExpression *DI : DIs)
+    NewGV->addDebugInfo(DI);
+
+  rewriteUses(&GV, NewGV, 0, Shape, 0);
+  GV.eraseFromParent();
+  return true;
+}
+
+bool SNITCHTCDMBankPadding::padAlloca(AllocaInst &AI) {
+  ArrayShape Shape;
+  Instruction *At = choosePadding(&AI, AI.getAllocatedType(), Shape);
+  if (!At)
+    return false;
+  reportPadding(&AI, Shape, At);
+
+  const DataLayout &DL = AI.getModule()->getDataLayout();
+  auto *NewAI =
+      new AllocaInst(Shape.NewLevels[0], AI.getType()->getAddressSpace(),
+                     nullptr, AI.getAlign(), "", &AI);
+  NewAI->takeName(&AI);
+  rewriteUses(&AI, NewAI, 0, Shape,
+              DL.getTypeAllocSize(Shape.NewLevels[0]).getFixedSize());
+  AI.eraseFromParent();
+  return true;
+}
+
+bool SNITCHTCDMBankPadding::runOnModule(Module &M) {
+  if (DisableBankPadding || skipModule(M))
+    return false;
+  TM = &getAnalysis<TargetPassConfig>().getTM<RISCVTargetMachine>();
+
+  SmallVector<GlobalVariable *, 8> Globals;
+  for (GlobalVariable &GV : M.globals())
+    if (GV.hasLocalLinkage() && !GV.isConstant() && GV.hasInitializer() &&
+        isTCDMGlobal(GV))
+      Globals.push_back(&GV);
+
+  SmallVector<AllocaInst *, 8> Allocas;
+  for (Function &F : M) {
+    if (F.isDeclaration() || F.hasOptNone())
+      continue;
+    // MemPool places the stacks in the sequential regions of the tiles.
+    const RISCVSubtarget &ST = *TM->getSubtargetImpl(F);
+    if (!ST.getTCDMNumBanks() || ST.hasExtXmempool())
+      continue;
+    for (Instruction &I : F.getEntryBlock())
+      if (auto *AI = dyn_cast<AllocaInst>(&I))
+        if (AI->isStaticAlloca())
+          Allocas.push_back(AI);
+  }
+
+  bool Changed = false;
+  for (GlobalVariable *GV : Globals)
+    Changed |= padGlobal(*GV);
+  for (AllocaInst *AI : Allocas)
+    Changed |= padAlloca(*AI);
+  return Changed;
+}
+
+INITIALIZE_PASS_BEGIN(SNITCHTCDMBankPadding, DEBUG_TYPE,
+                      SNITCH_TCDM_BANK_PADDING_NAME, false, false)
+INITIALIZE_PASS_DEPENDENCY(TargetPassConfig)
+INITIALIZE_PASS_END(SNITCHTCDMBankPadding, DEBUG_TYPE,
+                    SNITCH_TCDM_BANK_PADDING_NAME, false, false)
+
+namespace llvm {
+  ModulePass *createSNITCHTCDMBankPaddingPass() {
+    return new SNITCHTCDMBankPadding();
+  }
+} // end of namespace llvm
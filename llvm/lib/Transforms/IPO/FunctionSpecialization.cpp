@@ -0,0 +1,405 @@
+//===- FunctionSpecialization.cpp - Function Specialization ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass clones functions for the combinations of constant integer
+// arguments they are most frequently called with, and redirects the matching
+// call sites to the clones.
+//
+// Interprocedural constant propagation only propagates an argument into a
+// function when all of its call sites agree on its value. Kernels that take
+// tile sizes or strides as arguments are typically called with a few
+// different constants, so that their loop bounds and strides stay unknown and
+// the backend has to fall back to loops with run-time trip counts and to
+// configure the hardware loops and streams at run time.
+//
+// For each function, the arguments that determine loop bounds, strides,
+// operands of intrinsics, compares or switches are scored by the loop depth
+// of these uses. The call sites passing constants for such arguments are
+// grouped by the constants they pass and weighted by their profile count, or
+// by their frequency relative to the entry of their caller without profile,
+// cold call sites being ignored. The heaviest groups get a clone of the
+// function in which the constants replace the arguments, and their call sites
+// are redirected to it. The constants are folded into the clone, and the
+// later passes take it from there.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionSpecialization.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <map>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "function-specialization"
+
+STATISTIC(NumFuncSpecialized, "Number of functions specialized");
+STATISTIC(NumSpecializations, "Number of specializations created");
+STATISTIC(NumCallSitesRewritten,
+          "Number of call sites redirected to a specialization");
+
+static cl::opt<unsigned> MaxClonesThreshold(
+    "func-specialization-max-clones", cl::Hidden, cl::init(3),
+    cl::desc("The maximum number of specializations of a function"));
+
+static cl::opt<unsigned> MaxSizeThreshold(
+    "func-specialization-max-size", cl::Hidden, cl::init(500),
+    cl::desc("The maximum number of instructions of a function to "
+             "specialize"));
+
+static cl::opt<unsigned> MinBonusThreshold(
+    "func-specialization-min-bonus", cl::Hidden, cl::init(1),
+    cl::desc("The minimum score of the constant arguments of a "
+             "specialization, counting the loop bounds, strides and "
+             "intrinsic operands they determine by their loop depth"));
+
+namespace {
+
+/// The constant integer arguments of a call site, as pairs of argument number
+/// and value, by increasing argument number.
+using ConstantArgList = SmallVector<std::pair<unsigned, ConstantInt *>, 4>;
+
+/// A candidate specialization of a function: the constant arguments it is
+/// specialized for and the call sites that pass them.
+struct SpecializationInfo {
+  ConstantArgList Args;
+  SmallVector<CallBase *, 4> CallSites;
+  /// The sum of the profile counts of the call sites, or of their frequencies
+  /// relative to the entry of their callers without profile.
+  double Weight = 0;
+};
+
+class FunctionSpecializer {
+  Module &M;
+  function_ref<const TargetLibraryInfo &(Function &)> GetTLI;
+  function_ref<LoopInfo &(Function &)> GetLI;
+  function_ref<BlockFrequencyInfo &(Function &)> GetBFI;
+  ProfileSummaryInfo *PSI;
+
+public:
+  FunctionSpecializer(
+      Module &M, function_ref<const TargetLibraryInfo &(Function &)> GetTLI,
+      function_ref<LoopInfo &(Function &)> GetLI,
+      function_ref<BlockFrequencyInfo &(Function &)> GetBFI,
+      ProfileSummaryInfo *PSI)
+      : M(M), GetTLI(GetTLI), GetLI(GetLI), GetBFI(GetBFI), PSI(PSI) {}
+
+  bool run();
+
+private:
+  /// Return whether \p F can be cloned and is worth looking at.
+  bool isCandidateFunction(Function &F) const;
+
+  /// Specialize \p F for the heaviest constant arguments of its call sites.
+  bool specializeFunction(Function &F);
+
+  /// Create the \p N-th specialization \p S of \p F.
+  Function *createSpecialization(Function &F, const SpecializationInfo &S,
+                                 unsigned N);
+};
+
+} // end anonymous namespace
+
+/// Return how much the code of a function would benefit from knowing the
+/// value of its argument \p A. The loop bounds and strides it determines count
+/// for their loop depth, and the compares and switches that fold and the
+/// operands of intrinsics for their loop depth plus one.
+static unsigned getArgumentBonus(Argument &A, LoopInfo &LI) {
+  unsigned Bonus = 0;
+  SmallVector<Value *, 8> Worklist = {&A};
+  SmallPtrSet<Value *, 8> Known = {&A};
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (User *U : V->users()) {
+      auto *I = dyn_cast<Instruction>(U);
+      if (!I)
+        continue;
+      unsigned Depth = LI.getLoopDepth(I->getParent());
+
+      // The values computed from the argument and other constants are known
+      // as well.
+      bool Folds = isa<CastInst>(I) ||
+                   ((isa<BinaryOperator>(I) || isa<CmpInst>(I)) &&
+                    all_of(I->operands(), [&](Value *Op) {
+                      return isa<Constant>(Op) || Known.count(Op);
+                    }));
+      if (Folds) {
+        if (isa<CmpInst>(I))
+          Bonus += Depth + 1;
+        if (Known.insert(I).second)
+          Worklist.push_back(I);
+        continue;
+      }
+
+      if (isa<SwitchInst>(I) || isa<IntrinsicInst>(I))
+        Bonus += Depth + 1;
+      else if (Depth &&
+               (isa<CmpInst>(I) || isa<GetElementPtrInst>(I) ||
+                I->getOpcode() == Instruction::Mul ||
+                I->getOpcode() == Instruction::Shl))
+        Bonus += Depth;
+    }
+  }
+  return Bonus;
+}
+
+bool FunctionSpecializer::isCandidateFunction(Function &F) const {
+  if (F.isDeclaration() || F.isVarArg() || F.isInterposable() ||
+      F.hasOptNone() || F.hasOptSize())
+    return false;
+  if (none_of(F.args(),
+              [](Argument &A) { return A.getType()->isIntegerTy(); }))
+    return false;
+  if (F.getInstructionCount() > MaxSizeThreshold)
+    return false;
+
+  for (BasicBlock &BB : F) {
+    if (BB.hasAddressTaken())
+      return false;
+    for (Instruction &I : BB)
+      if (auto *CB = dyn_cast<CallBase>(&I))
+        if (CB->cannotDuplicate())
+          return false;
+  }
+  return true;
+}
+
+bool FunctionSpecializer::specializeFunction(Function &F) {
+  // The loop info is not used once the block frequencies of the callers are
+  // queried, as the legacy pass manager may have released it by then.
+  SmallVector<unsigned, 8> ArgBonus(F.arg_size());
+  LoopInfo &LI = GetLI(F);
+  for (Argument &A : F.args())
+    if (A.getType()->isIntegerTy())
+      ArgBonus[A.getArgNo()] = getArgumentBonus(A, LI);
+  if (all_of(ArgBonus, [](unsigned Bonus) { return Bonus == 0; }))
+    return false;
+
+  // Group the call sites by the constants they pass for the arguments that
+  // matter.
+  bool HasProfile = PSI && PSI->hasProfileSummary();
+  std::vector<SpecializationInfo> Specs;
+  std::map<ConstantArgList, unsigned> SpecIndex;
+  unsigned NumOtherUses = 0;
+  for (Use &U : F.uses()) {
+    auto *CB = dyn_cast<CallBase>(U.getUser());
+    if (!CB || !CB->isCallee(&U) ||
+        CB->getFunctionType() != F.getFunctionType() ||
+        CB->isMustTailCall() || CB->getFunction() == &F) {
+      ++NumOtherUses;
+      continue;
+    }
+
+    ConstantArgList Args;
+    unsigned Bonus = 0;
+    for (unsigned ArgNo = 0, E = F.arg_size(); ArgNo != E; ++ArgNo) {
+      auto *C = dyn_cast<ConstantInt>(CB->getArgOperand(ArgNo));
+      if (!C || !ArgBonus[ArgNo])
+        continue;
+      Args.emplace_back(ArgNo, C);
+      Bonus += ArgBonus[ArgNo];
+    }
+    if (Args.empty() || Bonus < MinBonusThreshold) {
+      ++NumOtherUses;
+      continue;
+    }
+
+    BlockFrequencyInfo &BFI = GetBFI(*CB->getFunction());
+    double Weight;
+    if (HasProfile) {
+      if (PSI->isColdCallSite(*CB, &BFI)) {
+        ++NumOtherUses;
+        continue;
+      }
+      Weight = BFI.getBlockProfileCount(CB->getParent()).getValueOr(0);
+    } else {
+      Weight = double(BFI.getBlockFreq(CB->getParent()).getFrequency()) /
+               BFI.getEntryFreq();
+    }
+
+    auto It = SpecIndex.insert(std::make_pair(Args, Specs.size())).first;
+    if (It->second == Specs.size()) {
+      Specs.emplace_back();
+      Specs.back().Args = std::move(Args);
+    }
+    SpecializationInfo &S = Specs[It->second];
+    S.CallSites.push_back(CB);
+    S.Weight += Weight;
+  }
+
+  // Constant propagation takes care of the internal functions that are always
+  // called with the same constants.
+  if (Specs.empty() ||
+      (F.hasLocalLinkage() && Specs.size() == 1 && NumOtherUses == 0))
+    return false;
+
+  llvm::stable_sort(Specs,
+                    [](const SpecializationInfo &L,
+                       const SpecializationInfo &R) {
+                      return L.Weight > R.Weight;
+                    });
+  if (Specs.size() > MaxClonesThreshold)
+    Specs.resize(MaxClonesThreshold);
+
+  Function::ProfileCount EntryCount = F.getEntryCount();
+  uint64_t RemainingCount = EntryCount.hasValue() ? EntryCount.getCount() : 0;
+  for (unsigned N = 0, E = Specs.size(); N != E; ++N) {
+    Function *Clone = createSpecialization(F, Specs[N], N);
+    if (HasProfile && EntryCount.hasValue()) {
+      uint64_t Count = Specs[N].Weight;
+      Clone->setEntryCount(Count, EntryCount.getType());
+      RemainingCount -= std::min(RemainingCount, Count);
+    }
+  }
+  if (HasProfile && EntryCount.hasValue())
+    F.setEntryCount(RemainingCount, EntryCount.getType());
+
+  ++NumFuncSpecialized;
+  return true;
+}
+
+Function *FunctionSpecializer::createSpecialization(
+    Function &F, const SpecializationInfo &S, unsigned N) {
+  ValueToValueMapTy VMap;
+  Function *Clone = CloneFunction(&F, VMap);
+  Clone->setName(F.getName() + ".specialized." + Twine(N));
+  Clone->setLinkage(GlobalValue::InternalLinkage);
+  Clone->setVisibility(GlobalValue::DefaultVisibility);
+  Clone->setDLLStorageClass(GlobalValue::DefaultStorageClass);
+  Clone->setComdat(nullptr);
+  LLVM_DEBUG(dbgs() << "FnSpecialization: Created " << Clone->getName()
+                    << " for " << S.CallSites.size() << " call sites\n");
+
+  for (const auto &Arg : S.Args)
+    (Clone->arg_begin() + Arg.first)->replaceAllUsesWith(Arg.second);
+
+  // Fold what the constants make constant, so that the clone is not bigger
+  // than it has to be for the passes up to the next constant propagation.
+  const DataLayout &DL = M.getDataLayout();
+  const TargetLibraryInfo &TLI = GetTLI(F);
+  for (Instruction &I : make_early_inc_range(instructions(Clone))) {
+    Constant *C = ConstantFoldInstruction(&I, DL, &TLI);
+    if (!C)
+      continue;
+    I.replaceAllUsesWith(C);
+    if (isInstructionTriviallyDead(&I, &TLI))
+      I.eraseFromParent();
+  }
+
+  for (CallBase *CB : S.CallSites)
+    CB->setCalledFunction(Clone);
+  NumCallSitesRewritten += S.CallSites.size();
+  ++NumSpecializations;
+  return Clone;
+}
+
+bool FunctionSpecializer::run() {
+  // The clones are appended to the module, and are not specialized further.
+  SmallVector<Function *, 16> Candidates;
+  for (Function &F : M)
+    if (isCandidateFunction(F))
+      Candidates.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Candidates)
+    Changed |= specializeFunction(*F);
+  return Changed;
+}
+
+PreservedAnalyses FunctionSpecializationPass::run(Module &M,
+                                                  ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  auto GetTLI = [&FAM](Function &F) -> const TargetLibraryInfo & {
+    return FAM.getResult<TargetLibraryAnalysis>(F);
+  };
+  auto GetLI = [&FAM](Function &F) -> LoopInfo & {
+    return FAM.getResult<LoopAnalysis>(F);
+  };
+  auto GetBFI = [&FAM](Function &F) -> BlockFrequencyInfo & {
+    return FAM.getResult<BlockFrequencyAnalysis>(F);
+  };
+  ProfileSummaryInfo *PSI = &AM.getResult<ProfileSummaryAnalysis>(M);
+
+  if (!FunctionSpecializer(M, GetTLI, GetLI, GetBFI, PSI).run())
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
+
+namespace {
+
+class FunctionSpecializationLegacyPass : public ModulePass {
+public:
+  static char ID;
+
+  FunctionSpecializationLegacyPass() : ModulePass(ID) {
+    initializeFunctionSpecializationLegacyPassPass(
+        *PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    AU.addRequired<TargetLibraryInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override {
+    if (skipModule(M))
+      return false;
+
+    auto GetTLI = [this](Function &F) -> const TargetLibraryInfo & {
+      return this->getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(F);
+    };
+    auto GetLI = [this](Function &F) -> LoopInfo & {
+      return this->getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+    };
+    auto GetBFI = [this](Function &F) -> BlockFrequencyInfo & {
+      return this->getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+    };
+    ProfileSummaryInfo *PSI =
+        &getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+
+    return FunctionSpecializer(M, GetTLI, GetLI, GetBFI, PSI).run();
+  }
+};
+
+} // end anonymous namespace
+
+char FunctionSpecializationLegacyPass::ID = 0;
+
+INITIALIZE_PASS_BEGIN(FunctionSpecializationLegacyPass,
+                      "function-specialization", "Function Specialization",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_END(FunctionSpecializationLegacyPass,
+                    "function-specialization", "Function Specialization",
+                    false, false)
+
+ModulePass *llvm::createFunctionSpecializationPass() {
+  return new FunctionSpecializationLegacyPass();
+}
@@ -69,6 +69,12 @@ cl::opt<bool> RuntimeCounterRelocation(
     cl::desc("Enable relocating counters at runtime."),
     cl::init(false));
 
+cl::opt<bool> ByteCoverage(
+    "instrprof-byte-coverage", cl::ZeroOrMore,
+    cl::desc("Use single byte counters that only record whether a region was "
+             "executed, at the cost of the execution counts"),
+    cl::init(false));
+
 cl::opt<bool> ValueProfileStaticAlloc(
     "vp-static-alloc",
     cl::desc("Do static counter allocation for value profiler"),
@@ -479,6 +485,8 @@ bool InstrProfiling::isCounterPromotionEnabled() const {
   return Options.DoCounterPromotion;
 }
 
+bool InstrProfiling::isByteCoverageEnabled() const { return ByteCoverage; }
+
 void InstrProfiling::promoteCounterLoadStores(Function *F) {
   if (!isCounterPromotionEnabled())
     return;
@@ -584,6 +592,8 @@ bool InstrProfiling::run(
   emitRegistration();
   emitUses();
   emitInitialization();
+  if (isByteCoverageEnabled())
+    emitByteCoverageFlag();
   return true;
 }
 
@@ -696,10 +706,18 @@ void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
       LI = Builder.CreateLoad(Int64Ty, Bias);
     }
     auto *Add = Builder.CreateAdd(Builder.CreatePtrToInt(Addr, Int64Ty), LI);
-    Addr = Builder.CreateIntToPtr(Add, Int64PtrTy);
+    Addr = Builder.CreateIntToPtr(Add, isByteCoverageEnabled()
+                                           ? Type::getInt8PtrTy(M->getContext())
+                                           : Int64PtrTy);
   }
 
-  if (Options.Atomic || AtomicCounterUpdateAll ||
+  if (isByteCoverageEnabled()) {
+    // Covered regions are marked by clearing their counter. The store does not
+    // depend on the previous value, so it neither needs to be atomic nor to be
+    // promoted out of loops.
+    Builder.CreateStore(ConstantInt::get(Type::getInt8Ty(M->getContext()), 0),
+                        Addr);
+  } else if (Options.Atomic || AtomicCounterUpdateAll ||
       (Index == 0 && AtomicFirstCounter)) {
     Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, Inc->getStep(),
                             AtomicOrdering::Monotonic);
@@ -837,17 +855,27 @@ InstrProfiling::getOrCreateRegionCounters(InstrProfIncrementInst *Inc) {
 
   uint64_t NumCounters = Inc->getNumCounters()->getZExtValue();
   LLVMContext &Ctx = M->getContext();
-  ArrayType *CounterTy = ArrayType::get(Type::getInt64Ty(Ctx), NumCounters);
+  ArrayType *CounterTy;
+  Constant *CounterInit;
+  if (isByteCoverageEnabled()) {
+    // Byte counters start out as all ones and are cleared when the region
+    // is executed, see lowerIncrement().
+    SmallVector<uint8_t, 16> Init(NumCounters, UINT8_MAX);
+    CounterTy = ArrayType::get(Type::getInt8Ty(Ctx), NumCounters);
+    CounterInit = ConstantDataArray::get(Ctx, Init);
+  } else {
+    CounterTy = ArrayType::get(Type::getInt64Ty(Ctx), NumCounters);
+    CounterInit = Constant::getNullValue(CounterTy);
+  }
 
   // Create the counters variable.
   auto *CounterPtr =
-      new GlobalVariable(*M, CounterTy, false, Linkage,
-                         Constant::getNullValue(CounterTy),
+      new GlobalVariable(*M, CounterTy, false, Linkage, CounterInit,
                          getVarName(Inc, getInstrProfCountersVarPrefix()));
   CounterPtr->setVisibility(Visibility);
   CounterPtr->setSection(
       getInstrProfSectionName(IPSK_cnts, TT.getObjectFormat()));
-  CounterPtr->setAlignment(Align(8));
+  CounterPtr->setAlignment(Align(isByteCoverageEnabled() ? 1 : 8));
   MaybeSetComdat(CounterPtr);
   CounterPtr->setLinkage(Linkage);
 
@@ -1080,6 +1108,34 @@ void InstrProfiling::emitUses() {
     appendToUsed(*M, UsedVars);
 }
 
+void InstrProfiling::emitByteCoverageFlag() {
+  // The IR level instrumentation already defined the version variable, add
+  // the byte coverage variant to it. Otherwise define it the same way, so
+  // that it overrides the default one of the runtime.
+  const StringRef VarName(INSTR_PROF_QUOTE(INSTR_PROF_RAW_VERSION_VAR));
+  Type *Int64Ty = Type::getInt64Ty(M->getContext());
+  if (GlobalVariable *VersionVar = M->getNamedGlobal(VarName)) {
+    auto *Init = VersionVar->hasInitializer()
+                     ? dyn_cast<ConstantInt>(VersionVar->getInitializer())
+                     : nullptr;
+    if (Init)
+      VersionVar->setInitializer(ConstantInt::get(
+          Int64Ty, Init->getZExtValue() | VARIANT_MASK_BYTE_COVERAGE));
+    return;
+  }
+
+  auto *VersionVar = new GlobalVariable(
+      *M, Int64Ty, true, GlobalValue::WeakAnyLinkage,
+      ConstantInt::get(Int64Ty,
+                       INSTR_PROF_RAW_VERSION | VARIANT_MASK_BYTE_COVERAGE),
+      VarName);
+  VersionVar->setVisibility(GlobalValue::DefaultVisibility);
+  if (TT.supportsCOMDAT()) {
+    VersionVar->setLinkage(GlobalValue::ExternalLinkage);
+    VersionVar->setComdat(M->getOrInsertComdat(VarName));
+  }
+}
+
 void InstrProfiling::emitInitialization() {
   // Create ProfileFileName variable. Don't don't this for the
   // context-sensitive instrumentation lowering: This lowering is after
@@ -1,54 +1,107 @@
 #ifndef TOOLS_LLVM_DWP_DWPSTRINGPOOL
 #define TOOLS_LLVM_DWP_DWPSTRINGPOOL
 
+#include "llvm/ADT/CachedHashString.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/MC/MCSection.h"
 #include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/Threading.h"
 #include <cassert>
 
 namespace llvm {
 class DWPStringPool {
+public:
+  // The first occurrence of a string in the pool, as its shard and its index
+  // in the shard.
+  struct StringID {
+    uint32_t Shard;
+    uint32_t Index;
+  };
 
-  struct CStrDenseMapInfo {
-    static inline const char *getEmptyKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(0));
-    }
-    static inline const char *getTombstoneKey() {
-      return reinterpret_cast<const char *>(~static_cast<uintptr_t>(1));
-    }
-    static unsigned getHashValue(const char *Val) {
-      assert(Val != getEmptyKey() && "Cannot hash the empty key!");
-      assert(Val != getTombstoneKey() && "Cannot hash the tombstone key!");
-      return (unsigned)hash_value(StringRef(Val));
-    }
-    static bool isEqual(const char *LHS, const char *RHS) {
-      if (RHS == getEmptyKey())
-        return LHS == getEmptyKey();
-      if (RHS == getTombstoneKey())
-        return LHS == getTombstoneKey();
-      return strcmp(LHS, RHS) == 0;
-    }
+  // The strings of the .debug_str.dwo section of an input file, and their
+  // references in the pool once inserted.
+  struct InputStrings {
+    std::vector<CachedHashStringRef> Strings;
+    std::vector<StringID> IDs;
+  };
+
+private:
+  static constexpr uint32_t NumShards = 32;
+  static constexpr uint32_t Unassigned = ~0U;
+
+  struct Entry {
+    StringRef Str;
+    uint32_t Offset;
+  };
+
+  // The strings of a shard are in their order of first occurrence. A shard is
+  // only accessed by one thread at a time, and owns its strings so that the
+  // input files can be released once they have been written.
+  struct Shard {
+    DenseMap<CachedHashStringRef, uint32_t> Map;
+    std::vector<Entry> Entries;
+    BumpPtrAllocator Alloc;
   };
 
   MCStreamer &Out;
   MCSection *Sec;
-  DenseMap<const char *, uint32_t, CStrDenseMapInfo> Pool;
+  Shard Shards[NumShards];
   uint32_t Offset = 0;
 
 public:
   DWPStringPool(MCStreamer &Out, MCSection *Sec) : Out(Out), Sec(Sec) {}
 
-  uint32_t getOffset(const char *Str, unsigned Length) {
-    assert(strlen(Str) + 1 == Length && "Ensure length hint is correct");
+  // Deduplicates the strings of a batch of input files, in parallel on the
+  // shards. The offsets of the new strings are only assigned by getOffset, so
+  // that the section does not depend on the number of threads.
+  void insert(MutableArrayRef<InputStrings> Inputs) {
+    const unsigned Shift = 32 - countTrailingZeros(NumShards);
+    const size_t Concurrency = PowerOf2Floor(std::min<size_t>(
+        parallel::strategy.compute_thread_count(), NumShards));
+
+    for (InputStrings &Input : Inputs)
+      Input.IDs.resize(Input.Strings.size());
 
-    auto Pair = Pool.insert(std::make_pair(Str, Offset));
-    if (Pair.second) {
+    parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+      for (InputStrings &Input : Inputs) {
+        for (size_t I = 0, E = Input.Strings.size(); I != E; ++I) {
+          CachedHashStringRef Str = Input.Strings[I];
+          uint32_t ShardId = Str.hash() >> Shift;
+          if ((ShardId & (Concurrency - 1)) != ThreadId)
+            continue;
+
+          Shard &S = Shards[ShardId];
+          auto It = S.Map.find(Str);
+          if (It == S.Map.end()) {
+            StringRef Saved = StringSaver(S.Alloc).save(Str.val());
+            It = S.Map
+                     .try_emplace(CachedHashStringRef(Saved, Str.hash()),
+                                  S.Entries.size())
+                     .first;
+            S.Entries.push_back({Saved, Unassigned});
+          }
+          Input.IDs[I] = {ShardId, It->second};
+        }
+      }
+    });
+  }
+
+  // Returns the offset of a string in the output section, emitting the string
+  // if this is its first use.
+  uint32_t getOffset(StringID ID) {
+    Entry &E = Shards[ID.Shard].Entries[ID.Index];
+    if (E.Offset == Unassigned) {
+      E.Offset = Offset;
       Out.SwitchSection(Sec);
-      Out.emitBytes(StringRef(Str, Length));
-      Offset += Length;
+      // The saved strings are null terminated.
+      Out.emitBytes(StringRef(E.Str.data(), E.Str.size() + 1));
+      Offset += E.Str.size() + 1;
     }
-
-    return Pair.first->second;
+    return E.Offset;
   }
 };
 }
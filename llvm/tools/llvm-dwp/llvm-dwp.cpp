@@ -37,6 +37,7 @@
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
@@ -64,38 +65,16 @@ static cl::opt<std::string> OutputFilename(cl::Required, "o",
                                            cl::value_desc("filename"),
                                            cl::cat(DwpCategory));
 
-static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
-                                   MCSection *StrOffsetSection,
-                                   StringRef CurStrSection,
-                                   StringRef CurStrOffsetSection) {
-  // Could possibly produce an error or warning if one of these was non-null but
-  // the other was null.
-  if (CurStrSection.empty() || CurStrOffsetSection.empty())
-    return;
-
-  DenseMap<uint64_t, uint32_t> OffsetRemapping;
-
-  DataExtractor Data(CurStrSection, true, 0);
-  uint64_t LocalOffset = 0;
-  uint64_t PrevOffset = 0;
-  while (const char *s = Data.getCStr(&LocalOffset)) {
-    OffsetRemapping[PrevOffset] =
-        Strings.getOffset(s, LocalOffset - PrevOffset);
-    PrevOffset = LocalOffset;
-  }
+static cl::opt<unsigned>
+    Threads("j",
+            cl::desc("Number of threads to read the input files with (default "
+                     "is the number of hardware threads)"),
+            cl::init(0), cl::value_desc("N"), cl::cat(DwpCategory));
 
-  Data = DataExtractor(CurStrOffsetSection, true, 0);
-
-  Out.SwitchSection(StrOffsetSection);
-
-  uint64_t Offset = 0;
-  uint64_t Size = CurStrOffsetSection.size();
-  while (Offset < Size) {
-    auto OldOffset = Data.getU32(&Offset);
-    auto NewOffset = OffsetRemapping[OldOffset];
-    Out.emitIntValue(NewOffset, 4);
-  }
-}
+// The input files are read in parallel by batches, and written in their order
+// once a batch has been read. Only the files of one batch are kept in memory.
+static constexpr size_t FilesPerThread = 4;
+static constexpr size_t MinBatchSize = 16;
 
 static uint64_t getCUAbbrev(StringRef Abbrev, uint64_t AbbrCode) {
   uint64_t CurCode;
@@ -210,6 +189,66 @@ static Expected<CompileUnitIdentifiers> getCUIdentifiers(StringRef Abbrev,
   return ID;
 }
 
+namespace {
+// A section of an input file to be copied to the package.
+struct InputSection {
+  MCSection *OutSection;
+  DWARFSectionKind Kind;
+  StringRef Contents;
+};
+
+// The sections of an input .dwo or .dwp file and what was parsed from them
+// while reading it.
+struct DWOInput {
+  OwningBinary<ObjectFile> Obj;
+  std::deque<SmallString<32>> UncompressedSections;
+  std::vector<InputSection> Sections;
+  StringRef StrSection;
+  StringRef StrOffsetSection;
+  std::vector<StringRef> TypesSections;
+  StringRef InfoSection;
+  StringRef AbbrevSection;
+  StringRef CUIndexSection;
+  StringRef TUIndexSection;
+  // The offsets in StrSection of the strings inserted in the string pool.
+  std::vector<uint64_t> StrOffsets;
+  // The identifiers of the compile unit of a .dwo file.
+  CompileUnitIdentifiers ID;
+};
+} // namespace
+
+static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
+                                   MCSection *StrOffsetSection,
+                                   const DWOInput &In,
+                                   const DWPStringPool::InputStrings &InStrs) {
+  // Could possibly produce an error or warning if one of these was non-null but
+  // the other was null.
+  if (In.StrSection.empty() || In.StrOffsetSection.empty())
+    return;
+
+  // Assign the offsets in the order of the strings, as the strings that were
+  // not seen before are emitted when they are assigned.
+  std::vector<uint32_t> NewOffsets;
+  NewOffsets.reserve(InStrs.IDs.size());
+  for (DWPStringPool::StringID ID : InStrs.IDs)
+    NewOffsets.push_back(Strings.getOffset(ID));
+
+  DataExtractor Data(In.StrOffsetSection, true, 0);
+
+  Out.SwitchSection(StrOffsetSection);
+
+  uint64_t Offset = 0;
+  uint64_t Size = In.StrOffsetSection.size();
+  while (Offset < Size) {
+    auto OldOffset = Data.getU32(&Offset);
+    auto It = llvm::lower_bound(In.StrOffsets, OldOffset);
+    uint32_t NewOffset = 0;
+    if (It != In.StrOffsets.end() && *It == OldOffset)
+      NewOffset = NewOffsets[It - In.StrOffsets.begin()];
+    Out.emitIntValue(NewOffset, 4);
+  }
+}
+
 struct UnitIndexEntry {
   DWARFUnitIndex::Entry::SectionContribution Contributions[8];
   std::string Name;
@@ -423,17 +462,11 @@ handleCompressedSection(std::deque<SmallString<32>> &UncompressedSections,
   return Error::success();
 }
 
-static Error handleSection(
-    const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
-    const MCSection *StrSection, const MCSection *StrOffsetSection,
-    const MCSection *TypesSection, const MCSection *CUIndexSection,
-    const MCSection *TUIndexSection, const SectionRef &Section, MCStreamer &Out,
-    std::deque<SmallString<32>> &UncompressedSections,
-    uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
-    StringRef &CurStrSection, StringRef &CurStrOffsetSection,
-    std::vector<StringRef> &CurTypesSection, StringRef &InfoSection,
-    StringRef &AbbrevSection, StringRef &CurCUIndexSection,
-    StringRef &CurTUIndexSection) {
+using KnownSectionMap = StringMap<std::pair<MCSection *, DWARFSectionKind>>;
+
+static Error readSection(const KnownSectionMap &KnownSections,
+                         const MCObjectFileInfo &MCOFI,
+                         const SectionRef &Section, DWOInput &In) {
   if (Section.isBSS())
     return Error::success();
 
@@ -450,7 +483,8 @@ static Error handleSection(
     return ContentsOrErr.takeError();
   StringRef Contents = *ContentsOrErr;
 
-  if (auto Err = handleCompressedSection(UncompressedSections, Name, Contents))
+  if (auto Err =
+          handleCompressedSection(In.UncompressedSections, Name, Contents))
     return Err;
 
   Name = Name.substr(Name.find_first_not_of("._"));
@@ -459,44 +493,100 @@ static Error handleSection(
   if (SectionPair == KnownSections.end())
     return Error::success();
 
-  if (DWARFSectionKind Kind = SectionPair->second.second) {
-    auto Index = getContributionIndex(Kind);
-    if (Kind != DW_SECT_EXT_TYPES) {
-      CurEntry.Contributions[Index].Offset = ContributionOffsets[Index];
-      ContributionOffsets[Index] +=
-          (CurEntry.Contributions[Index].Length = Contents.size());
-    }
+  DWARFSectionKind Kind = SectionPair->second.second;
+  switch (Kind) {
+  case DW_SECT_INFO:
+    In.InfoSection = Contents;
+    break;
+  case DW_SECT_ABBREV:
+    In.AbbrevSection = Contents;
+    break;
+  default:
+    break;
+  }
 
-    switch (Kind) {
-    case DW_SECT_INFO:
-      InfoSection = Contents;
-      break;
-    case DW_SECT_ABBREV:
-      AbbrevSection = Contents;
-      break;
-    default:
-      break;
+  MCSection *OutSection = SectionPair->second.first;
+  if (OutSection == MCOFI.getDwarfStrOffDWOSection())
+    In.StrOffsetSection = Contents;
+  else if (OutSection == MCOFI.getDwarfStrDWOSection())
+    In.StrSection = Contents;
+  else if (OutSection == MCOFI.getDwarfTypesDWOSection())
+    In.TypesSections.push_back(Contents);
+  else if (OutSection == MCOFI.getDwarfCUIndexSection())
+    In.CUIndexSection = Contents;
+  else if (OutSection == MCOFI.getDwarfTUIndexSection())
+    In.TUIndexSection = Contents;
+  In.Sections.push_back({OutSection, Kind, Contents});
+  return Error::success();
+}
+
+// Reads an input file, and the strings and compile unit identifiers of a .dwo
+// file. This only depends on the file, so that the files can be read in
+// parallel.
+static Error readInput(const KnownSectionMap &KnownSections,
+                       const MCObjectFileInfo &MCOFI, StringRef Input,
+                       DWOInput &In, DWPStringPool::InputStrings &InStrs) {
+  auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
+  if (!ErrOrObj)
+    return ErrOrObj.takeError();
+  In.Obj = std::move(*ErrOrObj);
+
+  for (const auto &Section : In.Obj.getBinary()->sections())
+    if (auto Err = readSection(KnownSections, MCOFI, Section, In))
+      return Err;
+
+  if (In.InfoSection.empty())
+    return Error::success();
+
+  if (!In.StrSection.empty() && !In.StrOffsetSection.empty()) {
+    DataExtractor Data(In.StrSection, true, 0);
+    uint64_t LocalOffset = 0;
+    uint64_t PrevOffset = 0;
+    while (const char *s = Data.getCStr(&LocalOffset)) {
+      In.StrOffsets.push_back(PrevOffset);
+      InStrs.Strings.emplace_back(StringRef(s, LocalOffset - PrevOffset - 1));
+      PrevOffset = LocalOffset;
     }
   }
 
-  MCSection *OutSection = SectionPair->second.first;
-  if (OutSection == StrOffsetSection)
-    CurStrOffsetSection = Contents;
-  else if (OutSection == StrSection)
-    CurStrSection = Contents;
-  else if (OutSection == TypesSection)
-    CurTypesSection.push_back(Contents);
-  else if (OutSection == CUIndexSection)
-    CurCUIndexSection = Contents;
-  else if (OutSection == TUIndexSection)
-    CurTUIndexSection = Contents;
-  else {
-    Out.SwitchSection(OutSection);
-    Out.emitBytes(Contents);
+  if (In.CUIndexSection.empty()) {
+    Expected<CompileUnitIdentifiers> EID =
+        getCUIdentifiers(In.AbbrevSection, In.InfoSection, In.StrOffsetSection,
+                         In.StrSection);
+    if (!EID)
+      return createFileError(Input, EID.takeError());
+    In.ID = *EID;
   }
   return Error::success();
 }
 
+// Adds the contributions of the sections of an input file to the index entry
+// of its unit, and copies the sections that are not rewritten.
+static void addSections(MCStreamer &Out, const MCObjectFileInfo &MCOFI,
+                        const DWOInput &In, uint32_t (&ContributionOffsets)[8],
+                        UnitIndexEntry &CurEntry) {
+  for (const InputSection &Section : In.Sections) {
+    if (DWARFSectionKind Kind = Section.Kind) {
+      auto Index = getContributionIndex(Kind);
+      if (Kind != DW_SECT_EXT_TYPES) {
+        CurEntry.Contributions[Index].Offset = ContributionOffsets[Index];
+        ContributionOffsets[Index] +=
+            (CurEntry.Contributions[Index].Length = Section.Contents.size());
+      }
+    }
+
+    MCSection *OutSection = Section.OutSection;
+    if (OutSection != MCOFI.getDwarfStrOffDWOSection() &&
+        OutSection != MCOFI.getDwarfStrDWOSection() &&
+        OutSection != MCOFI.getDwarfTypesDWOSection() &&
+        OutSection != MCOFI.getDwarfCUIndexSection() &&
+        OutSection != MCOFI.getDwarfTUIndexSection()) {
+      Out.SwitchSection(OutSection);
+      Out.emitBytes(Section.Contents);
+    }
+  }
+}
+
 static Error
 buildDuplicateError(const std::pair<uint64_t, UnitIndexEntry> &PrevE,
                     const CompileUnitIdentifiers &ID, StringRef DWPName) {
@@ -536,14 +626,106 @@ getDWOFilenames(StringRef ExecFilename) {
   return std::move(DWOPaths);
 }
 
+// Writes an input file that has been read without error, or returns the
+// error that reading it produced.
+static Error
+processInput(MCStreamer &Out, const MCObjectFileInfo &MCOFI,
+             DWPStringPool &Strings, StringRef Input, const DWOInput &In,
+             const DWPStringPool::InputStrings &InStrs, Error ReadErr,
+             uint32_t (&ContributionOffsets)[8],
+             MapVector<uint64_t, UnitIndexEntry> &IndexEntries,
+             MapVector<uint64_t, UnitIndexEntry> &TypeIndexEntries) {
+  if (ReadErr)
+    return ReadErr;
+
+  UnitIndexEntry CurEntry = {};
+  addSections(Out, MCOFI, In, ContributionOffsets, CurEntry);
+
+  if (In.InfoSection.empty())
+    return Error::success();
+
+  MCSection *const TypesSection = MCOFI.getDwarfTypesDWOSection();
+  writeStringsAndOffsets(Out, Strings, MCOFI.getDwarfStrOffDWOSection(), In,
+                         InStrs);
+
+  if (In.CUIndexSection.empty()) {
+    const auto &ID = In.ID;
+    auto P = IndexEntries.insert(std::make_pair(ID.Signature, CurEntry));
+    if (!P.second)
+      return buildDuplicateError(*P.first, ID, "");
+    P.first->second.Name = ID.Name;
+    P.first->second.DWOName = ID.DWOName;
+    addAllTypes(Out, TypeIndexEntries, TypesSection, In.TypesSections,
+                CurEntry,
+                ContributionOffsets[getContributionIndex(DW_SECT_EXT_TYPES)]);
+    return Error::success();
+  }
+
+  const ObjectFile &Obj = *In.Obj.getBinary();
+  DWARFUnitIndex CUIndex(DW_SECT_INFO);
+  DataExtractor CUIndexData(In.CUIndexSection, Obj.isLittleEndian(), 0);
+  if (!CUIndex.parse(CUIndexData))
+    return make_error<DWPError>("failed to parse cu_index");
+  if (CUIndex.getVersion() != 2)
+    return make_error<DWPError>(
+        "unsupported cu_index version: " + utostr(CUIndex.getVersion()) +
+        " (only version 2 is supported)");
+
+  for (const DWARFUnitIndex::Entry &E : CUIndex.getRows()) {
+    auto *I = E.getContributions();
+    if (!I)
+      continue;
+    auto P = IndexEntries.insert(std::make_pair(E.getSignature(), CurEntry));
+    Expected<CompileUnitIdentifiers> EID = getCUIdentifiers(
+        getSubsection(In.AbbrevSection, E, DW_SECT_ABBREV),
+        getSubsection(In.InfoSection, E, DW_SECT_INFO),
+        getSubsection(In.StrOffsetSection, E, DW_SECT_STR_OFFSETS),
+        In.StrSection);
+    if (!EID)
+      return createFileError(Input, EID.takeError());
+    const auto &ID = *EID;
+    if (!P.second)
+      return buildDuplicateError(*P.first, ID, Input);
+    auto &NewEntry = P.first->second;
+    NewEntry.Name = ID.Name;
+    NewEntry.DWOName = ID.DWOName;
+    NewEntry.DWPName = Input;
+    for (auto Kind : CUIndex.getColumnKinds()) {
+      if (!isSupportedSectionKind(Kind))
+        continue;
+      auto &C = NewEntry.Contributions[getContributionIndex(Kind)];
+      C.Offset += I->Offset;
+      C.Length = I->Length;
+      ++I;
+    }
+  }
+
+  if (!In.TypesSections.empty()) {
+    if (In.TypesSections.size() != 1)
+      return make_error<DWPError>("multiple type unit sections in .dwp file");
+    DWARFUnitIndex TUIndex(DW_SECT_EXT_TYPES);
+    DataExtractor TUIndexData(In.TUIndexSection, Obj.isLittleEndian(), 0);
+    if (!TUIndex.parse(TUIndexData))
+      return make_error<DWPError>("failed to parse tu_index");
+    if (TUIndex.getVersion() != 2)
+      return make_error<DWPError>(
+          "unsupported tu_index version: " + utostr(TUIndex.getVersion()) +
+          " (only version 2 is supported)");
+
+    addAllTypesFromDWP(
+        Out, TypeIndexEntries, TUIndex, TypesSection, In.TypesSections.front(),
+        CurEntry, ContributionOffsets[getContributionIndex(DW_SECT_EXT_TYPES)]);
+  }
+  return Error::success();
+}
+
 static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
   const auto &MCOFI = *Out.getContext().getObjectFileInfo();
   MCSection *const StrSection = MCOFI.getDwarfStrDWOSection();
   MCSection *const StrOffsetSection = MCOFI.getDwarfStrOffDWOSection();
-  MCSection *const TypesSection = MCOFI.getDwarfTypesDWOSection();
   MCSection *const CUIndexSection = MCOFI.getDwarfCUIndexSection();
   MCSection *const TUIndexSection = MCOFI.getDwarfTUIndexSection();
-  const StringMap<std::pair<MCSection *, DWARFSectionKind>> KnownSections = {
+  const KnownSectionMap KnownSections = {
       {"debug_info.dwo", {MCOFI.getDwarfInfoDWOSection(), DW_SECT_INFO}},
       {"debug_types.dwo", {MCOFI.getDwarfTypesDWOSection(), DW_SECT_EXT_TYPES}},
       {"debug_str_offsets.dwo", {StrOffsetSection, DW_SECT_STR_OFFSETS}},
@@ -561,116 +743,33 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 
   DWPStringPool Strings(Out, StrSection);
 
-  SmallVector<OwningBinary<object::ObjectFile>, 128> Objects;
-  Objects.reserve(Inputs.size());
-
-  std::deque<SmallString<32>> UncompressedSections;
-
-  for (const auto &Input : Inputs) {
-    auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
-    if (!ErrOrObj)
-      return ErrOrObj.takeError();
-
-    auto &Obj = *ErrOrObj->getBinary();
-    Objects.push_back(std::move(*ErrOrObj));
-
-    UnitIndexEntry CurEntry = {};
-
-    StringRef CurStrSection;
-    StringRef CurStrOffsetSection;
-    std::vector<StringRef> CurTypesSection;
-    StringRef InfoSection;
-    StringRef AbbrevSection;
-    StringRef CurCUIndexSection;
-    StringRef CurTUIndexSection;
-
-    for (const auto &Section : Obj.sections())
-      if (auto Err = handleSection(
-              KnownSections, StrSection, StrOffsetSection, TypesSection,
-              CUIndexSection, TUIndexSection, Section, Out,
-              UncompressedSections, ContributionOffsets, CurEntry,
-              CurStrSection, CurStrOffsetSection, CurTypesSection, InfoSection,
-              AbbrevSection, CurCUIndexSection, CurTUIndexSection))
+  const size_t BatchSize = std::max(
+      parallel::strategy.compute_thread_count() * FilesPerThread, MinBatchSize);
+  for (size_t BatchBegin = 0; BatchBegin < Inputs.size();
+       BatchBegin += BatchSize) {
+    ArrayRef<std::string> Batch = Inputs.slice(
+        BatchBegin, std::min(BatchSize, Inputs.size() - BatchBegin));
+
+    std::vector<DWOInput> Files(Batch.size());
+    std::vector<DWPStringPool::InputStrings> FileStrings(Batch.size());
+    std::vector<Optional<Error>> Errors(Batch.size());
+    parallelForEachN(0, Batch.size(), [&](size_t I) {
+      Errors[I] =
+          readInput(KnownSections, MCOFI, Batch[I], Files[I], FileStrings[I]);
+    });
+    Strings.insert(FileStrings);
+
+    for (size_t I = 0, E = Batch.size(); I != E; ++I) {
+      if (Error Err = processInput(Out, MCOFI, Strings, Batch[I], Files[I],
+                                   FileStrings[I], std::move(*Errors[I]),
+                                   ContributionOffsets, IndexEntries,
+                                   TypeIndexEntries)) {
+        // Report the first error in the order of the input files.
+        for (size_t J = I + 1; J != E; ++J)
+          consumeError(std::move(*Errors[J]));
         return Err;
-
-    if (InfoSection.empty())
-      continue;
-
-    writeStringsAndOffsets(Out, Strings, StrOffsetSection, CurStrSection,
-                           CurStrOffsetSection);
-
-    if (CurCUIndexSection.empty()) {
-      Expected<CompileUnitIdentifiers> EID = getCUIdentifiers(
-          AbbrevSection, InfoSection, CurStrOffsetSection, CurStrSection);
-      if (!EID)
-        return createFileError(Input, EID.takeError());
-      const auto &ID = *EID;
-      auto P = IndexEntries.insert(std::make_pair(ID.Signature, CurEntry));
-      if (!P.second)
-        return buildDuplicateError(*P.first, ID, "");
-      P.first->second.Name = ID.Name;
-      P.first->second.DWOName = ID.DWOName;
-      addAllTypes(Out, TypeIndexEntries, TypesSection, CurTypesSection,
-                  CurEntry,
-                  ContributionOffsets[getContributionIndex(DW_SECT_EXT_TYPES)]);
-      continue;
-    }
-
-    DWARFUnitIndex CUIndex(DW_SECT_INFO);
-    DataExtractor CUIndexData(CurCUIndexSection, Obj.isLittleEndian(), 0);
-    if (!CUIndex.parse(CUIndexData))
-      return make_error<DWPError>("failed to parse cu_index");
-    if (CUIndex.getVersion() != 2)
-      return make_error<DWPError>(
-          "unsupported cu_index version: " + utostr(CUIndex.getVersion()) +
-          " (only version 2 is supported)");
-
-    for (const DWARFUnitIndex::Entry &E : CUIndex.getRows()) {
-      auto *I = E.getContributions();
-      if (!I)
-        continue;
-      auto P = IndexEntries.insert(std::make_pair(E.getSignature(), CurEntry));
-      Expected<CompileUnitIdentifiers> EID = getCUIdentifiers(
-          getSubsection(AbbrevSection, E, DW_SECT_ABBREV),
-          getSubsection(InfoSection, E, DW_SECT_INFO),
-          getSubsection(CurStrOffsetSection, E, DW_SECT_STR_OFFSETS),
-          CurStrSection);
-      if (!EID)
-        return createFileError(Input, EID.takeError());
-      const auto &ID = *EID;
-      if (!P.second)
-        return buildDuplicateError(*P.first, ID, Input);
-      auto &NewEntry = P.first->second;
-      NewEntry.Name = ID.Name;
-      NewEntry.DWOName = ID.DWOName;
-      NewEntry.DWPName = Input;
-      for (auto Kind : CUIndex.getColumnKinds()) {
-        if (!isSupportedSectionKind(Kind))
-          continue;
-        auto &C = NewEntry.Contributions[getContributionIndex(Kind)];
-        C.Offset += I->Offset;
-        C.Length = I->Length;
-        ++I;
       }
     }
-
-    if (!CurTypesSection.empty()) {
-      if (CurTypesSection.size() != 1)
-        return make_error<DWPError>("multiple type unit sections in .dwp file");
-      DWARFUnitIndex TUIndex(DW_SECT_EXT_TYPES);
-      DataExtractor TUIndexData(CurTUIndexSection, Obj.isLittleEndian(), 0);
-      if (!TUIndex.parse(TUIndexData))
-        return make_error<DWPError>("failed to parse tu_index");
-      if (TUIndex.getVersion() != 2)
-        return make_error<DWPError>(
-            "unsupported tu_index version: " + utostr(TUIndex.getVersion()) +
-            " (only version 2 is supported)");
-
-      addAllTypesFromDWP(
-          Out, TypeIndexEntries, TUIndex, TypesSection, CurTypesSection.front(),
-          CurEntry,
-          ContributionOffsets[getContributionIndex(DW_SECT_EXT_TYPES)]);
-    }
   }
 
   // Lie about there being no info contributions so the TU index only includes
@@ -708,6 +807,7 @@ int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
 
   cl::ParseCommandLineOptions(argc, argv, "merge split dwarf (.dwo) files\n");
+  parallel::strategy = hardware_concurrency(Threads);
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
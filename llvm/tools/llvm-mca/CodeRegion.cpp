@@ -16,7 +16,8 @@
 namespace llvm {
 namespace mca {
 
-CodeRegions::CodeRegions(llvm::SourceMgr &S) : SM(S), FoundErrors(false) {
+CodeRegions::CodeRegions(llvm::SourceMgr &S)
+    : SM(S), FoundErrors(false), RepeatCount(0) {
   // Create a default region for the input code sequence.
   Regions.emplace_back(std::make_unique<CodeRegion>("", SMLoc()));
 }
@@ -105,7 +106,57 @@ void CodeRegions::endRegion(StringRef Description, SMLoc Loc) {
   }
 }
 
+void CodeRegions::beginRepeat(unsigned Count, SMLoc Loc) {
+  if (RepeatLoc.isValid()) {
+    SM.PrintMessage(Loc, SourceMgr::DK_Error,
+                    "repeat blocks cannot be nested");
+    SM.PrintMessage(RepeatLoc, SourceMgr::DK_Note,
+                    "Previous repeat block was defined here");
+    FoundErrors = true;
+    return;
+  }
+  if (Count == 0) {
+    SM.PrintMessage(Loc, SourceMgr::DK_Error,
+                    "expected a positive repeat count");
+    FoundErrors = true;
+    return;
+  }
+  RepeatCount = Count;
+  RepeatLoc = Loc;
+}
+
+void CodeRegions::endRepeat(SMLoc Loc) {
+  if (!RepeatLoc.isValid()) {
+    SM.PrintMessage(Loc, SourceMgr::DK_Error,
+                    "found a repeat end directive without a repeat block");
+    FoundErrors = true;
+    return;
+  }
+  for (unsigned I = 0; I < RepeatCount; ++I)
+    for (const MCInst &Instruction : RepeatedInstructions)
+      addToRegions(Instruction);
+  RepeatedInstructions.clear();
+  RepeatCount = 0;
+  RepeatLoc = SMLoc();
+}
+
+void CodeRegions::checkRepeatClosed() {
+  if (!RepeatLoc.isValid())
+    return;
+  SM.PrintMessage(RepeatLoc, SourceMgr::DK_Error,
+                  "repeat block is never closed");
+  FoundErrors = true;
+}
+
 void CodeRegions::addInstruction(const MCInst &Instruction) {
+  if (RepeatLoc.isValid()) {
+    RepeatedInstructions.emplace_back(Instruction);
+    return;
+  }
+  addToRegions(Instruction);
+}
+
+void CodeRegions::addToRegions(const MCInst &Instruction) {
   SMLoc Loc = Instruction.getLoc();
   for (UniqueCodeRegion &Region : Regions)
     if (Region->isLocInRange(Loc))
@@ -92,6 +92,16 @@ class CodeRegions {
   llvm::StringMap<unsigned> ActiveRegions;
   bool FoundErrors;
 
+  // The instructions of the open LLVM-MCA-REPEAT block, which are added to
+  // the regions RepeatCount times once the block is closed. Hardware loops,
+  // like the FREP and Xpulp loops of RISC-V, repeat their body without any
+  // instruction in the input marking the iterations.
+  llvm::SmallVector<llvm::MCInst, 8> RepeatedInstructions;
+  unsigned RepeatCount;
+  llvm::SMLoc RepeatLoc;
+
+  void addToRegions(const llvm::MCInst &Instruction);
+
   CodeRegions(const CodeRegions &) = delete;
   CodeRegions &operator=(const CodeRegions &) = delete;
 
@@ -108,6 +118,10 @@ public:
 
   void beginRegion(llvm::StringRef Description, llvm::SMLoc Loc);
   void endRegion(llvm::StringRef Description, llvm::SMLoc Loc);
+  void beginRepeat(unsigned Count, llvm::SMLoc Loc);
+  void endRepeat(llvm::SMLoc Loc);
+  /// Diagnose a LLVM-MCA-REPEAT block left open at the end of the input.
+  void checkRepeatClosed();
   void addInstruction(const llvm::MCInst &Instruction);
   llvm::SourceMgr &getSourceMgr() const { return SM; }
 
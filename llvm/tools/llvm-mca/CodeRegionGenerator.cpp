@@ -85,6 +85,20 @@ void MCACommentConsumer::HandleComment(SMLoc Loc, StringRef CommentText) {
     return;
 
   Comment = Comment.drop_front(Position);
+  if (Comment.consume_front("LLVM-MCA-REPEAT-END")) {
+    Regions.endRepeat(Loc);
+    return;
+  }
+
+  // The instructions up to LLVM-MCA-REPEAT-END are executed <count> times.
+  if (Comment.consume_front("LLVM-MCA-REPEAT")) {
+    unsigned Count;
+    if (Comment.trim().getAsInteger(10, Count))
+      Count = 0;
+    Regions.beginRepeat(Count, Loc);
+    return;
+  }
+
   if (Comment.consume_front("LLVM-MCA-END")) {
     // Skip spaces and tabs.
     Position = Comment.find_first_not_of(" \t");
@@ -129,6 +143,7 @@ Expected<const CodeRegions &> AsmCodeRegionGenerator::parseCodeRegions() {
         inconvertibleErrorCode());
   Parser->setTargetParser(*TAP);
   Parser->Run(false);
+  Regions.checkRepeatClosed();
 
   // Set the assembler dialect from the input. llvm-mca will use this as the
   // default dialect when printing reports.
@@ -571,7 +571,8 @@ CompressedSection::CompressedSection(const SectionBase &Sec,
       DecompressedSize(Sec.OriginalData.size()), DecompressedAlign(Sec.Align) {
   ErrorAsOutParameter EAO(&OutErr);
 
-  if (Error Err = zlib::compress(
+  // Large sections are deflated in independent chunks in parallel.
+  if (Error Err = zlib::compressParallel(
           StringRef(reinterpret_cast<const char *>(OriginalData.data()),
                     OriginalData.size()),
           CompressedData)) {
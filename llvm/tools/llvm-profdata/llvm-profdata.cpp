@@ -32,6 +32,7 @@
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 
 using namespace llvm;
 
@@ -329,9 +330,6 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   if (NumThreads == 0)
     NumThreads = std::min(hardware_concurrency().compute_thread_count(),
                           unsigned((Inputs.size() + 1) / 2));
-  // FIXME: There's a bug here, where setting NumThreads = Inputs.size() fails
-  // the merge_empty_profile.test because the InstrProfWriter.ProfileKind isn't
-  // merged, thus the emitted file ends up with a PF_Unknown kind.
 
   // Initialize the writer contexts.
   SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
@@ -345,12 +343,16 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   } else {
     ThreadPool Pool(hardware_concurrency(NumThreads));
 
-    // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
-    for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Remapper, Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
-    }
+    // Load the inputs in parallel (N/NumThreads serial steps). Each context is
+    // filled by a single task taking the next input that is left, so that the
+    // work stays balanced however long the inputs take to load, and only one
+    // input per thread is in memory at a time.
+    std::atomic<size_t> NextInput(0);
+    for (unsigned I = 0; I < NumThreads; ++I)
+      Pool.async([&, I]() {
+        for (size_t J = NextInput++; J < Inputs.size(); J = NextInput++)
+          loadInput(Inputs[J], Remapper, Contexts[I].get());
+      });
     Pool.wait();
 
     // Merge the writer contexts together (~ lg(NumThreads) serial steps).
@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Opts.inc"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/Symbolize/DIPrinter.h"
@@ -29,11 +30,23 @@
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <mutex>
 #include <string>
+#include <thread>
+
+#ifdef LLVM_ON_UNIX
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 using namespace llvm;
 using namespace symbolize;
@@ -138,21 +151,21 @@ static bool parseCommand(StringRef BinaryName, bool IsAddr2Line,
 static void symbolizeInput(const opt::InputArgList &Args, uint64_t AdjustVMA,
                            bool IsAddr2Line, DIPrinter::OutputStyle OutputStyle,
                            StringRef InputString, LLVMSymbolizer &Symbolizer,
-                           DIPrinter &Printer) {
+                           DIPrinter &Printer, raw_ostream &OS) {
   Command Cmd;
   std::string ModuleName;
   uint64_t Offset = 0;
   if (!parseCommand(Args.getLastArgValue(OPT_obj_EQ), IsAddr2Line,
                     StringRef(InputString), Cmd, ModuleName, Offset)) {
-    outs() << InputString << "\n";
+    OS << InputString << "\n";
     return;
   }
 
   if (Args.hasArg(OPT_addresses)) {
-    outs() << "0x";
-    outs().write_hex(Offset);
+    OS << "0x";
+    OS.write_hex(Offset);
     StringRef Delimiter = Args.hasArg(OPT_pretty_print) ? ": " : "\n";
-    outs() << Delimiter;
+    OS << Delimiter;
   }
   Offset -= AdjustVMA;
   if (Cmd == Command::Data) {
@@ -166,7 +179,7 @@ static void symbolizeInput(const opt::InputArgList &Args, uint64_t AdjustVMA,
       for (DILocal Local : *ResOrErr)
         Printer << Local;
       if (ResOrErr->empty())
-        outs() << "??\n";
+        OS << "??\n";
     }
   } else if (Args.hasFlag(OPT_inlines, OPT_no_inlines, !IsAddr2Line)) {
     auto ResOrErr = Symbolizer.symbolizeInlinedCode(
@@ -193,7 +206,168 @@ static void symbolizeInput(const opt::InputArgList &Args, uint64_t AdjustVMA,
     Printer << (error(ResOrErr) ? DILineInfo() : ResOrErr.get());
   }
   if (OutputStyle == DIPrinter::OutputStyle::LLVM)
-    outs() << "\n";
+    OS << "\n";
+}
+
+/// Symbolizes one input line with the given symbolizer into the given stream.
+using SymbolizeFn =
+    function_ref<void(StringRef, LLVMSymbolizer &, raw_ostream &)>;
+
+#ifdef LLVM_ON_UNIX
+namespace {
+/// A symbolizer of the server with its own module cache. The modules are
+/// spread over the shards by name, so that each one is only parsed once while
+/// different modules are symbolized at the same time.
+struct SymbolizerShard {
+  SymbolizerShard(const LLVMSymbolizer::Options &Opts) : Symbolizer(Opts) {}
+
+  std::mutex Lock;
+  LLVMSymbolizer Symbolizer;
+};
+} // namespace
+
+/// Returns the output for a batch of input lines, in order.
+static std::string
+symbolizeBatch(ArrayRef<std::string> Lines, StringRef ObjName, bool IsAddr2Line,
+               ArrayRef<std::unique_ptr<SymbolizerShard>> Shards,
+               ThreadPool &Pool, SymbolizeFn Symbolize) {
+  std::vector<std::vector<size_t>> LinesOfShard(Shards.size());
+  for (size_t I = 0, E = Lines.size(); I != E; ++I) {
+    Command Cmd;
+    std::string ModuleName;
+    uint64_t Offset;
+    parseCommand(ObjName, IsAddr2Line, Lines[I], Cmd, ModuleName, Offset);
+    LinesOfShard[hash_value(ModuleName) % Shards.size()].push_back(I);
+  }
+
+  std::vector<std::string> Results(Lines.size());
+  std::vector<std::shared_future<void>> Futures;
+  for (size_t S = 0, E = Shards.size(); S != E; ++S) {
+    if (LinesOfShard[S].empty())
+      continue;
+    Futures.push_back(Pool.async([&, S] {
+      SymbolizerShard &Shard = *Shards[S];
+      std::lock_guard<std::mutex> Guard(Shard.Lock);
+      for (size_t I : LinesOfShard[S]) {
+        raw_string_ostream OS(Results[I]);
+        Symbolize(Lines[I], Shard.Symbolizer, OS);
+      }
+    }));
+  }
+  for (std::shared_future<void> &Future : Futures)
+    Future.wait();
+
+  std::string Output;
+  for (const std::string &Result : Results)
+    Output += Result;
+  return Output;
+}
+
+static bool writeAll(int FD, StringRef Data) {
+  while (!Data.empty()) {
+    ssize_t N = write(FD, Data.data(), Data.size());
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Data = Data.drop_front(N);
+  }
+  return true;
+}
+
+/// Answers the requests of one client. Every read that completes some lines
+/// is symbolized as one batch, so clients should send as many lines at once as
+/// they can.
+static void serveConnection(int FD, StringRef ObjName, bool IsAddr2Line,
+                            ArrayRef<std::unique_ptr<SymbolizerShard>> Shards,
+                            ThreadPool &Pool, SymbolizeFn Symbolize) {
+  std::string Pending;
+  char Buffer[1 << 16];
+  bool Done = false;
+  while (!Done) {
+    ssize_t N = read(FD, Buffer, sizeof(Buffer));
+    if (N < 0 && errno == EINTR)
+      continue;
+    Done = N <= 0;
+    if (!Done)
+      Pending.append(Buffer, N);
+
+    // Input without a final newline is only complete at the end of the stream.
+    size_t End = Done ? Pending.size() : Pending.rfind('\n');
+    if (End == std::string::npos || (Done && Pending.empty()))
+      continue;
+
+    std::vector<std::string> Lines;
+    SmallVector<StringRef, 64> Split;
+    StringRef(Pending).take_front(End).split(Split, '\n');
+    for (StringRef Line : Split)
+      Lines.push_back(Line.rtrim('\r').str());
+    Pending.erase(0, std::min(End + 1, Pending.size()));
+
+    std::string Output =
+        symbolizeBatch(Lines, ObjName, IsAddr2Line, Shards, Pool, Symbolize);
+    if (!writeAll(FD, Output))
+      return;
+  }
+}
+#endif
+
+/// Listens on the Unix domain socket \p SocketPath and symbolizes the input
+/// lines sent on each connection, as if read from stdin. The symbolizers stay
+/// alive between connections, so the debug info of a module is only parsed
+/// once for all clients.
+static int runServer(StringRef SocketPath, unsigned NumThreads,
+                     const LLVMSymbolizer::Options &Opts, StringRef ObjName,
+                     bool IsAddr2Line, SymbolizeFn Symbolize) {
+#ifndef LLVM_ON_UNIX
+  WithColor::error() << "--server is not supported on this platform\n";
+  return 1;
+#else
+  sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (SocketPath.size() >= sizeof(Addr.sun_path)) {
+    WithColor::error() << "socket path too long: " << SocketPath << "\n";
+    return 1;
+  }
+  memcpy(Addr.sun_path, SocketPath.data(), SocketPath.size());
+
+  // Replace the socket of a previous server, but nothing else.
+  sys::fs::file_status Status;
+  if (!sys::fs::status(SocketPath, Status) &&
+      Status.type() == sys::fs::file_type::socket_file)
+    sys::fs::remove(SocketPath);
+
+  int ListenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (ListenFD < 0 ||
+      bind(ListenFD, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr)) < 0 ||
+      listen(ListenFD, SOMAXCONN) < 0) {
+    WithColor::error() << "cannot listen on " << SocketPath << ": "
+                       << strerror(errno) << "\n";
+    return 1;
+  }
+  // A client going away must not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  ThreadPool Pool(hardware_concurrency(NumThreads));
+  std::vector<std::unique_ptr<SymbolizerShard>> Shards;
+  for (unsigned I = 0, E = Pool.getThreadCount(); I != E; ++I)
+    Shards.push_back(std::make_unique<SymbolizerShard>(Opts));
+
+  while (true) {
+    int FD = accept(ListenFD, nullptr, nullptr);
+    if (FD < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      WithColor::error() << "cannot accept on " << SocketPath << ": "
+                         << strerror(errno) << "\n";
+      return 1;
+    }
+    std::thread([=, &Shards, &Pool] {
+      serveConnection(FD, ObjName, IsAddr2Line, Shards, Pool, Symbolize);
+      close(FD);
+    }).detach();
+  }
+#endif
 }
 
 static void printHelp(StringRef ToolName, const SymbolizerOptTable &Tbl,
@@ -302,6 +476,7 @@ int main(int argc, char **argv) {
   }
 #endif
   Opts.UseSymbolTable = true;
+  parseIntArg(Args, OPT_cache_size_EQ, Opts.MaxCacheSize);
 
   for (const opt::Arg *A : Args.filtered(OPT_dsym_hint_EQ)) {
     StringRef Hint(A->getValue());
@@ -321,10 +496,23 @@ int main(int argc, char **argv) {
                       : DIPrinter::OutputStyle::LLVM;
   }
 
+  auto Symbolize = [&](StringRef Input, LLVMSymbolizer &Symbolizer,
+                       raw_ostream &OS) {
+    DIPrinter Printer(OS, Opts.PrintFunctions != FunctionNameKind::None,
+                      Args.hasArg(OPT_pretty_print), SourceContextLines,
+                      Args.hasArg(OPT_verbose), OutputStyle);
+    symbolizeInput(Args, AdjustVMA, IsAddr2Line, OutputStyle, Input,
+                   Symbolizer, Printer, OS);
+  };
+
+  if (const opt::Arg *A = Args.getLastArg(OPT_server_EQ)) {
+    unsigned NumThreads;
+    parseIntArg(Args, OPT_server_threads_EQ, NumThreads);
+    return runServer(A->getValue(), NumThreads, Opts,
+                     Args.getLastArgValue(OPT_obj_EQ), IsAddr2Line, Symbolize);
+  }
+
   LLVMSymbolizer Symbolizer(Opts);
-  DIPrinter Printer(outs(), Opts.PrintFunctions != FunctionNameKind::None,
-                    Args.hasArg(OPT_pretty_print), SourceContextLines,
-                    Args.hasArg(OPT_verbose), OutputStyle);
 
   std::vector<std::string> InputAddresses = Args.getAllArgValues(OPT_INPUT);
   if (InputAddresses.empty()) {
@@ -336,14 +524,12 @@ int main(int argc, char **argv) {
       std::string StrippedInputString(InputString);
       llvm::erase_if(StrippedInputString,
                      [](char c) { return c == '\r' || c == '\n'; });
-      symbolizeInput(Args, AdjustVMA, IsAddr2Line, OutputStyle,
-                     StrippedInputString, Symbolizer, Printer);
+      Symbolize(StrippedInputString, Symbolizer, outs());
       outs().flush();
     }
   } else {
     for (StringRef Address : InputAddresses)
-      symbolizeInput(Args, AdjustVMA, IsAddr2Line, OutputStyle, Address,
-                     Symbolizer, Printer);
+      Symbolize(Address, Symbolizer, outs());
   }
 
   return 0;
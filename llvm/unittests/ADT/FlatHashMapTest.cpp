@@ -0,0 +1,118 @@
+//===- llvm/unittest/ADT/FlatHashMapTest.cpp - FlatHashMap unit tests -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatHashMap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+// No key values are reserved, unlike in DenseMap.
+TEST(FlatHashMapTest, AllKeys) {
+  FlatHashMap<unsigned, unsigned> Map;
+  Map[~0U] = 1;
+  Map[~0U - 1] = 2;
+  Map[0] = 3;
+  EXPECT_EQ(3u, Map.size());
+  EXPECT_EQ(1u, Map.lookup(~0U));
+  EXPECT_EQ(2u, Map.lookup(~0U - 1));
+  EXPECT_EQ(3u, Map.lookup(0));
+  EXPECT_EQ(0u, Map.count(1));
+}
+
+TEST(FlatHashMapTest, InsertFindErase) {
+  FlatHashMap<int, std::string> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_TRUE(Map.find(1) == Map.end());
+
+  auto Res = Map.insert({1, "one"});
+  EXPECT_TRUE(Res.second);
+  EXPECT_EQ(1, Res.first->first);
+  Res = Map.insert({1, "uno"});
+  EXPECT_FALSE(Res.second);
+  EXPECT_EQ("one", Res.first->second);
+  EXPECT_TRUE(Map.try_emplace(2, "two").second);
+
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ("two", Map.find(2)->second);
+  EXPECT_TRUE(Map.erase(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(1u, Map.size());
+  Map.erase(Map.find(2));
+  EXPECT_TRUE(Map.empty());
+}
+
+TEST(FlatHashMapTest, MoveOnlyValues) {
+  FlatHashMap<int, std::unique_ptr<int>> Map;
+  for (int I = 0; I < 100; ++I)
+    Map[I] = std::make_unique<int>(I);
+  FlatHashMap<int, std::unique_ptr<int>> Moved(std::move(Map));
+  EXPECT_EQ(100u, Moved.size());
+  for (int I = 0; I < 100; ++I)
+    EXPECT_EQ(I, *Moved[I]);
+}
+
+TEST(FlatHashMapTest, CopyAndClear) {
+  FlatHashMap<int, int> Map = {{1, 2}, {3, 4}};
+  FlatHashMap<int, int> Copy(Map);
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(2u, Copy.size());
+  EXPECT_EQ(4, Copy.lookup(3));
+  Map = Copy;
+  EXPECT_EQ(2, Map.lookup(1));
+}
+
+// Compare a long sequence of random operations, with many erasures that leave
+// deleted buckets behind, against std::map.
+TEST(FlatHashMapTest, RandomOperations) {
+  std::mt19937 Rand(0);
+  FlatHashMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Expected;
+  for (unsigned I = 0; I < 100000; ++I) {
+    unsigned Key = Rand() % 4096;
+    switch (Rand() % 3) {
+    case 0:
+      EXPECT_EQ(Expected.erase(Key) != 0, Map.erase(Key));
+      break;
+    case 1:
+      Map[Key] = I;
+      Expected[Key] = I;
+      break;
+    default:
+      EXPECT_EQ(Expected.count(Key), Map.count(Key));
+      break;
+    }
+    ASSERT_EQ(Expected.size(), Map.size());
+  }
+
+  unsigned NumVisited = 0;
+  for (const auto &KV : Map) {
+    EXPECT_EQ(Expected[KV.first], KV.second);
+    ++NumVisited;
+  }
+  EXPECT_EQ(Expected.size(), NumVisited);
+}
+
+TEST(FlatHashMapTest, Reserve) {
+  FlatHashMap<int, int> Map;
+  Map.reserve(1000);
+  size_t MemorySize = Map.getMemorySize();
+  for (int I = 0; I < 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(MemorySize, Map.getMemorySize());
+}
+
+} // end anonymous namespace
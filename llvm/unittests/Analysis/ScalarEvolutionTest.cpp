@@ -1421,4 +1421,55 @@ TEST_F(ScalarEvolutionsTest, MatchURem) {
   });
 }
 
+// Make sure that forgetLoopDispositions drops the dispositions of the loop
+// the client changed, but keeps those of unrelated loops.
+TEST_F(ScalarEvolutionsTest, SCEVForgetLoopDispositions) {
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(
+      "define void @foo(i64* %p, i64 %n) { "
+      "entry: "
+      "  br label %loop1.ph "
+      "loop1.ph: "
+      "  br label %loop1 "
+      "loop1: "
+      "  %iv1 = phi i64 [ 0, %loop1.ph ], [ %iv1.next, %loop1 ] "
+      "  %x = load i64, i64* %p "
+      "  %iv1.next = add i64 %iv1, 1 "
+      "  %cmp1 = icmp slt i64 %iv1.next, %n "
+      "  br i1 %cmp1, label %loop1, label %loop2.ph "
+      "loop2.ph: "
+      "  br label %loop2 "
+      "loop2: "
+      "  %iv2 = phi i64 [ 0, %loop2.ph ], [ %iv2.next, %loop2 ] "
+      "  %iv2.next = add i64 %iv2, 1 "
+      "  %cmp2 = icmp slt i64 %iv2.next, %n "
+      "  br i1 %cmp2, label %loop2, label %exit "
+      "exit: "
+      "  ret void "
+      "} ",
+      Err, C);
+
+  ASSERT_TRUE(M && "Could not parse module?");
+  ASSERT_TRUE(!verifyModule(*M) && "Must have been well formed!");
+
+  runWithSE(*M, "foo", [](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+    auto *X = getInstructionByName(F, "x");
+    Loop *L1 = LI.getLoopFor(X->getParent());
+    Loop *L2 = LI.getLoopFor(getInstructionByName(F, "iv2")->getParent());
+    const SCEV *S = SE.getSCEV(X);
+    const SCEV *IV2 = SE.getSCEV(getInstructionByName(F, "iv2"));
+    EXPECT_EQ(SE.getLoopDisposition(S, L1), ScalarEvolution::LoopVariant);
+    EXPECT_EQ(SE.getLoopDisposition(S, L2), ScalarEvolution::LoopInvariant);
+    EXPECT_EQ(SE.getLoopDisposition(IV2, L2), ScalarEvolution::LoopComputable);
+
+    // Hoist the load out of the first loop, as LICM would.
+    X->moveBefore(L1->getLoopPreheader()->getTerminator());
+    SE.forgetLoopDispositions(L1);
+    EXPECT_EQ(SE.getLoopDisposition(S, L1), ScalarEvolution::LoopInvariant);
+    EXPECT_EQ(SE.getLoopDisposition(S, L2), ScalarEvolution::LoopInvariant);
+    EXPECT_EQ(SE.getLoopDisposition(IV2, L2), ScalarEvolution::LoopComputable);
+  });
+}
+
 }  // end namespace llvm
@@ -15,10 +15,12 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -255,4 +257,58 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// Tests that decoding the function bodies on several threads reads the same
+// module as decoding them one after another.
+TEST(BitReaderTest, MaterializeAllDecodedOnThreads) {
+  SmallString<1024> Mem;
+  LLVMContext WriteContext;
+  writeModuleToBuffer(
+      parseAssembly(WriteContext,
+                    "@g = global i32 0\n"
+                    "define i32 @f(i32 %x) !dbg !3 {\n"
+                    "entry:\n"
+                    "  %a = add i32 %x, 42, !dbg !5\n"
+                    "  br label %next\n"
+                    "next:\n"
+                    "  store i32 %a, i32* @g\n"
+                    "  ret i32 %a\n"
+                    "}\n"
+                    "define float @h(float %x) {\n"
+                    "  %m = fmul float %x, 1.5\n"
+                    "  %r = call i32 @f(i32 7)\n"
+                    "  ret float %m\n"
+                    "}\n"
+                    "define void @j() {\n"
+                    "  unreachable\n"
+                    "}\n"
+                    "!llvm.dbg.cu = !{!0}\n"
+                    "!llvm.module.flags = !{!2}\n"
+                    "!0 = distinct !DICompileUnit(language: DW_LANG_C99, "
+                    "file: !1, emissionKind: FullDebug)\n"
+                    "!1 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+                    "!2 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+                    "!3 = distinct !DISubprogram(name: \"f\", scope: !1, "
+                    "file: !1, unit: !0, spFlags: DISPFlagDefinition)\n"
+                    "!5 = !DILocation(line: 1, scope: !3)\n"),
+      Mem);
+
+  auto readModule = [&](unsigned Threads) {
+    auto *Opt = static_cast<cl::opt<unsigned> *>(
+        cl::getRegisteredOptions()["bitcode-decode-threads"]);
+    *Opt = Threads;
+    LLVMContext Context;
+    Expected<std::unique_ptr<Module>> ModuleOrErr =
+        parseBitcodeFile(MemoryBufferRef(Mem.str(), "test"), Context);
+    *Opt = 1;
+    if (!ModuleOrErr)
+      report_fatal_error("Could not parse bitcode module");
+    EXPECT_FALSE(verifyModule(**ModuleOrErr, &dbgs()));
+    std::string Str;
+    raw_string_ostream OS(Str);
+    (*ModuleOrErr)->print(OS, nullptr);
+    return OS.str();
+  };
+  EXPECT_EQ(readModule(1), readModule(4));
+}
+
 } // end namespace
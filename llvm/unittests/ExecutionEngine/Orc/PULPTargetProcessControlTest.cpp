@@ -0,0 +1,170 @@
+//===- PULPTargetProcessControlTest.cpp - Unit tests for the PULP TPC -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PULPTargetProcessControl.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Testing/Support/Error.h"
+#include "gtest/gtest.h"
+
+#include <deque>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+constexpr JITTargetAddress L2Base = 0x1c000000;
+constexpr size_t L2Size = 0x1000;
+
+// An accelerator whose L2 memory is a host buffer, and which completes every
+// kernel as soon as it is started.
+class FakePULPDriver : public PULPDriver {
+public:
+  std::vector<char> &L2;
+  std::vector<uint32_t> &Sent;
+  std::deque<uint32_t> Replies;
+
+  FakePULPDriver(std::vector<char> &L2, std::vector<uint32_t> &Sent)
+      : L2(L2), Sent(Sent) {}
+
+  Error writeMemory(JITTargetAddress Addr, ArrayRef<char> Bytes) override {
+    if (Addr < L2Base || Addr + Bytes.size() > L2Base + L2.size())
+      return make_error<StringError>("Write outside of L2",
+                                     inconvertibleErrorCode());
+    std::copy(Bytes.begin(), Bytes.end(), L2.begin() + (Addr - L2Base));
+    return Error::success();
+  }
+
+  Error writeMailbox(uint32_t Word) override {
+    Sent.push_back(Word);
+    // The start message has four words.
+    if (Sent.size() % 4 == 0) {
+      Replies.push_back(PULPTargetProcessControl::PULP_DONE);
+      Replies.push_back(42);
+    }
+    return Error::success();
+  }
+
+  Expected<uint32_t> readMailbox() override {
+    if (Replies.empty())
+      return make_error<StringError>("Mailbox is empty",
+                                     inconvertibleErrorCode());
+    uint32_t Word = Replies.front();
+    Replies.pop_front();
+    return Word;
+  }
+};
+
+class PULPTargetProcessControlTest : public testing::Test {
+protected:
+  std::vector<char> L2 = std::vector<char>(L2Size, '\xff');
+  std::vector<uint32_t> Sent;
+  std::unique_ptr<PULPTargetProcessControl> TPC;
+
+  void SetUp() override {
+    StringMap<JITTargetAddress> Symbols;
+    Symbols["hero_dma_wait"] = 0x1c008000;
+    TPC = cantFail(PULPTargetProcessControl::Create(
+        std::make_shared<SymbolStringPool>(),
+        std::make_unique<FakePULPDriver>(L2, Sent), L2Base, L2Base + L2Size,
+        std::move(Symbols)));
+  }
+};
+
+TEST_F(PULPTargetProcessControlTest, LinksIntoL2) {
+  using jitlink::JITLinkMemoryManager;
+  const auto RX = static_cast<JITLinkMemoryManager::ProtectionFlags>(
+      sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  const auto RW = static_cast<JITLinkMemoryManager::ProtectionFlags>(
+      sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+
+  JITLinkMemoryManager::SegmentsRequestMap Request;
+  Request[RX] = JITLinkMemoryManager::SegmentRequest(16, 6, 0);
+  Request[RW] = JITLinkMemoryManager::SegmentRequest(64, 4, 12);
+  auto Alloc = TPC->getMemMgr().allocate(nullptr, Request);
+  ASSERT_THAT_EXPECTED(Alloc, Succeeded());
+
+  JITTargetAddress Code = (*Alloc)->getTargetMemory(RX);
+  JITTargetAddress Data = (*Alloc)->getTargetMemory(RW);
+  EXPECT_GE(Code, L2Base);
+  EXPECT_EQ(Code % 16, 0u);
+  EXPECT_EQ(Data % 64, 0u);
+  EXPECT_LE(Data + 16, L2Base + L2Size);
+
+  // Nothing reaches the accelerator before the allocation is finalized.
+  memcpy((*Alloc)->getWorkingMemory(RX).data(), "kernel", 6);
+  memcpy((*Alloc)->getWorkingMemory(RW).data(), "data", 4);
+  EXPECT_EQ(L2[Code - L2Base], '\xff');
+  EXPECT_THAT_ERROR((*Alloc)->finalize(), Succeeded());
+  EXPECT_EQ(StringRef(&L2[Code - L2Base], 6), "kernel");
+  EXPECT_EQ(StringRef(&L2[Data - L2Base], 4), "data");
+  // The zero-fill part is cleared.
+  EXPECT_TRUE(std::all_of(&L2[Data - L2Base + 4], &L2[Data - L2Base + 16],
+                          [](char C) { return C == 0; }));
+
+  // Freed memory is reused.
+  EXPECT_THAT_ERROR((*Alloc)->deallocate(), Succeeded());
+  auto Again = TPC->getMemMgr().allocate(nullptr, Request);
+  ASSERT_THAT_EXPECTED(Again, Succeeded());
+  EXPECT_EQ((*Again)->getTargetMemory(RX), Code);
+  EXPECT_THAT_ERROR((*Again)->deallocate(), Succeeded());
+}
+
+TEST_F(PULPTargetProcessControlTest, OutOfL2) {
+  using jitlink::JITLinkMemoryManager;
+  JITLinkMemoryManager::SegmentsRequestMap Request;
+  Request[sys::Memory::MF_READ] =
+      JITLinkMemoryManager::SegmentRequest(8, L2Size + 1, 0);
+  EXPECT_THAT_EXPECTED(TPC->getMemMgr().allocate(nullptr, Request), Failed());
+}
+
+TEST_F(PULPTargetProcessControlTest, RunsKernels) {
+  auto Cycles = TPC->runKernel(0x1c000100, {7, 0x100000000});
+  ASSERT_THAT_EXPECTED(Cycles, Succeeded());
+  EXPECT_EQ(*Cycles, 42u);
+
+  // The start message points to the arguments, as 64-bit words in L2.
+  ASSERT_EQ(Sent.size(), 4u);
+  EXPECT_EQ(Sent[0], uint32_t(PULPTargetProcessControl::PULP_START));
+  EXPECT_EQ(Sent[1], 0x1c000100u);
+  EXPECT_EQ(Sent[3], 0u);
+  JITTargetAddress Args = Sent[2];
+  ASSERT_GE(Args, L2Base);
+  const char *Words = &L2[Args - L2Base];
+  EXPECT_EQ(support::endian::read64le(Words), 7u);
+  EXPECT_EQ(support::endian::read64le(Words + 8), 0x100000000u);
+}
+
+TEST_F(PULPTargetProcessControlTest, WritesMemory) {
+  auto &MA = TPC->getMemoryAccess();
+  EXPECT_THAT_ERROR(MA.writeUInt32s({{L2Base + 4, 0x11223344}}), Succeeded());
+  EXPECT_EQ(support::endian::read32le(&L2[4]), 0x11223344u);
+  EXPECT_THAT_ERROR(MA.writeUInt8s({{L2Base + L2Size, 1}}), Failed());
+}
+
+TEST_F(PULPTargetProcessControlTest, LooksUpDeviceSymbols) {
+  auto Handle = TPC->loadDylib(nullptr);
+  ASSERT_THAT_EXPECTED(Handle, Succeeded());
+  EXPECT_THAT_EXPECTED(TPC->loadDylib("libc.so"), Failed());
+
+  SymbolLookupSet Found({TPC->intern("hero_dma_wait")});
+  auto R = TPC->lookupSymbols({{*Handle, Found}});
+  ASSERT_THAT_EXPECTED(R, Succeeded());
+  EXPECT_EQ((*R)[0][0], 0x1c008000u);
+
+  SymbolLookupSet Weak;
+  Weak.add(TPC->intern("missing"), SymbolLookupFlags::WeaklyReferencedSymbol);
+  R = TPC->lookupSymbols({{*Handle, Weak}});
+  ASSERT_THAT_EXPECTED(R, Succeeded());
+  EXPECT_EQ((*R)[0][0], 0u);
+
+  SymbolLookupSet Missing({TPC->intern("missing")});
+  EXPECT_THAT_EXPECTED(TPC->lookupSymbols({{*Handle, Missing}}), Failed());
+}
+
+} // end anonymous namespace
@@ -85,9 +85,11 @@ struct OutputFunctionCoverageData {
 
 struct CoverageMappingReaderMock : CoverageMappingReader {
   ArrayRef<OutputFunctionCoverageData> Functions;
+  bool RandomAccess;
 
-  CoverageMappingReaderMock(ArrayRef<OutputFunctionCoverageData> Functions)
-      : Functions(Functions) {}
+  CoverageMappingReaderMock(ArrayRef<OutputFunctionCoverageData> Functions,
+                            bool RandomAccess = false)
+      : Functions(Functions), RandomAccess(RandomAccess) {}
 
   Error readNextRecord(CoverageMappingRecord &Record) override {
     if (Functions.empty())
@@ -98,6 +100,16 @@ struct CoverageMappingReaderMock : CoverageMappingReader {
 
     return Error::success();
   }
+
+  size_t getNumRecords() const override {
+    return RandomAccess ? Functions.size() : 0;
+  }
+
+  Error readRecord(size_t Index, CoverageMappingRecord &Record,
+                   RecordBuffers &) const override {
+    Functions[Index].fillCoverageMappingRecord(Record);
+    return Error::success();
+  }
 };
 
 struct InputFunctionCoverageData {
@@ -128,6 +140,8 @@ struct InputFunctionCoverageData {
 
 struct CoverageMappingTest : ::testing::TestWithParam<std::pair<bool, bool>> {
   bool UseMultipleReaders;
+  unsigned NumThreads = 1;
+  bool RandomAccess = false;
   StringMap<unsigned> Files;
   std::vector<InputFunctionCoverageData> InputFunctions;
   std::vector<OutputFunctionCoverageData> OutputFunctions;
@@ -234,14 +248,14 @@ struct CoverageMappingTest : ::testing::TestWithParam<std::pair<bool, bool>> {
       for (const auto &OF : OutputFunctions) {
         ArrayRef<OutputFunctionCoverageData> Funcs(OF);
         CoverageReaders.push_back(
-            std::make_unique<CoverageMappingReaderMock>(Funcs));
+            std::make_unique<CoverageMappingReaderMock>(Funcs, RandomAccess));
       }
     } else {
       ArrayRef<OutputFunctionCoverageData> Funcs(OutputFunctions);
       CoverageReaders.push_back(
-          std::make_unique<CoverageMappingReaderMock>(Funcs));
+          std::make_unique<CoverageMappingReaderMock>(Funcs, RandomAccess));
     }
-    return CoverageMapping::load(CoverageReaders, *ProfileReader);
+    return CoverageMapping::load(CoverageReaders, *ProfileReader, NumThreads);
   }
 
   Error loadCoverageMapping(bool EmitFilenames = true) {
@@ -364,6 +378,38 @@ TEST_P(CoverageMappingTest, load_coverage_for_several_functions) {
   }
 }
 
+TEST_P(CoverageMappingTest, load_coverage_on_several_threads) {
+  ProfileWriter.addRecord({"func1", 0x1234, {10}}, Err);
+  ProfileWriter.addRecord({"func2", 0x2345, {20}}, Err);
+  ProfileWriter.addRecord({"func3", 0x3456, {30}}, Err);
+
+  startFunction("func1", 0x1234);
+  addCMR(Counter::getCounter(0), "foo", 1, 1, 5, 5);
+  startFunction("func2", 0x2345);
+  addCMR(Counter::getCounter(0), "bar", 2, 2, 6, 6);
+  // A copy of func1 from another translation unit is dropped.
+  startFunction("func1", 0x1234);
+  addCMR(Counter::getCounter(0), "foo", 1, 1, 5, 5);
+  startFunction("func3", 0x3456);
+  addCMR(Counter::getCounter(0), "foo", 7, 1, 9, 1);
+
+  NumThreads = 4;
+  RandomAccess = true;
+  EXPECT_THAT_ERROR(loadCoverageMapping(), Succeeded());
+
+  const auto FunctionRecords = LoadedCoverage->getCoveredFunctions();
+  std::vector<std::string> Names;
+  for (const auto &FunctionRecord : FunctionRecords)
+    Names.push_back(FunctionRecord.Name);
+  EXPECT_EQ((std::vector<std::string>{"func1", "func2", "func3"}), Names);
+
+  CoverageData Data = LoadedCoverage->getCoverageForFile("foo");
+  std::vector<CoverageSegment> Segments(Data.begin(), Data.end());
+  ASSERT_EQ(4U, Segments.size());
+  EXPECT_EQ(CoverageSegment(1, 1, 10, true), Segments[0]);
+  EXPECT_EQ(CoverageSegment(7, 1, 30, true), Segments[2]);
+}
+
 TEST_P(CoverageMappingTest, create_combined_regions) {
   ProfileWriter.addRecord({"func1", 0x1234, {1, 2, 3}}, Err);
   startFunction("func1", 0x1234);
@@ -221,6 +221,24 @@ TEST_F(InstrProfTest, test_writer_merge) {
   ASSERT_EQ(0U, R->Counts[1]);
 }
 
+TEST_F(InstrProfTest, test_writer_merge_into_empty) {
+  InstrProfWriter Writer2;
+  ASSERT_THAT_ERROR(Writer2.setIsIRLevelProfile(true, false), Succeeded());
+  Writer2.addRecord({"func1", 0x1234, {42}}, Err);
+
+  Writer.mergeRecordsFromWriter(std::move(Writer2), Err);
+  ASSERT_TRUE(Writer2.getProfileData().empty());
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+  ASSERT_TRUE(Reader->isIRLevelProfile());
+
+  Expected<InstrProfRecord> R = Reader->getInstrProfRecord("func1", 0x1234);
+  EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+  ASSERT_EQ(1U, R->Counts.size());
+  ASSERT_EQ(42U, R->Counts[0]);
+}
+
 static const char callee1[] = "callee1";
 static const char callee2[] = "callee2";
 static const char callee3[] = "callee3";
@@ -232,4 +232,29 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_GT(MockSlabAllocator::GetLastSlabSize(), 4096u);
 }
 
+// Slabs released while a SlabCache is installed are handed out again.
+TEST(AllocatorTest, TestSlabCache) {
+  SlabCache Cache;
+  EXPECT_EQ(&Cache, SlabCache::getCurrent());
+  void *First;
+  {
+    BumpPtrAllocator Alloc;
+    First = Alloc.Allocate(16, 8);
+  }
+  EXPECT_EQ(4096u, Cache.getBytesAllocated());
+  {
+    BumpPtrAllocator Alloc;
+    EXPECT_EQ(First, Alloc.Allocate(16, 8));
+  }
+  EXPECT_EQ(4096u, Cache.getBytesAllocated());
+  EXPECT_EQ(4096u, Cache.getBytesReused());
+
+  // Slabs of other allocators are not cached.
+  {
+    BumpPtrAllocatorImpl<MockSlabAllocator> Alloc;
+    (void)Alloc.Allocate(16, 8);
+  }
+  EXPECT_EQ(4096u, Cache.getBytesAllocated());
+}
+
 }  // anonymous namespace
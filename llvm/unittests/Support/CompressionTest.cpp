@@ -65,6 +65,53 @@ TEST(CompressionTest, Zlib) {
   TestZlibCompression(BinaryDataStr, zlib::DefaultCompression);
 }
 
+void TestZlibParallelCompression(StringRef Input, int Level,
+                                 size_t ChunkSize) {
+  SmallString<32> Compressed;
+  SmallString<32> Uncompressed;
+
+  Error E = zlib::compressParallel(Input, Compressed, Level, ChunkSize);
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+
+  // The chunks form a single zlib stream.
+  E = zlib::uncompress(Compressed, Uncompressed, Input.size());
+  EXPECT_FALSE(E);
+  consumeError(std::move(E));
+  EXPECT_EQ(Input, Uncompressed);
+
+  // A single chunk is compressed like zlib::compress does.
+  if (Input.size() <= ChunkSize) {
+    SmallString<32> Serial;
+    E = zlib::compress(Input, Serial, Level);
+    EXPECT_FALSE(E);
+    consumeError(std::move(E));
+    EXPECT_EQ(Serial, Compressed);
+  }
+}
+
+TEST(CompressionTest, ZlibParallel) {
+  TestZlibParallelCompression("", zlib::DefaultCompression, 16);
+  TestZlibParallelCompression("hello, world!", zlib::BestSpeedCompression, 16);
+
+  const size_t kSize = 4096;
+  char BinaryData[kSize];
+  for (size_t i = 0; i < kSize; ++i) {
+    BinaryData[i] = (i * 7) & 255;
+  }
+  StringRef BinaryDataStr(BinaryData, kSize);
+
+  for (size_t ChunkSize : {size_t(1), size_t(100), size_t(1024), kSize}) {
+    TestZlibParallelCompression(BinaryDataStr, zlib::NoCompression, ChunkSize);
+    TestZlibParallelCompression(BinaryDataStr, zlib::BestSizeCompression,
+                                ChunkSize);
+    TestZlibParallelCompression(BinaryDataStr, zlib::BestSpeedCompression,
+                                ChunkSize);
+    TestZlibParallelCompression(BinaryDataStr, zlib::DefaultCompression,
+                                ChunkSize);
+  }
+}
+
 TEST(CompressionTest, ZlibCRC32) {
   EXPECT_EQ(
       0x414FA339U,
@@ -14,6 +14,7 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
 
 uint32_t array[1024 * 1024];
@@ -49,6 +50,16 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, NestedParallelFor) {
+  // The outer loop runs its tasks on the workers and on the waiting thread,
+  // while the inner loops run sequentially on whichever thread they are on.
+  std::atomic<uint32_t> sum{0};
+  parallelForEachN(0, 64, [&](size_t) {
+    parallelForEachN(0, 1024, [&](size_t I) { sum += I; });
+  });
+  ASSERT_EQ(sum, 64u * (1023u * 1024u / 2));
+}
+
 TEST(Parallel, TransformReduce) {
   // Sum an empty list, check that it works.
   auto identity = [](uint32_t v) { return v; };
@@ -17,3 +17,45 @@ TEST(xxhashTest, Basic) {
   EXPECT_EQ(0x69196c1b3af0bff9U,
             xxHash64("0123456789abcdefghijklmnopqrstuvwxyz"));
 }
+
+TEST(xxhashTest, xxh3) {
+  constexpr size_t Size = 2243;
+  uint8_t A[Size];
+  uint64_t X = 2654435761;
+  for (size_t I = 0; I != Size; ++I) {
+    X ^= X << 13;
+    X ^= X >> 7;
+    X ^= X << 17;
+    A[I] = uint8_t(X >> 32);
+  }
+#define F(len) xxh3_64bits(makeArrayRef(A, size_t(len)))
+  EXPECT_EQ(UINT64_C(0x2d06800538d394c2), F(0));
+  EXPECT_EQ(UINT64_C(0x4a2ce28c39c127a2), F(1));
+  EXPECT_EQ(UINT64_C(0x64e5325a0437f315), F(2));
+  EXPECT_EQ(UINT64_C(0x99cbb334701ee8bc), F(3));
+  EXPECT_EQ(UINT64_C(0xe7642131de835ab4), F(4));
+  EXPECT_EQ(UINT64_C(0xfdda88ad00f0645b), F(8));
+  EXPECT_EQ(UINT64_C(0xf379550d2243ae84), F(9));
+  EXPECT_EQ(UINT64_C(0x2b4a951c61c535f4), F(16));
+  EXPECT_EQ(UINT64_C(0xc4275996e4e284cb), F(17));
+  EXPECT_EQ(UINT64_C(0xb07008d9adb86c3b), F(32));
+  EXPECT_EQ(UINT64_C(0xbd6e1fb4d84facba), F(33));
+  EXPECT_EQ(UINT64_C(0x2479d7cd50cbcd4f), F(64));
+  EXPECT_EQ(UINT64_C(0x7595260ec6739c85), F(65));
+  EXPECT_EQ(UINT64_C(0xf1fb5d5af9ec7989), F(96));
+  EXPECT_EQ(UINT64_C(0xebaa6fa8d2abf0a5), F(97));
+  EXPECT_EQ(UINT64_C(0xaddbbeceac969110), F(128));
+  EXPECT_EQ(UINT64_C(0x7836edba6c94b2cc), F(129));
+  EXPECT_EQ(UINT64_C(0x9aba8e4bf7427f4e), F(240));
+  EXPECT_EQ(UINT64_C(0xa671beef7070fe8e), F(241));
+  EXPECT_EQ(UINT64_C(0xce5fdd65f047c0ca), F(255));
+  EXPECT_EQ(UINT64_C(0xf35aff30def535ea), F(256));
+  EXPECT_EQ(UINT64_C(0xe6bdfc6c85c12a99), F(511));
+  EXPECT_EQ(UINT64_C(0xeed251725a1dcdf9), F(512));
+  EXPECT_EQ(UINT64_C(0x883d9e27b34cb21d), F(1024));
+  EXPECT_EQ(UINT64_C(0x3ca0769975830f26), F(1025));
+  EXPECT_EQ(UINT64_C(0x25fa675ddf2051f3), F(2048));
+  EXPECT_EQ(UINT64_C(0xd8545b5272983551), F(2240));
+  EXPECT_EQ(UINT64_C(0x6925ed1acf02e8bb), F(2243));
+#undef F
+}
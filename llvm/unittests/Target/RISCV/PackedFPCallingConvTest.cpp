@@ -0,0 +1,141 @@
+//===- PackedFPCallingConvTest.cpp ----------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "MCTargetDesc/RISCVMCTargetDesc.h"
+#include "RISCVISelLowering.h"
+#include "RISCVSubtarget.h"
+#include "llvm/CodeGen/CallingConvLower.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// The packed SIMD types of Xfvecsingle and Xfvechalf must be passed and
+// returned like f64.
+class PackedFPCallingConvTest : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    LLVMInitializeRISCVTargetInfo();
+    LLVMInitializeRISCVTarget();
+    LLVMInitializeRISCVTargetMC();
+  }
+
+  void createTargetMachine(StringRef TT, StringRef FS, StringRef ABIName) {
+    std::string Error;
+    const Target *TheTarget = TargetRegistry::lookupTarget(TT.str(), Error);
+    ASSERT_TRUE(TheTarget) << Error;
+
+    TargetOptions Options;
+    Options.MCOptions.ABIName = ABIName.str();
+    TM.reset(static_cast<LLVMTargetMachine *>(TheTarget->createTargetMachine(
+        TT, "", FS, Options, None, None, CodeGenOpt::Default)));
+    ASSERT_TRUE(TM) << "Could not allocate target machine!";
+  }
+
+  // Runs CC_RISCV over NumVals values of type VT and returns whether all of
+  // them could be assigned.
+  bool assign(MVT VT, unsigned NumVals, bool IsFixed = true,
+              bool IsRet = false) {
+    LLVMContext Ctx;
+    Module M("PackedFPCallingConvTest", Ctx);
+    M.setDataLayout(TM->createDataLayout());
+    Function *F =
+        Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false),
+                         GlobalValue::ExternalLinkage, "f", M);
+    const auto &STI =
+        static_cast<const RISCVSubtarget &>(*TM->getSubtargetImpl(*F));
+    MachineModuleInfo MMI(TM.get());
+    MachineFunction &MF = MMI.getOrCreateMachineFunction(*F);
+
+    Locs.clear();
+    CCState CCInfo(CallingConv::C, !IsFixed, MF, Locs, Ctx);
+    ISD::ArgFlagsTy Flags;
+    Flags.setOrigAlign(Align(8));
+    Type *OrigTy = EVT(VT).getTypeForEVT(Ctx);
+    for (unsigned I = 0; I != NumVals; ++I)
+      if (RISCV::CC_RISCV(M.getDataLayout(), STI.getTargetABI(), I, VT, VT,
+                          CCValAssign::Full, Flags, CCInfo, IsFixed, IsRet,
+                          OrigTy, *STI.getTargetLowering(), None))
+        return false;
+    return true;
+  }
+
+  std::unique_ptr<LLVMTargetMachine> TM;
+  SmallVector<CCValAssign, 16> Locs;
+};
+
+TEST_F(PackedFPCallingConvTest, V2F32InFPRs) {
+  createTargetMachine("riscv32-unknown-elf", "+f,+d,+xfvecsingle", "ilp32d");
+  ASSERT_TRUE(assign(MVT::v2f32, 2));
+  ASSERT_EQ(Locs.size(), 2u);
+  const MCPhysReg Regs[] = {RISCV::F10_D, RISCV::F11_D};
+  for (unsigned I = 0; I != 2; ++I) {
+    EXPECT_TRUE(Locs[I].isRegLoc());
+    EXPECT_EQ(Locs[I].getLocReg(), Regs[I]);
+    EXPECT_EQ(Locs[I].getLocVT(), MVT::v2f32);
+    EXPECT_EQ(Locs[I].getLocInfo(), CCValAssign::Full);
+  }
+
+  ASSERT_TRUE(assign(MVT::v2f32, 1, /*IsFixed=*/true, /*IsRet=*/true));
+  ASSERT_EQ(Locs.size(), 1u);
+  EXPECT_TRUE(Locs[0].isRegLoc());
+  EXPECT_EQ(Locs[0].getLocReg(), RISCV::F10_D);
+}
+
+TEST_F(PackedFPCallingConvTest, V4F16InFPRs) {
+  createTargetMachine("riscv64-unknown-elf",
+                      "+f,+d,+experimental-zfh,+xfvechalf", "lp64d");
+  ASSERT_TRUE(assign(MVT::v4f16, 1));
+  ASSERT_EQ(Locs.size(), 1u);
+  EXPECT_TRUE(Locs[0].isRegLoc());
+  EXPECT_EQ(Locs[0].getLocReg(), RISCV::F10_D);
+  EXPECT_EQ(Locs[0].getLocVT(), MVT::v4f16);
+
+  ASSERT_TRUE(assign(MVT::v4f16, 1, /*IsFixed=*/true, /*IsRet=*/true));
+  ASSERT_EQ(Locs.size(), 1u);
+  EXPECT_EQ(Locs[0].getLocReg(), RISCV::F10_D);
+}
+
+TEST_F(PackedFPCallingConvTest, ExhaustedFPRsOnRV32) {
+  createTargetMachine("riscv32-unknown-elf", "+f,+d,+xfvecsingle", "ilp32d");
+  // The ninth value takes a GPR pair, like f64.
+  ASSERT_TRUE(assign(MVT::v2f32, 9));
+  ASSERT_EQ(Locs.size(), 9u);
+  EXPECT_EQ(Locs[7].getLocReg(), RISCV::F17_D);
+  EXPECT_TRUE(Locs[8].isRegLoc());
+  EXPECT_EQ(Locs[8].getLocReg(), RISCV::X10);
+  EXPECT_EQ(Locs[8].getLocVT(), MVT::i32);
+}
+
+TEST_F(PackedFPCallingConvTest, SoftFloatABIOnRV64) {
+  createTargetMachine("riscv64-unknown-elf", "+f,+d,+xfvecsingle", "lp64");
+  ASSERT_TRUE(assign(MVT::v2f32, 1));
+  ASSERT_EQ(Locs.size(), 1u);
+  EXPECT_TRUE(Locs[0].isRegLoc());
+  EXPECT_EQ(Locs[0].getLocReg(), RISCV::X10);
+  EXPECT_EQ(Locs[0].getLocVT(), MVT::i64);
+  EXPECT_EQ(Locs[0].getLocInfo(), CCValAssign::BCvt);
+}
+
+TEST_F(PackedFPCallingConvTest, VariadicOnRV32) {
+  createTargetMachine("riscv32-unknown-elf", "+f,+d,+xfvecsingle", "ilp32d");
+  ASSERT_TRUE(assign(MVT::v2f32, 1, /*IsFixed=*/false));
+  ASSERT_EQ(Locs.size(), 1u);
+  EXPECT_TRUE(Locs[0].isRegLoc());
+  EXPECT_EQ(Locs[0].getLocReg(), RISCV::X10);
+  EXPECT_EQ(Locs[0].getLocVT(), MVT::i32);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,169 @@
+//===- FunctionSpecializationTest.cpp - Function specialization tests -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Transforms/IPO.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// A kernel clearing len elements at a stride, called with a tile size from a
+// loop, another one after the loop and once with a size and a stride only
+// known at run time.
+static const char *KernelModule = R"(
+  define void @kernel(i32* %p, i32 %len, i32 %stride) {
+  entry:
+    %empty = icmp eq i32 %len, 0
+    br i1 %empty, label %exit, label %loop
+
+  loop:
+    %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+    %idx = mul i32 %i, %stride
+    %addr = getelementptr i32, i32* %p, i32 %idx
+    store i32 0, i32* %addr
+    %i.next = add i32 %i, 1
+    %done = icmp eq i32 %i.next, %len
+    br i1 %done, label %exit, label %loop
+
+  exit:
+    ret void
+  }
+
+  define void @caller(i32* %p, i32 %n) {
+  entry:
+    br label %loop
+
+  loop:
+    %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+    call void @kernel(i32* %p, i32 8, i32 4)
+    call void @kernel(i32* %p, i32 8, i32 4)
+    %i.next = add i32 %i, 1
+    %done = icmp eq i32 %i.next, 100
+    br i1 %done, label %exit, label %loop
+
+  exit:
+    call void @kernel(i32* %p, i32 16, i32 4)
+    call void @kernel(i32* %p, i32 %n, i32 %n)
+    ret void
+  }
+)";
+
+class FunctionSpecializationTest : public testing::Test {
+protected:
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M;
+
+  void parseModule(const char *ModuleString) {
+    SMDiagnostic Err;
+    M = parseAssemblyString(ModuleString, Err, Ctx);
+    ASSERT_TRUE(M);
+  }
+
+  bool runSpecialization() {
+    legacy::PassManager PM;
+    PM.add(createFunctionSpecializationPass());
+    bool Changed = PM.run(*M);
+    EXPECT_FALSE(verifyModule(*M, &errs()));
+    return Changed;
+  }
+
+  // Return the callees of the calls in function Name, in program order.
+  SmallVector<Function *, 4> getCallees(StringRef Name) {
+    SmallVector<Function *, 4> Callees;
+    for (Instruction &I : instructions(M->getFunction(Name)))
+      if (auto *CB = dyn_cast<CallBase>(&I))
+        Callees.push_back(CB->getCalledFunction());
+    return Callees;
+  }
+};
+
+TEST_F(FunctionSpecializationTest, HotConstantArguments) {
+  parseModule(KernelModule);
+  ASSERT_TRUE(runSpecialization());
+
+  // The calls in the loop are the hottest and get the first specialization.
+  Function *Kernel = M->getFunction("kernel");
+  Function *Spec0 = M->getFunction("kernel.specialized.0");
+  Function *Spec1 = M->getFunction("kernel.specialized.1");
+  ASSERT_TRUE(Spec0);
+  ASSERT_TRUE(Spec1);
+  EXPECT_TRUE(Spec0->hasLocalLinkage());
+  EXPECT_EQ(getCallees("caller"),
+            (SmallVector<Function *, 4>{Spec0, Spec0, Spec1, Kernel}));
+
+  // The constants replace the arguments in the specializations.
+  for (Function *Spec : {Spec0, Spec1}) {
+    EXPECT_TRUE((Spec->arg_begin() + 1)->use_empty());
+    EXPECT_TRUE((Spec->arg_begin() + 2)->use_empty());
+  }
+  bool FoundBound = false;
+  for (Instruction &I : instructions(Spec0))
+    if (auto *Cmp = dyn_cast<ICmpInst>(&I))
+      if (auto *C = dyn_cast<ConstantInt>(Cmp->getOperand(1)))
+        FoundBound |= C->getZExtValue() == 8;
+  EXPECT_TRUE(FoundBound);
+}
+
+TEST_F(FunctionSpecializationTest, LeavesConstantPropagationAlone) {
+  // An internal function always called with the same constants is left to
+  // interprocedural constant propagation.
+  parseModule(R"(
+    define internal void @kernel(i32* %p, i32 %len) {
+    entry:
+      br label %loop
+
+    loop:
+      %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+      %addr = getelementptr i32, i32* %p, i32 %i
+      store i32 0, i32* %addr
+      %i.next = add i32 %i, 1
+      %done = icmp eq i32 %i.next, %len
+      br i1 %done, label %exit, label %loop
+
+    exit:
+      ret void
+    }
+
+    define void @caller(i32* %p) {
+      call void @kernel(i32* %p, i32 8)
+      call void @kernel(i32* %p, i32 8)
+      ret void
+    }
+  )");
+  EXPECT_FALSE(runSpecialization());
+  EXPECT_FALSE(M->getFunction("kernel.specialized.0"));
+}
+
+TEST_F(FunctionSpecializationTest, IgnoresUselessArguments) {
+  // The constant is only stored, knowing it makes no loop bound or stride
+  // constant.
+  parseModule(R"(
+    define void @store(i32* %p, i32 %v) {
+      store i32 %v, i32* %p
+      ret void
+    }
+
+    define void @caller(i32* %p) {
+      call void @store(i32* %p, i32 1)
+      call void @store(i32* %p, i32 2)
+      ret void
+    }
+  )");
+  EXPECT_FALSE(runSpecialization());
+}
+
+} // end anonymous namespace
@@ -69,8 +69,8 @@ cl::opt<bool> EmitLongStrLiterals(
 } // end namespace llvm
 
 namespace {
-cl::opt<ActionType> Action(
-    cl::desc("Action to perform:"),
+cl::list<ActionType> Action(
+    cl::desc("Actions to perform (each writes to its own -o output):"),
     cl::values(
         clEnumValN(PrintRecords, "print-records",
                    "Print all records to stdout (default)"),
@@ -145,8 +145,8 @@ cl::opt<std::string> Class("class", cl::desc("Print Enum list for this class"),
                            cl::value_desc("class name"),
                            cl::cat(PrintEnumsCat));
 
-bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
-  switch (Action) {
+bool LLVMTableGenMain(ActionType A, raw_ostream &OS, RecordKeeper &Records) {
+  switch (A) {
   case PrintRecords:
     OS << Records;              // No argument, dump all contents
     break;
@@ -282,7 +282,16 @@ int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
   cl::ParseCommandLineOptions(argc, argv);
 
-  return TableGenMain(argv[0], &LLVMTableGenMain);
+  // Several actions share a single parse of the input.
+  std::vector<ActionType> ActionTypes(Action.begin(), Action.end());
+  if (ActionTypes.empty())
+    ActionTypes.push_back(PrintRecords);
+  std::vector<std::function<TableGenMainFn>> Actions;
+  for (ActionType A : ActionTypes)
+    Actions.push_back([A](raw_ostream &OS, RecordKeeper &Records) {
+      return LLVMTableGenMain(A, OS, Records);
+    });
+  return TableGenMain(argv[0], Actions);
 }
 
 #ifndef __has_feature
@@ -0,0 +1,75 @@
+//===- BytecodeReader.h - MLIR bytecode reader ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the interface to read MLIR from its binary bytecode
+// format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODEREADER_H
+#define MLIR_BYTECODE_BYTECODEREADER_H
+
+#include "mlir/Support/LogicalResult.h"
+
+#include <memory>
+
+namespace llvm {
+class MemoryBufferRef;
+} // end namespace llvm
+
+namespace mlir {
+class Block;
+class LocationAttr;
+class MLIRContext;
+class Operation;
+
+/// Returns true if the given buffer starts with the bytecode magic number.
+bool isBytecode(llvm::MemoryBufferRef buffer);
+
+/// Read the operations defined in the given bytecode buffer and append them to
+/// the given block, before its terminator if it is non-empty. The read
+/// operations are verified. If `sourceFileLoc` is non-null, it is populated
+/// with a file location representing the start of the buffer.
+LogicalResult readBytecodeFile(llvm::MemoryBufferRef buffer, Block *block,
+                               MLIRContext *context,
+                               LocationAttr *sourceFileLoc = nullptr);
+
+/// A reader of bytecode that can defer reading the regions of the operations
+/// that are isolated from above, e.g. function bodies, until they are needed.
+/// The buffer must outlive the reader, and the reader must outlive the
+/// operations whose regions have not been materialized yet. Such operations
+/// must not be erased before they are materialized.
+class BytecodeReader {
+public:
+  BytecodeReader(llvm::MemoryBufferRef buffer, MLIRContext *context,
+                 bool lazyLoading);
+  ~BytecodeReader();
+
+  /// Read the top-level operations of the buffer into the given block, as
+  /// `readBytecodeFile` does. With lazy loading, the regions of isolated
+  /// operations are left empty and nothing is verified.
+  LogicalResult read(Block *block);
+
+  /// Returns true if the regions of `op` have not been read yet.
+  bool isMaterializable(Operation *op) const;
+
+  /// Read the regions of `op`. Isolated operations nested in them are again
+  /// left for later. Does nothing if `op` is not materializable.
+  LogicalResult materialize(Operation *op);
+
+  /// Read all the regions that have not been read yet.
+  LogicalResult materializeAll();
+
+private:
+  class Impl;
+  std::unique_ptr<Impl> impl;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODEREADER_H
@@ -0,0 +1,30 @@
+//===- BytecodeWriter.h - MLIR bytecode writer ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the interface to write MLIR in its binary bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODEWRITER_H
+#define MLIR_BYTECODE_BYTECODEWRITER_H
+
+namespace llvm {
+class raw_ostream;
+} // end namespace llvm
+
+namespace mlir {
+class Operation;
+
+/// Write the bytecode for the given operation to the provided output stream.
+/// The bytecode can be read back with `readBytecodeFile` or with any of the
+/// `parseSourceFile` entry points.
+void writeBytecodeToFile(Operation *op, llvm::raw_ostream &os);
+
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODEWRITER_H
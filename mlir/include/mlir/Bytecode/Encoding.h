@@ -0,0 +1,66 @@
+//===- Encoding.h - MLIR bytecode encoding constants ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the constants shared by the reader and the writer of the
+// MLIR bytecode format. A bytecode file is laid out as follows, where `varint`
+// is an unsigned LEB128 integer:
+//
+//   file ::= magic version string-table type-table attr-table ops
+//   magic ::= 'M' 'L' 0xEF 'R'
+//   version ::= varint
+//   string-table ::= varint (varint bytes 0x00)*   // Size excludes the 0x00.
+//   type-table ::= varint string-index*            // Textual form of types.
+//   attr-table ::= varint string-index*            // Including locations.
+//   ops ::= varint op*
+//
+//   op ::= name-string-index loc-attr-index byte(mask)
+//          (attr-index)?                           // kHasAttrs
+//          (varint type-index*)?                   // kHasResults
+//          (varint value-index*)?                  // kHasOperands
+//          (varint block-index*)?                  // kHasSuccessors
+//          (varint (region* | varint bytes))?      // kHasRegions
+//   region ::= varint block*
+//   block ::= varint type-index* ops               // Arguments, then ops.
+//
+// The regions of an operation with kHasIsolatedRegions are prefixed with their
+// size in bytes, which allows a reader to skip them and materialize them on
+// demand. Values are numbered per isolated scope in the order they are
+// defined: block arguments, then operation results, then the values of nested
+// regions that are not isolated. Successors refer to the blocks of the region
+// of the operation by index.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_ENCODING_H
+#define MLIR_BYTECODE_ENCODING_H
+
+#include <cstdint>
+
+namespace mlir {
+namespace bytecode {
+
+/// The magic number at the start of every bytecode file.
+static constexpr uint8_t kMagic[] = {'M', 'L', 0xEF, 'R'};
+
+/// The version of the format emitted by the writer.
+static constexpr uint64_t kVersion = 0;
+
+/// The bits of the mask describing which parts of an operation are encoded.
+enum OpEncodingMask : uint8_t {
+  kHasAttrs = 0x01,
+  kHasResults = 0x02,
+  kHasOperands = 0x04,
+  kHasSuccessors = 0x08,
+  kHasRegions = 0x10,
+  kHasIsolatedRegions = 0x20,
+};
+
+} // end namespace bytecode
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_ENCODING_H
@@ -0,0 +1,53 @@
+//===- LinalgToSnitch.h - Linalg to Snitch SSR streams ----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_CONVERSION_LINALGTOSNITCH_LINALGTOSNITCH_H_
+#define MLIR_CONVERSION_LINALGTOSNITCH_LINALGTOSNITCH_H_
+
+#include "mlir/IR/Value.h"
+#include "mlir/Support/LogicalResult.h"
+
+#include <memory>
+
+namespace mlir {
+class FuncOp;
+class MLIRContext;
+class OpBuilder;
+template <typename T>
+class OperationPass;
+class OwningRewritePatternList;
+
+/// Populate the given list with the pattern that lowers Linalg operations on
+/// f64 buffers to loops reading and writing their operands through the stream
+/// semantic registers of Snitch.
+void populateLinalgToSnitchConversionPatterns(
+    MLIRContext *context, OwningRewritePatternList &patterns);
+
+/// Copies `src` into `dst` with the cluster DMA and waits for the transfer.
+/// Meant to be passed as copy-in and copy-out function to
+/// `linalg::LinalgPromotionOptions::setCopyInOutFns`, so that promoted tiles
+/// are moved into the TCDM by the DMA instead of by the core.
+LogicalResult snitchDMACopy(OpBuilder &b, Value src, Value dst);
+
+/// Starts copying `src` into `dst` with the cluster DMA and returns the id of
+/// the transfer, or None if the DMA cannot copy between the two buffers.
+/// Together with `snitchDMAWait`, meant to be passed to
+/// `linalg::LinalgPromotionOptions::setAsyncCopyInFns` so that
+/// `linalg::promoteSubViewsDoubleBuffered` fetches the next tile while the
+/// core computes on the current one.
+Optional<Value> snitchDMACopyAsync(OpBuilder &b, Value src, Value dst);
+
+/// Waits for the DMA transfer with the id `txid`.
+LogicalResult snitchDMAWait(OpBuilder &b, Value txid);
+
+/// Create a pass to lower Linalg operations to Snitch SSR streams.
+std::unique_ptr<OperationPass<FuncOp>> createConvertLinalgToSnitchPass();
+
+} // namespace mlir
+
+#endif // MLIR_CONVERSION_LINALGTOSNITCH_LINALGTOSNITCH_H_
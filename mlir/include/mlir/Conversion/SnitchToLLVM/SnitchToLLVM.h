@@ -0,0 +1,34 @@
+//===- SnitchToLLVM.h - Conversion Patterns from Snitch to LLVM -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_CONVERSION_SNITCHTOLLVM_SNITCHTOLLVM_H_
+#define MLIR_CONVERSION_SNITCHTOLLVM_SNITCHTOLLVM_H_
+
+#include <memory>
+
+namespace mlir {
+
+class LLVMTypeConverter;
+class ModuleOp;
+template <typename T>
+class OperationPass;
+class OwningRewritePatternList;
+
+/// Collect a set of patterns to convert from the Snitch dialect to LLVM.
+void populateSnitchToLLVMConversionPatterns(LLVMTypeConverter &converter,
+                                            OwningRewritePatternList &patterns);
+
+/// Create a pass to convert the Snitch dialect, together with the Standard
+/// dialect it is embedded in, to the LLVM dialect. Snitch is a 32-bit core,
+/// hence the index type is lowered to i32 by default.
+std::unique_ptr<OperationPass<ModuleOp>>
+createConvertSnitchToLLVMPass(unsigned indexBitwidth = 32);
+
+} // namespace mlir
+
+#endif // MLIR_CONVERSION_SNITCHTOLLVM_SNITCHTOLLVM_H_
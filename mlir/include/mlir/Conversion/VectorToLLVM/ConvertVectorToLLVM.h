@@ -23,7 +23,8 @@ class OperationPass;
 struct LowerVectorToLLVMOptions {
   LowerVectorToLLVMOptions()
       : reassociateFPReductions(false), enableIndexOptimizations(true),
-        enableArmNeon(false), enableArmSVE(false), enableAVX512(false) {}
+        enableArmNeon(false), enableArmSVE(false), enableAVX512(false),
+        enablePULP(false) {}
 
   LowerVectorToLLVMOptions &setReassociateFPReductions(bool b) {
     reassociateFPReductions = b;
@@ -45,12 +46,17 @@ struct LowerVectorToLLVMOptions {
     enableAVX512 = b;
     return *this;
   }
+  LowerVectorToLLVMOptions &setEnablePULP(bool b) {
+    enablePULP = b;
+    return *this;
+  }
 
   bool reassociateFPReductions;
   bool enableIndexOptimizations;
   bool enableArmNeon;
   bool enableArmSVE;
   bool enableAVX512;
+  bool enablePULP;
 };
 
 /// Collect a set of patterns to convert from Vector contractions to LLVM Matrix
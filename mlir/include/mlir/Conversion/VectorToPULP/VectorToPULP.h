@@ -0,0 +1,33 @@
+//===- VectorToPULP.h - Vector dot products to PULP intrinsics --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_CONVERSION_VECTORTOPULP_VECTORTOPULP_H_
+#define MLIR_CONVERSION_VECTORTOPULP_VECTORTOPULP_H_
+
+namespace mlir {
+
+class MLIRContext;
+class OwningRewritePatternList;
+
+/// Collect a set of patterns that rewrite 1-D vector.contract dot products on
+/// the packed SIMD types of PULP into the LLVMPULP intrinsics:
+/// - vector<4xi8> and vector<2xi16> operands, either accumulated into their
+///   own element type or sign or zero extended to i32 and accumulated into
+///   i32, use the Xpulpv2 dot products.
+/// - vector<4xf16> operands extended to f32 and accumulated into f32 use the
+///   expanding smallfloat dot product if `reassociateFPReductions` is set, as
+///   it adds the products in a different order.
+/// The patterns have a higher benefit than the generic contraction lowering,
+/// which does not lower mixed precision contractions.
+void populateVectorToPULPPatterns(MLIRContext *context,
+                                  OwningRewritePatternList &patterns,
+                                  bool reassociateFPReductions = false);
+
+} // namespace mlir
+
+#endif // MLIR_CONVERSION_VECTORTOPULP_VECTORTOPULP_H_
@@ -163,6 +163,16 @@ using DeallocBufferCallbackFn =
 using CopyCallbackFn =
     std::function<LogicalResult(OpBuilder &b, Value src, Value dst)>;
 
+/// Callback function type used to start an asynchronous copy from `src` to
+/// `dst`. Returns a token for the copy that is passed to the matching
+/// `WaitCallbackFn`, or None if the copy cannot be done asynchronously.
+using AsyncCopyCallbackFn =
+    std::function<Optional<Value>(OpBuilder &b, Value src, Value dst)>;
+
+/// Callback function type used to wait for the copy with the given `token`.
+/// Waiting again for a copy that has already completed must be a no-op.
+using WaitCallbackFn = std::function<LogicalResult(OpBuilder &b, Value token)>;
+
 struct LinalgPromotionOptions {
   /// Indices of subViews to promote. If `None`, try to promote all operands.
   Optional<DenseSet<unsigned>> operandsToPromote = None;
@@ -233,6 +243,16 @@ struct LinalgPromotionOptions {
     copyOutFn = copyOut;
     return *this;
   }
+  /// Callback functions to start copying data into a promoted subview and to
+  /// wait for the copy. Only used by `promoteSubViewsDoubleBuffered`.
+  Optional<AsyncCopyCallbackFn> asyncCopyInFn = None;
+  Optional<WaitCallbackFn> waitFn = None;
+  LinalgPromotionOptions &setAsyncCopyInFns(AsyncCopyCallbackFn const &copyIn,
+                                            WaitCallbackFn const &wait) {
+    asyncCopyInFn = copyIn;
+    waitFn = wait;
+    return *this;
+  }
 };
 
 /// Creates a new buffer using the `allocationFn` provided. The size of this
@@ -263,6 +283,20 @@ Optional<LinalgOp> promoteSubViews(OpBuilder &b, LinalgOp op,
                                    LinalgPromotionOptions options,
                                    OperationFolder *folder = nullptr);
 
+/// Promotes the subviews of `op`, which is in the body of `loop`, like
+/// `promoteSubViews` but double buffers the inputs whose subviews depend on the
+/// iteration of `loop`. Two buffers are allocated for each of them ahead of
+/// the loop and the copy into the first one is started there. Each iteration
+/// then starts copying the tile of the next iteration into one buffer with
+/// `asyncCopyInFn`, waits for the copy into the other one and computes on it,
+/// so that the copies overlap with the computation. The loop is replaced by
+/// one that carries the buffers and the copy tokens.
+///
+/// Returns the modified linalg op, or None if the promotion failed.
+Optional<LinalgOp> promoteSubViewsDoubleBuffered(
+    OpBuilder &b, scf::ForOp loop, LinalgOp op, LinalgPromotionOptions options,
+    OperationFolder *folder = nullptr);
+
 /// Emit a suitable vector form for a Linalg op with fully static shape.
 void vectorizeLinalgOp(OpBuilder &builder, Operation *op);
 
@@ -305,6 +339,12 @@ interchangeGenericLinalgOpPrecondition(Operation *op,
 LogicalResult promoteSubviewsPrecondition(Operation *op,
                                           LinalgPromotionOptions options);
 
+/// Double buffer the promoted std.subviews feeding a linalg operation that is
+/// in the body of `loop`.
+LogicalResult
+promoteSubviewsDoubleBufferedPrecondition(scf::ForOp loop, Operation *op,
+                                          LinalgPromotionOptions options);
+
 /// Rewrite a linalg.generic into a suitable vector.contraction op.
 LogicalResult vectorizeLinalgOpPrecondition(Operation *op);
 
@@ -0,0 +1,27 @@
+//===- SnitchDialect.h - MLIR Dialect for Snitch ----------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the Target dialect for the Snitch streaming, repetition
+// and DMA extensions in MLIR.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_DIALECT_SNITCH_SNITCHDIALECT_H_
+#define MLIR_DIALECT_SNITCH_SNITCHDIALECT_H_
+
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+
+#include "mlir/Dialect/Snitch/SnitchDialect.h.inc"
+
+#define GET_OP_CLASSES
+#include "mlir/Dialect/Snitch/Snitch.h.inc"
+
+#endif // MLIR_DIALECT_SNITCH_SNITCHDIALECT_H_
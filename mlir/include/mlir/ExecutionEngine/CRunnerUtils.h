@@ -217,6 +217,20 @@ extern "C" MLIR_CRUNNERUTILS_EXPORT void *openTensorC(char *filename,
 extern "C" MLIR_CRUNNERUTILS_EXPORT void
 readTensorItemC(void *tensor, uint64_t *idata, double *ddata);
 extern "C" MLIR_CRUNNERUTILS_EXPORT void closeTensor(void *tensor);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void writeTensorBinaryC(void *tensor,
+                                                            char *filename);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void *newSparseMatrix(void *tensor,
+                                                          bool columnMajor);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_getSparseMatrixPointers(StridedMemRefType<uint64_t, 1> *ref,
+                                     void *matrix);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_getSparseMatrixIndices(StridedMemRefType<uint64_t, 1> *ref,
+                                    void *matrix);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void
+_mlir_ciface_getSparseMatrixValues(StridedMemRefType<double, 1> *ref,
+                                   void *matrix);
+extern "C" MLIR_CRUNNERUTILS_EXPORT void closeSparseMatrix(void *matrix);
 extern "C" MLIR_CRUNNERUTILS_EXPORT char *getTensorFilename(uint64_t id);
 
 #endif // EXECUTIONENGINE_CRUNNERUTILS_H_
@@ -25,6 +25,9 @@ void registerToROCDLIRTranslation();
 void registerArmNeonToLLVMIRTranslation();
 void registerAVX512ToLLVMIRTranslation();
 void registerArmSVEToLLVMIRTranslation();
+void registerPULPToLLVMIRTranslation();
+void registerSnitchToLLVMIRTranslation();
+void registerToBytecodeTranslation();
 
 // This function should be called before creating any MLIRContext if one
 // expects all the possible translations to be made available to the context
@@ -40,6 +43,9 @@ inline void registerAllTranslations() {
     registerArmNeonToLLVMIRTranslation();
     registerAVX512ToLLVMIRTranslation();
     registerArmSVEToLLVMIRTranslation();
+    registerPULPToLLVMIRTranslation();
+    registerSnitchToLLVMIRTranslation();
+    registerToBytecodeTranslation();
     return true;
   }();
   (void)initOnce;
@@ -15,9 +15,61 @@
 #define MLIR_TRANSFORMS_GREEDYPATTERNREWRITEDRIVER_H_
 
 #include "mlir/Rewrite/FrozenRewritePatternList.h"
+#include "llvm/ADT/MapVector.h"
+
+#include <chrono>
 
 namespace mlir {
 
+//===----------------------------------------------------------------------===//
+// GreedyRewriteConfig
+//===----------------------------------------------------------------------===//
+
+/// Counters collected by the greedy pattern driver.
+struct GreedyRewriteStatistics {
+  struct PatternStatistics {
+    /// The number of times the pattern was tried.
+    unsigned numMatchAttempts = 0;
+    /// The number of times the pattern matched and rewrote the IR.
+    unsigned numRewrites = 0;
+    /// The time spent matching and rewriting with the pattern.
+    std::chrono::steady_clock::duration time{0};
+  };
+
+  /// Adds the counters of `other` to this.
+  void merge(const GreedyRewriteStatistics &other);
+
+  /// Prints one line per pattern, ordered by decreasing time.
+  void print(raw_ostream &os) const;
+
+  /// The counters of each pattern that was tried, in the order in which the
+  /// patterns were first tried.
+  llvm::MapVector<const Pattern *, PatternStatistics> patterns;
+  /// The number of operations folded.
+  unsigned numFolds = 0;
+  /// The number of operations erased because they were trivially dead.
+  unsigned numErasedDeadOps = 0;
+};
+
+/// Options for the greedy pattern driver.
+struct GreedyRewriteConfig {
+  /// The number of times the regions are scanned before giving up on
+  /// convergence.
+  unsigned maxIterations = 10;
+
+  /// If true and multithreading is enabled on the context, first simplify the
+  /// regions of the outermost IsolatedFromAbove operations nested in the
+  /// rewritten regions concurrently, each with its own worklist, and then the
+  /// rewritten regions themselves. The operations of one isolated region are
+  /// never split across threads: they share the constants materialized by the
+  /// folder and the use lists of their values. As the nested regions do not
+  /// depend on each other, the result is the same as with a single thread.
+  bool parallel = false;
+
+  /// If non-null, the counters of the rewrite are added to this.
+  GreedyRewriteStatistics *statistics = nullptr;
+};
+
 //===----------------------------------------------------------------------===//
 // applyPatternsGreedily
 //===----------------------------------------------------------------------===//
@@ -56,6 +108,20 @@ applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
                              const FrozenRewritePatternList &patterns,
                              unsigned maxIterations);
 
+/// Rewrite the regions of the specified operation, which must be isolated from
+/// above, as configured by `config`.
+LogicalResult
+applyPatternsAndFoldGreedily(Operation *op,
+                             const FrozenRewritePatternList &patterns,
+                             const GreedyRewriteConfig &config);
+
+/// Rewrite the given regions, which must be isolated from above, as configured
+/// by `config`.
+LogicalResult
+applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
+                             const FrozenRewritePatternList &patterns,
+                             const GreedyRewriteConfig &config);
+
 /// Applies the specified patterns on `op` alone while also trying to fold it,
 /// by selecting the highest benefits patterns in a greedy manner. Returns
 /// success if no more patterns can be matched. `erased` is set to true if `op`
@@ -48,6 +48,10 @@ createPromoteBuffersToStackPass(unsigned maxAllocSizeInBytes = 1024,
                                 unsigned bitwidthOfIndexType = 64,
                                 unsigned maxRankOfAllocatedMemRef = 1);
 
+/// Creates a pass that packs statically shaped buffers with disjoint lifetimes
+/// into a single arena per memory space.
+std::unique_ptr<Pass> createBufferPackingPass(unsigned alignment = 16);
+
 /// Creates a pass that finalizes a partial bufferization by removing remaining
 /// tensor_load and tensor_to_memref operations.
 std::unique_ptr<FunctionPass> createFinalizingBufferizePass();
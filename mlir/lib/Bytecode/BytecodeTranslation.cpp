@@ -0,0 +1,29 @@
+//===- BytecodeTranslation.cpp - MLIR to bytecode translation -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file registers the translation from MLIR to its bytecode format. The
+// opposite direction is handled by the parser, which reads bytecode as input
+// of any translation or of mlir-opt.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Translation.h"
+
+using namespace mlir;
+
+namespace mlir {
+void registerToBytecodeTranslation() {
+  TranslateFromMLIRRegistration registration(
+      "mlir-to-bytecode", [](ModuleOp module, raw_ostream &output) {
+        writeBytecodeToFile(module, output);
+        return success();
+      });
+}
+} // namespace mlir
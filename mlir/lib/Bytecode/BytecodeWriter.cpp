@@ -0,0 +1,257 @@
+//===- BytecodeWriter.cpp - MLIR bytecode writer --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/Bytecode/Encoding.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/OpDefinition.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+namespace {
+/// Buffers the encoding of a part of the bytecode.
+class EncodingEmitter {
+public:
+  void emitByte(uint8_t byte) { data.push_back(byte); }
+
+  void emitBytes(ArrayRef<uint8_t> bytes) {
+    data.append(bytes.begin(), bytes.end());
+  }
+
+  /// Emit an unsigned LEB128 integer.
+  void emitVarInt(uint64_t value) {
+    while (value >= 0x80) {
+      data.push_back(uint8_t(value) | 0x80);
+      value >>= 7;
+    }
+    data.push_back(uint8_t(value));
+  }
+
+  /// Emit the given string prefixed with its size and followed by a null
+  /// character, which allows the reader to parse it in place.
+  void emitString(StringRef str) {
+    emitVarInt(str.size());
+    data.append(str.bytes_begin(), str.bytes_end());
+    data.push_back(0);
+  }
+
+  /// Emit the contents of `other` prefixed with its size.
+  void emitSection(const EncodingEmitter &other) {
+    emitVarInt(other.data.size());
+    emitBytes(other.data);
+  }
+
+  void writeTo(raw_ostream &os) const {
+    os.write(reinterpret_cast<const char *>(data.data()), data.size());
+  }
+
+private:
+  SmallVector<uint8_t, 0> data;
+};
+
+class BytecodeWriter {
+public:
+  void write(Operation *rootOp, raw_ostream &os);
+
+private:
+  void writeOp(EncodingEmitter &emitter, Operation *op);
+  void writeRegion(EncodingEmitter &emitter, Region &region);
+
+  /// Number the values defined by `op` and by its regions, if they are not
+  /// isolated from above, in the current scope.
+  void numberValues(Operation *op);
+  void numberValues(Region &region);
+
+  unsigned getStringID(StringRef str);
+  unsigned getTypeID(Type type);
+  unsigned getAttrID(Attribute attr);
+
+  /// The uniqued strings, in the order of their IDs. The references point to
+  /// the keys of `stringIDs`.
+  llvm::StringMap<unsigned> stringIDs;
+  std::vector<StringRef> strings;
+
+  /// The types and attributes, represented by the ID of their textual form.
+  DenseMap<Type, unsigned> typeIDs;
+  std::vector<unsigned> typeStrings;
+  DenseMap<Attribute, unsigned> attrIDs;
+  std::vector<unsigned> attrStrings;
+
+  /// The numbering of the values of the current isolated scope.
+  DenseMap<Value, unsigned> valueIDs;
+  unsigned nextValueID = 0;
+
+  /// The index of each block in its region.
+  DenseMap<Block *, unsigned> blockIDs;
+};
+} // namespace
+
+static bool hasIsolatedRegions(Operation *op) {
+  return op->getNumRegions() != 0 &&
+         op->hasTrait<OpTrait::IsIsolatedFromAbove>();
+}
+
+void BytecodeWriter::write(Operation *rootOp, raw_ostream &os) {
+  // Encode the IR first to collect the strings, types and attributes it uses.
+  numberValues(rootOp);
+  EncodingEmitter irEmitter;
+  irEmitter.emitVarInt(/*numOps=*/1);
+  writeOp(irEmitter, rootOp);
+
+  EncodingEmitter emitter;
+  emitter.emitBytes(kMagic);
+  emitter.emitVarInt(kVersion);
+  emitter.emitVarInt(strings.size());
+  for (StringRef str : strings)
+    emitter.emitString(str);
+  emitter.emitVarInt(typeStrings.size());
+  for (unsigned stringID : typeStrings)
+    emitter.emitVarInt(stringID);
+  emitter.emitVarInt(attrStrings.size());
+  for (unsigned stringID : attrStrings)
+    emitter.emitVarInt(stringID);
+  emitter.writeTo(os);
+  irEmitter.writeTo(os);
+}
+
+void BytecodeWriter::writeOp(EncodingEmitter &emitter, Operation *op) {
+  emitter.emitVarInt(getStringID(op->getName().getStringRef()));
+  emitter.emitVarInt(getAttrID(LocationAttr(op->getLoc())));
+
+  DictionaryAttr attrs = op->getAttrDictionary();
+  bool isolated = hasIsolatedRegions(op);
+  uint8_t mask = 0;
+  if (!attrs.empty())
+    mask |= kHasAttrs;
+  if (op->getNumResults())
+    mask |= kHasResults;
+  if (op->getNumOperands())
+    mask |= kHasOperands;
+  if (op->getNumSuccessors())
+    mask |= kHasSuccessors;
+  if (op->getNumRegions())
+    mask |= kHasRegions;
+  if (isolated)
+    mask |= kHasIsolatedRegions;
+  emitter.emitByte(mask);
+
+  if (mask & kHasAttrs)
+    emitter.emitVarInt(getAttrID(attrs));
+  if (mask & kHasResults) {
+    emitter.emitVarInt(op->getNumResults());
+    for (Type type : op->getResultTypes())
+      emitter.emitVarInt(getTypeID(type));
+  }
+  if (mask & kHasOperands) {
+    emitter.emitVarInt(op->getNumOperands());
+    for (Value operand : op->getOperands()) {
+      assert(valueIDs.count(operand) && "operand defined outside the scope");
+      emitter.emitVarInt(valueIDs.lookup(operand));
+    }
+  }
+  if (mask & kHasSuccessors) {
+    emitter.emitVarInt(op->getNumSuccessors());
+    for (Block *successor : op->getSuccessors())
+      emitter.emitVarInt(blockIDs.lookup(successor));
+  }
+  if (!(mask & kHasRegions))
+    return;
+
+  emitter.emitVarInt(op->getNumRegions());
+  if (!isolated) {
+    for (Region &region : op->getRegions())
+      writeRegion(emitter, region);
+    return;
+  }
+
+  // Isolated regions form a new value scope, and are emitted with their size
+  // so that the reader can skip them.
+  DenseMap<Value, unsigned> parentValueIDs;
+  std::swap(valueIDs, parentValueIDs);
+  unsigned parentNextValueID = nextValueID;
+  nextValueID = 0;
+  for (Region &region : op->getRegions())
+    numberValues(region);
+  EncodingEmitter regionEmitter;
+  for (Region &region : op->getRegions())
+    writeRegion(regionEmitter, region);
+  emitter.emitSection(regionEmitter);
+  std::swap(valueIDs, parentValueIDs);
+  nextValueID = parentNextValueID;
+}
+
+void BytecodeWriter::writeRegion(EncodingEmitter &emitter, Region &region) {
+  emitter.emitVarInt(region.getBlocks().size());
+  unsigned blockID = 0;
+  for (Block &block : region)
+    blockIDs[&block] = blockID++;
+
+  for (Block &block : region) {
+    emitter.emitVarInt(block.getNumArguments());
+    for (BlockArgument arg : block.getArguments())
+      emitter.emitVarInt(getTypeID(arg.getType()));
+    emitter.emitVarInt(block.getOperations().size());
+    for (Operation &op : block)
+      writeOp(emitter, &op);
+  }
+}
+
+void BytecodeWriter::numberValues(Operation *op) {
+  for (Value result : op->getResults())
+    valueIDs[result] = nextValueID++;
+  if (hasIsolatedRegions(op))
+    return;
+  for (Region &region : op->getRegions())
+    numberValues(region);
+}
+
+void BytecodeWriter::numberValues(Region &region) {
+  for (Block &block : region) {
+    for (BlockArgument arg : block.getArguments())
+      valueIDs[arg] = nextValueID++;
+    for (Operation &op : block)
+      numberValues(&op);
+  }
+}
+
+unsigned BytecodeWriter::getStringID(StringRef str) {
+  auto it = stringIDs.try_emplace(str, strings.size());
+  if (it.second)
+    strings.push_back(it.first->getKey());
+  return it.first->second;
+}
+
+unsigned BytecodeWriter::getTypeID(Type type) {
+  auto it = typeIDs.try_emplace(type, typeStrings.size());
+  if (!it.second)
+    return it.first->second;
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  type.print(os);
+  typeStrings.push_back(getStringID(os.str()));
+  return it.first->second;
+}
+
+unsigned BytecodeWriter::getAttrID(Attribute attr) {
+  auto it = attrIDs.try_emplace(attr, attrStrings.size());
+  if (!it.second)
+    return it.first->second;
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  attr.print(os);
+  attrStrings.push_back(getStringID(os.str()));
+  return it.first->second;
+}
+
+void mlir::writeBytecodeToFile(Operation *op, raw_ostream &os) {
+  BytecodeWriter().write(op, os);
+}
@@ -0,0 +1,401 @@
+//===- LinalgToSnitch.cpp - Linalg to Snitch SSR streams ------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the lowering of Linalg operations to loops that access
+// their operands through the stream semantic registers (SSRs) of Snitch.
+//
+// Each used input becomes a read stream that iterates over all loops of the
+// operation, the output becomes a write stream over the parallel loops. The
+// loop nest itself then only pops the inputs, computes the body and pushes the
+// result, which also lets the backend run the innermost loop under frep.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/LinalgToSnitch/LinalgToSnitch.h"
+
+#include "../PassDetail.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Linalg/IR/LinalgOps.h"
+#include "mlir/Dialect/SCF/SCF.h"
+#include "mlir/Dialect/Snitch/SnitchDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/AffineExpr.h"
+#include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+
+using namespace mlir;
+using namespace mlir::linalg;
+
+/// The number of data movers and the number of loops each of them has.
+static constexpr unsigned kNumSSRs = 3;
+static constexpr unsigned kNumSSRLoops = 4;
+
+/// The streams only move f64 elements.
+static constexpr int64_t kElementBytes = 8;
+
+namespace {
+/// A stream over one operand of a Linalg operation.
+struct OperandStream {
+  /// The data mover of the stream.
+  unsigned dm;
+  /// The number of loops of the stream, these are the outermost loops of the
+  /// operation.
+  unsigned numLoops;
+  /// The distance in elements between the accessed elements of two
+  /// consecutive iterations of each loop of the operation.
+  SmallVector<int64_t, 4> loopStrides;
+};
+} // namespace
+
+/// Adds `coefficient` times the linear expression `expr` to `loopStrides`.
+/// Fails if `expr` is not a sum of loop dimensions multiplied by constants.
+static LogicalResult addLoopStrides(AffineExpr expr, int64_t coefficient,
+                                    MutableArrayRef<int64_t> loopStrides) {
+  if (auto dim = expr.dyn_cast<AffineDimExpr>()) {
+    loopStrides[dim.getPosition()] += coefficient;
+    return success();
+  }
+  if (auto cst = expr.dyn_cast<AffineConstantExpr>())
+    return success(cst.getValue() == 0);
+  auto binary = expr.dyn_cast<AffineBinaryOpExpr>();
+  if (!binary)
+    return failure();
+  if (expr.getKind() == AffineExprKind::Add)
+    return success(
+        succeeded(addLoopStrides(binary.getLHS(), coefficient, loopStrides)) &&
+        succeeded(addLoopStrides(binary.getRHS(), coefficient, loopStrides)));
+  if (expr.getKind() == AffineExprKind::Mul)
+    if (auto cst = binary.getRHS().dyn_cast<AffineConstantExpr>())
+      return addLoopStrides(binary.getLHS(), coefficient * cst.getValue(),
+                            loopStrides);
+  return failure();
+}
+
+/// Returns the distance in elements between the elements of `buffer` that
+/// two consecutive iterations of each loop access through `map`, or None if
+/// this is not a constant.
+static Optional<SmallVector<int64_t, 4>>
+getLoopStrides(Value buffer, AffineMap map, unsigned numLoops) {
+  auto type = buffer.getType().dyn_cast<MemRefType>();
+  if (!type || !type.getElementType().isF64())
+    return llvm::None;
+  int64_t offset;
+  SmallVector<int64_t, 4> strides;
+  if (failed(getStridesAndOffset(type, strides, offset)) ||
+      llvm::any_of(strides, ShapedType::isDynamicStrideOrOffset))
+    return llvm::None;
+  SmallVector<int64_t, 4> loopStrides(numLoops, 0);
+  for (auto en : llvm::enumerate(map.getResults()))
+    if (failed(addLoopStrides(en.value(), strides[en.index()], loopStrides)))
+      return llvm::None;
+  return loopStrides;
+}
+
+/// Configures the loops of `stream` and starts it on `buffer`. The hardware
+/// counts the loops from the innermost one and increments the address by the
+/// stride of a loop after the inner loops have run through, so the distance
+/// they covered is subtracted from it.
+static void emitStreamSetup(OpBuilder &b, Location loc,
+                            const OperandStream &stream,
+                            ArrayRef<Range> loopRanges, Value buffer,
+                            bool isWrite) {
+  auto toI32 = [&](Value index) -> Value {
+    return b.create<IndexCastOp>(loc, index, b.getI32Type());
+  };
+  Value one = b.create<ConstantIndexOp>(loc, 1);
+  Value covered = b.create<ConstantIndexOp>(loc, 0);
+  for (unsigned dim = 0; dim < stream.numLoops; ++dim) {
+    unsigned loop = stream.numLoops - 1 - dim;
+    Value stride = b.create<ConstantIndexOp>(
+        loc, stream.loopStrides[loop] * kElementBytes);
+    Value bound = b.create<SubIOp>(loc, loopRanges[loop].size, one);
+    Value increment = b.create<SubIOp>(loc, stride, covered);
+    b.create<snitch::SSRSetupBoundStrideOp>(
+        loc, b.getI32IntegerAttr(stream.dm), b.getI32IntegerAttr(dim),
+        toI32(bound), toI32(increment));
+    covered = b.create<AddIOp>(loc, covered,
+                               b.create<MulIOp>(loc, stride, bound));
+  }
+  if (isWrite)
+    b.create<snitch::SSRWriteOp>(loc, b.getI32IntegerAttr(stream.dm),
+                                 b.getI32IntegerAttr(stream.numLoops), buffer);
+  else
+    b.create<snitch::SSRReadOp>(loc, b.getI32IntegerAttr(stream.dm),
+                                b.getI32IntegerAttr(stream.numLoops), buffer);
+}
+
+namespace {
+/// Emits the loop nest of a Linalg operation whose operands are streamed.
+class StreamedLoopNestBuilder {
+public:
+  StreamedLoopNestBuilder(LinalgOp op, ArrayRef<Range> loopRanges,
+                          unsigned numParallelLoops,
+                          ArrayRef<Optional<unsigned>> inputDMs,
+                          Optional<unsigned> outputDM, bool inferFrep)
+      : op(op), body(op.getOperation()->getRegion(0).front()),
+        loopRanges(loopRanges), numLoops(op.getNumLoops()),
+        numParallelLoops(numParallelLoops), inputDMs(inputDMs),
+        outputDM(outputDM), inferFrep(inferFrep) {}
+
+  /// Emits the parallel loops from `loop` on and everything nested in them.
+  void emitParallelLoops(OpBuilder &b, Location loc, unsigned loop) {
+    if (loop == numParallelLoops)
+      return emitOutputUpdate(b, loc);
+    markFrep(b, loc, loop);
+    b.create<scf::ForOp>(
+        loc, loopRanges[loop].offset, loopRanges[loop].size,
+        loopRanges[loop].stride, llvm::None,
+        [&](OpBuilder &nested, Location nestedLoc, Value iv, ValueRange) {
+          ivs.push_back(iv);
+          emitParallelLoops(nested, nestedLoc, loop + 1);
+          nested.create<scf::YieldOp>(nestedLoc);
+        });
+  }
+
+private:
+  /// Computes the element of the output for the current iteration of the
+  /// parallel loops and pushes it to the write stream, or stores it if the
+  /// operation has no parallel loops.
+  void emitOutputUpdate(OpBuilder &b, Location loc) {
+    Value output = op.getOutputBuffer(0);
+    Value init;
+    if (!body.getArgument(op.getNumInputs()).use_empty())
+      init = b.create<LoadOp>(loc, output, getOutputIndices(b, loc));
+    Value result = emitReductionLoops(b, loc, numParallelLoops, init);
+    if (outputDM)
+      b.create<snitch::SSRPushOp>(loc, b.getI32IntegerAttr(*outputDM), result);
+    else
+      b.create<StoreOp>(loc, result, output, getOutputIndices(b, loc));
+  }
+
+  /// Emits the reduction loops from `loop` on, which carry the partial result
+  /// `acc`, and returns the result.
+  Value emitReductionLoops(OpBuilder &b, Location loc, unsigned loop,
+                           Value acc) {
+    if (loop == numLoops)
+      return emitBody(b, loc, acc);
+    markFrep(b, loc, loop);
+    auto forOp = b.create<scf::ForOp>(
+        loc, loopRanges[loop].offset, loopRanges[loop].size,
+        loopRanges[loop].stride, ValueRange{acc},
+        [&](OpBuilder &nested, Location nestedLoc, Value, ValueRange args) {
+          Value result =
+              emitReductionLoops(nested, nestedLoc, loop + 1, args.front());
+          nested.create<scf::YieldOp>(nestedLoc, result);
+        });
+    return forOp.getResult(0);
+  }
+
+  /// Pops the inputs off their streams and clones the body of the operation.
+  Value emitBody(OpBuilder &b, Location loc, Value output) {
+    BlockAndValueMapping map;
+    for (auto en : llvm::enumerate(inputDMs))
+      if (en.value())
+        map.map(body.getArgument(en.index()),
+                b.create<snitch::SSRPopOp>(loc, b.getF64Type(),
+                                           b.getI32IntegerAttr(*en.value())));
+    if (output)
+      map.map(body.getArgument(op.getNumInputs()), output);
+    for (Operation &bodyOp : body.without_terminator())
+      b.clone(bodyOp, map);
+    return map.lookupOrDefault(body.getTerminator()->getOperand(0));
+  }
+
+  /// Returns the indices of the output element of the current iteration of
+  /// the parallel loops. The output does not depend on the reduction loops.
+  SmallVector<Value, 4> getOutputIndices(OpBuilder &b, Location loc) {
+    SmallVector<Value, 4> dims(ivs.begin(), ivs.end());
+    dims.resize(numLoops, b.create<ConstantIndexOp>(loc, 0));
+    AffineMap map = op.getOutputIndexingMap(0);
+    SmallVector<Value, 4> indices;
+    for (unsigned i = 0, e = map.getNumResults(); i < e; ++i)
+      indices.push_back(b.create<AffineApplyOp>(loc, map.getSubMap({i}), dims));
+    return indices;
+  }
+
+  void markFrep(OpBuilder &b, Location loc, unsigned loop) {
+    if (inferFrep && loop == numLoops - 1)
+      b.create<snitch::FrepInferOp>(loc);
+  }
+
+  LinalgOp op;
+  Block &body;
+  ArrayRef<Range> loopRanges;
+  unsigned numLoops;
+  unsigned numParallelLoops;
+  ArrayRef<Optional<unsigned>> inputDMs;
+  Optional<unsigned> outputDM;
+  bool inferFrep;
+  SmallVector<Value, 4> ivs;
+};
+
+/// Lowers a Linalg operation to a loop nest around its body that reads the
+/// inputs from read streams and writes the output to a write stream.
+///
+/// The operation must have a single f64 output, at most four loops with the
+/// reduction loops innermost, and f64 inputs accessed through linear maps
+/// with static strides. The buffers of the streams are assumed not to
+/// overlap, which is the case for tiles promoted into the TCDM, and the
+/// iteration space is assumed not to be empty.
+struct LinalgToSnitchStreamsPattern : public RewritePattern {
+  LinalgToSnitchStreamsPattern()
+      : RewritePattern(/*benefit=*/1, MatchAnyOpTypeTag()) {}
+
+  LogicalResult matchAndRewrite(Operation *operation,
+                                PatternRewriter &rewriter) const override {
+    auto op = dyn_cast<LinalgOp>(operation);
+    if (!op || isa<IndexedGenericOp>(operation) || !op.hasBufferSemantics() ||
+        operation->getNumRegions() != 1 ||
+        !llvm::hasSingleElement(operation->getRegion(0)))
+      return failure();
+    unsigned numLoops = op.getNumLoops();
+    unsigned numInputs = op.getNumInputs();
+    if (op.getNumOutputs() != 1 || numLoops == 0 || numLoops > kNumSSRLoops)
+      return failure();
+
+    // A write stream runs over the parallel loops only, so the reduction
+    // loops have to be the innermost ones.
+    ArrayAttr iterators = op.iterator_types();
+    unsigned numParallelLoops = 0;
+    while (numParallelLoops < numLoops &&
+           isParallelIterator(iterators[numParallelLoops]))
+      ++numParallelLoops;
+    for (unsigned loop = numParallelLoops; loop < numLoops; ++loop)
+      if (!isReductionIterator(iterators[loop]))
+        return failure();
+
+    // The streams replace all memory accesses of the loop nest.
+    Block &body = operation->getRegion(0).front();
+    bool inferFrep = true;
+    for (Operation &bodyOp : body.without_terminator()) {
+      auto effects = dyn_cast<MemoryEffectOpInterface>(&bodyOp);
+      if (!effects || !effects.hasNoEffect() || bodyOp.getNumRegions() != 0)
+        return failure();
+      inferFrep &= llvm::all_of(bodyOp.getResultTypes(), [](Type type) {
+        return type.isa<FloatType>();
+      });
+    }
+
+    Value output = op.getOutputBuffer(0);
+    AffineMap outputMap = op.getOutputIndexingMap(0);
+    bool outputUsed = !body.getArgument(numInputs).use_empty();
+    if (!getLoopStrides(output, outputMap, numLoops))
+      return failure();
+    for (unsigned loop = numParallelLoops; loop < numLoops; ++loop)
+      if (outputMap.isFunctionOfDim(loop))
+        return failure();
+    if (numParallelLoops < numLoops && !outputUsed)
+      return failure();
+
+    SmallVector<OperandStream, kNumSSRs> streams;
+    SmallVector<Optional<unsigned>, kNumSSRs> inputDMs(numInputs, llvm::None);
+    for (unsigned i = 0; i < numInputs; ++i) {
+      Value input = op.getInput(i);
+      if (body.getArgument(i).use_empty())
+        continue;
+      if (input == output || streams.size() == kNumSSRs)
+        return failure();
+      auto loopStrides =
+          getLoopStrides(input, op.getInputIndexingMap(i), numLoops);
+      if (!loopStrides)
+        return failure();
+      unsigned dm = streams.size();
+      inputDMs[i] = dm;
+      streams.push_back({dm, numLoops, std::move(*loopStrides)});
+    }
+    Optional<unsigned> outputDM;
+    if (numParallelLoops > 0) {
+      if (streams.size() == kNumSSRs)
+        return failure();
+      unsigned dm = streams.size();
+      outputDM = dm;
+      streams.push_back({dm, numParallelLoops,
+                         *getLoopStrides(output, outputMap, numLoops)});
+    }
+
+    // The body of the innermost loop has to consist of floating-point
+    // operations and stream accesses only, which excludes loading the output
+    // in the innermost parallel loop.
+    if (numParallelLoops == numLoops && outputUsed)
+      inferFrep = false;
+
+    Location loc = op.getLoc();
+    SmallVector<Range, 4> loopRanges = op.createLoopRanges(rewriter, loc);
+    for (unsigned i = 0; i < numInputs; ++i)
+      if (inputDMs[i])
+        emitStreamSetup(rewriter, loc, streams[*inputDMs[i]], loopRanges,
+                        op.getInput(i), /*isWrite=*/false);
+    if (outputDM)
+      emitStreamSetup(rewriter, loc, streams[*outputDM], loopRanges, output,
+                      /*isWrite=*/true);
+    rewriter.create<snitch::SSREnableOp>(loc);
+    StreamedLoopNestBuilder(op, loopRanges, numParallelLoops, inputDMs,
+                            outputDM, inferFrep)
+        .emitParallelLoops(rewriter, loc, 0);
+    rewriter.create<snitch::SSRDisableOp>(loc);
+    if (outputDM)
+      rewriter.create<snitch::SSRBarrierOp>(
+          loc, rewriter.getI32IntegerAttr(*outputDM));
+    rewriter.eraseOp(operation);
+    return success();
+  }
+};
+} // namespace
+
+void mlir::populateLinalgToSnitchConversionPatterns(
+    MLIRContext *context, OwningRewritePatternList &patterns) {
+  patterns.insert<LinalgToSnitchStreamsPattern>();
+}
+
+Optional<Value> mlir::snitchDMACopyAsync(OpBuilder &b, Value src, Value dst) {
+  auto srcType = src.getType().cast<MemRefType>();
+  auto dstType = dst.getType().cast<MemRefType>();
+  auto hasUnitInnermostStride = [](MemRefType type) {
+    int64_t offset;
+    SmallVector<int64_t, 2> strides;
+    return succeeded(getStridesAndOffset(type, strides, offset)) &&
+           !strides.empty() && strides.back() == 1;
+  };
+  if (srcType.getRank() < 1 || srcType.getRank() > 2 ||
+      !srcType.getElementType().isIntOrFloat() ||
+      !hasUnitInnermostStride(srcType) || !hasUnitInnermostStride(dstType))
+    return llvm::None;
+  return b.create<snitch::DMACopyOp>(src.getLoc(), b.getI32Type(), src, dst)
+      .getResult();
+}
+
+LogicalResult mlir::snitchDMAWait(OpBuilder &b, Value txid) {
+  b.create<snitch::DMAWaitOp>(txid.getLoc(), txid);
+  return success();
+}
+
+LogicalResult mlir::snitchDMACopy(OpBuilder &b, Value src, Value dst) {
+  // Fall back to a copy by the core for what the DMA cannot transfer.
+  Optional<Value> txid = snitchDMACopyAsync(b, src, dst);
+  if (!txid) {
+    b.create<CopyOp>(src.getLoc(), src, dst);
+    return success();
+  }
+  return snitchDMAWait(b, *txid);
+}
+
+namespace {
+struct ConvertLinalgToSnitchPass
+    : public ConvertLinalgToSnitchBase<ConvertLinalgToSnitchPass> {
+  void runOnFunction() override {
+    OwningRewritePatternList patterns;
+    populateLinalgToSnitchConversionPatterns(&getContext(), patterns);
+    applyPatternsAndFoldGreedily(getFunction(), std::move(patterns));
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<FuncOp>> mlir::createConvertLinalgToSnitchPass() {
+  return std::make_unique<ConvertLinalgToSnitchPass>();
+}
@@ -33,6 +33,7 @@ class LLVMArmNeonDialect;
 class LLVMArmSVEDialect;
 class LLVMAVX512Dialect;
 class LLVMDialect;
+class LLVMSnitchDialect;
 } // end namespace LLVM
 
 namespace NVVM {
@@ -55,6 +56,10 @@ namespace scf {
 class SCFDialect;
 } // end namespace scf
 
+namespace snitch {
+class SnitchDialect;
+} // end namespace snitch
+
 namespace spirv {
 class SPIRVDialect;
 } // end namespace spirv
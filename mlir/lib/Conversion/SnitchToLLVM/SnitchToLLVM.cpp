@@ -0,0 +1,258 @@
+//===- SnitchToLLVM.cpp - Snitch to the LLVM dialect ----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/SnitchToLLVM/SnitchToLLVM.h"
+
+#include "../PassDetail.h"
+#include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVM.h"
+#include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/LLVMIR/LLVMSnitchDialect.h"
+#include "mlir/Dialect/Snitch/SnitchDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/PatternMatch.h"
+
+using namespace mlir;
+using namespace mlir::snitch;
+
+static Value createI32Constant(OpBuilder &b, Location loc, int64_t value) {
+  return b.create<LLVM::ConstantOp>(loc, b.getI32Type(),
+                                    b.getI32IntegerAttr(value));
+}
+
+/// Returns the pointer to the first element of the memref with the given
+/// descriptor.
+static Value getBufferStart(OpBuilder &b, Location loc, Value descriptor) {
+  MemRefDescriptor desc(descriptor);
+  Value base = desc.alignedPtr(b, loc);
+  return b.create<LLVM::GEPOp>(loc, base.getType(), base,
+                               ValueRange{desc.offset(b, loc)});
+}
+
+namespace {
+
+struct SSRSetupBoundStrideOpConversion
+    : public ConvertOpToLLVMPattern<SSRSetupBoundStrideOp> {
+  using ConvertOpToLLVMPattern<SSRSetupBoundStrideOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SSRSetupBoundStrideOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    SSRSetupBoundStrideOp::Adaptor adaptor(operands);
+    Value dm = createI32Constant(rewriter, op.getLoc(), op.dm());
+    SmallVector<Value, 3> args = {dm, adaptor.bound(), adaptor.stride()};
+    switch (op.dim()) {
+    case 0:
+      rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_setup_bound_stride_1d>(
+          op, TypeRange(), args);
+      return success();
+    case 1:
+      rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_setup_bound_stride_2d>(
+          op, TypeRange(), args);
+      return success();
+    case 2:
+      rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_setup_bound_stride_3d>(
+          op, TypeRange(), args);
+      return success();
+    case 3:
+      rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_setup_bound_stride_4d>(
+          op, TypeRange(), args);
+      return success();
+    }
+    return failure();
+  }
+};
+
+/// Converts snitch.ssr_read and snitch.ssr_write, which take the number of
+/// loops of the stream, to the intrinsics, which take the index of the
+/// outermost loop.
+template <typename SourceOp, typename TargetOp>
+struct SSRStartOpConversion : public ConvertOpToLLVMPattern<SourceOp> {
+  using ConvertOpToLLVMPattern<SourceOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SourceOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    typename SourceOp::Adaptor adaptor(operands);
+    Location loc = op.getLoc();
+    Value dm = createI32Constant(rewriter, loc, op.dm());
+    Value dim = createI32Constant(rewriter, loc, op.dims() - 1);
+    Value ptr = rewriter.create<LLVM::BitcastOp>(
+        loc, this->getVoidPtrType(),
+        getBufferStart(rewriter, loc, adaptor.buffer()));
+    rewriter.replaceOpWithNewOp<TargetOp>(op, TypeRange(),
+                                          ValueRange{dm, dim, ptr});
+    return success();
+  }
+};
+
+struct SSRPopOpConversion : public ConvertOpToLLVMPattern<SSRPopOp> {
+  using ConvertOpToLLVMPattern<SSRPopOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SSRPopOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    Value dm = createI32Constant(rewriter, op.getLoc(), op.dm());
+    rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_pop>(
+        op, TypeRange{rewriter.getF64Type()}, ValueRange{dm});
+    return success();
+  }
+};
+
+struct SSRPushOpConversion : public ConvertOpToLLVMPattern<SSRPushOp> {
+  using ConvertOpToLLVMPattern<SSRPushOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SSRPushOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    SSRPushOp::Adaptor adaptor(operands);
+    Value dm = createI32Constant(rewriter, op.getLoc(), op.dm());
+    rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_push>(
+        op, TypeRange(), ValueRange{dm, adaptor.value()});
+    return success();
+  }
+};
+
+struct SSRBarrierOpConversion : public ConvertOpToLLVMPattern<SSRBarrierOp> {
+  using ConvertOpToLLVMPattern<SSRBarrierOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SSRBarrierOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    Value dm = createI32Constant(rewriter, op.getLoc(), op.dm());
+    rewriter.replaceOpWithNewOp<LLVM::riscv_ssr_barrier>(op, TypeRange(),
+                                                         ValueRange{dm});
+    return success();
+  }
+};
+
+/// Converts the operations without attributes and results whose operands map
+/// one to one to the operands of the intrinsic.
+template <typename SourceOp, typename TargetOp>
+struct ZeroResultIntrinsicConversion : public ConvertOpToLLVMPattern<SourceOp> {
+  using ConvertOpToLLVMPattern<SourceOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(SourceOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    rewriter.replaceOpWithNewOp<TargetOp>(op, TypeRange(), operands);
+    return success();
+  }
+};
+
+/// Converts snitch.dma_copy into a 1-D transfer of the whole buffer or into
+/// a 2-D transfer with one burst per row.
+struct DMACopyOpConversion : public ConvertOpToLLVMPattern<DMACopyOp> {
+  using ConvertOpToLLVMPattern<DMACopyOp>::ConvertOpToLLVMPattern;
+
+  LogicalResult
+  matchAndRewrite(DMACopyOp op, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const override {
+    DMACopyOp::Adaptor adaptor(operands);
+    Location loc = op.getLoc();
+    auto type = op.src().getType().cast<MemRefType>();
+    unsigned rank = type.getRank();
+    MemRefDescriptor src(adaptor.src()), dst(adaptor.dst());
+
+    auto toAddress = [&](Value descriptor) -> Value {
+      return rewriter.create<LLVM::PtrToIntOp>(
+          loc, rewriter.getI64Type(),
+          getBufferStart(rewriter, loc, descriptor));
+    };
+    Value elementBytes = createIndexConstant(
+        rewriter, loc, type.getElementTypeBitWidth() / 8);
+    auto toBytes = [&](Value elements) -> Value {
+      Value bytes = rewriter.create<LLVM::MulOp>(loc, getIndexType(),
+                                                 elements, elementBytes);
+      return toI32(rewriter, loc, bytes);
+    };
+
+    Value srcAddr = toAddress(adaptor.src());
+    Value dstAddr = toAddress(adaptor.dst());
+    Value rowBytes = toBytes(src.size(rewriter, loc, rank - 1));
+    Value config = createI32Constant(rewriter, loc, 0);
+    if (rank == 1) {
+      rewriter.replaceOpWithNewOp<LLVM::riscv_sdma_start_oned>(
+          op, TypeRange{rewriter.getI32Type()},
+          ValueRange{srcAddr, dstAddr, rowBytes, config});
+      return success();
+    }
+    Value srcStride = toBytes(src.stride(rewriter, loc, 0));
+    Value dstStride = toBytes(dst.stride(rewriter, loc, 0));
+    Value reps = toI32(rewriter, loc, src.size(rewriter, loc, 0));
+    rewriter.replaceOpWithNewOp<LLVM::riscv_sdma_start_twod>(
+        op, TypeRange{rewriter.getI32Type()},
+        ValueRange{srcAddr, dstAddr, rowBytes, srcStride, dstStride, reps,
+                   config});
+    return success();
+  }
+
+private:
+  /// Converts a value of the index type to the i32 the DMA registers take.
+  Value toI32(OpBuilder &b, Location loc, Value index) const {
+    unsigned bitwidth = getTypeConverter()->getIndexTypeBitwidth();
+    if (bitwidth > 32)
+      return b.create<LLVM::TruncOp>(loc, b.getI32Type(), index);
+    if (bitwidth < 32)
+      return b.create<LLVM::ZExtOp>(loc, b.getI32Type(), index);
+    return index;
+  }
+};
+
+} // namespace
+
+/// Populate the given list with patterns that convert from Snitch to LLVM.
+void mlir::populateSnitchToLLVMConversionPatterns(
+    LLVMTypeConverter &converter, OwningRewritePatternList &patterns) {
+  // clang-format off
+  patterns.insert<
+      SSRSetupBoundStrideOpConversion,
+      SSRStartOpConversion<SSRReadOp, LLVM::riscv_ssr_read>,
+      SSRStartOpConversion<SSRWriteOp, LLVM::riscv_ssr_write>,
+      SSRPopOpConversion,
+      SSRPushOpConversion,
+      SSRBarrierOpConversion,
+      ZeroResultIntrinsicConversion<SSREnableOp, LLVM::riscv_ssr_enable>,
+      ZeroResultIntrinsicConversion<SSRDisableOp, LLVM::riscv_ssr_disable>,
+      ZeroResultIntrinsicConversion<FrepInferOp, LLVM::riscv_frep_infer>,
+      DMACopyOpConversion,
+      ZeroResultIntrinsicConversion<DMAWaitOp, LLVM::riscv_sdma_wait>>(
+      converter);
+  // clang-format on
+}
+
+namespace {
+struct ConvertSnitchToLLVMPass
+    : public ConvertSnitchToLLVMBase<ConvertSnitchToLLVMPass> {
+  ConvertSnitchToLLVMPass(unsigned indexBitwidth) {
+    this->indexBitwidth = indexBitwidth;
+  }
+
+  void runOnOperation() override {
+    LowerToLLVMOptions options;
+    options.indexBitwidth = indexBitwidth;
+    LLVMTypeConverter converter(&getContext(), options);
+    OwningRewritePatternList patterns;
+    populateStdToLLVMConversionPatterns(converter, patterns);
+    populateSnitchToLLVMConversionPatterns(converter, patterns);
+
+    LLVMConversionTarget target(getContext());
+    target.addLegalDialect<LLVM::LLVMSnitchDialect>();
+    target.addIllegalDialect<SnitchDialect>();
+    if (failed(applyPartialConversion(getOperation(), target,
+                                      std::move(patterns))))
+      signalPassFailure();
+  }
+};
+} // namespace
+
+std::unique_ptr<OperationPass<ModuleOp>>
+mlir::createConvertSnitchToLLVMPass(unsigned indexBitwidth) {
+  return std::make_unique<ConvertSnitchToLLVMPass>(indexBitwidth);
+}
@@ -15,6 +15,7 @@
 #include "mlir/Conversion/ArmSVEToLLVM/ArmSVEToLLVM.h"
 #include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVM.h"
 #include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
+#include "mlir/Conversion/VectorToPULP/VectorToPULP.h"
 #include "mlir/Dialect/AVX512/AVX512Dialect.h"
 #include "mlir/Dialect/ArmNeon/ArmNeonDialect.h"
 #include "mlir/Dialect/ArmSVE/ArmSVEDialect.h"
@@ -22,6 +23,7 @@
 #include "mlir/Dialect/LLVMIR/LLVMArmNeonDialect.h"
 #include "mlir/Dialect/LLVMIR/LLVMArmSVEDialect.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/Dialect/LLVMIR/LLVMPULPDialect.h"
 #include "mlir/Dialect/Vector/VectorOps.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 
@@ -37,6 +39,7 @@ struct LowerVectorToLLVMPass
     this->enableArmNeon = options.enableArmNeon;
     this->enableArmSVE = options.enableArmSVE;
     this->enableAVX512 = options.enableAVX512;
+    this->enablePULP = options.enablePULP;
   }
   // Override explicitly to allow conditional dialect dependence.
   void getDependentDialects(DialectRegistry &registry) const override {
@@ -47,6 +50,8 @@ struct LowerVectorToLLVMPass
       registry.insert<LLVM::LLVMArmSVEDialect>();
     if (enableAVX512)
       registry.insert<LLVM::LLVMAVX512Dialect>();
+    if (enablePULP)
+      registry.insert<LLVM::LLVMPULPDialect>();
   }
   void runOnOperation() override;
 };
@@ -60,6 +65,11 @@ void LowerVectorToLLVMPass::runOnOperation() {
     populateVectorToVectorCanonicalizationPatterns(patterns, &getContext());
     populateVectorSlicesLoweringPatterns(patterns, &getContext());
     populateVectorContractLoweringPatterns(patterns, &getContext());
+    // Dot products on packed SIMD operands take precedence over the generic
+    // contraction lowering.
+    if (enablePULP)
+      populateVectorToPULPPatterns(&getContext(), patterns,
+                                   reassociateFPReductions);
     applyPatternsAndFoldGreedily(getOperation(), std::move(patterns));
   }
 
@@ -89,6 +99,8 @@ void LowerVectorToLLVMPass::runOnOperation() {
     target.addIllegalDialect<avx512::AVX512Dialect>();
     populateAVX512ToLLVMConversionPatterns(converter, patterns);
   }
+  if (enablePULP)
+    target.addLegalDialect<LLVM::LLVMPULPDialect>();
 
   if (failed(
           applyPartialConversion(getOperation(), target, std::move(patterns))))
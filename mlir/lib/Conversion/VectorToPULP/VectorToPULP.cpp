@@ -0,0 +1,181 @@
+//===- VectorToPULP.cpp - Vector dot products to PULP intrinsics ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/VectorToPULP/VectorToPULP.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMPULPDialect.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/Dialect/Vector/VectorOps.h"
+#include "mlir/IR/PatternMatch.h"
+
+using namespace mlir;
+
+/// Returns true if `op` is the dot product of two 1-D vectors accumulated into
+/// a scalar.
+static bool isDotProduct(vector::ContractionOp op) {
+  if (llvm::size(op.masks()) != 0 || op.getLhsType().getRank() != 1 ||
+      op.getRhsType().getRank() != 1 || op.getAccType().isa<VectorType>())
+    return false;
+  SmallVector<AffineMap, 4> maps = op.getIndexingMaps();
+  return maps[0].isIdentity() && maps[1].isIdentity() &&
+         maps[2].getNumResults() == 0;
+}
+
+/// Returns true if `type` is a packed SIMD type of Xpulpv2.
+static bool isPULPIntVector(Type type) {
+  auto vectorType = type.dyn_cast<VectorType>();
+  if (!vectorType || vectorType.getRank() != 1)
+    return false;
+  Type elementType = vectorType.getElementType();
+  return (vectorType.getNumElements() == 4 && elementType.isInteger(8)) ||
+         (vectorType.getNumElements() == 2 && elementType.isInteger(16));
+}
+
+namespace {
+enum class Extension { None, Sign, Zero };
+} // namespace
+
+/// Returns the value extended to produce `value`, or `value` itself if it is
+/// not the result of an integer extension.
+static Value stripIntExtension(Value value, Extension &extension) {
+  if (auto extOp = value.getDefiningOp<SignExtendIOp>()) {
+    extension = Extension::Sign;
+    return extOp.value();
+  }
+  if (auto extOp = value.getDefiningOp<ZeroExtendIOp>()) {
+    extension = Extension::Zero;
+    return extOp.value();
+  }
+  extension = Extension::None;
+  return value;
+}
+
+template <typename DotOp4, typename DotOp2>
+static Value createDotProduct(PatternRewriter &rewriter, Location loc,
+                              Value lhs, Value rhs, Value acc) {
+  Type i32 = rewriter.getI32Type();
+  if (lhs.getType().cast<VectorType>().getNumElements() == 4)
+    return rewriter
+        .create<DotOp4>(loc, TypeRange{i32}, ValueRange{lhs, rhs, acc})
+        ->getResult(0);
+  return rewriter
+      .create<DotOp2>(loc, TypeRange{i32}, ValueRange{lhs, rhs, acc})
+      ->getResult(0);
+}
+
+namespace {
+/// Rewrites the dot products of vector<4xi8> or vector<2xi16> operands to the
+/// Xpulpv2 dot products. The operands are either used as they are with an
+/// accumulator of their element type, in which case the result wraps around
+/// and the signedness does not matter, or extended from the packed type to
+/// i32 with an i32 accumulator, in which case the extensions select between
+/// the signed, unsigned and mixed dot products.
+struct PULPIntDotProductLowering
+    : public OpRewritePattern<vector::ContractionOp> {
+  PULPIntDotProductLowering(MLIRContext *context)
+      : OpRewritePattern<vector::ContractionOp>(context, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(vector::ContractionOp op,
+                                PatternRewriter &rewriter) const override {
+    if (!isDotProduct(op) || !op.getAccType().isSignlessInteger())
+      return failure();
+
+    Location loc = op.getLoc();
+    Type accType = op.getAccType();
+    Value lhs, rhs, acc;
+    Extension lhsExt, rhsExt;
+    bool truncate = false;
+    if (isPULPIntVector(op.getLhsType()) &&
+        op.getLhsType() == op.getRhsType() &&
+        accType == op.getLhsType().getElementType()) {
+      lhs = op.lhs();
+      rhs = op.rhs();
+      lhsExt = rhsExt = Extension::Sign;
+      acc = rewriter.create<SignExtendIOp>(loc, op.acc(),
+                                           rewriter.getI32Type());
+      truncate = true;
+    } else {
+      lhs = stripIntExtension(op.lhs(), lhsExt);
+      rhs = stripIntExtension(op.rhs(), rhsExt);
+      if (!accType.isInteger(32) || lhsExt == Extension::None ||
+          rhsExt == Extension::None || !isPULPIntVector(lhs.getType()) ||
+          lhs.getType() != rhs.getType())
+        return failure();
+      acc = op.acc();
+    }
+
+    Value dot;
+    if (lhsExt == Extension::Sign && rhsExt == Extension::Sign) {
+      dot = createDotProduct<LLVM::riscv_pulp_sdotsp4,
+                             LLVM::riscv_pulp_sdotsp2>(rewriter, loc, lhs,
+                                                       rhs, acc);
+    } else if (lhsExt == Extension::Zero && rhsExt == Extension::Zero) {
+      dot = createDotProduct<LLVM::riscv_pulp_sdotup4,
+                             LLVM::riscv_pulp_sdotup2>(rewriter, loc, lhs,
+                                                       rhs, acc);
+    } else {
+      // The mixed dot product takes the unsigned operand first.
+      if (lhsExt == Extension::Sign)
+        std::swap(lhs, rhs);
+      dot = createDotProduct<LLVM::riscv_pulp_sdotusp4,
+                             LLVM::riscv_pulp_sdotusp2>(rewriter, loc, lhs,
+                                                        rhs, acc);
+    }
+    if (truncate)
+      dot = rewriter.create<TruncateIOp>(loc, dot, accType);
+    rewriter.replaceOp(op, dot);
+    return success();
+  }
+};
+
+/// Rewrites the dot products of vector<4xf16> operands extended to f32 with
+/// an f32 accumulator to the expanding smallfloat dot product. It sums the
+/// products pairwise into two lanes, which are then added.
+struct PULPFloatDotProductLowering
+    : public OpRewritePattern<vector::ContractionOp> {
+  PULPFloatDotProductLowering(MLIRContext *context)
+      : OpRewritePattern<vector::ContractionOp>(context, /*benefit=*/2) {}
+
+  LogicalResult matchAndRewrite(vector::ContractionOp op,
+                                PatternRewriter &rewriter) const override {
+    if (!isDotProduct(op) || !op.getAccType().isF32())
+      return failure();
+    auto lhsExt = op.lhs().getDefiningOp<FPExtOp>();
+    auto rhsExt = op.rhs().getDefiningOp<FPExtOp>();
+    auto v4f16 = VectorType::get({4}, rewriter.getF16Type());
+    if (!lhsExt || !rhsExt || lhsExt.in().getType() != v4f16 ||
+        rhsExt.in().getType() != v4f16)
+      return failure();
+
+    Location loc = op.getLoc();
+    auto v2f32 = VectorType::get({2}, rewriter.getF32Type());
+    Value zero = rewriter.create<ConstantOp>(loc, rewriter.getZeroAttr(v2f32));
+    Value acc = rewriter.create<vector::InsertOp>(loc, op.acc(), zero,
+                                                  ArrayRef<int64_t>{0});
+    Value sums = rewriter
+                     .create<LLVM::riscv_vfdotpex_s_h>(
+                         loc, TypeRange{v2f32},
+                         ValueRange{acc, lhsExt.in(), rhsExt.in()})
+                     ->getResult(0);
+    Value lo = rewriter.create<vector::ExtractOp>(loc, sums,
+                                                  ArrayRef<int64_t>{0});
+    Value hi = rewriter.create<vector::ExtractOp>(loc, sums,
+                                                  ArrayRef<int64_t>{1});
+    rewriter.replaceOpWithNewOp<AddFOp>(op, lo, hi);
+    return success();
+  }
+};
+} // namespace
+
+void mlir::populateVectorToPULPPatterns(MLIRContext *context,
+                                        OwningRewritePatternList &patterns,
+                                        bool reassociateFPReductions) {
+  patterns.insert<PULPIntDotProductLowering>(context);
+  if (reassociateFPReductions)
+    patterns.insert<PULPFloatDotProductLowering>(context);
+}
@@ -24,6 +24,22 @@ using namespace mlir::async;
 
 #define DEBUG_TYPE "async-parallel-for"
 
+// The minimum estimated cost of the work of a task, in units of the cost of a
+// simple operation. Launching an async.execute on a worker thread costs in the
+// order of a microsecond, and the blocks are made large enough for their work
+// to outweigh it.
+static constexpr int64_t kMinTaskCost = 8192;
+
+// The number of blocks per worker thread to target, so that the workers that
+// run out of work can steal the remaining blocks of the slower ones.
+static constexpr int64_t kBlocksPerWorker = 4;
+
+// The number of blocks that a dispatch task launches.
+static constexpr int64_t kDispatchFanOut = 16;
+
+// The trip count assumed for the nested loops with unknown bounds.
+static constexpr int64_t kUnknownTripCount = 16;
+
 namespace {
 
 // Rewrite scf.parallel operation into multiple concurrent async.execute
@@ -40,45 +56,71 @@ namespace {
 //   %c0 = constant 0 : index
 //   %c1 = constant 1 : index
 //
-//   // Compute blocks sizes for each induction variable.
-//   %num_blocks_i = ... : index
-//   %num_blocks_j = ... : index
+//   // Compute blocks sizes for each induction variable, from the estimated
+//   // cost of an iteration and the number of worker threads of the runtime.
+//   %num_workers = async.runtime.num_worker_threads : index
 //   %block_size_i = ... : index
 //   %block_size_j = ... : index
+//   %num_blocks = ... : index
 //
-//   // Create an async group to track async execute ops.
-//   %group = async.create_group
+//   %is_single_block = cmpi "sle", %num_blocks, %c1 : index
+//   scf.if %is_single_block {
+//     // Execute the loop nest in the caller thread, a task would only add
+//     // overhead.
+//     scf.for %i = %lbi to %ubi step %si {
+//       scf.for %j = %lbj to %ubj step %sj {
+//         "do_some_compute"(%i, %j): () -> ()
+//       }
+//     }
+//   } else {
+//     // Create an async group to track async execute ops.
+//     %group = async.create_group
 //
-//   scf.for %bi = %c0 to %num_blocks_i step %c1 {
-//     %block_start_i = ... : index
-//     %block_end_i   = ... : index
+//     // Launch a dispatch task for each chunk of blocks but the first one.
+//     %num_chunks = ... : index
+//     scf.for %chunk = %c1 to %num_chunks step %c1 {
+//       %token = async.execute {
+//         <dispatch the blocks of %chunk>
+//         async.yield
+//       }
+//       async.add_to_group %token, %group
+//     }
 //
-//     scf.for %bj = %c0 to %num_blocks_j step %c1 {
-//       %block_start_j = ... : index
-//       %block_end_j   = ... : index
+//     // Dispatch the blocks of the first chunk from the caller thread.
+//     <dispatch the blocks of %c0>
 //
+//     // Await completion of all async.execute operations.
+//     async.await_all %group
+//   }
+//
+// To dispatch the blocks of a chunk, the dispatching thread launches a task for
+// each of them but the first one, and executes the first one itself:
+//
+//   scf.for %block = %first_block_plus_one to %end_block step %c1 {
+//     %token = async.execute {
 //       // Execute the body of original parallel operation for the current
 //       // block.
-//       %token = async.execute {
-//         scf.for %i = %block_start_i to %block_end_i step %si {
-//           scf.for %j = %block_start_j to %block_end_j step %sj {
-//             "do_some_compute"(%i, %j): () -> ()
-//           }
+//       %block_start_i = ... : index
+//       %block_end_i   = ... : index
+//       %block_start_j = ... : index
+//       %block_end_j   = ... : index
+//       scf.for %i = %block_start_i to %block_end_i step %si {
+//         scf.for %j = %block_start_j to %block_end_j step %sj {
+//           "do_some_compute"(%i, %j): () -> ()
 //         }
 //       }
-//
-//       // Add produced async token to the group.
-//       async.add_to_group %token, %group
+//       async.yield
 //     }
+//     async.add_to_group %token, %group
 //   }
+//   <execute %first_block>
 //
-//   // Await completion of all async.execute operations.
-//   async.await_all %group
-//
-// In this example outer loop launches inner block level loops as separate async
-// execute operations which will be executed concurrently.
+// The caller only launches a task per chunk of blocks instead of every block,
+// and the chunks are dispatched concurrently.
 //
-// At the end it waits for the completiom of all async execute operations.
+// At the end it waits for the completion of all async execute operations. The
+// tasks are added to the group by the tasks that launch them, before these
+// complete, so the group can not become empty while some are still to come.
 //
 struct AsyncParallelForRewrite : public OpRewritePattern<scf::ParallelOp> {
 public:
@@ -105,6 +147,42 @@ struct AsyncParallelForPass
 
 } // namespace
 
+// Returns the estimated cost of executing the operations of the block once, in
+// units of the cost of a simple operation, saturated at the minimum cost of a
+// task.
+static int64_t estimateCost(Block &block) {
+  int64_t cost = 0;
+  for (Operation &op : block) {
+    if (op.hasTrait<OpTrait::IsTerminator>())
+      continue;
+
+    // The operations nested in loops count for every iteration.
+    int64_t numIterations = 1;
+    if (auto forOp = dyn_cast<scf::ForOp>(op)) {
+      auto lb = forOp.lowerBound().getDefiningOp<ConstantIndexOp>();
+      auto ub = forOp.upperBound().getDefiningOp<ConstantIndexOp>();
+      auto step = forOp.step().getDefiningOp<ConstantIndexOp>();
+      numIterations = kUnknownTripCount;
+      if (lb && ub && step && step.getValue() > 0) {
+        int64_t range = std::max<int64_t>(ub.getValue() - lb.getValue(), 0);
+        numIterations = (range + step.getValue() - 1) / step.getValue();
+      }
+    } else if (isa<scf::ParallelOp, scf::WhileOp>(op)) {
+      numIterations = kUnknownTripCount;
+    }
+
+    int64_t opCost = 1;
+    for (Region &region : op.getRegions())
+      for (Block &nested : region)
+        opCost += estimateCost(nested);
+    cost += std::min(opCost, kMinTaskCost) *
+            std::min(numIterations, kMinTaskCost);
+    if (cost >= kMinTaskCost)
+      return kMinTaskCost;
+  }
+  return cost;
+}
+
 LogicalResult
 AsyncParallelForRewrite::matchAndRewrite(scf::ParallelOp op,
                                          PatternRewriter &rewriter) const {
@@ -114,23 +192,27 @@ AsyncParallelForRewrite::matchAndRewrite(scf::ParallelOp op,
 
   MLIRContext *ctx = op.getContext();
   Location loc = op.getLoc();
+  size_t numLoops = op.getNumLoops();
 
   // Index constants used below.
-  auto indexTy = IndexType::get(ctx);
-  auto zero = IntegerAttr::get(indexTy, 0);
-  auto one = IntegerAttr::get(indexTy, 1);
-  auto c0 = rewriter.create<ConstantOp>(loc, indexTy, zero);
-  auto c1 = rewriter.create<ConstantOp>(loc, indexTy, one);
+  auto c0 = rewriter.create<ConstantIndexOp>(loc, 0);
+  auto c1 = rewriter.create<ConstantIndexOp>(loc, 1);
 
   // Shorthand for signed integer ceil division operation.
   auto divup = [&](Value x, Value y) -> Value {
     return rewriter.create<SignedCeilDivIOp>(loc, x, y);
   };
 
+  // Shorthand for signed integer maximum.
+  auto max = [&](Value x, Value y) -> Value {
+    auto cmp = rewriter.create<CmpIOp>(loc, CmpIPredicate::sgt, x, y);
+    return rewriter.create<SelectOp>(loc, cmp, x, y);
+  };
+
   // Compute trip count for each loop induction variable:
   //   tripCount = divUp(upperBound - lowerBound, step);
-  SmallVector<Value, 4> tripCounts(op.getNumLoops());
-  for (size_t i = 0; i < op.getNumLoops(); ++i) {
+  SmallVector<Value, 4> tripCounts(numLoops);
+  for (size_t i = 0; i < numLoops; ++i) {
     auto lb = op.lowerBound()[i];
     auto ub = op.upperBound()[i];
     auto step = op.step()[i];
@@ -138,9 +220,29 @@ AsyncParallelForRewrite::matchAndRewrite(scf::ParallelOp op,
     tripCounts[i] = divup(range, step);
   }
 
-  // The target number of concurrent async.execute ops.
-  auto numExecuteOps = rewriter.create<ConstantOp>(
-      loc, indexTy, IntegerAttr::get(indexTy, numConcurrentAsyncExecute));
+  // The minimum number of iterations of a block for its work to outweigh the
+  // overhead of its task.
+  int64_t iterationCost = std::max<int64_t>(estimateCost(*op.getBody()), 1);
+  auto minBlockIterations = rewriter.create<ConstantIndexOp>(
+      loc, (kMinTaskCost + iterationCost - 1) / iterationCost);
+
+  // The target number of blocks, for the worker threads of the runtime and at
+  // least the requested number of concurrent async.execute ops.
+  auto numWorkers =
+      rewriter.create<RuntimeNumWorkerThreadsOp>(loc, rewriter.getIndexType());
+  auto blocksPerWorker =
+      rewriter.create<ConstantIndexOp>(loc, kBlocksPerWorker);
+  auto numExecuteOps =
+      rewriter.create<ConstantIndexOp>(loc, numConcurrentAsyncExecute);
+  Value numWorkerBlocks =
+      rewriter.create<MulIOp>(loc, numWorkers, blocksPerWorker);
+
+  // The number of iterations of the loops nested in each induction variable.
+  SmallVector<Value, 4> innerTripCounts(numLoops);
+  innerTripCounts[numLoops - 1] = c1;
+  for (size_t i = numLoops - 1; i > 0; --i)
+    innerTripCounts[i - 1] =
+        rewriter.create<MulIOp>(loc, innerTripCounts[i], tripCounts[i]);
 
   // Blocks sizes configuration for each induction variable.
 
@@ -149,117 +251,159 @@ AsyncParallelForRewrite::matchAndRewrite(scf::ParallelOp op,
   // multidimensional access, e.g. in (%d0, %d1, ..., %dn) = (<from>) to (<to>)
   // we will try to parallelize iteration along the %d0. If %d0 is too small,
   // we'll parallelize iteration over %d1, and so on.
-  SmallVector<Value, 4> targetNumBlocks(op.getNumLoops());
-  SmallVector<Value, 4> blockSize(op.getNumLoops());
-  SmallVector<Value, 4> numBlocks(op.getNumLoops());
-
-  // Compute block size and number of blocks along the first induction variable.
-  targetNumBlocks[0] = numExecuteOps;
-  blockSize[0] = divup(tripCounts[0], targetNumBlocks[0]);
-  numBlocks[0] = divup(tripCounts[0], blockSize[0]);
-
-  // Assign remaining available concurrency to other induction variables.
-  for (size_t i = 1; i < op.getNumLoops(); ++i) {
-    targetNumBlocks[i] = divup(targetNumBlocks[i - 1], numBlocks[i - 1]);
-    blockSize[i] = divup(tripCounts[i], targetNumBlocks[i]);
+  //
+  // The blocks along an induction variable are large enough to reach the
+  // minimum number of iterations of a block with the induction variables
+  // nested in it, which are only split if the outer ones do not make enough
+  // blocks.
+  SmallVector<Value, 4> targetNumBlocks(numLoops);
+  SmallVector<Value, 4> blockSize(numLoops);
+  SmallVector<Value, 4> numBlocks(numLoops);
+  for (size_t i = 0; i < numLoops; ++i) {
+    targetNumBlocks[i] =
+        i == 0 ? max(numWorkerBlocks, numExecuteOps)
+               : divup(targetNumBlocks[i - 1], max(numBlocks[i - 1], c1));
+    Value minBlockSize =
+        max(divup(minBlockIterations, max(innerTripCounts[i], c1)), c1);
+    blockSize[i] = max(divup(tripCounts[i], targetNumBlocks[i]), minBlockSize);
     numBlocks[i] = divup(tripCounts[i], blockSize[i]);
   }
 
-  // Create an async.group to wait on all async tokens from async execute ops.
-  auto group = rewriter.create<CreateGroupOp>(loc, GroupType::get(ctx));
-
-  // Build a scf.for loop nest from the parallel operation.
-
-  // Lower/upper bounds for nest block level computations.
-  SmallVector<Value, 4> blockLowerBounds(op.getNumLoops());
-  SmallVector<Value, 4> blockUpperBounds(op.getNumLoops());
-  SmallVector<Value, 4> blockInductionVars(op.getNumLoops());
-
-  using LoopBodyBuilder =
-      std::function<void(OpBuilder &, Location, Value, ValueRange)>;
-  using LoopBuilder = std::function<LoopBodyBuilder(size_t loopIdx)>;
-
-  // Builds inner loop nest inside async.execute operation that does all the
-  // work concurrently.
-  LoopBuilder workLoopBuilder = [&](size_t loopIdx) -> LoopBodyBuilder {
-    return [&, loopIdx](OpBuilder &b, Location loc, Value iv, ValueRange args) {
-      blockInductionVars[loopIdx] = iv;
+  Value totalNumBlocks = numBlocks[0];
+  for (size_t i = 1; i < numLoops; ++i)
+    totalNumBlocks = rewriter.create<MulIOp>(loc, totalNumBlocks, numBlocks[i]);
+
+  // Builds a loop nest from the parallel operation, over the given bounds.
+  auto buildLoopNest = [&](OpBuilder &b, Location loc, ValueRange lbs,
+                           ValueRange ubs) {
+    scf::buildLoopNest(
+        b, loc, lbs, ubs, op.step(),
+        [&](OpBuilder &nestedBuilder, Location nestedLoc, ValueRange ivs) {
+          // Copy the body of the parallel op with new loop bounds.
+          BlockAndValueMapping mapping;
+          mapping.map(op.getInductionVars(), ivs);
+          for (auto &bodyOp : op.getBody()->without_terminator())
+            nestedBuilder.clone(bodyOp, mapping);
+        });
+  };
 
-      // Continue building async loop nest.
-      if (loopIdx < op.getNumLoops() - 1) {
-        b.create<scf::ForOp>(
-            loc, blockLowerBounds[loopIdx + 1], blockUpperBounds[loopIdx + 1],
-            op.step()[loopIdx + 1], ValueRange(), workLoopBuilder(loopIdx + 1));
-        b.create<scf::YieldOp>(loc);
-        return;
+  // Builds the loop nest over the iterations of a block.
+  auto buildBlock = [&](OpBuilder &b, Location loc, Value blockIndex) {
+    SmallVector<Value, 4> blockLowerBounds(numLoops);
+    SmallVector<Value, 4> blockUpperBounds(numLoops);
+
+    // The block coordinates of the last induction variable vary fastest.
+    for (size_t i = numLoops; i-- > 0;) {
+      Value iv = blockIndex;
+      if (numLoops > 1) {
+        iv = b.create<SignedRemIOp>(loc, blockIndex, numBlocks[i]);
+        blockIndex = b.create<SignedDivIOp>(loc, blockIndex, numBlocks[i]);
       }
 
-      // Copy the body of the parallel op with new loop bounds.
-      BlockAndValueMapping mapping;
-      mapping.map(op.getInductionVars(), blockInductionVars);
-
-      for (auto &bodyOp : op.getLoopBody().getOps())
-        b.clone(bodyOp, mapping);
-    };
-  };
-
-  // Builds a loop nest that does async execute op dispatching.
-  LoopBuilder asyncLoopBuilder = [&](size_t loopIdx) -> LoopBodyBuilder {
-    return [&, loopIdx](OpBuilder &b, Location loc, Value iv, ValueRange args) {
-      auto lb = op.lowerBound()[loopIdx];
-      auto ub = op.upperBound()[loopIdx];
-      auto step = op.step()[loopIdx];
+      auto lb = op.lowerBound()[i];
+      auto ub = op.upperBound()[i];
+      auto step = op.step()[i];
 
       // Compute lower bound for the current block:
       //   blockLowerBound = iv * blockSize * step + lowerBound
-      auto s0 = b.create<MulIOp>(loc, iv, blockSize[loopIdx]);
+      auto s0 = b.create<MulIOp>(loc, iv, blockSize[i]);
       auto s1 = b.create<MulIOp>(loc, s0, step);
       auto s2 = b.create<AddIOp>(loc, s1, lb);
-      blockLowerBounds[loopIdx] = s2;
+      blockLowerBounds[i] = s2;
 
       // Compute upper bound for the current block:
       //   blockUpperBound = min(upperBound,
       //                         blockLowerBound + blockSize * step)
-      auto e0 = b.create<MulIOp>(loc, blockSize[loopIdx], step);
+      auto e0 = b.create<MulIOp>(loc, blockSize[i], step);
       auto e1 = b.create<AddIOp>(loc, e0, s2);
       auto e2 = b.create<CmpIOp>(loc, CmpIPredicate::slt, e1, ub);
       auto e3 = b.create<SelectOp>(loc, e2, e1, ub);
-      blockUpperBounds[loopIdx] = e3;
+      blockUpperBounds[i] = e3;
+    }
 
-      // Continue building async dispatch loop nest.
-      if (loopIdx < op.getNumLoops() - 1) {
-        b.create<scf::ForOp>(loc, c0, numBlocks[loopIdx + 1], c1, ValueRange(),
-                             asyncLoopBuilder(loopIdx + 1));
-        b.create<scf::YieldOp>(loc);
-        return;
-      }
+    buildLoopNest(b, loc, blockLowerBounds, blockUpperBounds);
+  };
 
-      // Build the inner loop nest that will do the actual work inside the
-      // `async.execute` body region.
-      auto executeBodyBuilder = [&](OpBuilder &executeBuilder,
-                                    Location executeLoc,
-                                    ValueRange executeArgs) {
-        executeBuilder.create<scf::ForOp>(executeLoc, blockLowerBounds[0],
-                                          blockUpperBounds[0], op.step()[0],
-                                          ValueRange(), workLoopBuilder(0));
-        executeBuilder.create<async::YieldOp>(executeLoc, ValueRange());
-      };
-
-      auto execute = b.create<ExecuteOp>(
-          loc, /*resultTypes=*/TypeRange(), /*dependencies=*/ValueRange(),
-          /*operands=*/ValueRange(), executeBodyBuilder);
-      auto rankType = IndexType::get(ctx);
-      b.create<AddToGroupOp>(loc, rankType, execute.token(), group.result());
-      b.create<scf::YieldOp>(loc);
+  // Launches an async.execute op added to the group.
+  auto buildTask = [&](OpBuilder &b, Location loc, Value group,
+                       function_ref<void(OpBuilder &, Location)> bodyBuilder) {
+    auto executeBodyBuilder = [&](OpBuilder &executeBuilder,
+                                  Location executeLoc,
+                                  ValueRange executeArgs) {
+      bodyBuilder(executeBuilder, executeLoc);
+      executeBuilder.create<async::YieldOp>(executeLoc, ValueRange());
     };
+
+    auto execute = b.create<ExecuteOp>(
+        loc, /*resultTypes=*/TypeRange(), /*dependencies=*/ValueRange(),
+        /*operands=*/ValueRange(), executeBodyBuilder);
+    auto rankType = IndexType::get(ctx);
+    b.create<AddToGroupOp>(loc, rankType, execute.token(), group);
   };
 
-  // Start building a loop nest from the first induction variable.
-  rewriter.create<scf::ForOp>(loc, c0, numBlocks[0], c1, ValueRange(),
-                              asyncLoopBuilder(0));
+  auto fanOut = rewriter.create<ConstantIndexOp>(loc, kDispatchFanOut);
+
+  // Builds the dispatch of the blocks of a chunk: a task for each block but the
+  // first one, which the dispatching thread executes.
+  auto buildDispatch = [&](OpBuilder &b, Location loc, Value group,
+                           Value chunk) {
+    auto firstBlock = b.create<MulIOp>(loc, chunk, fanOut);
+    auto nextBlock = b.create<AddIOp>(loc, firstBlock, c1);
+    auto chunkEnd = b.create<AddIOp>(loc, firstBlock, fanOut);
+    auto isLastChunk =
+        b.create<CmpIOp>(loc, CmpIPredicate::slt, totalNumBlocks, chunkEnd);
+    auto endBlock = b.create<SelectOp>(loc, isLastChunk, totalNumBlocks,
+                                       chunkEnd);
+
+    b.create<scf::ForOp>(
+        loc, nextBlock, endBlock, c1, ValueRange(),
+        [&](OpBuilder &forBuilder, Location forLoc, Value block,
+            ValueRange args) {
+          buildTask(forBuilder, forLoc, group,
+                    [&](OpBuilder &taskBuilder, Location taskLoc) {
+                      buildBlock(taskBuilder, taskLoc, block);
+                    });
+          forBuilder.create<scf::YieldOp>(forLoc);
+        });
+
+    buildBlock(b, loc, firstBlock);
+  };
 
-  // Wait for the completion of all subtasks.
-  rewriter.create<AwaitAllOp>(loc, group.result());
+  // Execute the loop nest in the caller thread when there is a single block.
+  auto isSingleBlock =
+      rewriter.create<CmpIOp>(loc, CmpIPredicate::sle, totalNumBlocks, c1);
+  rewriter.create<scf::IfOp>(
+      loc, isSingleBlock,
+      [&](OpBuilder &b, Location loc) {
+        buildLoopNest(b, loc, op.lowerBound(), op.upperBound());
+        b.create<scf::YieldOp>(loc);
+      },
+      [&](OpBuilder &b, Location loc) {
+        // Create an async.group to wait on all async tokens from async execute
+        // ops.
+        auto group = b.create<CreateGroupOp>(loc, GroupType::get(ctx));
+
+        // Launch a dispatch task for each chunk but the first one, which the
+        // caller dispatches.
+        auto numChunks =
+            b.create<SignedCeilDivIOp>(loc, totalNumBlocks, fanOut);
+        b.create<scf::ForOp>(
+            loc, c1, numChunks, c1, ValueRange(),
+            [&](OpBuilder &forBuilder, Location forLoc, Value chunk,
+                ValueRange args) {
+              buildTask(forBuilder, forLoc, group.result(),
+                        [&](OpBuilder &taskBuilder, Location taskLoc) {
+                          buildDispatch(taskBuilder, taskLoc, group.result(),
+                                        chunk);
+                        });
+              forBuilder.create<scf::YieldOp>(forLoc);
+            });
+        buildDispatch(b, loc, group.result(), c0);
+
+        // Wait for the completion of all subtasks.
+        b.create<AwaitAllOp>(loc, group.result());
+        b.create<scf::YieldOp>(loc);
+      });
 
   // Erase the original parallel operation.
   rewriter.eraseOp(op);
@@ -30,6 +30,21 @@ static Value cloneMemref(Location loc, Value memref, OpBuilder &b) {
   return alloc;
 }
 
+/// Returns true if the buffer of `tensor` can be written in place by the only
+/// user of `tensor`. This is the case when the tensor is produced by an
+/// operation that bufferizes to a buffer no other live value aliases, i.e. a
+/// fresh allocation or the destination of an operation that was itself
+/// bufferized in place, and when no other operation reads the tensor.
+/// Function arguments and constants are never written in place, as their
+/// buffers are owned by the caller or are read-only.
+static bool isInPlaceWritable(Value tensor) {
+  if (!tensor.hasOneUse())
+    return false;
+  Operation *defOp = tensor.getDefiningOp();
+  return defOp && (isa<InitTensorOp, SubTensorOp, SubTensorInsertOp>(defOp) ||
+                   isa<LinalgOp>(defOp));
+}
+
 static LogicalResult
 allocateBuffersForResults(Location loc, LinalgOp linalgOp,
                           linalg::GenericOpAdaptor &adaptor,
@@ -53,14 +68,17 @@ allocateBuffersForResults(Location loc, LinalgOp linalgOp,
     auto memrefType = MemRefType::get(tensorShape, tensorType.getElementType());
     Value resultTensor = adaptor.outputs()[resultIndex];
 
-    // Clone output buffers whose value is actually used.
-    if (linalgOp.payloadUsesValueFromOutputOperandIndex(resultIndex)) {
-      resultBuffers.push_back(cloneMemref(loc, resultTensor, b));
+    // Write to the buffer of the output operand in place when nothing else
+    // reads it, which is the destination-passing style the output operands
+    // express.
+    if (isInPlaceWritable(linalgOp.getOutput(resultIndex))) {
+      resultBuffers.push_back(resultTensor);
       continue;
     }
 
-    if (auto alloc = resultTensor.getDefiningOp<AllocOp>()) {
-      resultBuffers.push_back(resultTensor);
+    // Clone output buffers whose value is actually used.
+    if (linalgOp.payloadUsesValueFromOutputOperandIndex(resultIndex)) {
+      resultBuffers.push_back(cloneMemref(loc, resultTensor, b));
       continue;
     }
     // Allocate buffers for statically-shaped results.
@@ -265,10 +283,12 @@ public:
     Value sourceMemRef = adaptor.source();
     assert(sourceMemRef.getType().isa<MemRefType>());
 
-    // For now, be conservative and copy the converted input memref.
-    // In general, the converted input memref here could be aliased or could
+    // Insert into the converted input memref in place if nothing else can
+    // observe it. Otherwise, copy it, as the memref could be aliased or could
     // point into constant memory, so mutating it would lead to miscompilations.
-    Value destMemRef = cloneMemref(op.getLoc(), adaptor.dest(), rewriter);
+    Value destMemRef = adaptor.dest();
+    if (!isInPlaceWritable(op.dest()))
+      destMemRef = cloneMemref(op.getLoc(), destMemRef, rewriter);
     assert(destMemRef.getType().isa<MemRefType>());
 
     // Take a subview to copy the small memref.
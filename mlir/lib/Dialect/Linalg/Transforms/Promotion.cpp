@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "PassDetail.h"
+#include "mlir/Analysis/SliceAnalysis.h"
 #include "mlir/Dialect/Affine/EDSC/Intrinsics.h"
 #include "mlir/Dialect/Linalg/EDSC/FoldedIntrinsics.h"
 #include "mlir/Dialect/Linalg/IR/LinalgOps.h"
@@ -23,6 +24,7 @@
 #include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/AffineMap.h"
+#include "mlir/IR/BlockAndValueMapping.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Transforms/FoldUtils.h"
 #include "llvm/ADT/MapVector.h"
@@ -242,6 +244,19 @@ Optional<PromotionInfo> mlir::linalg::promoteSubviewAsNewBuffer(
   return PromotionInfo{*fullLocalView, partialLocalView};
 }
 
+/// Fills the full local view of a promoted buffer with zeros so that the
+/// padding of partial tiles is initialized.
+static void fillWithZero(Value fullLocalView, OperationFolder *folder) {
+  Type elementType =
+      fullLocalView.getType().cast<ShapedType>().getElementType();
+  Value fillVal;
+  if (auto t = elementType.dyn_cast<FloatType>())
+    fillVal = folded_std_constant(folder, FloatAttr::get(t, 0.0));
+  else if (auto t = elementType.dyn_cast<IntegerType>())
+    fillVal = folded_std_constant_int(folder, 0, t);
+  linalg_fill(fullLocalView, fillVal);
+}
+
 static Optional<MapVector<unsigned, PromotionInfo>>
 promoteSubViews(OpBuilder &b, Location loc,
                 LinalgOpInstancePromotionOptions options,
@@ -263,13 +278,7 @@ promoteSubViews(OpBuilder &b, Location loc,
     // Only fill the buffer if the full local view is used
     if (!options.useFullTileBuffers[v.second])
       continue;
-    Value fillVal;
-    if (auto t = subView.getType().getElementType().dyn_cast<FloatType>())
-      fillVal = folded_std_constant(folder, FloatAttr::get(t, 0.0));
-    else if (auto t =
-                 subView.getType().getElementType().dyn_cast<IntegerType>())
-      fillVal = folded_std_constant_int(folder, 0, t);
-    linalg_fill(promotionInfo->fullLocalView, fillVal);
+    fillWithZero(promotionInfo->fullLocalView, folder);
   }
 
   // Copy data into the promoted buffers. Use callback if provided.
@@ -374,6 +383,254 @@ Optional<LinalgOp> mlir::linalg::promoteSubViews(OpBuilder &b,
       b, linalgOp, LinalgOpInstancePromotionOptions(linalgOp, options), folder);
 }
 
+/// Returns the smallest constant bounds of the sizes of `subView`, or None if
+/// one of them is not bounded by a constant.
+static Optional<SmallVector<int64_t, 4>>
+getConstantBoundingSizes(SubViewOp subView) {
+  SmallVector<int64_t, 4> sizes;
+  for (unsigned idx = 0, e = subView.static_sizes().size(); idx != e; ++idx) {
+    if (!subView.isDynamicSize(idx)) {
+      sizes.push_back(subView.getStaticSize(idx));
+      continue;
+    }
+    IntegerAttr sizeAttr =
+        getSmallestBoundingIndex(subView.getDynamicSize(idx));
+    if (!sizeAttr)
+      return llvm::None;
+    sizes.push_back(sizeAttr.getInt());
+  }
+  return sizes;
+}
+
+/// Returns the operations of the body of `loop` that `subView` is computed
+/// from, in the order they appear, or None if one of them has side effects.
+static Optional<SetVector<Operation *>> getLoopSlice(scf::ForOp loop,
+                                                     SubViewOp subView) {
+  SetVector<Operation *> slice;
+  getBackwardSlice(subView, &slice, [&](Operation *op) {
+    return op->getBlock() == loop.getBody();
+  });
+  slice.insert(subView);
+  if (!llvm::all_of(slice, [](Operation *op) {
+        return MemoryEffectOpInterface::hasNoEffect(op);
+      }))
+    return llvm::None;
+  return slice;
+}
+
+/// Returns the positions of the inputs of `op` to double buffer: the promoted
+/// inputs whose subview is computed in the body of `loop` without side effects
+/// and has sizes bounded by constants, so that the buffers can be allocated
+/// ahead of the loop.
+static SmallVector<unsigned, 4>
+getDoubleBufferedInputs(scf::ForOp loop, LinalgOp op,
+                        const LinalgPromotionOptions &options) {
+  SmallVector<unsigned, 4> inputs;
+  for (unsigned idx = 0, e = op.getNumInputs(); idx != e; ++idx) {
+    if (options.operandsToPromote && !options.operandsToPromote->count(idx))
+      continue;
+    auto subView = op.getShapedOperand(idx).getDefiningOp<SubViewOp>();
+    if (!subView || subView->getBlock() != loop.getBody())
+      continue;
+    if (getConstantBoundingSizes(subView) && getLoopSlice(loop, subView))
+      inputs.push_back(idx);
+  }
+  return inputs;
+}
+
+/// Clones the computation of `subView` in the body of `loop` at the insertion
+/// point of `b` for the iteration `iv`.
+static SubViewOp cloneForIteration(OpBuilder &b, scf::ForOp loop,
+                                   SubViewOp subView, Value iv) {
+  BlockAndValueMapping map;
+  map.map(loop.getInductionVar(), iv);
+  for (Operation *op : *getLoopSlice(loop, subView))
+    b.clone(*op, map);
+  return cast<SubViewOp>(map.lookup(subView.getResult()).getDefiningOp());
+}
+
+/// Returns the view of `fullLocalView` with the sizes of `subView`.
+static Value getPartialLocalView(OpBuilder &b, Value fullLocalView,
+                                 SubViewOp subView, OperationFolder *folder) {
+  unsigned rank = subView.getType().getRank();
+  SmallVector<OpFoldResult, 4> partialSizes;
+  for (unsigned idx = 0; idx != rank; ++idx)
+    partialSizes.push_back(folded_std_dim(folder, subView, idx).value);
+  SmallVector<OpFoldResult, 4> zeros(rank, b.getIndexAttr(0));
+  SmallVector<OpFoldResult, 4> ones(rank, b.getIndexAttr(1));
+  return folded_std_subview(folder, fullLocalView, zeros, partialSizes, ones);
+}
+
+/// Replaces `loop`, which carries no values, by a loop that carries
+/// `iterOperands` and has the same body. The new loop yields its region
+/// arguments unchanged.
+static scf::ForOp addIterOperands(OpBuilder &b, scf::ForOp loop,
+                                  ValueRange iterOperands) {
+  OpBuilder::InsertionGuard guard(b);
+  b.setInsertionPoint(loop);
+  auto newLoop =
+      b.create<scf::ForOp>(loop.getLoc(), loop.lowerBound(), loop.upperBound(),
+                           loop.step(), iterOperands);
+  Block *body = loop.getBody();
+  Block *newBody = newLoop.getBody();
+  loop.getInductionVar().replaceAllUsesWith(newLoop.getInductionVar());
+  body->getTerminator()->erase();
+  newBody->getOperations().splice(newBody->end(), body->getOperations());
+  b.setInsertionPointToEnd(newBody);
+  b.create<scf::YieldOp>(loop.getLoc(), newLoop.getRegionIterArgs());
+  loop.erase();
+  return newLoop;
+}
+
+LogicalResult mlir::linalg::promoteSubviewsDoubleBufferedPrecondition(
+    scf::ForOp loop, Operation *op, LinalgPromotionOptions options) {
+  if (!options.asyncCopyInFn || !options.waitFn)
+    return failure();
+  if (failed(promoteSubviewsPrecondition(op, options)))
+    return failure();
+  // The loop is rebuilt with the buffers as loop-carried values.
+  if (op->getParentOp() != loop.getOperation() ||
+      loop.getNumIterOperands() != 0)
+    return failure();
+  if (getDoubleBufferedInputs(loop, cast<LinalgOp>(op), options).empty())
+    return failure();
+  return success();
+}
+
+namespace {
+/// The buffers of a double buffered input.
+struct DoubleBuffer {
+  unsigned operand;
+  SubViewOp subView;
+  bool useFullTileBuffer;
+  Value first, second;
+};
+} // namespace
+
+Optional<LinalgOp> mlir::linalg::promoteSubViewsDoubleBuffered(
+    OpBuilder &b, scf::ForOp loop, LinalgOp op, LinalgPromotionOptions options,
+    OperationFolder *folder) {
+  if (failed(promoteSubviewsDoubleBufferedPrecondition(loop, op, options)))
+    return {};
+  Location loc = op.getLoc();
+  OpBuilder::InsertionGuard guard(b);
+  b.setInsertionPoint(loop);
+  ScopedContext scope(b, loc);
+  LinalgOpInstancePromotionOptions instanceOptions(op, options);
+
+  // 1. Allocate both buffers of every input ahead of the loop and start
+  // copying the tiles of the first iteration into the first ones.
+  SmallVector<DoubleBuffer, 4> buffers;
+  SmallVector<Value, 8> iterOperands;
+  for (unsigned idx : getDoubleBufferedInputs(loop, op, options)) {
+    auto subView = op.getShapedOperand(idx).getDefiningOp<SubViewOp>();
+    bool useFullTileBuffer = instanceOptions.useFullTileBuffers[subView];
+    instanceOptions.subViews.erase(idx);
+    SmallVector<Value, 4> fullSizes;
+    for (int64_t size : *getConstantBoundingSizes(subView))
+      fullSizes.push_back(folded_std_constant_index(folder, size));
+    Optional<Value> first =
+        instanceOptions.allocationFn(b, subView, fullSizes, folder);
+    Optional<Value> second =
+        instanceOptions.allocationFn(b, subView, fullSizes, folder);
+    if (!first || !second)
+      return {};
+    buffers.push_back({idx, subView, useFullTileBuffer, *first, *second});
+  }
+  auto startCopyIn = [&](const DoubleBuffer &buffer, Value iv,
+                         Value fullLocalView) -> Optional<Value> {
+    SubViewOp subView = cloneForIteration(b, loop, buffer.subView, iv);
+    if (buffer.useFullTileBuffer)
+      fillWithZero(fullLocalView, folder);
+    return (*options.asyncCopyInFn)(
+        b, subView, getPartialLocalView(b, fullLocalView, subView, folder));
+  };
+  for (const DoubleBuffer &buffer : buffers) {
+    Optional<Value> token =
+        startCopyIn(buffer, loop.lowerBound(), buffer.first);
+    if (!token)
+      return {};
+    iterOperands.append({buffer.first, buffer.second, *token});
+  }
+
+  // 2. Carry the buffers and the tokens through the loop. Each iteration
+  // computes on the first buffer and swaps the two for the next one.
+  loop = addIterOperands(b, loop, iterOperands);
+  auto iterArgs = loop.getRegionIterArgs();
+  b.setInsertionPoint(op);
+  Value iv = loop.getInductionVar();
+  Value nextIv = b.create<AddIOp>(loc, iv, loop.step());
+  Value hasNext =
+      b.create<CmpIOp>(loc, CmpIPredicate::slt, nextIv, loop.upperBound());
+  SmallVector<Type, 4> tokenTypes;
+  SmallVector<Value, 4> tokens;
+  for (unsigned i = 0, e = buffers.size(); i != e; ++i) {
+    tokens.push_back(iterArgs[3 * i + 2]);
+    tokenTypes.push_back(tokens.back().getType());
+  }
+
+  // 3. Start copying the tiles of the next iteration, if any, into the second
+  // buffers. If a copy cannot be started asynchronously, it is done right away
+  // and the already completed copy of the current tile stands in for it.
+  bool copyFailed = false;
+  auto prefetch = b.create<scf::IfOp>(
+      loc, tokenTypes, hasNext,
+      [&](OpBuilder &nested, Location nestedLoc) {
+        SmallVector<Value, 4> nextTokens;
+        for (auto en : llvm::enumerate(buffers)) {
+          Value fullLocalView = iterArgs[3 * en.index() + 1];
+          if (Optional<Value> token =
+                  startCopyIn(en.value(), nextIv, fullLocalView)) {
+            nextTokens.push_back(*token);
+            continue;
+          }
+          SubViewOp subView =
+              cloneForIteration(b, loop, en.value().subView, nextIv);
+          Value partialLocalView =
+              getPartialLocalView(b, fullLocalView, subView, folder);
+          copyFailed |=
+              failed(instanceOptions.copyInFn(b, subView, partialLocalView));
+          nextTokens.push_back(tokens[en.index()]);
+        }
+        nested.create<scf::YieldOp>(nestedLoc, nextTokens);
+      },
+      [&](OpBuilder &nested, Location nestedLoc) {
+        nested.create<scf::YieldOp>(nestedLoc, tokens);
+      });
+  if (copyFailed)
+    return {};
+
+  // 4. Wait for the tiles of this iteration and compute on them.
+  SmallVector<Value, 8> yieldOperands;
+  for (auto en : llvm::enumerate(buffers)) {
+    const DoubleBuffer &buffer = en.value();
+    Value fullLocalView = iterArgs[3 * en.index()];
+    if (failed((*options.waitFn)(b, tokens[en.index()])))
+      return {};
+    op->setOperand(buffer.operand,
+                   buffer.useFullTileBuffer
+                       ? fullLocalView
+                       : getPartialLocalView(b, fullLocalView, buffer.subView,
+                                             folder));
+    yieldOperands.append({iterArgs[3 * en.index() + 1], fullLocalView,
+                          prefetch.getResult(en.index())});
+  }
+  loop.getBody()->getTerminator()->setOperands(yieldOperands);
+
+  // 5. Release the buffers after the loop.
+  b.setInsertionPointAfter(loop);
+  for (const DoubleBuffer &buffer : buffers) {
+    instanceOptions.deallocationFn(b, buffer.first);
+    instanceOptions.deallocationFn(b, buffer.second);
+  }
+
+  // 6. Promote the remaining subviews as usual.
+  if (instanceOptions.subViews.empty())
+    return op;
+  b.setInsertionPoint(op);
+  return ::promoteSubViews(b, op, instanceOptions, folder);
+}
+
 namespace {
 struct LinalgPromotionPass : public LinalgPromotionBase<LinalgPromotionPass> {
   LinalgPromotionPass() = default;
@@ -0,0 +1,65 @@
+//===- SnitchDialect.cpp - MLIR Snitch ops implementation -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Snitch dialect and its operations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Dialect/Snitch/SnitchDialect.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/OpImplementation.h"
+#include "mlir/IR/TypeUtilities.h"
+
+using namespace mlir;
+using namespace mlir::snitch;
+
+void SnitchDialect::initialize() {
+  addOperations<
+#define GET_OP_LIST
+#include "mlir/Dialect/Snitch/Snitch.cpp.inc"
+      >();
+}
+
+template <typename OpTy>
+static LogicalResult verifySSRStart(OpTy op) {
+  auto type = op.buffer().getType().template cast<MemRefType>();
+  if (!type.getElementType().isF64())
+    return op.emitOpError("requires a buffer of f64 elements");
+  return success();
+}
+
+static LogicalResult verify(SSRReadOp op) { return verifySSRStart(op); }
+static LogicalResult verify(SSRWriteOp op) { return verifySSRStart(op); }
+
+static LogicalResult verify(DMACopyOp op) {
+  auto srcType = op.src().getType().cast<MemRefType>();
+  auto dstType = op.dst().getType().cast<MemRefType>();
+  if (srcType.getElementType() != dstType.getElementType())
+    return op.emitOpError("requires buffers of the same element type");
+  if (!srcType.getElementType().isIntOrFloat())
+    return op.emitOpError("requires buffers of integer or float elements");
+  if (srcType.getRank() != dstType.getRank() || srcType.getRank() < 1 ||
+      srcType.getRank() > 2)
+    return op.emitOpError("requires buffers of the same rank, 1 or 2");
+  for (auto dims : llvm::zip(srcType.getShape(), dstType.getShape()))
+    if (std::get<0>(dims) != std::get<1>(dims) &&
+        !ShapedType::isDynamic(std::get<0>(dims)) &&
+        !ShapedType::isDynamic(std::get<1>(dims)))
+      return op.emitOpError("requires buffers of the same shape");
+  for (MemRefType type : {srcType, dstType}) {
+    int64_t offset;
+    SmallVector<int64_t, 2> strides;
+    if (failed(getStridesAndOffset(type, strides, offset)) ||
+        strides.back() != 1)
+      return op.emitOpError("requires buffers with a unit innermost stride");
+  }
+  return success();
+}
+
+#define GET_OP_CLASSES
+#include "mlir/Dialect/Snitch/Snitch.cpp.inc"
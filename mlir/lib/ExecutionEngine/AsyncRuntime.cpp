@@ -15,9 +15,11 @@
 
 #ifdef MLIR_ASYNCRUNTIME_DEFINE_FUNCTIONS
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <mutex>
@@ -25,7 +27,6 @@
 #include <vector>
 
 #include "llvm/ADT/StringMap.h"
-#include "llvm/Support/ThreadPool.h"
 
 using namespace mlir::runtime;
 
@@ -40,6 +41,156 @@ namespace {
 // Forward declare class defined below.
 class RefCounted;
 
+// -------------------------------------------------------------------------- //
+// A work-stealing scheduler for the tasks of the async runtime.
+//
+// Every worker thread owns a queue of tasks. Tasks submitted from a worker go
+// to the back of its own queue and the worker runs its queue from the back, so
+// that the continuations of a task run while their data is still in cache.
+// Tasks submitted from other threads are spread over the queues round-robin.
+// A worker without tasks steals from the front of the other queues.
+//
+// Threads that block on an async object keep running queued tasks until the
+// object becomes ready, so a blocking await inside a task does not take a
+// worker away, and only go to sleep when there is nothing to run.
+// -------------------------------------------------------------------------- //
+
+class Scheduler;
+
+// The scheduler and the index of the queue of the current worker thread.
+static thread_local Scheduler *currentScheduler = nullptr;
+static thread_local unsigned currentWorker = 0;
+
+class Scheduler {
+public:
+  using Task = std::function<void()>;
+
+  explicit Scheduler(unsigned numThreads)
+      : queues(numThreads), nextQueue(0), numQueued(0), numInFlight(0),
+        numSleeping(0), stopping(false) {
+    workers.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i)
+      workers.emplace_back([this, i]() {
+        currentScheduler = this;
+        currentWorker = i;
+        runUntil([this]() { return stopping.load(); });
+      });
+  }
+
+  ~Scheduler() {
+    stopping = true;
+    wakeUpAll();
+    for (std::thread &worker : workers)
+      worker.join();
+  }
+
+  void submit(Task task) {
+    unsigned index = currentScheduler == this
+                         ? currentWorker
+                         : nextQueue.fetch_add(1, std::memory_order_relaxed) %
+                               queues.size();
+    numInFlight.fetch_add(1);
+    numQueued.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(queues[index].mu);
+      queues[index].tasks.push_back(std::move(task));
+    }
+    wakeUpOne();
+  }
+
+  // Runs tasks on the calling thread until `isDone` returns true. The state
+  // that `isDone` checks must be updated with sequentially consistent atomics
+  // followed by a call to `wakeUpAll`, otherwise the thread may miss it.
+  template <typename Predicate>
+  void runUntil(Predicate isDone) {
+    while (!isDone()) {
+      if (runOneTask())
+        continue;
+      std::unique_lock<std::mutex> lock(sleepMu);
+      numSleeping.fetch_add(1);
+      sleepCv.wait(lock, [&]() { return isDone() || numQueued.load() != 0; });
+      numSleeping.fetch_sub(1);
+      // Pass on a wake up for a new task if this thread does not run it.
+      if (isDone() && numQueued.load() != 0)
+        sleepCv.notify_one();
+    }
+  }
+
+  unsigned getNumThreads() const { return workers.size(); }
+
+  // Waits for the completion of all submitted tasks.
+  void wait() {
+    runUntil([this]() { return numInFlight.load() == 0; });
+  }
+
+  // Wakes up the threads sleeping in `runUntil` to check their conditions.
+  void wakeUpAll() {
+    if (numSleeping.load() == 0)
+      return;
+    { std::lock_guard<std::mutex> lock(sleepMu); }
+    sleepCv.notify_all();
+  }
+
+private:
+  struct TaskQueue {
+    std::mutex mu;
+    std::deque<Task> tasks;
+  };
+
+  void wakeUpOne() {
+    if (numSleeping.load() == 0)
+      return;
+    { std::lock_guard<std::mutex> lock(sleepMu); }
+    sleepCv.notify_one();
+  }
+
+  // Runs a task from the queue of the calling worker, or steals one from the
+  // other queues. Returns false if there was no task to run.
+  bool runOneTask() {
+    if (numQueued.load() == 0)
+      return false;
+
+    bool isWorker = currentScheduler == this;
+    unsigned home = isWorker ? currentWorker : 0;
+    Task task;
+    for (unsigned i = 0, e = queues.size(); i != e && !task; ++i) {
+      TaskQueue &queue = queues[(home + i) % e];
+      std::lock_guard<std::mutex> lock(queue.mu);
+      if (queue.tasks.empty())
+        continue;
+      if (isWorker && i == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+    if (!task)
+      return false;
+
+    numQueued.fetch_sub(1);
+    task();
+    if (numInFlight.fetch_sub(1) == 1)
+      wakeUpAll();
+    return true;
+  }
+
+  std::vector<TaskQueue> queues;
+  std::vector<std::thread> workers;
+  std::atomic<unsigned> nextQueue;
+
+  // The number of tasks in the queues, and of tasks queued or running.
+  std::atomic<int64_t> numQueued;
+  std::atomic<int64_t> numInFlight;
+
+  // Threads without tasks sleep on the condition variable.
+  std::mutex sleepMu;
+  std::condition_variable sleepCv;
+  std::atomic<int> numSleeping;
+  std::atomic<bool> stopping;
+};
+
 // -------------------------------------------------------------------------- //
 // AsyncRuntime orchestrates all async operations and Async runtime API is built
 // on top of the default runtime instance.
@@ -47,10 +198,12 @@ class RefCounted;
 
 class AsyncRuntime {
 public:
-  AsyncRuntime() : numRefCountedObjects(0) {}
+  AsyncRuntime()
+      : numRefCountedObjects(0),
+        scheduler(std::max(std::thread::hardware_concurrency(), 1u)) {}
 
   ~AsyncRuntime() {
-    threadPool.wait(); // wait for the completion of all async tasks
+    scheduler.wait(); // wait for the completion of all async tasks
     assert(getNumRefCountedObjects() == 0 &&
            "all ref counted objects must be destroyed");
   }
@@ -59,7 +212,7 @@ public:
     return numRefCountedObjects.load(std::memory_order_relaxed);
   }
 
-  llvm::ThreadPool &getThreadPool() { return threadPool; }
+  Scheduler &getScheduler() { return scheduler; }
 
 private:
   friend class RefCounted;
@@ -74,7 +227,7 @@ private:
   }
 
   std::atomic<int32_t> numRefCountedObjects;
-  llvm::ThreadPool threadPool;
+  Scheduler scheduler;
 };
 
 // -------------------------------------------------------------------------- //
@@ -105,6 +258,8 @@ public:
       destroy();
   }
 
+  AsyncRuntime *getRuntime() const { return runtime; }
+
 protected:
   virtual void destroy() { delete this; }
 
@@ -113,6 +268,67 @@ private:
   std::atomic<int32_t> refCount;
 };
 
+// -------------------------------------------------------------------------- //
+// A lock-free list of the awaiters of an async object that becomes ready once.
+// The awaiters form a stack that is swapped out for a marker when the object
+// becomes ready, awaiters added after that run right away.
+// -------------------------------------------------------------------------- //
+
+class AwaiterList {
+public:
+  AwaiterList() : head(nullptr) {}
+
+  ~AwaiterList() {
+    assert((head.load() == nullptr || head.load() == readyMarker()) &&
+           "awaiters must have run");
+  }
+
+  bool isReady() const { return head.load() == readyMarker(); }
+
+  // Runs `awaiter` once the object is ready.
+  void add(std::function<void()> awaiter) {
+    Node *node = new Node{std::move(awaiter), head.load()};
+    while (node->next != readyMarker())
+      if (head.compare_exchange_weak(node->next, node))
+        return;
+    node->awaiter();
+    delete node;
+  }
+
+  // Switches to the ready state and runs all awaiters in the order they were
+  // added.
+  void setReady() {
+    Node *node = head.exchange(readyMarker());
+    assert(node != readyMarker() && "async object is already ready");
+    Node *reversed = nullptr;
+    while (node) {
+      Node *next = node->next;
+      node->next = reversed;
+      reversed = node;
+      node = next;
+    }
+    while (reversed) {
+      Node *next = reversed->next;
+      reversed->awaiter();
+      delete reversed;
+      reversed = next;
+    }
+  }
+
+private:
+  struct Node {
+    std::function<void()> awaiter;
+    Node *next;
+  };
+
+  static Node *readyMarker() {
+    static Node marker;
+    return &marker;
+  }
+
+  std::atomic<Node *> head;
+};
+
 } // namespace
 
 // Returns the default per-process instance of an async runtime.
@@ -136,15 +352,10 @@ struct AsyncToken : public RefCounted {
   // asynchronously executed task. If the caller immediately will drop its
   // reference we must ensure that the token will be alive until the
   // asynchronous operation is completed.
-  AsyncToken(AsyncRuntime *runtime)
-      : RefCounted(runtime, /*count=*/2), ready(false) {}
-
-  std::atomic<bool> ready;
+  AsyncToken(AsyncRuntime *runtime) : RefCounted(runtime, /*count=*/2) {}
 
-  // Pending awaiters are guarded by a mutex.
-  std::mutex mu;
-  std::condition_variable cv;
-  std::vector<std::function<void()>> awaiters;
+  // The token is ready once its awaiters have been run.
+  AwaiterList awaiters;
 };
 
 // Async value provides a mechanism to access the result of asynchronous
@@ -153,17 +364,13 @@ struct AsyncToken : public RefCounted {
 struct AsyncValue : public RefCounted {
   // AsyncValue similar to an AsyncToken created with a reference count of 2.
   AsyncValue(AsyncRuntime *runtime, int32_t size)
-      : RefCounted(runtime, /*count=*/2), ready(false), storage(size) {}
-
-  std::atomic<bool> ready;
+      : RefCounted(runtime, /*count=*/2), storage(size) {}
 
   // Use vector of bytes to store async value payload.
   std::vector<int8_t> storage;
 
-  // Pending awaiters are guarded by a mutex.
-  std::mutex mu;
-  std::condition_variable cv;
-  std::vector<std::function<void()>> awaiters;
+  // The value is ready once its awaiters have been run.
+  AwaiterList awaiters;
 };
 
 // Async group provides a mechanism to group together multiple async tokens or
@@ -176,9 +383,10 @@ struct AsyncGroup : public RefCounted {
   std::atomic<int> pendingTokens;
   std::atomic<int> rank;
 
-  // Pending awaiters are guarded by a mutex.
+  // Unlike tokens and values, a group becomes ready every time its pending
+  // tokens drop to zero, so its awaiters are guarded by a mutex. Only the slow
+  // path of awaiting a group that is not ready takes it.
   std::mutex mu;
-  std::condition_variable cv;
   std::vector<std::function<void()>> awaiters;
 };
 
@@ -215,57 +423,42 @@ extern "C" AsyncGroup *mlirAsyncRuntimeCreateGroup() {
   return group;
 }
 
+// Updates the pending tokens of `group` and runs its awaiters if it was the
+// last one.
+static void onGroupTokenReady(AsyncGroup *group) {
+  if (group->pendingTokens.fetch_sub(1) != 1)
+    return;
+  std::vector<std::function<void()>> awaiters;
+  {
+    std::unique_lock<std::mutex> lock(group->mu);
+    awaiters.swap(group->awaiters);
+  }
+  group->getRuntime()->getScheduler().wakeUpAll();
+  for (auto &awaiter : awaiters)
+    awaiter();
+}
+
 extern "C" int64_t mlirAsyncRuntimeAddTokenToGroup(AsyncToken *token,
                                                    AsyncGroup *group) {
-  std::unique_lock<std::mutex> lockToken(token->mu);
-  std::unique_lock<std::mutex> lockGroup(group->mu);
-
   // Get the rank of the token inside the group before we drop the reference.
   int rank = group->rank.fetch_add(1);
   group->pendingTokens.fetch_add(1);
 
-  auto onTokenReady = [group]() {
-    // Run all group awaiters if it was the last token in the group.
-    if (group->pendingTokens.fetch_sub(1) == 1) {
-      group->cv.notify_all();
-      for (auto &awaiter : group->awaiters)
-        awaiter();
-    }
-  };
-
-  if (token->ready) {
-    // Update group pending tokens immediately and maybe run awaiters.
-    onTokenReady();
-
-  } else {
-    // Update group pending tokens when token will become ready. Because this
-    // will happen asynchronously we must ensure that `group` is alive until
-    // then, and re-ackquire the lock.
-    group->addRef();
-
-    token->awaiters.push_back([group, onTokenReady]() {
-      // Make sure that `dropRef` does not destroy the mutex owned by the lock.
-      {
-        std::unique_lock<std::mutex> lockGroup(group->mu);
-        onTokenReady();
-      }
-      group->dropRef();
-    });
-  }
+  // Update group pending tokens when token will become ready, or right away
+  // if it already is. We must ensure that `group` is alive until then.
+  group->addRef();
+  token->awaiters.add([group]() {
+    onGroupTokenReady(group);
+    group->dropRef();
+  });
 
   return rank;
 }
 
 // Switches `async.token` to ready state and runs all awaiters.
 extern "C" void mlirAsyncRuntimeEmplaceToken(AsyncToken *token) {
-  // Make sure that `dropRef` does not destroy the mutex owned by the lock.
-  {
-    std::unique_lock<std::mutex> lock(token->mu);
-    token->ready = true;
-    token->cv.notify_all();
-    for (auto &awaiter : token->awaiters)
-      awaiter();
-  }
+  token->awaiters.setReady();
+  token->getRuntime()->getScheduler().wakeUpAll();
 
   // Async tokens created with a ref count `2` to keep token alive until the
   // async task completes. Drop this reference explicitly when token emplaced.
@@ -274,36 +467,30 @@ extern "C" void mlirAsyncRuntimeEmplaceToken(AsyncToken *token) {
 
 // Switches `async.value` to ready state and runs all awaiters.
 extern "C" void mlirAsyncRuntimeEmplaceValue(AsyncValue *value) {
-  // Make sure that `dropRef` does not destroy the mutex owned by the lock.
-  {
-    std::unique_lock<std::mutex> lock(value->mu);
-    value->ready = true;
-    value->cv.notify_all();
-    for (auto &awaiter : value->awaiters)
-      awaiter();
-  }
+  value->awaiters.setReady();
+  value->getRuntime()->getScheduler().wakeUpAll();
 
   // Async values created with a ref count `2` to keep value alive until the
   // async task completes. Drop this reference explicitly when value emplaced.
   value->dropRef();
 }
 
+// Blocking awaits run queued tasks on the calling thread until the awaited
+// object becomes ready.
+
 extern "C" void mlirAsyncRuntimeAwaitToken(AsyncToken *token) {
-  std::unique_lock<std::mutex> lock(token->mu);
-  if (!token->ready)
-    token->cv.wait(lock, [token] { return token->ready.load(); });
+  token->getRuntime()->getScheduler().runUntil(
+      [token]() { return token->awaiters.isReady(); });
 }
 
 extern "C" void mlirAsyncRuntimeAwaitValue(AsyncValue *value) {
-  std::unique_lock<std::mutex> lock(value->mu);
-  if (!value->ready)
-    value->cv.wait(lock, [value] { return value->ready.load(); });
+  value->getRuntime()->getScheduler().runUntil(
+      [value]() { return value->awaiters.isReady(); });
 }
 
 extern "C" void mlirAsyncRuntimeAwaitAllInGroup(AsyncGroup *group) {
-  std::unique_lock<std::mutex> lock(group->mu);
-  if (group->pendingTokens != 0)
-    group->cv.wait(lock, [group] { return group->pendingTokens == 0; });
+  group->getRuntime()->getScheduler().runUntil(
+      [group]() { return group->pendingTokens.load() == 0; });
 }
 
 // Returns a pointer to the storage owned by the async value.
@@ -313,43 +500,39 @@ extern "C" ValueStorage mlirAsyncRuntimeGetValueStorage(AsyncValue *value) {
 
 extern "C" void mlirAsyncRuntimeExecute(CoroHandle handle, CoroResume resume) {
   auto *runtime = getDefaultAsyncRuntime();
-  runtime->getThreadPool().async([handle, resume]() { (*resume)(handle); });
+  runtime->getScheduler().submit([handle, resume]() { (*resume)(handle); });
 }
 
 extern "C" void mlirAsyncRuntimeAwaitTokenAndExecute(AsyncToken *token,
                                                      CoroHandle handle,
                                                      CoroResume resume) {
-  auto execute = [handle, resume]() { (*resume)(handle); };
-  if (token->ready) {
-    execute();
-  } else {
-    std::unique_lock<std::mutex> lock(token->mu);
-    token->awaiters.push_back([execute]() { execute(); });
-  }
+  token->awaiters.add([handle, resume]() { (*resume)(handle); });
 }
 
 extern "C" void mlirAsyncRuntimeAwaitValueAndExecute(AsyncValue *value,
                                                      CoroHandle handle,
                                                      CoroResume resume) {
-  auto execute = [handle, resume]() { (*resume)(handle); };
-  if (value->ready) {
-    execute();
-  } else {
-    std::unique_lock<std::mutex> lock(value->mu);
-    value->awaiters.push_back([execute]() { execute(); });
-  }
+  value->awaiters.add([handle, resume]() { (*resume)(handle); });
 }
 
 extern "C" void mlirAsyncRuntimeAwaitAllInGroupAndExecute(AsyncGroup *group,
                                                           CoroHandle handle,
                                                           CoroResume resume) {
   auto execute = [handle, resume]() { (*resume)(handle); };
-  if (group->pendingTokens == 0) {
-    execute();
-  } else {
+  {
+    // Checking the pending tokens under the lock guarantees that the last
+    // token either sees this awaiter or is already accounted for.
     std::unique_lock<std::mutex> lock(group->mu);
-    group->awaiters.push_back([execute]() { execute(); });
+    if (group->pendingTokens.load() != 0) {
+      group->awaiters.push_back(execute);
+      return;
+    }
   }
+  execute();
+}
+
+extern "C" int64_t mlirAsyncRuntimeGetNumWorkerThreads() {
+  return getDefaultAsyncRuntime()->getScheduler().getNumThreads();
 }
 
 //===----------------------------------------------------------------------===//
@@ -407,6 +590,8 @@ extern "C" API void __mlir_runner_init(llvm::StringMap<void *> &exportSymbols) {
                &mlir::runtime::mlirAsyncRuntimeAwaitAllInGroup);
   exportSymbol("mlirAsyncRuntimeAwaitAllInGroupAndExecute",
                &mlir::runtime::mlirAsyncRuntimeAwaitAllInGroupAndExecute);
+  exportSymbol("mlirAsyncRuntimeGetNumWorkerThreads",
+               &mlir::runtime::mlirAsyncRuntimeGetNumWorkerThreads);
   exportSymbol("mlirAsyncRuntimePrintCurrentThreadId",
                &mlir::runtime::mlirAsyncRuntimePrintCurrentThreadId);
 }
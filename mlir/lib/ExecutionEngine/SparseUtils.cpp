@@ -27,6 +27,13 @@
 #include <cstring>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 //===----------------------------------------------------------------------===//
 //
 // Internal support for reading sparse tensors in one of the following
@@ -38,20 +45,68 @@
 // (2) Formidable Repository of Open Sparse Tensors and Tools (FROSTT): *.tns
 //     http://frostt.io/tensors/file-formats.html
 //
+// (3) Binary coordinate scheme: *.spt
+//     A sequence of 64-bit little-endian words, memory-mapped when read:
+//       magic "MLIRSPT1", rank, nnz, flags, sizes[rank],
+//       indices[nnz][rank] (0-based), values[nnz] (f64)
+//     Bit 0 of the flags is set if the elements are in lexicographic index
+//     order. Files in this format are written by writeTensorBinaryC and
+//     avoid parsing text when the same tensor is read repeatedly.
+//
 //===----------------------------------------------------------------------===//
 
 namespace {
 
-/// A sparse tensor element in coordinate scheme (value and indices).
-/// For example, a rank-1 vector element would look like
-///   ({i}, a[i])
-/// and a rank-5 tensor element like
-///   ({i,j,k,l,m}, a[i,j,k,l,m])
-struct Element {
-  Element(const std::vector<uint64_t> &ind, double val)
-      : indices(ind), value(val){};
-  std::vector<uint64_t> indices;
-  double value;
+static const char kBinaryMagic[8] = {'M', 'L', 'I', 'R', 'S', 'P', 'T', '1'};
+static const uint64_t kBinarySorted = 1;
+
+/// A read-only view of a whole file, memory-mapped where supported and read
+/// into memory otherwise.
+class FileBuffer {
+public:
+  explicit FileBuffer(const char *filename) : buffer(nullptr), length(0) {
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        buffer = static_cast<const char *>(addr);
+        length = st.st_size;
+      }
+    }
+    if (fd >= 0)
+      close(fd);
+    if (buffer)
+      return;
+#endif
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+      return;
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+      copy.insert(copy.end(), chunk, chunk + n);
+    fclose(file);
+    buffer = copy.data();
+    length = copy.size();
+  }
+  ~FileBuffer() {
+#ifndef _WIN32
+    if (buffer && copy.empty())
+      munmap(const_cast<char *>(buffer), length);
+#endif
+  }
+  const char *data() const { return buffer; }
+  uint64_t size() const { return length; }
+
+private:
+  FileBuffer(const FileBuffer &) = delete;
+  FileBuffer &operator=(const FileBuffer &) = delete;
+
+  const char *buffer;
+  uint64_t length;
+  std::vector<char> copy; // contents if the file is not mapped
 };
 
 /// A memory-resident sparse tensor in coordinate scheme (collection of
@@ -59,39 +114,136 @@ struct Element {
 /// external file format into memory and sort the elements lexicographically
 /// by indices before passing it back to the client (most packed storage
 /// formats require the elements to appear in lexicographic index order).
+/// For example, a rank-1 vector element would look like
+///   ({i}, a[i])
+/// and a rank-5 tensor element like
+///   ({i,j,k,l,m}, a[i,j,k,l,m])
+/// The indices of all elements are kept in one array, so that a tensor with
+/// many nonzeros does not need one allocation per element. The elements are
+/// either owned by the tensor or reside in a memory-mapped binary file.
 struct SparseTensor {
 public:
   SparseTensor(const std::vector<uint64_t> &szs, uint64_t capacity)
-      : sizes(szs), pos(0) {
-    elements.reserve(capacity);
+      : sizes(szs), rank(szs.size()), nnz(0), indices(nullptr),
+        values(nullptr), pos(0) {
+    ownedIndices.reserve(capacity * rank);
+    ownedValues.reserve(capacity);
   }
+  SparseTensor(const std::vector<uint64_t> &szs, uint64_t nnz,
+               const uint64_t *ind, const double *val, FileBuffer *file)
+      : sizes(szs), rank(szs.size()), nnz(nnz), indices(ind), values(val),
+        pos(0), file(file) {}
+  ~SparseTensor() { delete file; }
   // Add element as indices and value.
-  void add(const std::vector<uint64_t> &ind, double val) {
-    assert(sizes.size() == ind.size());
-    for (int64_t r = 0, rank = sizes.size(); r < rank; r++)
+  void add(const uint64_t *ind, double val) {
+    for (uint64_t r = 0; r < rank; r++)
       assert(ind[r] < sizes[r]); // within bounds
-    elements.emplace_back(Element(ind, val));
+    ownedIndices.insert(ownedIndices.end(), ind, ind + rank);
+    ownedValues.push_back(val);
+    indices = ownedIndices.data();
+    values = ownedValues.data();
+    nnz++;
+  }
+  // Sort elements lexicographically by index, unless they already are.
+  void sort() {
+    if (isSorted())
+      return;
+    assert(!file && "cannot sort a memory-mapped tensor");
+    std::vector<uint64_t> perm(nnz);
+    for (uint64_t k = 0; k < nnz; k++)
+      perm[k] = k;
+    const uint64_t *ind = indices;
+    uint64_t rnk = rank;
+    std::sort(perm.begin(), perm.end(), [ind, rnk](uint64_t k1, uint64_t k2) {
+      return lexOrder(ind + k1 * rnk, ind + k2 * rnk, rnk);
+    });
+    std::vector<uint64_t> sortedIndices(nnz * rank);
+    std::vector<double> sortedValues(nnz);
+    for (uint64_t k = 0; k < nnz; k++) {
+      std::copy(indices + perm[k] * rank, indices + (perm[k] + 1) * rank,
+                sortedIndices.begin() + k * rank);
+      sortedValues[k] = values[perm[k]];
+    }
+    ownedIndices.swap(sortedIndices);
+    ownedValues.swap(sortedValues);
+    indices = ownedIndices.data();
+    values = ownedValues.data();
+  }
+  // Returns true if the elements are in lexicographic index order.
+  bool isSorted() const {
+    for (uint64_t k = 1; k < nnz; k++)
+      if (lexOrder(indices + k * rank, indices + (k - 1) * rank, rank))
+        return false;
+    return true;
   }
-  // Sort elements lexicographically by index.
-  void sort() { std::sort(elements.begin(), elements.end(), lexOrder); }
   // Primitive one-time iteration.
-  const Element &next() { return elements[pos++]; }
+  const uint64_t *next(double &val) {
+    assert(pos < nnz);
+    val = values[pos];
+    return indices + rank * pos++;
+  }
+  const std::vector<uint64_t> &getSizes() const { return sizes; }
+  uint64_t getRank() const { return rank; }
+  uint64_t getNNZ() const { return nnz; }
+  const uint64_t *getIndices() const { return indices; }
+  const double *getValues() const { return values; }
 
 private:
-  // Returns true if indices of e1 < indices of e2.
-  static bool lexOrder(const Element &e1, const Element &e2) {
-    assert(e1.indices.size() == e2.indices.size());
-    for (int64_t r = 0, rank = e1.indices.size(); r < rank; r++) {
-      if (e1.indices[r] == e2.indices[r])
+  // Returns true if indices i1 < indices i2.
+  static bool lexOrder(const uint64_t *i1, const uint64_t *i2, uint64_t rank) {
+    for (uint64_t r = 0; r < rank; r++) {
+      if (i1[r] == i2[r])
         continue;
-      return e1.indices[r] < e2.indices[r];
+      return i1[r] < i2[r];
     }
     return false;
   }
 
   std::vector<uint64_t> sizes; // per-rank dimension sizes
-  std::vector<Element> elements;
+  uint64_t rank;
+  uint64_t nnz;
+  const uint64_t *indices; // nnz x rank, row-major
+  const double *values;
+  std::vector<uint64_t> ownedIndices;
+  std::vector<double> ownedValues;
   uint64_t pos;
+  FileBuffer *file = nullptr; // backing memory-mapped file, if any
+};
+
+/// A sparse matrix in compressed sparse row (CSR) or column (CSC) format.
+/// The pointers of major index i delimit the range [pointers[i],
+/// pointers[i+1]) of the minor indices and values of its nonzeros, which are
+/// ordered by increasing minor index. All three arrays are contiguous, so that
+/// kernels iterating over them can use unit-stride vector loads.
+struct SparseMatrix {
+  SparseMatrix(const SparseTensor &tensor, bool columnMajor) {
+    assert(tensor.getRank() == 2);
+    uint64_t nnz = tensor.getNNZ();
+    uint64_t major = columnMajor ? 1 : 0;
+    uint64_t minor = 1 - major;
+    const uint64_t *ind = tensor.getIndices();
+    const double *val = tensor.getValues();
+    // Counting sort by major index. As the elements are in lexicographic
+    // order, the scatter keeps the minor indices of each row or column in
+    // increasing order.
+    pointers.assign(tensor.getSizes()[major] + 1, 0);
+    for (uint64_t k = 0; k < nnz; k++)
+      pointers[ind[2 * k + major] + 1]++;
+    for (uint64_t i = 1, e = pointers.size(); i < e; i++)
+      pointers[i] += pointers[i - 1];
+    std::vector<uint64_t> next(pointers.begin(), pointers.end() - 1);
+    indices.resize(nnz);
+    values.resize(nnz);
+    for (uint64_t k = 0; k < nnz; k++) {
+      uint64_t p = next[ind[2 * k + major]]++;
+      indices[p] = ind[2 * k + minor];
+      values[p] = val[k];
+    }
+  }
+
+  std::vector<uint64_t> pointers;
+  std::vector<uint64_t> indices;
+  std::vector<double> values;
 };
 
 /// Helper to convert string to lower case.
@@ -171,6 +323,84 @@ static void readExtFROSTTHeader(FILE *file, char *name, uint64_t *idata) {
   }
 }
 
+/// Read the nonzero elements that follow the header of a text file. The rest
+/// of the file is read at once and parsed in memory, which is much faster
+/// than scanning the file one number at a time.
+static void readTextElements(FILE *file, char *name, SparseTensor *tensor,
+                             uint64_t nnz) {
+  std::vector<char> text;
+  char chunk[1 << 16];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    text.insert(text.end(), chunk, chunk + n);
+  text.push_back('\0');
+  uint64_t rank = tensor->getRank();
+  std::vector<uint64_t> indices(rank);
+  char *pos = text.data();
+  char *end;
+  for (uint64_t k = 0; k < nnz; k++) {
+    for (uint64_t r = 0; r < rank; r++) {
+      indices[r] = strtoull(pos, &end, 10) - 1; // 0-based index
+      if (end == pos) {
+        fprintf(stderr, "Cannot find next index in %s\n", name);
+        exit(1);
+      }
+      pos = end;
+    }
+    double value = strtod(pos, &end);
+    if (end == pos) {
+      fprintf(stderr, "Cannot find next value in %s\n", name);
+      exit(1);
+    }
+    pos = end;
+    tensor->add(indices.data(), value);
+  }
+}
+
+/// Map a binary tensor file. The elements are used in place, the returned
+/// tensor keeps the file mapped until it is closed.
+static SparseTensor *readBinaryTensor(char *name, uint64_t *idata) {
+  FileBuffer *file = new FileBuffer(name);
+  const char *data = file->data();
+  uint64_t size = file->size();
+  const uint64_t *words = reinterpret_cast<const uint64_t *>(data);
+  if (!data) {
+    fprintf(stderr, "Cannot find %s\n", name);
+    exit(1);
+  }
+  if (size < 4 * sizeof(uint64_t) ||
+      memcmp(data, kBinaryMagic, sizeof(kBinaryMagic))) {
+    fprintf(stderr, "Corrupt header in %s\n", name);
+    exit(1);
+  }
+  uint64_t rank = words[1];
+  uint64_t nnz = words[2];
+  uint64_t flags = words[3];
+  if (size != (4 + rank + nnz * rank + nnz) * sizeof(uint64_t)) {
+    fprintf(stderr, "Corrupt data in %s\n", name);
+    exit(1);
+  }
+  idata[0] = rank;
+  idata[1] = nnz;
+  std::vector<uint64_t> sizes(words + 4, words + 4 + rank);
+  for (uint64_t r = 0; r < rank; r++)
+    idata[2 + r] = sizes[r];
+  const uint64_t *indices = words + 4 + rank;
+  const double *values =
+      reinterpret_cast<const double *>(indices + nnz * rank);
+  SparseTensor *tensor = new SparseTensor(sizes, nnz, indices, values, file);
+  if (!(flags & kBinarySorted) && !tensor->isSorted()) {
+    // Fall back to an owned copy that can be sorted.
+    SparseTensor *owned = new SparseTensor(sizes, nnz);
+    for (uint64_t k = 0; k < nnz; k++)
+      owned->add(indices + k * rank, values[k]);
+    delete tensor;
+    tensor = owned;
+    tensor->sort();
+  }
+  return tensor;
+}
+
 } // anonymous namespace
 
 //===----------------------------------------------------------------------===//
@@ -218,6 +448,9 @@ static void readExtFROSTTHeader(FILE *file, char *name, uint64_t *idata) {
 /// array parameter is used to pass the rank, the number of nonzero elements,
 /// and the dimension sizes (one per rank).
 extern "C" void *openTensorC(char *filename, uint64_t *idata) {
+  // Binary files are mapped instead of parsed.
+  if (strstr(filename, ".spt"))
+    return readBinaryTensor(filename, idata);
   // Open the file.
   FILE *file = fopen(filename, "r");
   if (!file) {
@@ -237,26 +470,10 @@ extern "C" void *openTensorC(char *filename, uint64_t *idata) {
   // and the number of nonzeros as initial capacity.
   uint64_t rank = idata[0];
   uint64_t nnz = idata[1];
-  std::vector<uint64_t> indices(rank);
-  for (uint64_t r = 0; r < rank; r++)
-    indices[r] = idata[2 + r];
-  SparseTensor *tensor = new SparseTensor(indices, nnz);
+  std::vector<uint64_t> sizes(idata + 2, idata + 2 + rank);
+  SparseTensor *tensor = new SparseTensor(sizes, nnz);
   // Read all nonzero elements.
-  for (uint64_t k = 0; k < nnz; k++) {
-    for (uint64_t r = 0; r < rank; r++) {
-      if (fscanf(file, "%" PRIu64, &indices[r]) != 1) {
-        fprintf(stderr, "Cannot find next index in %s\n", filename);
-        exit(1);
-      }
-      indices[r]--; // 0-based index
-    }
-    double value;
-    if (fscanf(file, "%lg\n", &value) != 1) {
-      fprintf(stderr, "Cannot find next value in %s\n", filename);
-      exit(1);
-    }
-    tensor->add(indices, value);
-  }
+  readTextElements(file, filename, tensor, nnz);
   // Close the file and return sorted tensor.
   fclose(file);
   tensor->sort(); // sort lexicographically
@@ -272,10 +489,9 @@ extern "C" void *openTensor(char *filename, uint64_t *ibase, uint64_t *idata,
 
 /// Yields the next element from the given opaque sparse tensor object.
 extern "C" void readTensorItemC(void *tensor, uint64_t *idata, double *ddata) {
-  const Element &e = static_cast<SparseTensor *>(tensor)->next();
-  for (uint64_t r = 0, rank = e.indices.size(); r < rank; r++)
-    idata[r] = e.indices[r];
-  ddata[0] = e.value;
+  SparseTensor *t = static_cast<SparseTensor *>(tensor);
+  const uint64_t *indices = t->next(ddata[0]);
+  std::copy(indices, indices + t->getRank(), idata);
 }
 
 /// "MLIRized" version.
@@ -293,6 +509,89 @@ extern "C" void closeTensor(void *tensor) {
   delete static_cast<SparseTensor *>(tensor);
 }
 
+/// Writes the given opaque sparse tensor object to a file in the binary
+/// format, which later calls to openTensor map instead of parsing.
+extern "C" void writeTensorBinaryC(void *tensor, char *filename) {
+  SparseTensor *t = static_cast<SparseTensor *>(tensor);
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    exit(1);
+  }
+  uint64_t header[3] = {t->getRank(), t->getNNZ(), kBinarySorted};
+  uint64_t nnz = t->getNNZ(), rank = t->getRank();
+  if (fwrite(kBinaryMagic, sizeof(kBinaryMagic), 1, file) != 1 ||
+      fwrite(header, sizeof(header), 1, file) != 1 ||
+      fwrite(t->getSizes().data(), sizeof(uint64_t), rank, file) != rank ||
+      fwrite(t->getIndices(), sizeof(uint64_t), nnz * rank, file) !=
+          nnz * rank ||
+      fwrite(t->getValues(), sizeof(double), nnz, file) != nnz) {
+    fprintf(stderr, "Cannot write %s\n", filename);
+    exit(1);
+  }
+  fclose(file);
+}
+
+//===----------------------------------------------------------------------===//
+//
+// Public API to convert a sparse matrix read with openTensor to a compressed
+// format, whose pointers, indices, and values arrays are then accessed
+// directly by the kernel.
+//
+//   %csr = call @newSparseMatrix(%tensor, %false)
+//     : (!llvm.ptr<i8>, i1) -> (!llvm.ptr<i8>)
+//   %pointers = call @getSparseMatrixPointers(%csr)
+//     : (!llvm.ptr<i8>) -> memref<?xindex>
+//   %indices = call @getSparseMatrixIndices(%csr)
+//     : (!llvm.ptr<i8>) -> memref<?xindex>
+//   %values = call @getSparseMatrixValues(%csr)
+//     : (!llvm.ptr<i8>) -> memref<?xf64>
+//   .. kernel ..
+//   call @closeSparseMatrix(%csr) : (!llvm.ptr<i8>) -> ()
+//
+// The functions returning a memref follow the C interface convention of
+// functions with the llvm.emit_c_interface attribute.
+//
+//===----------------------------------------------------------------------===//
+
+/// Converts the given sparse matrix, which is not changed, to CSR or, if
+/// `columnMajor` is set, to CSC. The conversion is a single counting sort
+/// over the nonzeros.
+extern "C" void *newSparseMatrix(void *tensor, bool columnMajor) {
+  return new SparseMatrix(*static_cast<SparseTensor *>(tensor), columnMajor);
+}
+
+template <typename T>
+static void toMemRef(StridedMemRefType<T, 1> *ref, std::vector<T> &vec) {
+  ref->basePtr = ref->data = vec.data();
+  ref->offset = 0;
+  ref->sizes[0] = vec.size();
+  ref->strides[0] = 1;
+}
+
+extern "C" void
+_mlir_ciface_getSparseMatrixPointers(StridedMemRefType<uint64_t, 1> *ref,
+                                     void *matrix) {
+  toMemRef(ref, static_cast<SparseMatrix *>(matrix)->pointers);
+}
+
+extern "C" void
+_mlir_ciface_getSparseMatrixIndices(StridedMemRefType<uint64_t, 1> *ref,
+                                    void *matrix) {
+  toMemRef(ref, static_cast<SparseMatrix *>(matrix)->indices);
+}
+
+extern "C" void
+_mlir_ciface_getSparseMatrixValues(StridedMemRefType<double, 1> *ref,
+                                   void *matrix) {
+  toMemRef(ref, static_cast<SparseMatrix *>(matrix)->values);
+}
+
+/// Releases the memory resources of the given compressed sparse matrix.
+extern "C" void closeSparseMatrix(void *matrix) {
+  delete static_cast<SparseMatrix *>(matrix);
+}
+
 /// Helper method to read a sparse tensor filename from the environment,
 /// defined with the naming convention ${TENSOR0}, ${TENSOR1}, etc.
 extern "C" char *getTensorFilename(uint64_t id) {
@@ -0,0 +1,559 @@
+//===- BytecodeReader.cpp - MLIR bytecode reader --------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the reader of the MLIR bytecode format described in
+// mlir/Bytecode/Encoding.h. It lives with the parser, as it is an alternative
+// input format of the `parseSourceFile` entry points, and parses the textual
+// form of the types and attributes it uniques.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeReader.h"
+#include "mlir/Bytecode/Encoding.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/Verifier.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <algorithm>
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+bool mlir::isBytecode(llvm::MemoryBufferRef buffer) {
+  StringRef contents = buffer.getBuffer();
+  return contents.size() >= sizeof(kMagic) &&
+         std::equal(std::begin(kMagic), std::end(kMagic),
+                    contents.bytes_begin());
+}
+
+namespace {
+/// Reads the primitives of the encoding from a range of bytes.
+class EncodingReader {
+public:
+  EncodingReader(ArrayRef<uint8_t> contents, Location fileLoc)
+      : data(contents), pos(data.begin()), fileLoc(fileLoc) {}
+
+  bool empty() const { return pos == data.end(); }
+
+  InFlightDiagnostic emitError(const Twine &msg) {
+    return ::emitError(fileLoc, msg);
+  }
+
+  LogicalResult parseByte(uint8_t &value) {
+    if (empty())
+      return emitError("unexpected end of bytecode");
+    value = *pos++;
+    return success();
+  }
+
+  LogicalResult parseBytes(size_t length, ArrayRef<uint8_t> &result) {
+    if (size_t(data.end() - pos) < length)
+      return emitError("unexpected end of bytecode");
+    result = ArrayRef<uint8_t>(pos, length);
+    pos += length;
+    return success();
+  }
+
+  /// Parse an unsigned LEB128 integer.
+  LogicalResult parseVarInt(uint64_t &result) {
+    result = 0;
+    uint8_t byte;
+    unsigned shift = 0;
+    do {
+      if (shift >= 64)
+        return emitError("malformed variable-width integer");
+      if (failed(parseByte(byte)))
+        return failure();
+      result |= uint64_t(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return success();
+  }
+
+  /// Parse an integer that indexes a table of `size` entries.
+  LogicalResult parseIndex(size_t size, StringRef kind, uint64_t &result) {
+    if (failed(parseVarInt(result)))
+      return failure();
+    if (result >= size)
+      return emitError("invalid ") << kind << " index " << result;
+    return success();
+  }
+
+  /// Parse a string of the string table. The bytes following the string must
+  /// be a null character.
+  LogicalResult parseString(StringRef &result) {
+    uint64_t length;
+    ArrayRef<uint8_t> bytes;
+    if (failed(parseVarInt(length)) || failed(parseBytes(length + 1, bytes)))
+      return failure();
+    if (bytes.back() != 0)
+      return emitError("expected null terminated string");
+    result = StringRef(reinterpret_cast<const char *>(bytes.data()), length);
+    return success();
+  }
+
+  /// Parse a range of bytes prefixed with its size.
+  LogicalResult parseSection(ArrayRef<uint8_t> &result) {
+    uint64_t length;
+    return failure(failed(parseVarInt(length)) ||
+                   failed(parseBytes(length, result)));
+  }
+
+private:
+  ArrayRef<uint8_t> data;
+  const uint8_t *pos;
+  Location fileLoc;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// BytecodeReader::Impl
+//===----------------------------------------------------------------------===//
+
+class BytecodeReader::Impl {
+public:
+  Impl(llvm::MemoryBufferRef buffer, MLIRContext *context, bool lazyLoading)
+      : buffer(buffer), context(context), lazyLoading(lazyLoading),
+        fileLoc(FileLineColLoc::get(buffer.getBufferIdentifier(),
+                                    /*line=*/0, /*column=*/0, context)) {}
+
+  LogicalResult read(Block *block);
+  bool isMaterializable(Operation *op) const { return lazyBodies.count(op); }
+  LogicalResult materialize(Operation *op);
+  LogicalResult materializeAll();
+
+private:
+  /// The values defined in an isolated scope, indexed by their ID, and the
+  /// placeholders of the values used before being defined.
+  struct ValueScope {
+    ~ValueScope();
+    std::vector<Value> values;
+    DenseMap<uint64_t, Operation *> forwardRefs;
+  };
+
+  LogicalResult parseTables(EncodingReader &reader);
+
+  LogicalResult parseOps(EncodingReader &reader, Block *block,
+                         ArrayRef<Block *> regionBlocks, ValueScope &scope);
+  LogicalResult parseOp(EncodingReader &reader, Block *block,
+                        ArrayRef<Block *> regionBlocks, ValueScope &scope);
+  LogicalResult parseRegion(EncodingReader &reader, Region &region,
+                            ValueScope &scope);
+  LogicalResult parseIsolatedRegions(ArrayRef<uint8_t> data, Operation *op);
+  LogicalResult finalizeScope(EncodingReader &reader, ValueScope &scope);
+
+  LogicalResult parseOpName(EncodingReader &reader, OperationName &result);
+  LogicalResult parseType(EncodingReader &reader, Type &result);
+  LogicalResult parseAttribute(EncodingReader &reader, Attribute &result);
+  template <typename T>
+  LogicalResult parseAttribute(EncodingReader &reader, T &result) {
+    Attribute attr;
+    if (failed(parseAttribute(reader, attr)))
+      return failure();
+    if (!(result = attr.dyn_cast<T>()))
+      return reader.emitError("unexpected attribute ") << attr;
+    return success();
+  }
+
+  void defineValue(ValueScope &scope, Value value);
+  LogicalResult parseOperand(EncodingReader &reader, ValueScope &scope,
+                             Value &result);
+
+  llvm::MemoryBufferRef buffer;
+  MLIRContext *context;
+  bool lazyLoading;
+  Location fileLoc;
+
+  /// The string table, and the lazily created names, types and attributes
+  /// referring to it.
+  std::vector<StringRef> strings;
+  DenseMap<uint64_t, OperationName> opNames;
+  std::vector<uint64_t> typeStrings;
+  std::vector<Type> types;
+  std::vector<uint64_t> attrStrings;
+  std::vector<Attribute> attrs;
+
+  /// The encoded regions of the operations that have not been materialized.
+  DenseMap<Operation *, ArrayRef<uint8_t>> lazyBodies;
+};
+
+BytecodeReader::Impl::ValueScope::~ValueScope() {
+  // Release the placeholders left after an error.
+  for (auto &entry : forwardRefs) {
+    entry.second->getResult(0).dropAllUses();
+    entry.second->destroy();
+  }
+}
+
+LogicalResult BytecodeReader::Impl::read(Block *block) {
+  ArrayRef<uint8_t> contents(
+      reinterpret_cast<const uint8_t *>(buffer.getBufferStart()),
+      buffer.getBufferSize());
+  EncodingReader reader(contents, fileLoc);
+  if (failed(parseTables(reader)))
+    return failure();
+
+  // Read the operations into a temporary block, so that nothing is added to
+  // `block` on failure.
+  Block parsedBlock;
+  ValueScope scope;
+  auto eraseParsedOps = [&] {
+    for (Operation &op : parsedBlock)
+      op.dropAllReferences();
+    while (!parsedBlock.empty())
+      parsedBlock.back().erase();
+  };
+  if (failed(parseOps(reader, &parsedBlock, /*regionBlocks=*/{}, scope)) ||
+      failed(finalizeScope(reader, scope))) {
+    eraseParsedOps();
+    return failure();
+  }
+  if (!reader.empty()) {
+    eraseParsedOps();
+    return reader.emitError("unexpected trailing bytes in bytecode");
+  }
+  if (!lazyLoading) {
+    for (Operation &op : parsedBlock) {
+      if (failed(verify(&op))) {
+        eraseParsedOps();
+        return failure();
+      }
+    }
+  }
+
+  auto &destOps = block->getOperations();
+  destOps.splice(destOps.empty() ? destOps.end() : std::prev(destOps.end()),
+                 parsedBlock.getOperations());
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::materialize(Operation *op) {
+  auto it = lazyBodies.find(op);
+  if (it == lazyBodies.end())
+    return success();
+  ArrayRef<uint8_t> data = it->second;
+  lazyBodies.erase(it);
+  return parseIsolatedRegions(data, op);
+}
+
+LogicalResult BytecodeReader::Impl::materializeAll() {
+  while (!lazyBodies.empty())
+    if (failed(materialize(lazyBodies.begin()->first)))
+      return failure();
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::parseTables(EncodingReader &reader) {
+  ArrayRef<uint8_t> magic;
+  if (failed(reader.parseBytes(sizeof(kMagic), magic)) ||
+      !std::equal(magic.begin(), magic.end(), std::begin(kMagic)))
+    return reader.emitError("invalid bytecode magic number");
+  uint64_t version;
+  if (failed(reader.parseVarInt(version)))
+    return failure();
+  if (version != kVersion)
+    return reader.emitError("unsupported bytecode version ") << version;
+
+  uint64_t numStrings;
+  if (failed(reader.parseVarInt(numStrings)))
+    return failure();
+  strings.resize(numStrings);
+  for (StringRef &str : strings)
+    if (failed(reader.parseString(str)))
+      return failure();
+
+  auto parseStringIndices = [&](std::vector<uint64_t> &indices) {
+    uint64_t numIndices;
+    if (failed(reader.parseVarInt(numIndices)))
+      return failure();
+    indices.resize(numIndices);
+    for (uint64_t &index : indices)
+      if (failed(reader.parseIndex(strings.size(), "string", index)))
+        return failure();
+    return success();
+  };
+  if (failed(parseStringIndices(typeStrings)) ||
+      failed(parseStringIndices(attrStrings)))
+    return failure();
+  types.resize(typeStrings.size());
+  attrs.resize(attrStrings.size());
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::parseOps(EncodingReader &reader,
+                                             Block *block,
+                                             ArrayRef<Block *> regionBlocks,
+                                             ValueScope &scope) {
+  uint64_t numOps;
+  if (failed(reader.parseVarInt(numOps)))
+    return failure();
+  for (uint64_t i = 0; i < numOps; ++i)
+    if (failed(parseOp(reader, block, regionBlocks, scope)))
+      return failure();
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::parseOp(EncodingReader &reader,
+                                            Block *block,
+                                            ArrayRef<Block *> regionBlocks,
+                                            ValueScope &scope) {
+  OperationName name("", context);
+  LocationAttr loc;
+  uint8_t mask;
+  if (failed(parseOpName(reader, name)) ||
+      failed(parseAttribute(reader, loc)) || failed(reader.parseByte(mask)))
+    return failure();
+
+  DictionaryAttr attrDict;
+  if (mask & kHasAttrs) {
+    if (failed(parseAttribute(reader, attrDict)))
+      return failure();
+  } else {
+    attrDict = DictionaryAttr::get({}, context);
+  }
+
+  SmallVector<Type, 4> resultTypes;
+  if (mask & kHasResults) {
+    uint64_t numResults;
+    if (failed(reader.parseVarInt(numResults)))
+      return failure();
+    resultTypes.resize(numResults);
+    for (Type &type : resultTypes)
+      if (failed(parseType(reader, type)))
+        return failure();
+  }
+
+  SmallVector<Value, 4> operands;
+  if (mask & kHasOperands) {
+    uint64_t numOperands;
+    if (failed(reader.parseVarInt(numOperands)))
+      return failure();
+    operands.resize(numOperands);
+    for (Value &operand : operands)
+      if (failed(parseOperand(reader, scope, operand)))
+        return failure();
+  }
+
+  SmallVector<Block *, 2> successors;
+  if (mask & kHasSuccessors) {
+    uint64_t numSuccessors;
+    if (failed(reader.parseVarInt(numSuccessors)))
+      return failure();
+    for (uint64_t i = 0; i < numSuccessors; ++i) {
+      uint64_t index;
+      if (failed(reader.parseIndex(regionBlocks.size(), "successor", index)))
+        return failure();
+      successors.push_back(regionBlocks[index]);
+    }
+  }
+
+  uint64_t numRegions = 0;
+  if ((mask & kHasRegions) && failed(reader.parseVarInt(numRegions)))
+    return failure();
+
+  Operation *op = Operation::create(loc, name, resultTypes, operands, attrDict,
+                                    successors, numRegions);
+  block->push_back(op);
+  for (Value result : op->getResults())
+    defineValue(scope, result);
+  if (!numRegions)
+    return success();
+
+  if (!(mask & kHasIsolatedRegions)) {
+    for (Region &region : op->getRegions())
+      if (failed(parseRegion(reader, region, scope)))
+        return failure();
+    return success();
+  }
+
+  ArrayRef<uint8_t> regionData;
+  if (failed(reader.parseSection(regionData)))
+    return failure();
+  if (lazyLoading) {
+    lazyBodies.try_emplace(op, regionData);
+    return success();
+  }
+  return parseIsolatedRegions(regionData, op);
+}
+
+LogicalResult BytecodeReader::Impl::parseRegion(EncodingReader &reader,
+                                                Region &region,
+                                                ValueScope &scope) {
+  uint64_t numBlocks;
+  if (failed(reader.parseVarInt(numBlocks)))
+    return failure();
+
+  // Create the blocks upfront, as operations may branch to later blocks.
+  SmallVector<Block *, 4> blocks;
+  for (uint64_t i = 0; i < numBlocks; ++i) {
+    blocks.push_back(new Block());
+    region.push_back(blocks.back());
+  }
+
+  for (Block *block : blocks) {
+    uint64_t numArgs;
+    if (failed(reader.parseVarInt(numArgs)))
+      return failure();
+    for (uint64_t i = 0; i < numArgs; ++i) {
+      Type type;
+      if (failed(parseType(reader, type)))
+        return failure();
+      defineValue(scope, block->addArgument(type));
+    }
+    if (failed(parseOps(reader, block, blocks, scope)))
+      return failure();
+  }
+  return success();
+}
+
+LogicalResult
+BytecodeReader::Impl::parseIsolatedRegions(ArrayRef<uint8_t> data,
+                                           Operation *op) {
+  EncodingReader reader(data, fileLoc);
+  ValueScope scope;
+  for (Region &region : op->getRegions())
+    if (failed(parseRegion(reader, region, scope)))
+      return failure();
+  if (failed(finalizeScope(reader, scope)))
+    return failure();
+  if (!reader.empty())
+    return reader.emitError("unexpected trailing bytes in region of ")
+           << op->getName();
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::finalizeScope(EncodingReader &reader,
+                                                  ValueScope &scope) {
+  if (scope.forwardRefs.empty())
+    return success();
+  uint64_t id = scope.forwardRefs.begin()->first;
+  return reader.emitError("use of undefined value #") << id;
+}
+
+LogicalResult BytecodeReader::Impl::parseOpName(EncodingReader &reader,
+                                                OperationName &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(strings.size(), "string", index)))
+    return failure();
+  auto it = opNames.find(index);
+  if (it != opNames.end()) {
+    result = it->second;
+    return success();
+  }
+
+  // The names are stored in full, so only the operations of the builtin
+  // dialect have no prefix. Load the dialect as the textual parser does.
+  StringRef name = strings[index];
+  if (name.contains('.')) {
+    StringRef dialectName = name.split('.').first;
+    if (!context->getLoadedDialect(dialectName))
+      context->getOrLoadDialect(dialectName);
+  }
+  result = OperationName(name, context);
+  opNames.try_emplace(index, result);
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::parseType(EncodingReader &reader,
+                                              Type &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(types.size(), "type", index)))
+    return failure();
+  if (!types[index]) {
+    StringRef str = strings[typeStrings[index]];
+    if (!(types[index] = mlir::parseType(str, context)))
+      return reader.emitError("invalid type '") << str << "'";
+  }
+  result = types[index];
+  return success();
+}
+
+LogicalResult BytecodeReader::Impl::parseAttribute(EncodingReader &reader,
+                                                   Attribute &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(attrs.size(), "attribute", index)))
+    return failure();
+  if (!attrs[index]) {
+    StringRef str = strings[attrStrings[index]];
+    if (!(attrs[index] = mlir::parseAttribute(str, context)))
+      return reader.emitError("invalid attribute '") << str << "'";
+  }
+  result = attrs[index];
+  return success();
+}
+
+void BytecodeReader::Impl::defineValue(ValueScope &scope, Value value) {
+  uint64_t id = scope.values.size();
+  scope.values.push_back(value);
+  auto it = scope.forwardRefs.find(id);
+  if (it == scope.forwardRefs.end())
+    return;
+  Operation *placeholder = it->second;
+  placeholder->getResult(0).replaceAllUsesWith(value);
+  placeholder->destroy();
+  scope.forwardRefs.erase(it);
+}
+
+LogicalResult BytecodeReader::Impl::parseOperand(EncodingReader &reader,
+                                                 ValueScope &scope,
+                                                 Value &result) {
+  uint64_t id;
+  if (failed(reader.parseVarInt(id)))
+    return failure();
+  if (id < scope.values.size()) {
+    result = scope.values[id];
+    return success();
+  }
+
+  // Values used before being defined, e.g. in graph regions or by the
+  // successor operands of a back edge, are replaced once defined.
+  Operation *&placeholder = scope.forwardRefs[id];
+  if (!placeholder)
+    placeholder = Operation::create(
+        fileLoc, OperationName("placeholder", context), NoneType::get(context),
+        /*operands=*/{}, /*attributes=*/llvm::None, /*successors=*/{},
+        /*numRegions=*/0);
+  result = placeholder->getResult(0);
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// BytecodeReader
+//===----------------------------------------------------------------------===//
+
+BytecodeReader::BytecodeReader(llvm::MemoryBufferRef buffer,
+                               MLIRContext *context, bool lazyLoading)
+    : impl(std::make_unique<Impl>(buffer, context, lazyLoading)) {}
+
+BytecodeReader::~BytecodeReader() = default;
+
+LogicalResult BytecodeReader::read(Block *block) { return impl->read(block); }
+
+bool BytecodeReader::isMaterializable(Operation *op) const {
+  return impl->isMaterializable(op);
+}
+
+LogicalResult BytecodeReader::materialize(Operation *op) {
+  return impl->materialize(op);
+}
+
+LogicalResult BytecodeReader::materializeAll() {
+  return impl->materializeAll();
+}
+
+LogicalResult mlir::readBytecodeFile(llvm::MemoryBufferRef buffer,
+                                     Block *block, MLIRContext *context,
+                                     LocationAttr *sourceFileLoc) {
+  if (sourceFileLoc)
+    *sourceFileLoc = FileLineColLoc::get(buffer.getBufferIdentifier(),
+                                         /*line=*/0, /*column=*/0, context);
+  return BytecodeReader(buffer, context, /*lazyLoading=*/false).read(block);
+}
@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "Parser.h"
+#include "mlir/Bytecode/BytecodeReader.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Dialect.h"
@@ -2093,6 +2094,10 @@ LogicalResult mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
   if (sourceFileLoc)
     *sourceFileLoc = parserLoc;
 
+  // Buffers in the bytecode format are read by the bytecode reader.
+  if (isBytecode(sourceBuf->getMemBufferRef()))
+    return readBytecodeFile(sourceBuf->getMemBufferRef(), block, context);
+
   SymbolState aliasState;
   ParserState state(sourceMgr, context, aliasState);
   return TopLevelOperationParser(state).parse(block, parserLoc);
@@ -0,0 +1,193 @@
+//===- BufferPacking.cpp - Pack buffers with disjoint lifetimes -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass that packs the statically shaped allocations of
+// a function into one arena per memory space. Buffers whose lifetimes do not
+// overlap share the same bytes of the arena, which bounds the memory a
+// function needs by its peak usage instead of the sum of its buffers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "mlir/Analysis/BufferAliasAnalysis.h"
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace mlir;
+
+namespace {
+/// An allocation to place into an arena. Its lifetime spans the operations of
+/// the entry block from the allocation to the last operation accessing the
+/// buffer or one of its aliases.
+struct PackedBuffer {
+  AllocOp alloc;
+  SmallVector<Operation *, 2> deallocs;
+  uint64_t size;
+  uint64_t alignment;
+  unsigned begin;
+  unsigned end;
+  uint64_t offset = 0;
+
+  bool overlaps(const PackedBuffer &other) const {
+    return begin <= other.end && other.begin <= end;
+  }
+};
+} // end anonymous namespace
+
+/// Returns the size in bytes of the buffers of the given type, or None if the
+/// buffers cannot be placed into an arena.
+static Optional<uint64_t> getArenaSizeInBytes(MemRefType type) {
+  if (!type.hasStaticShape() || !type.getElementType().isIntOrFloat())
+    return llvm::None;
+  // Views into the arena have an identity layout.
+  ArrayRef<AffineMap> maps = type.getAffineMaps();
+  if (maps.size() > 1 || (maps.size() == 1 && !maps.front().isIdentity()))
+    return llvm::None;
+  return type.getNumElements() *
+         llvm::divideCeil(type.getElementTypeBitWidth(), 8);
+}
+
+/// Computes the lifetime of the buffer allocated by `alloc` in `block`, the
+/// entry block of its function, and collects its deallocations. Returns false
+/// if an alias of the buffer is returned or is used outside of `block`.
+static bool computeLifetime(Block &block,
+                            const DenseMap<Operation *, unsigned> &positions,
+                            const BufferAliasAnalysis &aliasAnalysis,
+                            PackedBuffer &buffer) {
+  buffer.begin = buffer.end = positions.lookup(buffer.alloc);
+  for (Value alias : aliasAnalysis.resolve(buffer.alloc)) {
+    for (Operation *user : alias.getUsers()) {
+      if (isa<DeallocOp>(user)) {
+        buffer.deallocs.push_back(user);
+        continue;
+      }
+      Operation *ancestor = block.findAncestorOpInBlock(*user);
+      if (!ancestor || ancestor == block.getTerminator())
+        return false;
+      buffer.end = std::max(buffer.end, positions.lookup(ancestor));
+    }
+  }
+  return true;
+}
+
+/// Assigns offsets to the buffers such that buffers with overlapping lifetimes
+/// occupy disjoint bytes, and returns the size of the arena. The buffers are
+/// placed from largest to smallest at the lowest offset that fits, which
+/// tends to pack the large buffers tightly.
+static uint64_t assignOffsets(MutableArrayRef<PackedBuffer> buffers) {
+  SmallVector<PackedBuffer *, 8> order;
+  for (PackedBuffer &buffer : buffers)
+    order.push_back(&buffer);
+  llvm::stable_sort(order, [](PackedBuffer *lhs, PackedBuffer *rhs) {
+    return lhs->size > rhs->size;
+  });
+
+  uint64_t arenaSize = 0;
+  SmallVector<PackedBuffer *, 8> placed;
+  for (PackedBuffer *buffer : order) {
+    SmallVector<PackedBuffer *, 8> conflicts;
+    for (PackedBuffer *other : placed)
+      if (buffer->overlaps(*other))
+        conflicts.push_back(other);
+    llvm::sort(conflicts, [](PackedBuffer *lhs, PackedBuffer *rhs) {
+      return lhs->offset < rhs->offset;
+    });
+
+    uint64_t offset = 0;
+    for (PackedBuffer *other : conflicts) {
+      if (llvm::alignTo(offset, buffer->alignment) + buffer->size <=
+          other->offset)
+        break;
+      offset = std::max(offset, other->offset + other->size);
+    }
+    buffer->offset = llvm::alignTo(offset, buffer->alignment);
+    arenaSize = std::max(arenaSize, buffer->offset + buffer->size);
+    placed.push_back(buffer);
+  }
+  return arenaSize;
+}
+
+/// Replaces the allocations of the given buffers by views into a new arena
+/// allocated at the beginning of `block` and freed before its terminator.
+static void createArena(Block &block, unsigned memorySpace,
+                        MutableArrayRef<PackedBuffer> buffers) {
+  uint64_t arenaSize = assignOffsets(buffers);
+  uint64_t alignment = 1;
+  for (PackedBuffer &buffer : buffers)
+    alignment = std::max(alignment, buffer.alignment);
+
+  Location loc = block.getParentOp()->getLoc();
+  OpBuilder builder = OpBuilder::atBlockBegin(&block);
+  auto arenaType = MemRefType::get({static_cast<int64_t>(arenaSize)},
+                                   builder.getIntegerType(8), {}, memorySpace);
+  Value arena = builder.create<AllocOp>(
+      loc, arenaType, builder.getI64IntegerAttr(alignment));
+
+  for (PackedBuffer &buffer : buffers) {
+    builder.setInsertionPoint(buffer.alloc);
+    Value byteShift =
+        builder.create<ConstantIndexOp>(buffer.alloc.getLoc(), buffer.offset);
+    Value view = builder.create<ViewOp>(buffer.alloc.getLoc(),
+                                        buffer.alloc.getType(), arena,
+                                        byteShift, ValueRange());
+    buffer.alloc.replaceAllUsesWith(view);
+    buffer.alloc.erase();
+    for (Operation *dealloc : buffer.deallocs)
+      dealloc->erase();
+  }
+
+  builder.setInsertionPoint(block.getTerminator());
+  builder.create<DeallocOp>(loc, arena);
+}
+
+namespace {
+struct BufferPackingPass : BufferPackingBase<BufferPackingPass> {
+  BufferPackingPass(unsigned alignment) { this->alignment = alignment; }
+
+  void runOnFunction() override {
+    FuncOp func = getFunction();
+    // Lifetimes are computed on the order of the operations, which requires a
+    // single block.
+    if (func.isExternal() || !llvm::hasSingleElement(func.getBody()))
+      return;
+    Block &block = func.getBody().front();
+
+    DenseMap<Operation *, unsigned> positions;
+    for (auto en : llvm::enumerate(block.getOperations()))
+      positions[&en.value()] = en.index();
+
+    BufferAliasAnalysis aliasAnalysis(func);
+    llvm::MapVector<unsigned, SmallVector<PackedBuffer, 8>> arenas;
+    for (AllocOp alloc : block.getOps<AllocOp>()) {
+      Optional<uint64_t> size = getArenaSizeInBytes(alloc.getType());
+      if (!size)
+        continue;
+      PackedBuffer buffer;
+      buffer.alloc = alloc;
+      buffer.size = *size;
+      buffer.alignment = std::max<uint64_t>(
+          alloc.alignment().getValueOr(1), this->alignment);
+      if (computeLifetime(block, positions, aliasAnalysis, buffer))
+        arenas[alloc.getType().getMemorySpace()].push_back(buffer);
+    }
+
+    // Packing a single buffer would only add a view.
+    for (auto &arena : arenas)
+      if (arena.second.size() > 1)
+        createArena(block, arena.first, arena.second);
+  }
+};
+} // end anonymous namespace
+
+std::unique_ptr<Pass> mlir::createBufferPackingPass(unsigned alignment) {
+  return std::make_unique<BufferPackingPass>(alignment);
+}
@@ -15,6 +15,7 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
 
@@ -30,7 +31,19 @@ struct Canonicalizer : public CanonicalizerBase<Canonicalizer> {
     patterns = std::move(owningPatterns);
   }
   void runOnOperation() override {
-    applyPatternsAndFoldGreedily(getOperation()->getRegions(), patterns);
+    GreedyRewriteStatistics statistics;
+    GreedyRewriteConfig config;
+    config.parallel = parallel;
+    if (printPatternStatistics)
+      config.statistics = &statistics;
+    applyPatternsAndFoldGreedily(getOperation()->getRegions(), patterns,
+                                 config);
+
+    if (printPatternStatistics) {
+      llvm::errs() << "canonicalize @ '" << getOperation()->getName()
+                   << "': ";
+      statistics.print(llvm::errs());
+    }
   }
 
   FrozenRewritePatternList patterns;
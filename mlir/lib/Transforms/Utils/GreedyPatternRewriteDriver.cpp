@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Rewrite/PatternApplicator.h"
 #include "mlir/Transforms/FoldUtils.h"
@@ -18,8 +19,12 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <atomic>
+
 using namespace mlir;
 
 #define DEBUG_TYPE "pattern-matcher"
@@ -27,6 +32,46 @@ using namespace mlir;
 /// The max number of iterations scanning for pattern match.
 static unsigned maxPatternMatchIterations = 10;
 
+//===----------------------------------------------------------------------===//
+// GreedyRewriteStatistics
+//===----------------------------------------------------------------------===//
+
+void GreedyRewriteStatistics::merge(const GreedyRewriteStatistics &other) {
+  for (auto &it : other.patterns) {
+    PatternStatistics &stats = patterns[it.first];
+    stats.numMatchAttempts += it.second.numMatchAttempts;
+    stats.numRewrites += it.second.numRewrites;
+    stats.time += it.second.time;
+  }
+  numFolds += other.numFolds;
+  numErasedDeadOps += other.numErasedDeadOps;
+}
+
+void GreedyRewriteStatistics::print(raw_ostream &os) const {
+  using Entry = std::pair<const Pattern *, PatternStatistics>;
+  SmallVector<const Entry *, 16> sorted;
+  for (const Entry &entry : patterns)
+    sorted.push_back(&entry);
+  llvm::stable_sort(sorted, [](const Entry *lhs, const Entry *rhs) {
+    return lhs->second.time > rhs->second.time;
+  });
+
+  os << "folds: " << numFolds << ", dead operations erased: "
+     << numErasedDeadOps << "\n";
+  for (const Entry *entry : sorted) {
+    const Pattern &pattern = *entry->first;
+    const PatternStatistics &stats = entry->second;
+    double seconds = std::chrono::duration<double>(stats.time).count();
+    os << llvm::format("%10.4f s %10u rewrites %10u attempts  ", seconds,
+                       stats.numRewrites, stats.numMatchAttempts);
+    if (Optional<OperationName> rootKind = pattern.getRootKind())
+      os << rootKind->getStringRef();
+    else
+      os << "<any>";
+    os << " (benefit " << pattern.getBenefit().getBenefit() << ")\n";
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // GreedyPatternRewriteDriver
 //===----------------------------------------------------------------------===//
@@ -37,8 +82,10 @@ namespace {
 class GreedyPatternRewriteDriver : public PatternRewriter {
 public:
   explicit GreedyPatternRewriteDriver(MLIRContext *ctx,
-                                      const FrozenRewritePatternList &patterns)
-      : PatternRewriter(ctx), matcher(patterns), folder(ctx) {
+                                      const FrozenRewritePatternList &patterns,
+                                      GreedyRewriteStatistics *statistics)
+      : PatternRewriter(ctx), matcher(patterns), folder(ctx),
+        statistics(statistics) {
     worklist.reserve(64);
 
     // Apply a simple cost model based solely on pattern benefit.
@@ -133,6 +180,9 @@ private:
 
   /// Non-pattern based folder for operations.
   OperationFolder folder;
+
+  /// If non-null, the counters of the rewrite are added to this.
+  GreedyRewriteStatistics *statistics;
 };
 } // end anonymous namespace
 
@@ -167,6 +217,8 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions,
         notifyOperationRemoved(op);
         op->erase();
         changed = true;
+        if (statistics)
+          ++statistics->numErasedDeadOps;
         continue;
       }
 
@@ -191,13 +243,36 @@ bool GreedyPatternRewriteDriver::simplify(MutableArrayRef<Region> regions,
       if ((succeeded(folder.tryToFold(op, collectOps, preReplaceAction,
                                       &inPlaceUpdate)))) {
         changed = true;
+        if (statistics)
+          ++statistics->numFolds;
         if (!inPlaceUpdate)
           continue;
       }
 
       // Try to match one of the patterns. The rewriter is automatically
       // notified of any necessary changes, so there is nothing else to do here.
-      changed |= succeeded(matcher.matchAndRewrite(op, *this));
+      if (!statistics) {
+        changed |= succeeded(matcher.matchAndRewrite(op, *this));
+        continue;
+      }
+      std::chrono::steady_clock::time_point start;
+      auto canApply = [&](const Pattern &) {
+        start = std::chrono::steady_clock::now();
+        return true;
+      };
+      auto recordAttempt = [&](const Pattern &pattern) {
+        auto &stats = statistics->patterns[&pattern];
+        ++stats.numMatchAttempts;
+        stats.time += std::chrono::steady_clock::now() - start;
+        return &stats;
+      };
+      auto onFailure = [&](const Pattern &pattern) { recordAttempt(pattern); };
+      auto onSuccess = [&](const Pattern &pattern) {
+        ++recordAttempt(pattern)->numRewrites;
+        return success();
+      };
+      changed |= succeeded(
+          matcher.matchAndRewrite(op, *this, canApply, onFailure, onSuccess));
     }
 
     // After applying patterns, make sure that the CFG of each of the regions is
@@ -240,6 +315,65 @@ LogicalResult
 mlir::applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
                                    const FrozenRewritePatternList &patterns,
                                    unsigned maxIterations) {
+  GreedyRewriteConfig config;
+  config.maxIterations = maxIterations;
+  return applyPatternsAndFoldGreedily(regions, patterns, config);
+}
+LogicalResult
+mlir::applyPatternsAndFoldGreedily(Operation *op,
+                                   const FrozenRewritePatternList &patterns,
+                                   const GreedyRewriteConfig &config) {
+  return applyPatternsAndFoldGreedily(op->getRegions(), patterns, config);
+}
+
+/// Collects the outermost IsolatedFromAbove operations nested in `region`.
+static void collectIsolatedOps(Region &region,
+                               SmallVectorImpl<Operation *> &isolatedOps) {
+  for (Block &block : region) {
+    for (Operation &op : block) {
+      if (op.getNumRegions() == 0)
+        continue;
+      if (op.isKnownIsolatedFromAbove()) {
+        isolatedOps.push_back(&op);
+        continue;
+      }
+      for (Region &nested : op.getRegions())
+        collectIsolatedOps(nested, isolatedOps);
+    }
+  }
+}
+
+/// Simplifies the regions of `isolatedOps` concurrently. Returns true if all
+/// of them converged.
+static bool simplifyConcurrently(ArrayRef<Operation *> isolatedOps,
+                                 const FrozenRewritePatternList &patterns,
+                                 const GreedyRewriteConfig &config) {
+  MLIRContext *context = isolatedOps.front()->getContext();
+
+  // Each operation gets its own counters, which are merged in the order of the
+  // operations afterwards so that the result does not depend on scheduling.
+  std::vector<GreedyRewriteStatistics> statistics(
+      config.statistics ? isolatedOps.size() : 0);
+  std::atomic<bool> allConverged(true);
+  ParallelDiagnosticHandler diagHandler(context);
+  llvm::parallelForEachN(0, isolatedOps.size(), [&](size_t i) {
+    diagHandler.setOrderIDForThread(i);
+    GreedyPatternRewriteDriver driver(
+        context, patterns, config.statistics ? &statistics[i] : nullptr);
+    if (!driver.simplify(isolatedOps[i]->getRegions(), config.maxIterations))
+      allConverged = false;
+    diagHandler.eraseOrderIDForThread();
+  });
+
+  for (const GreedyRewriteStatistics &opStatistics : statistics)
+    config.statistics->merge(opStatistics);
+  return allConverged;
+}
+
+LogicalResult
+mlir::applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
+                                   const FrozenRewritePatternList &patterns,
+                                   const GreedyRewriteConfig &config) {
   if (regions.empty())
     return success();
 
@@ -253,12 +387,25 @@ mlir::applyPatternsAndFoldGreedily(MutableArrayRef<Region> regions,
   assert(llvm::all_of(regions, regionIsIsolated) &&
          "patterns can only be applied to operations IsolatedFromAbove");
 
+  // Simplify the nested isolated regions first, they do not depend on each
+  // other. The enclosing regions are simplified afterwards, where the nested
+  // isolated regions have already reached a fixed point.
+  MLIRContext *context = regions[0].getContext();
+  bool converged = true;
+  if (config.parallel && context->isMultithreadingEnabled()) {
+    SmallVector<Operation *, 8> isolatedOps;
+    for (Region &region : regions)
+      collectIsolatedOps(region, isolatedOps);
+    if (isolatedOps.size() > 1)
+      converged = simplifyConcurrently(isolatedOps, patterns, config);
+  }
+
   // Start the pattern driver.
-  GreedyPatternRewriteDriver driver(regions[0].getContext(), patterns);
-  bool converged = driver.simplify(regions, maxIterations);
+  GreedyPatternRewriteDriver driver(context, patterns, config.statistics);
+  converged &= driver.simplify(regions, config.maxIterations);
   LLVM_DEBUG(if (!converged) {
     llvm::dbgs() << "The pattern rewrite doesn't converge after scanning "
-                 << maxIterations << " times\n";
+                 << config.maxIterations << " times\n";
   });
   return success(converged);
 }
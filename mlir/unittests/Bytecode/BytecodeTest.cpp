@@ -0,0 +1,122 @@
+//===- BytecodeTest.cpp - MLIR bytecode unit tests ------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/BytecodeReader.h"
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+// ^bb1 uses a value defined later in ^bb2, which the reader has to resolve.
+static const char *const kIR = R"mlir(
+module {
+  func @f(%arg0: i32) -> i32 attributes {test.attr = [1, 2]} {
+    %0 = "test.op"(%arg0) {value = 3 : i64} : (i32) -> i32
+    "test.br"()[^bb2] : () -> ()
+  ^bb1:
+    "test.return"(%1) : (i32) -> ()
+  ^bb2:
+    %1 = "test.region"() ({
+      "test.yield"(%0) : (i32) -> ()
+    }) : () -> i32 loc("file.mlir":3:4)
+    "test.br"()[^bb1] : () -> ()
+  }
+  func @g(tensor<?xf32>)
+}
+)mlir";
+
+static std::string print(Operation *op) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  op->print(os, OpPrintingFlags().enableDebugInfo());
+  return os.str();
+}
+
+static std::string writeBytecode(Operation *op) {
+  std::string str;
+  llvm::raw_string_ostream os(str);
+  writeBytecodeToFile(op, os);
+  return os.str();
+}
+
+namespace {
+TEST(BytecodeTest, RoundTrip) {
+  MLIRContext context;
+  context.allowUnregisteredDialects();
+  OwningModuleRef module = parseSourceString(kIR, &context);
+  ASSERT_TRUE(module);
+
+  std::string bytecode = writeBytecode(*module);
+  auto buffer = llvm::MemoryBuffer::getMemBuffer(
+      bytecode, "bytecode", /*RequiresNullTerminator=*/false);
+  ASSERT_TRUE(isBytecode(buffer->getMemBufferRef()));
+
+  Block block;
+  ASSERT_TRUE(succeeded(
+      readBytecodeFile(buffer->getMemBufferRef(), &block, &context)));
+  ASSERT_EQ(block.getOperations().size(), 1u);
+  EXPECT_EQ(print(&block.front()), print(*module));
+}
+
+TEST(BytecodeTest, LazyLoading) {
+  MLIRContext context;
+  context.allowUnregisteredDialects();
+  OwningModuleRef module = parseSourceString(kIR, &context);
+  ASSERT_TRUE(module);
+
+  std::string bytecode = writeBytecode(*module);
+  auto buffer = llvm::MemoryBuffer::getMemBuffer(
+      bytecode, "bytecode", /*RequiresNullTerminator=*/false);
+  BytecodeReader reader(buffer->getMemBufferRef(), &context,
+                        /*lazyLoading=*/true);
+  Block block;
+  ASSERT_TRUE(succeeded(reader.read(&block)));
+
+  // Only the current isolated region is read on each materialization.
+  Operation *readModule = &block.front();
+  EXPECT_TRUE(reader.isMaterializable(readModule));
+  EXPECT_TRUE(readModule->getRegion(0).empty());
+  ASSERT_TRUE(succeeded(reader.materialize(readModule)));
+  EXPECT_FALSE(reader.isMaterializable(readModule));
+  Operation *readFunc = &readModule->getRegion(0).front().front();
+  EXPECT_TRUE(reader.isMaterializable(readFunc));
+  EXPECT_TRUE(readFunc->getRegion(0).empty());
+
+  ASSERT_TRUE(succeeded(reader.materializeAll()));
+  EXPECT_FALSE(reader.isMaterializable(readFunc));
+  EXPECT_EQ(print(readModule), print(*module));
+}
+
+TEST(BytecodeTest, Truncated) {
+  MLIRContext context;
+  context.allowUnregisteredDialects();
+  OwningModuleRef module = parseSourceString(kIR, &context);
+  ASSERT_TRUE(module);
+
+  std::string bytecode = writeBytecode(*module);
+  bytecode.resize(bytecode.size() / 2);
+  auto buffer = llvm::MemoryBuffer::getMemBuffer(
+      bytecode, "bytecode", /*RequiresNullTerminator=*/false);
+
+  unsigned numErrors = 0;
+  ScopedDiagnosticHandler handler(&context, [&](Diagnostic &) {
+    ++numErrors;
+    return success();
+  });
+  Block block;
+  EXPECT_TRUE(
+      failed(readBytecodeFile(buffer->getMemBufferRef(), &block, &context)));
+  EXPECT_TRUE(block.empty());
+  EXPECT_NE(numErrors, 0u);
+}
+} // end namespace
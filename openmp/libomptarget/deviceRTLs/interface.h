@@ -25,6 +25,9 @@
 #ifdef __CUDACC__
 #include "nvptx/src/nvptx_interface.h"
 #endif
+#ifdef __PULP__
+#include "pulp/src/pulp_interface.h"
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 // OpenMP interface
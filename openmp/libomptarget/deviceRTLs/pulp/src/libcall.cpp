@@ -0,0 +1,104 @@
+//===--- libcall.cpp - PULP OpenMP user calls --------------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the OpenMP runtime functions that can be
+// invoked by the user in an OpenMP region
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+EXTERN double omp_get_wtick(void) { return __kmpc_impl_get_wtick(); }
+
+EXTERN double omp_get_wtime(void) { return __kmpc_impl_get_wtime(); }
+
+EXTERN void omp_set_num_threads(int num) {
+  GetThreadDescr().NThreadsVar = num > 0 ? num : 0;
+}
+
+EXTERN int omp_get_num_threads(void) { return GetNumberOfOmpThreads(); }
+
+EXTERN int omp_get_max_threads(void) {
+  const omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  if (Thread.Level > 0)
+    return 1;
+  int NumCores = GetNumberOfCores();
+  if (Thread.NThreadsVar && (int)Thread.NThreadsVar < NumCores)
+    return Thread.NThreadsVar;
+  return NumCores;
+}
+
+EXTERN int omp_get_thread_limit(void) { return GetNumberOfCores(); }
+
+EXTERN int omp_get_thread_num(void) { return GetOmpThreadId(); }
+
+EXTERN int omp_get_num_procs(void) { return GetNumberOfCores(); }
+
+EXTERN int omp_in_parallel(void) { return GetThreadDescr().InActiveParallel; }
+
+EXTERN int omp_in_final(void) { return 0; }
+
+EXTERN void omp_set_dynamic(int) {}
+
+EXTERN int omp_get_dynamic(void) { return 0; }
+
+EXTERN void omp_set_nested(int) {}
+
+EXTERN int omp_get_nested(void) { return 0; }
+
+EXTERN void omp_set_max_active_levels(int) {}
+
+EXTERN int omp_get_max_active_levels(void) { return 1; }
+
+EXTERN int omp_get_level(void) { return GetThreadDescr().Level; }
+
+EXTERN int omp_get_active_level(void) {
+  return GetThreadDescr().InActiveParallel;
+}
+
+EXTERN int omp_get_ancestor_thread_num(int level) {
+  const omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  if (level < 0 || level > Thread.Level)
+    return -1;
+  if (level == 1 && Thread.InActiveParallel)
+    return GetCoreId();
+  return 0;
+}
+
+EXTERN int omp_get_team_size(int level) {
+  const omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  if (level < 0 || level > Thread.Level)
+    return -1;
+  if (level == 1 && Thread.InActiveParallel)
+    return omptarget_pulp_Team.NumThreads;
+  return 1;
+}
+
+EXTERN int omp_get_num_teams(void) { return 1; }
+
+EXTERN int omp_get_team_num(void) { return 0; }
+
+EXTERN int omp_is_initial_device(void) { return 0; }
+
+////////////////////////////////////////////////////////////////////////////////
+// locks
+////////////////////////////////////////////////////////////////////////////////
+
+EXTERN void omp_init_lock(omp_lock_t *lock) { __kmpc_impl_init_lock(lock); }
+
+EXTERN void omp_destroy_lock(omp_lock_t *lock) {
+  __kmpc_impl_destroy_lock(lock);
+}
+
+EXTERN void omp_set_lock(omp_lock_t *lock) { __kmpc_impl_set_lock(lock); }
+
+EXTERN void omp_unset_lock(omp_lock_t *lock) { __kmpc_impl_unset_lock(lock); }
+
+EXTERN int omp_test_lock(omp_lock_t *lock) {
+  return __kmpc_impl_test_lock(lock);
+}
@@ -0,0 +1,52 @@
+//===--- log.cpp - PULP device stdout ----------------------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Producer side of the log rings drained by the host plugin. Every core only
+// writes the head of its own ring and the host only writes the tail, so
+// neither side takes a lock. Both offsets stay below LOG_RING_SIZE, one byte
+// of the ring is left free so that a full ring differs from an empty one.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+INLINE volatile uint32_t *__kmpc_impl_log_ring() {
+  return (volatile uint32_t *)(uintptr_t)(PULP_L3_ADDR +
+                                          LOG_BUF_SIZE *
+                                              __builtin_pulp_ClusterId() +
+                                          LOG_CORE_SIZE * GetCoreId());
+}
+
+EXTERN void __kmpc_pulp_log_write(const char *Buf, uint32_t Size) {
+  volatile uint32_t *Ring = __kmpc_impl_log_ring();
+  if (Ring[LOG_ENABLE] != LOG_MAGIC)
+    return;
+  volatile char *Data = (volatile char *)Ring + LOG_HEADER_SIZE;
+  uint32_t Head = Ring[LOG_HEAD];
+  for (uint32_t I = 0; I < Size; ++I) {
+    uint32_t Next = Head + 1 == LOG_RING_SIZE ? 0 : Head + 1;
+    if (Next == Ring[LOG_TAIL]) {
+      // Publish the bytes written so far and wait for the host to read them.
+      __sync_synchronize();
+      Ring[LOG_HEAD] = Head;
+      while (Next == Ring[LOG_TAIL]) {
+      }
+    }
+    Data[Head] = Buf[I];
+    Head = Next;
+  }
+  // The bytes must be visible to the host before the head that covers them.
+  __sync_synchronize();
+  Ring[LOG_HEAD] = Head;
+}
+
+EXTERN int __kmpc_pulp_log_putchar(int C) {
+  char Byte = (char)C;
+  __kmpc_pulp_log_write(&Byte, 1);
+  return (unsigned char)Byte;
+}
@@ -0,0 +1,105 @@
+//===--- loop.cpp - PULP OpenMP loop worksharing ------------------ C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Static loop schedules. The iterations of a core only depend on its id in
+// the team, so they are computed without any communication.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+namespace {
+
+// T is the type of the induction variable, UT its unsigned counterpart, and
+// ST the signed type of the increment and chunk size.
+template <typename T, typename UT, typename ST>
+INLINE void forStaticInit(int32_t Schedule, int32_t *PLast, T *PLower,
+                          T *PUpper, ST *PStride, ST Incr, ST Chunk) {
+  T Lower = *PLower;
+  T Upper = *PUpper;
+  // Distribute schedules split the iterations among the teams, of which
+  // there is a single one per cluster.
+  bool IsDistribute = Schedule >= kmp_sched_distribute_first &&
+                      Schedule <= kmp_sched_distribute_last;
+  UT Id = IsDistribute ? 0 : GetOmpThreadId();
+  UT NumThreads = IsDistribute ? 1 : GetNumberOfOmpThreads();
+
+  // Number of iterations, the bounds are inclusive.
+  UT TripCount = Incr > 0 ? (UT)(Upper - Lower) / (UT)Incr + 1
+                          : (UT)(Lower - Upper) / (UT)-Incr + 1;
+
+  switch (SCHEDULE_WITHOUT_MODIFIERS(Schedule)) {
+  case kmp_sched_static_balanced_chunk:
+    // Chunks are rounded up so that every core gets at most one of them.
+    if (Chunk > 0) {
+      UT PerThread = (TripCount + NumThreads - 1) / NumThreads;
+      Chunk = (ST)((PerThread + Chunk - 1) / Chunk * Chunk);
+    }
+    [[clang::fallthrough]];
+  case kmp_sched_static_chunk:
+  case kmp_sched_static_ordered:
+  case kmp_sched_distr_static_chunk:
+    if (Chunk > 0) {
+      *PLower = Lower + (T)(Id * Chunk * Incr);
+      *PUpper = *PLower + (T)(Chunk * Incr) - (T)Incr;
+      *PStride = (ST)(NumThreads * Chunk * Incr);
+      *PLast = (TripCount - 1) / Chunk % NumThreads == Id;
+      return;
+    }
+    break;
+  default:
+    break;
+  }
+
+  // Balanced blocks of contiguous iterations, the first cores get one more
+  // iteration than the others if the iterations do not divide evenly.
+  UT Small = TripCount / NumThreads;
+  UT Extras = TripCount % NumThreads;
+  UT Begin = Id * Small + (Id < Extras ? Id : Extras);
+  UT Size = Small + (Id < Extras ? 1 : 0);
+  *PLower = Lower + (T)(Begin * Incr);
+  *PUpper = *PLower + (T)(Size * Incr) - (T)Incr;
+  *PStride = (ST)(TripCount * Incr);
+  *PLast = Size > 0 && Begin + Size == TripCount;
+}
+
+} // namespace
+
+EXTERN void __kmpc_for_static_init_4(kmp_Ident *, int32_t, int32_t Schedule,
+                                     int32_t *PLast, int32_t *PLower,
+                                     int32_t *PUpper, int32_t *PStride,
+                                     int32_t Incr, int32_t Chunk) {
+  forStaticInit<int32_t, uint32_t, int32_t>(Schedule, PLast, PLower, PUpper,
+                                            PStride, Incr, Chunk);
+}
+
+EXTERN void __kmpc_for_static_init_4u(kmp_Ident *, int32_t, int32_t Schedule,
+                                      int32_t *PLast, uint32_t *PLower,
+                                      uint32_t *PUpper, int32_t *PStride,
+                                      int32_t Incr, int32_t Chunk) {
+  forStaticInit<uint32_t, uint32_t, int32_t>(Schedule, PLast, PLower, PUpper,
+                                             PStride, Incr, Chunk);
+}
+
+EXTERN void __kmpc_for_static_init_8(kmp_Ident *, int32_t, int32_t Schedule,
+                                     int32_t *PLast, int64_t *PLower,
+                                     int64_t *PUpper, int64_t *PStride,
+                                     int64_t Incr, int64_t Chunk) {
+  forStaticInit<int64_t, uint64_t, int64_t>(Schedule, PLast, PLower, PUpper,
+                                            PStride, Incr, Chunk);
+}
+
+EXTERN void __kmpc_for_static_init_8u(kmp_Ident *, int32_t, int32_t Schedule,
+                                      int32_t *PLast, uint64_t *PLower,
+                                      uint64_t *PUpper, int64_t *PStride,
+                                      int64_t Incr, int64_t Chunk) {
+  forStaticInit<uint64_t, uint64_t, int64_t>(Schedule, PLast, PLower, PUpper,
+                                             PStride, Incr, Chunk);
+}
+
+EXTERN void __kmpc_for_static_fini(kmp_Ident *, int32_t) {}
@@ -0,0 +1,183 @@
+//===--- parallel.cpp - PULP OpenMP parallel regions (fork/join) -- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Fork and join of parallel regions on a PULP cluster.
+//
+// Cores that are not running a parallel region sleep at the cluster barrier.
+// To fork, the master core publishes the outlined function in the TCDM and
+// arrives at the cluster barrier, which wakes up the whole cluster at once.
+// The join is a second round of the cluster barrier, after which the
+// workers are waiting for the next region again. Cores beyond the team size
+// only take part in the two barriers. Nested parallel regions are
+// serialized.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+#include <stdarg.h>
+
+static void invokeMicrotask(kmpc_micro Fn, int32_t Gtid, int32_t Tid,
+                            int32_t NumArgs, void **Args) {
+  switch (NumArgs) {
+  case 0:
+    Fn(&Gtid, &Tid);
+    break;
+  case 1:
+    Fn(&Gtid, &Tid, Args[0]);
+    break;
+  case 2:
+    Fn(&Gtid, &Tid, Args[0], Args[1]);
+    break;
+  case 3:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2]);
+    break;
+  case 4:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3]);
+    break;
+  case 5:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4]);
+    break;
+  case 6:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5]);
+    break;
+  case 7:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6]);
+    break;
+  case 8:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7]);
+    break;
+  case 9:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8]);
+    break;
+  case 10:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9]);
+    break;
+  case 11:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9], Args[10]);
+    break;
+  case 12:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9], Args[10], Args[11]);
+    break;
+  case 13:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9], Args[10], Args[11], Args[12]);
+    break;
+  case 14:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9], Args[10], Args[11], Args[12],
+       Args[13]);
+    break;
+  case 15:
+    Fn(&Gtid, &Tid, Args[0], Args[1], Args[2], Args[3], Args[4], Args[5],
+       Args[6], Args[7], Args[8], Args[9], Args[10], Args[11], Args[12],
+       Args[13], Args[14]);
+    break;
+  default:
+    __builtin_trap();
+  }
+}
+
+// Runs the published parallel region on the calling core if it is part of
+// the team, then joins.
+static void runTeamMember() {
+  int CoreId = GetCoreId();
+  omptarget_pulp_TeamDescr &Team = omptarget_pulp_Team;
+  if ((uint32_t)CoreId < Team.NumThreads) {
+    omptarget_pulp_ThreadDescr &Thread = omptarget_pulp_Threads[CoreId];
+    Thread.Level = 1;
+    Thread.InActiveParallel = 1;
+    invokeMicrotask(Team.Fn, CoreId, CoreId, Team.NumArgs, Team.Args);
+    Thread.Level = 0;
+    Thread.InActiveParallel = 0;
+  }
+  __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+}
+
+EXTERN void __kmpc_pulp_worker_loop() {
+  __kmpc_impl_enable_barrier_event();
+  __kmpc_impl_perf_start();
+  for (;;) {
+    __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+    if (!omptarget_pulp_Team.Running) {
+      __kmpc_impl_perf_store();
+      __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+      return;
+    }
+    runTeamMember();
+  }
+}
+
+EXTERN int32_t __kmpc_global_thread_num(kmp_Ident *) { return GetCoreId(); }
+
+EXTERN void __kmpc_push_num_threads(kmp_Ident *, int32_t, int32_t NumThreads) {
+  GetThreadDescr().NextNumThreads = NumThreads;
+}
+
+EXTERN void __kmpc_push_proc_bind(kmp_Ident *, uint32_t, int) {}
+
+EXTERN void __kmpc_fork_call(kmp_Ident *, int32_t NumArgs, kmpc_micro Fn,
+                             ...) {
+  if (NumArgs > MAX_SHARED_ARGS)
+    __builtin_trap();
+  void *Args[MAX_SHARED_ARGS];
+  va_list Ap;
+  va_start(Ap, Fn);
+  for (int32_t I = 0; I < NumArgs; ++I)
+    Args[I] = va_arg(Ap, void *);
+  va_end(Ap);
+
+  int CoreId = GetCoreId();
+  omptarget_pulp_ThreadDescr &Thread = omptarget_pulp_Threads[CoreId];
+  uint32_t NumThreads = GetNumberOfCores();
+  uint32_t Requested =
+      Thread.NextNumThreads ? Thread.NextNumThreads : Thread.NThreadsVar;
+  if (Requested && Requested < NumThreads)
+    NumThreads = Requested;
+  Thread.NextNumThreads = 0;
+
+  // Only the master core of the cluster can start an active region, the
+  // others are bound to a team already.
+  if (CoreId != 0 || Thread.Level > 0 || NumThreads == 1) {
+    ++Thread.Level;
+    invokeMicrotask(Fn, CoreId, 0, NumArgs, Args);
+    --Thread.Level;
+    return;
+  }
+
+  omptarget_pulp_TeamDescr &Team = omptarget_pulp_Team;
+  Team.Fn = Fn;
+  Team.Args = Args;
+  Team.NumArgs = NumArgs;
+  if (NumThreads != Team.NumThreads) {
+    // Nobody uses the team barrier while the workers wait for work.
+    __kmpc_impl_setup_barrier(PULP_TEAM_BARRIER,
+                              __kmpc_impl_core_mask(NumThreads));
+    Team.NumThreads = NumThreads;
+  }
+  __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+  runTeamMember();
+}
+
+EXTERN void __kmpc_serialized_parallel(kmp_Ident *, uint32_t) {
+  ++GetThreadDescr().Level;
+}
+
+EXTERN void __kmpc_end_serialized_parallel(kmp_Ident *, uint32_t) {
+  --GetThreadDescr().Level;
+}
+
+EXTERN uint16_t __kmpc_parallel_level(kmp_Ident *, uint32_t) {
+  return GetThreadDescr().Level;
+}
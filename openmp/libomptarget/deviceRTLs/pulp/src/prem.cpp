@@ -0,0 +1,73 @@
+//===--- prem.cpp - PULP predictable execution phases ------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// DMA transfers and memory phases of the tiles of PREM kernels.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+INLINE volatile uint32_t *__kmpc_impl_dma_reg(uint32_t Offset) {
+  return (volatile uint32_t *)(uintptr_t)(PULP_DMA_DEMUX_ADDR + Offset);
+}
+
+// Enqueues a transfer on the DMA of the calling core. Pushing a command
+// allocates a transfer counter, which is set in the status register until
+// the transfer completed.
+INLINE void __kmpc_impl_dma_transfer(uint32_t Local, uint32_t Ext,
+                                     uint32_t Size, uint32_t Cmd) {
+  omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  while (Size) {
+    uint32_t Len = Size < DMA_MAX_TRANSFER ? Size : DMA_MAX_TRANSFER;
+    uint32_t Id = *__kmpc_impl_dma_reg(DMA_CMD);
+    *__kmpc_impl_dma_reg(DMA_CMD) = Len | Cmd | DMA_CMD_INC;
+    *__kmpc_impl_dma_reg(DMA_CMD) = Local;
+    *__kmpc_impl_dma_reg(DMA_CMD) = Ext;
+    Thread.DMAJobs |= 1u << Id;
+    Local += Len;
+    Ext += Len;
+    Size -= Len;
+  }
+}
+
+EXTERN void __kmpc_pulp_prem_dma_in(void *Local, const void *Global,
+                                    uint32_t Size) {
+  __kmpc_impl_dma_transfer((uint32_t)(uintptr_t)Local,
+                           (uint32_t)(uintptr_t)Global, Size, DMA_CMD_EXT2LOC);
+}
+
+EXTERN void __kmpc_pulp_prem_dma_out(void *Global, const void *Local,
+                                     uint32_t Size) {
+  // The DMA reads the buffer, the stores of the compute phase must be done.
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  __kmpc_impl_dma_transfer((uint32_t)(uintptr_t)Local,
+                           (uint32_t)(uintptr_t)Global, Size, 0);
+}
+
+EXTERN void __kmpc_pulp_prem_dma_wait() {
+  omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  uint32_t Jobs = Thread.DMAJobs;
+  uint32_t Start = (uint32_t)__builtin_readcyclecounter();
+  while (*__kmpc_impl_dma_reg(DMA_STATUS) & Jobs) {
+  }
+  Thread.DMAWaitCycles += (uint32_t)__builtin_readcyclecounter() - Start;
+  // Release the counters of the completed transfers.
+  *__kmpc_impl_dma_reg(DMA_STATUS) = Jobs;
+  Thread.DMAJobs = 0;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+// Without a PREM runtime the memory phases are not arbitrated with the host,
+// they only keep the compiler from moving accesses across them.
+EXTERN __attribute__((weak)) void __kmpc_pulp_prem_memory_phase_begin() {
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+EXTERN __attribute__((weak)) void __kmpc_pulp_prem_memory_phase_end() {
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,82 @@
+//===--- profile.cpp - PULP launch profiles ----------------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Performance counters of a kernel, which the host plugin reads after the
+// cluster reported its completion. Every core runs its counters from the
+// start of the kernel and stores its own into the profile of its cluster at
+// the end, the master core adds the counters of the cluster last.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+// Performance counter CSRs of the RI5CY cores. Writing the last counter
+// writes all of them.
+enum : uint32_t {
+  PCCR_CYCLES = 0x780,
+  PCCR_INSTR = 0x781,
+  PCCR_IMISS = 0x784,
+  PCCR_TCDM_CONT = 0x78f,
+  PCCR_ALL = 0x79f,
+  PCER = 0x7e0,
+  PCMR = 0x7e1,
+};
+
+enum : uint32_t {
+  // Event I is counted by counter PCCR_CYCLES + I.
+  PCER_EVENTS = 1u << 0 | 1u << 1 | 1u << 4 | 1u << 15,
+  PCMR_ENABLE = 1u << 0,
+};
+
+#define READ_CSR(Csr)                                                          \
+  ({                                                                           \
+    uint32_t Value;                                                            \
+    asm volatile("csrr %0, %1" : "=r"(Value) : "i"(Csr));                      \
+    Value;                                                                     \
+  })
+#define WRITE_CSR(Csr, Value)                                                  \
+  asm volatile("csrw %0, %1" ::"i"(Csr), "r"((uint32_t)(Value)))
+
+INLINE volatile omptarget_pulp_PerfRecord *__kmpc_impl_perf_record() {
+  return (volatile omptarget_pulp_PerfRecord *)(uintptr_t)(
+             PULP_L3_ADDR + LOG_BUF_SIZE * PULP_NB_CLUSTERS) +
+         __builtin_pulp_ClusterId();
+}
+
+DEVICE void __kmpc_impl_perf_start() {
+  WRITE_CSR(PCMR, 0);
+  WRITE_CSR(PCCR_ALL, 0);
+  WRITE_CSR(PCER, PCER_EVENTS);
+  WRITE_CSR(PCMR, PCMR_ENABLE);
+}
+
+DEVICE void __kmpc_impl_perf_store() {
+  WRITE_CSR(PCMR, 0);
+  volatile omptarget_pulp_PerfRecord *Record = __kmpc_impl_perf_record();
+  int CoreId = GetCoreId();
+  Record->Instructions[CoreId] = READ_CSR(PCCR_INSTR);
+  Record->TcdmStalls[CoreId] = READ_CSR(PCCR_TCDM_CONT);
+  Record->ICacheMisses[CoreId] = READ_CSR(PCCR_IMISS);
+}
+
+DEVICE void __kmpc_impl_perf_store_cluster() {
+  volatile omptarget_pulp_PerfRecord *Record = __kmpc_impl_perf_record();
+  uint32_t DmaBusy = 0;
+  for (int I = 0; I < PULP_MAX_CORES; ++I)
+    DmaBusy += omptarget_pulp_Threads[I].DMAWaitCycles;
+  // Cores the cluster does not have report nothing.
+  for (int I = GetNumberOfCores(); I < PULP_MAX_CORES; ++I) {
+    Record->Instructions[I] = 0;
+    Record->TcdmStalls[I] = 0;
+    Record->ICacheMisses[I] = 0;
+  }
+  Record->DmaBusy = DmaBusy;
+  Record->Cycles = READ_CSR(PCCR_CYCLES);
+  // The record must be complete before the cluster reports its completion.
+  __sync_synchronize();
+}
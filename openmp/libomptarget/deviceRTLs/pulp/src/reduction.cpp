@@ -0,0 +1,63 @@
+//===--- reduction.cpp - PULP OpenMP reductions ------------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Reductions are combined in a binary tree over the reduction lists that the
+// cores publish in the TCDM. Every level of the tree ends at the team
+// barrier, so a team of N cores needs log2(N) + 1 barriers and no locks.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+// Combines the reduction lists of the team into the one of core 0. Returns 1
+// on core 0, which then combines the result with the original variables, and
+// 0 on the other cores.
+static int32_t treeReduce(void *ReduceData, kmp_ReductFctPtr ReduceFn) {
+  if (!IsInActiveTeam())
+    return 1;
+  omptarget_pulp_TeamDescr &Team = omptarget_pulp_Team;
+  uint32_t NumThreads = Team.NumThreads;
+  if (NumThreads == 1)
+    return 1;
+
+  uint32_t Id = GetCoreId();
+  Team.ReduceData[Id] = ReduceData;
+  __kmpc_impl_barrier(PULP_TEAM_BARRIER);
+  for (uint32_t Step = 1; Step < NumThreads; Step *= 2) {
+    // The partner of this level is released by the barrier below only once
+    // its list has been read.
+    if (Id % (2 * Step) == 0 && Id + Step < NumThreads)
+      ReduceFn(Team.ReduceData[Id], Team.ReduceData[Id + Step]);
+    __kmpc_impl_barrier(PULP_TEAM_BARRIER);
+  }
+  return Id == 0;
+}
+
+EXTERN int32_t __kmpc_reduce_nowait(kmp_Ident *, int32_t, int32_t, size_t,
+                                    void *ReduceData, kmp_ReductFctPtr ReduceFn,
+                                    kmp_CriticalName *) {
+  return treeReduce(ReduceData, ReduceFn);
+}
+
+EXTERN void __kmpc_end_reduce_nowait(kmp_Ident *, int32_t,
+                                     kmp_CriticalName *) {}
+
+// The cores that do not combine the result wait for the one that does to
+// finish in __kmpc_end_reduce.
+EXTERN int32_t __kmpc_reduce(kmp_Ident *, int32_t, int32_t, size_t,
+                             void *ReduceData, kmp_ReductFctPtr ReduceFn,
+                             kmp_CriticalName *) {
+  int32_t Result = treeReduce(ReduceData, ReduceFn);
+  if (!Result)
+    __kmpc_impl_syncthreads();
+  return Result;
+}
+
+EXTERN void __kmpc_end_reduce(kmp_Ident *, int32_t, kmp_CriticalName *) {
+  __kmpc_impl_syncthreads();
+}
@@ -0,0 +1,57 @@
+//===--- sync.cpp - PULP OpenMP synchronizations ------------------ C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Include all synchronization.
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Barrier
+////////////////////////////////////////////////////////////////////////////////
+
+EXTERN void __kmpc_barrier(kmp_Ident *, int32_t) { __kmpc_impl_syncthreads(); }
+
+EXTERN int32_t __kmpc_cancel_barrier(kmp_Ident *loc, int32_t tid) {
+  __kmpc_barrier(loc, tid);
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Single and master
+////////////////////////////////////////////////////////////////////////////////
+
+EXTERN int32_t __kmpc_single(kmp_Ident *, int32_t) {
+  return GetOmpThreadId() == 0;
+}
+
+EXTERN void __kmpc_end_single(kmp_Ident *, int32_t) {}
+
+EXTERN int32_t __kmpc_master(kmp_Ident *, int32_t) {
+  return GetOmpThreadId() == 0;
+}
+
+EXTERN void __kmpc_end_master(kmp_Ident *, int32_t) {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Critical and flush
+////////////////////////////////////////////////////////////////////////////////
+
+// The first word of the name, zero initialized by the compiler, is the lock.
+EXTERN void __kmpc_critical(kmp_Ident *, int32_t, kmp_CriticalName *crit) {
+  __kmpc_impl_set_lock((omp_lock_t *)crit);
+}
+
+EXTERN void __kmpc_end_critical(kmp_Ident *, int32_t, kmp_CriticalName *crit) {
+  __kmpc_impl_unset_lock((omp_lock_t *)crit);
+}
+
+EXTERN void __kmpc_flush(kmp_Ident *) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
@@ -0,0 +1,93 @@
+//===--- target_impl.cpp - PULP OpenMP cluster runtime ------------ C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Definitions of target specific functions
+//
+//===----------------------------------------------------------------------===//
+
+#include "target_impl.h"
+
+PULP_L1 omptarget_pulp_TeamDescr omptarget_pulp_Team;
+PULP_L1 omptarget_pulp_ThreadDescr omptarget_pulp_Threads[PULP_MAX_CORES];
+
+EXTERN void __kmpc_pulp_kernel_init() {
+  uint32_t AllCores = __kmpc_impl_core_mask(GetNumberOfCores());
+  // The TCDM is not zero initialized.
+  for (int I = 0; I < PULP_MAX_CORES; ++I)
+    omptarget_pulp_Threads[I] = omptarget_pulp_ThreadDescr();
+  // The team barrier is set up by the first parallel region.
+  omptarget_pulp_Team.NumThreads = 0;
+  omptarget_pulp_Team.Running = 1;
+  __kmpc_impl_setup_barrier(PULP_CLUSTER_BARRIER, AllCores);
+  __kmpc_impl_enable_barrier_event();
+  __kmpc_impl_perf_start();
+}
+
+EXTERN void __kmpc_pulp_kernel_deinit() {
+  if (GetNumberOfCores() > 1) {
+    // The workers store their counters between the two barriers, before
+    // they return from __kmpc_pulp_worker_loop.
+    omptarget_pulp_Team.Running = 0;
+    __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+    __kmpc_impl_perf_store();
+    __kmpc_impl_barrier(PULP_CLUSTER_BARRIER);
+  } else {
+    __kmpc_impl_perf_store();
+  }
+  // The host reads the profile once the cluster reported its completion.
+  __kmpc_impl_perf_store_cluster();
+}
+
+DEVICE double __kmpc_impl_get_wtick() {
+  return 1.0 / PULP_CLUSTER_FREQUENCY;
+}
+
+DEVICE double __kmpc_impl_get_wtime() {
+  return (double)__builtin_readcyclecounter() / PULP_CLUSTER_FREQUENCY;
+}
+
+// Atomics
+DEVICE uint32_t __kmpc_atomic_add(uint32_t *Address, uint32_t Val) {
+  return __atomic_fetch_add(Address, Val, __ATOMIC_SEQ_CST);
+}
+
+DEVICE uint32_t __kmpc_atomic_exchange(uint32_t *Address, uint32_t Val) {
+  return __atomic_exchange_n(Address, Val, __ATOMIC_SEQ_CST);
+}
+
+DEVICE uint32_t __kmpc_atomic_cas(uint32_t *Address, uint32_t Compare,
+                                  uint32_t Val) {
+  (void)__atomic_compare_exchange_n(Address, &Compare, Val, false,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+  return Compare;
+}
+
+// Locks
+#define UNSET 0u
+#define SET 1u
+
+DEVICE void __kmpc_impl_init_lock(omp_lock_t *lock) {
+  __kmpc_impl_unset_lock(lock);
+}
+
+DEVICE void __kmpc_impl_destroy_lock(omp_lock_t *lock) {
+  __kmpc_impl_unset_lock(lock);
+}
+
+DEVICE void __kmpc_impl_set_lock(omp_lock_t *lock) {
+  while (__kmpc_atomic_cas(lock, UNSET, SET) != UNSET) {
+  }
+}
+
+DEVICE void __kmpc_impl_unset_lock(omp_lock_t *lock) {
+  (void)__kmpc_atomic_exchange(lock, UNSET);
+}
+
+DEVICE int __kmpc_impl_test_lock(omp_lock_t *lock) {
+  return __kmpc_atomic_cas(lock, UNSET, SET) == UNSET;
+}
@@ -0,0 +1,343 @@
+//===--- target_impl.h - PULP OpenMP cluster runtime -------------- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Declarations and definitions of target specific functions and constants.
+//
+// Device code for riscv32-hero is compiled like host code, so this runtime
+// implements the host kmpc interface (__kmpc_fork_call, __kmpc_barrier,
+// __kmpc_for_static_init_*, __kmpc_reduce*, ...) for a single PULP cluster.
+// A team is made of the first cores of the cluster, its state lives in the
+// TCDM and all synchronization goes through the hardware barriers of the
+// cluster event unit, which put the waiting cores to sleep.
+//
+//===----------------------------------------------------------------------===//
+#ifndef OMPTARGET_PULP_TARGET_IMPL_H
+#define OMPTARGET_PULP_TARGET_IMPL_H
+
+#ifndef __PULP__
+#error "pulp target_impl.h expects to be compiled under __PULP__"
+#endif
+
+#include "interface.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEVICE
+#define INLINE inline __attribute__((always_inline))
+#define NOINLINE __attribute__((noinline))
+#define ALIGN(N) __attribute__((aligned(N)))
+// Places a variable in the TCDM of the cluster, the memory shared by all of
+// its cores.
+#define PULP_L1 __attribute__((section(".l1cluster_g")))
+
+////////////////////////////////////////////////////////////////////////////////
+// Cluster options
+////////////////////////////////////////////////////////////////////////////////
+
+// Maximum number of cores in a cluster. Sizes the per-core state in the TCDM.
+#ifndef PULP_MAX_CORES
+#define PULP_MAX_CORES 8
+#endif
+
+// Maximum number of arguments passed to an outlined parallel function.
+#define MAX_SHARED_ARGS 15
+
+// Frequency of the cycle counter, used by omp_get_wtime.
+#ifndef PULP_CLUSTER_FREQUENCY
+#define PULP_CLUSTER_FREQUENCY 50000000
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Event unit
+////////////////////////////////////////////////////////////////////////////////
+
+// Cluster-local addresses of the event unit. Through the demultiplexed alias
+// every core accesses its own core registers at the same addresses.
+#ifndef PULP_EU_ADDR
+#define PULP_EU_ADDR 0x00200800
+#endif
+#ifndef PULP_EU_DEMUX_ADDR
+#define PULP_EU_DEMUX_ADDR 0x00204000
+#endif
+
+// Event raised by the hardware barriers (ARCHI_CL_EVT_BAR).
+#ifndef PULP_EU_BARRIER_EVENT
+#define PULP_EU_BARRIER_EVENT 16
+#endif
+
+enum : uint32_t {
+  EU_CORE_MASK_OR = 0x18,
+  EU_BARRIER_OFFSET = 0x400,
+  EU_HW_BARRIER_SIZE = 0x20,
+  EU_HW_BARR_TRIGGER_MASK = 0x00,
+  EU_HW_BARR_TARGET_MASK = 0x0c,
+  EU_HW_BARR_TRIGGER_WAIT_CLEAR = 0x1c,
+};
+
+// Hardware barriers used by the runtime. Idle cores wait for work at the
+// cluster barrier, cores of a team synchronize at the team barrier.
+enum : uint32_t {
+  PULP_CLUSTER_BARRIER = 0,
+  PULP_TEAM_BARRIER = 1,
+};
+
+INLINE volatile uint32_t *__kmpc_impl_eu_reg(uint32_t Addr) {
+  return (volatile uint32_t *)(uintptr_t)Addr;
+}
+
+// Configures hardware barrier \p Id to release once all cores in \p Mask
+// arrived, and to wake up all of them.
+INLINE void __kmpc_impl_setup_barrier(uint32_t Id, uint32_t Mask) {
+  uint32_t Addr = PULP_EU_ADDR + EU_BARRIER_OFFSET + Id * EU_HW_BARRIER_SIZE;
+  *__kmpc_impl_eu_reg(Addr + EU_HW_BARR_TRIGGER_MASK) = Mask;
+  *__kmpc_impl_eu_reg(Addr + EU_HW_BARR_TARGET_MASK) = Mask;
+}
+
+// Arrives at hardware barrier \p Id and sleeps until it is released. The
+// load is a p.elw, which stalls the core in the event unit instead of
+// spinning. The clusters have no data caches, so ordering the accesses of
+// the compiler is enough to publish the stores made before the barrier.
+INLINE void __kmpc_impl_barrier(uint32_t Id) {
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  __builtin_pulp_event_unit_read(
+      (int *)(uintptr_t)(PULP_EU_DEMUX_ADDR + EU_BARRIER_OFFSET +
+                         Id * EU_HW_BARRIER_SIZE),
+      EU_HW_BARR_TRIGGER_WAIT_CLEAR);
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+// Lets the calling core be woken up by the hardware barriers.
+INLINE void __kmpc_impl_enable_barrier_event() {
+  *__kmpc_impl_eu_reg(PULP_EU_DEMUX_ADDR + EU_CORE_MASK_OR) =
+      1u << PULP_EU_BARRIER_EVENT;
+}
+
+INLINE uint32_t __kmpc_impl_core_mask(uint32_t NumCores) {
+  return NumCores >= 32 ? ~0u : (1u << NumCores) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Cluster DMA
+////////////////////////////////////////////////////////////////////////////////
+
+// Cluster-local address of the DMA (mchan). Through the demultiplexed alias
+// every core has its own command queue and transfer counters.
+#ifndef PULP_DMA_DEMUX_ADDR
+#define PULP_DMA_DEMUX_ADDR 0x00204400
+#endif
+
+enum : uint32_t {
+  DMA_CMD = 0x0,
+  DMA_STATUS = 0x4,
+  DMA_CMD_EXT2LOC = 1u << 17,
+  DMA_CMD_INC = 1u << 18,
+  // The length field of a command has 17 bits.
+  DMA_MAX_TRANSFER = 1u << 16,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Host channels
+////////////////////////////////////////////////////////////////////////////////
+
+// Address at which the cluster sees the contiguous L3 area of the host
+// plugin, which holds the channels to the host.
+#ifndef PULP_L3_ADDR
+#define PULP_L3_ADDR 0x80000000
+#endif
+
+// Device stdout. The layout of the log rings must match the one in
+// plugins/pulp/rtl.cpp: the first MiB of the L3 area of every cluster is split
+// into one ring per core, of which PULP_MAX_CORES must match the number of
+// cores of the cluster. A ring starts with a header of four words, the offset
+// of the next byte written by the core, the offset of the next byte read by
+// the host, and a magic word written by the host if it drains the rings.
+enum : uint32_t {
+  LOG_BUF_SIZE = 1024 * 1024,
+  LOG_CORE_SIZE = LOG_BUF_SIZE / PULP_MAX_CORES,
+  LOG_HEADER_SIZE = 4 * sizeof(uint32_t),
+  LOG_RING_SIZE = LOG_CORE_SIZE - LOG_HEADER_SIZE,
+  LOG_HEAD = 0,
+  LOG_TAIL = 1,
+  LOG_ENABLE = 2,
+  LOG_MAGIC = 0x4c4f4721,
+};
+
+// Number of clusters of the SoC. The launch profiles of the clusters follow
+// the log rings of all of them.
+#ifndef PULP_NB_CLUSTERS
+#define PULP_NB_CLUSTERS 1
+#endif
+
+// Launch profile of a cluster, stored at the end of every kernel. Must match
+// PulpPerfRecord in plugins/pulp/rtl.cpp.
+struct omptarget_pulp_PerfRecord {
+  // Cycles of the master core from __kmpc_pulp_kernel_init to
+  // __kmpc_pulp_kernel_deinit.
+  uint32_t Cycles;
+  // Cycles the cores waited for their DMA transfers.
+  uint32_t DmaBusy;
+  uint32_t Instructions[PULP_MAX_CORES];
+  uint32_t TcdmStalls[PULP_MAX_CORES];
+  uint32_t ICacheMisses[PULP_MAX_CORES];
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Runtime state
+////////////////////////////////////////////////////////////////////////////////
+
+typedef void (*kmpc_micro)(int32_t *global_tid, int32_t *bound_tid, ...);
+typedef void (*kmp_ReductFctPtr)(void *lhsData, void *rhsData);
+
+// The active parallel region of the cluster, written by its master core
+// while the other cores wait at the cluster barrier.
+struct omptarget_pulp_TeamDescr {
+  kmpc_micro Fn;
+  void **Args;
+  int32_t NumArgs;
+  // Number of cores of the team, which are the cores [0, NumThreads).
+  uint32_t NumThreads;
+  // Cleared to stop the cores waiting for work.
+  uint32_t Running;
+  // Reduction lists published by the members of the team.
+  void *ReduceData[PULP_MAX_CORES];
+};
+
+struct omptarget_pulp_ThreadDescr {
+  // Number of enclosing parallel regions, active or not.
+  uint16_t Level;
+  // Whether the outermost enclosing parallel region is active.
+  uint16_t InActiveParallel;
+  // Team size requested by num_threads for the next parallel region.
+  uint32_t NextNumThreads;
+  // Team size set by omp_set_num_threads, 0 for the whole cluster.
+  uint32_t NThreadsVar;
+  // Counters of the DMA transfers issued by the core and not waited for.
+  uint32_t DMAJobs;
+  // Cycles the core waited for its DMA transfers in the current kernel.
+  uint32_t DMAWaitCycles;
+};
+
+extern PULP_L1 omptarget_pulp_TeamDescr omptarget_pulp_Team;
+extern PULP_L1 omptarget_pulp_ThreadDescr
+    omptarget_pulp_Threads[PULP_MAX_CORES];
+
+INLINE int GetCoreId() { return __builtin_pulp_CoreId(); }
+INLINE int GetNumberOfCores() {
+  int NumCores = __builtin_pulp_CoreCount();
+  return NumCores < PULP_MAX_CORES ? NumCores : PULP_MAX_CORES;
+}
+
+INLINE omptarget_pulp_ThreadDescr &GetThreadDescr() {
+  return omptarget_pulp_Threads[GetCoreId()];
+}
+
+// Whether the calling core is a member of the active team of the cluster,
+// not counting parallel regions that it serialized within.
+INLINE bool IsInActiveTeam() {
+  const omptarget_pulp_ThreadDescr &Thread = GetThreadDescr();
+  return Thread.InActiveParallel && Thread.Level == 1;
+}
+
+// Id of the calling core in its innermost team, and the size of that team.
+INLINE int GetOmpThreadId() { return IsInActiveTeam() ? GetCoreId() : 0; }
+INLINE int GetNumberOfOmpThreads() {
+  return IsInActiveTeam() ? omptarget_pulp_Team.NumThreads : 1;
+}
+
+// Synchronizes the innermost team of the calling core.
+INLINE void __kmpc_impl_syncthreads() {
+  if (IsInActiveTeam() && omptarget_pulp_Team.NumThreads > 1)
+    __kmpc_impl_barrier(PULP_TEAM_BARRIER);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Entry points of the cluster
+////////////////////////////////////////////////////////////////////////////////
+
+// Called by the master core of the cluster before running a target region,
+// sets up the event unit for the cores of the cluster.
+EXTERN void __kmpc_pulp_kernel_init();
+// Called by the master core once the target region finished, releases the
+// cores waiting in __kmpc_pulp_worker_loop.
+EXTERN void __kmpc_pulp_kernel_deinit();
+// Called by every core of the cluster but the master once it booted. Runs the
+// parallel regions forked by the master, returns after
+// __kmpc_pulp_kernel_deinit.
+EXTERN void __kmpc_pulp_worker_loop();
+
+// Memory phases of the predictable execution model (PREM), emitted by the
+// pulp-prem-phases pass around the DMA transfers of a tile. The memory of the
+// host is only accessed between __kmpc_pulp_prem_memory_phase_begin and
+// __kmpc_pulp_prem_memory_phase_end. These definitions are weak, the PREM
+// runtime of the platform overrides them to arbitrate the memory phases with
+// the host.
+EXTERN void __kmpc_pulp_prem_memory_phase_begin();
+EXTERN void __kmpc_pulp_prem_memory_phase_end();
+// Copies \p Size bytes between the memory of the host and the TCDM with the
+// cluster DMA. The transfers complete in __kmpc_pulp_prem_dma_wait.
+EXTERN void __kmpc_pulp_prem_dma_in(void *Local, const void *Global,
+                                    uint32_t Size);
+EXTERN void __kmpc_pulp_prem_dma_out(void *Global, const void *Local,
+                                     uint32_t Size);
+EXTERN void __kmpc_pulp_prem_dma_wait();
+
+// Writes \p Size bytes to the log ring of the calling core, from which the
+// host plugin prints them to its stdout. Stalls while the ring is full, drops
+// the bytes if the host does not drain the rings. This is the stdout of the
+// cores, the putchar and write hooks of the platform call into it.
+EXTERN void __kmpc_pulp_log_write(const char *Buf, uint32_t Size);
+EXTERN int __kmpc_pulp_log_putchar(int C);
+
+// Host interface functions that the GPU runtimes do not provide.
+EXTERN void __kmpc_fork_call(kmp_Ident *loc, int32_t argc, kmpc_micro microtask,
+                             ...);
+EXTERN int32_t __kmpc_reduce_nowait(kmp_Ident *loc, int32_t global_tid,
+                                    int32_t num_vars, size_t reduce_size,
+                                    void *reduce_data,
+                                    kmp_ReductFctPtr reduce_func,
+                                    kmp_CriticalName *lck);
+EXTERN void __kmpc_end_reduce_nowait(kmp_Ident *loc, int32_t global_tid,
+                                     kmp_CriticalName *lck);
+EXTERN int32_t __kmpc_reduce(kmp_Ident *loc, int32_t global_tid,
+                             int32_t num_vars, size_t reduce_size,
+                             void *reduce_data, kmp_ReductFctPtr reduce_func,
+                             kmp_CriticalName *lck);
+EXTERN void __kmpc_end_reduce(kmp_Ident *loc, int32_t global_tid,
+                              kmp_CriticalName *lck);
+
+////////////////////////////////////////////////////////////////////////////////
+// Atomics and locks
+////////////////////////////////////////////////////////////////////////////////
+
+DEVICE uint32_t __kmpc_atomic_add(uint32_t *, uint32_t);
+DEVICE uint32_t __kmpc_atomic_exchange(uint32_t *, uint32_t);
+DEVICE uint32_t __kmpc_atomic_cas(uint32_t *, uint32_t, uint32_t);
+
+DEVICE void __kmpc_impl_init_lock(omp_lock_t *lock);
+DEVICE void __kmpc_impl_destroy_lock(omp_lock_t *lock);
+DEVICE void __kmpc_impl_set_lock(omp_lock_t *lock);
+DEVICE void __kmpc_impl_unset_lock(omp_lock_t *lock);
+DEVICE int __kmpc_impl_test_lock(omp_lock_t *lock);
+
+DEVICE double __kmpc_impl_get_wtick();
+DEVICE double __kmpc_impl_get_wtime();
+
+////////////////////////////////////////////////////////////////////////////////
+// Launch profiles
+////////////////////////////////////////////////////////////////////////////////
+
+// Clears and starts the performance counters of the calling core.
+DEVICE void __kmpc_impl_perf_start();
+// Stores the counters of the calling core into the profile of its cluster.
+DEVICE void __kmpc_impl_perf_store();
+// Stores the counters of the cluster, called by the master core after every
+// core stored its own.
+DEVICE void __kmpc_impl_perf_store_cluster();
+
+#endif
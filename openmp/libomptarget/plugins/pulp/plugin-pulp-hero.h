@@ -57,7 +57,13 @@ extern "C" {
 
 #include "pulp.h"
 
-#define PULP_HERO_DEFAULT_CLUSTER_ID (0x1U)
+// number of clusters of the SoC, every cluster runs one team
+#ifdef ARCHI_NB_CLUSTER
+#define PULP_HERO_NB_CLUSTERS (ARCHI_NB_CLUSTER)
+#else
+#define PULP_HERO_NB_CLUSTERS (1U)
+#endif
+#define PULP_HERO_DEFAULT_CLUSTER_ID ((1U << PULP_HERO_NB_CLUSTERS) - 1)
 #define PULP_HERO_DEFAULT_FREQ (PULP_DEFAULT_FREQ_MHZ)
 #define PULP_HERO_DEFAULT_MEM_MODE (copy)
 #define PULP_HERO_DEFAULT_RAB_LEVEL (0x2U)
@@ -363,28 +369,42 @@ extern "C" bool GOMP_OFFLOAD_free(int n __attribute__((unused)),
   return 1;
 }
 
+// FIXME: This is a workaround to solve issue hero#59, in which the aarch64
+//        memcpy caused a segfault under certain cases. The gitlab issue has
+//        coded we used to produce the behaviour. The workaround is to use a
+//        copy loop; it moves 64-bit words where source and destination are
+//        equally aligned and bytes otherwise.
+static void copy_l3(char *dst, const char *src, size_t size) {
+  size_t i = 0;
+  if ((((uintptr_t)dst ^ (uintptr_t)src) & 0x7) == 0) {
+    for (; i < size && ((uintptr_t)(dst + i) & 0x7); i++)
+      dst[i] = src[i];
+    for (; i + 8 <= size; i += 8)
+      *(volatile uint64_t *)(dst + i) = *(const volatile uint64_t *)(src + i);
+  }
+  for (; i < size; i++)
+    dst[i] = src[i];
+}
+
+/* Host address of the L3 buffer with the physical address tgt_ptr.  */
+static void *l3_virt_ptr(const void *tgt_ptr) {
+  DataDesc &data_desc = address_map->find((uintptr_t)tgt_ptr)->second;
+  return data_desc.ptr_l3_v;
+}
+
 extern "C" bool GOMP_OFFLOAD_host2dev(int n __attribute__((unused)),
                                       void *tgt_ptr, const void *host_ptr,
                                       size_t size) {
   TRACE_FUNCTION();
 
-  DataDesc &data_desc = address_map->find((uintptr_t)tgt_ptr)->second;
-  uintptr_t vir_ptr = (uintptr_t)data_desc.ptr_l3_v;
+  uintptr_t vir_ptr = (uintptr_t)l3_virt_ptr(tgt_ptr);
 
   TRACE("       tgt_ptr = %p, host_ptr = %p, size = %#x", (void *)tgt_ptr,
         (void *)host_ptr, size);
   TRACE("memcpy(vir_ptr = %p, host_ptr = %p, size = %#x)", (void *)vir_ptr,
         (void *)host_ptr, size);
 
-  // FIXME: This is a workaround to solve issue hero#59, in which the aarch64
-  //        memcpy caused a segfault under certain cases. The gitlab issue has
-  //        coded we used to produce the behaviour. The workaround is to use a
-  //        byte-copy-loop.
-  char *src = (char *)host_ptr;
-  char *dst = (char *)vir_ptr;
-  for (int i = 0; i < size; i++) {
-    dst[i] = src[i];
-  }
+  copy_l3((char *)vir_ptr, (const char *)host_ptr, size);
   //memcpy((void *)vir_ptr, host_ptr, size);
 
   return 1;
@@ -395,23 +415,14 @@ extern "C" bool GOMP_OFFLOAD_dev2host(int n __attribute__((unused)),
                                       size_t size) {
   TRACE_FUNCTION();
 
-  DataDesc &data_desc = address_map->find((uintptr_t)tgt_ptr)->second;
-  uintptr_t vir_ptr = (uintptr_t)data_desc.ptr_l3_v;
+  uintptr_t vir_ptr = (uintptr_t)l3_virt_ptr(tgt_ptr);
 
   TRACE("       host_ptr = %p, tgt_ptr = %p, size = %#x", (void *)host_ptr,
         (void *)tgt_ptr, size);
   TRACE("memcpy(host_ptr = %p, vir_ptr = %p, size = %#x)", (void *)host_ptr,
         (void *)vir_ptr, size);
 
-  // FIXME: This is a workaround to solve issue hero#59, in which the aarch64
-  //        memcpy caused a segfault under certain cases. The gitlab issue has
-  //        coded we used to produce the behaviour. The workaround is to use a
-  //        byte-copy-loop.
-  char *dst = (char *)host_ptr;
-  char *src = (char *)vir_ptr;
-  for (int i = 0; i < size; i++) {
-    dst[i] = src[i];
-  }
+  copy_l3((char *)host_ptr, (const char *)vir_ptr, size);
   //memcpy(host_ptr, (void *)vir_ptr, size);
 
   return 1;
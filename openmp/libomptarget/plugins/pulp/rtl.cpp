@@ -11,12 +11,19 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <chrono>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <future>
 #include <list>
 #include <map>
+#include <mutex>
 #include <stdio.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef PREM_MODE
@@ -52,10 +59,403 @@ static int DebugLevel = 10;
 #include "../common/elf_common/elf_common.h"
 #include <gelf.h>
 
-// size of the argument buffer in words
-#define ARG_BUF_SIZE 16
-std::vector<uint64_t> host_arg_buf;
-void *dev_arg_buf;
+// The launch arguments live in a ring in the contiguous L3 memory. The host
+// writes them in place and PULP reads them through the physical address, in
+// both the SVM and the memcpy mode, so a launch neither allocates nor copies.
+// Each launch takes the next words of the ring and wraps around at its end.
+// Only the arguments of the kernel running on PULP are live, a launch only
+// waits for that kernel before staging if its words would overlap them.
+// size of the argument ring in words
+#define ARG_RING_SIZE 1024
+static volatile uint64_t *arg_ring_virt = nullptr;
+static uintptr_t arg_ring_phys = 0;
+// next free word of the ring
+static size_t arg_ring_head = 0;
+// words [running_args_begin, running_args_end) belong to the running kernel
+static size_t running_args_begin = 0;
+static size_t running_args_end = 0;
+
+// PULP runs one offload at a time. An asynchronous launch returns as soon as
+// the mailbox is written, its queue remembers that the kernel may still be
+// running. The kernel is waited for by the synchronization of its queue, by
+// later operations on the same queue, or by the next launch, which needs the
+// mailbox and the argument buffer.
+// Asynchronous submits in memcpy mode run on host threads in issue order, so
+// the copy of the next buffer overlaps with the kernel of another queue.
+struct PulpQueueTy {
+  std::atomic<bool> KernelPending{false};
+  // the last copy issued on the queue
+  std::shared_future<void> LastCopy;
+};
+// The queue whose kernel currently runs on PULP, if any.
+static PulpQueueTy *running_queue = nullptr;
+// The number of clusters running the kernel.
+static unsigned running_clusters = 0;
+// Serializes the mailbox protocol between host threads.
+static std::mutex pulp_mtx;
+
+// Device stdout is a log channel: every core owns a ring in the first MiB of
+// the L3 area of its cluster, written by __kmpc_pulp_log_write of the device
+// runtime. The ring starts with a header of four words: the offset of the
+// next byte the core writes, written by the core only, the offset of the
+// next byte the host reads, written by the host only, and a magic word the
+// host sets while it drains the rings. Both offsets stay below the ring
+// size, the core leaves one byte free so that a full ring differs from an
+// empty one. The core writes its bytes before it publishes the new offset
+// and stalls while the ring is full, so neither side takes a lock. A host
+// thread drains the rings while kernels run. The channel is disabled unless
+// LIBOMPTARGET_PULP_STDOUT is set, the host then clears the magic words and
+// the cores drop their output.
+#define LOG_BUF_SIZE (1024 * 1024) // per cluster
+#define LOG_CORE_SIZE (LOG_BUF_SIZE / ARCHI_CLUSTER_NB_PE)
+#define LOG_HEADER_SIZE (4 * sizeof(uint32_t))
+#define LOG_RING_SIZE (LOG_CORE_SIZE - LOG_HEADER_SIZE)
+#define LOG_MAGIC 0x4c4f4721
+#define LOG_POLL_INTERVAL std::chrono::milliseconds(1)
+
+static bool log_enabled = false;
+// serializes the host side of the rings
+static std::mutex log_mtx;
+
+static volatile uint32_t *get_log_ring(unsigned cluster, unsigned core) {
+  return (volatile uint32_t *)((char *)pulp->l3_mem.v_addr +
+                               LOG_BUF_SIZE * cluster + LOG_CORE_SIZE * core);
+}
+
+// Print the bytes produced by every core since the last drain.
+static void drain_logs() {
+  std::lock_guard<std::mutex> lock(log_mtx);
+  for (unsigned c = 0; c < PULP_HERO_NB_CLUSTERS; ++c) {
+    for (unsigned i = 0; i < ARCHI_CLUSTER_NB_PE; ++i) {
+      volatile uint32_t *ring = get_log_ring(c, i);
+      const uint32_t head = ring[0];
+      uint32_t tail = ring[1];
+      if (head == tail)
+        continue;
+      // read the bytes only after their count
+      __sync_synchronize();
+      const volatile char *data = (const volatile char *)ring + LOG_HEADER_SIZE;
+      for (; tail != head; tail = tail + 1 == LOG_RING_SIZE ? 0 : tail + 1)
+        putchar(data[tail]);
+      // release the bytes only after they have been read
+      __sync_synchronize();
+      ring[1] = tail;
+    }
+  }
+  fflush(stdout);
+}
+
+class PulpLogDrainer {
+  std::atomic<bool> Stop{false};
+  std::thread Thread;
+
+public:
+  // Enable or disable the output of the cores in the rings.
+  static void reset(bool enable) {
+    for (unsigned c = 0; c < PULP_HERO_NB_CLUSTERS; ++c)
+      for (unsigned i = 0; i < ARCHI_CLUSTER_NB_PE; ++i) {
+        volatile uint32_t *ring = get_log_ring(c, i);
+        ring[0] = ring[1] = 0;
+        // the offsets must be reset before the cores see the magic word
+        __sync_synchronize();
+        ring[2] = enable ? LOG_MAGIC : 0;
+      }
+  }
+
+  void start() {
+    reset(true);
+    log_enabled = true;
+    Thread = std::thread([this]() {
+      while (!Stop) {
+        drain_logs();
+        std::this_thread::sleep_for(LOG_POLL_INTERVAL);
+      }
+    });
+  }
+
+  ~PulpLogDrainer() {
+    if (!Thread.joinable())
+      return;
+    Stop = true;
+    Thread.join();
+    drain_logs();
+    reset(false);
+  }
+};
+
+static PulpLogDrainer log_drainer;
+
+// Launch profiles. At the end of every kernel, __kmpc_pulp_kernel_deinit of
+// the device runtime stores the performance counters of every cluster into
+// its record in L3, behind the log rings, before it reports completion. The
+// record must match omptarget_pulp_PerfRecord of the device runtime, which
+// has to be built for the same number of clusters and cores. If
+// LIBOMPTARGET_PULP_PROFILE names a file, the host appends one line per
+// launch and cluster to it:
+//   kernel,cluster,start_us,end_us,cycles,instructions,tcdm_stalls,
+//   icache_misses,dma_busy
+// with the host time of launch and completion and the counters summed over
+// the cores of the cluster.
+struct PulpPerfRecord {
+  // cycles of the master core of the cluster
+  uint32_t Cycles;
+  // cycles the cores waited for their DMA transfers
+  uint32_t DmaBusy;
+  uint32_t Instructions[ARCHI_CLUSTER_NB_PE];
+  uint32_t TcdmStalls[ARCHI_CLUSTER_NB_PE];
+  uint32_t ICacheMisses[ARCHI_CLUSTER_NB_PE];
+};
+
+class PulpProfile {
+  FILE *File = nullptr;
+  // the names of the loaded kernels by device address
+  std::map<void *, std::string> KernelNames;
+  // the kernel running on PULP and the host time of its launch
+  void *RunningKernel = nullptr;
+  std::chrono::steady_clock::time_point Start;
+
+  static const volatile PulpPerfRecord *getRecord(unsigned cluster) {
+    return (const volatile PulpPerfRecord *)((char *)pulp->l3_mem.v_addr +
+                                             LOG_BUF_SIZE *
+                                                 PULP_HERO_NB_CLUSTERS) +
+           cluster;
+  }
+
+  uint64_t getMicroseconds(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               t.time_since_epoch())
+        .count();
+  }
+
+public:
+  void open(const char *path) {
+    File = fopen(path, "w");
+    if (!File) {
+      DP("failed to open the profile %s\n", path);
+      return;
+    }
+    fprintf(File, "kernel,cluster,start_us,end_us,cycles,instructions,"
+                  "tcdm_stalls,icache_misses,dma_busy\n");
+  }
+
+  ~PulpProfile() {
+    if (File)
+      fclose(File);
+  }
+
+  bool enabled() const { return File; }
+
+  void addKernel(void *addr, const char *name) { KernelNames[addr] = name; }
+
+  // Must be called with pulp_mtx held, as the two below.
+  void launched(void *kernel) {
+    RunningKernel = kernel;
+    Start = std::chrono::steady_clock::now();
+  }
+
+  void completed(unsigned num_clusters) {
+    const uint64_t end_us = getMicroseconds(std::chrono::steady_clock::now());
+    auto it = KernelNames.find(RunningKernel);
+    const char *name = it != KernelNames.end() ? it->second.c_str() : "?";
+    for (unsigned c = 0; c < num_clusters; ++c) {
+      const volatile PulpPerfRecord *record = getRecord(c);
+      uint64_t instructions = 0, tcdm_stalls = 0, icache_misses = 0;
+      for (unsigned i = 0; i < ARCHI_CLUSTER_NB_PE; ++i) {
+        instructions += record->Instructions[i];
+        tcdm_stalls += record->TcdmStalls[i];
+        icache_misses += record->ICacheMisses[i];
+      }
+      fprintf(File, "%s,%u,%llu,%llu,%u,%llu,%llu,%llu,%u\n", name, c,
+              (unsigned long long)getMicroseconds(Start),
+              (unsigned long long)end_us, (unsigned)record->Cycles,
+              (unsigned long long)instructions,
+              (unsigned long long)tcdm_stalls,
+              (unsigned long long)icache_misses, (unsigned)record->DmaBusy);
+    }
+    fflush(File);
+  }
+};
+
+static PulpProfile profile;
+
+// Wait for the kernel running on PULP and flush its output. Must be called
+// with pulp_mtx held.
+static void wait_for_kernel() {
+  if (!running_queue)
+    return;
+
+  // Every cluster reports its completion, the kernel takes as long as the
+  // slowest cluster.
+  uint32_t cycles = 0;
+  for (unsigned c = 0; c < running_clusters; ++c) {
+    uint32_t ret[2];
+    while (pulp_mbox_read(pulp, (unsigned int *)&ret[0], 1));
+    assert(ret[0] == 4 /* PULP_DONE */ &&
+           "Software mailbox protocol failure: Expected PULP_DONE.");
+    while (pulp_mbox_read(pulp, (unsigned int *)&ret[1], 1));
+    cycles = std::max(cycles, ret[1]);
+  }
+
+  if (log_enabled)
+    drain_logs();
+  if (profile.enabled())
+    profile.completed(running_clusters);
+
+  DP("Done offloading, cycles to execute kernel: %u\n", cycles);
+
+  running_queue->KernelPending = false;
+  running_queue = nullptr;
+  running_clusters = 0;
+  running_args_begin = running_args_end = 0;
+}
+
+// Wait until the kernel launched on queue has completed, operations on a queue
+// are executed in order.
+static void drain_queue(PulpQueueTy *queue) {
+  if (!queue || !queue->KernelPending)
+    return;
+  std::lock_guard<std::mutex> lock(pulp_mtx);
+  if (queue->KernelPending)
+    wait_for_kernel();
+}
+
+static bool copies_pending(PulpQueueTy *queue) {
+  return queue->LastCopy.valid() &&
+         queue->LastCopy.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready;
+}
+
+// Wait until the copies issued on queue have completed.
+static void wait_for_copies(PulpQueueTy *queue) {
+  if (queue && queue->LastCopy.valid())
+    queue->LastCopy.wait();
+}
+
+// The host CPU copies into the uncached L3 mapping, which one core cannot
+// saturate. Large transfers are split into chunks copied in parallel.
+#define COPY_CHUNK_SIZE (256 * 1024)
+#define COPY_MAX_CHUNKS 4
+
+static void copy_chunked(char *dst, const char *src, size_t size) {
+  size_t num_chunks = std::min<size_t>(
+      (size + COPY_CHUNK_SIZE - 1) / COPY_CHUNK_SIZE, COPY_MAX_CHUNKS);
+  if (num_chunks <= 1) {
+    copy_l3(dst, src, size);
+    return;
+  }
+  // Chunks are multiples of words to keep the alignment of every chunk.
+  size_t chunk_size = (size / num_chunks + 7) & ~(size_t)7;
+  std::vector<std::future<void>> chunks;
+  for (size_t off = chunk_size; off < size; off += chunk_size)
+    chunks.push_back(std::async(std::launch::async, copy_l3, dst + off,
+                                src + off, std::min(chunk_size, size - off)));
+  copy_l3(dst, src, chunk_size);
+  for (auto &chunk : chunks)
+    chunk.wait();
+}
+
+// Copy on queue, after the operations issued on it before. Small copies on an
+// idle queue are done right away.
+static void enqueue_copy(PulpQueueTy *queue, char *dst, const char *src,
+                         size_t size) {
+  if (size < COPY_CHUNK_SIZE && !queue->KernelPending &&
+      !copies_pending(queue)) {
+    copy_l3(dst, src, size);
+    return;
+  }
+  std::shared_future<void> prev = queue->LastCopy;
+  queue->LastCopy = std::async(std::launch::async, [=]() {
+                      if (prev.valid())
+                        prev.wait();
+                      drain_queue(queue);
+                      copy_chunked(dst, src, size);
+                    }).share();
+}
+
+static PulpQueueTy *get_queue(__tgt_async_info *async_info) {
+  if (!async_info->Queue)
+    async_info->Queue = new PulpQueueTy();
+  return static_cast<PulpQueueTy *>(async_info->Queue);
+}
+
+// Device buffers in memcpy mode are kept in a pool instead of being returned
+// to the driver, so repeated offloads of the same shapes do not allocate in
+// steady state. Sizes are rounded up to powers of two, a freed buffer is kept
+// on the free list of its size class while the cached bytes stay below the
+// reservation. LIBOMPTARGET_PULP_POOL_SIZE sets the reservation in bytes, 0
+// disables the pool; buffers larger than the reservation bypass it.
+#define POOL_MIN_CLASS 6 // 64 bytes
+#define POOL_DEFAULT_SIZE (64 * 1024 * 1024)
+
+class PulpMemoryPool {
+  std::mutex Mtx;
+  // free buffers by size class
+  std::map<unsigned, std::vector<void *>> FreeLists;
+  // size class of every buffer handed out by the pool
+  std::map<void *, unsigned> Classes;
+  size_t Reservation;
+  size_t CachedBytes = 0;
+  size_t Hits = 0;
+  size_t Misses = 0;
+
+  static unsigned getClass(size_t size) {
+    unsigned cls = POOL_MIN_CLASS;
+    while (((size_t)1 << cls) < size)
+      ++cls;
+    return cls;
+  }
+
+public:
+  PulpMemoryPool() : Reservation(POOL_DEFAULT_SIZE) {
+    if (const char *env = getenv("LIBOMPTARGET_PULP_POOL_SIZE"))
+      Reservation = strtoull(env, nullptr, 0);
+  }
+
+  ~PulpMemoryPool() {
+    DP("memory pool: %zu hits, %zu misses, %zu bytes cached\n", Hits, Misses,
+       CachedBytes);
+  }
+
+  void *allocate(int32_t device_id, size_t size) {
+    if (size > Reservation)
+      return GOMP_OFFLOAD_alloc(device_id, size);
+
+    unsigned cls = getClass(size);
+    std::lock_guard<std::mutex> lock(Mtx);
+    std::vector<void *> &free_list = FreeLists[cls];
+    if (!free_list.empty()) {
+      void *ptr = free_list.back();
+      free_list.pop_back();
+      CachedBytes -= (size_t)1 << cls;
+      ++Hits;
+      return ptr;
+    }
+    ++Misses;
+    void *ptr = GOMP_OFFLOAD_alloc(device_id, (size_t)1 << cls);
+    if (ptr)
+      Classes[ptr] = cls;
+    return ptr;
+  }
+
+  bool release(int32_t device_id, void *ptr) {
+    {
+      std::lock_guard<std::mutex> lock(Mtx);
+      auto it = Classes.find(ptr);
+      if (it != Classes.end()) {
+        size_t bytes = (size_t)1 << it->second;
+        if (CachedBytes + bytes <= Reservation) {
+          FreeLists[it->second].push_back(ptr);
+          CachedBytes += bytes;
+          return true;
+        }
+        Classes.erase(it);
+      }
+    }
+    return GOMP_OFFLOAD_free(device_id, ptr);
+  }
+};
+
+static PulpMemoryPool memory_pool;
 
 #ifdef PREM_MODE
 voteopts_t voteopts;
@@ -100,6 +500,12 @@ int32_t __tgt_rtl_init_device(int32_t device_id) {
   if (!initialized) {
     init_hero_device();
     initialized = true;
+    if (getenv("LIBOMPTARGET_PULP_STDOUT"))
+      log_drainer.start();
+    else
+      PulpLogDrainer::reset(false);
+    if (const char *path = getenv("LIBOMPTARGET_PULP_PROFILE"))
+      profile.open(path);
   }
   // init hero does not return failure
   return OFFLOAD_SUCCESS;
@@ -344,11 +750,14 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
     return NULL;
   }
 
-  // init argument buffers
-  host_arg_buf.reserve(ARG_BUF_SIZE); // memory leak
-  if (device_id == BIGPULP_MEMCPY) {
-    dev_arg_buf = __tgt_rtl_data_alloc(
-        device_id, ARG_BUF_SIZE * sizeof(uint64_t), host_arg_buf.data());
+  // init argument ring, shared by both devices
+  if (!arg_ring_virt) {
+    arg_ring_virt = (volatile uint64_t *)pulp_l3_malloc(
+        pulp, ARG_RING_SIZE * sizeof(uint64_t), &arg_ring_phys);
+    if (!arg_ring_virt) {
+      DP("failed to allocate the argument ring\n");
+      return NULL;
+    }
   }
 
 #ifdef PREM_MODE
@@ -373,6 +782,7 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
   __tgt_offload_entry *HostEnd = image->EntriesEnd;
   for (__tgt_offload_entry *e = HostBegin; e != HostEnd; ++e) {
     sym_vec->push_back(syms[e->name]);
+    profile.addKernel(sym_vec->back().addr, e->name);
   }
 
   table->EntriesBegin = &*sym_vec->begin();
@@ -388,7 +798,7 @@ void *__tgt_rtl_data_alloc(int32_t device_id, int64_t size, void *hst_ptr) {
   if (device_id == BIGPULP_SVM) {
     ptr = hst_ptr;
   } else {
-    ptr = GOMP_OFFLOAD_alloc(device_id, size);
+    ptr = memory_pool.allocate(device_id, size);
   }
   return ptr;
 }
@@ -421,31 +831,75 @@ int32_t __tgt_rtl_data_retrieve(int32_t device_id, void *hst_ptr, void *tgt_ptr,
              : OFFLOAD_FAIL;
 }
 
+// The host buffer must stay valid until the queue is synchronized.
+int32_t __tgt_rtl_data_submit_async(int32_t device_id, void *tgt_ptr,
+                                    void *hst_ptr, int64_t size,
+                                    __tgt_async_info *async_info) {
+  DP("__tgt_rtl_data_submit_async(device_id=%d, tgt_ptr=" DPxMOD
+     ", hst_ptr=" DPxMOD ", size=%lld\n",
+     device_id, DPxPTR(tgt_ptr), DPxPTR(hst_ptr), size);
+  assert(async_info && "async_info is nullptr");
+  if (device_id == BIGPULP_SVM) {
+    assert(hst_ptr == tgt_ptr);
+    return OFFLOAD_SUCCESS;
+  }
+  enqueue_copy(get_queue(async_info), (char *)l3_virt_ptr(tgt_ptr),
+               (const char *)hst_ptr, size);
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_retrieve_async(int32_t device_id, void *hst_ptr,
+                                      void *tgt_ptr, int64_t size,
+                                      __tgt_async_info *async_info) {
+  DP("__tgt_rtl_data_retrieve_async(device_id=%d, hst_ptr=" DPxMOD
+     ", tgt_ptr=" DPxMOD ", size=%lld\n",
+     device_id, DPxPTR(hst_ptr), DPxPTR(tgt_ptr), size);
+  assert(async_info && "async_info is nullptr");
+  if (device_id == BIGPULP_SVM) {
+    assert(hst_ptr == tgt_ptr);
+    return OFFLOAD_SUCCESS;
+  }
+  // libomptarget restores the shadow pointers of a retrieved struct right
+  // after this returns, a copy still queued behind a kernel would overwrite
+  // them. Retrieves thus complete before returning, after the operations
+  // issued on the queue before.
+  PulpQueueTy *queue = get_queue(async_info);
+  wait_for_copies(queue);
+  drain_queue(queue);
+  copy_chunked((char *)hst_ptr, (const char *)l3_virt_ptr(tgt_ptr), size);
+  return OFFLOAD_SUCCESS;
+}
+
 int32_t __tgt_rtl_data_delete(int32_t device_id, void *tgt_ptr) {
   DP("__tgt_rtl_data_delete(device_id=%d, tgt_ptr=" DPxMOD ")\n", device_id,
      DPxPTR(tgt_ptr));
   if (device_id == BIGPULP_SVM) {
     return OFFLOAD_SUCCESS;
   }
-  return GOMP_OFFLOAD_free(device_id, tgt_ptr) ? OFFLOAD_SUCCESS : OFFLOAD_FAIL;
+  return memory_pool.release(device_id, tgt_ptr) ? OFFLOAD_SUCCESS
+                                                : OFFLOAD_FAIL;
 }
 
-int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
-                                         void **tgt_args,
-                                         ptrdiff_t *tgt_offsets,
-                                         int32_t arg_num, int32_t team_num,
-                                         int32_t thread_limit,
-                                         uint64_t loop_tripcount) {
-  DP("__tgt_rtl_run_target_team_region(..)\n");
-
+// Stage the arguments and start the kernel, without waiting for it to finish.
+// The teams are distributed over the clusters, one team per cluster. If no
+// number of teams is requested, all clusters are used.
+static int32_t launch_kernel(int32_t device_id, void *tgt_entry_ptr,
+                             void **tgt_args, ptrdiff_t *tgt_offsets,
+                             int32_t arg_num, int32_t team_num,
+                             PulpQueueTy *queue) {
+  const unsigned num_clusters =
+      team_num > 0 ? std::min<unsigned>(team_num, PULP_HERO_NB_CLUSTERS)
+                   : PULP_HERO_NB_CLUSTERS;
+
+  size_t num_words = arg_num;
 #ifdef PREM_MODE
-  // disallow realloc
-  if (arg_num + 1 > ARG_BUF_SIZE) {
-    DP("argument buffer too large, max. number of args: %d\n",
-           ARG_BUF_SIZE - 1);
-    return OFFLOAD_FAIL;
-    }
+  // the channel is passed behind the arguments
+  ++num_words;
 #endif
+  if (num_words > ARG_RING_SIZE) {
+    DP("too many arguments, max. number of words: %d\n", ARG_RING_SIZE);
+    return OFFLOAD_FAIL;
+  }
 
   for (int32_t i = 0; i < arg_num; i++) {
     if (tgt_offsets[i] != 0) {
@@ -454,39 +908,56 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
     }
   }
 
-  host_arg_buf.clear();
-  DP("Offload Args (%p): ", host_arg_buf.data());
+  // The kernel must see the data copied before on its queue.
+  wait_for_copies(queue);
+
+  std::lock_guard<std::mutex> lock(pulp_mtx);
+  size_t begin = arg_ring_head;
+  if (begin + num_words > ARG_RING_SIZE)
+    begin = 0;
+  size_t end = begin + num_words;
+  // The running kernel may still read its arguments.
+  if (begin < running_args_end && running_args_begin < end)
+    wait_for_kernel();
+
+  volatile uint64_t *args = arg_ring_virt + begin;
+  DP("Offload Args (" DPxMOD "): ", DPxPTR((void *)args));
   for (int32_t i = 0; i < arg_num; i++) {
-    host_arg_buf.push_back((uint64_t)tgt_args[i]);
+    args[i] = (uint64_t)tgt_args[i];
     DP(DPxMOD ", ", DPxPTR((void *)tgt_args[i]));
   }
   DP("\n");
 
 #ifdef PREM_MODE
-  host_arg_buf.push_back(((uint32_t)channel_phys));
+  args[arg_num] = (uint32_t)channel_phys;
   DP(DPxMOD ", ", DPxPTR((void*) channel_phys));
 #endif
+  arg_ring_head = end;
+  const uintptr_t dev_args = arg_ring_phys + begin * sizeof(uint64_t);
 
-  void *host_buf = host_arg_buf.data();
-  if (device_id == BIGPULP_SVM) {
-    // FIXME: assumes the host buf is in 32-bit range for now
-    dev_arg_buf = host_buf;
-  } else {
-    size_t size = sizeof(uint64_t) * host_arg_buf.size();
+  // The mailbox takes one kernel at a time.
+  wait_for_kernel();
+  // The arguments must be visible to PULP before the start command.
+  __sync_synchronize();
 
-    DP("copying argbuf from host buffer " DPxMOD " to device buffer: " DPxMOD
-       "\n",
-       DPxPTR(host_buf), DPxPTR(dev_arg_buf));
-    __tgt_rtl_data_submit(device_id, dev_arg_buf, host_buf, size);
-  }
+  if (profile.enabled())
+    profile.launched(tgt_entry_ptr);
 
-  // instruct PULP to run the offload function
-  DP("Start offloading...\n");
-  pulp_mbox_write(pulp, PULP_START);
-  pulp_mbox_write(pulp, (uint32_t)tgt_entry_ptr);
-  pulp_mbox_write(pulp, (uint32_t)dev_arg_buf);
+  // instruct PULP to run the offload function, with one start message per
+  // cluster. On a SoC with several clusters, the message also carries the
+  // team of the cluster and the number of teams.
+  DP("Start offloading on %u cluster(s)...\n", num_clusters);
   const uint32_t num_miss_handler_threads = (device_id == BIGPULP_SVM) ? 1 : 0;
-  pulp_mbox_write(pulp, num_miss_handler_threads);
+  for (unsigned c = 0; c < num_clusters; ++c) {
+    pulp_mbox_write(pulp, PULP_START);
+    pulp_mbox_write(pulp, (uint32_t)tgt_entry_ptr);
+    pulp_mbox_write(pulp, (uint32_t)dev_args);
+    pulp_mbox_write(pulp, num_miss_handler_threads);
+    if (PULP_HERO_NB_CLUSTERS > 1) {
+      pulp_mbox_write(pulp, c);
+      pulp_mbox_write(pulp, num_clusters);
+    }
+  }
 
 #ifdef PREM_MODE
   // synchronize with CMUX
@@ -496,33 +967,43 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
   DP("Done PREM sync\n");
 #endif
 
-  uint32_t ret[2];
-  while (pulp_mbox_read(pulp, (unsigned int *)&ret[0], 1));
-  assert(ret[0] == 4 /* PULP_DONE */ &&
-         "Software mailbox protocol failure: Expected PULP_DONE.");
-  while (pulp_mbox_read(pulp, (unsigned int *)&ret[1], 1));
-
-  for (unsigned i = 0; i < ARCHI_CLUSTER_NB_PE; ++i) {
-    const size_t stdout_buf_size = 1024*1024; // FIXME: this should be defined in the same place as
-                                              // for PULP
-    const size_t stdout_offset_per_core = stdout_buf_size / ARCHI_CLUSTER_NB_PE;
-    const volatile char* ptr = (char*)pulp->l3_mem.v_addr + stdout_offset_per_core * i;
-    const volatile char* const end = ptr + stdout_offset_per_core;
-    if (!*ptr)
-      continue;
-    printf(">>> PRINTING BUFFER OF CORE %d:\n", i);
-    while (*ptr && ptr < end) {
-      printf("%c", *ptr);
-      ++ptr;
-    }
-    printf("<<< END OF BUFFER\n");
-  }
+  queue->KernelPending = true;
+  running_queue = queue;
+  running_clusters = num_clusters;
+  running_args_begin = begin;
+  running_args_end = end;
+  return OFFLOAD_SUCCESS;
+}
 
-  printf("Done offloading, cycles to execute kernel: %d!\n", (int)ret[1]);
+int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
+                                         void **tgt_args,
+                                         ptrdiff_t *tgt_offsets,
+                                         int32_t arg_num, int32_t team_num,
+                                         int32_t thread_limit,
+                                         uint64_t loop_tripcount) {
+  DP("__tgt_rtl_run_target_team_region(..)\n");
 
+  PulpQueueTy queue;
+  int32_t ret = launch_kernel(device_id, tgt_entry_ptr, tgt_args, tgt_offsets,
+                              arg_num, team_num, &queue);
+  if (ret != OFFLOAD_SUCCESS)
+    return ret;
+  drain_queue(&queue);
   return OFFLOAD_SUCCESS;
 }
 
+int32_t __tgt_rtl_run_target_team_region_async(
+    int32_t device_id, void *tgt_entry_ptr, void **tgt_args,
+    ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
+    int32_t thread_limit, uint64_t loop_tripcount,
+    __tgt_async_info *async_info) {
+  DP("__tgt_rtl_run_target_team_region_async(..)\n");
+  assert(async_info && "async_info is nullptr");
+
+  return launch_kernel(device_id, tgt_entry_ptr, tgt_args, tgt_offsets,
+                       arg_num, team_num, get_queue(async_info));
+}
+
 int32_t __tgt_rtl_run_target_region(int32_t device_id, void *tgt_entry_ptr,
                                     void **tgt_args, ptrdiff_t *tgt_offsets,
                                     int32_t arg_num) {
@@ -535,6 +1016,32 @@ int32_t __tgt_rtl_run_target_region(int32_t device_id, void *tgt_entry_ptr,
                                           thread_limit, 0);
 }
 
+int32_t __tgt_rtl_run_target_region_async(int32_t device_id,
+                                          void *tgt_entry_ptr, void **tgt_args,
+                                          ptrdiff_t *tgt_offsets,
+                                          int32_t arg_num,
+                                          __tgt_async_info *async_info) {
+  DP("__tgt_rtl_run_target_region_async(..)\n");
+  // use one team and the default number of threads.
+  const int32_t team_num = 1;
+  const int32_t thread_limit = 0;
+  return __tgt_rtl_run_target_team_region_async(
+      device_id, tgt_entry_ptr, tgt_args, tgt_offsets, arg_num, team_num,
+      thread_limit, 0, async_info);
+}
+
+int32_t __tgt_rtl_synchronize(int32_t device_id, __tgt_async_info *async_info) {
+  DP("__tgt_rtl_synchronize(device_id=%d)\n", device_id);
+  assert(async_info && "async_info is nullptr");
+
+  PulpQueueTy *queue = static_cast<PulpQueueTy *>(async_info->Queue);
+  wait_for_copies(queue);
+  drain_queue(queue);
+  delete queue;
+  async_info->Queue = nullptr;
+  return OFFLOAD_SUCCESS;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -372,6 +372,9 @@ enum sched_type : kmp_int32 {
   kmp_sch_guided_simd = 46, /**< guided with chunk adjustment */
   kmp_sch_runtime_simd = 47, /**< runtime with chunk adjustment */
 
+  /* accessible only through OMP_SCHEDULE environment variable */
+  kmp_sch_adaptive = 48, /**< dynamic with chunk size adjusted at run time */
+
   /* accessible only through KMP_SCHEDULE environment variable */
   kmp_sch_upper, /**< upper bound for unordered values */
 
@@ -963,6 +966,7 @@ typedef struct kmp_allocator_t {
   kmp_allocator_t *fb_data;
   kmp_uint64 pool_size;
   kmp_uint64 pool_used;
+  omp_alloctrait_value_t partition; // placed by libnuma if non-zero
 } kmp_allocator_t;
 
 extern omp_allocator_handle_t __kmpc_init_allocator(int gtid,
@@ -982,6 +986,8 @@ extern void __kmpc_free(int gtid, void *ptr, omp_allocator_handle_t al);
 
 extern void __kmp_init_memkind();
 extern void __kmp_fini_memkind();
+extern void __kmp_init_libnuma();
+extern void __kmp_fini_libnuma();
 
 /* ------------------------------------------------------------------------ */
 
@@ -1748,6 +1754,14 @@ typedef struct KMP_ALIGN_CACHE dispatch_private_info64 {
 } dispatch_private_info64_t;
 #endif /* KMP_STATIC_STEAL_ENABLED */
 
+// Feedback the adaptive schedule keeps per thread and loop. The times are in
+// the units of KMP_TIMESTAMP().
+typedef struct dispatch_adaptive_info {
+  kmp_uint64 chunk_start; // when the thread got its current chunk
+  double iter_time; // smoothed execution time of one iteration
+  double sched_time; // smoothed time to get a chunk
+} dispatch_adaptive_info_t;
+
 typedef struct KMP_ALIGN_CACHE dispatch_private_info {
   union private_info {
     dispatch_private_info32_t p32;
@@ -1766,6 +1780,7 @@ typedef struct KMP_ALIGN_CACHE dispatch_private_info {
   void *parent; /* hierarchical scheduling parent pointer */
 #endif
   enum cons_type pushed_ws;
+  dispatch_adaptive_info_t adaptive; /* kmp_sch_adaptive only */
 } dispatch_private_info_t;
 
 typedef struct dispatch_shared_info32 {
@@ -2209,6 +2224,12 @@ typedef struct kmp_task { /* GEH: Shouldn't this be aligned somehow? */
 @}
 */
 
+// Time spent in an adaptive taskloop, in the units of KMP_TIMESTAMP()
+typedef struct kmp_taskloop_timing {
+  std::atomic<kmp_uint64> exec_time; // executing the chunk tasks
+  std::atomic<kmp_uint64> create_time; // creating the chunk tasks
+} kmp_taskloop_timing_t;
+
 typedef struct kmp_taskgroup {
   std::atomic<kmp_int32> count; // number of allocated and incomplete tasks
   std::atomic<kmp_int32>
@@ -2217,6 +2238,8 @@ typedef struct kmp_taskgroup {
   // Block of data to perform task reduction
   void *reduce_data; // reduction related info
   kmp_int32 reduce_num_data; // number of data items to reduce
+  // Timing of the adaptive taskloop owning this taskgroup, NULL otherwise
+  kmp_taskloop_timing_t *taskloop_timing;
 } kmp_taskgroup_t;
 
 // forward declarations
@@ -2351,7 +2374,8 @@ typedef struct kmp_tasking_flags { /* Total struct must be exactly 32 bits */
   unsigned complete : 1; /* 1==complete, 0==not complete   */
   unsigned freed : 1; /* 1==freed, 0==allocated        */
   unsigned native : 1; /* 1==gcc-compiled task, 0==intel */
-  unsigned reserved31 : 7; /* reserved for library use */
+  unsigned taskloop_timed : 1; /* 1==adaptive taskloop chunk, time it */
+  unsigned reserved31 : 6; /* reserved for library use */
 
 } kmp_tasking_flags_t;
 
@@ -2414,13 +2438,22 @@ typedef struct kmp_base_thread_data {
   kmp_info_p *td_thr; // Pointer back to thread info
   // Used only in __kmp_execute_tasks_template, maybe not avail until task is
   // queued?
+  // The owner pushes and pops tasks at the tail without taking the lock.
+  // Other threads take the lock and remove tasks at the head with a CAS, as
+  // in a Chase-Lev deque. Threads other than the owner that need to change
+  // the tail or the middle of the deque additionally enter the exclusive mode
+  // (see __kmp_deque_acquire_exclusive), which keeps the owner on the locked
+  // path.
   kmp_bootstrap_lock_t td_deque_lock; // Lock for accessing deque
   kmp_taskdata_t *
       *td_deque; // Deque of tasks encountered by td_thr, dynamically allocated
   kmp_int32 td_deque_size; // Size of deck
-  kmp_uint32 td_deque_head; // Head of deque (will wrap)
-  kmp_uint32 td_deque_tail; // Tail of deque (will wrap)
-  kmp_int32 td_deque_ntasks; // Number of tasks in deque
+  // Head and tail count the tasks ever removed at the head and pushed at the
+  // tail, the slot of a counter is counter & TASK_DEQUE_MASK.
+  std::atomic<kmp_uint32> td_deque_head; // Head of deque
+  std::atomic<kmp_uint32> td_deque_tail; // Tail of deque
+  std::atomic<kmp_int32> td_deque_owner_busy; // Owner is on the lock-free path
+  std::atomic<kmp_int32> td_deque_exclusive; // Owner must take the lock
   // GEH: shouldn't this be volatile since used in while-spin?
   kmp_int32 td_deque_last_stolen; // Thread number of last successful steal
 #ifdef BUILD_TIED_TASK_STACK
@@ -2435,6 +2468,16 @@ typedef struct kmp_base_thread_data {
 #define TASK_DEQUE_SIZE(td) ((td).td_deque_size)
 #define TASK_DEQUE_MASK(td) ((td).td_deque_size - 1)
 
+// Number of tasks in a deque. Exact for the owner outside of its own push and
+// pop, and under the deque lock in the exclusive mode; an estimate otherwise.
+static inline kmp_int32 __kmp_deque_ntasks(kmp_base_thread_data_t *td) {
+  kmp_uint32 tail = KMP_ATOMIC_LD_ACQ(&td->td_deque_tail);
+  kmp_uint32 head = KMP_ATOMIC_LD_ACQ(&td->td_deque_head);
+  kmp_int32 ntasks = (kmp_int32)(tail - head);
+  // A thief may have taken the last task while the owner was popping it.
+  return ntasks < 0 ? 0 : ntasks;
+}
+
 typedef union KMP_ALIGN_CACHE kmp_thread_data {
   kmp_base_thread_data_t td;
   double td_align; /* use worst case alignment */
@@ -2865,6 +2908,8 @@ extern int __kmp_forkjoin_frames_mode;
 #endif
 extern PACKED_REDUCTION_METHOD_T __kmp_force_reduction_method;
 extern int __kmp_determ_red;
+/* Team size above which reductions use the barrier tree, 0 for the default */
+extern int __kmp_reduction_tree_threshold;
 
 #ifdef KMP_DEBUG
 extern int kmp_a_debug;
@@ -2949,6 +2994,8 @@ extern char const *__kmp_barrier_branch_bit_env_name[bs_last_barrier];
 extern char const *__kmp_barrier_pattern_env_name[bs_last_barrier];
 extern char const *__kmp_barrier_type_name[bs_last_barrier];
 extern char const *__kmp_barrier_pattern_name[bp_last_bar];
+extern int __kmp_barrier_auto; /* pick barriers from the machine topology? */
+extern int __kmp_env_barrier[bs_last_barrier]; /* KMP_*_BARRIER* specified? */
 
 /* Global Locks */
 extern kmp_bootstrap_lock_t __kmp_initz_lock; /* control initialization */
@@ -3457,6 +3504,8 @@ extern int __kmp_aux_set_affinity_mask_proc(int proc, void **mask);
 extern int __kmp_aux_unset_affinity_mask_proc(int proc, void **mask);
 extern int __kmp_aux_get_affinity_mask_proc(int proc, void **mask);
 extern void __kmp_balanced_affinity(kmp_info_t *th, int team_size);
+extern int __kmp_affinity_get_shape(int *packages, int *cores_per_pkg,
+                                    int *threads_per_core);
 #if KMP_OS_LINUX || KMP_OS_FREEBSD
 extern int kmp_set_thread_affinity_mask_initial(void);
 #endif
@@ -3559,6 +3608,7 @@ extern int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
                          void (*reduce)(void *, void *));
 extern void __kmp_end_split_barrier(enum barrier_type bt, int gtid);
 extern int __kmp_barrier_gomp_cancel(int gtid);
+extern void __kmp_barrier_auto_select(void);
 
 /*!
  * Tell the fork call which compiler generated the fork call, and therefore how
@@ -3652,6 +3702,15 @@ extern void __kmp_tasking_barrier(kmp_team_t *team, kmp_info_t *thread,
 extern int __kmp_is_address_mapped(void *addr);
 extern kmp_uint64 __kmp_hardware_timestamp(void);
 
+// Cheap time stamp in unspecified units, used by the heuristics that adapt to
+// measured execution times
+#if KMP_ARCH_X86 || KMP_ARCH_X86_64
+#define KMP_TIMESTAMP() __kmp_hardware_timestamp()
+#else
+extern kmp_uint64 __kmp_now_nsec();
+#define KMP_TIMESTAMP() __kmp_now_nsec()
+#endif
+
 #if KMP_OS_UNIX
 extern int __kmp_read_from_file(char const *path, char const *format, ...);
 #endif
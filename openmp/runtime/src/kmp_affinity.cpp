@@ -4576,6 +4576,20 @@ static void __kmp_aux_affinity_initialize(void) {
 }
 #undef KMP_EXIT_AFF_NONE
 
+// Report the shape of the machine found by the topology detection. Returns
+// FALSE if no topology was detected or the threads are not bound to it, in
+// which case the machine hierarchy is not built from the topology either.
+int __kmp_affinity_get_shape(int *packages, int *cores_per_pkg,
+                             int *threads_per_core) {
+  if (address2os == NULL || nPackages <= 0 || nCoresPerPkg <= 0 ||
+      __kmp_nThreadsPerCore <= 0)
+    return FALSE;
+  *packages = nPackages;
+  *cores_per_pkg = nCoresPerPkg;
+  *threads_per_core = __kmp_nThreadsPerCore;
+  return TRUE;
+}
+
 void __kmp_affinity_initialize(void) {
   // Much of the code above was written assuming that if a machine was not
   // affinity capable, then __kmp_affinity_type == affinity_none.  We now
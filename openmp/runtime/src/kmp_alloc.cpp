@@ -1339,6 +1339,145 @@ void __kmp_fini_memkind() {
 #endif
 }
 
+/* libnuma API used for the partition trait: */
+static void *h_libnuma;
+// numa_available
+static int (*kmp_numa_available)(void);
+// numa_max_node
+static int (*kmp_numa_max_node)(void);
+// numa_node_size64
+static long long (*kmp_numa_node_size64)(int node, long long *freep);
+// numa_pagesize
+static int (*kmp_numa_pagesize)(void);
+// numa_alloc
+static void *(*kmp_numa_alloc)(size_t size);
+// numa_alloc_local
+static void *(*kmp_numa_alloc_local)(size_t size);
+// numa_alloc_interleaved
+static void *(*kmp_numa_alloc_interleaved)(size_t size);
+// numa_tonode_memory
+static void (*kmp_numa_tonode_memory)(void *start, size_t size, int node);
+// numa_free
+static void (*kmp_numa_free)(void *start, size_t size);
+// nodes that have memory, in increasing order
+static int *kmp_numa_nodes;
+static int kmp_numa_num_nodes;
+static size_t kmp_numa_page_size;
+
+void __kmp_init_libnuma() {
+#if KMP_OS_LINUX && KMP_DYNAMIC_LIB
+  // load libnuma at run time as for memkind, so that libomp does not depend
+  // on it
+  h_libnuma = dlopen("libnuma.so.1", RTLD_LAZY);
+  if (h_libnuma) {
+    kmp_numa_available = (int (*)(void))dlsym(h_libnuma, "numa_available");
+    kmp_numa_max_node = (int (*)(void))dlsym(h_libnuma, "numa_max_node");
+    kmp_numa_node_size64 = (long long (*)(int, long long *))dlsym(
+        h_libnuma, "numa_node_size64");
+    kmp_numa_pagesize = (int (*)(void))dlsym(h_libnuma, "numa_pagesize");
+    kmp_numa_alloc = (void *(*)(size_t))dlsym(h_libnuma, "numa_alloc");
+    kmp_numa_alloc_local =
+        (void *(*)(size_t))dlsym(h_libnuma, "numa_alloc_local");
+    kmp_numa_alloc_interleaved =
+        (void *(*)(size_t))dlsym(h_libnuma, "numa_alloc_interleaved");
+    kmp_numa_tonode_memory = (void (*)(void *, size_t, int))dlsym(
+        h_libnuma, "numa_tonode_memory");
+    kmp_numa_free = (void (*)(void *, size_t))dlsym(h_libnuma, "numa_free");
+    if (kmp_numa_available && kmp_numa_max_node && kmp_numa_node_size64 &&
+        kmp_numa_pagesize && kmp_numa_alloc && kmp_numa_alloc_local &&
+        kmp_numa_alloc_interleaved && kmp_numa_tonode_memory &&
+        kmp_numa_free && kmp_numa_available() != -1) {
+      int max_node = kmp_numa_max_node();
+      kmp_numa_nodes =
+          (int *)__kmp_allocate(sizeof(int) * (size_t)(max_node + 1));
+      kmp_numa_num_nodes = 0;
+      for (int node = 0; node <= max_node; ++node) {
+        // skip the nodes without memory (CPU-only nodes)
+        if (kmp_numa_node_size64(node, NULL) > 0)
+          kmp_numa_nodes[kmp_numa_num_nodes++] = node;
+      }
+      kmp_numa_page_size = (size_t)kmp_numa_pagesize();
+      if (kmp_numa_num_nodes > 0) {
+        KE_TRACE(25, ("__kmp_init_libnuma: libnuma initialized, %d nodes\n",
+                      kmp_numa_num_nodes));
+        return;
+      }
+      __kmp_free(kmp_numa_nodes);
+    }
+    dlclose(h_libnuma); // failure
+  }
+#endif // KMP_OS_LINUX && KMP_DYNAMIC_LIB
+  h_libnuma = NULL;
+  kmp_numa_nodes = NULL;
+  kmp_numa_num_nodes = 0;
+  kmp_numa_free = NULL;
+}
+
+void __kmp_fini_libnuma() {
+#if KMP_OS_LINUX && KMP_DYNAMIC_LIB
+  if (h_libnuma) {
+    KE_TRACE(25, ("__kmp_fini_libnuma: finalize libnuma\n"));
+    dlclose(h_libnuma);
+    h_libnuma = NULL;
+  }
+  if (kmp_numa_nodes) {
+    __kmp_free(kmp_numa_nodes);
+    kmp_numa_nodes = NULL;
+  }
+  kmp_numa_num_nodes = 0;
+  kmp_numa_free = NULL;
+#endif
+}
+
+// Blocks smaller than this are taken from the per-thread bget pool: the pool
+// is first touched by its owner, so its pages are on the node of the thread,
+// and a block below one page per node cannot be spread over the nodes anyway.
+static inline size_t __kmp_numa_pool_limit(const kmp_allocator_t *al) {
+  if (al->partition == omp_atv_nearest)
+    return kmp_numa_page_size;
+  return kmp_numa_page_size * kmp_numa_num_nodes;
+}
+
+// Allocates size bytes with the placement requested by the partition trait
+// of the allocator.
+static void *__kmp_numa_alloc(int gtid, const kmp_allocator_t *al,
+                              size_t size) {
+  if (size < __kmp_numa_pool_limit(al))
+    return __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), size);
+  switch (al->partition) {
+  case omp_atv_nearest:
+    return kmp_numa_alloc_local(size);
+  case omp_atv_interleaved:
+    return kmp_numa_alloc_interleaved(size);
+  case omp_atv_blocked: {
+    // one contiguous block per node, each a whole number of pages
+    char *ptr = (char *)kmp_numa_alloc(size);
+    if (ptr == NULL)
+      return NULL;
+    size_t pages = (size + kmp_numa_page_size - 1) / kmp_numa_page_size;
+    size_t block =
+        (pages + kmp_numa_num_nodes - 1) / kmp_numa_num_nodes *
+        kmp_numa_page_size;
+    for (int i = 0; i < kmp_numa_num_nodes && i * block < size; ++i) {
+      size_t len = size - i * block < block ? size - i * block : block;
+      kmp_numa_tonode_memory(ptr + i * block, len, kmp_numa_nodes[i]);
+    }
+    return ptr;
+  }
+  default:
+    KMP_ASSERT2(0, "Unexpected partition");
+  }
+  return NULL;
+}
+
+static void __kmp_numa_free(int gtid, const kmp_allocator_t *al, void *ptr,
+                            size_t size) {
+  if (size < __kmp_numa_pool_limit(al))
+    __kmp_thread_free(__kmp_thread_from_gtid(gtid), ptr);
+  else
+    kmp_numa_free(ptr, size);
+}
+
 omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
                                              int ntraits,
                                              omp_alloctrait_t traits[]) {
@@ -1388,6 +1527,18 @@ omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
   } else if (al->fb == omp_atv_default_mem_fb) {
     al->fb_data = (kmp_allocator_t *)omp_default_mem_alloc;
   }
+  if (kmp_numa_num_nodes > 0 && ms != omp_high_bw_mem_space &&
+      ms != omp_large_cap_mem_space &&
+      (al->memkind == (void *)omp_atv_nearest ||
+       al->memkind == (void *)omp_atv_blocked ||
+       (al->memkind == (void *)omp_atv_interleaved &&
+        !(__kmp_memkind_available && mk_interleave)))) {
+    // Place the memory with libnuma; memkind has no kinds for these
+    // partitions of the default memory space besides interleaved.
+    al->partition = (omp_alloctrait_value_t)(kmp_uintptr_t)al->memkind;
+    al->memkind = mk_default;
+    return (omp_allocator_handle_t)al;
+  }
   if (__kmp_memkind_available) {
     // Let's use memkind library if available
     if (ms == omp_high_bw_mem_space) {
@@ -1512,7 +1663,8 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
         } // else ptr == NULL;
       } else {
         // pool has enough space
-        ptr = kmp_mk_alloc(*al->memkind, desc.size_a);
+        ptr = al->partition ? __kmp_numa_alloc(gtid, al, desc.size_a)
+                            : kmp_mk_alloc(*al->memkind, desc.size_a);
         if (ptr == NULL) {
           if (al->fb == omp_atv_default_mem_fb) {
             al = (kmp_allocator_t *)omp_default_mem_alloc;
@@ -1528,7 +1680,8 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
       }
     } else {
       // custom allocator, pool size not requested
-      ptr = kmp_mk_alloc(*al->memkind, desc.size_a);
+      ptr = al->partition ? __kmp_numa_alloc(gtid, al, desc.size_a)
+                          : kmp_mk_alloc(*al->memkind, desc.size_a);
       if (ptr == NULL) {
         if (al->fb == omp_atv_default_mem_fb) {
           al = (kmp_allocator_t *)omp_default_mem_alloc;
@@ -1570,14 +1723,18 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
       } // else ptr == NULL;
     } else {
       // pool has enough space
-      ptr = __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), desc.size_a);
+      ptr = al->partition ? __kmp_numa_alloc(gtid, al, desc.size_a)
+                          : __kmp_thread_malloc(__kmp_thread_from_gtid(gtid),
+                                                desc.size_a);
       if (ptr == NULL && al->fb == omp_atv_abort_fb) {
         KMP_ASSERT(0); // abort fallback requested
       } // no sense to look for another fallback because of same internal alloc
     }
   } else {
     // custom allocator, pool size not requested
-    ptr = __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), desc.size_a);
+    ptr = al->partition
+              ? __kmp_numa_alloc(gtid, al, desc.size_a)
+              : __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), desc.size_a);
     if (ptr == NULL && al->fb == omp_atv_abort_fb) {
       KMP_ASSERT(0); // abort fallback requested
     } // no sense to look for another fallback because of same internal alloc
@@ -1715,7 +1872,10 @@ void __kmpc_free(int gtid, void *ptr, const omp_allocator_handle_t allocator) {
         (void)used; // to suppress compiler warning
         KMP_DEBUG_ASSERT(used >= desc.size_a);
       }
-      kmp_mk_free(*al->memkind, desc.ptr_alloc);
+      if (al->partition)
+        __kmp_numa_free(gtid, al, desc.ptr_alloc, desc.size_a);
+      else
+        kmp_mk_free(*al->memkind, desc.ptr_alloc);
     }
   } else {
     if (oal > kmp_max_mem_alloc && al->pool_size > 0) {
@@ -1724,7 +1884,10 @@ void __kmpc_free(int gtid, void *ptr, const omp_allocator_handle_t allocator) {
       (void)used; // to suppress compiler warning
       KMP_DEBUG_ASSERT(used >= desc.size_a);
     }
-    __kmp_thread_free(__kmp_thread_from_gtid(gtid), desc.ptr_alloc);
+    if (oal > kmp_max_mem_alloc && al->partition)
+      __kmp_numa_free(gtid, al, desc.ptr_alloc, desc.size_a);
+    else
+      __kmp_thread_free(__kmp_thread_from_gtid(gtid), desc.ptr_alloc);
   }
   KE_TRACE(10, ("__kmpc_free: T#%d freed %p (%p)\n", gtid, desc.ptr_alloc,
                 allocator));
@@ -1597,6 +1597,49 @@ static int __kmp_barrier_template(enum barrier_type bt, int gtid, int is_split,
 }
 
 // Returns 0 if master thread, 1 if worker thread.
+// Pick the barrier patterns from the machine topology (KMP_BARRIER_AUTO).
+// Called once the topology is known, i.e. after __kmp_affinity_initialize().
+// Barrier types whose pattern or branch bits were set in the environment are
+// left alone.
+// On machines with more than one package, the hierarchical barrier builds its
+// tree from the machine hierarchy: the threads of a core signal their parent
+// through the bytes of one on-core flag, and only one thread per core and per
+// package touches the cache lines of the next level. This keeps most of the
+// barrier traffic inside a cache domain, whereas the hyper barrier pairs
+// threads by tid and crosses the package boundary at every level above the
+// branch factor. On a single package the defaults are kept, and so they are
+// when the threads are not bound to the topology.
+void __kmp_barrier_auto_select(void) {
+  int packages = 0, cores_per_pkg = 0, threads_per_core = 0;
+
+  if (!__kmp_barrier_auto)
+    return;
+#if KMP_AFFINITY_SUPPORTED
+  if (!__kmp_affinity_get_shape(&packages, &cores_per_pkg, &threads_per_core))
+#endif
+  {
+    KA_TRACE(10, ("__kmp_barrier_auto_select: no machine topology, keeping "
+                  "the default barriers\n"));
+    return;
+  }
+  KA_TRACE(10, ("__kmp_barrier_auto_select: %d packages x %d cores x %d "
+                "threads\n",
+                packages, cores_per_pkg, threads_per_core));
+  if (packages < 2)
+    return;
+
+  for (int i = bs_plain_barrier; i < bs_last_barrier; i++) {
+    if (__kmp_env_barrier[i])
+      continue;
+    __kmp_barrier_gather_pattern[i] = bp_hierarchical_bar;
+    __kmp_barrier_release_pattern[i] = bp_hierarchical_bar;
+    KA_TRACE(10, ("__kmp_barrier_auto_select: %s barrier uses the %s "
+                  "pattern\n",
+                  __kmp_barrier_type_name[i],
+                  __kmp_barrier_pattern_name[bp_hierarchical_bar]));
+  }
+}
+
 int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
                   size_t reduce_size, void *reduce_data,
                   void (*reduce)(void *, void *)) {
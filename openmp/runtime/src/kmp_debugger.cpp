@@ -210,7 +210,7 @@ kmp_omp_struct_info_t __kmp_omp_debug_struct_info = {
     offset_and_size_of(kmp_base_thread_data_t, td_deque_size),
     offset_and_size_of(kmp_base_thread_data_t, td_deque_head),
     offset_and_size_of(kmp_base_thread_data_t, td_deque_tail),
-    offset_and_size_of(kmp_base_thread_data_t, td_deque_ntasks),
+    offset_and_size_not_available, // ntasks is tail - head
     offset_and_size_of(kmp_base_thread_data_t, td_deque_last_stolen),
 
     // The last field.
@@ -649,6 +649,30 @@ void __kmp_dispatch_init_algorithm(ident_t *loc, int gtid,
                    "kmp_sch_static_chunked/kmp_sch_dynamic_chunked cases\n",
                    gtid));
     break;
+  case kmp_sch_adaptive:
+    if (pr->u.p.parm1 <= 0) {
+      pr->u.p.parm1 = KMP_DEFAULT_CHUNK;
+    }
+    if (nproc > 1 && !pr->flags.ordered) {
+      KD_TRACE(100,
+               ("__kmp_dispatch_init_algorithm: T#%d kmp_sch_adaptive case\n",
+                gtid));
+      // parm1: smallest chunk, parm2: size of the next chunk, parm3: size of
+      // the chunk being executed
+      pr->u.p.parm2 = pr->u.p.parm1;
+      pr->u.p.parm3 = 0;
+      pr->adaptive.chunk_start = 0;
+      pr->adaptive.iter_time = 0.0;
+      pr->adaptive.sched_time = 0.0;
+    } else {
+      // Nothing to balance with one thread, and ordered chunks are handed out
+      // in order anyway.
+      KD_TRACE(100, ("__kmp_dispatch_init_algorithm: T#%d falling back from "
+                     "kmp_sch_adaptive to kmp_sch_dynamic_chunked\n",
+                     gtid));
+      schedule = kmp_sch_dynamic_chunked;
+    }
+    break;
   case kmp_sch_trapezoidal: {
     /* TSS: trapezoid self-scheduling, minimum chunk_size = parm1 */
 
@@ -927,6 +951,7 @@ __kmp_dispatch_init(ident_t *loc, int gtid, enum sched_type schedule, T lb,
         cur_chunk = pr->u.p.parm1;
         break;
       case kmp_sch_dynamic_chunked:
+      case kmp_sch_adaptive:
         schedtype = 1;
         break;
       case kmp_sch_guided_iterative_chunked:
@@ -1527,6 +1552,76 @@ int __kmp_dispatch_next_algorithm(int gtid,
   } // case
   break;
 
+  case kmp_sch_adaptive: {
+    // The time since the previous call is the execution time of the previous
+    // chunk, the time spent in the atomic increment is the cost of getting a
+    // chunk, which grows with the contention on the shared iteration count.
+    // Both feed the size of the next chunk.
+    dispatch_adaptive_info_t *ai = &pr->adaptive;
+    T chunk = pr->u.p.parm2;
+    kmp_uint64 now = KMP_TIMESTAMP();
+    ST remaining; // signed, because can be < 0
+
+    KD_TRACE(100,
+             ("__kmp_dispatch_next_algorithm: T#%d kmp_sch_adaptive case\n",
+              gtid));
+    if (pr->u.p.parm3 > 0) {
+      double iter_time =
+          (double)(now - ai->chunk_start) / (double)pr->u.p.parm3;
+      ai->iter_time = ai->iter_time > 0.0
+                          ? (3.0 * ai->iter_time + iter_time) / 4.0
+                          : iter_time;
+      pr->u.p.parm3 = 0;
+    }
+    init = test_then_add<ST>(RCAST(volatile ST *, &sh->u.s.iteration),
+                             (ST)chunk);
+    ai->chunk_start = KMP_TIMESTAMP();
+    double sched_time = (double)(ai->chunk_start - now);
+    ai->sched_time = ai->sched_time > 0.0
+                         ? (3.0 * ai->sched_time + sched_time) / 4.0
+                         : sched_time;
+    trip = pr->u.p.tc;
+    remaining = trip - init;
+    if ((status = (remaining > 0)) == 0) {
+      *p_lb = 0;
+      *p_ub = 0;
+      if (p_st != NULL)
+        *p_st = 0;
+    } else {
+      if ((last = ((T)remaining <= chunk)) != 0) {
+        limit = trip - 1;
+      } else {
+        limit = init + chunk - 1;
+      }
+      pr->u.p.parm3 = limit - init + 1;
+
+      // size of the next chunk
+      double target = 2.0 * chunk;
+      if (ai->iter_time > 0.0) {
+        target = adaptive_sched_ratio * ai->sched_time / ai->iter_time;
+        if (target > 2.0 * chunk)
+          target = 2.0 * chunk;
+        else if (target < 0.5 * chunk)
+          target = 0.5 * chunk;
+      }
+      // keep the end of the loop balanced
+      double cap = (double)(remaining - pr->u.p.parm3) /
+                   (adaptive_int_param * (double)nproc);
+      if (target > cap)
+        target = cap;
+      pr->u.p.parm2 =
+          target > (double)pr->u.p.parm1 ? (T)target : pr->u.p.parm1;
+
+      start = pr->u.p.lb;
+      incr = pr->u.p.st;
+      if (p_st != NULL)
+        *p_st = incr;
+      *p_lb = start + init * incr;
+      *p_ub = start + limit * incr;
+    } // if
+  } // case
+  break;
+
   case kmp_sch_guided_iterative_chunked: {
     T chunkspec = pr->u.p.parm1;
     KD_TRACE(100, ("__kmp_dispatch_next_algorithm: T#%d kmp_sch_guided_chunked "
@@ -147,6 +147,7 @@ template <typename T> struct KMP_ALIGN_CACHE dispatch_private_info_template {
   kmp_hier_top_unit_t<T> *get_parent() { return hier_parent; }
 #endif
   enum cons_type pushed_ws;
+  dispatch_adaptive_info_t adaptive; // kmp_sch_adaptive only
 };
 
 // replaces dispatch_shared_info{32,64} structures and
@@ -503,4 +504,12 @@ __kmp_dispatch_guided_remaining(T tc, typename traits_t<T>::floating_t base,
 // With n = 1 first chunk is the same as for static schedule, e.g. trip / nproc.
 static const int guided_int_param = 2;
 static const double guided_flt_param = 0.5; // = 1.0 / guided_int_param;
+
+// Parameters of the adaptive algorithm: the chunk size is chosen so that
+// executing a chunk takes adaptive_sched_ratio times as long as getting it,
+// changes by at most a factor of two from one chunk to the next, and leaves
+// at least adaptive_int_param * nproc chunks of that size for the end of the
+// loop.
+static const double adaptive_sched_ratio = 64.0;
+static const int adaptive_int_param = 2;
 #endif // KMP_DISPATCH_H
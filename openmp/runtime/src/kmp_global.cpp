@@ -112,6 +112,8 @@ char const *__kmp_barrier_type_name[bs_last_barrier] = {"plain", "forkjoin"
 };
 char const *__kmp_barrier_pattern_name[bp_last_bar] = {"linear", "tree",
                                                        "hyper", "hierarchical"};
+int __kmp_barrier_auto = FALSE;
+int __kmp_env_barrier[bs_last_barrier] = {FALSE};
 
 int __kmp_allThreadsSpecified = 0;
 size_t __kmp_align_alloc = CACHE_LINE;
@@ -353,6 +355,7 @@ int __kmp_forkjoin_frames_mode = 3;
 PACKED_REDUCTION_METHOD_T __kmp_force_reduction_method =
     reduction_method_not_defined;
 int __kmp_determ_red = FALSE;
+int __kmp_reduction_tree_threshold = 0;
 
 #ifdef KMP_DEBUG
 int kmp_a_debug = 0;
@@ -540,8 +540,14 @@ static void __kmp_print_team_storage_map(const char *header, kmp_team_t *team,
                                "%s_%d.t_disp_buffer", header, team_id);
 }
 
-static void __kmp_init_allocator() { __kmp_init_memkind(); }
-static void __kmp_fini_allocator() { __kmp_fini_memkind(); }
+static void __kmp_init_allocator() {
+  __kmp_init_memkind();
+  __kmp_init_libnuma();
+}
+static void __kmp_fini_allocator() {
+  __kmp_fini_libnuma();
+  __kmp_fini_memkind();
+}
 
 /* ------------------------------------------------------------------------ */
 
@@ -2842,6 +2848,7 @@ void __kmp_get_schedule(int gtid, kmp_sched_t *kind, int *chunk) {
     *kind = kmp_sched_static;
     break;
   case kmp_sch_dynamic_chunked:
+  case kmp_sch_adaptive:
     *kind = kmp_sched_dynamic;
     break;
   case kmp_sch_guided_chunked:
@@ -7019,6 +7026,8 @@ static void __kmp_do_middle_initialize(void) {
   }
 #endif /* KMP_AFFINITY_SUPPORTED */
 
+  __kmp_barrier_auto_select();
+
   KMP_ASSERT(__kmp_xproc > 0);
   if (__kmp_avail_proc == 0) {
     __kmp_avail_proc = __kmp_xproc;
@@ -8380,6 +8389,9 @@ __kmp_determine_reduction_method(
       teamsize_cutoff = 8;
     }
 #endif
+    if (__kmp_reduction_tree_threshold) {
+      teamsize_cutoff = __kmp_reduction_tree_threshold;
+    }
     int tree_available = FAST_REDUCTION_TREE_METHOD_GENERATED;
     if (tree_available) {
       if (team_size <= teamsize_cutoff) {
@@ -8428,6 +8440,14 @@ __kmp_determine_reduction_method(
 #else
 #error "Unknown or unsupported architecture"
 #endif
+
+    // With KMP_REDUCTION_TREE_THRESHOLD, large teams combine in the barrier
+    // tree on every architecture instead of serializing on a lock.
+    if (__kmp_reduction_tree_threshold &&
+        FAST_REDUCTION_TREE_METHOD_GENERATED &&
+        team_size > __kmp_reduction_tree_threshold) {
+      retval = TREE_REDUCE_BLOCK_WITH_REDUCTION_BARRIER;
+    }
   }
 
   // KMP_FORCE_REDUCTION
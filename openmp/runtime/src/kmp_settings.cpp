@@ -1571,6 +1571,7 @@ static void __kmp_stg_parse_barrier_branch_bit(char const *name,
     if ((strcmp(var, name) == 0) && (value != 0)) {
       char *comma;
 
+      __kmp_env_barrier[i] = TRUE;
       comma = CCAST(char *, strchr(value, ','));
       __kmp_barrier_gather_branch_bits[i] =
           (kmp_uint32)__kmp_str_to_int(value, ',');
@@ -1638,6 +1639,8 @@ static void __kmp_stg_parse_barrier_pattern(char const *name, char const *value,
       int j;
       char *comma = CCAST(char *, strchr(value, ','));
 
+      __kmp_env_barrier[i] = TRUE;
+
       /* handle first parameter: gather pattern */
       for (j = bp_linear_bar; j < bp_last_bar; j++) {
         if (__kmp_match_with_sentinel(__kmp_barrier_pattern_name[j], value, 1,
@@ -1692,6 +1695,19 @@ static void __kmp_stg_print_barrier_pattern(kmp_str_buf_t *buffer,
   }
 } // __kmp_stg_print_barrier_pattern
 
+// -----------------------------------------------------------------------------
+// KMP_BARRIER_AUTO
+
+static void __kmp_stg_parse_barrier_auto(char const *name, char const *value,
+                                         void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_barrier_auto);
+} // __kmp_stg_parse_barrier_auto
+
+static void __kmp_stg_print_barrier_auto(kmp_str_buf_t *buffer,
+                                         char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_barrier_auto);
+} // __kmp_stg_print_barrier_auto
+
 // -----------------------------------------------------------------------------
 // KMP_ABORT_DELAY
 
@@ -1797,6 +1813,22 @@ static void __kmp_stg_print_force_reduction(kmp_str_buf_t *buffer,
 
 } // __kmp_stg_print_force_reduction
 
+// -----------------------------------------------------------------------------
+// KMP_REDUCTION_TREE_THRESHOLD
+
+static void __kmp_stg_parse_reduction_tree_threshold(char const *name,
+                                                     char const *value,
+                                                     void *data) {
+  __kmp_stg_parse_int(name, value, 0, __kmp_sys_max_nth,
+                      &__kmp_reduction_tree_threshold);
+} // __kmp_stg_parse_reduction_tree_threshold
+
+static void __kmp_stg_print_reduction_tree_threshold(kmp_str_buf_t *buffer,
+                                                     char const *name,
+                                                     void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_reduction_tree_threshold);
+} // __kmp_stg_print_reduction_tree_threshold
+
 // -----------------------------------------------------------------------------
 // KMP_STORAGE_MAP
 
@@ -3931,6 +3963,8 @@ static const char *__kmp_parse_single_omp_schedule(const char *name,
     sched = kmp_sch_trapezoidal;
   else if (!__kmp_strcasecmp_with_sentinel("static", ptr, *delim))
     sched = kmp_sch_static;
+  else if (!__kmp_strcasecmp_with_sentinel("adaptive", ptr, *delim))
+    sched = kmp_sch_adaptive;
 #if KMP_STATIC_STEAL_ENABLED
   else if (!__kmp_strcasecmp_with_sentinel("static_steal", ptr, *delim))
     sched = kmp_sch_static_steal;
@@ -4072,6 +4106,9 @@ static void __kmp_stg_print_omp_schedule(kmp_str_buf_t *buffer,
     case kmp_sch_auto:
       __kmp_str_buf_print(buffer, "%s,%d'\n", "auto", __kmp_chunk);
       break;
+    case kmp_sch_adaptive:
+      __kmp_str_buf_print(buffer, "%s,%d'\n", "adaptive", __kmp_chunk);
+      break;
     }
   } else {
     switch (sched) {
@@ -4097,6 +4134,9 @@ static void __kmp_stg_print_omp_schedule(kmp_str_buf_t *buffer,
     case kmp_sch_auto:
       __kmp_str_buf_print(buffer, "%s'\n", "auto");
       break;
+    case kmp_sch_adaptive:
+      __kmp_str_buf_print(buffer, "%s'\n", "adaptive");
+      break;
     }
   }
 } // __kmp_stg_print_omp_schedule
@@ -5139,6 +5179,8 @@ static kmp_setting_t __kmp_stg_table[] = {
     {"KMP_REDUCTION_BARRIER_PATTERN", __kmp_stg_parse_barrier_pattern,
      __kmp_stg_print_barrier_pattern, NULL, 0, 0},
 #endif
+    {"KMP_BARRIER_AUTO", __kmp_stg_parse_barrier_auto,
+     __kmp_stg_print_barrier_auto, NULL, 0, 0},
 
     {"KMP_ABORT_DELAY", __kmp_stg_parse_abort_delay,
      __kmp_stg_print_abort_delay, NULL, 0, 0},
@@ -5148,6 +5190,8 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_force_reduction, NULL, 0, 0},
     {"KMP_DETERMINISTIC_REDUCTION", __kmp_stg_parse_force_reduction,
      __kmp_stg_print_force_reduction, NULL, 0, 0},
+    {"KMP_REDUCTION_TREE_THRESHOLD", __kmp_stg_parse_reduction_tree_threshold,
+     __kmp_stg_print_reduction_tree_threshold, NULL, 0, 0},
     {"KMP_STORAGE_MAP", __kmp_stg_parse_storage_map,
      __kmp_stg_print_storage_map, NULL, 0, 0},
     {"KMP_ALL_THREADPRIVATE", __kmp_stg_parse_all_threadprivate,
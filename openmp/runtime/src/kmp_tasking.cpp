@@ -291,14 +291,49 @@ static bool __kmp_task_is_allowed(int gtid, const kmp_int32 is_constrained,
   return true;
 }
 
+// __kmp_deque_enter_owner:
+// Called by the owner of a deque before pushing or popping a task without the
+// deque lock. Returns false if another thread holds the deque in the exclusive
+// mode, in which case the owner must take the lock instead.
+static inline bool __kmp_deque_enter_owner(kmp_base_thread_data_t *td) {
+  // Sequentially consistent, pairs with __kmp_deque_acquire_exclusive: either
+  // the owner sees the exclusive mode or the other thread sees the owner busy.
+  td->td_deque_owner_busy.store(1);
+  if (td->td_deque_exclusive.load()) {
+    KMP_ATOMIC_ST_REL(&td->td_deque_owner_busy, 0);
+    return false;
+  }
+  return true;
+}
+
+static inline void __kmp_deque_exit_owner(kmp_base_thread_data_t *td) {
+  KMP_ATOMIC_ST_REL(&td->td_deque_owner_busy, 0);
+}
+
+// __kmp_deque_acquire_exclusive:
+// Called with the deque lock held by a thread other than the owner before it
+// changes the tail or the middle of the deque, or reallocates it. Waits until
+// the owner has left the lock-free path and keeps it on the locked path until
+// __kmp_deque_release_exclusive.
+static void __kmp_deque_acquire_exclusive(kmp_base_thread_data_t *td) {
+  td->td_deque_exclusive.store(1);
+  while (td->td_deque_owner_busy.load())
+    KMP_CPU_PAUSE();
+}
+
+static inline void __kmp_deque_release_exclusive(kmp_base_thread_data_t *td) {
+  KMP_ATOMIC_ST_REL(&td->td_deque_exclusive, 0);
+}
+
 // __kmp_realloc_task_deque:
 // Re-allocates a task deque for a particular thread, copies the content from
 // the old deque and adjusts the necessary data structures relating to the
-// deque. This operation must be done with the deque_lock being held
+// deque. This operation must be done with the deque_lock being held, and in
+// the exclusive mode unless the calling thread is the owner.
 static void __kmp_realloc_task_deque(kmp_info_t *thread,
                                      kmp_thread_data_t *thread_data) {
   kmp_int32 size = TASK_DEQUE_SIZE(thread_data->td);
-  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) == size);
+  KMP_DEBUG_ASSERT(__kmp_deque_ntasks(&thread_data->td) == size);
   kmp_int32 new_size = 2 * size;
 
   KE_TRACE(10, ("__kmp_realloc_task_deque: T#%d reallocating deque[from %d to "
@@ -308,17 +343,17 @@ static void __kmp_realloc_task_deque(kmp_info_t *thread,
   kmp_taskdata_t **new_deque =
       (kmp_taskdata_t **)__kmp_allocate(new_size * sizeof(kmp_taskdata_t *));
 
-  int i, j;
-  for (i = thread_data->td.td_deque_head, j = 0; j < size;
-       i = (i + 1) & TASK_DEQUE_MASK(thread_data->td), j++)
-    new_deque[j] = thread_data->td.td_deque[i];
+  kmp_uint32 i = KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_head);
+  for (int j = 0; j < size; ++i, ++j)
+    new_deque[j] =
+        thread_data->td.td_deque[i & TASK_DEQUE_MASK(thread_data->td)];
 
   __kmp_free(thread_data->td.td_deque);
 
-  thread_data->td.td_deque_head = 0;
-  thread_data->td.td_deque_tail = size;
   thread_data->td.td_deque = new_deque;
   thread_data->td.td_deque_size = new_size;
+  KMP_ATOMIC_ST_RLX(&thread_data->td.td_deque_head, 0);
+  KMP_ATOMIC_ST_REL(&thread_data->td.td_deque_tail, size);
 }
 
 //  __kmp_push_task: Add a task to the thread's deque
@@ -327,9 +362,12 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
   kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
 
   // We don't need to map to shadow gtid if it is already hidden helper thread
+  bool is_owner = true;
   if (taskdata->td_flags.hidden_helper && !KMP_HIDDEN_HELPER_THREAD(gtid)) {
     gtid = KMP_GTID_TO_SHADOW_GTID(gtid);
     thread = __kmp_threads[gtid];
+    // The deque of the shadow thread is not owned by the calling thread.
+    is_owner = false;
   }
 
   kmp_task_team_t *task_team = thread->th.th_task_team;
@@ -377,67 +415,83 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
     __kmp_alloc_task_deque(thread, thread_data);
   }
 
-  int locked = 0;
   // Check if deque is full
-  if (TCR_4(thread_data->td.td_deque_ntasks) >=
+  if (__kmp_deque_ntasks(&thread_data->td) >=
+          TASK_DEQUE_SIZE(thread_data->td) &&
+      __kmp_enable_task_throttling &&
+      __kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
+                            thread->th.th_current_task)) {
+    KA_TRACE(20, ("__kmp_push_task: T#%d deque is full; returning "
+                  "TASK_NOT_PUSHED for task %p\n",
+                  gtid, taskdata));
+    return TASK_NOT_PUSHED;
+  }
+
+  // Fast path: the owner pushes at the tail without the lock. Thieves only
+  // read the slot after they have seen the new tail.
+  if (is_owner && __kmp_deque_enter_owner(&thread_data->td)) {
+    kmp_uint32 tail = KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail);
+    kmp_uint32 head = KMP_ATOMIC_LD_ACQ(&thread_data->td.td_deque_head);
+    if ((kmp_int32)(tail - head) < TASK_DEQUE_SIZE(thread_data->td)) {
+      thread_data->td.td_deque[tail & TASK_DEQUE_MASK(thread_data->td)] =
+          taskdata; // Push taskdata
+      KMP_ATOMIC_ST_REL(&thread_data->td.td_deque_tail, tail + 1);
+      __kmp_deque_exit_owner(&thread_data->td);
+      KMP_FSYNC_RELEASING(thread->th.th_current_task); // releasing self
+      KMP_FSYNC_RELEASING(taskdata); // releasing child
+      KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
+                    "task=%p head=%u tail=%u\n",
+                    gtid, taskdata, head, tail + 1));
+      goto pushed;
+    }
+    __kmp_deque_exit_owner(&thread_data->td);
+  }
+
+  // Lock the deque for the task push operation
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  if (!is_owner)
+    __kmp_deque_acquire_exclusive(&thread_data->td);
+  // Need to recheck as we can get a proxy task from thread outside of OpenMP
+  if (__kmp_deque_ntasks(&thread_data->td) >=
       TASK_DEQUE_SIZE(thread_data->td)) {
     if (__kmp_enable_task_throttling &&
         __kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
                               thread->th.th_current_task)) {
-      KA_TRACE(20, ("__kmp_push_task: T#%d deque is full; returning "
-                    "TASK_NOT_PUSHED for task %p\n",
+      if (!is_owner)
+        __kmp_deque_release_exclusive(&thread_data->td);
+      __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+      KA_TRACE(20, ("__kmp_push_task: T#%d deque is full on 2nd check; "
+                    "returning TASK_NOT_PUSHED for task %p\n",
                     gtid, taskdata));
       return TASK_NOT_PUSHED;
     } else {
-      __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-      locked = 1;
-      if (TCR_4(thread_data->td.td_deque_ntasks) >=
-          TASK_DEQUE_SIZE(thread_data->td)) {
-        // expand deque to push the task which is not allowed to execute
-        __kmp_realloc_task_deque(thread, thread_data);
-      }
-    }
-  }
-  // Lock the deque for the task push operation
-  if (!locked) {
-    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-    // Need to recheck as we can get a proxy task from thread outside of OpenMP
-    if (TCR_4(thread_data->td.td_deque_ntasks) >=
-        TASK_DEQUE_SIZE(thread_data->td)) {
-      if (__kmp_enable_task_throttling &&
-          __kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
-                                thread->th.th_current_task)) {
-        __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
-        KA_TRACE(20, ("__kmp_push_task: T#%d deque is full on 2nd check; "
-                      "returning TASK_NOT_PUSHED for task %p\n",
-                      gtid, taskdata));
-        return TASK_NOT_PUSHED;
-      } else {
-        // expand deque to push the task which is not allowed to execute
-        __kmp_realloc_task_deque(thread, thread_data);
-      }
+      // expand deque to push the task which is not allowed to execute
+      __kmp_realloc_task_deque(thread, thread_data);
     }
   }
   // Must have room since no thread can add tasks but calling thread
-  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) <
+  KMP_DEBUG_ASSERT(__kmp_deque_ntasks(&thread_data->td) <
                    TASK_DEQUE_SIZE(thread_data->td));
 
-  thread_data->td.td_deque[thread_data->td.td_deque_tail] =
-      taskdata; // Push taskdata
-  // Wrap index.
-  thread_data->td.td_deque_tail =
-      (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
-  TCW_4(thread_data->td.td_deque_ntasks,
-        TCR_4(thread_data->td.td_deque_ntasks) + 1); // Adjust task count
+  {
+    kmp_uint32 tail = KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail);
+    thread_data->td.td_deque[tail & TASK_DEQUE_MASK(thread_data->td)] =
+        taskdata; // Push taskdata
+    KMP_ATOMIC_ST_REL(&thread_data->td.td_deque_tail, tail + 1);
+  }
   KMP_FSYNC_RELEASING(thread->th.th_current_task); // releasing self
   KMP_FSYNC_RELEASING(taskdata); // releasing child
   KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
                 "task=%p ntasks=%d head=%u tail=%u\n",
-                gtid, taskdata, thread_data->td.td_deque_ntasks,
-                thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+                gtid, taskdata, __kmp_deque_ntasks(&thread_data->td),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_head),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail)));
 
+  if (!is_owner)
+    __kmp_deque_release_exclusive(&thread_data->td);
   __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
 
+pushed:
   // Signal one worker thread to execute the task
   if (taskdata->td_flags.hidden_helper) {
     // Wake hidden helper threads up if they're sleeping
@@ -1615,6 +1669,10 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
     KMP_FSYNC_ACQUIRED(taskdata); // acquired self (new task)
 #endif
 
+    kmp_uint64 taskloop_start = 0;
+    if (taskdata->td_flags.taskloop_timed)
+      taskloop_start = KMP_TIMESTAMP();
+
 #ifdef KMP_GOMP_COMPAT
     if (taskdata->td_flags.native) {
       ((void (*)(void *))(*(task->routine)))(task->shareds);
@@ -1625,6 +1683,13 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
     }
     KMP_POP_PARTITIONED_TIMER();
 
+    if (taskdata->td_flags.taskloop_timed) {
+      kmp_taskloop_timing_t *timing = taskdata->td_taskgroup->taskloop_timing;
+      KMP_DEBUG_ASSERT(timing);
+      timing->exec_time.fetch_add(KMP_TIMESTAMP() - taskloop_start,
+                                  std::memory_order_relaxed);
+    }
+
 #if USE_ITT_BUILD && USE_ITT_NOTIFY
     if (kmp_itt_count_task) {
       // Barrier imbalance - adjust arrive time with the task duration
@@ -2498,6 +2563,7 @@ void __kmpc_taskgroup(ident_t *loc, int gtid) {
   tg_new->parent = taskdata->td_taskgroup;
   tg_new->reduce_data = NULL;
   tg_new->reduce_num_data = 0;
+  tg_new->taskloop_timing = NULL;
   taskdata->td_taskgroup = tg_new;
 
 #if OMPT_SUPPORT && OMPT_OPTIONAL
@@ -2661,6 +2727,41 @@ void __kmpc_end_taskgroup(ident_t *loc, int gtid) {
 #endif
 }
 
+// __kmp_pop_task_tail: remove the task at the tail of the deque for its owner.
+// Either called by the owner on the lock-free path or with the deque lock
+// held. Returns NULL if the deque is empty, if the TSC does not allow the tail
+// task, or if a thief has taken the last task.
+static kmp_taskdata_t *__kmp_pop_task_tail(kmp_info_t *thread, kmp_int32 gtid,
+                                           kmp_base_thread_data_t *td,
+                                           kmp_int32 is_constrained) {
+  // Publish the smaller tail before looking at the head, so that a thief
+  // either sees the task gone or the owner sees the thief's head.
+  kmp_uint32 tail = KMP_ATOMIC_LD_RLX(&td->td_deque_tail) - 1;
+  KMP_ATOMIC_ST_RLX(&td->td_deque_tail, tail);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  kmp_uint32 head = KMP_ATOMIC_LD_RLX(&td->td_deque_head);
+  if ((kmp_int32)(tail - head) < 0) {
+    // Empty: restore the tail
+    KMP_ATOMIC_ST_RLX(&td->td_deque_tail, tail + 1);
+    return NULL;
+  }
+
+  kmp_taskdata_t *taskdata = td->td_deque[tail & TASK_DEQUE_MASK(*td)];
+  if (!__kmp_task_is_allowed(gtid, is_constrained, taskdata,
+                             thread->th.th_current_task)) {
+    // The TSC does not allow to execute the tail task, put it back
+    KMP_ATOMIC_ST_REL(&td->td_deque_tail, tail + 1);
+    return NULL;
+  }
+  if (tail != head) // No thief can reach this task
+    return taskdata;
+
+  // Last task: race the thieves for it
+  bool taken = __kmp_atomic_compare_store(&td->td_deque_head, head, head + 1);
+  KMP_ATOMIC_ST_RLX(&td->td_deque_tail, tail + 1);
+  return taken ? taskdata : NULL;
+}
+
 // __kmp_remove_my_task: remove a task from my own deque
 static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
                                         kmp_task_team_t *task_team,
@@ -2668,7 +2769,6 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
   kmp_task_t *task;
   kmp_taskdata_t *taskdata;
   kmp_thread_data_t *thread_data;
-  kmp_uint32 tail;
 
   KMP_DEBUG_ASSERT(__kmp_tasking_mode != tskm_immediate_exec);
   KMP_DEBUG_ASSERT(task_team->tt.tt_threads_data !=
@@ -2677,55 +2777,40 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
   thread_data = &task_team->tt.tt_threads_data[__kmp_tid_from_gtid(gtid)];
 
   KA_TRACE(10, ("__kmp_remove_my_task(enter): T#%d ntasks=%d head=%u tail=%u\n",
-                gtid, thread_data->td.td_deque_ntasks,
-                thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+                gtid, __kmp_deque_ntasks(&thread_data->td),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_head),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail)));
 
-  if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
-    KA_TRACE(10,
-             ("__kmp_remove_my_task(exit #1): T#%d No tasks to remove: "
-              "ntasks=%d head=%u tail=%u\n",
-              gtid, thread_data->td.td_deque_ntasks,
-              thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+  if (__kmp_deque_ntasks(&thread_data->td) == 0) {
+    KA_TRACE(10, ("__kmp_remove_my_task(exit #1): T#%d No tasks to remove\n",
+                  gtid));
     return NULL;
   }
 
-  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-
-  if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
+  if (__kmp_deque_enter_owner(&thread_data->td)) {
+    taskdata = __kmp_pop_task_tail(thread, gtid, &thread_data->td,
+                                   is_constrained);
+    __kmp_deque_exit_owner(&thread_data->td);
+  } else {
+    // Another thread changes the deque in the exclusive mode
+    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+    taskdata = __kmp_pop_task_tail(thread, gtid, &thread_data->td,
+                                   is_constrained);
     __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
-    KA_TRACE(10,
-             ("__kmp_remove_my_task(exit #2): T#%d No tasks to remove: "
-              "ntasks=%d head=%u tail=%u\n",
-              gtid, thread_data->td.td_deque_ntasks,
-              thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
-    return NULL;
   }
 
-  tail = (thread_data->td.td_deque_tail - 1) &
-         TASK_DEQUE_MASK(thread_data->td); // Wrap index.
-  taskdata = thread_data->td.td_deque[tail];
-
-  if (!__kmp_task_is_allowed(gtid, is_constrained, taskdata,
-                             thread->th.th_current_task)) {
-    // The TSC does not allow to steal victim task
-    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
-    KA_TRACE(10,
-             ("__kmp_remove_my_task(exit #3): T#%d TSC blocks tail task: "
-              "ntasks=%d head=%u tail=%u\n",
-              gtid, thread_data->td.td_deque_ntasks,
-              thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+  if (taskdata == NULL) {
+    KA_TRACE(10, ("__kmp_remove_my_task(exit #2): T#%d No task to remove or "
+                  "TSC blocks tail task: ntasks=%d\n",
+                  gtid, __kmp_deque_ntasks(&thread_data->td)));
     return NULL;
   }
 
-  thread_data->td.td_deque_tail = tail;
-  TCW_4(thread_data->td.td_deque_ntasks, thread_data->td.td_deque_ntasks - 1);
-
-  __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
-
-  KA_TRACE(10, ("__kmp_remove_my_task(exit #4): T#%d task %p removed: "
+  KA_TRACE(10, ("__kmp_remove_my_task(exit #3): T#%d task %p removed: "
                 "ntasks=%d head=%u tail=%u\n",
-                gtid, taskdata, thread_data->td.td_deque_ntasks,
-                thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+                gtid, taskdata, __kmp_deque_ntasks(&thread_data->td),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_head),
+                KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail)));
 
   task = KMP_TASKDATA_TO_TASK(taskdata);
   return task;
@@ -2743,7 +2828,7 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   kmp_taskdata_t *taskdata;
   kmp_taskdata_t *current;
   kmp_thread_data_t *victim_td, *threads_data;
-  kmp_int32 target;
+  kmp_uint32 head, tail, target;
   kmp_int32 victim_tid;
 
   KMP_DEBUG_ASSERT(__kmp_tasking_mode != tskm_immediate_exec);
@@ -2755,57 +2840,90 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   victim_td = &threads_data[victim_tid];
 
   KA_TRACE(10, ("__kmp_steal_task(enter): T#%d try to steal from T#%d: "
-                "task_team=%p ntasks=%d head=%u tail=%u\n",
+                "task_team=%p ntasks=%d\n",
                 gtid, __kmp_gtid_from_thread(victim_thr), task_team,
-                victim_td->td.td_deque_ntasks, victim_td->td.td_deque_head,
-                victim_td->td.td_deque_tail));
+                __kmp_deque_ntasks(&victim_td->td)));
 
-  if (TCR_4(victim_td->td.td_deque_ntasks) == 0) {
+  if (__kmp_deque_ntasks(&victim_td->td) == 0) {
     KA_TRACE(10, ("__kmp_steal_task(exit #1): T#%d could not steal from T#%d: "
-                  "task_team=%p ntasks=%d head=%u tail=%u\n",
-                  gtid, __kmp_gtid_from_thread(victim_thr), task_team,
-                  victim_td->td.td_deque_ntasks, victim_td->td.td_deque_head,
-                  victim_td->td.td_deque_tail));
+                  "task_team=%p ntasks=0\n",
+                  gtid, __kmp_gtid_from_thread(victim_thr), task_team));
     return NULL;
   }
 
+  // The lock serializes the thieves, the owner is only synchronized with
+  // through the head and tail.
   __kmp_acquire_bootstrap_lock(&victim_td->td.td_deque_lock);
 
-  int ntasks = TCR_4(victim_td->td.td_deque_ntasks);
+  head = KMP_ATOMIC_LD_ACQ(&victim_td->td.td_deque_head);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  tail = KMP_ATOMIC_LD_ACQ(&victim_td->td.td_deque_tail);
+  kmp_int32 ntasks = (kmp_int32)(tail - head);
   // Check again after we acquire the lock
-  if (ntasks == 0) {
+  if (ntasks <= 0) {
     __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
     KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d could not steal from T#%d: "
                   "task_team=%p ntasks=%d head=%u tail=%u\n",
                   gtid, __kmp_gtid_from_thread(victim_thr), task_team, ntasks,
-                  victim_td->td.td_deque_head, victim_td->td.td_deque_tail));
+                  head, tail));
     return NULL;
   }
 
+  if (*thread_finished) {
+    // We need to un-mark this victim as a finished victim.  This must be done
+    // before the task leaves the deque, or else other threads (starting with
+    // the master victim) might be prematurely released from the barrier!!!
+    // It is undone below if no task is stolen.
+    kmp_int32 count;
+
+    count = KMP_ATOMIC_INC(unfinished_threads);
+
+    KA_TRACE(
+        20,
+        ("__kmp_steal_task: T#%d inc unfinished_threads to %d: task_team=%p\n",
+         gtid, count + 1, task_team));
+  }
+
   KMP_DEBUG_ASSERT(victim_td->td.td_deque != NULL);
   current = __kmp_threads[gtid]->th.th_current_task;
-  taskdata = victim_td->td.td_deque[victim_td->td.td_deque_head];
+  taskdata = victim_td->td.td_deque[head & TASK_DEQUE_MASK(victim_td->td)];
   if (__kmp_task_is_allowed(gtid, is_constrained, taskdata, current)) {
-    // Bump head pointer and Wrap.
-    victim_td->td.td_deque_head =
-        (victim_td->td.td_deque_head + 1) & TASK_DEQUE_MASK(victim_td->td);
+    // Bump head pointer, unless the owner has popped the last task meanwhile.
+    if (!__kmp_atomic_compare_store(&victim_td->td.td_deque_head, head,
+                                    head + 1)) {
+      if (*thread_finished)
+        KMP_ATOMIC_DEC(unfinished_threads);
+      __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+      KA_TRACE(10, ("__kmp_steal_task(exit #3): T#%d could not steal from "
+                    "T#%d: task_team=%p, lost the last task to the owner\n",
+                    gtid, __kmp_gtid_from_thread(victim_thr), task_team));
+      return NULL;
+    }
   } else {
     if (!task_team->tt.tt_untied_task_encountered) {
       // The TSC does not allow to steal victim task
+      if (*thread_finished)
+        KMP_ATOMIC_DEC(unfinished_threads);
       __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
-      KA_TRACE(10, ("__kmp_steal_task(exit #3): T#%d could not steal from "
+      KA_TRACE(10, ("__kmp_steal_task(exit #4): T#%d could not steal from "
                     "T#%d: task_team=%p ntasks=%d head=%u tail=%u\n",
                     gtid, __kmp_gtid_from_thread(victim_thr), task_team, ntasks,
-                    victim_td->td.td_deque_head, victim_td->td.td_deque_tail));
+                    head, tail));
       return NULL;
     }
+    // Stealing from the middle of the deque moves the tasks after the stolen
+    // one, so the owner must stay away from the tail meanwhile.
+    __kmp_deque_acquire_exclusive(&victim_td->td);
+    head = KMP_ATOMIC_LD_RLX(&victim_td->td.td_deque_head);
+    tail = KMP_ATOMIC_LD_RLX(&victim_td->td.td_deque_tail);
+    ntasks = (kmp_int32)(tail - head);
     int i;
     // walk through victim's deque trying to steal any task
-    target = victim_td->td.td_deque_head;
+    target = head;
     taskdata = NULL;
-    for (i = 1; i < ntasks; ++i) {
-      target = (target + 1) & TASK_DEQUE_MASK(victim_td->td);
-      taskdata = victim_td->td.td_deque[target];
+    for (i = 0; i < ntasks; ++i, ++target) {
+      taskdata =
+          victim_td->td.td_deque[target & TASK_DEQUE_MASK(victim_td->td)];
       if (__kmp_task_is_allowed(gtid, is_constrained, taskdata, current)) {
         break; // found victim task
       } else {
@@ -2814,50 +2932,38 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
     }
     if (taskdata == NULL) {
       // No appropriate candidate to steal found
+      __kmp_deque_release_exclusive(&victim_td->td);
+      if (*thread_finished)
+        KMP_ATOMIC_DEC(unfinished_threads);
       __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
-      KA_TRACE(10, ("__kmp_steal_task(exit #4): T#%d could not steal from "
+      KA_TRACE(10, ("__kmp_steal_task(exit #5): T#%d could not steal from "
                     "T#%d: task_team=%p ntasks=%d head=%u tail=%u\n",
                     gtid, __kmp_gtid_from_thread(victim_thr), task_team, ntasks,
-                    victim_td->td.td_deque_head, victim_td->td.td_deque_tail));
+                    head, tail));
       return NULL;
     }
-    int prev = target;
-    for (i = i + 1; i < ntasks; ++i) {
+    if (i == 0) {
+      KMP_ATOMIC_ST_REL(&victim_td->td.td_deque_head, head + 1);
+    } else {
       // shift remaining tasks in the deque left by 1
-      target = (target + 1) & TASK_DEQUE_MASK(victim_td->td);
-      victim_td->td.td_deque[prev] = victim_td->td.td_deque[target];
-      prev = target;
+      for (; target + 1 != tail; ++target)
+        victim_td->td.td_deque[target & TASK_DEQUE_MASK(victim_td->td)] =
+            victim_td->td
+                .td_deque[(target + 1) & TASK_DEQUE_MASK(victim_td->td)];
+      KMP_ATOMIC_ST_REL(&victim_td->td.td_deque_tail, tail - 1);
     }
-    KMP_DEBUG_ASSERT(
-        victim_td->td.td_deque_tail ==
-        (kmp_uint32)((target + 1) & TASK_DEQUE_MASK(victim_td->td)));
-    victim_td->td.td_deque_tail = target; // tail -= 1 (wrapped))
+    __kmp_deque_release_exclusive(&victim_td->td);
   }
-  if (*thread_finished) {
-    // We need to un-mark this victim as a finished victim.  This must be done
-    // before releasing the lock, or else other threads (starting with the
-    // master victim) might be prematurely released from the barrier!!!
-    kmp_int32 count;
-
-    count = KMP_ATOMIC_INC(unfinished_threads);
-
-    KA_TRACE(
-        20,
-        ("__kmp_steal_task: T#%d inc unfinished_threads to %d: task_team=%p\n",
-         gtid, count + 1, task_team));
-
-    *thread_finished = FALSE;
-  }
-  TCW_4(victim_td->td.td_deque_ntasks, ntasks - 1);
+  *thread_finished = FALSE;
 
   __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
 
   KMP_COUNT_BLOCK(TASK_stolen);
   KA_TRACE(10,
-           ("__kmp_steal_task(exit #5): T#%d stole task %p from T#%d: "
-            "task_team=%p ntasks=%d head=%u tail=%u\n",
+           ("__kmp_steal_task(exit #6): T#%d stole task %p from T#%d: "
+            "task_team=%p ntasks=%d\n",
             gtid, taskdata, __kmp_gtid_from_thread(victim_thr), task_team,
-            ntasks, victim_td->td.td_deque_head, victim_td->td.td_deque_tail));
+            __kmp_deque_ntasks(&victim_td->td)));
 
   task = KMP_TASKDATA_TO_TASK(taskdata);
   return task;
@@ -3020,7 +3126,7 @@ static inline int __kmp_execute_tasks_template(
       KMP_YIELD(__kmp_library == library_throughput); // Yield before next task
       // If execution of a stolen task results in more tasks being placed on our
       // run queue, reset use_own_tasks
-      if (!use_own_tasks && TCR_4(threads_data[tid].td.td_deque_ntasks) != 0) {
+      if (!use_own_tasks && __kmp_deque_ntasks(&threads_data[tid].td) != 0) {
         KA_TRACE(20, ("__kmp_execute_tasks_template: T#%d stolen task spawned "
                       "other tasks, restart\n",
                       gtid));
@@ -3245,9 +3351,8 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
   // Initialize last stolen task field to "none"
   thread_data->td.td_deque_last_stolen = -1;
 
-  KMP_DEBUG_ASSERT(TCR_4(thread_data->td.td_deque_ntasks) == 0);
-  KMP_DEBUG_ASSERT(thread_data->td.td_deque_head == 0);
-  KMP_DEBUG_ASSERT(thread_data->td.td_deque_tail == 0);
+  KMP_DEBUG_ASSERT(KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_head) == 0);
+  KMP_DEBUG_ASSERT(KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail) == 0);
 
   KE_TRACE(
       10,
@@ -3267,7 +3372,8 @@ static void __kmp_alloc_task_deque(kmp_info_t *thread,
 static void __kmp_free_task_deque(kmp_thread_data_t *thread_data) {
   if (thread_data->td.td_deque != NULL) {
     __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-    TCW_4(thread_data->td.td_deque_ntasks, 0);
+    KMP_ATOMIC_ST_RLX(&thread_data->td.td_deque_head, 0);
+    KMP_ATOMIC_ST_RLX(&thread_data->td.td_deque_tail, 0);
     __kmp_free(thread_data->td.td_deque);
     thread_data->td.td_deque = NULL;
     __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
@@ -3786,7 +3892,7 @@ static bool __kmp_give_task(kmp_info_t *thread, kmp_int32 tid, kmp_task_t *task,
     return result;
   }
 
-  if (TCR_4(thread_data->td.td_deque_ntasks) >=
+  if (__kmp_deque_ntasks(&thread_data->td) >=
       TASK_DEQUE_SIZE(thread_data->td)) {
     KA_TRACE(
         30,
@@ -3797,47 +3903,41 @@ static bool __kmp_give_task(kmp_info_t *thread, kmp_int32 tid, kmp_task_t *task,
     // thread
     if (TASK_DEQUE_SIZE(thread_data->td) / INITIAL_TASK_DEQUE_SIZE >= pass)
       return result;
+  }
 
-    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
-    if (TCR_4(thread_data->td.td_deque_ntasks) >=
-        TASK_DEQUE_SIZE(thread_data->td)) {
-      // expand deque to push the task which is not allowed to execute
-      __kmp_realloc_task_deque(thread, thread_data);
-    }
-
-  } else {
-
-    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  // The calling thread is not the owner of the deque, it needs the exclusive
+  // mode to change the tail.
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  __kmp_deque_acquire_exclusive(&thread_data->td);
 
-    if (TCR_4(thread_data->td.td_deque_ntasks) >=
-        TASK_DEQUE_SIZE(thread_data->td)) {
-      KA_TRACE(30, ("__kmp_give_task: queue is full while giving task %p to "
-                    "thread %d.\n",
-                    taskdata, tid));
+  if (__kmp_deque_ntasks(&thread_data->td) >=
+      TASK_DEQUE_SIZE(thread_data->td)) {
+    KA_TRACE(30, ("__kmp_give_task: queue is full while giving task %p to "
+                  "thread %d.\n",
+                  taskdata, tid));
 
-      // if this deque is bigger than the pass ratio give a chance to another
-      // thread
-      if (TASK_DEQUE_SIZE(thread_data->td) / INITIAL_TASK_DEQUE_SIZE >= pass)
-        goto release_and_exit;
+    // if this deque is bigger than the pass ratio give a chance to another
+    // thread
+    if (TASK_DEQUE_SIZE(thread_data->td) / INITIAL_TASK_DEQUE_SIZE >= pass)
+      goto release_and_exit;
 
-      __kmp_realloc_task_deque(thread, thread_data);
-    }
+    __kmp_realloc_task_deque(thread, thread_data);
   }
 
   // lock is held here, and there is space in the deque
-
-  thread_data->td.td_deque[thread_data->td.td_deque_tail] = taskdata;
-  // Wrap index.
-  thread_data->td.td_deque_tail =
-      (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
-  TCW_4(thread_data->td.td_deque_ntasks,
-        TCR_4(thread_data->td.td_deque_ntasks) + 1);
+  {
+    kmp_uint32 tail = KMP_ATOMIC_LD_RLX(&thread_data->td.td_deque_tail);
+    thread_data->td.td_deque[tail & TASK_DEQUE_MASK(thread_data->td)] =
+        taskdata;
+    KMP_ATOMIC_ST_REL(&thread_data->td.td_deque_tail, tail + 1);
+  }
 
   result = true;
   KA_TRACE(30, ("__kmp_give_task: successfully gave task %p to thread %d.\n",
                 taskdata, tid));
 
 release_and_exit:
+  __kmp_deque_release_exclusive(&thread_data->td);
   __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
 
   return result;
@@ -4270,6 +4370,14 @@ void __kmp_taskloop_linear(ident_t *loc, int gtid, kmp_task_t *task,
                 gtid, num_tasks, grainsize, extras, last_chunk, lower, upper,
                 ub_glob, st, task_dup));
 
+  kmp_taskloop_timing_t *timing = NULL;
+  kmp_uint64 create_start = 0;
+  if (KMP_TASK_TO_TASKDATA(task)->td_flags.taskloop_timed) {
+    timing = current_task->td_taskgroup->taskloop_timing;
+    KMP_DEBUG_ASSERT(timing);
+    create_start = KMP_TIMESTAMP();
+  }
+
   // Launch num_tasks tasks, assign grainsize iterations each task
   for (i = 0; i < num_tasks; ++i) {
     kmp_uint64 chunk_minus_1;
@@ -4328,6 +4436,9 @@ void __kmp_taskloop_linear(ident_t *loc, int gtid, kmp_task_t *task,
 #endif
     lower = upper + st; // adjust lower bound for the next iteration
   }
+  if (timing)
+    timing->create_time.fetch_add(KMP_TIMESTAMP() - create_start,
+                                  std::memory_order_relaxed);
   // free the pattern task and exit
   __kmp_task_start(gtid, task, current_task); // make internal bookkeeping
   // do not execute the pattern task, just do internal bookkeeping
@@ -4549,12 +4660,91 @@ void __kmp_taskloop_recur(ident_t *loc, int gtid, kmp_task_t *task,
   KA_TRACE(40, ("__kmp_taskloop_recur(exit): T#%d\n", gtid));
 }
 
+// Feedback of the adaptive taskloop grainsize, kept per call site across
+// executions. The times are in the units of KMP_TIMESTAMP().
+typedef struct kmp_taskloop_feedback {
+  ident_t *loc;
+  double iter_time; // execution time of one iteration
+  double task_time; // time to create one task
+} kmp_taskloop_feedback_t;
+
+#define KMP_TASKLOOP_FEEDBACK_SIZE 64
+static kmp_taskloop_feedback_t
+    __kmp_taskloop_feedback[KMP_TASKLOOP_FEEDBACK_SIZE];
+static kmp_bootstrap_lock_t __kmp_taskloop_feedback_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_taskloop_feedback_lock);
+
+// The adaptive grainsize makes executing a task take taskloop_adaptive_ratio
+// times as long as creating it, while leaving at least taskloop_adaptive_tasks
+// tasks per thread to balance the load.
+static const double taskloop_adaptive_ratio = 64.0;
+static const kmp_uint64 taskloop_adaptive_tasks = 4;
+
+static inline kmp_taskloop_feedback_t *__kmp_taskloop_feedback_slot(
+    ident_t *loc) {
+  return &__kmp_taskloop_feedback[((kmp_uintptr_t)loc / sizeof(ident_t)) %
+                                  KMP_TASKLOOP_FEEDBACK_SIZE];
+}
+
+// Returns the grainsize the previous executions of the taskloop at loc
+// suggest, or 0 if there were none.
+static kmp_uint64 __kmp_taskloop_adaptive_grainsize(ident_t *loc,
+                                                    kmp_uint64 tc,
+                                                    kmp_uint64 nproc) {
+  double iter_time = 0.0, task_time = 0.0;
+  kmp_taskloop_feedback_t *slot = __kmp_taskloop_feedback_slot(loc);
+  __kmp_acquire_bootstrap_lock(&__kmp_taskloop_feedback_lock);
+  if (slot->loc == loc) {
+    iter_time = slot->iter_time;
+    task_time = slot->task_time;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_taskloop_feedback_lock);
+  if (iter_time <= 0.0)
+    return 0;
+
+  double grainsize = taskloop_adaptive_ratio * task_time / iter_time;
+  double max_grainsize = (double)tc / (taskloop_adaptive_tasks * nproc);
+  if (grainsize > max_grainsize)
+    grainsize = max_grainsize;
+  return grainsize < 1.0 ? 1 : (kmp_uint64)grainsize;
+}
+
+// Records the timing of one execution of the taskloop at loc.
+static void __kmp_taskloop_adaptive_update(ident_t *loc,
+                                           const kmp_taskloop_timing_t *timing,
+                                           kmp_uint64 tc,
+                                           kmp_uint64 num_tasks) {
+  double iter_time = (double)timing->exec_time.load() / tc;
+  double task_time = (double)timing->create_time.load() / num_tasks;
+  kmp_taskloop_feedback_t *slot = __kmp_taskloop_feedback_slot(loc);
+  __kmp_acquire_bootstrap_lock(&__kmp_taskloop_feedback_lock);
+  if (slot->loc == loc && slot->iter_time > 0.0) {
+    slot->iter_time = (slot->iter_time + iter_time) / 2.0;
+    slot->task_time = (slot->task_time + task_time) / 2.0;
+  } else {
+    slot->loc = loc;
+    slot->iter_time = iter_time;
+    slot->task_time = task_time;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_taskloop_feedback_lock);
+}
+
 static void __kmp_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
                            kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
                            int nogroup, int sched, kmp_uint64 grainsize,
                            int modifier, void *task_dup) {
   kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
   KMP_DEBUG_ASSERT(task != NULL);
+  kmp_taskloop_timing_t timing;
+  // Without grainsize and num_tasks clauses, the adaptive run-sched-var picks
+  // the grainsize from the timing of the previous executions. The timing is
+  // only complete when the taskgroup waits for all the tasks.
+  bool adaptive =
+      sched == 0 && nogroup == 0 && if_val != 0 && loc != NULL &&
+      !taskdata->td_flags.native &&
+      SCHEDULE_WITHOUT_MODIFIERS(__kmp_threads[gtid]
+                                     ->th.th_current_task->td_icvs.sched
+                                     .r_sched_type) == kmp_sch_adaptive;
   if (nogroup == 0) {
 #if OMPT_SUPPORT && OMPT_OPTIONAL
     OMPT_STORE_RETURN_ADDRESS(gtid);
@@ -4614,6 +4804,19 @@ static void __kmp_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
     num_tasks_min =
         KMP_MIN(thread->th.th_team_nproc * 10, INITIAL_TASK_DEQUE_SIZE);
 
+  if (adaptive) {
+    kmp_uint64 adaptive_grainsize =
+        __kmp_taskloop_adaptive_grainsize(loc, tc, thread->th.th_team_nproc);
+    if (adaptive_grainsize) {
+      sched = 1;
+      grainsize = adaptive_grainsize;
+    }
+    timing.exec_time = 0;
+    timing.create_time = 0;
+    current_task->td_taskgroup->taskloop_timing = &timing;
+    taskdata->td_flags.taskloop_timed = 1;
+  }
+
   // compute num_tasks/grainsize based on the input provided
   switch (sched) {
   case 0: // no schedule clause specified, we can choose the default
@@ -4711,6 +4914,8 @@ static void __kmp_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
 #endif
     __kmpc_end_taskgroup(loc, gtid);
   }
+  if (adaptive)
+    __kmp_taskloop_adaptive_update(loc, &timing, tc, num_tasks);
   KA_TRACE(20, ("__kmp_taskloop(exit): T#%d\n", gtid));
 }
 
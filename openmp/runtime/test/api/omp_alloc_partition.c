@@ -0,0 +1,58 @@
+// RUN: %libomp-compile-and-run
+
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+
+#define BIG (4 * 1024 * 1024)
+#define SMALL 100
+
+// Allocators with any partition must hand out usable memory whether or not
+// the machine has several NUMA nodes; both the small blocks served from the
+// per-thread pool and the big ones placed on the nodes are exercised.
+int test_partition(omp_uintptr_t partition) {
+  omp_alloctrait_t at[2];
+  omp_allocator_handle_t a;
+  int failed = 0;
+  at[0].key = omp_atk_partition;
+  at[0].value = partition;
+  at[1].key = omp_atk_fallback;
+  at[1].value = omp_atv_default_mem_fb;
+  a = omp_init_allocator(omp_default_mem_space, 2, at);
+  if (a == omp_null_allocator) {
+    printf("failed: no allocator for partition %d\n", (int)partition);
+    return 1;
+  }
+#pragma omp parallel num_threads(4) reduction(+ : failed)
+  {
+    char *small = (char *)omp_alloc(SMALL, a);
+    char *big = (char *)omp_alloc(BIG, a);
+    if (small == NULL || big == NULL) {
+      failed++;
+    } else {
+      memset(small, omp_get_thread_num(), SMALL);
+      memset(big, omp_get_thread_num(), BIG);
+      if (small[SMALL - 1] != omp_get_thread_num() ||
+          big[BIG - 1] != omp_get_thread_num())
+        failed++;
+    }
+    omp_free(small, a);
+    omp_free(big, a);
+  }
+  omp_destroy_allocator(a);
+  if (failed)
+    printf("failed: partition %d\n", (int)partition);
+  return failed;
+}
+
+int main() {
+  int failed = 0;
+  failed += test_partition(omp_atv_nearest);
+  failed += test_partition(omp_atv_blocked);
+  failed += test_partition(omp_atv_interleaved);
+  failed += test_partition(omp_atv_environment);
+  if (failed)
+    return 1;
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,59 @@
+// RUN: %libomp-compile
+// RUN: env KMP_REDUCTION_TREE_THRESHOLD=1 %libomp-run
+// RUN: env KMP_REDUCTION_TREE_THRESHOLD=3 %libomp-run
+// RUN: env KMP_REDUCTION_TREE_THRESHOLD=1000 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+#define MAX_THREADS 16
+
+// Reductions of one and of several variables, with and without the closing
+// barrier, have to be exact for every team size whatever method is chosen.
+int test_reduction_tree_threshold() {
+  int nthreads, rep;
+  int known_sum = (LOOPCOUNT * (LOOPCOUNT + 1)) / 2;
+
+  for (nthreads = 1; nthreads <= MAX_THREADS; nthreads++) {
+    for (rep = 0; rep < REPETITIONS; rep++) {
+      int sum = 0, nowait_sum = 0;
+      long long lsum = 0;
+      double dsum = 0.0;
+
+#pragma omp parallel num_threads(nthreads)
+      {
+        int i;
+#pragma omp for reduction(+ : sum)
+        for (i = 1; i <= LOOPCOUNT; i++)
+          sum += i;
+
+#pragma omp for reduction(+ : nowait_sum) nowait
+        for (i = 1; i <= LOOPCOUNT; i++)
+          nowait_sum += i;
+
+#pragma omp for reduction(+ : lsum, dsum)
+        for (i = 1; i <= LOOPCOUNT; i++) {
+          lsum += i;
+          dsum += i;
+        }
+      }
+
+      if (sum != known_sum || nowait_sum != known_sum || lsum != known_sum ||
+          dsum != (double)known_sum) {
+        fprintf(stderr,
+                "error with %d threads: sum=%d nowait_sum=%d lsum=%lld "
+                "dsum=%f, expected %d\n",
+                nthreads, sum, nowait_sum, lsum, dsum, known_sum);
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+int main() {
+  if (!test_reduction_tree_threshold())
+    return 1;
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,65 @@
+// RUN: %libomp-compile && env OMP_NUM_THREADS=64 %libomp-run
+// RUN: %libomp-compile && env KMP_ENABLE_TASK_THROTTLING=0 OMP_NUM_THREADS=64 %libomp-run
+
+#include <stdio.h>
+#include <omp.h>
+
+/**
+ * Stress the task deques with a large number of tiny tasks, both with one
+ * producer that all other threads steal from and with every thread producing
+ * into its own deque. Every task must run exactly once. The throughput is
+ * printed to stderr so that runs of the test can be compared.
+ */
+
+#define NUM_TASKS 1000000
+
+static int counter;
+
+static void tiny_task() {
+#pragma omp atomic
+  counter++;
+}
+
+static int run(int all_producers) {
+  double start, seconds;
+  counter = 0;
+  start = omp_get_wtime();
+  #pragma omp parallel
+  {
+    int nthreads = omp_get_num_threads();
+    if (all_producers) {
+      int i;
+      int tid = omp_get_thread_num();
+      for (i = tid; i < NUM_TASKS; i += nthreads) {
+        #pragma omp task
+        tiny_task();
+      }
+    } else {
+      #pragma omp single
+      {
+        int i;
+        for (i = 0; i < NUM_TASKS; i++) {
+          #pragma omp task
+          tiny_task();
+        }
+      }
+    }
+  }
+  seconds = omp_get_wtime() - start;
+  fprintf(stderr, "%s: %d tasks in %.3f s (%.2f Mtasks/s)\n",
+          all_producers ? "all producers" : "single producer", NUM_TASKS,
+          seconds, NUM_TASKS / seconds / 1e6);
+  if (counter != NUM_TASKS) {
+    fprintf(stderr, "error: %d of %d tasks executed\n", counter, NUM_TASKS);
+    return 1;
+  }
+  return 0;
+}
+
+int main() {
+  int failed = run(0) + run(1);
+  if (failed)
+    return 1;
+  printf("pass\n");
+  return 0;
+}
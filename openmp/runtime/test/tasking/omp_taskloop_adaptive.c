@@ -0,0 +1,52 @@
+// RUN: %libomp-compile && env OMP_SCHEDULE=adaptive %libomp-run
+// RUN: %libomp-compile && env OMP_SCHEDULE=adaptive OMP_NUM_THREADS=1 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+#define N 10000
+#define REPS 8
+
+// Runs the same taskloop several times so that the later executions use the
+// grainsize chosen from the timing of the earlier ones.
+int test_omp_taskloop_adaptive() {
+  static int count[N];
+  int i, rep, error = 0;
+
+  for (i = 0; i < N; ++i)
+    count[i] = 0;
+
+  #pragma omp parallel
+  #pragma omp single
+  for (rep = 0; rep < REPS; ++rep) {
+    int j;
+    #pragma omp taskloop
+    for (j = 0; j < N; ++j) {
+      int k;
+      volatile double x = 0.0;
+      // Irregular work so that the iteration time is measurable.
+      for (k = 0; k < j % 64; ++k)
+        x += k * 0.5;
+      #pragma omp atomic
+      count[j]++;
+    }
+  }
+
+  for (i = 0; i < N; ++i) {
+    if (count[i] != REPS) {
+      fprintf(stderr, "iteration %d executed %d times\n", i, count[i]);
+      error = 1;
+    }
+  }
+  return !error;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_taskloop_adaptive())
+      num_failed++;
+  }
+  return num_failed;
+}
@@ -0,0 +1,416 @@
+/*
+ * ompt-trace.cpp -- OMPT tool writing Chrome trace files
+ */
+
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for details.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <inttypes.h>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "omp-tools.h"
+
+namespace {
+
+class TraceFlags {
+public:
+  std::string file;
+  uint64_t buffer_size{1 << 16};
+  int verbose{0};
+
+  TraceFlags(const char *env) {
+    if (env) {
+      std::string token;
+      std::istringstream iss(env);
+      while (std::getline(iss, token, ' ')) {
+        if (token.empty())
+          continue;
+        if (token.compare(0, 5, "file=") == 0) {
+          file = token.substr(5);
+          continue;
+        }
+        if (sscanf(token.c_str(), "buffer_size=%" SCNu64, &buffer_size))
+          continue;
+        if (sscanf(token.c_str(), "verbose=%d", &verbose))
+          continue;
+        std::cerr << "Illegal values for OMPTRACE_OPTIONS variable: " << token
+                  << std::endl;
+      }
+    }
+    if (file.empty())
+      file = "omptrace." + std::to_string(getpid()) + ".json";
+    // the ring buffers are indexed with a mask
+    uint64_t size = 1;
+    while (size < buffer_size)
+      size <<= 1;
+    buffer_size = size;
+  }
+};
+
+TraceFlags *trace_flags;
+
+enum EventKind : uint32_t {
+  EK_Parallel,
+  EK_Teams,
+  EK_Task,
+  EK_BarrierWait,
+  EK_TaskwaitWait,
+  EK_TaskgroupWait,
+  EK_OtherWait
+};
+
+const char *const EventNames[] = {"parallel",      "teams",
+                                  "task",          "barrier wait",
+                                  "taskwait wait", "taskgroup wait",
+                                  "wait"};
+
+struct Event {
+  uint64_t Begin;
+  uint64_t End;
+  const void *Codeptr;
+  EventKind Kind;
+  // parallel and teams: number of threads or teams
+  uint32_t TeamSize;
+  // parallel and teams: (max - mean) / max of the work time of the threads
+  double Imbalance;
+};
+
+/// Events of one thread. Only the owner writes to the buffer; it is read once
+/// all threads are done, when the tool is finalized.
+struct ThreadBuffer {
+  ThreadBuffer(uint64_t Id, ompt_thread_t Type, uint64_t Capacity)
+      : Id(Id), Type(Type), Mask(Capacity - 1), Events(new Event[Capacity]) {}
+
+  void record(const Event &E) {
+    uint64_t H = Head.load(std::memory_order_relaxed);
+    Events[H & Mask] = E;
+    Head.store(H + 1, std::memory_order_release);
+  }
+
+  const uint64_t Id;
+  const ompt_thread_t Type;
+  const uint64_t Mask;
+  std::unique_ptr<Event[]> Events;
+  std::atomic<uint64_t> Head{0};
+  ThreadBuffer *Next{nullptr};
+
+  // begin of the running segment of an explicit task
+  uint64_t SegmentBegin{0};
+  // begin of the implicit tasks and of the waits in progress
+  std::vector<uint64_t> ImplicitBegin;
+  std::vector<uint64_t> WaitBegin;
+};
+
+/// The parallel or teams region a parallel_data points to.
+struct Region {
+  uint64_t Begin;
+  std::atomic<uint64_t> WorkSum{0};
+  std::atomic<uint64_t> WorkMax{0};
+  std::atomic<uint32_t> Threads{0};
+};
+
+std::atomic<ThreadBuffer *> Buffers{nullptr};
+std::atomic<uint64_t> NextThreadId{0};
+thread_local ThreadBuffer *Buffer;
+uint64_t Origin;
+
+inline uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+static void ompt_trace_thread_begin(ompt_thread_t thread_type,
+                                    ompt_data_t *thread_data) {
+  ThreadBuffer *B =
+      new ThreadBuffer(NextThreadId.fetch_add(1, std::memory_order_relaxed),
+                       thread_type, trace_flags->buffer_size);
+  B->Next = Buffers.load(std::memory_order_relaxed);
+  while (!Buffers.compare_exchange_weak(B->Next, B, std::memory_order_release,
+                                        std::memory_order_relaxed))
+    ;
+  Buffer = B;
+  thread_data->ptr = B;
+}
+
+static void ompt_trace_parallel_begin(ompt_data_t *parent_task_data,
+                                      const ompt_frame_t *parent_task_frame,
+                                      ompt_data_t *parallel_data,
+                                      uint32_t requested_team_size, int flag,
+                                      const void *codeptr_ra) {
+  Region *R = new Region;
+  R->Begin = now();
+  parallel_data->ptr = R;
+}
+
+static void ompt_trace_parallel_end(ompt_data_t *parallel_data,
+                                    ompt_data_t *task_data, int flag,
+                                    const void *codeptr_ra) {
+  Region *R = static_cast<Region *>(parallel_data->ptr);
+  if (!R)
+    return;
+  if (Buffer) {
+    Event E;
+    E.Begin = R->Begin;
+    E.End = now();
+    E.Codeptr = codeptr_ra;
+    E.Kind = (flag & ompt_parallel_league) ? EK_Teams : EK_Parallel;
+    E.TeamSize = R->Threads.load(std::memory_order_relaxed);
+    uint64_t Max = R->WorkMax.load(std::memory_order_relaxed);
+    E.Imbalance = 0.0;
+    if (E.TeamSize > 0 && Max > 0) {
+      double Mean =
+          double(R->WorkSum.load(std::memory_order_relaxed)) / E.TeamSize;
+      E.Imbalance = (Max - Mean) / Max;
+    }
+    Buffer->record(E);
+  }
+  parallel_data->ptr = nullptr;
+  delete R;
+}
+
+static void ompt_trace_implicit_task(ompt_scope_endpoint_t endpoint,
+                                     ompt_data_t *parallel_data,
+                                     ompt_data_t *task_data,
+                                     unsigned int team_size,
+                                     unsigned int thread_num, int flags) {
+  if (!Buffer)
+    return;
+  switch (endpoint) {
+  case ompt_scope_begin:
+    // only explicit tasks have a non-zero value, see task_create
+    task_data->value = 0;
+    Buffer->ImplicitBegin.push_back(now());
+    break;
+  case ompt_scope_end:
+    if (!Buffer->ImplicitBegin.empty())
+      Buffer->ImplicitBegin.pop_back();
+    break;
+  default:
+    break;
+  }
+}
+
+static void ompt_trace_sync_region(ompt_sync_region_t kind,
+                                   ompt_scope_endpoint_t endpoint,
+                                   ompt_data_t *parallel_data,
+                                   ompt_data_t *task_data,
+                                   const void *codeptr_ra) {
+  // The work of a thread in a region ends when it reaches the implicit
+  // barrier, which all threads do before the region ends.
+  if (endpoint != ompt_scope_begin ||
+      (kind != ompt_sync_region_barrier_implicit &&
+       kind != ompt_sync_region_barrier_implicit_parallel) ||
+      !parallel_data || !parallel_data->ptr || !Buffer ||
+      Buffer->ImplicitBegin.empty())
+    return;
+  Region *R = static_cast<Region *>(parallel_data->ptr);
+  uint64_t Work = now() - Buffer->ImplicitBegin.back();
+  R->WorkSum.fetch_add(Work, std::memory_order_relaxed);
+  uint64_t Max = R->WorkMax.load(std::memory_order_relaxed);
+  while (Work > Max && !R->WorkMax.compare_exchange_weak(
+                           Max, Work, std::memory_order_relaxed))
+    ;
+  R->Threads.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ompt_trace_sync_region_wait(ompt_sync_region_t kind,
+                                        ompt_scope_endpoint_t endpoint,
+                                        ompt_data_t *parallel_data,
+                                        ompt_data_t *task_data,
+                                        const void *codeptr_ra) {
+  if (!Buffer)
+    return;
+  if (endpoint == ompt_scope_begin) {
+    Buffer->WaitBegin.push_back(now());
+    return;
+  }
+  if (endpoint != ompt_scope_end || Buffer->WaitBegin.empty())
+    return;
+  Event E;
+  E.Begin = Buffer->WaitBegin.back();
+  E.End = now();
+  E.Codeptr = codeptr_ra;
+  switch (kind) {
+  case ompt_sync_region_barrier:
+  case ompt_sync_region_barrier_implicit:
+  case ompt_sync_region_barrier_implicit_workshare:
+  case ompt_sync_region_barrier_implicit_parallel:
+  case ompt_sync_region_barrier_teams:
+  case ompt_sync_region_barrier_explicit:
+  case ompt_sync_region_barrier_implementation:
+    E.Kind = EK_BarrierWait;
+    break;
+  case ompt_sync_region_taskwait:
+    E.Kind = EK_TaskwaitWait;
+    break;
+  case ompt_sync_region_taskgroup:
+    E.Kind = EK_TaskgroupWait;
+    break;
+  default:
+    E.Kind = EK_OtherWait;
+    break;
+  }
+  E.TeamSize = 0;
+  E.Imbalance = 0.0;
+  Buffer->WaitBegin.pop_back();
+  Buffer->record(E);
+}
+
+static void ompt_trace_task_create(ompt_data_t *parent_task_data,
+                                   const ompt_frame_t *parent_frame,
+                                   ompt_data_t *new_task_data, int type,
+                                   int has_dependences,
+                                   const void *codeptr_ra) {
+  // Remember where an explicit task comes from; 1 marks an explicit task
+  // without a code address.
+  if (type & ompt_task_explicit)
+    new_task_data->value = codeptr_ra ? (uint64_t)codeptr_ra : 1;
+}
+
+static void ompt_trace_task_schedule(ompt_data_t *first_task_data,
+                                     ompt_task_status_t prior_task_status,
+                                     ompt_data_t *second_task_data) {
+  if (!Buffer)
+    return;
+  uint64_t Now = now();
+  if (first_task_data && first_task_data->value != 0) {
+    Event E;
+    E.Begin = Buffer->SegmentBegin;
+    E.End = Now;
+    E.Codeptr = first_task_data->value == 1
+                    ? nullptr
+                    : (const void *)first_task_data->value;
+    E.Kind = EK_Task;
+    E.TeamSize = 0;
+    E.Imbalance = 0.0;
+    Buffer->record(E);
+  }
+  if (second_task_data && second_task_data->value != 0)
+    Buffer->SegmentBegin = Now;
+}
+
+static void ompt_trace_write(FILE *F) {
+  int Pid = getpid();
+  const char *Sep = "";
+  fprintf(F, "{\"traceEvents\":[\n");
+  for (ThreadBuffer *B = Buffers.load(std::memory_order_acquire); B;
+       B = B->Next) {
+    fprintf(F,
+            "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"tid\":%" PRIu64 ",\"args\":{\"name\":\"OpenMP %s thread %" PRIu64
+            "\"}}",
+            Sep, Pid, B->Id,
+            B->Type == ompt_thread_initial  ? "initial"
+            : B->Type == ompt_thread_worker ? "worker"
+                                            : "other",
+            B->Id);
+    Sep = ",\n";
+    uint64_t Head = B->Head.load(std::memory_order_acquire);
+    uint64_t First = Head > B->Mask + 1 ? Head - (B->Mask + 1) : 0;
+    if (First > 0)
+      fprintf(stderr,
+              "omptrace: dropped the %" PRIu64 " oldest events of thread %" PRIu64
+              ", increase buffer_size in OMPTRACE_OPTIONS\n",
+              First, B->Id);
+    for (uint64_t I = First; I < Head; ++I) {
+      const Event &E = B->Events[I & B->Mask];
+      fprintf(F,
+              "%s{\"name\":\"%s\",\"cat\":\"omp\",\"ph\":\"X\",\"pid\":%d,"
+              "\"tid\":%" PRIu64 ",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"args\":{\"codeptr\":\"%p\"",
+              Sep, EventNames[E.Kind], Pid, B->Id, (E.Begin - Origin) / 1e3,
+              (E.End - E.Begin) / 1e3, E.Codeptr);
+      if (E.Kind == EK_Parallel || E.Kind == EK_Teams)
+        fprintf(F, ",\"team_size\":%u,\"imbalance\":%.4f", E.TeamSize,
+                E.Imbalance);
+      fprintf(F, "}}");
+    }
+  }
+  fprintf(F, "\n],\"displayTimeUnit\":\"ns\"}\n");
+}
+
+#define SET_CALLBACK_T(event, type)                                            \
+  do {                                                                         \
+    ompt_callback_##type##_t trace_##event = &ompt_trace_##event;              \
+    if (ompt_set_callback(ompt_callback_##event,                               \
+                          (ompt_callback_t)trace_##event) < ompt_set_always && \
+        trace_flags->verbose)                                                  \
+      fprintf(stderr, "omptrace: callback '" #event "' is not supported\n");  \
+  } while (0)
+
+#define SET_CALLBACK(event) SET_CALLBACK_T(event, event)
+
+static int ompt_trace_initialize(ompt_function_lookup_t lookup,
+                                 int device_num, ompt_data_t *tool_data) {
+  ompt_set_callback_t ompt_set_callback =
+      (ompt_set_callback_t)lookup("ompt_set_callback");
+  if (ompt_set_callback == NULL) {
+    std::cerr << "Could not set callback, exiting..." << std::endl;
+    std::exit(1);
+  }
+  Origin = now();
+
+  SET_CALLBACK(thread_begin);
+  SET_CALLBACK(parallel_begin);
+  SET_CALLBACK(parallel_end);
+  SET_CALLBACK(implicit_task);
+  SET_CALLBACK(sync_region);
+  SET_CALLBACK_T(sync_region_wait, sync_region);
+  SET_CALLBACK(task_create);
+  SET_CALLBACK(task_schedule);
+  return 1; // success
+}
+
+static void ompt_trace_finalize(ompt_data_t *tool_data) {
+  FILE *F = fopen(trace_flags->file.c_str(), "w");
+  if (F) {
+    ompt_trace_write(F);
+    fclose(F);
+    if (trace_flags->verbose)
+      fprintf(stderr, "omptrace: trace written to %s\n",
+              trace_flags->file.c_str());
+  } else {
+    fprintf(stderr, "omptrace: cannot open %s: %s\n",
+            trace_flags->file.c_str(), strerror(errno));
+  }
+
+  ThreadBuffer *B = Buffers.exchange(nullptr);
+  while (B) {
+    ThreadBuffer *Next = B->Next;
+    delete B;
+    B = Next;
+  }
+  delete trace_flags;
+  trace_flags = nullptr;
+}
+
+extern "C" ompt_start_tool_result_t *
+ompt_start_tool(unsigned int omp_version, const char *runtime_version) {
+  trace_flags = new TraceFlags(getenv("OMPTRACE_OPTIONS"));
+  static ompt_start_tool_result_t ompt_start_tool_result = {
+      &ompt_trace_initialize, &ompt_trace_finalize, {0}};
+  return &ompt_start_tool_result;
+}
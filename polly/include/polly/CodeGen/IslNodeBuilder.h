@@ -418,6 +418,24 @@ private:
   void generateCopyStmt(ScopStmt *Stmt,
                         __isl_keep isl_id_to_ast_expr *NewAccesses);
 
+  /// Create code for a block copy statement.
+  ///
+  /// A block copy statement transfers a box of elements with a
+  /// two-dimensional DMA transfer. Its read and its write memory access
+  /// describe the first element of the box in the source and in the target
+  /// array; the rows of the box are the innermost dimension of the arrays.
+  /// If the statement is synchronous, we wait for the DMA engine to complete
+  /// all transfers afterwards.
+  ///
+  /// @param Stmt The block copy statement that contains the accesses.
+  /// @param NewAccesses The hash table that contains remappings from memory
+  ///                    ids to new access expressions.
+  void generateBlockCopyStmt(ScopStmt *Stmt,
+                             __isl_keep isl_id_to_ast_expr *NewAccesses);
+
+  /// Return the number of bytes between consecutive rows of @p SAI.
+  Value *getRowStride(const ScopArrayInfo *SAI);
+
   /// Materialize a canonical loop induction variable for `L`, which is a loop
   /// that is *not* present in the Scop.
   ///
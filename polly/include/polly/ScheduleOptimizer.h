@@ -10,6 +10,7 @@
 #define POLLY_SCHEDULEOPTIMIZER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "isl/isl-noexceptions.h"
 
 namespace llvm {
@@ -248,6 +249,11 @@ private:
   /// We are looking for an innermost band node and apply the following
   /// transformations:
   ///
+  ///  - Tile the band for a scratchpad memory and copy the tiles with DMA
+  ///    transfers
+  ///      - if -polly-scratchpad-tiling is given and the tiles of all arrays
+  ///        the band accesses can be copied (see optimizeScratchpadBand)
+  ///
   ///  - Tile the band
   ///      - if the band is tileable
   ///      - if the band has more than one loop dimension
@@ -329,8 +335,67 @@ private:
   static isl::schedule_node
   createMicroKernel(isl::schedule_node Node,
                     MicroKernelParamsTy MicroKernelParams);
+
+  /// Tile a band for a software-managed scratchpad memory.
+  ///
+  /// The band is tiled with the largest tile size, starting from
+  /// -polly-scratchpad-default-tile-size and halving it, for which the
+  /// rectangular footprints of a tile in all arrays it accesses fit into
+  /// -polly-scratchpad-size bytes. Each array is then accessed through a
+  /// buffer in the scratchpad, which block copy statements fill and drain
+  /// with DMA transfers:
+  ///
+  ///   - Arrays whose footprint does not change along the innermost tile loop
+  ///     are copied in before that loop and, if written, copied out after it.
+  ///   - Arrays that are only read are double buffered along the innermost
+  ///     tile loop: the footprint of the next tile is transferred while the
+  ///     current tile is computed.
+  ///   - All other arrays are copied in before and copied out after each
+  ///     tile.
+  ///
+  /// Example (a matrix multiplication C[i][j] += A[i][k] * B[k][j]):
+  ///
+  /// | for (ti = 0; ti < N / T; ti++)
+  /// |   for (tj = 0; tj < N / T; tj++) {
+  /// |     copy C[T*ti:T][T*tj:T] to Buf_C
+  /// |     for (tk = 0; tk < N / T; tk++) {
+  /// |       if (tk == 0)
+  /// |         copy A[T*ti:T][0:T] to Buf_A[0] and B[0:T][T*tj:T] to Buf_B[0]
+  /// |       wait for all transfers
+  /// |       if (tk < N / T - 1)
+  /// |         copy the tiles tk + 1 of A and B to Buf_A[1 - tk % 2] and
+  /// |              Buf_B[1 - tk % 2]
+  /// |       compute the tile on Buf_A[tk % 2], Buf_B[tk % 2] and Buf_C
+  /// |     }
+  /// |     copy Buf_C to C[T*ti:T][T*tj:T] and wait
+  /// |   }
+  ///
+  /// @param Node The band node to be tiled.
+  /// @return The point band of the tiled band, or a null node if the band
+  ///         accesses arrays that cannot be copied to the scratchpad or no
+  ///         tile size is small enough.
+  static isl::schedule_node optimizeScratchpadBand(isl::schedule_node Node);
+};
+
+/// The rectangular hull of the array elements each tile accesses.
+struct ScratchpadBoxTy {
+  /// The first element of the box of each tile.
+  isl::multi_pw_aff Offset;
+
+  /// The number of elements of the box of each tile along each dimension.
+  isl::multi_pw_aff Extent;
+
+  /// The largest extent along each dimension over all tiles.
+  llvm::SmallVector<long, 4> MaxExtent;
 };
 
+/// Compute the rectangular hull of the footprint of each tile.
+///
+/// @param Footprint A map from the tiles to the array elements they access.
+/// @param Box       Set to the box of each tile.
+/// @return True, if the extents of the boxes are bounded, false otherwise.
+bool getScratchpadBox(isl::map Footprint, ScratchpadBoxTy &Box);
+
 /// Build the desired set of partial tile prefixes.
 ///
 /// We build a set of partial tile prefixes, which are prefixes of the vector
@@ -1259,6 +1259,14 @@ private:
   /// The isl AST build for the new generated AST.
   isl::ast_build Build;
 
+  /// For a copy statement that transfers a whole block with one DMA
+  /// transfer, the extents of the block along each dimension of the
+  /// accessed arrays.
+  isl::multi_pw_aff BlockExtents;
+
+  /// Whether the DMA transfer of a block copy statement is waited for.
+  bool SynchronousBlockCopy = false;
+
   SmallVector<Loop *, 4> NestLoops;
 
   std::string BaseName;
@@ -1327,6 +1335,32 @@ public:
   /// Return true if this is a copy statement.
   bool isCopyStmt() const { return BB == nullptr && R == nullptr; }
 
+  /// Return true if this copy statement transfers a block of elements.
+  ///
+  /// The accesses of a block copy statement describe the first element of
+  /// the block in the source and in the target array.
+  bool isBlockCopyStmt() const {
+    return isCopyStmt() && !BlockExtents.is_null();
+  }
+
+  /// Turn this copy statement into a block copy statement.
+  ///
+  /// @param Extents     The number of elements of the block along each
+  ///                    dimension, as a function of the statement instance.
+  /// @param Synchronous Whether the transfer must complete before the
+  ///                    statement is done.
+  void setBlockCopy(isl::multi_pw_aff Extents, bool Synchronous) {
+    assert(isCopyStmt() && "Only copy statements can transfer blocks");
+    BlockExtents = Extents;
+    SynchronousBlockCopy = Synchronous;
+  }
+
+  /// Get the extents of the block a block copy statement transfers.
+  isl::multi_pw_aff getBlockCopyExtents() const { return BlockExtents; }
+
+  /// Return true if the transfer of a block copy statement is waited for.
+  bool isSynchronousBlockCopy() const { return SynchronousBlockCopy; }
+
   /// Get the region represented by this ScopStmt (if any).
   ///
   /// @return The region represented by this ScopStmt, or null if the statement
@@ -43,6 +43,8 @@
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicsRISCV.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
 #include "llvm/Support/Casting.h"
@@ -426,6 +428,13 @@ void IslNodeBuilder::createMark(__isl_take isl_ast_node *Node) {
     auto *BasePtr = static_cast<Value *>(isl_id_get_user(Id));
     Annotator.addInterIterationAliasFreeBasePtr(BasePtr);
   }
+  // The DMA transfers into the scratchpad buffers of a tile must complete
+  // before the tile is computed.
+  if (strcmp(isl_id_get_name(Id), "Scratchpad DMA wait") == 0) {
+    Module *M = Builder.GetInsertBlock()->getModule();
+    Builder.CreateCall(
+        Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_wait_for_idle));
+  }
   create(Child);
   isl_id_free(Id);
 }
@@ -956,6 +965,65 @@ void IslNodeBuilder::generateCopyStmt(
   Builder.CreateStore(LoadValue, StoreAddr);
 }
 
+Value *IslNodeBuilder::getRowStride(const ScopArrayInfo *SAI) {
+  Value *ElemSize = Builder.getInt32(SAI->getElemSizeInBytes());
+  unsigned Dims = SAI->getNumberOfDimensions();
+  if (Dims < 2)
+    return ElemSize;
+  Value *RowElems = generateSCEV(SAI->getDimensionSize(Dims - 1));
+  RowElems = Builder.CreateSExtOrTrunc(RowElems, Builder.getInt32Ty());
+  return Builder.CreateMul(RowElems, ElemSize);
+}
+
+void IslNodeBuilder::generateBlockCopyStmt(
+    ScopStmt *Stmt, __isl_keep isl_id_to_ast_expr *NewAccesses) {
+  assert(Stmt->size() == 2);
+  auto ReadAccess = Stmt->begin();
+  auto WriteAccess = ReadAccess++;
+  assert((*ReadAccess)->isRead() && (*WriteAccess)->isMustWrite());
+  assert((*ReadAccess)->isArrayKind() && (*WriteAccess)->isArrayKind());
+  const ScopArrayInfo *SrcSAI = (*ReadAccess)->getLatestScopArrayInfo();
+  const ScopArrayInfo *DstSAI = (*WriteAccess)->getLatestScopArrayInfo();
+  Type *Int32Ty = Builder.getInt32Ty();
+  Type *Int64Ty = Builder.getInt64Ty();
+
+  auto *AccessExpr =
+      isl_id_to_ast_expr_get(NewAccesses, (*ReadAccess)->getId().release());
+  Value *Src = Builder.CreatePtrToInt(
+      ExprBuilder.createAccessAddress(AccessExpr), Int64Ty);
+  AccessExpr =
+      isl_id_to_ast_expr_get(NewAccesses, (*WriteAccess)->getId().release());
+  Value *Dst = Builder.CreatePtrToInt(
+      ExprBuilder.createAccessAddress(AccessExpr), Int64Ty);
+
+  // Evaluate the extents of the block at the current statement instance.
+  isl::ast_build Build = Stmt->getAstBuild();
+  isl::union_map Schedule = Build.get_schedule().intersect_domain(
+      isl::union_set(Stmt->getDomain()));
+  isl::pw_multi_aff Iterators =
+      isl::pw_multi_aff::from_map(isl::map::from_union_map(Schedule).reverse());
+  isl::multi_pw_aff Extents = Stmt->getBlockCopyExtents().pullback(Iterators);
+  unsigned Dims = Extents.dim(isl::dim::out);
+  auto CreateExtent = [&](unsigned Dim) {
+    isl::ast_expr Extent = Build.expr_from(Extents.get_pw_aff(Dim));
+    return Builder.CreateSExtOrTrunc(ExprBuilder.create(Extent.release()),
+                                     Int32Ty);
+  };
+  Value *RowBytes =
+      Builder.CreateMul(CreateExtent(Dims - 1),
+                        Builder.getInt32(SrcSAI->getElemSizeInBytes()));
+  Value *Rows = Dims > 1 ? CreateExtent(Dims - 2) : Builder.getInt32(1);
+
+  Module *M = Builder.GetInsertBlock()->getModule();
+  Builder.CreateCall(
+      Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_start_twod),
+      {Src, Dst, RowBytes, getRowStride(SrcSAI), getRowStride(DstSAI), Rows,
+       Builder.getInt32(0)});
+  if (Stmt->isSynchronousBlockCopy())
+    Builder.CreateCall(
+        Intrinsic::getDeclaration(M, Intrinsic::riscv_sdma_wait_for_idle));
+}
+
 Value *IslNodeBuilder::materializeNonScopLoopInductionVariable(const Loop *L) {
   assert(OutsideLoopIterations.find(L) == OutsideLoopIterations.end() &&
          "trying to materialize loop induction variable twice");
@@ -981,7 +1049,10 @@ void IslNodeBuilder::createUser(__isl_take isl_ast_node *User) {
 
   Stmt = (ScopStmt *)isl_id_get_user(Id);
   auto *NewAccesses = createNewAccesses(Stmt, User);
-  if (Stmt->isCopyStmt()) {
+  if (Stmt->isBlockCopyStmt()) {
+    generateBlockCopyStmt(Stmt, NewAccesses);
+    isl_ast_expr_free(Expr);
+  } else if (Stmt->isCopyStmt()) {
     generateCopyStmt(Stmt, NewAccesses);
     isl_ast_expr_free(Expr);
   } else {
@@ -28,6 +28,8 @@
 //  - Prevectorization - The choice of a possible outer loop that is strip-mined
 //                       to the innermost level to enable inner-loop
 //                       vectorization.
+//  - Tiling for software-managed scratchpad memories, with DMA transfers of
+//    the tiles of each array (-polly-scratchpad-tiling)
 //  - Some optimizations for spatial locality are also planned.
 //
 // For a detailed description of the schedule tree itself please see section 6
@@ -55,6 +57,8 @@
 #include "polly/ScopPass.h"
 #include "polly/Simplify.h"
 #include "polly/Support/ISLOStream.h"
+#include "polly/Support/ISLTools.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/Function.h"
@@ -63,6 +67,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "isl/ctx.h"
+#include "isl/ilp.h"
 #include "isl/options.h"
 #include "isl/printer.h"
 #include "isl/schedule.h"
@@ -261,6 +266,22 @@ static cl::opt<bool>
                 cl::desc("Perform optimizations based on pattern matching"),
                 cl::init(true), cl::ZeroOrMore, cl::cat(PollyCategory));
 
+static cl::opt<bool> ScratchpadTiling(
+    "polly-scratchpad-tiling",
+    cl::desc("Tile for a software-managed scratchpad memory and copy the "
+             "tiles with DMA transfers"),
+    cl::init(false), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<int> ScratchpadSize(
+    "polly-scratchpad-size",
+    cl::desc("The capacity of the scratchpad memory in bytes"), cl::Hidden,
+    cl::init(65536), cl::ZeroOrMore, cl::cat(PollyCategory));
+
+static cl::opt<int> ScratchpadDefaultTileSize(
+    "polly-scratchpad-default-tile-size",
+    cl::desc("The largest tile size tried for scratchpad tiling"), cl::Hidden,
+    cl::init(64), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> OptimizedScops(
     "polly-optimized-scops",
     cl::desc("Polly - Dump polyhedral description of Scops optimized with "
@@ -294,6 +315,7 @@ STATISTIC(RegisterTileOpts, "Number of register tiling applied");
 STATISTIC(PrevectOpts, "Number of strip-mining for prevectorization applied");
 STATISTIC(MatMulOpts,
           "Number of matrix multiplication patterns detected and optimized");
+STATISTIC(ScratchpadTileOpts, "Number of scratchpad tiling applied");
 
 /// Create an isl::union_set, which describes the isolate option based on
 /// IsolateDomain.
@@ -1326,6 +1348,308 @@ bool ScheduleTreeOptimizer::isMatrMultPattern(isl::schedule_node Node,
   return false;
 }
 
+bool getScratchpadBox(isl::map Footprint, ScratchpadBoxTy &Box) {
+  isl::ctx Ctx = Footprint.get_ctx();
+  unsigned Dims = Footprint.dim(isl::dim::out);
+  Box.MaxExtent.clear();
+  for (unsigned i = 0; i < Dims; i++) {
+    isl::pw_aff Lo = Footprint.dim_min(i);
+    isl::pw_aff Hi = Footprint.dim_max(i);
+    isl::pw_aff One(Lo.domain(), isl::val(Ctx, 1));
+    isl::pw_aff Extent = Hi.sub(Lo).add(One);
+    isl::set Extents = isl::map::from_pw_aff(Extent).range();
+    isl::val Max = isl::manage(isl_set_dim_max_val(Extents.release(), 0));
+    if (Max.is_null() || !Max.is_int())
+      return false;
+    Box.MaxExtent.push_back(Max.get_num_si());
+    Box.Offset =
+        i == 0 ? isl::multi_pw_aff(Lo) : Box.Offset.flat_range_product(Lo);
+    Box.Extent = i == 0 ? isl::multi_pw_aff(Extent)
+                        : Box.Extent.flat_range_product(Extent);
+  }
+  return Dims > 0;
+}
+
+namespace {
+/// The accesses of a band to an array and the buffer the array is copied to.
+struct ScratchpadArrayTy {
+  /// The accesses to the array.
+  SmallVector<MemoryAccess *, 4> Accesses;
+
+  /// The elements of the array each statement instance accesses.
+  isl::union_map Accessed;
+
+  /// Whether the array is written.
+  bool Written = false;
+
+  /// Whether the footprint of a tile does not change along the innermost
+  /// tile loop, so that the buffer is filled and drained around that loop.
+  bool Resident = false;
+
+  /// Whether the buffer holds the footprints of two consecutive tiles.
+  bool DoubleBuffered = false;
+
+  /// The footprint of each tile, or of each iteration of the loops around the
+  /// innermost tile loop for resident arrays.
+  ScratchpadBoxTy Box;
+};
+
+using ScratchpadArraysTy = MapVector<const ScopArrayInfo *, ScratchpadArrayTy>;
+} // namespace
+
+/// Collect the array accesses of the statement instances in @p Domain.
+///
+/// @return False, if some array cannot be copied to a scratchpad.
+static bool collectScratchpadArrays(isl::union_set Domain,
+                                    ScratchpadArraysTy &Arrays) {
+  for (isl::set Set : Domain.get_set_list()) {
+    auto *Stmt = static_cast<ScopStmt *>(Set.get_tuple_id().get_user());
+
+    // The new access relations are defined on the instances in the band, so
+    // those must be all instances of the statement.
+    if (!Stmt || Stmt->isCopyStmt() || !Stmt->getDomain().is_subset(Set))
+      return false;
+
+    for (MemoryAccess *MA : *Stmt) {
+      if (!MA->isLatestArrayKind())
+        continue;
+      const ScopArrayInfo *SAI = MA->getLatestScopArrayInfo();
+      if (!MA->isAffine() || SAI->getNumberOfDimensions() == 0 ||
+          SAI->getBasePtrOriginSAI() ||
+          MA->getElementType() != SAI->getElementType())
+        return false;
+      ScratchpadArrayTy &Array = Arrays[SAI];
+      isl::union_map Accessed =
+          MA->getLatestAccessRelation().intersect_domain(Set);
+      Array.Accesses.push_back(MA);
+      Array.Accessed =
+          Array.Accessed.is_null() ? Accessed : Array.Accessed.unite(Accessed);
+      Array.Written |= MA->isWrite();
+    }
+  }
+  return !Arrays.empty();
+}
+
+/// Return true if @p Function does not depend on its input dimension @p Pos.
+static bool isIndependentOf(isl::multi_pw_aff Function, unsigned Pos) {
+  isl::map Map = isl::map::from_multi_pw_aff(Function);
+  return Map.project_out(isl::dim::in, Pos, 1).is_single_valued().is_true();
+}
+
+/// Compute the footprints of the tiles in all arrays.
+///
+/// @param Arrays      The arrays accessed by the tiled band.
+/// @param Prefix      The prefix schedule of the point band.
+/// @param OuterPrefix The prefix schedule of the innermost tile loop.
+/// @return The number of bytes of scratchpad the buffers take, or -1 if the
+///         footprints cannot be copied with two-dimensional DMA transfers.
+static long computeScratchpadFootprints(ScratchpadArraysTy &Arrays,
+                                        isl::union_map Prefix,
+                                        isl::union_map OuterPrefix) {
+  unsigned TileLoop = getNumScatterDims(Prefix) - 1;
+  long Bytes = 0;
+  for (auto &ArrayAndAccesses : Arrays) {
+    const ScopArrayInfo *SAI = ArrayAndAccesses.first;
+    ScratchpadArrayTy &Array = ArrayAndAccesses.second;
+    isl::union_map Footprint = Prefix.reverse().apply_range(Array.Accessed);
+    if (!getScratchpadBox(isl::map::from_union_map(Footprint), Array.Box))
+      return -1;
+    Array.Resident = isIndependentOf(Array.Box.Offset, TileLoop) &&
+                     isIndependentOf(Array.Box.Extent, TileLoop);
+    if (Array.Resident) {
+      Footprint = OuterPrefix.reverse().apply_range(Array.Accessed);
+      if (!getScratchpadBox(isl::map::from_union_map(Footprint), Array.Box))
+        return -1;
+    }
+    Array.DoubleBuffered = !Array.Resident && !Array.Written;
+
+    // A DMA transfer copies a sequence of rows, so all but the two innermost
+    // dimensions must be fixed within a tile.
+    long Elements = 1;
+    unsigned Dims = Array.Box.MaxExtent.size();
+    for (unsigned i = 0; i < Dims; i++) {
+      if (i + 2 < Dims && Array.Box.MaxExtent[i] != 1)
+        return -1;
+      Elements *= Array.Box.MaxExtent[i];
+    }
+    Bytes += Elements * SAI->getElemSizeInBytes() *
+             (Array.DoubleBuffered ? 2 : 1);
+  }
+  return Bytes;
+}
+
+/// Return a map from @p Domain to the first element of @p Buffer, or, if the
+/// buffer is double buffered, of the half of the buffer @p Half selects.
+static isl::map getBufferStart(isl::set Domain, const ScopArrayInfo *Buffer,
+                               isl::pw_aff Half) {
+  isl::map Zero = isl::map::from_pw_aff(
+      isl::pw_aff(Domain, isl::val(Domain.get_ctx(), 0)));
+  isl::map Start = Half.is_null()
+                       ? Zero
+                       : isl::map::from_pw_aff(Half.intersect_domain(Domain));
+  for (unsigned i = 1; i < Buffer->getNumberOfDimensions(); i++)
+    Start = Start.flat_range_product(Zero);
+  return Start.set_tuple_id(isl::dim::out, Buffer->getBasePtrId());
+}
+
+/// Add a block copy statement to @p Extension.
+///
+/// For each element of @p Domain, the statement copies a box of @p Extent
+/// elements that starts at @p Source to the location @p Target.
+static void addBlockCopy(isl::union_map &Extension, Scop &S, isl::set Domain,
+                         isl::map Source, isl::map Target,
+                         isl::multi_pw_aff Extent, bool Synchronous) {
+  if (Domain.is_empty())
+    return;
+  Source = Source.intersect_domain(Domain);
+  Target = Target.intersect_domain(Domain);
+  ScopStmt *Stmt = S.addScopStmt(Source, Target, Domain);
+  isl::id Id = Stmt->getDomainId();
+  Extent = Extent.intersect_domain(Domain).set_tuple_id(isl::dim::in, Id);
+  Stmt->setBlockCopy(Extent, Synchronous);
+  isl::map Copy = isl::map::identity(Domain.get_space().map_from_set());
+  Copy = Copy.intersect_domain(Domain).set_tuple_id(isl::dim::out, Id);
+  Extension = Extension.unite(Copy);
+}
+
+/// Graft the statements of @p Extension before or after @p Node.
+static isl::schedule_node graftBlockCopies(isl::schedule_node Node,
+                                           isl::union_map Extension,
+                                           bool Before) {
+  if (Extension.is_empty())
+    return Node;
+  auto Graft = isl::schedule_node::from_extension(Extension);
+  return Before ? Node.graft_before(Graft) : Node.graft_after(Graft);
+}
+
+/// Redirect the accesses of a tiled band to buffers in the scratchpad and
+/// copy the footprints of the tiles to and from the buffers.
+///
+/// @param TileBand The innermost tile loop, whose child is the mark of the
+///                 point band.
+/// @param Arrays   The arrays and the footprints of their tiles.
+/// @return The point band.
+static isl::schedule_node copyTilesToScratchpad(isl::schedule_node TileBand,
+                                                ScratchpadArraysTy &Arrays) {
+  isl::schedule_node PointBand = TileBand.child(0).child(0);
+  isl::union_map Prefix = PointBand.get_prefix_schedule_relation();
+  isl::union_map OuterPrefix = TileBand.get_prefix_schedule_relation();
+  isl::set Tiles = isl::set(Prefix.range());
+  isl::ctx Ctx = Tiles.get_ctx();
+  unsigned TileLoop = Tiles.dim(isl::dim::set) - 1;
+
+  // The next tile along the innermost tile loop, and the half of a double
+  // buffer each tile is computed on.
+  isl::multi_aff Next =
+      isl::multi_aff::identity(Tiles.get_space().map_from_set());
+  Next = Next.set_aff(TileLoop, Next.get_aff(TileLoop).add_constant_si(1));
+  isl::map NextMap = isl::map::from_multi_aff(Next);
+  isl::pw_aff Half =
+      isl::pw_aff::var_on_domain(isl::local_space(Tiles.get_space()),
+                                 isl::dim::set, TileLoop)
+          .mod(isl::val(Ctx, 2));
+
+  isl::union_map Empty = isl::union_map::empty(Tiles.get_space().params());
+  isl::union_map OuterCopyIn = Empty, OuterCopyOut = Empty;
+  isl::union_map CopyIn = Empty, Prefetch = Empty, CopyOut = Empty;
+  for (auto &ArrayAndAccesses : Arrays) {
+    const ScopArrayInfo *SAI = ArrayAndAccesses.first;
+    ScratchpadArrayTy &Array = ArrayAndAccesses.second;
+    Scop &S = *Array.Accesses.front()->getStatement()->getParent();
+
+    std::vector<unsigned> Sizes;
+    if (Array.DoubleBuffered)
+      Sizes.push_back(2);
+    for (long Extent : Array.Box.MaxExtent)
+      Sizes.push_back(Extent);
+    auto *Buffer = S.createScopArrayInfo(
+        SAI->getElementType(),
+        SAI->getName() + "_scratchpad" + std::to_string(S.getCopyStmtsNum()),
+        Sizes);
+
+    isl::union_map Schedule = Array.Resident ? OuterPrefix : Prefix;
+    isl::map Offset = isl::map::from_multi_pw_aff(Array.Box.Offset);
+    Offset = Offset.set_tuple_id(isl::dim::out, SAI->getBasePtrId());
+    for (MemoryAccess *MA : Array.Accesses) {
+      isl::union_set StmtDomain(MA->getStatement()->getDomain());
+      isl::map StmtSchedule =
+          isl::map::from_union_map(Schedule.intersect_domain(StmtDomain));
+      isl::map Local = MA->getLatestAccessRelation().sum(
+          StmtSchedule.apply_range(Offset).neg());
+      if (Array.DoubleBuffered)
+        Local = StmtSchedule.apply_range(isl::map::from_pw_aff(Half))
+                    .flat_range_product(Local);
+      MA->setNewAccessRelation(
+          Local.set_tuple_id(isl::dim::out, Buffer->getBasePtrId()));
+    }
+
+    isl::set Domain = Offset.domain();
+    isl::pw_aff NoHalf;
+    if (Array.Resident) {
+      isl::map Start = getBufferStart(Domain, Buffer, NoHalf);
+      addBlockCopy(OuterCopyIn, S, Domain, Offset, Start, Array.Box.Extent,
+                   false);
+      if (Array.Written)
+        addBlockCopy(OuterCopyOut, S, Domain, Start, Offset, Array.Box.Extent,
+                     true);
+    } else if (Array.DoubleBuffered) {
+      // The first tile of each sequence of consecutive tiles is copied when
+      // it starts, the others are prefetched during the tile before.
+      isl::set First = Domain.subtract(Tiles.apply(NextMap));
+      addBlockCopy(CopyIn, S, First, Offset,
+                   getBufferStart(First, Buffer, Half), Array.Box.Extent,
+                   false);
+      isl::set Ahead = Tiles.intersect(Domain.apply(NextMap.reverse()));
+      addBlockCopy(Prefetch, S, Ahead, NextMap.apply_range(Offset),
+                   getBufferStart(Ahead, Buffer, Half.pullback(Next)),
+                   Array.Box.Extent.pullback(Next), false);
+    } else {
+      isl::map Start = getBufferStart(Domain, Buffer, NoHalf);
+      addBlockCopy(CopyIn, S, Domain, Offset, Start, Array.Box.Extent, false);
+      addBlockCopy(CopyOut, S, Domain, Start, Offset, Array.Box.Extent, true);
+    }
+  }
+
+  // All transfers that precede a tile complete before it is computed; the
+  // prefetches for the next tile overlap with the computation.
+  TileBand = graftBlockCopies(TileBand, OuterCopyIn, true);
+  TileBand = graftBlockCopies(TileBand, OuterCopyOut, false);
+  PointBand = TileBand.child(0).child(0);
+  PointBand = PointBand.insert_mark(
+      isl::id::alloc(Ctx, "Scratchpad DMA wait", nullptr));
+  PointBand = graftBlockCopies(PointBand, CopyIn, true);
+  PointBand = graftBlockCopies(PointBand.child(0), Prefetch, true);
+  return graftBlockCopies(PointBand, CopyOut, false);
+}
+
+isl::schedule_node
+ScheduleTreeOptimizer::optimizeScratchpadBand(isl::schedule_node Node) {
+  ScratchpadArraysTy Arrays;
+  if (!collectScratchpadArrays(Node.get_domain(), Arrays))
+    return nullptr;
+
+  unsigned Dims = isl_schedule_node_band_n_member(Node.get());
+  for (int TileSize = ScratchpadDefaultTileSize; TileSize > 1; TileSize /= 2) {
+    // Split the innermost tile loop off the tile band, so that the buffers of
+    // resident arrays can be copied around it.
+    auto TileBand =
+        tileNode(Node, "Scratchpad tiling", {}, TileSize).parent().parent();
+    TileBand = isl::manage(
+        isl_schedule_node_band_split(TileBand.release(), Dims - 1));
+    TileBand = TileBand.child(0);
+    auto Prefix = TileBand.child(0).child(0).get_prefix_schedule_relation();
+    long Bytes = computeScratchpadFootprints(
+        Arrays, Prefix, TileBand.get_prefix_schedule_relation());
+    if (Bytes < 0)
+      return nullptr;
+    LLVM_DEBUG(dbgs() << "Scratchpad tiles of size " << TileSize << " take "
+                      << Bytes << " bytes\n");
+    if (Bytes <= ScratchpadSize)
+      return copyTilesToScratchpad(TileBand, Arrays);
+  }
+  return nullptr;
+}
+
 __isl_give isl_schedule_node *
 ScheduleTreeOptimizer::optimizeBand(__isl_take isl_schedule_node *Node,
                                     void *User) {
@@ -1335,6 +1659,16 @@ ScheduleTreeOptimizer::optimizeBand(__isl_take isl_schedule_node *Node,
   const OptimizerAdditionalInfoTy *OAI =
       static_cast<const OptimizerAdditionalInfoTy *>(User);
 
+  if (ScratchpadTiling) {
+    auto Tiled = optimizeScratchpadBand(isl::manage_copy(Node));
+    if (!Tiled.is_null()) {
+      LLVM_DEBUG(dbgs() << "The band was tiled for the scratchpad\n");
+      ScratchpadTileOpts++;
+      isl_schedule_node_free(Node);
+      return Tiled.release();
+    }
+  }
+
   MatMulInfoTy MMI;
   if (PMBasedOpts && User &&
       isMatrMultPattern(isl::manage_copy(Node), OAI->D, MMI)) {
@@ -56,4 +56,54 @@ TEST(ScheduleOptimizer, getPartialTilePrefixes) {
 
   isl_ctx_free(ctx);
 }
+
+TEST(ScheduleOptimizer, getScratchpadBox) {
+
+  isl_ctx *ctx = isl_ctx_alloc();
+
+  {
+    // Verify that the tiles of 32 x 32 elements of an N x N array start at
+    // multiples of 32 and that the last tiles of each row and column are
+    // partial.
+    isl::map Footprint(ctx, "[N] -> { [t0, t1] -> A[i, j] : 0 <= i < N and "
+                            "0 <= j < N and 32t0 <= i < 32t0 + 32 and "
+                            "32t1 <= j < 32t1 + 32 }");
+    ScratchpadBoxTy Box;
+    EXPECT_TRUE(getScratchpadBox(Footprint, Box));
+    ASSERT_EQ(Box.MaxExtent.size(), 2u);
+    EXPECT_EQ(Box.MaxExtent[0], 32);
+    EXPECT_EQ(Box.MaxExtent[1], 32);
+    isl::map Offset = isl::map::from_multi_pw_aff(Box.Offset);
+    EXPECT_TRUE(Offset.is_equal(
+        isl::map(ctx, "[N] -> { [t0, t1] -> [32t0, 32t1] : t0 >= 0 and "
+                      "t1 >= 0 and 32t0 < N and 32t1 < N }")));
+    isl::map Extent = isl::map::from_multi_pw_aff(Box.Extent);
+    EXPECT_TRUE(Extent.is_equal(isl::map(
+        ctx, "[N] -> { [t0, t1] -> [min(32, N - 32t0), min(32, N - 32t1)] : "
+             "t0 >= 0 and t1 >= 0 and 32t0 < N and 32t1 < N }")));
+  }
+
+  {
+    // Verify that the halo of a stencil is part of the box.
+    isl::map Footprint(
+        ctx, "{ [t] -> A[i] : 0 <= t < 4 and 16t - 1 <= i <= 16t + 16 }");
+    ScratchpadBoxTy Box;
+    EXPECT_TRUE(getScratchpadBox(Footprint, Box));
+    ASSERT_EQ(Box.MaxExtent.size(), 1u);
+    EXPECT_EQ(Box.MaxExtent[0], 18);
+    isl::map Offset = isl::map::from_multi_pw_aff(Box.Offset);
+    EXPECT_TRUE(
+        Offset.is_equal(isl::map(ctx, "{ [t] -> [16t - 1] : 0 <= t < 4 }")));
+  }
+
+  {
+    // Verify that no box is computed for footprints that grow with a
+    // parameter.
+    isl::map Footprint(ctx, "[N] -> { [t] -> A[i] : 0 <= t <= i < N }");
+    ScratchpadBoxTy Box;
+    EXPECT_FALSE(getScratchpadBox(Footprint, Box));
+  }
+
+  isl_ctx_free(ctx);
+}
 } // anonymous namespace
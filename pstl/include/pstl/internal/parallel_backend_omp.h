@@ -0,0 +1,429 @@
+// -*- C++ -*-
+//===-- parallel_backend_omp.h --------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_PARALLEL_BACKEND_OMP_H
+#define _PSTL_PARALLEL_BACKEND_OMP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <omp.h>
+
+#include "pstl_config.h"
+
+#if !defined(_OPENMP)
+#    error _PSTL_PAR_BACKEND_OPENMP requires compiling with OpenMP enabled (-fopenmp)
+#endif
+
+_PSTL_HIDE_FROM_ABI_PUSH
+
+namespace __pstl
+{
+namespace __omp_backend
+{
+
+//------------------------------------------------------------------------
+// Work is split into chunks of about __default_chunk_size elements, which
+// run as OpenMP tasks. Tasks rather than worksharing loops let the
+// algorithms nest: a parallel algorithm called from inside a parallel
+// region adds tasks to the enclosing team instead of oversubscribing the
+// machine with a new one.
+//------------------------------------------------------------------------
+
+constexpr std::size_t __default_chunk_size = 2048;
+
+//! Raw memory buffer with automatic freeing and no exceptions.
+template <typename _Tp>
+class __buffer
+{
+    std::allocator<_Tp> __allocator_;
+    _Tp* __ptr_;
+    const std::size_t __buf_size_;
+    __buffer(const __buffer&) = delete;
+    void
+    operator=(const __buffer&) = delete;
+
+  public:
+    __buffer(std::size_t __n) : __allocator_(), __ptr_(__allocator_.allocate(__n)), __buf_size_(__n) {}
+
+    operator bool() const { return __ptr_ != nullptr; }
+
+    _Tp*
+    get() const
+    {
+        return __ptr_;
+    }
+    ~__buffer() { __allocator_.deallocate(__ptr_, __buf_size_); }
+};
+
+// Cancellation needs OMP_CANCELLATION in the environment, so the algorithms
+// that would use it run to completion instead.
+inline void
+__cancel_execution()
+{
+}
+
+// The division of [0, __n) into chunks.
+struct __chunk_metrics
+{
+    std::size_t __n_chunks;
+    std::size_t __chunk_size;
+    std::size_t __first_chunk_size;
+};
+
+// Splits __n elements into chunks of about __requested_chunk_size elements.
+// The first chunk takes the remainder, so that the others are equal.
+inline __chunk_metrics
+__chunk_partitioner(std::size_t __n, std::size_t __requested_chunk_size = __default_chunk_size)
+{
+    if (__n <= __requested_chunk_size)
+        return __chunk_metrics{1, __n, __n};
+    const std::size_t __n_chunks = __n / __requested_chunk_size;
+    const std::size_t __chunk_size = __n / __n_chunks;
+    return __chunk_metrics{__n_chunks, __chunk_size, __chunk_size + __n % __n_chunks};
+}
+
+// Returns the offsets [__begin, __end) of chunk __chunk.
+inline std::pair<std::size_t, std::size_t>
+__chunk_bounds(const __chunk_metrics& __metrics, std::size_t __chunk)
+{
+    const std::size_t __begin = __chunk == 0 ? 0 : __metrics.__first_chunk_size + (__chunk - 1) * __metrics.__chunk_size;
+    const std::size_t __length = __chunk == 0 ? __metrics.__first_chunk_size : __metrics.__chunk_size;
+    return {__begin, __begin + __length};
+}
+
+// Runs __f on one thread of a parallel region, where the tasks it creates
+// are picked up by the whole team. Inside an existing region __f runs
+// directly and its tasks join the enclosing team.
+template <class _Fp>
+void
+__run_in_team(_Fp&& __f)
+{
+    if (omp_in_parallel())
+    {
+        std::forward<_Fp>(__f)();
+        return;
+    }
+    _PSTL_PRAGMA(omp parallel)
+    _PSTL_PRAGMA(omp single nowait)
+    std::forward<_Fp>(__f)();
+}
+
+// Calls __f(__chunk) for every chunk as tasks, and waits for all of them.
+template <class _Fp>
+void
+__for_each_chunk(const __chunk_metrics& __metrics, _Fp __f)
+{
+    _PSTL_PRAGMA(omp taskloop untied mergeable)
+    for (std::size_t __chunk = 0; __chunk < __metrics.__n_chunks; ++__chunk)
+        __f(__chunk);
+}
+
+//------------------------------------------------------------------------
+// parallel_for
+//------------------------------------------------------------------------
+
+template <class _ExecutionPolicy, class _Index, class _Fp>
+void
+__parallel_for(_ExecutionPolicy&&, _Index __first, _Index __last, _Fp __f)
+{
+    if (__first == __last)
+        return;
+    const __chunk_metrics __metrics = __chunk_partitioner(__last - __first);
+    if (__metrics.__n_chunks == 1)
+    {
+        __f(__first, __last);
+        return;
+    }
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __f(__first + __bounds.first, __first + __bounds.second);
+        });
+    });
+}
+
+//------------------------------------------------------------------------
+// parallel_reduce
+//------------------------------------------------------------------------
+
+template <class _ExecutionPolicy, class _Value, class _Index, typename _RealBody, typename _Reduction>
+_Value
+__parallel_reduce(_ExecutionPolicy&&, _Index __first, _Index __last, const _Value& __identity,
+                  const _RealBody& __real_body, const _Reduction& __reduction)
+{
+    if (__first == __last)
+        return __identity;
+    const __chunk_metrics __metrics = __chunk_partitioner(__last - __first);
+    if (__metrics.__n_chunks == 1)
+        return __real_body(__first, __last, __identity);
+
+    std::vector<_Value> __partials(__metrics.__n_chunks, __identity);
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __partials[__chunk] = __real_body(__first + __bounds.first, __first + __bounds.second, __identity);
+        });
+    });
+    // Combine in order, since the reduction need not be commutative.
+    _Value __result = std::move(__partials[0]);
+    for (std::size_t __chunk = 1; __chunk < __metrics.__n_chunks; ++__chunk)
+        __result = __reduction(std::move(__result), std::move(__partials[__chunk]));
+    return __result;
+}
+
+//------------------------------------------------------------------------
+// parallel_transform_reduce
+//
+// Notation:
+//      r(i,j,init) returns reduction of init with reduction over [i,j)
+//      u(i) returns f(i,i+1,identity) for a hypothetical left identity element
+//      c(x,y) combines values x and y that were the result of r or u
+//------------------------------------------------------------------------
+
+template <class _ExecutionPolicy, class _Index, class _Up, class _Tp, class _Cp, class _Rp>
+_Tp
+__parallel_transform_reduce(_ExecutionPolicy&&, _Index __first, _Index __last, _Up __u, _Tp __init, _Cp __combine,
+                            _Rp __brick_reduce)
+{
+    if (__first == __last)
+        return __init;
+    const __chunk_metrics __metrics = __chunk_partitioner(__last - __first);
+    if (__metrics.__n_chunks == 1)
+        return __brick_reduce(__first, __last, __init);
+
+    // There is no identity element, so every chunk starts from its first
+    // transformed element.
+    std::vector<_Tp> __partials(__metrics.__n_chunks, __init);
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            const _Index __chunk_first = __first + __bounds.first;
+            __partials[__chunk] = __brick_reduce(__chunk_first + 1, __first + __bounds.second, __u(__chunk_first));
+        });
+    });
+    for (std::size_t __chunk = 0; __chunk < __metrics.__n_chunks; ++__chunk)
+        __init = __combine(std::move(__init), std::move(__partials[__chunk]));
+    return __init;
+}
+
+//------------------------------------------------------------------------
+// parallel_scan
+//------------------------------------------------------------------------
+
+// Computes the chunk prefixes __initial, c(__initial, s0), c(c(__initial, s0), s1), ...
+// from the chunk sums, in place, and returns the total.
+template <class _Tp, class _Cp>
+_Tp
+__exclusive_chunk_prefixes(std::vector<_Tp>& __sums, _Tp __initial, _Cp __combine)
+{
+    for (_Tp& __sum : __sums)
+    {
+        _Tp __next = __combine(__initial, __sum);
+        __sum = std::move(__initial);
+        __initial = std::move(__next);
+    }
+    return __initial;
+}
+
+template <class _ExecutionPolicy, typename _Index, typename _Tp, typename _Rp, typename _Cp, typename _Sp,
+          typename _Ap>
+void
+__parallel_strict_scan(_ExecutionPolicy&&, _Index __n, _Tp __initial, _Rp __reduce, _Cp __combine, _Sp __scan,
+                       _Ap __apex)
+{
+    const __chunk_metrics __metrics = __chunk_partitioner(__n);
+    if (__n == 0 || __metrics.__n_chunks == 1)
+    {
+        _Tp __sum = __initial;
+        if (__n)
+            __sum = __combine(__sum, __reduce(_Index(0), __n));
+        __apex(__sum);
+        if (__n)
+            __scan(_Index(0), __n, __initial);
+        return;
+    }
+
+    // Reduce every chunk, then scan every chunk from its prefix.
+    std::vector<_Tp> __sums(__metrics.__n_chunks, __initial);
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __sums[__chunk] = __reduce(_Index(__bounds.first), _Index(__bounds.second - __bounds.first));
+        });
+    });
+    __apex(__exclusive_chunk_prefixes(__sums, __initial, __combine));
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __scan(_Index(__bounds.first), _Index(__bounds.second - __bounds.first), __sums[__chunk]);
+        });
+    });
+}
+
+template <class _ExecutionPolicy, class _Index, class _Up, class _Tp, class _Cp, class _Rp, class _Sp>
+_Tp
+__parallel_transform_scan(_ExecutionPolicy&&, _Index __n, _Up __u, _Tp __init, _Cp __combine, _Rp __brick_reduce,
+                          _Sp __scan)
+{
+    const __chunk_metrics __metrics = __chunk_partitioner(__n);
+    if (__n == 0 || __metrics.__n_chunks == 1)
+        return __scan(_Index(0), __n, __init);
+
+    // The chunk sums exclude __init, which only the first prefix includes.
+    std::vector<_Tp> __sums(__metrics.__n_chunks, __init);
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __sums[__chunk] = __brick_reduce(_Index(__bounds.first + 1), _Index(__bounds.second),
+                                             __u(_Index(__bounds.first)));
+        });
+    });
+    const _Tp __total = __exclusive_chunk_prefixes(__sums, __init, __combine);
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __scan(_Index(__bounds.first), _Index(__bounds.second), __sums[__chunk]);
+        });
+    });
+    return __total;
+}
+
+//------------------------------------------------------------------------
+// parallel_stable_sort
+//------------------------------------------------------------------------
+
+// Merges the sorted chunks [__chunk_first, __chunk_last) of __first in
+// place, halving the range recursively so that independent merges run as
+// tasks. std::inplace_merge keeps the sort stable.
+template <typename _RandomAccessIterator, typename _Compare>
+void
+__merge_sorted_chunks(_RandomAccessIterator __first, const __chunk_metrics& __metrics, std::size_t __chunk_first,
+                      std::size_t __chunk_last, _Compare __comp)
+{
+    if (__chunk_last - __chunk_first < 2)
+        return;
+    const std::size_t __chunk_middle = __chunk_first + (__chunk_last - __chunk_first) / 2;
+    _PSTL_PRAGMA(omp task untied mergeable default(none) firstprivate(__first, __chunk_first, __chunk_middle, __comp) \
+                 shared(__metrics))
+    __merge_sorted_chunks(__first, __metrics, __chunk_first, __chunk_middle, __comp);
+    __merge_sorted_chunks(__first, __metrics, __chunk_middle, __chunk_last, __comp);
+    _PSTL_PRAGMA(omp taskwait)
+    std::inplace_merge(__first + __chunk_bounds(__metrics, __chunk_first).first,
+                       __first + __chunk_bounds(__metrics, __chunk_middle).first,
+                       __first + __chunk_bounds(__metrics, __chunk_last - 1).second, __comp);
+}
+
+template <class _ExecutionPolicy, typename _RandomAccessIterator, typename _Compare, typename _LeafSort>
+void
+__parallel_stable_sort(_ExecutionPolicy&&, _RandomAccessIterator __first, _RandomAccessIterator __last, _Compare __comp,
+                       _LeafSort __leaf_sort, std::size_t = 0)
+{
+    // A partial sort request (the last argument) is satisfied by sorting
+    // everything.
+    const __chunk_metrics __metrics = __chunk_partitioner(__last - __first);
+    if (__metrics.__n_chunks == 1)
+    {
+        __leaf_sort(__first, __last, __comp);
+        return;
+    }
+    __run_in_team([&] {
+        __for_each_chunk(__metrics, [&](std::size_t __chunk) {
+            const auto __bounds = __chunk_bounds(__metrics, __chunk);
+            __leaf_sort(__first + __bounds.first, __first + __bounds.second, __comp);
+        });
+        __merge_sorted_chunks(__first, __metrics, 0, __metrics.__n_chunks, __comp);
+    });
+}
+
+//------------------------------------------------------------------------
+// parallel_merge
+//------------------------------------------------------------------------
+
+template <typename _RandomAccessIterator1, typename _RandomAccessIterator2, typename _RandomAccessIterator3,
+          typename _Compare, typename _LeafMerge>
+void
+__parallel_merge_body(_RandomAccessIterator1 __first1, _RandomAccessIterator1 __last1, _RandomAccessIterator2 __first2,
+                      _RandomAccessIterator2 __last2, _RandomAccessIterator3 __outit, _Compare __comp,
+                      _LeafMerge __leaf_merge)
+{
+    const std::size_t __size1 = __last1 - __first1;
+    const std::size_t __size2 = __last2 - __first2;
+    if (__size1 + __size2 <= __default_chunk_size)
+    {
+        __leaf_merge(__first1, __last1, __first2, __last2, __outit, __comp);
+        return;
+    }
+
+    // Split the larger range in the middle and the other one where that
+    // element belongs, so that equal elements of the first range stay first.
+    _RandomAccessIterator1 __mid1;
+    _RandomAccessIterator2 __mid2;
+    if (__size1 >= __size2)
+    {
+        __mid1 = __first1 + __size1 / 2;
+        __mid2 = std::lower_bound(__first2, __last2, *__mid1, __comp);
+    }
+    else
+    {
+        __mid2 = __first2 + __size2 / 2;
+        __mid1 = std::upper_bound(__first1, __last1, *__mid2, __comp);
+    }
+    const _RandomAccessIterator3 __outit_mid = __outit + (__mid1 - __first1) + (__mid2 - __first2);
+
+    _PSTL_PRAGMA(omp task untied mergeable default(none) \
+                 firstprivate(__first1, __mid1, __first2, __mid2, __outit, __comp, __leaf_merge))
+    __parallel_merge_body(__first1, __mid1, __first2, __mid2, __outit, __comp, __leaf_merge);
+    __parallel_merge_body(__mid1, __last1, __mid2, __last2, __outit_mid, __comp, __leaf_merge);
+    _PSTL_PRAGMA(omp taskwait)
+}
+
+template <class _ExecutionPolicy, typename _RandomAccessIterator1, typename _RandomAccessIterator2,
+          typename _RandomAccessIterator3, typename _Compare, typename _LeafMerge>
+void
+__parallel_merge(_ExecutionPolicy&&, _RandomAccessIterator1 __first1, _RandomAccessIterator1 __last1,
+                 _RandomAccessIterator2 __first2, _RandomAccessIterator2 __last2, _RandomAccessIterator3 __outit,
+                 _Compare __comp, _LeafMerge __leaf_merge)
+{
+    if (std::size_t(__last1 - __first1) + std::size_t(__last2 - __first2) <= __default_chunk_size)
+    {
+        __leaf_merge(__first1, __last1, __first2, __last2, __outit, __comp);
+        return;
+    }
+    __run_in_team(
+        [&] { __parallel_merge_body(__first1, __last1, __first2, __last2, __outit, __comp, __leaf_merge); });
+}
+
+//------------------------------------------------------------------------
+// parallel_invoke
+//------------------------------------------------------------------------
+
+template <class _ExecutionPolicy, typename _F1, typename _F2>
+void
+__parallel_invoke(_ExecutionPolicy&&, _F1&& __f1, _F2&& __f2)
+{
+    __run_in_team([&] {
+        _PSTL_PRAGMA(omp task untied mergeable default(none) shared(__f1))
+        std::forward<_F1>(__f1)();
+        std::forward<_F2>(__f2)();
+        _PSTL_PRAGMA(omp taskwait)
+    });
+}
+
+} // namespace __omp_backend
+} // namespace __pstl
+
+_PSTL_HIDE_FROM_ABI_POP
+
+#endif /* _PSTL_PARALLEL_BACKEND_OMP_H */